@@ -0,0 +1,211 @@
+
+# Copyright (c) 2021-2025, PostgreSQL Global Development Group
+
+# Test CREATE INDEX CONCURRENTLY with concurrent modifications, validating
+# the index from the captured tuples rather than by scanning the table
+use strict;
+use warnings FATAL => 'all';
+
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+
+use Test::More;
+
+my $node;
+
+#
+# Test set-up
+#
+$node = PostgreSQL::Test::Cluster->new('CIC_capture_test');
+$node->init;
+$node->append_conf('postgresql.conf',
+	'lock_timeout = ' . (1000 * $PostgreSQL::Test::Utils::timeout_default));
+$node->append_conf('postgresql.conf', 'concurrent_index_capture_size = 1MB');
+$node->start;
+$node->safe_psql('postgres', q(CREATE EXTENSION amcheck));
+$node->safe_psql('postgres',
+	q(CREATE TABLE tbl(i int, j int, k int, filler text)));
+$node->safe_psql('postgres',
+	q(INSERT INTO tbl SELECT g, g % 100, 0, 'x' FROM generate_series(1, 1000) g)
+);
+$node->safe_psql('postgres', q(CREATE SEQUENCE tbl_seq START 1001));
+$node->safe_psql('postgres', q(CREATE INDEX idx ON tbl(j)));
+$node->safe_psql('postgres', q(CREATE UNIQUE INDEX uidx ON tbl(i)));
+$node->safe_psql('postgres',
+	q(CREATE INDEX pidx ON tbl(k) WHERE j < 50));
+$node->safe_psql('postgres',
+	q(CREATE TABLE ctbl(i int, j int, filler text)
+	  WITH (autovacuum_enabled = off)));
+$node->safe_psql('postgres',
+	q(INSERT INTO ctbl SELECT g, g % 100, 'x' FROM generate_series(1, 1000) g)
+);
+
+#
+# Build an index on ctbl concurrently, with every kind of change made
+# while the index isn't ready for inserts: by transactions that commit
+# before the build takes its snapshot, and by ones that are still running
+# then and only commit (or abort) while the build waits before validation.
+# Returns the number of heap tuples validation looked at.
+#
+sub cic_with_concurrent_changes
+{
+	my ($base) = @_;
+
+	my $blocker = $node->background_psql('postgres');
+	my $builder = $node->background_psql('postgres');
+	my $late = $node->background_psql('postgres');
+	my $aborted = $node->background_psql('postgres');
+
+	# Hold the build in its wait before the build
+	$blocker->query_safe(
+		qq(BEGIN; INSERT INTO ctbl VALUES ($base, 0, 'blocker')));
+
+	my $offset = -s $node->logfile;
+	$builder->query_safe(q(SET log_min_messages = debug2));
+	$builder->query_until(
+		qr/start/, q(
+		\echo start
+		CREATE INDEX CONCURRENTLY cidx ON ctbl(j);
+	));
+	$node->poll_query_until('postgres',
+		q(SELECT phase = 'waiting for writers before build'
+		  FROM pg_stat_progress_create_index
+		  WHERE relid = 'ctbl'::regclass))
+	  or die "timed out waiting for CIC to wait before build";
+
+	# Changes still in progress when the build takes its snapshot: an
+	# insert, a non-HOT update, a HOT update and an insert to be aborted
+	$late->query_safe(
+		qq(BEGIN;
+		   INSERT INTO ctbl VALUES ($base + 1, 1, 'late');
+		   UPDATE ctbl SET j = j + 1 WHERE i = 1;
+		   UPDATE ctbl SET filler = 'hot' WHERE i = 2;));
+	$aborted->query_safe(
+		qq(BEGIN; INSERT INTO ctbl VALUES ($base + 2, 2, 'aborted')));
+
+	# The same changes, committed before the build takes its snapshot
+	$node->safe_psql(
+		'postgres', qq(
+		INSERT INTO ctbl
+		  SELECT $base + 100 + g, g % 100, 'y' FROM generate_series(1, 200) g;
+		UPDATE ctbl SET j = j + 1 WHERE i = 3;
+		UPDATE ctbl SET filler = 'hot' WHERE i = 4;
+		BEGIN;
+		INSERT INTO ctbl VALUES ($base + 3, 3, 'aborted');
+		ROLLBACK;
+	));
+
+	# Let the build go on, until it waits before validation
+	$blocker->query_safe(q(COMMIT));
+	$node->poll_query_until('postgres',
+		q(SELECT phase = 'waiting for writers before validation'
+		  FROM pg_stat_progress_create_index
+		  WHERE relid = 'ctbl'::regclass))
+	  or die "timed out waiting for CIC to wait before validation";
+
+	$aborted->query_safe(q(ROLLBACK));
+	$late->query_safe(q(COMMIT));
+
+	# Wait for the build to finish
+	$builder->query_safe(q(SELECT 1));
+
+	$blocker->quit;
+	$builder->quit;
+	$late->quit;
+	$aborted->quit;
+
+	my $log = slurp_file($node->logfile, $offset);
+	my ($htups, $inserted) = $log =~
+	  /validate_index found (\d+) heap tuples, \d+ index tuples; inserted (\d+) missing tuples/
+	  or die "no validate_index report in server log";
+	is($inserted, 2, 'validation inserted the insert and non-HOT update');
+
+	is( $node->safe_psql('postgres', q(SELECT bt_index_check('cidx', true))),
+		'', 'bt_index_check with heapallindexed');
+	is( $node->safe_psql(
+			'postgres',
+			q(SELECT count(*) FROM ctbl WHERE filler = 'aborted')),
+		'0',
+		'aborted inserts are gone');
+
+	$node->safe_psql('postgres', q(DROP INDEX cidx));
+
+	return $htups;
+}
+
+my $htups = cic_with_concurrent_changes(10000);
+ok($htups < 1000, 'validation looked at the captured tuples only')
+  or diag "validation looked at $htups heap tuples";
+
+#
+# Stress CIC with pgbench.  The updates of k are HOT unless pidx is being
+# built, the updates of j never are.
+#
+# pgbench might try to launch more than one instance of the CIC
+# transaction concurrently.  That would deadlock, so use an advisory
+# lock to ensure only one CIC runs at a time.
+#
+my %scripts = (
+	'007_pgbench_concurrent_insert' => q(
+		INSERT INTO tbl VALUES(nextval('tbl_seq'), random(0, 99), 0, 'y');
+	  ),
+	'007_pgbench_concurrent_update' => q(
+		\set id random(1, 1000)
+		UPDATE tbl SET j = random(0, 99) WHERE i = :id;
+		UPDATE tbl SET k = k + 1 WHERE i = :id + 1;
+	  ),
+	'007_pgbench_concurrent_delete' => q(
+		BEGIN;
+		DELETE FROM tbl WHERE i = random(1, 1000);
+		ROLLBACK;
+	  ),
+	'007_pgbench_concurrent_aborted_insert' => q(
+		BEGIN;
+		INSERT INTO tbl VALUES(nextval('tbl_seq'), random(0, 99), 0, 'z');
+		ROLLBACK;
+	  ),
+	'007_pgbench_concurrent_cic' => q(
+		SELECT pg_try_advisory_lock(42)::integer AS gotlock \gset
+		\if :gotlock
+			DROP INDEX CONCURRENTLY idx;
+			CREATE INDEX CONCURRENTLY idx ON tbl(j);
+			DROP INDEX CONCURRENTLY uidx;
+			CREATE UNIQUE INDEX CONCURRENTLY uidx ON tbl(i);
+			DROP INDEX CONCURRENTLY pidx;
+			CREATE INDEX CONCURRENTLY pidx ON tbl(k) WHERE j < 50;
+			SELECT bt_index_check('idx', true);
+			SELECT bt_index_check('uidx', true, true);
+			SELECT bt_index_check('pidx', true);
+			SELECT pg_advisory_unlock(42);
+		\endif
+	  ));
+
+$node->pgbench(
+	'--no-vacuum --client=5 --transactions=100',
+	0,
+	[qr{actually processed}],
+	[qr{^$}],
+	'concurrent modifications and CIC with captured tuples',
+	\%scripts);
+
+#
+# Do it again with too little memory for the captured tuples, so that the
+# builds have to fall back to scanning the table.
+#
+$node->append_conf('postgresql.conf', 'concurrent_index_capture_size = 1kB');
+$node->restart;
+
+$htups = cic_with_concurrent_changes(20000);
+ok($htups >= 1000, 'validation fell back to scanning the table')
+  or diag "validation looked at $htups heap tuples";
+
+$node->pgbench(
+	'--no-vacuum --client=5 --transactions=100',
+	0,
+	[qr{actually processed}],
+	[qr{^$}],
+	'concurrent modifications and CIC with too many tuples to capture',
+	\%scripts);
+
+$node->stop;
+done_testing();
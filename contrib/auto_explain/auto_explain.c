@@ -36,6 +36,7 @@ static bool auto_explain_log_buffers = false;
 static bool auto_explain_log_wal = false;
 static bool auto_explain_log_triggers = false;
 static bool auto_explain_log_timing = true;
+static bool auto_explain_log_timing_sampling = false;
 static bool auto_explain_log_settings = false;
 static int	auto_explain_log_format = EXPLAIN_FORMAT_TEXT;
 static int	auto_explain_log_level = LOG;
@@ -232,6 +233,17 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable("auto_explain.log_timing_sampling",
+							 "Time only a sample of each plan node's executions.",
+							 NULL,
+							 &auto_explain_log_timing_sampling,
+							 false,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomRealVariable("auto_explain.sample_rate",
 							 "Fraction of queries to process.",
 							 NULL,
@@ -288,7 +300,11 @@ explain_ExecutorStart(QueryDesc *queryDesc, int eflags)
 		if (auto_explain_log_analyze && (eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0)
 		{
 			if (auto_explain_log_timing)
+			{
 				queryDesc->instrument_options |= INSTRUMENT_TIMER;
+				if (auto_explain_log_timing_sampling)
+					queryDesc->instrument_options |= INSTRUMENT_TIMER_SAMPLED;
+			}
 			else
 				queryDesc->instrument_options |= INSTRUMENT_ROWS;
 			if (auto_explain_log_buffers)
@@ -398,6 +414,7 @@ explain_ExecutorEnd(QueryDesc *queryDesc)
 			es->buffers = (es->analyze && auto_explain_log_buffers);
 			es->wal = (es->analyze && auto_explain_log_wal);
 			es->timing = (es->analyze && auto_explain_log_timing);
+			es->sampling = (es->timing && auto_explain_log_timing_sampling);
 			es->summary = es->analyze;
 			/* No support for MEMORY */
 			/* es->memory = false; */
@@ -133,6 +133,7 @@ blhandler(PG_FUNCTION_ARGS)
 	amroutine->ambuildempty = blbuildempty;
 	amroutine->aminsert = blinsert;
 	amroutine->aminsertcleanup = NULL;
+	amroutine->aminsertbatch = NULL;
 	amroutine->ambulkdelete = blbulkdelete;
 	amroutine->amvacuumcleanup = blvacuumcleanup;
 	amroutine->amcanreturn = NULL;
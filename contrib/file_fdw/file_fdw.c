@@ -16,6 +16,7 @@
 #include <unistd.h>
 
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/reloptions.h"
 #include "access/sysattr.h"
 #include "access/table.h"
@@ -32,10 +33,13 @@
 #include "foreign/foreign.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
+#include "optimizer/cost.h"
 #include "optimizer/optimizer.h"
 #include "optimizer/pathnode.h"
+#include "optimizer/paths.h"
 #include "optimizer/planmain.h"
 #include "optimizer/restrictinfo.h"
+#include "port/atomics.h"
 #include "utils/acl.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
@@ -86,6 +90,9 @@ static const struct FileFdwOption valid_options[] = {
 	{"force_not_null", AttributeRelationId},
 	{"force_null", AttributeRelationId},
 
+	/* Planner options */
+	{"parallel_scan", ForeignTableRelationId},
+
 	/*
 	 * force_quote is not supported by file_fdw because it's for COPY TO.
 	 */
@@ -117,8 +124,35 @@ typedef struct FileFdwExecutionState
 	List	   *options;		/* merged COPY options, excluding filename and
 								 * is_program */
 	CopyFromState cstate;		/* COPY execution state */
+
+	/* for a parallel scan, where cstate reads one range of the file */
+	bool		parallel;		/* is this a parallel scan? */
+	struct FileFdwParallelScanState *pscan; /* shared state, or NULL */
+	bool		ranges_done;	/* claimed the only range, if pscan is NULL */
+	uint64		num_errors;		/* rows skipped in earlier ranges */
 } FileFdwExecutionState;
 
+/*
+ * Shared state of a parallel scan, in the DSM segment.  The file is divided
+ * into ranges of range_size bytes, which the participants claim one at a
+ * time; the last range extends to the end of the file, however large it has
+ * grown meanwhile.
+ */
+typedef struct FileFdwParallelScanState
+{
+	uint64		range_size;		/* size of each range, in bytes */
+	uint32		nranges;		/* number of ranges */
+	pg_atomic_uint32 next_range;	/* next range to claim */
+} FileFdwParallelScanState;
+
+/*
+ * Each participant should get a few ranges, so that one that is slowed down
+ * doesn't hold up the whole scan, but ranges shouldn't be so small that
+ * setting up the COPY state for each one becomes noticeable.
+ */
+#define PARALLEL_SCAN_MIN_RANGE_SIZE			(1024 * 1024)
+#define PARALLEL_SCAN_RANGES_PER_PARTICIPANT	4
+
 /*
  * SQL functions
  */
@@ -151,6 +185,17 @@ static bool fileAnalyzeForeignTable(Relation relation,
 									BlockNumber *totalpages);
 static bool fileIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
 										  RangeTblEntry *rte);
+static Size fileEstimateDSMForeignScan(ForeignScanState *node,
+									   ParallelContext *pcxt);
+static void fileInitializeDSMForeignScan(ForeignScanState *node,
+										 ParallelContext *pcxt,
+										 void *coordinate);
+static void fileReInitializeDSMForeignScan(ForeignScanState *node,
+										   ParallelContext *pcxt,
+										   void *coordinate);
+static void fileInitializeWorkerForeignScan(ForeignScanState *node,
+											shm_toc *toc,
+											void *coordinate);
 
 /*
  * Helper functions
@@ -169,6 +214,10 @@ static void estimate_size(PlannerInfo *root, RelOptInfo *baserel,
 static void estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
 						   FileFdwPlanState *fdw_private,
 						   Cost *startup_cost, Cost *total_cost);
+static bool parallel_scan_possible(Oid foreigntableid,
+								   FileFdwPlanState *fdw_private);
+static bool begin_next_range(ForeignScanState *node,
+							 FileFdwExecutionState *festate);
 static int	file_acquire_sample_rows(Relation onerel, int elevel,
 									 HeapTuple *rows, int targrows,
 									 double *totalrows, double *totaldeadrows);
@@ -193,6 +242,10 @@ file_fdw_handler(PG_FUNCTION_ARGS)
 	fdwroutine->EndForeignScan = fileEndForeignScan;
 	fdwroutine->AnalyzeForeignTable = fileAnalyzeForeignTable;
 	fdwroutine->IsForeignScanParallelSafe = fileIsForeignScanParallelSafe;
+	fdwroutine->EstimateDSMForeignScan = fileEstimateDSMForeignScan;
+	fdwroutine->InitializeDSMForeignScan = fileInitializeDSMForeignScan;
+	fdwroutine->ReInitializeDSMForeignScan = fileReInitializeDSMForeignScan;
+	fdwroutine->InitializeWorkerForeignScan = fileInitializeWorkerForeignScan;
 
 	PG_RETURN_POINTER(fdwroutine);
 }
@@ -331,6 +384,9 @@ file_fdw_validator(PG_FUNCTION_ARGS)
 			force_null = def;
 			(void) defGetBoolean(def);
 		}
+		/* parallel_scan is for the planner, not for COPY */
+		else if (strcmp(def->defname, "parallel_scan") == 0)
+			(void) defGetBoolean(def);
 		else
 			other_options = lappend(other_options, def);
 	}
@@ -403,6 +459,15 @@ fileGetOptions(Oid foreigntableid,
 	options = list_concat(options, table->options);
 	options = list_concat(options, get_file_fdw_attribute_options(foreigntableid));
 
+	/* parallel_scan is not a COPY option; see parallel_scan_possible() */
+	foreach(lc, options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "parallel_scan") == 0)
+			options = foreach_delete_current(options, lc);
+	}
+
 	/*
 	 * Separate out the filename or program option (we assume there is only
 	 * one).
@@ -594,6 +659,48 @@ fileGetForeignPaths(PlannerInfo *root,
 									 NIL,	/* no fdw_restrictinfo list */
 									 coptions));
 
+	/*
+	 * With the parallel_scan option, the participants of a parallel query
+	 * can also divide the file among themselves.  As in cost_seqscan(), only
+	 * the CPU cost is assumed to be divided among them, not the I/O.
+	 */
+	if (baserel->consider_parallel && baserel->lateral_relids == NULL &&
+		parallel_scan_possible(foreigntableid, fdw_private))
+	{
+		int			parallel_workers;
+
+		parallel_workers = compute_parallel_worker(baserel, fdw_private->pages,
+												   -1,
+												   max_parallel_workers_per_gather);
+		if (parallel_workers > 0)
+		{
+			ForeignPath *path;
+			double		parallel_divisor;
+			Cost		disk_cost = seq_page_cost * fdw_private->pages;
+
+			path = create_foreignscan_path(root, baserel,
+										   NULL,	/* default pathtarget */
+										   baserel->rows,
+										   0,
+										   startup_cost,
+										   total_cost,
+										   NIL, /* no pathkeys */
+										   NULL,	/* no outer rel */
+										   NULL,	/* no extra plan */
+										   NIL, /* no fdw_restrictinfo list */
+										   coptions);
+			path->path.parallel_aware = true;
+			path->path.parallel_workers = parallel_workers;
+
+			parallel_divisor = get_parallel_divisor(&path->path);
+			path->path.rows = clamp_row_est(baserel->rows / parallel_divisor);
+			path->path.total_cost = startup_cost + disk_cost +
+				(total_cost - startup_cost - disk_cost) / parallel_divisor;
+
+			add_partial_path(baserel, (Path *) path);
+		}
+	}
+
 	/*
 	 * If data file was sorted, and we knew it somehow, we could insert
 	 * appropriate pathkeys into the ForeignPath node to tell the planner
@@ -698,15 +805,21 @@ fileBeginForeignScan(ForeignScanState *node, int eflags)
 	/*
 	 * Create CopyState from FDW options.  We always acquire all columns, so
 	 * as to match the expected ScanTupleSlot signature.
+	 *
+	 * In a parallel scan, we don't know yet which part of the file we'll
+	 * read; begin_next_range() creates a CopyState for each range.
 	 */
-	cstate = BeginCopyFrom(NULL,
-						   node->ss.ss_currentRelation,
-						   NULL,
-						   filename,
-						   is_program,
-						   NULL,
-						   NIL,
-						   options);
+	if (plan->scan.plan.parallel_aware)
+		cstate = NULL;
+	else
+		cstate = BeginCopyFrom(NULL,
+							   node->ss.ss_currentRelation,
+							   NULL,
+							   filename,
+							   is_program,
+							   NULL,
+							   NIL,
+							   options);
 
 	/*
 	 * Save state in node->fdw_state.  We must save enough information to call
@@ -717,6 +830,10 @@ fileBeginForeignScan(ForeignScanState *node, int eflags)
 	festate->is_program = is_program;
 	festate->options = options;
 	festate->cstate = cstate;
+	festate->parallel = plan->scan.plan.parallel_aware;
+	festate->pscan = NULL;
+	festate->ranges_done = false;
+	festate->num_errors = 0;
 
 	node->fdw_state = festate;
 }
@@ -734,9 +851,14 @@ fileIterateForeignScan(ForeignScanState *node)
 	ExprContext *econtext;
 	MemoryContext oldcontext = CurrentMemoryContext;
 	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
-	CopyFromState cstate = festate->cstate;
+	CopyFromState cstate;
 	ErrorContextCallback errcallback;
 
+	/* In a parallel scan, claim our first range of the file */
+	if (festate->cstate == NULL && !begin_next_range(node, festate))
+		return ExecClearTuple(slot);
+	cstate = festate->cstate;
+
 	/* Set up callback to identify error line number. */
 	errcallback.callback = CopyFromErrorCallback;
 	errcallback.arg = cstate;
@@ -807,6 +929,20 @@ retry:
 
 		ExecStoreVirtualTuple(slot);
 	}
+	else if (festate->parallel)
+	{
+		/* Go on with the next range of the file, if there's one left */
+		MemoryContextSwitchTo(oldcontext);
+		error_context_stack = errcallback.previous;
+		if (begin_next_range(node, festate))
+		{
+			cstate = festate->cstate;
+			errcallback.arg = cstate;
+			error_context_stack = &errcallback;
+			ResetPerTupleExprContext(estate);
+			goto retry;
+		}
+	}
 
 	/* Switch back to original memory context */
 	MemoryContextSwitchTo(oldcontext);
@@ -826,6 +962,19 @@ fileReScanForeignScan(ForeignScanState *node)
 {
 	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
 
+	if (festate->parallel)
+	{
+		/* Start again from the first range we can claim */
+		if (festate->cstate != NULL)
+		{
+			EndCopyFrom(festate->cstate);
+			festate->cstate = NULL;
+		}
+		festate->ranges_done = false;
+		festate->num_errors = 0;
+		return;
+	}
+
 	EndCopyFrom(festate->cstate);
 
 	festate->cstate = BeginCopyFrom(NULL,
@@ -851,14 +1000,19 @@ fileEndForeignScan(ForeignScanState *node)
 	if (!festate)
 		return;
 
+	/* a participant of a parallel scan might not have read anything */
+	if (!festate->cstate)
+		return;
+
+	festate->num_errors += festate->cstate->num_errors;
 	if (festate->cstate->opts.on_error == COPY_ON_ERROR_IGNORE &&
-		festate->cstate->num_errors > 0 &&
+		festate->num_errors > 0 &&
 		festate->cstate->opts.log_verbosity >= COPY_LOG_VERBOSITY_DEFAULT)
 		ereport(NOTICE,
 				errmsg_plural("%" PRIu64 " row was skipped due to data type incompatibility",
 							  "%" PRIu64 " rows were skipped due to data type incompatibility",
-							  festate->cstate->num_errors,
-							  festate->cstate->num_errors));
+							  festate->num_errors,
+							  festate->num_errors));
 
 	EndCopyFrom(festate->cstate);
 }
@@ -925,6 +1079,131 @@ fileIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
 	return true;
 }
 
+/*
+ * fileEstimateDSMForeignScan
+ *		Report the size of the shared state of a parallel scan
+ */
+static Size
+fileEstimateDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt)
+{
+	return sizeof(FileFdwParallelScanState);
+}
+
+/*
+ * fileInitializeDSMForeignScan
+ *		Divide the file into ranges for the participants to claim
+ */
+static void
+fileInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+							 void *coordinate)
+{
+	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
+	FileFdwParallelScanState *pscan = (FileFdwParallelScanState *) coordinate;
+	struct stat stat_buf;
+	uint64		file_size = 0;
+	uint64		range_size;
+
+	/* If we can't stat the file, BeginCopyFrom() will complain soon enough */
+	if (stat(festate->filename, &stat_buf) == 0)
+		file_size = stat_buf.st_size;
+
+	range_size = file_size /
+		((pcxt->nworkers + 1) * PARALLEL_SCAN_RANGES_PER_PARTICIPANT);
+	range_size = Max(range_size, PARALLEL_SCAN_MIN_RANGE_SIZE);
+
+	pscan->range_size = range_size;
+	pscan->nranges = Max((file_size + range_size - 1) / range_size, 1);
+	pg_atomic_init_u32(&pscan->next_range, 0);
+
+	festate->pscan = pscan;
+}
+
+/*
+ * fileReInitializeDSMForeignScan
+ *		Reset the shared state of a parallel scan for a rescan
+ */
+static void
+fileReInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+							   void *coordinate)
+{
+	FileFdwParallelScanState *pscan = (FileFdwParallelScanState *) coordinate;
+
+	pg_atomic_write_u32(&pscan->next_range, 0);
+}
+
+/*
+ * fileInitializeWorkerForeignScan
+ *		Attach a parallel worker to the shared state of a parallel scan
+ */
+static void
+fileInitializeWorkerForeignScan(ForeignScanState *node, shm_toc *toc,
+								void *coordinate)
+{
+	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
+
+	festate->pscan = (FileFdwParallelScanState *) coordinate;
+}
+
+/*
+ * begin_next_range
+ *		Claim the next range of the file in a parallel scan, and create a
+ *		CopyState to read it
+ *
+ * Returns false if there are no ranges left.  Without shared state, which
+ * happens if the query isn't run in parallel after all, the one and only
+ * range is the whole file.
+ */
+static bool
+begin_next_range(ForeignScanState *node, FileFdwExecutionState *festate)
+{
+	FileFdwParallelScanState *pscan = festate->pscan;
+	pgoff_t		start;
+	pgoff_t		end;
+	CopyFromState cstate;
+
+	if (pscan == NULL)
+	{
+		if (festate->ranges_done)
+			return false;
+		festate->ranges_done = true;
+		start = 0;
+		end = -1;
+	}
+	else
+	{
+		uint32		range = pg_atomic_fetch_add_u32(&pscan->next_range, 1);
+
+		if (range >= pscan->nranges)
+			return false;
+		start = (pgoff_t) (range * pscan->range_size);
+		end = (range == pscan->nranges - 1) ? -1 :
+			(pgoff_t) (start + pscan->range_size);
+	}
+
+	cstate = BeginCopyFrom(NULL,
+						   node->ss.ss_currentRelation,
+						   NULL,
+						   festate->filename,
+						   false,
+						   NULL,
+						   NIL,
+						   festate->options);
+	CopyFromSetRange(cstate, start, end);
+
+	/*
+	 * Keep the CopyState of the last range until the end of the scan, for
+	 * fileEndForeignScan() to report the skipped rows.
+	 */
+	if (festate->cstate != NULL)
+	{
+		festate->num_errors += festate->cstate->num_errors;
+		EndCopyFrom(festate->cstate);
+	}
+	festate->cstate = cstate;
+
+	return true;
+}
+
 /*
  * check_selective_binary_conversion
  *
@@ -1167,6 +1446,51 @@ estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
 	*total_cost = *startup_cost + run_cost;
 }
 
+/*
+ * Can a scan of the foreign table be divided among parallel workers?
+ *
+ * The participants each read different ranges of the file, finding the
+ * first line of their range by looking for a newline.  Only the user can
+ * tell us that no field in the file contains a newline, so this must be
+ * enabled with the parallel_scan option.  It can't work for a program's
+ * output or the binary format, and reject_limit couldn't be enforced across
+ * the participants.
+ */
+static bool
+parallel_scan_possible(Oid foreigntableid, FileFdwPlanState *fdw_private)
+{
+	ForeignTable *table;
+	bool		parallel_scan = false;
+	ListCell   *lc;
+
+	if (fdw_private->is_program)
+		return false;
+
+	table = GetForeignTable(foreigntableid);
+	foreach(lc, table->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "parallel_scan") == 0)
+			parallel_scan = defGetBoolean(def);
+	}
+	if (!parallel_scan)
+		return false;
+
+	foreach(lc, fdw_private->options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "format") == 0 &&
+			strcmp(defGetString(def), "binary") == 0)
+			return false;
+		if (strcmp(def->defname, "reject_limit") == 0)
+			return false;
+	}
+
+	return true;
+}
+
 /*
  * file_acquire_sample_rows -- acquire a random sample of rows from the table
  *
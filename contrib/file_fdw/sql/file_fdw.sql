@@ -4,6 +4,7 @@
 
 -- directory paths are passed to us in environment variables
 \getenv abs_srcdir PG_ABS_SRCDIR
+\getenv abs_builddir PG_ABS_BUILDDIR
 
 -- Clean up in case a prior regression run failed
 SET client_min_messages TO 'warning';
@@ -262,6 +263,29 @@ OPTIONS (format 'csv', filename :'filename', default '\D');
 SELECT id, text_value, ts_value FROM copy_default;
 DROP FOREIGN TABLE copy_default;
 
+-- parallel scan tests
+\set filename :abs_builddir '/results/parallel.csv'
+COPY (SELECT i, 'row ' || i FROM generate_series(1, 200000) i)
+  TO :'filename' WITH (FORMAT csv, HEADER);
+CREATE FOREIGN TABLE par_csv (a int, b text) SERVER file_server
+OPTIONS (format 'csv', header 'true', filename :'filename', parallel_scan 'true');
+ALTER FOREIGN TABLE par_csv OPTIONS (SET parallel_scan 'maybe');   -- ERROR
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+\t on
+SELECT explain_filter('EXPLAIN (COSTS FALSE) SELECT count(*), sum(a) FROM par_csv');
+\t off
+-- every line must be read exactly once, and none cut in two
+SELECT count(*), sum(a), min(a), max(a), count(*) FILTER (WHERE b = 'row ' || a)
+  FROM par_csv;
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
+DROP FOREIGN TABLE par_csv;
+
 -- privilege tests
 SET ROLE regress_file_fdw_superuser;
 SELECT * FROM agg_text ORDER BY a;
@@ -0,0 +1,56 @@
+/* contrib/lsm/lsm--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION lsm" to load this file. \quit
+
+CREATE FUNCTION lsmhandler(internal)
+RETURNS index_am_handler
+AS 'MODULE_PATHNAME'
+LANGUAGE C;
+
+-- Access method
+CREATE ACCESS METHOD lsm TYPE INDEX HANDLER lsmhandler;
+COMMENT ON ACCESS METHOD lsm IS 'lsm index access method';
+
+CREATE FUNCTION lsm_compact(regclass)
+RETURNS void
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT;
+
+-- Opclasses
+
+CREATE OPERATOR CLASS int4_ops
+DEFAULT FOR TYPE int4 USING lsm AS
+	OPERATOR	1	<(int4, int4),
+	OPERATOR	2	<=(int4, int4),
+	OPERATOR	3	=(int4, int4),
+	OPERATOR	4	>=(int4, int4),
+	OPERATOR	5	>(int4, int4),
+	FUNCTION	1	btint4cmp(int4, int4);
+
+CREATE OPERATOR CLASS int8_ops
+DEFAULT FOR TYPE int8 USING lsm AS
+	OPERATOR	1	<(int8, int8),
+	OPERATOR	2	<=(int8, int8),
+	OPERATOR	3	=(int8, int8),
+	OPERATOR	4	>=(int8, int8),
+	OPERATOR	5	>(int8, int8),
+	FUNCTION	1	btint8cmp(int8, int8);
+
+CREATE OPERATOR CLASS text_ops
+DEFAULT FOR TYPE text USING lsm AS
+	OPERATOR	1	<(text, text),
+	OPERATOR	2	<=(text, text),
+	OPERATOR	3	=(text, text),
+	OPERATOR	4	>=(text, text),
+	OPERATOR	5	>(text, text),
+	FUNCTION	1	bttextcmp(text, text);
+
+CREATE OPERATOR CLASS uuid_ops
+DEFAULT FOR TYPE uuid USING lsm AS
+	OPERATOR	1	<(uuid, uuid),
+	OPERATOR	2	<=(uuid, uuid),
+	OPERATOR	3	=(uuid, uuid),
+	OPERATOR	4	>=(uuid, uuid),
+	OPERATOR	5	>(uuid, uuid),
+	FUNCTION	1	uuid_cmp(uuid, uuid);
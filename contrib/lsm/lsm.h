@@ -0,0 +1,233 @@
+/*-------------------------------------------------------------------------
+ *
+ * lsm.h
+ *	  Header for LSM index.
+ *
+ * Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/lsm/lsm.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef _LSM_H_
+#define _LSM_H_
+
+#include "access/amapi.h"
+#include "access/generic_xlog.h"
+#include "access/itup.h"
+#include "access/transam.h"
+#include "fmgr.h"
+#include "nodes/pathnodes.h"
+#include "storage/bufpage.h"
+
+/* Support procedure numbers */
+#define LSM_CMP_PROC			1
+#define LSM_NPROC				1
+
+/* Scan strategies, numbered as for btree */
+#define LSM_LESS_STRATEGY			1
+#define LSM_LESS_EQUAL_STRATEGY		2
+#define LSM_EQUAL_STRATEGY			3
+#define LSM_GREATER_EQUAL_STRATEGY	4
+#define LSM_GREATER_STRATEGY		5
+#define LSM_NSTRATEGIES				5
+
+/*
+ * Opaque data of LSM index pages.
+ *
+ * Delta pages form a singly-linked list in insertion order; owner is the
+ * sequence number of the page within the delta.  Run pages form a static
+ * tree, each level of which is linked left-to-right; owner is the ID of the
+ * run, and level is 0 for leaf pages.
+ *
+ * A page that is no longer needed is marked retired, but keeps its contents
+ * until no scan can be looking at it anymore, as determined by safexid.
+ */
+typedef struct LsmPageOpaqueData
+{
+	BlockNumber rightlink;		/* next page on the same level, or in delta */
+	uint32		owner;			/* delta sequence number or run ID */
+	FullTransactionId safexid;	/* when a retired page can be recycled */
+	uint16		level;			/* tree level of a run page */
+	uint16		flags;			/* see bit definitions below */
+	uint16		unused;			/* placeholder to force maxaligning of size of
+								 * LsmPageOpaqueData and to place lsm_page_id
+								 * exactly at the end of page */
+	uint16		lsm_page_id;	/* for identification of LSM indexes */
+} LsmPageOpaqueData;
+
+typedef LsmPageOpaqueData *LsmPageOpaque;
+
+/* LSM page flags */
+#define LSM_META		(1 << 0)
+#define LSM_DELTA		(1 << 1)
+#define LSM_RUN			(1 << 2)
+#define LSM_RETIRED		(1 << 3)
+
+/*
+ * The page ID is for the convenience of pg_filedump and similar utilities,
+ * which otherwise would have a hard time telling pages of different index
+ * types apart.  It should be the last 2 bytes on the page.
+ *
+ * See comments above GinPageOpaqueData.
+ */
+#define LSM_PAGE_ID		0xFF84
+
+#define LsmPageGetOpaque(page) ((LsmPageOpaque) PageGetSpecialPointer(page))
+#define LsmPageIsMeta(page) \
+	((LsmPageGetOpaque(page)->flags & LSM_META) != 0)
+#define LsmPageIsDelta(page) \
+	((LsmPageGetOpaque(page)->flags & LSM_DELTA) != 0)
+#define LsmPageIsRun(page) \
+	((LsmPageGetOpaque(page)->flags & LSM_RUN) != 0)
+#define LsmPageIsRetired(page) \
+	((LsmPageGetOpaque(page)->flags & LSM_RETIRED) != 0)
+
+/* Preserved page numbers */
+#define LSM_METAPAGE_BLKNO		(0)
+
+/*
+ * Maximum size of an index tuple.  Internal pages of a run must be able to
+ * hold at least two downlinks, which are copies of the leaf tuples.
+ */
+#define LsmMaxItemSize \
+	MAXALIGN_DOWN((BLCKSZ - \
+				   MAXALIGN(SizeOfPageHeaderData + 3 * sizeof(ItemIdData)) - \
+				   MAXALIGN(sizeof(LsmPageOpaqueData))) / 3)
+
+/* Maximum number of sorted runs, and height of a run */
+#define LSM_MAX_RUNS			32
+#define LSM_MAX_LEVELS			16
+
+/* Description of a sorted run, in the metapage */
+typedef struct LsmRunData
+{
+	uint32		id;				/* run ID, stored in all of its pages */
+	uint16		level;			/* level of the root page */
+	uint16		tier;			/* number of merges the run is a product of */
+	BlockNumber root;			/* root page */
+	BlockNumber firstleaf;		/* leftmost leaf page */
+	BlockNumber npages;			/* total number of pages */
+	uint64		ntuples;		/* number of tuples when the run was made */
+} LsmRunData;
+
+/* Metadata of LSM index */
+typedef struct LsmMetaPageData
+{
+	uint32		magicNumber;
+	uint32		nextRunId;		/* ID to assign to the next run */
+	BlockNumber deltaHead;		/* first page of the delta */
+	BlockNumber deltaTail;		/* last page of the delta */
+	uint32		deltaHeadSeq;	/* sequence number of deltaHead */
+	uint32		deltaNextSeq;	/* sequence number for the next delta page */
+	uint32		nRuns;			/* number of valid entries in runs[] */
+	LsmRunData	runs[LSM_MAX_RUNS]; /* sorted runs, newest first */
+} LsmMetaPageData;
+
+/* Magic number to distinguish LSM pages from others */
+#define LSM_MAGIC_NUMBER (0x4C534D31)
+
+#define LsmPageGetMeta(page)	((LsmMetaPageData *) PageGetContents(page))
+
+/* LSM index options */
+typedef struct LsmOptions
+{
+	int32		vl_len_;		/* varlena header (do not touch directly!) */
+	int			deltaSize;		/* delta flush threshold, in kilobytes */
+	int			mergeFanout;	/* number of runs merged at a time */
+} LsmOptions;
+
+#define LSM_DEFAULT_DELTA_SIZE		4096
+#define LSM_MIN_DELTA_SIZE			64
+#define LSM_DEFAULT_MERGE_FANOUT	4
+#define LSM_MAX_MERGE_FANOUT		16
+
+#define LsmGetDeltaSize(relation) \
+	((relation)->rd_options ? \
+	 ((LsmOptions *) (relation)->rd_options)->deltaSize : \
+	 LSM_DEFAULT_DELTA_SIZE)
+#define LsmGetMergeFanout(relation) \
+	((relation)->rd_options ? \
+	 ((LsmOptions *) (relation)->rd_options)->mergeFanout : \
+	 LSM_DEFAULT_MERGE_FANOUT)
+
+/* Comparison support for the index columns */
+typedef struct LsmState
+{
+	Relation	index;
+	TupleDesc	tupdesc;
+	int			nColumns;
+	FmgrInfo	cmpFn[INDEX_MAX_KEYS];
+	Oid			collations[INDEX_MAX_KEYS];
+} LsmState;
+
+/* Builds a sorted run page by page; see lsmsort.c */
+typedef struct LsmRunWriter LsmRunWriter;
+
+/* Opaque data structure for LSM index scan */
+typedef struct LsmScanOpaqueData
+{
+	LsmState	state;
+	ScanKey		lowerKey;		/* lower bound on the first column, if any */
+	ScanKey		upperKey;		/* upper bound on the first column, if any */
+	bool		firstColKeys;	/* are there any keys on the first column? */
+	bool		keysOk;			/* false if the keys can't be satisfied */
+} LsmScanOpaqueData;
+
+typedef LsmScanOpaqueData *LsmScanOpaque;
+
+/* lsmutils.c */
+extern void initLsmState(LsmState *state, Relation index);
+extern int	lsmCompareTuples(LsmState *state, IndexTuple a, IndexTuple b);
+extern void LsmInitPage(Page page, uint16 flags);
+extern void LsmInitMetapage(Relation index, ForkNumber forknum);
+extern Buffer LsmNewBuffer(Relation index);
+extern bool LsmPageIsRecyclable(Page page);
+extern void LsmPageRetire(Page page);
+extern IndexTuple LsmFormTuple(Relation index, ItemPointer iptr,
+							   Datum *values, bool *isnull);
+
+/* lsmsort.c */
+extern LsmRunWriter *lsmBeginRun(Relation index, uint32 id);
+extern void lsmRunAdd(LsmRunWriter *writer, IndexTuple itup);
+extern bool lsmEndRun(LsmRunWriter *writer, LsmRunData *run);
+extern void lsmSortTuples(LsmState *state, IndexTuple *tuples, int ntuples);
+extern void lsmMergeToRun(LsmState *state, LsmRunData *inputs, int ninputs,
+						  LsmRunWriter *writer);
+extern void lsmRetireRun(Relation index, LsmRunData *run);
+
+/* lsminsert.c */
+extern void lsmFlushDelta(Relation index, bool wait);
+extern bool lsmMergeRuns(Relation index, bool force);
+
+/* lsmvalidate.c */
+extern bool lsmvalidate(Oid opclassoid);
+
+/* index access method interface functions */
+extern bool lsminsert(Relation index, Datum *values, bool *isnull,
+					  ItemPointer ht_ctid, Relation heapRel,
+					  IndexUniqueCheck checkUnique,
+					  bool indexUnchanged,
+					  struct IndexInfo *indexInfo);
+extern IndexScanDesc lsmbeginscan(Relation r, int nkeys, int norderbys);
+extern int64 lsmgetbitmap(IndexScanDesc scan, TIDBitmap *tbm);
+extern void lsmrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
+					  ScanKey orderbys, int norderbys);
+extern void lsmendscan(IndexScanDesc scan);
+extern IndexBuildResult *lsmbuild(Relation heap, Relation index,
+								  struct IndexInfo *indexInfo);
+extern void lsmbuildempty(Relation index);
+extern IndexBulkDeleteResult *lsmbulkdelete(IndexVacuumInfo *info,
+											IndexBulkDeleteResult *stats,
+											IndexBulkDeleteCallback callback,
+											void *callback_state);
+extern IndexBulkDeleteResult *lsmvacuumcleanup(IndexVacuumInfo *info,
+											   IndexBulkDeleteResult *stats);
+extern bytea *lsmoptions(Datum reloptions, bool validate);
+extern void lsmcostestimate(PlannerInfo *root, IndexPath *path,
+							double loop_count, Cost *indexStartupCost,
+							Cost *indexTotalCost, Selectivity *indexSelectivity,
+							double *indexCorrelation, double *indexPages);
+
+#endif
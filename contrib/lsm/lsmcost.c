@@ -0,0 +1,90 @@
+/*-------------------------------------------------------------------------
+ *
+ * lsmcost.c
+ *		Cost estimate function for LSM indexes.
+ *
+ * Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/lsm/lsmcost.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/genam.h"
+#include "lsm.h"
+#include "optimizer/optimizer.h"
+#include "storage/bufmgr.h"
+#include "utils/selfuncs.h"
+
+/* CPU cost of processing a page during descent, as in selfuncs.c */
+#define LSM_PAGE_CPU_MULTIPLIER 50.0
+
+/*
+ * Estimate cost of LSM index scan.
+ *
+ * On top of the generic estimate for the fraction of the index that the
+ * scan selects, a scan has to descend each sorted run, and read the whole
+ * delta.
+ */
+void
+lsmcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
+				Cost *indexStartupCost, Cost *indexTotalCost,
+				Selectivity *indexSelectivity, double *indexCorrelation,
+				double *indexPages)
+{
+	IndexOptInfo *index = path->indexinfo;
+	GenericCosts costs = {0};
+	double		deltaPages = 0;
+	double		deltaTuples;
+	Cost		descentCost = 0;
+
+	/* Use generic estimate */
+	genericcostestimate(root, path, loop_count, &costs);
+
+	if (!index->hypothetical)
+	{
+		Relation	indexRel;
+		Buffer		metaBuffer;
+		LsmMetaPageData *metadata;
+		int			i;
+
+		/* Lock should have already been obtained in plancat.c */
+		indexRel = index_open(index->indexoid, NoLock);
+		metaBuffer = ReadBuffer(indexRel, LSM_METAPAGE_BLKNO);
+		LockBuffer(metaBuffer, BUFFER_LOCK_SHARE);
+		metadata = LsmPageGetMeta(BufferGetPage(metaBuffer));
+
+		deltaPages = metadata->deltaNextSeq - metadata->deltaHeadSeq;
+		for (i = 0; i < metadata->nRuns; i++)
+		{
+			/* Comparisons to find the starting leaf, as in btcostestimate */
+			if (metadata->runs[i].ntuples > 1)
+				descentCost += ceil(log(metadata->runs[i].ntuples) / log(2.0)) *
+					cpu_operator_cost;
+			descentCost += (metadata->runs[i].level + 1) *
+				LSM_PAGE_CPU_MULTIPLIER * cpu_operator_cost;
+		}
+
+		UnlockReleaseBuffer(metaBuffer);
+		index_close(indexRel, NoLock);
+	}
+
+	/*
+	 * Every tuple in the delta is checked against the quals.  Assume delta
+	 * pages are as densely packed as the rest of the index.
+	 */
+	deltaTuples = (index->pages > 0) ?
+		deltaPages * index->tuples / index->pages : 0;
+
+	*indexStartupCost = costs.indexStartupCost + descentCost;
+	*indexTotalCost = costs.indexTotalCost + descentCost +
+		deltaPages * seq_page_cost +
+		deltaTuples * list_length(path->indexclauses) * cpu_operator_cost;
+	*indexSelectivity = costs.indexSelectivity;
+	*indexCorrelation = costs.indexCorrelation;
+	*indexPages = costs.numIndexPages + deltaPages;
+}
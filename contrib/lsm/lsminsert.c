@@ -0,0 +1,745 @@
+/*-------------------------------------------------------------------------
+ *
+ * lsminsert.c
+ *		LSM index build and insert functions, and maintenance of the delta
+ *		and the sorted runs.
+ *
+ * New index tuples are appended, unsorted, to the delta: a list of pages
+ * that is cheap to insert into, because every insertion goes to its last
+ * page.  Once the delta has grown past delta_size, it is flushed: its
+ * tuples are sorted and written out as a new sorted run, and the consumed
+ * pages are retired.  Sorted runs are merged together when merge_fanout of
+ * them have accumulated in the same tier, so that the number of runs a scan
+ * has to search stays logarithmic in the size of the index.
+ *
+ * Flushing and merging are serialized by a heavyweight lock on the
+ * metapage, which VACUUM also takes, so that tuples it removes can't be
+ * resurrected from a copy made by a concurrent flush or merge.
+ *
+ * Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/lsm/lsminsert.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/generic_xlog.h"
+#include "access/tableam.h"
+#include "lsm.h"
+#include "miscadmin.h"
+#include "nodes/execnodes.h"
+#include "postmaster/autovacuum.h"
+#include "storage/bufmgr.h"
+#include "storage/indexfsm.h"
+#include "storage/lmgr.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+
+PG_MODULE_MAGIC_EXT(
+					.name = "lsm",
+					.version = PG_VERSION
+);
+
+/*
+ * State of LSM index build.  Tuples are accumulated in memory, and written
+ * out as an intermediate sorted run whenever maintenance_work_mem is full.
+ */
+typedef struct
+{
+	LsmState	state;
+	int64		indtuples;		/* total number of tuples indexed */
+	MemoryContext tmpCtx;		/* holds the accumulated tuples */
+	IndexTuple *tuples;			/* accumulated tuples */
+	int			ntuples;
+	int			maxtuples;		/* allocated size of tuples[] */
+	Size		memUsed;		/* memory used by accumulated tuples */
+	LsmRunData *runs;			/* intermediate runs written so far */
+	int			nruns;
+	int			maxruns;		/* allocated size of runs[] */
+	uint32		nextRunId;
+} LsmBuildState;
+
+/*
+ * Update the metapage after writing a sorted run: add the new run, if any,
+ * and remove the runs it was merged from.  If deltaHead is valid, also
+ * advance the head of the delta past the nconsumed pages that were written
+ * to the run.
+ */
+static void
+lsmRegisterRun(Relation index, LsmRunData *run,
+			   LsmRunData *inputs, int ninputs,
+			   BlockNumber deltaHead, uint32 nconsumed)
+{
+	Buffer		metaBuffer;
+	LsmMetaPageData *metadata;
+	GenericXLogState *state;
+	int			i,
+				j;
+
+	metaBuffer = ReadBuffer(index, LSM_METAPAGE_BLKNO);
+	LockBuffer(metaBuffer, BUFFER_LOCK_EXCLUSIVE);
+	state = GenericXLogStart(index);
+	metadata = LsmPageGetMeta(GenericXLogRegisterBuffer(state, metaBuffer, 0));
+
+	/* Remove the inputs */
+	for (i = 0; i < ninputs; i++)
+	{
+		for (j = 0; j < metadata->nRuns; j++)
+		{
+			if (metadata->runs[j].id == inputs[i].id)
+			{
+				memmove(&metadata->runs[j], &metadata->runs[j + 1],
+						sizeof(LsmRunData) * (metadata->nRuns - j - 1));
+				metadata->nRuns--;
+				break;
+			}
+		}
+	}
+
+	/* Add the new run at the front, as the newest */
+	if (run)
+	{
+		if (metadata->nRuns >= LSM_MAX_RUNS)
+			elog(ERROR, "too many sorted runs in index \"%s\"",
+				 RelationGetRelationName(index));
+		memmove(&metadata->runs[1], &metadata->runs[0],
+				sizeof(LsmRunData) * metadata->nRuns);
+		metadata->runs[0] = *run;
+		metadata->nRuns++;
+		metadata->nextRunId = Max(metadata->nextRunId, run->id + 1);
+	}
+
+	if (deltaHead != InvalidBlockNumber)
+	{
+		metadata->deltaHead = deltaHead;
+		metadata->deltaHeadSeq += nconsumed;
+	}
+
+	GenericXLogFinish(state);
+	UnlockReleaseBuffer(metaBuffer);
+}
+
+/*
+ * Assign an ID to a new sorted run.
+ *
+ * The ID is reserved in the metapage before any page of the run is written,
+ * so that if we crash before the run is registered, VACUUM can tell that its
+ * pages belong to no live run.
+ */
+static uint32
+lsmReserveRunId(Relation index)
+{
+	Buffer		metaBuffer;
+	LsmMetaPageData *metadata;
+	GenericXLogState *state;
+	uint32		id;
+
+	metaBuffer = ReadBuffer(index, LSM_METAPAGE_BLKNO);
+	LockBuffer(metaBuffer, BUFFER_LOCK_EXCLUSIVE);
+	state = GenericXLogStart(index);
+	metadata = LsmPageGetMeta(GenericXLogRegisterBuffer(state, metaBuffer, 0));
+	id = metadata->nextRunId++;
+	GenericXLogFinish(state);
+	UnlockReleaseBuffer(metaBuffer);
+
+	return id;
+}
+
+/*
+ * Read the metapage fields needed to start a flush or merge.
+ */
+static LsmMetaPageData *
+lsmCopyMeta(Relation index)
+{
+	Buffer		metaBuffer;
+	LsmMetaPageData *metadata = palloc_object(LsmMetaPageData);
+
+	metaBuffer = ReadBuffer(index, LSM_METAPAGE_BLKNO);
+	LockBuffer(metaBuffer, BUFFER_LOCK_SHARE);
+	memcpy(metadata, LsmPageGetMeta(BufferGetPage(metaBuffer)),
+		   sizeof(LsmMetaPageData));
+	UnlockReleaseBuffer(metaBuffer);
+
+	return metadata;
+}
+
+/*
+ * Append a new, empty page to the delta.  Caller must hold exclusive locks
+ * on the metapage and the current tail page, and is responsible for
+ * finishing the WAL record.
+ */
+static Page
+lsmAppendDeltaPage(GenericXLogState *state, Buffer metaBuffer,
+				   Buffer tailBuffer, Buffer newBuffer)
+{
+	LsmMetaPageData *metadata;
+	Page		tailPage,
+				newPage;
+
+	metadata = LsmPageGetMeta(GenericXLogRegisterBuffer(state, metaBuffer, 0));
+	tailPage = GenericXLogRegisterBuffer(state, tailBuffer, 0);
+	newPage = GenericXLogRegisterBuffer(state, newBuffer,
+										GENERIC_XLOG_FULL_IMAGE);
+
+	LsmInitPage(newPage, LSM_DELTA);
+	LsmPageGetOpaque(newPage)->owner = metadata->deltaNextSeq++;
+	LsmPageGetOpaque(tailPage)->rightlink = BufferGetBlockNumber(newBuffer);
+	metadata->deltaTail = BufferGetBlockNumber(newBuffer);
+
+	return newPage;
+}
+
+/*
+ * Retire the first npages pages of the delta, starting at blkno.
+ */
+static void
+lsmRetireDelta(Relation index, BlockNumber blkno, uint32 npages)
+{
+	while (npages-- > 0)
+	{
+		Buffer		buffer;
+		Page		page;
+		GenericXLogState *state;
+
+		buffer = ReadBuffer(index, blkno);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		state = GenericXLogStart(index);
+		page = GenericXLogRegisterBuffer(state, buffer, 0);
+		blkno = LsmPageGetOpaque(page)->rightlink;
+		LsmPageRetire(page);
+		GenericXLogFinish(state);
+		UnlockReleaseBuffer(buffer);
+	}
+}
+
+/*
+ * Write the contents of the delta out as sorted runs.
+ *
+ * Only the pages that are in the delta when we start are consumed; a new
+ * tail page is appended first, so that concurrent inserters don't have to
+ * wait for us, and we can't be kept busy forever by them.
+ *
+ * If wait is false, we give up immediately if someone else is already
+ * flushing or merging.  That's the case when called by an inserter that
+ * found the delta to be full: the other process will get to it.
+ */
+void
+lsmFlushDelta(Relation index, bool wait)
+{
+	LsmState	lsmstate;
+	Buffer		metaBuffer,
+				tailBuffer;
+	Page		tailPage;
+	LsmMetaPageData *metadata;
+	GenericXLogState *state;
+	BlockNumber blkno,
+				stop;
+	MemoryContext tmpCtx,
+				oldCtx;
+	IndexTuple *tuples;
+	int			maxtuples;
+	int			workMemory;
+
+	if (wait)
+	{
+		LockPage(index, LSM_METAPAGE_BLKNO, ExclusiveLock);
+		workMemory =
+			(AmAutoVacuumWorkerProcess() && autovacuum_work_mem != -1) ?
+			autovacuum_work_mem : maintenance_work_mem;
+	}
+	else
+	{
+		if (!ConditionalLockPage(index, LSM_METAPAGE_BLKNO, ExclusiveLock))
+			return;
+		workMemory = work_mem;
+	}
+
+	/* Close off the delta by appending a new empty tail page to it */
+	metaBuffer = ReadBuffer(index, LSM_METAPAGE_BLKNO);
+	LockBuffer(metaBuffer, BUFFER_LOCK_EXCLUSIVE);
+	metadata = LsmPageGetMeta(BufferGetPage(metaBuffer));
+
+	blkno = metadata->deltaHead;
+	tailBuffer = ReadBuffer(index, metadata->deltaTail);
+	LockBuffer(tailBuffer, BUFFER_LOCK_EXCLUSIVE);
+	tailPage = BufferGetPage(tailBuffer);
+
+	if (PageGetMaxOffsetNumber(tailPage) == InvalidOffsetNumber)
+	{
+		/* Tail is empty, so it can stay where it is */
+		stop = BufferGetBlockNumber(tailBuffer);
+	}
+	else
+	{
+		Buffer		newBuffer = LsmNewBuffer(index);
+
+		state = GenericXLogStart(index);
+		lsmAppendDeltaPage(state, metaBuffer, tailBuffer, newBuffer);
+		GenericXLogFinish(state);
+		stop = BufferGetBlockNumber(newBuffer);
+		UnlockReleaseBuffer(newBuffer);
+	}
+	UnlockReleaseBuffer(tailBuffer);
+	UnlockReleaseBuffer(metaBuffer);
+
+	if (blkno == stop)
+	{
+		/* Nothing to do */
+		UnlockPage(index, LSM_METAPAGE_BLKNO, ExclusiveLock);
+		return;
+	}
+
+	initLsmState(&lsmstate, index);
+	tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
+								   "LSM flush temporary context",
+								   ALLOCSET_DEFAULT_SIZES);
+	oldCtx = MemoryContextSwitchTo(tmpCtx);
+
+	while (blkno != stop)
+	{
+		BlockNumber head = blkno;
+		uint32		nconsumed = 0;
+		int			ntuples = 0;
+		LsmRunWriter *writer;
+		LsmRunData	run;
+		bool		haveRun;
+		int			i;
+
+		/* Make sure there is room for another run in the metapage */
+		metadata = lsmCopyMeta(index);
+		while (metadata->nRuns >= LSM_MAX_RUNS)
+		{
+			MemoryContextSwitchTo(oldCtx);
+			lsmMergeRuns(index, true);
+			MemoryContextSwitchTo(tmpCtx);
+			metadata = lsmCopyMeta(index);
+		}
+
+		/* Collect as many delta pages as fit in memory */
+		maxtuples = 1024;
+		tuples = palloc_array(IndexTuple, maxtuples);
+		while (blkno != stop &&
+			   (nconsumed == 0 ||
+				MemoryContextMemAllocated(tmpCtx, false) < workMemory * (Size) 1024))
+		{
+			Buffer		buffer;
+			Page		page;
+			OffsetNumber offnum,
+						maxoff;
+
+			CHECK_FOR_INTERRUPTS();
+
+			buffer = ReadBuffer(index, blkno);
+			LockBuffer(buffer, BUFFER_LOCK_SHARE);
+			page = BufferGetPage(buffer);
+			maxoff = PageGetMaxOffsetNumber(page);
+
+			for (offnum = FirstOffsetNumber; offnum <= maxoff; offnum++)
+			{
+				IndexTuple	itup;
+
+				itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+				if (ntuples >= maxtuples)
+				{
+					maxtuples *= 2;
+					tuples = repalloc_array(tuples, IndexTuple, maxtuples);
+				}
+				tuples[ntuples++] = CopyIndexTuple(itup);
+			}
+
+			blkno = LsmPageGetOpaque(page)->rightlink;
+			UnlockReleaseBuffer(buffer);
+			nconsumed++;
+		}
+
+		/* Sort them and write them out as a run */
+		lsmSortTuples(&lsmstate, tuples, ntuples);
+		writer = lsmBeginRun(index, lsmReserveRunId(index));
+		for (i = 0; i < ntuples; i++)
+			lsmRunAdd(writer, tuples[i]);
+		haveRun = lsmEndRun(writer, &run);
+
+		lsmRegisterRun(index, haveRun ? &run : NULL, NULL, 0,
+					   blkno, nconsumed);
+		lsmRetireDelta(index, head, nconsumed);
+
+		MemoryContextReset(tmpCtx);
+	}
+
+	MemoryContextSwitchTo(oldCtx);
+	MemoryContextDelete(tmpCtx);
+
+	UnlockPage(index, LSM_METAPAGE_BLKNO, ExclusiveLock);
+}
+
+/*
+ * Merge some sorted runs into one.
+ *
+ * We merge the runs of the lowest tier that has at least merge_fanout runs.
+ * If there is none and force is true, we merge the runs of the most
+ * populous tier, or failing that the two newest runs, so that repeated
+ * forced merges eventually leave a single run.
+ *
+ * Returns false if there was nothing to merge.  The caller must hold the
+ * heavyweight lock on the metapage.
+ */
+bool
+lsmMergeRuns(Relation index, bool force)
+{
+	LsmMetaPageData *metadata;
+	LsmState	lsmstate;
+	LsmRunData	inputs[LSM_MAX_RUNS];
+	LsmRunData	run;
+	LsmRunWriter *writer;
+	int			ninputs = 0;
+	int			fanout = LsmGetMergeFanout(index);
+	int			tier = -1;
+	int			bestTier = -1;
+	int			bestCount = 1;
+	bool		haveRun;
+	int			i;
+
+	metadata = lsmCopyMeta(index);
+	if (metadata->nRuns < 2)
+	{
+		pfree(metadata);
+		return false;
+	}
+
+	/* Find the tier to merge */
+	for (i = 0; i < metadata->nRuns; i++)
+	{
+		int			t = metadata->runs[i].tier;
+		int			count = 0;
+		int			j;
+
+		for (j = 0; j < metadata->nRuns; j++)
+		{
+			if (metadata->runs[j].tier == t)
+				count++;
+		}
+
+		if (count >= fanout && (tier < 0 || t < tier))
+			tier = t;
+		if (count > bestCount)
+		{
+			bestTier = t;
+			bestCount = count;
+		}
+	}
+
+	if (tier < 0 && force)
+		tier = bestTier;
+
+	if (tier >= 0)
+	{
+		for (i = 0; i < metadata->nRuns; i++)
+		{
+			if (metadata->runs[i].tier == tier)
+				inputs[ninputs++] = metadata->runs[i];
+		}
+	}
+	else if (force)
+	{
+		inputs[ninputs++] = metadata->runs[0];
+		inputs[ninputs++] = metadata->runs[1];
+	}
+	else
+	{
+		pfree(metadata);
+		return false;
+	}
+
+	initLsmState(&lsmstate, index);
+	writer = lsmBeginRun(index, lsmReserveRunId(index));
+	lsmMergeToRun(&lsmstate, inputs, ninputs, writer);
+	haveRun = lsmEndRun(writer, &run);
+
+	lsmRegisterRun(index, haveRun ? &run : NULL, inputs, ninputs,
+				   InvalidBlockNumber, 0);
+	for (i = 0; i < ninputs; i++)
+		lsmRetireRun(index, &inputs[i]);
+
+	pfree(metadata);
+	return true;
+}
+
+/*
+ * Write out the tuples accumulated during index build as a sorted run.
+ */
+static void
+lsmBuildDumpRun(LsmBuildState *buildstate)
+{
+	LsmRunWriter *writer;
+	int			i;
+
+	lsmSortTuples(&buildstate->state, buildstate->tuples, buildstate->ntuples);
+
+	writer = lsmBeginRun(buildstate->state.index, buildstate->nextRunId++);
+	for (i = 0; i < buildstate->ntuples; i++)
+		lsmRunAdd(writer, buildstate->tuples[i]);
+
+	if (buildstate->nruns >= buildstate->maxruns)
+	{
+		buildstate->maxruns *= 2;
+		buildstate->runs = repalloc_array(buildstate->runs, LsmRunData,
+										  buildstate->maxruns);
+	}
+	if (lsmEndRun(writer, &buildstate->runs[buildstate->nruns]))
+		buildstate->nruns++;
+
+	MemoryContextReset(buildstate->tmpCtx);
+	buildstate->tuples = MemoryContextAlloc(buildstate->tmpCtx,
+											sizeof(IndexTuple) * buildstate->maxtuples);
+	buildstate->ntuples = 0;
+	buildstate->memUsed = 0;
+}
+
+/*
+ * Per-tuple callback for table_index_build_scan.
+ */
+static void
+lsmBuildCallback(Relation index, ItemPointer tid, Datum *values,
+				 bool *isnull, bool tupleIsAlive, void *state)
+{
+	LsmBuildState *buildstate = (LsmBuildState *) state;
+	MemoryContext oldCtx;
+	IndexTuple	itup;
+
+	oldCtx = MemoryContextSwitchTo(buildstate->tmpCtx);
+
+	itup = LsmFormTuple(index, tid, values, isnull);
+	if (buildstate->ntuples >= buildstate->maxtuples)
+	{
+		buildstate->memUsed += sizeof(IndexTuple) * buildstate->maxtuples;
+		buildstate->maxtuples *= 2;
+		buildstate->tuples = repalloc_array(buildstate->tuples, IndexTuple,
+											buildstate->maxtuples);
+	}
+	buildstate->tuples[buildstate->ntuples++] = itup;
+	buildstate->memUsed += GetMemoryChunkSpace(itup);
+	buildstate->indtuples += 1;
+
+	MemoryContextSwitchTo(oldCtx);
+
+	if (buildstate->memUsed >= maintenance_work_mem * (Size) 1024)
+	{
+		CHECK_FOR_INTERRUPTS();
+		lsmBuildDumpRun(buildstate);
+	}
+}
+
+/*
+ * Build a new LSM index.
+ *
+ * The heap is sorted in chunks of maintenance_work_mem, each of which is
+ * written as a sorted run, and the runs are then merged into one.  The
+ * delta starts out empty.
+ */
+IndexBuildResult *
+lsmbuild(Relation heap, Relation index, IndexInfo *indexInfo)
+{
+	IndexBuildResult *result;
+	double		reltuples;
+	LsmBuildState buildstate;
+
+	if (RelationGetNumberOfBlocks(index) != 0)
+		elog(ERROR, "index \"%s\" already contains data",
+			 RelationGetRelationName(index));
+
+	/* Initialize the meta page */
+	LsmInitMetapage(index, MAIN_FORKNUM);
+
+	/* Initialize the LSM build state */
+	memset(&buildstate, 0, sizeof(buildstate));
+	initLsmState(&buildstate.state, index);
+	buildstate.tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
+											  "LSM build temporary context",
+											  ALLOCSET_DEFAULT_SIZES);
+	buildstate.maxtuples = 1024;
+	buildstate.tuples = MemoryContextAlloc(buildstate.tmpCtx,
+										   sizeof(IndexTuple) * buildstate.maxtuples);
+	buildstate.maxruns = 8;
+	buildstate.runs = palloc_array(LsmRunData, buildstate.maxruns);
+	buildstate.nextRunId = 1;
+
+	/* Do the heap scan */
+	reltuples = table_index_build_scan(heap, index, indexInfo, true, true,
+									   lsmBuildCallback, &buildstate,
+									   NULL);
+
+	if (buildstate.ntuples > 0)
+		lsmBuildDumpRun(&buildstate);
+
+	if (buildstate.nruns > 1)
+	{
+		LsmRunWriter *writer;
+		LsmRunData	run;
+		int			i;
+
+		writer = lsmBeginRun(index, buildstate.nextRunId);
+		lsmMergeToRun(&buildstate.state, buildstate.runs, buildstate.nruns,
+					  writer);
+		for (i = 0; i < buildstate.nruns; i++)
+			lsmRetireRun(index, &buildstate.runs[i]);
+		buildstate.nruns = 0;
+		if (lsmEndRun(writer, &run))
+			buildstate.runs[buildstate.nruns++] = run;
+	}
+
+	if (buildstate.nruns > 0)
+		lsmRegisterRun(index, &buildstate.runs[0], NULL, 0,
+					   InvalidBlockNumber, 0);
+
+	MemoryContextDelete(buildstate.tmpCtx);
+
+	result = palloc_object(IndexBuildResult);
+	result->heap_tuples = reltuples;
+	result->index_tuples = buildstate.indtuples;
+
+	return result;
+}
+
+/*
+ * Build an empty LSM index in the initialization fork.
+ */
+void
+lsmbuildempty(Relation index)
+{
+	/* Initialize the meta page */
+	LsmInitMetapage(index, INIT_FORKNUM);
+}
+
+/*
+ * Insert new tuple to the LSM index.
+ *
+ * The tuple is appended to the tail page of the delta.  Only when that is
+ * full do we need to lock the metapage exclusively to add a new tail page.
+ */
+bool
+lsminsert(Relation index, Datum *values, bool *isnull,
+		  ItemPointer ht_ctid, Relation heapRel,
+		  IndexUniqueCheck checkUnique,
+		  bool indexUnchanged,
+		  IndexInfo *indexInfo)
+{
+	IndexTuple	itup;
+	Size		itemsz;
+	MemoryContext oldCtx;
+	MemoryContext insertCtx;
+	LsmMetaPageData *metadata;
+	Buffer		buffer,
+				metaBuffer,
+				newBuffer;
+	Page		page;
+	GenericXLogState *state;
+	bool		needFlush;
+
+	insertCtx = AllocSetContextCreate(CurrentMemoryContext,
+									  "LSM insert temporary context",
+									  ALLOCSET_DEFAULT_SIZES);
+
+	oldCtx = MemoryContextSwitchTo(insertCtx);
+
+	itup = LsmFormTuple(index, ht_ctid, values, isnull);
+	itemsz = MAXALIGN(IndexTupleSize(itup));
+
+	metaBuffer = ReadBuffer(index, LSM_METAPAGE_BLKNO);
+
+	/*
+	 * At first, try to add the tuple to the tail page without locking the
+	 * metapage exclusively.  The page we find might have stopped being the
+	 * tail, or even have been flushed, by the time we lock it; inserting
+	 * anywhere but at the current tail could lose the tuple, so in that case
+	 * we just look again.
+	 */
+	for (;;)
+	{
+		BlockNumber blkno;
+
+		LockBuffer(metaBuffer, BUFFER_LOCK_SHARE);
+		blkno = LsmPageGetMeta(BufferGetPage(metaBuffer))->deltaTail;
+		LockBuffer(metaBuffer, BUFFER_LOCK_UNLOCK);
+
+		buffer = ReadBuffer(index, blkno);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buffer);
+
+		if (!PageIsNew(page) && LsmPageIsDelta(page) &&
+			!LsmPageIsRetired(page) &&
+			LsmPageGetOpaque(page)->rightlink == InvalidBlockNumber)
+			break;
+
+		UnlockReleaseBuffer(buffer);
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	if (PageGetFreeSpace(page) >= itemsz)
+	{
+		/* Success!  Apply the change, clean up, and exit */
+		state = GenericXLogStart(index);
+		page = GenericXLogRegisterBuffer(state, buffer, 0);
+		if (PageAddItem(page, itup, itemsz, InvalidOffsetNumber,
+						false, false) == InvalidOffsetNumber)
+			elog(ERROR, "failed to add item to index page in \"%s\"",
+				 RelationGetRelationName(index));
+		GenericXLogFinish(state);
+		UnlockReleaseBuffer(buffer);
+		ReleaseBuffer(metaBuffer);
+		MemoryContextSwitchTo(oldCtx);
+		MemoryContextDelete(insertCtx);
+		return false;
+	}
+
+	/*
+	 * The tail page is full, so we have to add a new one.  Relock in the
+	 * metapage-first order, and check again whether the page is still the
+	 * tail.
+	 */
+	UnlockReleaseBuffer(buffer);
+	LockBuffer(metaBuffer, BUFFER_LOCK_EXCLUSIVE);
+	metadata = LsmPageGetMeta(BufferGetPage(metaBuffer));
+	buffer = ReadBuffer(index, metadata->deltaTail);
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+	state = GenericXLogStart(index);
+	if (PageGetFreeSpace(BufferGetPage(buffer)) >= itemsz)
+	{
+		/* Someone else added a new tail meanwhile */
+		page = GenericXLogRegisterBuffer(state, buffer, 0);
+		newBuffer = InvalidBuffer;
+	}
+	else
+	{
+		newBuffer = LsmNewBuffer(index);
+		page = lsmAppendDeltaPage(state, metaBuffer, buffer, newBuffer);
+	}
+
+	if (PageAddItem(page, itup, itemsz, InvalidOffsetNumber,
+					false, false) == InvalidOffsetNumber)
+		elog(ERROR, "failed to add item to index page in \"%s\"",
+			 RelationGetRelationName(index));
+
+	/* Apply the changes */
+	GenericXLogFinish(state);
+
+	/* Is it time to flush the delta? */
+	needFlush = (uint64) (metadata->deltaNextSeq - metadata->deltaHeadSeq) *
+		(BLCKSZ / 1024) >= LsmGetDeltaSize(index);
+
+	if (BufferIsValid(newBuffer))
+		UnlockReleaseBuffer(newBuffer);
+	UnlockReleaseBuffer(buffer);
+	UnlockReleaseBuffer(metaBuffer);
+
+	MemoryContextSwitchTo(oldCtx);
+	MemoryContextDelete(insertCtx);
+
+	if (needFlush)
+		lsmFlushDelta(index, false);
+
+	return false;
+}
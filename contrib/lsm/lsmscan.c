@@ -0,0 +1,346 @@
+/*-------------------------------------------------------------------------
+ *
+ * lsmscan.c
+ *		LSM index scan functions.
+ *
+ * A scan has to look at the whole delta, which is unsorted, and at each
+ * sorted run.  Within a run, keys on the first index column are used to
+ * descend to the first leaf page that can contain matches, and to stop
+ * once no more can follow.
+ *
+ * Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/lsm/lsmscan.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/relscan.h"
+#include "lsm.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "storage/bufmgr.h"
+#include "utils/rel.h"
+
+/*
+ * Begin scan of LSM index.
+ */
+IndexScanDesc
+lsmbeginscan(Relation r, int nkeys, int norderbys)
+{
+	IndexScanDesc scan;
+	LsmScanOpaque so;
+
+	scan = RelationGetIndexScan(r, nkeys, norderbys);
+
+	so = (LsmScanOpaque) palloc_object(LsmScanOpaqueData);
+	initLsmState(&so->state, scan->indexRelation);
+	so->lowerKey = NULL;
+	so->upperKey = NULL;
+	so->firstColKeys = false;
+	so->keysOk = true;
+
+	scan->opaque = so;
+
+	return scan;
+}
+
+/*
+ * Rescan an LSM index.
+ */
+void
+lsmrescan(IndexScanDesc scan, ScanKey scankey, int nscankeys,
+		  ScanKey orderbys, int norderbys)
+{
+	LsmScanOpaque so = (LsmScanOpaque) scan->opaque;
+	Oid			opcintype = scan->indexRelation->rd_opcintype[0];
+	int			i;
+
+	if (scankey && scan->numberOfKeys > 0)
+		memcpy(scan->keyData, scankey, scan->numberOfKeys * sizeof(ScanKeyData));
+
+	so->lowerKey = NULL;
+	so->upperKey = NULL;
+	so->firstColKeys = false;
+	so->keysOk = true;
+
+	for (i = 0; i < scan->numberOfKeys; i++)
+	{
+		ScanKey		skey = &scan->keyData[i];
+
+		/*
+		 * Assume LSM-indexable operators to be strict, so nothing could be
+		 * found for NULL key.
+		 */
+		if (skey->sk_flags & SK_ISNULL)
+			so->keysOk = false;
+
+		if (skey->sk_attno != 1)
+			continue;
+		so->firstColKeys = true;
+
+		/*
+		 * Only keys that can be compared with the comparison support function
+		 * of the column can bound the part of a run that we read.
+		 */
+		if (skey->sk_subtype != InvalidOid && skey->sk_subtype != opcintype)
+			continue;
+
+		switch (skey->sk_strategy)
+		{
+			case LSM_EQUAL_STRATEGY:
+				so->lowerKey = so->upperKey = skey;
+				break;
+			case LSM_GREATER_EQUAL_STRATEGY:
+			case LSM_GREATER_STRATEGY:
+				if (so->lowerKey == NULL)
+					so->lowerKey = skey;
+				break;
+			case LSM_LESS_STRATEGY:
+			case LSM_LESS_EQUAL_STRATEGY:
+				if (so->upperKey == NULL)
+					so->upperKey = skey;
+				break;
+		}
+	}
+}
+
+/*
+ * End scan of LSM index.
+ */
+void
+lsmendscan(IndexScanDesc scan)
+{
+	LsmScanOpaque so = (LsmScanOpaque) scan->opaque;
+
+	pfree(so);
+}
+
+/*
+ * Does the index tuple satisfy all scan keys?
+ */
+static bool
+lsmCheckKeys(IndexScanDesc scan, IndexTuple itup)
+{
+	LsmScanOpaque so = (LsmScanOpaque) scan->opaque;
+	int			i;
+
+	for (i = 0; i < scan->numberOfKeys; i++)
+	{
+		ScanKey		skey = &scan->keyData[i];
+		Datum		datum;
+		bool		isnull;
+
+		datum = index_getattr(itup, skey->sk_attno, so->state.tupdesc, &isnull);
+		if (isnull)
+			return false;
+		if (!DatumGetBool(FunctionCall2Coll(&skey->sk_func,
+											skey->sk_collation,
+											datum,
+											skey->sk_argument)))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Compare the first column of an index tuple with the argument of a scan
+ * key.  NULLs sort after everything.
+ */
+static int
+lsmCompareKey(LsmScanOpaque so, IndexTuple itup, ScanKey skey)
+{
+	Datum		datum;
+	bool		isnull;
+
+	datum = index_getattr(itup, 1, so->state.tupdesc, &isnull);
+	if (isnull)
+		return 1;
+
+	return DatumGetInt32(FunctionCall2Coll(&so->state.cmpFn[0],
+										   so->state.collations[0],
+										   datum, skey->sk_argument));
+}
+
+/*
+ * Can no tuple at or after this one in a run satisfy the scan keys?
+ */
+static bool
+lsmPastUpperBound(LsmScanOpaque so, IndexTuple itup)
+{
+	bool		isnull;
+	int			cmp;
+
+	if (so->firstColKeys)
+	{
+		(void) index_getattr(itup, 1, so->state.tupdesc, &isnull);
+		if (isnull)
+			return true;
+	}
+
+	if (so->upperKey == NULL)
+		return false;
+
+	cmp = lsmCompareKey(so, itup, so->upperKey);
+	if (so->upperKey->sk_strategy == LSM_LESS_STRATEGY)
+		return cmp >= 0;
+	return cmp > 0;
+}
+
+/*
+ * Find the leaf page of a run to start scanning at.
+ */
+static BlockNumber
+lsmDescendRun(IndexScanDesc scan, LsmRunData *run)
+{
+	LsmScanOpaque so = (LsmScanOpaque) scan->opaque;
+	BlockNumber blkno = run->root;
+
+	if (so->lowerKey == NULL)
+		return run->firstleaf;
+
+	for (;;)
+	{
+		Buffer		buffer;
+		Page		page;
+		OffsetNumber offnum,
+					maxoff;
+		IndexTuple	itup = NULL;
+
+		buffer = ReadBuffer(scan->indexRelation, blkno);
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buffer);
+
+		if (LsmPageGetOpaque(page)->level == 0)
+		{
+			UnlockReleaseBuffer(buffer);
+			return blkno;
+		}
+
+		/* Find the last downlink whose key is below the lower bound */
+		maxoff = PageGetMaxOffsetNumber(page);
+		for (offnum = FirstOffsetNumber; offnum <= maxoff; offnum++)
+		{
+			IndexTuple	downlink;
+
+			downlink = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
+			if (itup != NULL && lsmCompareKey(so, downlink, so->lowerKey) >= 0)
+				break;
+			itup = downlink;
+		}
+
+		Assert(itup != NULL);
+		blkno = ItemPointerGetBlockNumber(&itup->t_tid);
+		UnlockReleaseBuffer(buffer);
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/*
+ * Add matching tuples on a page to the bitmap.  Returns false if the scan of
+ * the run can stop here.
+ */
+static bool
+lsmScanPage(IndexScanDesc scan, Page page, bool sorted,
+			TIDBitmap *tbm, int64 *ntids)
+{
+	LsmScanOpaque so = (LsmScanOpaque) scan->opaque;
+	OffsetNumber offnum,
+				maxoff = PageGetMaxOffsetNumber(page);
+
+	for (offnum = FirstOffsetNumber; offnum <= maxoff; offnum++)
+	{
+		IndexTuple	itup = (IndexTuple) PageGetItem(page,
+													PageGetItemId(page, offnum));
+
+		if (sorted && lsmPastUpperBound(so, itup))
+			return false;
+
+		if (lsmCheckKeys(scan, itup))
+		{
+			tbm_add_tuples(tbm, &itup->t_tid, 1, false);
+			(*ntids)++;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Insert all matching tuples into a bitmap.
+ */
+int64
+lsmgetbitmap(IndexScanDesc scan, TIDBitmap *tbm)
+{
+	LsmScanOpaque so = (LsmScanOpaque) scan->opaque;
+	Relation	index = scan->indexRelation;
+	int64		ntids = 0;
+	Buffer		metaBuffer;
+	LsmMetaPageData *metadata;
+	LsmRunData	runs[LSM_MAX_RUNS];
+	int			nRuns;
+	BlockNumber blkno;
+	int			i;
+
+	if (!so->keysOk)
+		return 0;
+
+	pgstat_count_index_scan(index);
+	if (scan->instrument)
+		scan->instrument->nsearches++;
+
+	/*
+	 * Take a consistent picture of the delta and the runs.  Pages that a
+	 * concurrent flush or merge retires stay readable until our snapshot is
+	 * gone, so every tuple is found exactly once, either in the delta or in
+	 * one of the runs.
+	 */
+	metaBuffer = ReadBuffer(index, LSM_METAPAGE_BLKNO);
+	LockBuffer(metaBuffer, BUFFER_LOCK_SHARE);
+	metadata = LsmPageGetMeta(BufferGetPage(metaBuffer));
+	nRuns = metadata->nRuns;
+	memcpy(runs, metadata->runs, sizeof(LsmRunData) * nRuns);
+	blkno = metadata->deltaHead;
+	UnlockReleaseBuffer(metaBuffer);
+
+	/* Scan the delta */
+	while (blkno != InvalidBlockNumber)
+	{
+		Buffer		buffer;
+		Page		page;
+
+		buffer = ReadBuffer(index, blkno);
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buffer);
+		(void) lsmScanPage(scan, page, false, tbm, &ntids);
+		blkno = LsmPageGetOpaque(page)->rightlink;
+		UnlockReleaseBuffer(buffer);
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	/* Scan each sorted run */
+	for (i = 0; i < nRuns; i++)
+	{
+		blkno = lsmDescendRun(scan, &runs[i]);
+
+		while (blkno != InvalidBlockNumber)
+		{
+			Buffer		buffer;
+			Page		page;
+			bool		more;
+
+			buffer = ReadBuffer(index, blkno);
+			LockBuffer(buffer, BUFFER_LOCK_SHARE);
+			page = BufferGetPage(buffer);
+			more = lsmScanPage(scan, page, true, tbm, &ntids);
+			blkno = more ? LsmPageGetOpaque(page)->rightlink : InvalidBlockNumber;
+			UnlockReleaseBuffer(buffer);
+			CHECK_FOR_INTERRUPTS();
+		}
+	}
+
+	return ntids;
+}
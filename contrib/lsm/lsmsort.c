@@ -0,0 +1,422 @@
+/*-------------------------------------------------------------------------
+ *
+ * lsmsort.c
+ *		Writing, merging and retiring the sorted runs of an LSM index.
+ *
+ * A sorted run is a static tree, much like a btree index built by
+ * nbtsort.c: leaf pages hold the index tuples in order, and each page of an
+ * upper level holds a downlink to each page of the level below it, keyed by
+ * a copy of the first tuple on the child page.  A run is never modified
+ * once it has been written, except that VACUUM removes index tuples from its
+ * leaf pages.
+ *
+ * Runs are written one page at a time, from left to right, so when the
+ * index has to be extended to make room for them, they are laid out
+ * sequentially in the index file.
+ *
+ * Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/lsm/lsmsort.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/generic_xlog.h"
+#include "lib/binaryheap.h"
+#include "lsm.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+#include "storage/indexfsm.h"
+#include "utils/rel.h"
+
+/*
+ * A page of a run under construction.  The buffer for it has already been
+ * allocated, so that its left sibling can link to it, but the page is only
+ * written out once it is full.
+ */
+typedef struct LsmWriterLevel
+{
+	PGAlignedBlock *page;		/* local copy of the page being filled */
+	Buffer		buffer;			/* pinned buffer for the page */
+	BlockNumber npages;			/* number of pages written on this level */
+} LsmWriterLevel;
+
+struct LsmRunWriter
+{
+	Relation	index;
+	uint32		id;				/* ID of the run */
+	int			nlevels;		/* number of levels started so far */
+	LsmWriterLevel levels[LSM_MAX_LEVELS];
+	BlockNumber firstleaf;
+	BlockNumber npages;
+	uint64		ntuples;
+};
+
+/* Reads the leaf level of a run, for merging */
+typedef struct LsmRunReader
+{
+	BlockNumber next;			/* next page to read */
+	OffsetNumber offnum;		/* current tuple on page */
+	OffsetNumber maxoff;
+	PGAlignedBlock page;		/* copy of current page */
+} LsmRunReader;
+
+typedef struct LsmMergeState
+{
+	LsmState   *state;
+	LsmRunReader *readers;
+} LsmMergeState;
+
+static void lsmRunAddToLevel(LsmRunWriter *writer, IndexTuple itup, int level);
+
+/*
+ * Start a new page on the given level, in the buffer already allocated for
+ * it.
+ */
+static void
+lsmStartPage(LsmRunWriter *writer, int level, Buffer buffer)
+{
+	LsmWriterLevel *lev = &writer->levels[level];
+	LsmPageOpaque opaque;
+
+	lev->buffer = buffer;
+	LsmInitPage(lev->page->data, LSM_RUN);
+	opaque = LsmPageGetOpaque(lev->page->data);
+	opaque->owner = writer->id;
+	opaque->level = level;
+
+	if (level == 0 && writer->firstleaf == InvalidBlockNumber)
+		writer->firstleaf = BufferGetBlockNumber(buffer);
+}
+
+/*
+ * Allocate a buffer for a page of the run.  Only its pin is kept until the
+ * page is written.
+ */
+static Buffer
+lsmAllocRunBuffer(LsmRunWriter *writer)
+{
+	Buffer		buffer = LsmNewBuffer(writer->index);
+
+	LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+	return buffer;
+}
+
+/*
+ * Write out the current page of the given level, and add a downlink to it to
+ * the level above, unless it is the root.
+ */
+static void
+lsmFinishPage(LsmRunWriter *writer, int level, bool last, bool isroot)
+{
+	LsmWriterLevel *lev = &writer->levels[level];
+	Page		page = lev->page->data;
+	BlockNumber blkno = BufferGetBlockNumber(lev->buffer);
+	Buffer		nextbuf = InvalidBuffer;
+	IndexTuple	downlink = NULL;
+	GenericXLogState *state;
+
+	Assert(PageGetMaxOffsetNumber(page) >= FirstOffsetNumber);
+
+	if (!last)
+	{
+		nextbuf = lsmAllocRunBuffer(writer);
+		LsmPageGetOpaque(page)->rightlink = BufferGetBlockNumber(nextbuf);
+	}
+
+	if (!isroot)
+	{
+		downlink = CopyIndexTuple((IndexTuple)
+								  PageGetItem(page,
+											  PageGetItemId(page, FirstOffsetNumber)));
+		ItemPointerSet(&downlink->t_tid, blkno, FirstOffsetNumber);
+	}
+
+	LockBuffer(lev->buffer, BUFFER_LOCK_EXCLUSIVE);
+	state = GenericXLogStart(writer->index);
+	memcpy(GenericXLogRegisterBuffer(state, lev->buffer, GENERIC_XLOG_FULL_IMAGE),
+		   page, BLCKSZ);
+	GenericXLogFinish(state);
+	UnlockReleaseBuffer(lev->buffer);
+
+	lev->npages++;
+	writer->npages++;
+
+	if (!last)
+		lsmStartPage(writer, level, nextbuf);
+	else
+		lev->buffer = InvalidBuffer;
+
+	if (downlink)
+	{
+		lsmRunAddToLevel(writer, downlink, level + 1);
+		pfree(downlink);
+	}
+}
+
+static void
+lsmRunAddToLevel(LsmRunWriter *writer, IndexTuple itup, int level)
+{
+	LsmWriterLevel *lev;
+	Size		itemsz = MAXALIGN(IndexTupleSize(itup));
+
+	if (level >= writer->nlevels)
+	{
+		if (level >= LSM_MAX_LEVELS)
+			elog(ERROR, "too many levels in sorted run of index \"%s\"",
+				 RelationGetRelationName(writer->index));
+		lev = &writer->levels[level];
+		lev->page = palloc_object(PGAlignedBlock);
+		lev->npages = 0;
+		lsmStartPage(writer, level, lsmAllocRunBuffer(writer));
+		writer->nlevels++;
+	}
+	lev = &writer->levels[level];
+
+	if (PageGetFreeSpace(lev->page->data) < itemsz)
+		lsmFinishPage(writer, level, false, false);
+
+	if (PageAddItem(lev->page->data, itup, itemsz, InvalidOffsetNumber,
+					false, false) == InvalidOffsetNumber)
+		elog(ERROR, "failed to add item to sorted run of index \"%s\"",
+			 RelationGetRelationName(writer->index));
+}
+
+/*
+ * Begin writing a new sorted run with the given ID.  The tuples must be
+ * passed to lsmRunAdd() in order.
+ */
+LsmRunWriter *
+lsmBeginRun(Relation index, uint32 id)
+{
+	LsmRunWriter *writer = palloc0_object(LsmRunWriter);
+
+	writer->index = index;
+	writer->id = id;
+	writer->firstleaf = InvalidBlockNumber;
+
+	return writer;
+}
+
+void
+lsmRunAdd(LsmRunWriter *writer, IndexTuple itup)
+{
+	lsmRunAddToLevel(writer, itup, 0);
+	writer->ntuples++;
+}
+
+/*
+ * Finish writing a sorted run, and fill in its description in *run.
+ *
+ * Returns false if no tuples were added, in which case no run was created.
+ */
+bool
+lsmEndRun(LsmRunWriter *writer, LsmRunData *run)
+{
+	int			level;
+	BlockNumber limit;
+	int			fanout = LsmGetMergeFanout(writer->index);
+
+	if (writer->ntuples == 0)
+	{
+		pfree(writer);
+		return false;
+	}
+
+	/*
+	 * Write out the rightmost page of each level, bottom-up.  The first level
+	 * that consists of a single page is the root.
+	 */
+	for (level = 0;; level++)
+	{
+		LsmWriterLevel *lev = &writer->levels[level];
+		bool		isroot = (level == writer->nlevels - 1 && lev->npages == 0);
+
+		if (isroot)
+			run->root = BufferGetBlockNumber(lev->buffer);
+		lsmFinishPage(writer, level, true, isroot);
+		pfree(lev->page);
+		if (isroot)
+			break;
+	}
+
+	run->id = writer->id;
+	run->level = level;
+	run->firstleaf = writer->firstleaf;
+	run->npages = writer->npages;
+	run->ntuples = writer->ntuples;
+
+	/*
+	 * Runs are grouped into tiers by size for merging: tier 0 is up to the
+	 * size of the delta, and each further tier is merge_fanout times larger.
+	 */
+	run->tier = 0;
+	limit = Max(LsmGetDeltaSize(writer->index) / (BLCKSZ / 1024), 1);
+	while (run->npages > limit && run->tier < PG_UINT16_MAX)
+	{
+		limit = (limit > MaxBlockNumber / fanout) ? MaxBlockNumber : limit * fanout;
+		run->tier++;
+	}
+
+	pfree(writer);
+	return true;
+}
+
+static int
+lsmSortCmp(const void *a, const void *b, void *arg)
+{
+	return lsmCompareTuples((LsmState *) arg,
+							*((IndexTuple *) a), *((IndexTuple *) b));
+}
+
+/*
+ * Sort an array of index tuples.
+ */
+void
+lsmSortTuples(LsmState *state, IndexTuple *tuples, int ntuples)
+{
+	qsort_arg(tuples, ntuples, sizeof(IndexTuple), lsmSortCmp, state);
+}
+
+/*
+ * Read the next nonempty leaf page of a run.  Returns false at the end of
+ * the run.
+ */
+static bool
+lsmReaderNextPage(Relation index, LsmRunReader *reader)
+{
+	while (reader->next != InvalidBlockNumber)
+	{
+		Buffer		buffer;
+		Page		page;
+
+		CHECK_FOR_INTERRUPTS();
+
+		buffer = ReadBuffer(index, reader->next);
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buffer);
+		memcpy(reader->page.data, page, BLCKSZ);
+		UnlockReleaseBuffer(buffer);
+
+		page = reader->page.data;
+		reader->next = LsmPageGetOpaque(page)->rightlink;
+		reader->offnum = FirstOffsetNumber;
+		reader->maxoff = PageGetMaxOffsetNumber(page);
+		if (reader->maxoff >= FirstOffsetNumber)
+			return true;
+	}
+
+	return false;
+}
+
+static inline IndexTuple
+lsmReaderTuple(LsmRunReader *reader)
+{
+	Page		page = reader->page.data;
+
+	return (IndexTuple) PageGetItem(page, PageGetItemId(page, reader->offnum));
+}
+
+/* binaryheap comparator: the reader with the smallest tuple comes first */
+static int
+lsmMergeCmp(Datum a, Datum b, void *arg)
+{
+	LsmMergeState *mstate = (LsmMergeState *) arg;
+
+	return -lsmCompareTuples(mstate->state,
+							 lsmReaderTuple(&mstate->readers[DatumGetInt32(a)]),
+							 lsmReaderTuple(&mstate->readers[DatumGetInt32(b)]));
+}
+
+/*
+ * Merge the given runs, adding all their tuples to a new run.
+ *
+ * The caller must prevent the runs from being modified meanwhile.
+ */
+void
+lsmMergeToRun(LsmState *state, LsmRunData *inputs, int ninputs,
+			  LsmRunWriter *writer)
+{
+	LsmMergeState mstate;
+	binaryheap *heap;
+	int			i;
+
+	mstate.state = state;
+	mstate.readers = palloc_array(LsmRunReader, ninputs);
+	heap = binaryheap_allocate(ninputs, lsmMergeCmp, &mstate);
+
+	for (i = 0; i < ninputs; i++)
+	{
+		mstate.readers[i].next = inputs[i].firstleaf;
+		if (lsmReaderNextPage(state->index, &mstate.readers[i]))
+			binaryheap_add_unordered(heap, Int32GetDatum(i));
+	}
+	binaryheap_build(heap);
+
+	while (!binaryheap_empty(heap))
+	{
+		Datum		top = binaryheap_first(heap);
+		LsmRunReader *reader = &mstate.readers[DatumGetInt32(top)];
+
+		lsmRunAdd(writer, lsmReaderTuple(reader));
+
+		if (reader->offnum < reader->maxoff)
+		{
+			reader->offnum++;
+			binaryheap_replace_first(heap, top);
+		}
+		else if (lsmReaderNextPage(state->index, reader))
+			binaryheap_replace_first(heap, top);
+		else
+			binaryheap_remove_first(heap);
+	}
+
+	binaryheap_free(heap);
+	pfree(mstate.readers);
+}
+
+/*
+ * Retire all pages of a run that is no longer referenced from the metapage.
+ */
+void
+lsmRetireRun(Relation index, LsmRunData *run)
+{
+	BlockNumber leftmost = run->root;
+
+	while (leftmost != InvalidBlockNumber)
+	{
+		BlockNumber blkno = leftmost;
+
+		leftmost = InvalidBlockNumber;
+		while (blkno != InvalidBlockNumber)
+		{
+			Buffer		buffer;
+			Page		page;
+			GenericXLogState *state;
+
+			buffer = ReadBuffer(index, blkno);
+			LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+			state = GenericXLogStart(index);
+			page = GenericXLogRegisterBuffer(state, buffer, 0);
+
+			/* Remember the leftmost page of the level below */
+			if (leftmost == InvalidBlockNumber &&
+				LsmPageGetOpaque(page)->level > 0 &&
+				PageGetMaxOffsetNumber(page) >= FirstOffsetNumber)
+			{
+				IndexTuple	itup;
+
+				itup = (IndexTuple) PageGetItem(page,
+												PageGetItemId(page, FirstOffsetNumber));
+				leftmost = ItemPointerGetBlockNumber(&itup->t_tid);
+			}
+
+			blkno = LsmPageGetOpaque(page)->rightlink;
+			LsmPageRetire(page);
+			GenericXLogFinish(state);
+			UnlockReleaseBuffer(buffer);
+		}
+	}
+}
@@ -0,0 +1,357 @@
+/*-------------------------------------------------------------------------
+ *
+ * lsmutils.c
+ *		LSM index utilities.
+ *
+ * Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/lsm/lsmutils.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/amapi.h"
+#include "access/generic_xlog.h"
+#include "access/reloptions.h"
+#include "commands/vacuum.h"
+#include "lsm.h"
+#include "storage/bufmgr.h"
+#include "storage/indexfsm.h"
+#include "utils/guc.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+PG_FUNCTION_INFO_V1(lsmhandler);
+
+/* Kind of relation options for LSM index */
+static relopt_kind lsm_relopt_kind;
+
+/* parse table for fillRelOptions */
+static relopt_parse_elt lsm_relopt_tab[2];
+
+/*
+ * Module initialize function: initialize info about LSM relation options.
+ */
+void
+_PG_init(void)
+{
+	lsm_relopt_kind = add_reloption_kind();
+
+	add_int_reloption(lsm_relopt_kind, "delta_size",
+					  "Size of the delta that triggers writing it out as a sorted run, in kilobytes",
+					  LSM_DEFAULT_DELTA_SIZE, LSM_MIN_DELTA_SIZE, MAX_KILOBYTES,
+					  ShareUpdateExclusiveLock);
+	lsm_relopt_tab[0].optname = "delta_size";
+	lsm_relopt_tab[0].opttype = RELOPT_TYPE_INT;
+	lsm_relopt_tab[0].offset = offsetof(LsmOptions, deltaSize);
+
+	add_int_reloption(lsm_relopt_kind, "merge_fanout",
+					  "Number of sorted runs of the same tier that are merged together",
+					  LSM_DEFAULT_MERGE_FANOUT, 2, LSM_MAX_MERGE_FANOUT,
+					  ShareUpdateExclusiveLock);
+	lsm_relopt_tab[1].optname = "merge_fanout";
+	lsm_relopt_tab[1].opttype = RELOPT_TYPE_INT;
+	lsm_relopt_tab[1].offset = offsetof(LsmOptions, mergeFanout);
+}
+
+/*
+ * LSM handler function: return IndexAmRoutine with access method parameters
+ * and callbacks.
+ */
+Datum
+lsmhandler(PG_FUNCTION_ARGS)
+{
+	IndexAmRoutine *amroutine = makeNode(IndexAmRoutine);
+
+	amroutine->amstrategies = LSM_NSTRATEGIES;
+	amroutine->amsupport = LSM_NPROC;
+	amroutine->amoptsprocnum = 0;
+	amroutine->amcanorder = false;
+	amroutine->amcanorderbyop = false;
+	amroutine->amcanhash = false;
+	amroutine->amconsistentequality = false;
+	amroutine->amconsistentordering = false;
+	amroutine->amcanbackward = false;
+	amroutine->amcanunique = false;
+	amroutine->amcanmulticol = true;
+	amroutine->amoptionalkey = true;
+	amroutine->amsearcharray = false;
+	amroutine->amsearchnulls = false;
+	amroutine->amstorage = false;
+	amroutine->amclusterable = false;
+	amroutine->ampredlocks = false;
+	amroutine->amcanparallel = false;
+	amroutine->amcanbuildparallel = false;
+	amroutine->amcaninclude = false;
+	amroutine->amusemaintenanceworkmem = true;
+	amroutine->amparallelvacuumoptions = VACUUM_OPTION_NO_PARALLEL;
+	amroutine->amkeytype = InvalidOid;
+
+	amroutine->ambuild = lsmbuild;
+	amroutine->ambuildempty = lsmbuildempty;
+	amroutine->aminsert = lsminsert;
+	amroutine->aminsertcleanup = NULL;
+	amroutine->aminsertbatch = NULL;
+	amroutine->ambulkdelete = lsmbulkdelete;
+	amroutine->amvacuumcleanup = lsmvacuumcleanup;
+	amroutine->amcanreturn = NULL;
+	amroutine->amcostestimate = lsmcostestimate;
+	amroutine->amgettreeheight = NULL;
+	amroutine->amoptions = lsmoptions;
+	amroutine->amproperty = NULL;
+	amroutine->ambuildphasename = NULL;
+	amroutine->amvalidate = lsmvalidate;
+	amroutine->amadjustmembers = NULL;
+	amroutine->ambeginscan = lsmbeginscan;
+	amroutine->amrescan = lsmrescan;
+	amroutine->amgettuple = NULL;
+	amroutine->amgetbitmap = lsmgetbitmap;
+	amroutine->amendscan = lsmendscan;
+	amroutine->ammarkpos = NULL;
+	amroutine->amrestrpos = NULL;
+	amroutine->amestimateparallelscan = NULL;
+	amroutine->aminitparallelscan = NULL;
+	amroutine->amparallelrescan = NULL;
+	amroutine->amtranslatestrategy = NULL;
+	amroutine->amtranslatecmptype = NULL;
+
+	PG_RETURN_POINTER(amroutine);
+}
+
+/*
+ * Fill LsmState structure for particular index.
+ */
+void
+initLsmState(LsmState *state, Relation index)
+{
+	int			i;
+
+	state->index = index;
+	state->tupdesc = RelationGetDescr(index);
+	state->nColumns = index->rd_att->natts;
+
+	/* Initialize comparison function for each attribute */
+	for (i = 0; i < state->nColumns; i++)
+	{
+		fmgr_info_copy(&(state->cmpFn[i]),
+					   index_getprocinfo(index, i + 1, LSM_CMP_PROC),
+					   CurrentMemoryContext);
+		state->collations[i] = index->rd_indcollation[i];
+	}
+}
+
+/*
+ * Compare two index tuples: by their keys, with NULLs sorting last, and then
+ * by heap TID.
+ */
+int
+lsmCompareTuples(LsmState *state, IndexTuple a, IndexTuple b)
+{
+	int			i;
+
+	for (i = 0; i < state->nColumns; i++)
+	{
+		Datum		da,
+					db;
+		bool		anull,
+					bnull;
+		int32		cmp;
+
+		da = index_getattr(a, i + 1, state->tupdesc, &anull);
+		db = index_getattr(b, i + 1, state->tupdesc, &bnull);
+
+		if (anull || bnull)
+		{
+			if (!anull)
+				return -1;
+			if (!bnull)
+				return 1;
+			continue;
+		}
+
+		cmp = DatumGetInt32(FunctionCall2Coll(&state->cmpFn[i],
+											  state->collations[i],
+											  da, db));
+		if (cmp != 0)
+			return cmp;
+	}
+
+	return ItemPointerCompare(&a->t_tid, &b->t_tid);
+}
+
+/*
+ * Form an index tuple pointing to the given heap tuple.
+ */
+IndexTuple
+LsmFormTuple(Relation index, ItemPointer iptr, Datum *values, bool *isnull)
+{
+	IndexTuple	itup;
+	Size		itemsz;
+
+	itup = index_form_tuple(RelationGetDescr(index), values, isnull);
+	itup->t_tid = *iptr;
+
+	itemsz = MAXALIGN(IndexTupleSize(itup));
+	if (itemsz > LsmMaxItemSize)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("index row size %zu exceeds maximum %zu for index \"%s\"",
+						itemsz, (Size) LsmMaxItemSize,
+						RelationGetRelationName(index))));
+
+	return itup;
+}
+
+/*
+ * Is the page free to be reused?
+ *
+ * A retired page might still be read by scans that found it before it was
+ * retired, so it can only be reused once no snapshot is old enough to belong
+ * to such a scan.
+ */
+bool
+LsmPageIsRecyclable(Page page)
+{
+	if (PageIsNew(page))
+		return true;
+
+	return LsmPageIsRetired(page) &&
+		GlobalVisCheckRemovableFullXid(NULL, LsmPageGetOpaque(page)->safexid);
+}
+
+/*
+ * Mark a page as no longer needed.  Its contents are left alone, for the
+ * benefit of concurrent scans.
+ */
+void
+LsmPageRetire(Page page)
+{
+	LsmPageOpaque opaque = LsmPageGetOpaque(page);
+
+	opaque->flags |= LSM_RETIRED;
+	opaque->safexid = ReadNextFullTransactionId();
+}
+
+/*
+ * Allocate a new page (either by recycling, or by extending the index file)
+ * The returned buffer is already pinned and exclusive-locked
+ * Caller is responsible for initializing the page by calling LsmInitPage
+ */
+Buffer
+LsmNewBuffer(Relation index)
+{
+	Buffer		buffer;
+
+	/* First, try to get a page from FSM */
+	for (;;)
+	{
+		BlockNumber blkno = GetFreeIndexPage(index);
+
+		if (blkno == InvalidBlockNumber)
+			break;
+
+		buffer = ReadBuffer(index, blkno);
+
+		/*
+		 * We have to guard against the possibility that someone else already
+		 * recycled this page; the buffer may be locked if so.
+		 */
+		if (ConditionalLockBuffer(buffer))
+		{
+			if (LsmPageIsRecyclable(BufferGetPage(buffer)))
+				return buffer;	/* OK to use */
+
+			LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+		}
+
+		/* Can't use it, so release buffer and try again */
+		ReleaseBuffer(buffer);
+	}
+
+	/* Must extend the file */
+	buffer = ExtendBufferedRel(BMR_REL(index), MAIN_FORKNUM, NULL,
+							   EB_LOCK_FIRST);
+
+	return buffer;
+}
+
+/*
+ * Initialize any page of an LSM index.
+ */
+void
+LsmInitPage(Page page, uint16 flags)
+{
+	LsmPageOpaque opaque;
+
+	PageInit(page, BLCKSZ, sizeof(LsmPageOpaqueData));
+
+	opaque = LsmPageGetOpaque(page);
+	opaque->rightlink = InvalidBlockNumber;
+	opaque->flags = flags;
+	opaque->lsm_page_id = LSM_PAGE_ID;
+}
+
+/*
+ * Initialize metapage and the first (empty) delta page for an LSM index.
+ */
+void
+LsmInitMetapage(Relation index, ForkNumber forknum)
+{
+	Buffer		metaBuffer,
+				deltaBuffer;
+	Page		metaPage,
+				deltaPage;
+	LsmMetaPageData *metadata;
+	GenericXLogState *state;
+
+	/*
+	 * Make the new pages; since they are the first pages the metapage should
+	 * be associated with block number 0 (LSM_METAPAGE_BLKNO).  No need to
+	 * hold the extension lock because there cannot be concurrent inserters
+	 * yet.
+	 */
+	metaBuffer = ReadBufferExtended(index, forknum, P_NEW, RBM_NORMAL, NULL);
+	LockBuffer(metaBuffer, BUFFER_LOCK_EXCLUSIVE);
+	Assert(BufferGetBlockNumber(metaBuffer) == LSM_METAPAGE_BLKNO);
+	deltaBuffer = ReadBufferExtended(index, forknum, P_NEW, RBM_NORMAL, NULL);
+	LockBuffer(deltaBuffer, BUFFER_LOCK_EXCLUSIVE);
+
+	state = GenericXLogStart(index);
+	metaPage = GenericXLogRegisterBuffer(state, metaBuffer,
+										 GENERIC_XLOG_FULL_IMAGE);
+	deltaPage = GenericXLogRegisterBuffer(state, deltaBuffer,
+										  GENERIC_XLOG_FULL_IMAGE);
+
+	LsmInitPage(deltaPage, LSM_DELTA);
+	LsmPageGetOpaque(deltaPage)->owner = 0;
+
+	LsmInitPage(metaPage, LSM_META);
+	metadata = LsmPageGetMeta(metaPage);
+	memset(metadata, 0, sizeof(LsmMetaPageData));
+	metadata->magicNumber = LSM_MAGIC_NUMBER;
+	metadata->nextRunId = 1;
+	metadata->deltaHead = metadata->deltaTail = BufferGetBlockNumber(deltaBuffer);
+	metadata->deltaHeadSeq = 0;
+	metadata->deltaNextSeq = 1;
+	((PageHeader) metaPage)->pd_lower += sizeof(LsmMetaPageData);
+
+	GenericXLogFinish(state);
+
+	UnlockReleaseBuffer(deltaBuffer);
+	UnlockReleaseBuffer(metaBuffer);
+}
+
+/*
+ * Parse reloptions for LSM index, producing an LsmOptions struct.
+ */
+bytea *
+lsmoptions(Datum reloptions, bool validate)
+{
+	return (bytea *) build_reloptions(reloptions, validate,
+									  lsm_relopt_kind,
+									  sizeof(LsmOptions),
+									  lsm_relopt_tab,
+									  lengthof(lsm_relopt_tab));
+}
@@ -0,0 +1,309 @@
+/*-------------------------------------------------------------------------
+ *
+ * lsmvacuum.c
+ *		LSM index vacuum functions.
+ *
+ * Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  contrib/lsm/lsmvacuum.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/xlog.h"
+#include "catalog/pg_class.h"
+#include "commands/defrem.h"
+#include "commands/vacuum.h"
+#include "lsm.h"
+#include "miscadmin.h"
+#include "storage/bufmgr.h"
+#include "storage/indexfsm.h"
+#include "storage/lmgr.h"
+#include "utils/acl.h"
+#include "utils/rel.h"
+
+PG_FUNCTION_INFO_V1(lsm_compact);
+
+/*
+ * Classification of a page found by a physical scan of the index.
+ */
+typedef enum
+{
+	LSM_PAGE_FREE,				/* unused or retired */
+	LSM_PAGE_LIVE,				/* delta page or leaf of a live run */
+	LSM_PAGE_INTERNAL,			/* metapage or internal page of a live run */
+	LSM_PAGE_ORPHAN,			/* left behind by an interrupted flush or merge */
+} LsmPageClass;
+
+static LsmPageClass
+lsmClassifyPage(Page page, LsmMetaPageData *metadata)
+{
+	LsmPageOpaque opaque;
+	int			i;
+
+	if (PageIsNew(page) || LsmPageIsRetired(page))
+		return LSM_PAGE_FREE;
+
+	opaque = LsmPageGetOpaque(page);
+
+	if (LsmPageIsDelta(page))
+		return opaque->owner >= metadata->deltaHeadSeq ?
+			LSM_PAGE_LIVE : LSM_PAGE_ORPHAN;
+
+	if (LsmPageIsRun(page))
+	{
+		for (i = 0; i < metadata->nRuns; i++)
+		{
+			if (metadata->runs[i].id == opaque->owner)
+				return opaque->level == 0 ? LSM_PAGE_LIVE : LSM_PAGE_INTERNAL;
+		}
+		return LSM_PAGE_ORPHAN;
+	}
+
+	return LSM_PAGE_INTERNAL;
+}
+
+static void
+lsmReadMeta(Relation index, LsmMetaPageData *metadata)
+{
+	Buffer		metaBuffer;
+
+	metaBuffer = ReadBuffer(index, LSM_METAPAGE_BLKNO);
+	LockBuffer(metaBuffer, BUFFER_LOCK_SHARE);
+	memcpy(metadata, LsmPageGetMeta(BufferGetPage(metaBuffer)),
+		   sizeof(LsmMetaPageData));
+	UnlockReleaseBuffer(metaBuffer);
+}
+
+/*
+ * Bulk deletion of all index entries pointing to a set of heap tuples.
+ * The set of target tuples is specified via a callback routine that tells
+ * whether any given heap tuple (identified by ItemPointer) is being deleted.
+ *
+ * Tuples are removed in place from the delta and from the leaf pages of the
+ * sorted runs.  We hold off flushes and merges meanwhile, since they might
+ * copy a tuple before we get to remove it.
+ *
+ * Result: a palloc'd struct containing statistical info for VACUUM displays.
+ */
+IndexBulkDeleteResult *
+lsmbulkdelete(IndexVacuumInfo *info, IndexBulkDeleteResult *stats,
+			  IndexBulkDeleteCallback callback, void *callback_state)
+{
+	Relation	index = info->index;
+	BlockNumber blkno,
+				npages;
+	LsmMetaPageData metadata;
+
+	if (stats == NULL)
+		stats = palloc0_object(IndexBulkDeleteResult);
+
+	LockPage(index, LSM_METAPAGE_BLKNO, ExclusiveLock);
+	lsmReadMeta(index, &metadata);
+
+	/*
+	 * Iterate over the pages.  Pages added concurrently to the delta can't
+	 * contain tuples to delete, and no runs can be added while we hold the
+	 * lock.
+	 */
+	npages = RelationGetNumberOfBlocks(index);
+	for (blkno = LSM_METAPAGE_BLKNO + 1; blkno < npages; blkno++)
+	{
+		Buffer		buffer;
+		Page		page;
+		GenericXLogState *gxlogState;
+		OffsetNumber deletable[MaxOffsetNumber];
+		int			ndeletable = 0;
+		OffsetNumber offnum,
+					maxoff;
+
+		vacuum_delay_point(false);
+
+		buffer = ReadBufferExtended(index, MAIN_FORKNUM, blkno,
+									RBM_NORMAL, info->strategy);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buffer);
+
+		/* Leave anything but live tuples until lsmvacuumcleanup() */
+		if (lsmClassifyPage(page, &metadata) != LSM_PAGE_LIVE)
+		{
+			UnlockReleaseBuffer(buffer);
+			continue;
+		}
+
+		maxoff = PageGetMaxOffsetNumber(page);
+		for (offnum = FirstOffsetNumber; offnum <= maxoff; offnum++)
+		{
+			IndexTuple	itup = (IndexTuple) PageGetItem(page,
+														PageGetItemId(page, offnum));
+
+			if (callback(&itup->t_tid, callback_state))
+				deletable[ndeletable++] = offnum;
+		}
+
+		if (ndeletable > 0)
+		{
+			gxlogState = GenericXLogStart(index);
+			page = GenericXLogRegisterBuffer(gxlogState, buffer, 0);
+			PageIndexMultiDelete(page, deletable, ndeletable);
+			GenericXLogFinish(gxlogState);
+			stats->tuples_removed += ndeletable;
+		}
+
+		UnlockReleaseBuffer(buffer);
+	}
+
+	UnlockPage(index, LSM_METAPAGE_BLKNO, ExclusiveLock);
+
+	return stats;
+}
+
+/*
+ * Post-VACUUM cleanup.
+ *
+ * This is where the delta gets flushed and the sorted runs get merged in
+ * the background: autovacuum processes insert-only tables too, once enough
+ * rows have been inserted.
+ *
+ * Result: a palloc'd struct containing statistical info for VACUUM displays.
+ */
+IndexBulkDeleteResult *
+lsmvacuumcleanup(IndexVacuumInfo *info, IndexBulkDeleteResult *stats)
+{
+	Relation	index = info->index;
+	BlockNumber npages,
+				blkno;
+	LsmMetaPageData metadata;
+
+	if (info->analyze_only)
+		return stats;
+
+	if (stats == NULL)
+		stats = palloc0_object(IndexBulkDeleteResult);
+
+	lsmFlushDelta(index, true);
+
+	LockPage(index, LSM_METAPAGE_BLKNO, ExclusiveLock);
+
+	while (lsmMergeRuns(index, false))
+		vacuum_delay_point(false);
+
+	lsmReadMeta(index, &metadata);
+
+	/*
+	 * Iterate over the pages: insert recyclable pages into FSM, retire pages
+	 * of runs that never got registered, and collect statistics.
+	 */
+	npages = RelationGetNumberOfBlocks(index);
+	stats->num_pages = npages;
+	stats->pages_free = 0;
+	stats->num_index_tuples = 0;
+	for (blkno = LSM_METAPAGE_BLKNO + 1; blkno < npages; blkno++)
+	{
+		Buffer		buffer;
+		Page		page;
+
+		vacuum_delay_point(false);
+
+		buffer = ReadBufferExtended(index, MAIN_FORKNUM, blkno,
+									RBM_NORMAL, info->strategy);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buffer);
+
+		switch (lsmClassifyPage(page, &metadata))
+		{
+			case LSM_PAGE_FREE:
+				if (LsmPageIsRecyclable(page))
+				{
+					RecordFreeIndexPage(index, blkno);
+					stats->pages_free++;
+				}
+				stats->pages_deleted++;
+				break;
+			case LSM_PAGE_LIVE:
+				stats->num_index_tuples += PageGetMaxOffsetNumber(page);
+				break;
+			case LSM_PAGE_INTERNAL:
+				break;
+			case LSM_PAGE_ORPHAN:
+				{
+					GenericXLogState *gxlogState;
+
+					gxlogState = GenericXLogStart(index);
+					LsmPageRetire(GenericXLogRegisterBuffer(gxlogState, buffer, 0));
+					GenericXLogFinish(gxlogState);
+					stats->pages_newly_deleted++;
+					stats->pages_deleted++;
+				}
+				break;
+		}
+
+		UnlockReleaseBuffer(buffer);
+	}
+
+	UnlockPage(index, LSM_METAPAGE_BLKNO, ExclusiveLock);
+
+	IndexFreeSpaceMapVacuum(info->index);
+
+	return stats;
+}
+
+/*
+ * SQL-callable function to flush the delta of an LSM index and merge all of
+ * its sorted runs into one.
+ */
+Datum
+lsm_compact(PG_FUNCTION_ARGS)
+{
+	Oid			indexoid = PG_GETARG_OID(0);
+	Relation	indexRel;
+
+	if (RecoveryInProgress())
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("recovery is in progress"),
+				 errhint("LSM indexes cannot be compacted during recovery.")));
+
+	indexRel = index_open(indexoid, RowExclusiveLock);
+
+	/* Must be an LSM index */
+	if (indexRel->rd_rel->relkind != RELKIND_INDEX ||
+		indexRel->rd_rel->relam != get_index_am_oid("lsm", false))
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("\"%s\" is not an LSM index",
+						RelationGetRelationName(indexRel))));
+
+	/*
+	 * Reject attempts to read non-local temporary relations; we would be
+	 * likely to get wrong data since we have no visibility into the owning
+	 * session's local buffers.
+	 */
+	if (RELATION_IS_OTHER_TEMP(indexRel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot access temporary indexes of other sessions")));
+
+	/* User must own the index (comparable to privileges needed for VACUUM) */
+	if (!object_ownercheck(RelationRelationId, indexoid, GetUserId()))
+		aclcheck_error(ACLCHECK_NOT_OWNER, OBJECT_INDEX,
+					   RelationGetRelationName(indexRel));
+
+	/* Can't assume anything about the content of an invalid index */
+	if (indexRel->rd_index->indisvalid)
+	{
+		lsmFlushDelta(indexRel, true);
+
+		LockPage(indexRel, LSM_METAPAGE_BLKNO, ExclusiveLock);
+		while (lsmMergeRuns(indexRel, true))
+			CHECK_FOR_INTERRUPTS();
+		UnlockPage(indexRel, LSM_METAPAGE_BLKNO, ExclusiveLock);
+	}
+
+	index_close(indexRel, RowExclusiveLock);
+
+	PG_RETURN_VOID();
+}
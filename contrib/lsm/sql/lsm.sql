@@ -0,0 +1,67 @@
+CREATE EXTENSION lsm;
+
+CREATE TABLE tst (
+	i	int4,
+	t	text
+);
+
+INSERT INTO tst SELECT g % 100, (g % 7)::text FROM generate_series(1, 20000) g;
+CREATE INDEX lsmidx ON tst USING lsm (i, t) WITH (delta_size = 64);
+
+-- these go through the delta, which gets flushed into many sorted runs
+INSERT INTO tst SELECT g % 100, (g % 7)::text FROM generate_series(20001, 40000) g;
+
+SET enable_seqscan=off;
+SET enable_bitmapscan=on;
+SET enable_indexscan=on;
+
+EXPLAIN (COSTS OFF) SELECT count(*) FROM tst WHERE i = 7;
+EXPLAIN (COSTS OFF) SELECT count(*) FROM tst WHERE i >= 90 AND i < 95 AND t = '3';
+
+SELECT count(*) FROM tst WHERE i = 7;
+SELECT count(*) FROM tst WHERE i < 10;
+SELECT count(*) FROM tst WHERE i >= 90 AND i < 95 AND t = '3';
+SELECT count(*) FROM tst WHERE t = '3';
+
+-- merge everything into a single run
+SELECT lsm_compact('lsmidx');
+
+SELECT count(*) FROM tst WHERE i = 7;
+SELECT count(*) FROM tst WHERE i < 10;
+SELECT count(*) FROM tst WHERE i >= 90 AND i < 95 AND t = '3';
+SELECT count(*) FROM tst WHERE t = '3';
+
+DELETE FROM tst WHERE i > 50;
+VACUUM tst;
+INSERT INTO tst SELECT g % 100, (g % 7)::text FROM generate_series(1, 1000) g;
+INSERT INTO tst VALUES (NULL, '3'), (NULL, NULL);
+
+SELECT count(*) FROM tst WHERE i = 7;
+SELECT count(*) FROM tst WHERE i < 10;
+SELECT count(*) FROM tst WHERE i >= 90 AND i < 95 AND t = '3';
+SELECT count(*) FROM tst WHERE t = '3';
+
+-- text as the leading column
+CREATE INDEX lsmidx_t ON tst USING lsm (t);
+SELECT count(*) FROM tst WHERE t > '5';
+DROP INDEX lsmidx_t;
+
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+RESET enable_indexscan;
+
+-- Run amvalidator function on our opclasses
+SELECT opcname, amvalidate(opc.oid)
+FROM pg_opclass opc JOIN pg_am am ON am.oid = opcmethod
+WHERE amname = 'lsm'
+ORDER BY 1;
+
+--
+-- relation options
+--
+ALTER INDEX lsmidx SET (merge_fanout = 8);
+SELECT reloptions FROM pg_class WHERE oid = 'lsmidx'::regclass;
+-- check for min and max values
+\set VERBOSITY terse
+CREATE INDEX lsmidx2 ON tst USING lsm (i) WITH (delta_size = 10);
+CREATE INDEX lsmidx2 ON tst USING lsm (i) WITH (merge_fanout = 1);
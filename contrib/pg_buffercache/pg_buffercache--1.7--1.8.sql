@@ -0,0 +1,34 @@
+/* contrib/pg_buffercache/pg_buffercache--1.7--1.8.sql */
+
+-- complain if script is sourced in psql, rather than via ALTER EXTENSION
+\echo Use "ALTER EXTENSION pg_buffercache UPDATE TO '1.8'" to load this file. \quit
+
+-- Function to report the state of the clock-sweep partitions.
+CREATE FUNCTION pg_buffercache_partitions(
+    OUT partition integer,
+    OUT first_buffer integer,
+    OUT last_buffer integer,
+    OUT complete_passes bigint,
+    OUT buffers_allocated bigint)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'pg_buffercache_partitions'
+LANGUAGE C PARALLEL SAFE;
+
+REVOKE ALL ON FUNCTION pg_buffercache_partitions() FROM PUBLIC;
+GRANT EXECUTE ON FUNCTION pg_buffercache_partitions() TO pg_monitor;
+
+-- Function to count the buffers of each relation, optionally by sampling.
+CREATE FUNCTION pg_buffercache_relations(
+    IN sample_fraction float8 DEFAULT 1.0,
+    OUT relfilenode oid,
+    OUT reltablespace oid,
+    OUT reldatabase oid,
+    OUT relforknumber int2,
+    OUT buffers int8,
+    OUT buffers_dirty int8)
+RETURNS SETOF record
+AS 'MODULE_PATHNAME', 'pg_buffercache_relations'
+LANGUAGE C PARALLEL SAFE STRICT;
+
+REVOKE ALL ON FUNCTION pg_buffercache_relations(float8) FROM PUBLIC;
+GRANT EXECUTE ON FUNCTION pg_buffercache_relations(float8) TO pg_monitor;
@@ -8,13 +8,17 @@
  */
 #include "postgres.h"
 
+#include <math.h>
+
 #include "access/htup_details.h"
 #include "access/relation.h"
 #include "catalog/pg_type.h"
+#include "common/pg_prng.h"
 #include "funcapi.h"
 #include "port/pg_numa.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "utils/hsearch.h"
 #include "utils/rel.h"
 
 
@@ -22,6 +26,8 @@
 #define NUM_BUFFERCACHE_PAGES_ELEM	9
 #define NUM_BUFFERCACHE_SUMMARY_ELEM 5
 #define NUM_BUFFERCACHE_USAGE_COUNTS_ELEM 4
+#define NUM_BUFFERCACHE_PARTITIONS_ELEM 5
+#define NUM_BUFFERCACHE_RELATIONS_ELEM 6
 #define NUM_BUFFERCACHE_EVICT_ELEM 2
 #define NUM_BUFFERCACHE_EVICT_RELATION_ELEM 3
 #define NUM_BUFFERCACHE_EVICT_ALL_ELEM 3
@@ -92,6 +98,26 @@ typedef struct
 } BufferCacheOsPagesContext;
 
 
+/*
+ * Hash table entry counting the buffers of one relation fork, for
+ * pg_buffercache_relations().
+ */
+typedef struct
+{
+	RelFileNumber relfilenumber;	/* hash key (must be first) */
+	Oid			reltablespace;
+	Oid			reldatabase;
+	ForkNumber	forknum;
+} BufferCacheRelationKey;
+
+typedef struct
+{
+	BufferCacheRelationKey key;
+	int64		buffers;
+	int64		buffers_dirty;
+} BufferCacheRelationEntry;
+
+
 /*
  * Function returning data from the shared buffer cache - buffer number,
  * relation node/tablespace/database/blocknum and dirty indicator.
@@ -101,6 +127,8 @@ PG_FUNCTION_INFO_V1(pg_buffercache_os_pages);
 PG_FUNCTION_INFO_V1(pg_buffercache_numa_pages);
 PG_FUNCTION_INFO_V1(pg_buffercache_summary);
 PG_FUNCTION_INFO_V1(pg_buffercache_usage_counts);
+PG_FUNCTION_INFO_V1(pg_buffercache_partitions);
+PG_FUNCTION_INFO_V1(pg_buffercache_relations);
 PG_FUNCTION_INFO_V1(pg_buffercache_evict);
 PG_FUNCTION_INFO_V1(pg_buffercache_evict_relation);
 PG_FUNCTION_INFO_V1(pg_buffercache_evict_all);
@@ -704,6 +732,149 @@ pg_buffercache_usage_counts(PG_FUNCTION_ARGS)
 	return (Datum) 0;
 }
 
+Datum
+pg_buffercache_partitions(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Datum		values[NUM_BUFFERCACHE_PARTITIONS_ELEM];
+	bool		nulls[NUM_BUFFERCACHE_PARTITIONS_ELEM] = {0};
+	int			nparts = StrategyNumPartitions();
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	for (int i = 0; i < nparts; i++)
+	{
+		int			first_buffer;
+		int			num_buffers;
+		uint32		complete_passes;
+		uint64		num_allocs;
+
+		StrategyPartitionInfo(i, &first_buffer, &num_buffers,
+							  &complete_passes, &num_allocs);
+
+		/* report buffer IDs the same way pg_buffercache_pages() does */
+		values[0] = Int32GetDatum(i);
+		values[1] = Int32GetDatum(first_buffer + 1);
+		values[2] = Int32GetDatum(first_buffer + num_buffers);
+		values[3] = Int64GetDatum((int64) complete_passes);
+		values[4] = Int64GetDatum((int64) num_allocs);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	return (Datum) 0;
+}
+
+/*
+ * Count the buffers of each relation fork, looking at only a sample of the
+ * buffers if sample_fraction is less than 1.
+ *
+ * Rather than building a row per buffer like pg_buffercache_pages(), this
+ * aggregates as it goes, so memory use depends on the number of relations
+ * rather than on shared_buffers.  With sampling, every 1/sample_fraction'th
+ * buffer is visited, starting at a random offset, and the counts are scaled
+ * up accordingly; this makes it cheap enough to monitor cache residency
+ * frequently even with very large shared_buffers.
+ */
+Datum
+pg_buffercache_relations(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	double		sample_fraction = PG_GETARG_FLOAT8(0);
+	Datum		values[NUM_BUFFERCACHE_RELATIONS_ELEM];
+	bool		nulls[NUM_BUFFERCACHE_RELATIONS_ELEM] = {0};
+	HASHCTL		ctl;
+	HTAB	   *relations;
+	HASH_SEQ_STATUS status;
+	BufferCacheRelationEntry *entry;
+	int			step;
+	int			nsampled = 0;
+	double		scale;
+
+	if (isnan(sample_fraction) || sample_fraction <= 0.0 ||
+		sample_fraction > 1.0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("sample fraction must be greater than 0 and at most 1")));
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	ctl.keysize = sizeof(BufferCacheRelationKey);
+	ctl.entrysize = sizeof(BufferCacheRelationEntry);
+	ctl.hcxt = CurrentMemoryContext;
+	relations = hash_create("pg_buffercache relations", 1024, &ctl,
+							HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	step = (int) Min(rint(1.0 / sample_fraction), (double) NBuffers);
+	step = Max(step, 1);
+
+	for (int i = (int) pg_prng_uint64_range(&pg_global_prng_state, 0, step - 1);
+		 i < NBuffers;
+		 i += step)
+	{
+		BufferDesc *bufHdr = GetBufferDescriptor(i);
+		BufferCacheRelationKey key;
+		uint32		buf_state;
+		bool		found;
+
+		CHECK_FOR_INTERRUPTS();
+
+		nsampled++;
+
+		/*
+		 * Unlike pg_buffercache_summary(), we need the tag, so lock the
+		 * header to get a consistent one.  Skip the lock for buffers that
+		 * are obviously unused.
+		 */
+		if (!(pg_atomic_read_u32(&bufHdr->state) & BM_VALID))
+			continue;
+
+		buf_state = LockBufHdr(bufHdr);
+		if (!((buf_state & BM_VALID) && (buf_state & BM_TAG_VALID)))
+		{
+			UnlockBufHdr(bufHdr);
+			continue;
+		}
+
+		/* zero the padding, as the key is hashed as a blob */
+		memset(&key, 0, sizeof(key));
+		key.relfilenumber = BufTagGetRelNumber(&bufHdr->tag);
+		key.reltablespace = bufHdr->tag.spcOid;
+		key.reldatabase = bufHdr->tag.dbOid;
+		key.forknum = BufTagGetForkNum(&bufHdr->tag);
+		UnlockBufHdr(bufHdr);
+
+		entry = hash_search(relations, &key, HASH_ENTER, &found);
+		if (!found)
+		{
+			entry->buffers = 0;
+			entry->buffers_dirty = 0;
+		}
+		entry->buffers++;
+		if (buf_state & BM_DIRTY)
+			entry->buffers_dirty++;
+	}
+
+	scale = nsampled > 0 ? (double) NBuffers / nsampled : 0.0;
+
+	hash_seq_init(&status, relations);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		values[0] = ObjectIdGetDatum(entry->key.relfilenumber);
+		values[1] = ObjectIdGetDatum(entry->key.reltablespace);
+		values[2] = ObjectIdGetDatum(entry->key.reldatabase);
+		values[3] = Int16GetDatum(entry->key.forknum);
+		values[4] = Int64GetDatum((int64) rint(entry->buffers * scale));
+		values[5] = Int64GetDatum((int64) rint(entry->buffers_dirty * scale));
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	hash_destroy(relations);
+
+	return (Datum) 0;
+}
+
 /*
  * Helper function to check if the user has superuser privileges.
  */
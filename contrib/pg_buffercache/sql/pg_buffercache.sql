@@ -18,6 +18,26 @@ from pg_buffercache_summary();
 
 SELECT count(*) > 0 FROM pg_buffercache_usage_counts() WHERE buffers >= 0;
 
+-- The clock-sweep partitions must cover all buffers, without gaps
+select min(first_buffer) = 1,
+       sum(last_buffer - first_buffer + 1) = (select setting::bigint
+                                              from pg_settings
+                                              where name = 'shared_buffers'),
+       bool_and(last_buffer >= first_buffer),
+       bool_and(buffers_allocated >= 0)
+from pg_buffercache_partitions();
+
+-- The per-relation counts can't add up to more than the buffers
+select sum(buffers) <= (select setting::bigint
+                        from pg_settings
+                        where name = 'shared_buffers'),
+       bool_and(buffers > 0),
+       bool_and(buffers_dirty <= buffers)
+from pg_buffercache_relations();
+select count(*) > 0 from pg_buffercache_relations(0.5);
+select * from pg_buffercache_relations(0);
+select * from pg_buffercache_relations(1.5);
+
 -- Check that the functions / views can't be accessed by default. To avoid
 -- having to create a dedicated user, use the pg_database_owner pseudo-role.
 SET ROLE pg_database_owner;
@@ -26,6 +46,8 @@ SELECT * FROM pg_buffercache_os_pages;
 SELECT * FROM pg_buffercache_pages() AS p (wrong int);
 SELECT * FROM pg_buffercache_summary();
 SELECT * FROM pg_buffercache_usage_counts();
+SELECT * FROM pg_buffercache_partitions();
+SELECT * FROM pg_buffercache_relations();
 RESET role;
 
 -- Check that pg_monitor is allowed to query view / function
@@ -34,6 +56,8 @@ SELECT count(*) > 0 FROM pg_buffercache;
 SELECT count(*) > 0 FROM pg_buffercache_os_pages;
 SELECT buffers_used + buffers_unused > 0 FROM pg_buffercache_summary();
 SELECT count(*) > 0 FROM pg_buffercache_usage_counts();
+SELECT count(*) > 0 FROM pg_buffercache_partitions();
+SELECT count(*) > 0 FROM pg_buffercache_relations();
 RESET role;
 
 
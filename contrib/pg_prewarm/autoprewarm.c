@@ -16,6 +16,14 @@
  *		relevant database in turn.  The former keeps running after the
  *		initial prewarm is complete to update the dump file periodically.
  *
+ *		The list of blocks can also be sent to standbys, so that their
+ *		buffer pool follows the primary's and they don't start with a cold
+ *		cache after a failover.  On each periodic dump, the primary
+ *		WAL-logs the blocks, as ranges of consecutive blocks, using a custom
+ *		resource manager.  Replay of that record saves it to a file, which
+ *		the standby's leader worker picks up to prewarm those blocks with
+ *		the same per-database workers.
+ *
  *	Copyright (c) 2016-2025, PostgreSQL Global Development Group
  *
  *	IDENTIFICATION
@@ -30,6 +38,10 @@
 
 #include "access/relation.h"
 #include "access/xact.h"
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xloginsert.h"
+#include "access/xlogrecovery.h"
 #include "pgstat.h"
 #include "postmaster/bgworker.h"
 #include "postmaster/interrupt.h"
@@ -50,6 +62,17 @@
 #include "utils/timestamp.h"
 
 #define AUTOPREWARM_FILE "autoprewarm.blocks"
+#define AUTOPREWARM_STANDBY_FILE "autoprewarm.standby"
+
+/* How often a standby checks for a new list of blocks from the primary */
+#define AUTOPREWARM_STANDBY_POLL_MS 10000
+
+/*
+ * Custom WAL resource manager used to send the list of blocks to standbys;
+ * see https://wiki.postgresql.org/wiki/CustomWALResourceManagers
+ */
+#define RM_AUTOPREWARM_ID		139
+#define XLOG_AUTOPREWARM_BLOCKS	0x00
 
 /* Metadata for each block we dump. */
 typedef struct BlockInfoRecord
@@ -61,6 +84,30 @@ typedef struct BlockInfoRecord
 	BlockNumber blocknum;
 } BlockInfoRecord;
 
+/* A range of consecutive blocks, as WAL-logged for standbys. */
+typedef struct xl_autoprewarm_range
+{
+	Oid			database;
+	Oid			tablespace;
+	RelFileNumber filenumber;
+	ForkNumber	forknum;
+	BlockNumber blocknum;		/* first block of the range */
+	BlockNumber nblocks;		/* number of blocks in the range */
+} xl_autoprewarm_range;
+
+/* WAL record with the blocks in the primary's shared buffers. */
+typedef struct xl_autoprewarm_blocks
+{
+	int			nranges;
+	xl_autoprewarm_range ranges[FLEXIBLE_ARRAY_MEMBER];
+} xl_autoprewarm_blocks;
+
+#define SizeOfAutoPrewarmBlocks	(offsetof(xl_autoprewarm_blocks, ranges))
+
+/* Don't go beyond the maximum WAL record size, whatever shared_buffers. */
+#define MaxAutoPrewarmRanges \
+	((XLogRecordMaxSize / 2 - SizeOfAutoPrewarmBlocks) / sizeof(xl_autoprewarm_range))
+
 /* Shared state information for autoprewarm bgworker. */
 typedef struct AutoPrewarmSharedState
 {
@@ -105,19 +152,34 @@ PG_FUNCTION_INFO_V1(autoprewarm_start_worker);
 PG_FUNCTION_INFO_V1(autoprewarm_dump_now);
 
 static void apw_load_buffers(void);
-static int	apw_dump_now(bool is_bgworker, bool dump_unlogged);
+static void apw_load_standby_buffers(void);
+static void apw_prewarm_blocks(dsm_segment *seg, int num_elements);
+static int	apw_dump_now(bool is_bgworker, bool dump_unlogged, bool wal_log);
+static void apw_log_blocks(BlockInfoRecord *block_info, int num_blocks);
 static void apw_start_leader_worker(void);
 static void apw_start_database_worker(void);
 static bool apw_init_shmem(void);
 static void apw_detach_shmem(int code, Datum arg);
 static int	apw_compare_blockinfo(const void *p, const void *q);
 
+static void apw_redo(XLogReaderState *record);
+static void apw_desc(StringInfo buf, XLogReaderState *record);
+static const char *apw_identify(uint8 info);
+
+static const RmgrData apw_rmgr = {
+	.rm_name = "autoprewarm",
+	.rm_redo = apw_redo,
+	.rm_desc = apw_desc,
+	.rm_identify = apw_identify
+};
+
 /* Pointer to shared-memory state. */
 static AutoPrewarmSharedState *apw_state = NULL;
 
 /* GUC variables. */
 static bool autoprewarm = true; /* start worker? */
 static int	autoprewarm_interval = 300; /* dump interval */
+static bool autoprewarm_send_to_standbys = false;	/* WAL-log the dumps? */
 
 /*
  * Module load callback.
@@ -152,8 +214,25 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable("pg_prewarm.autoprewarm_send_to_standbys",
+							 "Sends the blocks dumped by autoprewarm to standbys.",
+							 "The standbys must also load pg_prewarm.",
+							 &autoprewarm_send_to_standbys,
+							 false,
+							 PGC_SIGHUP,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	MarkGUCPrefixReserved("pg_prewarm");
 
+	/*
+	 * Register the resource manager whether or not the worker runs, so that
+	 * a standby can always replay the records sent by its primary.
+	 */
+	RegisterCustomRmgr(RM_AUTOPREWARM_ID, &apw_rmgr);
+
 	/* Register autoprewarm worker, if enabled. */
 	if (autoprewarm)
 		apw_start_leader_worker();
@@ -226,9 +305,15 @@ autoprewarm_main(Datum main_arg)
 		last_dump_time = GetCurrentTimestamp();
 	}
 
-	/* Periodically dump buffers until terminated. */
+	/*
+	 * Periodically dump buffers until terminated.  On a standby, also prewarm
+	 * the blocks sent by the primary whenever a new list arrives.
+	 */
 	while (!ShutdownRequestPending)
 	{
+		bool		in_recovery;
+		long		delay_in_ms = -1L;
+
 		/* In case of a SIGHUP, just reload the configuration. */
 		if (ConfigReloadPending)
 		{
@@ -236,18 +321,18 @@ autoprewarm_main(Datum main_arg)
 			ProcessConfigFile(PGC_SIGHUP);
 		}
 
-		if (autoprewarm_interval <= 0)
+		in_recovery = RecoveryInProgress();
+		if (in_recovery)
 		{
-			/* We're only dumping at shutdown, so just wait forever. */
-			(void) WaitLatch(MyLatch,
-							 WL_LATCH_SET | WL_EXIT_ON_PM_DEATH,
-							 -1L,
-							 PG_WAIT_EXTENSION);
+			apw_load_standby_buffers();
+			if (ShutdownRequestPending)
+				break;
 		}
-		else
+
+		/* If the interval is zero, we're only dumping at shutdown. */
+		if (autoprewarm_interval > 0)
 		{
 			TimestampTz next_dump_time;
-			long		delay_in_ms;
 
 			/* Compute the next dump time. */
 			next_dump_time =
@@ -261,17 +346,25 @@ autoprewarm_main(Datum main_arg)
 			if (delay_in_ms <= 0)
 			{
 				last_dump_time = GetCurrentTimestamp();
-				apw_dump_now(true, false);
+				apw_dump_now(true, false,
+							 autoprewarm_send_to_standbys && !in_recovery &&
+							 XLogStandbyInfoActive());
 				continue;
 			}
-
-			/* Sleep until the next dump time. */
-			(void) WaitLatch(MyLatch,
-							 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
-							 delay_in_ms,
-							 PG_WAIT_EXTENSION);
 		}
 
+		/* A standby must wake up to check for the primary's blocks. */
+		if (in_recovery &&
+			(delay_in_ms < 0 || delay_in_ms > AUTOPREWARM_STANDBY_POLL_MS))
+			delay_in_ms = AUTOPREWARM_STANDBY_POLL_MS;
+
+		/* Sleep until the next dump time, or forever. */
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_EXIT_ON_PM_DEATH |
+						 (delay_in_ms >= 0 ? WL_TIMEOUT : 0),
+						 delay_in_ms,
+						 PG_WAIT_EXTENSION);
+
 		/* Reset the latch, loop. */
 		ResetLatch(MyLatch);
 	}
@@ -281,7 +374,7 @@ autoprewarm_main(Datum main_arg)
 	 * shutdown, although it's possible that we've merely been terminated.
 	 */
 	if (final_dump_allowed)
-		apw_dump_now(true, true);
+		apw_dump_now(true, true, false);
 }
 
 /*
@@ -365,11 +458,6 @@ apw_load_buffers(void)
 	qsort(blkinfo, num_elements, sizeof(BlockInfoRecord),
 		  apw_compare_blockinfo);
 
-	/* Populate shared memory state. */
-	apw_state->block_info_handle = dsm_segment_handle(seg);
-	apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx = 0;
-	apw_state->prewarmed_blocks = 0;
-
 	/* Don't prewarm more than we can fit. */
 	if (num_elements > NBuffers)
 	{
@@ -379,6 +467,36 @@ apw_load_buffers(void)
 						NBuffers)));
 	}
 
+	apw_prewarm_blocks(seg, num_elements);
+
+	/* Clean up. */
+	dsm_detach(seg);
+	LWLockAcquire(&apw_state->lock, LW_EXCLUSIVE);
+	apw_state->block_info_handle = DSM_HANDLE_INVALID;
+	apw_state->pid_using_dumpfile = InvalidPid;
+	LWLockRelease(&apw_state->lock);
+
+	/* Report our success, if we were able to finish. */
+	if (!ShutdownRequestPending)
+		ereport(LOG,
+				(errmsg("autoprewarm successfully prewarmed %d of %d previously-loaded blocks",
+						apw_state->prewarmed_blocks, num_elements)));
+}
+
+/*
+ * Prewarm the blocks of the first num_elements sorted BlockInfoRecords in
+ * the given segment, launching per-database workers one at a time.
+ */
+static void
+apw_prewarm_blocks(dsm_segment *seg, int num_elements)
+{
+	BlockInfoRecord *blkinfo = (BlockInfoRecord *) dsm_segment_address(seg);
+
+	/* Populate shared memory state. */
+	apw_state->block_info_handle = dsm_segment_handle(seg);
+	apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx = 0;
+	apw_state->prewarmed_blocks = 0;
+
 	/* Get the info position of the first block of the next database. */
 	while (apw_state->prewarm_start_idx < num_elements)
 	{
@@ -435,19 +553,106 @@ apw_load_buffers(void)
 		/* Prepare for next database. */
 		apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx;
 	}
+}
+
+/*
+ * On a standby, prewarm the blocks last sent by the primary, if a list has
+ * arrived since the last call.
+ *
+ * Replay may save a new list at any time, so the file is first renamed out
+ * of its way.  Blocks already in shared buffers are cheap to skip, so this
+ * only reads the blocks that the primary caches and we don't.
+ */
+static void
+apw_load_standby_buffers(void)
+{
+	char		path[MAXPGPATH];
+	FILE	   *file;
+	int			nranges;
+	xl_autoprewarm_range *ranges = NULL;
+	bool		corrupted = false;
+	int64		num_elements = 0;
+	int			i,
+				n;
+	BlockInfoRecord *blkinfo;
+	dsm_segment *seg;
+
+	snprintf(path, MAXPGPATH, "%s.loading", AUTOPREWARM_STANDBY_FILE);
+	if (rename(AUTOPREWARM_STANDBY_FILE, path) != 0)
+	{
+		if (errno == ENOENT)
+			return;				/* Nothing new from the primary. */
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not rename file \"%s\" to \"%s\": %m",
+						AUTOPREWARM_STANDBY_FILE, path)));
+	}
+
+	file = AllocateFile(path, PG_BINARY_R);
+	if (!file)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", path)));
+
+	if (fread(&nranges, sizeof(nranges), 1, file) != 1 ||
+		nranges < 0 || nranges > MaxAutoPrewarmRanges)
+		corrupted = true;
+	else
+	{
+		ranges = (xl_autoprewarm_range *)
+			palloc_extended(sizeof(xl_autoprewarm_range) * Max(nranges, 1),
+							MCXT_ALLOC_HUGE);
+		if (fread(ranges, sizeof(xl_autoprewarm_range), nranges, file) != nranges)
+			corrupted = true;
+	}
+
+	FreeFile(file);
+	unlink(path);
+
+	if (corrupted)
+	{
+		ereport(LOG,
+				(errmsg("autoprewarm block list received from the primary is corrupted")));
+		return;
+	}
+
+	/* Don't prewarm more than we can fit. */
+	for (i = 0; i < nranges; i++)
+		num_elements += ranges[i].nblocks;
+	if (num_elements > NBuffers)
+		num_elements = NBuffers;
+	if (num_elements == 0)
+	{
+		pfree(ranges);
+		return;
+	}
+
+	/* Expand the ranges, which the primary sorted, into the segment. */
+	seg = dsm_create(sizeof(BlockInfoRecord) * num_elements, 0);
+	blkinfo = (BlockInfoRecord *) dsm_segment_address(seg);
+	n = 0;
+	for (i = 0; i < nranges && n < num_elements; i++)
+	{
+		for (BlockNumber j = 0; j < ranges[i].nblocks && n < num_elements; j++)
+		{
+			blkinfo[n].database = ranges[i].database;
+			blkinfo[n].tablespace = ranges[i].tablespace;
+			blkinfo[n].filenumber = ranges[i].filenumber;
+			blkinfo[n].forknum = ranges[i].forknum;
+			blkinfo[n].blocknum = ranges[i].blocknum + j;
+			n++;
+		}
+	}
+	pfree(ranges);
+
+	apw_prewarm_blocks(seg, n);
 
-	/* Clean up. */
 	dsm_detach(seg);
-	LWLockAcquire(&apw_state->lock, LW_EXCLUSIVE);
 	apw_state->block_info_handle = DSM_HANDLE_INVALID;
-	apw_state->pid_using_dumpfile = InvalidPid;
-	LWLockRelease(&apw_state->lock);
 
-	/* Report our success, if we were able to finish. */
-	if (!ShutdownRequestPending)
-		ereport(LOG,
-				(errmsg("autoprewarm successfully prewarmed %d of %d previously-loaded blocks",
-						apw_state->prewarmed_blocks, num_elements)));
+	ereport(DEBUG1,
+			(errmsg_internal("autoprewarm prewarmed %d of %d blocks sent by the primary",
+							 apw_state->prewarmed_blocks, n)));
 }
 
 /*
@@ -658,10 +863,11 @@ autoprewarm_database_main(Datum main_arg)
  * Dump information on blocks in shared buffers.  We use a text format here
  * so that it's easy to understand and even change the file contents if
  * necessary.
+ * If wal_log is true, the blocks are also WAL-logged for standbys.
  * Returns the number of blocks dumped.
  */
 static int
-apw_dump_now(bool is_bgworker, bool dump_unlogged)
+apw_dump_now(bool is_bgworker, bool dump_unlogged, bool wal_log)
 {
 	int			num_blocks;
 	int			i;
@@ -779,6 +985,9 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 		}
 	}
 
+	if (wal_log)
+		apw_log_blocks(block_info_array, num_blocks);
+
 	pfree(block_info_array);
 
 	/*
@@ -806,6 +1015,159 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 	return num_blocks;
 }
 
+/*
+ * WAL-log the given blocks for standbys, merging consecutive blocks into
+ * ranges.  This sorts the array.
+ */
+static void
+apw_log_blocks(BlockInfoRecord *block_info, int num_blocks)
+{
+	xl_autoprewarm_range *ranges;
+	int			nranges = 0;
+	int			i;
+
+	qsort(block_info, num_blocks, sizeof(BlockInfoRecord),
+		  apw_compare_blockinfo);
+
+	ranges = (xl_autoprewarm_range *)
+		palloc_extended(sizeof(xl_autoprewarm_range) * Max(num_blocks, 1),
+						MCXT_ALLOC_HUGE);
+
+	for (i = 0; i < num_blocks; i++)
+	{
+		BlockInfoRecord *blk = &block_info[i];
+		xl_autoprewarm_range *last = nranges > 0 ? &ranges[nranges - 1] : NULL;
+
+		if (last != NULL &&
+			last->database == blk->database &&
+			last->tablespace == blk->tablespace &&
+			last->filenumber == blk->filenumber &&
+			last->forknum == blk->forknum &&
+			last->blocknum + last->nblocks == blk->blocknum)
+		{
+			last->nblocks++;
+			continue;
+		}
+
+		if (nranges >= MaxAutoPrewarmRanges)
+			break;
+
+		ranges[nranges].database = blk->database;
+		ranges[nranges].tablespace = blk->tablespace;
+		ranges[nranges].filenumber = blk->filenumber;
+		ranges[nranges].forknum = blk->forknum;
+		ranges[nranges].blocknum = blk->blocknum;
+		ranges[nranges].nblocks = 1;
+		nranges++;
+	}
+
+	XLogBeginInsert();
+	XLogRegisterData(&nranges, SizeOfAutoPrewarmBlocks);
+	XLogRegisterData(ranges, sizeof(xl_autoprewarm_range) * nranges);
+
+	/* This doesn't need to force a checkpoint or WAL switch. */
+	XLogSetRecordFlags(XLOG_MARK_UNIMPORTANT);
+
+	(void) XLogInsert(RM_AUTOPREWARM_ID, XLOG_AUTOPREWARM_BLOCKS);
+
+	pfree(ranges);
+}
+
+/*
+ * Replay the list of blocks sent by the primary, by saving it for our
+ * leader worker.
+ *
+ * This runs in the startup process, where an ERROR would bring the standby
+ * down; since losing a list only means prewarming less, failures are merely
+ * logged.
+ */
+static void
+apw_redo(XLogReaderState *record)
+{
+	uint8		info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
+	char	   *data = XLogRecGetData(record);
+	int			len = XLogRecGetDataLen(record);
+	char		tmppath[MAXPGPATH];
+	int			fd;
+
+	if (info != XLOG_AUTOPREWARM_BLOCKS)
+		elog(PANIC, "apw_redo: unknown op code %u", info);
+
+	/* Nobody would use the list after crash recovery or without a worker. */
+	if (!StandbyMode || !autoprewarm)
+		return;
+
+	snprintf(tmppath, MAXPGPATH, "%s.tmp", AUTOPREWARM_STANDBY_FILE);
+	fd = OpenTransientFile(tmppath, O_WRONLY | O_CREAT | O_TRUNC | PG_BINARY);
+	if (fd < 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not create file \"%s\": %m", tmppath)));
+		return;
+	}
+
+	errno = 0;
+	if (write(fd, data, len) != len)
+	{
+		/* if write didn't set errno, assume problem is no disk space */
+		if (errno == 0)
+			errno = ENOSPC;
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not write to file \"%s\": %m", tmppath)));
+		CloseTransientFile(fd);
+		unlink(tmppath);
+		return;
+	}
+
+	if (CloseTransientFile(fd) != 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m", tmppath)));
+		unlink(tmppath);
+		return;
+	}
+
+	if (rename(tmppath, AUTOPREWARM_STANDBY_FILE) != 0)
+	{
+		ereport(LOG,
+				(errcode_for_file_access(),
+				 errmsg("could not rename file \"%s\" to \"%s\": %m",
+						tmppath, AUTOPREWARM_STANDBY_FILE)));
+		unlink(tmppath);
+	}
+}
+
+static void
+apw_desc(StringInfo buf, XLogReaderState *record)
+{
+	char	   *rec = XLogRecGetData(record);
+	uint8		info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
+
+	if (info == XLOG_AUTOPREWARM_BLOCKS)
+	{
+		xl_autoprewarm_blocks *xlrec = (xl_autoprewarm_blocks *) rec;
+		int64		nblocks = 0;
+
+		for (int i = 0; i < xlrec->nranges; i++)
+			nblocks += xlrec->ranges[i].nblocks;
+
+		appendStringInfo(buf, "nranges %d; nblocks " INT64_FORMAT,
+						 xlrec->nranges, nblocks);
+	}
+}
+
+static const char *
+apw_identify(uint8 info)
+{
+	if ((info & ~XLR_INFO_MASK) == XLOG_AUTOPREWARM_BLOCKS)
+		return "BLOCKS";
+
+	return NULL;
+}
+
 /*
  * SQL-callable function to launch autoprewarm.
  */
@@ -850,7 +1212,7 @@ autoprewarm_dump_now(PG_FUNCTION_ARGS)
 
 	PG_ENSURE_ERROR_CLEANUP(apw_detach_shmem, 0);
 	{
-		num_blocks = apw_dump_now(false, true);
+		num_blocks = apw_dump_now(false, true, false);
 	}
 	PG_END_ENSURE_ERROR_CLEANUP(apw_detach_shmem, 0);
 
@@ -0,0 +1,46 @@
+
+# Copyright (c) 2025, PostgreSQL Global Development Group
+
+# Test that autoprewarm sends the blocks cached by the primary to a standby
+use strict;
+use warnings FATAL => 'all';
+
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $primary = PostgreSQL::Test::Cluster->new('primary');
+$primary->init(allows_streaming => 1);
+$primary->append_conf(
+	'postgresql.conf',
+	qq{shared_preload_libraries = 'pg_prewarm'
+    pg_prewarm.autoprewarm_interval = 0
+    pg_prewarm.autoprewarm_send_to_standbys = on});
+$primary->start;
+
+$primary->safe_psql("postgres",
+		"CREATE TABLE test(c1 int);\n"
+	  . "INSERT INTO test SELECT generate_series(1, 10000);");
+
+my $backup_name = 'my_backup';
+$primary->backup($backup_name);
+
+my $standby = PostgreSQL::Test::Cluster->new('standby');
+$standby->init_from_backup($primary, $backup_name, has_streaming => 1);
+$standby->append_conf('postgresql.conf', 'log_min_messages = debug1');
+$standby->start;
+
+# Dump periodically from now on, which sends the blocks to the standby.
+$primary->append_conf('postgresql.conf',
+	'pg_prewarm.autoprewarm_interval = 1s');
+$primary->reload;
+
+$standby->wait_for_log(
+	"autoprewarm prewarmed [1-9][0-9]* of [1-9][0-9]* blocks sent by the primary"
+);
+ok(1, 'standby prewarmed the blocks sent by the primary');
+
+$standby->stop;
+$primary->stop;
+
+done_testing();
@@ -33,6 +33,13 @@
  * requires holding pgss->lock exclusively; this allows individual entries
  * in the file to be read or written while holding only shared lock.
  *
+ * If pg_stat_statements.flush_interval is set, each backend accumulates the
+ * counters of the statements it executes in a local hashtable, and merges
+ * them into the shared entries at most once per interval, taking the lock
+ * once for all of them.  A statement found in the local hashtable needs no
+ * access to shared memory at all, so frequently repeated statements don't
+ * contend on pgss->lock or on their entry's spinlock.
+ *
  *
  * Copyright (c) 2008-2025, PostgreSQL Global Development Group
  *
@@ -86,7 +93,7 @@ PG_MODULE_MAGIC_EXT(
 #define PGSS_TEXT_FILE	PG_STAT_TMP_DIR "/pgss_query_texts.stat"
 
 /* Magic number identifying the stats file format */
-static const uint32 PGSS_FILE_HEADER = 0x20250731;
+static const uint32 PGSS_FILE_HEADER = 0x20251015;
 
 /* PostgreSQL major version number, changes in which invalidate all entries */
 static const uint32 PGSS_PG_MAJOR_VERSION = PG_VERSION_NUM / 100;
@@ -99,6 +106,10 @@ static const uint32 PGSS_PG_MAJOR_VERSION = PG_VERSION_NUM / 100;
 #define USAGE_DECREASE_FACTOR	(0.99)	/* decreased every entry_dealloc */
 #define STICKY_DECREASE_FACTOR	(0.50)	/* factor for sticky entries */
 #define USAGE_DEALLOC_PERCENT	5	/* free this % of entries at once */
+#define USAGE_HIST_MIN_EXP		(-32)	/* smallest usage histogram octave */
+#define USAGE_HIST_SUBBUCKETS	4	/* usage histogram buckets per octave */
+#define USAGE_HIST_BUCKETS		256 /* # of usage histogram buckets */
+#define PGSS_MAX_PENDING		1024	/* flush local counters beyond this */
 #define IS_STICKY(c)	((c.calls[PGSS_PLAN] + c.calls[PGSS_EXEC]) == 0)
 
 /*
@@ -116,6 +127,7 @@ typedef enum pgssVersion
 	PGSS_V1_11,
 	PGSS_V1_12,
 	PGSS_V1_13,
+	PGSS_V1_14,
 } pgssVersion;
 
 typedef enum pgssStoreKind
@@ -146,6 +158,7 @@ typedef struct pgssHashKey
 	Oid			userid;			/* user OID */
 	Oid			dbid;			/* database OID */
 	int64		queryid;		/* query identifier */
+	int64		planid;			/* plan identifier, if tracking plans */
 	bool		toplevel;		/* query executed at top level */
 } pgssHashKey;
 
@@ -215,6 +228,15 @@ typedef struct Counters
 	int64		custom_plan_calls;	/* number of calls using a custom plan */
 } Counters;
 
+/*
+ * Counters accumulated locally for an entry, when flush_interval is set
+ */
+typedef struct pgssPendingEntry
+{
+	pgssHashKey key;			/* hash key of entry - MUST BE FIRST */
+	Counters	counters;		/* statistics not yet merged into the entry */
+} pgssPendingEntry;
+
 /*
  * Global statistics for pg_stat_statements
  */
@@ -278,6 +300,10 @@ static ProcessUtility_hook_type prev_ProcessUtility = NULL;
 static pgssSharedState *pgss = NULL;
 static HTAB *pgss_hash = NULL;
 
+/* Counters not yet merged into the shared entries, and when we last did */
+static HTAB *pgss_pending_hash = NULL;
+static TimestampTz pgss_last_flush = 0;
+
 /*---- GUC variables ----*/
 
 typedef enum
@@ -301,6 +327,10 @@ static bool pgss_track_utility = true;	/* whether to track utility commands */
 static bool pgss_track_planning = false;	/* whether to track planning
 											 * duration */
 static bool pgss_save = true;	/* whether to save stats across shutdown */
+static int	pgss_flush_interval = 0;	/* how long to accumulate counters
+										 * locally, in msec */
+static bool pgss_track_plans = false;	/* whether to keep separate
+										 * statistics per plan */
 
 #define pgss_enabled(level) \
 	(!IsParallelWorker() && \
@@ -327,6 +357,7 @@ PG_FUNCTION_INFO_V1(pg_stat_statements_1_10);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_11);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_12);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_13);
+PG_FUNCTION_INFO_V1(pg_stat_statements_1_14);
 PG_FUNCTION_INFO_V1(pg_stat_statements);
 PG_FUNCTION_INFO_V1(pg_stat_statements_info);
 
@@ -335,6 +366,7 @@ static void pgss_shmem_startup(void);
 static void pgss_shmem_shutdown(int code, Datum arg);
 static void pgss_post_parse_analyze(ParseState *pstate, Query *query,
 									JumbleState *jstate);
+static void pgss_set_plan_id(Query *parse, PlannedStmt *result);
 static PlannedStmt *pgss_planner(Query *parse,
 								 const char *query_string,
 								 int cursorOptions,
@@ -351,7 +383,7 @@ static void pgss_ProcessUtility(PlannedStmt *pstmt, const char *queryString,
 								ProcessUtilityContext context, ParamListInfo params,
 								QueryEnvironment *queryEnv,
 								DestReceiver *dest, QueryCompletion *qc);
-static void pgss_store(const char *query, int64 queryId,
+static void pgss_store(const char *query, int64 queryId, int64 planId,
 					   int query_location, int query_len,
 					   pgssStoreKind kind,
 					   double total_time, uint64 rows,
@@ -362,6 +394,17 @@ static void pgss_store(const char *query, int64 queryId,
 					   int parallel_workers_to_launch,
 					   int parallel_workers_launched,
 					   PlannedStmtOrigin planOrigin);
+static void counters_accum(Counters *counters, pgssStoreKind kind,
+						   double total_time, uint64 rows,
+						   const BufferUsage *bufusage,
+						   const WalUsage *walusage,
+						   const struct JitInstrumentation *jitusage,
+						   int parallel_workers_to_launch,
+						   int parallel_workers_launched,
+						   PlannedStmtOrigin planOrigin);
+static void counters_merge(Counters *dst, const Counters *src);
+static void pgss_flush_pending(void);
+static void pgss_flush_at_exit(int code, Datum arg);
 static void pg_stat_statements_internal(FunctionCallInfo fcinfo,
 										pgssVersion api_version,
 										bool showtext);
@@ -457,6 +500,17 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable("pg_stat_statements.track_plans",
+							 "Selects whether pg_stat_statements keeps separate statistics for each plan of a statement.",
+							 NULL,
+							 &pgss_track_plans,
+							 false,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
 	DefineCustomBoolVariable("pg_stat_statements.save",
 							 "Save pg_stat_statements statistics across server shutdowns.",
 							 NULL,
@@ -468,6 +522,19 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomIntVariable("pg_stat_statements.flush_interval",
+							"Sets how long each backend accumulates statistics before adding them to pg_stat_statements.",
+							"0 adds the statistics of each statement as soon as it completes.",
+							&pgss_flush_interval,
+							0,
+							0,
+							INT_MAX / 1000,
+							PGC_SUSET,
+							GUC_UNIT_MS,
+							NULL,
+							NULL,
+							NULL);
+
 	MarkGUCPrefixReserved("pg_stat_statements");
 
 	/*
@@ -873,6 +940,7 @@ pgss_post_parse_analyze(ParseState *pstate, Query *query, JumbleState *jstate)
 	if (jstate && jstate->clocations_count > 0)
 		pgss_store(pstate->p_sourcetext,
 				   query->queryId,
+				   INT64CONST(0),
 				   query->stmt_location,
 				   query->stmt_len,
 				   PGSS_INVALID,
@@ -887,6 +955,20 @@ pgss_post_parse_analyze(ParseState *pstate, Query *query, JumbleState *jstate)
 				   PLAN_STMT_UNKNOWN);
 }
 
+/*
+ * Compute the plan identifier of a new plan, if we're tracking plans and no
+ * other module has done so.  planner() reports it to pg_stat_activity, and
+ * it is kept with the plan, so that pgss_ExecutorEnd() finds it.
+ */
+static void
+pgss_set_plan_id(Query *parse, PlannedStmt *result)
+{
+	if (pgss_track_plans && pgss_enabled(nesting_level) &&
+		parse->queryId != INT64CONST(0) &&
+		result->planId == INT64CONST(0))
+		result->planId = JumblePlan(result);
+}
+
 /*
  * Planner hook: forward to regular planner, but measure planning time
  * if needed.
@@ -942,6 +1024,8 @@ pgss_planner(Query *parse,
 		}
 		PG_END_TRY();
 
+		pgss_set_plan_id(parse, result);
+
 		INSTR_TIME_SET_CURRENT(duration);
 		INSTR_TIME_SUBTRACT(duration, start);
 
@@ -955,6 +1039,7 @@ pgss_planner(Query *parse,
 
 		pgss_store(query_string,
 				   parse->queryId,
+				   result->planId,
 				   parse->stmt_location,
 				   parse->stmt_len,
 				   PGSS_PLAN,
@@ -990,6 +1075,8 @@ pgss_planner(Query *parse,
 			nesting_level--;
 		}
 		PG_END_TRY();
+
+		pgss_set_plan_id(parse, result);
 	}
 
 	return result;
@@ -1090,6 +1177,7 @@ pgss_ExecutorEnd(QueryDesc *queryDesc)
 
 		pgss_store(queryDesc->sourceText,
 				   queryId,
+				   queryDesc->plannedstmt->planId,
 				   queryDesc->plannedstmt->stmt_location,
 				   queryDesc->plannedstmt->stmt_len,
 				   PGSS_EXEC,
@@ -1224,6 +1312,7 @@ pgss_ProcessUtility(PlannedStmt *pstmt, const char *queryString,
 
 		pgss_store(queryString,
 				   saved_queryId,
+				   INT64CONST(0),
 				   saved_stmt_location,
 				   saved_stmt_len,
 				   PGSS_EXEC,
@@ -1287,9 +1376,14 @@ pgss_ProcessUtility(PlannedStmt *pstmt, const char *queryString,
  *
  * If kind is PGSS_PLAN or PGSS_EXEC, its value is used as the array position
  * for the arrays in the Counters field.
+ *
+ * If flush_interval is set, the counters are accumulated locally, and only
+ * merged into the shared entry by pgss_flush_pending().  The shared entry is
+ * created the first time the statement is seen, so that the query text is
+ * stored; after that, we don't look at shared memory until the next flush.
  */
 static void
-pgss_store(const char *query, int64 queryId,
+pgss_store(const char *query, int64 queryId, int64 planId,
 		   int query_location, int query_len,
 		   pgssStoreKind kind,
 		   double total_time, uint64 rows,
@@ -1303,8 +1397,10 @@ pgss_store(const char *query, int64 queryId,
 {
 	pgssHashKey key;
 	pgssEntry  *entry;
+	pgssPendingEntry *pending;
 	char	   *norm_query = NULL;
 	int			encoding = GetDatabaseEncoding();
+	bool		batch = false;
 
 	Assert(query != NULL);
 
@@ -1334,8 +1430,33 @@ pgss_store(const char *query, int64 queryId,
 	key.userid = GetUserId();
 	key.dbid = MyDatabaseId;
 	key.queryid = queryId;
+	key.planid = pgss_track_plans ? planId : INT64CONST(0);
 	key.toplevel = (nesting_level == 0);
 
+	if (pgss_flush_interval > 0)
+	{
+		/* If we've seen the statement since the last flush, stay local */
+		pending = pgss_pending_hash == NULL ? NULL :
+			hash_search(pgss_pending_hash, &key, HASH_FIND, NULL);
+		if (pending)
+		{
+			if (!jstate)
+			{
+				Assert(kind == PGSS_PLAN || kind == PGSS_EXEC);
+				counters_accum(&pending->counters, kind, total_time, rows,
+							   bufusage, walusage, jitusage,
+							   parallel_workers_to_launch,
+							   parallel_workers_launched, planOrigin);
+			}
+			goto flush;
+		}
+	}
+	else if (pgss_pending_hash != NULL)
+	{
+		/* flush_interval was just turned off; don't leave anything behind */
+		pgss_flush_pending();
+	}
+
 	/* Lookup the hash table entry with shared lock. */
 	LWLockAcquire(pgss->lock, LW_SHARED);
 
@@ -1348,6 +1469,23 @@ pgss_store(const char *query, int64 queryId,
 		int			gc_count;
 		bool		stored;
 		bool		do_gc;
+		pgssEntry  *sibling = NULL;
+		pgssHashKey sibling_key;
+
+		/*
+		 * The entry for a new plan can share the query text of the
+		 * statement's entry without a plan identifier, which
+		 * pgss_post_parse_analyze() creates with the normalized text.
+		 */
+		if (key.planid != INT64CONST(0) && !jstate)
+		{
+			sibling_key = key;
+			sibling_key.planid = INT64CONST(0);
+			sibling = (pgssEntry *) hash_search(pgss_hash, &sibling_key,
+												HASH_FIND, NULL);
+			if (sibling && sibling->query_len < 0)
+				sibling = NULL;
+		}
 
 		/*
 		 * Create a new, normalized query string if caller asked.  We don't
@@ -1366,8 +1504,11 @@ pgss_store(const char *query, int64 queryId,
 		}
 
 		/* Append new query text to file with only shared lock held */
-		stored = qtext_store(norm_query ? norm_query : query, query_len,
-							 &query_offset, &gc_count);
+		if (sibling)
+			stored = false;
+		else
+			stored = qtext_store(norm_query ? norm_query : query, query_len,
+								 &query_offset, &gc_count);
 
 		/*
 		 * Determine whether we need to garbage collect external query texts
@@ -1380,6 +1521,24 @@ pgss_store(const char *query, int64 queryId,
 		LWLockRelease(pgss->lock);
 		LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
 
+		/*
+		 * The sibling may have been removed, or its text moved, in the
+		 * meantime, so look again.
+		 */
+		if (sibling)
+		{
+			sibling = (pgssEntry *) hash_search(pgss_hash, &sibling_key,
+												HASH_FIND, NULL);
+			if (sibling && sibling->query_len >= 0)
+			{
+				query_offset = sibling->query_offset;
+				query_len = sibling->query_len;
+				encoding = sibling->encoding;
+				stored = true;
+				gc_count = pgss->gc_count;
+			}
+		}
+
 		/*
 		 * A garbage collection may have occurred while we weren't holding the
 		 * lock.  In the unlikely event that this happens, the query text we
@@ -1405,7 +1564,9 @@ pgss_store(const char *query, int64 queryId,
 	}
 
 	/* Increment the counts, except when jstate is not NULL */
-	if (!jstate)
+	if (pgss_flush_interval > 0)
+		batch = true;
+	else if (!jstate)
 	{
 		Assert(kind == PGSS_PLAN || kind == PGSS_EXEC);
 
@@ -1419,109 +1580,304 @@ pgss_store(const char *query, int64 queryId,
 		if (IS_STICKY(entry->counters))
 			entry->counters.usage = USAGE_INIT;
 
-		entry->counters.calls[kind] += 1;
-		entry->counters.total_time[kind] += total_time;
+		counters_accum(&entry->counters, kind, total_time, rows,
+					   bufusage, walusage, jitusage,
+					   parallel_workers_to_launch,
+					   parallel_workers_launched, planOrigin);
+
+		SpinLockRelease(&entry->mutex);
+	}
+
+done:
+	LWLockRelease(pgss->lock);
+
+	/* We postpone this clean-up until we're out of the lock */
+	if (norm_query)
+		pfree(norm_query);
+
+	if (!batch)
+		return;
+
+	/* Start accumulating the counters locally */
+	if (pgss_pending_hash == NULL)
+	{
+		HASHCTL		ctl;
+
+		ctl.keysize = sizeof(pgssHashKey);
+		ctl.entrysize = sizeof(pgssPendingEntry);
+		ctl.hcxt = TopMemoryContext;
+		pgss_pending_hash = hash_create("pg_stat_statements pending counters",
+										64, &ctl,
+										HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+		pgss_last_flush = GetCurrentStatementStartTimestamp();
+		before_shmem_exit(pgss_flush_at_exit, (Datum) 0);
+	}
+
+	pending = hash_search(pgss_pending_hash, &key, HASH_ENTER, NULL);
+	memset(&pending->counters, 0, sizeof(Counters));
+	if (!jstate)
+	{
+		Assert(kind == PGSS_PLAN || kind == PGSS_EXEC);
+		counters_accum(&pending->counters, kind, total_time, rows,
+					   bufusage, walusage, jitusage,
+					   parallel_workers_to_launch,
+					   parallel_workers_launched, planOrigin);
+	}
+
+flush:
+	if (hash_get_num_entries(pgss_pending_hash) >= PGSS_MAX_PENDING ||
+		TimestampDifferenceExceeds(pgss_last_flush,
+								   GetCurrentStatementStartTimestamp(),
+								   pgss_flush_interval))
+		pgss_flush_pending();
+}
+
+/*
+ * Add the statistics of one planning or execution of a statement to a set of
+ * counters.
+ */
+static void
+counters_accum(Counters *counters, pgssStoreKind kind,
+			   double total_time, uint64 rows,
+			   const BufferUsage *bufusage,
+			   const WalUsage *walusage,
+			   const struct JitInstrumentation *jitusage,
+			   int parallel_workers_to_launch,
+			   int parallel_workers_launched,
+			   PlannedStmtOrigin planOrigin)
+{
+	counters->calls[kind] += 1;
+	counters->total_time[kind] += total_time;
+
+	if (counters->calls[kind] == 1)
+	{
+		counters->min_time[kind] = total_time;
+		counters->max_time[kind] = total_time;
+		counters->mean_time[kind] = total_time;
+	}
+	else
+	{
+		/*
+		 * Welford's method for accurately computing variance. See
+		 * <http://www.johndcook.com/blog/standard_deviation/>
+		 */
+		double		old_mean = counters->mean_time[kind];
 
-		if (entry->counters.calls[kind] == 1)
+		counters->mean_time[kind] +=
+			(total_time - old_mean) / counters->calls[kind];
+		counters->sum_var_time[kind] +=
+			(total_time - old_mean) * (total_time - counters->mean_time[kind]);
+
+		/*
+		 * Calculate min and max time. min = 0 and max = 0 means that the
+		 * min/max statistics were reset
+		 */
+		if (counters->min_time[kind] == 0
+			&& counters->max_time[kind] == 0)
 		{
-			entry->counters.min_time[kind] = total_time;
-			entry->counters.max_time[kind] = total_time;
-			entry->counters.mean_time[kind] = total_time;
+			counters->min_time[kind] = total_time;
+			counters->max_time[kind] = total_time;
 		}
 		else
 		{
-			/*
-			 * Welford's method for accurately computing variance. See
-			 * <http://www.johndcook.com/blog/standard_deviation/>
-			 */
-			double		old_mean = entry->counters.mean_time[kind];
+			if (counters->min_time[kind] > total_time)
+				counters->min_time[kind] = total_time;
+			if (counters->max_time[kind] < total_time)
+				counters->max_time[kind] = total_time;
+		}
+	}
+	counters->rows += rows;
+	counters->shared_blks_hit += bufusage->shared_blks_hit;
+	counters->shared_blks_read += bufusage->shared_blks_read;
+	counters->shared_blks_dirtied += bufusage->shared_blks_dirtied;
+	counters->shared_blks_written += bufusage->shared_blks_written;
+	counters->local_blks_hit += bufusage->local_blks_hit;
+	counters->local_blks_read += bufusage->local_blks_read;
+	counters->local_blks_dirtied += bufusage->local_blks_dirtied;
+	counters->local_blks_written += bufusage->local_blks_written;
+	counters->temp_blks_read += bufusage->temp_blks_read;
+	counters->temp_blks_written += bufusage->temp_blks_written;
+	counters->shared_blk_read_time += INSTR_TIME_GET_MILLISEC(bufusage->shared_blk_read_time);
+	counters->shared_blk_write_time += INSTR_TIME_GET_MILLISEC(bufusage->shared_blk_write_time);
+	counters->local_blk_read_time += INSTR_TIME_GET_MILLISEC(bufusage->local_blk_read_time);
+	counters->local_blk_write_time += INSTR_TIME_GET_MILLISEC(bufusage->local_blk_write_time);
+	counters->temp_blk_read_time += INSTR_TIME_GET_MILLISEC(bufusage->temp_blk_read_time);
+	counters->temp_blk_write_time += INSTR_TIME_GET_MILLISEC(bufusage->temp_blk_write_time);
+	counters->usage += USAGE_EXEC(total_time);
+	counters->wal_records += walusage->wal_records;
+	counters->wal_fpi += walusage->wal_fpi;
+	counters->wal_bytes += walusage->wal_bytes;
+	counters->wal_buffers_full += walusage->wal_buffers_full;
+	if (jitusage)
+	{
+		counters->jit_functions += jitusage->created_functions;
+		counters->jit_generation_time += INSTR_TIME_GET_MILLISEC(jitusage->generation_counter);
 
-			entry->counters.mean_time[kind] +=
-				(total_time - old_mean) / entry->counters.calls[kind];
-			entry->counters.sum_var_time[kind] +=
-				(total_time - old_mean) * (total_time - entry->counters.mean_time[kind]);
+		if (INSTR_TIME_GET_MILLISEC(jitusage->deform_counter))
+			counters->jit_deform_count++;
+		counters->jit_deform_time += INSTR_TIME_GET_MILLISEC(jitusage->deform_counter);
 
-			/*
-			 * Calculate min and max time. min = 0 and max = 0 means that the
-			 * min/max statistics were reset
-			 */
-			if (entry->counters.min_time[kind] == 0
-				&& entry->counters.max_time[kind] == 0)
-			{
-				entry->counters.min_time[kind] = total_time;
-				entry->counters.max_time[kind] = total_time;
-			}
-			else
-			{
-				if (entry->counters.min_time[kind] > total_time)
-					entry->counters.min_time[kind] = total_time;
-				if (entry->counters.max_time[kind] < total_time)
-					entry->counters.max_time[kind] = total_time;
-			}
+		if (INSTR_TIME_GET_MILLISEC(jitusage->inlining_counter))
+			counters->jit_inlining_count++;
+		counters->jit_inlining_time += INSTR_TIME_GET_MILLISEC(jitusage->inlining_counter);
+
+		if (INSTR_TIME_GET_MILLISEC(jitusage->optimization_counter))
+			counters->jit_optimization_count++;
+		counters->jit_optimization_time += INSTR_TIME_GET_MILLISEC(jitusage->optimization_counter);
+
+		if (INSTR_TIME_GET_MILLISEC(jitusage->emission_counter))
+			counters->jit_emission_count++;
+		counters->jit_emission_time += INSTR_TIME_GET_MILLISEC(jitusage->emission_counter);
+	}
+
+	/* parallel worker counters */
+	counters->parallel_workers_to_launch += parallel_workers_to_launch;
+	counters->parallel_workers_launched += parallel_workers_launched;
+
+	/* plan cache counters */
+	if (planOrigin == PLAN_STMT_CACHE_GENERIC)
+		counters->generic_plan_calls++;
+	else if (planOrigin == PLAN_STMT_CACHE_CUSTOM)
+		counters->custom_plan_calls++;
+}
+
+/*
+ * Merge locally accumulated counters into those of a shared entry.
+ *
+ * Caller must hold the entry's spinlock.
+ */
+static void
+counters_merge(Counters *dst, const Counters *src)
+{
+	if (src->calls[PGSS_PLAN] + src->calls[PGSS_EXEC] == 0)
+		return;
+
+	/* "Unstick" entry if it was previously sticky */
+	if (IS_STICKY((*dst)))
+		dst->usage = USAGE_INIT;
+
+	for (int kind = 0; kind < PGSS_NUMKIND; kind++)
+	{
+		int64		n_dst = dst->calls[kind];
+		int64		n_src = src->calls[kind];
+		double		delta;
+
+		if (n_src == 0)
+			continue;
+
+		dst->calls[kind] = n_dst + n_src;
+		dst->total_time[kind] += src->total_time[kind];
+
+		if (n_dst == 0 ||
+			(dst->min_time[kind] == 0 && dst->max_time[kind] == 0))
+		{
+			dst->min_time[kind] = src->min_time[kind];
+			dst->max_time[kind] = src->max_time[kind];
 		}
-		entry->counters.rows += rows;
-		entry->counters.shared_blks_hit += bufusage->shared_blks_hit;
-		entry->counters.shared_blks_read += bufusage->shared_blks_read;
-		entry->counters.shared_blks_dirtied += bufusage->shared_blks_dirtied;
-		entry->counters.shared_blks_written += bufusage->shared_blks_written;
-		entry->counters.local_blks_hit += bufusage->local_blks_hit;
-		entry->counters.local_blks_read += bufusage->local_blks_read;
-		entry->counters.local_blks_dirtied += bufusage->local_blks_dirtied;
-		entry->counters.local_blks_written += bufusage->local_blks_written;
-		entry->counters.temp_blks_read += bufusage->temp_blks_read;
-		entry->counters.temp_blks_written += bufusage->temp_blks_written;
-		entry->counters.shared_blk_read_time += INSTR_TIME_GET_MILLISEC(bufusage->shared_blk_read_time);
-		entry->counters.shared_blk_write_time += INSTR_TIME_GET_MILLISEC(bufusage->shared_blk_write_time);
-		entry->counters.local_blk_read_time += INSTR_TIME_GET_MILLISEC(bufusage->local_blk_read_time);
-		entry->counters.local_blk_write_time += INSTR_TIME_GET_MILLISEC(bufusage->local_blk_write_time);
-		entry->counters.temp_blk_read_time += INSTR_TIME_GET_MILLISEC(bufusage->temp_blk_read_time);
-		entry->counters.temp_blk_write_time += INSTR_TIME_GET_MILLISEC(bufusage->temp_blk_write_time);
-		entry->counters.usage += USAGE_EXEC(total_time);
-		entry->counters.wal_records += walusage->wal_records;
-		entry->counters.wal_fpi += walusage->wal_fpi;
-		entry->counters.wal_bytes += walusage->wal_bytes;
-		entry->counters.wal_buffers_full += walusage->wal_buffers_full;
-		if (jitusage)
+		else
 		{
-			entry->counters.jit_functions += jitusage->created_functions;
-			entry->counters.jit_generation_time += INSTR_TIME_GET_MILLISEC(jitusage->generation_counter);
+			dst->min_time[kind] = Min(dst->min_time[kind], src->min_time[kind]);
+			dst->max_time[kind] = Max(dst->max_time[kind], src->max_time[kind]);
+		}
 
-			if (INSTR_TIME_GET_MILLISEC(jitusage->deform_counter))
-				entry->counters.jit_deform_count++;
-			entry->counters.jit_deform_time += INSTR_TIME_GET_MILLISEC(jitusage->deform_counter);
+		/*
+		 * Combine the means and sums of variances of the two sets of calls,
+		 * per Chan et al.'s parallel variant of Welford's method.
+		 */
+		delta = src->mean_time[kind] - dst->mean_time[kind];
+		dst->mean_time[kind] += delta * n_src / dst->calls[kind];
+		dst->sum_var_time[kind] += src->sum_var_time[kind] +
+			delta * delta * n_dst * n_src / dst->calls[kind];
+	}
 
-			if (INSTR_TIME_GET_MILLISEC(jitusage->inlining_counter))
-				entry->counters.jit_inlining_count++;
-			entry->counters.jit_inlining_time += INSTR_TIME_GET_MILLISEC(jitusage->inlining_counter);
+	dst->rows += src->rows;
+	dst->shared_blks_hit += src->shared_blks_hit;
+	dst->shared_blks_read += src->shared_blks_read;
+	dst->shared_blks_dirtied += src->shared_blks_dirtied;
+	dst->shared_blks_written += src->shared_blks_written;
+	dst->local_blks_hit += src->local_blks_hit;
+	dst->local_blks_read += src->local_blks_read;
+	dst->local_blks_dirtied += src->local_blks_dirtied;
+	dst->local_blks_written += src->local_blks_written;
+	dst->temp_blks_read += src->temp_blks_read;
+	dst->temp_blks_written += src->temp_blks_written;
+	dst->shared_blk_read_time += src->shared_blk_read_time;
+	dst->shared_blk_write_time += src->shared_blk_write_time;
+	dst->local_blk_read_time += src->local_blk_read_time;
+	dst->local_blk_write_time += src->local_blk_write_time;
+	dst->temp_blk_read_time += src->temp_blk_read_time;
+	dst->temp_blk_write_time += src->temp_blk_write_time;
+	dst->usage += src->usage;
+	dst->wal_records += src->wal_records;
+	dst->wal_fpi += src->wal_fpi;
+	dst->wal_bytes += src->wal_bytes;
+	dst->wal_buffers_full += src->wal_buffers_full;
+	dst->jit_functions += src->jit_functions;
+	dst->jit_generation_time += src->jit_generation_time;
+	dst->jit_inlining_count += src->jit_inlining_count;
+	dst->jit_inlining_time += src->jit_inlining_time;
+	dst->jit_deform_count += src->jit_deform_count;
+	dst->jit_deform_time += src->jit_deform_time;
+	dst->jit_optimization_count += src->jit_optimization_count;
+	dst->jit_optimization_time += src->jit_optimization_time;
+	dst->jit_emission_count += src->jit_emission_count;
+	dst->jit_emission_time += src->jit_emission_time;
+	dst->parallel_workers_to_launch += src->parallel_workers_to_launch;
+	dst->parallel_workers_launched += src->parallel_workers_launched;
+	dst->generic_plan_calls += src->generic_plan_calls;
+	dst->custom_plan_calls += src->custom_plan_calls;
+}
 
-			if (INSTR_TIME_GET_MILLISEC(jitusage->optimization_counter))
-				entry->counters.jit_optimization_count++;
-			entry->counters.jit_optimization_time += INSTR_TIME_GET_MILLISEC(jitusage->optimization_counter);
+/*
+ * Merge all locally accumulated counters into the shared entries.
+ *
+ * The counters of entries that have been deallocated or reset since we
+ * looked them up are discarded.
+ */
+static void
+pgss_flush_pending(void)
+{
+	HASH_SEQ_STATUS hash_seq;
+	pgssPendingEntry *pending;
 
-			if (INSTR_TIME_GET_MILLISEC(jitusage->emission_counter))
-				entry->counters.jit_emission_count++;
-			entry->counters.jit_emission_time += INSTR_TIME_GET_MILLISEC(jitusage->emission_counter);
-		}
+	if (pgss_pending_hash == NULL)
+		return;
 
-		/* parallel worker counters */
-		entry->counters.parallel_workers_to_launch += parallel_workers_to_launch;
-		entry->counters.parallel_workers_launched += parallel_workers_launched;
+	pgss_last_flush = GetCurrentStatementStartTimestamp();
 
-		/* plan cache counters */
-		if (planOrigin == PLAN_STMT_CACHE_GENERIC)
-			entry->counters.generic_plan_calls++;
-		else if (planOrigin == PLAN_STMT_CACHE_CUSTOM)
-			entry->counters.custom_plan_calls++;
+	if (hash_get_num_entries(pgss_pending_hash) == 0)
+		return;
 
-		SpinLockRelease(&entry->mutex);
+	LWLockAcquire(pgss->lock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, pgss_pending_hash);
+	while ((pending = hash_seq_search(&hash_seq)) != NULL)
+	{
+		pgssEntry  *entry;
+
+		entry = (pgssEntry *) hash_search(pgss_hash, &pending->key,
+										  HASH_FIND, NULL);
+		if (entry)
+		{
+			SpinLockAcquire(&entry->mutex);
+			counters_merge(&entry->counters, &pending->counters);
+			SpinLockRelease(&entry->mutex);
+		}
+
+		hash_search(pgss_pending_hash, &pending->key, HASH_REMOVE, NULL);
 	}
 
-done:
 	LWLockRelease(pgss->lock);
+}
 
-	/* We postpone this clean-up until we're out of the lock */
-	if (norm_query)
-		pfree(norm_query);
+/*
+ * before_shmem_exit callback: don't lose what we accumulated.
+ */
+static void
+pgss_flush_at_exit(int code, Datum arg)
+{
+	if (pgss && pgss_hash && !LWLockHeldByMe(pgss->lock))
+		pgss_flush_pending();
 }
 
 /*
@@ -1581,7 +1937,8 @@ pg_stat_statements_reset(PG_FUNCTION_ARGS)
 #define PG_STAT_STATEMENTS_COLS_V1_11	49
 #define PG_STAT_STATEMENTS_COLS_V1_12	52
 #define PG_STAT_STATEMENTS_COLS_V1_13	54
-#define PG_STAT_STATEMENTS_COLS			54	/* maximum of above */
+#define PG_STAT_STATEMENTS_COLS_V1_14	55
+#define PG_STAT_STATEMENTS_COLS			55	/* maximum of above */
 
 /*
  * Retrieve statement statistics.
@@ -1593,6 +1950,16 @@ pg_stat_statements_reset(PG_FUNCTION_ARGS)
  * expected API version is identified by embedding it in the C name of the
  * function.  Unfortunately we weren't bright enough to do that for 1.1.
  */
+Datum
+pg_stat_statements_1_14(PG_FUNCTION_ARGS)
+{
+	bool		showtext = PG_GETARG_BOOL(0);
+
+	pg_stat_statements_internal(fcinfo, PGSS_V1_14, showtext);
+
+	return (Datum) 0;
+}
+
 Datum
 pg_stat_statements_1_13(PG_FUNCTION_ARGS)
 {
@@ -1714,6 +2081,9 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("pg_stat_statements must be loaded via \"shared_preload_libraries\"")));
 
+	/* Make sure our own statistics are included */
+	pgss_flush_pending();
+
 	InitMaterializedSRF(fcinfo, 0);
 
 	/*
@@ -1765,6 +2135,10 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 			if (api_version != PGSS_V1_13)
 				elog(ERROR, "incorrect number of output arguments");
 			break;
+		case PG_STAT_STATEMENTS_COLS_V1_14:
+			if (api_version != PGSS_V1_14)
+				elog(ERROR, "incorrect number of output arguments");
+			break;
 		default:
 			elog(ERROR, "incorrect number of output arguments");
 	}
@@ -1853,6 +2227,8 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 		{
 			if (api_version >= PGSS_V1_2)
 				values[i++] = Int64GetDatumFast(queryid);
+			if (api_version >= PGSS_V1_14)
+				values[i++] = Int64GetDatumFast(entry->key.planid);
 
 			if (showtext)
 			{
@@ -1891,6 +2267,8 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 			/* Don't show queryid */
 			if (api_version >= PGSS_V1_2)
 				nulls[i++] = true;
+			if (api_version >= PGSS_V1_14)
+				nulls[i++] = true;
 
 			/*
 			 * Don't show query text, but hint as to the reason for not doing
@@ -2038,6 +2416,7 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 					 api_version == PGSS_V1_11 ? PG_STAT_STATEMENTS_COLS_V1_11 :
 					 api_version == PGSS_V1_12 ? PG_STAT_STATEMENTS_COLS_V1_12 :
 					 api_version == PGSS_V1_13 ? PG_STAT_STATEMENTS_COLS_V1_13 :
+					 api_version == PGSS_V1_14 ? PG_STAT_STATEMENTS_COLS_V1_14 :
 					 -1 /* fail if you forget to update this assert */ ));
 
 		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
@@ -2150,20 +2529,38 @@ entry_alloc(pgssHashKey *key, Size query_offset, int query_len, int encoding,
 }
 
 /*
- * qsort comparator for sorting into increasing usage order
+ * Map a usage value to a bucket of the histogram used by entry_dealloc().
+ * The buckets are spaced logarithmically, USAGE_HIST_SUBBUCKETS per power of
+ * two, so that their resolution is the same for any usage.
  */
 static int
-entry_cmp(const void *lhs, const void *rhs)
+usage_bucket(double usage)
 {
-	double		l_usage = (*(pgssEntry *const *) lhs)->counters.usage;
-	double		r_usage = (*(pgssEntry *const *) rhs)->counters.usage;
+	double		frac;
+	int			exp;
+	int			bucket;
 
-	if (l_usage < r_usage)
-		return -1;
-	else if (l_usage > r_usage)
-		return +1;
-	else
+	if (usage <= 0)
 		return 0;
+
+	/* usage = frac * 2^exp, with frac in [0.5, 1) */
+	frac = frexp(usage, &exp);
+	bucket = (exp - USAGE_HIST_MIN_EXP) * USAGE_HIST_SUBBUCKETS +
+		(int) ((frac - 0.5) * 2 * USAGE_HIST_SUBBUCKETS);
+
+	return Max(0, Min(bucket, USAGE_HIST_BUCKETS - 1));
+}
+
+/*
+ * Return the smallest usage value that maps to a histogram bucket.
+ */
+static double
+usage_bucket_bound(int bucket)
+{
+	int			exp = bucket / USAGE_HIST_SUBBUCKETS + USAGE_HIST_MIN_EXP;
+	int			sub = bucket % USAGE_HIST_SUBBUCKETS;
+
+	return ldexp(0.5 + (double) sub / (2 * USAGE_HIST_SUBBUCKETS), exp);
 }
 
 /*
@@ -2175,15 +2572,25 @@ static void
 entry_dealloc(void)
 {
 	HASH_SEQ_STATUS hash_seq;
-	pgssEntry **entries;
 	pgssEntry  *entry;
+	int			hist[USAGE_HIST_BUCKETS];
+	int			nentries;
 	int			nvictims;
-	int			i;
+	int			threshold;
+	int			nbelow;
+	int			nremoved;
+	int			cumulative;
 	Size		tottextlen;
 	int			nvalidtexts;
 
 	/*
-	 * Sort entries by usage and deallocate USAGE_DEALLOC_PERCENT of them.
+	 * Deallocate the USAGE_DEALLOC_PERCENT of entries with the least usage.
+	 * Rather than sorting all entries, which is slow with a large
+	 * pg_stat_statements.max while we hold the exclusive lock, we build a
+	 * histogram of the usage values, and use it to find the usage below
+	 * which we must remove entries.  Of the entries in the bucket at that
+	 * threshold, we remove whichever we come across first.
+	 *
 	 * While we're scanning the table, apply the decay factor to the usage
 	 * values, and update the mean query length.
 	 *
@@ -2194,21 +2601,21 @@ entry_dealloc(void)
 	 * cur_median_usage includes the entries we're about to zap.
 	 */
 
-	entries = palloc(hash_get_num_entries(pgss_hash) * sizeof(pgssEntry *));
-
-	i = 0;
+	memset(hist, 0, sizeof(hist));
+	nentries = 0;
 	tottextlen = 0;
 	nvalidtexts = 0;
 
 	hash_seq_init(&hash_seq, pgss_hash);
 	while ((entry = hash_seq_search(&hash_seq)) != NULL)
 	{
-		entries[i++] = entry;
 		/* "Sticky" entries get a different usage decay rate. */
 		if (IS_STICKY(entry->counters))
 			entry->counters.usage *= STICKY_DECREASE_FACTOR;
 		else
 			entry->counters.usage *= USAGE_DECREASE_FACTOR;
+		hist[usage_bucket(entry->counters.usage)]++;
+		nentries++;
 		/* In the mean length computation, ignore dropped texts. */
 		if (entry->query_len >= 0)
 		{
@@ -2217,12 +2624,17 @@ entry_dealloc(void)
 		}
 	}
 
-	/* Sort into increasing order by usage */
-	qsort(entries, i, sizeof(pgssEntry *), entry_cmp);
-
 	/* Record the (approximate) median usage */
-	if (i > 0)
-		pgss->cur_median_usage = entries[i / 2]->counters.usage;
+	cumulative = 0;
+	for (int bucket = 0; bucket < USAGE_HIST_BUCKETS; bucket++)
+	{
+		cumulative += hist[bucket];
+		if (cumulative > nentries / 2)
+		{
+			pgss->cur_median_usage = usage_bucket_bound(bucket);
+			break;
+		}
+	}
 	/* Record the mean query length */
 	if (nvalidtexts > 0)
 		pgss->mean_query_len = tottextlen / nvalidtexts;
@@ -2230,15 +2642,30 @@ entry_dealloc(void)
 		pgss->mean_query_len = ASSUMED_LENGTH_INIT;
 
 	/* Now zap an appropriate fraction of lowest-usage entries */
-	nvictims = Max(10, i * USAGE_DEALLOC_PERCENT / 100);
-	nvictims = Min(nvictims, i);
+	nvictims = Max(10, nentries * USAGE_DEALLOC_PERCENT / 100);
+	nvictims = Min(nvictims, nentries);
+
+	/* Find the bucket that contains the last victim */
+	threshold = 0;
+	nbelow = 0;
+	while (threshold < USAGE_HIST_BUCKETS - 1 &&
+		   nbelow + hist[threshold] < nvictims)
+		nbelow += hist[threshold++];
 
-	for (i = 0; i < nvictims; i++)
+	nremoved = 0;
+	hash_seq_init(&hash_seq, pgss_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
 	{
-		hash_search(pgss_hash, &entries[i]->key, HASH_REMOVE, NULL);
-	}
+		int			bucket = usage_bucket(entry->counters.usage);
 
-	pfree(entries);
+		if (bucket < threshold ||
+			(bucket == threshold && nremoved < nvictims - nbelow))
+		{
+			if (bucket == threshold)
+				nremoved++;
+			hash_search(pgss_hash, &entry->key, HASH_REMOVE, NULL);
+		}
+	}
 
 	/* Increment the number of times entries are deallocated */
 	SpinLockAcquire(&pgss->mutex);
@@ -2725,14 +3152,22 @@ entry_reset(Oid userid, Oid dbid, int64 queryid, bool minmax_only)
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
 				 errmsg("pg_stat_statements must be loaded via \"shared_preload_libraries\"")));
 
+	/* Don't let our own statistics from before the reset survive it */
+	pgss_flush_pending();
+
 	LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
 	num_entries = hash_get_num_entries(pgss_hash);
 
 	stats_reset = GetCurrentTimestamp();
 
-	if (userid != 0 && dbid != 0 && queryid != INT64CONST(0))
+	if (userid != 0 && dbid != 0 && queryid != INT64CONST(0) &&
+		!pgss_track_plans)
 	{
-		/* If all the parameters are available, use the fast path. */
+		/*
+		 * If all the parameters are available, use the fast path.  That
+		 * can't find the entries for individual plans, which we assume don't
+		 * exist unless we're tracking plans.
+		 */
 		memset(&key, 0, sizeof(pgssHashKey));
 		key.userid = userid;
 		key.dbid = dbid;
@@ -26,6 +26,26 @@ SELECT plans, calls, rows, query FROM pg_stat_statements
 SELECT plans >= 2 AND plans <= calls AS plans_ok, calls, rows, query FROM pg_stat_statements
   WHERE query LIKE 'PREPARE%' ORDER BY query COLLATE "C";
 
+--
+-- separate statistics per plan
+--
+SET pg_stat_statements.track_plans = TRUE;
+CREATE TABLE stats_plan_variants (a int PRIMARY KEY);
+SELECT pg_stat_statements_reset() IS NOT NULL AS t;
+SET enable_indexscan = FALSE;
+SET enable_indexonlyscan = FALSE;
+SET enable_bitmapscan = FALSE;
+SELECT * FROM stats_plan_variants WHERE a = 1;
+SELECT * FROM stats_plan_variants WHERE a = 2;
+RESET enable_indexscan;
+RESET enable_indexonlyscan;
+RESET enable_bitmapscan;
+SELECT * FROM stats_plan_variants WHERE a = 3;
+SELECT planid <> 0 AS has_planid, plans, calls, query FROM pg_stat_statements
+  WHERE query LIKE 'SELECT * FROM stats_plan_variants%' ORDER BY calls DESC;
+RESET pg_stat_statements.track_plans;
+
 -- Cleanup
 DROP TABLE stats_plan_test;
+DROP TABLE stats_plan_variants;
 SELECT pg_stat_statements_reset() IS NOT NULL AS t;
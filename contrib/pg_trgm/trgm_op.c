@@ -8,8 +8,8 @@
 #include "catalog/pg_collation_d.h"
 #include "catalog/pg_type.h"
 #include "common/int.h"
-#include "lib/qunique.h"
 #include "miscadmin.h"
+#include "port/simd.h"
 #include "trgm.h"
 #include "tsearch/ts_locale.h"
 #include "utils/formatting.h"
@@ -17,6 +17,7 @@
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_crc.h"
+#include "utils/pg_locale.h"
 
 PG_MODULE_MAGIC_EXT(
 					.name = "pg_trgm",
@@ -154,6 +155,155 @@ CMPTRGM_CHOOSE(const void *a, const void *b)
 	return CMPTRGM(a, b);
 }
 
+/*
+ * A trgm packed into an integer that orders the same way as CMPTRGM, so that
+ * trigram arrays can be sorted and merged without calling the comparator.
+ * If chars are signed, flipping the high bit of each byte turns the signed
+ * order into the unsigned one.
+ */
+static inline uint32
+trgm_sign_flip(void)
+{
+	return GetDefaultCharSignedness() ? 0x808080 : 0;
+}
+
+static inline uint32
+trgm_key(const trgm *t, uint32 flip)
+{
+	const unsigned char *p = (const unsigned char *) t;
+
+	return (((uint32) p[0] << 16) | ((uint32) p[1] << 8) | p[2]) ^ flip;
+}
+
+#define ST_SORT sort_trgm_keys
+#define ST_ELEMENT_TYPE uint32
+#define ST_COMPARE(a, b) pg_cmp_u32(*(a), *(b))
+#define ST_SCOPE static
+#define ST_DEFINE
+#include "lib/sort_template.h"
+
+/*
+ * Sort an array of trigrams and remove duplicates, returning the new length.
+ */
+static int
+sort_unique_trgm(trgm *arr, int len)
+{
+	uint32		flip = trgm_sign_flip();
+	uint32	   *keys;
+	int			i,
+				n = 0;
+
+	if (len <= 1)
+		return len;
+
+	keys = palloc_array(uint32, len);
+	for (i = 0; i < len; i++)
+		keys[i] = trgm_key(&arr[i], flip);
+
+	sort_trgm_keys(keys, len);
+
+	for (i = 0; i < len; i++)
+	{
+		uint32		key;
+
+		if (i > 0 && keys[i] == keys[i - 1])
+			continue;
+		key = keys[i] ^ flip;
+		arr[n][0] = (char) (key >> 16);
+		arr[n][1] = (char) (key >> 8);
+		arr[n][2] = (char) key;
+		n++;
+	}
+
+	pfree(keys);
+
+	return n;
+}
+
+/*
+ * Which ASCII characters are word characters, and what they lowercase to, in
+ * the database default locale.  These let generate_trgm_only() handle plain
+ * ASCII text without per-character locale calls or per-word allocations.  A
+ * zero in ascii_lower means that the character does not lowercase to a single
+ * ASCII character (think of a Turkish locale's "I"), and text containing it
+ * takes the general path.
+ */
+static bool ascii_tables_ready = false;
+static bool ascii_lower_complete;
+static bool ascii_wordchr[128];
+static char ascii_lower[128];
+
+static void
+init_ascii_tables(void)
+{
+	pg_locale_t locale = pg_database_locale();
+	int			c;
+
+	ascii_lower_complete = true;
+	for (c = 1; c < lengthof(ascii_wordchr); c++)
+	{
+		ascii_wordchr[c] = pg_iswalnum((pg_wchar) c, locale);
+#ifdef IGNORECASE
+		if (ascii_wordchr[c])
+		{
+			char		ch = (char) c;
+			char	   *lower = str_tolower(&ch, 1, DEFAULT_COLLATION_OID);
+
+			if (strlen(lower) == 1 && !IS_HIGHBIT_SET(lower[0]))
+				ascii_lower[c] = lower[0];
+			else
+			{
+				ascii_lower[c] = 0;
+				ascii_lower_complete = false;
+			}
+			pfree(lower);
+		}
+#else
+		ascii_lower[c] = (char) c;
+#endif
+	}
+	ascii_tables_ready = true;
+}
+
+/*
+ * Can generate_trgm_only_ascii() handle this string?
+ */
+static bool
+trgm_ascii_ok(const char *str, int slen)
+{
+	int			i = 0;
+
+	if (!ascii_tables_ready)
+		init_ascii_tables();
+
+	for (; i + (int) sizeof(Vector8) <= slen; i += sizeof(Vector8))
+	{
+		Vector8		chunk;
+
+		vector8_load(&chunk, (const uint8 *) str + i);
+		if (vector8_is_highbit_set(chunk))
+			return false;
+	}
+	for (; i < slen; i++)
+	{
+		if (IS_HIGHBIT_SET(str[i]))
+			return false;
+	}
+
+	if (!ascii_lower_complete)
+	{
+		for (i = 0; i < slen; i++)
+		{
+			unsigned char c = (unsigned char) str[i];
+
+			if (ascii_wordchr[c] && ascii_lower[c] == 0)
+				return false;
+		}
+	}
+
+	return true;
+}
+
 /*
  * Deprecated function.
  * Use "pg_trgm.similarity_threshold" GUC variable instead of this function.
@@ -209,12 +359,6 @@ show_limit(PG_FUNCTION_ARGS)
 	PG_RETURN_FLOAT4(similarity_threshold);
 }
 
-static int
-comp_trgm(const void *a, const void *b)
-{
-	return CMPTRGM(a, b);
-}
-
 /*
  * Finds first word in string, returns pointer to the word,
  * endword points to the character after word
@@ -314,6 +458,54 @@ make_trigrams(trgm *tptr, char *str, int bytelen, int charlen)
 	return tptr;
 }
 
+/*
+ * generate_trgm_only() for a string accepted by trgm_ascii_ok().
+ */
+static int
+generate_trgm_only_ascii(trgm *trg, const char *str, int slen,
+						 TrgmBound *bounds)
+{
+	trgm	   *tptr = trg;
+	char	   *buf;
+	int			pos = 0;
+
+	buf = (char *) palloc(slen + 4);
+
+	if (LPADDING > 0)
+	{
+		*buf = ' ';
+		if (LPADDING > 1)
+			*(buf + 1) = ' ';
+	}
+
+	for (;;)
+	{
+		int			bytelen = 0;
+
+		while (pos < slen && !ascii_wordchr[(unsigned char) str[pos]])
+			pos++;
+		if (pos >= slen)
+			break;
+
+		while (pos < slen && ascii_wordchr[(unsigned char) str[pos]])
+			buf[LPADDING + bytelen++] = ascii_lower[(unsigned char) str[pos++]];
+
+		buf[LPADDING + bytelen] = ' ';
+		buf[LPADDING + bytelen + 1] = ' ';
+
+		if (bounds)
+			bounds[tptr - trg] |= TRGM_BOUND_LEFT;
+		tptr = make_trigrams(tptr, buf, bytelen + LPADDING + RPADDING,
+							 bytelen + LPADDING + RPADDING);
+		if (bounds)
+			bounds[tptr - trg - 1] |= TRGM_BOUND_RIGHT;
+	}
+
+	pfree(buf);
+
+	return tptr - trg;
+}
+
 /*
  * Make array of trigrams without sorting and removing duplicate items.
  *
@@ -336,6 +528,9 @@ generate_trgm_only(trgm *trg, char *str, int slen, TrgmBound *bounds)
 	if (slen + LPADDING + RPADDING < 3 || slen == 0)
 		return 0;
 
+	if (trgm_ascii_ok(str, slen))
+		return generate_trgm_only_ascii(trg, str, slen, bounds);
+
 	tptr = trg;
 
 	/* Allocate a buffer for case-folded, blank-padded words */
@@ -424,11 +619,7 @@ generate_trgm(char *str, int slen)
 	/*
 	 * Make trigrams unique.
 	 */
-	if (len > 1)
-	{
-		qsort(GETARR(trg), len, sizeof(trgm), comp_trgm);
-		len = qunique(GETARR(trg), len, sizeof(trgm), comp_trgm);
-	}
+	len = sort_unique_trgm(GETARR(trg), len);
 
 	SET_VARSIZE(trg, CALCGTSIZE(ARRKEY, len));
 
@@ -972,11 +1163,7 @@ generate_wildcard_trgm(const char *str, int slen)
 	/*
 	 * Make trigrams unique.
 	 */
-	if (len > 1)
-	{
-		qsort(GETARR(trg), len, sizeof(trgm), comp_trgm);
-		len = qunique(GETARR(trg), len, sizeof(trgm), comp_trgm);
-	}
+	len = sort_unique_trgm(GETARR(trg), len);
 
 	SET_VARSIZE(trg, CALCGTSIZE(ARRKEY, len));
 
@@ -1047,6 +1234,9 @@ cnt_sml(TRGM *trg1, TRGM *trg2, bool inexact)
 	int			count = 0;
 	int			len1,
 				len2;
+	int			i = 0,
+				j = 0;
+	uint32		flip;
 
 	ptr1 = GETARR(trg1);
 	ptr2 = GETARR(trg2);
@@ -1058,20 +1248,19 @@ cnt_sml(TRGM *trg1, TRGM *trg2, bool inexact)
 	if (len1 <= 0 || len2 <= 0)
 		return (float4) 0.0;
 
-	while (ptr1 - GETARR(trg1) < len1 && ptr2 - GETARR(trg2) < len2)
+	/*
+	 * Count the common trigrams by merging the sorted arrays.  The merge is
+	 * written without branches on the comparison, which are unpredictable.
+	 */
+	flip = trgm_sign_flip();
+	while (i < len1 && j < len2)
 	{
-		int			res = CMPTRGM(ptr1, ptr2);
+		uint32		k1 = trgm_key(&ptr1[i], flip);
+		uint32		k2 = trgm_key(&ptr2[j], flip);
 
-		if (res < 0)
-			ptr1++;
-		else if (res > 0)
-			ptr2++;
-		else
-		{
-			ptr1++;
-			ptr2++;
-			count++;
-		}
+		count += (k1 == k2);
+		i += (k1 <= k2);
+		j += (k1 >= k2);
 	}
 
 	/*
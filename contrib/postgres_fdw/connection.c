@@ -289,6 +289,9 @@ GetConnection(UserMapping *user, bool will_prep_stmt, PgFdwConnState **state)
 		/* Process a pending asynchronous request if any. */
 		if (entry->state.pendingAreq)
 			process_pending_request(entry->state.pendingAreq);
+		/* Likewise, collect the results of pipelined commands if any. */
+		if (entry->state.numPipelined > 0)
+			pgfdw_get_pipelined_results(entry->conn, &entry->state, 0);
 		/* Start a new transaction or subtransaction if needed. */
 		begin_remote_xact(entry);
 	}
@@ -949,12 +952,55 @@ pgfdw_exec_query(PGconn *conn, const char *query, PgFdwConnState *state)
 	/* First, process a pending asynchronous request, if any. */
 	if (state && state->pendingAreq)
 		process_pending_request(state->pendingAreq);
+	/* Likewise, collect the results of pipelined commands, if any. */
+	if (state && state->numPipelined > 0)
+		pgfdw_get_pipelined_results(conn, state, 0);
 
 	if (!PQsendQuery(conn, query))
 		return NULL;
 	return pgfdw_get_result(conn);
 }
 
+/*
+ * Collect the results of the commands that execute_foreign_modify() sent in
+ * pipeline mode, until no more than max_pending of them are outstanding.
+ * Each command is followed by its own sync point.  Once nothing is
+ * outstanding, the connection is taken out of pipeline mode, so that it can
+ * be used for other commands again.
+ *
+ * Any error reported by the remote server is thrown.
+ */
+void
+pgfdw_get_pipelined_results(PGconn *conn, PgFdwConnState *state,
+							int max_pending)
+{
+	while (state->numPipelined > max_pending)
+	{
+		PGresult   *res;
+
+		res = pgfdw_get_result(conn);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			pgfdw_report_error(res, conn, state->pipelinedSql);
+		PQclear(res);
+
+		/* libpq doesn't return a NULL after the sync point's result */
+		res = libpqsrv_get_result(conn, pgfdw_we_get_result);
+		if (PQresultStatus(res) != PGRES_PIPELINE_SYNC)
+			pgfdw_report_error(res, conn, state->pipelinedSql);
+		PQclear(res);
+
+		state->numPipelined--;
+	}
+
+	if (state->numPipelined == 0 &&
+		PQpipelineStatus(conn) != PQ_PIPELINE_OFF)
+	{
+		if (!PQexitPipelineMode(conn))
+			pgfdw_report_error(NULL, conn, state->pipelinedSql);
+		state->pipelinedSql = NULL;
+	}
+}
+
 /*
  * Wrap libpqsrv_get_result_last(), adding wait event.
  *
@@ -1756,6 +1802,16 @@ pgfdw_abort_cleanup(ConnCacheEntry *entry, bool toplevel)
 	/* Assume we might have lost track of prepared statements */
 	entry->have_error = true;
 
+	/*
+	 * If commands were left outstanding in pipeline mode, we don't try to
+	 * unwind the pipeline; the connection is discarded instead.
+	 */
+	if (PQpipelineStatus(entry->conn) != PQ_PIPELINE_OFF)
+	{
+		memset(&entry->state, 0, sizeof(entry->state));
+		return;
+	}
+
 	/*
 	 * If a command has been submitted to the remote server by using an
 	 * asynchronous execution function, the command might not have yet
@@ -1829,6 +1885,16 @@ pgfdw_abort_cleanup_begin(ConnCacheEntry *entry, bool toplevel,
 	/* Assume we might have lost track of prepared statements */
 	entry->have_error = true;
 
+	/*
+	 * If commands were left outstanding in pipeline mode, we don't try to
+	 * unwind the pipeline; the connection is discarded instead.
+	 */
+	if (PQpipelineStatus(entry->conn) != PQ_PIPELINE_OFF)
+	{
+		memset(&entry->state, 0, sizeof(entry->state));
+		return false;
+	}
+
 	/*
 	 * If a command has been submitted to the remote server by using an
 	 * asynchronous execution function, the command might not have yet
@@ -2173,7 +2173,8 @@ deparseInsertSql(StringInfo buf, RangeTblEntry *rte,
 		appendStringInfoString(buf, " ON CONFLICT DO NOTHING");
 
 	deparseReturningList(buf, rte, rtindex, rel,
-						 rel->trigdesc && rel->trigdesc->trig_insert_after_row,
+						 RelationGetTriggerDesc(rel) &&
+						 RelationGetTriggerDesc(rel)->trig_insert_after_row,
 						 withCheckOptionList, returningList, retrieved_attrs);
 }
 
@@ -2282,7 +2283,8 @@ deparseUpdateSql(StringInfo buf, RangeTblEntry *rte,
 	appendStringInfoString(buf, " WHERE ctid = $1");
 
 	deparseReturningList(buf, rte, rtindex, rel,
-						 rel->trigdesc && rel->trigdesc->trig_update_after_row,
+						 RelationGetTriggerDesc(rel) &&
+						 RelationGetTriggerDesc(rel)->trig_update_after_row,
 						 withCheckOptionList, returningList, retrieved_attrs);
 }
 
@@ -2400,7 +2402,8 @@ deparseDeleteSql(StringInfo buf, RangeTblEntry *rte,
 	appendStringInfoString(buf, " WHERE ctid = $1");
 
 	deparseReturningList(buf, rte, rtindex, rel,
-						 rel->trigdesc && rel->trigdesc->trig_delete_after_row,
+						 RelationGetTriggerDesc(rel) &&
+						 RelationGetTriggerDesc(rel)->trig_delete_after_row,
 						 NIL, returningList, retrieved_attrs);
 }
 
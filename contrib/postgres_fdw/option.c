@@ -118,6 +118,7 @@ postgres_fdw_validator(PG_FUNCTION_ARGS)
 			strcmp(def->defname, "updatable") == 0 ||
 			strcmp(def->defname, "truncatable") == 0 ||
 			strcmp(def->defname, "async_capable") == 0 ||
+			strcmp(def->defname, "parallel_scan") == 0 ||
 			strcmp(def->defname, "parallel_commit") == 0 ||
 			strcmp(def->defname, "parallel_abort") == 0 ||
 			strcmp(def->defname, "keep_connections") == 0)
@@ -157,7 +158,8 @@ postgres_fdw_validator(PG_FUNCTION_ARGS)
 			(void) ExtractExtensionList(defGetString(def), true);
 		}
 		else if (strcmp(def->defname, "fetch_size") == 0 ||
-				 strcmp(def->defname, "batch_size") == 0)
+				 strcmp(def->defname, "batch_size") == 0 ||
+				 strcmp(def->defname, "pipeline_depth") == 0)
 		{
 			char	   *value;
 			int			int_val;
@@ -263,9 +265,15 @@ InitPgFdwOptions(void)
 		/* batch_size is available on both server and table */
 		{"batch_size", ForeignServerRelationId, false},
 		{"batch_size", ForeignTableRelationId, false},
+		/* pipeline_depth is available on both server and table */
+		{"pipeline_depth", ForeignServerRelationId, false},
+		{"pipeline_depth", ForeignTableRelationId, false},
 		/* async_capable is available on both server and table */
 		{"async_capable", ForeignServerRelationId, false},
 		{"async_capable", ForeignTableRelationId, false},
+		/* parallel_scan is available on both server and table */
+		{"parallel_scan", ForeignServerRelationId, false},
+		{"parallel_scan", ForeignTableRelationId, false},
 		{"parallel_commit", ForeignServerRelationId, false},
 		{"parallel_abort", ForeignServerRelationId, false},
 		{"keep_connections", ForeignServerRelationId, false},
@@ -15,8 +15,10 @@
 #include <limits.h>
 
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/sysattr.h"
 #include "access/table.h"
+#include "access/xact.h"
 #include "catalog/pg_opfamily.h"
 #include "commands/defrem.h"
 #include "commands/explain_format.h"
@@ -38,6 +40,7 @@
 #include "optimizer/restrictinfo.h"
 #include "optimizer/tlist.h"
 #include "parser/parsetree.h"
+#include "port/atomics.h"
 #include "postgres_fdw.h"
 #include "storage/latch.h"
 #include "utils/builtins.h"
@@ -174,8 +177,35 @@ typedef struct PgFdwScanState
 	MemoryContext temp_cxt;		/* context for per-tuple temporary data */
 
 	int			fetch_size;		/* number of tuples per fetch */
+
+	/* for parallel scans */
+	bool		parallel;		/* fetch the remote table in block ranges? */
+	struct PgFdwParallelScanState *pscan;	/* shared state, or NULL */
+	bool		ranges_done;	/* no more ranges for us to fetch? */
+	BlockNumber range_start;	/* first block of the current range */
+	BlockNumber range_end;		/* first block after it */
 } PgFdwScanState;
 
+/*
+ * Shared state of a parallel foreign scan.  The remote table is divided into
+ * ranges of blocks, which the participants claim one at a time and fetch
+ * with a condition on ctid.  So that the workers see the same data as the
+ * leader, their remote transactions import the snapshot of the leader's.
+ */
+typedef struct PgFdwParallelScanState
+{
+	char		snapshot[64];	/* remote snapshot to import, or "" */
+	BlockNumber range_blocks;	/* # of blocks in each range */
+	uint32		nranges;		/* # of ranges; the last one is open-ended */
+	pg_atomic_uint32 next_range;	/* next range to be claimed */
+} PgFdwParallelScanState;
+
+/* Minimum size of a range of blocks fetched by a parallel scan */
+#define PARALLEL_SCAN_MIN_RANGE_BLOCKS	128
+
+/* Number of ranges to divide the remote table into, per participant */
+#define PARALLEL_SCAN_RANGES_PER_PARTICIPANT	4
+
 /*
  * Execution state of a foreign insert/update/delete operation.
  */
@@ -195,6 +225,7 @@ typedef struct PgFdwModifyState
 	List	   *target_attrs;	/* list of target attribute numbers */
 	int			values_end;		/* length up to the end of VALUES */
 	int			batch_size;		/* value of FDW option "batch_size" */
+	int			pipeline_depth; /* # of INSERTs that may be in flight */
 	bool		has_returning;	/* is there a RETURNING clause? */
 	List	   *retrieved_attrs;	/* attr numbers retrieved by RETURNING */
 
@@ -421,6 +452,20 @@ static bool postgresIsForeignPathAsyncCapable(ForeignPath *path);
 static void postgresForeignAsyncRequest(AsyncRequest *areq);
 static void postgresForeignAsyncConfigureWait(AsyncRequest *areq);
 static void postgresForeignAsyncNotify(AsyncRequest *areq);
+static bool postgresIsForeignScanParallelSafe(PlannerInfo *root,
+											  RelOptInfo *rel,
+											  RangeTblEntry *rte);
+static Size postgresEstimateDSMForeignScan(ForeignScanState *node,
+										   ParallelContext *pcxt);
+static void postgresInitializeDSMForeignScan(ForeignScanState *node,
+											 ParallelContext *pcxt,
+											 void *coordinate);
+static void postgresReInitializeDSMForeignScan(ForeignScanState *node,
+											   ParallelContext *pcxt,
+											   void *coordinate);
+static void postgresInitializeWorkerForeignScan(ForeignScanState *node,
+												shm_toc *toc,
+												void *coordinate);
 
 /*
  * Helper functions
@@ -451,6 +496,7 @@ static bool ec_member_matches_foreign(PlannerInfo *root, RelOptInfo *rel,
 									  EquivalenceClass *ec, EquivalenceMember *em,
 									  void *arg);
 static void create_cursor(ForeignScanState *node);
+static bool claim_scan_range(PgFdwScanState *fsstate);
 static void fetch_more_data(ForeignScanState *node);
 static void close_cursor(PGconn *conn, unsigned int cursor_number,
 						 PgFdwConnState *conn_state);
@@ -545,6 +591,9 @@ static void merge_fdw_options(PgFdwRelationInfo *fpinfo,
 							  const PgFdwRelationInfo *fpinfo_o,
 							  const PgFdwRelationInfo *fpinfo_i);
 static int	get_batch_size_option(Relation rel);
+static int	get_pipeline_depth_option(Relation rel);
+static bool get_parallel_scan_option(Oid foreigntableid);
+static void add_partial_foreign_path(PlannerInfo *root, RelOptInfo *baserel);
 
 
 /*
@@ -611,6 +660,13 @@ postgres_fdw_handler(PG_FUNCTION_ARGS)
 	routine->ForeignAsyncConfigureWait = postgresForeignAsyncConfigureWait;
 	routine->ForeignAsyncNotify = postgresForeignAsyncNotify;
 
+	/* Support functions for parallel execution */
+	routine->IsForeignScanParallelSafe = postgresIsForeignScanParallelSafe;
+	routine->EstimateDSMForeignScan = postgresEstimateDSMForeignScan;
+	routine->InitializeDSMForeignScan = postgresInitializeDSMForeignScan;
+	routine->ReInitializeDSMForeignScan = postgresReInitializeDSMForeignScan;
+	routine->InitializeWorkerForeignScan = postgresInitializeWorkerForeignScan;
+
 	PG_RETURN_POINTER(routine);
 }
 
@@ -1043,8 +1099,20 @@ postgresGetForeignPaths(PlannerInfo *root,
 								   NULL,	/* no extra plan */
 								   NIL, /* no fdw_restrictinfo list */
 								   NIL);	/* no fdw_private list */
+
+	/*
+	 * Only a partial path may be run in a parallel worker, because a worker
+	 * must see the same remote data as the leader, and only a parallel-aware
+	 * scan sets that up; see postgresInitializeDSMForeignScan().  The same
+	 * goes for all the other paths we create.
+	 */
+	path->path.parallel_safe = false;
 	add_path(baserel, (Path *) path);
 
+	/* If the table may be scanned in parallel, add a partial path */
+	if (baserel->consider_parallel && baserel->lateral_relids == NULL)
+		add_partial_foreign_path(root, baserel);
+
 	/* Add paths with pathkeys */
 	add_paths_with_pathkeys_for_rel(root, baserel, NULL, NIL);
 
@@ -1218,10 +1286,54 @@ postgresGetForeignPaths(PlannerInfo *root,
 									   NULL,
 									   NIL, /* no fdw_restrictinfo list */
 									   NIL);	/* no fdw_private list */
+		path->path.parallel_safe = false;
 		add_path(baserel, (Path *) path);
 	}
 }
 
+/*
+ * add_partial_foreign_path
+ *		Add a partial path for a parallel scan of the foreign table
+ *
+ * The participants each fetch different ranges of the remote table's blocks,
+ * so the remote work is divided among them as well as the local work.
+ */
+static void
+add_partial_foreign_path(PlannerInfo *root, RelOptInfo *baserel)
+{
+	PgFdwRelationInfo *fpinfo = (PgFdwRelationInfo *) baserel->fdw_private;
+	ForeignPath *path;
+	int			parallel_workers;
+	double		parallel_divisor;
+
+	parallel_workers = compute_parallel_worker(baserel, baserel->pages, -1,
+											   max_parallel_workers_per_gather);
+	if (parallel_workers <= 0)
+		return;
+
+	path = create_foreignscan_path(root, baserel,
+								   NULL,	/* default pathtarget */
+								   fpinfo->rows,
+								   fpinfo->disabled_nodes,
+								   fpinfo->startup_cost,
+								   fpinfo->total_cost,
+								   NIL, /* no pathkeys */
+								   NULL,	/* no outer rel */
+								   NULL,	/* no extra plan */
+								   NIL, /* no fdw_restrictinfo list */
+								   NIL);	/* no fdw_private list */
+	path->path.parallel_aware = true;
+	path->path.parallel_workers = parallel_workers;
+
+	/* Each participant handles its share of the rows */
+	parallel_divisor = get_parallel_divisor(&path->path);
+	path->path.rows = clamp_row_est(fpinfo->rows / parallel_divisor);
+	path->path.total_cost = fpinfo->startup_cost +
+		(fpinfo->total_cost - fpinfo->startup_cost) / parallel_divisor;
+
+	add_partial_path(baserel, (Path *) path);
+}
+
 /*
  * postgresGetForeignPlan
  *		Create ForeignScan plan node which implements selected best path
@@ -1409,6 +1521,21 @@ postgresGetForeignPlan(PlannerInfo *root,
 							has_final_sort, has_limit, false,
 							&retrieved_attrs, &params_list);
 
+	/*
+	 * A parallel scan fetches one range of remote blocks at a time.  The
+	 * bounds of the range are passed as two more parameters, after those of
+	 * the query proper; see create_cursor().
+	 */
+	if (best_path->path.parallel_aware)
+	{
+		int			nparams = list_length(params_list);
+
+		Assert(IS_SIMPLE_REL(foreignrel));
+		appendStringInfo(&sql,
+						 " %s ctid >= $%d::pg_catalog.tid AND ctid < $%d::pg_catalog.tid",
+						 remote_exprs ? "AND" : "WHERE", nparams + 1, nparams + 2);
+	}
+
 	/* Remember remote_exprs for possible use by postgresPlanDirectModify */
 	fpinfo->final_remote_exprs = remote_exprs;
 
@@ -1593,6 +1720,14 @@ postgresBeginForeignScan(ForeignScanState *node, int eflags)
 
 	/* Set the async-capable flag */
 	fsstate->async_capable = node->ss.ps.async_capable;
+
+	/*
+	 * A parallel scan gets its shared state later, if it runs in parallel at
+	 * all; without that, it just fetches the whole table in one range.
+	 */
+	fsstate->parallel = fsplan->scan.plan.parallel_aware;
+	fsstate->pscan = NULL;
+	fsstate->ranges_done = false;
 }
 
 /*
@@ -1610,15 +1745,20 @@ postgresIterateForeignScan(ForeignScanState *node)
 	 * In sync mode, if this is the first call after Begin or ReScan, we need
 	 * to create the cursor on the remote side.  In async mode, we would have
 	 * already created the cursor before we get here, even if this is the
-	 * first call after Begin or ReScan.
+	 * first call after Begin or ReScan.  In a parallel scan, the cursor
+	 * covers one range of remote blocks, which we claim first.
 	 */
 	if (!fsstate->cursor_exists)
+	{
+		if (fsstate->parallel && !claim_scan_range(fsstate))
+			return ExecClearTuple(slot);
 		create_cursor(node);
+	}
 
 	/*
 	 * Get some more tuples, if we've run out.
 	 */
-	if (fsstate->next_tuple >= fsstate->num_tuples)
+	while (fsstate->next_tuple >= fsstate->num_tuples)
 	{
 		/* In async mode, just clear tuple slot. */
 		if (fsstate->async_capable)
@@ -1626,9 +1766,19 @@ postgresIterateForeignScan(ForeignScanState *node)
 		/* No point in another fetch if we already detected EOF, though. */
 		if (!fsstate->eof_reached)
 			fetch_more_data(node);
+		if (fsstate->next_tuple < fsstate->num_tuples)
+			break;
 		/* If we didn't get any tuples, must be end of data. */
-		if (fsstate->next_tuple >= fsstate->num_tuples)
+		if (!fsstate->parallel)
+			return ExecClearTuple(slot);
+
+		/* In a parallel scan, move on to the next range, if any is left */
+		close_cursor(fsstate->conn, fsstate->cursor_number,
+					 fsstate->conn_state);
+		fsstate->cursor_exists = false;
+		if (!claim_scan_range(fsstate))
 			return ExecClearTuple(slot);
+		create_cursor(node);
 	}
 
 	/*
@@ -1652,6 +1802,22 @@ postgresReScanForeignScan(ForeignScanState *node)
 	char		sql[64];
 	PGresult   *res;
 
+	/*
+	 * A parallel scan starts over from the first range of blocks, which might
+	 * not be the one we have fetched, so always get rid of the cursor.
+	 */
+	if (fsstate->parallel)
+	{
+		fsstate->ranges_done = false;
+		if (fsstate->cursor_exists)
+		{
+			close_cursor(fsstate->conn, fsstate->cursor_number,
+						 fsstate->conn_state);
+			fsstate->cursor_exists = false;
+		}
+		return;
+	}
+
 	/* If we haven't created the cursor yet, nothing to do. */
 	if (!fsstate->cursor_exists)
 		return;
@@ -1810,8 +1976,8 @@ postgresPlanForeignModify(PlannerInfo *root,
 	 */
 	if (operation == CMD_INSERT ||
 		(operation == CMD_UPDATE &&
-		 rel->trigdesc &&
-		 rel->trigdesc->trig_update_before_row))
+		 RelationGetTriggerDesc(rel) &&
+		 RelationGetTriggerDesc(rel)->trig_update_before_row))
 	{
 		TupleDesc	tupdesc = RelationGetDescr(rel);
 		int			attnum;
@@ -1961,6 +2127,14 @@ postgresBeginForeignModify(ModifyTableState *mtstate,
 									has_returning,
 									retrieved_attrs);
 
+	/*
+	 * With ON CONFLICT DO NOTHING, we need to know how many rows the remote
+	 * server actually inserted, so don't pipeline the inserts.
+	 */
+	if (castNode(ModifyTable, mtstate->ps.plan)->onConflictAction ==
+		ONCONFLICT_NOTHING)
+		fmstate->pipeline_depth = 1;
+
 	resultRelInfo->ri_FdwState = fmstate;
 }
 
@@ -2265,6 +2439,10 @@ postgresBeginForeignInsert(ModifyTableState *mtstate,
 									retrieved_attrs != NIL,
 									retrieved_attrs);
 
+	/* As in postgresBeginForeignModify, don't pipeline with DO NOTHING */
+	if (doNothing)
+		fmstate->pipeline_depth = 1;
+
 	/*
 	 * If the given resultRelInfo already has PgFdwModifyState set, it means
 	 * the foreign table is an UPDATE subplan result rel; in which case, store
@@ -3735,6 +3913,9 @@ create_cursor(ForeignScanState *node)
 	/* First, process a pending asynchronous request, if any. */
 	if (fsstate->conn_state->pendingAreq)
 		process_pending_request(fsstate->conn_state->pendingAreq);
+	/* Likewise, collect the results of pipelined commands, if any. */
+	if (fsstate->conn_state->numPipelined > 0)
+		pgfdw_get_pipelined_results(conn, fsstate->conn_state, 0);
 
 	/*
 	 * Construct array of query parameter values in text format.  We do the
@@ -3755,6 +3936,30 @@ create_cursor(ForeignScanState *node)
 		MemoryContextSwitchTo(oldcontext);
 	}
 
+	/*
+	 * In a parallel scan, add the bounds of the range of remote blocks to
+	 * fetch.  InvalidBlockNumber is larger than any valid block number, so it
+	 * works as the upper bound of an open-ended range.
+	 */
+	if (fsstate->parallel)
+	{
+		MemoryContext oldcontext;
+		const char **range_values;
+
+		oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+		range_values = palloc_array(const char *, numParams + 2);
+		if (numParams > 0)
+			memcpy(range_values, values, numParams * sizeof(char *));
+		range_values[numParams] = psprintf("(%u,0)", fsstate->range_start);
+		range_values[numParams + 1] = psprintf("(%u,0)", fsstate->range_end);
+
+		MemoryContextSwitchTo(oldcontext);
+
+		values = range_values;
+		numParams += 2;
+	}
+
 	/* Construct the DECLARE CURSOR command */
 	initStringInfo(&buf);
 	appendStringInfo(&buf, "DECLARE c%u CURSOR FOR\n%s",
@@ -3948,6 +4153,45 @@ close_cursor(PGconn *conn, unsigned int cursor_number,
 	PQclear(res);
 }
 
+/*
+ * Claim the next range of remote blocks for a parallel scan to fetch, and
+ * store it in fsstate.  Returns false if there is none left.
+ */
+static bool
+claim_scan_range(PgFdwScanState *fsstate)
+{
+	PgFdwParallelScanState *pscan = fsstate->pscan;
+	uint32		range;
+
+	if (fsstate->ranges_done)
+		return false;
+
+	/* Without shared state, we are on our own; fetch the whole table */
+	if (pscan == NULL)
+	{
+		fsstate->range_start = 0;
+		fsstate->range_end = InvalidBlockNumber;
+		fsstate->ranges_done = true;
+		return true;
+	}
+
+	range = pg_atomic_fetch_add_u32(&pscan->next_range, 1);
+	if (range >= pscan->nranges)
+	{
+		fsstate->ranges_done = true;
+		return false;
+	}
+
+	/* The last range also covers any blocks added since we looked */
+	fsstate->range_start = range * pscan->range_blocks;
+	if (range == pscan->nranges - 1)
+		fsstate->range_end = InvalidBlockNumber;
+	else
+		fsstate->range_end = fsstate->range_start + pscan->range_blocks;
+
+	return true;
+}
+
 /*
  * create_foreign_modify
  *		Construct an execution state of a foreign insert/update/delete
@@ -4054,9 +4298,18 @@ create_foreign_modify(EState *estate,
 
 	Assert(fmstate->p_nums <= n_params);
 
-	/* Set batch_size from foreign server/table options. */
+	/*
+	 * Set batch_size and pipeline_depth from foreign server/table options.
+	 * An INSERT with RETURNING can't be pipelined, since we need its result
+	 * straight away.
+	 */
+	fmstate->pipeline_depth = 1;
 	if (operation == CMD_INSERT)
+	{
 		fmstate->batch_size = get_batch_size_option(rel);
+		if (!has_returning)
+			fmstate->pipeline_depth = get_pipeline_depth_option(rel);
+	}
 
 	fmstate->num_slots = 1;
 
@@ -4087,6 +4340,7 @@ execute_foreign_modify(EState *estate,
 	PGresult   *res;
 	int			n_rows;
 	StringInfoData sql;
+	PgFdwConnState *conn_state = fmstate->conn_state;
 
 	/* The operation should be INSERT, UPDATE, or DELETE */
 	Assert(operation == CMD_INSERT ||
@@ -4094,8 +4348,17 @@ execute_foreign_modify(EState *estate,
 		   operation == CMD_DELETE);
 
 	/* First, process a pending asynchronous request, if any. */
-	if (fmstate->conn_state->pendingAreq)
-		process_pending_request(fmstate->conn_state->pendingAreq);
+	if (conn_state->pendingAreq)
+		process_pending_request(conn_state->pendingAreq);
+
+	/*
+	 * Likewise, collect the results of commands pipelined on the connection,
+	 * unless they are our own and we're going to add to them.
+	 */
+	if (conn_state->numPipelined > 0 &&
+		(fmstate->pipeline_depth <= 1 ||
+		 conn_state->pipelinedSql != fmstate->query))
+		pgfdw_get_pipelined_results(fmstate->conn, conn_state, 0);
 
 	/*
 	 * If the existing query was deparsed and prepared for a different number
@@ -4103,6 +4366,10 @@ execute_foreign_modify(EState *estate,
 	 */
 	if (operation == CMD_INSERT && fmstate->num_slots != *numSlots)
 	{
+		/* The query text is about to go away; finish using it first */
+		if (conn_state->numPipelined > 0)
+			pgfdw_get_pipelined_results(fmstate->conn, conn_state, 0);
+
 		/* Destroy the prepared statement created previously */
 		if (fmstate->p_name)
 			deallocate_query(fmstate);
@@ -4142,6 +4409,40 @@ execute_foreign_modify(EState *estate,
 	/* Convert parameters needed by prepared statement to text form */
 	p_values = convert_prep_stmt_params(fmstate, ctid, slots, *numSlots);
 
+	/*
+	 * If pipelining is enabled, send the statement in pipeline mode and
+	 * return without waiting for its result, unless too many are already in
+	 * flight.  Any error is then reported by a later call, or at the latest
+	 * by finish_foreign_modify().  Since we don't know how many rows the
+	 * remote server will actually insert, we assume that all of them are.
+	 */
+	if (fmstate->pipeline_depth > 1)
+	{
+		if (PQpipelineStatus(fmstate->conn) == PQ_PIPELINE_OFF &&
+			!PQenterPipelineMode(fmstate->conn))
+			pgfdw_report_error(NULL, fmstate->conn, fmstate->query);
+
+		if (!PQsendQueryPrepared(fmstate->conn,
+								 fmstate->p_name,
+								 fmstate->p_nums * (*numSlots),
+								 p_values,
+								 NULL,
+								 NULL,
+								 0) ||
+			!PQpipelineSync(fmstate->conn))
+			pgfdw_report_error(NULL, fmstate->conn, fmstate->query);
+
+		conn_state->numPipelined++;
+		conn_state->pipelinedSql = fmstate->query;
+
+		pgfdw_get_pipelined_results(fmstate->conn, conn_state,
+									fmstate->pipeline_depth - 1);
+
+		MemoryContextReset(fmstate->temp_cxt);
+
+		return slots;
+	}
+
 	/*
 	 * Execute the prepared statement.
 	 */
@@ -4347,6 +4648,10 @@ finish_foreign_modify(PgFdwModifyState *fmstate)
 {
 	Assert(fmstate != NULL);
 
+	/* Collect the results of any statements still in flight */
+	if (fmstate->conn_state->numPipelined > 0)
+		pgfdw_get_pipelined_results(fmstate->conn, fmstate->conn_state, 0);
+
 	/* If we created a prepared statement, destroy it */
 	deallocate_query(fmstate);
 
@@ -4522,6 +4827,9 @@ execute_dml_stmt(ForeignScanState *node)
 	/* First, process a pending asynchronous request, if any. */
 	if (dmstate->conn_state->pendingAreq)
 		process_pending_request(dmstate->conn_state->pendingAreq);
+	/* Likewise, collect the results of pipelined commands, if any. */
+	if (dmstate->conn_state->numPipelined > 0)
+		pgfdw_get_pipelined_results(dmstate->conn, dmstate->conn_state, 0);
 
 	/*
 	 * Construct array of query parameter values in text format.
@@ -6084,6 +6392,7 @@ add_paths_with_pathkeys_for_rel(PlannerInfo *root, RelOptInfo *rel,
 		Cost		total_cost;
 		List	   *useful_pathkeys = lfirst(lc);
 		Path	   *sorted_epq_path;
+		Path	   *path;
 
 		estimate_path_cost_size(root, rel, NIL, useful_pathkeys, NULL,
 								&rows, &width, &disabled_nodes,
@@ -6105,32 +6414,34 @@ add_paths_with_pathkeys_for_rel(PlannerInfo *root, RelOptInfo *rel,
 								 -1.0);
 
 		if (IS_SIMPLE_REL(rel))
-			add_path(rel, (Path *)
-					 create_foreignscan_path(root, rel,
-											 NULL,
-											 rows,
-											 disabled_nodes,
-											 startup_cost,
-											 total_cost,
-											 useful_pathkeys,
-											 rel->lateral_relids,
-											 sorted_epq_path,
-											 NIL,	/* no fdw_restrictinfo
-													 * list */
-											 NIL));
+			path = (Path *)
+				create_foreignscan_path(root, rel,
+										NULL,
+										rows,
+										disabled_nodes,
+										startup_cost,
+										total_cost,
+										useful_pathkeys,
+										rel->lateral_relids,
+										sorted_epq_path,
+										NIL,	/* no fdw_restrictinfo list */
+										NIL);
 		else
-			add_path(rel, (Path *)
-					 create_foreign_join_path(root, rel,
-											  NULL,
-											  rows,
-											  disabled_nodes,
-											  startup_cost,
-											  total_cost,
-											  useful_pathkeys,
-											  rel->lateral_relids,
-											  sorted_epq_path,
-											  restrictlist,
-											  NIL));
+			path = (Path *)
+				create_foreign_join_path(root, rel,
+										 NULL,
+										 rows,
+										 disabled_nodes,
+										 startup_cost,
+										 total_cost,
+										 useful_pathkeys,
+										 rel->lateral_relids,
+										 sorted_epq_path,
+										 restrictlist,
+										 NIL);
+		/* See postgresGetForeignPaths */
+		path->parallel_safe = false;
+		add_path(rel, path);
 	}
 }
 
@@ -6389,6 +6700,9 @@ postgresGetForeignJoinPaths(PlannerInfo *root,
 										extra->restrictlist,
 										NIL);	/* no fdw_private */
 
+	/* See postgresGetForeignPaths */
+	joinpath->path.parallel_safe = false;
+
 	/* Add generated path into joinrel by add_path(). */
 	add_path(joinrel, (Path *) joinpath);
 
@@ -6782,6 +7096,9 @@ add_foreign_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 										  NIL,	/* no fdw_restrictinfo list */
 										  NIL); /* no fdw_private */
 
+	/* See postgresGetForeignPaths */
+	grouppath->path.parallel_safe = false;
+
 	/* Add generated path into grouped_rel by add_path(). */
 	add_path(grouped_rel, (Path *) grouppath);
 }
@@ -7405,6 +7722,8 @@ fetch_more_data_begin(AsyncRequest *areq)
 	/* Create the cursor synchronously. */
 	if (!fsstate->cursor_exists)
 		create_cursor(node);
+	else if (fsstate->conn_state->numPipelined > 0)
+		pgfdw_get_pipelined_results(fsstate->conn, fsstate->conn_state, 0);
 
 	/* We will send this query, but not wait for the response. */
 	snprintf(sql, sizeof(sql), "FETCH %d FROM c%u",
@@ -7474,6 +7793,153 @@ complete_pending_request(AsyncRequest *areq)
 							  TupIsNull(areq->result) ? 0.0 : 1.0);
 }
 
+/*
+ * postgresIsForeignScanParallelSafe
+ *		Determine whether a foreign scan may be run in parallel workers
+ */
+static bool
+postgresIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
+								  RangeTblEntry *rte)
+{
+	/*
+	 * This is called before postgresGetForeignRelSize(), so we look up the
+	 * option ourselves.
+	 */
+	return get_parallel_scan_option(rte->relid);
+}
+
+/*
+ * postgresEstimateDSMForeignScan
+ *		Estimate the size of the shared state of a parallel scan
+ */
+static Size
+postgresEstimateDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt)
+{
+	return sizeof(PgFdwParallelScanState);
+}
+
+/*
+ * postgresInitializeDSMForeignScan
+ *		Set up the shared state of a parallel scan
+ *
+ * We divide the remote table into ranges of blocks, and export the snapshot
+ * of our remote transaction for the workers to import.  That is only
+ * possible if the remote transaction is not in a subtransaction, and only
+ * useful if it hasn't written anything, since the writes would not be
+ * visible to the transactions importing the snapshot.  Also, the remote
+ * server must be v14 or later to fetch a range of blocks efficiently with a
+ * TID range scan.  If any of that doesn't hold, we don't let any workers be
+ * launched at all, and scan the table alone.
+ */
+static void
+postgresInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+								 void *coordinate)
+{
+	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
+	PgFdwParallelScanState *pscan = (PgFdwParallelScanState *) coordinate;
+	PGconn	   *conn = fsstate->conn;
+	bool		try_export;
+	BlockNumber nblocks;
+	BlockNumber range_blocks;
+	StringInfoData sql;
+	PGresult   *res;
+
+	try_export = (PQserverVersion(conn) >= 140000 &&
+				  GetCurrentTransactionNestLevel() == 1);
+
+	initStringInfo(&sql);
+	deparseAnalyzeSizeSql(&sql, fsstate->rel);
+	if (try_export)
+		appendStringInfoString(&sql, ", CASE WHEN pg_catalog.pg_current_xact_id_if_assigned() IS NULL THEN pg_catalog.pg_export_snapshot() END");
+
+	res = pgfdw_exec_query(conn, sql.data, fsstate->conn_state);
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		pgfdw_report_error(res, conn, sql.data);
+	if (PQntuples(res) != 1 || PQnfields(res) != (try_export ? 2 : 1))
+		elog(ERROR, "unexpected result from parallel scan setup query");
+
+	nblocks = strtoul(PQgetvalue(res, 0, 0), NULL, 10);
+	pscan->snapshot[0] = '\0';
+	if (try_export && !PQgetisnull(res, 0, 1))
+		strlcpy(pscan->snapshot, PQgetvalue(res, 0, 1),
+				sizeof(pscan->snapshot));
+	PQclear(res);
+	pfree(sql.data);
+
+	/*
+	 * Make several ranges for each participant, so that they finish at about
+	 * the same time, but not so small that the per-range overhead of opening
+	 * a cursor dominates.
+	 */
+	range_blocks = nblocks / ((pcxt->nworkers + 1) *
+							  PARALLEL_SCAN_RANGES_PER_PARTICIPANT);
+	range_blocks = Max(range_blocks, PARALLEL_SCAN_MIN_RANGE_BLOCKS);
+	pscan->range_blocks = range_blocks;
+	pscan->nranges = Max((nblocks + range_blocks - 1) / range_blocks, 1);
+	pg_atomic_init_u32(&pscan->next_range, 0);
+
+	fsstate->pscan = pscan;
+
+	if (pscan->snapshot[0] == '\0')
+		ReinitializeParallelWorkers(pcxt, 0);
+}
+
+/*
+ * postgresReInitializeDSMForeignScan
+ *		Reset the shared state of a parallel scan for a rescan
+ */
+static void
+postgresReInitializeDSMForeignScan(ForeignScanState *node,
+								   ParallelContext *pcxt, void *coordinate)
+{
+	PgFdwParallelScanState *pscan = (PgFdwParallelScanState *) coordinate;
+
+	pg_atomic_write_u32(&pscan->next_range, 0);
+}
+
+/*
+ * postgresInitializeWorkerForeignScan
+ *		Attach a parallel worker to the shared state of a parallel scan
+ */
+static void
+postgresInitializeWorkerForeignScan(ForeignScanState *node, shm_toc *toc,
+									void *coordinate)
+{
+	PgFdwScanState *fsstate = (PgFdwScanState *) node->fdw_state;
+	PgFdwParallelScanState *pscan = (PgFdwParallelScanState *) coordinate;
+	PgFdwConnState *conn_state = fsstate->conn_state;
+
+	/* The leader doesn't launch workers without a snapshot to import */
+	Assert(pscan->snapshot[0] != '\0');
+
+	fsstate->pscan = pscan;
+
+	/*
+	 * Make our remote transaction see the same data as the leader's.  This
+	 * must happen before anything else is done in it, which is the case as
+	 * our connection was set up by postgresBeginForeignScan() in this very
+	 * worker.  Other scans sharing the connection import the same snapshot,
+	 * so only the first one needs to.
+	 */
+	if (!conn_state->importedSnapshot)
+	{
+		StringInfoData sql;
+		PGresult   *res;
+
+		initStringInfo(&sql);
+		appendStringInfoString(&sql, "SET TRANSACTION SNAPSHOT ");
+		deparseStringLiteral(&sql, pscan->snapshot);
+
+		res = pgfdw_exec_query(fsstate->conn, sql.data, conn_state);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			pgfdw_report_error(res, fsstate->conn, sql.data);
+		PQclear(res);
+		pfree(sql.data);
+
+		conn_state->importedSnapshot = true;
+	}
+}
+
 /*
  * Create a tuple from the specified row of the PGresult.
  *
@@ -7886,3 +8352,76 @@ get_batch_size_option(Relation rel)
 
 	return batch_size;
 }
+
+/*
+ * Determine the number of INSERT statements that may be pipelined for a
+ * given foreign table.  The option specified for a table has precedence.
+ */
+static int
+get_pipeline_depth_option(Relation rel)
+{
+	Oid			foreigntableid = RelationGetRelid(rel);
+	ForeignTable *table;
+	ForeignServer *server;
+	List	   *options;
+	ListCell   *lc;
+
+	/* we use 1 by default, which means "no pipelining" */
+	int			pipeline_depth = 1;
+
+	table = GetForeignTable(foreigntableid);
+	server = GetForeignServer(table->serverid);
+
+	options = NIL;
+	options = list_concat(options, table->options);
+	options = list_concat(options, server->options);
+
+	foreach(lc, options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "pipeline_depth") == 0)
+		{
+			(void) parse_int(defGetString(def), &pipeline_depth, 0, NULL);
+			break;
+		}
+	}
+
+	return pipeline_depth;
+}
+
+/*
+ * Determine whether a given foreign table may be scanned in parallel.  The
+ * option specified for a table has precedence.
+ */
+static bool
+get_parallel_scan_option(Oid foreigntableid)
+{
+	ForeignTable *table;
+	ForeignServer *server;
+	List	   *options;
+	ListCell   *lc;
+
+	/* we don't scan in parallel by default */
+	bool		parallel_scan = false;
+
+	table = GetForeignTable(foreigntableid);
+	server = GetForeignServer(table->serverid);
+
+	options = NIL;
+	options = list_concat(options, table->options);
+	options = list_concat(options, server->options);
+
+	foreach(lc, options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "parallel_scan") == 0)
+		{
+			parallel_scan = defGetBoolean(def);
+			break;
+		}
+	}
+
+	return parallel_scan;
+}
@@ -137,6 +137,10 @@ typedef struct PgFdwRelationInfo
 typedef struct PgFdwConnState
 {
 	AsyncRequest *pendingAreq;	/* pending async request */
+	int			numPipelined;	/* # of pipelined commands not yet read */
+	const char *pipelinedSql;	/* text of those commands */
+	bool		importedSnapshot;	/* imported the leader's snapshot? (only
+									 * in a parallel worker) */
 } PgFdwConnState;
 
 /*
@@ -166,6 +170,8 @@ extern void do_sql_command(PGconn *conn, const char *sql);
 extern PGresult *pgfdw_get_result(PGconn *conn);
 extern PGresult *pgfdw_exec_query(PGconn *conn, const char *query,
 								  PgFdwConnState *state);
+extern void pgfdw_get_pipelined_results(PGconn *conn, PgFdwConnState *state,
+										int max_pending);
 pg_noreturn extern void pgfdw_report_error(PGresult *res, PGconn *conn,
 										   const char *sql);
 extern void pgfdw_report(int elevel, PGresult *res, PGconn *conn,
@@ -3682,6 +3682,21 @@ DROP TRIGGER trig_row_before ON ftable;
 DROP FOREIGN TABLE ftable;
 DROP TABLE batch_table;
 
+-- Test pipelined batch inserts
+CREATE TABLE batch_table ( x int PRIMARY KEY );
+CREATE FOREIGN TABLE ftable ( x int ) SERVER loopback
+	OPTIONS ( table_name 'batch_table', batch_size '3', pipeline_depth '4' );
+INSERT INTO ftable SELECT * FROM generate_series(1, 20) i;
+SELECT COUNT(*), SUM(x) FROM ftable;
+-- Scan the same foreign table while inserting into it
+INSERT INTO ftable SELECT x + 20 FROM ftable;
+SELECT COUNT(*), SUM(x) FROM ftable;
+-- An error in any of the statements in flight is reported
+INSERT INTO ftable SELECT * FROM generate_series(35, 50) i;
+SELECT COUNT(*) FROM ftable;
+DROP FOREIGN TABLE ftable;
+DROP TABLE batch_table;
+
 -- Use partitioning
 CREATE TABLE batch_table ( x int ) PARTITION BY HASH (x);
 
@@ -3878,6 +3893,43 @@ DROP TABLE ltable;
 DROP TABLE parent;
 DROP FUNCTION ftable_rowcount_trigf;
 
+-- ===================================================================
+-- test parallel scans
+-- ===================================================================
+
+CREATE TABLE base_ptbl (a int, b text);
+INSERT INTO base_ptbl SELECT i, 'row ' || i FROM generate_series(1, 5000) i;
+CREATE FOREIGN TABLE ptbl (a int, b text)
+  SERVER loopback OPTIONS (table_name 'base_ptbl', parallel_scan 'true');
+ANALYZE ptbl;
+-- a function that can't be shipped, so that the aggregate is done locally
+CREATE FUNCTION ptbl_twice(int) RETURNS int LANGUAGE plpgsql
+  IMMUTABLE PARALLEL SAFE AS $$ BEGIN RETURN $1 * 2; END $$;
+
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT count(*), sum(ptbl_twice(a)) FROM ptbl;
+SELECT count(*), sum(ptbl_twice(a)) FROM ptbl;
+
+-- After a remote write, the workers couldn't see the same data as the
+-- leader, so the leader scans the table alone
+BEGIN;
+INSERT INTO ptbl VALUES (5001, 'row 5001');
+SELECT count(*), sum(ptbl_twice(a)) FROM ptbl;
+ROLLBACK;
+
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
+DROP FUNCTION ptbl_twice(int);
+DROP FOREIGN TABLE ptbl;
+DROP TABLE base_ptbl;
+
 -- ===================================================================
 -- test asynchronous execution
 -- ===================================================================
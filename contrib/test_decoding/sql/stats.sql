@@ -31,7 +31,8 @@ SELECT * FROM pg_stat_get_replication_slot('do-not-exist');
 SELECT pg_stat_reset_replication_slot('do-not-exist');
 SELECT * FROM pg_stat_get_replication_slot('do-not-exist');
 
--- spilling the xact
+-- spilling the xact, with compressed spill files
+SET logical_decoding_spill_compression = pglz;
 BEGIN;
 INSERT INTO stats_test SELECT 'serialize-topbig--1:'||g.i FROM generate_series(1, 5000) g(i);
 COMMIT;
@@ -41,8 +42,8 @@ SELECT count(*) FROM pg_logical_slot_peek_changes('regression_slot_stats1', NULL
 -- background transaction (say by autovacuum) happens in parallel to the main
 -- transaction.
 SELECT pg_stat_force_next_flush();
-SELECT slot_name, spill_txns > 0 AS spill_txns, spill_count > 0 AS spill_count, mem_exceeded_count > 0 AS mem_exceeded_count FROM pg_stat_replication_slots;
-
+SELECT slot_name, spill_txns > 0 AS spill_txns, spill_count > 0 AS spill_count, spill_compressed_bytes BETWEEN 1 AND spill_bytes AS spill_compressed_bytes, mem_exceeded_count > 0 AS mem_exceeded_count FROM pg_stat_replication_slots;
+RESET logical_decoding_spill_compression;
 -- Ensure stats can be repeatedly accessed using the same stats snapshot. See
 -- https://postgr.es/m/20210317230447.c7uc4g3vbs4wi32i%40alap3.anarazel.de
 BEGIN;
@@ -36,9 +36,11 @@
 #include "tcop/tcopprot.h"
 #include "utils/acl.h"
 #include "utils/datum.h"
+#include "utils/fmgroids.h"
 #include "utils/fmgrprotos.h"
 #include "utils/guc.h"
 #include "utils/index_selfuncs.h"
+#include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/tuplesort.h"
@@ -281,6 +283,7 @@ brinhandler(PG_FUNCTION_ARGS)
 	amroutine->ambuildempty = brinbuildempty;
 	amroutine->aminsert = brininsert;
 	amroutine->aminsertcleanup = brininsertcleanup;
+	amroutine->aminsertbatch = NULL;
 	amroutine->ambulkdelete = brinbulkdelete;
 	amroutine->amvacuumcleanup = brinvacuumcleanup;
 	amroutine->amcanreturn = NULL;
@@ -1662,6 +1665,115 @@ brinGetStats(Relation index, BrinStatsData *stats)
 	UnlockReleaseBuffer(metabuffer);
 }
 
+/*
+ * Compute a bound for MIN() or MAX() of an index column from the summaries of
+ * a minmax opclass, for the planner's benefit (see planagg.c).
+ *
+ * Considers either the upper ('upper' true) or the lower bounds of all
+ * summarized, non-empty page ranges, and stores into *bound the one that
+ * sorts first according to 'sortop'.  With "<" and the upper bounds, say,
+ * that's the least range maximum: the range it belongs to has no values
+ * above it, so MIN() is at most that value unless all the tuples that
+ * produced the summaries have since been deleted.  Summaries aren't
+ * narrowed by deletions, so the caller must be prepared for that.
+ *
+ * The result is allocated in the caller's memory context.  Returns false if
+ * there is no bound to report, including when the column doesn't use a
+ * minmax opclass or the index is too large to be read in full.
+ */
+bool
+brinGetMinMaxBound(Relation heapRel, Relation index, AttrNumber attno,
+				   Oid sortop, bool upper, Datum *bound)
+{
+	BrinDesc   *bdesc;
+	BrinRevmap *revmap;
+	BlockNumber pagesPerRange;
+	BlockNumber nblocks;
+	BrinTuple  *btup = NULL;
+	Size		btupsz = 0;
+	BrinMemTuple *dtup = NULL;
+	Buffer		buf = InvalidBuffer;
+	TypeCacheEntry *typcache;
+	FmgrInfo	cmpfn;
+	Oid			collation;
+	MemoryContext boundCxt;
+	MemoryContext oldCxt;
+	Datum		best = (Datum) 0;
+	bool		found = false;
+
+	/* Only the minmax opclasses store plain lower and upper bounds */
+	if (index_getprocid(index, attno, BRIN_PROCNUM_OPCINFO) !=
+		F_BRIN_MINMAX_OPCINFO)
+		return false;
+
+	/*
+	 * We have to look at every summary, which is only cheap enough if the
+	 * index is small.
+	 */
+	if (RelationGetNumberOfBlocks(index) > BRIN_MINMAX_BOUND_MAX_PAGES)
+		return false;
+
+	boundCxt = AllocSetContextCreate(CurrentMemoryContext,
+									 "brin minmax bound",
+									 ALLOCSET_DEFAULT_SIZES);
+	oldCxt = MemoryContextSwitchTo(boundCxt);
+
+	bdesc = brin_build_desc(index);
+	typcache = bdesc->bd_info[attno - 1]->oi_typcache[0];
+	collation = index->rd_indcollation[attno - 1];
+	fmgr_info(get_opcode(sortop), &cmpfn);
+
+	revmap = brinRevmapInitialize(index, &pagesPerRange);
+	nblocks = RelationGetNumberOfBlocks(heapRel);
+
+	/* cf. bringetbitmap() */
+	for (uint64 heapBlk = 0; heapBlk < nblocks; heapBlk += pagesPerRange)
+	{
+		BrinTuple  *tup;
+		BrinValues *bval;
+		OffsetNumber off;
+		Size		size;
+		Datum		value;
+
+		CHECK_FOR_INTERRUPTS();
+
+		tup = brinGetTupleForHeapBlock(revmap, (BlockNumber) heapBlk, &buf,
+									   &off, &size, BUFFER_LOCK_SHARE);
+		if (!tup)
+			continue;
+		btup = brin_copy_tuple(tup, size, btup, &btupsz);
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+
+		dtup = brin_deform_tuple(bdesc, btup, dtup);
+		if (dtup->bt_placeholder || dtup->bt_empty_range)
+			continue;
+
+		bval = &dtup->bt_columns[attno - 1];
+		if (bval->bv_allnulls)
+			continue;
+
+		value = bval->bv_values[upper ? 1 : 0];
+		if (!found ||
+			DatumGetBool(FunctionCall2Coll(&cmpfn, collation, value, best)))
+		{
+			/* the deformed tuple is overwritten by the next one */
+			best = datumCopy(value, typcache->typbyval, typcache->typlen);
+			found = true;
+		}
+	}
+
+	if (BufferIsValid(buf))
+		ReleaseBuffer(buf);
+	brinRevmapTerminate(revmap);
+
+	MemoryContextSwitchTo(oldCxt);
+	if (found)
+		*bound = datumCopy(best, typcache->typbyval, typcache->typlen);
+	MemoryContextDelete(boundCxt);
+
+	return found;
+}
+
 /*
  * Initialize a BrinBuildState appropriate to create tuples on the given index.
  */
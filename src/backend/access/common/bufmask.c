@@ -54,6 +54,9 @@ mask_page_hint_bits(Page page)
 	PageClearFull(page);
 	PageClearHasFreeLinePointers(page);
 
+	/* PD_COMPRESSED depends on each server's own history of writes. */
+	phdr->pd_flags &= ~PD_COMPRESSED;
+
 	/*
 	 * During replay, if the page LSN has advanced past our XLOG record's LSN,
 	 * we don't mark the page all-visible. See heap_xlog_visible() for
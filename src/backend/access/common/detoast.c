@@ -19,9 +19,48 @@
 #include "access/toast_internals.h"
 #include "common/int.h"
 #include "common/pg_lzcompress.h"
+#include "lib/ilist.h"
 #include "utils/expandeddatum.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
 
+/*
+ * A cache of detoasted values, see detoast_cache_create().  Entries are kept
+ * in a hash table keyed by the toast pointer, and in a list ordered from the
+ * most to the least recently used.
+ */
+typedef struct DetoastCacheKey
+{
+	Oid			toastrelid;
+	Oid			valueid;
+} DetoastCacheKey;
+
+typedef struct DetoastCacheEntry
+{
+	DetoastCacheKey key;		/* hash key, must be first */
+	dlist_node	node;			/* link in lru list */
+	struct varlena *value;		/* detoasted value */
+} DetoastCacheEntry;
+
+struct DetoastCache
+{
+	MemoryContext parent;		/* context to create the cache's context in */
+	MemoryContext cxt;			/* holds the hash table and the values */
+	HTAB	   *hash;			/* NULL until the first value is added */
+	dlist_head	lru;			/* entries, most recently used first */
+	Size		limit;			/* maximum total size of the values */
+	Size		size;			/* current total size of the values */
+};
+
+/* The cache used by detoast_attr(), if any */
+static DetoastCache *active_detoast_cache = NULL;
+
+static struct varlena *detoast_cache_lookup(DetoastCache *cache,
+											struct varatt_external *toast_pointer);
+static void detoast_cache_insert(DetoastCache *cache,
+								 struct varatt_external *toast_pointer,
+								 struct varlena *value);
 static struct varlena *toast_fetch_datum(struct varlena *attr);
 static struct varlena *toast_fetch_datum_slice(struct varlena *attr,
 											   int32 sliceoffset,
@@ -117,6 +156,20 @@ detoast_attr(struct varlena *attr)
 {
 	if (VARATT_IS_EXTERNAL_ONDISK(attr))
 	{
+		DetoastCache *cache = active_detoast_cache;
+		struct varatt_external toast_pointer;
+
+		/* Maybe we've seen this value before */
+		if (cache != NULL)
+		{
+			struct varlena *result;
+
+			VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+			result = detoast_cache_lookup(cache, &toast_pointer);
+			if (result != NULL)
+				return result;
+		}
+
 		/*
 		 * This is an externally stored datum --- fetch it back from there
 		 */
@@ -129,6 +182,9 @@ detoast_attr(struct varlena *attr)
 			attr = toast_decompress_datum(tmp);
 			pfree(tmp);
 		}
+
+		if (cache != NULL)
+			detoast_cache_insert(cache, &toast_pointer, attr);
 	}
 	else if (VARATT_IS_EXTERNAL_INDIRECT(attr))
 	{
@@ -191,6 +247,167 @@ detoast_attr(struct varlena *attr)
 }
 
 
+/* ----------
+ * detoast_cache_create -
+ *
+ *	Create a cache of detoasted values, holding up to 'limit' bytes of them.
+ *	While it's active, detoast_attr() keeps the values it fetches from toast
+ *	relations in it, and looks there before fetching a value again.  The
+ *	executor uses one per query, so that a value referenced from several
+ *	places in a query, or detoasted by several functions, is only fetched and
+ *	decompressed once.  Once the limit is reached, the least recently used
+ *	values are evicted.
+ *
+ *	The contents of a toast value never change, so a toast pointer identifies
+ *	it for at least as long as the snapshot used to find the pointer.
+ *
+ *	The cache is allocated in 'parent', which must outlive its use; the
+ *	memory for the values is only allocated when the first one is added.
+ * ----------
+ */
+DetoastCache *
+detoast_cache_create(MemoryContext parent, Size limit)
+{
+	DetoastCache *cache;
+
+	cache = MemoryContextAllocZero(parent, sizeof(DetoastCache));
+	cache->parent = parent;
+	cache->limit = limit;
+	dlist_init(&cache->lru);
+
+	return cache;
+}
+
+/* ----------
+ * detoast_cache_activate -
+ *
+ *	Make detoast_attr() use the given cache, or none if it's NULL, and return
+ *	the one that was active before, for the caller to restore when done.
+ *	Transaction and subtransaction abort deactivate the cache.
+ * ----------
+ */
+DetoastCache *
+detoast_cache_activate(DetoastCache *cache)
+{
+	DetoastCache *prev = active_detoast_cache;
+
+	active_detoast_cache = cache;
+	return prev;
+}
+
+/* ----------
+ * detoast_cache_reset -
+ *
+ *	Forget all the values in the cache, so that it can be used again under a
+ *	different snapshot.
+ * ----------
+ */
+void
+detoast_cache_reset(DetoastCache *cache)
+{
+	if (cache->cxt != NULL)
+		MemoryContextDelete(cache->cxt);
+	cache->cxt = NULL;
+	cache->hash = NULL;
+	dlist_init(&cache->lru);
+	cache->size = 0;
+}
+
+/*
+ * AtAbort_DetoastCache
+ *		Forget the active cache, which may have been freed by the abort.
+ */
+void
+AtAbort_DetoastCache(void)
+{
+	active_detoast_cache = NULL;
+}
+
+/*
+ * Return a palloc'd copy of a cached value, or NULL if it isn't cached.
+ */
+static struct varlena *
+detoast_cache_lookup(DetoastCache *cache, struct varatt_external *toast_pointer)
+{
+	DetoastCacheKey key;
+	DetoastCacheEntry *entry;
+	struct varlena *result;
+
+	if (cache->hash == NULL)
+		return NULL;
+
+	key.toastrelid = toast_pointer->va_toastrelid;
+	key.valueid = toast_pointer->va_valueid;
+	entry = hash_search(cache->hash, &key, HASH_FIND, NULL);
+	if (entry == NULL)
+		return NULL;
+
+	dlist_move_head(&cache->lru, &entry->node);
+
+	result = (struct varlena *) palloc(VARSIZE(entry->value));
+	memcpy(result, entry->value, VARSIZE(entry->value));
+	return result;
+}
+
+/*
+ * Add a copy of a detoasted value to the cache, evicting others as needed.
+ */
+static void
+detoast_cache_insert(DetoastCache *cache, struct varatt_external *toast_pointer,
+					 struct varlena *value)
+{
+	Size		size = VARSIZE(value);
+	DetoastCacheKey key;
+	DetoastCacheEntry *entry;
+	struct varlena *copy;
+	bool		found;
+
+	if (size > cache->limit)
+		return;
+
+	if (cache->hash == NULL)
+	{
+		HASHCTL		ctl;
+
+		cache->cxt = AllocSetContextCreate(cache->parent,
+										   "Detoast cache",
+										   ALLOCSET_DEFAULT_SIZES);
+		ctl.keysize = sizeof(DetoastCacheKey);
+		ctl.entrysize = sizeof(DetoastCacheEntry);
+		ctl.hcxt = cache->cxt;
+		cache->hash = hash_create("Detoast cache", 64, &ctl,
+								  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	copy = MemoryContextAlloc(cache->cxt, size);
+	memcpy(copy, value, size);
+
+	key.toastrelid = toast_pointer->va_toastrelid;
+	key.valueid = toast_pointer->va_valueid;
+	entry = hash_search(cache->hash, &key, HASH_ENTER, &found);
+	if (found)
+	{
+		pfree(copy);
+		return;
+	}
+
+	/* make room, least recently used first */
+	while (cache->size + size > cache->limit)
+	{
+		DetoastCacheEntry *victim;
+
+		victim = dlist_tail_element(DetoastCacheEntry, node, &cache->lru);
+		dlist_delete(&victim->node);
+		cache->size -= VARSIZE(victim->value);
+		pfree(victim->value);
+		(void) hash_search(cache->hash, &victim->key, HASH_REMOVE, NULL);
+	}
+
+	entry->value = copy;
+	dlist_push_head(&cache->lru, &entry->node);
+	cache->size += size;
+}
+
 /* ----------
  * detoast_attr_slice -
  *
@@ -485,6 +702,8 @@ toast_decompress_datum(struct varlena *attr)
 			return pglz_decompress_datum(attr);
 		case TOAST_LZ4_COMPRESSION_ID:
 			return lz4_decompress_datum(attr);
+		case TOAST_ZSTD_COMPRESSION_ID:
+			return zstd_decompress_datum(attr);
 		default:
 			elog(ERROR, "invalid compression method id %d", cmid);
 			return NULL;		/* keep compiler quiet */
@@ -528,6 +747,8 @@ toast_decompress_datum_slice(struct varlena *attr, int32 slicelength)
 			return pglz_decompress_datum_slice(attr, slicelength);
 		case TOAST_LZ4_COMPRESSION_ID:
 			return lz4_decompress_datum_slice(attr, slicelength);
+		case TOAST_ZSTD_COMPRESSION_ID:
+			return zstd_decompress_datum_slice(attr, slicelength);
 		default:
 			elog(ERROR, "invalid compression method id %d", cmid);
 			return NULL;		/* keep compiler quiet */
@@ -16,8 +16,11 @@
 #include "postgres.h"
 
 #include "access/printtup.h"
+#include "libpq/libpq-be.h"
 #include "libpq/pqformat.h"
 #include "libpq/protocol.h"
+#include "mb/pg_wchar.h"
+#include "miscadmin.h"
 #include "tcop/pquery.h"
 #include "utils/lsyscache.h"
 #include "utils/memdebug.h"
@@ -28,6 +31,7 @@
 static void printtup_startup(DestReceiver *self, int operation,
 							 TupleDesc typeinfo);
 static bool printtup(TupleTableSlot *slot, DestReceiver *self);
+static bool printtup_batch(TupleTableSlot *slot, DestReceiver *self);
 static void printtup_shutdown(DestReceiver *self);
 static void printtup_destroy(DestReceiver *self);
 
@@ -52,6 +56,25 @@ typedef struct
 	FmgrInfo	finfo;			/* Precomputed call info for output fn */
 } PrinttupAttrInfo;
 
+/*
+ * Column batches, see printtup_batch().  Each column of a ColumnBatch
+ * message consists of an array of nrows + 1 value offsets, a bitmap with a
+ * bit set for each non-null value, and the values themselves.  The bitmap
+ * and the values are padded to a multiple of 4 bytes, so that the clients
+ * can use the offsets in place.
+ */
+#define BATCH_PAD(len)	TYPEALIGN(4, (len))
+
+/* Flush a batch early once its values take up this much space */
+#define BATCH_MAX_BYTES	(8 * 1024 * 1024)
+
+typedef struct
+{								/* Per-attribute batch buffers */
+	uint8	   *validity;		/* bit set for each non-null value */
+	uint32	   *offsets;		/* end of each row's value in data */
+	StringInfoData data;		/* the values, back to back */
+} PrinttupBatchColumn;
+
 typedef struct
 {
 	DestReceiver pub;			/* publicly-known function pointers */
@@ -62,6 +85,10 @@ typedef struct
 	PrinttupAttrInfo *myinfo;	/* Cached info about each attr */
 	StringInfoData buf;			/* output buffer (*not* in tmpcontext) */
 	MemoryContext tmpcontext;	/* Memory context for per-row workspace */
+	int			batchRows;		/* max rows per ColumnBatch, or 0 */
+	int			batchCount;		/* rows in the current batch */
+	size_t		batchBytes;		/* size of the values in the current batch */
+	PrinttupBatchColumn *batch; /* per-attribute batch buffers */
 } DR_printtup;
 
 /* ----------------
@@ -90,6 +117,10 @@ printtup_create_DR(CommandDest dest)
 	self->myinfo = NULL;
 	self->buf.data = NULL;
 	self->tmpcontext = NULL;
+	self->batchRows = 0;
+	self->batchCount = 0;
+	self->batchBytes = 0;
+	self->batch = NULL;
 
 	return (DestReceiver *) self;
 }
@@ -130,6 +161,16 @@ printtup_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
 												"printtup",
 												ALLOCSET_DEFAULT_SIZES);
 
+	/*
+	 * If the client asked for column batches, collect the rows and send them
+	 * in ColumnBatch messages instead of one DataRow message per row.
+	 */
+	if (MyProcPort != NULL && MyProcPort->column_batch_rows > 0)
+	{
+		myState->batchRows = MyProcPort->column_batch_rows;
+		myState->pub.receiveSlot = printtup_batch;
+	}
+
 	/*
 	 * If we are supposed to emit row descriptions, then send the tuple
 	 * descriptor of the tuples.
@@ -244,6 +285,27 @@ SendRowDescriptionMessage(StringInfo buf, TupleDesc typeinfo,
 	pq_endmessage_reuse(buf);
 }
 
+/*
+ * Release the batch buffers
+ */
+static void
+printtup_free_batch(DR_printtup *myState)
+{
+	if (myState->batch == NULL)
+		return;
+
+	for (int i = 0; i < myState->nattrs; i++)
+	{
+		PrinttupBatchColumn *col = myState->batch + i;
+
+		pfree(col->validity);
+		pfree(col->offsets);
+		pfree(col->data.data);
+	}
+	pfree(myState->batch);
+	myState->batch = NULL;
+}
+
 /*
  * Get the lookup info that printtup() needs
  */
@@ -254,6 +316,7 @@ printtup_prepare_info(DR_printtup *myState, TupleDesc typeinfo, int numAttrs)
 	int			i;
 
 	/* get rid of any old data */
+	printtup_free_batch(myState);
 	if (myState->myinfo)
 		pfree(myState->myinfo);
 	myState->myinfo = NULL;
@@ -292,6 +355,22 @@ printtup_prepare_info(DR_printtup *myState, TupleDesc typeinfo, int numAttrs)
 					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 					 errmsg("unsupported format code: %d", format)));
 	}
+
+	if (myState->batchRows > 0)
+	{
+		myState->batch = (PrinttupBatchColumn *)
+			palloc(numAttrs * sizeof(PrinttupBatchColumn));
+
+		for (i = 0; i < numAttrs; i++)
+		{
+			PrinttupBatchColumn *col = myState->batch + i;
+
+			col->validity = palloc0((myState->batchRows + 7) / 8);
+			col->offsets = palloc((myState->batchRows + 1) * sizeof(uint32));
+			col->offsets[0] = 0;
+			initStringInfo(&col->data);
+		}
+	}
 }
 
 /* ----------------
@@ -382,6 +461,141 @@ printtup(TupleTableSlot *slot, DestReceiver *self)
 	return true;
 }
 
+/*
+ * Send the rows collected by printtup_batch() in a ColumnBatch message
+ */
+static void
+printtup_send_batch(DR_printtup *myState)
+{
+	StringInfo	buf = &myState->buf;
+	int			nrows = myState->batchCount;
+	int			natts = myState->nattrs;
+	static const char padding[4] = {0};
+
+	if (nrows == 0)
+		return;
+
+	pq_beginmessage_reuse(buf, PqMsg_ColumnBatch);
+	pq_sendint32(buf, nrows);
+	pq_sendint16(buf, natts);
+	pq_sendint16(buf, 0);		/* reserved */
+
+	for (int i = 0; i < natts; i++)
+	{
+		PrinttupBatchColumn *col = myState->batch + i;
+		size_t		vlen = (nrows + 7) / 8;
+		size_t		dlen = col->data.len;
+
+		enlargeStringInfo(buf, (nrows + 1) * sizeof(uint32) +
+						  BATCH_PAD(vlen) + BATCH_PAD(dlen));
+
+		for (int j = 0; j <= nrows; j++)
+			pq_writeint32(buf, col->offsets[j]);
+		pq_sendbytes(buf, col->validity, vlen);
+		pq_sendbytes(buf, padding, BATCH_PAD(vlen) - vlen);
+		pq_sendbytes(buf, col->data.data, dlen);
+		pq_sendbytes(buf, padding, BATCH_PAD(dlen) - dlen);
+
+		/* reset for the next batch */
+		memset(col->validity, 0, vlen);
+		resetStringInfo(&col->data);
+	}
+
+	pq_endmessage_reuse(buf);
+
+	myState->batchCount = 0;
+	myState->batchBytes = 0;
+}
+
+/* ----------------
+ *		printtup_batch --- collect a tuple for a ColumnBatch message
+ *
+ * Like printtup(), but appends each value to the buffer of its column, and
+ * sends the batch once it is full.  Any partial batch is sent at shutdown.
+ * ----------------
+ */
+static bool
+printtup_batch(TupleTableSlot *slot, DestReceiver *self)
+{
+	TupleDesc	typeinfo = slot->tts_tupleDescriptor;
+	DR_printtup *myState = (DR_printtup *) self;
+	MemoryContext oldcontext;
+	int			natts = typeinfo->natts;
+	int			row;
+	int			i;
+
+	/* Set or update my derived attribute info, if needed */
+	if (myState->attrinfo != typeinfo || myState->nattrs != natts)
+	{
+		printtup_send_batch(myState);
+		printtup_prepare_info(myState, typeinfo, natts);
+	}
+
+	/* Make sure the tuple is fully deconstructed */
+	slot_getallattrs(slot);
+
+	/*
+	 * Switch into per-row context so we can recover memory below.  The batch
+	 * buffers were allocated outside of it, and stay there when enlarged.
+	 */
+	oldcontext = MemoryContextSwitchTo(myState->tmpcontext);
+
+	row = myState->batchCount;
+	for (i = 0; i < natts; ++i)
+	{
+		PrinttupAttrInfo *thisState = myState->myinfo + i;
+		PrinttupBatchColumn *col = myState->batch + i;
+		Datum		attr = slot->tts_values[i];
+		int			before = col->data.len;
+
+		if (!slot->tts_isnull[i])
+		{
+			/* See printtup() */
+			if (thisState->typisvarlena)
+				VALGRIND_CHECK_MEM_IS_DEFINED(DatumGetPointer(attr),
+											  VARSIZE_ANY(DatumGetPointer(attr)));
+
+			if (thisState->format == 0)
+			{
+				/* Text output, converted to the client encoding */
+				char	   *outputstr;
+				char	   *p;
+				int			slen;
+
+				outputstr = OutputFunctionCall(&thisState->finfo, attr);
+				slen = strlen(outputstr);
+				p = pg_server_to_client(outputstr, slen);
+				if (p != outputstr)
+					slen = strlen(p);
+				appendBinaryStringInfo(&col->data, p, slen);
+			}
+			else
+			{
+				/* Binary output */
+				bytea	   *outputbytes;
+
+				outputbytes = SendFunctionCall(&thisState->finfo, attr);
+				appendBinaryStringInfo(&col->data, VARDATA(outputbytes),
+									   VARSIZE(outputbytes) - VARHDRSZ);
+			}
+			col->validity[row / 8] |= 1 << (row % 8);
+		}
+		col->offsets[row + 1] = col->data.len;
+		myState->batchBytes += col->data.len - before;
+	}
+	myState->batchCount++;
+
+	/* Return to caller's context, and flush row's temporary memory */
+	MemoryContextSwitchTo(oldcontext);
+	MemoryContextReset(myState->tmpcontext);
+
+	if (myState->batchCount >= myState->batchRows ||
+		myState->batchBytes >= BATCH_MAX_BYTES)
+		printtup_send_batch(myState);
+
+	return true;
+}
+
 /* ----------------
  *		printtup_shutdown
  * ----------------
@@ -391,6 +605,13 @@ printtup_shutdown(DestReceiver *self)
 {
 	DR_printtup *myState = (DR_printtup *) self;
 
+	/* Send what's left of the last batch, if any */
+	if (myState->batchRows > 0)
+	{
+		printtup_send_batch(myState);
+		printtup_free_batch(myState);
+	}
+
 	if (myState->myinfo)
 		pfree(myState->myinfo);
 	myState->myinfo = NULL;
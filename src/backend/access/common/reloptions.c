@@ -93,6 +93,15 @@
 
 static relopt_bool boolRelOpts[] =
 {
+	{
+		{
+			"autocleanup",
+			"Enables cleanup of the pending list of this GIN index by autovacuum",
+			RELOPT_KIND_GIN,
+			AccessExclusiveLock
+		},
+		false
+	},
 	{
 		{
 			"autosummarize",
@@ -166,6 +175,16 @@ static relopt_bool boolRelOpts[] =
 		},
 		true
 	},
+	{
+		{
+			"page_compression",
+			"Enables compression of pages on disk",
+			RELOPT_KIND_HEAP | RELOPT_KIND_BTREE,
+			ShareUpdateExclusiveLock	/* since it applies only to later
+										 * writes */
+		},
+		false
+	},
 	/* list terminator */
 	{{NULL}}
 };
@@ -1926,7 +1945,9 @@ default_reloptions(Datum reloptions, bool validate, relopt_kind kind)
 		{"vacuum_truncate", RELOPT_TYPE_BOOL,
 		offsetof(StdRdOptions, vacuum_truncate), offsetof(StdRdOptions, vacuum_truncate_set)},
 		{"vacuum_max_eager_freeze_failure_rate", RELOPT_TYPE_REAL,
-		offsetof(StdRdOptions, vacuum_max_eager_freeze_failure_rate)}
+		offsetof(StdRdOptions, vacuum_max_eager_freeze_failure_rate)},
+		{"page_compression", RELOPT_TYPE_BOOL,
+		offsetof(StdRdOptions, page_compression)}
 	};
 
 	return (bytea *) build_reloptions(reloptions, validate, kind,
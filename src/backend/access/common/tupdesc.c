@@ -126,6 +126,51 @@ populate_compact_attribute(TupleDesc tupdesc, int attnum)
 	dst = &tupdesc->compact_attrs[attnum];
 
 	populate_compact_attribute_internal(src, dst);
+
+	/* The attribute may have changed size, so forget the fixed prefix */
+	tupdesc->tdfixedprefix = -1;
+	tupdesc->tdwideprefix = 0;
+}
+
+/*
+ * TupleDescComputeFixedPrefix
+ *		Determine the leading run of fixed-width attributes of the TupleDesc,
+ *		and cache their offsets in attcacheoff.
+ *
+ * As long as none of them is NULL, these attributes are at the same offsets
+ * in every tuple, which lets slot_deform_heap_tuple() extract them without
+ * looking at them one by one.  tdwideprefix counts the leading attributes
+ * that are also pass-by-value and as wide as a Datum: their values can be
+ * copied straight from the tuple into the Datum array.
+ *
+ * TupleDescs may be shared between backends, so tdwideprefix is always
+ * stored first: a concurrent reader that sees tdfixedprefix set but not
+ * yet tdwideprefix just doesn't take the bulk copy.
+ */
+void
+TupleDescComputeFixedPrefix(TupleDesc tupdesc)
+{
+	int			off = 0;
+	int			nwide = 0;
+	int			i;
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		CompactAttribute *att = TupleDescCompactAttr(tupdesc, i);
+
+		if (att->attlen <= 0)
+			break;
+
+		off = att_nominal_alignby(off, att->attalignby);
+		att->attcacheoff = off;
+		off += att->attlen;
+
+		if (nwide == i && att->attbyval && att->attlen == sizeof(Datum))
+			nwide++;
+	}
+
+	tupdesc->tdwideprefix = nwide;
+	tupdesc->tdfixedprefix = i;
 }
 
 /*
@@ -213,6 +258,8 @@ CreateTemplateTupleDesc(int natts)
 	desc->tdtypeid = RECORDOID;
 	desc->tdtypmod = -1;
 	desc->tdrefcount = -1;		/* assume not reference-counted */
+	desc->tdfixedprefix = -1;
+	desc->tdwideprefix = 0;
 
 	return desc;
 }
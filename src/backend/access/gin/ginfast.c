@@ -32,6 +32,7 @@
 #include "storage/predicate.h"
 #include "utils/acl.h"
 #include "utils/fmgrprotos.h"
+#include "utils/guc.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 
@@ -227,6 +228,7 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	ginxlogUpdateMeta data;
 	bool		separateList = false;
 	bool		needCleanup = false;
+	bool		deferCleanup = false;
 	int			cleanupSize;
 	bool		needWal;
 
@@ -459,10 +461,25 @@ ginHeapTupleFastInsert(GinState *ginstate, GinTupleCollector *collector)
 	if (metadata->nPendingPages * GIN_PAGE_FREESIZE > cleanupSize * (Size) 1024)
 		needCleanup = true;
 
+	/*
+	 * With autocleanup, we'd rather have autovacuum do the cleanup, so that
+	 * this insertion doesn't have to wait for it.  But if autovacuum doesn't
+	 * keep up and the pending list grows to twice its limit, clean it up
+	 * ourselves after all, lest searches get slower and slower.
+	 */
+	if (needCleanup && GinGetAutoCleanup(index) &&
+		metadata->nPendingPages * GIN_PAGE_FREESIZE <= 2 * cleanupSize * (Size) 1024)
+		deferCleanup = true;
+
 	UnlockReleaseBuffer(metabuffer);
 
 	END_CRIT_SECTION();
 
+	if (deferCleanup && AutoVacuumingActive() &&
+		AutoVacuumRequestWork(AVW_GINCleanupPendingList,
+							  RelationGetRelid(index), InvalidBlockNumber))
+		needCleanup = false;
+
 	/*
 	 * Since it could contend with concurrent cleanup process we cleanup
 	 * pending list not forcibly.
@@ -1033,6 +1050,9 @@ gin_clean_pending_list(PG_FUNCTION_ARGS)
 	Oid			indexoid = PG_GETARG_OID(0);
 	Relation	indexRel = index_open(indexoid, RowExclusiveLock);
 	IndexBulkDeleteResult stats;
+	Oid			save_userid;
+	int			save_sec_context;
+	int			save_nestlevel;
 
 	if (RecoveryInProgress())
 		ereport(ERROR,
@@ -1076,8 +1096,29 @@ gin_clean_pending_list(PG_FUNCTION_ARGS)
 	{
 		GinState	ginstate;
 
+		/*
+		 * Autovacuum calls us to process autocleanup requests.  For its
+		 * benefit, switch to the index owner's userid, so that any opclass
+		 * functions are run as that user, and lock down security-restricted
+		 * operations, as VACUUM does.  This is harmless when called from SQL,
+		 * because the user owns the index.  Autovacuum also shouldn't chase
+		 * insertions made while it works, like in ginvacuumcleanup().
+		 */
+		GetUserIdAndSecContext(&save_userid, &save_sec_context);
+		SetUserIdAndSecContext(indexRel->rd_rel->relowner,
+							   save_sec_context | SECURITY_RESTRICTED_OPERATION);
+		save_nestlevel = NewGUCNestLevel();
+		RestrictSearchPath();
+
 		initGinState(&ginstate, indexRel);
-		ginInsertCleanup(&ginstate, true, true, true, &stats);
+		ginInsertCleanup(&ginstate, !AmAutoVacuumWorkerProcess(), true, true,
+						 &stats);
+
+		/* Roll back any GUC changes executed by opclass functions */
+		AtEOXact_GUC(false, save_nestlevel);
+
+		/* Restore userid and security context */
+		SetUserIdAndSecContext(save_userid, save_sec_context);
 	}
 	else
 		ereport(DEBUG1,
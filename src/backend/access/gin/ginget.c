@@ -647,6 +647,60 @@ startScan(IndexScanDesc scan)
 		startScanKey(ginstate, so, so->keys + i);
 }
 
+/*
+ * Returns the index of the first item in list[start .. nitems - 1] that is
+ * > advancePast, or nitems if there is none.  The list must be sorted.
+ *
+ * When some other key of the scan lets us skip ahead, the next interesting
+ * item can be far away in a long posting list.  Rather than stepping over
+ * the items one at a time, we gallop: probe at exponentially growing
+ * distances from 'start' until we overshoot, then binary search the last
+ * interval.  That needs O(log d) comparisons to skip d items, while an item
+ * that is already past advancePast, as in a plain sequential scan of the
+ * list, still costs just one comparison.
+ */
+static inline int
+ginSkipItems(ItemPointerData *list, int start, int nitems,
+			 ItemPointer advancePast)
+{
+	int			lo;
+	int			hi;
+	int			step;
+
+	if (start >= nitems || ginCompareItemPointers(&list[start], advancePast) > 0)
+		return start;
+
+	/* Gallop, keeping list[lo] <= advancePast */
+	lo = start;
+	step = 1;
+	for (;;)
+	{
+		if (step >= nitems - lo)
+		{
+			hi = nitems;
+			break;
+		}
+		hi = lo + step;
+		if (ginCompareItemPointers(&list[hi], advancePast) > 0)
+			break;
+		lo = hi;
+		step *= 2;
+	}
+
+	/* Binary search, keeping list[lo] <= advancePast < list[hi] */
+	while (hi - lo > 1)
+	{
+		int			mid = lo + (hi - lo) / 2;
+
+		if (ginCompareItemPointers(&list[mid], advancePast) > 0)
+			hi = mid;
+		else
+			lo = mid;
+	}
+
+	return hi;
+}
+
 /*
  * Load the next batch of item pointers from a posting tree.
  *
@@ -772,22 +826,20 @@ entryLoadMoreItems(GinState *ginstate, GinScanEntry entry,
 
 		entry->list = GinDataLeafPageGetItems(page, &entry->nlist, advancePast);
 
-		for (i = 0; i < entry->nlist; i++)
+		i = ginSkipItems(entry->list, 0, entry->nlist, &advancePast);
+		if (i < entry->nlist)
 		{
-			if (ginCompareItemPointers(&advancePast, &entry->list[i]) < 0)
-			{
-				entry->offset = i;
+			entry->offset = i;
 
-				if (GinPageRightMost(page))
-				{
-					/* after processing the copied items, we're done. */
-					UnlockReleaseBuffer(entry->buffer);
-					entry->buffer = InvalidBuffer;
-				}
-				else
-					LockBuffer(entry->buffer, GIN_UNLOCK);
-				return;
+			if (GinPageRightMost(page))
+			{
+				/* after processing the copied items, we're done. */
+				UnlockReleaseBuffer(entry->buffer);
+				entry->buffer = InvalidBuffer;
 			}
+			else
+				LockBuffer(entry->buffer, GIN_UNLOCK);
+			return;
 		}
 	}
 }
@@ -926,6 +978,10 @@ entryGetItem(GinState *ginstate, GinScanEntry entry,
 		 */
 		for (;;)
 		{
+			/* Skip over all the items <= advancePast */
+			entry->offset = ginSkipItems(entry->list, entry->offset,
+										 entry->nlist, &advancePast);
+
 			if (entry->offset >= entry->nlist)
 			{
 				ItemPointerSetInvalid(&entry->curItem);
@@ -935,10 +991,6 @@ entryGetItem(GinState *ginstate, GinScanEntry entry,
 
 			entry->curItem = entry->list[entry->offset++];
 
-			/* If we're not past advancePast, keep scanning */
-			if (ginCompareItemPointers(&entry->curItem, &advancePast) <= 0)
-				continue;
-
 			/* Done unless we need to reduce the result */
 			if (!entry->reduceResult || !dropItem(entry))
 				break;
@@ -961,12 +1013,14 @@ entryGetItem(GinState *ginstate, GinScanEntry entry,
 				}
 			}
 
-			entry->curItem = entry->list[entry->offset++];
-
-			/* If we're not past advancePast, keep scanning */
-			if (ginCompareItemPointers(&entry->curItem, &advancePast) <= 0)
+			/* Skip over all the items <= advancePast in the current batch */
+			entry->offset = ginSkipItems(entry->list, entry->offset,
+										 entry->nlist, &advancePast);
+			if (entry->offset >= entry->nlist)
 				continue;
 
+			entry->curItem = entry->list[entry->offset++];
+
 			/* Done unless we need to reduce the result */
 			if (!entry->reduceResult || !dropItem(entry))
 				break;
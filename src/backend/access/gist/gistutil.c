@@ -1015,7 +1015,7 @@ gistproperty(Oid index_oid, int attno,
 XLogRecPtr
 gistGetFakeLSN(Relation rel)
 {
-	if (rel->rd_rel->relpersistence == RELPERSISTENCE_TEMP)
+	if (RelationUsesLocalBuffers(rel))
 	{
 		/*
 		 * Temporary relations are only accessible in our session, so a simple
@@ -263,13 +263,16 @@ hashnameextended(PG_FUNCTION_ARGS)
 							 PG_GETARG_INT64(1));
 }
 
-Datum
-hashtext(PG_FUNCTION_ARGS)
+/*
+ * Workhorse for hashtext and hashtextfast, hashing the bytes that identify
+ * the value with 'hashfn'.
+ */
+static inline uint32
+hash_text_common(text *key, Oid collid,
+				 uint32 (*hashfn) (const unsigned char *k, int keylen))
 {
-	text	   *key = PG_GETARG_TEXT_PP(0);
-	Oid			collid = PG_GET_COLLATION();
 	pg_locale_t mylocale;
-	Datum		result;
+	uint32		result;
 
 	if (!collid)
 		ereport(ERROR,
@@ -281,8 +284,8 @@ hashtext(PG_FUNCTION_ARGS)
 
 	if (mylocale->deterministic)
 	{
-		result = hash_any((unsigned char *) VARDATA_ANY(key),
-						  VARSIZE_ANY_EXHDR(key));
+		result = hashfn((unsigned char *) VARDATA_ANY(key),
+						VARSIZE_ANY_EXHDR(key));
 	}
 	else
 	{
@@ -307,15 +310,45 @@ hashtext(PG_FUNCTION_ARGS)
 		 * character in the hash, but it was done before and the behavior must
 		 * be preserved.
 		 */
-		result = hash_any((uint8_t *) buf, bsize + 1);
+		result = hashfn((uint8_t *) buf, bsize + 1);
 
 		pfree(buf);
 	}
 
+	return result;
+}
+
+Datum
+hashtext(PG_FUNCTION_ARGS)
+{
+	text	   *key = PG_GETARG_TEXT_PP(0);
+	uint32		result;
+
+	result = hash_text_common(key, PG_GET_COLLATION(), hash_bytes);
+
 	/* Avoid leaking memory for toasted inputs */
 	PG_FREE_IF_COPY(key, 0);
 
-	return result;
+	PG_RETURN_UINT32(result);
+}
+
+/*
+ * hashtextfast() is like hashtext(), but uses hash_bytes_fast(), so it must
+ * only be used for hash tables that live in memory.  See
+ * ExecInMemoryHashFunction().
+ */
+Datum
+hashtextfast(PG_FUNCTION_ARGS)
+{
+	text	   *key = PG_GETARG_TEXT_PP(0);
+	uint32		result;
+
+	result = hash_text_common(key, PG_GET_COLLATION(), hash_bytes_fast);
+
+	/* Avoid leaking memory for toasted inputs */
+	PG_FREE_IF_COPY(key, 0);
+
+	PG_RETURN_UINT32(result);
 }
 
 Datum
@@ -423,3 +456,22 @@ hashbyteaextended(PG_FUNCTION_ARGS)
 {
 	return hashvarlenaextended(fcinfo);
 }
+
+/*
+ * hashbyteafast() is like hashbytea(), but uses hash_bytes_fast(), so it
+ * must only be used for hash tables that live in memory.
+ */
+Datum
+hashbyteafast(PG_FUNCTION_ARGS)
+{
+	bytea	   *key = PG_GETARG_BYTEA_PP(0);
+	uint32		result;
+
+	result = hash_bytes_fast((unsigned char *) VARDATA_ANY(key),
+							 VARSIZE_ANY_EXHDR(key));
+
+	/* Avoid leaking memory for toasted inputs */
+	PG_FREE_IF_COPY(key, 0);
+
+	PG_RETURN_UINT32(result);
+}
@@ -40,11 +40,13 @@
 #include "access/valid.h"
 #include "access/visibilitymap.h"
 #include "access/xloginsert.h"
+#include "catalog/globaltemp.h"
 #include "catalog/pg_database.h"
 #include "catalog/pg_database_d.h"
 #include "commands/vacuum.h"
 #include "pgstat.h"
 #include "port/pg_bitutils.h"
+#include "postmaster/background_prune.h"
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
 #include "storage/procarray.h"
@@ -256,7 +258,7 @@ heap_scan_stream_read_next_parallel(ReadStream *stream,
 	Assert(ScanDirectionIsForward(scan->rs_dir));
 	Assert(scan->rs_base.rs_parallel);
 
-	if (unlikely(!scan->rs_inited))
+	if (unlikely(!scan->rs_stream_inited))
 	{
 		/* parallel scan */
 		table_block_parallelscan_startblock_init(scan->rs_base.rs_rd,
@@ -269,7 +271,7 @@ heap_scan_stream_read_next_parallel(ReadStream *stream,
 		scan->rs_prefetch_block = table_block_parallelscan_nextpage(scan->rs_base.rs_rd,
 																	scan->rs_parallelworkerdata,
 																	(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel);
-		scan->rs_inited = true;
+		scan->rs_stream_inited = true;
 	}
 	else
 	{
@@ -293,10 +295,10 @@ heap_scan_stream_read_next_serial(ReadStream *stream,
 {
 	HeapScanDesc scan = (HeapScanDesc) callback_private_data;
 
-	if (unlikely(!scan->rs_inited))
+	if (unlikely(!scan->rs_stream_inited))
 	{
 		scan->rs_prefetch_block = heapgettup_initial_block(scan, scan->rs_dir);
-		scan->rs_inited = true;
+		scan->rs_stream_inited = true;
 	}
 	else
 		scan->rs_prefetch_block = heapgettup_advance_block(scan,
@@ -457,6 +459,7 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 
 	scan->rs_numblocks = InvalidBlockNumber;
 	scan->rs_inited = false;
+	scan->rs_stream_inited = false;
 	scan->rs_ctup.t_data = NULL;
 	ItemPointerSetInvalid(&scan->rs_ctup.t_self);
 	scan->rs_cbuf = InvalidBuffer;
@@ -693,6 +696,7 @@ heap_fetch_next_buffer(HeapScanDesc scan, ScanDirection dir)
 	scan->rs_cbuf = read_stream_next_buffer(scan->rs_read_stream, NULL);
 	if (BufferIsValid(scan->rs_cbuf))
 		scan->rs_cblock = BufferGetBlockNumber(scan->rs_cbuf);
+	scan->rs_inited = true;
 }
 
 /*
@@ -1005,6 +1009,7 @@ continue_page:
 	scan->rs_prefetch_block = InvalidBlockNumber;
 	tuple->t_data = NULL;
 	scan->rs_inited = false;
+	scan->rs_stream_inited = false;
 }
 
 /* ----------------
@@ -1105,6 +1110,7 @@ continue_page:
 	scan->rs_prefetch_block = InvalidBlockNumber;
 	tuple->t_data = NULL;
 	scan->rs_inited = false;
+	scan->rs_stream_inited = false;
 }
 
 
@@ -1131,6 +1137,10 @@ heap_beginscan(Relation relation, Snapshot snapshot,
 	 */
 	RelationIncrementReferenceCount(relation);
 
+	/* A global temporary table gets this session's storage on first use */
+	if (RelationIsGlobalTemp(relation))
+		GlobalTempRelationInitStorage(relation);
+
 	/*
 	 * allocate and initialize scan descriptor
 	 */
@@ -1439,6 +1449,59 @@ heap_getnextslot(TableScanDesc sscan, ScanDirection direction, TupleTableSlot *s
 	return true;
 }
 
+/*
+ * heap_getnextbatch - fetch up to nslots tuples of a scan at once
+ *
+ * Like calling heap_getnextslot() repeatedly, but without the indirection
+ * through the table AM for every tuple.
+ */
+int
+heap_getnextbatch(TableScanDesc sscan, ScanDirection direction,
+				  TupleTableSlot **slots, int nslots)
+{
+	HeapScanDesc scan = (HeapScanDesc) sscan;
+	int			n;
+
+	for (n = 0; n < nslots; n++)
+	{
+		if (sscan->rs_flags & SO_ALLOW_PAGEMODE)
+			heapgettup_pagemode(scan, direction, sscan->rs_nkeys, sscan->rs_key);
+		else
+			heapgettup(scan, direction, sscan->rs_nkeys, sscan->rs_key);
+
+		if (scan->rs_ctup.t_data == NULL)
+		{
+			ExecClearTuple(slots[n]);
+			break;
+		}
+
+		pgstat_count_heap_getnext(scan->rs_base.rs_rd);
+
+		ExecStoreBufferHeapTuple(&scan->rs_ctup, slots[n], scan->rs_cbuf);
+	}
+
+	return n;
+}
+
+/*
+ * heap_scan_prefetch - start reading the first blocks of a scan
+ *
+ * Has no effect once the scan has returned tuples.  Parallel scans are left
+ * alone, since looking ahead there would claim blocks from the shared scan
+ * that other workers could be processing.
+ */
+void
+heap_scan_prefetch(TableScanDesc sscan)
+{
+	HeapScanDesc scan = (HeapScanDesc) sscan;
+
+	if (scan->rs_read_stream == NULL || scan->rs_inited ||
+		sscan->rs_parallel != NULL)
+		return;
+
+	read_stream_prefetch(scan->rs_read_stream);
+}
+
 void
 heap_set_tidrange(TableScanDesc sscan, ItemPointer mintid,
 				  ItemPointer maxtid)
@@ -2118,6 +2181,9 @@ heap_insert(Relation relation, HeapTuple tup, CommandId cid,
 
 	AssertHasSnapshotForToast(relation);
 
+	if (RelationIsGlobalTemp(relation))
+		GlobalTempRelationInitStorage(relation);
+
 	/*
 	 * Fill in tuple header fields and toast the tuple if necessary.
 	 *
@@ -2298,15 +2364,12 @@ heap_prepare_insert(Relation relation, HeapTuple tup, TransactionId xid,
 					CommandId cid, int options)
 {
 	/*
-	 * To allow parallel inserts, we need to ensure that they are safe to be
-	 * performed in workers. We have the infrastructure to allow parallel
-	 * inserts in general except for the cases where inserts generate a new
-	 * CommandId (eg. inserts into a table having a foreign key column).
+	 * Inserts in parallel workers are safe as long as they don't need a new
+	 * CommandId (eg. inserts into a table having a foreign key column).  The
+	 * caller got 'cid' from GetCurrentCommandId(true), which refuses to hand
+	 * one out in a worker unless the leader had already marked it used
+	 * before starting the parallel operation, as parallel COPY FROM does.
 	 */
-	if (IsParallelWorker())
-		ereport(ERROR,
-				(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
-				 errmsg("cannot insert tuples in a parallel worker")));
 
 	tup->t_data->t_infomask &= ~(HEAP_XACT_MASK);
 	tup->t_data->t_infomask2 &= ~(HEAP2_XACT_MASK);
@@ -2397,6 +2460,9 @@ heap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 
 	AssertHasSnapshotForToast(relation);
 
+	if (RelationIsGlobalTemp(relation))
+		GlobalTempRelationInitStorage(relation);
+
 	needwal = RelationNeedsWAL(relation);
 	saveFreeSpace = RelationGetTargetPageFreeSpace(relation,
 												   HEAP_DEFAULT_FILLFACTOR);
@@ -3212,6 +3278,9 @@ l1:
 
 	pgstat_count_heap_delete(relation);
 
+	/* Let the background pruner clean up after us, if enabled */
+	BackgroundPruneEnqueue(relation, block, xid);
+
 	if (old_key_tuple != NULL && old_key_copied)
 		heap_freetuple(old_key_tuple);
 
@@ -3275,6 +3344,7 @@ simple_heap_delete(Relation relation, const ItemPointerData *tid)
 TM_Result
 heap_update(Relation relation, const ItemPointerData *otid, HeapTuple newtup,
 			CommandId cid, Snapshot crosscheck, bool wait,
+			const Bitmapset *hot_exempt_attrs,
 			TM_FailureData *tmfd, LockTupleMode *lockmode,
 			TU_UpdateIndexes *update_indexes)
 {
@@ -3358,6 +3428,14 @@ heap_update(Relation relation, const ItemPointerData *otid, HeapTuple newtup,
 	 */
 	hot_attrs = RelationGetIndexAttrBitmap(relation,
 										   INDEX_ATTR_BITMAP_HOT_BLOCKING);
+
+	/*
+	 * The caller may have established that changes to some columns, which
+	 * are only used in index expressions, leave all index keys unchanged.
+	 * Those don't need to prevent a HOT update.
+	 */
+	hot_attrs = bms_del_members(hot_attrs, hot_exempt_attrs);
+
 	sum_attrs = RelationGetIndexAttrBitmap(relation,
 										   INDEX_ATTR_BITMAP_SUMMARIZED);
 	key_attrs = RelationGetIndexAttrBitmap(relation, INDEX_ATTR_BITMAP_KEY);
@@ -4210,6 +4288,16 @@ l2:
 
 	pgstat_count_heap_update(relation, use_hot_update, newbuf != buffer);
 
+	/*
+	 * Let the background pruner clean up after us, if enabled.  The new
+	 * version's page is also worth visiting, to set its hint bits.
+	 */
+	BackgroundPruneEnqueue(relation, block, xid);
+	if (ItemPointerGetBlockNumber(&heaptup->t_self) != block)
+		BackgroundPruneEnqueue(relation,
+							   ItemPointerGetBlockNumber(&heaptup->t_self),
+							   xid);
+
 	/*
 	 * If heaptup is a private copy, release it.  Don't forget to copy t_self
 	 * back to the caller's image, too.
@@ -4527,7 +4615,7 @@ simple_heap_update(Relation relation, const ItemPointerData *otid, HeapTuple tup
 	result = heap_update(relation, otid, tup,
 						 GetCurrentCommandId(true), InvalidSnapshot,
 						 true /* wait for commit */ ,
-						 &tmfd, &lockmode, update_indexes);
+						 NULL, &tmfd, &lockmode, update_indexes);
 	switch (result)
 	{
 		case TM_SelfModified:
@@ -23,6 +23,7 @@
 #include "access/heapam.h"
 #include "access/heaptoast.h"
 #include "access/multixact.h"
+#include "access/parallel.h"
 #include "access/rewriteheap.h"
 #include "access/syncscan.h"
 #include "access/tableam.h"
@@ -35,20 +36,121 @@
 #include "catalog/storage_xlog.h"
 #include "commands/progress.h"
 #include "executor/executor.h"
+#include "executor/instrument.h"
 #include "miscadmin.h"
+#include "optimizer/optimizer.h"
 #include "pgstat.h"
 #include "storage/bufmgr.h"
 #include "storage/bufpage.h"
+#include "storage/condition_variable.h"
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
 #include "storage/procarray.h"
+#include "storage/read_stream.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
 #include "utils/builtins.h"
 #include "utils/rel.h"
+#include "utils/tuplesort.h"
+
+/* Magic numbers for parallel CLUSTER state sharing */
+#define PARALLEL_KEY_CLUSTER_SHARED		UINT64CONST(0xC000000000000001)
+#define PARALLEL_KEY_CLUSTER_TUPLESORT	UINT64CONST(0xC000000000000002)
+#define PARALLEL_KEY_CLUSTER_QUERY_TEXT	UINT64CONST(0xC000000000000003)
+#define PARALLEL_KEY_CLUSTER_WAL_USAGE	UINT64CONST(0xC000000000000004)
+#define PARALLEL_KEY_CLUSTER_BUFFER_USAGE	UINT64CONST(0xC000000000000005)
+
+/*
+ * Status for a CLUSTER performed in parallel, allocated in a dynamic shared
+ * memory segment.  Each participant scans part of the old heap with a
+ * parallel scan and sorts the tuples it keeps; the leader then merges the
+ * sorted runs and writes the new heap by itself, since the rewrite of update
+ * chains in rewriteheap.c can't be shared.
+ */
+typedef struct HeapClusterShared
+{
+	/* Immutable state */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	TransactionId OldestXmin;
+	int			scantuplesortstates;
+
+	/* Query ID, for report in worker processes */
+	int64		queryid;
+
+	/*
+	 * workersdonecv is signaled by each worker when it has finished its part
+	 * of the scan and sort.
+	 */
+	ConditionVariable workersdonecv;
+
+	/*
+	 * mutex protects the fields below, which workers add their tuple counts
+	 * to when they are done.
+	 */
+	slock_t		mutex;
+	int			nparticipantsdone;
+	double		num_tuples;
+	double		tups_vacuumed;
+	double		tups_recently_dead;
+
+	/*
+	 * ParallelTableScanDescData data follows. Can't directly embed here, as
+	 * implementations of the parallel table scan desc interface might need
+	 * stronger alignment.
+	 */
+} HeapClusterShared;
+
+/*
+ * Return pointer to a HeapClusterShared's parallel table scan.
+ *
+ * c.f. shm_toc_allocate as to why BUFFERALIGN is used, rather than just
+ * MAXALIGN.
+ */
+#define ParallelTableScanFromHeapClusterShared(shared) \
+	(ParallelTableScanDesc) ((char *) (shared) + BUFFERALIGN(sizeof(HeapClusterShared)))
+
+/*
+ * Status for the leader of a parallel CLUSTER.
+ */
+typedef struct HeapClusterLeader
+{
+	ParallelContext *pcxt;
+
+	/*
+	 * Number of worker processes successfully launched, plus one for the
+	 * leader, which always participates.
+	 */
+	int			nparticipanttuplesorts;
+
+	HeapClusterShared *shared;
+	Sharedsort *sharedsort;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+} HeapClusterLeader;
 
 static void reform_and_rewrite_tuple(HeapTuple tuple,
 									 Relation OldHeap, Relation NewHeap,
 									 Datum *values, bool *isnull, RewriteState rwstate);
+static bool heapam_cluster_tuple_is_dead(Relation OldHeap, HeapTuple tuple,
+										 Buffer buf, TransactionId OldestXmin,
+										 bool is_system_catalog,
+										 double *tups_recently_dead);
+static HeapClusterLeader *heapam_cluster_begin_parallel(Relation OldHeap,
+														Relation OldIndex,
+														TransactionId OldestXmin,
+														int request);
+static void heapam_cluster_wait_for_workers(HeapClusterLeader *leader,
+											double *num_tuples,
+											double *tups_vacuumed,
+											double *tups_recently_dead);
+static void heapam_cluster_end_parallel(HeapClusterLeader *leader);
+static void heapam_cluster_worker_scan_and_sort(Relation OldHeap,
+												Relation OldIndex,
+												HeapClusterShared *shared,
+												Sharedsort *sharedsort,
+												int sortmem);
 
 static bool SampleHeapTupleVisible(TableScanDesc scan, Buffer buffer,
 								   HeapTuple tuple,
@@ -84,6 +186,7 @@ heapam_index_fetch_begin(Relation rel)
 	IndexFetchHeapData *hscan = palloc0_object(IndexFetchHeapData);
 
 	hscan->xs_base.rel = rel;
+	hscan->xs_base.stream_capable = true;
 	hscan->xs_cbuf = InvalidBuffer;
 
 	return &hscan->xs_base;
@@ -129,10 +232,27 @@ heapam_index_fetch_tuple(struct IndexFetchTableData *scan,
 	{
 		/* Switch to correct buffer if we don't have it already */
 		Buffer		prev_buf = hscan->xs_cbuf;
-
-		hscan->xs_cbuf = ReleaseAndReadBuffer(hscan->xs_cbuf,
-											  hscan->xs_base.rel,
-											  ItemPointerGetBlockNumber(tid));
+		BlockNumber blkno = ItemPointerGetBlockNumber(tid);
+
+		if (scan->rs == NULL)
+			hscan->xs_cbuf = ReleaseAndReadBuffer(hscan->xs_cbuf,
+												  hscan->xs_base.rel,
+												  blkno);
+		else if (!BufferIsValid(prev_buf) ||
+				 BufferGetBlockNumber(prev_buf) != blkno)
+		{
+			/*
+			 * The index scan is reading ahead, so the block we need next
+			 * should be the next one the read stream returns.
+			 */
+			if (BufferIsValid(prev_buf))
+				ReleaseBuffer(prev_buf);
+			hscan->xs_cbuf = read_stream_next_buffer(scan->rs, NULL);
+			if (!BufferIsValid(hscan->xs_cbuf) ||
+				BufferGetBlockNumber(hscan->xs_cbuf) != blkno)
+				elog(ERROR, "index prefetch stream returned unexpected block in relation \"%s\"",
+					 RelationGetRelationName(hscan->xs_base.rel));
+		}
 
 		/*
 		 * Prune page, but only if we weren't already on this page
@@ -316,8 +436,9 @@ heapam_tuple_delete(Relation relation, ItemPointer tid, CommandId cid,
 static TM_Result
 heapam_tuple_update(Relation relation, ItemPointer otid, TupleTableSlot *slot,
 					CommandId cid, Snapshot snapshot, Snapshot crosscheck,
-					bool wait, TM_FailureData *tmfd,
-					LockTupleMode *lockmode, TU_UpdateIndexes *update_indexes)
+					bool wait, const Bitmapset *hot_exempt_attrs,
+					TM_FailureData *tmfd, LockTupleMode *lockmode,
+					TU_UpdateIndexes *update_indexes)
 {
 	bool		shouldFree = true;
 	HeapTuple	tuple = ExecFetchSlotHeapTuple(slot, true, &shouldFree);
@@ -328,7 +449,7 @@ heapam_tuple_update(Relation relation, ItemPointer otid, TupleTableSlot *slot,
 	tuple->t_tableOid = slot->tts_tableOid;
 
 	result = heap_update(relation, otid, tuple, cid, crosscheck, wait,
-						 tmfd, lockmode, update_indexes);
+						 hot_exempt_attrs, tmfd, lockmode, update_indexes);
 	ItemPointerCopy(&tuple->t_self, &slot->tts_tid);
 
 	/*
@@ -705,6 +826,7 @@ heapam_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
 	bool	   *isnull;
 	BufferHeapTupleTableSlot *hslot;
 	BlockNumber prev_cblock = InvalidBlockNumber;
+	HeapClusterLeader *leader = NULL;
 
 	/* Remember if it's a system catalog */
 	is_system_catalog = IsSystemRelation(OldHeap);
@@ -725,11 +847,39 @@ heapam_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
 								 *multi_cutoff);
 
 
-	/* Set up sorting if wanted */
+	/*
+	 * Set up sorting if wanted.  The scan and sort can be done in parallel,
+	 * in which case we only sort our share of the tuples here, with our
+	 * share of maintenance_work_mem, and merge everyone's sorted runs later.
+	 * We don't try that for system catalogs.
+	 */
 	if (use_sort)
-		tuplesort = tuplesort_begin_cluster(oldTupDesc, OldIndex,
-											maintenance_work_mem,
-											NULL, TUPLESORT_NONE);
+	{
+		int			nworkers = 0;
+
+		if (!is_system_catalog)
+			nworkers = plan_create_index_workers(RelationGetRelid(OldHeap),
+												 RelationGetRelid(OldIndex));
+		if (nworkers > 0)
+			leader = heapam_cluster_begin_parallel(OldHeap, OldIndex,
+												   OldestXmin, nworkers);
+
+		if (leader != NULL)
+		{
+			SortCoordinate coordinate = palloc0_object(SortCoordinateData);
+
+			coordinate->isWorker = true;
+			coordinate->nParticipants = -1;
+			coordinate->sharedsort = leader->sharedsort;
+			tuplesort = tuplesort_begin_cluster(oldTupDesc, OldIndex,
+												maintenance_work_mem / leader->nparticipanttuplesorts,
+												coordinate, TUPLESORT_NONE);
+		}
+		else
+			tuplesort = tuplesort_begin_cluster(oldTupDesc, OldIndex,
+												maintenance_work_mem,
+												NULL, TUPLESORT_NONE);
+	}
 	else
 		tuplesort = NULL;
 
@@ -762,7 +912,12 @@ heapam_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
 		pgstat_progress_update_param(PROGRESS_CLUSTER_PHASE,
 									 PROGRESS_CLUSTER_PHASE_SEQ_SCAN_HEAP);
 
-		tableScan = table_beginscan(OldHeap, SnapshotAny, 0, (ScanKey) NULL);
+		/* In a parallel CLUSTER, join the scan the workers have started */
+		if (leader != NULL)
+			tableScan = table_beginscan_parallel(OldHeap,
+												 ParallelTableScanFromHeapClusterShared(leader->shared));
+		else
+			tableScan = table_beginscan(OldHeap, SnapshotAny, 0, (ScanKey) NULL);
 		heapScan = (HeapScanDesc) tableScan;
 		indexScan = NULL;
 
@@ -822,14 +977,22 @@ heapam_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
 			 * rs_startblock may be >0, and rs_cblock may end with a number
 			 * below rs_startblock. To prevent showing this wraparound to the
 			 * user, we offset rs_cblock by rs_startblock (modulo rs_nblocks).
+			 * A parallel scan tracks its start block elsewhere, and as the
+			 * blocks are handed out in order, the position of our current
+			 * block is a good approximation of the progress of the whole
+			 * scan.
 			 */
 			if (prev_cblock != heapScan->rs_cblock)
 			{
-				pgstat_progress_update_param(PROGRESS_CLUSTER_HEAP_BLKS_SCANNED,
-											 (heapScan->rs_cblock +
-											  heapScan->rs_nblocks -
-											  heapScan->rs_startblock
-											  ) % heapScan->rs_nblocks + 1);
+				if (leader != NULL)
+					pgstat_progress_update_param(PROGRESS_CLUSTER_HEAP_BLKS_SCANNED,
+												 heapam_scan_get_blocks_done(heapScan) + 1);
+				else
+					pgstat_progress_update_param(PROGRESS_CLUSTER_HEAP_BLKS_SCANNED,
+												 (heapScan->rs_cblock +
+												  heapScan->rs_nblocks -
+												  heapScan->rs_startblock
+												  ) % heapScan->rs_nblocks + 1);
 				prev_cblock = heapScan->rs_cblock;
 			}
 		}
@@ -837,58 +1000,9 @@ heapam_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
 		tuple = ExecFetchSlotHeapTuple(slot, false, NULL);
 		buf = hslot->buffer;
 
-		LockBuffer(buf, BUFFER_LOCK_SHARE);
-
-		switch (HeapTupleSatisfiesVacuum(tuple, OldestXmin, buf))
-		{
-			case HEAPTUPLE_DEAD:
-				/* Definitely dead */
-				isdead = true;
-				break;
-			case HEAPTUPLE_RECENTLY_DEAD:
-				*tups_recently_dead += 1;
-				/* fall through */
-			case HEAPTUPLE_LIVE:
-				/* Live or recently dead, must copy it */
-				isdead = false;
-				break;
-			case HEAPTUPLE_INSERT_IN_PROGRESS:
-
-				/*
-				 * Since we hold exclusive lock on the relation, normally the
-				 * only way to see this is if it was inserted earlier in our
-				 * own transaction.  However, it can happen in system
-				 * catalogs, since we tend to release write lock before commit
-				 * there.  Give a warning if neither case applies; but in any
-				 * case we had better copy it.
-				 */
-				if (!is_system_catalog &&
-					!TransactionIdIsCurrentTransactionId(HeapTupleHeaderGetXmin(tuple->t_data)))
-					elog(WARNING, "concurrent insert in progress within table \"%s\"",
-						 RelationGetRelationName(OldHeap));
-				/* treat as live */
-				isdead = false;
-				break;
-			case HEAPTUPLE_DELETE_IN_PROGRESS:
-
-				/*
-				 * Similar situation to INSERT_IN_PROGRESS case.
-				 */
-				if (!is_system_catalog &&
-					!TransactionIdIsCurrentTransactionId(HeapTupleHeaderGetUpdateXid(tuple->t_data)))
-					elog(WARNING, "concurrent delete in progress within table \"%s\"",
-						 RelationGetRelationName(OldHeap));
-				/* treat as recently dead */
-				*tups_recently_dead += 1;
-				isdead = false;
-				break;
-			default:
-				elog(ERROR, "unexpected HeapTupleSatisfiesVacuum result");
-				isdead = false; /* keep compiler quiet */
-				break;
-		}
-
-		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+		isdead = heapam_cluster_tuple_is_dead(OldHeap, tuple, buf, OldestXmin,
+											  is_system_catalog,
+											  tups_recently_dead);
 
 		if (isdead)
 		{
@@ -957,6 +1071,31 @@ heapam_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
 
 		tuplesort_performsort(tuplesort);
 
+		/*
+		 * In a parallel CLUSTER, that only sorted our own share of the
+		 * tuples.  Once the workers are done with theirs, merge all the
+		 * sorted runs.
+		 */
+		if (leader != NULL)
+		{
+			SortCoordinate coordinate = palloc0_object(SortCoordinateData);
+
+			tuplesort_end(tuplesort);
+
+			heapam_cluster_wait_for_workers(leader, num_tuples, tups_vacuumed,
+											tups_recently_dead);
+			pgstat_progress_update_param(PROGRESS_CLUSTER_HEAP_TUPLES_SCANNED,
+										 *num_tuples);
+
+			coordinate->isWorker = false;
+			coordinate->nParticipants = leader->nparticipanttuplesorts;
+			coordinate->sharedsort = leader->sharedsort;
+			tuplesort = tuplesort_begin_cluster(oldTupDesc, OldIndex,
+												maintenance_work_mem,
+												coordinate, TUPLESORT_NONE);
+			tuplesort_performsort(tuplesort);
+		}
+
 		/* Report that we are now writing new heap */
 		pgstat_progress_update_param(PROGRESS_CLUSTER_PHASE,
 									 PROGRESS_CLUSTER_PHASE_WRITE_NEW_HEAP);
@@ -982,6 +1121,9 @@ heapam_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
 		}
 
 		tuplesort_end(tuplesort);
+
+		if (leader != NULL)
+			heapam_cluster_end_parallel(leader);
 	}
 
 	/* Write out any remaining tuples, and fsync if needed */
@@ -992,6 +1134,386 @@ heapam_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
 	pfree(isnull);
 }
 
+/*
+ * Decide whether a tuple of the old heap is dead, for CLUSTER and VACUUM
+ * FULL.  The caller must hold a pin on the tuple's buffer.  Recently-dead
+ * tuples, which must still be copied, are counted in *tups_recently_dead.
+ */
+static bool
+heapam_cluster_tuple_is_dead(Relation OldHeap, HeapTuple tuple, Buffer buf,
+							 TransactionId OldestXmin, bool is_system_catalog,
+							 double *tups_recently_dead)
+{
+	bool		isdead;
+
+	LockBuffer(buf, BUFFER_LOCK_SHARE);
+
+	switch (HeapTupleSatisfiesVacuum(tuple, OldestXmin, buf))
+	{
+		case HEAPTUPLE_DEAD:
+			/* Definitely dead */
+			isdead = true;
+			break;
+		case HEAPTUPLE_RECENTLY_DEAD:
+			*tups_recently_dead += 1;
+			/* fall through */
+		case HEAPTUPLE_LIVE:
+			/* Live or recently dead, must copy it */
+			isdead = false;
+			break;
+		case HEAPTUPLE_INSERT_IN_PROGRESS:
+
+			/*
+			 * Since we hold exclusive lock on the relation, normally the
+			 * only way to see this is if it was inserted earlier in our
+			 * own transaction.  However, it can happen in system
+			 * catalogs, since we tend to release write lock before commit
+			 * there.  Give a warning if neither case applies; but in any
+			 * case we had better copy it.
+			 */
+			if (!is_system_catalog &&
+				!TransactionIdIsCurrentTransactionId(HeapTupleHeaderGetXmin(tuple->t_data)))
+				elog(WARNING, "concurrent insert in progress within table \"%s\"",
+					 RelationGetRelationName(OldHeap));
+			/* treat as live */
+			isdead = false;
+			break;
+		case HEAPTUPLE_DELETE_IN_PROGRESS:
+
+			/*
+			 * Similar situation to INSERT_IN_PROGRESS case.
+			 */
+			if (!is_system_catalog &&
+				!TransactionIdIsCurrentTransactionId(HeapTupleHeaderGetUpdateXid(tuple->t_data)))
+				elog(WARNING, "concurrent delete in progress within table \"%s\"",
+					 RelationGetRelationName(OldHeap));
+			/* treat as recently dead */
+			*tups_recently_dead += 1;
+			isdead = false;
+			break;
+		default:
+			elog(ERROR, "unexpected HeapTupleSatisfiesVacuum result");
+			isdead = false; /* keep compiler quiet */
+			break;
+	}
+
+	LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+
+	return isdead;
+}
+
+/*
+ * Launch parallel workers to scan and sort the old heap for CLUSTER.
+ *
+ * request is the target number of worker processes.  Returns NULL, leaving
+ * the caller to do a serial scan and sort, if no worker could be launched.
+ * Otherwise, the caller must join the parallel scan, sort its own share of
+ * the tuples, and shut the workers down with heapam_cluster_end_parallel()
+ * once it has read the merged result.
+ */
+static HeapClusterLeader *
+heapam_cluster_begin_parallel(Relation OldHeap, Relation OldIndex,
+							  TransactionId OldestXmin, int request)
+{
+	ParallelContext *pcxt;
+	int			scantuplesortstates;
+	Size		estshared;
+	Size		estsort;
+	HeapClusterShared *shared;
+	Sharedsort *sharedsort;
+	HeapClusterLeader *leader;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+	int			querylen;
+
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "heap_parallel_cluster_main",
+								 request);
+
+	/* The leader always participates */
+	scantuplesortstates = request + 1;
+
+	/*
+	 * Estimate size for our own PARALLEL_KEY_CLUSTER_SHARED workspace, and
+	 * PARALLEL_KEY_CLUSTER_TUPLESORT tuplesort workspace.  Like the serial
+	 * scan, the parallel scan uses SnapshotAny, and we do our own visibility
+	 * checks.
+	 */
+	estshared = add_size(BUFFERALIGN(sizeof(HeapClusterShared)),
+						 table_parallelscan_estimate(OldHeap, SnapshotAny));
+	shm_toc_estimate_chunk(&pcxt->estimator, estshared);
+	estsort = tuplesort_estimate_shared(scantuplesortstates);
+	shm_toc_estimate_chunk(&pcxt->estimator, estsort);
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	/* Estimate space for WalUsage and BufferUsage of each worker */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_KEY_CLUSTER_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial CLUSTER) */
+	if (pcxt->seg == NULL)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return NULL;
+	}
+
+	shared = (HeapClusterShared *) shm_toc_allocate(pcxt->toc, estshared);
+	shared->heaprelid = RelationGetRelid(OldHeap);
+	shared->indexrelid = RelationGetRelid(OldIndex);
+	shared->OldestXmin = OldestXmin;
+	shared->scantuplesortstates = scantuplesortstates;
+	shared->queryid = pgstat_get_my_query_id();
+	ConditionVariableInit(&shared->workersdonecv);
+	SpinLockInit(&shared->mutex);
+	shared->nparticipantsdone = 0;
+	shared->num_tuples = 0;
+	shared->tups_vacuumed = 0;
+	shared->tups_recently_dead = 0;
+	table_parallelscan_initialize(OldHeap,
+								  ParallelTableScanFromHeapClusterShared(shared),
+								  SnapshotAny);
+
+	sharedsort = (Sharedsort *) shm_toc_allocate(pcxt->toc, estsort);
+	tuplesort_initialize_shared(sharedsort, scantuplesortstates, pcxt->seg);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_CLUSTER_SHARED, shared);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_CLUSTER_TUPLESORT, sharedsort);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_CLUSTER_QUERY_TEXT, sharedquery);
+	}
+
+	walusage = shm_toc_allocate(pcxt->toc,
+								mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_CLUSTER_WAL_USAGE, walusage);
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_CLUSTER_BUFFER_USAGE, bufferusage);
+
+	LaunchParallelWorkers(pcxt);
+
+	leader = palloc0_object(HeapClusterLeader);
+	leader->pcxt = pcxt;
+	leader->nparticipanttuplesorts = pcxt->nworkers_launched + 1;
+	leader->shared = shared;
+	leader->sharedsort = sharedsort;
+	leader->walusage = walusage;
+	leader->bufferusage = bufferusage;
+
+	/* If no workers were successfully launched, back out (do serial CLUSTER) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		heapam_cluster_end_parallel(leader);
+		pfree(leader);
+		return NULL;
+	}
+
+	/*
+	 * Caller will wait for all launched workers.  Make sure that the
+	 * failure-to-start case will not hang forever.
+	 */
+	WaitForParallelWorkersToAttach(pcxt);
+
+	return leader;
+}
+
+/*
+ * Within the leader of a parallel CLUSTER, wait for the workers to finish
+ * their scan and sort, and add their tuple counts to ours.
+ */
+static void
+heapam_cluster_wait_for_workers(HeapClusterLeader *leader, double *num_tuples,
+								double *tups_vacuumed,
+								double *tups_recently_dead)
+{
+	HeapClusterShared *shared = leader->shared;
+	int			nworkers = leader->nparticipanttuplesorts - 1;
+
+	for (;;)
+	{
+		SpinLockAcquire(&shared->mutex);
+		if (shared->nparticipantsdone == nworkers)
+		{
+			*num_tuples += shared->num_tuples;
+			*tups_vacuumed += shared->tups_vacuumed;
+			*tups_recently_dead += shared->tups_recently_dead;
+			SpinLockRelease(&shared->mutex);
+			break;
+		}
+		SpinLockRelease(&shared->mutex);
+
+		ConditionVariableSleep(&shared->workersdonecv,
+							   WAIT_EVENT_PARALLEL_CLUSTER_SCAN);
+	}
+
+	ConditionVariableCancelSleep();
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ */
+static void
+heapam_cluster_end_parallel(HeapClusterLeader *leader)
+{
+	WaitForParallelWorkersToFinish(leader->pcxt);
+
+	/*
+	 * Next, accumulate WAL and buffer usage.  (This must wait for the workers
+	 * to finish, or we might get incomplete data.)
+	 */
+	for (int i = 0; i < leader->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&leader->bufferusage[i], &leader->walusage[i]);
+
+	DestroyParallelContext(leader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Perform a worker's share of the scan and sort of a parallel CLUSTER.
+ *
+ * Dead tuples are only counted.  The leader doesn't need to hear about them:
+ * rewrite_heap_dead_tuple() can't find anything to forget about before the
+ * new heap is written, which only starts after the sort.
+ */
+static void
+heapam_cluster_worker_scan_and_sort(Relation OldHeap, Relation OldIndex,
+									HeapClusterShared *shared,
+									Sharedsort *sharedsort, int sortmem)
+{
+	SortCoordinate coordinate;
+	Tuplesortstate *tuplesort;
+	TableScanDesc scan;
+	TupleTableSlot *slot;
+	double		num_tuples = 0;
+	double		tups_vacuumed = 0;
+	double		tups_recently_dead = 0;
+
+	coordinate = palloc0_object(SortCoordinateData);
+	coordinate->isWorker = true;
+	coordinate->nParticipants = -1;
+	coordinate->sharedsort = sharedsort;
+
+	tuplesort = tuplesort_begin_cluster(RelationGetDescr(OldHeap), OldIndex,
+										sortmem, coordinate, TUPLESORT_NONE);
+
+	scan = table_beginscan_parallel(OldHeap,
+									ParallelTableScanFromHeapClusterShared(shared));
+	slot = table_slot_create(OldHeap, NULL);
+
+	while (table_scan_getnextslot(scan, ForwardScanDirection, slot))
+	{
+		HeapTuple	tuple;
+
+		CHECK_FOR_INTERRUPTS();
+
+		tuple = ExecFetchSlotHeapTuple(slot, false, NULL);
+
+		if (heapam_cluster_tuple_is_dead(OldHeap, tuple,
+										 ((BufferHeapTupleTableSlot *) slot)->buffer,
+										 shared->OldestXmin, false,
+										 &tups_recently_dead))
+		{
+			tups_vacuumed += 1;
+			continue;
+		}
+
+		num_tuples += 1;
+		tuplesort_putheaptuple(tuplesort, tuple);
+	}
+
+	table_endscan(scan);
+	ExecDropSingleTupleTableSlot(slot);
+
+	tuplesort_performsort(tuplesort);
+
+	SpinLockAcquire(&shared->mutex);
+	shared->nparticipantsdone++;
+	shared->num_tuples += num_tuples;
+	shared->tups_vacuumed += tups_vacuumed;
+	shared->tups_recently_dead += tups_recently_dead;
+	SpinLockRelease(&shared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&shared->workersdonecv);
+
+	/* We can end the tuplesort immediately */
+	tuplesort_end(tuplesort);
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+heap_parallel_cluster_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	HeapClusterShared *shared;
+	Sharedsort *sharedsort;
+	Relation	heapRel;
+	Relation	indexRel;
+	WalUsage   *walusage;
+	BufferUsage *bufferusage;
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_CLUSTER_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	shared = shm_toc_lookup(toc, PARALLEL_KEY_CLUSTER_SHARED, false);
+
+	/* Track query ID */
+	pgstat_report_query_id(shared->queryid, false);
+
+	/* Open relations using the lock mode held by the leader */
+	heapRel = table_open(shared->heaprelid, AccessExclusiveLock);
+	indexRel = index_open(shared->indexrelid, AccessExclusiveLock);
+
+	/* Look up shared state private to tuplesort.c */
+	sharedsort = shm_toc_lookup(toc, PARALLEL_KEY_CLUSTER_TUPLESORT, false);
+	tuplesort_attach_shared(sharedsort, seg);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	heapam_cluster_worker_scan_and_sort(heapRel, indexRel, shared, sharedsort,
+										maintenance_work_mem / shared->scantuplesortstates);
+
+	/* Report WAL/buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_CLUSTER_BUFFER_USAGE, false);
+	walusage = shm_toc_lookup(toc, PARALLEL_KEY_CLUSTER_WAL_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber],
+						  &walusage[ParallelWorkerNumber]);
+
+	index_close(indexRel, AccessExclusiveLock);
+	table_close(heapRel, AccessExclusiveLock);
+}
+
 /*
  * Prepare to analyze the next block in the read stream.  Returns false if
  * the stream is exhausted and true otherwise. The scan must have been started
@@ -2622,6 +3144,8 @@ static const TableAmRoutine heapam_methods = {
 	.scan_end = heap_endscan,
 	.scan_rescan = heap_rescan,
 	.scan_getnextslot = heap_getnextslot,
+	.scan_getnextbatch = heap_getnextbatch,
+	.scan_prefetch = heap_scan_prefetch,
 
 	.scan_set_tidrange = heap_set_tidrange,
 	.scan_getnextslot_tidrange = heap_getnextslot_tidrange,
@@ -23,6 +23,13 @@
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
 
+/*
+ * Maximum number of times RelationGetBufferForTuple() asks the FSM for a
+ * different page when the target page is locked by another backend, before
+ * it waits for the lock.
+ */
+#define MAX_CONTENDED_TARGET_PAGES	3
+
 
 /*
  * RelationPutHeapTuple - place tuple at specified page
@@ -514,6 +521,7 @@ RelationGetBufferForTuple(Relation relation, Size len,
 				otherBlock;
 	bool		unlockedTargetBuffer;
 	bool		recheckVmPins;
+	int			ncontended = 0;
 
 	len = MAXALIGN(len);		/* be conservative */
 
@@ -625,7 +633,32 @@ loop:
 				(PageGetMaxOffsetNumber(BufferGetPage(buffer)) == 0))
 				visibilitymap_pin(relation, targetBlock, vmbuffer);
 
-			LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+			/*
+			 * If another backend has the page locked, most likely because it
+			 * is inserting into it as well, try another page rather than
+			 * queueing up behind it.  The FSM hands out pages in round-robin
+			 * fashion, so asking it again normally yields a different page
+			 * with enough free space, and concurrent inserters spread out over
+			 * as many pages.  After a few attempts, or if there is no other
+			 * page, just wait for the lock.
+			 */
+			if (!use_fsm || bistate ||
+				ncontended >= MAX_CONTENDED_TARGET_PAGES)
+				LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+			else if (!ConditionalLockBuffer(buffer))
+			{
+				BlockNumber altBlock;
+
+				ncontended++;
+				altBlock = GetPageWithFreeSpace(relation, targetFreeSpace);
+				if (altBlock != InvalidBlockNumber && altBlock != targetBlock)
+				{
+					ReleaseBuffer(buffer);
+					targetBlock = altBlock;
+					continue;
+				}
+				LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+			}
 		}
 		else if (otherBlock == targetBlock)
 		{
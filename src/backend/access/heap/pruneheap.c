@@ -191,6 +191,8 @@ static void page_verify_redirects(Page page);
 static bool heap_page_will_freeze(Relation relation, Buffer buffer,
 								  bool did_tuple_hint_fpi, bool do_prune, bool do_hint_prune,
 								  PruneState *prstate);
+static void heap_page_prune_opt_internal(Relation relation, Buffer buffer,
+										 bool background);
 
 
 /*
@@ -207,6 +209,26 @@ static bool heap_page_will_freeze(Relation relation, Buffer buffer,
  */
 void
 heap_page_prune_opt(Relation relation, Buffer buffer)
+{
+	heap_page_prune_opt_internal(relation, buffer, false);
+}
+
+/*
+ * Like heap_page_prune_opt(), for the background pruner.
+ *
+ * The background pruner visits pages that were recently updated or deleted
+ * from, so that the queries that read them next don't have to, and prunes
+ * them whenever there is something to prune, not only when the page is
+ * running out of free space.
+ */
+void
+heap_page_prune_background(Relation relation, Buffer buffer)
+{
+	heap_page_prune_opt_internal(relation, buffer, true);
+}
+
+static void
+heap_page_prune_opt_internal(Relation relation, Buffer buffer, bool background)
 {
 	Page		page = BufferGetPage(buffer);
 	TransactionId prune_xid;
@@ -255,7 +277,7 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
 											 HEAP_DEFAULT_FILLFACTOR);
 	minfree = Max(minfree, BLCKSZ / 10);
 
-	if (PageIsFull(page) || PageGetHeapFreeSpace(page) < minfree)
+	if (background || PageIsFull(page) || PageGetHeapFreeSpace(page) < minfree)
 	{
 		/* OK, try to get exclusive buffer lock */
 		if (!ConditionalLockBufferForCleanup(buffer))
@@ -266,7 +288,7 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
 		 * page's free space, and recheck the heuristic about whether to
 		 * prune.
 		 */
-		if (PageIsFull(page) || PageGetHeapFreeSpace(page) < minfree)
+		if (background || PageIsFull(page) || PageGetHeapFreeSpace(page) < minfree)
 		{
 			OffsetNumber dummy_off_loc;
 			PruneFreezeResult presult;
@@ -153,6 +153,7 @@
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
 #include "storage/read_stream.h"
+#include "storage/spin.h"
 #include "utils/lsyscache.h"
 #include "utils/pg_rusage.h"
 #include "utils/timestamp.h"
@@ -213,6 +214,13 @@
  */
 #define PREFETCH_SIZE			((BlockNumber) 32)
 
+/*
+ * Size of the ranges of blocks handed out to the participants of a parallel
+ * heap scan.  Ranges are skipped as a whole when the visibility map allows
+ * it, so use the same threshold as for skipping in a serial scan.
+ */
+#define PARALLEL_VACUUM_CHUNK_SIZE	SKIP_PAGES_THRESHOLD
+
 /*
  * Macro to check if we are in a parallel vacuum.  If true, we are in the
  * parallel mode and the DSM segment is initialized.
@@ -418,6 +426,56 @@ typedef struct LVSavedErrInfo
 	VacErrPhase phase;
 } LVSavedErrInfo;
 
+/*
+ * Shared state of a parallel heap scan (the first pass over the heap), kept
+ * in the parallel vacuum DSM segment.
+ *
+ * The leader and the workers claim ranges of PARALLEL_VACUUM_CHUNK_SIZE
+ * blocks from next_block until the relation is exhausted or the shared
+ * dead_items store fills up, which ends the round.  The leader then performs
+ * a round of index and heap vacuuming and starts the next round where the
+ * previous one stopped.
+ */
+typedef struct LVParallelScanShared
+{
+	/* Set by the leader before the first round, read-only afterwards */
+	struct VacuumCutoffs cutoffs;
+	BlockNumber rel_pages;
+	bool		aggressive;
+	bool		skipwithvm;
+
+	/* Set by the leader at the start of each round */
+	bool		do_index_vacuuming;
+
+	/* Next block to hand out, and whether the current round must stop */
+	pg_atomic_uint64 next_block;
+	pg_atomic_uint32 stop;
+
+	/*
+	 * Results of the workers, accumulated under the mutex.  The leader
+	 * collects its own results in its LVRelState directly, and merges these
+	 * into it (resetting them) at the end of each round.
+	 */
+	slock_t		mutex;
+	BlockNumber scanned_pages;
+	BlockNumber new_frozen_tuple_pages;
+	BlockNumber vm_new_visible_pages;
+	BlockNumber vm_new_visible_frozen_pages;
+	BlockNumber vm_new_frozen_pages;
+	BlockNumber lpdead_item_pages;
+	BlockNumber missed_dead_pages;
+	BlockNumber nonempty_pages;
+	int64		tuples_deleted;
+	int64		tuples_frozen;
+	int64		lpdead_items;
+	int64		live_tuples;
+	int64		recently_dead_tuples;
+	int64		missed_dead_tuples;
+	TransactionId NewRelfrozenXid;
+	MultiXactId NewRelminMxid;
+	bool		skippedallvis;
+} LVParallelScanShared;
+
 
 /* non-export function prototypes */
 static void lazy_scan_heap(LVRelState *vacrel);
@@ -427,6 +485,13 @@ static BlockNumber heap_vac_scan_next_block(ReadStream *stream,
 											void *callback_private_data,
 											void *per_buffer_data);
 static void find_next_unskippable_block(LVRelState *vacrel, bool *skipsallvis);
+static int	lazy_scan_heap_page(LVRelState *vacrel, Buffer buf, uint8 blk_info,
+								Buffer *vmbuffer, bool *got_cleanup_lock_p,
+								bool *vm_page_frozen);
+static BlockNumber lazy_scan_heap_serial(LVRelState *vacrel);
+static BlockNumber lazy_scan_heap_parallel(LVRelState *vacrel);
+static void lazy_scan_heap_participate(LVRelState *vacrel,
+									   LVParallelScanShared *shared);
 static bool lazy_scan_new_or_empty(LVRelState *vacrel, Buffer buf,
 								   BlockNumber blkno, Page page,
 								   bool sharelock, Buffer vmbuffer);
@@ -1225,13 +1290,8 @@ heap_vacuum_rel(Relation rel, const VacuumParams params,
 static void
 lazy_scan_heap(LVRelState *vacrel)
 {
-	ReadStream *stream;
 	BlockNumber rel_pages = vacrel->rel_pages,
-				blkno = 0,
-				next_fsm_block_to_vacuum = 0;
-	BlockNumber orig_eager_scan_success_limit =
-		vacrel->eager_scan_remaining_successes; /* for logging */
-	Buffer		vmbuffer = InvalidBuffer;
+				next_fsm_block_to_vacuum;
 	const int	initprog_index[] = {
 		PROGRESS_VACUUM_PHASE,
 		PROGRESS_VACUUM_TOTAL_HEAP_BLKS,
@@ -1245,6 +1305,78 @@ lazy_scan_heap(LVRelState *vacrel)
 	initprog_val[2] = vacrel->dead_items_info->max_bytes;
 	pgstat_progress_update_multi_param(3, initprog_index, initprog_val);
 
+	/*
+	 * Scan the heap with the help of parallel workers if parallel vacuum set
+	 * up a heap scan for us, else on our own.
+	 */
+	if (ParallelVacuumIsActive(vacrel) &&
+		parallel_vacuum_get_scan_state(vacrel->pvs) != NULL)
+		next_fsm_block_to_vacuum = lazy_scan_heap_parallel(vacrel);
+	else
+		next_fsm_block_to_vacuum = lazy_scan_heap_serial(vacrel);
+
+	/*
+	 * Report that everything is now scanned. We never skip scanning the last
+	 * block in the relation, so we can pass rel_pages here.
+	 */
+	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED,
+								 rel_pages);
+
+	/* now we can compute the new value for pg_class.reltuples */
+	vacrel->new_live_tuples = vac_estimate_reltuples(vacrel->rel, rel_pages,
+													 vacrel->scanned_pages,
+													 vacrel->live_tuples);
+
+	/*
+	 * Also compute the total number of surviving heap entries.  In the
+	 * (unlikely) scenario that new_live_tuples is -1, take it as zero.
+	 */
+	vacrel->new_rel_tuples =
+		Max(vacrel->new_live_tuples, 0) + vacrel->recently_dead_tuples +
+		vacrel->missed_dead_tuples;
+
+	/*
+	 * Do index vacuuming (call each index's ambulkdelete routine), then do
+	 * related heap vacuuming
+	 */
+	if (vacrel->dead_items_info->num_items > 0)
+		lazy_vacuum(vacrel);
+
+	/*
+	 * Vacuum the remainder of the Free Space Map.  We must do this whether or
+	 * not there were indexes, and whether or not we bypassed index vacuuming.
+	 * We can pass rel_pages here because we never skip scanning the last
+	 * block of the relation.
+	 */
+	if (rel_pages > next_fsm_block_to_vacuum)
+		FreeSpaceMapVacuumRange(vacrel->rel, next_fsm_block_to_vacuum, rel_pages);
+
+	/* report all blocks vacuumed */
+	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, rel_pages);
+
+	/* Do final index cleanup (call each index's amvacuumcleanup routine) */
+	if (vacrel->nindexes > 0 && vacrel->do_index_cleanup)
+		lazy_cleanup_all_indexes(vacrel);
+}
+
+/*
+ *	lazy_scan_heap_serial() -- first pass over the heap, without workers
+ *
+ *		Processes the blocks returned by heap_vac_scan_next_block() through a
+ *		read stream, performing rounds of index and heap vacuuming whenever
+ *		dead_items fills up.  Returns the block up to which the FSM has been
+ *		vacuumed.
+ */
+static BlockNumber
+lazy_scan_heap_serial(LVRelState *vacrel)
+{
+	ReadStream *stream;
+	BlockNumber blkno = 0,
+				next_fsm_block_to_vacuum = 0;
+	BlockNumber orig_eager_scan_success_limit =
+		vacrel->eager_scan_remaining_successes; /* for logging */
+	Buffer		vmbuffer = InvalidBuffer;
+
 	/* Initialize for the first heap_vac_scan_next_block() call */
 	vacrel->current_block = InvalidBlockNumber;
 	vacrel->next_unskippable_block = InvalidBlockNumber;
@@ -1269,10 +1401,8 @@ lazy_scan_heap(LVRelState *vacrel)
 	while (true)
 	{
 		Buffer		buf;
-		Page		page;
 		uint8		blk_info = 0;
-		int			ndeleted = 0;
-		bool		has_lpdead_items;
+		int			ndeleted;
 		void	   *per_buffer_data = NULL;
 		bool		vm_page_frozen = false;
 		bool		got_cleanup_lock = false;
@@ -1341,7 +1471,6 @@ lazy_scan_heap(LVRelState *vacrel)
 
 		blk_info = *((uint8 *) per_buffer_data);
 		CheckBufferIsPinnedOnce(buf);
-		page = BufferGetPage(buf);
 		blkno = BufferGetBlockNumber(buf);
 
 		vacrel->scanned_pages++;
@@ -1353,71 +1482,8 @@ lazy_scan_heap(LVRelState *vacrel)
 		update_vacuum_error_info(vacrel, NULL, VACUUM_ERRCB_PHASE_SCAN_HEAP,
 								 blkno, InvalidOffsetNumber);
 
-		/*
-		 * Pin the visibility map page in case we need to mark the page
-		 * all-visible.  In most cases this will be very cheap, because we'll
-		 * already have the correct page pinned anyway.
-		 */
-		visibilitymap_pin(vacrel->rel, blkno, &vmbuffer);
-
-		/*
-		 * We need a buffer cleanup lock to prune HOT chains and defragment
-		 * the page in lazy_scan_prune.  But when it's not possible to acquire
-		 * a cleanup lock right away, we may be able to settle for reduced
-		 * processing using lazy_scan_noprune.
-		 */
-		got_cleanup_lock = ConditionalLockBufferForCleanup(buf);
-
-		if (!got_cleanup_lock)
-			LockBuffer(buf, BUFFER_LOCK_SHARE);
-
-		/* Check for new or empty pages before lazy_scan_[no]prune call */
-		if (lazy_scan_new_or_empty(vacrel, buf, blkno, page, !got_cleanup_lock,
-								   vmbuffer))
-		{
-			/* Processed as new/empty page (lock and pin released) */
-			continue;
-		}
-
-		/*
-		 * If we didn't get the cleanup lock, we can still collect LP_DEAD
-		 * items in the dead_items area for later vacuuming, count live and
-		 * recently dead tuples for vacuum logging, and determine if this
-		 * block could later be truncated. If we encounter any xid/mxids that
-		 * require advancing the relfrozenxid/relminxid, we'll have to wait
-		 * for a cleanup lock and call lazy_scan_prune().
-		 */
-		if (!got_cleanup_lock &&
-			!lazy_scan_noprune(vacrel, buf, blkno, page, &has_lpdead_items))
-		{
-			/*
-			 * lazy_scan_noprune could not do all required processing.  Wait
-			 * for a cleanup lock, and call lazy_scan_prune in the usual way.
-			 */
-			Assert(vacrel->aggressive);
-			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
-			LockBufferForCleanup(buf);
-			got_cleanup_lock = true;
-		}
-
-		/*
-		 * If we have a cleanup lock, we must now prune, freeze, and count
-		 * tuples. We may have acquired the cleanup lock originally, or we may
-		 * have gone back and acquired it after lazy_scan_noprune() returned
-		 * false. Either way, the page hasn't been processed yet.
-		 *
-		 * Like lazy_scan_noprune(), lazy_scan_prune() will count
-		 * recently_dead_tuples and live tuples for vacuum logging, determine
-		 * if the block can later be truncated, and accumulate the details of
-		 * remaining LP_DEAD line pointers on the page into dead_items. These
-		 * dead items include those pruned by lazy_scan_prune() as well as
-		 * line pointers previously marked LP_DEAD.
-		 */
-		if (got_cleanup_lock)
-			ndeleted = lazy_scan_prune(vacrel, buf, blkno, page,
-									   vmbuffer,
-									   blk_info & VAC_BLK_ALL_VISIBLE_ACCORDING_TO_VM,
-									   &has_lpdead_items, &vm_page_frozen);
+		ndeleted = lazy_scan_heap_page(vacrel, buf, blk_info, &vmbuffer,
+									   &got_cleanup_lock, &vm_page_frozen);
 
 		/*
 		 * Count an eagerly scanned page as a failure or a success.
@@ -1475,99 +1541,452 @@ lazy_scan_heap(LVRelState *vacrel)
 		}
 
 		/*
-		 * Now drop the buffer lock and, potentially, update the FSM.
-		 *
-		 * Our goal is to update the freespace map the last time we touch the
-		 * page. If we'll process a block in the second pass, we may free up
-		 * additional space on the page, so it is better to update the FSM
-		 * after the second pass. If the relation has no indexes, or if index
-		 * vacuuming is disabled, there will be no second heap pass; if this
-		 * particular page has no dead items, the second heap pass will not
-		 * touch this page. So, in those cases, update the FSM now.
-		 *
-		 * Note: In corner cases, it's possible to miss updating the FSM
-		 * entirely. If index vacuuming is currently enabled, we'll skip the
-		 * FSM update now. But if failsafe mode is later activated, or there
-		 * are so few dead tuples that index vacuuming is bypassed, there will
-		 * also be no opportunity to update the FSM later, because we'll never
-		 * revisit this page. Since updating the FSM is desirable but not
-		 * absolutely required, that's OK.
+		 * Periodically perform FSM vacuuming to make newly-freed space
+		 * visible on upper FSM pages. This is done after vacuuming if the
+		 * table has indexes. There will only be newly-freed space if we held
+		 * the cleanup lock and lazy_scan_prune() was called.
 		 */
-		if (vacrel->nindexes == 0
-			|| !vacrel->do_index_vacuuming
-			|| !has_lpdead_items)
+		if (got_cleanup_lock && vacrel->nindexes == 0 && ndeleted > 0 &&
+			blkno - next_fsm_block_to_vacuum >= VACUUM_FSM_EVERY_PAGES)
 		{
-			Size		freespace = PageGetHeapFreeSpace(page);
-
-			UnlockReleaseBuffer(buf);
-			RecordPageWithFreeSpace(vacrel->rel, blkno, freespace);
-
-			/*
-			 * Periodically perform FSM vacuuming to make newly-freed space
-			 * visible on upper FSM pages. This is done after vacuuming if the
-			 * table has indexes. There will only be newly-freed space if we
-			 * held the cleanup lock and lazy_scan_prune() was called.
-			 */
-			if (got_cleanup_lock && vacrel->nindexes == 0 && ndeleted > 0 &&
-				blkno - next_fsm_block_to_vacuum >= VACUUM_FSM_EVERY_PAGES)
-			{
-				FreeSpaceMapVacuumRange(vacrel->rel, next_fsm_block_to_vacuum,
-										blkno);
-				next_fsm_block_to_vacuum = blkno;
-			}
+			FreeSpaceMapVacuumRange(vacrel->rel, next_fsm_block_to_vacuum,
+									blkno);
+			next_fsm_block_to_vacuum = blkno;
 		}
-		else
-			UnlockReleaseBuffer(buf);
 	}
 
 	vacrel->blkno = InvalidBlockNumber;
 	if (BufferIsValid(vmbuffer))
 		ReleaseBuffer(vmbuffer);
 
+	read_stream_end(stream);
+
+	return next_fsm_block_to_vacuum;
+}
+
+/*
+ *	lazy_scan_heap_page() -- first pass processing of one heap page
+ *
+ *		Prunes, freezes and counts the tuples of the pinned page "buf", whose
+ *		visibility map bits are described by blk_info, and records its free
+ *		space in the FSM unless the second heap pass will visit it.  Releases
+ *		the page.  *vmbuffer is the visibility map page pinned by the caller
+ *		(if any), which may be replaced.
+ *
+ *		Returns the number of tuples deleted from the page.  Sets
+ *		*got_cleanup_lock_p if the page was pruned with a cleanup lock, and
+ *		*vm_page_frozen if it was newly set all-frozen in the visibility map.
+ */
+static int
+lazy_scan_heap_page(LVRelState *vacrel, Buffer buf, uint8 blk_info,
+					Buffer *vmbuffer, bool *got_cleanup_lock_p,
+					bool *vm_page_frozen)
+{
+	BlockNumber blkno = BufferGetBlockNumber(buf);
+	Page		page = BufferGetPage(buf);
+	int			ndeleted = 0;
+	bool		has_lpdead_items;
+	bool		got_cleanup_lock;
+
+	*vm_page_frozen = false;
+
 	/*
-	 * Report that everything is now scanned. We never skip scanning the last
-	 * block in the relation, so we can pass rel_pages here.
+	 * Pin the visibility map page in case we need to mark the page
+	 * all-visible.  In most cases this will be very cheap, because we'll
+	 * already have the correct page pinned anyway.
 	 */
-	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED,
-								 rel_pages);
-
-	/* now we can compute the new value for pg_class.reltuples */
-	vacrel->new_live_tuples = vac_estimate_reltuples(vacrel->rel, rel_pages,
-													 vacrel->scanned_pages,
-													 vacrel->live_tuples);
+	visibilitymap_pin(vacrel->rel, blkno, vmbuffer);
 
 	/*
-	 * Also compute the total number of surviving heap entries.  In the
-	 * (unlikely) scenario that new_live_tuples is -1, take it as zero.
+	 * We need a buffer cleanup lock to prune HOT chains and defragment
+	 * the page in lazy_scan_prune.  But when it's not possible to acquire
+	 * a cleanup lock right away, we may be able to settle for reduced
+	 * processing using lazy_scan_noprune.
 	 */
-	vacrel->new_rel_tuples =
-		Max(vacrel->new_live_tuples, 0) + vacrel->recently_dead_tuples +
-		vacrel->missed_dead_tuples;
+	got_cleanup_lock = ConditionalLockBufferForCleanup(buf);
 
-	read_stream_end(stream);
+	if (!got_cleanup_lock)
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+
+	/* Check for new or empty pages before lazy_scan_[no]prune call */
+	if (lazy_scan_new_or_empty(vacrel, buf, blkno, page, !got_cleanup_lock,
+							   *vmbuffer))
+	{
+		/* Processed as new/empty page (lock and pin released) */
+		*got_cleanup_lock_p = false;
+		return 0;
+	}
 
 	/*
-	 * Do index vacuuming (call each index's ambulkdelete routine), then do
-	 * related heap vacuuming
+	 * If we didn't get the cleanup lock, we can still collect LP_DEAD
+	 * items in the dead_items area for later vacuuming, count live and
+	 * recently dead tuples for vacuum logging, and determine if this
+	 * block could later be truncated. If we encounter any xid/mxids that
+	 * require advancing the relfrozenxid/relminxid, we'll have to wait
+	 * for a cleanup lock and call lazy_scan_prune().
 	 */
-	if (vacrel->dead_items_info->num_items > 0)
-		lazy_vacuum(vacrel);
+	if (!got_cleanup_lock &&
+		!lazy_scan_noprune(vacrel, buf, blkno, page, &has_lpdead_items))
+	{
+		/*
+		 * lazy_scan_noprune could not do all required processing.  Wait
+		 * for a cleanup lock, and call lazy_scan_prune in the usual way.
+		 */
+		Assert(vacrel->aggressive);
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+		LockBufferForCleanup(buf);
+		got_cleanup_lock = true;
+	}
 
 	/*
-	 * Vacuum the remainder of the Free Space Map.  We must do this whether or
-	 * not there were indexes, and whether or not we bypassed index vacuuming.
-	 * We can pass rel_pages here because we never skip scanning the last
-	 * block of the relation.
+	 * If we have a cleanup lock, we must now prune, freeze, and count
+	 * tuples. We may have acquired the cleanup lock originally, or we may
+	 * have gone back and acquired it after lazy_scan_noprune() returned
+	 * false. Either way, the page hasn't been processed yet.
+	 *
+	 * Like lazy_scan_noprune(), lazy_scan_prune() will count
+	 * recently_dead_tuples and live tuples for vacuum logging, determine
+	 * if the block can later be truncated, and accumulate the details of
+	 * remaining LP_DEAD line pointers on the page into dead_items. These
+	 * dead items include those pruned by lazy_scan_prune() as well as
+	 * line pointers previously marked LP_DEAD.
 	 */
-	if (rel_pages > next_fsm_block_to_vacuum)
-		FreeSpaceMapVacuumRange(vacrel->rel, next_fsm_block_to_vacuum, rel_pages);
+	if (got_cleanup_lock)
+		ndeleted = lazy_scan_prune(vacrel, buf, blkno, page,
+								   *vmbuffer,
+								   blk_info & VAC_BLK_ALL_VISIBLE_ACCORDING_TO_VM,
+								   &has_lpdead_items, vm_page_frozen);
+	*got_cleanup_lock_p = got_cleanup_lock;
 
-	/* report all blocks vacuumed */
-	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, rel_pages);
 
-	/* Do final index cleanup (call each index's amvacuumcleanup routine) */
-	if (vacrel->nindexes > 0 && vacrel->do_index_cleanup)
-		lazy_cleanup_all_indexes(vacrel);
+	/*
+	 * Now drop the buffer lock and, potentially, update the FSM.
+	 *
+	 * Our goal is to update the freespace map the last time we touch the
+	 * page. If we'll process a block in the second pass, we may free up
+	 * additional space on the page, so it is better to update the FSM
+	 * after the second pass. If the relation has no indexes, or if index
+	 * vacuuming is disabled, there will be no second heap pass; if this
+	 * particular page has no dead items, the second heap pass will not
+	 * touch this page. So, in those cases, update the FSM now.
+	 *
+	 * Note: In corner cases, it's possible to miss updating the FSM
+	 * entirely. If index vacuuming is currently enabled, we'll skip the
+	 * FSM update now. But if failsafe mode is later activated, or there
+	 * are so few dead tuples that index vacuuming is bypassed, there will
+	 * also be no opportunity to update the FSM later, because we'll never
+	 * revisit this page. Since updating the FSM is desirable but not
+	 * absolutely required, that's OK.
+	 */
+	if (vacrel->nindexes == 0
+		|| !vacrel->do_index_vacuuming
+		|| !has_lpdead_items)
+	{
+		Size		freespace = PageGetHeapFreeSpace(page);
+
+		UnlockReleaseBuffer(buf);
+		RecordPageWithFreeSpace(vacrel->rel, blkno, freespace);
+	}
+	else
+		UnlockReleaseBuffer(buf);
+
+	return ndeleted;
+}
+
+/*
+ *	lazy_scan_heap_parallel() -- first pass over the heap, with workers
+ *
+ *		The leader and the parallel vacuum workers process the heap in ranges
+ *		of PARALLEL_VACUUM_CHUNK_SIZE blocks claimed from the shared scan
+ *		state, collecting dead items in the shared dead_items store.  When it
+ *		fills up, the round ends, and the leader performs a round of index and
+ *		heap vacuuming before starting the next round.  Returns the block up
+ *		to which the FSM has been vacuumed.
+ *
+ *		Eager scanning of all-visible pages is not used, and neither is the
+ *		periodic FSM vacuuming of the serial one-pass strategy; the FSM is
+ *		vacuumed after each round instead.
+ */
+static BlockNumber
+lazy_scan_heap_parallel(LVRelState *vacrel)
+{
+	LVParallelScanShared *shared;
+	BlockNumber next_fsm_block_to_vacuum = 0;
+
+	shared = (LVParallelScanShared *) parallel_vacuum_get_scan_state(vacrel->pvs);
+	shared->cutoffs = vacrel->cutoffs;
+	shared->rel_pages = vacrel->rel_pages;
+	shared->aggressive = vacrel->aggressive;
+	shared->skipwithvm = vacrel->skipwithvm;
+	pg_atomic_init_u64(&shared->next_block, 0);
+	pg_atomic_init_u32(&shared->stop, 0);
+	SpinLockInit(&shared->mutex);
+
+	for (;;)
+	{
+		BlockNumber next_block;
+
+		/* Reset the per-round state */
+		pg_atomic_write_u32(&shared->stop, 0);
+		shared->do_index_vacuuming = vacrel->do_index_vacuuming;
+		shared->scanned_pages = 0;
+		shared->new_frozen_tuple_pages = 0;
+		shared->vm_new_visible_pages = 0;
+		shared->vm_new_visible_frozen_pages = 0;
+		shared->vm_new_frozen_pages = 0;
+		shared->lpdead_item_pages = 0;
+		shared->missed_dead_pages = 0;
+		shared->nonempty_pages = 0;
+		shared->tuples_deleted = 0;
+		shared->tuples_frozen = 0;
+		shared->lpdead_items = 0;
+		shared->live_tuples = 0;
+		shared->recently_dead_tuples = 0;
+		shared->missed_dead_tuples = 0;
+		shared->NewRelfrozenXid = vacrel->NewRelfrozenXid;
+		shared->NewRelminMxid = vacrel->NewRelminMxid;
+		shared->skippedallvis = false;
+
+		parallel_vacuum_scan_heap_begin(vacrel->pvs);
+		lazy_scan_heap_participate(vacrel, shared);
+		parallel_vacuum_scan_heap_end(vacrel->pvs);
+
+		/* Merge the results of the workers into ours */
+		vacrel->scanned_pages += shared->scanned_pages;
+		vacrel->new_frozen_tuple_pages += shared->new_frozen_tuple_pages;
+		vacrel->vm_new_visible_pages += shared->vm_new_visible_pages;
+		vacrel->vm_new_visible_frozen_pages += shared->vm_new_visible_frozen_pages;
+		vacrel->vm_new_frozen_pages += shared->vm_new_frozen_pages;
+		vacrel->lpdead_item_pages += shared->lpdead_item_pages;
+		vacrel->missed_dead_pages += shared->missed_dead_pages;
+		vacrel->nonempty_pages = Max(vacrel->nonempty_pages,
+									 shared->nonempty_pages);
+		vacrel->tuples_deleted += shared->tuples_deleted;
+		vacrel->tuples_frozen += shared->tuples_frozen;
+		vacrel->lpdead_items += shared->lpdead_items;
+		vacrel->live_tuples += shared->live_tuples;
+		vacrel->recently_dead_tuples += shared->recently_dead_tuples;
+		vacrel->missed_dead_tuples += shared->missed_dead_tuples;
+		if (TransactionIdPrecedes(shared->NewRelfrozenXid,
+								  vacrel->NewRelfrozenXid))
+			vacrel->NewRelfrozenXid = shared->NewRelfrozenXid;
+		if (MultiXactIdPrecedes(shared->NewRelminMxid, vacrel->NewRelminMxid))
+			vacrel->NewRelminMxid = shared->NewRelminMxid;
+		vacrel->skippedallvis |= shared->skippedallvis;
+
+		next_block = (BlockNumber) Min(pg_atomic_read_u64(&shared->next_block),
+									   (uint64) vacrel->rel_pages);
+		if (next_block >= vacrel->rel_pages)
+			break;
+
+		/*
+		 * The round stopped because dead_items is full.  Perform a round of
+		 * index and heap vacuuming, and vacuum the FSM for the blocks
+		 * processed so far, which all precede next_block.
+		 */
+		vacrel->consider_bypass_optimization = false;
+		lazy_vacuum(vacrel);
+
+		FreeSpaceMapVacuumRange(vacrel->rel, next_fsm_block_to_vacuum,
+								next_block);
+		next_fsm_block_to_vacuum = next_block;
+
+		/* Report that we are once again scanning the heap */
+		pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+									 PROGRESS_VACUUM_PHASE_SCAN_HEAP);
+	}
+
+	vacrel->blkno = InvalidBlockNumber;
+
+	return next_fsm_block_to_vacuum;
+}
+
+/*
+ *	lazy_scan_heap_participate() -- process ranges of a parallel heap scan
+ *
+ *		Used by the leader and the workers alike.  Claims ranges of blocks from
+ *		the shared scan state until there are none left, or until the round
+ *		must stop because dead_items is full.  A range is processed in full
+ *		once claimed, so dead_items may overrun its limit by a few ranges'
+ *		worth of TIDs.
+ */
+static void
+lazy_scan_heap_participate(LVRelState *vacrel, LVParallelScanShared *shared)
+{
+	BlockNumber rel_pages = shared->rel_pages;
+	Buffer		vmbuffer = InvalidBuffer;
+
+	for (;;)
+	{
+		uint64		chunk_start;
+		BlockNumber chunk_end;
+		bool		skip_chunk;
+		bool		skipsallvis = false;
+
+		if (pg_atomic_read_u32(&shared->stop) != 0)
+			break;
+
+		/*
+		 * Stop the round once dead_items is full, but only when something
+		 * was stored, to ensure progress even with very little memory.
+		 */
+		if (vacrel->dead_items_info->num_items > 0 &&
+			TidStoreMemoryUsage(vacrel->dead_items) > vacrel->dead_items_info->max_bytes)
+		{
+			pg_atomic_write_u32(&shared->stop, 1);
+			break;
+		}
+
+		chunk_start = pg_atomic_fetch_add_u64(&shared->next_block,
+											  PARALLEL_VACUUM_CHUNK_SIZE);
+		if (chunk_start >= rel_pages)
+			break;
+		chunk_end = (BlockNumber) Min(chunk_start + PARALLEL_VACUUM_CHUNK_SIZE,
+									  (uint64) rel_pages);
+
+		/*
+		 * Skip the whole range if the visibility map allows skipping all of
+		 * its blocks.  As in a serial scan, never skip the last block of the
+		 * relation, so that truncation can tell whether it is empty.
+		 */
+		skip_chunk = shared->skipwithvm && chunk_end < rel_pages;
+		for (BlockNumber blkno = (BlockNumber) chunk_start;
+			 skip_chunk && blkno < chunk_end; blkno++)
+		{
+			uint8		mapbits = visibilitymap_get_status(vacrel->rel, blkno,
+														   &vmbuffer);
+
+			if ((mapbits & VISIBILITYMAP_ALL_FROZEN) != 0)
+				continue;
+			if ((mapbits & VISIBILITYMAP_ALL_VISIBLE) == 0 ||
+				shared->aggressive)
+				skip_chunk = false;
+			else
+				skipsallvis = true;
+		}
+
+		if (skip_chunk)
+		{
+			/* relfrozenxid can't be advanced past unfrozen skipped pages */
+			if (skipsallvis)
+				vacrel->skippedallvis = true;
+			continue;
+		}
+
+		for (BlockNumber blkno = (BlockNumber) chunk_start; blkno < chunk_end;
+			 blkno++)
+		{
+			Buffer		buf;
+			uint8		blk_info = 0;
+			bool		got_cleanup_lock;
+			bool		vm_page_frozen;
+
+			vacuum_delay_point(false);
+
+			/* Only the leader watches out for wraparound, see lazy_scan_heap */
+			if (!IsParallelWorker() && vacrel->scanned_pages > 0 &&
+				vacrel->scanned_pages % FAILSAFE_EVERY_PAGES == 0)
+				lazy_check_wraparound_failsafe(vacrel);
+
+			if ((visibilitymap_get_status(vacrel->rel, blkno, &vmbuffer) &
+				 VISIBILITYMAP_ALL_VISIBLE) != 0)
+				blk_info |= VAC_BLK_ALL_VISIBLE_ACCORDING_TO_VM;
+
+			buf = ReadBufferExtended(vacrel->rel, MAIN_FORKNUM, blkno,
+									 RBM_NORMAL, vacrel->bstrategy);
+
+			vacrel->scanned_pages++;
+
+			/* Report as block scanned, update error traceback information */
+			if (!IsParallelWorker())
+				pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED,
+											 Min(pg_atomic_read_u64(&shared->next_block),
+												 (uint64) rel_pages));
+			update_vacuum_error_info(vacrel, NULL, VACUUM_ERRCB_PHASE_SCAN_HEAP,
+									 blkno, InvalidOffsetNumber);
+
+			(void) lazy_scan_heap_page(vacrel, buf, blk_info, &vmbuffer,
+									   &got_cleanup_lock, &vm_page_frozen);
+		}
+	}
+
+	if (BufferIsValid(vmbuffer))
+		ReleaseBuffer(vmbuffer);
+}
+
+/*
+ *	heap_vacuum_parallel_scan_worker() -- take part in a parallel heap scan
+ *
+ *		Entry point for parallel vacuum workers, called with the shared
+ *		dead_items store and the scan state set up by lazy_scan_heap_parallel
+ *		in the leader.  The worker's results are added to the shared state for
+ *		the leader to collect.
+ */
+void
+heap_vacuum_parallel_scan_worker(Relation rel, int nindexes,
+								 TidStore *dead_items,
+								 VacDeadItemsInfo *dead_items_info,
+								 void *scan_state,
+								 BufferAccessStrategy bstrategy)
+{
+	LVParallelScanShared *shared = (LVParallelScanShared *) scan_state;
+	LVRelState *vacrel;
+	ErrorContextCallback errcallback;
+
+	Assert(IsParallelWorker());
+
+	vacrel = palloc0_object(LVRelState);
+	vacrel->dbname = get_database_name(MyDatabaseId);
+	vacrel->relnamespace = get_namespace_name(RelationGetNamespace(rel));
+	vacrel->relname = pstrdup(RelationGetRelationName(rel));
+	vacrel->phase = VACUUM_ERRCB_PHASE_UNKNOWN;
+	vacrel->rel = rel;
+	vacrel->nindexes = nindexes;
+	vacrel->bstrategy = bstrategy;
+	vacrel->aggressive = shared->aggressive;
+	vacrel->skipwithvm = shared->skipwithvm;
+	vacrel->do_index_vacuuming = shared->do_index_vacuuming;
+	vacrel->cutoffs = shared->cutoffs;
+	vacrel->vistest = GlobalVisTestFor(rel);
+	vacrel->NewRelfrozenXid = shared->cutoffs.OldestXmin;
+	vacrel->NewRelminMxid = shared->cutoffs.OldestMxact;
+	vacrel->dead_items = dead_items;
+	vacrel->dead_items_info = dead_items_info;
+	vacrel->rel_pages = shared->rel_pages;
+
+	/* Setup error traceback support for ereport() */
+	errcallback.callback = vacuum_error_callback;
+	errcallback.arg = vacrel;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	lazy_scan_heap_participate(vacrel, shared);
+
+	error_context_stack = errcallback.previous;
+
+	SpinLockAcquire(&shared->mutex);
+	shared->scanned_pages += vacrel->scanned_pages;
+	shared->new_frozen_tuple_pages += vacrel->new_frozen_tuple_pages;
+	shared->vm_new_visible_pages += vacrel->vm_new_visible_pages;
+	shared->vm_new_visible_frozen_pages += vacrel->vm_new_visible_frozen_pages;
+	shared->vm_new_frozen_pages += vacrel->vm_new_frozen_pages;
+	shared->lpdead_item_pages += vacrel->lpdead_item_pages;
+	shared->missed_dead_pages += vacrel->missed_dead_pages;
+	shared->nonempty_pages = Max(shared->nonempty_pages,
+								 vacrel->nonempty_pages);
+	shared->tuples_deleted += vacrel->tuples_deleted;
+	shared->tuples_frozen += vacrel->tuples_frozen;
+	shared->lpdead_items += vacrel->lpdead_items;
+	shared->live_tuples += vacrel->live_tuples;
+	shared->recently_dead_tuples += vacrel->recently_dead_tuples;
+	shared->missed_dead_tuples += vacrel->missed_dead_tuples;
+	if (TransactionIdPrecedes(vacrel->NewRelfrozenXid,
+							  shared->NewRelfrozenXid))
+		shared->NewRelfrozenXid = vacrel->NewRelfrozenXid;
+	if (MultiXactIdPrecedes(vacrel->NewRelminMxid, shared->NewRelminMxid))
+		shared->NewRelminMxid = vacrel->NewRelminMxid;
+	shared->skippedallvis |= vacrel->skippedallvis;
+	SpinLockRelease(&shared->mutex);
 }
 
 /*
@@ -3536,11 +3955,12 @@ dead_items_alloc(LVRelState *vacrel, int nworkers)
 		autovacuum_work_mem : maintenance_work_mem;
 
 	/*
-	 * Initialize state for a parallel vacuum.  As of now, only one worker can
-	 * be used for an index, so we invoke parallelism only if there are at
-	 * least two indexes on a table.
+	 * Initialize state for a parallel vacuum.  Workers can help with the
+	 * first pass over the heap and, when there are at least two indexes,
+	 * with index vacuuming (only one worker can be used for an index);
+	 * parallel_vacuum_init decides whether either is worthwhile.
 	 */
-	if (nworkers >= 0 && vacrel->nindexes > 1 && vacrel->do_index_vacuuming)
+	if (nworkers >= 0)
 	{
 		/*
 		 * Since parallel workers cannot access data in temporary tables, we
@@ -3562,7 +3982,8 @@ dead_items_alloc(LVRelState *vacrel, int nworkers)
 											   vacrel->nindexes, nworkers,
 											   vac_work_mem,
 											   vacrel->verbose ? INFO : DEBUG2,
-											   vacrel->bstrategy);
+											   vacrel->bstrategy,
+											   sizeof(LVParallelScanShared));
 
 		/*
 		 * If parallel mode started, dead_items and dead_items_info spaces are
@@ -3602,11 +4023,14 @@ dead_items_add(LVRelState *vacrel, BlockNumber blkno, OffsetNumber *offsets,
 	};
 	int64		prog_val[2];
 
+	/* Parallel heap scan participants add to the store concurrently */
+	TidStoreLockExclusive(vacrel->dead_items);
 	TidStoreSetBlockOffsets(vacrel->dead_items, blkno, offsets, num_offsets);
 	vacrel->dead_items_info->num_items += num_offsets;
+	prog_val[0] = vacrel->dead_items_info->num_items;
+	TidStoreUnlock(vacrel->dead_items);
 
 	/* update the progress information */
-	prog_val[0] = vacrel->dead_items_info->num_items;
 	prog_val[1] = TidStoreMemoryUsage(vacrel->dead_items);
 	pgstat_progress_update_multi_param(2, prog_index, prog_val);
 }
@@ -18,12 +18,16 @@
  *		index_rescan	- restart a scan of an index
  *		index_endscan	- end a scan
  *		index_insert	- insert an index tuple into a relation
+ *		index_insert_batch	- insert a batch of index tuples into a relation
  *		index_markpos	- mark a scan position
  *		index_restrpos	- restore a scan position
  *		index_parallelscan_estimate - estimate shared memory for parallel scan
  *		index_parallelscan_initialize - initialize parallel scan
  *		index_parallelrescan  - (re)start a parallel scan of an index
  *		index_beginscan_parallel - join parallel index scan
+ *		index_beginscan_parallel_bitmap - join parallel index scan with
+ *						amgetbitmap
+ *		index_prefetch_begin - start reading ahead TIDs and table blocks
  *		index_getnext_tid	- get the next TID from a scan
  *		index_fetch_heap		- get the scan's next heap tuple
  *		index_getnext_slot	- get the next tuple from a scan
@@ -48,17 +52,25 @@
 #include "access/reloptions.h"
 #include "access/relscan.h"
 #include "access/tableam.h"
+#include "access/visibilitymap.h"
+#include "catalog/globaltemp.h"
 #include "catalog/index.h"
 #include "catalog/pg_type.h"
 #include "nodes/execnodes.h"
 #include "pgstat.h"
+#include "port/pg_bitutils.h"
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
+#include "storage/read_stream.h"
+#include "utils/memutils.h"
 #include "utils/ruleutils.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
 
+/* GUC parameter */
+int			index_prefetch_distance = 0;
+
 /* ----------------------------------------------------------------
  *					macros used in index_ routines
  *
@@ -108,6 +120,12 @@ static IndexScanDesc index_beginscan_internal(Relation indexRelation,
 											  int nkeys, int norderbys, Snapshot snapshot,
 											  ParallelIndexScanDesc pscan, bool temp_snap);
 static inline void validate_relation_kind(Relation r);
+static void index_prefetch_reset(IndexScanDesc scan);
+static bool index_prefetch_fill(IndexScanDesc scan);
+static bool index_prefetch_getnext(IndexScanDesc scan, ScanDirection direction);
+static BlockNumber index_prefetch_next_block(ReadStream *stream,
+											 void *callback_private_data,
+											 void *per_buffer_data);
 
 
 /* ----------------------------------------------------------------
@@ -233,6 +251,36 @@ index_insert(Relation indexRelation,
 											 indexInfo);
 }
 
+/* ----------------
+ *		index_insert_batch - insert a batch of index tuples into a relation
+ *
+ * values and isnull hold ntuples consecutive groups of index columns, one
+ * group per heap_tids entry.  Only for AMs providing aminsertbatch, and only
+ * when no uniqueness checking is wanted.
+ * ----------------
+ */
+void
+index_insert_batch(Relation indexRelation,
+				   int ntuples,
+				   Datum *values,
+				   bool *isnull,
+				   ItemPointer heap_tids,
+				   Relation heapRelation,
+				   IndexInfo *indexInfo)
+{
+	RELATION_CHECKS;
+	CHECK_REL_PROCEDURE(aminsertbatch);
+
+	if (!(indexRelation->rd_indam->ampredlocks))
+		CheckForSerializableConflictIn(indexRelation,
+									   (ItemPointer) NULL,
+									   InvalidBlockNumber);
+
+	indexRelation->rd_indam->aminsertbatch(indexRelation, ntuples,
+										   values, isnull, heap_tids,
+										   heapRelation, indexInfo);
+}
+
 /* -------------------------
  *		index_insert_cleanup - clean up after all index inserts are done
  * -------------------------
@@ -338,6 +386,10 @@ index_beginscan_internal(Relation indexRelation,
 	 */
 	RelationIncrementReferenceCount(indexRelation);
 
+	/* A global temporary index gets this session's storage on first use */
+	if (RelationIsGlobalTemp(indexRelation))
+		GlobalTempRelationInitStorage(indexRelation);
+
 	/*
 	 * Tell the AM to open a scan.
 	 */
@@ -376,6 +428,8 @@ index_rescan(IndexScanDesc scan,
 	/* Release resources (like buffer pins) from table accesses */
 	if (scan->xs_heapfetch)
 		table_index_fetch_reset(scan->xs_heapfetch);
+	if (scan->xs_prefetch)
+		index_prefetch_reset(scan);
 
 	scan->kill_prior_tuple = false; /* for safety */
 	scan->xs_heap_continue = false;
@@ -395,6 +449,20 @@ index_endscan(IndexScanDesc scan)
 	CHECK_SCAN_PROCEDURE(amendscan);
 
 	/* Release resources (like buffer pins) from table accesses */
+	if (scan->xs_prefetch)
+	{
+		IndexPrefetchData *prefetch = scan->xs_prefetch;
+
+		read_stream_end(scan->xs_heapfetch->rs);
+		scan->xs_heapfetch->rs = NULL;
+		if (BufferIsValid(prefetch->vmbuffer))
+			ReleaseBuffer(prefetch->vmbuffer);
+		if (prefetch->tuple_cxt)
+			MemoryContextDelete(prefetch->tuple_cxt);
+		pfree(prefetch->entries);
+		pfree(prefetch);
+		scan->xs_prefetch = NULL;
+	}
 	if (scan->xs_heapfetch)
 	{
 		table_index_fetch_end(scan->xs_heapfetch);
@@ -446,6 +514,7 @@ void
 index_restrpos(IndexScanDesc scan)
 {
 	Assert(IsMVCCSnapshot(scan->xs_snapshot));
+	Assert(scan->xs_prefetch == NULL);
 
 	SCAN_CHECKS;
 	CHECK_SCAN_PROCEDURE(amrestrpos);
@@ -578,6 +647,8 @@ index_parallelrescan(IndexScanDesc scan)
 
 	if (scan->xs_heapfetch)
 		table_index_fetch_reset(scan->xs_heapfetch);
+	if (scan->xs_prefetch)
+		index_prefetch_reset(scan);
 
 	/* amparallelrescan is optional; assume no-op if not provided by AM */
 	if (scan->indexRelation->rd_indam->amparallelrescan != NULL)
@@ -620,6 +691,314 @@ index_beginscan_parallel(Relation heaprel, Relation indexrel,
 	return scan;
 }
 
+/*
+ * index_beginscan_parallel_bitmap - join parallel index scan with amgetbitmap
+ *
+ * Each participant's index_getbitmap call returns only the TIDs from the part
+ * of the index it got to scan.  As with index_beginscan_bitmap, the caller
+ * had better be holding some lock on the parent heap relation.
+ */
+IndexScanDesc
+index_beginscan_parallel_bitmap(Relation indexrel,
+								IndexScanInstrumentation *instrument,
+								int nkeys, ParallelIndexScanDesc pscan)
+{
+	Snapshot	snapshot;
+	IndexScanDesc scan;
+
+	Assert(RelFileLocatorEquals(indexrel->rd_locator, pscan->ps_indexlocator));
+
+	snapshot = RestoreSnapshot(pscan->ps_snapshot_data);
+	RegisterSnapshot(snapshot);
+	scan = index_beginscan_internal(indexrel, nkeys, 0, snapshot, pscan, true);
+
+	scan->xs_snapshot = snapshot;
+	scan->instrument = instrument;
+
+	return scan;
+}
+
+/* ----------------
+ * index_prefetch_begin - start reading ahead TIDs and table blocks
+ *
+ * Arrange for an amgettuple-based scan to read up to "distance" TIDs ahead
+ * of the ones it returns, and to feed the table blocks they point to into a
+ * read stream, so that table I/O can be started before the tuples are
+ * needed.  This is a no-op if distance is not positive or the table AM
+ * can't consume a read stream.
+ *
+ * Must be called before the scan returns its first TID.  The caller must not
+ * need any output of the index AM other than the TID, the recheck flag and,
+ * for an index-only scan, the index tuple (so no ordering operators), must
+ * not change the scan direction, and must not use mark/restore.  Since the
+ * index AM has already moved past an entry by the time its heap tuples are
+ * found to be dead, kill_prior_tuple is never set while prefetching.
+ *
+ * For an index-only scan, the visibility map is checked for each TID as it's
+ * read from the index, and only the table blocks that aren't all-visible are
+ * read; the caller must then use the result in xs_prefetch->all_visible
+ * instead of checking the visibility map itself, and must only fetch table
+ * tuples for the TIDs for which it's false.  Checking as the TID is read
+ * gives the same guarantees as checking just after index_getnext_tid() would
+ * without prefetching, see IndexOnlyNext().
+ * ----------------
+ */
+void
+index_prefetch_begin(IndexScanDesc scan, int distance, bool index_only)
+{
+	IndexPrefetchData *prefetch;
+
+	SCAN_CHECKS;
+	Assert(scan->xs_heapfetch != NULL);
+	Assert(scan->xs_prefetch == NULL);
+
+	if (distance <= 0 || !scan->xs_heapfetch->stream_capable)
+		return;
+
+	Assert(scan->xs_want_itup == index_only);
+	Assert(scan->numberOfOrderBys == 0);
+
+	prefetch = palloc0_object(IndexPrefetchData);
+	prefetch->distance = distance;
+	prefetch->size = pg_nextpower2_32(Max(distance, 16));
+	prefetch->entries = palloc_array(IndexPrefetchEntry, prefetch->size);
+	prefetch->index_only = index_only;
+	prefetch->vmbuffer = InvalidBuffer;
+	if (index_only)
+		prefetch->tuple_cxt = AllocSetContextCreate(CurrentMemoryContext,
+													"index prefetch tuples",
+													ALLOCSET_SMALL_SIZES);
+	scan->xs_prefetch = prefetch;
+
+	/*
+	 * The callback calls into the index AM, which may perform I/O of its own,
+	 * so we mustn't use READ_STREAM_USE_BATCHING.
+	 */
+	scan->xs_heapfetch->rs =
+		read_stream_begin_relation(READ_STREAM_DEFAULT,
+								   NULL,
+								   scan->heapRelation,
+								   MAIN_FORKNUM,
+								   index_prefetch_next_block,
+								   scan,
+								   0);
+
+	index_prefetch_reset(scan);
+}
+
+/*
+ * Forget all TIDs read ahead so far, and any table blocks the read stream
+ * has queued up for them.
+ */
+static void
+index_prefetch_reset(IndexScanDesc scan)
+{
+	IndexPrefetchData *prefetch = scan->xs_prefetch;
+
+	read_stream_reset(scan->xs_heapfetch->rs);
+
+	prefetch->direction = NoMovementScanDirection;
+	prefetch->exhausted = false;
+	prefetch->paused = false;
+	prefetch->last_block = InvalidBlockNumber;
+	prefetch->next_return = 0;
+	prefetch->next_stream = 0;
+	prefetch->next_free = 0;
+
+	if (prefetch->tuple_cxt)
+		MemoryContextReset(prefetch->tuple_cxt);
+	prefetch->cur_itup = NULL;
+	prefetch->cur_hitup = NULL;
+}
+
+/*
+ * Fetch one more TID from the index AM and append it to the prefetch queue.
+ * Returns false if the index AM has no more entries.
+ *
+ * This is also called by the read stream callback, in the middle of fetching
+ * a table tuple for the TID last returned to the caller, so the fields of
+ * the scan descriptor set by the index AM are restored afterwards.
+ */
+static bool
+index_prefetch_fill(IndexScanDesc scan)
+{
+	IndexPrefetchData *prefetch = scan->xs_prefetch;
+	IndexPrefetchEntry *entry;
+	uint64		oldest;
+	ItemPointerData save_heaptid;
+	bool		save_recheck;
+	IndexTuple	save_itup;
+	HeapTuple	save_hitup;
+
+	if (prefetch->exhausted)
+		return false;
+
+	save_heaptid = scan->xs_heaptid;
+	save_recheck = scan->xs_recheck;
+	save_itup = scan->xs_itup;
+	save_hitup = scan->xs_hitup;
+
+	if (!scan->indexRelation->rd_indam->amgettuple(scan, prefetch->direction))
+	{
+		prefetch->exhausted = true;
+		scan->xs_heaptid = save_heaptid;
+		scan->xs_recheck = save_recheck;
+		scan->xs_itup = save_itup;
+		scan->xs_hitup = save_hitup;
+		return false;
+	}
+	Assert(ItemPointerIsValid(&scan->xs_heaptid));
+
+	/*
+	 * Entries must be kept until both the caller and the read stream callback
+	 * have seen them.  Normally the queue can't hold more than "distance"
+	 * entries, but the read stream may lag behind the caller, so grow the
+	 * queue if necessary.
+	 */
+	oldest = Min(prefetch->next_return, prefetch->next_stream);
+	if (prefetch->next_free - oldest == prefetch->size)
+	{
+		uint32		newsize = prefetch->size * 2;
+		IndexPrefetchEntry *newentries;
+
+		newentries = MemoryContextAlloc(GetMemoryChunkContext(prefetch->entries),
+										sizeof(IndexPrefetchEntry) * newsize);
+		for (uint64 pos = oldest; pos < prefetch->next_free; pos++)
+			newentries[pos & (newsize - 1)] =
+				prefetch->entries[pos & (prefetch->size - 1)];
+		pfree(prefetch->entries);
+		prefetch->entries = newentries;
+		prefetch->size = newsize;
+	}
+
+	entry = &prefetch->entries[prefetch->next_free++ & (prefetch->size - 1)];
+	entry->tid = scan->xs_heaptid;
+	entry->recheck = scan->xs_recheck;
+
+	if (prefetch->index_only)
+	{
+		MemoryContext oldcxt = MemoryContextSwitchTo(prefetch->tuple_cxt);
+
+		/* The index AM's copies only last until it moves on */
+		entry->itup = scan->xs_itup ? CopyIndexTuple(scan->xs_itup) : NULL;
+		entry->hitup = scan->xs_hitup ? heap_copytuple(scan->xs_hitup) : NULL;
+		MemoryContextSwitchTo(oldcxt);
+
+		/*
+		 * The visibility map buffer stays pinned, so consecutive checks
+		 * against the same map page don't have to look it up again.
+		 */
+		entry->all_visible = VM_ALL_VISIBLE(scan->heapRelation,
+											ItemPointerGetBlockNumber(&entry->tid),
+											&prefetch->vmbuffer);
+	}
+	else
+	{
+		entry->all_visible = false;
+		entry->itup = NULL;
+		entry->hitup = NULL;
+	}
+
+	scan->xs_heaptid = save_heaptid;
+	scan->xs_recheck = save_recheck;
+	scan->xs_itup = save_itup;
+	scan->xs_hitup = save_hitup;
+
+	return true;
+}
+
+/*
+ * Return the next TID from the prefetch queue in scan->xs_heaptid, reading
+ * more from the index AM if the read stream hasn't done so already.
+ */
+static bool
+index_prefetch_getnext(IndexScanDesc scan, ScanDirection direction)
+{
+	IndexPrefetchData *prefetch = scan->xs_prefetch;
+	IndexPrefetchEntry *entry;
+
+	/* The direction is fixed by the first call after (re)starting */
+	if (prefetch->direction == NoMovementScanDirection)
+		prefetch->direction = direction;
+	Assert(direction == prefetch->direction);
+
+	if (prefetch->next_return == prefetch->next_free &&
+		!index_prefetch_fill(scan))
+		return false;
+
+	entry = &prefetch->entries[prefetch->next_return++ & (prefetch->size - 1)];
+	scan->xs_heaptid = entry->tid;
+	scan->xs_recheck = entry->recheck;
+
+	if (prefetch->index_only)
+	{
+		/* The caller is done with the previous entry's tuple */
+		if (prefetch->cur_itup)
+			pfree(prefetch->cur_itup);
+		if (prefetch->cur_hitup)
+			heap_freetuple(prefetch->cur_hitup);
+		prefetch->cur_itup = scan->xs_itup = entry->itup;
+		prefetch->cur_hitup = scan->xs_hitup = entry->hitup;
+		prefetch->all_visible = entry->all_visible;
+	}
+
+	/* There's room in the queue again, so let the stream look further ahead */
+	if (prefetch->paused)
+	{
+		prefetch->paused = false;
+		read_stream_resume(scan->xs_heapfetch->rs);
+	}
+
+	return true;
+}
+
+/*
+ * Read stream callback for index prefetching.  Returns the table block for
+ * the next TID in the queue, reading more TIDs from the index AM as needed.
+ * Consecutive TIDs on the same block produce only one block number, which
+ * matches the table AM's rule of only consuming a buffer from the stream
+ * when the block changes.  TIDs on all-visible blocks are skipped, since an
+ * index-only scan doesn't fetch their table tuples.
+ */
+static BlockNumber
+index_prefetch_next_block(ReadStream *stream,
+						  void *callback_private_data,
+						  void *per_buffer_data)
+{
+	IndexScanDesc scan = (IndexScanDesc) callback_private_data;
+	IndexPrefetchData *prefetch = scan->xs_prefetch;
+
+	for (;;)
+	{
+		IndexPrefetchEntry *entry;
+		BlockNumber blkno;
+
+		if (prefetch->next_stream == prefetch->next_free)
+		{
+			/* Don't read further ahead of the caller than allowed */
+			if (prefetch->next_free - prefetch->next_return >=
+				prefetch->distance)
+			{
+				prefetch->paused = true;
+				return read_stream_pause(stream);
+			}
+
+			if (!index_prefetch_fill(scan))
+				return InvalidBlockNumber;
+		}
+
+		entry = &prefetch->entries[prefetch->next_stream++ & (prefetch->size - 1)];
+		if (entry->all_visible)
+			continue;
+		blkno = ItemPointerGetBlockNumber(&entry->tid);
+		if (blkno != prefetch->last_block)
+		{
+			prefetch->last_block = blkno;
+			return blkno;
+		}
+	}
+}
+
 /* ----------------
  * index_getnext_tid - get the next TID from a scan
  *
@@ -642,9 +1021,13 @@ index_getnext_tid(IndexScanDesc scan, ScanDirection direction)
 	 * The AM's amgettuple proc finds the next index entry matching the scan
 	 * keys, and puts the TID into scan->xs_heaptid.  It should also set
 	 * scan->xs_recheck and possibly scan->xs_itup/scan->xs_hitup, though we
-	 * pay no attention to those fields here.
+	 * pay no attention to those fields here.  If we're prefetching, the TID
+	 * may have been read from the index AM some time ago.
 	 */
-	found = scan->indexRelation->rd_indam->amgettuple(scan, direction);
+	if (scan->xs_prefetch)
+		found = index_prefetch_getnext(scan, direction);
+	else
+		found = scan->indexRelation->rd_indam->amgettuple(scan, direction);
 
 	/* Reset kill flag immediately for safety */
 	scan->kill_prior_tuple = false;
@@ -703,9 +1086,10 @@ index_fetch_heap(IndexScanDesc scan, TupleTableSlot *slot)
 	 * AM to kill its entry for that TID (this will take effect in the next
 	 * amgettuple call, in index_getnext_tid).  We do not do this when in
 	 * recovery because it may violate MVCC to do so.  See comments in
-	 * RelationGetIndexScan().
+	 * RelationGetIndexScan().  Nor when prefetching, because the index AM's
+	 * prior tuple is then no longer the one we just fetched.
 	 */
-	if (!scan->xactStartedInRecovery)
+	if (!scan->xactStartedInRecovery && scan->xs_prefetch == NULL)
 		scan->kill_prior_tuple = all_dead;
 
 	return found;
@@ -33,7 +33,8 @@
 
 
 static BTStack _bt_search_insert(Relation rel, Relation heaprel,
-								 BTInsertState insertstate);
+								 BTInsertState insertstate,
+								 BlockNumber leafhint);
 static TransactionId _bt_check_unique(Relation rel, BTInsertState insertstate,
 									  Relation heapRel,
 									  IndexUniqueCheck checkUnique, bool *is_unique,
@@ -94,6 +95,12 @@ static inline int _bt_blk_cmp(const void *arg1, const void *arg2);
  *		must nevertheless have a new entry to point to a successor
  *		version.
  *
+ *		If leafhint isn't NULL, *leafhint may give the leaf page that the
+ *		previous tuple of a sorted batch went to (or InvalidBlockNumber).
+ *		We try that page before descending the tree (unless checking
+ *		uniqueness), and on return set *leafhint to the leaf page this
+ *		tuple was inserted on.
+ *
  *		The result value is only significant for UNIQUE_CHECK_PARTIAL:
  *		it must be true if the entry is known unique, else false.
  *		(In the current implementation we'll also return true after a
@@ -103,7 +110,7 @@ static inline int _bt_blk_cmp(const void *arg1, const void *arg2);
 bool
 _bt_doinsert(Relation rel, IndexTuple itup,
 			 IndexUniqueCheck checkUnique, bool indexUnchanged,
-			 Relation heapRel)
+			 Relation heapRel, BlockNumber *leafhint)
 {
 	bool		is_unique = false;
 	BTInsertStateData insertstate;
@@ -166,7 +173,9 @@ search:
 	 * searching from the root page.  insertstate.buf will hold a buffer that
 	 * is locked in exclusive mode afterwards.
 	 */
-	stack = _bt_search_insert(rel, heapRel, &insertstate);
+	stack = _bt_search_insert(rel, heapRel, &insertstate,
+							  leafhint && !checkingunique ?
+							  *leafhint : InvalidBlockNumber);
 
 	/*
 	 * checkingunique inserts are not allowed to go ahead when two tuples with
@@ -259,6 +268,8 @@ search:
 		 */
 		newitemoff = _bt_findinsertloc(rel, &insertstate, checkingunique,
 									   indexUnchanged, stack, heapRel);
+		if (leafhint)
+			*leafhint = BufferGetBlockNumber(insertstate.buf);
 		_bt_insertonpg(rel, heapRel, itup_key, insertstate.buf, InvalidBuffer,
 					   stack, itup, insertstate.itemsz, newitemoff,
 					   insertstate.postingoff, false);
@@ -314,14 +325,66 @@ search:
  * rightmost page (we give up if we'd have to wait for the lock).  We assume
  * that it isn't useful to apply the optimization when there is contention,
  * since each per-backend cache won't stay valid for long.
+ *
+ * Callers inserting a sorted batch of tuples can pass the leaf page the
+ * previous tuple went to as leafhint.  Successive tuples usually belong on
+ * the same leaf page, which we verify by checking that the page's key space
+ * covers the new tuple.  The rules for using the page are the same as for
+ * the rightmost page cache.
  */
 static BTStack
-_bt_search_insert(Relation rel, Relation heaprel, BTInsertState insertstate)
+_bt_search_insert(Relation rel, Relation heaprel, BTInsertState insertstate,
+				  BlockNumber leafhint)
 {
 	Assert(insertstate->buf == InvalidBuffer);
 	Assert(!insertstate->bounds_valid);
 	Assert(insertstate->postingoff == 0);
 
+	/*
+	 * Only heapkeyspace indexes are considered, since otherwise
+	 * _bt_findinsertloc() might move right into a page that needs a split.
+	 */
+	if (BlockNumberIsValid(leafhint) &&
+		leafhint != RelationGetTargetBlock(rel) &&
+		insertstate->itup_key->heapkeyspace)
+	{
+		insertstate->buf = ReadBuffer(rel, leafhint);
+		if (_bt_conditionallockbuf(rel, insertstate->buf))
+		{
+			Page		page;
+			BTPageOpaque opaque;
+
+			_bt_checkpage(rel, insertstate->buf);
+			page = BufferGetPage(insertstate->buf);
+			opaque = BTPageGetOpaque(page);
+
+			/*
+			 * The page's low bound never changes while it's live, so the
+			 * scan key belongs here if it is strictly greater than the first
+			 * non-pivot tuple, and not greater than the high key.  That's
+			 * the page _bt_search() would return, too.
+			 */
+			if (P_ISLEAF(opaque) &&
+				!P_IGNORE(opaque) &&
+				PageGetFreeSpace(page) > insertstate->itemsz &&
+				PageGetMaxOffsetNumber(page) >= P_FIRSTDATAKEY(opaque) &&
+				_bt_compare(rel, insertstate->itup_key, page,
+							P_FIRSTDATAKEY(opaque)) > 0 &&
+				(P_RIGHTMOST(opaque) ||
+				 _bt_compare(rel, insertstate->itup_key, page, P_HIKEY) <= 0))
+				return NULL;
+
+			/* Page unsuitable for caller, drop lock and pin */
+			_bt_relbuf(rel, insertstate->buf);
+		}
+		else
+		{
+			/* Lock unavailable, drop pin */
+			ReleaseBuffer(insertstate->buf);
+		}
+		insertstate->buf = InvalidBuffer;
+	}
+
 	if (RelationGetTargetBlock(rel) != InvalidBlockNumber)
 	{
 		/* Simulate a _bt_getbuf() call with conditional locking */
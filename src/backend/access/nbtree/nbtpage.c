@@ -563,6 +563,52 @@ _bt_getroot(Relation rel, Relation heaprel, int access)
 	return rootbuf;
 }
 
+/*
+ *	_bt_getrootcopy() -- Get the root page without locking it.
+ *
+ *		This is an alternative to _bt_getroot() for _bt_search, when the
+ *		root is an internal page.  On success, the root page is pinned but
+ *		not locked, and a copy of it taken by _bt_copybuf() is returned in
+ *		*dest.  Only the cached metapage data is consulted, so this returns
+ *		InvalidBuffer whenever there is no usable cache, the root is a leaf
+ *		page, or the page couldn't be copied; callers should then fall back
+ *		on _bt_getroot(), which sorts all of that out.
+ */
+Buffer
+_bt_getrootcopy(Relation rel, Page dest)
+{
+	BTMetaPageData *metad;
+	Buffer		rootbuf;
+	BTPageOpaque rootopaque;
+
+	if (rel->rd_amcache == NULL)
+		return InvalidBuffer;
+
+	metad = (BTMetaPageData *) rel->rd_amcache;
+	if (metad->btm_fastlevel == 0)
+		return InvalidBuffer;
+
+	rootbuf = ReadBuffer(rel, metad->btm_fastroot);
+	if (!_bt_copybuf(rel, rootbuf, dest))
+	{
+		ReleaseBuffer(rootbuf);
+		return InvalidBuffer;
+	}
+
+	/* Same checks as in _bt_getroot() */
+	rootopaque = BTPageGetOpaque(dest);
+	if (P_IGNORE(rootopaque) ||
+		rootopaque->btpo_level != metad->btm_fastlevel ||
+		!P_LEFTMOST(rootopaque) ||
+		!P_RIGHTMOST(rootopaque))
+	{
+		ReleaseBuffer(rootbuf);
+		return InvalidBuffer;
+	}
+
+	return rootbuf;
+}
+
 /*
  *	_bt_gettrueroot() -- Get the true root page of the btree.
  *
@@ -1103,6 +1149,40 @@ _bt_conditionallockbuf(Relation rel, Buffer buf)
 	return true;
 }
 
+/*
+ *	_bt_copybuf() -- copy a pinned buffer without locking it.
+ *
+ * Returns false if that's not possible, because the page was concurrently
+ * modified or the relation uses local buffers, or if the copy doesn't look
+ * like a btree page.  Callers should lock the buffer instead, then.
+ *
+ * This is only safe for internal pages, whose contents are never changed
+ * without an exclusive lock (see CopyBufferOptimistic).  The copy can of
+ * course be stale by the time it is looked at, but no more so than a page
+ * that was locked and then unlocked.
+ */
+bool
+_bt_copybuf(Relation rel, Buffer buf, Page dest)
+{
+	bool		copied;
+
+	/* The page is only addressable while locked, as far as Valgrind knows */
+	if (!RelationUsesLocalBuffers(rel))
+		VALGRIND_MAKE_MEM_DEFINED(BufferGetPage(buf), BLCKSZ);
+
+	copied = CopyBufferOptimistic(buf, dest);
+
+	if (!RelationUsesLocalBuffers(rel))
+		VALGRIND_MAKE_MEM_NOACCESS(BufferGetPage(buf), BLCKSZ);
+
+	if (!copied)
+		INJECTION_POINT("nbtree-optimistic-copy-failed", NULL);
+
+	/* Same checks as _bt_checkpage(), but leave complaining to the caller */
+	return copied && !PageIsNew(dest) &&
+		PageGetSpecialSize(dest) == MAXALIGN(sizeof(BTPageOpaqueData));
+}
+
 /*
  *	_bt_upgradelockbufcleanup() -- upgrade lock to a full cleanup lock.
  */
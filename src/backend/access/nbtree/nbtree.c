@@ -35,6 +35,7 @@
 #include "utils/fmgrprotos.h"
 #include "utils/index_selfuncs.h"
 #include "utils/memutils.h"
+#include "utils/sortsupport.h"
 
 
 /*
@@ -147,6 +148,7 @@ bthandler(PG_FUNCTION_ARGS)
 	amroutine->ambuildempty = btbuildempty;
 	amroutine->aminsert = btinsert;
 	amroutine->aminsertcleanup = NULL;
+	amroutine->aminsertbatch = btinsertbatch;
 	amroutine->ambulkdelete = btbulkdelete;
 	amroutine->amvacuumcleanup = btvacuumcleanup;
 	amroutine->amcanreturn = btcanreturn;
@@ -213,13 +215,123 @@ btinsert(Relation rel, Datum *values, bool *isnull,
 	itup = index_form_tuple(RelationGetDescr(rel), values, isnull);
 	itup->t_tid = *ht_ctid;
 
-	result = _bt_doinsert(rel, itup, checkUnique, indexUnchanged, heapRel);
+	result = _bt_doinsert(rel, itup, checkUnique, indexUnchanged, heapRel,
+						  NULL);
 
 	pfree(itup);
 
 	return result;
 }
 
+/*
+ * Sort state for btinsertbatch()
+ */
+typedef struct BTInsertBatchSortState
+{
+	int			natts;			/* stride of the values/isnull arrays */
+	int			nkeyatts;		/* number of key attributes to compare */
+	Datum	   *values;
+	bool	   *isnull;
+	ItemPointer heap_tids;
+	SortSupport sortKeys;
+} BTInsertBatchSortState;
+
+static int
+btinsertbatch_cmp(const void *a, const void *b, void *arg)
+{
+	BTInsertBatchSortState *state = (BTInsertBatchSortState *) arg;
+	int			i1 = *(const int *) a;
+	int			i2 = *(const int *) b;
+
+	for (int k = 0; k < state->nkeyatts; k++)
+	{
+		int			off1 = i1 * state->natts + k;
+		int			off2 = i2 * state->natts + k;
+		int			compare;
+
+		compare = ApplySortComparator(state->values[off1], state->isnull[off1],
+									  state->values[off2], state->isnull[off2],
+									  &state->sortKeys[k]);
+		if (compare != 0)
+			return compare;
+	}
+
+	/* heap TID is the final tiebreaker, as in the index itself */
+	return ItemPointerCompare(&state->heap_tids[i1], &state->heap_tids[i2]);
+}
+
+/*
+ *	btinsertbatch() -- insert a batch of index tuples into a btree.
+ *
+ *		values and isnull hold ntuples consecutive groups of index columns.
+ *		No uniqueness checking is done.  The tuples are inserted in index
+ *		order, so that runs of tuples belonging on the same leaf page can
+ *		skip the descent from the root: each insert first tries the leaf page
+ *		the previous tuple went to.
+ */
+void
+btinsertbatch(Relation rel, int ntuples, Datum *values, bool *isnull,
+			  ItemPointer ht_ctids, Relation heapRel,
+			  IndexInfo *indexInfo)
+{
+	int			natts = IndexRelationGetNumberOfAttributes(rel);
+	int			nkeyatts = IndexRelationGetNumberOfKeyAttributes(rel);
+	BTInsertBatchSortState state;
+	BlockNumber leafhint = InvalidBlockNumber;
+	int		   *order;
+
+	order = palloc_array(int, ntuples);
+	for (int i = 0; i < ntuples; i++)
+		order[i] = i;
+
+	if (ntuples > 1)
+	{
+		state.natts = natts;
+		state.nkeyatts = nkeyatts;
+		state.values = values;
+		state.isnull = isnull;
+		state.heap_tids = ht_ctids;
+		state.sortKeys = palloc0_array(SortSupportData, nkeyatts);
+
+		for (int k = 0; k < nkeyatts; k++)
+		{
+			SortSupport sortKey = &state.sortKeys[k];
+			int16		indoption = rel->rd_indoption[k];
+
+			sortKey->ssup_cxt = CurrentMemoryContext;
+			sortKey->ssup_collation = rel->rd_indcollation[k];
+			sortKey->ssup_nulls_first =
+				(indoption & INDOPTION_NULLS_FIRST) != 0;
+			sortKey->ssup_attno = k + 1;
+			sortKey->abbreviate = false;
+
+			PrepareSortSupportFromIndexRel(rel,
+										   (indoption & INDOPTION_DESC) != 0,
+										   sortKey);
+		}
+
+		qsort_arg(order, ntuples, sizeof(int), btinsertbatch_cmp, &state);
+		pfree(state.sortKeys);
+	}
+
+	for (int i = 0; i < ntuples; i++)
+	{
+		int			n = order[i];
+		IndexTuple	itup;
+
+		itup = index_form_tuple(RelationGetDescr(rel),
+								values + n * natts, isnull + n * natts);
+		itup->t_tid = ht_ctids[n];
+
+		(void) _bt_doinsert(rel, itup, UNIQUE_CHECK_NO, false, heapRel,
+							&leafhint);
+
+		pfree(itup);
+	}
+
+	pfree(order);
+}
+
 /*
  *	btgettuple() -- Get the next tuple in the scan.
  */
@@ -29,7 +29,10 @@ static inline void _bt_drop_lock_and_maybe_pin(Relation rel, BTScanOpaque so);
 static Buffer _bt_moveright(Relation rel, Relation heaprel, BTScanInsert key,
 							Buffer buf, bool forupdate, BTStack stack,
 							int access);
-static OffsetNumber _bt_binsrch(Relation rel, BTScanInsert key, Buffer buf);
+static OffsetNumber _bt_binsrch(Relation rel, BTScanInsert key, Page page);
+static inline int32 _bt_compare_prefix(Relation rel, BTScanInsert key,
+									   Page page, OffsetNumber offnum,
+									   int *nequal);
 static int	_bt_binsrch_posting(BTScanInsert key, Page page,
 								OffsetNumber offnum);
 static inline void _bt_returnitem(IndexScanDesc scan, BTScanOpaque so);
@@ -92,6 +95,16 @@ _bt_drop_lock_and_maybe_pin(Relation rel, BTScanOpaque so)
  *
  * heaprel must be provided by callers that pass access = BT_WRITE, since we
  * might need to allocate a new root page for caller -- see _bt_allocbuf.
+ *
+ * Internal pages above level 1 are normally not locked at all on the way
+ * down.  Instead we hold just a pin, and work from a private copy of the
+ * page taken with _bt_copybuf, which only succeeds if no-one modified the
+ * page while we were copying it.  A locked page tells us nothing more than
+ * such a copy does, since we'd release the lock before visiting the child
+ * anyway, but with many concurrent searches, locking the upper levels of
+ * the tree makes for heavy contention on a few buffer content locks.  If the
+ * page can't be copied, or the copy shows that we need to move right or
+ * finish an incomplete split, we just lock the page and carry on as usual.
  */
 BTStack
 _bt_search(Relation rel, Relation heaprel, BTScanInsert key, Buffer *bufP,
@@ -99,13 +112,18 @@ _bt_search(Relation rel, Relation heaprel, BTScanInsert key, Buffer *bufP,
 {
 	BTStack		stack_in = NULL;
 	int			page_access = BT_READ;
+	PGAlignedBlock copy;
+	bool		unlocked;
 
 	/* heaprel must be set whenever _bt_allocbuf is reachable */
 	Assert(access == BT_READ || access == BT_WRITE);
 	Assert(access == BT_READ || heaprel != NULL);
 
-	/* Get the root page to start with */
-	*bufP = _bt_getroot(rel, heaprel, access);
+	/* Get the root page to start with, preferably without locking it */
+	*bufP = _bt_getrootcopy(rel, copy.data);
+	unlocked = BufferIsValid(*bufP);
+	if (!unlocked)
+		*bufP = _bt_getroot(rel, heaprel, access);
 
 	/* If index is empty and access = BT_READ, no root page is created. */
 	if (!BufferIsValid(*bufP))
@@ -120,34 +138,59 @@ _bt_search(Relation rel, Relation heaprel, BTScanInsert key, Buffer *bufP,
 		ItemId		itemid;
 		IndexTuple	itup;
 		BlockNumber child;
+		bool		child_internal;
 		BTStack		new_stack;
 
 		/*
-		 * Race -- the page we just grabbed may have split since we read its
-		 * downlink in its parent page (or the metapage).  If it has, we may
-		 * need to move right to its new sibling.  Do that.
-		 *
-		 * In write-mode, allow _bt_moveright to finish any incomplete splits
-		 * along the way.  Strictly speaking, we'd only need to finish an
-		 * incomplete split on the leaf page we're about to insert to, not on
-		 * any of the upper levels (internal pages with incomplete splits are
-		 * also taken care of in _bt_getstackbuf).  But this is a good
-		 * opportunity to finish splits of internal pages too.
+		 * If we hold only a pin, check the copy of the page for anything that
+		 * _bt_moveright would have to deal with.  All of that is rare, so
+		 * just lock the page and let _bt_moveright take care of it.
 		 */
-		*bufP = _bt_moveright(rel, heaprel, key, *bufP, (access == BT_WRITE),
-							  stack_in, page_access);
+		if (unlocked)
+		{
+			page = copy.data;
+			opaque = BTPageGetOpaque(page);
+			if (P_ISLEAF(opaque) || P_IGNORE(opaque) ||
+				(access == BT_WRITE && P_INCOMPLETE_SPLIT(opaque)) ||
+				(!P_RIGHTMOST(opaque) &&
+				 _bt_compare(rel, key, page, P_HIKEY) >= (key->nextkey ? 0 : 1)))
+			{
+				_bt_lockbuf(rel, *bufP, BT_READ);
+				_bt_checkpage(rel, *bufP);
+				unlocked = false;
+			}
+		}
 
-		/* if this is a leaf page, we're done */
-		page = BufferGetPage(*bufP);
-		opaque = BTPageGetOpaque(page);
-		if (P_ISLEAF(opaque))
-			break;
+		if (!unlocked)
+		{
+			/*
+			 * Race -- the page we just grabbed may have split since we read
+			 * its downlink in its parent page (or the metapage).  If it has,
+			 * we may need to move right to its new sibling.  Do that.
+			 *
+			 * In write-mode, allow _bt_moveright to finish any incomplete
+			 * splits along the way.  Strictly speaking, we'd only need to
+			 * finish an incomplete split on the leaf page we're about to
+			 * insert to, not on any of the upper levels (internal pages with
+			 * incomplete splits are also taken care of in _bt_getstackbuf).
+			 * But this is a good opportunity to finish splits of internal
+			 * pages too.
+			 */
+			*bufP = _bt_moveright(rel, heaprel, key, *bufP,
+								  (access == BT_WRITE), stack_in, page_access);
+
+			/* if this is a leaf page, we're done */
+			page = BufferGetPage(*bufP);
+			opaque = BTPageGetOpaque(page);
+			if (P_ISLEAF(opaque))
+				break;
+		}
 
 		/*
 		 * Find the appropriate pivot tuple on this page.  Its downlink points
 		 * to the child page that we're about to descend to.
 		 */
-		offnum = _bt_binsrch(rel, key, *bufP);
+		offnum = _bt_binsrch(rel, key, page);
 		itemid = PageGetItemId(page, offnum);
 		itup = (IndexTuple) PageGetItem(page, itemid);
 		Assert(BTreeTupleIsPivot(itup) || !key->heapkeyspace);
@@ -171,9 +214,23 @@ _bt_search(Relation rel, Relation heaprel, BTScanInsert key, Buffer *bufP,
 		 */
 		if (opaque->btpo_level == 1 && access == BT_WRITE)
 			page_access = BT_WRITE;
+		child_internal = (opaque->btpo_level > 1);
 
-		/* drop the read lock on the page, then acquire one on its child */
-		*bufP = _bt_relandgetbuf(rel, *bufP, child, page_access);
+		/* drop the read lock on the page, if any */
+		if (!unlocked)
+			_bt_unlockbuf(rel, *bufP);
+
+		/*
+		 * Move to the child.  Lock it, unless it's an internal page that we
+		 * manage to copy.
+		 */
+		*bufP = ReleaseAndReadBuffer(*bufP, rel, child);
+		unlocked = child_internal && _bt_copybuf(rel, *bufP, copy.data);
+		if (!unlocked)
+		{
+			_bt_lockbuf(rel, *bufP, page_access);
+			_bt_checkpage(rel, *bufP);
+		}
 
 		/* okay, all set to move down a level */
 		stack_in = new_stack;
@@ -331,22 +388,22 @@ _bt_moveright(Relation rel,
  * non-pivot slot, or (in the case of a backward scan) before the first slot.
  *
  * This procedure is not responsible for walking right, it just examines
- * the given page.  _bt_binsrch() has no lock or refcount side effects
- * on the buffer.
+ * the given page.  That's usually a locked buffer page, but can also be a
+ * private copy of an internal page (see _bt_search).
  */
 static OffsetNumber
 _bt_binsrch(Relation rel,
 			BTScanInsert key,
-			Buffer buf)
+			Page page)
 {
-	Page		page;
 	BTPageOpaque opaque;
 	OffsetNumber low,
 				high;
+	int			lowprefix,
+				highprefix;
 	int32		result,
 				cmpval;
 
-	page = BufferGetPage(buf);
 	opaque = BTPageGetOpaque(page);
 
 	/* Requesting nextkey semantics while using scantid seems nonsensical */
@@ -378,23 +435,39 @@ _bt_binsrch(Relation rel,
 	 * 'low' are <= scan key, all slots at or after 'high' are > scan key.
 	 *
 	 * We can fall out when high == low.
+	 *
+	 * lowprefix and highprefix are the number of leading key attributes that
+	 * the tuples just before 'low' and at 'high' were found to share with the
+	 * scan key.  Every tuple in between must share at least as many, so
+	 * _bt_compare_prefix() needn't compare those attributes again.  With
+	 * indexes on several columns whose leading values repeat a lot, that
+	 * saves most of the comparisons (see "Dynamic prefix truncation" in the
+	 * README).
 	 */
 	high++;						/* establish the loop invariant for high */
+	lowprefix = highprefix = 0;
 
 	cmpval = key->nextkey ? 0 : 1;	/* select comparison value */
 
 	while (high > low)
 	{
 		OffsetNumber mid = low + ((high - low) / 2);
+		int			nequal = Min(lowprefix, highprefix);
 
 		/* We have low <= mid < high, so mid points at a real slot */
 
-		result = _bt_compare(rel, key, page, mid);
+		result = _bt_compare_prefix(rel, key, page, mid, &nequal);
 
 		if (result >= cmpval)
+		{
 			low = mid + 1;
+			lowprefix = nequal;
+		}
 		else
+		{
 			high = mid;
+			highprefix = nequal;
+		}
 	}
 
 	/*
@@ -474,6 +547,8 @@ _bt_binsrch_insert(Relation rel, BTInsertState insertstate)
 	OffsetNumber low,
 				high,
 				stricthigh;
+	int			lowprefix,
+				highprefix;
 	int32		result,
 				cmpval;
 
@@ -521,21 +596,29 @@ _bt_binsrch_insert(Relation rel, BTInsertState insertstate)
 		high++;					/* establish the loop invariant for high */
 	stricthigh = high;			/* high initially strictly higher */
 
+	/* Same as in _bt_binsrch(); cached bounds don't remember their prefix */
+	lowprefix = highprefix = 0;
+
 	cmpval = 1;					/* !nextkey comparison value */
 
 	while (high > low)
 	{
 		OffsetNumber mid = low + ((high - low) / 2);
+		int			nequal = Min(lowprefix, highprefix);
 
 		/* We have low <= mid < high, so mid points at a real slot */
 
-		result = _bt_compare(rel, key, page, mid);
+		result = _bt_compare_prefix(rel, key, page, mid, &nequal);
 
 		if (result >= cmpval)
+		{
 			low = mid + 1;
+			lowprefix = nequal;
+		}
 		else
 		{
 			high = mid;
+			highprefix = nequal;
 			if (result != 0)
 				stricthigh = high;
 		}
@@ -684,6 +767,27 @@ _bt_compare(Relation rel,
 			BTScanInsert key,
 			Page page,
 			OffsetNumber offnum)
+{
+	int			nequal = 0;
+
+	return _bt_compare_prefix(rel, key, page, offnum, &nequal);
+}
+
+/*
+ *	_bt_compare_prefix() -- _bt_compare(), skipping a known-equal prefix.
+ *
+ * On entry, *nequal is the number of leading key attributes that caller
+ * already knows to be equal between the scankey and the tuple at offnum;
+ * comparison starts with the attribute after those.  On return, *nequal is
+ * the number of leading key attributes that are known to be equal, which
+ * callers can use to bound later comparisons (see _bt_binsrch).
+ */
+static inline int32
+_bt_compare_prefix(Relation rel,
+				   BTScanInsert key,
+				   Page page,
+				   OffsetNumber offnum,
+				   int *nequal)
 {
 	TupleDesc	itupdesc = RelationGetDescr(rel);
 	BTPageOpaque opaque = BTPageGetOpaque(page);
@@ -703,7 +807,10 @@ _bt_compare(Relation rel,
 	 * --- see NOTE above.
 	 */
 	if (!P_ISLEAF(opaque) && offnum == P_FIRSTDATAKEY(opaque))
+	{
+		*nequal = 0;
 		return 1;
+	}
 
 	itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, offnum));
 	ntupatts = BTreeTupleGetNAtts(itup, rel);
@@ -723,8 +830,9 @@ _bt_compare(Relation rel,
 	ncmpkey = Min(ntupatts, key->keysz);
 	Assert(key->heapkeyspace || ncmpkey == key->keysz);
 	Assert(!BTreeTupleIsPosting(itup) || key->allequalimage);
-	scankey = key->scankeys;
-	for (int i = 1; i <= ncmpkey; i++)
+	Assert(*nequal >= 0 && *nequal <= key->keysz);
+	scankey = key->scankeys + *nequal;
+	for (int i = *nequal + 1; i <= ncmpkey; i++)
 	{
 		Datum		datum;
 		bool		isNull;
@@ -768,11 +876,20 @@ _bt_compare(Relation rel,
 
 		/* if the keys are unequal, return the difference */
 		if (result != 0)
+		{
+			*nequal = i - 1;
 			return result;
+		}
 
 		scankey++;
 	}
 
+	/*
+	 * A truncated pivot tuple may have fewer attributes than caller thought
+	 * to be equal; only claim the ones it actually has.
+	 */
+	*nequal = ncmpkey;
+
 	/*
 	 * All non-truncated attributes (other than heap TID) were found to be
 	 * equal.  Treat truncated attributes as minus infinity when scankey has a
@@ -1538,7 +1655,7 @@ _bt_first(IndexScanDesc scan, ScanDirection dir)
 	}
 
 	/* position to the precise item on the page */
-	offnum = _bt_binsrch(rel, &inskey, so->currPos.buf);
+	offnum = _bt_binsrch(rel, &inskey, BufferGetPage(so->currPos.buf));
 
 	/*
 	 * Now load data from the first page of the scan (usually the page
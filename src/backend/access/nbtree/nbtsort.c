@@ -1147,6 +1147,13 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 	int64		tuples_done = 0;
 	bool		deduplicate;
 
+	/*
+	 * If requested, have the pages we write compressed.  Once compressed,
+	 * pages stay that way when written back later.
+	 */
+	RelationGetSmgr(wstate->index)->smgr_compress =
+		BTGetPageCompression(wstate->index);
+
 	wstate->bulkstate = smgr_bulk_start_rel(wstate->index, MAIN_FORKNUM);
 
 	deduplicate = wstate->inskey->allequalimage && !btspool->isunique &&
@@ -1374,6 +1381,7 @@ _bt_load(BTWriteState *wstate, BTSpool *btspool, BTSpool *btspool2)
 	/* Close down final pages and write the metapage */
 	_bt_uppershutdown(wstate, state);
 	smgr_bulk_finish(wstate->bulkstate);
+	RelationGetSmgr(wstate->index)->smgr_compress = false;
 }
 
 /*
@@ -608,7 +608,9 @@ btoptions(Datum reloptions, bool validate)
 		{"vacuum_cleanup_index_scale_factor", RELOPT_TYPE_REAL,
 		offsetof(BTOptions, vacuum_cleanup_index_scale_factor)},
 		{"deduplicate_items", RELOPT_TYPE_BOOL,
-		offsetof(BTOptions, deduplicate_items)}
+		offsetof(BTOptions, deduplicate_items)},
+		{"page_compression", RELOPT_TYPE_BOOL,
+		offsetof(BTOptions, page_compression)}
 	};
 
 	return (bytea *) build_reloptions(reloptions, validate,
@@ -377,7 +377,7 @@ simple_table_tuple_update(Relation rel, ItemPointer otid,
 								GetCurrentCommandId(true),
 								snapshot, InvalidSnapshot,
 								true /* wait for commit */ ,
-								&tmfd, &lockmode, update_indexes);
+								NULL, &tmfd, &lockmode, update_indexes);
 
 	switch (result)
 	{
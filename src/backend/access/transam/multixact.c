@@ -83,6 +83,7 @@
 #include "storage/pmsignal.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
+#include "storage/spin.h"
 #include "utils/guc_hooks.h"
 #include "utils/injection_point.h"
 #include "utils/lsyscache.h"
@@ -247,6 +248,40 @@ typedef struct mXactCacheEnt
 static dclist_head MXactCache = DCLIST_STATIC_INIT(MXactCache);
 static MemoryContext MXactContext = NULL;
 
+/*
+ * Definitions for the shared MultiXactId member cache.
+ *
+ * The backend-local cache above only helps a backend that looks at the same
+ * multixact repeatedly within one transaction.  Workloads that take many
+ * FOR KEY SHARE locks (e.g. foreign key checks) create lots of small
+ * multixacts that are then examined by many other backends, each of which
+ * would otherwise have to read both SLRU areas.  To reduce that traffic we
+ * keep an optional direct-mapped array in shared memory, indexed by
+ * multi % multixact_cache_size, holding the members of recently created
+ * multixacts.  Entries are filled when a multixact is recorded (including
+ * during WAL replay, so standbys benefit too) and when a lookup has to go to
+ * the SLRUs.  A multixact's membership never changes once recorded, so an
+ * entry can be trusted as long as its multi matches; multixacts with more
+ * than MXACT_SHARED_CACHE_MAX_MEMBERS members are not cached.
+ *
+ * Each entry is protected by its own spinlock, which is only held while
+ * copying a handful of members in or out.
+ */
+#define MXACT_SHARED_CACHE_MAX_MEMBERS	6
+
+typedef struct MXactSharedCacheEnt
+{
+	slock_t		mutex;
+	MultiXactId multi;			/* InvalidMultiXactId if unused */
+	int			nmembers;
+	MultiXactMember members[MXACT_SHARED_CACHE_MAX_MEMBERS];
+} MXactSharedCacheEnt;
+
+/* GUC parameter */
+int			multixact_cache_size = 0;
+
+static MXactSharedCacheEnt *MXactSharedCache = NULL;
+
 #ifdef MULTIXACT_DEBUG
 #define debug_elog2(a,b) elog(a,b)
 #define debug_elog3(a,b,c) elog(a,b,c)
@@ -273,6 +308,9 @@ static MultiXactId mXactCacheGetBySet(int nmembers, MultiXactMember *members);
 static int	mXactCacheGetById(MultiXactId multi, MultiXactMember **members);
 static void mXactCachePut(MultiXactId multi, int nmembers,
 						  MultiXactMember *members);
+static int	mXactSharedCacheGet(MultiXactId multi, MultiXactMember **members);
+static void mXactSharedCachePut(MultiXactId multi, int nmembers,
+								MultiXactMember *members);
 
 /* management of SLRU infrastructure */
 static bool MultiXactOffsetPagePrecedes(int64 page1, int64 page2);
@@ -772,6 +810,14 @@ RecordNewMultiXact(MultiXactId multi, MultiXactOffset offset,
 	LWLock	   *lock;
 	LWLock	   *prevlock = NULL;
 
+	/*
+	 * Remember the members in the shared cache.  Other backends can't look
+	 * at this multixact until it's been stamped on a tuple, which happens
+	 * only after we return, so it doesn't matter that the SLRUs are not
+	 * updated yet.
+	 */
+	mXactSharedCachePut(multi, nmembers, members);
+
 	/* position of this multixid in the offsets SLRU area  */
 	pageno = MultiXactIdToOffsetPage(multi);
 	entryno = MultiXactIdToOffsetEntry(multi);
@@ -1194,6 +1240,20 @@ GetMultiXactIdMembers(MultiXactId multi, MultiXactMember **members,
 				 errmsg("MultiXactId %u has not been created yet -- apparent wraparound",
 						multi)));
 
+	/*
+	 * Try the shared cache before going to the SLRUs.  This has to come after
+	 * the range checks above, so that an entry left behind by a multixact
+	 * that has since been truncated away is never returned.
+	 */
+	length = mXactSharedCacheGet(multi, members);
+	if (length > 0)
+	{
+		debug_elog3(DEBUG2, "GetMembers: found %s in the shared cache",
+					mxid_to_string(multi, length, *members));
+		mXactCachePut(multi, length, *members);
+		return length;
+	}
+
 	/*
 	 * Find out the offset at which we need to start reading MultiXactMembers
 	 * and the number of members in the multixact.  We determine the latter as
@@ -1330,9 +1390,10 @@ GetMultiXactIdMembers(MultiXactId multi, MultiXactMember **members,
 	LWLockRelease(lock);
 
 	/*
-	 * Copy the result into the local cache.
+	 * Copy the result into the local and shared caches.
 	 */
 	mXactCachePut(multi, length, ptr);
+	mXactSharedCachePut(multi, length, ptr);
 
 	debug_elog3(DEBUG2, "GetMembers: no cache for %s",
 				mxid_to_string(multi, length, ptr));
@@ -1512,6 +1573,62 @@ mXactCachePut(MultiXactId multi, int nmembers, MultiXactMember *members)
 	}
 }
 
+/*
+ * mXactSharedCacheGet
+ *		returns a palloc'd copy of the members of the given MultiXactId from
+ *		the shared cache, or -1 if it's not there.
+ */
+static int
+mXactSharedCacheGet(MultiXactId multi, MultiXactMember **members)
+{
+	MXactSharedCacheEnt *entry;
+	MultiXactMember buf[MXACT_SHARED_CACHE_MAX_MEMBERS];
+	int			nmembers = -1;
+
+	if (MXactSharedCache == NULL)
+		return -1;
+
+	entry = &MXactSharedCache[multi % multixact_cache_size];
+
+	SpinLockAcquire(&entry->mutex);
+	if (entry->multi == multi)
+	{
+		nmembers = entry->nmembers;
+		memcpy(buf, entry->members, nmembers * sizeof(MultiXactMember));
+	}
+	SpinLockRelease(&entry->mutex);
+
+	if (nmembers <= 0)
+		return -1;
+
+	*members = palloc(nmembers * sizeof(MultiXactMember));
+	memcpy(*members, buf, nmembers * sizeof(MultiXactMember));
+	return nmembers;
+}
+
+/*
+ * mXactSharedCachePut
+ *		Remember the members of a MultiXactId in the shared cache, evicting
+ *		whatever occupied its slot.
+ */
+static void
+mXactSharedCachePut(MultiXactId multi, int nmembers, MultiXactMember *members)
+{
+	MXactSharedCacheEnt *entry;
+
+	if (MXactSharedCache == NULL ||
+		nmembers <= 0 || nmembers > MXACT_SHARED_CACHE_MAX_MEMBERS)
+		return;
+
+	entry = &MXactSharedCache[multi % multixact_cache_size];
+
+	SpinLockAcquire(&entry->mutex);
+	entry->multi = multi;
+	entry->nmembers = nmembers;
+	memcpy(entry->members, members, nmembers * sizeof(MultiXactMember));
+	SpinLockRelease(&entry->mutex);
+}
+
 char *
 mxstatus_to_string(MultiXactStatus status)
 {
@@ -1718,6 +1835,8 @@ MultiXactShmemSize(void)
 	size = SHARED_MULTIXACT_STATE_SIZE;
 	size = add_size(size, SimpleLruShmemSize(multixact_offset_buffers, 0));
 	size = add_size(size, SimpleLruShmemSize(multixact_member_buffers, 0));
+	size = add_size(size, mul_size(sizeof(MXactSharedCacheEnt),
+								   multixact_cache_size));
 
 	return size;
 }
@@ -1766,6 +1885,28 @@ MultiXactShmemInit(void)
 	 */
 	OldestMemberMXactId = MultiXactState->perBackendXactIds;
 	OldestVisibleMXactId = OldestMemberMXactId + MaxOldestSlot;
+
+	/* Initialize the shared member cache, if enabled */
+	if (multixact_cache_size > 0)
+	{
+		MXactSharedCache = (MXactSharedCacheEnt *)
+			ShmemInitStruct("Shared MultiXact Member Cache",
+							mul_size(sizeof(MXactSharedCacheEnt),
+									 multixact_cache_size),
+							&found);
+		if (!IsUnderPostmaster)
+		{
+			Assert(!found);
+			for (int i = 0; i < multixact_cache_size; i++)
+			{
+				SpinLockInit(&MXactSharedCache[i].mutex);
+				MXactSharedCache[i].multi = InvalidMultiXactId;
+				MXactSharedCache[i].nmembers = 0;
+			}
+		}
+		else
+			Assert(found);
+	}
 }
 
 /*
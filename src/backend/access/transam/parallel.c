@@ -14,8 +14,12 @@
 
 #include "postgres.h"
 
+#include <signal.h>
+
 #include "access/brin.h"
 #include "access/gin.h"
+#include "access/gist_private.h"
+#include "access/heapam.h"
 #include "access/nbtree.h"
 #include "access/parallel.h"
 #include "access/session.h"
@@ -26,6 +30,8 @@
 #include "catalog/pg_enum.h"
 #include "catalog/storage.h"
 #include "commands/async.h"
+#include "commands/copy.h"
+#include "commands/tablecmds.h"
 #include "commands/vacuum.h"
 #include "executor/execParallel.h"
 #include "libpq/libpq.h"
@@ -36,6 +42,9 @@
 #include "pgstat.h"
 #include "storage/ipc.h"
 #include "storage/predicate.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
+#include "storage/sinval.h"
 #include "storage/spin.h"
 #include "tcop/tcopprot.h"
 #include "utils/combocid.h"
@@ -44,6 +53,7 @@
 #include "utils/memutils.h"
 #include "utils/relmapper.h"
 #include "utils/snapmgr.h"
+#include "utils/timestamp.h"
 
 /*
  * We don't want to waste a lot of memory on an error queue which, most of
@@ -57,6 +67,14 @@
 /* Magic number for parallel context TOC. */
 #define PARALLEL_MAGIC						0x50477c7c
 
+/*
+ * Largest DSM segment that we keep for reuse by the next parallel context,
+ * rather than destroying it.  Creating a segment, and having every worker map
+ * it, costs several system calls and page faults; a session that runs many
+ * short parallel queries would otherwise pay that for each of them.
+ */
+#define PARALLEL_DSM_CACHE_MAX_SIZE			(2 * 1024 * 1024)
+
 /*
  * Magic numbers for per-context parallel state sharing.  Higher-level code
  * should use smaller values, leaving these very large ones for use by this
@@ -106,6 +124,91 @@ typedef struct FixedParallelState
 	XLogRecPtr	last_xlog_end;
 } FixedParallelState;
 
+/* What a newly launched worker finds in bgw_extra. */
+typedef struct ParallelWorkerExtra
+{
+	int			worker_number;
+	int			pool_slot;		/* see below, or -1 */
+	uint64		pool_generation;
+} ParallelWorkerExtra;
+
+StaticAssertDecl(sizeof(ParallelWorkerExtra) <= BGW_EXTRALEN,
+				 "ParallelWorkerExtra doesn't fit in bgw_extra");
+
+/*
+ * Parallel worker pool.
+ *
+ * Starting a parallel worker means forking a process, connecting it to the
+ * database and loading libraries before it can restore the leader's state,
+ * which takes long enough to make parallelism useless for short queries.
+ * With parallel_worker_pool_size > 0, a worker that has completed its task
+ * doesn't exit, but stays connected to its database as its authenticated
+ * user and waits for a leader with the same database and authenticated
+ * user to hand it another task.  Only the per-task part of the setup in
+ * ParallelWorkerMain() is repeated then.
+ *
+ * A worker can join the pool only if it owns a slot in ParallelPool, which
+ * the leader that launches it reserves.  A slot goes through these states:
+ *
+ * ASSIGNED: the worker is being started, or has been handed a task, by the
+ * leader recorded in the slot.  The slot's generation is advanced each
+ * time, so that the leader can tell whether the slot is still about its
+ * own task.
+ *
+ * DONE: the worker has completed the task, detached from the leader's DSM
+ * segment and left its lock group.  To the leader, that is as good as the
+ * worker having exited; see WaitForParallelWorkersToExit().
+ *
+ * IDLE: the leader has seen that, and the worker may be claimed again.
+ *
+ * A worker that doesn't fit in the pool exits as usual, and so does an idle
+ * worker after PARALLEL_POOL_IDLE_TIMEOUT, to give back the
+ * max_worker_processes and max_parallel_workers slots it occupies.  An idle
+ * worker holds no locks, snapshots or DSM segments, but it is connected to
+ * its database, so CountOtherDBBackends() asks such workers to exit.
+ */
+#define PARALLEL_POOL_IDLE_TIMEOUT	60000	/* ms */
+
+typedef enum ParallelPoolSlotState
+{
+	PARALLEL_POOL_FREE = 0,
+	PARALLEL_POOL_ASSIGNED,
+	PARALLEL_POOL_DONE,
+	PARALLEL_POOL_IDLE,
+} ParallelPoolSlotState;
+
+typedef struct ParallelPoolSlot
+{
+	ParallelPoolSlotState state;
+	uint64		generation;		/* advanced by each assignment */
+	Oid			database_id;
+	Oid			authenticated_user_id;
+
+	/* The worker; pid is 0 until it has started */
+	pid_t		pid;
+	ProcNumber	procno;
+	int			bgw_slot;		/* see GetMyBackgroundWorkerSlot() */
+	uint64		bgw_generation;
+
+	/* The current task */
+	ProcNumber	leader_procno;
+	dsm_handle	seg_handle;
+	int			worker_number;
+} ParallelPoolSlot;
+
+typedef struct ParallelPoolControl
+{
+	slock_t		mutex;			/* protects all fields */
+	uint64		hits;			/* tasks handed to idle workers */
+	uint64		misses;			/* workers launched for want of one */
+	ParallelPoolSlot slots[FLEXIBLE_ARRAY_MEMBER];	/* max_worker_processes */
+} ParallelPoolControl;
+
+static ParallelPoolControl *ParallelPool = NULL;
+
+/* GUC parameter */
+int			parallel_worker_pool_size = 0;
+
 /*
  * Our parallel worker number.  We initialize this to -1, meaning that we are
  * not a parallel worker.  In parallel workers, it will be set to a value >= 0
@@ -126,9 +229,19 @@ static FixedParallelState *MyFixedParallelState;
 /* List of active parallel contexts. */
 static dlist_head pcxt_list = DLIST_STATIC_INIT(pcxt_list);
 
+/* In the leader, a DSM segment kept for reuse; see DestroyParallelContext. */
+static dsm_segment *ParallelCachedSegment = NULL;
+
 /* Backend-local copy of data from FixedParallelState. */
 static pid_t ParallelLeaderPid;
 
+/* In a worker, the DSM segment of the current task. */
+static dsm_segment *ParallelWorkerSegment = NULL;
+
+/* In a worker, our pool slot (or -1), and the generation of our task. */
+static int	MyParallelPoolSlot = -1;
+static uint64 MyParallelPoolGeneration;
+
 /*
  * List of internal parallel worker entry points.  We need this for
  * reasons explained in LookupParallelWorkerFunction(), below.
@@ -152,8 +265,20 @@ static const struct
 	{
 		"_gin_parallel_build_main", _gin_parallel_build_main
 	},
+	{
+		"_gist_parallel_build_main", _gist_parallel_build_main
+	},
 	{
 		"parallel_vacuum_main", parallel_vacuum_main
+	},
+	{
+		"ParallelCopyFromMain", ParallelCopyFromMain
+	},
+	{
+		"heap_parallel_cluster_main", heap_parallel_cluster_main
+	},
+	{
+		"ATRewriteTableParallelMain", ATRewriteTableParallelMain
 	}
 };
 
@@ -161,7 +286,17 @@ static const struct
 static void ProcessParallelMessage(ParallelContext *pcxt, int i, StringInfo msg);
 static void WaitForParallelWorkersToExit(ParallelContext *pcxt);
 static parallel_worker_main_type LookupParallelWorkerFunction(const char *libraryname, const char *funcname);
+static bool ParallelWorkerRunTask(dsm_handle handle, int worker_number,
+								  bool first);
 static void ParallelWorkerShutdown(int code, Datum arg);
+static bool ParallelPoolClaimWorker(ParallelContext *pcxt, int i);
+static void ParallelPoolReserveSlot(ParallelContext *pcxt, int i);
+static void ParallelPoolReleaseSlot(int slotno, uint64 generation);
+static void ParallelPoolWaitForWorker(ParallelWorkerInfo *worker);
+static void ParallelPoolTerminateIdle(Oid dbid, int max_workers);
+static void ParallelPoolWorkerStartup(int slotno, uint64 generation);
+static bool ParallelPoolWaitForTask(dsm_handle *handle, int *worker_number);
+static void ParallelPoolWorkerExit(int code, Datum arg);
 
 
 /*
@@ -324,7 +459,15 @@ InitializeParallelDSM(ParallelContext *pcxt)
 	 * parallelism than to fail outright.
 	 */
 	segsize = shm_toc_estimate(&pcxt->estimator);
-	if (pcxt->nworkers > 0)
+	if (pcxt->nworkers > 0 && ParallelCachedSegment != NULL &&
+		dsm_segment_map_length(ParallelCachedSegment) >= segsize)
+	{
+		/* Reuse the cached segment, tying it to our resource owner again */
+		pcxt->seg = ParallelCachedSegment;
+		ParallelCachedSegment = NULL;
+		dsm_unpin_mapping(pcxt->seg);
+	}
+	else if (pcxt->nworkers > 0)
 		pcxt->seg = dsm_create(segsize, DSM_CREATE_NULL_IF_MAXSEGMENTS);
 	if (pcxt->seg != NULL)
 		pcxt->toc = shm_toc_create(PARALLEL_MAGIC,
@@ -582,6 +725,7 @@ LaunchParallelWorkers(ParallelContext *pcxt)
 {
 	MemoryContext oldcontext;
 	BackgroundWorker worker;
+	ParallelWorkerExtra extra;
 	int			i;
 	bool		any_registrations_failed = false;
 
@@ -614,7 +758,8 @@ LaunchParallelWorkers(ParallelContext *pcxt)
 	worker.bgw_notify_pid = MyProcPid;
 
 	/*
-	 * Start workers.
+	 * Start workers, preferably by handing the task to idle workers from the
+	 * pool.
 	 *
 	 * The caller must be able to tolerate ending up with fewer workers than
 	 * expected, so there is no need to throw an error here if registration
@@ -623,31 +768,58 @@ LaunchParallelWorkers(ParallelContext *pcxt)
 	 */
 	for (i = 0; i < pcxt->nworkers_to_launch; ++i)
 	{
-		memcpy(worker.bgw_extra, &i, sizeof(int));
-		if (!any_registrations_failed &&
-			RegisterDynamicBackgroundWorker(&worker,
-											&pcxt->worker[i].bgwhandle))
+		pcxt->worker[i].pool_slot = -1;
+		if (!any_registrations_failed && ParallelPoolClaimWorker(pcxt, i))
 		{
 			shm_mq_set_handle(pcxt->worker[i].error_mqh,
 							  pcxt->worker[i].bgwhandle);
 			pcxt->nworkers_launched++;
+			continue;
 		}
-		else
+
+		if (!any_registrations_failed)
 		{
+			ParallelPoolReserveSlot(pcxt, i);
+			extra.worker_number = i;
+			extra.pool_slot = pcxt->worker[i].pool_slot;
+			extra.pool_generation = pcxt->worker[i].pool_generation;
+			memcpy(worker.bgw_extra, &extra, sizeof(extra));
+			if (RegisterDynamicBackgroundWorker(&worker,
+												&pcxt->worker[i].bgwhandle))
+			{
+				shm_mq_set_handle(pcxt->worker[i].error_mqh,
+								  pcxt->worker[i].bgwhandle);
+				pcxt->nworkers_launched++;
+				continue;
+			}
+
+			if (pcxt->worker[i].pool_slot >= 0)
+			{
+				ParallelPoolReleaseSlot(pcxt->worker[i].pool_slot,
+										pcxt->worker[i].pool_generation);
+				pcxt->worker[i].pool_slot = -1;
+			}
+
 			/*
-			 * If we weren't able to register the worker, then we've bumped up
-			 * against the max_worker_processes limit, and future
-			 * registrations will probably fail too, so arrange to skip them.
-			 * But we still have to execute this code for the remaining slots
-			 * to make sure that we forget about the error queues we budgeted
-			 * for those workers.  Otherwise, we'll wait for them to start,
-			 * but they never will.
+			 * Idle pooled workers of other databases or users may be
+			 * occupying the worker slots.  Ask one of them to make room for
+			 * next time.
 			 */
-			any_registrations_failed = true;
-			pcxt->worker[i].bgwhandle = NULL;
-			shm_mq_detach(pcxt->worker[i].error_mqh);
-			pcxt->worker[i].error_mqh = NULL;
+			ParallelPoolTerminateIdle(InvalidOid, 1);
 		}
+
+		/*
+		 * If we weren't able to register the worker, then we've bumped up
+		 * against the max_worker_processes limit, and future registrations
+		 * will probably fail too, so arrange to skip them.  But we still have
+		 * to execute this code for the remaining slots to make sure that we
+		 * forget about the error queues we budgeted for those workers.
+		 * Otherwise, we'll wait for them to start, but they never will.
+		 */
+		any_registrations_failed = true;
+		pcxt->worker[i].bgwhandle = NULL;
+		shm_mq_detach(pcxt->worker[i].error_mqh);
+		pcxt->worker[i].error_mqh = NULL;
 	}
 
 	/*
@@ -926,18 +1098,25 @@ WaitForParallelWorkersToExit(ParallelContext *pcxt)
 		if (pcxt->worker == NULL || pcxt->worker[i].bgwhandle == NULL)
 			continue;
 
-		status = WaitForBackgroundWorkerShutdown(pcxt->worker[i].bgwhandle);
+		/* A pooled worker doesn't exit, but is just as good when done */
+		if (pcxt->worker[i].pool_slot >= 0)
+			ParallelPoolWaitForWorker(&pcxt->worker[i]);
+		else
+		{
+			status = WaitForBackgroundWorkerShutdown(pcxt->worker[i].bgwhandle);
 
-		/*
-		 * If the postmaster kicked the bucket, we have no chance of cleaning
-		 * up safely -- we won't be able to tell when our workers are actually
-		 * dead.  This doesn't necessitate a PANIC since they will all abort
-		 * eventually, but we can't safely continue this session.
-		 */
-		if (status == BGWH_POSTMASTER_DIED)
-			ereport(FATAL,
-					(errcode(ERRCODE_ADMIN_SHUTDOWN),
-					 errmsg("postmaster exited during a parallel transaction")));
+			/*
+			 * If the postmaster kicked the bucket, we have no chance of
+			 * cleaning up safely -- we won't be able to tell when our workers
+			 * are actually dead.  This doesn't necessitate a PANIC since they
+			 * will all abort eventually, but we can't safely continue this
+			 * session.
+			 */
+			if (status == BGWH_POSTMASTER_DIED)
+				ereport(FATAL,
+						(errcode(ERRCODE_ADMIN_SHUTDOWN),
+						 errmsg("postmaster exited during a parallel transaction")));
+		}
 
 		/* Release memory. */
 		pfree(pcxt->worker[i].bgwhandle);
@@ -951,7 +1130,8 @@ WaitForParallelWorkersToExit(ParallelContext *pcxt)
  * If expecting a clean exit, you should use WaitForParallelWorkersToFinish()
  * first, before calling this function.  When this function is invoked, any
  * remaining workers are forcibly killed; the dynamic shared memory segment
- * is unmapped; and we then wait (uninterruptibly) for the workers to exit.
+ * is unmapped, or cleaned up for reuse; and we then wait (uninterruptibly)
+ * for the workers to exit.
  */
 void
 DestroyParallelContext(ParallelContext *pcxt)
@@ -985,11 +1165,22 @@ DestroyParallelContext(ParallelContext *pcxt)
 	 * If we have allocated a shared memory segment, detach it.  This will
 	 * implicitly detach the error queues, and any other shared memory queues,
 	 * stored there.
+	 *
+	 * If the segment is small enough, we'd rather keep it for the next
+	 * parallel context.  In that case we run the detach callbacks, which
+	 * clean up whatever was stored in it, but keep the mapping until the
+	 * workers are gone.
 	 */
 	if (pcxt->seg != NULL)
 	{
-		dsm_detach(pcxt->seg);
-		pcxt->seg = NULL;
+		if (ParallelCachedSegment == NULL &&
+			dsm_segment_map_length(pcxt->seg) <= PARALLEL_DSM_CACHE_MAX_SIZE)
+			dsm_run_detach_callbacks(pcxt->seg);
+		else
+		{
+			dsm_detach(pcxt->seg);
+			pcxt->seg = NULL;
+		}
 	}
 
 	/*
@@ -1011,6 +1202,19 @@ DestroyParallelContext(ParallelContext *pcxt)
 	WaitForParallelWorkersToExit(pcxt);
 	RESUME_INTERRUPTS();
 
+	/*
+	 * No worker can be attached to the segment anymore, so it's safe to hand
+	 * it to the next parallel context.  Keep it mapped beyond the end of the
+	 * transaction.
+	 */
+	if (pcxt->seg != NULL)
+	{
+		Assert(ParallelCachedSegment == NULL);
+		dsm_pin_mapping(pcxt->seg);
+		ParallelCachedSegment = pcxt->seg;
+		pcxt->seg = NULL;
+	}
+
 	/* Free the worker array itself. */
 	if (pcxt->worker != NULL)
 	{
@@ -1297,6 +1501,54 @@ AtEOXact_Parallel(bool isCommit)
  */
 void
 ParallelWorkerMain(Datum main_arg)
+{
+	ParallelWorkerExtra extra;
+	dsm_handle	handle = DatumGetUInt32(main_arg);
+	MemoryContext workcontext;
+	bool		first = true;
+
+	/* Establish signal handlers. */
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/* Determine our parallel worker number, and pool slot if any. */
+	memcpy(&extra, MyBgworkerEntry->bgw_extra, sizeof(extra));
+	if (extra.pool_slot >= 0)
+		ParallelPoolWorkerStartup(extra.pool_slot, extra.pool_generation);
+
+	/* Arrange to signal the leader if we exit. */
+	before_shmem_exit(ParallelWorkerShutdown, (Datum) 0);
+
+	/* Set up a memory context to work in, just for cleanliness. */
+	workcontext = AllocSetContextCreate(TopMemoryContext,
+										"Parallel worker",
+										ALLOCSET_DEFAULT_SIZES);
+
+	/* If we're pooled, keep running tasks for as long as we stay pooled. */
+	for (;;)
+	{
+		MemoryContextSwitchTo(workcontext);
+		if (!ParallelWorkerRunTask(handle, extra.worker_number, first))
+			break;
+		if (MyParallelPoolSlot < 0)
+			break;
+
+		MemoryContextSwitchTo(TopMemoryContext);
+		MemoryContextReset(workcontext);
+		if (!ParallelPoolWaitForTask(&handle, &extra.worker_number))
+			break;
+		first = false;
+	}
+}
+
+/*
+ * Run one task in a parallel worker.  'first' is true for the first task of
+ * the process, which must also connect to the database.
+ *
+ * Returns false if the leader has gone away already.
+ */
+static bool
+ParallelWorkerRunTask(dsm_handle handle, int worker_number, bool first)
 {
 	dsm_segment *seg;
 	shm_toc    *toc;
@@ -1326,29 +1578,21 @@ ParallelWorkerMain(Datum main_arg)
 	/* Set flag to indicate that we're initializing a parallel worker. */
 	InitializingParallelWorker = true;
 
-	/* Establish signal handlers. */
-	pqsignal(SIGTERM, die);
-	BackgroundWorkerUnblockSignals();
-
-	/* Determine and set our parallel worker number. */
+	/* Set our parallel worker number. */
 	Assert(ParallelWorkerNumber == -1);
-	memcpy(&ParallelWorkerNumber, MyBgworkerEntry->bgw_extra, sizeof(int));
-
-	/* Set up a memory context to work in, just for cleanliness. */
-	CurrentMemoryContext = AllocSetContextCreate(TopMemoryContext,
-												 "Parallel worker",
-												 ALLOCSET_DEFAULT_SIZES);
+	ParallelWorkerNumber = worker_number;
 
 	/*
 	 * Attach to the dynamic shared memory segment for the parallel query, and
 	 * find its table of contents.
 	 *
 	 * Note: at this point, we have not created any ResourceOwner in this
-	 * process.  This will result in our DSM mapping surviving until process
-	 * exit, which is fine.  If there were a ResourceOwner, it would acquire
-	 * ownership of the mapping, but we have no need for that.
+	 * process.  This will result in our DSM mapping surviving until we detach
+	 * it at the end of the task or until process exit, which is fine.  If
+	 * there were a ResourceOwner, it would acquire ownership of the mapping,
+	 * but we have no need for that.
 	 */
-	seg = dsm_attach(DatumGetUInt32(main_arg));
+	seg = dsm_attach(handle);
 	if (seg == NULL)
 		ereport(ERROR,
 				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
@@ -1366,7 +1610,7 @@ ParallelWorkerMain(Datum main_arg)
 	/* Arrange to signal the leader if we exit. */
 	ParallelLeaderPid = fps->parallel_leader_pid;
 	ParallelLeaderProcNumber = fps->parallel_leader_proc_number;
-	before_shmem_exit(ParallelWorkerShutdown, PointerGetDatum(seg));
+	ParallelWorkerSegment = seg;
 
 	/*
 	 * Now we can find and attach to the error queue provided for us.  That's
@@ -1399,7 +1643,7 @@ ParallelWorkerMain(Datum main_arg)
 	 */
 	if (!BecomeLockGroupMember(fps->parallel_leader_pgproc,
 							   fps->parallel_leader_pid))
-		return;
+		return false;
 
 	/*
 	 * Restore transaction and statement start-time timestamps.  This must
@@ -1423,33 +1667,41 @@ ParallelWorkerMain(Datum main_arg)
 	 * Restore current session authorization and role id.  No verification
 	 * happens here, we just blindly adopt the leader's state.  Note that this
 	 * has to happen before InitPostgres, since InitializeSessionUserId will
-	 * not set these variables.
+	 * not set these variables.  A pooled worker is only handed tasks of
+	 * leaders with the same database and authenticated user.
 	 */
-	SetAuthenticatedUserId(fps->authenticated_user_id);
+	if (first)
+		SetAuthenticatedUserId(fps->authenticated_user_id);
+	Assert(GetAuthenticatedUserId() == fps->authenticated_user_id);
 	SetSessionAuthorization(fps->session_user_id,
 							fps->session_user_is_superuser);
 	SetCurrentRoleId(fps->outer_user_id, fps->role_is_superuser);
 
-	/*
-	 * Restore database connection.  We skip connection authorization checks,
-	 * reasoning that (a) the leader checked these things when it started, and
-	 * (b) we do not want parallel mode to cause these failures, because that
-	 * would make use of parallel query plans not transparent to applications.
-	 */
-	BackgroundWorkerInitializeConnectionByOid(fps->database_id,
-											  fps->authenticated_user_id,
-											  BGWORKER_BYPASS_ALLOWCONN |
-											  BGWORKER_BYPASS_ROLELOGINCHECK);
+	if (first)
+	{
+		/*
+		 * Restore database connection.  We skip connection authorization
+		 * checks, reasoning that (a) the leader checked these things when it
+		 * started, and (b) we do not want parallel mode to cause these
+		 * failures, because that would make use of parallel query plans not
+		 * transparent to applications.
+		 */
+		BackgroundWorkerInitializeConnectionByOid(fps->database_id,
+												  fps->authenticated_user_id,
+												  BGWORKER_BYPASS_ALLOWCONN |
+												  BGWORKER_BYPASS_ROLELOGINCHECK);
 
-	/*
-	 * Set the client encoding to the database encoding, since that is what
-	 * the leader will expect.  (We're cheating a bit by not calling
-	 * PrepareClientEncoding first.  It's okay because this call will always
-	 * result in installing a no-op conversion.  No error should be possible,
-	 * but check anyway.)
-	 */
-	if (SetClientEncoding(GetDatabaseEncoding()) < 0)
-		elog(ERROR, "SetClientEncoding(%d) failed", GetDatabaseEncoding());
+		/*
+		 * Set the client encoding to the database encoding, since that is
+		 * what the leader will expect.  (We're cheating a bit by not calling
+		 * PrepareClientEncoding first.  It's okay because this call will
+		 * always result in installing a no-op conversion.  No error should
+		 * be possible, but check anyway.)
+		 */
+		if (SetClientEncoding(GetDatabaseEncoding()) < 0)
+			elog(ERROR, "SetClientEncoding(%d) failed", GetDatabaseEncoding());
+	}
+	Assert(MyDatabaseId == fps->database_id);
 
 	/*
 	 * Load libraries that were loaded by original backend.  We want to do
@@ -1541,7 +1793,13 @@ ParallelWorkerMain(Datum main_arg)
 										   false);
 	RestoreUncommittedEnums(uncommittedenumsspace);
 
-	/* Restore the ClientConnectionInfo. */
+	/* Restore the ClientConnectionInfo, forgetting the previous leader's. */
+	if (!first)
+	{
+		if (MyClientConnectionInfo.authn_id)
+			pfree(unconstify(char *, MyClientConnectionInfo.authn_id));
+		ResetSystemUser();
+	}
 	clientconninfospace = shm_toc_lookup(toc, PARALLEL_KEY_CLIENTCONNINFO,
 										 false);
 	RestoreClientConnectionInfo(clientconninfospace);
@@ -1583,6 +1841,8 @@ ParallelWorkerMain(Datum main_arg)
 
 	/* Report success. */
 	pq_putmessage(PqMsg_Terminate, NULL, 0);
+
+	return true;
 }
 
 /*
@@ -1620,11 +1880,16 @@ ParallelWorkerReportLastRecEnd(XLogRecPtr last_xlog_end)
 static void
 ParallelWorkerShutdown(int code, Datum arg)
 {
+	/* Nothing to do if we're an idle pooled worker */
+	if (ParallelWorkerSegment == NULL)
+		return;
+
 	SendProcSignal(ParallelLeaderPid,
 				   PROCSIG_PARALLEL_MESSAGE,
 				   ParallelLeaderProcNumber);
 
-	dsm_detach((dsm_segment *) DatumGetPointer(arg));
+	dsm_detach(ParallelWorkerSegment);
+	ParallelWorkerSegment = NULL;
 }
 
 /*
@@ -1670,3 +1935,419 @@ LookupParallelWorkerFunction(const char *libraryname, const char *funcname)
 	return (parallel_worker_main_type)
 		load_external_function(libraryname, funcname, true, NULL);
 }
+
+/*
+ * Report shared-memory space needed by ParallelWorkerPoolShmemInit.
+ */
+Size
+ParallelWorkerPoolShmemSize(void)
+{
+	return add_size(offsetof(ParallelPoolControl, slots),
+					mul_size(max_worker_processes, sizeof(ParallelPoolSlot)));
+}
+
+/*
+ * Allocate and initialize the parallel worker pool.
+ */
+void
+ParallelWorkerPoolShmemInit(void)
+{
+	bool		found;
+
+	ParallelPool = (ParallelPoolControl *)
+		ShmemInitStruct("Parallel Worker Pool", ParallelWorkerPoolShmemSize(),
+						&found);
+	if (!found)
+	{
+		memset(ParallelPool, 0, ParallelWorkerPoolShmemSize());
+		SpinLockInit(&ParallelPool->mutex);
+		for (int i = 0; i < max_worker_processes; i++)
+			ParallelPool->slots[i].state = PARALLEL_POOL_FREE;
+	}
+}
+
+/*
+ * Hand a task to an idle pooled worker, as worker number 'i' of the given
+ * parallel context.  Returns false if there's no suitable idle worker.
+ */
+static bool
+ParallelPoolClaimWorker(ParallelContext *pcxt, int i)
+{
+	Oid			userid = GetAuthenticatedUserId();
+	int			slotno = -1;
+	ProcNumber	procno = INVALID_PROC_NUMBER;
+	int			bgw_slot = 0;
+	uint64		bgw_generation = 0;
+
+	if (parallel_worker_pool_size <= 0)
+		return false;
+
+	SpinLockAcquire(&ParallelPool->mutex);
+	for (int n = 0; n < max_worker_processes; n++)
+	{
+		ParallelPoolSlot *slot = &ParallelPool->slots[n];
+
+		if (slot->state != PARALLEL_POOL_IDLE ||
+			slot->database_id != MyDatabaseId ||
+			slot->authenticated_user_id != userid)
+			continue;
+
+		slot->state = PARALLEL_POOL_ASSIGNED;
+		slot->generation++;
+		slot->leader_procno = MyProcNumber;
+		slot->seg_handle = dsm_segment_handle(pcxt->seg);
+		slot->worker_number = i;
+
+		slotno = n;
+		pcxt->worker[i].pool_generation = slot->generation;
+		procno = slot->procno;
+		bgw_slot = slot->bgw_slot;
+		bgw_generation = slot->bgw_generation;
+		break;
+	}
+	if (slotno >= 0)
+		ParallelPool->hits++;
+	else
+		ParallelPool->misses++;
+	SpinLockRelease(&ParallelPool->mutex);
+
+	if (slotno < 0)
+		return false;
+
+	pcxt->worker[i].pool_slot = slotno;
+	pcxt->worker[i].bgwhandle = MakeBackgroundWorkerHandle(bgw_slot,
+														   bgw_generation);
+	SetLatch(&GetPGProcByNumber(procno)->procLatch);
+
+	return true;
+}
+
+/*
+ * Reserve a pool slot for worker number 'i' of the given parallel context,
+ * which we're about to launch, so that it can join the pool once it's done.
+ * If pooling is disabled or there is no free slot, the worker won't be
+ * pooled, and pool_slot is left at -1.
+ */
+static void
+ParallelPoolReserveSlot(ParallelContext *pcxt, int i)
+{
+	if (parallel_worker_pool_size <= 0)
+		return;
+
+	SpinLockAcquire(&ParallelPool->mutex);
+	for (int n = 0; n < max_worker_processes; n++)
+	{
+		ParallelPoolSlot *slot = &ParallelPool->slots[n];
+
+		if (slot->state != PARALLEL_POOL_FREE)
+			continue;
+
+		slot->state = PARALLEL_POOL_ASSIGNED;
+		slot->generation++;
+		slot->database_id = MyDatabaseId;
+		slot->authenticated_user_id = GetAuthenticatedUserId();
+		slot->pid = 0;
+		slot->procno = INVALID_PROC_NUMBER;
+		slot->leader_procno = MyProcNumber;
+		slot->seg_handle = dsm_segment_handle(pcxt->seg);
+		slot->worker_number = i;
+
+		pcxt->worker[i].pool_slot = n;
+		pcxt->worker[i].pool_generation = slot->generation;
+		break;
+	}
+	SpinLockRelease(&ParallelPool->mutex);
+}
+
+/*
+ * Free a pool slot assigned by us, unless it has been reused already.
+ */
+static void
+ParallelPoolReleaseSlot(int slotno, uint64 generation)
+{
+	ParallelPoolSlot *slot = &ParallelPool->slots[slotno];
+
+	SpinLockAcquire(&ParallelPool->mutex);
+	if (slot->generation == generation)
+	{
+		slot->state = PARALLEL_POOL_FREE;
+		slot->pid = 0;
+	}
+	SpinLockRelease(&ParallelPool->mutex);
+}
+
+/*
+ * Wait for a pooled worker to complete the task we handed it and detach
+ * from everything of ours, and then let it be claimed by anyone.
+ */
+static void
+ParallelPoolWaitForWorker(ParallelWorkerInfo *worker)
+{
+	ParallelPoolSlot *slot = &ParallelPool->slots[worker->pool_slot];
+
+	for (;;)
+	{
+		bool		done = false;
+		pid_t		pid;
+
+		SpinLockAcquire(&ParallelPool->mutex);
+		if (slot->generation != worker->pool_generation ||
+			slot->state == PARALLEL_POOL_FREE)
+			done = true;
+		else if (slot->state == PARALLEL_POOL_DONE)
+		{
+			slot->state = PARALLEL_POOL_IDLE;
+			done = true;
+		}
+		SpinLockRelease(&ParallelPool->mutex);
+
+		if (done)
+			break;
+
+		/*
+		 * If the worker is gone without completing the task, or never
+		 * started, the slot is ours to free.
+		 */
+		if (GetBackgroundWorkerPid(worker->bgwhandle, &pid) == BGWH_STOPPED)
+		{
+			ParallelPoolReleaseSlot(worker->pool_slot, worker->pool_generation);
+			break;
+		}
+
+		/*
+		 * The worker sets our latch when it's done.  But only the leader
+		 * that launched the worker is told if it exits, so poll for that.
+		 */
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 100L, WAIT_EVENT_PARALLEL_WORKER_POOL_RELEASE);
+		ResetLatch(MyLatch);
+	}
+}
+
+/*
+ * Ask up to 'max_workers' idle pooled workers connected to the given database,
+ * or to any database if InvalidOid, to exit.
+ */
+static void
+ParallelPoolTerminateIdle(Oid dbid, int max_workers)
+{
+	pid_t	   *pids;
+	int			npids = 0;
+
+	if (max_workers <= 0)
+		return;
+
+	pids = palloc_array(pid_t, Min(max_workers, max_worker_processes));
+
+	SpinLockAcquire(&ParallelPool->mutex);
+	for (int n = 0; n < max_worker_processes && npids < max_workers; n++)
+	{
+		ParallelPoolSlot *slot = &ParallelPool->slots[n];
+
+		if (slot->state != PARALLEL_POOL_IDLE ||
+			(OidIsValid(dbid) && slot->database_id != dbid))
+			continue;
+
+		/* Take the worker out of the pool, so that nobody claims it */
+		pids[npids++] = slot->pid;
+		slot->state = PARALLEL_POOL_FREE;
+		slot->pid = 0;
+	}
+	SpinLockRelease(&ParallelPool->mutex);
+
+	for (int n = 0; n < npids; n++)
+		(void) kill(pids[n], SIGTERM);
+
+	pfree(pids);
+}
+
+/*
+ * ParallelWorkerPoolTerminate
+ *		Ask all idle pooled workers connected to the given database to exit.
+ */
+void
+ParallelWorkerPoolTerminate(Oid dbid)
+{
+	ParallelPoolTerminateIdle(dbid, max_worker_processes);
+}
+
+/*
+ * ParallelWorkerPoolGetStats
+ *		Report the number of pooled workers, and the pool's hits and misses.
+ *
+ * Workers that completed a task but haven't been noticed by their leader
+ * yet count as idle.
+ */
+void
+ParallelWorkerPoolGetStats(int *idle, int *active, uint64 *hits,
+						   uint64 *misses)
+{
+	*idle = 0;
+	*active = 0;
+
+	SpinLockAcquire(&ParallelPool->mutex);
+	for (int n = 0; n < max_worker_processes; n++)
+	{
+		ParallelPoolSlot *slot = &ParallelPool->slots[n];
+
+		if (slot->state == PARALLEL_POOL_IDLE ||
+			slot->state == PARALLEL_POOL_DONE)
+			(*idle)++;
+		else if (slot->state == PARALLEL_POOL_ASSIGNED)
+			(*active)++;
+	}
+	*hits = ParallelPool->hits;
+	*misses = ParallelPool->misses;
+	SpinLockRelease(&ParallelPool->mutex);
+}
+
+/*
+ * Take possession of the pool slot reserved for us by the leader that
+ * launched us.
+ */
+static void
+ParallelPoolWorkerStartup(int slotno, uint64 generation)
+{
+	ParallelPoolSlot *slot = &ParallelPool->slots[slotno];
+
+	SpinLockAcquire(&ParallelPool->mutex);
+	if (slot->generation == generation &&
+		slot->state == PARALLEL_POOL_ASSIGNED)
+	{
+		slot->pid = MyProcPid;
+		slot->procno = MyProcNumber;
+		MyParallelPoolSlot = slotno;
+		MyParallelPoolGeneration = generation;
+	}
+	SpinLockRelease(&ParallelPool->mutex);
+
+	if (MyParallelPoolSlot >= 0)
+		before_shmem_exit(ParallelPoolWorkerExit, (Datum) 0);
+}
+
+/*
+ * In a pooled worker that has completed its task, do the cleanup that
+ * exiting would do, return to the pool, and wait for another task.  Returns
+ * false if we should exit instead.
+ */
+static bool
+ParallelPoolWaitForTask(dsm_handle *handle, int *worker_number)
+{
+	ParallelPoolSlot *slot = &ParallelPool->slots[MyParallelPoolSlot];
+	ProcNumber	leader_procno = INVALID_PROC_NUMBER;
+	int			bgw_slot;
+	uint64		bgw_generation;
+	TimestampTz idle_since;
+
+	/*
+	 * Detaching from the segment also stops redirecting our messages to the
+	 * leader, and tells the leader that we've detached from our error queue.
+	 */
+	dsm_detach(ParallelWorkerSegment);
+	ParallelWorkerSegment = NULL;
+	MyFixedParallelState = NULL;
+	ParallelWorkerNumber = -1;
+	ParallelLeaderProcNumber = INVALID_PROC_NUMBER;
+
+	if (!LeaveLockGroup())
+		return false;
+
+	/* Send the statistics that we'd otherwise send at exit */
+	pgstat_report_stat(true);
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	if (!GetMyBackgroundWorkerSlot(&bgw_slot, &bgw_generation))
+		return false;
+
+	SpinLockAcquire(&ParallelPool->mutex);
+	if (slot->generation == MyParallelPoolGeneration &&
+		slot->state == PARALLEL_POOL_ASSIGNED)
+	{
+		int			nidle = 0;
+
+		for (int n = 0; n < max_worker_processes; n++)
+		{
+			if (ParallelPool->slots[n].state == PARALLEL_POOL_IDLE ||
+				ParallelPool->slots[n].state == PARALLEL_POOL_DONE)
+				nidle++;
+		}
+
+		if (nidle < parallel_worker_pool_size)
+		{
+			slot->state = PARALLEL_POOL_DONE;
+			slot->bgw_slot = bgw_slot;
+			slot->bgw_generation = bgw_generation;
+			leader_procno = slot->leader_procno;
+		}
+	}
+	SpinLockRelease(&ParallelPool->mutex);
+
+	/* If the pool is full, exit; the leader waits for that as usual */
+	if (leader_procno == INVALID_PROC_NUMBER)
+		return false;
+
+	SetLatch(&GetPGProcByNumber(leader_procno)->procLatch);
+
+	idle_since = GetCurrentTimestamp();
+	for (;;)
+	{
+		ParallelPoolSlotState state;
+		long		timeout;
+
+		timeout = PARALLEL_POOL_IDLE_TIMEOUT -
+			TimestampDifferenceMilliseconds(idle_since, GetCurrentTimestamp());
+
+		SpinLockAcquire(&ParallelPool->mutex);
+		state = slot->state;
+		if (state == PARALLEL_POOL_ASSIGNED)
+		{
+			MyParallelPoolGeneration = slot->generation;
+			*handle = slot->seg_handle;
+			*worker_number = slot->worker_number;
+		}
+		else if (state == PARALLEL_POOL_IDLE && timeout <= 0)
+		{
+			slot->state = PARALLEL_POOL_FREE;
+			slot->pid = 0;
+			state = PARALLEL_POOL_FREE;
+		}
+		SpinLockRelease(&ParallelPool->mutex);
+
+		if (state == PARALLEL_POOL_ASSIGNED)
+			return true;
+		if (state == PARALLEL_POOL_FREE)
+			return false;
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 Max(timeout, 1), WAIT_EVENT_PARALLEL_WORKER_POOL_IDLE);
+		ResetLatch(MyLatch);
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* Keep up with invalidations, so that we don't hold up others */
+		if (catchupInterruptPending)
+			ProcessCatchupInterrupt();
+	}
+}
+
+/*
+ * Free our pool slot at exit, unless we're in the middle of a task, in which
+ * case the leader frees it once it sees that we're gone.
+ */
+static void
+ParallelPoolWorkerExit(int code, Datum arg)
+{
+	ParallelPoolSlot *slot = &ParallelPool->slots[MyParallelPoolSlot];
+
+	SpinLockAcquire(&ParallelPool->mutex);
+	if (slot->pid == MyProcPid &&
+		(slot->state == PARALLEL_POOL_IDLE ||
+		 slot->state == PARALLEL_POOL_DONE))
+	{
+		slot->state = PARALLEL_POOL_FREE;
+		slot->pid = 0;
+	}
+	SpinLockRelease(&ParallelPool->mutex);
+}
@@ -68,6 +68,7 @@
 #include "access/xlogutils.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/pg_iovec.h"
 #include "storage/fd.h"
 #include "storage/shmem.h"
 #include "utils/guc.h"
@@ -131,6 +132,22 @@ typedef struct SlruWriteAllData
 
 typedef struct SlruWriteAllData *SlruWriteAll;
 
+/*
+ * During SimpleLruWriteAll(), when we write a dirty page we also pick up any
+ * dirty pages directly following it in the same segment, and write them all
+ * with a single vectored write.  This is the maximum number of pages written
+ * together.
+ */
+#define SLRU_MAX_WRITE_COMBINE	Min(16, PG_IOV_MAX)
+
+/*
+ * When SlruPhysicalReadPage() notices that a backend is reading consecutive
+ * pages of a segment, it asks the kernel to start reading this many of the
+ * following pages, so that the next misses don't each have to wait for a
+ * synchronous read.
+ */
+#define SLRU_READAHEAD_PAGES	8
+
 
 /*
  * Bank size for the slot array.  Pages are assigned a bank according to their
@@ -179,7 +196,9 @@ static void SimpleLruZeroLSNs(SlruCtl ctl, int slotno);
 static void SimpleLruWaitIO(SlruCtl ctl, int slotno);
 static void SlruInternalWritePage(SlruCtl ctl, int slotno, SlruWriteAll fdata);
 static bool SlruPhysicalReadPage(SlruCtl ctl, int64 pageno, int slotno);
-static bool SlruPhysicalWritePage(SlruCtl ctl, int64 pageno, int slotno,
+static int	SlruCombineFollowingPages(SlruCtl ctl, int64 pageno, int *slotnos);
+static bool SlruPhysicalWritePages(SlruCtl ctl, int64 pageno, int *slotnos,
+								   int nslots,
 								  SlruWriteAll fdata);
 static void SlruReportIOError(SlruCtl ctl, int64 pageno, TransactionId xid);
 static int	SlruSelectLRUPage(SlruCtl ctl, int64 pageno);
@@ -343,6 +362,8 @@ SimpleLruInit(SlruCtl ctl, const char *name, int nslots, int nlsns,
 	ctl->shared = shared;
 	ctl->sync_handler = sync_handler;
 	ctl->long_segment_names = long_segment_names;
+	ctl->last_read_pageno = -1;
+	ctl->readahead_pageno = -1;
 	ctl->nbanks = nbanks;
 	strlcpy(ctl->Dir, subdir, sizeof(ctl->Dir));
 }
@@ -679,6 +700,8 @@ SlruInternalWritePage(SlruCtl ctl, int slotno, SlruWriteAll fdata)
 	SlruShared	shared = ctl->shared;
 	int64		pageno = shared->page_number[slotno];
 	int			bankno = SlotGetBankNumber(slotno);
+	int			slotnos[SLRU_MAX_WRITE_COMBINE];
+	int			nslots = 1;
 	bool		ok;
 
 	Assert(shared->page_status[slotno] != SLRU_PAGE_EMPTY);
@@ -713,8 +736,16 @@ SlruInternalWritePage(SlruCtl ctl, int slotno, SlruWriteAll fdata)
 	/* Release bank lock while doing I/O */
 	LWLockRelease(&shared->bank_locks[bankno].lock);
 
+	/*
+	 * If part of a flush, write out any dirty pages following this one along
+	 * with it.
+	 */
+	slotnos[0] = slotno;
+	if (fdata)
+		nslots = SlruCombineFollowingPages(ctl, pageno, slotnos);
+
 	/* Do the write */
-	ok = SlruPhysicalWritePage(ctl, pageno, slotno, fdata);
+	ok = SlruPhysicalWritePages(ctl, pageno, slotnos, nslots, fdata);
 
 	/* If we failed, and we're in a flush, better close the files */
 	if (!ok && fdata)
@@ -723,6 +754,24 @@ SlruInternalWritePage(SlruCtl ctl, int slotno, SlruWriteAll fdata)
 			CloseTransientFile(fdata->fd[i]);
 	}
 
+	/* Update the state of the extra pages, if any */
+	for (int i = 1; i < nslots; i++)
+	{
+		int			extrabank = SlotGetBankNumber(slotnos[i]);
+
+		LWLockAcquire(&shared->bank_locks[extrabank].lock, LW_EXCLUSIVE);
+
+		Assert(shared->page_number[slotnos[i]] == pageno + i &&
+			   shared->page_status[slotnos[i]] == SLRU_PAGE_WRITE_IN_PROGRESS);
+
+		if (!ok)
+			shared->page_dirty[slotnos[i]] = true;
+		shared->page_status[slotnos[i]] = SLRU_PAGE_VALID;
+
+		LWLockRelease(&shared->buffer_locks[slotnos[i]].lock);
+		LWLockRelease(&shared->bank_locks[extrabank].lock);
+	}
+
 	/* Re-acquire bank lock and update page state */
 	LWLockAcquire(&shared->bank_locks[bankno].lock, LW_EXCLUSIVE);
 
@@ -741,12 +790,71 @@ SlruInternalWritePage(SlruCtl ctl, int slotno, SlruWriteAll fdata)
 	if (!ok)
 		SlruReportIOError(ctl, pageno, InvalidTransactionId);
 
-	/* If part of a checkpoint, count this as a SLRU buffer written. */
+	/* If part of a checkpoint, count these as SLRU buffers written. */
 	if (fdata)
 	{
-		CheckpointStats.ckpt_slru_written++;
-		PendingCheckpointerStats.slru_written++;
+		CheckpointStats.ckpt_slru_written += nslots;
+		PendingCheckpointerStats.slru_written += nslots;
+	}
+}
+
+/*
+ * Find dirty pages directly following the given page in the same segment,
+ * and mark them write-busy so that the caller can write them out together
+ * with it.  slotnos[0] must hold the slot of the given page, which the caller
+ * has already marked write-busy; the slots of the following pages are added
+ * after it.  Returns the total number of slots in slotnos[].
+ *
+ * No bank lock may be held at entry.  We take each page's bank lock in turn,
+ * never more than one at a time, and leave the per-buffer locks of the pages
+ * we return held, just like SlruInternalWritePage does for its own page.
+ */
+static int
+SlruCombineFollowingPages(SlruCtl ctl, int64 pageno, int *slotnos)
+{
+	SlruShared	shared = ctl->shared;
+	int			nslots = 1;
+
+	while (nslots < SLRU_MAX_WRITE_COMBINE)
+	{
+		int64		nextpage = pageno + nslots;
+		int			bankno = nextpage % ctl->nbanks;
+		int			bankstart = bankno * SLRU_BANK_SIZE;
+		int			bankend = bankstart + SLRU_BANK_SIZE;
+		int			found = -1;
+
+		/* Stop at the segment boundary */
+		if (nextpage % SLRU_PAGES_PER_SEGMENT == 0)
+			break;
+
+		LWLockAcquire(&shared->bank_locks[bankno].lock, LW_EXCLUSIVE);
+
+		for (int slotno = bankstart; slotno < bankend; slotno++)
+		{
+			if (shared->page_status[slotno] == SLRU_PAGE_VALID &&
+				shared->page_number[slotno] == nextpage)
+			{
+				if (shared->page_dirty[slotno])
+					found = slotno;
+				break;
+			}
+		}
+
+		if (found >= 0)
+		{
+			shared->page_status[found] = SLRU_PAGE_WRITE_IN_PROGRESS;
+			shared->page_dirty[found] = false;
+			LWLockAcquire(&shared->buffer_locks[found].lock, LW_EXCLUSIVE);
+		}
+
+		LWLockRelease(&shared->bank_locks[bankno].lock);
+
+		if (found < 0)
+			break;
+		slotnos[nslots++] = found;
 	}
+
+	return nslots;
 }
 
 /*
@@ -841,7 +949,7 @@ SlruPhysicalReadPage(SlruCtl ctl, int64 pageno, int slotno)
 	 * In a crash-and-restart situation, it's possible for us to receive
 	 * commands to set the commit status of transactions whose bits are in
 	 * already-truncated segments of the commit log (see notes in
-	 * SlruPhysicalWritePage).  Hence, if we are InRecovery, allow the case
+	 * SlruPhysicalWritePages).  Hence, if we are InRecovery, allow the case
 	 * where the file doesn't exist, and return zeroes instead.
 	 */
 	fd = OpenTransientFile(path, O_RDONLY | PG_BINARY);
@@ -861,6 +969,28 @@ SlruPhysicalReadPage(SlruCtl ctl, int64 pageno, int slotno)
 		return true;
 	}
 
+#if defined(USE_POSIX_FADVISE) && defined(POSIX_FADV_WILLNEED)
+
+	/*
+	 * If this backend is reading consecutive pages, ask the kernel to read
+	 * ahead the following pages of the segment.  We issue the advice once
+	 * per SLRU_READAHEAD_PAGES pages, when the reader gets to the end of the
+	 * previously advised range.  It's only a hint, so errors are ignored.
+	 */
+	if (pageno == ctl->last_read_pageno + 1 &&
+		pageno >= ctl->readahead_pageno &&
+		rpageno + 1 < SLRU_PAGES_PER_SEGMENT)
+	{
+		int			npages = Min(SLRU_READAHEAD_PAGES,
+								 SLRU_PAGES_PER_SEGMENT - rpageno - 1);
+
+		(void) posix_fadvise(fd, offset + BLCKSZ, (off_t) npages * BLCKSZ,
+							 POSIX_FADV_WILLNEED);
+		ctl->readahead_pageno = pageno + npages;
+	}
+#endif
+	ctl->last_read_pageno = pageno;
+
 	errno = 0;
 	pgstat_report_wait_start(WAIT_EVENT_SLRU_READ);
 	if (pg_pread(fd, shared->page_buffer[slotno], BLCKSZ, offset) != BLCKSZ)
@@ -884,7 +1014,10 @@ SlruPhysicalReadPage(SlruCtl ctl, int64 pageno, int slotno)
 }
 
 /*
- * Physical write of a page from a buffer slot
+ * Physical write of consecutive pages from buffer slots
+ *
+ * slotnos[] holds the slots of nslots pages, starting at pageno; they must
+ * all be in the same segment.  They are written with a single vectored write.
  *
  * On failure, we cannot just ereport(ERROR) since caller has put state in
  * shared memory that must be undone.  So, we return false and save enough
@@ -898,7 +1031,8 @@ SlruPhysicalReadPage(SlruCtl ctl, int64 pageno, int slotno)
  * SimpleLruWriteAll.
  */
 static bool
-SlruPhysicalWritePage(SlruCtl ctl, int64 pageno, int slotno, SlruWriteAll fdata)
+SlruPhysicalWritePages(SlruCtl ctl, int64 pageno, int *slotnos, int nslots,
+					   SlruWriteAll fdata)
 {
 	SlruShared	shared = ctl->shared;
 	int64		segno = pageno / SLRU_PAGES_PER_SEGMENT;
@@ -906,9 +1040,14 @@ SlruPhysicalWritePage(SlruCtl ctl, int64 pageno, int slotno, SlruWriteAll fdata)
 	off_t		offset = rpageno * BLCKSZ;
 	char		path[MAXPGPATH];
 	int			fd = -1;
+	struct iovec iov[SLRU_MAX_WRITE_COMBINE];
+
+	Assert(nslots >= 1 && nslots <= SLRU_MAX_WRITE_COMBINE);
+	Assert(rpageno + nslots <= SLRU_PAGES_PER_SEGMENT);
 
 	/* update the stats counter of written pages */
-	pgstat_count_slru_blocks_written(shared->slru_stats_idx);
+	for (int i = 0; i < nslots; i++)
+		pgstat_count_slru_blocks_written(shared->slru_stats_idx);
 
 	/*
 	 * Honor the write-WAL-before-data rule, if appropriate, so that we do not
@@ -918,23 +1057,25 @@ SlruPhysicalWritePage(SlruCtl ctl, int64 pageno, int slotno, SlruWriteAll fdata)
 	if (shared->group_lsn != NULL)
 	{
 		/*
-		 * We must determine the largest async-commit LSN for the page. This
+		 * We must determine the largest async-commit LSN for the pages. This
 		 * is a bit tedious, but since this entire function is a slow path
 		 * anyway, it seems better to do this here than to maintain a per-page
 		 * LSN variable (which'd need an extra comparison in the
 		 * transaction-commit path).
 		 */
-		XLogRecPtr	max_lsn;
-		int			lsnindex;
+		XLogRecPtr	max_lsn = InvalidXLogRecPtr;
 
-		lsnindex = slotno * shared->lsn_groups_per_page;
-		max_lsn = shared->group_lsn[lsnindex++];
-		for (int lsnoff = 1; lsnoff < shared->lsn_groups_per_page; lsnoff++)
+		for (int i = 0; i < nslots; i++)
 		{
-			XLogRecPtr	this_lsn = shared->group_lsn[lsnindex++];
+			int			lsnindex = slotnos[i] * shared->lsn_groups_per_page;
+
+			for (int lsnoff = 0; lsnoff < shared->lsn_groups_per_page; lsnoff++)
+			{
+				XLogRecPtr	this_lsn = shared->group_lsn[lsnindex++];
 
-			if (max_lsn < this_lsn)
-				max_lsn = this_lsn;
+				if (max_lsn < this_lsn)
+					max_lsn = this_lsn;
+			}
 		}
 
 		if (XLogRecPtrIsValid(max_lsn))
@@ -1013,9 +1154,15 @@ SlruPhysicalWritePage(SlruCtl ctl, int64 pageno, int slotno, SlruWriteAll fdata)
 		}
 	}
 
+	for (int i = 0; i < nslots; i++)
+	{
+		iov[i].iov_base = shared->page_buffer[slotnos[i]];
+		iov[i].iov_len = BLCKSZ;
+	}
+
 	errno = 0;
 	pgstat_report_wait_start(WAIT_EVENT_SLRU_WRITE);
-	if (pg_pwrite(fd, shared->page_buffer[slotno], BLCKSZ, offset) != BLCKSZ)
+	if (pg_pwritev(fd, iov, nslots, offset) != (ssize_t) nslots * BLCKSZ)
 	{
 		pgstat_report_wait_end();
 		/* if write didn't set errno, assume problem is no disk space */
@@ -1067,7 +1214,7 @@ SlruPhysicalWritePage(SlruCtl ctl, int64 pageno, int slotno, SlruWriteAll fdata)
 
 /*
  * Issue the error message after failure of SlruPhysicalReadPage or
- * SlruPhysicalWritePage.  Call this after cleaning up shared-memory state.
+ * SlruPhysicalWritePages.  Call this after cleaning up shared-memory state.
  */
 static void
 SlruReportIOError(SlruCtl ctl, int64 pageno, TransactionId xid)
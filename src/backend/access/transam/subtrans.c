@@ -31,8 +31,10 @@
 #include "access/slru.h"
 #include "access/subtrans.h"
 #include "access/transam.h"
+#include "access/xlog.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
+#include "pgstat.h"
 #include "utils/guc_hooks.h"
 #include "utils/snapmgr.h"
 
@@ -77,6 +79,37 @@ static SlruCtlData SubTransCtlData;
 static bool SubTransPagePrecedes(int64 page1, int64 page2);
 
 
+/*
+ * Backend-local cache of SubTransGetTopmostTransaction() results.
+ *
+ * Once a snapshot has overflowed, XidInMVCCSnapshot() must look up the
+ * topmost parent of every xid it is asked about that is not known to be
+ * finished, and with many concurrent subtransactions every backend keeps
+ * walking the same parent chains through the SLRU, contending for its bank
+ * locks.  Parent links never change while the xids are of interest, so we
+ * remember the results.  The cache is direct-mapped by xid.
+ *
+ * Only true topmost xids are cached: a result that stopped early because it
+ * reached TransactionXmin would be wrong for a later transaction with an
+ * older TransactionXmin.  To keep xids from wrapping around on us, all
+ * cached xids follow topmostCacheXmin, and the cache is reset before
+ * TransactionXmin gets too far ahead of it.  During recovery, parent links
+ * are set only when the corresponding WAL record is replayed, which can be
+ * after a lookup found none, so the cache is not used there.
+ */
+#define TOPMOST_CACHE_SIZE		1024
+#define TOPMOST_CACHE_MAX_AGE	((uint32) 1 << 30)
+
+typedef struct TopmostCacheEntry
+{
+	TransactionId xid;
+	TransactionId topmostXid;
+} TopmostCacheEntry;
+
+static TopmostCacheEntry topmostCache[TOPMOST_CACHE_SIZE];
+static TransactionId topmostCacheXmin = InvalidTransactionId;
+
+
 /*
  * Record the parent of a subtransaction in the subtrans log.
  */
@@ -163,16 +196,63 @@ SubTransGetTopmostTransaction(TransactionId xid)
 {
 	TransactionId parentXid = xid,
 				previousXid = xid;
+	TopmostCacheEntry *entry = NULL;
+	int64		curpageno = -1;
+	LWLock	   *lock = NULL;
+	TransactionId *page = NULL;
 
 	/* Can't ask about stuff that might not be around anymore */
 	Assert(TransactionIdFollowsOrEquals(xid, TransactionXmin));
 
+	if (TransactionIdIsNormal(xid) && TransactionIdIsNormal(TransactionXmin) &&
+		!RecoveryInProgress())
+	{
+		if (!TransactionIdIsValid(topmostCacheXmin) ||
+			TransactionIdPrecedes(TransactionXmin, topmostCacheXmin) ||
+			TransactionXmin - topmostCacheXmin > TOPMOST_CACHE_MAX_AGE)
+		{
+			memset(topmostCache, 0, sizeof(topmostCache));
+			topmostCacheXmin = TransactionXmin;
+		}
+
+		entry = &topmostCache[xid % TOPMOST_CACHE_SIZE];
+		if (entry->xid == xid)
+			return entry->topmostXid;
+	}
+
+	/*
+	 * Walk up the chain of parents.  A parent is usually on the same page as
+	 * its child, so rather than going through SubTransGetParent(), hold on to
+	 * the page until we need a different one.
+	 */
 	while (TransactionIdIsValid(parentXid))
 	{
+		int64		pageno;
+
 		previousXid = parentXid;
 		if (TransactionIdPrecedes(parentXid, TransactionXmin))
 			break;
-		parentXid = SubTransGetParent(parentXid);
+
+		/* Bootstrap and frozen XIDs have no parent */
+		if (!TransactionIdIsNormal(parentXid))
+			break;
+
+		pageno = TransactionIdToPage(parentXid);
+		if (pageno != curpageno)
+		{
+			int			slotno;
+
+			if (lock != NULL)
+				LWLockRelease(lock);
+
+			/* lock is acquired by SimpleLruReadPage_ReadOnly */
+			slotno = SimpleLruReadPage_ReadOnly(SubTransCtl, pageno, parentXid);
+			lock = SimpleLruGetBankLock(SubTransCtl, pageno);
+			page = (TransactionId *) SubTransCtl->shared->page_buffer[slotno];
+			curpageno = pageno;
+		}
+
+		parentXid = page[TransactionIdToEntry(parentXid)];
 
 		/*
 		 * By convention the parent xid gets allocated first, so should always
@@ -180,15 +260,39 @@ SubTransGetTopmostTransaction(TransactionId xid)
 		 * structure that could lead to an infinite loop, so exit.
 		 */
 		if (!TransactionIdPrecedes(parentXid, previousXid))
+		{
+			LWLockRelease(lock);
 			elog(ERROR, "pg_subtrans contains invalid entry: xid %u points to parent xid %u",
 				 previousXid, parentXid);
+		}
 	}
 
+	if (lock != NULL)
+		LWLockRelease(lock);
+
 	Assert(TransactionIdIsValid(previousXid));
 
+	/* Remember the result, if we got to the end of the chain */
+	if (entry != NULL && !TransactionIdIsValid(parentXid))
+	{
+		entry->xid = xid;
+		entry->topmostXid = previousXid;
+	}
+
 	return previousXid;
 }
 
+/*
+ * Count a snapshot that had to be taken with the subxid cache of some
+ * backend overflowed, which means that visibility checks using it have to
+ * consult pg_subtrans.  The count is reported in pg_stat_slru.
+ */
+void
+SubTransReportOverflowedSnapshot(void)
+{
+	pgstat_count_slru_overflowed_snapshot(SubTransCtl->shared->slru_stats_idx);
+}
+
 /*
  * Number of shared SUBTRANS buffers.
  *
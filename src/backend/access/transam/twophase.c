@@ -105,6 +105,7 @@
 #include "utils/builtins.h"
 #include "utils/injection_point.h"
 #include "utils/memutils.h"
+#include "utils/sharedplancache.h"
 #include "utils/timestamp.h"
 
 /*
@@ -112,8 +113,9 @@
  */
 #define TWOPHASE_DIR "pg_twophase"
 
-/* GUC variable, can't be changed after startup */
+/* GUC variables, can't be changed after startup */
 int			max_prepared_xacts = 0;
+int			twophase_state_cache_size = 0;	/* in kilobytes */
 
 /*
  * This struct describes one global transaction that is in prepared state
@@ -168,6 +170,16 @@ typedef struct GlobalTransactionData
 	bool		ondisk;			/* true if prepare state file is on disk */
 	bool		inredo;			/* true if entry was added via xlog_redo */
 	char		gid[GIDSIZE];	/* The GID assigned to the prepared xact */
+
+	/*
+	 * If twophase_state_cache_size is set, each GXACT has that much shared
+	 * memory to keep a copy of its state data, if it fits.  That saves
+	 * reading it back from WAL, or from the state file once a checkpoint has
+	 * moved it to disk, on COMMIT/ROLLBACK PREPARED.  state_len is zero if
+	 * the data is not there.
+	 */
+	char	   *state_data;		/* twophase_state_cache_size bytes */
+	uint32		state_len;		/* length of the copy, without CRC */
 } GlobalTransactionData;
 
 /*
@@ -223,6 +235,7 @@ static void ProcessRecords(char *bufptr, FullTransactionId fxid,
 static void RemoveGXact(GlobalTransaction gxact);
 
 static void XlogReadTwoPhaseData(XLogRecPtr lsn, char **buf, int *len);
+static char *ReadTwoPhaseData(GlobalTransaction gxact, int *len);
 static char *ProcessTwoPhaseBuffer(FullTransactionId fxid,
 								   XLogRecPtr prepare_start_lsn,
 								   bool fromdisk, bool setParent, bool setNextXid);
@@ -232,6 +245,15 @@ static void MarkAsPreparingGuts(GlobalTransaction gxact, FullTransactionId fxid,
 static void RemoveTwoPhaseFile(FullTransactionId fxid, bool giveWarning);
 static void RecreateTwoPhaseFile(FullTransactionId fxid, void *content, int len);
 
+/*
+ * Size of the shared memory kept for the state data of each GXACT
+ */
+static inline Size
+TwoPhaseStateCacheSlotSize(void)
+{
+	return MAXALIGN((Size) twophase_state_cache_size * 1024);
+}
+
 /*
  * Initialization of shared memory
  */
@@ -247,6 +269,9 @@ TwoPhaseShmemSize(void)
 	size = MAXALIGN(size);
 	size = add_size(size, mul_size(max_prepared_xacts,
 								   sizeof(GlobalTransactionData)));
+	size = MAXALIGN(size);
+	size = add_size(size, mul_size(max_prepared_xacts,
+								   TwoPhaseStateCacheSlotSize()));
 
 	return size;
 }
@@ -262,6 +287,7 @@ TwoPhaseShmemInit(void)
 	if (!IsUnderPostmaster)
 	{
 		GlobalTransaction gxacts;
+		char	   *state_data;
 		int			i;
 
 		Assert(!found);
@@ -275,6 +301,8 @@ TwoPhaseShmemInit(void)
 			((char *) TwoPhaseState +
 			 MAXALIGN(offsetof(TwoPhaseStateData, prepXacts) +
 					  sizeof(GlobalTransaction) * max_prepared_xacts));
+		state_data = (char *) gxacts +
+			MAXALIGN(sizeof(GlobalTransactionData) * max_prepared_xacts);
 		for (i = 0; i < max_prepared_xacts; i++)
 		{
 			/* insert into linked list */
@@ -283,6 +311,10 @@ TwoPhaseShmemInit(void)
 
 			/* associate it with a PGPROC assigned by InitProcGlobal */
 			gxacts[i].pgprocno = GetNumberFromPGProc(&PreparedXactProcs[i]);
+
+			/* and with its share of the state data cache */
+			gxacts[i].state_data = state_data + i * TwoPhaseStateCacheSlotSize();
+			gxacts[i].state_len = 0;
 		}
 	}
 	else
@@ -488,6 +520,7 @@ MarkAsPreparingGuts(GlobalTransaction gxact, FullTransactionId fxid,
 	gxact->locking_backend = MyProcNumber;
 	gxact->valid = false;
 	gxact->inredo = false;
+	gxact->state_len = 0;
 	strcpy(gxact->gid, gid);
 
 	/*
@@ -1176,6 +1209,23 @@ EndPrepare(GlobalTransaction gxact)
 				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
 				 errmsg("two-phase state file maximum length exceeded")));
 
+	/*
+	 * Keep a copy of the state data in shared memory if it fits, for COMMIT
+	 * or ROLLBACK PREPARED.  Nobody looks at it before the GXACT is marked
+	 * valid below.
+	 */
+	if (records.total_len <= (uint32) twophase_state_cache_size * 1024)
+	{
+		char	   *ptr = gxact->state_data;
+
+		for (record = records.head; record != NULL; record = record->next)
+		{
+			memcpy(ptr, record->data, record->len);
+			ptr += record->len;
+		}
+		gxact->state_len = records.total_len;
+	}
+
 	/*
 	 * Now writing 2PC state data to WAL. We let the WAL's CRC protection
 	 * cover us, so no need to calculate a separate CRC.
@@ -1459,6 +1509,42 @@ XlogReadTwoPhaseData(XLogRecPtr lsn, char **buf, int *len)
 	XLogReaderFree(xlogreader);
 }
 
+/*
+ * Reads the 2PC data of a GXACT: from the copy kept in shared memory if
+ * there is one, else from the state file if a checkpoint has moved it to
+ * disk, else from WAL.  The length of the data, not counting the CRC of a
+ * state file, is returned in *len if len isn't NULL.
+ *
+ * The caller must ensure that the GXACT doesn't go away meanwhile, either by
+ * holding TwoPhaseStateLock or by having locked the GXACT.
+ */
+static char *
+ReadTwoPhaseData(GlobalTransaction gxact, int *len)
+{
+	char	   *buf;
+
+	if (gxact->state_len > 0)
+	{
+		buf = palloc(gxact->state_len);
+		memcpy(buf, gxact->state_data, gxact->state_len);
+		if (len != NULL)
+			*len = gxact->state_len;
+	}
+	else if (gxact->ondisk)
+	{
+		buf = ReadTwoPhaseFile(gxact->fxid, false);
+		if (len != NULL)
+			*len = ((TwoPhaseFileHeader *) buf)->total_len - sizeof(pg_crc32c);
+	}
+	else
+	{
+		Assert(XLogRecPtrIsValid(gxact->prepare_start_lsn));
+		XlogReadTwoPhaseData(gxact->prepare_start_lsn, &buf, len);
+	}
+
+	return buf;
+}
+
 
 /*
  * Confirms an xid is prepared, during recovery
@@ -1524,14 +1610,12 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
 	xid = XidFromFullTransactionId(fxid);
 
 	/*
-	 * Read and validate 2PC state data. State data will typically be stored
-	 * in WAL files if the LSN is after the last checkpoint record, or moved
-	 * to disk if for some reason they have lived for a long time.
+	 * Read and validate 2PC state data. State data will typically be kept in
+	 * shared memory, or else stored in WAL files if the LSN is after the last
+	 * checkpoint record, or moved to disk if for some reason they have lived
+	 * for a long time.
 	 */
-	if (gxact->ondisk)
-		buf = ReadTwoPhaseFile(fxid, false);
-	else
-		XlogReadTwoPhaseData(gxact->prepare_start_lsn, &buf, NULL);
+	buf = ReadTwoPhaseData(gxact, NULL);
 
 
 	/*
@@ -1633,7 +1717,10 @@ FinishPreparedTransaction(const char *gid, bool isCommit)
 	{
 		if (hdr->initfileinval)
 			RelationCacheInitFilePreInvalidate();
+		SharedPlanCacheBeginInvalidation();
+		SharedPlanCacheInvalidate(invalmsgs, hdr->ninvalmsgs);
 		SendSharedInvalidMessages(invalmsgs, hdr->ninvalmsgs);
+		SharedPlanCacheEndInvalidation();
 		if (hdr->initfileinval)
 			RelationCacheInitFilePostInvalidate();
 	}
@@ -1861,7 +1948,7 @@ CheckPointTwoPhase(XLogRecPtr redo_horizon)
 			char	   *buf;
 			int			len;
 
-			XlogReadTwoPhaseData(gxact->prepare_start_lsn, &buf, &len);
+			buf = ReadTwoPhaseData(gxact, &len);
 			RecreateTwoPhaseFile(gxact->fxid, buf, len);
 			gxact->ondisk = true;
 			gxact->prepare_start_lsn = InvalidXLogRecPtr;
@@ -2591,6 +2678,16 @@ PrepareRedoAdd(FullTransactionId fxid, char *buf,
 	gxact->inredo = true;		/* yes, added in redo */
 	strcpy(gxact->gid, gid);
 
+	/* Keep a copy of the state data, as EndPrepare() does */
+	if (hdr->total_len - sizeof(pg_crc32c) <=
+		(uint32) twophase_state_cache_size * 1024)
+	{
+		gxact->state_len = hdr->total_len - sizeof(pg_crc32c);
+		memcpy(gxact->state_data, buf, gxact->state_len);
+	}
+	else
+		gxact->state_len = 0;
+
 	/* And insert it into the active array */
 	Assert(TwoPhaseState->numPrepXacts < max_prepared_xacts);
 	TwoPhaseState->prepXacts[TwoPhaseState->numPrepXacts++] = gxact;
@@ -2712,13 +2809,7 @@ LookupGXact(const char *gid, XLogRecPtr prepare_end_lsn,
 			 * do this optimization if we encounter many collisions in GID
 			 * between publisher and subscriber.
 			 */
-			if (gxact->ondisk)
-				buf = ReadTwoPhaseFile(gxact->fxid, false);
-			else
-			{
-				Assert(gxact->prepare_start_lsn);
-				XlogReadTwoPhaseData(gxact->prepare_start_lsn, &buf, NULL);
-			}
+			buf = ReadTwoPhaseData(gxact, NULL);
 
 			hdr = (TwoPhaseFileHeader *) buf;
 
@@ -2816,6 +2907,31 @@ LookupGXactBySubid(Oid subid)
 	return found;
 }
 
+/*
+ * LookupGXactsByGidPrefix
+ *		Return the GIDs of all prepared transactions whose GID starts with
+ *		the given prefix, palloc'd in the current memory context.
+ */
+List *
+LookupGXactsByGidPrefix(const char *prefix)
+{
+	List	   *result = NIL;
+	size_t		prefixlen = strlen(prefix);
+
+	LWLockAcquire(TwoPhaseStateLock, LW_SHARED);
+	for (int i = 0; i < TwoPhaseState->numPrepXacts; i++)
+	{
+		GlobalTransaction gxact = TwoPhaseState->prepXacts[i];
+
+		/* Ignore not-yet-valid GIDs. */
+		if (gxact->valid && strncmp(gxact->gid, prefix, prefixlen) == 0)
+			result = lappend(result, pstrdup(gxact->gid));
+	}
+	LWLockRelease(TwoPhaseStateLock);
+
+	return result;
+}
+
 /*
  * TwoPhaseGetOldestXidInCommit
  *		Return the oldest transaction ID from prepared transactions that are
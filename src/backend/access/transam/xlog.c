@@ -74,6 +74,7 @@
 #include "pg_trace.h"
 #include "pgstat.h"
 #include "port/atomics.h"
+#include "port/pg_iovec.h"
 #include "postmaster/bgwriter.h"
 #include "postmaster/startup.h"
 #include "postmaster/walsummarizer.h"
@@ -85,6 +86,7 @@
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
 #include "storage/bufmgr.h"
+#include "storage/doublewrite.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/large_object.h"
@@ -132,7 +134,7 @@ bool		wal_recycle = true;
 bool		log_checkpoints = true;
 int			wal_sync_method = DEFAULT_WAL_SYNC_METHOD;
 int			wal_level = WAL_LEVEL_REPLICA;
-int			CommitDelay = 0;	/* precommit delay in microseconds */
+int			CommitDelay = -1;	/* precommit delay in microseconds */
 int			CommitSiblings = 5; /* # concurrent xacts needed to sleep */
 int			wal_retrieve_retry_interval = 5000;
 int			max_slot_wal_keep_size_mb = -1;
@@ -469,6 +471,19 @@ typedef struct XLogCtlData
 	pg_time_t	lastSegSwitchTime;
 	XLogRecPtr	lastSegSwitchLSN;
 
+	/*
+	 * Measurements for choosing commit_delay automatically.  flushRequests
+	 * counts the calls to XLogFlush() that had to wait for a flush.  The
+	 * other fields are protected by WALWriteLock: flushArrivalRate is a
+	 * moving average of how many such calls arrive per microsecond, sampled
+	 * at lastFlushTime, and flushLatency of the microseconds a flush takes.
+	 */
+	pg_atomic_uint64 flushRequests;
+	uint64		lastFlushRequests;
+	instr_time	lastFlushTime;
+	double		flushArrivalRate;
+	double		flushLatency;
+
 	/* These are accessed using atomics -- info_lck not needed */
 	pg_atomic_uint64 logInsertResult;	/* last byte + 1 inserted to buffers */
 	pg_atomic_uint64 logWriteResult;	/* last byte + 1 written out */
@@ -674,10 +689,13 @@ static XLogRecPtr XLogGetReplicationSlotMinimumLSN(void);
 static void AdvanceXLInsertBuffer(XLogRecPtr upto, TimeLineID tli,
 								  bool opportunistic);
 static void XLogWrite(XLogwrtRqst WriteRqst, TimeLineID tli, bool flexible);
+static void XLogWriteSegmentDone(int fd, XLogSegNo segno, TimeLineID tli);
+static int	XLogFlushDelay(void);
 static bool InstallXLogFileSegment(XLogSegNo *segno, char *tmppath,
 								   bool find_free, XLogSegNo max_segno,
 								   TimeLineID tli);
 static void XLogFileClose(void);
+static void XLogFileCloseFd(int fd, XLogSegNo segno, TimeLineID tli);
 static void PreallocXlogFiles(XLogRecPtr endptr, TimeLineID tli);
 static void RemoveTempXlogFiles(void);
 static void RemoveOldXlogFiles(XLogSegNo segno, XLogRecPtr lastredoptr,
@@ -704,6 +722,9 @@ static void CopyXLogRecordToWAL(int write_len, bool isLogSwitch,
 								TimeLineID tli);
 static void ReserveXLogInsertLocation(int size, XLogRecPtr *StartPos,
 									  XLogRecPtr *EndPos, XLogRecPtr *PrevPtr);
+static void ReserveXLogInsertLocationGroup(uint64 size, uint64 *startbytepos,
+										   uint64 *endbytepos,
+										   uint64 *prevbytepos);
 static bool ReserveXLogSwitch(XLogRecPtr *StartPos, XLogRecPtr *EndPos,
 							  XLogRecPtr *PrevPtr);
 static XLogRecPtr WaitXLogInsertionsToFinish(XLogRecPtr upto);
@@ -1093,6 +1114,140 @@ XLogInsertRecord(XLogRecData *rdata,
 	return EndPos;
 }
 
+/*
+ * ReserveXLogInsertLocationGroup -- reserve WAL space as part of a group
+ *
+ * Helper for ReserveXLogInsertLocation(), used when insertpos_lck is found
+ * to be held.  Like ProcArrayGroupClearXid() and
+ * TransactionGroupUpdateXidStatus(), each backend adds itself to a list of
+ * pending requests, and the first one to do so becomes the leader.  The
+ * leader detaches the whole list, computes the layout of all the requests
+ * without holding the lock, and then advances CurrBytePos and PrevBytePos
+ * for the whole group in a single acquisition of insertpos_lck.
+ *
+ * The critical section is far too short for sleeping on a semaphore to pay
+ * off, so unlike the other group mechanisms the followers spin on a flag in
+ * their own PGPROC until the leader has filled in their reservation.  That
+ * still avoids all of them bouncing the cache line of the spinlock around.
+ *
+ * The results are returned as usable byte positions, like the values
+ * ReserveXLogInsertLocation() computes itself.
+ */
+static pg_noinline void
+ReserveXLogInsertLocationGroup(uint64 size, uint64 *startbytepos,
+							   uint64 *endbytepos, uint64 *prevbytepos)
+{
+	XLogCtlInsert *Insert = &XLogCtl->Insert;
+	PROC_HDR   *procglobal = ProcGlobal;
+	PGPROC	   *proc = MyProc;
+	uint32		nextidx;
+	uint32		groupidx;
+	uint64		groupsize;
+	uint64		lastoffset;
+	uint64		basebytepos;
+	uint64		prevpos;
+
+	proc->walGroupSize = size;
+	pg_atomic_write_u32(&proc->walGroupDone, 0);
+
+	/* Add ourselves to the list of processes needing WAL space. */
+	nextidx = pg_atomic_read_u32(&procglobal->walGroupFirst);
+	while (true)
+	{
+		pg_atomic_write_u32(&proc->walGroupNext, nextidx);
+
+		if (pg_atomic_compare_exchange_u32(&procglobal->walGroupFirst,
+										   &nextidx,
+										   (uint32) MyProcNumber))
+			break;
+	}
+
+	/*
+	 * If the list was not empty, the leader will reserve our space.  Wait
+	 * for it to do so.
+	 */
+	if (nextidx != INVALID_PROC_NUMBER)
+	{
+		SpinDelayStatus delayStatus;
+
+		init_local_spin_delay(&delayStatus);
+		while (pg_atomic_read_u32(&proc->walGroupDone) == 0)
+			perform_spin_delay(&delayStatus);
+		finish_spin_delay(&delayStatus);
+
+		/* ensure we see the leader's stores to our PGPROC */
+		pg_read_barrier();
+
+		Assert(pg_atomic_read_u32(&proc->walGroupNext) == INVALID_PROC_NUMBER);
+
+		*startbytepos = proc->walGroupStartPos;
+		*endbytepos = proc->walGroupStartPos + size;
+		*prevbytepos = proc->walGroupPrevPos;
+		return;
+	}
+
+	/*
+	 * We are the leader.  Detach the list of group members, so that newly
+	 * arriving processes form the next group, and lay the members' records
+	 * out one after the other.  walGroupStartPos holds the offset from the
+	 * start of the group for now.
+	 */
+	groupidx = pg_atomic_exchange_u32(&procglobal->walGroupFirst,
+									  INVALID_PROC_NUMBER);
+	groupsize = 0;
+	lastoffset = 0;
+	nextidx = groupidx;
+	while (nextidx != INVALID_PROC_NUMBER)
+	{
+		PGPROC	   *member = GetPGProcByNumber(nextidx);
+
+		member->walGroupStartPos = groupsize;
+		lastoffset = groupsize;
+		groupsize += member->walGroupSize;
+
+		nextidx = pg_atomic_read_u32(&member->walGroupNext);
+	}
+
+	/* Reserve the space for the whole group at once. */
+	SpinLockAcquire(&Insert->insertpos_lck);
+
+	basebytepos = Insert->CurrBytePos;
+	prevpos = Insert->PrevBytePos;
+	Insert->CurrBytePos = basebytepos + groupsize;
+	Insert->PrevBytePos = basebytepos + lastoffset;
+
+	SpinLockRelease(&Insert->insertpos_lck);
+
+	/*
+	 * Hand out the reservations.  Each record's prev-link points to the
+	 * record of the preceding member.  Once walGroupDone is set the member
+	 * may immediately start another reservation, so we must not touch its
+	 * PGPROC after that.
+	 */
+	nextidx = groupidx;
+	while (nextidx != INVALID_PROC_NUMBER)
+	{
+		PGPROC	   *member = GetPGProcByNumber(nextidx);
+
+		member->walGroupStartPos += basebytepos;
+		member->walGroupPrevPos = prevpos;
+		prevpos = member->walGroupStartPos;
+
+		nextidx = pg_atomic_read_u32(&member->walGroupNext);
+		pg_atomic_write_u32(&member->walGroupNext, INVALID_PROC_NUMBER);
+
+		if (member != proc)
+		{
+			pg_write_barrier();
+			pg_atomic_write_u32(&member->walGroupDone, 1);
+		}
+	}
+
+	*startbytepos = proc->walGroupStartPos;
+	*endbytepos = proc->walGroupStartPos + size;
+	*prevbytepos = proc->walGroupPrevPos;
+}
+
 /*
  * Reserves the right amount of space for a record of given size from the WAL.
  * *StartPos is set to the beginning of the reserved section, *EndPos to
@@ -1134,16 +1289,26 @@ ReserveXLogInsertLocation(int size, XLogRecPtr *StartPos, XLogRecPtr *EndPos,
 	 * positions (XLogRecPtrs) can be done outside the locked region, and
 	 * because the usable byte position doesn't include any headers, reserving
 	 * X bytes from WAL is almost as simple as "CurrBytePos += X".
+	 *
+	 * If the spinlock is currently held by somebody else, join a group of
+	 * backends that reserve their space together instead of queuing up on
+	 * it, see ReserveXLogInsertLocationGroup().
 	 */
-	SpinLockAcquire(&Insert->insertpos_lck);
+	if (likely(SpinLockFree(&Insert->insertpos_lck)) || MyProc == NULL)
+	{
+		SpinLockAcquire(&Insert->insertpos_lck);
 
-	startbytepos = Insert->CurrBytePos;
-	endbytepos = startbytepos + size;
-	prevbytepos = Insert->PrevBytePos;
-	Insert->CurrBytePos = endbytepos;
-	Insert->PrevBytePos = startbytepos;
+		startbytepos = Insert->CurrBytePos;
+		endbytepos = startbytepos + size;
+		prevbytepos = Insert->PrevBytePos;
+		Insert->CurrBytePos = endbytepos;
+		Insert->PrevBytePos = startbytepos;
 
-	SpinLockRelease(&Insert->insertpos_lck);
+		SpinLockRelease(&Insert->insertpos_lck);
+	}
+	else
+		ReserveXLogInsertLocationGroup(size, &startbytepos, &endbytepos,
+									   &prevbytepos);
 
 	*StartPos = XLogBytePosToRecPtr(startbytepos);
 	*EndPos = XLogBytePosToEndRecPtr(endbytepos);
@@ -2292,6 +2457,91 @@ XLogCheckpointNeeded(XLogSegNo new_segno)
 	return false;
 }
 
+/*
+ * fsync a WAL segment that XLogWrite() has written completely.
+ *
+ * This is also the right place to notify the Archiver that the segment is
+ * ready to copy to archival storage, and to update the timer for
+ * archive_timeout, and to signal for a checkpoint if too many logfile
+ * segments have been used since the last checkpoint.
+ */
+static void
+XLogWriteSegmentDone(int fd, XLogSegNo segno, TimeLineID tli)
+{
+	issue_xlog_fsync(fd, segno, tli);
+
+	/* signal that we need to wakeup walsenders later */
+	WalSndWakeupRequest();
+
+	/* end of segment */
+	XLogSegNoOffsetToRecPtr(segno + 1, 0, wal_segment_size, LogwrtResult.Flush);
+
+	if (XLogArchivingActive())
+		XLogArchiveNotifySeg(segno, tli);
+
+	XLogCtl->lastSegSwitchTime = (pg_time_t) time(NULL);
+	XLogCtl->lastSegSwitchLSN = LogwrtResult.Flush;
+
+	/*
+	 * Request a checkpoint if we've consumed too much xlog since the last
+	 * one.  For speed, we first check using the local copy of RedoRecPtr,
+	 * which might be out of date; if it looks like a checkpoint is needed,
+	 * forcibly update RedoRecPtr and recheck.
+	 */
+	if (IsUnderPostmaster && XLogCheckpointNeeded(segno))
+	{
+		(void) GetRedoRecPtr();
+		if (XLogCheckpointNeeded(segno))
+			RequestCheckpoint(CHECKPOINT_CAUSE_XLOG);
+	}
+}
+
+/*
+ * Choose how long the flush leader should wait for more committers to join
+ * the group, in microseconds, when commit_delay is set to -1.
+ *
+ * We wait for at most half the time a flush has recently taken, and only if
+ * the recent rate of flush requests makes it likely that at least one more
+ * backend asks for a flush meanwhile.  At low load, that never happens, so
+ * no one waits.  Must be called with WALWriteLock held.
+ */
+#define MAX_COMMIT_DELAY	100000	/* the maximum of commit_delay */
+
+static int
+XLogFlushDelay(void)
+{
+	instr_time	now;
+	uint64		requests;
+	double		delay;
+
+	INSTR_TIME_SET_CURRENT(now);
+	requests = pg_atomic_read_u64(&XLogCtl->flushRequests);
+
+	if (!INSTR_TIME_IS_ZERO(XLogCtl->lastFlushTime))
+	{
+		instr_time	elapsed = now;
+		double		elapsed_us;
+
+		INSTR_TIME_SUBTRACT(elapsed, XLogCtl->lastFlushTime);
+		elapsed_us = INSTR_TIME_GET_MICROSEC(elapsed);
+		if (elapsed_us > 0)
+		{
+			double		rate;
+
+			rate = (requests - XLogCtl->lastFlushRequests) / elapsed_us;
+			XLogCtl->flushArrivalRate += (rate - XLogCtl->flushArrivalRate) / 8;
+		}
+	}
+	XLogCtl->lastFlushTime = now;
+	XLogCtl->lastFlushRequests = requests;
+
+	delay = Min(XLogCtl->flushLatency / 2, MAX_COMMIT_DELAY);
+	if (XLogCtl->flushArrivalRate * delay < 1.0)
+		return 0;
+
+	return (int) delay;
+}
+
 /*
  * Write and/or fsync the log at least as far as WriteRqst indicates.
  *
@@ -2312,8 +2562,11 @@ XLogWrite(XLogwrtRqst WriteRqst, TimeLineID tli, bool flexible)
 	bool		finishing_seg;
 	int			curridx;
 	int			npages;
+	int			nfirst;
 	int			startidx;
 	uint32		startoffset;
+	int			syncFile = -1;
+	XLogSegNo	syncSegNo = 0;
 
 	/* We should always be inside a critical section here */
 	Assert(CritSectionCount > 0);
@@ -2326,13 +2579,16 @@ XLogWrite(XLogwrtRqst WriteRqst, TimeLineID tli, bool flexible)
 	/*
 	 * Since successive pages in the xlog cache are consecutively allocated,
 	 * we can usually gather multiple pages together and issue just one
-	 * write() call.  npages is the number of pages we have determined can be
-	 * written together; startidx is the cache block index of the first one,
-	 * and startoffset is the file offset at which it should go. The latter
-	 * two variables are only valid when npages > 0, but we must initialize
-	 * all of them to keep the compiler quiet.
+	 * write() call, even if the pages wrap around the end of the cache.
+	 * npages is the number of pages we have determined can be written
+	 * together; startidx is the cache block index of the first one, and
+	 * startoffset is the file offset at which it should go.  nfirst is the
+	 * number of pages before the end of the cache, if the set wraps around,
+	 * else zero.  The latter three variables are only valid when npages > 0,
+	 * but we must initialize all of them to keep the compiler quiet.
 	 */
 	npages = 0;
+	nfirst = 0;
 	startidx = 0;
 	startoffset = 0;
 
@@ -2366,7 +2622,9 @@ XLogWrite(XLogwrtRqst WriteRqst, TimeLineID tli, bool flexible)
 		{
 			/*
 			 * Switch to new logfile segment.  We cannot have any pending
-			 * pages here (since we dump what we have at segment end).
+			 * pages here (since we dump what we have at segment end).  The
+			 * previous segment might still be open for a deferred fsync, in
+			 * which case openLogFile has already been reset.
 			 */
 			Assert(npages == 0);
 			if (openLogFile >= 0)
@@ -2397,34 +2655,48 @@ XLogWrite(XLogwrtRqst WriteRqst, TimeLineID tli, bool flexible)
 			startidx = curridx;
 			startoffset = XLogSegmentOffset(LogwrtResult.Write - XLOG_BLCKSZ,
 											wal_segment_size);
+			nfirst = 0;
 		}
 		npages++;
 
 		/*
 		 * Dump the set if this will be the last loop iteration, or if we are
-		 * at the last page of the cache area (since the next page won't be
-		 * contiguous in memory), or if we are at the end of the logfile
-		 * segment.
+		 * at the end of the logfile segment.  If we are at the last page of
+		 * the cache area, the next page won't be contiguous in memory, but we
+		 * can still write them together with a vectored write.
 		 */
 		last_iteration = WriteRqst.Write <= LogwrtResult.Write;
 
 		finishing_seg = !ispartialpage &&
 			(startoffset + npages * XLOG_BLCKSZ) >= wal_segment_size;
 
-		if (last_iteration ||
-			curridx == XLogCtl->XLogCacheBlck ||
-			finishing_seg)
+		if (!last_iteration && !finishing_seg &&
+			curridx == XLogCtl->XLogCacheBlck)
+			nfirst = npages;
+
+		if (last_iteration || finishing_seg)
 		{
-			char	   *from;
-			Size		nbytes;
+			struct iovec iov[2];
+			int			iovcnt;
 			Size		nleft;
 			ssize_t		written;
 			instr_time	start;
 
 			/* OK to write the page(s) */
-			from = XLogCtl->pages + startidx * (Size) XLOG_BLCKSZ;
-			nbytes = npages * (Size) XLOG_BLCKSZ;
-			nleft = nbytes;
+			iov[0].iov_base = XLogCtl->pages + startidx * (Size) XLOG_BLCKSZ;
+			if (nfirst > 0)
+			{
+				iov[0].iov_len = nfirst * (Size) XLOG_BLCKSZ;
+				iov[1].iov_base = XLogCtl->pages;
+				iov[1].iov_len = (npages - nfirst) * (Size) XLOG_BLCKSZ;
+				iovcnt = 2;
+			}
+			else
+			{
+				iov[0].iov_len = npages * (Size) XLOG_BLCKSZ;
+				iovcnt = 1;
+			}
+			nleft = npages * (Size) XLOG_BLCKSZ;
 			do
 			{
 				errno = 0;
@@ -2435,7 +2707,7 @@ XLogWrite(XLogwrtRqst WriteRqst, TimeLineID tli, bool flexible)
 				start = pgstat_prepare_io_time(track_wal_io_timing);
 
 				pgstat_report_wait_start(WAIT_EVENT_WAL_WRITE);
-				written = pg_pwrite(openLogFile, from, nleft, startoffset);
+				written = pg_pwritev(openLogFile, iov, iovcnt, startoffset);
 				pgstat_report_wait_end();
 
 				pgstat_count_io_op_time(IOOBJECT_WAL, IOCONTEXT_NORMAL,
@@ -2459,12 +2731,21 @@ XLogWrite(XLogwrtRqst WriteRqst, TimeLineID tli, bool flexible)
 									xlogfname, startoffset, nleft)));
 				}
 				nleft -= written;
-				from += written;
 				startoffset += written;
+				if (nleft > 0)
+					iovcnt = compute_remaining_iovec(iov, iov, iovcnt, written);
 			} while (nleft > 0);
 
 			npages = 0;
 
+			/* Finish the fsync of the previous segment, if we put it off */
+			if (syncFile >= 0)
+			{
+				XLogWriteSegmentDone(syncFile, syncSegNo, tli);
+				XLogFileCloseFd(syncFile, syncSegNo, tli);
+				syncFile = -1;
+			}
+
 			/*
 			 * If we just wrote the whole last page of a logfile segment,
 			 * fsync the segment immediately.  This avoids having to go back
@@ -2472,40 +2753,26 @@ XLogWrite(XLogwrtRqst WriteRqst, TimeLineID tli, bool flexible)
 			 * later. Doing it here ensures that one and only one backend will
 			 * perform this fsync.
 			 *
-			 * This is also the right place to notify the Archiver that the
-			 * segment is ready to copy to archival storage, and to update the
-			 * timer for archive_timeout, and to signal for a checkpoint if
-			 * too many logfile segments have been used since the last
-			 * checkpoint.
+			 * However, if we are going to write into the next segment right
+			 * away, only start writeback of this one, and fsync it after
+			 * writing the next pages.  That way, the storage can work on
+			 * both at once, rather than us waiting for each in turn.
 			 */
 			if (finishing_seg)
 			{
-				issue_xlog_fsync(openLogFile, openLogSegNo, tli);
-
-				/* signal that we need to wakeup walsenders later */
-				WalSndWakeupRequest();
-
-				LogwrtResult.Flush = LogwrtResult.Write;	/* end of page */
-
-				if (XLogArchivingActive())
-					XLogArchiveNotifySeg(openLogSegNo, tli);
-
-				XLogCtl->lastSegSwitchTime = (pg_time_t) time(NULL);
-				XLogCtl->lastSegSwitchLSN = LogwrtResult.Flush;
-
-				/*
-				 * Request a checkpoint if we've consumed too much xlog since
-				 * the last one.  For speed, we first check using the local
-				 * copy of RedoRecPtr, which might be out of date; if it looks
-				 * like a checkpoint is needed, forcibly update RedoRecPtr and
-				 * recheck.
-				 */
-				if (IsUnderPostmaster && XLogCheckpointNeeded(openLogSegNo))
+#ifdef HAVE_SYNC_FILE_RANGE
+				if (!last_iteration && !flexible && enableFsync &&
+					wal_sync_method != WAL_SYNC_METHOD_OPEN &&
+					wal_sync_method != WAL_SYNC_METHOD_OPEN_DSYNC)
 				{
-					(void) GetRedoRecPtr();
-					if (XLogCheckpointNeeded(openLogSegNo))
-						RequestCheckpoint(CHECKPOINT_CAUSE_XLOG);
+					pg_flush_data(openLogFile, 0, wal_segment_size);
+					syncFile = openLogFile;
+					syncSegNo = openLogSegNo;
+					openLogFile = -1;
 				}
+				else
+#endif
+					XLogWriteSegmentDone(openLogFile, openLogSegNo, tli);
 			}
 		}
 
@@ -2523,6 +2790,7 @@ XLogWrite(XLogwrtRqst WriteRqst, TimeLineID tli, bool flexible)
 	}
 
 	Assert(npages == 0);
+	Assert(syncFile < 0);
 
 	/*
 	 * If asked to flush, do so
@@ -2814,6 +3082,10 @@ XLogFlush(XLogRecPtr record)
 
 	START_CRIT_SECTION();
 
+	/* Count the arrival, for choosing commit_delay automatically */
+	if (CommitDelay < 0)
+		pg_atomic_fetch_add_u64(&XLogCtl->flushRequests, 1);
+
 	/*
 	 * Since fsync is usually a horribly expensive operation, we try to
 	 * piggyback as much data as we can on each fsync: if we see any more data
@@ -2832,6 +3104,8 @@ XLogFlush(XLogRecPtr record)
 	for (;;)
 	{
 		XLogRecPtr	insertpos;
+		int			delay;
+		instr_time	start;
 
 		/* done already? */
 		RefreshXLogWriteResult(LogwrtResult);
@@ -2881,13 +3155,30 @@ XLogFlush(XLogRecPtr record)
 		 *
 		 * We do not sleep if enableFsync is not turned on, nor if there are
 		 * fewer than CommitSiblings other backends with active transactions.
+		 * If commit_delay is chosen automatically, XLogFlushDelay() decides.
 		 */
-		if (CommitDelay > 0 && enableFsync &&
-			MinimumActiveBackends(CommitSiblings))
+		delay = 0;
+		if (CommitDelay < 0)
 		{
+			if (enableFsync)
+				delay = XLogFlushDelay();
+		}
+		else if (CommitDelay > 0 && enableFsync &&
+				 MinimumActiveBackends(CommitSiblings))
+			delay = CommitDelay;
+
+		if (delay > 0)
+		{
+			instr_time	duration;
+
+			INSTR_TIME_SET_CURRENT(start);
 			pgstat_report_wait_start(WAIT_EVENT_COMMIT_DELAY);
-			pg_usleep(CommitDelay);
+			pg_usleep(delay);
 			pgstat_report_wait_end();
+			INSTR_TIME_SET_CURRENT(duration);
+			INSTR_TIME_SUBTRACT(duration, start);
+			pgWalUsage.commit_delays++;
+			pgWalUsage.commit_delay_time += INSTR_TIME_GET_MICROSEC(duration);
 
 			/*
 			 * Re-check how far we can now flush the WAL. It's generally not
@@ -2906,7 +3197,19 @@ XLogFlush(XLogRecPtr record)
 		WriteRqst.Write = insertpos;
 		WriteRqst.Flush = insertpos;
 
-		XLogWrite(WriteRqst, insertTLI, false);
+		if (CommitDelay < 0)
+		{
+			instr_time	duration;
+
+			INSTR_TIME_SET_CURRENT(start);
+			XLogWrite(WriteRqst, insertTLI, false);
+			INSTR_TIME_SET_CURRENT(duration);
+			INSTR_TIME_SUBTRACT(duration, start);
+			XLogCtl->flushLatency +=
+				(INSTR_TIME_GET_MICROSEC(duration) - XLogCtl->flushLatency) / 8;
+		}
+		else
+			XLogWrite(WriteRqst, insertTLI, false);
 
 		LWLockRelease(WALWriteLock);
 		/* done */
@@ -3662,6 +3965,16 @@ XLogFileClose(void)
 {
 	Assert(openLogFile >= 0);
 
+	XLogFileCloseFd(openLogFile, openLogSegNo, openLogTLI);
+	openLogFile = -1;
+}
+
+/*
+ * Close a WAL segment file that isn't, or is no longer, openLogFile.
+ */
+static void
+XLogFileCloseFd(int fd, XLogSegNo segno, TimeLineID tli)
+{
 	/*
 	 * WAL segment files will not be re-read in normal operation, so we advise
 	 * the OS to release any cached pages.  But do not do so if WAL archiving
@@ -3670,22 +3983,21 @@ XLogFileClose(void)
 	 */
 #if defined(USE_POSIX_FADVISE) && defined(POSIX_FADV_DONTNEED)
 	if (!XLogIsNeeded() && (io_direct_flags & IO_DIRECT_WAL) == 0)
-		(void) posix_fadvise(openLogFile, 0, 0, POSIX_FADV_DONTNEED);
+		(void) posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
 #endif
 
-	if (close(openLogFile) != 0)
+	if (close(fd) != 0)
 	{
 		char		xlogfname[MAXFNAMELEN];
 		int			save_errno = errno;
 
-		XLogFileName(xlogfname, openLogTLI, openLogSegNo, wal_segment_size);
+		XLogFileName(xlogfname, tli, segno, wal_segment_size);
 		errno = save_errno;
 		ereport(PANIC,
 				(errcode_for_file_access(),
 				 errmsg("could not close file \"%s\": %m", xlogfname)));
 	}
 
-	openLogFile = -1;
 	ReleaseExternalFD();
 }
 
@@ -5101,6 +5413,7 @@ XLOGShmemInit(void)
 	pg_atomic_init_u64(&XLogCtl->logWriteResult, InvalidXLogRecPtr);
 	pg_atomic_init_u64(&XLogCtl->logFlushResult, InvalidXLogRecPtr);
 	pg_atomic_init_u64(&XLogCtl->unloggedLSN, InvalidXLogRecPtr);
+	pg_atomic_init_u64(&XLogCtl->flushRequests, 0);
 }
 
 /*
@@ -5846,6 +6159,13 @@ StartupXLOG(void)
 		/* Check that the GUCs used to generate the WAL allow recovery */
 		CheckRequiredParameterValues();
 
+		/*
+		 * Repair pages that were torn by the crash, from the copies that
+		 * were written to the double-write buffer first.  This must be done
+		 * before replay reads any of them.
+		 */
+		DoubleWriteRecover(checkPoint.redo);
+
 		/*
 		 * We're in recovery, so unlogged relations may be trashed and must be
 		 * reset.  This should be done BEFORE allowing Hot Standby
@@ -8742,7 +9062,7 @@ xlog_redo(XLogReaderState *record)
 
 /*
  * Return the extra open flags used for opening a file, depending on the
- * value of the GUCs wal_sync_method, fsync and debug_io_direct.
+ * value of the GUCs wal_sync_method, fsync and io_direct.
  */
 static int
 get_sync_bit(int method)
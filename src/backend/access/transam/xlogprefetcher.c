@@ -18,6 +18,12 @@
  * recorded in the decoded record so that XLogReadBufferForRedo() can try to
  * avoid a second buffer mapping table lookup.
  *
+ * When asynchronous I/O is performed by other processes (io_method is not
+ * "sync"), blocks are read into shared buffers straight away, so that the
+ * reads needed by many upcoming records are carried out in parallel while
+ * the startup process replays.  Otherwise we only advise the kernel about
+ * them.
+ *
  * Currently, only the main fork is considered for prefetching.  Currently,
  * prefetching is only effective on systems where PrefetchBuffer() does
  * something useful (mainly Linux).
@@ -27,14 +33,17 @@
 
 #include "postgres.h"
 
+#include "access/xact.h"
 #include "access/xlogprefetcher.h"
 #include "access/xlogreader.h"
+#include "catalog/pg_class.h"
 #include "catalog/pg_control.h"
 #include "catalog/storage_xlog.h"
 #include "commands/dbcommands_xlog.h"
 #include "funcapi.h"
 #include "miscadmin.h"
 #include "port/atomics.h"
+#include "storage/aio.h"
 #include "storage/bufmgr.h"
 #include "storage/shmem.h"
 #include "storage/smgr.h"
@@ -72,7 +81,11 @@ int			recovery_prefetch = RECOVERY_PREFETCH_TRY;
 		(recovery_prefetch != RECOVERY_PREFETCH_OFF && \
 		 maintenance_io_concurrency > 0)
 #else
-#define RecoveryPrefetchEnabled() false
+/* Without read-ahead advice, we can still read with asynchronous I/O */
+#define RecoveryPrefetchEnabled() \
+		(recovery_prefetch != RECOVERY_PREFETCH_OFF && \
+		 maintenance_io_concurrency > 0 && \
+		 io_method != IOMETHOD_SYNC)
 #endif
 
 static int	XLogPrefetchReconfigureCount = 0;
@@ -87,12 +100,29 @@ typedef enum
 	LRQ_NEXT_AGAIN,
 } LsnReadQueueNextStatus;
 
+/*
+ * A block reference tracked by LsnReadQueue.  If we started reading the
+ * block into shared buffers, we hold a pin on it until the record is about
+ * to be replayed.  The block's identity is remembered if we hold a pin, or
+ * if the record overwrites the whole page.
+ */
+typedef struct LsnReadQueueEntry
+{
+	bool		io;
+	XLogRecPtr	lsn;
+	Buffer		buffer;
+	bool		overwrites;
+	RelFileLocator rlocator;
+	BlockNumber blkno;
+	ReadBuffersOperation op;
+} LsnReadQueueEntry;
+
 /*
  * Type of callback that can decide which block to prefetch next.  For now
  * there is only one.
  */
 typedef LsnReadQueueNextStatus (*LsnReadQueueNextFun) (uintptr_t lrq_private,
-													   XLogRecPtr *lsn);
+													   LsnReadQueueEntry *entry);
 
 /*
  * A simple circular queue of LSNs, using to control the number of
@@ -107,14 +137,11 @@ typedef struct LsnReadQueue
 	uint32		max_inflight;
 	uint32		inflight;
 	uint32		completed;
+	uint32		pinned;
 	uint32		head;
 	uint32		tail;
 	uint32		size;
-	struct
-	{
-		bool		io;
-		XLogRecPtr	lsn;
-	}			queue[FLEXIBLE_ARRAY_MEMBER];
+	LsnReadQueueEntry queue[FLEXIBLE_ARRAY_MEMBER];
 } LsnReadQueue;
 
 /*
@@ -194,7 +221,7 @@ static inline bool XLogPrefetcherIsFiltered(XLogPrefetcher *prefetcher,
 static inline void XLogPrefetcherCompleteFilters(XLogPrefetcher *prefetcher,
 												 XLogRecPtr replaying_lsn);
 static LsnReadQueueNextStatus XLogPrefetcherNextBlock(uintptr_t pgsr_private,
-													  XLogRecPtr *lsn);
+													  LsnReadQueueEntry *entry);
 
 static XLogPrefetchStats *SharedStats;
 
@@ -219,16 +246,66 @@ lrq_alloc(uint32 max_distance,
 	lrq->tail = 0;
 	lrq->inflight = 0;
 	lrq->completed = 0;
+	lrq->pinned = 0;
 
 	return lrq;
 }
 
+/*
+ * Wait for the read of a block to finish, and give up our pin on it.
+ */
+static inline void
+lrq_release(LsnReadQueue *lrq, LsnReadQueueEntry *entry)
+{
+	Assert(BufferIsValid(entry->buffer));
+	Assert(lrq->pinned > 0);
+
+	WaitReadBuffers(&entry->op);
+	ReleaseBuffer(entry->buffer);
+	entry->buffer = InvalidBuffer;
+	lrq->pinned--;
+}
+
+static inline void
+lrq_release_all(LsnReadQueue *lrq)
+{
+	for (uint32 i = lrq->tail; lrq->pinned > 0 && i != lrq->head;
+		 i = (i + 1) % lrq->size)
+	{
+		if (BufferIsValid(lrq->queue[i].buffer))
+			lrq_release(lrq, &lrq->queue[i]);
+	}
+}
+
 static inline void
 lrq_free(LsnReadQueue *lrq)
 {
+	lrq_release_all(lrq);
 	pfree(lrq);
 }
 
+/*
+ * Find the latest block reference still waiting to be replayed that we hold
+ * a pin for, or that overwrites the page, for the given block.
+ */
+static inline LsnReadQueueEntry *
+lrq_find_block(LsnReadQueue *lrq, RelFileLocator rlocator, BlockNumber blkno)
+{
+	for (uint32 i = lrq->head; i != lrq->tail;)
+	{
+		LsnReadQueueEntry *entry;
+
+		i = (i == 0 ? lrq->size : i) - 1;
+		entry = &lrq->queue[i];
+		if ((entry->overwrites || BufferIsValid(entry->buffer)) &&
+			entry->blkno == blkno &&
+			RelFileLocatorEquals(entry->rlocator, rlocator))
+			return entry;
+	}
+
+	return NULL;
+}
+
 static inline uint32
 lrq_inflight(LsnReadQueue *lrq)
 {
@@ -241,24 +318,60 @@ lrq_completed(LsnReadQueue *lrq)
 	return lrq->completed;
 }
 
+/*
+ * Reads into shared buffers that have finished no longer count against the
+ * I/O depth, even though we keep the buffers pinned until their records are
+ * replayed.  Advice given to the kernel can't be tracked like that, so those
+ * I/Os count as in flight until replay catches up with them.
+ */
+static inline void
+lrq_poll(LsnReadQueue *lrq)
+{
+	for (uint32 i = lrq->tail; i != lrq->head; i = (i + 1) % lrq->size)
+	{
+		LsnReadQueueEntry *entry = &lrq->queue[i];
+
+		if (entry->io && BufferIsValid(entry->buffer) &&
+			pgaio_wref_check_done(&entry->op.io_wref))
+		{
+			entry->io = false;
+			lrq->inflight--;
+			lrq->completed++;
+		}
+	}
+}
+
 static inline void
 lrq_prefetch(LsnReadQueue *lrq)
 {
 	/* Try to start as many IOs as we can within our limits. */
-	while (lrq->inflight < lrq->max_inflight &&
-		   lrq->inflight + lrq->completed < lrq->size - 1)
+	for (;;)
 	{
+		LsnReadQueueEntry *entry;
+
+		if (lrq->pinned > 0 && lrq->inflight >= lrq->max_inflight)
+			lrq_poll(lrq);
+		if (lrq->inflight >= lrq->max_inflight ||
+			lrq->inflight + lrq->completed >= lrq->size - 1)
+			break;
+
+		entry = &lrq->queue[lrq->head];
 		Assert(((lrq->head + 1) % lrq->size) != lrq->tail);
-		switch (lrq->next(lrq->lrq_private, &lrq->queue[lrq->head].lsn))
+		entry->buffer = InvalidBuffer;
+		entry->overwrites = false;
+		switch (lrq->next(lrq->lrq_private, entry))
 		{
 			case LRQ_NEXT_AGAIN:
 				return;
 			case LRQ_NEXT_IO:
-				lrq->queue[lrq->head].io = true;
+				entry->io = true;
 				lrq->inflight++;
+				if (BufferIsValid(entry->buffer))
+					lrq->pinned++;
 				break;
 			case LRQ_NEXT_NO_IO:
-				lrq->queue[lrq->head].io = false;
+				Assert(!BufferIsValid(entry->buffer));
+				entry->io = false;
 				lrq->completed++;
 				break;
 		}
@@ -278,6 +391,10 @@ lrq_complete_lsn(LsnReadQueue *lrq, XLogRecPtr lsn)
 	while (lrq->tail != lrq->head &&
 		   lrq->queue[lrq->tail].lsn < lsn)
 	{
+		/* Should have been released before the record was replayed */
+		if (BufferIsValid(lrq->queue[lrq->tail].buffer))
+			lrq_release(lrq, &lrq->queue[lrq->tail]);
+
 		if (lrq->queue[lrq->tail].io)
 			lrq->inflight--;
 		else
@@ -446,17 +563,18 @@ XLogPrefetcherComputeStats(XLogPrefetcher *prefetcher)
  * Returns LRQ_NEXT_AGAIN if no more WAL data is available yet.
  *
  * Returns LRQ_NEXT_IO if the next block reference is for a main fork block
- * that isn't in the buffer pool, and the kernel has been asked to start
- * reading it to make a future read system call faster. An LSN is written to
- * *lsn, and the I/O will be considered to have completed once that LSN is
- * replayed.
+ * that isn't in the buffer pool, and either a read into shared buffers has
+ * been started, or the kernel has been asked to start reading it to make a
+ * future read system call faster.  An LSN is written to entry->lsn, and the
+ * I/O will be considered to have completed once that LSN is replayed.  If a
+ * buffer was pinned for the read, it is written to entry->buffer.
  *
  * Returns LRQ_NEXT_NO_IO if we examined the next block reference and found
  * that it was already in the buffer pool, or we decided for various reasons
  * not to prefetch.
  */
 static LsnReadQueueNextStatus
-XLogPrefetcherNextBlock(uintptr_t pgsr_private, XLogRecPtr *lsn)
+XLogPrefetcherNextBlock(uintptr_t pgsr_private, LsnReadQueueEntry *entry)
 {
 	XLogPrefetcher *prefetcher = (XLogPrefetcher *) pgsr_private;
 	XLogReaderState *reader = prefetcher->reader;
@@ -509,7 +627,7 @@ XLogPrefetcherNextBlock(uintptr_t pgsr_private, XLogRecPtr *lsn)
 			 */
 			if (!RecoveryPrefetchEnabled())
 			{
-				*lsn = InvalidXLogRecPtr;
+				entry->lsn = InvalidXLogRecPtr;
 				return LRQ_NEXT_NO_IO;
 			}
 
@@ -648,6 +766,7 @@ XLogPrefetcherNextBlock(uintptr_t pgsr_private, XLogRecPtr *lsn)
 			DecodedBkpBlock *block = &record->blocks[block_id];
 			SMgrRelation reln;
 			PrefetchBufferResult result;
+			LsnReadQueueEntry *pending;
 
 			if (!block->in_use)
 				continue;
@@ -659,7 +778,7 @@ XLogPrefetcherNextBlock(uintptr_t pgsr_private, XLogRecPtr *lsn)
 			 * LsnReadQueue will consider any IOs submitted for earlier LSNs
 			 * to be finished.
 			 */
-			*lsn = record->lsn;
+			entry->lsn = record->lsn;
 
 			/* We don't try to prefetch anything but the main fork for now. */
 			if (block->forknum != MAIN_FORKNUM)
@@ -673,6 +792,9 @@ XLogPrefetcherNextBlock(uintptr_t pgsr_private, XLogRecPtr *lsn)
 			 */
 			if (block->has_image)
 			{
+				entry->overwrites = true;
+				entry->rlocator = block->rlocator;
+				entry->blkno = block->blkno;
 				XLogPrefetchIncrement(&SharedStats->skip_fpw);
 				return LRQ_NEXT_NO_IO;
 			}
@@ -680,6 +802,9 @@ XLogPrefetcherNextBlock(uintptr_t pgsr_private, XLogRecPtr *lsn)
 			/* There is no point in reading a page that will be zeroed. */
 			if (block->flags & BKPBLOCK_WILL_INIT)
 			{
+				entry->overwrites = true;
+				entry->rlocator = block->rlocator;
+				entry->blkno = block->blkno;
 				XLogPrefetchIncrement(&SharedStats->skip_init);
 				return LRQ_NEXT_NO_IO;
 			}
@@ -763,6 +888,47 @@ XLogPrefetcherNextBlock(uintptr_t pgsr_private, XLogRecPtr *lsn)
 				return LRQ_NEXT_NO_IO;
 			}
 
+			/*
+			 * If asynchronous I/O is carried out by other processes, read
+			 * the block into shared buffers right away.  We can't do that if
+			 * we already hold a pin on it, or if an earlier record that we
+			 * haven't replayed yet overwrites it: the page on disk might be
+			 * torn, and the read would fail.  We also have to stay within
+			 * our share of pins.
+			 */
+			pending = lrq_find_block(prefetcher->streaming_read,
+									 block->rlocator, block->blkno);
+			if (pending != NULL && BufferIsValid(pending->buffer))
+			{
+				XLogPrefetchIncrement(&SharedStats->skip_rep);
+				return LRQ_NEXT_NO_IO;
+			}
+			if (io_method != IOMETHOD_SYNC && pending == NULL &&
+				GetAdditionalPinLimit() > 0)
+			{
+				entry->rlocator = block->rlocator;
+				entry->blkno = block->blkno;
+				entry->op.rel = NULL;
+				entry->op.smgr = reln;
+				entry->op.persistence = RELPERSISTENCE_PERMANENT;
+				entry->op.forknum = block->forknum;
+				entry->op.strategy = NULL;
+				if (StartReadBuffer(&entry->op, &entry->buffer, block->blkno, 0))
+				{
+					/* Cache miss, I/O started. */
+					XLogPrefetchIncrement(&SharedStats->prefetch);
+					block->prefetch_buffer = entry->buffer;
+					return LRQ_NEXT_IO;
+				}
+
+				/* Cache hit, no need to hold on to the pin. */
+				XLogPrefetchIncrement(&SharedStats->hit);
+				block->prefetch_buffer = entry->buffer;
+				ReleaseBuffer(entry->buffer);
+				entry->buffer = InvalidBuffer;
+				return LRQ_NEXT_NO_IO;
+			}
+
 			/* Try to initiate prefetching. */
 			result = PrefetchSharedBuffer(reln, block->forknum, block->blkno);
 			if (BufferIsValid(result.recent_buffer))
@@ -779,6 +945,7 @@ XLogPrefetcherNextBlock(uintptr_t pgsr_private, XLogRecPtr *lsn)
 				block->prefetch_buffer = InvalidBuffer;
 				return LRQ_NEXT_IO;
 			}
+#ifdef USE_PREFETCH
 			else if ((io_direct_flags & IO_DIRECT_DATA) == 0)
 			{
 				/*
@@ -795,6 +962,7 @@ XLogPrefetcherNextBlock(uintptr_t pgsr_private, XLogRecPtr *lsn)
 					 reln->smgr_rlocator.locator.relNumber,
 					 block->blkno);
 			}
+#endif
 		}
 
 		/*
@@ -973,6 +1141,97 @@ XLogPrefetcherBeginRead(XLogPrefetcher *prefetcher, XLogRecPtr recPtr)
 	XLogBeginRead(prefetcher->reader, recPtr);
 }
 
+/*
+ * Might replay of this record drop buffers?  That fails if we hold a pin on
+ * any of them.
+ */
+static bool
+XLogPrefetcherMightDropBuffers(DecodedXLogRecord *record)
+{
+	uint8		info = record->header.xl_info & ~XLR_INFO_MASK;
+
+	switch (record->header.xl_rmid)
+	{
+		case RM_SMGR_ID:
+		case RM_DBASE_ID:
+		case RM_TBLSPC_ID:
+			return true;
+		case RM_XACT_ID:
+			switch (info & XLOG_XACT_OPMASK)
+			{
+				case XLOG_XACT_COMMIT:
+				case XLOG_XACT_COMMIT_PREPARED:
+				case XLOG_XACT_ABORT:
+				case XLOG_XACT_ABORT_PREPARED:
+					{
+						xl_xact_xinfo xinfo;
+
+						/* Commit and abort records start the same way */
+						StaticAssertStmt(MinSizeOfXactCommit == MinSizeOfXactAbort,
+										 "commit and abort records differ");
+						if ((info & XLOG_XACT_HAS_INFO) == 0)
+							return false;
+						if (record->main_data_len < MinSizeOfXactCommit + sizeof(xinfo))
+							return true;
+						memcpy(&xinfo, record->main_data + MinSizeOfXactCommit,
+							   sizeof(xinfo));
+						return (xinfo.xinfo & XACT_XINFO_HAS_RELFILELOCATORS) != 0;
+					}
+			}
+			return false;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Before a record is replayed, wait for the reads of the blocks it references
+ * to finish and release our pins on them, because replay might need a cleanup
+ * lock, which can't be acquired while we hold another pin.  Pins for earlier
+ * records should be gone already.  Records that might drop buffers need all
+ * of our pins to be released.
+ */
+static void
+XLogPrefetcherReleaseBuffers(XLogPrefetcher *prefetcher,
+							 DecodedXLogRecord *record)
+{
+	LsnReadQueue *lrq = prefetcher->streaming_read;
+
+	if (lrq->pinned == 0)
+		return;
+
+	if (XLogPrefetcherMightDropBuffers(record))
+	{
+		lrq_release_all(lrq);
+		return;
+	}
+
+	for (uint32 i = lrq->tail; lrq->pinned > 0 && i != lrq->head;
+		 i = (i + 1) % lrq->size)
+	{
+		LsnReadQueueEntry *entry = &lrq->queue[i];
+		bool		release;
+
+		if (!BufferIsValid(entry->buffer))
+			continue;
+
+		release = entry->lsn <= record->lsn;
+		for (int block_id = 0; !release && block_id <= record->max_block_id;
+			 block_id++)
+		{
+			DecodedBkpBlock *block = &record->blocks[block_id];
+
+			release = block->in_use &&
+				block->forknum == MAIN_FORKNUM &&
+				block->blkno == entry->blkno &&
+				RelFileLocatorEquals(block->rlocator, entry->rlocator);
+		}
+
+		if (release)
+			lrq_release(lrq, entry);
+	}
+}
+
 /*
  * A wrapper for XLogReadRecord() that provides the same interface, but also
  * tries to initiate I/O for blocks referenced in future WAL records.
@@ -1065,6 +1324,9 @@ XLogPrefetcherReadRecord(XLogPrefetcher *prefetcher, char **errmsg)
 	if (record == prefetcher->record)
 		prefetcher->record = NULL;
 
+	/* Let go of buffers that replaying this record might need to lock. */
+	XLogPrefetcherReleaseBuffers(prefetcher, record);
+
 	/*
 	 * See if it's time to compute some statistics, because enough WAL has
 	 * been processed.
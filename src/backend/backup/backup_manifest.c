@@ -22,6 +22,8 @@
 #include "utils/json.h"
 
 static void AppendStringToManifest(backup_manifest_info *manifest, const char *s);
+static void AppendDataToManifest(backup_manifest_info *manifest, const char *s,
+								 size_t len);
 
 /*
  * Does the user want a backup manifest?
@@ -85,6 +87,66 @@ InitializeBackupManifest(backup_manifest_info *manifest,
 						 GetSystemIdentifier());
 }
 
+/*
+ * Initialize state so that we can write file entries for a backup manifest
+ * that is being constructed by another process, to the given file.
+ *
+ * This is used by the workers of a parallel backup.  Only file entries are
+ * written, each of them preceded by a comma, and no checksum is computed;
+ * AppendBackupManifestFileList adds them to the real manifest.  If buffile
+ * is NULL, no manifest is wanted.
+ */
+void
+InitializeBackupManifestFileList(backup_manifest_info *manifest,
+								 BufFile *buffile,
+								 pg_checksum_type manifest_checksum_type,
+								 bool force_encode)
+{
+	memset(manifest, 0, sizeof(backup_manifest_info));
+	manifest->buffile = buffile;
+	manifest->checksum_type = manifest_checksum_type;
+	manifest->manifest_size = UINT64CONST(0);
+	manifest->force_encode = force_encode;
+	manifest->first_file = false;
+	manifest->still_checksumming = false;
+}
+
+/*
+ * Add the file entries written to the given file by another process, as set
+ * up by InitializeBackupManifestFileList, to the backup manifest.
+ */
+void
+AppendBackupManifestFileList(backup_manifest_info *manifest, BufFile *file)
+{
+	char		buf[BLCKSZ];
+	size_t		nread;
+	bool		first = true;
+
+	if (!IsManifestEnabled(manifest))
+		return;
+
+	if (BufFileSeek(file, 0, 0, SEEK_SET))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not rewind temporary file")));
+
+	while ((nread = BufFileRead(file, buf, sizeof(buf))) > 0)
+	{
+		char	   *data = buf;
+
+		/* If these are the first entries, drop the comma before them. */
+		if (first && manifest->first_file && *data == ',')
+		{
+			data++;
+			nread--;
+		}
+		first = false;
+		manifest->first_file = false;
+
+		AppendDataToManifest(manifest, data, nread);
+	}
+}
+
 /*
  * Free resources assigned to a backup manifest constructed.
  */
@@ -383,8 +445,15 @@ SendBackupManifest(backup_manifest_info *manifest, bbsink *sink)
 static void
 AppendStringToManifest(backup_manifest_info *manifest, const char *s)
 {
-	int			len = strlen(s);
+	AppendDataToManifest(manifest, s, strlen(s));
+}
 
+/*
+ * Append arbitrary bytes to the manifest.
+ */
+static void
+AppendDataToManifest(backup_manifest_info *manifest, const char *s, size_t len)
+{
 	Assert(manifest != NULL);
 	if (manifest->still_checksumming)
 	{
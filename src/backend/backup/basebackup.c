@@ -21,6 +21,7 @@
 #include "backup/backup_manifest.h"
 #include "backup/basebackup.h"
 #include "backup/basebackup_incremental.h"
+#include "backup/basebackup_parallel.h"
 #include "backup/basebackup_sink.h"
 #include "backup/basebackup_target.h"
 #include "catalog/pg_tablespace_d.h"
@@ -40,6 +41,7 @@
 #include "replication/walsender_private.h"
 #include "storage/bufpage.h"
 #include "storage/checksum.h"
+#include "storage/doublewrite.h"
 #include "storage/dsm_impl.h"
 #include "storage/ipc.h"
 #include "storage/reinit.h"
@@ -67,6 +69,8 @@ typedef struct
 	bool		nowait;
 	bool		includewal;
 	bool		incremental;
+	int			parallel;
+	const char *parallel_token;
 	uint32		maxrate;
 	bool		sendtblspcmapfile;
 	bool		send_to_client;
@@ -114,6 +118,7 @@ static void _tarWritePadding(bbsink *sink, int len);
 static void convert_link_to_directory(const char *pathbuf, struct stat *statbuf);
 static void perform_base_backup(basebackup_options *opt, bbsink *sink,
 								IncrementalBackupInfo *ib);
+static void perform_base_backup_worker(basebackup_options *opt, bbsink *sink);
 static void parse_basebackup_options(List *options, basebackup_options *opt);
 static int	compareWalFileNames(const ListCell *a, const ListCell *b);
 static ssize_t basebackup_read_file(int fd, char *buf, size_t nbytes, off_t offset,
@@ -128,6 +133,9 @@ static long long int total_checksum_failures;
 /* Do not verify checksums. */
 static bool noverify_checksums = false;
 
+/* State of the parallel backup we're participating in, if any. */
+static ParallelBackupState *parallel_backup = NULL;
+
 /*
  * Definition of one element part of an exclusion list, used for paths part
  * of checksum validation or base backups.  "name" is the name of the file
@@ -166,6 +174,9 @@ static const char *const excludeDirContents[] =
 	/* Contents removed on startup, see dsm_cleanup_for_mmap(). */
 	PG_DYNSHMEM_DIR,
 
+	/* Only needed for crash recovery, see DoubleWriteRecover(). */
+	PG_DBLWR_DIR,
+
 	/* Contents removed on startup, see AsyncShmemInit(). */
 	"pg_notify",
 
@@ -255,6 +266,7 @@ perform_base_backup(basebackup_options *opt, bbsink *sink,
 	CurrentResourceOwner = AuxProcessResourceOwner;
 
 	backup_started_in_recovery = RecoveryInProgress();
+	parallel_backup = NULL;
 
 	InitializeBackupManifest(&manifest, opt->manifest,
 							 opt->manifest_checksum_type);
@@ -316,6 +328,22 @@ perform_base_backup(basebackup_options *opt, bbsink *sink,
 			state.bytes_total_is_valid = true;
 		}
 
+		/*
+		 * If other connections are to send part of the files, set up the
+		 * shared state for them, and tell the client how to join.
+		 */
+		if (opt->parallel > 1)
+		{
+			parallel_backup = ParallelBackupBegin(opt->parallel,
+												  state.startptr,
+												  state.starttli,
+												  !opt->sendtblspcmapfile,
+												  state.tablespaces,
+												  opt->manifest,
+												  opt->manifest_checksum_type);
+			ParallelBackupSendToken(parallel_backup);
+		}
+
 		/* notify basebackup sink about start of backup */
 		bbsink_begin_backup(sink, &state, SINK_BUFFER_LENGTH);
 
@@ -392,6 +420,16 @@ perform_base_backup(basebackup_options *opt, bbsink *sink,
 			}
 		}
 
+		/*
+		 * The backup can't be stopped until the other connections have sent
+		 * their files, too.
+		 */
+		if (parallel_backup != NULL)
+		{
+			ParallelBackupFinish(parallel_backup, &manifest);
+			parallel_backup = NULL;
+		}
+
 		basebackup_progress_wait_wal_archive(&state);
 		do_pg_backup_stop(backup_state, !opt->nowait);
 
@@ -678,6 +716,105 @@ perform_base_backup(basebackup_options *opt, bbsink *sink,
 	basebackup_progress_done();
 }
 
+/*
+ * Send our share of the files of a parallel base backup that was started by
+ * another connection.
+ *
+ * We send the same archives as the leader, but with only the directories and
+ * the relation files that are assigned to us; see basebackup_parallel.c.  We
+ * know nothing of the end of the backup, so we report the start position in
+ * its place.
+ */
+static void
+perform_base_backup_worker(basebackup_options *opt, bbsink *sink)
+{
+	bbsink_state state;
+	backup_manifest_info manifest;
+	BufFile    *manifest_file = NULL;
+	ListCell   *lc;
+
+	/* we're going to use a BufFile, so we need a ResourceOwner */
+	Assert(AuxProcessResourceOwner != NULL);
+	Assert(CurrentResourceOwner == AuxProcessResourceOwner ||
+		   CurrentResourceOwner == NULL);
+	CurrentResourceOwner = AuxProcessResourceOwner;
+
+	parallel_backup = ParallelBackupAttach(opt->parallel_token);
+
+	state.tablespaces = parallel_backup->tablespaces;
+	state.tablespace_num = 0;
+	state.bytes_done = 0;
+	state.bytes_total = 0;
+	state.bytes_total_is_valid = false;
+	state.startptr = parallel_backup->startptr;
+	state.starttli = parallel_backup->starttli;
+
+	backup_started_in_recovery = parallel_backup->started_in_recovery;
+
+	if (parallel_backup->manifest != MANIFEST_OPTION_NO)
+		manifest_file = ParallelBackupCreateManifestFile(parallel_backup);
+	InitializeBackupManifestFileList(&manifest, manifest_file,
+									 parallel_backup->manifest_checksum_type,
+									 parallel_backup->manifest == MANIFEST_OPTION_FORCE_ENCODE);
+
+	total_checksum_failures = 0;
+
+	bbsink_begin_backup(sink, &state, SINK_BUFFER_LENGTH);
+
+	foreach(lc, state.tablespaces)
+	{
+		tablespaceinfo *ti = (tablespaceinfo *) lfirst(lc);
+
+		if (ti->path == NULL)
+		{
+			bbsink_begin_archive(sink, "base.tar");
+			sendDir(sink, ".", 1, false, state.tablespaces,
+					parallel_backup->sendtblspclinks, &manifest,
+					InvalidOid, NULL);
+		}
+		else
+		{
+			char	   *archive_name = psprintf("%u.tar", ti->oid);
+
+			bbsink_begin_archive(sink, archive_name);
+			sendTablespace(sink, ti->path, ti->oid, false, &manifest, NULL);
+		}
+
+		/* Properly terminate the tarfile. */
+		memset(sink->bbs_buffer, 0, 2 * TAR_BLOCK_SIZE);
+		bbsink_archive_contents(sink, 2 * TAR_BLOCK_SIZE);
+		bbsink_end_archive(sink);
+	}
+
+	bbsink_end_backup(sink, state.startptr, state.starttli);
+
+	if (total_checksum_failures)
+	{
+		if (total_checksum_failures > 1)
+			ereport(WARNING,
+					(errmsg_plural("%lld total checksum verification failure",
+								   "%lld total checksum verification failures",
+								   total_checksum_failures,
+								   total_checksum_failures)));
+
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("checksum verification failure during base backup")));
+	}
+
+	if (manifest_file != NULL)
+		BufFileClose(manifest_file);
+	ParallelBackupWorkerDone(parallel_backup);
+	parallel_backup = NULL;
+
+	FreeBackupManifest(&manifest);
+
+	/* clean up the resource owner we created */
+	ReleaseAuxProcessResources(true);
+
+	basebackup_progress_done();
+}
+
 /*
  * list_sort comparison function, to compare log/seg portion of WAL segment
  * filenames, ignoring the timeline portion.
@@ -704,6 +841,8 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 	bool		o_nowait = false;
 	bool		o_wal = false;
 	bool		o_incremental = false;
+	bool		o_parallel = false;
+	bool		o_parallel_worker = false;
 	bool		o_maxrate = false;
 	bool		o_tablespace_map = false;
 	bool		o_noverify_checksums = false;
@@ -718,6 +857,7 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 	char	   *compression_detail_str = NULL;
 
 	MemSet(opt, 0, sizeof(*opt));
+	opt->parallel = 1;
 	opt->manifest = MANIFEST_OPTION_NO;
 	opt->manifest_checksum_type = CHECKSUM_TYPE_CRC32C;
 	opt->compression = PG_COMPRESSION_NONE;
@@ -795,6 +935,34 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 						 errmsg("incremental backups cannot be taken unless WAL summarization is enabled")));
 			o_incremental = true;
 		}
+		else if (strcmp(defel->defname, "parallel") == 0)
+		{
+			int64		parallel;
+
+			if (o_parallel)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+
+			parallel = defGetInt64(defel);
+			if (parallel < 1 || parallel > MAX_PARALLEL_BACKUP)
+				ereport(ERROR,
+						(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+						 errmsg("%" PRId64 " is outside the valid range for parameter \"%s\" (%d .. %d)",
+								parallel, "PARALLEL", 1, MAX_PARALLEL_BACKUP)));
+
+			opt->parallel = (int) parallel;
+			o_parallel = true;
+		}
+		else if (strcmp(defel->defname, "parallel_worker") == 0)
+		{
+			if (o_parallel_worker)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			opt->parallel_token = defGetString(defel);
+			o_parallel_worker = true;
+		}
 		else if (strcmp(defel->defname, "max_rate") == 0)
 		{
 			int64		maxrate;
@@ -957,6 +1125,30 @@ parse_basebackup_options(List *options, basebackup_options *opt)
 		opt->target_handle =
 			BaseBackupGetTargetHandle(target_str, target_detail_str);
 
+	if (opt->parallel > 1)
+	{
+		if (!opt->send_to_client || opt->target_handle != NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("parallel base backups can only be sent to the client")));
+		if (opt->incremental)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("incremental base backups cannot be taken in parallel")));
+	}
+
+	/*
+	 * A worker of a parallel backup takes everything else from the leader,
+	 * so it accepts only the options that affect how it sends its files.
+	 */
+	if (o_parallel_worker &&
+		(o_wal || o_incremental || o_parallel || o_checkpoint || o_nowait ||
+		 o_tablespace_map || o_manifest || o_manifest_checksums ||
+		 !opt->send_to_client || opt->target_handle != NULL))
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("only the LABEL, PROGRESS, MAX_RATE, VERIFY_CHECKSUMS, TARGET 'client', COMPRESSION and COMPRESSION_DETAIL options can be used with PARALLEL_WORKER")));
+
 	if (o_compression_detail && !o_compression)
 		ereport(ERROR,
 				(errcode(ERRCODE_SYNTAX_ERROR),
@@ -1056,7 +1248,10 @@ SendBaseBackup(BaseBackupCmd *cmd, IncrementalBackupInfo *ib)
 	 */
 	PG_TRY();
 	{
-		perform_base_backup(&opt, sink, ib);
+		if (opt.parallel_token != NULL)
+			perform_base_backup_worker(&opt, sink);
+		else
+			perform_base_backup(&opt, sink, ib);
 	}
 	PG_FINALLY();
 	{
@@ -1277,6 +1472,8 @@ sendDir(bbsink *sink, const char *path, int basepathlen, bool sizeonly,
 		 * the backup early than continue to the end and fail there.
 		 */
 		CHECK_FOR_INTERRUPTS();
+		if (parallel_backup != NULL)
+			ParallelBackupCheckAborted(parallel_backup);
 		if (RecoveryInProgress() != backup_started_in_recovery)
 			ereport(ERROR,
 					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
@@ -1406,6 +1603,17 @@ sendDir(bbsink *sink, const char *path, int basepathlen, bool sizeonly,
 			continue;			/* don't recurse into pg_wal */
 		}
 
+		/*
+		 * In a parallel backup, every participant sends all the directories,
+		 * but each file is sent by only one of them.  Relation files are
+		 * distributed among the participants, and all other files are sent
+		 * by the leader.
+		 */
+		if (parallel_backup != NULL && !sizeonly && !S_ISDIR(statbuf.st_mode) &&
+			!ParallelBackupIncludesFile(parallel_backup, pathbuf,
+										isRelationFile && S_ISREG(statbuf.st_mode)))
+			continue;
+
 		/* Allow symbolic links in pg_tblspc only */
 		if (strcmp(path, "./pg_tblspc") == 0 && S_ISLNK(statbuf.st_mode))
 		{
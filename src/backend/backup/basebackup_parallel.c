@@ -0,0 +1,445 @@
+/*-------------------------------------------------------------------------
+ *
+ * basebackup_parallel.c
+ *	  Coordination of a base backup sent over several connections
+ *
+ * A single walsender reads, checksums and compresses every file of a base
+ * backup by itself, which on a large cluster leaves most of the server's
+ * CPUs and I/O bandwidth idle.  With the PARALLEL option, the connection
+ * that runs BASE_BACKUP (the leader) starts the backup as usual and then
+ * returns a token, with which the client can open further replication
+ * connections and run BASE_BACKUP with the PARALLEL_WORKER option.  Each
+ * connection then sends its own tar archives, with the relation files
+ * divided among them by a hash of their path, so every file is sent by
+ * exactly one connection while each of them sends all of the directories.
+ * Everything else, including backup_label, pg_control, tablespace symlinks
+ * and WAL, is sent by the leader alone.
+ *
+ * The participants share a small DSM segment, created by the leader and
+ * identified by the token.  The workers write their part of the backup
+ * manifest to files in a SharedFileSet, and the leader waits for all of
+ * them to finish before it adds their entries to its own manifest and
+ * stops the backup.  If any participant goes away without finishing, the
+ * others notice and fail, since the backup would be incomplete.
+ *
+ * Portions Copyright (c) 2010-2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/backup/basebackup_parallel.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/tupdesc.h"
+#include "access/xlog.h"
+#include "backup/basebackup.h"
+#include "backup/basebackup_parallel.h"
+#include "catalog/pg_type_d.h"
+#include "common/hashfn.h"
+#include "executor/executor.h"
+#include "libpq/libpq.h"
+#include "libpq/pqformat.h"
+#include "miscadmin.h"
+#include "storage/condition_variable.h"
+#include "storage/dsm.h"
+#include "storage/sharedfileset.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "tcop/dest.h"
+#include "utils/builtins.h"
+#include "utils/wait_event.h"
+
+/*
+ * A tablespace of the backup, as in tablespaceinfo.  An empty path denotes
+ * the main data directory.
+ */
+typedef struct ParallelBackupTablespace
+{
+	Oid			oid;
+	char		path[MAXPGPATH];
+	char		rpath[MAXPGPATH];
+	bool		has_rpath;
+} ParallelBackupTablespace;
+
+typedef struct ParallelBackupShared
+{
+	/* Set by the leader and never changed. */
+	uint64		cookie;
+	Oid			userid;
+	int			nparticipants;
+	XLogRecPtr	startptr;
+	TimeLineID	starttli;
+	bool		started_in_recovery;
+	bool		sendtblspclinks;
+	backup_manifest_option manifest;
+	pg_checksum_type manifest_checksum_type;
+
+	/* Protected by mutex. */
+	slock_t		mutex;
+	int			nattached;		/* # of workers that have attached */
+	int			nfinished;		/* # of workers that have finished */
+	bool		aborted;		/* has some participant failed? */
+
+	/* Signaled when a worker finishes, or a participant fails. */
+	ConditionVariable cv;
+
+	/* Where the workers' manifest entries go. */
+	SharedFileSet fileset;
+
+	int			ntablespaces;
+	ParallelBackupTablespace tablespaces[FLEXIBLE_ARRAY_MEMBER];
+} ParallelBackupShared;
+
+/* Has this backend done its part of the current parallel backup? */
+static bool parallel_backup_done = false;
+
+static void parallel_backup_on_detach(dsm_segment *seg, Datum arg);
+static void parallel_backup_manifest_name(char *name, int participant);
+
+/*
+ * Set up the shared state of a parallel backup that has just been started
+ * by this backend.
+ */
+ParallelBackupState *
+ParallelBackupBegin(int nparticipants, XLogRecPtr startptr,
+					TimeLineID starttli, bool sendtblspclinks,
+					List *tablespaces, backup_manifest_option manifest,
+					pg_checksum_type manifest_checksum_type)
+{
+	ParallelBackupState *pstate = palloc0_object(ParallelBackupState);
+	ParallelBackupShared *shared;
+	Size		size;
+	int			i = 0;
+
+	Assert(nparticipants > 1);
+
+	size = add_size(offsetof(ParallelBackupShared, tablespaces),
+					mul_size(list_length(tablespaces),
+							 sizeof(ParallelBackupTablespace)));
+	pstate->seg = dsm_create(size, 0);
+	shared = dsm_segment_address(pstate->seg);
+	memset(shared, 0, size);
+
+	if (!pg_strong_random(&shared->cookie, sizeof(shared->cookie)))
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("could not generate random cookie")));
+	shared->userid = GetUserId();
+	shared->nparticipants = nparticipants;
+	shared->startptr = startptr;
+	shared->starttli = starttli;
+	shared->started_in_recovery = RecoveryInProgress();
+	shared->sendtblspclinks = sendtblspclinks;
+	shared->manifest = manifest;
+	shared->manifest_checksum_type = manifest_checksum_type;
+	SpinLockInit(&shared->mutex);
+	ConditionVariableInit(&shared->cv);
+	SharedFileSetInit(&shared->fileset, pstate->seg);
+
+	shared->ntablespaces = list_length(tablespaces);
+	foreach_ptr(tablespaceinfo, ti, tablespaces)
+	{
+		ParallelBackupTablespace *pti = &shared->tablespaces[i++];
+
+		pti->oid = ti->oid;
+		if (ti->path != NULL)
+			strlcpy(pti->path, ti->path, MAXPGPATH);
+		if (ti->rpath != NULL)
+		{
+			strlcpy(pti->rpath, ti->rpath, MAXPGPATH);
+			pti->has_rpath = true;
+		}
+	}
+
+	parallel_backup_done = false;
+	on_dsm_detach(pstate->seg, parallel_backup_on_detach,
+				  PointerGetDatum(shared));
+
+	pstate->shared = shared;
+	pstate->participant = 0;
+	pstate->nparticipants = nparticipants;
+	pstate->startptr = startptr;
+	pstate->starttli = starttli;
+	pstate->started_in_recovery = shared->started_in_recovery;
+	pstate->sendtblspclinks = sendtblspclinks;
+	pstate->tablespaces = tablespaces;
+	pstate->manifest = manifest;
+	pstate->manifest_checksum_type = manifest_checksum_type;
+
+	return pstate;
+}
+
+/*
+ * Send the client a result set with the token that the other connections
+ * of the backup must pass to PARALLEL_WORKER.
+ */
+void
+ParallelBackupSendToken(ParallelBackupState *pstate)
+{
+	DestReceiver *dest;
+	TupOutputState *tstate;
+	TupleDesc	tupdesc;
+	Datum		values[1];
+	bool		nulls[1] = {0};
+
+	dest = CreateDestReceiver(DestRemoteSimple);
+
+	tupdesc = CreateTemplateTupleDesc(1);
+	TupleDescInitBuiltinEntry(tupdesc, (AttrNumber) 1, "token", TEXTOID, -1, 0);
+
+	tstate = begin_tup_output_tupdesc(dest, tupdesc, &TTSOpsVirtual);
+
+	values[0] = CStringGetTextDatum(psprintf("%u-" UINT64_FORMAT,
+											 dsm_segment_handle(pstate->seg),
+											 pstate->shared->cookie));
+	do_tup_output(tstate, values, nulls);
+
+	end_tup_output(tstate);
+
+	pq_puttextmessage(PqMsg_CommandComplete, "SELECT");
+}
+
+/*
+ * Wait for all the workers of a parallel backup to finish, and add the
+ * files they sent to the leader's backup manifest.
+ */
+void
+ParallelBackupFinish(ParallelBackupState *pstate,
+					 backup_manifest_info *manifest)
+{
+	ParallelBackupShared *shared = pstate->shared;
+
+	ConditionVariablePrepareToSleep(&shared->cv);
+	for (;;)
+	{
+		bool		aborted;
+		int			nfinished;
+
+		SpinLockAcquire(&shared->mutex);
+		aborted = shared->aborted;
+		nfinished = shared->nfinished;
+		SpinLockRelease(&shared->mutex);
+
+		if (aborted)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("a connection of the parallel base backup failed")));
+		if (nfinished == shared->nparticipants - 1)
+			break;
+
+		/*
+		 * If the client has gone away, its other connections aren't coming
+		 * back either.
+		 */
+		if (!pq_check_connection())
+			ereport(ERROR,
+					(errcode(ERRCODE_CONNECTION_FAILURE),
+					 errmsg("connection to client lost")));
+
+		(void) ConditionVariableTimedSleep(&shared->cv, 1000,
+										   WAIT_EVENT_BACKUP_PARALLEL_WORKERS);
+	}
+	ConditionVariableCancelSleep();
+
+	if (shared->manifest != MANIFEST_OPTION_NO)
+	{
+		for (int i = 1; i < shared->nparticipants; i++)
+		{
+			char		name[MAXPGPATH];
+			BufFile    *file;
+
+			parallel_backup_manifest_name(name, i);
+			file = BufFileOpenFileSet(&shared->fileset.fs, name, O_RDONLY,
+									  false);
+			AppendBackupManifestFileList(manifest, file);
+			BufFileClose(file);
+		}
+	}
+
+	parallel_backup_done = true;
+	dsm_detach(pstate->seg);
+}
+
+/*
+ * Join the parallel backup identified by the given token, as a worker.
+ */
+ParallelBackupState *
+ParallelBackupAttach(const char *token)
+{
+	ParallelBackupState *pstate = palloc0_object(ParallelBackupState);
+	ParallelBackupShared *shared;
+	dsm_handle	handle;
+	uint64		cookie;
+	char	   *endptr;
+	int			participant;
+
+	errno = 0;
+	handle = strtoul(token, &endptr, 10);
+	if (errno != 0 || endptr == token || *endptr != '-')
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid parallel backup token: \"%s\"", token)));
+	cookie = strtou64(endptr + 1, &endptr, 10);
+	if (errno != 0 || *endptr != '\0')
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid parallel backup token: \"%s\"", token)));
+
+	pstate->seg = dsm_attach(handle);
+	if (pstate->seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("parallel base backup is not in progress")));
+	shared = dsm_segment_address(pstate->seg);
+
+	/*
+	 * The handle alone could belong to any DSM segment, so check the cookie
+	 * before looking at anything else.  Only the user who started the backup
+	 * may join it.
+	 */
+	if (dsm_segment_map_length(pstate->seg) < sizeof(ParallelBackupShared) ||
+		shared->cookie != cookie)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("parallel base backup is not in progress")));
+	if (shared->userid != GetUserId())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("parallel base backup was started by another user")));
+
+	SpinLockAcquire(&shared->mutex);
+	participant = ++shared->nattached;
+	SpinLockRelease(&shared->mutex);
+	if (participant >= shared->nparticipants)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("parallel base backup already has %d connections",
+						shared->nparticipants)));
+
+	parallel_backup_done = false;
+	on_dsm_detach(pstate->seg, parallel_backup_on_detach,
+				  PointerGetDatum(shared));
+	SharedFileSetAttach(&shared->fileset, pstate->seg);
+
+	pstate->shared = shared;
+	pstate->participant = participant;
+	pstate->nparticipants = shared->nparticipants;
+	pstate->startptr = shared->startptr;
+	pstate->starttli = shared->starttli;
+	pstate->started_in_recovery = shared->started_in_recovery;
+	pstate->sendtblspclinks = shared->sendtblspclinks;
+	pstate->manifest = shared->manifest;
+	pstate->manifest_checksum_type = shared->manifest_checksum_type;
+
+	for (int i = 0; i < shared->ntablespaces; i++)
+	{
+		ParallelBackupTablespace *pti = &shared->tablespaces[i];
+		tablespaceinfo *ti = palloc0_object(tablespaceinfo);
+
+		ti->oid = pti->oid;
+		ti->path = pti->path[0] != '\0' ? pstrdup(pti->path) : NULL;
+		ti->rpath = pti->has_rpath ? pstrdup(pti->rpath) : NULL;
+		ti->size = -1;
+		pstate->tablespaces = lappend(pstate->tablespaces, ti);
+	}
+
+	return pstate;
+}
+
+/*
+ * Create the file to which a worker writes its manifest entries.
+ */
+BufFile *
+ParallelBackupCreateManifestFile(ParallelBackupState *pstate)
+{
+	char		name[MAXPGPATH];
+
+	Assert(pstate->participant > 0);
+
+	parallel_backup_manifest_name(name, pstate->participant);
+	return BufFileCreateFileSet(&pstate->shared->fileset.fs, name);
+}
+
+/*
+ * Report that a worker has sent all of its files, and detach.  The worker's
+ * manifest file must have been closed already.
+ */
+void
+ParallelBackupWorkerDone(ParallelBackupState *pstate)
+{
+	ParallelBackupShared *shared = pstate->shared;
+
+	Assert(pstate->participant > 0);
+
+	SpinLockAcquire(&shared->mutex);
+	shared->nfinished++;
+	SpinLockRelease(&shared->mutex);
+	ConditionVariableBroadcast(&shared->cv);
+
+	parallel_backup_done = true;
+	dsm_detach(pstate->seg);
+}
+
+/*
+ * Should this participant send the given file?
+ *
+ * Files that are to be distributed among the participants go to the one
+ * chosen by a hash of their path, and all others to the leader.
+ */
+bool
+ParallelBackupIncludesFile(ParallelBackupState *pstate, const char *path,
+						   bool distribute)
+{
+	uint32		hash;
+
+	if (!distribute)
+		return pstate->participant == 0;
+
+	hash = hash_bytes((const unsigned char *) path, strlen(path));
+	return hash % pstate->nparticipants == pstate->participant;
+}
+
+/*
+ * Error out if another participant of the backup has failed, since there's
+ * no point in sending the rest of our files.
+ */
+void
+ParallelBackupCheckAborted(ParallelBackupState *pstate)
+{
+	bool		aborted;
+
+	SpinLockAcquire(&pstate->shared->mutex);
+	aborted = pstate->shared->aborted;
+	SpinLockRelease(&pstate->shared->mutex);
+
+	if (aborted)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("a connection of the parallel base backup failed")));
+}
+
+/*
+ * If we detach before doing our part, whether because of an error or
+ * because the connection was lost, the backup can't be completed.  Let the
+ * others know.
+ */
+static void
+parallel_backup_on_detach(dsm_segment *seg, Datum arg)
+{
+	ParallelBackupShared *shared = (ParallelBackupShared *) DatumGetPointer(arg);
+
+	if (parallel_backup_done)
+		return;
+
+	SpinLockAcquire(&shared->mutex);
+	shared->aborted = true;
+	SpinLockRelease(&shared->mutex);
+	ConditionVariableBroadcast(&shared->cv);
+}
+
+static void
+parallel_backup_manifest_name(char *name, int participant)
+{
+	snprintf(name, MAXPGPATH, "manifest.%d", participant);
+}
@@ -0,0 +1,847 @@
+/*-------------------------------------------------------------------------
+ *
+ * globaltemp.c
+ *	  Per-session storage of global temporary tables
+ *
+ * A global temporary table is defined once, in the regular catalogs, and
+ * its definition is visible to all sessions like that of any other table.
+ * Its contents, however, are private to each session: every session stores
+ * them in its own files, named after the shared relfilenumber and the
+ * session's ProcNumber like those of a temporary table, and accesses them
+ * through local buffers.  Using such a table thus doesn't touch the system
+ * catalogs at all, unlike creating and dropping a temporary table.
+ *
+ * A session creates its files for a table, and builds the table's indexes,
+ * when it first inserts into or scans the table or one of its indexes;
+ * merely opening the relation, or planning a query on it, doesn't.  Until
+ * then, the table counts as empty.  (The session that creates a relation
+ * gets its storage right away, from heap_create().)  An index that another session creates
+ * after this one put rows into the table is built over those rows when this
+ * session first uses it.  The files are removed when the session exits, or
+ * at the end of the first transaction the session commits after the table
+ * was dropped; if the session crashes, they are cleaned up at the next
+ * restart like those of temporary tables.
+ *
+ * TRUNCATE and REINDEX can't give the relation a new relfilenumber in
+ * pg_class, as that is shared.  Instead, the session switches to new storage
+ * of its own, under a relfilenumber that only this session's map knows (see
+ * GlobalTempRelationSetNewRelfilenumber).  As with a regular relation, the
+ * old files are removed at commit and the new ones at abort, and the map
+ * goes back to the old relfilenumber if the (sub)transaction aborts.  The
+ * relcache consults the map in RelationInitPhysicalAddr().  Commands that
+ * rewrite the table into a new pg_class entry are not supported.
+ *
+ * Nor can relfrozenxid and relminmxid in pg_class describe the contents of
+ * all sessions.  Instead, the session keeps them for each of its tables in
+ * its storage map, where they advance as VACUUM freezes the session's
+ * contents or TRUNCATE replaces them.  Each session that has such storage
+ * advertises in shared memory the oldest of those values, along with its
+ * database, and vac_update_datfrozenxid() takes the values of the sessions
+ * in its database into account in place of the pg_class entries.  Autovacuum
+ * can't process the contents, so it leaves global temporary tables alone.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/catalog/globaltemp.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/amapi.h"
+#include "access/genam.h"
+#include "access/multixact.h"
+#include "access/parallel.h"
+#include "access/relation.h"
+#include "access/tableam.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "catalog/catalog.h"
+#include "catalog/globaltemp.h"
+#include "catalog/index.h"
+#include "catalog/pg_class.h"
+#include "catalog/storage.h"
+#include "miscadmin.h"
+#include "nodes/pg_list.h"
+#include "storage/ipc.h"
+#include "storage/lmgr.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/relcache.h"
+#include "utils/syscache.h"
+
+/*
+ * The relations this session has storage for.  An entry whose sharedNumber
+ * doesn't match the relation's pg_class.relfilenode is left over from a
+ * dropped relation whose OID has been reused.
+ *
+ * frozenxid and minmxid play the part of relfrozenxid and relminmxid for
+ * this session's storage of a table; they are invalid for indexes.
+ *
+ * savedNumbers holds a GlobalTempSavedNumber for each open subtransaction
+ * that gave the relation new storage, innermost first.
+ *
+ * checkDropped is set when the relation's relcache entry is invalidated, as
+ * happens when it is dropped, and tells PreCommit_GlobalTemp() to look it up
+ * in pg_class.  If it's gone, dropped is set and the storage is removed when
+ * the transaction commits.
+ */
+typedef struct GlobalTempStorage
+{
+	Oid			relid;			/* hash key */
+	RelFileNumber sharedNumber; /* pg_class.relfilenode of the relation */
+	RelFileLocatorBackend locator;	/* this session's storage */
+	TransactionId frozenxid;
+	MultiXactId minmxid;
+	List	   *savedNumbers;
+	bool		checkDropped;
+	bool		dropped;
+} GlobalTempStorage;
+
+typedef struct GlobalTempSavedNumber
+{
+	SubTransactionId subid;		/* subtransaction that replaced the storage */
+	RelFileNumber relNumber;	/* storage in use before that */
+	TransactionId frozenxid;	/* ... and its horizons */
+	MultiXactId minmxid;
+} GlobalTempSavedNumber;
+
+static HTAB *GlobalTempStorageHash = NULL;
+
+/* total length of all savedNumbers lists */
+static int	numGlobalTempSavedNumbers = 0;
+
+/* is checkDropped set for any entry, and how many entries are dropped? */
+static bool globalTempCheckDropped = false;
+static int	numGlobalTempDropped = 0;
+
+/*
+ * Oldest XID and MultiXactId in the contents of each backend's global
+ * temporary tables, and the backend's database, indexed by ProcNumber.
+ * frozenxid is invalid if the backend has no such contents.  Only the
+ * owning backend sets its entry.
+ */
+typedef struct GlobalTempHorizon
+{
+	Oid			dbid;
+	TransactionId frozenxid;
+	MultiXactId minmxid;
+} GlobalTempHorizon;
+
+static GlobalTempHorizon *GlobalTempHorizons = NULL;
+
+static GlobalTempStorage *GlobalTempStorageLookup(Relation rel);
+static void GlobalTempUpdateHorizons(void);
+static void GlobalTempBuildIndex(Relation heap, Relation index);
+static void GlobalTempRelcacheCallback(Datum arg, Oid relid);
+static void GlobalTempStorageAtExit(int code, Datum arg);
+
+Size
+GlobalTempShmemSize(void)
+{
+	return mul_size(MaxBackends, sizeof(GlobalTempHorizon));
+}
+
+void
+GlobalTempShmemInit(void)
+{
+	bool		found;
+
+	GlobalTempHorizons = (GlobalTempHorizon *)
+		ShmemInitStruct("Global Temporary Table Horizons",
+						GlobalTempShmemSize(), &found);
+	if (!found)
+	{
+		for (int i = 0; i < MaxBackends; i++)
+		{
+			GlobalTempHorizons[i].dbid = InvalidOid;
+			GlobalTempHorizons[i].frozenxid = InvalidTransactionId;
+			GlobalTempHorizons[i].minmxid = InvalidMultiXactId;
+		}
+	}
+}
+
+/*
+ * GlobalTempGetOldestXids
+ *		Lower *frozenxid and *minmxid to the oldest values that the global
+ *		temporary tables of any session connected to database dbid may hold.
+ */
+void
+GlobalTempGetOldestXids(Oid dbid, TransactionId *frozenxid,
+						MultiXactId *minmxid)
+{
+	for (int i = 0; i < MaxBackends; i++)
+	{
+		volatile GlobalTempHorizon *horizon = &GlobalTempHorizons[i];
+		TransactionId xid;
+		MultiXactId mxid;
+
+		/* the other fields are set before frozenxid becomes valid */
+		xid = horizon->frozenxid;
+		if (!TransactionIdIsNormal(xid))
+			continue;
+		pg_read_barrier();
+		if (horizon->dbid != dbid)
+			continue;
+		mxid = horizon->minmxid;
+
+		if (TransactionIdPrecedes(xid, *frozenxid))
+			*frozenxid = xid;
+		if (MultiXactIdIsValid(mxid) &&
+			MultiXactIdPrecedes(mxid, *minmxid))
+			*minmxid = mxid;
+	}
+}
+
+/*
+ * Advertise the oldest horizons of this session's storage, including storage
+ * that a TRUNCATE in progress may go back to.  The values can only go back
+ * when new storage is created, and then not beyond the XID horizon that our
+ * own transaction holds back anyway.
+ */
+static void
+GlobalTempUpdateHorizons(void)
+{
+	volatile GlobalTempHorizon *horizon;
+	TransactionId frozenxid = InvalidTransactionId;
+	MultiXactId minmxid = InvalidMultiXactId;
+	HASH_SEQ_STATUS status;
+	GlobalTempStorage *entry;
+
+	if (MyProcNumber >= MaxBackends)
+		return;
+
+	hash_seq_init(&status, GlobalTempStorageHash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		ListCell   *lc;
+
+		if (TransactionIdIsValid(entry->frozenxid) &&
+			(!TransactionIdIsValid(frozenxid) ||
+			 TransactionIdPrecedes(entry->frozenxid, frozenxid)))
+			frozenxid = entry->frozenxid;
+		if (MultiXactIdIsValid(entry->minmxid) &&
+			(!MultiXactIdIsValid(minmxid) ||
+			 MultiXactIdPrecedes(entry->minmxid, minmxid)))
+			minmxid = entry->minmxid;
+
+		foreach(lc, entry->savedNumbers)
+		{
+			GlobalTempSavedNumber *saved = lfirst(lc);
+
+			if (TransactionIdIsValid(saved->frozenxid) &&
+				(!TransactionIdIsValid(frozenxid) ||
+				 TransactionIdPrecedes(saved->frozenxid, frozenxid)))
+				frozenxid = saved->frozenxid;
+			if (MultiXactIdIsValid(saved->minmxid) &&
+				(!MultiXactIdIsValid(minmxid) ||
+				 MultiXactIdPrecedes(saved->minmxid, minmxid)))
+				minmxid = saved->minmxid;
+		}
+	}
+
+	horizon = &GlobalTempHorizons[MyProcNumber];
+	if (!TransactionIdIsValid(frozenxid))
+	{
+		horizon->frozenxid = InvalidTransactionId;
+		return;
+	}
+	if (!TransactionIdIsValid(horizon->frozenxid))
+	{
+		horizon->dbid = MyDatabaseId;
+		horizon->minmxid = minmxid;
+		pg_write_barrier();
+	}
+	else
+		horizon->minmxid = minmxid;
+	horizon->frozenxid = frozenxid;
+}
+
+/*
+ * GlobalTempRelationGetXids
+ *		Return the relfrozenxid and relminmxid of this session's contents of a
+ *		global temporary table, or the pg_class values if it has none.
+ */
+void
+GlobalTempRelationGetXids(Relation rel, TransactionId *frozenxid,
+						  MultiXactId *minmxid)
+{
+	GlobalTempStorage *entry = GlobalTempStorageLookup(rel);
+
+	if (entry == NULL || !TransactionIdIsValid(entry->frozenxid))
+	{
+		*frozenxid = rel->rd_rel->relfrozenxid;
+		*minmxid = rel->rd_rel->relminmxid;
+		return;
+	}
+
+	*frozenxid = entry->frozenxid;
+	*minmxid = entry->minmxid;
+}
+
+/*
+ * GlobalTempRelationSetXids
+ *		Advance the relfrozenxid and relminmxid of this session's contents of
+ *		a global temporary table, after VACUUM.  Invalid values mean no
+ *		change, as for vac_update_relstats().
+ */
+void
+GlobalTempRelationSetXids(Relation rel, TransactionId frozenxid,
+						  MultiXactId minmxid)
+{
+	GlobalTempStorage *entry = GlobalTempStorageLookup(rel);
+	bool		changed = false;
+
+	if (entry == NULL)
+		return;
+
+	if (TransactionIdIsNormal(frozenxid) &&
+		TransactionIdPrecedes(entry->frozenxid, frozenxid))
+	{
+		entry->frozenxid = frozenxid;
+		changed = true;
+	}
+	if (MultiXactIdIsValid(minmxid) &&
+		MultiXactIdPrecedes(entry->minmxid, minmxid))
+	{
+		entry->minmxid = minmxid;
+		changed = true;
+	}
+
+	if (changed)
+		GlobalTempUpdateHorizons();
+}
+
+/*
+ * GlobalTempRelationHasStorage
+ *		Has this session created its storage for a global temporary relation?
+ */
+bool
+GlobalTempRelationHasStorage(Relation rel)
+{
+	return GlobalTempStorageLookup(rel) != NULL;
+}
+
+/*
+ * Return the entry for the relation, if this session has storage for it.
+ */
+static GlobalTempStorage *
+GlobalTempStorageLookup(Relation rel)
+{
+	GlobalTempStorage *entry;
+
+	if (GlobalTempStorageHash == NULL)
+		return NULL;
+
+	entry = hash_search(GlobalTempStorageHash, &rel->rd_id, HASH_FIND, NULL);
+	if (entry == NULL || entry->sharedNumber != rel->rd_rel->relfilenode)
+		return NULL;
+
+	return entry;
+}
+
+/*
+ * GlobalTempMapRelFileNumber
+ *		Return the relfilenumber of this session's storage for a global
+ *		temporary relation, given its OID and pg_class.relfilenode.
+ *
+ * That's the shared relfilenumber, unless the session has given the relation
+ * new storage.
+ */
+RelFileNumber
+GlobalTempMapRelFileNumber(Oid relid, RelFileNumber relfilenumber)
+{
+	GlobalTempStorage *entry;
+
+	if (GlobalTempStorageHash == NULL)
+		return relfilenumber;
+
+	entry = hash_search(GlobalTempStorageHash, &relid, HASH_FIND, NULL);
+	if (entry == NULL || entry->sharedNumber != relfilenumber)
+		return relfilenumber;
+
+	return entry->locator.locator.relNumber;
+}
+
+/*
+ * GlobalTempRelationRemember
+ *		Record that this session has storage for a global temporary relation.
+ *
+ * This is called once the storage has been created, including by
+ * heap_create() for the session that creates the relation.
+ */
+void
+GlobalTempRelationRemember(Relation rel)
+{
+	GlobalTempStorage *entry;
+	bool		found;
+
+	Assert(RelationIsGlobalTemp(rel));
+
+	if (GlobalTempStorageHash == NULL)
+	{
+		HASHCTL		ctl;
+
+		ctl.keysize = sizeof(Oid);
+		ctl.entrysize = sizeof(GlobalTempStorage);
+		ctl.hcxt = TopMemoryContext;
+		GlobalTempStorageHash = hash_create("Global temporary storage", 64,
+											&ctl,
+											HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+		CacheRegisterRelcacheCallback(GlobalTempRelcacheCallback, (Datum) 0);
+		before_shmem_exit(GlobalTempStorageAtExit, 0);
+	}
+
+	entry = hash_search(GlobalTempStorageHash, &rel->rd_id, HASH_ENTER, &found);
+	if (found)
+	{
+		/* forget about a dropped relation that had the same OID */
+		numGlobalTempSavedNumbers -= list_length(entry->savedNumbers);
+		list_free_deep(entry->savedNumbers);
+		if (entry->dropped)
+			numGlobalTempDropped--;
+	}
+	entry->sharedNumber = rel->rd_rel->relfilenode;
+	entry->locator.locator = rel->rd_locator;
+	entry->locator.backend = rel->rd_backend;
+	entry->frozenxid = InvalidTransactionId;
+	entry->minmxid = InvalidMultiXactId;
+	entry->savedNumbers = NIL;
+	entry->checkDropped = false;
+	entry->dropped = false;
+
+	/*
+	 * Advertise the table's horizons before putting anything into the
+	 * storage.  Our own transaction's XID is the only one older than the
+	 * next XID that the contents could hold.
+	 */
+	if (RELKIND_HAS_TABLE_AM(rel->rd_rel->relkind))
+	{
+		TransactionId xid = ReadNextTransactionId();
+		TransactionId topxid = GetTopTransactionIdIfAny();
+
+		if (TransactionIdIsValid(topxid) && TransactionIdPrecedes(topxid, xid))
+			xid = topxid;
+		entry->frozenxid = xid;
+		entry->minmxid = ReadNextMultiXactId();
+	}
+	GlobalTempUpdateHorizons();
+}
+
+/*
+ * GlobalTempRelationSetNewRelfilenumber
+ *		Give this session's contents of a global temporary relation new,
+ *		empty storage.  This is RelationSetNewRelfilenumber() for these
+ *		relations.
+ *
+ * If the session has no storage for the relation yet, there is nothing to
+ * replace.
+ */
+void
+GlobalTempRelationSetNewRelfilenumber(Relation relation)
+{
+	GlobalTempStorage *entry = GlobalTempStorageLookup(relation);
+	SubTransactionId mySubid = GetCurrentSubTransactionId();
+	RelFileLocator newrlocator;
+	TransactionId freezeXid = InvalidTransactionId;
+	MultiXactId minmulti = InvalidMultiXactId;
+
+	if (entry == NULL)
+		return;
+
+	newrlocator = relation->rd_locator;
+	newrlocator.relNumber =
+		GetNewRelFileNumber(relation->rd_rel->reltablespace, NULL,
+							RELPERSISTENCE_GLOBAL_TEMP);
+
+	/* The old storage goes away at commit, the new one at abort */
+	RelationDropStorage(relation);
+	if (RELKIND_HAS_TABLE_AM(relation->rd_rel->relkind))
+		table_relation_set_new_filelocator(relation, &newrlocator,
+										   RELPERSISTENCE_GLOBAL_TEMP,
+										   &freezeXid, &minmulti);
+	else
+	{
+		SMgrRelation srel;
+
+		srel = RelationCreateStorage(newrlocator, RELPERSISTENCE_GLOBAL_TEMP,
+									 true);
+		smgrclose(srel);
+	}
+
+	/*
+	 * Remember which storage to go back to if this subtransaction aborts.
+	 * If it has replaced the storage before, that's saved already.
+	 */
+	if (entry->savedNumbers == NIL ||
+		((GlobalTempSavedNumber *) linitial(entry->savedNumbers))->subid != mySubid)
+	{
+		MemoryContext oldcxt = MemoryContextSwitchTo(TopMemoryContext);
+		GlobalTempSavedNumber *saved = palloc(sizeof(GlobalTempSavedNumber));
+
+		saved->subid = mySubid;
+		saved->relNumber = entry->locator.locator.relNumber;
+		saved->frozenxid = entry->frozenxid;
+		saved->minmxid = entry->minmxid;
+		entry->savedNumbers = lcons(saved, entry->savedNumbers);
+		numGlobalTempSavedNumbers++;
+		MemoryContextSwitchTo(oldcxt);
+	}
+	entry->locator.locator.relNumber = newrlocator.relNumber;
+	entry->frozenxid = freezeXid;
+	entry->minmxid = minmulti;
+	GlobalTempUpdateHorizons();
+
+	/*
+	 * Have the relcache entry pick up the new storage.  The invalidation is
+	 * also replayed locally if we abort, so it then returns to the old one.
+	 */
+	CacheInvalidateRelcache(relation);
+	CommandCounterIncrement();
+
+	RelationAssumeNewRelfilelocator(relation);
+}
+
+/*
+ * GlobalTempRelationInitStorage
+ *		Make sure this session has storage for a global temporary relation,
+ *		and for its indexes.
+ *
+ * Called before inserting into or scanning such a relation.  The caller must
+ * hold a lock on the relation.
+ */
+void
+GlobalTempRelationInitStorage(Relation rel)
+{
+	SMgrRelation srel;
+
+	Assert(RelationIsGlobalTemp(rel));
+
+	if (GlobalTempStorageLookup(rel) != NULL)
+		return;
+
+	/* parallel query is not allowed on these tables anyway */
+	if (IsParallelWorker())
+		return;
+
+	if (rel->rd_rel->relkind == RELKIND_INDEX)
+	{
+		Relation	heap;
+
+		/*
+		 * Creating the table's storage builds all of its indexes.  If the
+		 * table's storage existed already, this index must be new.
+		 */
+		heap = relation_open(IndexGetRelation(RelationGetRelid(rel), false),
+							 AccessShareLock);
+		GlobalTempRelationInitStorage(heap);
+		if (GlobalTempStorageLookup(rel) == NULL)
+			GlobalTempBuildIndex(heap, rel);
+		relation_close(heap, AccessShareLock);
+		return;
+	}
+
+	/* throw away whatever a failed attempt left */
+	srel = RelationGetSmgr(rel);
+	if (smgrexists(srel, MAIN_FORKNUM))
+		RelationTruncate(rel, 0);
+	else
+		smgrcreate(srel, MAIN_FORKNUM, false);
+
+	/* remember the table before its indexes look for it */
+	GlobalTempRelationRemember(rel);
+
+	GlobalTempRelationInitIndexes(rel);
+}
+
+/*
+ * GlobalTempRelationInitIndexes
+ *		Build this session's copies of the indexes of a global temporary
+ *		table that it hasn't built yet.
+ *
+ * The session must have storage for the table.  This is for callers that
+ * process the indexes without scanning them first, like VACUUM.
+ */
+void
+GlobalTempRelationInitIndexes(Relation heap)
+{
+	List	   *indexoids;
+	ListCell   *lc;
+
+	Assert(GlobalTempStorageLookup(heap) != NULL);
+
+	if (!heap->rd_rel->relhasindex)
+		return;
+
+	indexoids = RelationGetIndexList(heap);
+	foreach(lc, indexoids)
+	{
+		Relation	index = index_open(lfirst_oid(lc), AccessShareLock);
+
+		if (GlobalTempStorageLookup(index) == NULL)
+			GlobalTempBuildIndex(heap, index);
+		index_close(index, AccessShareLock);
+	}
+	list_free(indexoids);
+}
+
+/*
+ * GlobalTempBuildIndex
+ *		Build an index of a global temporary table over the session's contents
+ *		of the table, discarding whatever the session's copy held before.
+ *
+ * Unlike index_build(), this doesn't update the index's statistics in
+ * pg_class, which are shared by all sessions.
+ */
+static void
+GlobalTempBuildIndex(Relation heap, Relation index)
+{
+	SMgrRelation srel = RelationGetSmgr(index);
+	IndexInfo  *indexInfo;
+
+	/* throw away the old contents, or whatever a failed attempt left */
+	if (smgrexists(srel, MAIN_FORKNUM))
+		RelationTruncate(index, 0);
+	else
+		smgrcreate(srel, MAIN_FORKNUM, false);
+
+	indexInfo = BuildIndexInfo(index);
+	(void) index->rd_indam->ambuild(heap, index, indexInfo);
+
+	GlobalTempRelationRemember(index);
+}
+
+/*
+ * Note the relations whose relcache entries are invalidated, so that
+ * PreCommit_GlobalTemp() checks whether they have been dropped.
+ */
+static void
+GlobalTempRelcacheCallback(Datum arg, Oid relid)
+{
+	GlobalTempStorage *entry;
+
+	if (OidIsValid(relid))
+	{
+		entry = hash_search(GlobalTempStorageHash, &relid, HASH_FIND, NULL);
+		if (entry == NULL)
+			return;
+		entry->checkDropped = true;
+	}
+	else
+	{
+		HASH_SEQ_STATUS status;
+
+		hash_seq_init(&status, GlobalTempStorageHash);
+		while ((entry = hash_seq_search(&status)) != NULL)
+			entry->checkDropped = true;
+	}
+	globalTempCheckDropped = true;
+}
+
+/*
+ * PreCommit_GlobalTemp
+ *		Find the relations this session has storage for that have been
+ *		dropped, by this transaction or by a transaction another session
+ *		committed, so that AtEOXact_GlobalTemp() removes their storage.
+ */
+void
+PreCommit_GlobalTemp(void)
+{
+	HASH_SEQ_STATUS status;
+	GlobalTempStorage *entry;
+
+	if (!globalTempCheckDropped)
+		return;
+	globalTempCheckDropped = false;
+
+	hash_seq_init(&status, GlobalTempStorageHash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		HeapTuple	tuple;
+		bool		dropped = true;
+
+		if (!entry->checkDropped || entry->dropped)
+			continue;
+		entry->checkDropped = false;
+
+		tuple = SearchSysCache1(RELOID, ObjectIdGetDatum(entry->relid));
+		if (HeapTupleIsValid(tuple))
+		{
+			Form_pg_class classForm = (Form_pg_class) GETSTRUCT(tuple);
+
+			dropped = (classForm->relfilenode != entry->sharedNumber);
+			ReleaseSysCache(tuple);
+		}
+
+		if (dropped)
+		{
+			entry->dropped = true;
+			numGlobalTempDropped++;
+		}
+	}
+}
+
+/*
+ * AtEOXact_GlobalTemp
+ *		Forget the saved storage at commit, or go back to it at abort.  Also
+ *		remove the storage of dropped relations at commit.
+ */
+void
+AtEOXact_GlobalTemp(bool isCommit)
+{
+	HASH_SEQ_STATUS status;
+	GlobalTempStorage *entry;
+
+	if (numGlobalTempSavedNumbers == 0 && numGlobalTempDropped == 0)
+		return;
+
+	hash_seq_init(&status, GlobalTempStorageHash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (entry->savedNumbers != NIL)
+		{
+			/*
+			 * The outermost entry has the storage from before the
+			 * transaction.
+			 */
+			if (!isCommit)
+			{
+				GlobalTempSavedNumber *saved = llast(entry->savedNumbers);
+
+				entry->locator.locator.relNumber = saved->relNumber;
+				entry->frozenxid = saved->frozenxid;
+				entry->minmxid = saved->minmxid;
+			}
+
+			list_free_deep(entry->savedNumbers);
+			entry->savedNumbers = NIL;
+		}
+
+		if (!entry->dropped)
+			continue;
+
+		if (isCommit)
+		{
+			SMgrRelation srel = smgropen(entry->locator.locator,
+										 entry->locator.backend);
+
+			smgrdounlinkall(&srel, 1, false);
+			smgrclose(srel);
+			hash_search(GlobalTempStorageHash, &entry->relid, HASH_REMOVE,
+						NULL);
+		}
+		else
+		{
+			/* check again at the next commit */
+			entry->dropped = false;
+			entry->checkDropped = true;
+			globalTempCheckDropped = true;
+		}
+	}
+	numGlobalTempSavedNumbers = 0;
+	numGlobalTempDropped = 0;
+
+	/*
+	 * The replaced storage's horizons, and those of dropped relations, no
+	 * longer hold us back.
+	 */
+	GlobalTempUpdateHorizons();
+}
+
+/*
+ * AtEOSubXact_GlobalTemp
+ *		Hand the saved storage over to the parent at subtransaction commit,
+ *		or go back to it at subtransaction abort.
+ */
+void
+AtEOSubXact_GlobalTemp(bool isCommit, SubTransactionId mySubid,
+					   SubTransactionId parentSubid)
+{
+	HASH_SEQ_STATUS status;
+	GlobalTempStorage *entry;
+
+	if (numGlobalTempSavedNumbers == 0)
+		return;
+
+	hash_seq_init(&status, GlobalTempStorageHash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		GlobalTempSavedNumber *saved;
+
+		if (entry->savedNumbers == NIL)
+			continue;
+		saved = (GlobalTempSavedNumber *) linitial(entry->savedNumbers);
+		if (saved->subid != mySubid)
+			continue;
+
+		if (isCommit &&
+			(list_length(entry->savedNumbers) == 1 ||
+			 ((GlobalTempSavedNumber *) lsecond(entry->savedNumbers))->subid != parentSubid))
+		{
+			saved->subid = parentSubid;
+			continue;
+		}
+
+		/*
+		 * At abort, go back to the storage saved by this subtransaction.  At
+		 * commit, the parent has saved older storage already.
+		 */
+		if (!isCommit)
+		{
+			entry->locator.locator.relNumber = saved->relNumber;
+			entry->frozenxid = saved->frozenxid;
+			entry->minmxid = saved->minmxid;
+		}
+		entry->savedNumbers = list_delete_first(entry->savedNumbers);
+		pfree(saved);
+		numGlobalTempSavedNumbers--;
+	}
+}
+
+/*
+ * Remove this session's storage at exit.  If we're exiting in the middle of
+ * a transaction, remove the storage it replaced, too.
+ */
+static void
+GlobalTempStorageAtExit(int code, Datum arg)
+{
+	HASH_SEQ_STATUS status;
+	GlobalTempStorage *entry;
+
+	hash_seq_init(&status, GlobalTempStorageHash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		SMgrRelation srel = smgropen(entry->locator.locator,
+									 entry->locator.backend);
+		ListCell   *lc;
+
+		smgrdounlinkall(&srel, 1, false);
+		smgrclose(srel);
+
+		foreach(lc, entry->savedNumbers)
+		{
+			GlobalTempSavedNumber *saved = lfirst(lc);
+			RelFileLocator rlocator = entry->locator.locator;
+
+			rlocator.relNumber = saved->relNumber;
+			srel = smgropen(rlocator, entry->locator.backend);
+			smgrdounlinkall(&srel, 1, false);
+			smgrclose(srel);
+		}
+	}
+
+	if (MyProcNumber < MaxBackends)
+	{
+		GlobalTempHorizons[MyProcNumber].frozenxid = InvalidTransactionId;
+		GlobalTempHorizons[MyProcNumber].minmxid = InvalidMultiXactId;
+		GlobalTempHorizons[MyProcNumber].dbid = InvalidOid;
+	}
+}
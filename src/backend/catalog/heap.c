@@ -36,6 +36,7 @@
 #include "access/tableam.h"
 #include "catalog/binary_upgrade.h"
 #include "catalog/catalog.h"
+#include "catalog/globaltemp.h"
 #include "catalog/heap.h"
 #include "catalog/index.h"
 #include "catalog/objectaccess.h"
@@ -389,6 +390,9 @@ heap_create(const char *relname,
 			RelationCreateStorage(rel->rd_locator, relpersistence, true);
 		else
 			Assert(false);
+
+		if (relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+			GlobalTempRelationRemember(rel);
 	}
 
 	/*
@@ -36,8 +36,10 @@
 #include "catalog/binary_upgrade.h"
 #include "catalog/catalog.h"
 #include "catalog/dependency.h"
+#include "catalog/globaltemp.h"
 #include "catalog/heap.h"
 #include "catalog/index.h"
+#include "catalog/indexcapture.h"
 #include "catalog/objectaccess.h"
 #include "catalog/partition.h"
 #include "catalog/pg_am.h"
@@ -127,6 +129,12 @@ static void IndexCheckExclusion(Relation heapRelation,
 								Relation indexRelation,
 								IndexInfo *indexInfo);
 static bool validate_index_callback(ItemPointer itemptr, void *opaque);
+static void validate_index_captured(Relation heapRelation,
+									Relation indexRelation,
+									IndexInfo *indexInfo,
+									Snapshot snapshot,
+									ValidateIndexState *state,
+									int64 *captured, int64 ncaptured);
 static bool ReindexIsCurrentlyProcessingIndex(Oid indexOid);
 static void SetReindexProcessing(Oid heapOid, Oid indexOid);
 static void ResetReindexProcessing(void);
@@ -3018,6 +3026,14 @@ index_build(Relation heapRelation,
 	Assert(indexRelation->rd_indam->ambuild);
 	Assert(indexRelation->rd_indam->ambuildempty);
 
+	/*
+	 * A session that has no copy of a global temporary index, say because
+	 * REINDEX found none, builds it when it first uses the index.
+	 */
+	if (RelationIsGlobalTemp(indexRelation) &&
+		!GlobalTempRelationHasStorage(indexRelation))
+		return;
+
 	/*
 	 * Determine worker process details for parallel CREATE INDEX.  Currently,
 	 * only btree, GIN, and BRIN have support for parallel builds.
@@ -3150,15 +3166,20 @@ index_build(Relation heapRelation,
 	}
 
 	/*
-	 * Update heap and index pg_class rows
+	 * Update heap and index pg_class rows.  The statistics of a global
+	 * temporary table are shared by all sessions, so don't overwrite them
+	 * with what this session's contents look like.
 	 */
-	index_update_stats(heapRelation,
-					   true,
-					   stats->heap_tuples);
+	if (!RelationIsGlobalTemp(heapRelation))
+	{
+		index_update_stats(heapRelation,
+						   true,
+						   stats->heap_tuples);
 
-	index_update_stats(indexRelation,
-					   false,
-					   stats->index_tuples);
+		index_update_stats(indexRelation,
+						   false,
+						   stats->index_tuples);
+	}
 
 	/* Make the updated catalog row versions visible */
 	CommandCounterIncrement();
@@ -3341,10 +3362,16 @@ IndexCheckExclusion(Relation heapRelation,
  * not index).  Then we mark the index "indisvalid" and commit.  Subsequent
  * transactions will be able to use it for queries.
  *
- * Doing two full table scans is a brute-force strategy.  We could try to be
- * cleverer, eg storing new tuples in a special area of the table (perhaps
- * making the table append-only by setting use_fsm).  However that would
- * add yet more locking issues.
+ * Doing two full table scans is a brute-force strategy.  So if the caller
+ * arranged for the tuples inserted while the index was not ready for inserts
+ * to be captured (see indexcapture.c), we merge the TID list against those
+ * tuples only, fetching them one by one, instead of scanning the table.  Any
+ * tuple valid according to the reference snapshot but missing from the
+ * index either was inserted by such a transaction, or belongs to the HOT
+ * chain of such a tuple.  (Transactions that inserted tuples before any
+ * session could see the index have committed before the build's snapshot
+ * was taken, so the build indexed those.)  We fall back to the table scan if
+ * some of the tuples could not be captured.
  */
 void
 validate_index(Oid heapId, Oid indexId, Snapshot snapshot)
@@ -3354,6 +3381,8 @@ validate_index(Oid heapId, Oid indexId, Snapshot snapshot)
 	IndexInfo  *indexInfo;
 	IndexVacuumInfo ivinfo;
 	ValidateIndexState state;
+	int64	   *captured;
+	int64		ncaptured;
 	Oid			save_userid;
 	int			save_sec_context;
 	int			save_nestlevel;
@@ -3445,15 +3474,28 @@ validate_index(Oid heapId, Oid indexId, Snapshot snapshot)
 	tuplesort_performsort(state.tuplesort);
 
 	/*
-	 * Now scan the heap and "merge" it with the index
+	 * Now scan the heap, or just the captured tuples if we have them, and
+	 * "merge" it with the index
 	 */
 	pgstat_progress_update_param(PROGRESS_CREATEIDX_PHASE,
 								 PROGRESS_CREATEIDX_PHASE_VALIDATE_TABLESCAN);
-	table_index_validate_scan(heapRelation,
-							  indexRelation,
-							  indexInfo,
-							  snapshot,
-							  &state);
+	captured = IndexCaptureCollect(indexId, &ncaptured);
+	if (captured != NULL)
+	{
+		validate_index_captured(heapRelation,
+								indexRelation,
+								indexInfo,
+								snapshot,
+								&state,
+								captured, ncaptured);
+		pfree(captured);
+	}
+	else
+		table_index_validate_scan(heapRelation,
+								  indexRelation,
+								  indexInfo,
+								  snapshot,
+								  &state);
 
 	/* Done with tuplesort object */
 	tuplesort_end(state.tuplesort);
@@ -3490,6 +3532,140 @@ validate_index_callback(ItemPointer itemptr, void *opaque)
 	return false;				/* never actually delete anything */
 }
 
+/*
+ * validate_index_captured - merge the captured tuples with the index
+ *
+ * This does the same as table_index_validate_scan(), but only looks at the
+ * tuples whose TIDs are in the sorted captured[] array.  Those are the roots
+ * of their HOT chains, and we insert the member of the chain that is valid
+ * according to the reference snapshot, if any, under the root's TID.
+ */
+static void
+validate_index_captured(Relation heapRelation,
+						Relation indexRelation,
+						IndexInfo *indexInfo,
+						Snapshot snapshot,
+						ValidateIndexState *state,
+						int64 *captured, int64 ncaptured)
+{
+	IndexFetchTableData *fetch;
+	Datum		values[INDEX_MAX_KEYS];
+	bool		isnull[INDEX_MAX_KEYS];
+	ExprState  *predicate;
+	TupleTableSlot *slot;
+	EState	   *estate;
+	ExprContext *econtext;
+	int64		indexcursor = 0;
+	bool		tuplesort_empty = false;
+
+	pgstat_progress_update_param(PROGRESS_CREATEIDX_TUPLES_TOTAL, ncaptured);
+
+	/*
+	 * Need an EState for evaluation of index expressions and partial-index
+	 * predicates.  Also a slot to hold the current tuple.
+	 */
+	estate = CreateExecutorState();
+	econtext = GetPerTupleExprContext(estate);
+	slot = table_slot_create(heapRelation, NULL);
+
+	/* Arrange for econtext's scan tuple to be the tuple under test */
+	econtext->ecxt_scantuple = slot;
+
+	/* Set up execution state for predicate, if any. */
+	predicate = ExecPrepareQual(indexInfo->ii_Predicate, estate);
+
+	fetch = table_index_fetch_begin(heapRelation);
+
+	for (int64 i = 0; i < ncaptured; i++)
+	{
+		ItemPointerData rootTuple;
+		ItemPointerData tid;
+		bool		call_again = false;
+		bool		all_dead = false;
+
+		CHECK_FOR_INTERRUPTS();
+
+		pgstat_progress_update_param(PROGRESS_CREATEIDX_TUPLES_DONE, i);
+
+		/*
+		 * "merge" by skipping through the index tuples until we find or pass
+		 * the current captured tuple.
+		 */
+		while (!tuplesort_empty && indexcursor < captured[i])
+		{
+			Datum		ts_val;
+			bool		ts_isnull;
+
+			tuplesort_empty = !tuplesort_getdatum(state->tuplesort, true,
+												  false, &ts_val, &ts_isnull,
+												  NULL);
+			Assert(tuplesort_empty || !ts_isnull);
+			if (!tuplesort_empty)
+				indexcursor = DatumGetInt64(ts_val);
+		}
+
+		/* Already in the index? */
+		if (!tuplesort_empty && indexcursor == captured[i])
+			continue;
+
+		MemoryContextReset(econtext->ecxt_per_tuple_memory);
+
+		/*
+		 * Fetch the member of the HOT chain valid for the snapshot, if any.
+		 * This moves tid to that member.
+		 */
+		itemptr_decode(&rootTuple, captured[i]);
+		tid = rootTuple;
+		if (!table_index_fetch_tuple(fetch, &tid, snapshot, slot,
+									 &call_again, &all_dead))
+			continue;
+
+		state->htups += 1;
+
+		/*
+		 * In a partial index, discard tuples that don't satisfy the
+		 * predicate.
+		 */
+		if (predicate != NULL)
+		{
+			if (!ExecQual(predicate, econtext))
+				continue;
+		}
+
+		FormIndexDatum(indexInfo,
+					   slot,
+					   estate,
+					   values,
+					   isnull);
+
+		/*
+		 * As in table_index_validate_scan(), don't suppress the uniqueness
+		 * check: the insert stands for a check on the whole HOT chain.
+		 */
+		index_insert(indexRelation,
+					 values,
+					 isnull,
+					 &rootTuple,
+					 heapRelation,
+					 indexInfo->ii_Unique ?
+					 UNIQUE_CHECK_YES : UNIQUE_CHECK_NO,
+					 false,
+					 indexInfo);
+
+		state->tups_inserted += 1;
+	}
+
+	table_index_fetch_end(fetch);
+
+	ExecDropSingleTupleTableSlot(slot);
+
+	FreeExecutorState(estate);
+
+	/* These may have been pointing to the now-gone estate */
+	indexInfo->ii_ExpressionsState = NIL;
+	indexInfo->ii_PredicateState = NULL;
+}
+
 /*
  * index_set_state_flags - adjust pg_index state flags
  *
@@ -0,0 +1,315 @@
+/*-------------------------------------------------------------------------
+ *
+ * indexcapture.c
+ *	  Capture of tuples inserted during concurrent index builds.
+ *
+ * CREATE INDEX CONCURRENTLY builds the index from a snapshot, and then has
+ * to find the tuples that were inserted while the build was running, but
+ * were not visible to the build's snapshot.  Without any help, that takes
+ * a second scan of the whole table (see validate_index()).  To avoid it,
+ * the backend running the build claims a slot in shared memory before the
+ * index becomes visible to other sessions.  As long as they see the index
+ * as not yet ready for inserts, sessions inserting into the table remember
+ * the TIDs of their new tuples in that slot instead of inserting them into
+ * the index, and validation only needs to look at those tuples.
+ *
+ * There are only a few slots, each holding a fixed number of TIDs.  If no
+ * slot is free when the build starts, or its slot fills up, the build falls
+ * back to scanning the whole table.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/catalog/indexcapture.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "catalog/index.h"
+#include "catalog/indexcapture.h"
+#include "common/int.h"
+#include "lib/qunique.h"
+#include "miscadmin.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+
+/* Number of index builds that can capture their tuples at once */
+#define NUM_INDEX_CAPTURE_SLOTS		4
+
+typedef struct IndexCaptureSlot
+{
+	slock_t		mutex;			/* protects all the fields below */
+	Oid			dbid;			/* database of the index */
+	Oid			indexOid;		/* index being built, or InvalidOid */
+	ProcNumber	owner;			/* backend running the build */
+	bool		overflowed;		/* did we run out of space for TIDs? */
+	int			ntids;			/* number of entries in tids[] */
+	ItemPointerData tids[FLEXIBLE_ARRAY_MEMBER];
+} IndexCaptureSlot;
+
+/* GUC parameters */
+int			concurrent_index_capture_size = 0;	/* in kilobytes */
+
+static char *IndexCaptureShmem = NULL;
+
+static int	capture_slot_tids(void);
+static Size capture_slot_size(void);
+static IndexCaptureSlot *capture_slot(int i);
+static int	capture_cmp_tids(const void *a, const void *b);
+
+/* Maximum number of TIDs in each slot */
+static int
+capture_slot_tids(void)
+{
+	return ((Size) concurrent_index_capture_size * 1024) /
+		sizeof(ItemPointerData);
+}
+
+static Size
+capture_slot_size(void)
+{
+	return MAXALIGN(add_size(offsetof(IndexCaptureSlot, tids),
+							 mul_size(capture_slot_tids(),
+									  sizeof(ItemPointerData))));
+}
+
+static IndexCaptureSlot *
+capture_slot(int i)
+{
+	return (IndexCaptureSlot *) (IndexCaptureShmem + i * capture_slot_size());
+}
+
+Size
+IndexCaptureShmemSize(void)
+{
+	if (concurrent_index_capture_size == 0)
+		return 0;
+
+	return mul_size(NUM_INDEX_CAPTURE_SLOTS, capture_slot_size());
+}
+
+void
+IndexCaptureShmemInit(void)
+{
+	bool		found;
+
+	if (concurrent_index_capture_size == 0)
+		return;
+
+	IndexCaptureShmem = (char *)
+		ShmemInitStruct("Index Build Capture", IndexCaptureShmemSize(),
+						&found);
+	if (!found)
+	{
+		for (int i = 0; i < NUM_INDEX_CAPTURE_SLOTS; i++)
+		{
+			IndexCaptureSlot *slot = capture_slot(i);
+
+			SpinLockInit(&slot->mutex);
+			slot->dbid = InvalidOid;
+			slot->indexOid = InvalidOid;
+			slot->owner = INVALID_PROC_NUMBER;
+			slot->overflowed = false;
+			slot->ntids = 0;
+		}
+	}
+}
+
+/*
+ * IndexCaptureBegin
+ *
+ * Start capturing the tuples inserted while the given index is being built.
+ * This must be called before the index becomes visible to other sessions.
+ * Returns false if no slot is available, in which case the build has to
+ * validate the index by scanning the whole table.
+ */
+bool
+IndexCaptureBegin(Oid indexId)
+{
+	if (IndexCaptureShmem == NULL)
+		return false;
+
+	for (int i = 0; i < NUM_INDEX_CAPTURE_SLOTS; i++)
+	{
+		IndexCaptureSlot *slot = capture_slot(i);
+
+		SpinLockAcquire(&slot->mutex);
+		if (!OidIsValid(slot->indexOid))
+		{
+			slot->dbid = MyDatabaseId;
+			slot->indexOid = indexId;
+			slot->owner = MyProcNumber;
+			slot->overflowed = false;
+			slot->ntids = 0;
+			SpinLockRelease(&slot->mutex);
+			return true;
+		}
+		SpinLockRelease(&slot->mutex);
+	}
+
+	return false;
+}
+
+/*
+ * IndexCaptureRecord
+ *
+ * Remember a tuple inserted into a table while the given index is being
+ * built and not yet ready for inserts.  Does nothing if the build isn't
+ * capturing its tuples.
+ *
+ * OIDs are only unique within a database, so the slot must be for an index
+ * of our database.
+ */
+void
+IndexCaptureRecord(Oid indexId, ItemPointer tid)
+{
+	if (IndexCaptureShmem == NULL)
+		return;
+
+	for (int i = 0; i < NUM_INDEX_CAPTURE_SLOTS; i++)
+	{
+		IndexCaptureSlot *slot = capture_slot(i);
+
+		/* Unlocked precheck, to avoid taking the locks of other builds */
+		if (slot->indexOid != indexId || slot->dbid != MyDatabaseId)
+			continue;
+
+		SpinLockAcquire(&slot->mutex);
+		if (slot->indexOid != indexId || slot->dbid != MyDatabaseId)
+		{
+			SpinLockRelease(&slot->mutex);
+			continue;
+		}
+		if (!slot->overflowed)
+		{
+			if (slot->ntids < capture_slot_tids())
+				slot->tids[slot->ntids++] = *tid;
+			else
+				slot->overflowed = true;
+		}
+		SpinLockRelease(&slot->mutex);
+		return;
+	}
+}
+
+/*
+ * IndexCaptureCollect
+ *
+ * Return the TIDs captured for the given index, encoded with
+ * itemptr_encode() and sorted, with their number in *ntids.  Returns NULL
+ * if the build isn't capturing its tuples, or lost some of them.
+ *
+ * All the sessions that might still be recording tuples must be gone when
+ * this is called.
+ */
+int64 *
+IndexCaptureCollect(Oid indexId, int64 *ntids)
+{
+	if (IndexCaptureShmem == NULL)
+		return NULL;
+
+	for (int i = 0; i < NUM_INDEX_CAPTURE_SLOTS; i++)
+	{
+		IndexCaptureSlot *slot = capture_slot(i);
+		int64	   *result;
+		int			n;
+
+		SpinLockAcquire(&slot->mutex);
+		if (slot->indexOid != indexId || slot->owner != MyProcNumber)
+		{
+			SpinLockRelease(&slot->mutex);
+			continue;
+		}
+		if (slot->overflowed)
+		{
+			SpinLockRelease(&slot->mutex);
+			elog(DEBUG1, "too many tuples inserted while building index %u, cannot use captured tuples",
+				 indexId);
+			return NULL;
+		}
+		n = slot->ntids;
+		SpinLockRelease(&slot->mutex);
+
+		/*
+		 * Nobody adds entries anymore, so we can copy them out without
+		 * holding the spinlock.
+		 */
+		result = palloc_array(int64, Max(n, 1));
+		for (int j = 0; j < n; j++)
+			result[j] = itemptr_encode(&slot->tids[j]);
+
+		qsort(result, n, sizeof(int64), capture_cmp_tids);
+		*ntids = qunique(result, n, sizeof(int64), capture_cmp_tids);
+
+		return result;
+	}
+
+	return NULL;
+}
+
+/*
+ * IndexCaptureEnd
+ *
+ * Stop capturing the tuples inserted for the given index, and release its
+ * slot.
+ */
+void
+IndexCaptureEnd(Oid indexId)
+{
+	if (IndexCaptureShmem == NULL)
+		return;
+
+	for (int i = 0; i < NUM_INDEX_CAPTURE_SLOTS; i++)
+	{
+		IndexCaptureSlot *slot = capture_slot(i);
+
+		SpinLockAcquire(&slot->mutex);
+		if (slot->indexOid == indexId && slot->owner == MyProcNumber)
+		{
+			slot->dbid = InvalidOid;
+			slot->indexOid = InvalidOid;
+			slot->owner = INVALID_PROC_NUMBER;
+		}
+		SpinLockRelease(&slot->mutex);
+	}
+}
+
+/*
+ * AtAbort_IndexCapture
+ *
+ * Release the slots of any index build this backend was running.  The build
+ * has failed, and the index will never become ready.
+ */
+void
+AtAbort_IndexCapture(void)
+{
+	if (IndexCaptureShmem == NULL)
+		return;
+
+	for (int i = 0; i < NUM_INDEX_CAPTURE_SLOTS; i++)
+	{
+		IndexCaptureSlot *slot = capture_slot(i);
+
+		/* Unlocked precheck; only we can set the owner to ourselves */
+		if (slot->owner != MyProcNumber)
+			continue;
+
+		SpinLockAcquire(&slot->mutex);
+		if (slot->owner == MyProcNumber)
+		{
+			slot->dbid = InvalidOid;
+			slot->indexOid = InvalidOid;
+			slot->owner = INVALID_PROC_NUMBER;
+		}
+		SpinLockRelease(&slot->mutex);
+	}
+}
+
+static int
+capture_cmp_tids(const void *a, const void *b)
+{
+	return pg_cmp_s64(*(const int64 *) a, *(const int64 *) b);
+}
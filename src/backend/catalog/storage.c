@@ -131,6 +131,7 @@ RelationCreateStorage(RelFileLocator rlocator, char relpersistence,
 	switch (relpersistence)
 	{
 		case RELPERSISTENCE_TEMP:
+		case RELPERSISTENCE_GLOBAL_TEMP:
 			procNumber = ProcNumberForTempRelations();
 			needs_wal = false;
 			break;
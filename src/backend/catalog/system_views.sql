@@ -692,6 +692,9 @@ GRANT SELECT ON pg_backend_memory_contexts TO pg_read_all_stats;
 REVOKE EXECUTE ON FUNCTION pg_get_backend_memory_contexts() FROM PUBLIC;
 GRANT EXECUTE ON FUNCTION pg_get_backend_memory_contexts() TO pg_read_all_stats;
 
+CREATE VIEW pg_backend_cache_stats AS
+    SELECT * FROM pg_get_backend_cache_stats();
+
 -- Statistics views
 
 CREATE VIEW pg_stat_all_tables AS
@@ -925,6 +928,23 @@ CREATE VIEW pg_stat_activity AS
         LEFT JOIN pg_database AS D ON (S.datid = D.oid)
         LEFT JOIN pg_authid AS U ON (S.usesysid = U.oid);
 
+CREATE VIEW pg_stat_session_history AS
+    SELECT
+            S.sample_time,
+            S.pid,
+            S.datid,
+            D.datname,
+            S.usesysid,
+            U.rolname AS usename,
+            S.backend_type,
+            S.state,
+            S.wait_event_type,
+            S.wait_event,
+            S.query_id
+    FROM pg_stat_get_session_history() AS S
+        LEFT JOIN pg_database AS D ON (S.datid = D.oid)
+        LEFT JOIN pg_authid AS U ON (S.usesysid = U.oid);
+
 CREATE VIEW pg_stat_replication AS
     SELECT
             S.pid,
@@ -961,9 +981,28 @@ CREATE VIEW pg_stat_slru AS
             s.blks_exists,
             s.flushes,
             s.truncates,
+            s.overflowed_snapshots,
             s.stats_reset
     FROM pg_stat_get_slru() s;
 
+CREATE VIEW pg_stat_lwlock AS
+    SELECT
+            l.name,
+            l.acquisitions,
+            l.waits,
+            l.wait_time,
+            l.spin_delays,
+            l.stats_reset
+    FROM pg_stat_get_lwlock() l;
+
+CREATE VIEW pg_stat_parallel_worker_pool AS
+    SELECT
+            p.idle_workers,
+            p.active_workers,
+            p.hits,
+            p.misses
+    FROM pg_stat_get_parallel_worker_pool() p;
+
 CREATE VIEW pg_stat_wal_receiver AS
     SELECT
             s.pid,
@@ -1071,6 +1110,7 @@ CREATE VIEW pg_stat_replication_slots AS
             s.spill_txns,
             s.spill_count,
             s.spill_bytes,
+            s.spill_compressed_bytes,
             s.stream_txns,
             s.stream_count,
             s.stream_bytes,
@@ -1119,6 +1159,8 @@ CREATE VIEW pg_stat_database AS
             pg_stat_get_db_sessions_killed(D.oid) AS sessions_killed,
             pg_stat_get_db_parallel_workers_to_launch(D.oid) as parallel_workers_to_launch,
             pg_stat_get_db_parallel_workers_launched(D.oid) as parallel_workers_launched,
+            pg_stat_get_db_warm_backend_hits(D.oid) AS warm_backend_hits,
+            pg_stat_get_db_warm_backend_misses(D.oid) AS warm_backend_misses,
             pg_stat_get_db_stat_reset_time(D.oid) AS stats_reset
     FROM (
         SELECT 0 AS oid, NULL::name AS datname
@@ -1174,6 +1216,26 @@ CREATE VIEW pg_stat_archiver AS
         s.stats_reset
     FROM pg_stat_get_archiver() s;
 
+CREATE VIEW pg_stat_autovacuum_queue AS
+    SELECT
+            S.relid,
+            N.nspname AS schemaname,
+            C.relname,
+            S.needs_vacuum,
+            S.needs_analyze,
+            S.wraparound,
+            S.score
+    FROM pg_stat_get_autovacuum_queue() S
+            JOIN pg_class C ON C.oid = S.relid
+            LEFT JOIN pg_namespace N ON N.oid = C.relnamespace;
+
+CREATE VIEW pg_stat_backend_memory AS
+    SELECT
+            S.pid,
+            S.backend_type,
+            S.allocated_bytes
+    FROM pg_stat_get_backend_memory() S;
+
 CREATE VIEW pg_stat_bgwriter AS
     SELECT
         pg_stat_get_bgwriter_buf_written_clean() AS buffers_clean,
@@ -1219,6 +1281,18 @@ SELECT
        b.stats_reset
 FROM pg_stat_get_io() b;
 
+CREATE VIEW pg_stat_io_histogram AS
+SELECT
+       h.backend_type,
+       h.object,
+       h.context,
+       h.op,
+       h.bucket_lower,
+       h.bucket_upper,
+       h.count,
+       h.stats_reset
+FROM pg_stat_get_io_histogram() h;
+
 CREATE VIEW pg_stat_wal AS
     SELECT
         w.wal_records,
@@ -1226,6 +1300,8 @@ CREATE VIEW pg_stat_wal AS
         w.wal_bytes,
         w.wal_fpi_bytes,
         w.wal_buffers_full,
+        w.commit_delays,
+        w.commit_delay_time,
         w.stats_reset
     FROM pg_stat_get_wal() w;
 
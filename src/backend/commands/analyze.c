@@ -26,9 +26,11 @@
 #include "access/tupconvert.h"
 #include "access/visibilitymap.h"
 #include "access/xact.h"
+#include "catalog/globaltemp.h"
 #include "catalog/index.h"
 #include "catalog/indexing.h"
 #include "catalog/pg_inherits.h"
+#include "common/int.h"
 #include "commands/progress.h"
 #include "commands/tablecmds.h"
 #include "commands/vacuum.h"
@@ -49,6 +51,7 @@
 #include "utils/guc.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/partcache.h"
 #include "utils/pg_rusage.h"
 #include "utils/sampling.h"
 #include "utils/sortsupport.h"
@@ -78,6 +81,7 @@ static void do_analyze_rel(Relation onerel,
 						   const VacuumParams params, List *va_cols,
 						   AcquireSampleRowsFunc acquirefunc, BlockNumber relpages,
 						   bool inh, bool in_outer_xact, int elevel);
+static bool modified_since_analyze(Relation onerel);
 static void compute_index_stats(Relation onerel, double totalrows,
 								AnlIndexData *indexdata, int nindexes,
 								HeapTuple *rows, int numrows,
@@ -91,6 +95,9 @@ static int	compare_rows(const void *a, const void *b, void *arg);
 static int	acquire_inherited_sample_rows(Relation onerel, int elevel,
 										  HeapTuple *rows, int targrows,
 										  double *totalrows, double *totaldeadrows);
+static bool merge_partition_stats(Relation onerel, int elevel,
+								  int attr_cnt, VacAttrStats **vacattrstats,
+								  double *totalrows);
 static void update_attstats(Oid relid, bool inh,
 							int natts, VacAttrStats **vacattrstats);
 static Datum std_fetch_func(VacAttrStatsP stats, int rownum, bool *isNull);
@@ -172,6 +179,16 @@ analyze_rel(Oid relid, RangeVar *relation,
 		return;
 	}
 
+	/*
+	 * Nor is there anything to sample in a global temporary table that this
+	 * session hasn't used.
+	 */
+	if (RelationIsGlobalTemp(onerel) && !GlobalTempRelationHasStorage(onerel))
+	{
+		relation_close(onerel, ShareUpdateExclusiveLock);
+		return;
+	}
+
 	/*
 	 * We can ANALYZE any table except pg_statistic. See update_attstats
 	 */
@@ -234,6 +251,23 @@ analyze_rel(Oid relid, RangeVar *relation,
 		return;
 	}
 
+	/*
+	 * An incremental ANALYZE skips tables that haven't been modified since
+	 * they were last analyzed.  Tables with inheritance children are always
+	 * processed, as their inherited statistics could be outdated anyway.
+	 */
+	if ((params.options & VACOPT_INCREMENTAL) != 0 &&
+		onerel->rd_rel->relkind != RELKIND_PARTITIONED_TABLE &&
+		!onerel->rd_rel->relhassubclass &&
+		!modified_since_analyze(onerel))
+	{
+		ereport(elevel,
+				(errmsg("skipping \"%s\" --- not modified since last analyzed",
+						RelationGetRelationName(onerel))));
+		relation_close(onerel, ShareUpdateExclusiveLock);
+		return;
+	}
+
 	/*
 	 * OK, let's do it.  First, initialize progress reporting.
 	 */
@@ -272,6 +306,38 @@ analyze_rel(Oid relid, RangeVar *relation,
 	pgstat_progress_end_command();
 }
 
+/*
+ *	modified_since_analyze() -- check if a table may have changed since it
+ *		was last analyzed
+ *
+ * We go by the cumulative statistics system, counting any changes made by
+ * this backend that haven't been reported yet as well.  If we don't know,
+ * say yes.
+ */
+static bool
+modified_since_analyze(Relation onerel)
+{
+	PgStat_StatTabEntry *tabentry;
+	PgStat_TableStatus *pending;
+
+	tabentry = pgstat_fetch_stat_tabentry_ext(onerel->rd_rel->relisshared,
+											  RelationGetRelid(onerel));
+	if (tabentry == NULL ||
+		(tabentry->analyze_count == 0 && tabentry->autoanalyze_count == 0) ||
+		tabentry->mod_since_analyze > 0)
+		return true;
+
+	pending = find_tabstat_entry(RelationGetRelid(onerel));
+	if (pending != NULL &&
+		(pending->counts.changed_tuples > 0 ||
+		 pending->counts.tuples_inserted > 0 ||
+		 pending->counts.tuples_updated > 0 ||
+		 pending->counts.tuples_deleted > 0))
+		return true;
+
+	return false;
+}
+
 /*
  *	do_analyze_rel() -- analyze one relation, recursively or not
  *
@@ -526,13 +592,23 @@ do_analyze_rel(Relation onerel, const VacuumParams params,
 		targrows = minrows;
 
 	/*
-	 * Acquire the sample rows
+	 * Acquire the sample rows, unless this is an incremental ANALYZE of a
+	 * partitioned table and we can merge the statistics of the partitions
+	 * instead.
 	 */
 	rows = (HeapTuple *) palloc(targrows * sizeof(HeapTuple));
 	pgstat_progress_update_param(PROGRESS_ANALYZE_PHASE,
 								 inh ? PROGRESS_ANALYZE_PHASE_ACQUIRE_SAMPLE_ROWS_INH :
 								 PROGRESS_ANALYZE_PHASE_ACQUIRE_SAMPLE_ROWS);
-	if (inh)
+	if (inh && (params.options & VACOPT_INCREMENTAL) != 0 &&
+		onerel->rd_rel->relkind == RELKIND_PARTITIONED_TABLE &&
+		merge_partition_stats(onerel, elevel, attr_cnt, vacattrstats,
+							  &totalrows))
+	{
+		numrows = 0;
+		totaldeadrows = 0;
+	}
+	else if (inh)
 		numrows = acquire_inherited_sample_rows(onerel, elevel,
 												rows, targrows,
 												&totalrows, &totaldeadrows);
@@ -3093,3 +3169,502 @@ analyze_mcv_list(int *mcv_counts,
 	}
 	return num_mcv;
 }
+
+/*
+ * Data used by merge_partition_stats() for one value found in the MCV lists
+ * or histograms of the partitions.
+ */
+typedef struct
+{
+	Datum		value;
+	double		mcvrows;		/* rows with this value in MCV lists */
+	double		histrows;		/* rows represented by histogram bounds */
+	int			nmcvs;			/* number of MCV lists containing it */
+	bool		keep;			/* chosen for the merged MCV list? */
+} MergeStatsItem;
+
+static int
+compare_merge_stats_items(const void *a, const void *b, void *arg)
+{
+	return ApplySortComparator(((const MergeStatsItem *) a)->value, false,
+							   ((const MergeStatsItem *) b)->value, false,
+							   (SortSupport) arg);
+}
+
+static int
+compare_merge_stats_mcvs(const void *a, const void *b, void *arg)
+{
+	const MergeStatsItem *items = (const MergeStatsItem *) arg;
+	int			ia = *(const int *) a;
+	int			ib = *(const int *) b;
+
+	/* more common values first, ties in value order */
+	if (items[ia].mcvrows != items[ib].mcvrows)
+		return (items[ia].mcvrows > items[ib].mcvrows) ? -1 : 1;
+	return pg_cmp_s32(ia, ib);
+}
+
+/*
+ * merge_column_stats -- merge the statistics of one column of the partitions
+ *
+ * statstuples[] holds the partitions' pg_statistic rows for the column, and
+ * partrows[] their row counts.
+ *
+ * The null fraction and average width are simply weighted by the partitions'
+ * sizes.  The number of distinct values is the sum of those of the
+ * partitions if the column is the partition key, as partitions can't share
+ * values then; otherwise, we use the MCV lists to estimate how much the
+ * values of different partitions overlap.
+ *
+ * For scalar types, the MCV lists are added up, and the most common of the
+ * resulting values are kept; a histogram is then built from the partitions'
+ * histogram bounds, each representing the rows of its adjacent buckets, and
+ * the MCVs that were not kept.  Other kinds of statistics, including the
+ * correlation and those of types with their own typanalyze function, can't
+ * be merged and are left out.
+ */
+static void
+merge_column_stats(VacAttrStats *stats, int nparts, HeapTuple *statstuples,
+				   double *partrows, double totalrows, bool is_partkey)
+{
+	StdAnalyzeData *mystats = (StdAnalyzeData *) stats->extra_data;
+	bool		is_scalar = (stats->compute_stats == compute_scalar_stats);
+	MergeStatsItem *items = NULL;
+	int			nitems = 0;
+	int			maxitems = 64;
+	double		nullrows = 0.0;
+	double		widthsum = 0.0;
+	double		sum_distinct = 0.0;
+	double		max_distinct = 0.0;
+	double		nonnullrows;
+	double		ndistinct;
+	int			nmcventries = 0;
+	int			slot_idx = 0;
+	int			i;
+
+	if (is_scalar)
+		items = palloc_array(MergeStatsItem, maxitems);
+
+	for (i = 0; i < nparts; i++)
+	{
+		Form_pg_statistic stat = (Form_pg_statistic) GETSTRUCT(statstuples[i]);
+		double		rows = partrows[i];
+		double		partdistinct;
+		AttStatsSlot sslot;
+		double		mcvfreq = 0.0;
+		int			j;
+
+		nullrows += rows * stat->stanullfrac;
+		widthsum += rows * (1.0 - stat->stanullfrac) * stat->stawidth;
+
+		partdistinct = (stat->stadistinct >= 0) ? stat->stadistinct :
+			-stat->stadistinct * rows;
+		sum_distinct += partdistinct;
+		max_distinct = Max(max_distinct, partdistinct);
+
+		if (get_attstatsslot(&sslot, statstuples[i], STATISTIC_KIND_MCV,
+							 InvalidOid, ATTSTATSSLOT_NUMBERS |
+							 (is_scalar ? ATTSTATSSLOT_VALUES : 0)))
+		{
+			nmcventries += sslot.nnumbers;
+			for (j = 0; j < sslot.nnumbers; j++)
+				mcvfreq += sslot.numbers[j];
+
+			for (j = 0; is_scalar && j < sslot.nvalues; j++)
+			{
+				if (nitems >= maxitems)
+				{
+					maxitems *= 2;
+					items = repalloc_array(items, MergeStatsItem, maxitems);
+				}
+				items[nitems].value = sslot.values[j];
+				items[nitems].mcvrows = rows * sslot.numbers[j];
+				items[nitems].histrows = 0.0;
+				items[nitems].nmcvs = 1;
+				items[nitems].keep = false;
+				nitems++;
+			}
+		}
+
+		if (is_scalar &&
+			get_attstatsslot(&sslot, statstuples[i], STATISTIC_KIND_HISTOGRAM,
+							 InvalidOid, ATTSTATSSLOT_VALUES) &&
+			sslot.nvalues >= 2)
+		{
+			double		histfrac = 1.0 - stat->stanullfrac - mcvfreq;
+			double		bucketrows = rows * Max(histfrac, 0.0) /
+				(sslot.nvalues - 1);
+
+			for (j = 0; j < sslot.nvalues; j++)
+			{
+				if (nitems >= maxitems)
+				{
+					maxitems *= 2;
+					items = repalloc_array(items, MergeStatsItem, maxitems);
+				}
+				items[nitems].value = sslot.values[j];
+				items[nitems].mcvrows = 0.0;
+				/* the end points only get half a bucket */
+				items[nitems].histrows = (j == 0 || j == sslot.nvalues - 1) ?
+					bucketrows / 2 : bucketrows;
+				items[nitems].nmcvs = 0;
+				items[nitems].keep = false;
+				nitems++;
+			}
+		}
+
+		/* the slots' memory is released along with the column's context */
+	}
+
+	stats->stats_valid = true;
+	stats->stanullfrac = Min(nullrows / totalrows, 1.0);
+	nonnullrows = totalrows - nullrows;
+	if (nonnullrows > 0)
+		stats->stawidth = (int32) rint(widthsum / nonnullrows);
+	else
+		stats->stawidth = stats->attrtype->typlen > 0 ?
+			stats->attrtype->typlen : 0;
+
+	/* Combine the equal values found in the partitions' statistics */
+	if (nitems > 0)
+	{
+		SortSupportData ssup;
+		int			n = 0;
+
+		memset(&ssup, 0, sizeof(ssup));
+		ssup.ssup_cxt = CurrentMemoryContext;
+		ssup.ssup_collation = stats->attrcollid;
+		ssup.ssup_nulls_first = false;
+		PrepareSortSupportFromOrderingOp(mystats->ltopr, &ssup);
+
+		qsort_interruptible(items, nitems, sizeof(MergeStatsItem),
+							compare_merge_stats_items, &ssup);
+
+		for (i = 1; i < nitems; i++)
+		{
+			if (compare_merge_stats_items(&items[n], &items[i], &ssup) == 0)
+			{
+				items[n].mcvrows += items[i].mcvrows;
+				items[n].histrows += items[i].histrows;
+				items[n].nmcvs += items[i].nmcvs;
+			}
+			else
+				items[++n] = items[i];
+		}
+		nitems = n + 1;
+	}
+
+	/*
+	 * Estimate the number of distinct values.  Partitions can't share values
+	 * of the partition key.  For other columns, the fraction of the entries
+	 * in the partitions' MCV lists that are distinct tells us how much the
+	 * partitions overlap; without MCV lists the values are probably unique,
+	 * so assume no overlap.  If we can't compare the values, assume full
+	 * overlap when there are MCV lists.
+	 */
+	if (is_partkey || nmcventries == 0)
+		ndistinct = sum_distinct;
+	else if (is_scalar)
+	{
+		int			nmcvvalues = 0;
+
+		for (i = 0; i < nitems; i++)
+		{
+			if (items[i].nmcvs > 0)
+				nmcvvalues++;
+		}
+		ndistinct = Max(max_distinct,
+						sum_distinct * nmcvvalues / nmcventries);
+	}
+	else
+		ndistinct = max_distinct;
+	ndistinct = Min(ndistinct, nonnullrows);
+
+	if (ndistinct > 0.1 * totalrows)
+		stats->stadistinct = -(ndistinct / totalrows);
+	else
+		stats->stadistinct = ndistinct;
+
+	if (nitems > 0)
+	{
+		int		   *mcvs;
+		int			ncandidates = 0;
+		int			num_mcv = 0;
+		double		mcvrows = 0.0;
+		double		histrows = 0.0;
+		int			nhistpoints = 0;
+
+		/*
+		 * Choose the merged MCV list.  If the MCV lists account for all the
+		 * rows, keep them all if there's room; otherwise keep the values
+		 * more common than average, like compute_distinct_stats() does.
+		 */
+		mcvs = palloc_array(int, nitems);
+		for (i = 0; i < nitems; i++)
+		{
+			if (items[i].nmcvs > 0)
+			{
+				mcvs[ncandidates++] = i;
+				mcvrows += items[i].mcvrows;
+			}
+		}
+		qsort_arg(mcvs, ncandidates, sizeof(int),
+				  compare_merge_stats_mcvs, items);
+
+		if (ncandidates <= stats->attstattarget &&
+			mcvrows >= 0.99 * nonnullrows)
+			num_mcv = ncandidates;
+		else
+		{
+			double		minrows = 1.25 * nonnullrows / Max(ndistinct, 1.0);
+
+			num_mcv = Min(ncandidates, stats->attstattarget);
+			for (i = 0; i < num_mcv; i++)
+			{
+				if (items[mcvs[i]].mcvrows <= minrows)
+				{
+					num_mcv = i;
+					break;
+				}
+			}
+		}
+
+		if (num_mcv > 0)
+		{
+			MemoryContext old_context;
+			Datum	   *mcv_values;
+			float4	   *mcv_freqs;
+
+			/* Must copy the target values into anl_context */
+			old_context = MemoryContextSwitchTo(stats->anl_context);
+			mcv_values = palloc_array(Datum, num_mcv);
+			mcv_freqs = palloc_array(float4, num_mcv);
+			for (i = 0; i < num_mcv; i++)
+			{
+				MergeStatsItem *item = &items[mcvs[i]];
+
+				item->keep = true;
+				mcv_values[i] = datumCopy(item->value,
+										  stats->attrtype->typbyval,
+										  stats->attrtype->typlen);
+				mcv_freqs[i] = item->mcvrows / totalrows;
+			}
+			MemoryContextSwitchTo(old_context);
+
+			stats->stakind[slot_idx] = STATISTIC_KIND_MCV;
+			stats->staop[slot_idx] = mystats->eqopr;
+			stats->stacoll[slot_idx] = stats->attrcollid;
+			stats->stanumbers[slot_idx] = mcv_freqs;
+			stats->numnumbers[slot_idx] = num_mcv;
+			stats->stavalues[slot_idx] = mcv_values;
+			stats->numvalues[slot_idx] = num_mcv;
+			slot_idx++;
+		}
+
+		/*
+		 * Build the histogram from the remaining values, weighted by the
+		 * rows they stand for.
+		 */
+		for (i = 0; i < nitems; i++)
+		{
+			if (items[i].keep)
+				continue;
+			items[i].histrows += items[i].mcvrows;
+			if (items[i].histrows > 0)
+			{
+				histrows += items[i].histrows;
+				items[nhistpoints++] = items[i];
+			}
+		}
+
+		if (nhistpoints >= 2)
+		{
+			MemoryContext old_context;
+			Datum	   *hist_values;
+			int			num_hist = Min(stats->attstattarget + 1, nhistpoints);
+			double		cumrows;
+			int			j;
+
+			old_context = MemoryContextSwitchTo(stats->anl_context);
+			hist_values = palloc_array(Datum, num_hist);
+
+			/*
+			 * The first and last bounds are the extreme values; the ones in
+			 * between are the values at evenly spaced fractions of the rows.
+			 */
+			j = 0;
+			cumrows = items[0].histrows;
+			for (i = 0; i < num_hist; i++)
+			{
+				if (i == num_hist - 1)
+					j = nhistpoints - 1;
+				else if (i > 0)
+				{
+					double		target = histrows * i / (num_hist - 1);
+
+					while (j < nhistpoints - 2 && cumrows < target)
+						cumrows += items[++j].histrows;
+				}
+				hist_values[i] = datumCopy(items[j].value,
+										   stats->attrtype->typbyval,
+										   stats->attrtype->typlen);
+			}
+			MemoryContextSwitchTo(old_context);
+
+			stats->stakind[slot_idx] = STATISTIC_KIND_HISTOGRAM;
+			stats->staop[slot_idx] = mystats->ltopr;
+			stats->stacoll[slot_idx] = stats->attrcollid;
+			stats->stavalues[slot_idx] = hist_values;
+			stats->numvalues[slot_idx] = num_hist;
+			slot_idx++;
+		}
+	}
+}
+
+/*
+ * merge_partition_stats -- compute a partitioned table's statistics by
+ *		merging those of its partitions
+ *
+ * This is used by ANALYZE (INCREMENTAL) in place of sampling the partitions
+ * with acquire_inherited_sample_rows(), so that only the partitions that
+ * changed need to be read, by their own ANALYZE.  The statistics of all
+ * non-empty leaf partitions must be available for this to work; if they
+ * aren't, we return false without doing anything, and the caller falls back
+ * to sampling.  On success, the statistics of all the columns have been
+ * stored in pg_statistic, and *totalrows is set.
+ */
+static bool
+merge_partition_stats(Relation onerel, int elevel,
+					  int attr_cnt, VacAttrStats **vacattrstats,
+					  double *totalrows)
+{
+	List	   *tableOIDs;
+	Oid		   *partoids;
+	double	   *partrows;
+	HeapTuple  *statstuples;
+	AttrNumber **partattnums;
+	PartitionKey key = RelationGetPartitionKey(onerel);
+	int			nparts = 0;
+	MemoryContext col_context,
+				old_context;
+	ListCell   *lc;
+	int			i,
+				j;
+
+	*totalrows = 0;
+
+	tableOIDs = find_all_inheritors(RelationGetRelid(onerel),
+									AccessShareLock, NULL);
+
+	partoids = palloc_array(Oid, list_length(tableOIDs));
+	partrows = palloc_array(double, list_length(tableOIDs));
+	partattnums = palloc_array(AttrNumber *, list_length(tableOIDs));
+
+	/*
+	 * Check that every leaf partition with rows has statistics for all the
+	 * columns, and remember where to find them.
+	 */
+	foreach(lc, tableOIDs)
+	{
+		Oid			childOID = lfirst_oid(lc);
+		char		relkind = get_rel_relkind(childOID);
+		float4		reltuples;
+		HeapTuple	tuple;
+
+		if (!RELKIND_HAS_STORAGE(relkind) && relkind != RELKIND_FOREIGN_TABLE)
+			continue;
+
+		tuple = SearchSysCache1(RELOID, ObjectIdGetDatum(childOID));
+		if (!HeapTupleIsValid(tuple))
+			elog(ERROR, "cache lookup failed for relation %u", childOID);
+		reltuples = ((Form_pg_class) GETSTRUCT(tuple))->reltuples;
+		ReleaseSysCache(tuple);
+
+		/* never analyzed */
+		if (reltuples < 0)
+			return false;
+		if (reltuples == 0)
+			continue;
+
+		partoids[nparts] = childOID;
+		partrows[nparts] = reltuples;
+		partattnums[nparts] = palloc_array(AttrNumber, attr_cnt);
+		for (i = 0; i < attr_cnt; i++)
+		{
+			Form_pg_attribute attr = TupleDescAttr(onerel->rd_att,
+												   vacattrstats[i]->tupattnum - 1);
+			AttrNumber	attnum = get_attnum(childOID, NameStr(attr->attname));
+
+			if (attnum == InvalidAttrNumber ||
+				!SearchSysCacheExists3(STATRELATTINH,
+									   ObjectIdGetDatum(childOID),
+									   Int16GetDatum(attnum),
+									   BoolGetDatum(false)))
+				return false;
+			partattnums[nparts][i] = attnum;
+		}
+
+		*totalrows += reltuples;
+		nparts++;
+	}
+
+	if (nparts == 0)
+		return false;
+
+	ereport(elevel,
+			(errmsg("merging statistics of %d partitions of \"%s.%s\"",
+					nparts,
+					get_namespace_name(RelationGetNamespace(onerel)),
+					RelationGetRelationName(onerel))));
+
+	pgstat_progress_update_param(PROGRESS_ANALYZE_PHASE,
+								 PROGRESS_ANALYZE_PHASE_COMPUTE_STATS);
+
+	col_context = AllocSetContextCreate(anl_context,
+										"Analyze Column",
+										ALLOCSET_DEFAULT_SIZES);
+	old_context = MemoryContextSwitchTo(col_context);
+
+	statstuples = palloc_array(HeapTuple, nparts);
+
+	for (i = 0; i < attr_cnt; i++)
+	{
+		VacAttrStats *stats = vacattrstats[i];
+		bool		is_partkey;
+		AttributeOpts *aopt;
+
+		is_partkey = (key->partnatts == 1 &&
+					  key->partattrs[0] == stats->tupattnum);
+
+		for (j = 0; j < nparts; j++)
+		{
+			statstuples[j] = SearchSysCache3(STATRELATTINH,
+											 ObjectIdGetDatum(partoids[j]),
+											 Int16GetDatum(partattnums[j][i]),
+											 BoolGetDatum(false));
+			if (!HeapTupleIsValid(statstuples[j]))
+				elog(ERROR, "cache lookup failed for statistics of attribute %d of relation %u",
+					 partattnums[j][i], partoids[j]);
+		}
+
+		merge_column_stats(stats, nparts, statstuples, partrows, *totalrows,
+						   is_partkey);
+
+		for (j = 0; j < nparts; j++)
+			ReleaseSysCache(statstuples[j]);
+
+		/* As in do_analyze_rel(), honor n_distinct_inherited */
+		aopt = get_attribute_options(onerel->rd_id, stats->tupattnum);
+		if (aopt != NULL && aopt->n_distinct_inherited != 0.0)
+			stats->stadistinct = aopt->n_distinct_inherited;
+
+		MemoryContextReset(col_context);
+	}
+
+	MemoryContextSwitchTo(old_context);
+	MemoryContextDelete(col_context);
+
+	update_attstats(RelationGetRelid(onerel), true, attr_cnt, vacattrstats);
+
+	return true;
+}
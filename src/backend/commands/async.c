@@ -24,8 +24,11 @@
  *	  All notification messages are placed in the queue and later read out
  *	  by listening backends.
  *
- *	  There is no central knowledge of which backend listens on which channel;
- *	  every backend has its own list of interesting channels.
+ *	  There is no exact central knowledge of which backend listens on which
+ *	  channel; every backend has its own list of interesting channels.  Each
+ *	  listening backend does publish a small bitmap of the hashes of its
+ *	  channels, its "channel filter", which tells which channels it might be
+ *	  listening on.
  *
  *	  Although there is only one queue, notifications are treated as being
  *	  database-local; this is done by including the sender's database OID
@@ -72,12 +75,13 @@
  *	  Then we signal any backends that may be interested in our messages
  *	  (including our own backend, if listening).  This is done by
  *	  SignalBackends(), which scans the list of listening backends and sends a
- *	  PROCSIG_NOTIFY_INTERRUPT signal to every listening backend (we don't
- *	  know which backend is listening on which channel so we must signal them
- *	  all).  We can exclude backends that are already up to date, though, and
- *	  we can also exclude backends that are in other databases (unless they
- *	  are way behind and should be kicked to make them advance their
- *	  pointers).
+ *	  PROCSIG_NOTIFY_INTERRUPT signal to every listening backend in our
+ *	  database whose channel filter matches one of the channels we notified.
+ *	  We can exclude backends that are already up to date.  Backends in other
+ *	  databases, or whose filter doesn't match, are only signaled if they are
+ *	  way behind and should be kicked to make them advance their pointers.
+ *	  A backend adds the channels of its LISTENs to its filter before it
+ *	  commits, so a notifier that commits later will see them.
  *
  *	  Finally, after we are out of the transaction altogether and about to go
  *	  idle, we scan the queue for messages that need to be sent to our
@@ -240,12 +244,26 @@ typedef struct QueuePosition
 /*
  * Struct describing a listening backend's status
  */
+/*
+ * A channel filter has one bit for each possible value of the hash of a
+ * channel name, modulo its size.  A set bit means that the backend may be
+ * listening on a channel with that hash.
+ */
+#define NOTIFY_FILTER_WORDS			4
+#define NOTIFY_FILTER_BITS			(NOTIFY_FILTER_WORDS * 64)
+
+typedef struct ChannelFilter
+{
+	uint64		words[NOTIFY_FILTER_WORDS];
+} ChannelFilter;
+
 typedef struct QueueBackendStatus
 {
 	int32		pid;			/* either a PID or InvalidPid */
 	Oid			dboid;			/* backend's database OID, or InvalidOid */
 	ProcNumber	nextListener;	/* id of next listener, or INVALID_PROC_NUMBER */
 	QueuePosition pos;			/* backend has read queue up to here */
+	ChannelFilter filter;		/* channels the backend may listen on */
 } QueueBackendStatus;
 
 /*
@@ -301,6 +319,7 @@ static AsyncQueueControl *asyncQueueControl;
 #define QUEUE_BACKEND_DBOID(i)		(asyncQueueControl->backend[i].dboid)
 #define QUEUE_NEXT_LISTENER(i)		(asyncQueueControl->backend[i].nextListener)
 #define QUEUE_BACKEND_POS(i)		(asyncQueueControl->backend[i].pos)
+#define QUEUE_BACKEND_FILTER(i)		(asyncQueueControl->backend[i].filter)
 
 /*
  * The SLRU buffer area through which we access the notification queue
@@ -433,11 +452,13 @@ static inline bool asyncQueuePagePrecedes(int64 p, int64 q);
 static void queue_listen(ListenActionKind action, const char *channel);
 static void Async_UnlistenOnExit(int code, Datum arg);
 static void Exec_ListenPreCommit(void);
+static void Exec_ListenFilterPreCommit(const char *channel);
 static void Exec_ListenCommit(const char *channel);
 static void Exec_UnlistenCommit(const char *channel);
 static void Exec_UnlistenAllCommit(void);
 static bool IsListeningOn(const char *channel);
 static void asyncQueueUnregister(void);
+static void asyncQueueResetFilter(void);
 static bool asyncQueueIsFull(void);
 static bool asyncQueueAdvance(volatile QueuePosition *position, int entryLength);
 static void asyncQueueNotificationToEntry(Notification *n, AsyncQueueEntry *qe);
@@ -457,6 +478,33 @@ static uint32 notification_hash(const void *key, Size keysize);
 static int	notification_match(const void *key1, const void *key2, Size keysize);
 static void ClearPendingActionsAndNotifies(void);
 
+/*
+ * Add a channel to a channel filter.
+ */
+static inline void
+ChannelFilterAdd(ChannelFilter *filter, const char *channel)
+{
+	uint32		bit;
+
+	bit = hash_bytes((const unsigned char *) channel, strlen(channel)) %
+		NOTIFY_FILTER_BITS;
+	filter->words[bit / 64] |= UINT64CONST(1) << (bit % 64);
+}
+
+/*
+ * Could a backend with filter 'a' be listening on a channel in filter 'b'?
+ */
+static inline bool
+ChannelFilterOverlaps(const ChannelFilter *a, const ChannelFilter *b)
+{
+	for (int i = 0; i < NOTIFY_FILTER_WORDS; i++)
+	{
+		if ((a->words[i] & b->words[i]) != 0)
+			return true;
+	}
+	return false;
+}
+
 /*
  * Compute the difference between two queue page numbers.
  * Previously this function accounted for a wraparound.
@@ -526,6 +574,7 @@ AsyncShmemInit(void)
 			QUEUE_BACKEND_DBOID(i) = InvalidOid;
 			QUEUE_NEXT_LISTENER(i) = INVALID_PROC_NUMBER;
 			SET_QUEUE_POS(QUEUE_BACKEND_POS(i), 0, 0);
+			memset(&QUEUE_BACKEND_FILTER(i), 0, sizeof(ChannelFilter));
 		}
 	}
 
@@ -739,6 +788,9 @@ Async_Listen(const char *channel)
 	if (Trace_notify)
 		elog(DEBUG1, "Async_Listen(%s,%d)", channel, MyProcPid);
 
+	/* Notifications are delivered to this backend only */
+	MySessionPinned = true;
+
 	queue_listen(LISTEN_LISTEN, channel);
 }
 
@@ -878,6 +930,7 @@ PreCommit_Notify(void)
 			{
 				case LISTEN_LISTEN:
 					Exec_ListenPreCommit();
+					Exec_ListenFilterPreCommit(actrec->channel);
 					break;
 				case LISTEN_UNLISTEN:
 					/* there is no Exec_UnlistenPreCommit() */
@@ -1003,6 +1056,8 @@ AtCommit_Notify(void)
 	/* If no longer listening to anything, get out of listener array */
 	if (amRegisteredListener && listenChannels == NIL)
 		asyncQueueUnregister();
+	else if (pendingActions != NULL && amRegisteredListener)
+		asyncQueueResetFilter();
 
 	/*
 	 * Send signals to listening backends.  We need do this only if there are
@@ -1098,6 +1153,7 @@ Exec_ListenPreCommit(void)
 	QUEUE_BACKEND_POS(MyProcNumber) = max;
 	QUEUE_BACKEND_PID(MyProcNumber) = MyProcPid;
 	QUEUE_BACKEND_DBOID(MyProcNumber) = MyDatabaseId;
+	memset(&QUEUE_BACKEND_FILTER(MyProcNumber), 0, sizeof(ChannelFilter));
 	/* Insert backend into list of listeners at correct position */
 	if (prevListener != INVALID_PROC_NUMBER)
 	{
@@ -1126,6 +1182,24 @@ Exec_ListenPreCommit(void)
 		asyncQueueReadAllNotifications();
 }
 
+/*
+ * Exec_ListenFilterPreCommit --- subroutine for PreCommit_Notify
+ *
+ * Add a channel we're about to start listening on to our channel filter.
+ * This must happen before we commit, so that anyone notifying the channel
+ * after we've committed will signal us.
+ */
+static void
+Exec_ListenFilterPreCommit(const char *channel)
+{
+	Assert(amRegisteredListener);
+
+	/* shared lock is enough to change our own entry; see AsyncQueueControl */
+	LWLockAcquire(NotifyQueueLock, LW_SHARED);
+	ChannelFilterAdd(&QUEUE_BACKEND_FILTER(MyProcNumber), channel);
+	LWLockRelease(NotifyQueueLock);
+}
+
 /*
  * Exec_ListenCommit --- subroutine for AtCommit_Notify
  *
@@ -1262,6 +1336,26 @@ asyncQueueUnregister(void)
 	amRegisteredListener = false;
 }
 
+/*
+ * Rebuild our channel filter from listenChannels, to drop the channels we
+ * no longer listen on.  The filter may also contain channels of LISTENs that
+ * were rolled back, which this gets rid of, too.
+ */
+static void
+asyncQueueResetFilter(void)
+{
+	ChannelFilter filter;
+	ListCell   *p;
+
+	memset(&filter, 0, sizeof(ChannelFilter));
+	foreach(p, listenChannels)
+		ChannelFilterAdd(&filter, (const char *) lfirst(p));
+
+	LWLockAcquire(NotifyQueueLock, LW_SHARED);
+	QUEUE_BACKEND_FILTER(MyProcNumber) = filter;
+	LWLockRelease(NotifyQueueLock);
+}
+
 /*
  * Test whether there is room to insert more notification messages.
  *
@@ -1583,6 +1677,17 @@ SignalBackends(void)
 	int32	   *pids;
 	ProcNumber *procnos;
 	int			count;
+	ChannelFilter filter;
+	ListCell   *p;
+
+	/* Compute the filter of the channels we have notified */
+	memset(&filter, 0, sizeof(ChannelFilter));
+	foreach(p, pendingNotifies->events)
+	{
+		Notification *n = (Notification *) lfirst(p);
+
+		ChannelFilterAdd(&filter, n->data);
+	}
 
 	/*
 	 * Identify backends that we need to signal.  We don't want to send
@@ -1604,11 +1709,13 @@ SignalBackends(void)
 
 		Assert(pid != InvalidPid);
 		pos = QUEUE_BACKEND_POS(i);
-		if (QUEUE_BACKEND_DBOID(i) == MyDatabaseId)
+		if (QUEUE_BACKEND_DBOID(i) == MyDatabaseId &&
+			ChannelFilterOverlaps(&QUEUE_BACKEND_FILTER(i), &filter))
 		{
 			/*
-			 * Always signal listeners in our own database, unless they're
-			 * already caught up (unlikely, but possible).
+			 * Always signal listeners in our own database that may be
+			 * listening on one of our channels, unless they're already
+			 * caught up (unlikely, but possible).
 			 */
 			if (QUEUE_POS_EQUAL(pos, QUEUE_HEAD))
 				continue;
@@ -1616,8 +1723,8 @@ SignalBackends(void)
 		else
 		{
 			/*
-			 * Listeners in other databases should be signaled only if they
-			 * are far behind.
+			 * Listeners in other databases, or not interested in our
+			 * channels, should be signaled only if they are far behind.
 			 */
 			if (asyncQueuePageDiff(QUEUE_POS_PAGE(QUEUE_HEAD),
 								   QUEUE_POS_PAGE(pos)) < QUEUE_CLEANUP_DELAY)
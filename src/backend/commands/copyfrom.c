@@ -559,11 +559,25 @@ CopyMultiInsertBufferFlush(CopyMultiInsertInfo *miinfo,
 						   buffer->bistate);
 		MemoryContextSwitchTo(oldcontext);
 
+		/*
+		 * Insert into the indexes that can take the whole batch at once.
+		 * Those have no constraints to enforce, so there's no particular row
+		 * to blame for an error.
+		 */
+		if (resultRelInfo->ri_NumIndices > 0)
+		{
+			Assert(!cstate->relname_only);
+			cstate->relname_only = true;
+			ExecInsertIndexTuplesBatch(resultRelInfo, slots, nused, estate,
+									   false);
+			cstate->relname_only = false;
+		}
+
 		for (i = 0; i < nused; i++)
 		{
 			/*
-			 * If there are any indexes, update them for all the inserted
-			 * tuples, and run AFTER ROW INSERT triggers.
+			 * If there are any indexes, update the remaining ones for all the
+			 * inserted tuples, and run AFTER ROW INSERT triggers.
 			 */
 			if (resultRelInfo->ri_NumIndices > 0)
 			{
@@ -571,9 +585,9 @@ CopyMultiInsertBufferFlush(CopyMultiInsertInfo *miinfo,
 
 				cstate->cur_lineno = buffer->linenos[i];
 				recheckIndexes =
-					ExecInsertIndexTuples(resultRelInfo,
-										  buffer->slots[i], estate, false,
-										  false, NULL, NIL, false);
+					ExecInsertIndexTuplesUnbatched(resultRelInfo,
+												   buffer->slots[i], estate,
+												   false);
 				ExecARInsertTriggers(estate, resultRelInfo,
 									 slots[i], recheckIndexes,
 									 cstate->transition_capture);
@@ -781,7 +795,7 @@ CopyFrom(CopyFromState cstate)
 	ResultRelInfo *resultRelInfo;
 	ResultRelInfo *target_resultRelInfo;
 	ResultRelInfo *prevResultRelInfo = NULL;
-	EState	   *estate = CreateExecutorState(); /* for ExecConstraints() */
+	EState	   *estate;			/* for ExecConstraints() */
 	ModifyTableState *mtstate;
 	ExprContext *econtext;
 	TupleTableSlot *singleslot = NULL;
@@ -806,6 +820,20 @@ CopyFrom(CopyFromState cstate)
 	if (cstate->opts.on_error != COPY_ON_ERROR_STOP)
 		Assert(cstate->escontext);
 
+	/*
+	 * If PARALLEL was requested, let workers do the parsing and inserting,
+	 * unless the target or the options rule that out.
+	 */
+	if (cstate->opts.nworkers > 0)
+	{
+		uint64		nprocessed;
+
+		if (ParallelCopyFrom(cstate, &nprocessed))
+			return nprocessed;
+	}
+
+	estate = CreateExecutorState();
+
 	/*
 	 * The target must be a plain, foreign, or partitioned relation, or have
 	 * an INSTEAD OF INSERT row trigger.  (Currently, such triggers are only
@@ -814,8 +842,8 @@ CopyFrom(CopyFromState cstate)
 	if (cstate->rel->rd_rel->relkind != RELKIND_RELATION &&
 		cstate->rel->rd_rel->relkind != RELKIND_FOREIGN_TABLE &&
 		cstate->rel->rd_rel->relkind != RELKIND_PARTITIONED_TABLE &&
-		!(cstate->rel->trigdesc &&
-		  cstate->rel->trigdesc->trig_insert_instead_row))
+		!(RelationGetTriggerDesc(cstate->rel) &&
+		  RelationGetTriggerDesc(cstate->rel)->trig_insert_instead_row))
 	{
 		if (cstate->rel->rd_rel->relkind == RELKIND_VIEW)
 			ereport(ERROR,
@@ -969,7 +997,7 @@ CopyFrom(CopyFromState cstate)
 	 * passed to ExecFindPartition() below.
 	 */
 	cstate->transition_capture = mtstate->mt_transition_capture =
-		MakeTransitionCaptureState(cstate->rel->trigdesc,
+		MakeTransitionCaptureState(RelationGetTriggerDesc(cstate->rel),
 								   RelationGetRelid(cstate->rel),
 								   CMD_INSERT);
 
@@ -1579,6 +1607,10 @@ BeginCopyFrom(ParseState *pstate,
 	/* Process the target relation */
 	cstate->rel = rel;
 
+	/* Parallel workers redo this setup from the original lists */
+	cstate->attnamelist = attnamelist;
+	cstate->options = options;
+
 	tupDesc = RelationGetDescr(cstate->rel);
 
 	/* process common options or initialization */
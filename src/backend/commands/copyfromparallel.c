@@ -0,0 +1,655 @@
+/*-------------------------------------------------------------------------
+ *
+ * copyfromparallel.c
+ *		Parallel execution of COPY FROM.
+ *
+ * With the PARALLEL option, the leader backend keeps reading the input and
+ * finding line boundaries, which has to be done sequentially because of CSV
+ * quoting and text-format escapes, but hands the lines over to parallel
+ * workers in chunks.  Each worker converts the fields with the datatype input
+ * functions, evaluates defaults, constraints and the WHERE clause, and
+ * inserts the rows with table_multi_insert(), exactly like a serial COPY
+ * FROM does; the lines it receives simply take the place of CopyReadLine().
+ *
+ * The leader sends chunks to the workers round-robin, through one shm_mq per
+ * worker.  Each chunk starts with the line number of its first line, so that
+ * errors raised in a worker report the same line number a serial COPY would.
+ * Rows are inserted in no particular order.
+ *
+ * The workers insert using the leader's transaction ID and command ID, which
+ * the leader assigns before entering parallel mode.  That only works as long
+ * as no insert needs to do anything a parallel worker can't, so COPY falls
+ * back to a serial load if the target has insert triggers (including foreign
+ * key checks), is not a plain permanent or unlogged table, or has defaults,
+ * constraints, generated columns, index expressions or input functions that
+ * are not parallel safe.  FREEZE, ON_ERROR other than STOP and BINARY format
+ * also mean a serial load.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/commands/copyfromparallel.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/parallel.h"
+#include "access/table.h"
+#include "access/xact.h"
+#include "catalog/pg_proc.h"
+#include "catalog/pg_type.h"
+#include "commands/copyfrom_internal.h"
+#include "commands/progress.h"
+#include "executor/instrument.h"
+#include "miscadmin.h"
+#include "optimizer/clauses.h"
+#include "optimizer/optimizer.h"
+#include "parser/parse_relation.h"
+#include "pgstat.h"
+#include "rewrite/rewriteHandler.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "tcop/tcopprot.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+
+/*
+ * DSM keys for parallel COPY FROM.  As for parallel vacuum, there are no
+ * plan node IDs to conflict with, so small integers will do.
+ */
+#define PARALLEL_COPY_KEY_SHARED			1
+#define PARALLEL_COPY_KEY_QUERY_TEXT		2
+#define PARALLEL_COPY_KEY_BUFFER_USAGE		3
+#define PARALLEL_COPY_KEY_WAL_USAGE			4
+#define PARALLEL_COPY_KEY_ATTNAMES			5
+#define PARALLEL_COPY_KEY_OPTIONS			6
+#define PARALLEL_COPY_KEY_WHERE				7
+#define PARALLEL_COPY_KEY_QUEUES			8
+
+/*
+ * The leader sends a chunk to a worker once it holds this many bytes of
+ * input lines.  Each worker's queue has room for a couple of chunks, so that
+ * the leader can go on reading while the worker is busy with the previous
+ * one.
+ */
+#define PARALLEL_COPY_CHUNK_SIZE			65536
+#define PARALLEL_COPY_QUEUE_SIZE			(2 * PARALLEL_COPY_CHUNK_SIZE)
+
+/*
+ * Shared information among the parallel COPY leader and workers, stored in
+ * the DSM segment.
+ */
+typedef struct ParallelCopyShared
+{
+	Oid			relid;			/* target relation */
+	int64		queryid;		/* query ID, for pg_stat_activity */
+	pg_atomic_uint64 processed; /* rows inserted by all workers so far */
+} ParallelCopyShared;
+
+/*
+ * Per-worker state for reading the lines sent by the leader.  The current
+ * chunk points into the worker's shm_mq and stays valid until the next
+ * message is received.
+ */
+typedef struct ParallelCopyWorkerState
+{
+	shm_mq_handle *mqh;			/* queue from the leader */
+	char	   *chunk;			/* lines of the current chunk */
+	Size		chunk_len;		/* length of the current chunk */
+	Size		chunk_off;		/* offset of the next line in the chunk */
+	uint64		next_lineno;	/* line number of the next line */
+} ParallelCopyWorkerState;
+
+static int	CopyFromParallelWorkers(CopyFromState cstate);
+static bool CopyFromParallelSafe(CopyFromState cstate);
+static void ParallelCopySendChunk(ParallelContext *pcxt, shm_mq_handle **mqh,
+								  int nqueues, int worker, StringInfo chunk);
+static int	ParallelCopyNoData(void *outbuf, int minread, int maxread);
+
+/*
+ * Work out how many parallel workers a COPY FROM can use, or 0 if it has to
+ * run serially.  As for VACUUM, the requested number of workers is capped by
+ * max_parallel_maintenance_workers.
+ */
+static int
+CopyFromParallelWorkers(CopyFromState cstate)
+{
+	int			nworkers;
+
+	nworkers = Min(cstate->opts.nworkers, max_parallel_maintenance_workers);
+	if (nworkers <= 0)
+		return 0;
+
+	/* Workers can't be started from workers, nor in single-user mode */
+	if (IsInParallelMode() || !IsUnderPostmaster)
+		return 0;
+
+	/* Option-level restrictions; see the file header comment */
+	if (cstate->opts.binary || cstate->opts.freeze ||
+		cstate->opts.on_error != COPY_ON_ERROR_STOP)
+		return 0;
+
+	if (!CopyFromParallelSafe(cstate))
+		return 0;
+
+	return nworkers;
+}
+
+/*
+ * Is it safe for parallel workers to convert and insert the rows?
+ */
+static bool
+CopyFromParallelSafe(CopyFromState cstate)
+{
+	Relation	rel = cstate->rel;
+	TupleDesc	tupDesc = RelationGetDescr(rel);
+	TriggerDesc *trigdesc = RelationGetTriggerDesc(rel);
+	List	   *indexoidlist;
+	ListCell   *lc;
+	bool		safe = true;
+
+	/*
+	 * Only plain tables, and not temporary ones, which workers can't access.
+	 */
+	if (rel->rd_rel->relkind != RELKIND_RELATION ||
+		RelationUsesLocalBuffers(rel))
+		return false;
+
+	/*
+	 * Triggers would have to fire in the workers, and AFTER triggers queued
+	 * there would be lost.  This also covers foreign key checks, whose
+	 * insert trigger would otherwise need a new command ID in each worker.
+	 */
+	if (trigdesc &&
+		(trigdesc->trig_insert_before_row ||
+		 trigdesc->trig_insert_after_row ||
+		 trigdesc->trig_insert_instead_row ||
+		 trigdesc->trig_insert_before_statement ||
+		 trigdesc->trig_insert_after_statement ||
+		 trigdesc->trig_insert_new_table))
+		return false;
+
+	/* The WHERE clause was already preprocessed in DoCopy() */
+	if (!expression_is_parallel_safe(cstate->whereClause))
+		return false;
+
+	for (int attnum = 1; attnum <= tupDesc->natts; attnum++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupDesc, attnum - 1);
+		Oid			in_func_oid;
+		Oid			typioparam;
+
+		if (att->attisdropped)
+			continue;
+
+		/*
+		 * Generated columns are computed in the workers.  Defaults are only
+		 * evaluated for columns not in the input, or for the DEFAULT marker.
+		 */
+		if (att->attgenerated)
+		{
+			if (!expression_is_parallel_safe(build_generation_expression(rel, attnum)))
+				return false;
+		}
+		else if (cstate->opts.default_print != NULL ||
+				 !list_member_int(cstate->attnumlist, attnum))
+		{
+			Node	   *defexpr = build_column_default(rel, attnum);
+
+			if (defexpr != NULL &&
+				!expression_is_parallel_safe((Node *) expression_planner((Expr *) defexpr)))
+				return false;
+		}
+
+		if (!list_member_int(cstate->attnumlist, attnum))
+			continue;
+
+		/*
+		 * Domain constraints are checked by the input function.  Treat them
+		 * as parallel restricted, like the planner does for CoerceToDomain.
+		 */
+		if (get_typtype(att->atttypid) == TYPTYPE_DOMAIN)
+			return false;
+
+		getTypeInputInfo(att->atttypid, &in_func_oid, &typioparam);
+		if (func_parallel(in_func_oid) != PROPARALLEL_SAFE)
+			return false;
+	}
+
+	/* CHECK constraints */
+	if (tupDesc->constr)
+	{
+		for (int i = 0; i < tupDesc->constr->num_check; i++)
+		{
+			Node	   *checkexpr = stringToNode(tupDesc->constr->check[i].ccbin);
+
+			if (!expression_is_parallel_safe(checkexpr))
+				return false;
+		}
+	}
+
+	/* Index expressions and predicates are evaluated when inserting, too */
+	indexoidlist = RelationGetIndexList(rel);
+	foreach(lc, indexoidlist)
+	{
+		Relation	indexRel = index_open(lfirst_oid(lc), AccessShareLock);
+
+		if (!expression_is_parallel_safe((Node *) RelationGetIndexExpressions(indexRel)) ||
+			!expression_is_parallel_safe((Node *) RelationGetIndexPredicate(indexRel)))
+			safe = false;
+
+		index_close(indexRel, AccessShareLock);
+
+		if (!safe)
+			break;
+	}
+	list_free(indexoidlist);
+
+	return safe;
+}
+
+/*
+ * Run a COPY FROM using parallel workers.
+ *
+ * Returns false, before consuming any input, if the COPY can't be run in
+ * parallel or no workers could be launched; the caller then loads the data
+ * itself.  Otherwise the whole input is processed, and the number of rows
+ * inserted is returned in *processed.
+ */
+bool
+ParallelCopyFrom(CopyFromState cstate, uint64 *processed)
+{
+	ParallelContext *pcxt;
+	ParallelCopyShared *shared;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	shm_mq_handle **mqh;
+	char	   *queuespace;
+	char	   *attnames;
+	char	   *options;
+	char	   *where;
+	Size		attnames_len;
+	Size		options_len;
+	Size		where_len;
+	int			nrequested;
+	int			nworkers;
+	int			querylen;
+	int			next_worker = 0;
+	StringInfoData chunk;
+	ErrorContextCallback errcallback;
+
+	nrequested = CopyFromParallelWorkers(cstate);
+	if (nrequested == 0)
+		return false;
+
+	/*
+	 * The workers insert with our transaction ID and command ID.  They can't
+	 * assign either themselves, so make sure both exist before entering
+	 * parallel mode.
+	 */
+	(void) GetCurrentTransactionId();
+	(void) GetCurrentCommandId(true);
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "ParallelCopyFromMain",
+								 nrequested);
+
+	/* Estimate size for shared information -- PARALLEL_COPY_KEY_SHARED */
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(ParallelCopyShared));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Estimate space for BufferUsage and WalUsage of each worker */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Estimate space for the column list, options and WHERE clause */
+	attnames = nodeToString(cstate->attnamelist);
+	attnames_len = strlen(attnames) + 1;
+	options = nodeToString(cstate->options);
+	options_len = strlen(options) + 1;
+	where = nodeToString(cstate->whereClause);
+	where_len = strlen(where) + 1;
+	shm_toc_estimate_chunk(&pcxt->estimator, attnames_len);
+	shm_toc_estimate_chunk(&pcxt->estimator, options_len);
+	shm_toc_estimate_chunk(&pcxt->estimator, where_len);
+	shm_toc_estimate_keys(&pcxt->estimator, 3);
+
+	/* Estimate space for the queues -- PARALLEL_COPY_KEY_QUEUES */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(PARALLEL_COPY_QUEUE_SIZE, pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_COPY_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	InitializeParallelDSM(pcxt);
+
+	shared = (ParallelCopyShared *) shm_toc_allocate(pcxt->toc,
+													 sizeof(ParallelCopyShared));
+	shared->relid = RelationGetRelid(cstate->rel);
+	shared->queryid = pgstat_get_my_query_id();
+	pg_atomic_init_u64(&shared->processed, 0);
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_SHARED, shared);
+
+	buffer_usage = shm_toc_allocate(pcxt->toc,
+									mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_BUFFER_USAGE, buffer_usage);
+	wal_usage = shm_toc_allocate(pcxt->toc,
+								 mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_WAL_USAGE, wal_usage);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_ATTNAMES,
+				   memcpy(shm_toc_allocate(pcxt->toc, attnames_len),
+						  attnames, attnames_len));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_OPTIONS,
+				   memcpy(shm_toc_allocate(pcxt->toc, options_len),
+						  options, options_len));
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_WHERE,
+				   memcpy(shm_toc_allocate(pcxt->toc, where_len),
+						  where, where_len));
+
+	/* Create the queues, and become the sender for each. */
+	queuespace = shm_toc_allocate(pcxt->toc,
+								  mul_size(PARALLEL_COPY_QUEUE_SIZE,
+										   pcxt->nworkers));
+	mqh = palloc_array(shm_mq_handle *, pcxt->nworkers);
+	for (int i = 0; i < pcxt->nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(queuespace + ((Size) i) * PARALLEL_COPY_QUEUE_SIZE,
+						   (Size) PARALLEL_COPY_QUEUE_SIZE);
+		shm_mq_set_sender(mq, MyProc);
+		mqh[i] = shm_mq_attach(mq, pcxt->seg, NULL);
+	}
+	shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_QUEUES, queuespace);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		sharedquery[querylen] = '\0';
+		shm_toc_insert(pcxt->toc, PARALLEL_COPY_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	LaunchParallelWorkers(pcxt);
+	nworkers = pcxt->nworkers_launched;
+
+	if (cstate->opts.log_verbosity >= COPY_LOG_VERBOSITY_VERBOSE)
+		ereport(NOTICE,
+				(errmsg(ngettext("launched %d parallel worker for COPY (planned: %d)",
+								 "launched %d parallel workers for COPY (planned: %d)",
+								 nworkers),
+						nworkers, nrequested)));
+
+	/* No input has been read yet, so we can still fall back */
+	if (nworkers == 0)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return false;
+	}
+
+	/* Let the queues notice if a worker dies before attaching */
+	for (int i = 0; i < nworkers; i++)
+		shm_mq_set_handle(mqh[i], pcxt->worker[i].bgwhandle);
+
+	/* Set up callback to identify error line number */
+	errcallback.callback = CopyFromErrorCallback;
+	errcallback.arg = cstate;
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	/*
+	 * Split the input into lines and send them to the workers in chunks.
+	 * Each line is sent as its length followed by its contents, without the
+	 * end-of-line marker.
+	 */
+	initStringInfo(&chunk);
+	while (NextCopyFromRawLine(cstate))
+	{
+		uint32		len = cstate->line_buf.len;
+
+		if (chunk.len == 0)
+			appendBinaryStringInfo(&chunk, &cstate->cur_lineno,
+								   sizeof(uint64));
+		appendBinaryStringInfo(&chunk, &len, sizeof(uint32));
+		appendBinaryStringInfo(&chunk, cstate->line_buf.data, len);
+
+		if (chunk.len >= PARALLEL_COPY_CHUNK_SIZE)
+		{
+			/*
+			 * While waiting, we may rethrow an error from a worker, which
+			 * has its own line number; don't add ours.
+			 */
+			cstate->relname_only = true;
+			ParallelCopySendChunk(pcxt, mqh, nworkers, next_worker, &chunk);
+			cstate->relname_only = false;
+			next_worker = (next_worker + 1) % nworkers;
+		}
+	}
+
+	error_context_stack = errcallback.previous;
+
+	if (chunk.len > 0)
+		ParallelCopySendChunk(pcxt, mqh, nworkers, next_worker, &chunk);
+	pfree(chunk.data);
+
+	/* Detaching tells the workers that there's no more input */
+	for (int i = 0; i < nworkers; i++)
+		shm_mq_detach(mqh[i]);
+
+	WaitForParallelWorkersToFinish(pcxt);
+
+	/*
+	 * Next, accumulate buffer and WAL usage.  (This must wait for the workers
+	 * to finish, or we might get incomplete data.)
+	 */
+	for (int i = 0; i < nworkers; i++)
+		InstrAccumParallelQuery(&buffer_usage[i], &wal_usage[i]);
+
+	*processed = pg_atomic_read_u64(&shared->processed);
+	pgstat_progress_update_param(PROGRESS_COPY_TUPLES_PROCESSED, *processed);
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	return true;
+}
+
+/*
+ * Send a chunk of lines to the given worker, and reset the chunk buffer.
+ *
+ * We wait for room in the worker's queue rather than looking for a less busy
+ * worker, since a partially sent message has to be completed on the same
+ * queue.
+ */
+static void
+ParallelCopySendChunk(ParallelContext *pcxt, shm_mq_handle **mqh, int nqueues,
+					  int worker, StringInfo chunk)
+{
+	shm_mq_result res;
+
+	res = shm_mq_send(mqh[worker], chunk->len, chunk->data, false, true);
+	if (res != SHM_MQ_SUCCESS)
+	{
+		/*
+		 * The worker has exited, most likely because of an error.  Let the
+		 * remaining workers finish, so that the error, if any, gets
+		 * reported; the rows they inserted will be rolled back along with
+		 * our transaction.
+		 */
+		for (int i = 0; i < nqueues; i++)
+			shm_mq_detach(mqh[i]);
+		WaitForParallelWorkersToFinish(pcxt);
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("could not send data to parallel COPY worker")));
+	}
+
+	resetStringInfo(chunk);
+}
+
+/*
+ * Read the next line sent by the leader into line_buf, in a parallel COPY
+ * worker.  Returns true, with an empty line_buf, when the leader has sent
+ * the whole input.
+ */
+bool
+CopyFromParallelNextLine(CopyFromState cstate)
+{
+	ParallelCopyWorkerState *ws = cstate->pcopy;
+	uint32		len;
+
+	resetStringInfo(&cstate->line_buf);
+	cstate->line_buf_valid = false;
+
+	if (ws->chunk_off >= ws->chunk_len)
+	{
+		shm_mq_result res;
+		Size		nbytes;
+		void	   *data;
+
+		res = shm_mq_receive(ws->mqh, &nbytes, &data, false);
+		if (res == SHM_MQ_DETACHED)
+			return true;
+		Assert(res == SHM_MQ_SUCCESS);
+		Assert(nbytes > sizeof(uint64));
+
+		memcpy(&ws->next_lineno, data, sizeof(uint64));
+		ws->chunk = (char *) data + sizeof(uint64);
+		ws->chunk_len = nbytes - sizeof(uint64);
+		ws->chunk_off = 0;
+	}
+
+	memcpy(&len, ws->chunk + ws->chunk_off, sizeof(uint32));
+	ws->chunk_off += sizeof(uint32);
+	appendBinaryStringInfo(&cstate->line_buf, ws->chunk + ws->chunk_off, len);
+	ws->chunk_off += len;
+
+	cstate->cur_lineno = ws->next_lineno++;
+	cstate->line_buf_valid = true;
+
+	return false;
+}
+
+/*
+ * Data source callback for the workers' COPY state.  It is never called,
+ * since the lines come from CopyFromParallelNextLine().
+ */
+static int
+ParallelCopyNoData(void *outbuf, int minread, int maxread)
+{
+	return 0;
+}
+
+/*
+ * Perform the work of a parallel COPY FROM worker.
+ */
+void
+ParallelCopyFromMain(dsm_segment *seg, shm_toc *toc)
+{
+	ParallelCopyShared *shared;
+	ParallelCopyWorkerState *ws;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	Relation	rel;
+	ParseState *pstate;
+	ParseNamespaceItem *nsitem;
+	CopyFromState cstate;
+	List	   *attnamelist;
+	List	   *options;
+	Node	   *whereClause;
+	char	   *sharedquery;
+	char	   *queuespace;
+	shm_mq	   *mq;
+	uint64		processed;
+
+	shared = (ParallelCopyShared *) shm_toc_lookup(toc, PARALLEL_COPY_KEY_SHARED,
+												   false);
+
+	/* Set debug_query_string for individual workers */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_COPY_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Track query ID */
+	pgstat_report_query_id(shared->queryid, false);
+
+	/*
+	 * Open table.  The lock mode is the same as the leader process.  It's
+	 * okay because the lock mode does not conflict among the parallel
+	 * workers.
+	 */
+	rel = table_open(shared->relid, RowExclusiveLock);
+
+	attnamelist = (List *) stringToNode(shm_toc_lookup(toc, PARALLEL_COPY_KEY_ATTNAMES,
+													   false));
+	options = (List *) stringToNode(shm_toc_lookup(toc, PARALLEL_COPY_KEY_OPTIONS,
+												   false));
+	whereClause = stringToNode(shm_toc_lookup(toc, PARALLEL_COPY_KEY_WHERE,
+											  false));
+
+	/* Attach to our queue */
+	queuespace = shm_toc_lookup(toc, PARALLEL_COPY_KEY_QUEUES, false);
+	mq = (shm_mq *) (queuespace +
+					 ParallelWorkerNumber * PARALLEL_COPY_QUEUE_SIZE);
+	shm_mq_set_receiver(mq, MyProc);
+
+	ws = palloc0_object(ParallelCopyWorkerState);
+	ws->mqh = shm_mq_attach(mq, seg, NULL);
+
+	/*
+	 * Build the range table entry CopyFrom() needs.  The leader has already
+	 * checked permissions.
+	 */
+	pstate = make_parsestate(NULL);
+	pstate->p_sourcetext = debug_query_string;
+	nsitem = addRangeTableEntryForRelation(pstate, rel, RowExclusiveLock,
+										   NULL, false, false);
+	nsitem->p_perminfo->requiredPerms = ACL_INSERT;
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	cstate = BeginCopyFrom(pstate, rel, whereClause, NULL, false,
+						   ParallelCopyNoData, attnamelist, options);
+
+	/* The leader has taken care of the header, and of parallelism */
+	cstate->opts.header_line = COPY_HEADER_FALSE;
+	cstate->opts.nworkers = 0;
+	cstate->pcopy = ws;
+
+	processed = CopyFrom(cstate);
+	pg_atomic_fetch_add_u64(&shared->processed, processed);
+
+	EndCopyFrom(cstate);
+
+	/* Report buffer/WAL usage during parallel execution */
+	buffer_usage = shm_toc_lookup(toc, PARALLEL_COPY_KEY_BUFFER_USAGE, false);
+	wal_usage = shm_toc_lookup(toc, PARALLEL_COPY_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&buffer_usage[ParallelWorkerNumber],
+						  &wal_usage[ParallelWorkerNumber]);
+
+	shm_mq_detach(ws->mqh);
+	free_parsestate(pstate);
+	table_close(rel, RowExclusiveLock);
+}
@@ -71,7 +71,9 @@
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/pg_bitutils.h"
 #include "port/pg_bswap.h"
+#include "port/simd.h"
 #include "utils/builtins.h"
 #include "utils/rel.h"
 
@@ -138,8 +140,54 @@ if (1) \
 /* NOTE: there's a copy of this in copyto.c */
 static const char BinarySignature[11] = "PGCOPY\n\377\r\n\0";
 
+#ifndef USE_NO_SIMD
+
+/*
+ * Count the bytes at the start of buf[0 .. len - 1] that are none of the
+ * characters c1 to c4, which the caller can then copy or skip without
+ * looking at them one by one.  The input is examined sizeof(Vector8) bytes
+ * at a time, so less than that is left over at the end for the caller to
+ * examine the slow way.  Callers with fewer than four characters to look
+ * for pass some of them twice.
+ *
+ * This relies on the same property of the server encodings as the byte-by-
+ * byte loops: none of the characters COPY looks for can appear inside a
+ * multibyte character.
+ */
+static inline int
+CopyCountPlainBytes(const char *buf, int len,
+					char c1, char c2, char c3, char c4)
+{
+	const Vector8 v1 = vector8_broadcast((uint8) c1);
+	const Vector8 v2 = vector8_broadcast((uint8) c2);
+	const Vector8 v3 = vector8_broadcast((uint8) c3);
+	const Vector8 v4 = vector8_broadcast((uint8) c4);
+	int			i;
+
+	for (i = 0; i + (int) sizeof(Vector8) <= len; i += sizeof(Vector8))
+	{
+		Vector8		chunk;
+		Vector8		special;
+		uint32		mask;
+
+		vector8_load(&chunk, (const uint8 *) buf + i);
+		special = vector8_or(vector8_or(vector8_eq(chunk, v1),
+										vector8_eq(chunk, v2)),
+							 vector8_or(vector8_eq(chunk, v3),
+										vector8_eq(chunk, v4)));
+		mask = vector8_highbit_mask(special);
+		if (mask != 0)
+			return i + pg_rightmost_one_pos32(mask);
+	}
+
+	return i;
+}
+
+#endif							/* ! USE_NO_SIMD */
+
 
 /* non-export function prototypes */
+static bool CopyFromSkipHeader(CopyFromState cstate, bool is_csv);
 static bool CopyReadLine(CopyFromState cstate, bool is_csv);
 static bool CopyReadLineText(CopyFromState cstate, bool is_csv);
 static int	CopyReadAttributesText(CopyFromState cstate);
@@ -161,6 +209,7 @@ static pg_attribute_always_inline bool NextCopyFromRawFieldsInternal(CopyFromSta
 /* Low-level communications functions */
 static int	CopyGetData(CopyFromState cstate, void *databuf,
 						int minread, int maxread);
+static int	CopyClipToRange(CopyFromState cstate, char *buf, int nbytes);
 static inline bool CopyGetInt32(CopyFromState cstate, int32 *val);
 static inline bool CopyGetInt16(CopyFromState cstate, int16 *val);
 static void CopyLoadInputBuf(CopyFromState cstate);
@@ -228,6 +277,95 @@ ReceiveCopyBinaryHeader(CopyFromState cstate)
 	}
 }
 
+/*
+ * CopyFromSetRange
+ *		Read only part of the input file.
+ *
+ * This lets several processes share the work of reading one file: each one
+ * reads the lines that start at a byte offset between start and end, and
+ * together they read every line exactly once.  The line that straddles
+ * 'start' is skipped, and the line that straddles 'end' is read to its end.
+ * An end of -1 means the end of the file.
+ *
+ * Lines are told apart by newlines only, so this must not be used if quoted
+ * CSV fields or escaped text-format values can contain a newline.  Header
+ * lines are only skipped in the range that starts at the beginning of the
+ * file, and line numbers in error messages count from the start of the
+ * range.
+ *
+ * Must be called right after BeginCopyFrom() on a file, in text or CSV
+ * format.
+ */
+void
+CopyFromSetRange(CopyFromState cstate, pgoff_t start, pgoff_t end)
+{
+	Assert(cstate->copy_src == COPY_FILE && !cstate->opts.binary);
+	Assert(cstate->raw_buf_len == 0 && cstate->cur_lineno == 0);
+	Assert(start >= 0 && (end < 0 || end > start));
+
+	cstate->range_set = true;
+	cstate->range_done = false;
+	cstate->range_pos = start;
+	cstate->range_end = end;
+
+	if (start > 0)
+	{
+		int			c;
+
+		cstate->opts.header_line = COPY_HEADER_FALSE;
+
+		/*
+		 * Our first line is the one that follows the first newline at or
+		 * after start - 1.  If there is none before end - 1, the range
+		 * contains no line starts at all.
+		 */
+		if (fseeko(cstate->copy_file, start - 1, SEEK_SET) != 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek in COPY file: %m")));
+		cstate->range_pos = start - 1;
+		do
+		{
+			c = getc(cstate->copy_file);
+			cstate->range_pos++;
+		} while (c != '\n' && c != EOF);
+		if (ferror(cstate->copy_file))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from COPY file: %m")));
+
+		if (c == EOF || (end >= 0 && cstate->range_pos >= end))
+			cstate->range_done = true;
+	}
+}
+
+/*
+ * Cut the data just read from the file short after the newline that ends
+ * the last line of the range set by CopyFromSetRange().  Returns the number
+ * of bytes to keep.
+ */
+static int
+CopyClipToRange(CopyFromState cstate, char *buf, int nbytes)
+{
+	pgoff_t		pos = cstate->range_pos;
+	int			off = 0;
+	char	   *nl;
+
+	cstate->range_pos += nbytes;
+	if (cstate->range_end < 0 || cstate->range_pos < cstate->range_end)
+		return nbytes;
+
+	/* The next range's first line follows a newline at or after end - 1 */
+	if (pos < cstate->range_end - 1)
+		off = cstate->range_end - 1 - pos;
+	nl = memchr(buf + off, '\n', nbytes - off);
+	if (nl == NULL)
+		return nbytes;
+
+	cstate->range_done = true;
+	return nl - buf + 1;
+}
+
 /*
  * CopyGetData reads data from the source (file or frontend)
  *
@@ -249,6 +387,11 @@ CopyGetData(CopyFromState cstate, void *databuf, int minread, int maxread)
 	switch (cstate->copy_src)
 	{
 		case COPY_FILE:
+			if (cstate->range_done)
+			{
+				cstate->raw_reached_eof = true;
+				break;
+			}
 			bytesread = fread(databuf, 1, maxread, cstate->copy_file);
 			if (ferror(cstate->copy_file))
 				ereport(ERROR,
@@ -256,6 +399,8 @@ CopyGetData(CopyFromState cstate, void *databuf, int minread, int maxread)
 						 errmsg("could not read from COPY file: %m")));
 			if (bytesread == 0)
 				cstate->raw_reached_eof = true;
+			else if (cstate->range_set)
+				bytesread = CopyClipToRange(cstate, databuf, bytesread);
 			break;
 		case COPY_FRONTEND:
 			while (maxread > 0 && bytesread < minread && !cstate->raw_reached_eof)
@@ -739,6 +884,76 @@ CopyReadBinaryData(CopyFromState cstate, char *dest, int nbytes)
 	return copied_bytes;
 }
 
+/*
+ * Skip the header line(s) at the start of the input, verifying the column
+ * names first if HEADER MATCH was given.  Returns true if EOF was reached.
+ */
+static bool
+CopyFromSkipHeader(CopyFromState cstate, bool is_csv)
+{
+	ListCell   *cur;
+	TupleDesc	tupDesc;
+	int			fldct;
+	bool		done = false;
+	int			lines_to_skip = cstate->opts.header_line;
+
+	/* If set to "match", one header line is skipped */
+	if (cstate->opts.header_line == COPY_HEADER_MATCH)
+		lines_to_skip = 1;
+
+	tupDesc = RelationGetDescr(cstate->rel);
+
+	for (int i = 0; i < lines_to_skip; i++)
+	{
+		cstate->cur_lineno++;
+		if ((done = CopyReadLine(cstate, is_csv)))
+			break;
+	}
+
+	if (cstate->opts.header_line == COPY_HEADER_MATCH)
+	{
+		int			fldnum;
+
+		if (is_csv)
+			fldct = CopyReadAttributesCSV(cstate);
+		else
+			fldct = CopyReadAttributesText(cstate);
+
+		if (fldct != list_length(cstate->attnumlist))
+			ereport(ERROR,
+					(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+					 errmsg("wrong number of fields in header line: got %d, expected %d",
+							fldct, list_length(cstate->attnumlist))));
+
+		fldnum = 0;
+		foreach(cur, cstate->attnumlist)
+		{
+			int			attnum = lfirst_int(cur);
+			char	   *colName;
+			Form_pg_attribute attr = TupleDescAttr(tupDesc, attnum - 1);
+
+			Assert(fldnum < cstate->max_fields);
+
+			colName = cstate->raw_fields[fldnum++];
+			if (colName == NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+						 errmsg("column name mismatch in header line field %d: got null value (\"%s\"), expected \"%s\"",
+								fldnum, cstate->opts.null_print, NameStr(attr->attname))));
+
+			if (namestrcmp(&attr->attname, colName) != 0)
+			{
+				ereport(ERROR,
+						(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+						 errmsg("column name mismatch in header line field %d: got \"%s\", expected \"%s\"",
+								fldnum, colName, NameStr(attr->attname))));
+			}
+		}
+	}
+
+	return done;
+}
+
 /*
  * This function is exposed for use by extensions that read raw fields in the
  * next line. See NextCopyFromRawFieldsInternal() for details.
@@ -777,75 +992,22 @@ NextCopyFromRawFieldsInternal(CopyFromState cstate, char ***fields, int *nfields
 	Assert(!cstate->opts.binary);
 
 	/* on input check that the header line is correct if needed */
-	if (cstate->cur_lineno == 0 && cstate->opts.header_line != COPY_HEADER_FALSE)
-	{
-		ListCell   *cur;
-		TupleDesc	tupDesc;
-		int			lines_to_skip = cstate->opts.header_line;
-
-		/* If set to "match", one header line is skipped */
-		if (cstate->opts.header_line == COPY_HEADER_MATCH)
-			lines_to_skip = 1;
-
-		tupDesc = RelationGetDescr(cstate->rel);
-
-		for (int i = 0; i < lines_to_skip; i++)
-		{
-			cstate->cur_lineno++;
-			if ((done = CopyReadLine(cstate, is_csv)))
-				break;
-		}
-
-		if (cstate->opts.header_line == COPY_HEADER_MATCH)
-		{
-			int			fldnum;
-
-			if (is_csv)
-				fldct = CopyReadAttributesCSV(cstate);
-			else
-				fldct = CopyReadAttributesText(cstate);
-
-			if (fldct != list_length(cstate->attnumlist))
-				ereport(ERROR,
-						(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
-						 errmsg("wrong number of fields in header line: got %d, expected %d",
-								fldct, list_length(cstate->attnumlist))));
-
-			fldnum = 0;
-			foreach(cur, cstate->attnumlist)
-			{
-				int			attnum = lfirst_int(cur);
-				char	   *colName;
-				Form_pg_attribute attr = TupleDescAttr(tupDesc, attnum - 1);
-
-				Assert(fldnum < cstate->max_fields);
-
-				colName = cstate->raw_fields[fldnum++];
-				if (colName == NULL)
-					ereport(ERROR,
-							(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
-							 errmsg("column name mismatch in header line field %d: got null value (\"%s\"), expected \"%s\"",
-									fldnum, cstate->opts.null_print, NameStr(attr->attname))));
-
-				if (namestrcmp(&attr->attname, colName) != 0)
-				{
-					ereport(ERROR,
-							(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
-							 errmsg("column name mismatch in header line field %d: got \"%s\", expected \"%s\"",
-									fldnum, colName, NameStr(attr->attname))));
-				}
-			}
-		}
+	if (cstate->cur_lineno == 0 && cstate->opts.header_line != COPY_HEADER_FALSE &&
+		CopyFromSkipHeader(cstate, is_csv))
+		return false;
 
-		if (done)
-			return false;
+	/*
+	 * Actually read the line into memory here.  A parallel COPY worker gets
+	 * its lines, already split and numbered, from the leader.
+	 */
+	if (cstate->pcopy != NULL)
+		done = CopyFromParallelNextLine(cstate);
+	else
+	{
+		cstate->cur_lineno++;
+		done = CopyReadLine(cstate, is_csv);
 	}
 
-	cstate->cur_lineno++;
-
-	/* Actually read the line into memory here */
-	done = CopyReadLine(cstate, is_csv);
-
 	/*
 	 * EOF at start of line means we're done.  If we see EOF after some
 	 * characters, we act as though it was newline followed by EOF, ie,
@@ -865,6 +1027,32 @@ NextCopyFromRawFieldsInternal(CopyFromState cstate, char ***fields, int *nfields
 	return true;
 }
 
+/*
+ * Read the next input line into line_buf without splitting it into fields,
+ * skipping the header first if needed.  Returns false if no more lines.
+ *
+ * This is used by the leader of a parallel COPY FROM, which only finds the
+ * line boundaries and leaves the parsing to the workers.
+ */
+bool
+NextCopyFromRawLine(CopyFromState cstate)
+{
+	bool		is_csv = cstate->opts.csv_mode;
+	bool		done;
+
+	Assert(!cstate->opts.binary);
+
+	if (cstate->cur_lineno == 0 && cstate->opts.header_line != COPY_HEADER_FALSE &&
+		CopyFromSkipHeader(cstate, is_csv))
+		return false;
+
+	cstate->cur_lineno++;
+	done = CopyReadLine(cstate, is_csv);
+
+	/* As in NextCopyFromRawFieldsInternal(), EOF after data ends a line */
+	return !(done && cstate->line_buf.len == 0);
+}
+
 /*
  * Read next tuple from file for COPY FROM. Return false if no more tuples.
  *
@@ -1328,6 +1516,36 @@ CopyReadLineText(CopyFromState cstate, bool is_csv)
 			need_data = false;
 		}
 
+#ifndef USE_NO_SIMD
+
+		/*
+		 * Skip over the bytes before the next character that needs a closer
+		 * look: a newline, a backslash in text mode, or a quote or escape
+		 * character in CSV mode.  The escape character only counts right
+		 * before a quote, so any byte skipped clears last_was_esc.
+		 */
+		{
+			int			nplain;
+
+			if (is_csv)
+				nplain = CopyCountPlainBytes(&copy_input_buf[input_buf_ptr],
+											 copy_buf_len - input_buf_ptr,
+											 '\n', '\r', quotec,
+											 escapec != '\0' ? escapec : quotec);
+			else
+				nplain = CopyCountPlainBytes(&copy_input_buf[input_buf_ptr],
+											 copy_buf_len - input_buf_ptr,
+											 '\n', '\r', '\\', '\\');
+			if (nplain > 0)
+			{
+				input_buf_ptr += nplain;
+				last_was_esc = false;
+				if (input_buf_ptr >= copy_buf_len)
+					continue;
+			}
+		}
+#endif
+
 		/* OK to fetch a character */
 		prev_raw_ptr = input_buf_ptr;
 		c = copy_input_buf[input_buf_ptr++];
@@ -1645,6 +1863,19 @@ CopyReadAttributesText(CopyFromState cstate)
 		{
 			char		c;
 
+#ifndef USE_NO_SIMD
+			/* Copy the bytes up to the next delimiter or backslash at once */
+			{
+				int			nplain;
+
+				nplain = CopyCountPlainBytes(cur_ptr, line_end_ptr - cur_ptr,
+											 delimc, '\\', delimc, '\\');
+				memcpy(output_ptr, cur_ptr, nplain);
+				output_ptr += nplain;
+				cur_ptr += nplain;
+			}
+#endif
+
 			end_ptr = cur_ptr;
 			if (cur_ptr >= line_end_ptr)
 				break;
@@ -1900,6 +2131,21 @@ CopyReadAttributesCSV(CopyFromState cstate)
 			/* Not in quote */
 			for (;;)
 			{
+#ifndef USE_NO_SIMD
+				/* Copy the bytes up to the next delimiter or quote at once */
+				{
+					int			nplain;
+
+					nplain = CopyCountPlainBytes(cur_ptr,
+												 line_end_ptr - cur_ptr,
+												 delimc, quotec,
+												 delimc, quotec);
+					memcpy(output_ptr, cur_ptr, nplain);
+					output_ptr += nplain;
+					cur_ptr += nplain;
+				}
+#endif
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					goto endfield;
@@ -1923,6 +2169,21 @@ CopyReadAttributesCSV(CopyFromState cstate)
 			/* In quote */
 			for (;;)
 			{
+#ifndef USE_NO_SIMD
+				/* Copy the bytes up to the next quote or escape at once */
+				{
+					int			nplain;
+
+					nplain = CopyCountPlainBytes(cur_ptr,
+												 line_end_ptr - cur_ptr,
+												 quotec, escapec,
+												 quotec, escapec);
+					memcpy(output_ptr, cur_ptr, nplain);
+					output_ptr += nplain;
+					cur_ptr += nplain;
+				}
+#endif
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					ereport(ERROR,
@@ -21,22 +21,32 @@
 #include "access/table.h"
 #include "access/tableam.h"
 #include "catalog/pg_inherits.h"
+#include "catalog/pg_proc.h"
+#include "catalog/pg_type.h"
 #include "commands/copyapi.h"
 #include "commands/progress.h"
 #include "executor/execdesc.h"
 #include "executor/executor.h"
+#include "executor/nodeGather.h"
 #include "executor/tuptable.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/pg_bitutils.h"
+#include "port/simd.h"
 #include "storage/fd.h"
 #include "tcop/tcopprot.h"
+#include "utils/builtins.h"
+#include "utils/datetime.h"
+#include "utils/float.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
+#include "utils/timestamp.h"
 
 /*
  * Represents the different dest cases we need to worry about at
@@ -47,6 +57,7 @@ typedef enum CopyDest
 	COPY_FILE,					/* to file (or a piped program) */
 	COPY_FRONTEND,				/* to frontend */
 	COPY_CALLBACK,				/* to callback function */
+	COPY_LEADER,				/* to the leader, from a parallel worker */
 } CopyDest;
 
 /*
@@ -85,8 +96,12 @@ typedef struct CopyToStateData
 	char	   *filename;		/* filename, or NULL for STDOUT */
 	bool		is_program;		/* is 'filename' a program to popen? */
 	copy_data_dest_cb data_dest_cb; /* function for writing data */
+	DestReceiver *leader;		/* used if copy_dest == COPY_LEADER */
+	TupleTableSlot *leader_slot;	/* row to send with 'leader' */
+	bool		leader_alive;	/* has 'leader' accepted every row? */
 
 	CopyFormatOptions opts;
+	List	   *options;		/* options to pass on to parallel workers */
 	Node	   *whereClause;	/* WHERE condition (or NULL) */
 	List	   *partitions;		/* OID list of partitions to copy data from */
 
@@ -98,6 +113,9 @@ typedef struct CopyToStateData
 	FmgrInfo   *out_functions;	/* lookup info for output functions */
 	MemoryContext rowcontext;	/* per-row evaluation context */
 	uint64		bytes_processed;	/* number of bytes processed so far */
+
+	/* slot in which the query returns rows formatted by parallel workers */
+	TupleTableSlot *formatted_slot;
 } CopyToStateData;
 
 /* DestReceiver for COPY (query) TO */
@@ -108,9 +126,24 @@ typedef struct
 	uint64		processed;		/* # of tuples processed */
 } DR_copy;
 
+/* DestReceiver for a parallel worker's share of COPY (query) TO */
+typedef struct
+{
+	DestReceiver pub;			/* publicly-known function pointers */
+	CopyToState cstate;			/* set up by copy_worker_dest_startup */
+	List	   *info;			/* what the leader told us about the COPY */
+	DestReceiver *leader;		/* sends formatted rows to the leader */
+} DR_copy_worker;
+
 /* NOTE: there's a copy of this in copyfromparse.c */
 static const char BinarySignature[11] = "PGCOPY\n\377\r\n\0";
 
+/*
+ * Size of the buffer for CopyToTextLikeValue(): enough for the longest
+ * output of any of the types it handles itself, which is a timestamp.
+ */
+#define COPY_VALUE_BUFLEN	(MAXDATELEN + 1)
+
 
 /* non-export function prototypes */
 static void EndCopy(CopyToState cstate);
@@ -121,6 +154,8 @@ static void CopyAttributeOutCSV(CopyToState cstate, const char *string,
 								bool use_quote);
 static void CopyRelationTo(CopyToState cstate, Relation rel, Relation root_rel,
 						   uint64 *processed);
+static TupleDesc CopyFormattedRowDesc(void);
+static void CopyToSetupParallel(CopyToState cstate);
 
 /* built-in format-specific routines */
 static void CopyToTextLikeStart(CopyToState cstate, TupleDesc tupDesc);
@@ -130,6 +165,8 @@ static void CopyToCSVOneRow(CopyToState cstate, TupleTableSlot *slot);
 static void CopyToTextLikeOneRow(CopyToState cstate, TupleTableSlot *slot,
 								 bool is_csv);
 static void CopyToTextLikeEnd(CopyToState cstate);
+static inline char *CopyToTextLikeValue(FmgrInfo *finfo, Datum value,
+										char *buf);
 static void CopyToBinaryStart(CopyToState cstate, TupleDesc tupDesc);
 static void CopyToBinaryOutFunc(CopyToState cstate, Oid atttypid, FmgrInfo *finfo);
 static void CopyToBinaryOneRow(CopyToState cstate, TupleTableSlot *slot);
@@ -288,10 +325,11 @@ CopyToTextLikeOneRow(CopyToState cstate,
 		}
 		else
 		{
+			char		buf[COPY_VALUE_BUFLEN];
 			char	   *string;
 
-			string = OutputFunctionCall(&out_functions[attnum - 1],
-										value);
+			string = CopyToTextLikeValue(&out_functions[attnum - 1],
+										 value, buf);
 
 			if (is_csv)
 				CopyAttributeOutCSV(cstate, string,
@@ -311,6 +349,46 @@ CopyToTextLikeEnd(CopyToState cstate)
 	/* Nothing to do here */
 }
 
+/*
+ * Convert one attribute value to text for CopyToTextLikeOneRow().
+ *
+ * For a few common types, we produce the same text as the output function
+ * would, but write it into the caller's buffer of COPY_VALUE_BUFLEN bytes.
+ * That saves the function call overhead and a palloc() for every value.
+ * We look at the output function rather than the type, so that domains
+ * over these types get the same treatment.
+ */
+static inline char *
+CopyToTextLikeValue(FmgrInfo *finfo, Datum value, char *buf)
+{
+	switch (finfo->fn_oid)
+	{
+		case F_INT2OUT:
+			pg_itoa(DatumGetInt16(value), buf);
+			return buf;
+		case F_INT4OUT:
+			pg_ltoa(DatumGetInt32(value), buf);
+			return buf;
+		case F_INT8OUT:
+			pg_lltoa(DatumGetInt64(value), buf);
+			return buf;
+		case F_FLOAT4OUT:
+			float4out_buf(DatumGetFloat4(value), buf);
+			return buf;
+		case F_FLOAT8OUT:
+			float8out_buf(DatumGetFloat8(value), buf);
+			return buf;
+		case F_TIMESTAMP_OUT:
+			timestamp_out_buf(DatumGetTimestamp(value), buf);
+			return buf;
+		case F_TIMESTAMPTZ_OUT:
+			timestamptz_out_buf(DatumGetTimestampTz(value), buf);
+			return buf;
+		default:
+			return OutputFunctionCall(finfo, value);
+	}
+}
+
 /*
  * Implementation of the start callback for binary format. Send a header
  * for a binary copy.
@@ -494,6 +572,26 @@ CopySendEndOfRow(CopyToState cstate)
 		case COPY_CALLBACK:
 			cstate->data_dest_cb(fe_msgbuf->data, fe_msgbuf->len);
 			break;
+		case COPY_LEADER:
+			{
+				TupleTableSlot *slot = cstate->leader_slot;
+				bytea	   *row;
+
+				/* Ship the formatted row as a bytea; see CopyToSetupParallel */
+				row = (bytea *) MemoryContextAlloc(cstate->rowcontext,
+												   VARHDRSZ + fe_msgbuf->len);
+				SET_VARSIZE(row, VARHDRSZ + fe_msgbuf->len);
+				memcpy(VARDATA(row), fe_msgbuf->data, fe_msgbuf->len);
+
+				ExecClearTuple(slot);
+				slot->tts_values[0] = PointerGetDatum(row);
+				slot->tts_isnull[0] = false;
+				ExecStoreVirtualTuple(slot);
+
+				if (!cstate->leader->receiveSlot(slot, cstate->leader))
+					cstate->leader_alive = false;
+			}
+			break;
 	}
 
 	/* Update the progress */
@@ -735,6 +833,16 @@ BeginCopyTo(ParseState *pstate,
 	/* Extract options from the statement node tree */
 	ProcessCopyOptions(pstate, &cstate->opts, false /* is_from */ , options);
 
+	/*
+	 * Remember the options for any parallel workers.  They get FORCE_QUOTE
+	 * as per-column flags instead, since they don't know the column names.
+	 */
+	foreach_node(DefElem, defel, options)
+	{
+		if (strcmp(defel->defname, "force_quote") != 0)
+			cstate->options = lappend(cstate->options, copyObject(defel));
+	}
+
 	/* Set format routine */
 	cstate->routine = CopyToGetRoutine(&cstate->opts);
 
@@ -1126,6 +1234,9 @@ DoCopyTo(CopyToState cstate)
 	}
 	else
 	{
+		/* let parallel workers format rows, if there are any */
+		CopyToSetupParallel(cstate);
+
 		/* run the plan --- the dest receiver will send tuples */
 		ExecutorRun(cstate->queryDesc, ForwardScanDirection, 0);
 		processed = ((DR_copy *) cstate->queryDesc->dest)->processed;
@@ -1208,6 +1319,58 @@ CopyRelationTo(CopyToState cstate, Relation rel, Relation root_rel, uint64 *proc
 	table_endscan(scandesc);
 }
 
+/*
+ * Tuple descriptor of the rows parallel workers send, each holding one row
+ * of COPY output as a bytea.
+ */
+static TupleDesc
+CopyFormattedRowDesc(void)
+{
+	TupleDesc	desc = CreateTemplateTupleDesc(1);
+
+	TupleDescInitEntry(desc, (AttrNumber) 1, "row", BYTEAOID, -1, 0);
+
+	return desc;
+}
+
+/*
+ * If the query has a Gather at the top, make its workers convert their rows
+ * to COPY format themselves, instead of leaving all the output function
+ * calls to us.  The workers send the formatted rows up the tuple queues,
+ * and copy_dest_receive then just has to pass them on.
+ *
+ * We can only do this if the Gather passes its rows through unchanged and
+ * the output functions are safe to run in a worker.
+ */
+static void
+CopyToSetupParallel(CopyToState cstate)
+{
+	GatherState *gather;
+	List	   *force_quote = NIL;
+	List	   *info;
+
+	if (!IsA(cstate->queryDesc->planstate, GatherState))
+		return;
+	gather = (GatherState *) cstate->queryDesc->planstate;
+	if (gather->ps.ps_ProjInfo != NULL)
+		return;
+
+	foreach_int(attnum, cstate->attnumlist)
+	{
+		if (func_parallel(cstate->out_functions[attnum - 1].fn_oid) !=
+			PROPARALLEL_SAFE)
+			return;
+		if (cstate->opts.force_quote_flags[attnum - 1])
+			force_quote = lappend_int(force_quote, attnum);
+	}
+
+	info = list_make3(cstate->options, force_quote,
+					  makeInteger(cstate->file_encoding));
+	ExecGatherSetWorkerDest(gather, PARALLEL_DEST_COPY, (Node *) info,
+							CopyFormattedRowDesc());
+	cstate->formatted_slot = gather->funnel_slot;
+}
+
 /*
  * Emit one row during DoCopyTo().
  */
@@ -1236,6 +1399,54 @@ CopyOneRowTo(CopyToState cstate, TupleTableSlot *slot)
 			CopySendData(cstate, start, ptr - start); \
 	} while (0)
 
+#ifndef USE_NO_SIMD
+
+/*
+ * Count the bytes at the start of str[0 .. len - 1] that can be sent as they
+ * are: bytes that are none of c1 to c4 and, if 'ctrl' is true, not ASCII
+ * control characters either.  The string is examined sizeof(Vector8) bytes
+ * at a time, leaving any shorter remainder for the caller's byte-by-byte
+ * loop.  Callers with fewer than four characters to look for pass some of
+ * them twice.
+ *
+ * Like that loop, this must only be used when the encoding doesn't embed
+ * ASCII bytes in multibyte characters.
+ */
+static inline int
+CopyCountPlainBytes(const char *str, int len,
+					char c1, char c2, char c3, char c4, bool ctrl)
+{
+	const Vector8 v1 = vector8_broadcast((uint8) c1);
+	const Vector8 v2 = vector8_broadcast((uint8) c2);
+	const Vector8 v3 = vector8_broadcast((uint8) c3);
+	const Vector8 v4 = vector8_broadcast((uint8) c4);
+	const Vector8 vctrl = vector8_broadcast(0x1F);
+	int			i;
+
+	for (i = 0; i + (int) sizeof(Vector8) <= len; i += sizeof(Vector8))
+	{
+		Vector8		chunk;
+		Vector8		special;
+		uint32		mask;
+
+		vector8_load(&chunk, (const uint8 *) str + i);
+		special = vector8_or(vector8_or(vector8_eq(chunk, v1),
+										vector8_eq(chunk, v2)),
+							 vector8_or(vector8_eq(chunk, v3),
+										vector8_eq(chunk, v4)));
+		if (ctrl)
+			special = vector8_or(special,
+								 vector8_eq(vector8_min(chunk, vctrl), chunk));
+		mask = vector8_highbit_mask(special);
+		if (mask != 0)
+			return i + pg_rightmost_one_pos32(mask);
+	}
+
+	return i;
+}
+
+#endif							/* ! USE_NO_SIMD */
+
 static void
 CopyAttributeOutText(CopyToState cstate, const char *string)
 {
@@ -1325,9 +1536,21 @@ CopyAttributeOutText(CopyToState cstate, const char *string)
 	}
 	else
 	{
+#ifndef USE_NO_SIMD
+		const char *end = ptr + strlen(ptr);
+#endif
+
 		start = ptr;
-		while ((c = *ptr) != '\0')
+		for (;;)
 		{
+#ifndef USE_NO_SIMD
+			/* Skip quickly to the next byte that might need escaping */
+			ptr += CopyCountPlainBytes(ptr, end - ptr, '\\', delimc,
+									   '\\', delimc, true);
+#endif
+			if ((c = *ptr) == '\0')
+				break;
+
 			if ((unsigned char) c < (unsigned char) 0x20)
 			{
 				/*
@@ -1400,6 +1623,9 @@ CopyAttributeOutCSV(CopyToState cstate, const char *string,
 	char		quotec = cstate->opts.quote[0];
 	char		escapec = cstate->opts.escape[0];
 	bool		single_attr = (list_length(cstate->attnumlist) == 1);
+#ifndef USE_NO_SIMD
+	const char *end;
+#endif
 
 	/* force quoting if it matches null_print (before conversion!) */
 	if (!use_quote && strcmp(string, cstate->opts.null_print) == 0)
@@ -1410,6 +1636,10 @@ CopyAttributeOutCSV(CopyToState cstate, const char *string,
 	else
 		ptr = string;
 
+#ifndef USE_NO_SIMD
+	end = ptr + strlen(ptr);
+#endif
+
 	/*
 	 * Make a preliminary pass to discover if it needs quoting
 	 */
@@ -1428,6 +1658,11 @@ CopyAttributeOutCSV(CopyToState cstate, const char *string,
 		{
 			const char *tptr = ptr;
 
+#ifndef USE_NO_SIMD
+			if (!cstate->encoding_embeds_ascii)
+				tptr += CopyCountPlainBytes(tptr, end - tptr, delimc, quotec,
+											'\n', '\r', false);
+#endif
 			while ((c = *tptr) != '\0')
 			{
 				if (c == delimc || c == quotec || c == '\n' || c == '\r')
@@ -1451,8 +1686,16 @@ CopyAttributeOutCSV(CopyToState cstate, const char *string,
 		 * We adopt the same optimization strategy as in CopyAttributeOutText
 		 */
 		start = ptr;
-		while ((c = *ptr) != '\0')
+		for (;;)
 		{
+#ifndef USE_NO_SIMD
+			if (!cstate->encoding_embeds_ascii)
+				ptr += CopyCountPlainBytes(ptr, end - ptr, quotec, escapec,
+										   quotec, escapec, false);
+#endif
+			if ((c = *ptr) == '\0')
+				break;
+
 			if (c == quotec || c == escapec)
 			{
 				DUMPSOFAR();
@@ -1494,7 +1737,20 @@ copy_dest_receive(TupleTableSlot *slot, DestReceiver *self)
 	CopyToState cstate = myState->cstate;
 
 	/* Send the data */
-	CopyOneRowTo(cstate, slot);
+	if (slot == cstate->formatted_slot)
+	{
+		/* A parallel worker has formatted the row already */
+		bool		isnull;
+		bytea	   *row = DatumGetByteaPP(slot_getattr(slot, 1, &isnull));
+
+		CopySendData(cstate, VARDATA_ANY(row), VARSIZE_ANY_EXHDR(row));
+		if (cstate->opts.binary)
+			CopySendEndOfRow(cstate);
+		else
+			CopySendTextLikeEndOfRow(cstate);
+	}
+	else
+		CopyOneRowTo(cstate, slot);
 
 	/* Increment the number of processed tuples, and report the progress */
 	pgstat_progress_update_param(PROGRESS_COPY_TUPLES_PROCESSED,
@@ -1540,3 +1796,123 @@ CreateCopyDestReceiver(void)
 
 	return (DestReceiver *) self;
 }
+
+/*
+ * copy_worker_dest_startup --- executor startup in a parallel worker
+ *
+ * Set up just enough of a CopyToState to format rows the same way as the
+ * leader does.
+ */
+static void
+copy_worker_dest_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
+{
+	DR_copy_worker *myState = (DR_copy_worker *) self;
+	CopyToState cstate;
+	MemoryContext oldcontext;
+
+	cstate = palloc0_object(CopyToStateData);
+	cstate->copycontext = AllocSetContextCreate(CurrentMemoryContext,
+												"COPY",
+												ALLOCSET_DEFAULT_SIZES);
+	oldcontext = MemoryContextSwitchTo(cstate->copycontext);
+
+	ProcessCopyOptions(NULL, &cstate->opts, false /* is_from */ ,
+					   linitial(myState->info));
+	cstate->routine = CopyToGetRoutine(&cstate->opts);
+	cstate->attnumlist = CopyGetAttnums(typeinfo, NULL, NIL);
+
+	cstate->opts.force_quote_flags = (bool *) palloc0(typeinfo->natts * sizeof(bool));
+	foreach_int(attnum, (List *) lsecond(myState->info))
+		cstate->opts.force_quote_flags[attnum - 1] = true;
+
+	cstate->file_encoding = intVal(lthird(myState->info));
+	cstate->need_transcoding =
+		!(cstate->file_encoding == GetDatabaseEncoding() ||
+		  cstate->file_encoding == PG_SQL_ASCII);
+	cstate->encoding_embeds_ascii = PG_ENCODING_IS_CLIENT_ONLY(cstate->file_encoding);
+
+	/* As in CopyToTextLikeStart(), but the leader sends any header */
+	cstate->opts.null_print_client = cstate->opts.null_print;
+	if (!cstate->opts.binary && cstate->need_transcoding)
+		cstate->opts.null_print_client = pg_server_to_any(cstate->opts.null_print,
+														  cstate->opts.null_print_len,
+														  cstate->file_encoding);
+
+	cstate->fe_msgbuf = makeStringInfo();
+	cstate->out_functions = (FmgrInfo *) palloc(typeinfo->natts * sizeof(FmgrInfo));
+	foreach_int(attnum, cstate->attnumlist)
+	{
+		Form_pg_attribute attr = TupleDescAttr(typeinfo, attnum - 1);
+
+		cstate->routine->CopyToOutFunc(cstate, attr->atttypid,
+									   &cstate->out_functions[attnum - 1]);
+	}
+
+	cstate->copy_dest = COPY_LEADER;
+	cstate->leader = myState->leader;
+	cstate->leader_slot = MakeSingleTupleTableSlot(CopyFormattedRowDesc(),
+												   &TTSOpsVirtual);
+	cstate->leader_alive = true;
+
+	cstate->rowcontext = AllocSetContextCreate(CurrentMemoryContext,
+											   "COPY TO",
+											   ALLOCSET_DEFAULT_SIZES);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	myState->cstate = cstate;
+}
+
+/*
+ * copy_worker_dest_receive --- format one tuple and send it to the leader
+ */
+static bool
+copy_worker_dest_receive(TupleTableSlot *slot, DestReceiver *self)
+{
+	DR_copy_worker *myState = (DR_copy_worker *) self;
+
+	CopyOneRowTo(myState->cstate, slot);
+
+	return myState->cstate->leader_alive;
+}
+
+/*
+ * copy_worker_dest_shutdown --- executor end in a parallel worker
+ */
+static void
+copy_worker_dest_shutdown(DestReceiver *self)
+{
+	DR_copy_worker *myState = (DR_copy_worker *) self;
+
+	if (myState->cstate != NULL)
+	{
+		ExecDropSingleTupleTableSlot(myState->cstate->leader_slot);
+		MemoryContextDelete(myState->cstate->rowcontext);
+		MemoryContextDelete(myState->cstate->copycontext);
+		pfree(myState->cstate);
+		myState->cstate = NULL;
+	}
+}
+
+/*
+ * CreateCopyToWorkerDestReceiver -- create a DestReceiver for a parallel
+ * worker's share of COPY (query) TO
+ *
+ * 'info' is what CopyToSetupParallel passed to the workers.  The rows are
+ * formatted here and sent on to 'leader', which the caller still owns.
+ */
+DestReceiver *
+CreateCopyToWorkerDestReceiver(List *info, DestReceiver *leader)
+{
+	DR_copy_worker *self = palloc0_object(DR_copy_worker);
+
+	self->pub.receiveSlot = copy_worker_dest_receive;
+	self->pub.rStartup = copy_worker_dest_startup;
+	self->pub.rShutdown = copy_worker_dest_shutdown;
+	self->pub.rDestroy = copy_dest_destroy;
+	self->pub.mydest = DestCopyOut;
+	self->info = info;
+	self->leader = leader;
+
+	return (DestReceiver *) self;
+}
@@ -35,8 +35,11 @@
 #include "commands/prepare.h"
 #include "commands/tablecmds.h"
 #include "commands/view.h"
+#include "access/xlog.h"
+#include "catalog/pg_am_d.h"
 #include "executor/execdesc.h"
 #include "executor/executor.h"
+#include "executor/nodeGather.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "nodes/queryjumble.h"
@@ -52,6 +55,8 @@ typedef struct
 {
 	DestReceiver pub;			/* publicly-known function pointers */
 	IntoClause *into;			/* target relation specification */
+	GatherState *gather;		/* Gather at the top of the plan, if any */
+	Oid			relid;			/* relation to insert into, in a worker */
 	/* These fields are filled by intorel_startup: */
 	Relation	rel;			/* relation to write to */
 	ObjectAddress reladdr;		/* address of rel, for ExecCreateTableAs */
@@ -66,6 +71,9 @@ static ObjectAddress create_ctas_nodata(List *tlist, IntoClause *into);
 
 /* DestReceiver routines for collecting data */
 static void intorel_startup(DestReceiver *self, int operation, TupleDesc typeinfo);
+static void intorel_worker_startup(DestReceiver *self, int operation,
+								   TupleDesc typeinfo);
+static bool intorel_parallel_ok(DR_intorel *myState);
 static bool intorel_receive(TupleTableSlot *slot, DestReceiver *self);
 static void intorel_shutdown(DestReceiver *self);
 static void intorel_destroy(DestReceiver *self);
@@ -236,6 +244,10 @@ ExecCreateTableAs(ParseState *pstate, CreateTableAsStmt *stmt,
 	if (CreateTableAsRelExists(stmt))
 		return InvalidObjectAddress;
 
+	/* Reject queries that can't be maintained before creating anything */
+	if (is_matview && into->incremental)
+		CheckIncrementalMatViewQuery(into->viewQuery);
+
 	/*
 	 * Create the tuple receiver object and insert info it will need
 	 */
@@ -287,6 +299,10 @@ ExecCreateTableAs(ParseState *pstate, CreateTableAsStmt *stmt,
 		 */
 		address = create_ctas_nodata(query->targetList, into);
 
+		if (is_matview && into->incremental)
+			CreateIncrementalMatViewTriggers(address.objectId,
+											 into->viewQuery);
+
 		/*
 		 * For materialized views, reuse the REFRESH logic, which locks down
 		 * security-restricted operations and restricts the search_path.  This
@@ -341,6 +357,13 @@ ExecCreateTableAs(ParseState *pstate, CreateTableAsStmt *stmt,
 		/* call ExecutorStart to prepare the plan for execution */
 		ExecutorStart(queryDesc, GetIntoRelEFlags(into));
 
+		/*
+		 * If the plan has a Gather at the top, its workers might be able to
+		 * insert their rows themselves; intorel_startup decides.
+		 */
+		if (IsA(queryDesc->planstate, GatherState))
+			((DR_intorel *) dest)->gather = (GatherState *) queryDesc->planstate;
+
 		/* run the plan to completion */
 		ExecutorRun(queryDesc, ForwardScanDirection, 0);
 
@@ -452,6 +475,22 @@ CreateIntoRelDestReceiver(IntoClause *intoClause)
 	return (DestReceiver *) self;
 }
 
+/*
+ * CreateIntoRelWorkerDestReceiver -- create a DestReceiver for a parallel
+ * worker that inserts its share of the rows of CREATE TABLE AS into the
+ * table the leader has created.
+ */
+DestReceiver *
+CreateIntoRelWorkerDestReceiver(Oid relid)
+{
+	DR_intorel *self = (DR_intorel *) CreateIntoRelDestReceiver(NULL);
+
+	self->pub.rStartup = intorel_worker_startup;
+	self->relid = relid;
+
+	return (DestReceiver *) self;
+}
+
 /*
  * intorel_startup --- executor startup
  */
@@ -574,6 +613,60 @@ intorel_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
 	 * This may be harmless, but this function hasn't planned for it.
 	 */
 	Assert(RelationGetTargetBlock(intoRelationDesc) == InvalidBlockNumber);
+
+	/*
+	 * Now that the table exists, let the workers of a Gather at the top of
+	 * the plan insert their rows into it directly, rather than funnel them
+	 * all through us.  They insert with our transaction and command IDs,
+	 * which we have both assigned by now.
+	 */
+	if (myState->gather != NULL && !into->skipData &&
+		intorel_parallel_ok(myState))
+		ExecGatherSetWorkerDest(myState->gather, PARALLEL_DEST_INTOREL,
+								(Node *) list_make1_oid(intoRelationAddr.objectId),
+								NULL);
+}
+
+/*
+ * Can the workers of myState->gather insert into the new table?
+ *
+ * Workers can only insert into heap tables, and can't access our temporary
+ * tables.  With wal_level = minimal, we skip WAL for the new table and sync
+ * it at commit instead, but the workers don't know that the table is new in
+ * this transaction and would WAL-log their inserts; don't mix the two.
+ */
+static bool
+intorel_parallel_ok(DR_intorel *myState)
+{
+	Relation	rel = myState->rel;
+
+	/* The workers' tuples must be exactly what the Gather returns */
+	if (myState->gather->ps.ps_ProjInfo != NULL)
+		return false;
+
+	if (rel->rd_rel->relam != HEAP_TABLE_AM_OID ||
+		RelationUsesLocalBuffers(rel))
+		return false;
+
+	if (RelationIsPermanent(rel) && !RelationNeedsWAL(rel))
+		return false;
+
+	return true;
+}
+
+/*
+ * intorel_worker_startup --- executor startup in a parallel worker
+ */
+static void
+intorel_worker_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
+{
+	DR_intorel *myState = (DR_intorel *) self;
+
+	/* The leader holds AccessExclusiveLock; group locking lets us in */
+	myState->rel = table_open(myState->relid, RowExclusiveLock);
+	myState->output_cid = GetCurrentCommandId(true);
+	myState->ti_options = TABLE_INSERT_SKIP_FSM;
+	myState->bistate = GetBulkInsertState();
 }
 
 /*
@@ -585,7 +678,7 @@ intorel_receive(TupleTableSlot *slot, DestReceiver *self)
 	DR_intorel *myState = (DR_intorel *) self;
 
 	/* Nothing to insert if WITH NO DATA is specified. */
-	if (!myState->into->skipData)
+	if (myState->bistate != NULL)
 	{
 		/*
 		 * Note that the input slot might not be of the type of the target
@@ -614,9 +707,8 @@ static void
 intorel_shutdown(DestReceiver *self)
 {
 	DR_intorel *myState = (DR_intorel *) self;
-	IntoClause *into = myState->into;
 
-	if (!into->skipData)
+	if (myState->bistate != NULL)
 	{
 		FreeBulkInsertState(myState->bistate);
 		table_finish_bulk_insert(myState->rel, myState->ti_options);
@@ -19,6 +19,7 @@
 #include "commands/discard.h"
 #include "commands/prepare.h"
 #include "commands/sequence.h"
+#include "miscadmin.h"
 #include "utils/guc.h"
 #include "utils/portal.h"
 
@@ -65,6 +66,9 @@ DiscardAll(bool isTopLevel)
 	 */
 	PreventInTransactionBlock(isTopLevel, "DISCARD ALL");
 
+	/* This drops protocol-level prepared statements, too */
+	MySessionPinned = true;
+
 	/* Closing portals might run user-defined code, so do that first. */
 	PortalHashTableDeleteAll();
 	SetPGVariable("session_authorization", NIL, false);
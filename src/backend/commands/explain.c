@@ -134,6 +134,8 @@ static void show_recursive_union_info(RecursiveUnionState *rstate,
 									  ExplainState *es);
 static void show_memoize_info(MemoizeState *mstate, List *ancestors,
 							  ExplainState *es);
+static void show_subplan_cache_info(SubPlanState *sps, ExplainState *es);
+static void show_nestloop_info(NestLoopState *nlstate, ExplainState *es);
 static void show_hashagg_info(AggState *aggstate, ExplainState *es);
 static void show_indexsearches_info(PlanState *planstate, ExplainState *es);
 static void show_tidbitmap_info(BitmapHeapScanState *planstate,
@@ -509,7 +511,11 @@ ExplainOnePlan(PlannedStmt *plannedstmt, IntoClause *into, ExplainState *es,
 	Assert(plannedstmt->commandType != CMD_UTILITY);
 
 	if (es->analyze && es->timing)
+	{
 		instrument_option |= INSTRUMENT_TIMER;
+		if (es->sampling)
+			instrument_option |= INSTRUMENT_TIMER_SAMPLED;
+	}
 	else if (es->analyze)
 		instrument_option |= INSTRUMENT_ROWS;
 
@@ -1966,6 +1972,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 										   planstate, es);
 			show_scan_qual(((IndexScan *) plan)->indexorderbyorig,
 						   "Order By", planstate, ancestors, es);
+			if (((IndexScan *) plan)->indexskipdistinct)
+				ExplainPropertyBool("Loose Scan", true, es);
 			show_scan_qual(plan->qual, "Filter", planstate, ancestors, es);
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
@@ -1980,6 +1988,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 										   planstate, es);
 			show_scan_qual(((IndexOnlyScan *) plan)->indexorderby,
 						   "Order By", planstate, ancestors, es);
+			if (((IndexOnlyScan *) plan)->indexskipdistinct)
+				ExplainPropertyBool("Loose Scan", true, es);
 			show_scan_qual(plan->qual, "Filter", planstate, ancestors, es);
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
@@ -2021,6 +2031,15 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			if (IsA(plan, SeqScan) &&
+				((SeqScanState *) planstate)->runtime_filter != NULL)
+				show_instrumentation_count("Rows Removed by Runtime Filter", 2,
+										   planstate, es);
+			if (IsA(plan, SeqScan) &&
+				((SeqScanState *) planstate)->batchqual != NULL)
+				ExplainPropertyInteger("Filter Batch Size", NULL,
+									   ((SeqScanState *) planstate)->batchsize,
+									   es);
 			if (IsA(plan, CteScan))
 				show_ctescan_info(castNode(CteScanState, planstate), es);
 			break;
@@ -2170,6 +2189,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 2,
 										   planstate, es);
+			if (es->analyze)
+				show_nestloop_info(castNode(NestLoopState, planstate), es);
 			break;
 		case T_MergeJoin:
 			show_upper_qual(((MergeJoin *) plan)->mergeclauses,
@@ -2267,6 +2288,10 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			break;
 	}
 
+	/* If this is the top node of a cached SubPlan, show the cache's stats */
+	if (es->subplan_state && es->subplan_state->planstate == planstate)
+		show_subplan_cache_info(es->subplan_state, es);
+
 	/*
 	 * Prepare per-worker JIT instrumentation.  As with the overall JIT
 	 * summary, this is printed only if printing costs is enabled.
@@ -3581,6 +3606,34 @@ show_recursive_union_info(RecursiveUnionState *rstate, ExplainState *es)
 	show_storage_info(maxStorageType, maxSpaceUsed, es);
 }
 
+/*
+ * Show whether an adaptive nestloop switched to hashing.
+ */
+static void
+show_nestloop_info(NestLoopState *nlstate, ExplainState *es)
+{
+	if (nlstate->nl_SwitchedAfter > 0)
+	{
+		if (es->format == EXPLAIN_FORMAT_TEXT)
+		{
+			ExplainIndentText(es);
+			appendStringInfo(es->str,
+							 "Join Strategy: Hash  Switched After: " UINT64_FORMAT " outer rows\n",
+							 nlstate->nl_SwitchedAfter);
+		}
+		else
+		{
+			ExplainPropertyText("Join Strategy", "Hash", es);
+			ExplainPropertyUInteger("Switched After", "rows",
+									nlstate->nl_SwitchedAfter, es);
+		}
+	}
+	else if (nlstate->nl_HashFailed)
+		ExplainPropertyText("Join Strategy",
+							"Nested Loop (hash table exceeded memory limit)",
+							es);
+}
+
 /*
  * Show information on memoize hits/misses/evictions and memory usage.
  */
@@ -3661,6 +3714,8 @@ show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
 		{
 			ExplainPropertyInteger("Cache Hits", NULL, mstate->stats.cache_hits, es);
 			ExplainPropertyInteger("Cache Misses", NULL, mstate->stats.cache_misses, es);
+			if (mstate->stats.shared_hits > 0)
+				ExplainPropertyInteger("Shared Cache Hits", NULL, mstate->stats.shared_hits, es);
 			ExplainPropertyInteger("Cache Evictions", NULL, mstate->stats.cache_evictions, es);
 			ExplainPropertyInteger("Cache Overflows", NULL, mstate->stats.cache_overflows, es);
 			ExplainPropertyInteger("Peak Memory Usage", "kB", memPeakKb, es);
@@ -3675,6 +3730,12 @@ show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
 							 mstate->stats.cache_evictions,
 							 mstate->stats.cache_overflows,
 							 memPeakKb);
+			if (mstate->stats.shared_hits > 0)
+			{
+				ExplainIndentText(es);
+				appendStringInfo(es->str, "Shared Hits: " UINT64_FORMAT "\n",
+								 mstate->stats.shared_hits);
+			}
 		}
 	}
 
@@ -3714,6 +3775,12 @@ show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
 							 si->cache_hits, si->cache_misses,
 							 si->cache_evictions, si->cache_overflows,
 							 memPeakKb);
+			if (si->shared_hits > 0)
+			{
+				ExplainIndentText(es);
+				appendStringInfo(es->str, "Shared Hits: " UINT64_FORMAT "\n",
+								 si->shared_hits);
+			}
 		}
 		else
 		{
@@ -3721,6 +3788,9 @@ show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
 								   si->cache_hits, es);
 			ExplainPropertyInteger("Cache Misses", NULL,
 								   si->cache_misses, es);
+			if (si->shared_hits > 0)
+				ExplainPropertyInteger("Shared Cache Hits", NULL,
+									   si->shared_hits, es);
 			ExplainPropertyInteger("Cache Evictions", NULL,
 								   si->cache_evictions, es);
 			ExplainPropertyInteger("Cache Overflows", NULL,
@@ -3734,6 +3804,41 @@ show_memoize_info(MemoizeState *mstate, List *ancestors, ExplainState *es)
 	}
 }
 
+/*
+ * Show the hit and miss counts of a SubPlan's result cache, if it has one.
+ */
+static void
+show_subplan_cache_info(SubPlanState *sps, ExplainState *es)
+{
+	int64		memPeakKb;
+
+	if (!es->analyze || sps->cache == NULL || sps->cacheMisses == 0)
+		return;
+
+	/* cacheMemPeak is only updated when the cache is emptied */
+	memPeakKb = BYTES_TO_KILOBYTES(Max(sps->cacheMemPeak,
+									   MemoryContextMemAllocated(sps->cacheContext,
+																 true)));
+
+	if (es->format != EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainPropertyInteger("Subplan Cache Hits", NULL, sps->cacheHits, es);
+		ExplainPropertyInteger("Subplan Cache Misses", NULL, sps->cacheMisses, es);
+		ExplainPropertyInteger("Subplan Cache Evictions", NULL, sps->cacheEvictions, es);
+		ExplainPropertyInteger("Subplan Cache Peak Memory Usage", "kB", memPeakKb, es);
+	}
+	else
+	{
+		ExplainIndentText(es);
+		appendStringInfo(es->str,
+						 "Subplan Cache Hits: " UINT64_FORMAT "  Misses: " UINT64_FORMAT "  Evictions: " UINT64_FORMAT "  Memory Usage: " INT64_FORMAT "kB\n",
+						 sps->cacheHits,
+						 sps->cacheMisses,
+						 sps->cacheEvictions,
+						 memPeakKb);
+	}
+}
+
 /*
  * Show information on hash aggregate memory usage and batches.
  */
@@ -4907,6 +5012,7 @@ ExplainSubPlans(List *plans, List *ancestors,
 	{
 		SubPlanState *sps = (SubPlanState *) lfirst(lst);
 		SubPlan    *sp = sps->subplan;
+		SubPlanState *save_subplan_state;
 		char	   *cooked_plan_name;
 
 		/*
@@ -4943,9 +5049,13 @@ ExplainSubPlans(List *plans, List *ancestors,
 		else
 			cooked_plan_name = psprintf("SubPlan %s", sp->plan_name);
 
+		save_subplan_state = es->subplan_state;
+		es->subplan_state = sps;
+
 		ExplainNode(sps->planstate, ancestors,
 					relationship, cooked_plan_name, es);
 
+		es->subplan_state = save_subplan_state;
 		ancestors = list_delete_first(ancestors);
 	}
 }
@@ -25,6 +25,7 @@
 #include "access/xact.h"
 #include "catalog/catalog.h"
 #include "catalog/index.h"
+#include "catalog/indexcapture.h"
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_am.h"
@@ -608,10 +609,13 @@ DefineIndex(Oid tableId,
 	 * Force non-concurrent build on temporary relations, even if CONCURRENTLY
 	 * was requested.  Other backends can't access a temporary relation, so
 	 * there's no harm in grabbing a stronger lock, and a non-concurrent DROP
-	 * is more efficient.  Do this before any use of the concurrent option is
-	 * done.
+	 * is more efficient.  The same goes for global temporary tables, as we
+	 * only build the index over our own session's contents.  Do this before
+	 * any use of the concurrent option is done.
 	 */
-	if (stmt->concurrent && get_rel_persistence(tableId) != RELPERSISTENCE_TEMP)
+	if (stmt->concurrent &&
+		get_rel_persistence(tableId) != RELPERSISTENCE_TEMP &&
+		get_rel_persistence(tableId) != RELPERSISTENCE_GLOBAL_TEMP)
 		concurrent = true;
 	else
 		concurrent = false;
@@ -1612,6 +1616,16 @@ DefineIndex(Oid tableId,
 		return address;
 	}
 
+	/*
+	 * Have the tuples inserted while the index isn't ready for inserts
+	 * captured, so that validate_index() needn't scan the whole table to
+	 * find them.  This must be set up before the index becomes visible.
+	 * Summarizing indexes also need to see the heap-only tuples added to
+	 * existing HOT chains, so they always get the table scan.
+	 */
+	if (!amissummarizing)
+		(void) IndexCaptureBegin(indexRelationId);
+
 	/* save lockrelid and locktag for below, then close rel */
 	heaprelid = rel->rd_lockInfo.lockRelId;
 	SET_LOCKTAG_RELATION(heaplocktag, heaprelid.dbId, heaprelid.relId);
@@ -1749,9 +1763,11 @@ DefineIndex(Oid tableId,
 	PushActiveSnapshot(snapshot);
 
 	/*
-	 * Scan the index and the heap, insert any missing index entries.
+	 * Scan the index and the heap, insert any missing index entries.  The
+	 * captured tuples aren't needed anymore afterwards.
 	 */
 	validate_index(tableId, indexRelationId, snapshot);
+	IndexCaptureEnd(indexRelationId);
 
 	/*
 	 * Drop the reference snapshot.  We must do this before waiting out other
@@ -2953,7 +2969,8 @@ ReindexIndex(const ReindexStmt *stmt, const ReindexParams *params, bool isTopLev
 	if (relkind == RELKIND_PARTITIONED_INDEX)
 		ReindexPartitions(stmt, indOid, params, isTopLevel);
 	else if ((params->options & REINDEXOPT_CONCURRENTLY) != 0 &&
-			 persistence != RELPERSISTENCE_TEMP)
+			 persistence != RELPERSISTENCE_TEMP &&
+			 persistence != RELPERSISTENCE_GLOBAL_TEMP)
 		ReindexRelationConcurrently(stmt, indOid, params);
 	else
 	{
@@ -3069,7 +3086,8 @@ ReindexTable(const ReindexStmt *stmt, const ReindexParams *params, bool isTopLev
 	if (get_rel_relkind(heapOid) == RELKIND_PARTITIONED_TABLE)
 		ReindexPartitions(stmt, heapOid, params, isTopLevel);
 	else if ((params->options & REINDEXOPT_CONCURRENTLY) != 0 &&
-			 get_rel_persistence(heapOid) != RELPERSISTENCE_TEMP)
+			 get_rel_persistence(heapOid) != RELPERSISTENCE_TEMP &&
+			 get_rel_persistence(heapOid) != RELPERSISTENCE_GLOBAL_TEMP)
 	{
 		result = ReindexRelationConcurrently(stmt, heapOid, params);
 
@@ -3493,7 +3511,8 @@ ReindexMultipleInternal(const ReindexStmt *stmt, const List *relids, const Reind
 		Assert(!RELKIND_HAS_PARTITIONS(relkind));
 
 		if ((params->options & REINDEXOPT_CONCURRENTLY) != 0 &&
-			relpersistence != RELPERSISTENCE_TEMP)
+			relpersistence != RELPERSISTENCE_TEMP &&
+			relpersistence != RELPERSISTENCE_GLOBAL_TEMP)
 		{
 			ReindexParams newparams = *params;
 
@@ -3935,7 +3954,7 @@ ReindexRelationConcurrently(const ReindexStmt *stmt, Oid relationOid, const Rein
 		idx->amId = indexRel->rd_rel->relam;
 
 		/* This function shouldn't be called for temporary relations. */
-		if (indexRel->rd_rel->relpersistence == RELPERSISTENCE_TEMP)
+		if (RelationUsesLocalBuffers(indexRel))
 			elog(ERROR, "cannot reindex a temporary table concurrently");
 
 		pgstat_progress_start_command(PROGRESS_COMMAND_CREATE_INDEX, idx->tableId);
@@ -20,26 +20,38 @@
 #include "access/multixact.h"
 #include "access/tableam.h"
 #include "access/xact.h"
+#include "catalog/dependency.h"
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_am.h"
+#include "catalog/pg_inherits.h"
 #include "catalog/pg_opclass.h"
+#include "catalog/pg_trigger.h"
 #include "commands/cluster.h"
 #include "commands/matview.h"
 #include "commands/tablecmds.h"
 #include "commands/tablespace.h"
+#include "commands/trigger.h"
 #include "executor/executor.h"
 #include "executor/spi.h"
 #include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
+#include "parser/parse_func.h"
+#include "parser/parsetree.h"
 #include "pgstat.h"
 #include "rewrite/rewriteHandler.h"
 #include "storage/lmgr.h"
 #include "tcop/tcopprot.h"
+#include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
+#include "utils/ruleutils.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
+#include "utils/tuplestore.h"
 
 
 typedef struct
@@ -966,3 +978,462 @@ CloseMatViewIncrementalMaintenance(void)
 	matview_maintenance_depth--;
 	Assert(matview_maintenance_depth >= 0);
 }
+
+/*
+ * Incremental maintenance
+ *
+ * A materialized view created with CREATE INCREMENTAL MATERIALIZED VIEW is
+ * kept up to date by statement-level AFTER triggers on the table it reads
+ * from.  The transition tables of each statement tell which groups of the
+ * view it may have changed; those groups are deleted from the view, and
+ * computed again from the table by running the view's query restricted to
+ * them.  Changing a few rows of a large table thus costs about as much as
+ * aggregating the rows of the groups they belong to, rather than the whole
+ * table.
+ *
+ * Only queries that aggregate a single plain table with GROUP BY on plain
+ * columns are supported, which is what recomputing groups requires.  The
+ * triggers take an ExclusiveLock on the view, so changes to the table are
+ * applied to it one transaction at a time, and compute the groups with the
+ * latest snapshot, so that a transaction using a transaction snapshot
+ * doesn't overwrite the groups with data older than what concurrent
+ * transactions already put there.
+ */
+
+/*
+ * CheckIncrementalMatViewQuery
+ *		Check that a materialized view's query can be maintained incrementally.
+ */
+void
+CheckIncrementalMatViewQuery(Query *query)
+{
+	RangeTblEntry *baserte = NULL;
+	ListCell   *lc;
+
+	if (query->commandType != CMD_SELECT ||
+		query->cteList != NIL ||
+		query->setOperations != NULL ||
+		query->hasSubLinks ||
+		query->hasWindowFuncs ||
+		query->hasTargetSRFs ||
+		query->hasForUpdate ||
+		query->distinctClause != NIL ||
+		query->groupingSets != NIL ||
+		query->limitCount != NULL ||
+		query->limitOffset != NULL ||
+		query->groupClause == NIL ||
+		list_length(query->jointree->fromlist) != 1 ||
+		!IsA(linitial(query->jointree->fromlist), RangeTblRef) ||
+		linitial_node(RangeTblRef, query->jointree->fromlist)->rtindex != 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("query is not supported for incremental materialized views"),
+				 errdetail("Only queries that aggregate a single table using GROUP BY are supported.")));
+
+	foreach(lc, query->rtable)
+	{
+		RangeTblEntry *rte = lfirst_node(RangeTblEntry, lc);
+
+		if (rte->rtekind == RTE_GROUP)
+			continue;
+		if (rte->rtekind != RTE_RELATION || baserte != NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("query is not supported for incremental materialized views"),
+					 errdetail("Only queries that aggregate a single table using GROUP BY are supported.")));
+		baserte = rte;
+	}
+	Assert(baserte == rt_fetch(1, query->rtable));
+
+	if (baserte->relkind != RELKIND_RELATION || baserte->tablesample != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("incremental materialized views can only read from plain tables")));
+
+	/* Triggers on the parent don't see changes made to the children */
+	if (has_subclass(baserte->relid))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("incremental materialized views cannot read from tables with inheritance children")));
+
+	/* Recomputing a group must give the same result as computing it first */
+	if (contain_mutable_functions((Node *) query))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("functions in the query of an incremental materialized view must be marked IMMUTABLE")));
+
+	foreach(lc, query->groupClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		TargetEntry *tle = get_sortgroupclause_tle(sgc, query->targetList);
+		Node	   *expr = flatten_group_exprs(NULL, query, (Node *) tle->expr);
+
+		if (tle->resjunk || !IsA(expr, Var) ||
+			((Var *) expr)->varno != 1 || ((Var *) expr)->varlevelsup != 0 ||
+			((Var *) expr)->varattno <= 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("GROUP BY items of an incremental materialized view must be columns of the table that appear in the select list")));
+	}
+}
+
+/*
+ * Create one of the triggers maintaining a materialized view.
+ */
+static void
+CreateIncrementalMatViewTrigger(Oid matviewOid, Oid baseOid, int16 event)
+{
+	CreateTrigStmt *trigger = makeNode(CreateTrigStmt);
+	ObjectAddress trigaddr;
+	ObjectAddress matviewaddr;
+
+	trigger->replace = false;
+	trigger->isconstraint = false;
+	switch (event)
+	{
+		case TRIGGER_TYPE_INSERT:
+			trigger->trigname = "MatView_Maintenance_ins";
+			break;
+		case TRIGGER_TYPE_UPDATE:
+			trigger->trigname = "MatView_Maintenance_upd";
+			break;
+		case TRIGGER_TYPE_DELETE:
+			trigger->trigname = "MatView_Maintenance_del";
+			break;
+		case TRIGGER_TYPE_TRUNCATE:
+			trigger->trigname = "MatView_Maintenance_trunc";
+			break;
+		default:
+			elog(ERROR, "unexpected trigger event: %d", event);
+	}
+	trigger->relation = NULL;
+	trigger->funcname = SystemFuncName("matview_incremental_maintenance");
+	trigger->args = list_make1(makeString(psprintf("%u", matviewOid)));
+	trigger->row = false;
+	trigger->timing = TRIGGER_TYPE_AFTER;
+	trigger->events = event;
+	trigger->columns = NIL;
+	trigger->whenClause = NULL;
+
+	/* Triggers with transition tables can only have one event */
+	trigger->transitionRels = NIL;
+	if (event == TRIGGER_TYPE_UPDATE || event == TRIGGER_TYPE_DELETE)
+	{
+		TriggerTransition *tt = makeNode(TriggerTransition);
+
+		tt->name = "__ivm_old";
+		tt->isNew = false;
+		tt->isTable = true;
+		trigger->transitionRels = lappend(trigger->transitionRels, tt);
+	}
+	if (event == TRIGGER_TYPE_INSERT || event == TRIGGER_TYPE_UPDATE)
+	{
+		TriggerTransition *tt = makeNode(TriggerTransition);
+
+		tt->name = "__ivm_new";
+		tt->isNew = true;
+		tt->isTable = true;
+		trigger->transitionRels = lappend(trigger->transitionRels, tt);
+	}
+
+	trigger->deferrable = false;
+	trigger->initdeferred = false;
+	trigger->constrrel = NULL;
+
+	trigaddr = CreateTrigger(trigger, NULL, baseOid, InvalidOid, InvalidOid,
+							 InvalidOid, InvalidOid, InvalidOid, NULL,
+							 true, false);
+
+	/* The trigger goes away with the view, and can't be dropped by itself */
+	ObjectAddressSet(matviewaddr, RelationRelationId, matviewOid);
+	recordDependencyOn(&trigaddr, &matviewaddr, DEPENDENCY_INTERNAL);
+}
+
+/*
+ * CreateIncrementalMatViewTriggers
+ *		Create the triggers that maintain a materialized view incrementally.
+ *
+ * The query must have passed CheckIncrementalMatViewQuery().
+ */
+void
+CreateIncrementalMatViewTriggers(Oid matviewOid, Query *query)
+{
+	Oid			baseOid = rt_fetch(1, query->rtable)->relid;
+	AclResult	aclresult;
+
+	/* Same check as CREATE TRIGGER would make */
+	aclresult = pg_class_aclcheck(baseOid, GetUserId(), ACL_TRIGGER);
+	if (aclresult != ACLCHECK_OK)
+		aclcheck_error(aclresult, get_relkind_objtype(get_rel_relkind(baseOid)),
+					   get_rel_name(baseOid));
+
+	CreateIncrementalMatViewTrigger(matviewOid, baseOid, TRIGGER_TYPE_INSERT);
+	CreateIncrementalMatViewTrigger(matviewOid, baseOid, TRIGGER_TYPE_UPDATE);
+	CreateIncrementalMatViewTrigger(matviewOid, baseOid, TRIGGER_TYPE_DELETE);
+	CreateIncrementalMatViewTrigger(matviewOid, baseOid, TRIGGER_TYPE_TRUNCATE);
+}
+
+/*
+ * Append a condition matching a grouping column to a key, where NULLs match
+ * each other as they do in GROUP BY.  Using the group's equality operator
+ * for columns that can't be null allows an index on them to be used.
+ */
+static void
+append_group_key_match(StringInfo buf, const char *leftop, const char *rightop,
+					   Oid type, Oid eqop, bool notnull)
+{
+	if (!notnull)
+		appendStringInfo(buf, "(%s IS NULL AND %s IS NULL OR ",
+						 leftop, rightop);
+	generate_operator_clause(buf, leftop, type, eqop, rightop, type);
+	if (!notnull)
+		appendStringInfoChar(buf, ')');
+}
+
+/*
+ * Run a statement maintaining a materialized view with the latest snapshot.
+ */
+static void
+execute_matview_maintenance(const char *sql, int expected)
+{
+	SPIPlanPtr	plan;
+
+	plan = SPI_prepare(sql, 0, NULL);
+	if (plan == NULL)
+		elog(ERROR, "SPI_prepare failed: %s", sql);
+	if (SPI_execute_snapshot(plan, NULL, NULL, GetLatestSnapshot(),
+							 InvalidSnapshot, false, true, 0) != expected)
+		elog(ERROR, "SPI_exec failed: %s", sql);
+	SPI_freeplan(plan);
+}
+
+/*
+ * Apply the changes a statement made to the table to the materialized view,
+ * by computing again all the groups that the old and new rows belong to.
+ */
+static void
+apply_matview_changes(Relation matviewRel, Query *query,
+					  TriggerData *trigdata)
+{
+	Relation	baseRel = trigdata->tg_relation;
+	Oid			baseOid = RelationGetRelid(baseRel);
+	TupleDesc	mvdesc = RelationGetDescr(matviewRel);
+	List	   *basecxt = deparse_context_for("__ivm_base", baseOid);
+	List	   *oldcxt = deparse_context_for("__ivm_old", baseOid);
+	List	   *newcxt = deparse_context_for("__ivm_new", baseOid);
+	StringInfoData oldkeys;
+	StringInfoData newkeys;
+	StringInfoData keynames;
+	StringInfoData mvmatch;
+	StringInfoData basematch;
+	StringInfoData groupby;
+	StringInfoData keys;
+	StringInfoData querybuf;
+	char	   *matviewname;
+	char	   *basename;
+	int			nkeys = 0;
+	ListCell   *lc;
+
+	Assert(rt_fetch(1, query->rtable)->relid == baseOid);
+
+	matviewname = quote_qualified_identifier(get_namespace_name(RelationGetNamespace(matviewRel)),
+											 RelationGetRelationName(matviewRel));
+	basename = quote_qualified_identifier(get_namespace_name(RelationGetNamespace(baseRel)),
+										  RelationGetRelationName(baseRel));
+
+	initStringInfo(&oldkeys);
+	initStringInfo(&newkeys);
+	initStringInfo(&keynames);
+	initStringInfo(&mvmatch);
+	initStringInfo(&basematch);
+	initStringInfo(&groupby);
+
+	foreach(lc, query->groupClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		TargetEntry *tle = get_sortgroupclause_tle(sgc, query->targetList);
+		Node	   *expr = flatten_group_exprs(NULL, query, (Node *) tle->expr);
+		Oid			type = exprType(expr);
+		bool		notnull;
+		char	   *mvcol;
+		char	   *basecol;
+		char	   *keycol;
+
+		Assert(IsA(expr, Var));
+		notnull = TupleDescAttr(RelationGetDescr(baseRel),
+								((Var *) expr)->varattno - 1)->attnotnull;
+		mvcol = psprintf("__ivm_mv.%s",
+						 quote_identifier(NameStr(TupleDescAttr(mvdesc, tle->resno - 1)->attname)));
+		basecol = deparse_expression(expr, basecxt, true, false);
+		keycol = psprintf("__ivm_keys.k%d", ++nkeys);
+
+		if (nkeys > 1)
+		{
+			appendStringInfoString(&oldkeys, ", ");
+			appendStringInfoString(&newkeys, ", ");
+			appendStringInfoString(&keynames, ", ");
+			appendStringInfoString(&mvmatch, " AND ");
+			appendStringInfoString(&basematch, " AND ");
+			appendStringInfoString(&groupby, ", ");
+		}
+		appendStringInfoString(&oldkeys, deparse_expression(expr, oldcxt, true, false));
+		appendStringInfoString(&newkeys, deparse_expression(expr, newcxt, true, false));
+		appendStringInfo(&keynames, "k%d", nkeys);
+		append_group_key_match(&mvmatch, mvcol, keycol, type, sgc->eqop, notnull);
+		append_group_key_match(&basematch, basecol, keycol, type, sgc->eqop, notnull);
+		appendStringInfoString(&groupby, basecol);
+	}
+
+	/* The keys of the groups that the statement may have changed */
+	initStringInfo(&keys);
+	appendStringInfoChar(&keys, '(');
+	if (trigdata->tg_oldtable != NULL)
+		appendStringInfo(&keys, "SELECT %s FROM __ivm_old", oldkeys.data);
+	if (trigdata->tg_oldtable != NULL && trigdata->tg_newtable != NULL)
+		appendStringInfoString(&keys, " UNION ALL ");
+	if (trigdata->tg_newtable != NULL)
+		appendStringInfo(&keys, "SELECT %s FROM __ivm_new", newkeys.data);
+	appendStringInfo(&keys, ") __ivm_keys(%s)", keynames.data);
+
+	/* Remove those groups from the view ... */
+	initStringInfo(&querybuf);
+	appendStringInfo(&querybuf,
+					 "DELETE FROM %s __ivm_mv WHERE EXISTS "
+					 "(SELECT 1 FROM %s WHERE %s)",
+					 matviewname, keys.data, mvmatch.data);
+	execute_matview_maintenance(querybuf.data, SPI_OK_DELETE);
+
+	/* ... and put back what's left of them */
+	resetStringInfo(&querybuf);
+	appendStringInfo(&querybuf, "INSERT INTO %s SELECT ", matviewname);
+	foreach(lc, query->targetList)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+		Node	   *expr;
+
+		if (tle->resjunk)
+			continue;
+		expr = flatten_group_exprs(NULL, query, (Node *) tle->expr);
+		if (tle->resno > 1)
+			appendStringInfoString(&querybuf, ", ");
+		appendStringInfoString(&querybuf,
+							   deparse_expression(expr, basecxt, true, false));
+	}
+	appendStringInfo(&querybuf, " FROM %s __ivm_base WHERE ", basename);
+	if (query->jointree->quals != NULL)
+		appendStringInfo(&querybuf, "(%s) AND ",
+						 deparse_expression(query->jointree->quals, basecxt,
+											true, false));
+	appendStringInfo(&querybuf,
+					 "EXISTS (SELECT 1 FROM %s WHERE %s) GROUP BY %s",
+					 keys.data, basematch.data, groupby.data);
+	if (query->havingQual != NULL)
+		appendStringInfo(&querybuf, " HAVING %s",
+						 deparse_expression(flatten_group_exprs(NULL, query,
+																query->havingQual),
+											basecxt, true, false));
+	execute_matview_maintenance(querybuf.data, SPI_OK_INSERT);
+}
+
+/*
+ * matview_incremental_maintenance
+ *		Trigger function maintaining an incremental materialized view.
+ *
+ * Fired after each statement changing the table the view reads from, with
+ * the OID of the view as argument.
+ */
+Datum
+matview_incremental_maintenance(PG_FUNCTION_ARGS)
+{
+	TriggerData *trigdata = (TriggerData *) fcinfo->context;
+	Oid			matviewOid;
+	Relation	matviewRel;
+	Query	   *query;
+	Oid			save_userid;
+	int			save_sec_context;
+	int			save_nestlevel;
+	int			old_depth = matview_maintenance_depth;
+
+	if (!CALLED_AS_TRIGGER(fcinfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+				 errmsg("function \"%s\" was not called by trigger manager",
+						"matview_incremental_maintenance")));
+	if (!TRIGGER_FIRED_AFTER(trigdata->tg_event) ||
+		!TRIGGER_FIRED_FOR_STATEMENT(trigdata->tg_event) ||
+		trigdata->tg_trigger->tgnargs != 1)
+		elog(ERROR, "function \"%s\" was called with an unexpected trigger",
+			 "matview_incremental_maintenance");
+
+	/* Nothing to do if the statement didn't change any rows */
+	if (!TRIGGER_FIRED_BY_TRUNCATE(trigdata->tg_event) &&
+		(trigdata->tg_oldtable == NULL ||
+		 tuplestore_tuple_count(trigdata->tg_oldtable) == 0) &&
+		(trigdata->tg_newtable == NULL ||
+		 tuplestore_tuple_count(trigdata->tg_newtable) == 0))
+		return PointerGetDatum(NULL);
+
+	/* Apply the changes of one transaction at a time, see above */
+	matviewOid = atooid(trigdata->tg_trigger->tgargs[0]);
+	matviewRel = table_open(matviewOid, ExclusiveLock);
+
+	/* A view that hasn't been populated stays so until it's refreshed */
+	if (!RelationIsPopulated(matviewRel))
+	{
+		table_close(matviewRel, NoLock);
+		return PointerGetDatum(NULL);
+	}
+
+	query = copyObject(linitial_node(Query,
+									 matviewRel->rd_rules->rules[0]->actions));
+
+	/*
+	 * Run the queries as the view's owner, like REFRESH does.  The search
+	 * path is restricted before they are built, so that the names in them
+	 * are qualified as needed.
+	 */
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+	SetUserIdAndSecContext(matviewRel->rd_rel->relowner,
+						   save_sec_context | SECURITY_LOCAL_USERID_CHANGE |
+						   SECURITY_RESTRICTED_OPERATION);
+	save_nestlevel = NewGUCNestLevel();
+	RestrictSearchPath();
+
+	SPI_connect();
+	if (SPI_register_trigger_data(trigdata) != SPI_OK_TD_REGISTER)
+		elog(ERROR, "SPI_register_trigger_data failed");
+
+	PG_TRY();
+	{
+		OpenMatViewIncrementalMaintenance();
+
+		if (TRIGGER_FIRED_BY_TRUNCATE(trigdata->tg_event))
+		{
+			char	   *sql;
+
+			sql = psprintf("DELETE FROM %s",
+						   quote_qualified_identifier(get_namespace_name(RelationGetNamespace(matviewRel)),
+													  RelationGetRelationName(matviewRel)));
+			execute_matview_maintenance(sql, SPI_OK_DELETE);
+		}
+		else
+			apply_matview_changes(matviewRel, query, trigdata);
+
+		CloseMatViewIncrementalMaintenance();
+	}
+	PG_CATCH();
+	{
+		matview_maintenance_depth = old_depth;
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	SPI_finish();
+
+	AtEOXact_GUC(false, save_nestlevel);
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+
+	table_close(matviewRel, NoLock);
+
+	return PointerGetDatum(NULL);
+}
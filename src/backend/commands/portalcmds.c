@@ -74,6 +74,10 @@ PerformCursorOpen(ParseState *pstate, DeclareCursorStmt *cstmt, ParamListInfo pa
 				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
 				 errmsg("cannot create a cursor WITH HOLD within security-restricted operation")));
 
+	/* A holdable cursor outlives the transaction */
+	if (cstmt->options & CURSOR_OPT_HOLD)
+		MySessionPinned = true;
+
 	/* Query contained by DeclareCursor needs to be jumbled if requested */
 	if (IsQueryIdEnabled())
 		jstate = JumbleQuery(query);
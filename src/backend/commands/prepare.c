@@ -26,6 +26,7 @@
 #include "commands/explain_state.h"
 #include "commands/prepare.h"
 #include "funcapi.h"
+#include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
 #include "parser/parse_coerce.h"
 #include "parser/parse_collate.h"
@@ -74,6 +75,9 @@ PrepareQuery(ParseState *pstate, PrepareStmt *stmt,
 				(errcode(ERRCODE_INVALID_PSTATEMENT_DEFINITION),
 				 errmsg("invalid statement name: must not be empty")));
 
+	/* SQL-level prepared statements live in this backend only */
+	MySessionPinned = true;
+
 	/*
 	 * Need to wrap the contained statement in a RawStmt node to pass it to
 	 * parse analysis.
@@ -504,6 +508,9 @@ FetchPreparedStatementTargetList(PreparedStatement *stmt)
 void
 DeallocateQuery(DeallocateStmt *stmt)
 {
+	/* DEALLOCATE ALL would also drop statements a connection proxy made */
+	MySessionPinned = true;
+
 	if (stmt->name)
 		DropPreparedStatement(stmt->name, true);
 	else
@@ -29,6 +29,7 @@
 #include "catalog/pg_sequence.h"
 #include "catalog/pg_type.h"
 #include "catalog/storage_xlog.h"
+#include "common/hashfn.h"
 #include "commands/defrem.h"
 #include "commands/sequence.h"
 #include "commands/sequence_xlog.h"
@@ -40,7 +41,9 @@
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
 #include "storage/proc.h"
+#include "storage/shmem.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
@@ -57,6 +60,39 @@
  */
 #define SEQ_LOG_VALS	32
 
+/*
+ * Values of sequences with CACHE 1 can be reserved in chunks of
+ * sequence_shared_cache values, kept in shared memory and handed out to all
+ * sessions in order.  That way, the sequence's page only needs to be locked
+ * and updated once per chunk, rather than by every nextval() call.  As with
+ * CACHE, the reserved values that haven't been handed out are lost if the
+ * server restarts, and the sequence's last_value shows the end of the chunk.
+ *
+ * The chunks are kept in a small direct-mapped table; a sequence that maps to
+ * a slot used by another sequence simply takes it over, losing the values
+ * left in it.  A slot is only filled and emptied while holding the exclusive
+ * lock on the sequence's buffer, so refills are serialized against each other
+ * and against setval().  Handing out the next value only takes the slot's
+ * spinlock.
+ */
+#define SEQ_SHARED_CACHE_SLOTS	64
+
+typedef struct SeqSharedCacheSlot
+{
+	slock_t		mutex;
+	Oid			dbid;			/* identity of the sequence, InvalidOid if */
+	Oid			relid;			/* the slot is empty */
+	RelFileNumber relnumber;
+	int64		last;			/* value last handed out */
+	int64		cached;			/* last value reserved in the chunk */
+	int64		increment;
+} SeqSharedCacheSlot;
+
+static SeqSharedCacheSlot *SeqSharedCache = NULL;
+
+/* GUC parameter */
+int			sequence_shared_cache = 0;
+
 /*
  * We store a SeqTable item for every sequence we have touched in the current
  * session.  This is needed to hold onto nextval/currval state.  (We can't
@@ -102,6 +138,11 @@ static void init_params(ParseState *pstate, List *options, bool for_identity,
 						bool *need_seq_rewrite,
 						List **owned_by);
 static void process_owned_by(Relation seqrel, List *owned_by, bool for_identity);
+static bool seq_shared_cache_next(Relation seqrel, int64 *result,
+								  int64 *increment);
+static void seq_shared_cache_fill(Relation seqrel, int64 first, int64 last,
+								  int64 increment);
+static void seq_shared_cache_forget(Oid relid);
 
 
 /*
@@ -129,6 +170,11 @@ DefineSequence(ParseState *pstate, CreateSeqStmt *seq)
 	bool		pgs_nulls[Natts_pg_sequence];
 	int			i;
 
+	if (seq->sequence->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("global temporary sequences are not supported")));
+
 	/*
 	 * If if_not_exists was given and a relation with the same name already
 	 * exists, bail out. (Note: we needn't check this when not if_not_exists,
@@ -317,6 +363,7 @@ ResetSequence(Oid seq_relid)
 	/* Clear local cache so that we don't think we have cached numbers */
 	/* Note that we do not change the currval() state */
 	elm->cached = elm->last;
+	seq_shared_cache_forget(seq_relid);
 
 	sequence_close(seq_rel, NoLock);
 }
@@ -520,6 +567,7 @@ AlterSequence(ParseState *pstate, AlterSeqStmt *stmt)
 	/* Clear local cache so that we don't think we have cached numbers */
 	/* Note that we do not change the currval() state */
 	elm->cached = elm->last;
+	seq_shared_cache_forget(relid);
 
 	/* process OWNED BY if given */
 	if (owned_by)
@@ -562,6 +610,7 @@ SequenceChangePersistence(Oid relid, char newrelpersistence)
 	(void) read_seq_tuple(seqrel, &buf, &seqdatatuple);
 	RelationSetNewRelfilenumber(seqrel, newrelpersistence);
 	fill_seq_with_data(seqrel, &seqdatatuple);
+	seq_shared_cache_forget(relid);
 	UnlockReleaseBuffer(buf);
 
 	sequence_close(seqrel, NoLock);
@@ -583,6 +632,8 @@ DeleteSequenceTuple(Oid relid)
 
 	ReleaseSysCache(tuple);
 	table_close(rel, RowExclusiveLock);
+
+	seq_shared_cache_forget(relid);
 }
 
 /*
@@ -643,6 +694,7 @@ nextval_internal(Oid relid, bool check_permissions)
 				rescnt = 0;
 	bool		cycle;
 	bool		logit = false;
+	bool		use_shared_cache;
 
 	/* open and lock sequence */
 	init_sequence(relid, &elm, &seqrel);
@@ -676,6 +728,17 @@ nextval_internal(Oid relid, bool check_permissions)
 		return elm->last;
 	}
 
+	/* try to take the next value of a chunk reserved in shared memory */
+	if (seq_shared_cache_next(seqrel, &result, &incby))
+	{
+		elm->increment = incby;
+		elm->last = elm->cached = result;
+		elm->last_valid = true;
+		sequence_close(seqrel, NoLock);
+		last_used_seq = elm;
+		return result;
+	}
+
 	pgstuple = SearchSysCache1(SEQRELID, ObjectIdGetDatum(relid));
 	if (!HeapTupleIsValid(pgstuple))
 		elog(ERROR, "cache lookup failed for sequence %u", relid);
@@ -687,10 +750,32 @@ nextval_internal(Oid relid, bool check_permissions)
 	cycle = pgsform->seqcycle;
 	ReleaseSysCache(pgstuple);
 
+	/* temporary sequences are used by a single session anyway */
+	use_shared_cache = (cache == 1 && sequence_shared_cache > 1 &&
+						seqrel->rd_rel->relpersistence != RELPERSISTENCE_TEMP);
+
 	/* lock page buffer and read tuple */
 	seq = read_seq_tuple(seqrel, &buf, &seqdatatuple);
 	page = BufferGetPage(buf);
 
+	if (use_shared_cache)
+	{
+		/* someone else may have refilled the chunk while we waited */
+		if (seq_shared_cache_next(seqrel, &result, &incby))
+		{
+			UnlockReleaseBuffer(buf);
+			elm->increment = incby;
+			elm->last = elm->cached = result;
+			elm->last_valid = true;
+			sequence_close(seqrel, NoLock);
+			last_used_seq = elm;
+			return result;
+		}
+
+		/* reserve a new chunk, as if the sequence had a larger CACHE */
+		cache = sequence_shared_cache;
+	}
+
 	last = next = result = seq->last_value;
 	fetch = cache;
 	log = seq->log_cnt;
@@ -787,10 +872,10 @@ nextval_internal(Oid relid, bool check_permissions)
 	log -= fetch;				/* adjust for any unfetched numbers */
 	Assert(log >= 0);
 
-	/* save info in local cache */
+	/* save info in local cache, unless the values are shared */
 	elm->increment = incby;
 	elm->last = result;			/* last returned number */
-	elm->cached = last;			/* last fetched number */
+	elm->cached = use_shared_cache ? result : last; /* last fetched number */
 	elm->last_valid = true;
 
 	last_used_seq = elm;
@@ -856,6 +941,10 @@ nextval_internal(Oid relid, bool check_permissions)
 
 	END_CRIT_SECTION();
 
+	/* publish the rest of the chunk, now that the page covers it */
+	if (use_shared_cache)
+		seq_shared_cache_fill(seqrel, result, last, incby);
+
 	UnlockReleaseBuffer(buf);
 
 	sequence_close(seqrel, NoLock);
@@ -1002,6 +1091,7 @@ SetSequence(Oid relid, int64 next, bool iscalled)
 
 	/* In any case, forget any future cached numbers */
 	elm->cached = elm->last;
+	seq_shared_cache_forget(relid);
 
 	/* check the comment above nextval_internal()'s equivalent call. */
 	if (RelationNeedsWAL(seqrel))
@@ -1910,3 +2000,112 @@ ResetSequenceCaches(void)
 
 	last_used_seq = NULL;
 }
+
+/*
+ * Shared memory for the chunks of values of sequences with CACHE 1
+ */
+Size
+SequenceShmemSize(void)
+{
+	return mul_size(SEQ_SHARED_CACHE_SLOTS, sizeof(SeqSharedCacheSlot));
+}
+
+void
+SequenceShmemInit(void)
+{
+	bool		found;
+
+	SeqSharedCache = (SeqSharedCacheSlot *)
+		ShmemInitStruct("Sequence Shared Cache", SequenceShmemSize(), &found);
+	if (!found)
+	{
+		for (int i = 0; i < SEQ_SHARED_CACHE_SLOTS; i++)
+		{
+			SeqSharedCacheSlot *slot = &SeqSharedCache[i];
+
+			SpinLockInit(&slot->mutex);
+			slot->dbid = InvalidOid;
+			slot->relid = InvalidOid;
+			slot->relnumber = InvalidRelFileNumber;
+			slot->last = slot->cached = slot->increment = 0;
+		}
+	}
+}
+
+static inline SeqSharedCacheSlot *
+seq_shared_cache_slot(Oid relid)
+{
+	return &SeqSharedCache[hash_combine(murmurhash32(MyDatabaseId),
+										murmurhash32(relid)) %
+						   SEQ_SHARED_CACHE_SLOTS];
+}
+
+/*
+ * Take the next value of the sequence from its chunk in shared memory.
+ *
+ * Returns false if the sequence has no chunk, or it has been used up.  The
+ * relfilenumber is part of the slot's key so that the chunk of an
+ * uncommitted rewrite of the sequence isn't used after that rolled back.
+ */
+static bool
+seq_shared_cache_next(Relation seqrel, int64 *result, int64 *increment)
+{
+	SeqSharedCacheSlot *slot;
+	bool		found = false;
+
+	if (sequence_shared_cache <= 1)
+		return false;
+
+	slot = seq_shared_cache_slot(RelationGetRelid(seqrel));
+
+	SpinLockAcquire(&slot->mutex);
+	if (slot->relid == RelationGetRelid(seqrel) &&
+		slot->dbid == MyDatabaseId &&
+		slot->relnumber == seqrel->rd_locator.relNumber &&
+		slot->last != slot->cached)
+	{
+		slot->last += slot->increment;
+		*result = slot->last;
+		*increment = slot->increment;
+		found = true;
+	}
+	SpinLockRelease(&slot->mutex);
+
+	return found;
+}
+
+/*
+ * Publish a newly reserved chunk, whose first value 'first' has already been
+ * returned by the caller.  The caller must hold the exclusive lock on the
+ * sequence's buffer, and the sequence page must already cover 'last'.
+ */
+static void
+seq_shared_cache_fill(Relation seqrel, int64 first, int64 last,
+					  int64 increment)
+{
+	SeqSharedCacheSlot *slot = seq_shared_cache_slot(RelationGetRelid(seqrel));
+
+	SpinLockAcquire(&slot->mutex);
+	slot->dbid = MyDatabaseId;
+	slot->relid = RelationGetRelid(seqrel);
+	slot->relnumber = seqrel->rd_locator.relNumber;
+	slot->last = first;
+	slot->cached = last;
+	slot->increment = increment;
+	SpinLockRelease(&slot->mutex);
+}
+
+/*
+ * Throw away the chunk of a sequence, if it has one, because the sequence's
+ * state or definition is changing.
+ */
+static void
+seq_shared_cache_forget(Oid relid)
+{
+	SeqSharedCacheSlot *slot = seq_shared_cache_slot(relid);
+
+	SpinLockAcquire(&slot->mutex);
+	if (slot->relid == relid && slot->dbid == MyDatabaseId)
+		slot->relid = InvalidOid;
+	SpinLockRelease(&slot->mutex);
+}
@@ -20,6 +20,7 @@
 #include "access/heapam.h"
 #include "access/heapam_xlog.h"
 #include "access/multixact.h"
+#include "access/parallel.h"
 #include "access/reloptions.h"
 #include "access/relscan.h"
 #include "access/sysattr.h"
@@ -69,12 +70,14 @@
 #include "commands/vacuum.h"
 #include "common/int.h"
 #include "executor/executor.h"
+#include "executor/instrument.h"
 #include "foreign/fdwapi.h"
 #include "foreign/foreign.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "nodes/parsenodes.h"
+#include "optimizer/clauses.h"
 #include "optimizer/optimizer.h"
 #include "parser/parse_coerce.h"
 #include "parser/parse_collate.h"
@@ -94,6 +97,7 @@
 #include "storage/lock.h"
 #include "storage/predicate.h"
 #include "storage/smgr.h"
+#include "tcop/tcopprot.h"
 #include "tcop/utility.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
@@ -240,6 +244,45 @@ typedef struct NewColumnValue
 	bool		is_generated;	/* is it a GENERATED expression? */
 } NewColumnValue;
 
+/*
+ * DSM keys for a table rewrite or verification scan done in parallel.  As
+ * for parallel vacuum, there are no plan node IDs to conflict with, so small
+ * integers will do.
+ */
+#define PARALLEL_REWRITE_KEY_SHARED			1
+#define PARALLEL_REWRITE_KEY_QUERY_TEXT		2
+#define PARALLEL_REWRITE_KEY_BUFFER_USAGE	3
+#define PARALLEL_REWRITE_KEY_WAL_USAGE		4
+#define PARALLEL_REWRITE_KEY_OLD_TUPDESC	5
+#define PARALLEL_REWRITE_KEY_EXPRS			6
+
+/*
+ * Shared information among the leader and workers of a parallel table
+ * rewrite or verification scan, stored in the DSM segment.  The workers get
+ * the rest of what they need to reconstruct the AlteredTableInfo from the
+ * other keys: the pre-modification tuple descriptor, and the new column
+ * values, CHECK constraints and partition constraint as a node tree.
+ */
+typedef struct ParallelRewriteShared
+{
+	Oid			relid;			/* table being rewritten */
+	Oid			newrelid;		/* new heap, or InvalidOid if only verifying */
+	bool		newrel_skip_wal;	/* leader doesn't WAL-log the new heap */
+	int			rewrite;		/* AlteredTableInfo fields */
+	bool		verify_new_notnull;
+	bool		validate_default;
+	int64		queryid;		/* query ID, for pg_stat_activity */
+
+	/*
+	 * ParallelTableScanDescData data follows. Can't directly embed here, as
+	 * implementations of the parallel table scan desc interface might need
+	 * stronger alignment.
+	 */
+} ParallelRewriteShared;
+
+#define ParallelTableScanFromRewriteShared(shared) \
+	(ParallelTableScanDesc) ((char *) (shared) + BUFFERALIGN(sizeof(ParallelRewriteShared)))
+
 /*
  * Error-reporting support for RemoveRelations
  */
@@ -475,7 +518,16 @@ static AlterTableCmd *ATParseTransformCmd(List **wqueue, AlteredTableInfo *tab,
 static void ATRewriteTables(AlterTableStmt *parsetree,
 							List **wqueue, LOCKMODE lockmode,
 							AlterTableUtilityContext *context);
-static void ATRewriteTable(AlteredTableInfo *tab, Oid OIDNewHeap);
+static void ATRewriteTable(AlteredTableInfo *tab, Oid OIDNewHeap,
+						   ParallelTableScanDesc pscan);
+static bool ATRewriteTableParallelSafe(AlteredTableInfo *tab, Relation oldrel,
+									   Relation newrel);
+static ParallelContext *ATRewriteTableBeginParallel(AlteredTableInfo *tab,
+													Relation oldrel,
+													Relation newrel,
+													Snapshot snapshot,
+													ParallelTableScanDesc *pscan);
+static void ATRewriteTableEndParallel(ParallelContext *pcxt);
 static AlteredTableInfo *ATGetQueueEntry(List **wqueue, Relation rel);
 static void ATSimplePermissions(AlterTableType cmdtype, Relation rel, int allowed_targets);
 static void ATSimpleRecursion(List **wqueue, Relation rel,
@@ -800,8 +852,25 @@ DefineRelation(CreateStmt *stmt, char relkind, Oid ownerId,
 	/*
 	 * Check consistency of arguments
 	 */
-	if (stmt->oncommit != ONCOMMIT_NOOP
-		&& stmt->relation->relpersistence != RELPERSISTENCE_TEMP)
+	if (stmt->relation->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+	{
+		/* the contents are kept until the session ends */
+		if (stmt->oncommit != ONCOMMIT_NOOP &&
+			stmt->oncommit != ONCOMMIT_PRESERVE_ROWS)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("only ON COMMIT PRESERVE ROWS is supported for global temporary tables")));
+		if (stmt->partspec != NULL || stmt->partbound != NULL)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("global temporary tables cannot be partitioned or be partitions")));
+		if (stmt->inhRelations != NIL)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("global temporary tables cannot inherit from other tables")));
+	}
+	else if (stmt->oncommit != ONCOMMIT_NOOP
+			 && stmt->relation->relpersistence != RELPERSISTENCE_TEMP)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
 				 errmsg("ON COMMIT can only be used on temporary tables")));
@@ -1319,7 +1388,7 @@ DefineRelation(CreateStmt *stmt, char relkind, Oid ownerId,
 		 * If there are any row-level triggers, clone them to the new
 		 * partition.
 		 */
-		if (parent->trigdesc != NULL)
+		if (RelationGetTriggerDesc(parent) != NULL)
 			CloneRowTriggersToPartition(parent, rel);
 
 		/*
@@ -2192,9 +2261,14 @@ ExecuteTruncateGuts(List *explicit_rels,
 		 * a new relfilenumber in the current (sub)transaction, then we can
 		 * just truncate it in-place, because a rollback would cause the whole
 		 * table or the current physical file to be thrown away anyway.
+		 *
+		 * A global temporary table always takes the transaction-safe path,
+		 * which gives new storage to just the parts of it that this session
+		 * has storage for (see catalog/globaltemp.c).
 		 */
-		if (rel->rd_createSubid == mySubid ||
-			rel->rd_newRelfilelocatorSubid == mySubid)
+		if ((rel->rd_createSubid == mySubid ||
+			 rel->rd_newRelfilelocatorSubid == mySubid) &&
+			!RelationIsGlobalTemp(rel))
 		{
 			/* Immediate, non-rollbackable truncation is OK */
 			heap_truncate_one_rel(rel);
@@ -2696,6 +2770,12 @@ MergeAttributes(List *columns, const List *supers, char relpersistence,
 					 errmsg("inherited relation \"%s\" is not a table or foreign table",
 							RelationGetRelationName(relation))));
 
+		if (RelationIsGlobalTemp(relation))
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("cannot inherit from global temporary relation \"%s\"",
+							RelationGetRelationName(relation))));
+
 		/*
 		 * If the parent is permanent, so must be all of its partitions.  Note
 		 * that inheritance allows that case.
@@ -6011,7 +6091,7 @@ ATRewriteTables(AlterTableStmt *parsetree, List **wqueue, LOCKMODE lockmode,
 			 * modifications, and test the current data within the table
 			 * against new constraints generated by ALTER TABLE commands.
 			 */
-			ATRewriteTable(tab, OIDNewHeap);
+			ATRewriteTable(tab, OIDNewHeap, NULL);
 
 			/*
 			 * Swap the physical files of the old and new heaps, then rebuild
@@ -6044,7 +6124,7 @@ ATRewriteTables(AlterTableStmt *parsetree, List **wqueue, LOCKMODE lockmode,
 			 */
 			if (tab->constraints != NIL || tab->verify_new_notnull ||
 				tab->partition_constraint != NULL)
-				ATRewriteTable(tab, InvalidOid);
+				ATRewriteTable(tab, InvalidOid, NULL);
 
 			/*
 			 * If we had SET TABLESPACE but no reason to reconstruct tuples,
@@ -6145,9 +6225,14 @@ ATRewriteTables(AlterTableStmt *parsetree, List **wqueue, LOCKMODE lockmode,
  *
  * A rewrite is requested by passing a valid OIDNewHeap; in that case, caller
  * must already hold AccessExclusiveLock on it.
+ *
+ * A rewrite may be done with the help of parallel workers, each of which
+ * runs this function too, with pscan set to the parallel scan of the old
+ * table it is to join.  Other callers pass NULL.
  */
 static void
-ATRewriteTable(AlteredTableInfo *tab, Oid OIDNewHeap)
+ATRewriteTable(AlteredTableInfo *tab, Oid OIDNewHeap,
+			   ParallelTableScanDesc pscan)
 {
 	Relation	oldrel;
 	Relation	newrel;
@@ -6282,8 +6367,9 @@ ATRewriteTable(AlteredTableInfo *tab, Oid OIDNewHeap)
 		MemoryContext oldCxt;
 		List	   *dropped_attrs = NIL;
 		ListCell   *lc;
-		Snapshot	snapshot;
+		Snapshot	snapshot = NULL;
 		ResultRelInfo *rInfo = NULL;
+		ParallelContext *pcxt = NULL;
 
 		/*
 		 * When adding or changing a virtual generated column with a not-null
@@ -6307,7 +6393,11 @@ ATRewriteTable(AlteredTableInfo *tab, Oid OIDNewHeap)
 			MemoryContextSwitchTo(oldcontext);
 		}
 
-		if (newrel)
+		if (pscan != NULL)
+		{
+			/* we're a parallel worker; the leader has done the following */
+		}
+		else if (newrel)
 			ereport(DEBUG1,
 					(errmsg_internal("rewriting table \"%s\"",
 									 RelationGetRelationName(oldrel))));
@@ -6316,7 +6406,7 @@ ATRewriteTable(AlteredTableInfo *tab, Oid OIDNewHeap)
 					(errmsg_internal("verifying table \"%s\"",
 									 RelationGetRelationName(oldrel))));
 
-		if (newrel)
+		if (newrel && pscan == NULL)
 		{
 			/*
 			 * All predicate locks on the tuples or pages are about to be made
@@ -6374,10 +6464,20 @@ ATRewriteTable(AlteredTableInfo *tab, Oid OIDNewHeap)
 
 		/*
 		 * Scan through the rows, generating a new row if needed and then
-		 * checking all the constraints.
+		 * checking all the constraints.  Try to get parallel workers to share
+		 * the work, in which case we join their parallel scan.
 		 */
-		snapshot = RegisterSnapshot(GetLatestSnapshot());
-		scan = table_beginscan(oldrel, snapshot, 0, NULL);
+		if (pscan == NULL)
+		{
+			snapshot = RegisterSnapshot(GetLatestSnapshot());
+			if (notnull_virtual_attrs == NIL)
+				pcxt = ATRewriteTableBeginParallel(tab, oldrel, newrel,
+												   snapshot, &pscan);
+		}
+		if (pscan != NULL)
+			scan = table_beginscan_parallel(oldrel, pscan);
+		else
+			scan = table_beginscan(oldrel, snapshot, 0, NULL);
 
 		/*
 		 * Switch to per-tuple memory context and reset it for each tuple
@@ -6559,7 +6659,10 @@ ATRewriteTable(AlteredTableInfo *tab, Oid OIDNewHeap)
 
 		MemoryContextSwitchTo(oldCxt);
 		table_endscan(scan);
-		UnregisterSnapshot(snapshot);
+		if (pcxt != NULL)
+			ATRewriteTableEndParallel(pcxt);
+		if (snapshot != NULL)
+			UnregisterSnapshot(snapshot);
 
 		ExecDropSingleTupleTableSlot(oldslot);
 		if (newslot)
@@ -6579,6 +6682,343 @@ ATRewriteTable(AlteredTableInfo *tab, Oid OIDNewHeap)
 	}
 }
 
+/*
+ * Can the rewrite or verification scan of a table be shared with parallel
+ * workers?
+ *
+ * The workers compute the new tuples, check the constraints on them and
+ * insert them into the new heap, if any, so all the expressions involved
+ * must be parallel safe.  Workers can only insert into heap tables, and
+ * can't access the leader's temporary tables.
+ */
+static bool
+ATRewriteTableParallelSafe(AlteredTableInfo *tab, Relation oldrel,
+						   Relation newrel)
+{
+	ListCell   *l;
+
+	if (RelationUsesLocalBuffers(oldrel))
+		return false;
+	if (newrel &&
+		(newrel->rd_rel->relam != HEAP_TABLE_AM_OID ||
+		 RelationUsesLocalBuffers(newrel)))
+		return false;
+
+	foreach(l, tab->newvals)
+	{
+		NewColumnValue *ex = lfirst(l);
+
+		if (!expression_is_parallel_safe((Node *) ex->expr))
+			return false;
+	}
+
+	foreach(l, tab->constraints)
+	{
+		NewConstraint *con = lfirst(l);
+
+		if (con->contype == CONSTR_CHECK &&
+			!expression_is_parallel_safe(expand_generated_columns_in_expr(con->qual, oldrel, 1)))
+			return false;
+	}
+
+	return expression_is_parallel_safe((Node *) tab->partition_constraint);
+}
+
+/*
+ * Try to launch parallel workers to help rewrite or verify a table in
+ * ATRewriteTable.  newrel is NULL if we're only checking constraints.
+ *
+ * Each worker runs ATRewriteTable itself, taking its share of the blocks of
+ * the old table from a parallel scan with the given snapshot, which the
+ * caller joins too, checking the constraints and inserting the new tuples
+ * into the new heap with our transaction and command IDs.  Rows are inserted
+ * in no particular order.  The first participant to find a violation reports
+ * it, and an error in a worker is rethrown in the leader.
+ *
+ * Returns the parallel context, and the parallel scan in *pscan, or NULL if
+ * the scan has to be done serially.
+ */
+static ParallelContext *
+ATRewriteTableBeginParallel(AlteredTableInfo *tab, Relation oldrel,
+							Relation newrel, Snapshot snapshot,
+							ParallelTableScanDesc *pscan)
+{
+	ParallelContext *pcxt;
+	ParallelRewriteShared *shared;
+	List	   *newvals = NIL;
+	List	   *checks = NIL;
+	ListCell   *l;
+	char	   *exprs;
+	char	   *shmexprs;
+	Size		estshared;
+	Size		exprs_len;
+	int			nworkers;
+	int			querylen;
+
+	/* Workers can't be started from workers */
+	if (IsInParallelMode())
+		return NULL;
+
+	if (!ATRewriteTableParallelSafe(tab, oldrel, newrel))
+		return NULL;
+
+	nworkers = plan_rewrite_table_workers(RelationGetRelid(oldrel));
+	if (nworkers == 0)
+		return NULL;
+
+	/* Flatten the new column values and CHECK constraints for the workers */
+	foreach(l, tab->newvals)
+	{
+		NewColumnValue *ex = lfirst(l);
+
+		newvals = lappend(newvals,
+						  list_make3(makeInteger(ex->attnum),
+									 makeBoolean(ex->is_generated),
+									 ex->expr));
+	}
+	foreach(l, tab->constraints)
+	{
+		NewConstraint *con = lfirst(l);
+
+		if (con->contype == CONSTR_CHECK)
+			checks = lappend(checks,
+							 list_make2(makeString(con->name), con->qual));
+	}
+	exprs = nodeToString(list_make3(newvals, checks,
+									tab->partition_constraint));
+	exprs_len = strlen(exprs) + 1;
+
+	/* The workers insert with our transaction and command IDs */
+	if (newrel)
+	{
+		(void) GetCurrentTransactionId();
+		(void) GetCurrentCommandId(true);
+	}
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "ATRewriteTableParallelMain",
+								 nworkers);
+
+	/* Estimate space for shared information and the parallel scan */
+	estshared = add_size(BUFFERALIGN(sizeof(ParallelRewriteShared)),
+						 table_parallelscan_estimate(oldrel, snapshot));
+	shm_toc_estimate_chunk(&pcxt->estimator, estshared);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Estimate space for the old tuple descriptor and the expressions */
+	shm_toc_estimate_chunk(&pcxt->estimator, TupleDescSize(tab->oldDesc));
+	shm_toc_estimate_chunk(&pcxt->estimator, exprs_len);
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	/* Estimate space for BufferUsage and WalUsage of each worker */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_REWRITE_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial rewrite) */
+	if (pcxt->seg == NULL)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return NULL;
+	}
+
+	shared = (ParallelRewriteShared *) shm_toc_allocate(pcxt->toc, estshared);
+	shared->relid = RelationGetRelid(oldrel);
+	shared->newrelid = newrel ? RelationGetRelid(newrel) : InvalidOid;
+	shared->newrel_skip_wal = newrel && !RelationNeedsWAL(newrel);
+	shared->rewrite = tab->rewrite;
+	shared->verify_new_notnull = tab->verify_new_notnull;
+	shared->validate_default = tab->validate_default;
+	shared->queryid = pgstat_get_my_query_id();
+	table_parallelscan_initialize(oldrel,
+								  ParallelTableScanFromRewriteShared(shared),
+								  snapshot);
+	shm_toc_insert(pcxt->toc, PARALLEL_REWRITE_KEY_SHARED, shared);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_REWRITE_KEY_OLD_TUPDESC,
+				   shm_toc_allocate(pcxt->toc, TupleDescSize(tab->oldDesc)));
+	TupleDescCopy(shm_toc_lookup(pcxt->toc, PARALLEL_REWRITE_KEY_OLD_TUPDESC,
+								 false),
+				  tab->oldDesc);
+
+	shmexprs = shm_toc_allocate(pcxt->toc, exprs_len);
+	memcpy(shmexprs, exprs, exprs_len);
+	shm_toc_insert(pcxt->toc, PARALLEL_REWRITE_KEY_EXPRS, shmexprs);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_REWRITE_KEY_BUFFER_USAGE,
+				   shm_toc_allocate(pcxt->toc,
+									mul_size(sizeof(BufferUsage), pcxt->nworkers)));
+	shm_toc_insert(pcxt->toc, PARALLEL_REWRITE_KEY_WAL_USAGE,
+				   shm_toc_allocate(pcxt->toc,
+									mul_size(sizeof(WalUsage), pcxt->nworkers)));
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_REWRITE_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	LaunchParallelWorkers(pcxt);
+
+	/* If no workers were successfully launched, back out */
+	if (pcxt->nworkers_launched == 0)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return NULL;
+	}
+
+	*pscan = ParallelTableScanFromRewriteShared(shared);
+
+	return pcxt;
+}
+
+/*
+ * Wait for the workers of a parallel table rewrite or verification scan to
+ * finish, destroy the parallel context, and end parallel mode.
+ */
+static void
+ATRewriteTableEndParallel(ParallelContext *pcxt)
+{
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+
+	WaitForParallelWorkersToFinish(pcxt);
+
+	/*
+	 * Next, accumulate buffer and WAL usage.  (This must wait for the workers
+	 * to finish, or we might get incomplete data.)
+	 */
+	buffer_usage = shm_toc_lookup(pcxt->toc, PARALLEL_REWRITE_KEY_BUFFER_USAGE,
+								  false);
+	wal_usage = shm_toc_lookup(pcxt->toc, PARALLEL_REWRITE_KEY_WAL_USAGE,
+							   false);
+	for (int i = 0; i < pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&buffer_usage[i], &wal_usage[i]);
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Perform the work of a parallel table rewrite or verification worker.
+ */
+void
+ATRewriteTableParallelMain(dsm_segment *seg, shm_toc *toc)
+{
+	ParallelRewriteShared *shared;
+	AlteredTableInfo *tab;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	List	   *exprs;
+	ListCell   *l;
+	char	   *sharedquery;
+
+	shared = shm_toc_lookup(toc, PARALLEL_REWRITE_KEY_SHARED, false);
+
+	/* Set debug_query_string for individual workers */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_REWRITE_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Track query ID */
+	pgstat_report_query_id(shared->queryid, false);
+
+	/*
+	 * Lock the tables.  Reading the old table needs no more than
+	 * AccessShareLock, which is fine however strong a lock the leader holds;
+	 * the new heap is locked the way the leader, who created it, has it
+	 * locked.  Neither conflicts within the lock group.
+	 */
+	LockRelationOid(shared->relid, AccessShareLock);
+	if (OidIsValid(shared->newrelid))
+		LockRelationOid(shared->newrelid, AccessExclusiveLock);
+
+	/*
+	 * With wal_level = minimal, the leader doesn't WAL-log the new heap it
+	 * created in this transaction, since it gets synced at commit instead.
+	 * Our relcache entry doesn't know that the relation is new, so tell it,
+	 * lest we WAL-log every tuple we insert.  The entry is then kept until
+	 * the end of the transaction.
+	 */
+	if (shared->newrel_skip_wal)
+	{
+		Relation	newrel = table_open(shared->newrelid, NoLock);
+
+		RelationAssumeNewRelfilelocator(newrel);
+		table_close(newrel, NoLock);
+	}
+
+	/* Reconstruct the parts of the AlteredTableInfo ATRewriteTable uses */
+	tab = palloc0_object(AlteredTableInfo);
+	tab->relid = shared->relid;
+	tab->oldDesc = CreateTupleDescCopy(shm_toc_lookup(toc, PARALLEL_REWRITE_KEY_OLD_TUPDESC,
+													  false));
+	tab->rewrite = shared->rewrite;
+	tab->verify_new_notnull = shared->verify_new_notnull;
+	tab->validate_default = shared->validate_default;
+
+	exprs = (List *) stringToNode(shm_toc_lookup(toc, PARALLEL_REWRITE_KEY_EXPRS,
+												 false));
+	foreach(l, (List *) linitial(exprs))
+	{
+		List	   *item = lfirst(l);
+		NewColumnValue *ex = palloc0_object(NewColumnValue);
+
+		ex->attnum = intVal(linitial(item));
+		ex->is_generated = boolVal(lsecond(item));
+		ex->expr = lthird(item);
+		tab->newvals = lappend(tab->newvals, ex);
+	}
+	foreach(l, (List *) lsecond(exprs))
+	{
+		List	   *item = lfirst(l);
+		NewConstraint *con = palloc0_object(NewConstraint);
+
+		con->name = strVal(linitial(item));
+		con->contype = CONSTR_CHECK;
+		con->qual = lsecond(item);
+		tab->constraints = lappend(tab->constraints, con);
+	}
+	tab->partition_constraint = lthird(exprs);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	ATRewriteTable(tab, shared->newrelid,
+				   ParallelTableScanFromRewriteShared(shared));
+
+	/* Report buffer/WAL usage during parallel execution */
+	buffer_usage = shm_toc_lookup(toc, PARALLEL_REWRITE_KEY_BUFFER_USAGE, false);
+	wal_usage = shm_toc_lookup(toc, PARALLEL_REWRITE_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&buffer_usage[ParallelWorkerNumber],
+						  &wal_usage[ParallelWorkerNumber]);
+
+	if (OidIsValid(shared->newrelid))
+		UnlockRelationOid(shared->newrelid, AccessExclusiveLock);
+	UnlockRelationOid(shared->relid, AccessShareLock);
+}
+
 /*
  * ATGetQueueEntry: find or create an entry in the ALTER TABLE work queue
  */
@@ -10175,6 +10615,12 @@ ATAddForeignKeyConstraint(List **wqueue, AlteredTableInfo *tab, Relation rel,
 						(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
 						 errmsg("constraints on unlogged tables may reference only permanent or unlogged tables")));
 			break;
+		case RELPERSISTENCE_GLOBAL_TEMP:
+			if (!RelationIsGlobalTemp(pkrel))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+						 errmsg("constraints on global temporary tables may reference only global temporary tables")));
+			break;
 		case RELPERSISTENCE_TEMP:
 			if (pkrel->rd_rel->relpersistence != RELPERSISTENCE_TEMP)
 				ereport(ERROR,
@@ -16644,6 +17090,12 @@ ATPrepSetTableSpace(AlteredTableInfo *tab, Relation rel, const char *tablespacen
 {
 	Oid			tablespaceId;
 
+	if (RelationIsGlobalTemp(rel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot change tablespace of global temporary relation \"%s\"",
+						RelationGetRelationName(rel))));
+
 	/* Check that the tablespace exists */
 	tablespaceId = get_tablespace_oid(tablespacename, false);
 
@@ -17306,6 +17758,11 @@ ATExecAddInherit(Relation child_rel, RangeVar *parent, LOCKMODE lockmode)
 	ATSimplePermissions(AT_AddInherit, parent_rel,
 						ATT_TABLE | ATT_PARTITIONED_TABLE | ATT_FOREIGN_TABLE);
 
+	if (RelationIsGlobalTemp(parent_rel) || RelationIsGlobalTemp(child_rel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("global temporary tables cannot take part in inheritance")));
+
 	/* Permanent rels cannot inherit from temporary ones */
 	if (parent_rel->rd_rel->relpersistence == RELPERSISTENCE_TEMP &&
 		child_rel->rd_rel->relpersistence != RELPERSISTENCE_TEMP)
@@ -17369,7 +17826,8 @@ ATExecAddInherit(Relation child_rel, RangeVar *parent, LOCKMODE lockmode)
 	 * currently don't allow it to become an inheritance child.  See also
 	 * prohibitions in ATExecAttachPartition() and CreateTrigger().
 	 */
-	trigger_name = FindTriggerIncompatibleWithInheritance(child_rel->trigdesc);
+	trigger_name =
+		FindTriggerIncompatibleWithInheritance(RelationGetTriggerDesc(child_rel));
 	if (trigger_name != NULL)
 		ereport(ERROR,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
@@ -18859,6 +19317,7 @@ ATPrepChangePersistence(AlteredTableInfo *tab, Relation rel, bool toLogged)
 	switch (rel->rd_rel->relpersistence)
 	{
 		case RELPERSISTENCE_TEMP:
+		case RELPERSISTENCE_GLOBAL_TEMP:
 			ereport(ERROR,
 					(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
 					 errmsg("cannot change logged status of table \"%s\" because it is temporary",
@@ -20419,6 +20878,12 @@ ATExecAttachPartition(List **wqueue, Relation rel, PartitionCmd *cmd,
 						   RelationGetRelationName(rel),
 						   RelationGetRelationName(attachrel))));
 
+	if (RelationIsGlobalTemp(attachrel))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot attach global temporary relation \"%s\" as a partition",
+						RelationGetRelationName(attachrel))));
+
 	/* If the parent is permanent, so must be all of its partitions. */
 	if (rel->rd_rel->relpersistence != RELPERSISTENCE_TEMP &&
 		attachrel->rd_rel->relpersistence == RELPERSISTENCE_TEMP)
@@ -20486,7 +20951,8 @@ ATExecAttachPartition(List **wqueue, Relation rel, PartitionCmd *cmd,
 	 * currently don't allow it to become a partition.  See also prohibitions
 	 * in ATExecAddInherit() and CreateTrigger().
 	 */
-	trigger_name = FindTriggerIncompatibleWithInheritance(attachrel->trigdesc);
+	trigger_name =
+		FindTriggerIncompatibleWithInheritance(RelationGetTriggerDesc(attachrel));
 	if (trigger_name != NULL)
 		ereport(ERROR,
 				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
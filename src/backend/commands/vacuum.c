@@ -34,6 +34,7 @@
 #include "access/tableam.h"
 #include "access/transam.h"
 #include "access/xact.h"
+#include "catalog/globaltemp.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_database.h"
 #include "catalog/pg_inherits.h"
@@ -58,6 +59,7 @@
 #include "utils/guc.h"
 #include "utils/guc_hooks.h"
 #include "utils/injection_point.h"
+#include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
@@ -174,6 +176,7 @@ ExecVacuum(ParseState *pstate, VacuumStmt *vacstmt, bool isTopLevel)
 	int			ring_size;
 	bool		skip_database_stats = false;
 	bool		only_database_stats = false;
+	bool		incremental = false;
 	MemoryContext vac_context;
 	ListCell   *lc;
 
@@ -229,6 +232,11 @@ ExecVacuum(ParseState *pstate, VacuumStmt *vacstmt, bool isTopLevel)
 
 			ring_size = result;
 		}
+
+		/* Parse options available on ANALYZE only */
+		else if (strcmp(opt->defname, "incremental") == 0 &&
+				 !vacstmt->is_vacuumcmd)
+			incremental = defGetBoolean(opt);
 		else if (!vacstmt->is_vacuumcmd)
 			ereport(ERROR,
 					(errcode(ERRCODE_SYNTAX_ERROR),
@@ -312,7 +320,8 @@ ExecVacuum(ParseState *pstate, VacuumStmt *vacstmt, bool isTopLevel)
 		(process_main ? VACOPT_PROCESS_MAIN : 0) |
 		(process_toast ? VACOPT_PROCESS_TOAST : 0) |
 		(skip_database_stats ? VACOPT_SKIP_DATABASE_STATS : 0) |
-		(only_database_stats ? VACOPT_ONLY_DATABASE_STATS : 0);
+		(only_database_stats ? VACOPT_ONLY_DATABASE_STATS : 0) |
+		(incremental ? VACOPT_INCREMENTAL : 0);
 
 	/* sanity checks on options */
 	Assert(params.options & (VACOPT_VACUUM | VACOPT_ANALYZE));
@@ -559,6 +568,31 @@ vacuum(List *relations, const VacuumParams params, BufferAccessStrategy bstrateg
 	else
 		relations = get_all_vacuum_rels(vac_context, params.options);
 
+	/*
+	 * An incremental ANALYZE computes the statistics of partitioned tables
+	 * from those of their partitions, so process them after everything else.
+	 */
+	if (params.options & VACOPT_INCREMENTAL)
+	{
+		List	   *partitioned = NIL;
+		List	   *others = NIL;
+		ListCell   *lc;
+		MemoryContext old_context;
+
+		old_context = MemoryContextSwitchTo(vac_context);
+		foreach(lc, relations)
+		{
+			VacuumRelation *vrel = lfirst_node(VacuumRelation, lc);
+
+			if (get_rel_relkind(vrel->oid) == RELKIND_PARTITIONED_TABLE)
+				partitioned = lappend(partitioned, vrel);
+			else
+				others = lappend(others, vrel);
+		}
+		relations = list_concat(others, partitioned);
+		MemoryContextSwitchTo(old_context);
+	}
+
 	/*
 	 * Decide whether we need to start/commit our own transactions.
 	 *
@@ -1118,9 +1152,18 @@ vacuum_get_cutoffs(Relation rel, const VacuumParams params,
 	freeze_table_age = params.freeze_table_age;
 	multixact_freeze_table_age = params.multixact_freeze_table_age;
 
-	/* Set pg_class fields in cutoffs */
-	cutoffs->relfrozenxid = rel->rd_rel->relfrozenxid;
-	cutoffs->relminmxid = rel->rd_rel->relminmxid;
+	/*
+	 * Set pg_class fields in cutoffs.  This session keeps its own for a
+	 * global temporary table.
+	 */
+	if (RelationIsGlobalTemp(rel))
+		GlobalTempRelationGetXids(rel, &cutoffs->relfrozenxid,
+								  &cutoffs->relminmxid);
+	else
+	{
+		cutoffs->relfrozenxid = rel->rd_rel->relfrozenxid;
+		cutoffs->relminmxid = rel->rd_rel->relminmxid;
+	}
 
 	/*
 	 * Acquire OldestXmin.
@@ -1443,6 +1486,25 @@ vac_update_relstats(Relation relation,
 				futuremxid;
 	TransactionId oldfrozenxid;
 	MultiXactId oldminmulti;
+	bool		hastriggers;
+
+	/*
+	 * The relfrozenxid and relminmxid of a global temporary table would
+	 * describe just this session's contents, so the session keeps them
+	 * itself.
+	 */
+	if (RelationIsGlobalTemp(relation))
+	{
+		GlobalTempRelationSetXids(relation, frozenxid, minmulti);
+		frozenxid = InvalidTransactionId;
+		minmulti = InvalidMultiXactId;
+	}
+
+	/*
+	 * Triggers are loaded into the relcache on demand, which involves catalog
+	 * access.  Do that now, while we don't hold the inplace update lock.
+	 */
+	hastriggers = (RelationGetTriggerDesc(relation) != NULL);
 
 	rd = table_open(RelationRelationId, RowExclusiveLock);
 
@@ -1501,7 +1563,7 @@ vac_update_relstats(Relation relation,
 			pgcform->relhasrules = false;
 			dirty = true;
 		}
-		if (pgcform->relhastriggers && relation->trigdesc == NULL)
+		if (pgcform->relhastriggers && !hastriggers)
 		{
 			pgcform->relhastriggers = false;
 			dirty = true;
@@ -1682,6 +1744,10 @@ vac_update_datfrozenxid(void)
 			continue;
 		}
 
+		/* the contents of global temporary tables are accounted for below */
+		if (classForm->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+			continue;
+
 		/*
 		 * Some table AMs might not need per-relation xid / multixid horizons.
 		 * It therefore seems reasonable to allow relfrozenxid and relminmxid
@@ -1736,6 +1802,8 @@ vac_update_datfrozenxid(void)
 	if (bogus)
 		return;
 
+	GlobalTempGetOldestXids(MyDatabaseId, &newFrozenXid, &newMinMulti);
+
 	Assert(TransactionIdIsNormal(newFrozenXid));
 	Assert(MultiXactIdIsValid(newMinMulti));
 
@@ -2145,6 +2213,39 @@ vacuum_rel(Oid relid, RangeVar *relation, VacuumParams params,
 		return false;
 	}
 
+	/*
+	 * VACUUM FULL would give the table a new relfilenumber, which a global
+	 * temporary table can't have.  Vacuum this session's contents of it the
+	 * regular way instead, and say so.
+	 */
+	if ((params.options & VACOPT_FULL) && RelationIsGlobalTemp(rel))
+	{
+		ereport(NOTICE,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("VACUUM FULL is not supported for global temporary table \"%s\"",
+						RelationGetRelationName(rel)),
+				 errdetail("The table is vacuumed without FULL instead.")));
+		params.options &= ~VACOPT_FULL;
+	}
+
+	/*
+	 * Only this session's contents of a global temporary table are vacuumed.
+	 * If it has none, there is nothing to do; otherwise, make sure that the
+	 * indexes have been built for them.
+	 */
+	if (RelationIsGlobalTemp(rel))
+	{
+		if (!GlobalTempRelationHasStorage(rel))
+		{
+			relation_close(rel, lmode);
+			PopActiveSnapshot();
+			CommitTransactionCommand();
+			/* It's OK to proceed with ANALYZE on this table */
+			return true;
+		}
+		GlobalTempRelationInitIndexes(rel);
+	}
+
 	/*
 	 * Silently ignore partitioned tables as there is no work to be done.  The
 	 * useful work is on their child partitions, which have been queued up for
@@ -8,7 +8,10 @@
  *
  * In a parallel vacuum, we perform both index bulk deletion and index cleanup
  * with parallel worker processes.  Individual indexes are processed by one
- * vacuum process.  ParallelVacuumState contains shared information as well as
+ * vacuum process.  For large enough tables, the workers also share the
+ * table AM's initial scan of the heap, which hands out ranges of blocks to
+ * the participants and collects the dead items of all of them in the shared
+ * TidStore.  ParallelVacuumState contains shared information as well as
  * the memory space for storing dead items allocated in the DSA area.  We
  * launch parallel worker processes at the start of parallel index
  * bulk-deletion and index cleanup and once all indexes are processed, the
@@ -27,6 +30,7 @@
 #include "postgres.h"
 
 #include "access/amapi.h"
+#include "access/heapam.h"
 #include "access/table.h"
 #include "access/xact.h"
 #include "commands/progress.h"
@@ -49,6 +53,7 @@
 #define PARALLEL_VACUUM_KEY_BUFFER_USAGE	3
 #define PARALLEL_VACUUM_KEY_WAL_USAGE		4
 #define PARALLEL_VACUUM_KEY_INDEX_STATS		5
+#define PARALLEL_VACUUM_KEY_SCAN_STATE		6
 
 /*
  * Shared information among parallel workers.  So this is allocated in the DSM
@@ -111,6 +116,9 @@ typedef struct PVShared
 	/* Counter for vacuuming and cleanup */
 	pg_atomic_uint32 idx;
 
+	/* Are the workers launched to take part in the heap scan? */
+	bool		heap_scan;
+
 	/* DSA handle where the TidStore lives */
 	dsa_handle	dead_items_dsa_handle;
 
@@ -211,6 +219,16 @@ struct ParallelVacuumState
 	/* Buffer access strategy used by leader process */
 	BufferAccessStrategy bstrategy;
 
+	/*
+	 * Number of workers to launch for the heap scan, and the table AM's
+	 * shared state for it (see parallel_vacuum_get_scan_state()).
+	 */
+	int			nworkers_heap_scan;
+	void	   *scan_state;
+
+	/* Have workers been launched before (so that the DSM needs resetting)? */
+	bool		launched;
+
 	/*
 	 * Error reporting state.  The error callback is set only for workers
 	 * processes during parallel index vacuum.
@@ -221,8 +239,10 @@ struct ParallelVacuumState
 	PVIndVacStatus status;
 };
 
-static int	parallel_vacuum_compute_workers(Relation *indrels, int nindexes, int nrequested,
-											bool *will_parallel_vacuum);
+static int	parallel_vacuum_compute_workers(Relation rel, Relation *indrels,
+											int nindexes, int nrequested,
+											bool *will_parallel_vacuum,
+											int *nworkers_heap_scan);
 static void parallel_vacuum_process_all_indexes(ParallelVacuumState *pvs, int num_index_scans,
 												bool vacuum);
 static void parallel_vacuum_process_safe_indexes(ParallelVacuumState *pvs);
@@ -242,7 +262,8 @@ static void parallel_vacuum_error_callback(void *arg);
 ParallelVacuumState *
 parallel_vacuum_init(Relation rel, Relation *indrels, int nindexes,
 					 int nrequested_workers, int vac_work_mem,
-					 int elevel, BufferAccessStrategy bstrategy)
+					 int elevel, BufferAccessStrategy bstrategy,
+					 Size scan_state_size)
 {
 	ParallelVacuumState *pvs;
 	ParallelContext *pcxt;
@@ -256,22 +277,20 @@ parallel_vacuum_init(Relation rel, Relation *indrels, int nindexes,
 	Size		est_shared_len;
 	int			nindexes_mwm = 0;
 	int			parallel_workers = 0;
+	int			nworkers_heap_scan = 0;
 	int			querylen;
 
-	/*
-	 * A parallel vacuum must be requested and there must be indexes on the
-	 * relation
-	 */
+	/* A parallel vacuum must be requested */
 	Assert(nrequested_workers >= 0);
-	Assert(nindexes > 0);
 
 	/*
 	 * Compute the number of parallel vacuum workers to launch
 	 */
 	will_parallel_vacuum = palloc0_array(bool, nindexes);
-	parallel_workers = parallel_vacuum_compute_workers(indrels, nindexes,
+	parallel_workers = parallel_vacuum_compute_workers(rel, indrels, nindexes,
 													   nrequested_workers,
-													   will_parallel_vacuum);
+													   will_parallel_vacuum,
+													   &nworkers_heap_scan);
 	if (parallel_workers <= 0)
 	{
 		/* Can't perform vacuum in parallel -- return NULL */
@@ -285,6 +304,7 @@ parallel_vacuum_init(Relation rel, Relation *indrels, int nindexes,
 	pvs->will_parallel_vacuum = will_parallel_vacuum;
 	pvs->bstrategy = bstrategy;
 	pvs->heaprel = rel;
+	pvs->nworkers_heap_scan = nworkers_heap_scan;
 
 	EnterParallelMode();
 	pcxt = CreateParallelContext("postgres", "parallel_vacuum_main",
@@ -302,6 +322,13 @@ parallel_vacuum_init(Relation rel, Relation *indrels, int nindexes,
 	shm_toc_estimate_chunk(&pcxt->estimator, est_shared_len);
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 
+	/* Estimate size for the heap scan -- PARALLEL_VACUUM_KEY_SCAN_STATE */
+	if (nworkers_heap_scan > 0)
+	{
+		shm_toc_estimate_chunk(&pcxt->estimator, scan_state_size);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+
 	/*
 	 * Estimate space for BufferUsage and WalUsage --
 	 * PARALLEL_VACUUM_KEY_BUFFER_USAGE and PARALLEL_VACUUM_KEY_WAL_USAGE.
@@ -394,6 +421,14 @@ parallel_vacuum_init(Relation rel, Relation *indrels, int nindexes,
 	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_SHARED, shared);
 	pvs->shared = shared;
 
+	/* Space for the table AM's heap scan state, initialized by the AM */
+	if (nworkers_heap_scan > 0)
+	{
+		pvs->scan_state = shm_toc_allocate(pcxt->toc, scan_state_size);
+		shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_SCAN_STATE,
+					   pvs->scan_state);
+	}
+
 	/*
 	 * Allocate space for each worker's BufferUsage and WalUsage; no need to
 	 * initialize
@@ -493,6 +528,85 @@ parallel_vacuum_reset_dead_items(ParallelVacuumState *pvs)
 	dead_items_info->num_items = 0;
 }
 
+/*
+ * Returns the shared state for the parallel heap scan, or NULL if the heap
+ * is not to be scanned in parallel.
+ */
+void *
+parallel_vacuum_get_scan_state(ParallelVacuumState *pvs)
+{
+	return pvs->scan_state;
+}
+
+/*
+ * Launch parallel workers to take part in the heap scan.  Each of them calls
+ * heap_vacuum_parallel_scan_worker(), while the leader takes part on its own
+ * after this returns.  Returns the number of workers launched.
+ */
+int
+parallel_vacuum_scan_heap_begin(ParallelVacuumState *pvs)
+{
+	Assert(!IsParallelWorker());
+	Assert(pvs->nworkers_heap_scan > 0);
+
+	/* Reinitialize parallel context to relaunch parallel workers */
+	if (pvs->launched)
+		ReinitializeParallelDSM(pvs->pcxt);
+	pvs->launched = true;
+
+	pvs->shared->heap_scan = true;
+
+	/* See parallel_vacuum_process_all_indexes() */
+	pg_atomic_write_u32(&(pvs->shared->cost_balance), VacuumCostBalance);
+	pg_atomic_write_u32(&(pvs->shared->active_nworkers), 0);
+
+	ReinitializeParallelWorkers(pvs->pcxt, pvs->nworkers_heap_scan);
+	LaunchParallelWorkers(pvs->pcxt);
+
+	if (pvs->pcxt->nworkers_launched > 0)
+	{
+		VacuumCostBalance = 0;
+		VacuumCostBalanceLocal = 0;
+		VacuumSharedCostBalance = &(pvs->shared->cost_balance);
+		VacuumActiveNWorkers = &(pvs->shared->active_nworkers);
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+	}
+
+	ereport(pvs->shared->elevel,
+			(errmsg(ngettext("launched %d parallel vacuum worker for heap scanning (planned: %d)",
+							 "launched %d parallel vacuum workers for heap scanning (planned: %d)",
+							 pvs->pcxt->nworkers_launched),
+					pvs->pcxt->nworkers_launched, pvs->nworkers_heap_scan)));
+
+	return pvs->pcxt->nworkers_launched;
+}
+
+/*
+ * Wait for the workers launched by parallel_vacuum_scan_heap_begin() to
+ * finish their part of the heap scan.
+ */
+void
+parallel_vacuum_scan_heap_end(ParallelVacuumState *pvs)
+{
+	Assert(!IsParallelWorker());
+
+	WaitForParallelWorkersToFinish(pvs->pcxt);
+
+	for (int i = 0; i < pvs->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&pvs->buffer_usage[i], &pvs->wal_usage[i]);
+
+	pvs->shared->heap_scan = false;
+
+	/* Carry the shared balance value back, and disable shared costing */
+	if (VacuumSharedCostBalance)
+	{
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+		VacuumCostBalance = pg_atomic_read_u32(VacuumSharedCostBalance);
+		VacuumSharedCostBalance = NULL;
+		VacuumActiveNWorkers = NULL;
+	}
+}
+
 /*
  * Do parallel index bulk-deletion with parallel workers.
  */
@@ -537,22 +651,28 @@ parallel_vacuum_cleanup_all_indexes(ParallelVacuumState *pvs, long num_table_tup
  * vacuum and index cleanup can be executed with parallel workers.
  * The index is eligible for parallel vacuum iff its size is greater than
  * min_parallel_index_scan_size as invoking workers for very small indexes
- * can hurt performance.
+ * can hurt performance.  Likewise, the heap scan is only done in parallel if
+ * the table is at least min_parallel_table_scan_size.
  *
  * nrequested is the number of parallel workers that user requested.  If
  * nrequested is 0, we compute the parallel degree based on nindexes, that is
- * the number of indexes that support parallel vacuum.  This function also
- * sets will_parallel_vacuum to remember indexes that participate in parallel
- * vacuum.
+ * the number of indexes that support parallel vacuum, and on the size of the
+ * table.  This function also sets will_parallel_vacuum to remember indexes
+ * that participate in parallel vacuum, and *nworkers_heap_scan to the number
+ * of workers to use for the heap scan.
  */
 static int
-parallel_vacuum_compute_workers(Relation *indrels, int nindexes, int nrequested,
-								bool *will_parallel_vacuum)
+parallel_vacuum_compute_workers(Relation rel, Relation *indrels, int nindexes,
+								int nrequested, bool *will_parallel_vacuum,
+								int *nworkers_heap_scan)
 {
 	int			nindexes_parallel = 0;
 	int			nindexes_parallel_bulkdel = 0;
 	int			nindexes_parallel_cleanup = 0;
 	int			parallel_workers;
+	BlockNumber heap_pages;
+
+	*nworkers_heap_scan = 0;
 
 	/*
 	 * We don't allow performing parallel operation in standalone backend or
@@ -589,18 +709,44 @@ parallel_vacuum_compute_workers(Relation *indrels, int nindexes, int nrequested,
 	/* The leader process takes one index */
 	nindexes_parallel--;
 
-	/* No index supports parallel vacuum */
-	if (nindexes_parallel <= 0)
-		return 0;
+	/* Compute the parallel degree for the indexes */
+	parallel_workers = 0;
+	if (nindexes_parallel > 0)
+		parallel_workers = (nrequested > 0) ?
+			Min(nrequested, nindexes_parallel) : nindexes_parallel;
 
-	/* Compute the parallel degree */
-	parallel_workers = (nrequested > 0) ?
-		Min(nrequested, nindexes_parallel) : nindexes_parallel;
+	/*
+	 * Compute the parallel degree for the heap scan the same way as for a
+	 * parallel sequential scan: one worker for a table of at least
+	 * min_parallel_table_scan_size, and one more for every tripling of the
+	 * size beyond that.  Only heap can scan in parallel so far.
+	 */
+	heap_pages = RelationGetNumberOfBlocks(rel);
+	if (rel->rd_tableam == GetHeapamTableAmRoutine() &&
+		heap_pages >= (BlockNumber) min_parallel_table_scan_size)
+	{
+		int			heap_workers = 1;
+		int			threshold = Max(min_parallel_table_scan_size, 1);
+
+		while (heap_pages >= (BlockNumber) (threshold * 3))
+		{
+			heap_workers++;
+			threshold *= 3;
+			if (threshold > INT_MAX / 3)
+				break;
+		}
+
+		if (nrequested > 0)
+			heap_workers = nrequested;
+
+		*nworkers_heap_scan = Min(heap_workers,
+								  max_parallel_maintenance_workers);
+	}
 
 	/* Cap by max_parallel_maintenance_workers */
 	parallel_workers = Min(parallel_workers, max_parallel_maintenance_workers);
 
-	return parallel_workers;
+	return Max(parallel_workers, *nworkers_heap_scan);
 }
 
 /*
@@ -670,8 +816,9 @@ parallel_vacuum_process_all_indexes(ParallelVacuumState *pvs, int num_index_scan
 	if (nworkers > 0)
 	{
 		/* Reinitialize parallel context to relaunch parallel workers */
-		if (num_index_scans > 0)
+		if (pvs->launched)
 			ReinitializeParallelDSM(pvs->pcxt);
+		pvs->launched = true;
 
 		/*
 		 * Set up shared cost balance and the number of active workers for
@@ -982,8 +1129,8 @@ parallel_vacuum_index_is_parallel_safe(Relation indrel, int num_index_scans,
 /*
  * Perform work within a launched parallel process.
  *
- * Since parallel vacuum workers perform only index vacuum or index cleanup,
- * we don't need to report progress information.
+ * Parallel vacuum workers take part in the heap scan, or perform index
+ * vacuum or index cleanup.  We don't need to report progress information.
  */
 void
 parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
@@ -1030,7 +1177,6 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	 * matched to the leader's one.
 	 */
 	vac_open_indexes(rel, RowExclusiveLock, &nindexes, &indrels);
-	Assert(nindexes > 0);
 
 	/*
 	 * Apply the desired value of maintenance_work_mem within this process.
@@ -1085,8 +1231,27 @@ parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 	/* Prepare to track buffer usage during parallel execution */
 	InstrStartParallelQuery();
 
-	/* Process indexes to perform vacuum/cleanup */
-	parallel_vacuum_process_safe_indexes(&pvs);
+	if (shared->heap_scan)
+	{
+		/* Take part in the heap scan */
+		if (VacuumActiveNWorkers)
+			pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+
+		heap_vacuum_parallel_scan_worker(rel, nindexes, dead_items,
+										 &shared->dead_items_info,
+										 shm_toc_lookup(toc,
+														PARALLEL_VACUUM_KEY_SCAN_STATE,
+														false),
+										 pvs.bstrategy);
+
+		if (VacuumActiveNWorkers)
+			pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+	}
+	else
+	{
+		/* Process indexes to perform vacuum/cleanup */
+		parallel_vacuum_process_safe_indexes(&pvs);
+	}
 
 	/* Report buffer/WAL usage during parallel execution */
 	buffer_usage = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_BUFFER_USAGE, false);
@@ -115,6 +115,10 @@ ExecReScan(PlanState *node)
 
 			if (splan->plan->extParam != NULL)
 				UpdateChangedParamSet(splan, node->chgParam);
+
+			/* cached results may depend on the changed params */
+			if (splan->chgParam != NULL && sstate->cache != NULL)
+				ExecSubPlanResetCache(sstate);
 		}
 		/* Well. Now set chgParam for child trees. */
 		if (outerPlanState(node) != NULL)
@@ -428,8 +432,11 @@ ExecSupportsMarkRestore(Path *pathnode)
 		case T_IndexOnlyScan:
 
 			/*
-			 * Not all index types support mark/restore.
+			 * Not all index types support mark/restore, and loose index
+			 * scans never do.
 			 */
+			if (castNode(IndexPath, pathnode)->indexskipdistinct)
+				return false;
 			return castNode(IndexPath, pathnode)->indexinfo->amcanmarkpos;
 
 		case T_Material:
@@ -554,9 +561,14 @@ ExecSupportsBackwardScan(Plan *node)
 			return false;
 
 		case T_IndexScan:
+			/* loose index scans only go forward */
+			if (((IndexScan *) node)->indexskipdistinct)
+				return false;
 			return IndexSupportsBackwardScan(((IndexScan *) node)->indexid);
 
 		case T_IndexOnlyScan:
+			if (((IndexOnlyScan *) node)->indexskipdistinct)
+				return false;
 			return IndexSupportsBackwardScan(((IndexOnlyScan *) node)->indexid);
 
 		case T_SubqueryScan:
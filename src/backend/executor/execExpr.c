@@ -31,6 +31,7 @@
 #include "postgres.h"
 
 #include "access/nbtree.h"
+#include "common/int.h"
 #include "catalog/objectaccess.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
@@ -47,6 +48,7 @@
 #include "utils/acl.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/fmgroids.h"
 #include "utils/jsonfuncs.h"
 #include "utils/jsonpath.h"
 #include "utils/lsyscache.h"
@@ -69,6 +71,8 @@ typedef struct ExprSetupInfo
 } ExprSetupInfo;
 
 static void ExecReadyExpr(ExprState *state);
+static bool ExecInitQualBatchClause(Expr *node, ExprBatchClause *clause);
+static int	batch_clause_attnum_cmp(const void *a, const void *b);
 static void ExecInitExprRec(Expr *node, ExprState *state,
 							Datum *resv, bool *resnull);
 static void ExecInitFunc(ExprEvalStep *scratch, Expr *node, List *args,
@@ -79,6 +83,8 @@ static void ExecInitSubPlanExpr(SubPlan *subplan,
 								Datum *resv, bool *resnull);
 static void ExecCreateExprSetupSteps(ExprState *state, Node *node);
 static void ExecPushExprSetupSteps(ExprState *state, ExprSetupInfo *info);
+static void ExecPushQualSetupSteps(ExprState *state, ExprSetupInfo *info,
+								   ExprSetupInfo *fetched);
 static bool expr_setup_walker(Node *node, ExprSetupInfo *info);
 static bool ExecComputeSlotInfo(ExprState *state, ExprEvalStep *op);
 static void ExecInitWholeRowVar(ExprEvalStep *scratch, Var *variable,
@@ -230,6 +236,7 @@ ExecInitQual(List *qual, PlanState *parent)
 {
 	ExprState  *state;
 	ExprEvalStep scratch = {0};
+	ExprSetupInfo fetched = {0, 0, 0, 0, 0, NIL};
 	List	   *adjust_jumps = NIL;
 
 	/* short-circuit (here and in ExecQual) for empty restriction list */
@@ -246,9 +253,6 @@ ExecInitQual(List *qual, PlanState *parent)
 	/* mark expression as to be used with ExecQual() */
 	state->flags = EEO_FLAG_IS_QUAL;
 
-	/* Insert setup steps as needed */
-	ExecCreateExprSetupSteps(state, (Node *) qual);
-
 	/*
 	 * ExecQual() needs to return false for an expression returning NULL. That
 	 * allows us to short-circuit the evaluation the first time a NULL is
@@ -266,7 +270,19 @@ ExecInitQual(List *qual, PlanState *parent)
 
 	foreach_ptr(Expr, node, qual)
 	{
-		/* first evaluate expression */
+		ExprSetupInfo info = {0, 0, 0, 0, 0, NIL};
+
+		/*
+		 * Deform the input tuples only as far as this clause needs, rather
+		 * than as far as the whole qual needs.  When an early clause rejects
+		 * most rows, columns that only later clauses look at are then never
+		 * deformed for those rows.  Once a slot has been deformed far enough,
+		 * no more steps are needed for it.
+		 */
+		expr_setup_walker((Node *) node, &info);
+		ExecPushQualSetupSteps(state, &info, &fetched);
+
+		/* then evaluate expression */
 		ExecInitExprRec(node, state, &state->resvalue, &state->resnull);
 
 		/* then emit EEOP_QUAL to detect if it's false (or null) */
@@ -299,6 +315,198 @@ ExecInitQual(List *qual, PlanState *parent)
 	return state;
 }
 
+/*
+ * ExecInitQualBatch: prepare a qual for batched evaluation by ExecQualBatch
+ *
+ * The clauses of the implicit-AND qual list that ExecQualBatch() knows how
+ * to evaluate are collected into the returned ExprBatchQual, which can then
+ * be used for batches of up to maxrows rows.  All other clauses are returned
+ * in *residual, for the caller to evaluate row by row with ExecQual().  If
+ * no clause can be batched, NULL is returned and *residual is the whole qual.
+ *
+ * Only comparisons between a column of the scan tuple and a non-null
+ * constant using the int4, int8, float8 and date comparison functions are
+ * handled.  These are strict, leakproof and cannot fail, so it's okay that
+ * they're evaluated before the residual clauses, whatever the original
+ * order of the qual was.
+ */
+ExprBatchQual *
+ExecInitQualBatch(List *qual, int maxrows, List **residual)
+{
+	ExprBatchQual *bq;
+	ListCell   *lc;
+	int			nclauses = 0;
+
+	Assert(maxrows > 0);
+
+	*residual = NIL;
+
+	bq = palloc(offsetof(ExprBatchQual, clauses) +
+				list_length(qual) * sizeof(ExprBatchClause));
+
+	foreach(lc, qual)
+	{
+		Expr	   *node = (Expr *) lfirst(lc);
+		ExprBatchClause *clause = &bq->clauses[nclauses];
+
+		if (ExecInitQualBatchClause(node, clause))
+			nclauses++;
+		else
+			*residual = lappend(*residual, node);
+	}
+
+	if (nclauses == 0)
+	{
+		pfree(bq);
+		return NULL;
+	}
+
+	/*
+	 * ExecQualBatch() deforms each row only as far as the clause at hand
+	 * needs, and only while the row still matches.  Evaluating the clauses
+	 * in column order makes that as cheap as possible.
+	 */
+	qsort(bq->clauses, nclauses, sizeof(ExprBatchClause),
+		  batch_clause_attnum_cmp);
+
+	bq->nclauses = nclauses;
+	bq->maxrows = maxrows;
+	bq->values = palloc_array(Datum, maxrows);
+	bq->isnull = palloc_array(bool, maxrows);
+
+	return bq;
+}
+
+/* qsort comparator ordering ExprBatchClauses by column */
+static int
+batch_clause_attnum_cmp(const void *a, const void *b)
+{
+	const ExprBatchClause *ca = (const ExprBatchClause *) a;
+	const ExprBatchClause *cb = (const ExprBatchClause *) b;
+
+	return pg_cmp_s16(ca->attnum, cb->attnum);
+}
+
+/*
+ * Check whether a qual clause can be evaluated by ExecQualBatch(), and fill
+ * in *clause if so.
+ */
+static bool
+ExecInitQualBatchClause(Expr *node, ExprBatchClause *clause)
+{
+	OpExpr	   *opexpr;
+	Expr	   *leftop;
+	Expr	   *rightop;
+	Var		   *var;
+	Const	   *con;
+	bool		commuted;
+
+	if (!IsA(node, OpExpr))
+		return false;
+	opexpr = (OpExpr *) node;
+	if (list_length(opexpr->args) != 2)
+		return false;
+
+	leftop = (Expr *) linitial(opexpr->args);
+	rightop = (Expr *) lsecond(opexpr->args);
+
+	if (IsA(leftop, Var) && IsA(rightop, Const))
+	{
+		var = (Var *) leftop;
+		con = (Const *) rightop;
+		commuted = false;
+	}
+	else if (IsA(leftop, Const) && IsA(rightop, Var))
+	{
+		var = (Var *) rightop;
+		con = (Const *) leftop;
+		commuted = true;
+	}
+	else
+		return false;
+
+	/* must be a regular column of the scan tuple, see ExecInitExprRec() */
+	if (var->varno == INNER_VAR || var->varno == OUTER_VAR ||
+		var->varattno <= 0 || var->varlevelsup != 0 ||
+		var->varreturningtype != VAR_RETURNING_DEFAULT)
+		return false;
+
+	/* strict operator with a NULL input; leave that to ExecQual() */
+	if (con->constisnull)
+		return false;
+
+	switch (opexpr->opfuncid)
+	{
+		case F_INT4EQ:
+		case F_DATE_EQ:
+		case F_INT8EQ:
+		case F_FLOAT8EQ:
+			clause->op = EBOP_EQ;
+			break;
+		case F_INT4NE:
+		case F_DATE_NE:
+		case F_INT8NE:
+		case F_FLOAT8NE:
+			clause->op = EBOP_NE;
+			break;
+		case F_INT4LT:
+		case F_DATE_LT:
+		case F_INT8LT:
+		case F_FLOAT8LT:
+			clause->op = commuted ? EBOP_GT : EBOP_LT;
+			break;
+		case F_INT4LE:
+		case F_DATE_LE:
+		case F_INT8LE:
+		case F_FLOAT8LE:
+			clause->op = commuted ? EBOP_GE : EBOP_LE;
+			break;
+		case F_INT4GT:
+		case F_DATE_GT:
+		case F_INT8GT:
+		case F_FLOAT8GT:
+			clause->op = commuted ? EBOP_LT : EBOP_GT;
+			break;
+		case F_INT4GE:
+		case F_DATE_GE:
+		case F_INT8GE:
+		case F_FLOAT8GE:
+			clause->op = commuted ? EBOP_LE : EBOP_GE;
+			break;
+		default:
+			return false;
+	}
+
+	switch (opexpr->opfuncid)
+	{
+		case F_INT8EQ:
+		case F_INT8NE:
+		case F_INT8LT:
+		case F_INT8LE:
+		case F_INT8GT:
+		case F_INT8GE:
+			clause->type = EBTYPE_INT8;
+			break;
+		case F_FLOAT8EQ:
+		case F_FLOAT8NE:
+		case F_FLOAT8LT:
+		case F_FLOAT8LE:
+		case F_FLOAT8GT:
+		case F_FLOAT8GE:
+			clause->type = EBTYPE_FLOAT8;
+			break;
+		default:
+			/* DateADT is an int32, so date is compared like int4 */
+			clause->type = EBTYPE_INT4;
+			break;
+	}
+
+	clause->attnum = var->varattno;
+	clause->constval = con->constvalue;
+
+	return true;
+}
+
 /*
  * ExecInitCheck: prepare a check constraint for execution by ExecCheck
  *
@@ -901,6 +1109,19 @@ ExecCheck(ExprState *state, ExprContext *econtext)
 static void
 ExecReadyExpr(ExprState *state)
 {
+	/*
+	 * With jit_tier_up_calls set, start out interpreting the expression; the
+	 * interpreter compiles it once it has been evaluated often enough for
+	 * the compilation cost to pay off.  Expressions that are only evaluated
+	 * a few times, e.g. because the estimates were off, never get compiled.
+	 */
+	if (jit_tier_up_expr(state))
+	{
+		state->jit_calls_left = (uint32) jit_tier_up_calls;
+		ExecReadyInterpretedExpr(state);
+		return;
+	}
+
 	if (jit_compile_expr(state))
 		return;
 
@@ -2882,6 +3103,34 @@ ExecCreateExprSetupSteps(ExprState *state, Node *node)
 	ExecPushExprSetupSteps(state, &info);
 }
 
+/*
+ * Add the setup steps needed by one clause of a qual, given that the steps
+ * added for the preceding clauses have already deformed the slots as far as
+ * "fetched" says.  Updates "fetched" accordingly.
+ */
+static void
+ExecPushQualSetupSteps(ExprState *state, ExprSetupInfo *info,
+					   ExprSetupInfo *fetched)
+{
+#define QUAL_SETUP_SLOT(field) \
+	do { \
+		if (info->field <= fetched->field) \
+			info->field = 0; \
+		else \
+			fetched->field = info->field; \
+	} while (0)
+
+	QUAL_SETUP_SLOT(last_inner);
+	QUAL_SETUP_SLOT(last_outer);
+	QUAL_SETUP_SLOT(last_scan);
+	QUAL_SETUP_SLOT(last_old);
+	QUAL_SETUP_SLOT(last_new);
+
+#undef QUAL_SETUP_SLOT
+
+	ExecPushExprSetupSteps(state, info);
+}
+
 /*
  * Add steps performing expression setup as indicated by "info".
  * This is useful when building an ExprState covering more than one expression.
@@ -3906,7 +4155,8 @@ ExecBuildAggTrans(AggState *aggstate, AggStatePerPhase phase,
 		}
 
 		/* Handle DISTINCT aggregates which have pre-sorted input */
-		if (pertrans->numDistinctCols > 0 && !pertrans->aggsortrequired)
+		if (pertrans->numDistinctCols > 0 && !pertrans->aggsortrequired &&
+			!pertrans->aggdistincthash)
 		{
 			if (pertrans->numDistinctCols > 1)
 				scratch.opcode = EEOP_AGG_PRESORTED_DISTINCT_MULTI;
@@ -3932,10 +4182,31 @@ ExecBuildAggTrans(AggState *aggstate, AggStatePerPhase phase,
 
 			for (int setno = 0; setno < processGroupingSets; setno++)
 			{
+				int			distinctcheck = -1;
+
+				/*
+				 * For hashed DISTINCT aggregates, skip the transition
+				 * function if the input was already seen in this set's
+				 * group.
+				 */
+				if (pertrans->aggdistincthash)
+				{
+					scratch.opcode = EEOP_AGG_HASHED_DISTINCT;
+					scratch.d.agg_hashed_distinctcheck.pertrans = pertrans;
+					scratch.d.agg_hashed_distinctcheck.setno = setno;
+					scratch.d.agg_hashed_distinctcheck.jumpdistinct = -1;
+					ExprEvalPushStep(state, &scratch);
+					distinctcheck = state->steps_len - 1;
+				}
+
 				ExecBuildAggTransCall(state, aggstate, &scratch, trans_fcinfo,
 									  pertrans, transno, setno, setoff, false,
 									  nullcheck);
 				setoff++;
+
+				if (distinctcheck != -1)
+					state->steps[distinctcheck].d.agg_hashed_distinctcheck.jumpdistinct =
+						state->steps_len;
 			}
 		}
 
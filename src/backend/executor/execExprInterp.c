@@ -62,6 +62,7 @@
 #include "executor/execExpr.h"
 #include "executor/nodeSubplan.h"
 #include "funcapi.h"
+#include "jit/jit.h"
 #include "miscadmin.h"
 #include "nodes/miscnodes.h"
 #include "nodes/nodeFuncs.h"
@@ -71,6 +72,7 @@
 #include "utils/date.h"
 #include "utils/datum.h"
 #include "utils/expandedrecord.h"
+#include "utils/float.h"
 #include "utils/json.h"
 #include "utils/jsonfuncs.h"
 #include "utils/jsonpath.h"
@@ -142,6 +144,7 @@ static ExprEvalOpLookup reverse_dispatch_table[EEOP_LAST];
 
 
 static Datum ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull);
+static Datum ExecInterpExprTierUp(ExprState *state, ExprContext *econtext, bool *isnull);
 static void ExecInitInterpreter(void);
 
 /* support functions */
@@ -174,6 +177,18 @@ static Datum ExecJustHashInnerVar(ExprState *state, ExprContext *econtext, bool
 static Datum ExecJustHashOuterVarVirt(ExprState *state, ExprContext *econtext, bool *isnull);
 static Datum ExecJustHashInnerVarVirt(ExprState *state, ExprContext *econtext, bool *isnull);
 static Datum ExecJustHashOuterVarStrict(ExprState *state, ExprContext *econtext, bool *isnull);
+static Datum ExecJustScanVarFuncQual(ExprState *state, ExprContext *econtext, bool *isnull);
+static Datum ExecJustScanVarInt4EqQual(ExprState *state, ExprContext *econtext, bool *isnull);
+static Datum ExecJustScanVarInt8EqQual(ExprState *state, ExprContext *econtext, bool *isnull);
+static Datum ExecJustInnerVarFuncQual(ExprState *state, ExprContext *econtext, bool *isnull);
+static Datum ExecJustOuterVarFuncQual(ExprState *state, ExprContext *econtext, bool *isnull);
+static Datum ExecJustScanVarNotNullFuncQual(ExprState *state, ExprContext *econtext, bool *isnull);
+
+/* Is this opcode a call of a strict function without fusage tracking? */
+#define IsStrictFuncOp(opcode) \
+	((opcode) == EEOP_FUNCEXPR_STRICT || \
+	 (opcode) == EEOP_FUNCEXPR_STRICT_1 || \
+	 (opcode) == EEOP_FUNCEXPR_STRICT_2)
 
 /* execution helper functions */
 static pg_attribute_always_inline void ExecAggPlainTransByVal(AggState *aggstate,
@@ -280,7 +295,30 @@ ExecReadyInterpretedExpr(ExprState *state)
 	 * the full interpreter is a measurable overhead for these, and these
 	 * patterns occur often enough to be worth optimizing.
 	 */
-	if (state->steps_len == 5)
+	if (state->steps_len == 8)
+	{
+		ExprEvalOp	step0 = state->steps[0].opcode;
+		ExprEvalOp	step1 = state->steps[1].opcode;
+		ExprEvalOp	step2 = state->steps[2].opcode;
+		ExprEvalOp	step3 = state->steps[3].opcode;
+		ExprEvalOp	step4 = state->steps[4].opcode;
+		ExprEvalOp	step5 = state->steps[5].opcode;
+		ExprEvalOp	step6 = state->steps[6].opcode;
+
+		/* "Var IS NOT NULL AND strictfunc(Var, Consts...)" */
+		if (step0 == EEOP_SCAN_FETCHSOME &&
+			step1 == EEOP_SCAN_VAR &&
+			step2 == EEOP_NULLTEST_ISNOTNULL &&
+			step3 == EEOP_QUAL &&
+			step4 == EEOP_SCAN_VAR &&
+			IsStrictFuncOp(step5) &&
+			step6 == EEOP_QUAL)
+		{
+			state->evalfunc_private = ExecJustScanVarNotNullFuncQual;
+			return;
+		}
+	}
+	else if (state->steps_len == 5)
 	{
 		ExprEvalOp	step0 = state->steps[0].opcode;
 		ExprEvalOp	step1 = state->steps[1].opcode;
@@ -295,6 +333,42 @@ ExecReadyInterpretedExpr(ExprState *state)
 			state->evalfunc_private = (void *) ExecJustHashInnerVarWithIV;
 			return;
 		}
+		/* qual "strictfunc(Var, Consts...)", e.g. "Var op Const" */
+		else if (step0 == EEOP_SCAN_FETCHSOME &&
+				 step1 == EEOP_SCAN_VAR &&
+				 IsStrictFuncOp(step2) &&
+				 step3 == EEOP_QUAL)
+		{
+			PGFunction	fn_addr = state->steps[2].d.func.fn_addr;
+
+			/*
+			 * Equality on int4 and int8 is common enough, and cheap enough
+			 * compared to the function call, to be done inline.
+			 */
+			if (fn_addr == int4eq)
+				state->evalfunc_private = ExecJustScanVarInt4EqQual;
+			else if (fn_addr == int8eq)
+				state->evalfunc_private = ExecJustScanVarInt8EqQual;
+			else
+				state->evalfunc_private = ExecJustScanVarFuncQual;
+			return;
+		}
+		else if (step0 == EEOP_INNER_FETCHSOME &&
+				 step1 == EEOP_INNER_VAR &&
+				 IsStrictFuncOp(step2) &&
+				 step3 == EEOP_QUAL)
+		{
+			state->evalfunc_private = ExecJustInnerVarFuncQual;
+			return;
+		}
+		else if (step0 == EEOP_OUTER_FETCHSOME &&
+				 step1 == EEOP_OUTER_VAR &&
+				 IsStrictFuncOp(step2) &&
+				 step3 == EEOP_QUAL)
+		{
+			state->evalfunc_private = ExecJustOuterVarFuncQual;
+			return;
+		}
 	}
 	else if (state->steps_len == 4)
 	{
@@ -590,6 +664,7 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 		&&CASE_EEOP_AGG_PLAIN_TRANS_BYREF,
 		&&CASE_EEOP_AGG_PRESORTED_DISTINCT_SINGLE,
 		&&CASE_EEOP_AGG_PRESORTED_DISTINCT_MULTI,
+		&&CASE_EEOP_AGG_HASHED_DISTINCT,
 		&&CASE_EEOP_AGG_ORDERED_TRANS_DATUM,
 		&&CASE_EEOP_AGG_ORDERED_TRANS_TUPLE,
 		&&CASE_EEOP_LAST
@@ -2247,6 +2322,18 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 				EEO_JUMP(op->d.agg_presorted_distinctcheck.jumpdistinct);
 		}
 
+		EEO_CASE(EEOP_AGG_HASHED_DISTINCT)
+		{
+			AggState   *aggstate = castNode(AggState, state->parent);
+			AggStatePerTrans pertrans = op->d.agg_hashed_distinctcheck.pertrans;
+
+			if (ExecEvalAggHashedDistinct(aggstate, pertrans,
+										  op->d.agg_hashed_distinctcheck.setno))
+				EEO_NEXT();
+			else
+				EEO_JUMP(op->d.agg_hashed_distinctcheck.jumpdistinct);
+		}
+
 		/* process single-column ordered aggregate datum */
 		EEO_CASE(EEOP_AGG_ORDERED_TRANS_DATUM)
 		{
@@ -2278,6 +2365,150 @@ out_error:
 	return (Datum) 0;
 }
 
+/*
+ * Evaluate "test" for every row of the batch, combining the result into
+ * matches[].  NULL inputs never match, as all the batched operators are
+ * strict.  This is written without branches so that it can be vectorized.
+ */
+#define EVAL_BATCH_CLAUSE(test) \
+	do { \
+		for (int i = 0; i < nslots; i++) \
+			matches[i] &= !isnull[i] & (test); \
+	} while (0)
+
+/*
+ * ExecQualBatch: evaluate an ExprBatchQual for a batch of rows
+ *
+ * Sets matches[i] to whether slots[i] satisfies all the clauses of the
+ * batched qual.  Each clause is evaluated by gathering its column of the
+ * batch into a dense array, and then comparing all of it to the constant
+ * in a tight loop.
+ *
+ * Rows are deformed lazily, only as far as the clause at hand needs, and
+ * not at all anymore once an earlier clause has rejected them.  With wide
+ * rows and selective clauses on leading columns, most of each row is thus
+ * never deformed here.
+ */
+void
+ExecQualBatch(ExprBatchQual *bq, TupleTableSlot **slots, int nslots,
+			  bool *matches)
+{
+	Datum	   *values = bq->values;
+	bool	   *isnull = bq->isnull;
+
+	Assert(nslots <= bq->maxrows);
+
+	for (int i = 0; i < nslots; i++)
+		matches[i] = true;
+
+	for (int c = 0; c < bq->nclauses; c++)
+	{
+		ExprBatchClause *clause = &bq->clauses[c];
+		int			attno = clause->attnum - 1;
+
+		for (int i = 0; i < nslots; i++)
+		{
+			if (!matches[i])
+			{
+				/* already rejected, any non-matching input will do */
+				values[i] = (Datum) 0;
+				isnull[i] = true;
+				continue;
+			}
+
+			slot_getsomeattrs(slots[i], clause->attnum);
+			values[i] = slots[i]->tts_values[attno];
+			isnull[i] = slots[i]->tts_isnull[attno];
+		}
+
+		switch (clause->type)
+		{
+			case EBTYPE_INT4:
+				{
+					int32		cval = DatumGetInt32(clause->constval);
+
+					switch (clause->op)
+					{
+						case EBOP_EQ:
+							EVAL_BATCH_CLAUSE(DatumGetInt32(values[i]) == cval);
+							break;
+						case EBOP_NE:
+							EVAL_BATCH_CLAUSE(DatumGetInt32(values[i]) != cval);
+							break;
+						case EBOP_LT:
+							EVAL_BATCH_CLAUSE(DatumGetInt32(values[i]) < cval);
+							break;
+						case EBOP_LE:
+							EVAL_BATCH_CLAUSE(DatumGetInt32(values[i]) <= cval);
+							break;
+						case EBOP_GT:
+							EVAL_BATCH_CLAUSE(DatumGetInt32(values[i]) > cval);
+							break;
+						case EBOP_GE:
+							EVAL_BATCH_CLAUSE(DatumGetInt32(values[i]) >= cval);
+							break;
+					}
+				}
+				break;
+			case EBTYPE_INT8:
+				{
+					int64		cval = DatumGetInt64(clause->constval);
+
+					switch (clause->op)
+					{
+						case EBOP_EQ:
+							EVAL_BATCH_CLAUSE(DatumGetInt64(values[i]) == cval);
+							break;
+						case EBOP_NE:
+							EVAL_BATCH_CLAUSE(DatumGetInt64(values[i]) != cval);
+							break;
+						case EBOP_LT:
+							EVAL_BATCH_CLAUSE(DatumGetInt64(values[i]) < cval);
+							break;
+						case EBOP_LE:
+							EVAL_BATCH_CLAUSE(DatumGetInt64(values[i]) <= cval);
+							break;
+						case EBOP_GT:
+							EVAL_BATCH_CLAUSE(DatumGetInt64(values[i]) > cval);
+							break;
+						case EBOP_GE:
+							EVAL_BATCH_CLAUSE(DatumGetInt64(values[i]) >= cval);
+							break;
+					}
+				}
+				break;
+			case EBTYPE_FLOAT8:
+				{
+					float8		cval = DatumGetFloat8(clause->constval);
+
+					/* use the NaN-aware comparisons of float8eq() etc */
+					switch (clause->op)
+					{
+						case EBOP_EQ:
+							EVAL_BATCH_CLAUSE(float8_eq(DatumGetFloat8(values[i]), cval));
+							break;
+						case EBOP_NE:
+							EVAL_BATCH_CLAUSE(float8_ne(DatumGetFloat8(values[i]), cval));
+							break;
+						case EBOP_LT:
+							EVAL_BATCH_CLAUSE(float8_lt(DatumGetFloat8(values[i]), cval));
+							break;
+						case EBOP_LE:
+							EVAL_BATCH_CLAUSE(float8_le(DatumGetFloat8(values[i]), cval));
+							break;
+						case EBOP_GT:
+							EVAL_BATCH_CLAUSE(float8_gt(DatumGetFloat8(values[i]), cval));
+							break;
+						case EBOP_GE:
+							EVAL_BATCH_CLAUSE(float8_ge(DatumGetFloat8(values[i]), cval));
+							break;
+					}
+				}
+				break;
+		}
+	}
+}
+
 /*
  * Expression evaluation callback that performs extra checks before executing
  * the expression. Declared extern so other methods of execution can use it
@@ -2292,13 +2523,53 @@ ExecInterpExprStillValid(ExprState *state, ExprContext *econtext, bool *isNull)
 	 */
 	CheckExprStillValid(state, econtext);
 
-	/* skip the check during further executions */
-	state->evalfunc = (ExprStateEvalFunc) state->evalfunc_private;
+	/*
+	 * Skip the check during further executions.  If the expression is to be
+	 * JIT compiled once it turns out to be hot, count executions until then.
+	 */
+	if (state->jit_calls_left > 0)
+		state->evalfunc = ExecInterpExprTierUp;
+	else
+		state->evalfunc = (ExprStateEvalFunc) state->evalfunc_private;
 
 	/* and actually execute */
 	return state->evalfunc(state, econtext, isNull);
 }
 
+/*
+ * Expression evaluation callback for interpreted expressions that are to be
+ * JIT compiled after jit_tier_up_calls evaluations (see ExecReadyExpr()).
+ *
+ * The steps have been set up for interpretation by then, possibly including
+ * direct threading, but the JIT provider copes with that, as it looks at
+ * each step's opcode through ExecEvalStepOp().
+ */
+static Datum
+ExecInterpExprTierUp(ExprState *state, ExprContext *econtext, bool *isNull)
+{
+	if (--state->jit_calls_left == 0)
+	{
+		MemoryContext oldcontext;
+		bool		compiled;
+
+		/*
+		 * We're likely running in a short-lived context, but the compiled
+		 * expression's state has to live as long as the ExprState.
+		 */
+		oldcontext = MemoryContextSwitchTo(state->parent->state->es_query_cxt);
+		compiled = jit_compile_expr(state);
+		MemoryContextSwitchTo(oldcontext);
+
+		/* stay interpreted if the expression couldn't be compiled */
+		if (!compiled)
+			state->evalfunc = (ExprStateEvalFunc) state->evalfunc_private;
+
+		return state->evalfunc(state, econtext, isNull);
+	}
+
+	return ((ExprStateEvalFunc) state->evalfunc_private) (state, econtext, isNull);
+}
+
 /*
  * Check that an expression is still valid in the face of potential schema
  * changes since the plan has been created.
@@ -2541,6 +2812,123 @@ get_cached_rowtype(Oid type_id, int32 typmod,
  * Fast-path functions, for very simple expressions
  */
 
+/* implementation of ExecJust(Scan|Inner|Outer)Var*FuncQual */
+static pg_attribute_always_inline Datum
+ExecJustVarFuncQualImpl(ExprState *state, TupleTableSlot *slot, int varstep,
+						bool *isnull)
+{
+	ExprEvalStep *varop = &state->steps[varstep];
+	ExprEvalStep *funcop = &state->steps[varstep + 1];
+	FunctionCallInfo fcinfo = funcop->d.func.fcinfo_data;
+	NullableDatum *args = fcinfo->args;
+	int			nargs = funcop->d.func.nargs;
+	Datum		d;
+
+	CheckOpSlotCompatibility(&state->steps[0], slot);
+
+	/*
+	 * The Var step stores into one of the function's arguments; the others
+	 * are constants, filled in when the expression was compiled.  As in
+	 * ExecJustVarImpl, slot_getattr() takes care of the FETCHSOME step.
+	 */
+	*varop->resvalue = slot_getattr(slot, varop->d.var.attnum + 1,
+									varop->resnull);
+
+	/* A qual's result is never null; null counts as false */
+	*isnull = false;
+
+	/* strict function, so check for NULL args */
+	for (int argno = 0; argno < nargs; argno++)
+	{
+		if (args[argno].isnull)
+			return BoolGetDatum(false);
+	}
+	fcinfo->isnull = false;
+	d = funcop->d.func.fn_addr(fcinfo);
+	if (fcinfo->isnull)
+		return BoolGetDatum(false);
+	return BoolGetDatum(DatumGetBool(d));
+}
+
+/* Qual consisting of a strict function of a scan Var and constants */
+static Datum
+ExecJustScanVarFuncQual(ExprState *state, ExprContext *econtext, bool *isnull)
+{
+	return ExecJustVarFuncQualImpl(state, econtext->ecxt_scantuple, 1, isnull);
+}
+
+/* Qual consisting of a strict function of an inner Var and constants */
+static Datum
+ExecJustInnerVarFuncQual(ExprState *state, ExprContext *econtext, bool *isnull)
+{
+	return ExecJustVarFuncQualImpl(state, econtext->ecxt_innertuple, 1, isnull);
+}
+
+/* Qual consisting of a strict function of an outer Var and constants */
+static Datum
+ExecJustOuterVarFuncQual(ExprState *state, ExprContext *econtext, bool *isnull)
+{
+	return ExecJustVarFuncQualImpl(state, econtext->ecxt_outertuple, 1, isnull);
+}
+
+/* implementation of ExecJustScanVarInt(4|8)EqQual */
+static pg_attribute_always_inline Datum
+ExecJustScanVarEqQualImpl(ExprState *state, ExprContext *econtext,
+						  bool is_int8, bool *isnull)
+{
+	TupleTableSlot *slot = econtext->ecxt_scantuple;
+	ExprEvalStep *varop = &state->steps[1];
+	NullableDatum *args = state->steps[2].d.func.fcinfo_data->args;
+
+	CheckOpSlotCompatibility(&state->steps[0], slot);
+
+	*varop->resvalue = slot_getattr(slot, varop->d.var.attnum + 1,
+									varop->resnull);
+
+	*isnull = false;
+	if (args[0].isnull || args[1].isnull)
+		return BoolGetDatum(false);
+	if (is_int8)
+		return BoolGetDatum(DatumGetInt64(args[0].value) ==
+							DatumGetInt64(args[1].value));
+	return BoolGetDatum(DatumGetInt32(args[0].value) ==
+						DatumGetInt32(args[1].value));
+}
+
+/* Qual "scan Var = Const" (or "Const = scan Var") using int4eq */
+static Datum
+ExecJustScanVarInt4EqQual(ExprState *state, ExprContext *econtext, bool *isnull)
+{
+	return ExecJustScanVarEqQualImpl(state, econtext, false, isnull);
+}
+
+/* Qual "scan Var = Const" (or "Const = scan Var") using int8eq */
+static Datum
+ExecJustScanVarInt8EqQual(ExprState *state, ExprContext *econtext, bool *isnull)
+{
+	return ExecJustScanVarEqQualImpl(state, econtext, true, isnull);
+}
+
+/* Qual "scan Var IS NOT NULL AND strictfunc(scan Var, constants)" */
+static Datum
+ExecJustScanVarNotNullFuncQual(ExprState *state, ExprContext *econtext,
+							   bool *isnull)
+{
+	TupleTableSlot *slot = econtext->ecxt_scantuple;
+	bool		attisnull;
+
+	CheckOpSlotCompatibility(&state->steps[0], slot);
+
+	(void) slot_getattr(slot, state->steps[1].d.var.attnum + 1, &attisnull);
+	if (attisnull)
+	{
+		*isnull = false;
+		return BoolGetDatum(false);
+	}
+
+	return ExecJustVarFuncQualImpl(state, slot, 4, isnull);
+}
+
 /* implementation of ExecJust(Inner|Outer|Scan)Var */
 static pg_attribute_always_inline Datum
 ExecJustVarImpl(ExprState *state, TupleTableSlot *slot, bool *isnull)
@@ -5801,6 +6189,73 @@ ExecEvalPreOrderedDistinctMulti(AggState *aggstate, AggStatePerTrans pertrans)
 	return isdistinct;
 }
 
+/*
+ * ExecEvalAggHashedDistinct
+ *		Returns true when the aggregate input has not been seen before in the
+ *		current group of grouping set 'setno', so the transition function
+ *		should be called for it, and false otherwise.
+ *
+ * New inputs are remembered in the set's hash table.  Once that has grown
+ * beyond hash_mem, inputs not found in it are added to a sort instead, which
+ * finalize_aggregates() deduplicates and passes to the transition function
+ * at the end of the group; we return false for those, too.
+ */
+bool
+ExecEvalAggHashedDistinct(AggState *aggstate, AggStatePerTrans pertrans,
+						  int setno)
+{
+	TupleHashTable hashtable = pertrans->distincttables[setno];
+	TupleTableSlot *slot = pertrans->sortslot;
+	TupleHashEntry entry;
+	bool		isnew;
+
+	for (int i = 0; i < pertrans->numTransInputs; i++)
+	{
+		slot->tts_values[i] = pertrans->transfn_fcinfo->args[i + 1].value;
+		slot->tts_isnull[i] = pertrans->transfn_fcinfo->args[i + 1].isnull;
+	}
+
+	ExecClearTuple(slot);
+	slot->tts_nvalid = pertrans->numInputs;
+	ExecStoreVirtualTuple(slot);
+
+	if (!pertrans->distinctfull[setno])
+	{
+		entry = LookupTupleHashEntry(hashtable, slot, &isnew, NULL);
+		if (!isnew)
+			return false;
+
+		if (MemoryContextMemAllocated(hashtable->tuplescxt, true) +
+			hashtable->hashtab->size * sizeof(TupleHashEntryData) >
+			get_hash_memory_limit())
+			pertrans->distinctfull[setno] = true;
+
+		return true;
+	}
+
+	/* The table is full; is it a value we saw before that happened? */
+	entry = LookupTupleHashEntry(hashtable, slot, NULL, NULL);
+	if (entry != NULL)
+		return false;
+
+	if (pertrans->sortstates[setno] == NULL)
+	{
+		MemoryContext oldContext;
+
+		oldContext = MemoryContextSwitchTo(aggstate->ss.ps.state->es_query_cxt);
+		agg_begin_input_sort(pertrans, setno);
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	if (pertrans->numInputs == 1)
+		tuplesort_putdatum(pertrans->sortstates[setno],
+						   slot->tts_values[0], slot->tts_isnull[0]);
+	else
+		tuplesort_puttupleslot(pertrans->sortstates[setno], slot);
+
+	return false;
+}
+
 /*
  * Invoke ordered transition function, with a datum argument.
  */
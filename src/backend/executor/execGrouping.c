@@ -21,6 +21,7 @@
 #include "common/hashfn.h"
 #include "executor/executor.h"
 #include "miscadmin.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 
 static int	TupleHashTableMatch(struct tuplehash_hash *tb, MinimalTuple tuple1, MinimalTuple tuple2);
@@ -86,6 +87,38 @@ execTuplesMatchPrepare(TupleDesc desc,
 	return expr;
 }
 
+/* GUC parameter */
+bool		fast_hash_functions = false;
+
+/*
+ * ExecInMemoryHashFunction
+ *		Return the function to use in place of the given hash support function
+ *		for a hash table that lives only in memory for the duration of a query.
+ *
+ * With fast_hash_functions enabled, the hash functions of text and bytea,
+ * whose values must stay the same forever because hash indexes and hash
+ * partitioning store them, are replaced by equivalents that use the faster
+ * hash_bytes_fast().  The caller must use the result for every value that
+ * goes into or is looked up in the hash table, including in other processes
+ * of a parallel query, which inherit the setting from the leader.
+ */
+Oid
+ExecInMemoryHashFunction(Oid hashfn)
+{
+	if (!fast_hash_functions)
+		return hashfn;
+
+	switch (hashfn)
+	{
+		case F_HASHTEXT:
+			return F_HASHTEXTFAST;
+		case F_HASHBYTEA:
+			return F_HASHBYTEAFAST;
+		default:
+			return hashfn;
+	}
+}
+
 /*
  * execTuplesHashPrepare
  *		Look up the equality and hashing functions needed for a TupleHashTable.
@@ -122,7 +155,8 @@ execTuplesHashPrepare(int numCols,
 		/* We're not supporting cross-type cases here */
 		Assert(left_hash_function == right_hash_function);
 		(*eqFuncOids)[i] = eq_function;
-		fmgr_info(right_hash_function, &(*hashFunctions)[i]);
+		fmgr_info(ExecInMemoryHashFunction(right_hash_function),
+				  &(*hashFunctions)[i]);
 	}
 }
 
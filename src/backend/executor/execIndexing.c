@@ -7,7 +7,9 @@
  * ExecInsertIndexTuples() is the main entry point.  It's called after
  * inserting a tuple to the heap, and it inserts corresponding index tuples
  * into all indexes.  At the same time, it enforces any unique and
- * exclusion constraints:
+ * exclusion constraints.  Callers that insert many heap tuples at once (COPY)
+ * can instead use ExecInsertIndexTuplesBatch() followed by
+ * ExecInsertIndexTuplesUnbatched() for each tuple; see those.
  *
  * Unique Indexes
  * --------------
@@ -110,11 +112,16 @@
 #include "access/relscan.h"
 #include "access/tableam.h"
 #include "access/xact.h"
+#include "catalog/globaltemp.h"
 #include "catalog/index.h"
+#include "catalog/indexcapture.h"
 #include "executor/executor.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
 #include "storage/lmgr.h"
+#include "utils/datum.h"
 #include "utils/injection_point.h"
+#include "utils/lsyscache.h"
 #include "utils/multirangetypes.h"
 #include "utils/rangetypes.h"
 #include "utils/snapmgr.h"
@@ -139,6 +146,18 @@ static bool check_exclusion_or_unique_constraint(Relation heap, Relation index,
 static bool index_recheck_constraint(Relation index, const Oid *constr_procs,
 									 const Datum *existing_values, const bool *existing_isnull,
 									 const Datum *new_values);
+static List *ExecInsertIndexTuplesInternal(ResultRelInfo *resultRelInfo,
+										   TupleTableSlot *slot, EState *estate,
+										   bool update,
+										   bool noDupErr,
+										   bool *specConflict,
+										   List *arbiterIndexes,
+										   bool onlySummarizing,
+										   bool skipBatchable);
+static bool index_batch_insertable(ResultRelInfo *resultRelInfo,
+								   EState *estate, bool update,
+								   Relation indexRelation,
+								   IndexInfo *indexInfo);
 static bool index_unchanged_by_update(ResultRelInfo *resultRelInfo,
 									  EState *estate, IndexInfo *indexInfo,
 									  Relation indexRelation);
@@ -211,6 +230,14 @@ ExecOpenIndices(ResultRelInfo *resultRelInfo, bool speculative)
 
 		indexDesc = index_open(indexOid, RowExclusiveLock);
 
+		/*
+		 * Build this session's copy of a global temporary index now, before
+		 * we insert into the table, rather than in index_insert(), which
+		 * would then find the new tuple already in the index.
+		 */
+		if (RelationIsGlobalTemp(indexDesc))
+			GlobalTempRelationInitStorage(indexDesc);
+
 		/* extract index key information from the index's pg_index info */
 		ii = BuildIndexInfo(indexDesc);
 
@@ -315,6 +342,151 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 					  bool *specConflict,
 					  List *arbiterIndexes,
 					  bool onlySummarizing)
+{
+	return ExecInsertIndexTuplesInternal(resultRelInfo, slot, estate,
+										 update, noDupErr, specConflict,
+										 arbiterIndexes, onlySummarizing,
+										 false);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInsertIndexTuplesBatch
+ *
+ *		Insert index tuples for a batch of newly inserted heap
+ *		tuples, into those indexes that can take them as a batch:
+ *		their AM provides aminsertbatch, and they enforce no unique
+ *		or exclusion constraint.  The AM can then sort the batch
+ *		and insert it in index order, which is much cheaper than
+ *		doing one random descent of the index per heap tuple.
+ *
+ *		The caller must then call ExecInsertIndexTuplesUnbatched()
+ *		for each slot to take care of the remaining indexes.  Since
+ *		batchable indexes never need a recheck, nothing is returned.
+ *
+ *		'update' is as for ExecInsertIndexTuples().  Indexes that
+ *		would get the 'indexUnchanged' hint are not batched, since
+ *		the hint matters for them.
+ * ----------------------------------------------------------------
+ */
+void
+ExecInsertIndexTuplesBatch(ResultRelInfo *resultRelInfo,
+						   TupleTableSlot **slots,
+						   int nslots,
+						   EState *estate,
+						   bool update)
+{
+	int			numIndices = resultRelInfo->ri_NumIndices;
+	RelationPtr relationDescs = resultRelInfo->ri_IndexRelationDescs;
+	IndexInfo **indexInfoArray = resultRelInfo->ri_IndexRelationInfo;
+	Relation	heapRelation = resultRelInfo->ri_RelationDesc;
+	ExprContext *econtext;
+	MemoryContext oldcontext;
+
+	/*
+	 * As in ExecInsertIndexTuples(), use the per-tuple context for
+	 * evaluating predicates and index expressions.  The caller must not reset
+	 * it while the batch is in progress, since all the index values of the
+	 * batch are kept until the AM is called.
+	 */
+	econtext = GetPerTupleExprContext(estate);
+	oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	for (int i = 0; i < numIndices; i++)
+	{
+		Relation	indexRelation = relationDescs[i];
+		IndexInfo  *indexInfo;
+		int			natts;
+		Datum	   *values;
+		bool	   *isnull;
+		ItemPointer tids;
+		int			ntuples = 0;
+
+		if (indexRelation == NULL)
+			continue;
+
+		indexInfo = indexInfoArray[i];
+
+		if (!indexInfo->ii_ReadyForInserts ||
+			!index_batch_insertable(resultRelInfo, estate, update,
+									indexRelation, indexInfo))
+			continue;
+
+		natts = IndexRelationGetNumberOfAttributes(indexRelation);
+		values = palloc_array(Datum, nslots * natts);
+		isnull = palloc_array(bool, nslots * natts);
+		tids = palloc_array(ItemPointerData, nslots);
+
+		for (int j = 0; j < nslots; j++)
+		{
+			TupleTableSlot *slot = slots[j];
+
+			Assert(ItemPointerIsValid(&slot->tts_tid));
+			Assert(slot->tts_tableOid == RelationGetRelid(heapRelation));
+
+			econtext->ecxt_scantuple = slot;
+
+			/* Check for partial index */
+			if (indexInfo->ii_Predicate != NIL)
+			{
+				if (indexInfo->ii_PredicateState == NULL)
+					indexInfo->ii_PredicateState =
+						ExecPrepareQual(indexInfo->ii_Predicate, estate);
+
+				if (!ExecQual(indexInfo->ii_PredicateState, econtext))
+					continue;
+			}
+
+			FormIndexDatum(indexInfo,
+						   slot,
+						   estate,
+						   values + ntuples * natts,
+						   isnull + ntuples * natts);
+			tids[ntuples] = slot->tts_tid;
+			ntuples++;
+		}
+
+		if (ntuples > 0)
+			index_insert_batch(indexRelation, ntuples, values, isnull, tids,
+							   heapRelation, indexInfo);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInsertIndexTuplesUnbatched
+ *
+ *		Counterpart of ExecInsertIndexTuplesBatch(): insert index
+ *		tuples for one heap tuple of the batch into the indexes it
+ *		skipped.  The result is as for ExecInsertIndexTuples().
+ * ----------------------------------------------------------------
+ */
+List *
+ExecInsertIndexTuplesUnbatched(ResultRelInfo *resultRelInfo,
+							   TupleTableSlot *slot,
+							   EState *estate,
+							   bool update)
+{
+	return ExecInsertIndexTuplesInternal(resultRelInfo, slot, estate,
+										 update, false, NULL, NIL, false,
+										 true);
+}
+
+/*
+ * Workhorse for ExecInsertIndexTuples() and ExecInsertIndexTuplesUnbatched().
+ * If skipBatchable is true, indexes that ExecInsertIndexTuplesBatch() handles
+ * are skipped.
+ */
+static List *
+ExecInsertIndexTuplesInternal(ResultRelInfo *resultRelInfo,
+							  TupleTableSlot *slot,
+							  EState *estate,
+							  bool update,
+							  bool noDupErr,
+							  bool *specConflict,
+							  List *arbiterIndexes,
+							  bool onlySummarizing,
+							  bool skipBatchable)
 {
 	ItemPointer tupleid = &slot->tts_tid;
 	List	   *result = NIL;
@@ -366,9 +538,20 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 
 		indexInfo = indexInfoArray[i];
 
-		/* If the index is marked as read-only, ignore it */
+		/*
+		 * If the index is marked as read-only, ignore it.  If it's still
+		 * being built by CREATE INDEX CONCURRENTLY, though, remember the new
+		 * tuple so that the build doesn't have to look for it in the whole
+		 * table.  (A tuple that only needs summarizing indexes updated is
+		 * the continuation of an existing HOT chain, which the build will
+		 * find through its root.)
+		 */
 		if (!indexInfo->ii_ReadyForInserts)
+		{
+			if (!onlySummarizing)
+				IndexCaptureRecord(RelationGetRelid(indexRelation), tupleid);
 			continue;
+		}
 
 		/*
 		 * Skip processing of non-summarizing indexes if we only update
@@ -377,6 +560,12 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 		if (onlySummarizing && !indexInfo->ii_Summarizing)
 			continue;
 
+		/* Skip indexes already handled by ExecInsertIndexTuplesBatch */
+		if (skipBatchable &&
+			index_batch_insertable(resultRelInfo, estate, update,
+								   indexRelation, indexInfo))
+			continue;
+
 		/* Check for partial index */
 		if (indexInfo->ii_Predicate != NIL)
 		{
@@ -518,6 +707,21 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 	return result;
 }
 
+/*
+ * Can ExecInsertIndexTuplesBatch() insert into this index?
+ */
+static bool
+index_batch_insertable(ResultRelInfo *resultRelInfo, EState *estate,
+					   bool update, Relation indexRelation,
+					   IndexInfo *indexInfo)
+{
+	return indexRelation->rd_indam->aminsertbatch != NULL &&
+		!indexRelation->rd_index->indisunique &&
+		indexInfo->ii_ExclusionOps == NULL &&
+		!(update && index_unchanged_by_update(resultRelInfo, estate,
+											  indexInfo, indexRelation));
+}
+
 /* ----------------------------------------------------------------
  *		ExecCheckIndexConstraints
  *
@@ -1115,6 +1319,143 @@ index_unchanged_by_update(ResultRelInfo *resultRelInfo, EState *estate,
 	return true;
 }
 
+/*
+ * ExecGetHotExemptAttrs -- find columns whose modification by an UPDATE
+ *		doesn't change any index key
+ *
+ * A HOT update is ruled out as soon as any column referenced by an index is
+ * modified.  For columns that are only referenced inside index expressions
+ * that is often too strict, since the value of the expression, which is what
+ * the index stores, may well stay the same; think of an index on one field of
+ * a jsonb document while other fields are updated.  Here we evaluate the
+ * expressions of such indexes for the old and new versions of the row, and
+ * return the set of columns, offset by FirstLowInvalidHeapAttributeNumber,
+ * that are referenced only by index expressions whose values are unchanged.
+ * The table AM may disregard modifications of those columns when deciding
+ * whether new index entries are needed.
+ *
+ * 'oldslot' must hold the row version stored at the TID being updated.
+ * Returns NULL if no column can be exempted.  The result is allocated in the
+ * per-tuple memory context.
+ */
+Bitmapset *
+ExecGetHotExemptAttrs(ResultRelInfo *resultRelInfo, TupleTableSlot *oldslot,
+					  TupleTableSlot *newslot, EState *estate)
+{
+	Bitmapset  *updatedCols;
+	Bitmapset  *exempt = NULL;
+	Bitmapset  *blocking = NULL;
+	ExprContext *econtext;
+	MemoryContext oldcxt;
+	bool		hasexpression = false;
+
+	/* Nothing to do unless some HOT-blocking index has expressions */
+	for (int i = 0; i < resultRelInfo->ri_NumIndices; i++)
+	{
+		IndexInfo  *indexInfo = resultRelInfo->ri_IndexRelationInfo[i];
+
+		if (indexInfo->ii_Expressions != NIL && !indexInfo->ii_Summarizing)
+		{
+			hasexpression = true;
+			break;
+		}
+	}
+	if (!hasexpression)
+		return NULL;
+
+	updatedCols = ExecGetAllUpdatedCols(resultRelInfo, estate);
+	econtext = GetPerTupleExprContext(estate);
+	oldcxt = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+
+	for (int i = 0; i < resultRelInfo->ri_NumIndices; i++)
+	{
+		IndexInfo  *indexInfo = resultRelInfo->ri_IndexRelationInfo[i];
+		Bitmapset  *exprattrs = NULL;
+		Datum		oldvalues[INDEX_MAX_KEYS];
+		bool		oldisnull[INDEX_MAX_KEYS];
+		Datum		newvalues[INDEX_MAX_KEYS];
+		bool		newisnull[INDEX_MAX_KEYS];
+		ListCell   *indexpr_item;
+		bool		unchanged = true;
+
+		/* Summarizing indexes never block HOT updates */
+		if (indexInfo->ii_Summarizing)
+			continue;
+
+		/* Changes to plain columns and predicate columns always count */
+		for (int attr = 0; attr < indexInfo->ii_NumIndexAttrs; attr++)
+		{
+			int			keycol = indexInfo->ii_IndexAttrNumbers[attr];
+
+			if (keycol > 0)
+				blocking = bms_add_member(blocking,
+										  keycol - FirstLowInvalidHeapAttributeNumber);
+		}
+		pull_varattnos((Node *) indexInfo->ii_Predicate, 1, &blocking);
+
+		if (indexInfo->ii_Expressions == NIL)
+			continue;
+		pull_varattnos((Node *) indexInfo->ii_Expressions, 1, &exprattrs);
+
+		/*
+		 * Don't bother evaluating the expressions if none of their columns is
+		 * a target of the UPDATE.  A BEFORE trigger might still have changed
+		 * them, so treat them as blocking, which is always safe.
+		 */
+		if (!bms_overlap(exprattrs, updatedCols))
+		{
+			blocking = bms_add_members(blocking, exprattrs);
+			continue;
+		}
+
+		econtext->ecxt_scantuple = oldslot;
+		FormIndexDatum(indexInfo, oldslot, estate, oldvalues, oldisnull);
+		econtext->ecxt_scantuple = newslot;
+		FormIndexDatum(indexInfo, newslot, estate, newvalues, newisnull);
+
+		indexpr_item = list_head(indexInfo->ii_Expressions);
+		for (int attr = 0; attr < indexInfo->ii_NumIndexAttrs; attr++)
+		{
+			Node	   *expr;
+			int16		typlen;
+			bool		typbyval;
+
+			if (indexInfo->ii_IndexAttrNumbers[attr] != 0)
+				continue;
+
+			expr = (Node *) lfirst(indexpr_item);
+			indexpr_item = lnext(indexInfo->ii_Expressions, indexpr_item);
+
+			if (oldisnull[attr] != newisnull[attr])
+			{
+				unchanged = false;
+				break;
+			}
+			if (oldisnull[attr])
+				continue;
+
+			get_typlenbyval(exprType(expr), &typlen, &typbyval);
+			if (!datumIsEqual(oldvalues[attr], newvalues[attr],
+							  typbyval, typlen))
+			{
+				unchanged = false;
+				break;
+			}
+		}
+
+		if (unchanged)
+			exempt = bms_add_members(exempt, exprattrs);
+		else
+			blocking = bms_add_members(blocking, exprattrs);
+	}
+
+	exempt = bms_del_members(exempt, blocking);
+
+	MemoryContextSwitchTo(oldcxt);
+
+	return exempt;
+}
+
 /*
  * Indexed expression helper for index_unchanged_by_update().
  *
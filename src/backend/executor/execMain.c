@@ -37,6 +37,8 @@
  */
 #include "postgres.h"
 
+#include "access/detoast.h"
+#include "access/genam.h"
 #include "access/sysattr.h"
 #include "access/table.h"
 #include "access/tableam.h"
@@ -49,17 +51,21 @@
 #include "executor/execPartition.h"
 #include "executor/nodeSubplan.h"
 #include "foreign/fdwapi.h"
+#include "jit/jit.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
 #include "nodes/queryjumble.h"
 #include "parser/parse_relation.h"
 #include "pgstat.h"
 #include "rewrite/rewriteHandler.h"
+#include "storage/bufmgr.h"
 #include "tcop/utility.h"
 #include "utils/acl.h"
 #include "utils/backend_status.h"
 #include "utils/lsyscache.h"
 #include "utils/partcache.h"
+#include "utils/plancache.h"
 #include "utils/rls.h"
 #include "utils/snapmgr.h"
 
@@ -73,6 +79,9 @@ ExecutorEnd_hook_type ExecutorEnd_hook = NULL;
 /* Hook for plugin to get control in ExecCheckPermissions() */
 ExecutorCheckPerms_hook_type ExecutorCheckPerms_hook = NULL;
 
+/* GUC parameter */
+bool		executor_state_reuse = false;
+
 /* decls for local routines only used within this module */
 static void InitPlan(QueryDesc *queryDesc, int eflags);
 static void CheckValidRowMarkRel(Relation rel, RowMarkType markType);
@@ -88,6 +97,8 @@ static bool ExecCheckPermissionsModified(Oid relOid, Oid userid,
 										 Bitmapset *modifiedCols,
 										 AclMode requiredPerms);
 static void ExecCheckXactReadOnly(PlannedStmt *plannedstmt);
+static bool ExecKeepCachedState(QueryDesc *queryDesc);
+static bool ExecReuseCachedState(QueryDesc *queryDesc, int eflags);
 static void EvalPlanQualStart(EPQState *epqstate, Plan *planTree);
 static void ReportNotNullViolationError(ResultRelInfo *resultRelInfo,
 										TupleTableSlot *slot,
@@ -169,6 +180,14 @@ standard_ExecutorStart(QueryDesc *queryDesc, int eflags)
 		!(eflags & EXEC_FLAG_EXPLAIN_ONLY))
 		ExecCheckXactReadOnly(queryDesc->plannedstmt);
 
+	/*
+	 * If a previous execution of the same cached plan left its state behind,
+	 * try to use that rather than building a new one.
+	 */
+	if (queryDesc->cplan != NULL && queryDesc->cplan->execstate != NULL &&
+		ExecReuseCachedState(queryDesc, eflags))
+		return;
+
 	/*
 	 * Build EState, switch into per-query memory context for startup.
 	 */
@@ -312,6 +331,7 @@ standard_ExecutorRun(QueryDesc *queryDesc,
 	DestReceiver *dest;
 	bool		sendTuples;
 	MemoryContext oldcontext;
+	DetoastCache *save_detoast_cache;
 
 	/* sanity checks */
 	Assert(queryDesc != NULL);
@@ -333,6 +353,17 @@ standard_ExecutorRun(QueryDesc *queryDesc,
 	if (queryDesc->totaltime)
 		InstrStartNode(queryDesc->totaltime);
 
+	/*
+	 * Detoast each out-of-line value only once, however many times the query
+	 * refers to it.  The cache lives as long as the query, across ExecutorRun
+	 * calls, but it's only active within them, since other queries may run
+	 * in between.
+	 */
+	if (estate->es_detoast_cache == NULL)
+		estate->es_detoast_cache = detoast_cache_create(estate->es_query_cxt,
+														(Size) work_mem * 1024);
+	save_detoast_cache = detoast_cache_activate(estate->es_detoast_cache);
+
 	/*
 	 * extract information from the query descriptor and the query feature.
 	 */
@@ -382,6 +413,8 @@ standard_ExecutorRun(QueryDesc *queryDesc,
 	if (sendTuples)
 		dest->rShutdown(dest);
 
+	detoast_cache_activate(save_detoast_cache);
+
 	if (queryDesc->totaltime)
 		InstrStopNode(queryDesc->totaltime, estate->es_processed);
 
@@ -496,6 +529,19 @@ standard_ExecutorEnd(QueryDesc *queryDesc)
 	Assert(estate->es_finished ||
 		   (estate->es_top_eflags & EXEC_FLAG_EXPLAIN_ONLY));
 
+	/*
+	 * Keep the state in the cached plan for its next execution, if possible.
+	 * Otherwise shut it down as usual.
+	 */
+	if (ExecKeepCachedState(queryDesc))
+	{
+		queryDesc->tupDesc = NULL;
+		queryDesc->estate = NULL;
+		queryDesc->planstate = NULL;
+		queryDesc->totaltime = NULL;
+		return;
+	}
+
 	/*
 	 * Switch into per-query memory context to run ExecEndPlan
 	 */
@@ -562,6 +608,422 @@ ExecutorRewind(QueryDesc *queryDesc)
 }
 
 
+/* ----------------------------------------------------------------
+ *		Reuse of executor state
+ *
+ *		Building the PlanState tree can take a good part of the time spent
+ *		on a simple statement, such as a lookup by primary key.  When a
+ *		statement runs from a generic cached plan, and executor_state_reuse
+ *		is enabled, ExecutorEnd doesn't destroy the executor state but keeps
+ *		it in the CachedPlan, and the next ExecutorStart for the same plan
+ *		resets it with ExecReScan instead of building a new one.
+ *
+ *		Between executions, the state holds no resources other than memory:
+ *		scans are ended, relations closed, slots emptied and their tuple
+ *		descriptors unpinned, and snapshots unregistered.  All of that is
+ *		acquired again when the state is taken back, and it's thrown away if
+ *		the relcache entries it refers to have been rebuilt in the meantime.
+ *		Any invalidation that could change the plan itself invalidates the
+ *		CachedPlan, and with it the state.
+ *
+ *		To keep this manageable, only SELECTs whose plans consist of simple
+ *		scans, Result and Limit nodes are handled.
+ * ----------------------------------------------------------------
+ */
+
+typedef struct CachedExecState
+{
+	PlannedStmt *plannedstmt;	/* statement the state was built for */
+	int			eflags;			/* es_top_eflags of the state */
+	EState	   *estate;
+	PlanState  *planstate;
+	TupleDesc	tupDesc;		/* result descriptor from InitPlan */
+	TupleDesc  *reldescs;		/* rd_att of each of es_relations */
+	Size		memsize;		/* size of es_query_cxt when first kept */
+} CachedExecState;
+
+/*
+ * Can the state of this plan tree be kept for reuse?
+ */
+static bool
+ExecPlanStateReusable(Plan *plan)
+{
+	if (plan == NULL)
+		return true;
+
+	if (plan->initPlan != NIL)
+		return false;
+
+	switch (nodeTag(plan))
+	{
+		case T_SeqScan:
+		case T_IndexOnlyScan:
+		case T_Result:
+		case T_Limit:
+			break;
+		case T_IndexScan:
+			/* avoid having to deal with the reorder queue */
+			if (((IndexScan *) plan)->indexorderby != NIL)
+				return false;
+			break;
+		default:
+			return false;
+	}
+
+	return ExecPlanStateReusable(plan->lefttree) &&
+		ExecPlanStateReusable(plan->righttree);
+}
+
+/*
+ * Can the state of this query be kept for reuse, as far as the QueryDesc
+ * and the statement are concerned?
+ */
+static bool
+ExecQueryStateReusable(QueryDesc *queryDesc)
+{
+	CachedPlan *cplan = queryDesc->cplan;
+	PlannedStmt *plannedstmt = queryDesc->plannedstmt;
+
+	if (!executor_state_reuse || cplan == NULL)
+		return false;
+
+	/* The state lives in the plan's context, so it must be a saved one */
+	if (!cplan->is_saved || !cplan->is_valid ||
+		plannedstmt->planOrigin != PLAN_STMT_CACHE_GENERIC)
+		return false;
+
+	if (queryDesc->operation != CMD_SELECT ||
+		queryDesc->instrument_options != 0 ||
+		queryDesc->queryEnv != NULL)
+		return false;
+
+	/* Params compiled into the expressions would go stale */
+	if (queryDesc->params != NULL && queryDesc->params->paramCompile != NULL)
+		return false;
+
+	if (plannedstmt->rowMarks != NIL ||
+		plannedstmt->hasModifyingCTE ||
+		plannedstmt->subplans != NIL ||
+		plannedstmt->paramExecTypes != NIL ||
+		plannedstmt->partPruneInfos != NIL ||
+		plannedstmt->parallelModeNeeded ||
+		plannedstmt->jitFlags != PGJIT_NONE)
+		return false;
+
+	return ExecPlanStateReusable(plannedstmt->planTree);
+}
+
+/*
+ * Release the resources held by the nodes of a plan state tree that is to
+ * be kept, or thrown away after failing to take it back.
+ */
+static bool
+ExecReleaseCachedPlanState(PlanState *planstate, void *context)
+{
+	switch (nodeTag(planstate))
+	{
+		case T_SeqScanState:
+			{
+				SeqScanState *node = (SeqScanState *) planstate;
+
+				if (node->ss.ss_currentScanDesc != NULL)
+					table_endscan(node->ss.ss_currentScanDesc);
+				node->ss.ss_currentScanDesc = NULL;
+			}
+			break;
+		case T_IndexScanState:
+			{
+				IndexScanState *node = (IndexScanState *) planstate;
+
+				if (node->iss_ScanDesc != NULL)
+					index_endscan(node->iss_ScanDesc);
+				node->iss_ScanDesc = NULL;
+				index_close(node->iss_RelationDesc, NoLock);
+			}
+			break;
+		case T_IndexOnlyScanState:
+			{
+				IndexOnlyScanState *node = (IndexOnlyScanState *) planstate;
+
+				if (node->ioss_VMBuffer != InvalidBuffer)
+					ReleaseBuffer(node->ioss_VMBuffer);
+				node->ioss_VMBuffer = InvalidBuffer;
+				if (node->ioss_ScanDesc != NULL)
+					index_endscan(node->ioss_ScanDesc);
+				node->ioss_ScanDesc = NULL;
+				index_close(node->ioss_RelationDesc, NoLock);
+			}
+			break;
+		default:
+			break;
+	}
+
+	return planstate_tree_walker(planstate, ExecReleaseCachedPlanState,
+								 context);
+}
+
+/*
+ * Reopen the indexes of a plan state tree being taken back, and clear
+ * *valid if any of them isn't the same relcache entry as before.
+ */
+static bool
+ExecReopenCachedPlanState(PlanState *planstate, bool *valid)
+{
+	Relation   *indexrel = NULL;
+	Oid			indexid = InvalidOid;
+
+	switch (nodeTag(planstate))
+	{
+		case T_IndexScanState:
+			indexrel = &((IndexScanState *) planstate)->iss_RelationDesc;
+			indexid = ((IndexScan *) planstate->plan)->indexid;
+			break;
+		case T_IndexOnlyScanState:
+			indexrel = &((IndexOnlyScanState *) planstate)->ioss_RelationDesc;
+			indexid = ((IndexOnlyScan *) planstate->plan)->indexid;
+			break;
+		default:
+			break;
+	}
+
+	if (indexrel != NULL)
+	{
+		Index		scanrelid = ((Scan *) planstate->plan)->scanrelid;
+		LOCKMODE	lockmode;
+		Relation	rel;
+
+		/* same lock as ExecInitIndexScan takes */
+		lockmode = exec_rt_fetch(scanrelid, planstate->state)->rellockmode;
+		rel = index_open(indexid, lockmode);
+		if (rel != *indexrel)
+			*valid = false;
+		*indexrel = rel;
+	}
+
+	return planstate_tree_walker(planstate, ExecReopenCachedPlanState, valid);
+}
+
+/*
+ * ExecKeepCachedState
+ *
+ * Called by ExecutorEnd instead of ExecEndPlan.  If the query's state can be
+ * reused, release its resources and hand it over to the cached plan, and
+ * return true.  Otherwise return false, and the state is to be destroyed as
+ * usual.
+ */
+static bool
+ExecKeepCachedState(QueryDesc *queryDesc)
+{
+	CachedPlan *cplan = queryDesc->cplan;
+	EState	   *estate = queryDesc->estate;
+	CachedExecState *cstate = estate->es_cached_state;
+	MemoryContext oldcontext;
+	Size		memsize;
+	ListCell   *lc;
+
+	/*
+	 * Another execution of the same plan may already have left its state
+	 * there.  Don't bother during abort, either.
+	 */
+	if (cplan == NULL || cplan->execstate != NULL || !IsTransactionState())
+		return false;
+
+	if (!ExecQueryStateReusable(queryDesc) ||
+		(estate->es_top_eflags & ~EXEC_FLAG_SKIP_TRIGGERS) != 0 ||
+		estate->es_instrument != 0 ||
+		estate->es_jit != NULL ||
+		queryDesc->totaltime != NULL)
+		return false;
+
+	/*
+	 * The only descriptors that may be pinned by the slots are those of the
+	 * relations, which we know how to check when the state is taken back.
+	 */
+	foreach(lc, estate->es_tupleTable)
+	{
+		TupleDesc	tupdesc = lfirst_node(TupleTableSlot, lc)->tts_tupleDescriptor;
+		bool		found = false;
+
+		if (tupdesc == NULL || tupdesc->tdrefcount < 0)
+			continue;
+		for (int i = 0; i < estate->es_range_table_size && !found; i++)
+			found = (estate->es_relations[i] != NULL &&
+					 RelationGetDescr(estate->es_relations[i]) == tupdesc);
+		if (!found)
+			return false;
+	}
+
+	/*
+	 * If something keeps allocating in the per-query context, start afresh
+	 * now and then rather than letting it grow.
+	 */
+	memsize = MemoryContextMemAllocated(estate->es_query_cxt, true);
+	if (cstate == NULL)
+	{
+		cstate = (CachedExecState *)
+			MemoryContextAllocZero(estate->es_query_cxt,
+								   sizeof(CachedExecState));
+		cstate->plannedstmt = queryDesc->plannedstmt;
+		cstate->eflags = estate->es_top_eflags;
+		cstate->estate = estate;
+		cstate->planstate = queryDesc->planstate;
+		cstate->tupDesc = queryDesc->tupDesc;
+		cstate->reldescs = (TupleDesc *)
+			MemoryContextAllocZero(estate->es_query_cxt,
+								   estate->es_range_table_size * sizeof(TupleDesc));
+		cstate->memsize = memsize;
+		estate->es_cached_state = cstate;
+	}
+	else if (memsize > 2 * cstate->memsize)
+		return false;
+
+	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+	ExecReleaseCachedPlanState(queryDesc->planstate, NULL);
+
+	/* Empty the slots, but unlike ExecResetTupleTable keep their descriptors */
+	foreach(lc, estate->es_tupleTable)
+	{
+		TupleTableSlot *slot = lfirst_node(TupleTableSlot, lc);
+
+		ExecClearTuple(slot);
+		if (slot->tts_tupleDescriptor)
+			ReleaseTupleDesc(slot->tts_tupleDescriptor);
+	}
+
+	foreach(lc, estate->es_exprcontexts)
+	{
+		ExprContext *econtext = (ExprContext *) lfirst(lc);
+
+		ReScanExprContext(econtext);
+		econtext->ecxt_param_list_info = NULL;
+	}
+	estate->es_param_list_info = NULL;
+
+	for (int i = 0; i < estate->es_range_table_size; i++)
+	{
+		if (estate->es_relations[i] != NULL)
+			cstate->reldescs[i] = RelationGetDescr(estate->es_relations[i]);
+	}
+	ExecCloseRangeTableRelations(estate);
+
+	/* Values detoasted under this snapshot mustn't be seen by the next one */
+	if (estate->es_detoast_cache != NULL)
+		detoast_cache_reset(estate->es_detoast_cache);
+
+	UnregisterSnapshot(estate->es_snapshot);
+	UnregisterSnapshot(estate->es_crosscheck_snapshot);
+	estate->es_snapshot = InvalidSnapshot;
+	estate->es_crosscheck_snapshot = InvalidSnapshot;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	MemoryContextSetParent(estate->es_query_cxt, cplan->context);
+	cplan->execstate = cstate;
+
+	return true;
+}
+
+/*
+ * ExecReuseCachedState
+ *
+ * Called by ExecutorStart when the cached plan holds the state of a previous
+ * execution.  If it can be used for this one, set up the QueryDesc with it
+ * and return true.  Otherwise the state is thrown away, and the caller must
+ * build a new one.
+ */
+static bool
+ExecReuseCachedState(QueryDesc *queryDesc, int eflags)
+{
+	CachedPlan *cplan = queryDesc->cplan;
+	CachedExecState *cstate = cplan->execstate;
+	EState	   *estate = cstate->estate;
+	MemoryContext oldcontext;
+	bool		valid = true;
+	ListCell   *lc;
+
+	/*
+	 * Take the state out of the plan.  From now on it belongs to this query,
+	 * and goes away with the caller's memory context in case of error.
+	 */
+	cplan->execstate = NULL;
+	MemoryContextSetParent(estate->es_query_cxt, CurrentMemoryContext);
+
+	if (!ExecQueryStateReusable(queryDesc) ||
+		cstate->plannedstmt != queryDesc->plannedstmt ||
+		cstate->eflags != (eflags | EXEC_FLAG_SKIP_TRIGGERS))
+	{
+		FreeExecutorState(estate);
+		return false;
+	}
+
+	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+	/* Permissions are checked by each execution, as in InitPlan */
+	ExecCheckPermissions(queryDesc->plannedstmt->rtable,
+						 queryDesc->plannedstmt->permInfos, true);
+
+	/*
+	 * Reopen the relations and indexes.  The nodes, and the slots' tuple
+	 * descriptors, point to their relcache entries, so the state can only be
+	 * used if those are still the same.
+	 */
+	for (int i = 0; i < estate->es_range_table_size; i++)
+	{
+		Relation	oldrel = estate->es_relations[i];
+		Relation	rel;
+
+		if (oldrel == NULL)
+			continue;
+		estate->es_relations[i] = NULL;
+		rel = ExecGetRangeTableRelation(estate, i + 1, false);
+		if (rel != oldrel || RelationGetDescr(rel) != cstate->reldescs[i])
+			valid = false;
+	}
+	ExecReopenCachedPlanState(cstate->planstate, &valid);
+
+	if (!valid)
+	{
+		ExecReleaseCachedPlanState(cstate->planstate, NULL);
+		ExecCloseRangeTableRelations(estate);
+		MemoryContextSwitchTo(oldcontext);
+		FreeExecutorState(estate);
+		return false;
+	}
+
+	foreach(lc, estate->es_tupleTable)
+	{
+		TupleTableSlot *slot = lfirst_node(TupleTableSlot, lc);
+
+		if (slot->tts_tupleDescriptor)
+			PinTupleDesc(slot->tts_tupleDescriptor);
+	}
+
+	estate->es_snapshot = RegisterSnapshot(queryDesc->snapshot);
+	estate->es_crosscheck_snapshot = RegisterSnapshot(queryDesc->crosscheck_snapshot);
+
+	estate->es_param_list_info = queryDesc->params;
+	foreach(lc, estate->es_exprcontexts)
+		((ExprContext *) lfirst(lc))->ecxt_param_list_info = queryDesc->params;
+
+	estate->es_sourceText = queryDesc->sourceText;
+	estate->es_processed = 0;
+	estate->es_total_processed = 0;
+	estate->es_finished = false;
+
+	queryDesc->estate = estate;
+	queryDesc->planstate = cstate->planstate;
+	queryDesc->tupDesc = cstate->tupDesc;
+
+	/* Reset the nodes, evaluating index keys with the new parameters */
+	ExecReScan(cstate->planstate);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return true;
+}
+
+
 /*
  * ExecCheckPermissions
  *		Check access permissions of relations mentioned in a query
@@ -1256,7 +1718,7 @@ InitResultRelInfo(ResultRelInfo *resultRelInfo,
 	resultRelInfo->ri_needLockTagTuple =
 		IsInplaceUpdateRelation(resultRelationDesc);
 	/* make a copy so as not to depend on relcache info not changing... */
-	resultRelInfo->ri_TrigDesc = CopyTriggerDesc(resultRelationDesc->trigdesc);
+	resultRelInfo->ri_TrigDesc = CopyTriggerDesc(RelationGetTriggerDesc(resultRelationDesc));
 	if (resultRelInfo->ri_TrigDesc)
 	{
 		int			n = resultRelInfo->ri_TrigDesc->numtriggers;
@@ -23,12 +23,15 @@
 
 #include "postgres.h"
 
+#include "commands/copy.h"
+#include "commands/createas.h"
 #include "executor/execParallel.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
 #include "executor/nodeAppend.h"
 #include "executor/nodeBitmapHeapscan.h"
 #include "executor/nodeBitmapIndexscan.h"
+#include "executor/nodeCtescan.h"
 #include "executor/nodeCustom.h"
 #include "executor/nodeForeignscan.h"
 #include "executor/nodeHash.h"
@@ -66,6 +69,8 @@
 #define PARALLEL_KEY_QUERY_TEXT		UINT64CONST(0xE000000000000008)
 #define PARALLEL_KEY_JIT_INSTRUMENTATION UINT64CONST(0xE000000000000009)
 #define PARALLEL_KEY_WAL_USAGE			UINT64CONST(0xE00000000000000A)
+#define PARALLEL_KEY_WORKER_DEST		UINT64CONST(0xE00000000000000B)
+#define PARALLEL_KEY_WORKER_PROCESSED	UINT64CONST(0xE00000000000000C)
 
 #define PARALLEL_TUPLE_QUEUE_SIZE		65536
 
@@ -78,6 +83,8 @@ typedef struct FixedParallelExecutorState
 	dsa_pointer param_exec;
 	int			eflags;
 	int			jit_flags;
+	Size		pstmt_len;		/* length of serialized PlannedStmt */
+	ParallelDestKind worker_dest;	/* see ExecGatherSetWorkerDest */
 } FixedParallelExecutorState;
 
 /*
@@ -125,7 +132,7 @@ typedef struct ExecParallelInitializeDSMContext
 } ExecParallelInitializeDSMContext;
 
 /* Helper functions that run in the parallel leader. */
-static char *ExecSerializePlan(Plan *plan, EState *estate);
+static char *ExecSerializePlan(Plan *plan, EState *estate, Size *len);
 static bool ExecParallelEstimate(PlanState *planstate,
 								 ExecParallelEstimateContext *e);
 static bool ExecParallelInitializeDSM(PlanState *planstate,
@@ -137,14 +144,21 @@ static bool ExecParallelReInitializeDSM(PlanState *planstate,
 static bool ExecParallelRetrieveInstrumentation(PlanState *planstate,
 												SharedExecutorInstrumentation *instrumentation);
 
-/* Helper function that runs in the parallel worker. */
+/* Helper functions that run in the parallel worker. */
 static DestReceiver *ExecParallelGetReceiver(dsm_segment *seg, shm_toc *toc);
+static DestReceiver *ExecParallelGetWorkerDest(FixedParallelExecutorState *fpes,
+											   shm_toc *toc,
+											   DestReceiver *receiver);
 
 /*
  * Create a serialized representation of the plan to be sent to each worker.
+ *
+ * The plan is serialized in the binary format of nodeToBinary(), which is
+ * much cheaper to produce and to read back than nodeToString() output.  Its
+ * length is returned in *len.
  */
 static char *
-ExecSerializePlan(Plan *plan, EState *estate)
+ExecSerializePlan(Plan *plan, EState *estate, Size *len)
 {
 	PlannedStmt *pstmt;
 	ListCell   *lc;
@@ -219,7 +233,7 @@ ExecSerializePlan(Plan *plan, EState *estate)
 	pstmt->stmt_len = -1;
 
 	/* Return serialized copy of our dummy PlannedStmt. */
-	return nodeToString(pstmt);
+	return nodeToBinary(pstmt, len);
 }
 
 /*
@@ -272,6 +286,11 @@ ExecParallelEstimate(PlanState *planstate, ExecParallelEstimateContext *e)
 				ExecTidRangeScanEstimate((TidRangeScanState *) planstate,
 										 e->pcxt);
 			break;
+		case T_CteScanState:
+			if (planstate->plan->parallel_aware)
+				ExecCteScanEstimate((CteScanState *) planstate,
+									e->pcxt);
+			break;
 		case T_AppendState:
 			if (planstate->plan->parallel_aware)
 				ExecAppendEstimate((AppendState *) planstate,
@@ -309,7 +328,7 @@ ExecParallelEstimate(PlanState *planstate, ExecParallelEstimateContext *e)
 			ExecAggEstimate((AggState *) planstate, e->pcxt);
 			break;
 		case T_MemoizeState:
-			/* even when not parallel-aware, for EXPLAIN ANALYZE */
+			/* even when not parallel-aware, for EXPLAIN ANALYZE and caching */
 			ExecMemoizeEstimate((MemoizeState *) planstate, e->pcxt);
 			break;
 		default:
@@ -504,6 +523,11 @@ ExecParallelInitializeDSM(PlanState *planstate,
 				ExecTidRangeScanInitializeDSM((TidRangeScanState *) planstate,
 											  d->pcxt);
 			break;
+		case T_CteScanState:
+			if (planstate->plan->parallel_aware)
+				ExecCteScanInitializeDSM((CteScanState *) planstate,
+										 d->pcxt);
+			break;
 		case T_AppendState:
 			if (planstate->plan->parallel_aware)
 				ExecAppendInitializeDSM((AppendState *) planstate,
@@ -541,7 +565,7 @@ ExecParallelInitializeDSM(PlanState *planstate,
 			ExecAggInitializeDSM((AggState *) planstate, d->pcxt);
 			break;
 		case T_MemoizeState:
-			/* even when not parallel-aware, for EXPLAIN ANALYZE */
+			/* even when not parallel-aware, for EXPLAIN ANALYZE and caching */
 			ExecMemoizeInitializeDSM((MemoizeState *) planstate, d->pcxt);
 			break;
 		default:
@@ -610,7 +634,8 @@ ExecParallelSetupTupleQueues(ParallelContext *pcxt, bool reinitialize)
 ParallelExecutorInfo *
 ExecInitParallelPlan(PlanState *planstate, EState *estate,
 					 Bitmapset *sendParams, int nworkers,
-					 int64 tuples_needed)
+					 int64 tuples_needed, ParallelDestKind worker_dest,
+					 Node *worker_dest_info)
 {
 	ParallelExecutorInfo *pei;
 	ParallelContext *pcxt;
@@ -624,7 +649,7 @@ ExecInitParallelPlan(PlanState *planstate, EState *estate,
 	WalUsage   *walusage_space;
 	SharedExecutorInstrumentation *instrumentation = NULL;
 	SharedJitInstrumentation *jit_instrumentation = NULL;
-	int			pstmt_len;
+	Size		pstmt_len;
 	int			paramlistinfo_len;
 	int			instrumentation_len = 0;
 	int			jit_instrumentation_len = 0;
@@ -632,6 +657,8 @@ ExecInitParallelPlan(PlanState *planstate, EState *estate,
 	Size		dsa_minsize = dsa_minimum_size();
 	char	   *query_string;
 	int			query_len;
+	char	   *dest_info_data = NULL;
+	int			dest_info_len = 0;
 
 	/*
 	 * Force any initplan outputs that we're going to pass to workers to be
@@ -650,9 +677,10 @@ ExecInitParallelPlan(PlanState *planstate, EState *estate,
 	pei = palloc0_object(ParallelExecutorInfo);
 	pei->finished = false;
 	pei->planstate = planstate;
+	pei->worker_dest = worker_dest;
 
 	/* Fix up and serialize plan to be sent to workers. */
-	pstmt_data = ExecSerializePlan(planstate->plan, estate);
+	pstmt_data = ExecSerializePlan(planstate->plan, estate, &pstmt_len);
 
 	/* Create a parallel context. */
 	pcxt = CreateParallelContext("postgres", "ParallelQueryMain", nworkers);
@@ -675,7 +703,6 @@ ExecInitParallelPlan(PlanState *planstate, EState *estate,
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 
 	/* Estimate space for serialized PlannedStmt. */
-	pstmt_len = strlen(pstmt_data) + 1;
 	shm_toc_estimate_chunk(&pcxt->estimator, pstmt_len);
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 
@@ -707,6 +734,21 @@ ExecInitParallelPlan(PlanState *planstate, EState *estate,
 						   mul_size(PARALLEL_TUPLE_QUEUE_SIZE, pcxt->nworkers));
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 
+	/*
+	 * If the workers are to pass their tuples to some other DestReceiver,
+	 * estimate space for what it needs to know, and for the workers' counts
+	 * of tuples they processed.
+	 */
+	if (worker_dest != PARALLEL_DEST_TUPLES)
+	{
+		dest_info_data = nodeToString(worker_dest_info);
+		dest_info_len = strlen(dest_info_data) + 1;
+		shm_toc_estimate_chunk(&pcxt->estimator, dest_info_len);
+		shm_toc_estimate_chunk(&pcxt->estimator,
+							   mul_size(sizeof(uint64), pcxt->nworkers));
+		shm_toc_estimate_keys(&pcxt->estimator, 2);
+	}
+
 	/*
 	 * Give parallel-aware nodes a chance to add to the estimates, and get a
 	 * count of how many PlanState nodes there are.
@@ -768,6 +810,8 @@ ExecInitParallelPlan(PlanState *planstate, EState *estate,
 	fpes->param_exec = InvalidDsaPointer;
 	fpes->eflags = estate->es_top_eflags;
 	fpes->jit_flags = estate->es_jit_flags;
+	fpes->pstmt_len = pstmt_len;
+	fpes->worker_dest = worker_dest;
 	shm_toc_insert(pcxt->toc, PARALLEL_KEY_EXECUTOR_FIXED, fpes);
 
 	/* Store query string */
@@ -803,6 +847,23 @@ ExecInitParallelPlan(PlanState *planstate, EState *estate,
 	/* We don't need the TupleQueueReaders yet, though. */
 	pei->reader = NULL;
 
+	/* Store the workers' DestReceiver details, and zero their counts. */
+	if (worker_dest != PARALLEL_DEST_TUPLES)
+	{
+		char	   *dest_info_space;
+
+		dest_info_space = shm_toc_allocate(pcxt->toc, dest_info_len);
+		memcpy(dest_info_space, dest_info_data, dest_info_len);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_WORKER_DEST, dest_info_space);
+
+		pei->worker_processed =
+			shm_toc_allocate(pcxt->toc,
+							 mul_size(sizeof(uint64), pcxt->nworkers));
+		memset(pei->worker_processed, 0, sizeof(uint64) * pcxt->nworkers);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_WORKER_PROCESSED,
+					   pei->worker_processed);
+	}
+
 	/*
 	 * If instrumentation options were supplied, allocate space for the data.
 	 * It only gets partially initialized here; the rest happens during
@@ -946,6 +1007,9 @@ ExecParallelReinitialize(PlanState *planstate,
 	pei->tqueue = ExecParallelSetupTupleQueues(pei->pcxt, true);
 	pei->reader = NULL;
 	pei->finished = false;
+	if (pei->worker_processed != NULL)
+		memset(pei->worker_processed, 0,
+			   sizeof(uint64) * pei->pcxt->nworkers);
 
 	fpes = shm_toc_lookup(pei->pcxt->toc, PARALLEL_KEY_EXECUTOR_FIXED, false);
 
@@ -1010,6 +1074,11 @@ ExecParallelReInitializeDSM(PlanState *planstate,
 				ExecTidRangeScanReInitializeDSM((TidRangeScanState *) planstate,
 												pcxt);
 			break;
+		case T_CteScanState:
+			if (planstate->plan->parallel_aware)
+				ExecCteScanReInitializeDSM((CteScanState *) planstate,
+										   pcxt);
+			break;
 		case T_AppendState:
 			if (planstate->plan->parallel_aware)
 				ExecAppendReInitializeDSM((AppendState *) planstate, pcxt);
@@ -1029,9 +1098,15 @@ ExecParallelReInitializeDSM(PlanState *planstate,
 				ExecHashJoinReInitializeDSM((HashJoinState *) planstate,
 											pcxt);
 			break;
+		case T_SortState:
+			if (planstate->plan->parallel_aware)
+				ExecSortReInitializeDSM((SortState *) planstate, pcxt);
+			break;
 		case T_BitmapIndexScanState:
+			ExecBitmapIndexScanReInitializeDSM((BitmapIndexScanState *) planstate,
+											   pcxt);
+			break;
 		case T_HashState:
-		case T_SortState:
 		case T_IncrementalSortState:
 		case T_MemoizeState:
 			/* these nodes have DSM state, but no reinitialization is required */
@@ -1213,6 +1288,16 @@ ExecParallelFinish(ParallelExecutorInfo *pei)
 	for (i = 0; i < nworkers; i++)
 		InstrAccumParallelQuery(&pei->buffer_usage[i], &pei->wal_usage[i]);
 
+	/*
+	 * Rows that the workers inserted themselves count as processed by the
+	 * query, as if we had passed them to our own DestReceiver.
+	 */
+	if (pei->worker_dest == PARALLEL_DEST_INTOREL)
+	{
+		for (i = 0; i < nworkers; i++)
+			pei->planstate->state->es_processed += pei->worker_processed[i];
+	}
+
 	pei->finished = true;
 }
 
@@ -1271,6 +1356,42 @@ ExecParallelGetReceiver(dsm_segment *seg, shm_toc *toc)
 	return CreateTupleQueueDestReceiver(shm_mq_attach(mq, seg, NULL));
 }
 
+/*
+ * Create the DestReceiver that the Gather's leader asked us to pass our
+ * tuples to instead of 'receiver', the one for our tuple queue, which it
+ * may use to send something else to the leader.
+ *
+ * PARALLEL_DEST_INTOREL inserts the tuples into the relation whose OID is
+ * the only member of the details list, for CREATE TABLE AS.
+ * PARALLEL_DEST_COPY formats them as COPY TO rows, which it sends to the
+ * leader to write out.
+ */
+static DestReceiver *
+ExecParallelGetWorkerDest(FixedParallelExecutorState *fpes, shm_toc *toc,
+						  DestReceiver *receiver)
+{
+	char	   *dest_info_space;
+	Node	   *dest_info;
+
+	dest_info_space = shm_toc_lookup(toc, PARALLEL_KEY_WORKER_DEST, false);
+	dest_info = stringToNode(dest_info_space);
+
+	switch (fpes->worker_dest)
+	{
+		case PARALLEL_DEST_INTOREL:
+			return CreateIntoRelWorkerDestReceiver(linitial_oid(castNode(List, dest_info)));
+		case PARALLEL_DEST_COPY:
+			return CreateCopyToWorkerDestReceiver(castNode(List, dest_info),
+												  receiver);
+		case PARALLEL_DEST_TUPLES:
+			break;
+	}
+
+	elog(ERROR, "unrecognized parallel worker destination: %d",
+		 (int) fpes->worker_dest);
+	return NULL;				/* keep compiler quiet */
+}
+
 /*
  * Create a QueryDesc for the PlannedStmt we are to execute, and return it.
  */
@@ -1278,6 +1399,7 @@ static QueryDesc *
 ExecParallelGetQueryDesc(shm_toc *toc, DestReceiver *receiver,
 						 int instrument_options)
 {
+	FixedParallelExecutorState *fpes;
 	char	   *pstmtspace;
 	char	   *paramspace;
 	PlannedStmt *pstmt;
@@ -1288,8 +1410,9 @@ ExecParallelGetQueryDesc(shm_toc *toc, DestReceiver *receiver,
 	queryString = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, false);
 
 	/* Reconstruct leader-supplied PlannedStmt. */
+	fpes = shm_toc_lookup(toc, PARALLEL_KEY_EXECUTOR_FIXED, false);
 	pstmtspace = shm_toc_lookup(toc, PARALLEL_KEY_PLANNEDSTMT, false);
-	pstmt = (PlannedStmt *) stringToNode(pstmtspace);
+	pstmt = (PlannedStmt *) binaryToNode(pstmtspace, fpes->pstmt_len);
 
 	/* Reconstruct ParamListInfo. */
 	paramspace = shm_toc_lookup(toc, PARALLEL_KEY_PARAMLISTINFO, false);
@@ -1383,6 +1506,11 @@ ExecParallelInitializeWorker(PlanState *planstate, ParallelWorkerContext *pwcxt)
 				ExecTidRangeScanInitializeWorker((TidRangeScanState *) planstate,
 												 pwcxt);
 			break;
+		case T_CteScanState:
+			if (planstate->plan->parallel_aware)
+				ExecCteScanInitializeWorker((CteScanState *) planstate,
+											pwcxt);
+			break;
 		case T_AppendState:
 			if (planstate->plan->parallel_aware)
 				ExecAppendInitializeWorker((AppendState *) planstate, pwcxt);
@@ -1420,7 +1548,7 @@ ExecParallelInitializeWorker(PlanState *planstate, ParallelWorkerContext *pwcxt)
 			ExecAggInitializeWorker((AggState *) planstate, pwcxt);
 			break;
 		case T_MemoizeState:
-			/* even when not parallel-aware, for EXPLAIN ANALYZE */
+			/* even when not parallel-aware, for EXPLAIN ANALYZE and caching */
 			ExecMemoizeInitializeWorker((MemoizeState *) planstate, pwcxt);
 			break;
 		default:
@@ -1461,18 +1589,23 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 	void	   *area_space;
 	dsa_area   *area;
 	ParallelWorkerContext pwcxt;
+	DestReceiver *dest;
 
 	/* Get fixed-size state. */
 	fpes = shm_toc_lookup(toc, PARALLEL_KEY_EXECUTOR_FIXED, false);
 
 	/* Set up DestReceiver, SharedExecutorInstrumentation, and QueryDesc. */
 	receiver = ExecParallelGetReceiver(seg, toc);
+	if (fpes->worker_dest != PARALLEL_DEST_TUPLES)
+		dest = ExecParallelGetWorkerDest(fpes, toc, receiver);
+	else
+		dest = receiver;
 	instrumentation = shm_toc_lookup(toc, PARALLEL_KEY_INSTRUMENTATION, true);
 	if (instrumentation != NULL)
 		instrument_options = instrumentation->instrument_options;
 	jit_instrumentation = shm_toc_lookup(toc, PARALLEL_KEY_JIT_INSTRUMENTATION,
 										 true);
-	queryDesc = ExecParallelGetQueryDesc(toc, receiver, instrument_options);
+	queryDesc = ExecParallelGetQueryDesc(toc, dest, instrument_options);
 
 	/* Setting debug_query_string for individual workers */
 	debug_query_string = queryDesc->sourceText;
@@ -1521,6 +1654,17 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 				ForwardScanDirection,
 				fpes->tuples_needed < 0 ? (int64) 0 : fpes->tuples_needed);
 
+	/* Report how many tuples our own DestReceiver took care of */
+	if (dest != receiver)
+	{
+		uint64	   *worker_processed;
+
+		worker_processed = shm_toc_lookup(toc, PARALLEL_KEY_WORKER_PROCESSED,
+										  false);
+		worker_processed[ParallelWorkerNumber] =
+			queryDesc->estate->es_processed;
+	}
+
 	/* Shut down the executor */
 	ExecutorFinish(queryDesc);
 
@@ -1549,5 +1693,7 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 	/* Cleanup. */
 	dsa_detach(area);
 	FreeQueryDesc(queryDesc);
+	if (dest != receiver)
+		dest->rDestroy(dest);
 	receiver->rDestroy(receiver);
 }
@@ -13,6 +13,7 @@
  */
 #include "postgres.h"
 
+#include "access/parallel.h"
 #include "access/table.h"
 #include "access/tableam.h"
 #include "catalog/index.h"
@@ -27,6 +28,7 @@
 #include "partitioning/partdesc.h"
 #include "partitioning/partprune.h"
 #include "rewrite/rewriteManip.h"
+#include "storage/lmgr.h"
 #include "utils/acl.h"
 #include "utils/lsyscache.h"
 #include "utils/partcache.h"
@@ -1510,6 +1512,13 @@ FormPartitionKeyDatum(PartitionDispatch pd,
  * don't attempt to use the cache again until we've found that partition at
  * least PARTITION_CACHED_FIND_THRESHOLD times in a row.
  *
+ * Loads into RANGE partitioned tables, such as time-series data arriving
+ * roughly in timestamp order, tend to move from one partition to the next.
+ * So when the cached partition doesn't match, we also check the range that
+ * directly follows it before falling back on the binary search, and moving
+ * on to the following bound doesn't reset the number of times we've found
+ * the same partition.
+ *
  * For cases where the partition changes on each lookup, the amount of
  * additional work required just amounts to recording the last found partition
  * and bound offset then resetting the found counter.  This is cheap and does
@@ -1674,6 +1683,27 @@ get_partition_for_tuple(PartitionDispatch pd, const Datum *values, const bool *i
 
 						if (cmpval > 0)
 							return boundinfo->indexes[last_datum_offset + 1];
+
+						/*
+						 * Input arriving in mostly ascending order tends to
+						 * move on to the next range rather than anywhere
+						 * else, so try that before doing a binary search.
+						 * The upper bound just checked is the lower bound of
+						 * the next range.
+						 */
+						if (cmpval == 0 ||
+							last_datum_offset + 2 >= boundinfo->ndatums ||
+							partition_rbound_datum_cmp(key->partsupfunc,
+													   key->partcollation,
+													   boundinfo->datums[last_datum_offset + 2],
+													   boundinfo->kind[last_datum_offset + 2],
+													   values,
+													   key->partnatts) > 0)
+						{
+							bound_offset = last_datum_offset + 1;
+							part_index = boundinfo->indexes[bound_offset + 1];
+							break;
+						}
 					}
 					/* fall-through and do a manual lookup */
 				}
@@ -1722,11 +1752,21 @@ get_partition_for_tuple(PartitionDispatch pd, const Datum *values, const bool *i
 	 * cached bound offset then we've found the same partition as last time,
 	 * so bump the count by one.  If all goes well, we'll eventually reach
 	 * PARTITION_CACHED_FIND_THRESHOLD and try the cache path next time
-	 * around.  Otherwise, we'll reset the cache count back to 1 to mark that
-	 * we've found this partition for the first time.
+	 * around.  If we've moved on to the bound right after the cached one,
+	 * the input is likely arriving in order, so move the cache along
+	 * without losing the count.  Otherwise, we'll reset the cache count back
+	 * to 1 to mark that we've found this partition for the first time.
 	 */
 	if (bound_offset == partdesc->last_found_datum_index)
 		partdesc->last_found_count++;
+	else if (partdesc->last_found_datum_index >= 0 &&
+			 bound_offset == partdesc->last_found_datum_index + 1)
+	{
+		if (partdesc->last_found_count < PARTITION_CACHED_FIND_THRESHOLD)
+			partdesc->last_found_count++;
+		partdesc->last_found_part_index = part_index;
+		partdesc->last_found_datum_index = bound_offset;
+	}
 	else
 	{
 		partdesc->last_found_count = 1;
@@ -1978,6 +2018,24 @@ ExecDoInitialPruning(EState *estate)
 		else
 			validsubplan_rtis = all_leafpart_rtis;
 
+		/*
+		 * A cached generic plan doesn't lock partitions that initial pruning
+		 * can eliminate (see AcquireExecutorLocks), so lock the survivors
+		 * here.  This is cheap if the lock is already held.  Parallel workers
+		 * lock relations as they open them.
+		 */
+		if (prunestate->do_initial_prune && !IsParallelWorker())
+		{
+			int			rti = -1;
+
+			while ((rti = bms_next_member(validsubplan_rtis, rti)) >= 0)
+			{
+				RangeTblEntry *rte = exec_rt_fetch(rti, estate);
+
+				LockRelationOid(rte->relid, rte->rellockmode);
+			}
+		}
+
 		estate->es_unpruned_relids = bms_add_members(estate->es_unpruned_relids,
 													 validsubplan_rtis);
 		estate->es_part_prune_results = lappend(estate->es_part_prune_results,
@@ -805,6 +805,9 @@ ExecShutdownNode_walker(PlanState *node, void *context)
 		case T_ForeignScanState:
 			ExecShutdownForeignScan((ForeignScanState *) node);
 			break;
+		case T_CteScanState:
+			ExecShutdownCteScan((CteScanState *) node);
+			break;
 		case T_CustomScanState:
 			ExecShutdownCustomScan((CustomScanState *) node);
 			break;
@@ -884,6 +884,71 @@ ExecSimpleRelationInsert(ResultRelInfo *resultRelInfo,
 	}
 }
 
+/*
+ * Insert tuples from slots into the relation all at once, the way
+ * ExecSimpleRelationInsert() inserts one.
+ *
+ * The caller must make sure that there are no BEFORE ROW INSERT triggers,
+ * which could skip or modify the tuples.  The index entries are still
+ * inserted one tuple at a time, after all the tuples have been stored.
+ */
+void
+ExecSimpleRelationMultiInsert(ResultRelInfo *resultRelInfo, EState *estate,
+							  TupleTableSlot **slots, int nslots)
+{
+	Relation	rel = resultRelInfo->ri_RelationDesc;
+	List	   *conflictindexes = resultRelInfo->ri_onConflictArbiterIndexes;
+
+	/* For now we support only tables. */
+	Assert(rel->rd_rel->relkind == RELKIND_RELATION);
+	Assert(!(resultRelInfo->ri_TrigDesc &&
+			 resultRelInfo->ri_TrigDesc->trig_insert_before_row));
+
+	CheckCmdReplicaIdentity(rel, CMD_INSERT);
+
+	for (int i = 0; i < nslots; i++)
+	{
+		/* Compute stored generated columns */
+		if (rel->rd_att->constr &&
+			rel->rd_att->constr->has_generated_stored)
+			ExecComputeStoredGenerated(resultRelInfo, estate, slots[i],
+									   CMD_INSERT);
+
+		/* Check the constraints of the tuple */
+		if (rel->rd_att->constr)
+			ExecConstraints(resultRelInfo, slots[i], estate);
+		if (rel->rd_rel->relispartition)
+			ExecPartitionCheck(resultRelInfo, slots[i], estate, true);
+	}
+
+	/* OK, store the tuples and create index entries for them */
+	table_multi_insert(rel, slots, nslots, GetCurrentCommandId(true), 0, NULL);
+
+	for (int i = 0; i < nslots; i++)
+	{
+		List	   *recheckIndexes = NIL;
+		bool		conflict = false;
+
+		if (resultRelInfo->ri_NumIndices > 0)
+			recheckIndexes = ExecInsertIndexTuples(resultRelInfo,
+												   slots[i], estate, false,
+												   conflictindexes ? true : false,
+												   &conflict,
+												   conflictindexes, false);
+
+		/* See ExecSimpleRelationInsert() */
+		if (conflict)
+			CheckAndReportConflict(resultRelInfo, estate, CT_INSERT_EXISTS,
+								   recheckIndexes, NULL, slots[i]);
+
+		/* AFTER ROW INSERT Triggers */
+		ExecARInsertTriggers(estate, resultRelInfo, slots[i],
+							 recheckIndexes, NULL);
+
+		list_free(recheckIndexes);
+	}
+}
+
 /*
  * Find the searchslot tuple and update it with data in the slot,
  * update the indexes, and execute any constraints and per-row triggers.
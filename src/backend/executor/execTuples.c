@@ -64,6 +64,7 @@
 #include "catalog/pg_type.h"
 #include "funcapi.h"
 #include "nodes/nodeFuncs.h"
+#include "port/pg_bitutils.h"
 #include "storage/bufmgr.h"
 #include "utils/builtins.h"
 #include "utils/expandeddatum.h"
@@ -1104,6 +1105,72 @@ slot_deform_heap_tuple_internal(TupleTableSlot *slot, HeapTuple tuple,
 	return natts;
 }
 
+/*
+ * slot_deform_heap_tuple_prefix
+ *		Deform the leading fixed-width attributes of the tuple at once, as
+ *		far as they are not NULL, and return the number of attributes done.
+ *
+ * Their offsets don't depend on the tuple's contents, so they're computed
+ * only once per TupleDesc, see TupleDescComputeFixedPrefix().  Leading
+ * Datum-sized pass-by-value attributes are laid out exactly like the Datum
+ * array, and are simply copied over.
+ */
+static pg_attribute_always_inline int
+slot_deform_heap_tuple_prefix(TupleTableSlot *slot, HeapTuple tuple,
+							  int natts, bool hasnulls, uint32 *offp)
+{
+	TupleDesc	tupleDesc = slot->tts_tupleDescriptor;
+	Datum	   *values = slot->tts_values;
+	HeapTupleHeader tup = tuple->t_data;
+	char	   *tp;
+	CompactAttribute *lastatt;
+	int			nfixed;
+	int			nwide;
+
+	if (unlikely(tupleDesc->tdfixedprefix < 0))
+		TupleDescComputeFixedPrefix(tupleDesc);
+
+	nfixed = Min(tupleDesc->tdfixedprefix, natts);
+	nwide = tupleDesc->tdwideprefix;
+
+	/* Stop at the first NULL, if any */
+	if (hasnulls)
+	{
+		bits8	   *bp = tup->t_bits;
+
+		for (int i = 0; i < nfixed; i += BITS_PER_BYTE)
+		{
+			uint32		nullbits = (uint8) ~bp[i >> 3];
+
+			if (nullbits != 0)
+			{
+				nfixed = Min(nfixed, i + pg_rightmost_one_pos32(nullbits));
+				break;
+			}
+		}
+	}
+
+	if (nfixed == 0)
+		return 0;
+	nwide = Min(nwide, nfixed);
+
+	tp = (char *) tup + tup->t_hoff;
+
+	memcpy(values, tp, nwide * sizeof(Datum));
+	for (int attnum = nwide; attnum < nfixed; attnum++)
+	{
+		CompactAttribute *thisatt = TupleDescCompactAttr(tupleDesc, attnum);
+
+		values[attnum] = fetchatt(thisatt, tp + thisatt->attcacheoff);
+	}
+	memset(slot->tts_isnull, false, nfixed * sizeof(bool));
+
+	lastatt = TupleDescCompactAttr(tupleDesc, nfixed - 1);
+	*offp = lastatt->attcacheoff + lastatt->attlen;
+
+	return nfixed;
+}
+
 /*
  * slot_deform_heap_tuple
  *		Given a TupleTableSlot, extract data from the slot's physical tuple
@@ -1137,9 +1204,11 @@ slot_deform_heap_tuple(TupleTableSlot *slot, HeapTuple tuple, uint32 *offp,
 	attnum = slot->tts_nvalid;
 	if (attnum == 0)
 	{
-		/* Start from the first attribute */
+		/* Start from the first attribute, doing the fixed prefix at once */
 		off = 0;
 		slow = false;
+		attnum = slot_deform_heap_tuple_prefix(slot, tuple, natts, hasnulls,
+											   &off);
 	}
 	else
 	{
@@ -165,6 +165,9 @@ CreateExecutorState(void)
 	estate->es_jit_flags = 0;
 	estate->es_jit = NULL;
 
+	estate->es_detoast_cache = NULL;
+	estate->es_cached_state = NULL;
+
 	/*
 	 * Return the executor state structure
 	 */
@@ -15,6 +15,7 @@
 
 #include <unistd.h>
 
+#include "common/pg_prng.h"
 #include "executor/instrument.h"
 
 BufferUsage pgBufferUsage;
@@ -39,6 +40,7 @@ InstrAlloc(int n, int instrument_options, bool async_mode)
 		bool		need_buffers = (instrument_options & INSTRUMENT_BUFFERS) != 0;
 		bool		need_wal = (instrument_options & INSTRUMENT_WAL) != 0;
 		bool		need_timer = (instrument_options & INSTRUMENT_TIMER) != 0;
+		bool		sample_timer = (instrument_options & INSTRUMENT_TIMER_SAMPLED) != 0;
 		int			i;
 
 		for (i = 0; i < n; i++)
@@ -46,6 +48,7 @@ InstrAlloc(int n, int instrument_options, bool async_mode)
 			instr[i].need_bufusage = need_buffers;
 			instr[i].need_walusage = need_wal;
 			instr[i].need_timer = need_timer;
+			instr[i].sample_timer = need_timer && sample_timer;
 			instr[i].async_mode = async_mode;
 		}
 	}
@@ -61,15 +64,47 @@ InstrInit(Instrumentation *instr, int instrument_options)
 	instr->need_bufusage = (instrument_options & INSTRUMENT_BUFFERS) != 0;
 	instr->need_walusage = (instrument_options & INSTRUMENT_WAL) != 0;
 	instr->need_timer = (instrument_options & INSTRUMENT_TIMER) != 0;
+	instr->sample_timer = instr->need_timer &&
+		(instrument_options & INSTRUMENT_TIMER_SAMPLED) != 0;
+}
+
+/*
+ * Decide whether to time the current call of a node with a sampled timer.
+ *
+ * The gaps between timed calls are random, averaging INSTR_SAMPLE_INTERVAL
+ * calls, so that they don't fall into step with a node's pattern of calls:
+ * the inner side of a nested loop, for example, alternates between calls
+ * that return a row and calls that find no more.  The first call of a cycle
+ * is always timed until one has been, so that there is a startup time to
+ * report.  InstrEndLoop() extrapolates from the timed calls.
+ */
+static bool
+InstrSampleCall(Instrumentation *instr)
+{
+	instr->calls += 1;
+
+	if (--instr->sample_countdown > 0 &&
+		(instr->running || instr->startup_sampled > 0))
+		return false;
+
+	instr->sample_countdown = 1 +
+		(int) pg_prng_uint64_range(&pg_global_prng_state, 0,
+								   2 * (INSTR_SAMPLE_INTERVAL - 1));
+	return true;
 }
 
 /* Entry to a plan node */
 void
 InstrStartNode(Instrumentation *instr)
 {
-	if (instr->need_timer &&
-		!INSTR_TIME_SET_CURRENT_LAZY(instr->starttime))
-		elog(ERROR, "InstrStartNode called twice in a row");
+	if (instr->need_timer)
+	{
+		instr->timing_call = instr->sample_timer ? InstrSampleCall(instr) : true;
+
+		if (instr->timing_call &&
+			!INSTR_TIME_SET_CURRENT_LAZY(instr->starttime))
+			elog(ERROR, "InstrStartNode called twice in a row");
+	}
 
 	/* save buffer usage totals at node entry, if needed */
 	if (instr->need_bufusage)
@@ -90,15 +125,26 @@ InstrStopNode(Instrumentation *instr, double nTuples)
 	instr->tuplecount += nTuples;
 
 	/* let's update the time only if the timer was requested */
-	if (instr->need_timer)
+	if (instr->need_timer && instr->timing_call)
 	{
 		if (INSTR_TIME_IS_ZERO(instr->starttime))
 			elog(ERROR, "InstrStopNode called without start");
 
 		INSTR_TIME_SET_CURRENT(endtime);
-		INSTR_TIME_ACCUM_DIFF(instr->counter, endtime, instr->starttime);
+		INSTR_TIME_SUBTRACT(endtime, instr->starttime);
+		INSTR_TIME_ADD(instr->counter, endtime);
 
 		INSTR_TIME_SET_ZERO(instr->starttime);
+
+		if (instr->sample_timer)
+		{
+			instr->sampled_calls += 1;
+			if (!instr->running)
+			{
+				instr->startup_sampled += 1;
+				instr->startup_sampled_time += INSTR_TIME_GET_DOUBLE(endtime);
+			}
+		}
 	}
 
 	/* Add delta of buffer usage since entry to node's totals */
@@ -151,11 +197,26 @@ InstrEndLoop(Instrumentation *instr)
 	/* Accumulate per-cycle statistics into totals */
 	totaltime = INSTR_TIME_GET_DOUBLE(instr->counter);
 
-	instr->startup += instr->firsttuple;
-	instr->total += totaltime;
 	instr->ntuples += instr->tuplecount;
 	instr->nloops += 1;
 
+	if (instr->sample_timer)
+	{
+		/* Extrapolate from the timed calls of all cycles so far */
+		instr->sampled_time += totaltime;
+		if (instr->startup_sampled > 0)
+			instr->startup = instr->startup_sampled_time *
+				instr->nloops / instr->startup_sampled;
+		if (instr->sampled_calls > 0)
+			instr->total = instr->sampled_time *
+				instr->calls / instr->sampled_calls;
+	}
+	else
+	{
+		instr->startup += instr->firsttuple;
+		instr->total += totaltime;
+	}
+
 	/* Reset for next cycle (if any) */
 	instr->running = false;
 	INSTR_TIME_SET_ZERO(instr->starttime);
@@ -186,6 +247,11 @@ InstrAggNode(Instrumentation *dst, Instrumentation *add)
 	dst->nloops += add->nloops;
 	dst->nfiltered1 += add->nfiltered1;
 	dst->nfiltered2 += add->nfiltered2;
+	dst->calls += add->calls;
+	dst->sampled_calls += add->sampled_calls;
+	dst->sampled_time += add->sampled_time;
+	dst->startup_sampled += add->startup_sampled;
+	dst->startup_sampled_time += add->startup_sampled_time;
 
 	/* Add delta of buffer usage since entry to node's totals */
 	if (dst->need_bufusage)
@@ -282,6 +348,8 @@ WalUsageAdd(WalUsage *dst, WalUsage *add)
 	dst->wal_fpi += add->wal_fpi;
 	dst->wal_fpi_bytes += add->wal_fpi_bytes;
 	dst->wal_buffers_full += add->wal_buffers_full;
+	dst->commit_delays += add->commit_delays;
+	dst->commit_delay_time += add->commit_delay_time;
 }
 
 void
@@ -292,4 +360,6 @@ WalUsageAccumDiff(WalUsage *dst, const WalUsage *add, const WalUsage *sub)
 	dst->wal_fpi += add->wal_fpi - sub->wal_fpi;
 	dst->wal_fpi_bytes += add->wal_fpi_bytes - sub->wal_fpi_bytes;
 	dst->wal_buffers_full += add->wal_buffers_full - sub->wal_buffers_full;
+	dst->commit_delays += add->commit_delays - sub->commit_delays;
+	dst->commit_delay_time += add->commit_delay_time - sub->commit_delay_time;
 }
@@ -214,6 +214,17 @@
  *	  As a particular tape is read, logtape.c recycles its disk space. When a
  *	  tape is read to completion, it is destroyed entirely.
  *
+ *	  Partial aggregation (see "aggsplit" above) has a cheaper way out: as its
+ *	  output is combined again by a Finalize Aggregate above, it may emit the
+ *	  same group more than once.  So if hash aggregation has absorbed few input
+ *	  tuples per group by the time it hits the limit, which means the groups
+ *	  are too many for aggregating in memory to reduce the input much, we
+ *	  enter "flush mode" instead of spill mode.  We stop reading input, emit
+ *	  all groups in the hash tables, reset them, and go on reading input (see
+ *	  agg_continue_hash_table()).  This matters for parallel aggregation with
+ *	  many groups, where spilling in each worker would mostly write out and
+ *	  re-read input that the leader will have to combine anyway.
+ *
  *	  Tapes' buffers can take up substantial memory when many tapes are open at
  *	  once. We only need one tape open at a time in read mode (using a buffer
  *	  that's a multiple of BLCKSZ); but we need one tape open in write mode (each
@@ -297,6 +308,13 @@
 #define HASHAGG_MIN_PARTITIONS 4
 #define HASHAGG_MAX_PARTITIONS 1024
 
+/*
+ * Partial aggregation flushes its hash tables rather than spilling if the
+ * groups in memory have absorbed fewer than this many input tuples each, on
+ * average, when the memory limit is hit.
+ */
+#define HASHAGG_FLUSH_MIN_REDUCTION 2.0
+
 /*
  * For reading from tapes, the buffer size must be a multiple of
  * BLCKSZ. Larger values help when reading from multiple tapes concurrently,
@@ -418,11 +436,14 @@ static void initialize_hash_entry(AggState *aggstate,
 static void lookup_hash_entries(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
 static void agg_fill_hash_table(AggState *aggstate);
+static void agg_continue_hash_table(AggState *aggstate);
 static bool agg_refill_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table_in_memory(AggState *aggstate);
 static void hash_agg_check_limits(AggState *aggstate);
+static bool hash_agg_reserve_memory(AggState *aggstate, Size total_mem);
 static void hash_agg_enter_spill_mode(AggState *aggstate);
+static bool hash_agg_can_flush(AggState *aggstate);
 static void hash_agg_update_metrics(AggState *aggstate, bool from_tape,
 									int npartitions);
 static void hashagg_finish_initial_spills(AggState *aggstate);
@@ -439,6 +460,8 @@ static Size hashagg_spill_tuple(AggState *aggstate, HashAggSpill *spill,
 static void hashagg_spill_finish(AggState *aggstate, HashAggSpill *spill,
 								 int setno);
 static Datum GetAggInitVal(Datum textInitVal, Oid transtype);
+static void build_pertrans_distinct_hash(AggState *aggstate,
+										 AggStatePerTrans pertrans);
 static void build_pertrans_for_aggref(AggStatePerTrans pertrans,
 									  AggState *aggstate, EState *estate,
 									  Aggref *aggref, Oid transfn_oid,
@@ -580,43 +603,22 @@ initialize_aggregate(AggState *aggstate, AggStatePerTrans pertrans,
 					 AggStatePerGroup pergroupstate)
 {
 	/*
-	 * Start a fresh sort operation for each DISTINCT/ORDER BY aggregate.
+	 * Start a fresh sort operation for each DISTINCT/ORDER BY aggregate, or
+	 * empty the hash table of a hashed DISTINCT aggregate.
 	 */
 	if (pertrans->aggsortrequired)
+		agg_begin_input_sort(pertrans, aggstate->current_set);
+	else if (pertrans->aggdistincthash)
 	{
-		/*
-		 * In case of rescan, maybe there could be an uncompleted sort
-		 * operation?  Clean it up if so.
-		 */
-		if (pertrans->sortstates[aggstate->current_set])
-			tuplesort_end(pertrans->sortstates[aggstate->current_set]);
-
+		int			setno = aggstate->current_set;
 
-		/*
-		 * We use a plain Datum sorter when there's a single input column;
-		 * otherwise sort the full tuple.  (See comments for
-		 * process_ordered_aggregate_single.)
-		 */
-		if (pertrans->numInputs == 1)
+		if (pertrans->sortstates[setno])
 		{
-			Form_pg_attribute attr = TupleDescAttr(pertrans->sortdesc, 0);
-
-			pertrans->sortstates[aggstate->current_set] =
-				tuplesort_begin_datum(attr->atttypid,
-									  pertrans->sortOperators[0],
-									  pertrans->sortCollations[0],
-									  pertrans->sortNullsFirst[0],
-									  work_mem, NULL, TUPLESORT_NONE);
+			tuplesort_end(pertrans->sortstates[setno]);
+			pertrans->sortstates[setno] = NULL;
 		}
-		else
-			pertrans->sortstates[aggstate->current_set] =
-				tuplesort_begin_heap(pertrans->sortdesc,
-									 pertrans->numSortCols,
-									 pertrans->sortColIdx,
-									 pertrans->sortOperators,
-									 pertrans->sortCollations,
-									 pertrans->sortNullsFirst,
-									 work_mem, NULL, TUPLESORT_NONE);
+		ResetTupleHashTable(pertrans->distincttables[setno]);
+		pertrans->distinctfull[setno] = false;
 	}
 
 	/*
@@ -820,6 +822,49 @@ advance_aggregates(AggState *aggstate)
 									  aggstate->tmpcontext);
 }
 
+/*
+ * Start a sort of the inputs of a DISTINCT or ORDER BY aggregate, for
+ * grouping set 'setno'.
+ *
+ * When called, CurrentMemoryContext should be the per-query context.
+ */
+void
+agg_begin_input_sort(AggStatePerTrans pertrans, int setno)
+{
+	/*
+	 * In case of rescan, maybe there could be an uncompleted sort operation?
+	 * Clean it up if so.
+	 */
+	if (pertrans->sortstates[setno])
+		tuplesort_end(pertrans->sortstates[setno]);
+
+	/*
+	 * We use a plain Datum sorter when there's a single input column;
+	 * otherwise sort the full tuple.  (See comments for
+	 * process_ordered_aggregate_single.)
+	 */
+	if (pertrans->numInputs == 1)
+	{
+		Form_pg_attribute attr = TupleDescAttr(pertrans->sortdesc, 0);
+
+		pertrans->sortstates[setno] =
+			tuplesort_begin_datum(attr->atttypid,
+								  pertrans->sortOperators[0],
+								  pertrans->sortCollations[0],
+								  pertrans->sortNullsFirst[0],
+								  work_mem, NULL, TUPLESORT_NONE);
+	}
+	else
+		pertrans->sortstates[setno] =
+			tuplesort_begin_heap(pertrans->sortdesc,
+								 pertrans->numSortCols,
+								 pertrans->sortColIdx,
+								 pertrans->sortOperators,
+								 pertrans->sortCollations,
+								 pertrans->sortNullsFirst,
+								 work_mem, NULL, TUPLESORT_NONE);
+}
+
 /*
  * Run the transition function for a DISTINCT or ORDER BY aggregate
  * with only one input.  This is called after we have completed
@@ -1300,7 +1345,9 @@ finalize_aggregates(AggState *aggstate,
 
 	/*
 	 * If there were any DISTINCT and/or ORDER BY aggregates, sort their
-	 * inputs and run the transition functions.
+	 * inputs and run the transition functions.  Hashed DISTINCT aggregates
+	 * have already seen their inputs, unless the hash table filled up and
+	 * the rest had to be sorted.
 	 */
 	for (int transno = 0; transno < aggstate->numtrans; transno++)
 	{
@@ -1309,7 +1356,9 @@ finalize_aggregates(AggState *aggstate,
 
 		pergroupstate = &pergroup[transno];
 
-		if (pertrans->aggsortrequired)
+		if (pertrans->aggsortrequired ||
+			(pertrans->aggdistincthash &&
+			 pertrans->sortstates[aggstate->current_set] != NULL))
 		{
 			Assert(aggstate->aggstrategy != AGG_HASHED &&
 				   aggstate->aggstrategy != AGG_MIXED);
@@ -1890,13 +1939,65 @@ hash_agg_check_limits(AggState *aggstate)
 	 */
 	if (aggstate->hash_ngroups_current > 0 &&
 		(total_mem > aggstate->hash_mem_limit ||
-		 ngroups > aggstate->hash_ngroups_limit))
+		 ngroups > aggstate->hash_ngroups_limit ||
+		 !hash_agg_reserve_memory(aggstate, total_mem)))
 	{
 		do_spill = true;
 	}
 
 	if (do_spill)
-		hash_agg_enter_spill_mode(aggstate);
+	{
+		if (hash_agg_can_flush(aggstate))
+		{
+			aggstate->hash_flush_mode = true;
+			aggstate->hash_ever_flushed = true;
+		}
+		else
+			hash_agg_enter_spill_mode(aggstate);
+	}
+}
+
+/*
+ * hash_agg_reserve_memory
+ *
+ * Make sure that total_mem, which is within hash_mem_limit, is reserved from
+ * the query memory budget.  We reserve in steps of doubling.  Returns false
+ * if the budget is exhausted, in which case we spill as if we had reached
+ * hash_mem_limit.
+ */
+static bool
+hash_agg_reserve_memory(AggState *aggstate, Size total_mem)
+{
+	MemoryGrant *grant = &aggstate->hash_mem_grant;
+	Size		target;
+
+	if (total_mem <= grant->size)
+		return true;
+
+	target = Max(total_mem, grant->size * 2);
+	target = Min(target, aggstate->hash_mem_limit);
+
+	return MemoryGrantExtend(grant, target,
+							 Min(target, QUERY_MEMORY_MIN_GRANT)) >= total_mem;
+}
+
+/*
+ * Should we enter "flush mode" rather than "spill mode"?
+ *
+ * That's only possible for partial aggregation, whose groups get combined
+ * again above us, while we're reading the outer plan.  It's worthwhile if
+ * aggregation hasn't reduced the input much so far.
+ */
+static bool
+hash_agg_can_flush(AggState *aggstate)
+{
+	if (!DO_AGGSPLIT_SKIPFINAL(aggstate->aggsplit) ||
+		aggstate->aggstrategy != AGG_HASHED ||
+		aggstate->hash_ever_spilled)
+		return false;
+
+	return aggstate->hash_ntuples_current <
+		HASHAGG_FLUSH_MIN_REDUCTION * aggstate->hash_ngroups_current;
 }
 
 /*
@@ -2641,6 +2742,7 @@ agg_fill_hash_table(AggState *aggstate)
 
 		/* set up for lookup_hash_entries and advance_aggregates */
 		tmpcontext->ecxt_outertuple = outerslot;
+		aggstate->hash_ntuples_current++;
 
 		/* Find or build hashtable entries */
 		lookup_hash_entries(aggstate);
@@ -2653,6 +2755,10 @@ agg_fill_hash_table(AggState *aggstate)
 		 * hash lookups do this too
 		 */
 		ResetExprContext(aggstate->tmpcontext);
+
+		/* emit the groups so far, if the hash tables are full */
+		if (aggstate->hash_flush_mode)
+			break;
 	}
 
 	/* finalize spills, if any */
@@ -2824,12 +2930,37 @@ agg_refill_hash_table(AggState *aggstate)
 	return true;
 }
 
+/*
+ * After all groups of a partial aggregation pass that stopped in flush mode
+ * have been emitted, reset the hash tables and resume reading the outer
+ * plan.
+ */
+static void
+agg_continue_hash_table(AggState *aggstate)
+{
+	Assert(aggstate->hash_flush_mode);
+
+	/* free memory and reset hash tables */
+	ReScanExprContext(aggstate->hashcontext);
+	for (int setno = 0; setno < aggstate->num_hashes; setno++)
+		ResetTupleHashTable(aggstate->perhash[setno].hashtable);
+
+	aggstate->hash_ngroups_current = 0;
+	aggstate->hash_ntuples_current = 0;
+	aggstate->hash_flush_mode = false;
+
+	/* each pass over the hash tables counts as a batch */
+	aggstate->hash_batches_used++;
+
+	agg_fill_hash_table(aggstate);
+}
+
 /*
  * ExecAgg for hashed case: retrieving groups from hash table
  *
  * After exhausting in-memory tuples, also try refilling the hash table using
- * previously-spilled tuples. Only returns NULL after all in-memory and
- * spilled tuples are exhausted.
+ * more input, if the tables were flushed, or previously-spilled tuples. Only
+ * returns NULL after all in-memory and spilled tuples are exhausted.
  */
 static TupleTableSlot *
 agg_retrieve_hash_table(AggState *aggstate)
@@ -2841,7 +2972,9 @@ agg_retrieve_hash_table(AggState *aggstate)
 		result = agg_retrieve_hash_table_in_memory(aggstate);
 		if (result == NULL)
 		{
-			if (!agg_refill_hash_table(aggstate))
+			if (aggstate->hash_flush_mode)
+				agg_continue_hash_table(aggstate);
+			else if (!agg_refill_hash_table(aggstate))
 			{
 				aggstate->agg_done = true;
 				break;
@@ -4015,6 +4148,18 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 										  aggTransFnInputTypes,
 										  numAggTransFnArgs);
 
+				/*
+				 * A DISTINCT aggregate may be able to use a hash table
+				 * instead of sorting its input; see
+				 * build_pertrans_distinct_hash.
+				 */
+				if (pertrans->aggsortrequired &&
+					pertrans->numDistinctCols > 0 &&
+					aggref->aggorder == NIL &&
+					pertrans->transtypeByVal &&
+					OidIsValid(aggform->aggcombinefn))
+					build_pertrans_distinct_hash(aggstate, pertrans);
+
 				/*
 				 * If the transfn is strict and the initval is NULL, make sure
 				 * input type and transtype are the same (or at least
@@ -4374,6 +4519,94 @@ build_pertrans_for_aggref(AggStatePerTrans pertrans,
 }
 
 
+/*
+ * Set up a DISTINCT aggregate to eliminate duplicates by hashing.
+ *
+ * Normally the input of each group is sorted, and the transition function
+ * is run on the sorted values, skipping adjacent duplicates.  It's much
+ * cheaper to remember the values seen so far in a hash table, and run the
+ * transition function on each new one as it arrives, especially when there
+ * are several DISTINCT aggregates over different inputs in the query, each
+ * of which would need a sort of its own.  But that doesn't present the
+ * values to the transition function in sorted order, and queries like
+ * "SELECT array_agg(DISTINCT x)" commonly rely on that, even though no
+ * order is promised without an ORDER BY.
+ *
+ * So the caller only tries this for aggregates that can't tell the
+ * difference: those without an ORDER BY, whose transition state is passed
+ * by value and so can't be a collection of the inputs, and that have a
+ * combine function, meaning that their input may be divided up and
+ * processed in any order anyway.  That takes in count(), min(), max(),
+ * sum() of the integer types, bool_and() and the like.  Here we just have
+ * to check that all the DISTINCT columns are hashable.
+ */
+static void
+build_pertrans_distinct_hash(AggState *aggstate, AggStatePerTrans pertrans)
+{
+	int			numGroupingSets = Max(aggstate->maxsets, 1);
+	int			numDistinctCols = pertrans->numDistinctCols;
+	Oid		   *eqops;
+	Oid		   *eqfuncoids;
+	FmgrInfo   *hashfunctions;
+	ListCell   *lc;
+	int			i;
+
+	Assert(aggstate->aggstrategy != AGG_HASHED &&
+		   aggstate->aggstrategy != AGG_MIXED);
+
+	eqops = palloc_array(Oid, numDistinctCols);
+
+	i = 0;
+	foreach(lc, pertrans->aggref->aggdistinct)
+	{
+		SortGroupClause *sortcl = (SortGroupClause *) lfirst(lc);
+
+		if (!sortcl->hashable)
+		{
+			pfree(eqops);
+			return;
+		}
+		eqops[i++] = sortcl->eqop;
+	}
+	Assert(i == numDistinctCols);
+
+	execTuplesHashPrepare(numDistinctCols, eqops,
+						  &eqfuncoids, &hashfunctions);
+
+	pertrans->distincttables = palloc_array(TupleHashTable, numGroupingSets);
+	pertrans->distinctfull = palloc0_array(bool, numGroupingSets);
+
+	for (int setno = 0; setno < numGroupingSets; setno++)
+	{
+		MemoryContext tuplescxt;
+
+		tuplescxt = AllocSetContextCreate(CurrentMemoryContext,
+										  "AggDistinct",
+										  ALLOCSET_DEFAULT_SIZES);
+
+		pertrans->distincttables[setno] =
+			BuildTupleHashTable(&aggstate->ss.ps,
+								pertrans->sortdesc,
+								NULL,
+								numDistinctCols,
+								pertrans->sortColIdx,
+								eqfuncoids,
+								hashfunctions,
+								pertrans->sortCollations,
+								64,
+								0,
+								CurrentMemoryContext,
+								tuplescxt,
+								aggstate->tmpcontext->ecxt_per_tuple_memory,
+								false);
+	}
+
+	pfree(eqops);
+
+	pertrans->aggsortrequired = false;
+	pertrans->aggdistincthash = true;
+}
+
 static Datum
 GetAggInitVal(Datum textInitVal, Oid transtype)
 {
@@ -4424,6 +4657,7 @@ ExecEndAgg(AggState *node)
 	hashagg_reset_spill_state(node);
 
 	/* Release hash tables too */
+	MemoryGrantRelease(&node->hash_mem_grant);
 	if (node->hash_metacxt != NULL)
 	{
 		MemoryContextDelete(node->hash_metacxt);
@@ -4487,6 +4721,7 @@ ExecReScanAgg(AggState *node)
 		 * again.
 		 */
 		if (outerPlan->chgParam == NULL && !node->hash_ever_spilled &&
+			!node->hash_ever_flushed &&
 			!bms_overlap(node->ss.ps.chgParam, aggnode->aggParams))
 		{
 			ResetTupleHashIterator(node->perhash[0].hashtable,
@@ -4548,6 +4783,9 @@ ExecReScanAgg(AggState *node)
 		node->hash_ever_spilled = false;
 		node->hash_spill_mode = false;
 		node->hash_ngroups_current = 0;
+		node->hash_ever_flushed = false;
+		node->hash_flush_mode = false;
+		node->hash_ntuples_current = 0;
 
 		ReScanExprContext(node->hashcontext);
 		/* Rebuild empty hash table(s) */
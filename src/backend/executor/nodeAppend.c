@@ -61,6 +61,7 @@
 #include "executor/execPartition.h"
 #include "executor/executor.h"
 #include "executor/nodeAppend.h"
+#include "executor/nodeSeqscan.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "storage/latch.h"
@@ -83,11 +84,15 @@ struct ParallelAppendState
 #define INVALID_SUBPLAN_INDEX		-1
 #define EVENT_BUFFER_SIZE			16
 
+/* GUC variable: upcoming subplans to start reading early, 0 disables */
+int			append_prefetch_subplans = 0;
+
 static TupleTableSlot *ExecAppend(PlanState *pstate);
 static bool choose_next_subplan_locally(AppendState *node);
 static bool choose_next_subplan_for_leader(AppendState *node);
 static bool choose_next_subplan_for_worker(AppendState *node);
 static void mark_invalid_subplans_as_finished(AppendState *node);
+static void prefetch_next_subplans(AppendState *node);
 static void ExecAppendAsyncBegin(AppendState *node);
 static bool ExecAppendAsyncGetNext(AppendState *node, TupleTableSlot **result);
 static bool ExecAppendAsyncRequest(AppendState *node, TupleTableSlot **result);
@@ -134,6 +139,12 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 	appendstate->as_syncdone = false;
 	appendstate->as_begun = false;
 
+	/* Reading subplans early only pays off when they run in order */
+	if ((eflags & EXEC_FLAG_BACKWARD) == 0)
+		appendstate->as_prefetch_subplans = append_prefetch_subplans;
+	else
+		appendstate->as_prefetch_subplans = 0;
+
 	/* If run-time partition pruning is enabled, then set that up now */
 	if (node->part_prune_index >= 0)
 	{
@@ -620,9 +631,44 @@ choose_next_subplan_locally(AppendState *node)
 
 	node->as_whichplan = nextplan;
 
+	if (node->as_prefetch_subplans > 0 &&
+		ScanDirectionIsForward(node->ps.state->es_direction))
+		prefetch_next_subplans(node);
+
 	return true;
 }
 
+/* ----------------------------------------------------------------
+ *		prefetch_next_subplans
+ *
+ *		Let the subplans following the current one start their I/O,
+ *		so that reads for several partitions are in flight at once
+ *		rather than each partition's scan starting cold.  Only plain
+ *		sequential scans know how to do that at present; other
+ *		subplans are skipped.  Subplans that have already started are
+ *		left alone by the callee, so it's fine to call this again for
+ *		the same subplans.
+ * ----------------------------------------------------------------
+ */
+static void
+prefetch_next_subplans(AppendState *node)
+{
+	int			i = node->as_whichplan;
+
+	for (int n = 0; n < node->as_prefetch_subplans; n++)
+	{
+		PlanState  *subnode;
+
+		i = bms_next_member(node->as_valid_subplans, i);
+		if (i < 0)
+			break;
+
+		subnode = node->appendplans[i];
+		if (IsA(subnode, SeqScanState))
+			ExecSeqScanPrefetch((SeqScanState *) subnode);
+	}
+}
+
 /* ----------------------------------------------------------------
  *		choose_next_subplan_for_leader
  *
@@ -42,16 +42,29 @@
 #include "access/visibilitymap.h"
 #include "executor/executor.h"
 #include "executor/nodeBitmapHeapscan.h"
+#include "executor/nodeBitmapIndexscan.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "storage/bufmgr.h"
 #include "utils/rel.h"
 #include "utils/spccache.h"
 
+/*
+ * A bitmap built by one participant of a parallel build, waiting to be merged.
+ * These form a list headed by ParallelBitmapHeapState->partial.
+ */
+typedef struct BitmapPartial
+{
+	dsa_pointer bitmap;			/* from tbm_prepare_shared_iterate */
+	dsa_pointer next;			/* next BitmapPartial, or InvalidDsaPointer */
+} BitmapPartial;
+
 static void BitmapTableScanSetup(BitmapHeapScanState *node);
 static TupleTableSlot *BitmapHeapNext(BitmapHeapScanState *node);
 static inline void BitmapDoneInitializingSharedState(ParallelBitmapHeapState *pstate);
 static bool BitmapShouldInitializeSharedState(ParallelBitmapHeapState *pstate);
+static void BitmapSetupParallelBuild(BitmapHeapScanState *node);
+static void BitmapBuildInParallel(BitmapHeapScanState *node);
 
 
 /*
@@ -73,6 +86,8 @@ BitmapTableScanSetup(BitmapHeapScanState *node)
 		if (!node->tbm || !IsA(node->tbm, TIDBitmap))
 			elog(ERROR, "unrecognized result from subplan");
 	}
+	else if (node->parallel_build)
+		BitmapBuildInParallel(node);
 	else if (BitmapShouldInitializeSharedState(pstate))
 	{
 		/*
@@ -360,6 +375,7 @@ ExecInitBitmapHeapScan(BitmapHeapScan *node, EState *estate, int eflags)
 	scanstate->initialized = false;
 	scanstate->pstate = NULL;
 	scanstate->recheck = true;
+	scanstate->parallel_build = false;
 
 	/*
 	 * Miscellaneous initialization
@@ -442,6 +458,157 @@ BitmapShouldInitializeSharedState(ParallelBitmapHeapState *pstate)
 	return (state == BM_INITIAL);
 }
 
+/*
+ * BitmapSetupParallelBuild
+ *
+ *		Decide whether all participants can build the bitmap together, each
+ *		from its share of the index scans, rather than leaving it all to
+ *		the first one.  That works if the bitmap is the union of the index
+ *		scans' TIDs, that is if the child is a BitmapIndexScan or a BitmapOr
+ *		of them, but not with a BitmapAnd, whose inputs must be complete
+ *		before they are intersected.
+ */
+static void
+BitmapSetupParallelBuild(BitmapHeapScanState *node)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+	PlanState **scans;
+	int			nscans;
+
+	if (IsA(outerPlan, BitmapIndexScanState))
+	{
+		scans = &outerPlanState(node);
+		nscans = 1;
+	}
+	else if (IsA(outerPlan, BitmapOrState))
+	{
+		scans = ((BitmapOrState *) outerPlan)->bitmapplans;
+		nscans = ((BitmapOrState *) outerPlan)->nplans;
+	}
+	else
+		return;
+
+	for (int i = 0; i < nscans; i++)
+	{
+		if (!IsA(scans[i], BitmapIndexScanState) ||
+			!ExecBitmapIndexScanCanBuildInParallel((BitmapIndexScanState *) scans[i]))
+			return;
+	}
+
+	for (int i = 0; i < nscans; i++)
+		((BitmapIndexScanState *) scans[i])->biss_ParallelBuild = true;
+	node->parallel_build = true;
+}
+
+/*
+ * BitmapBuildInParallel
+ *
+ *		Build the bitmap together with the other participants.
+ *
+ * Every participant that arrives while the build is still going on scans a
+ * share of the index and builds a bitmap of its own.  When done, it adds that
+ * to a list of partial bitmaps in the DSA, except for the last one to finish,
+ * which merges them all into its own bitmap and prepares that for shared
+ * iteration.  The others wait for that to be done, and so do participants
+ * that arrive too late to help.
+ */
+static void
+BitmapBuildInParallel(BitmapHeapScanState *node)
+{
+	ParallelBitmapHeapState *pstate = node->pstate;
+	dsa_area   *dsa = node->ss.ps.state->es_query_dsa;
+	TIDBitmap  *tbm;
+	SharedBitmapState state;
+	dsa_pointer partial;
+	bool		last;
+
+	SpinLockAcquire(&pstate->mutex);
+	if (pstate->state == BM_INITIAL)
+		pstate->state = BM_BUILDING;
+	state = pstate->state;
+	if (state == BM_BUILDING)
+		pstate->nbuilders++;
+	SpinLockRelease(&pstate->mutex);
+
+	if (state == BM_BUILDING)
+	{
+		tbm = (TIDBitmap *) MultiExecProcNode(outerPlanState(node));
+		if (!tbm || !IsA(tbm, TIDBitmap))
+			elog(ERROR, "unrecognized result from subplan");
+
+		/* If nobody else is still building, we can skip publishing ours */
+		SpinLockAcquire(&pstate->mutex);
+		last = (pstate->nbuilders == 1);
+		if (last)
+		{
+			pstate->nbuilders = 0;
+			pstate->state = BM_INPROGRESS;
+		}
+		SpinLockRelease(&pstate->mutex);
+
+		if (!last)
+		{
+			BitmapPartial *entry;
+
+			partial = dsa_allocate(dsa, sizeof(BitmapPartial));
+			entry = dsa_get_address(dsa, partial);
+			entry->bitmap = tbm_prepare_shared_iterate(tbm);
+			tbm_free(tbm);
+
+			/*
+			 * Whoever adds the last partial bitmap has to merge them; that may
+			 * be us, if the others finished meanwhile.
+			 */
+			SpinLockAcquire(&pstate->mutex);
+			entry->next = pstate->partial;
+			pstate->partial = partial;
+			last = (--pstate->nbuilders == 0);
+			if (last)
+				pstate->state = BM_INPROGRESS;
+			SpinLockRelease(&pstate->mutex);
+
+			if (last)
+				tbm = tbm_create(work_mem * (Size) 1024, dsa);
+		}
+
+		if (last)
+		{
+			/* nobody else touches the list now */
+			partial = pstate->partial;
+			pstate->partial = InvalidDsaPointer;
+			while (DsaPointerIsValid(partial))
+			{
+				BitmapPartial *entry = dsa_get_address(dsa, partial);
+				dsa_pointer next = entry->next;
+
+				tbm_union_shared(tbm, dsa, entry->bitmap);
+				tbm_free_shared_area(dsa, entry->bitmap);
+				dsa_free(dsa, partial);
+				partial = next;
+				CHECK_FOR_INTERRUPTS();
+			}
+
+			node->tbm = tbm;
+			pstate->tbmiterator = tbm_prepare_shared_iterate(tbm);
+			BitmapDoneInitializingSharedState(pstate);
+			return;
+		}
+	}
+
+	/* Wait for the last participant to finish the bitmap */
+	for (;;)
+	{
+		SpinLockAcquire(&pstate->mutex);
+		state = pstate->state;
+		SpinLockRelease(&pstate->mutex);
+
+		if (state == BM_FINISHED)
+			break;
+		ConditionVariableSleep(&pstate->cv, WAIT_EVENT_PARALLEL_BITMAP_SCAN);
+	}
+	ConditionVariableCancelSleep();
+}
+
 /* ----------------------------------------------------------------
  *		ExecBitmapHeapEstimate
  *
@@ -455,6 +622,8 @@ ExecBitmapHeapEstimate(BitmapHeapScanState *node,
 {
 	Size		size;
 
+	BitmapSetupParallelBuild(node);
+
 	size = MAXALIGN(sizeof(ParallelBitmapHeapState));
 
 	/* account for instrumentation, if required */
@@ -506,6 +675,8 @@ ExecBitmapHeapInitializeDSM(BitmapHeapScanState *node,
 	/* Initialize the mutex */
 	SpinLockInit(&pstate->mutex);
 	pstate->state = BM_INITIAL;
+	pstate->nbuilders = 0;
+	pstate->partial = InvalidDsaPointer;
 
 	ConditionVariableInit(&pstate->cv);
 
@@ -541,6 +712,8 @@ ExecBitmapHeapReInitializeDSM(BitmapHeapScanState *node,
 		return;
 
 	pstate->state = BM_INITIAL;
+	pstate->nbuilders = 0;
+	Assert(!DsaPointerIsValid(pstate->partial));
 
 	if (DsaPointerIsValid(pstate->tbmiterator))
 		tbm_free_shared_area(dsa, pstate->tbmiterator);
@@ -567,6 +740,9 @@ ExecBitmapHeapInitializeWorker(BitmapHeapScanState *node,
 	node->pstate = (ParallelBitmapHeapState *) ptr;
 	ptr += MAXALIGN(sizeof(ParallelBitmapHeapState));
 
+	/* this must come out the same as in the leader */
+	BitmapSetupParallelBuild(node);
+
 	if (node->ss.ps.instrument)
 		node->sinstrument = (SharedBitmapHeapInstrumentation *) ptr;
 }
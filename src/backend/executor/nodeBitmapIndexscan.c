@@ -18,15 +18,21 @@
  *		ExecInitBitmapIndexScan		creates and initializes state info.
  *		ExecReScanBitmapIndexScan	prepares to rescan the plan.
  *		ExecEndBitmapIndexScan		releases all storage.
+ *		ExecBitmapIndexScanCanBuildInParallel	can participants share
+ *									the index scan?
  */
 #include "postgres.h"
 
 #include "access/genam.h"
+#include "access/relscan.h"
 #include "executor/executor.h"
 #include "executor/nodeBitmapIndexscan.h"
 #include "executor/nodeIndexscan.h"
 #include "miscadmin.h"
+#include "utils/rel.h"
 
+static void ExecBitmapIndexScanBeginParallel(BitmapIndexScanState *node,
+											 ParallelIndexScanDesc piscan);
 
 /* ----------------------------------------------------------------
  *		ExecBitmapIndexScan
@@ -342,6 +348,49 @@ ExecInitBitmapIndexScan(BitmapIndexScan *node, EState *estate, int eflags)
 	return indexstate;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecBitmapIndexScanCanBuildInParallel
+ *
+ *		Can the participants of a parallel bitmap heap scan each scan
+ *		part of the index, so that together they produce the whole
+ *		bitmap?  This needs a parallel scan of the index AM, which can't
+ *		cope with array keys that we advance ourselves.  If so, the
+ *		parent sets biss_ParallelBuild before parallel initialization.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecBitmapIndexScanCanBuildInParallel(BitmapIndexScanState *node)
+{
+	return node->biss_RelationDesc != NULL &&
+		node->biss_RelationDesc->rd_indam->amcanparallel &&
+		node->biss_NumArrayKeys == 0;
+}
+
+/*
+ * Switch to a scan descriptor that shares the index scan with the other
+ * participants.
+ */
+static void
+ExecBitmapIndexScanBeginParallel(BitmapIndexScanState *node,
+								 ParallelIndexScanDesc piscan)
+{
+	index_endscan(node->biss_ScanDesc);
+	node->biss_ScanDesc =
+		index_beginscan_parallel_bitmap(node->biss_RelationDesc,
+										&node->biss_Instrument,
+										node->biss_NumScanKeys,
+										piscan);
+
+	/*
+	 * If no run-time keys to calculate or they are ready, go ahead and pass
+	 * the scankeys to the index AM.
+	 */
+	if (node->biss_NumRuntimeKeys == 0 || node->biss_RuntimeKeysReady)
+		index_rescan(node->biss_ScanDesc,
+					 node->biss_ScanKeys, node->biss_NumScanKeys,
+					 NULL, 0);
+}
+
 /* ----------------------------------------------------------------
  *		ExecBitmapIndexScanEstimate
  *
@@ -354,9 +403,22 @@ ExecBitmapIndexScanEstimate(BitmapIndexScanState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
+	if (node->biss_ParallelBuild)
+	{
+		node->biss_PscanLen =
+			index_parallelscan_estimate(node->biss_RelationDesc,
+										node->biss_NumScanKeys, 0,
+										node->ss.ps.state->es_snapshot,
+										node->ss.ps.instrument != NULL,
+										true, pcxt->nworkers);
+		shm_toc_estimate_chunk(&pcxt->estimator, node->biss_PscanLen);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+		return;
+	}
+
 	/*
-	 * Parallel bitmap index scans are not supported, but we still need to
-	 * store the scan's instrumentation in DSM during parallel query
+	 * Otherwise, we only need to store the scan's instrumentation in DSM
+	 * during parallel query
 	 */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
@@ -370,7 +432,8 @@ ExecBitmapIndexScanEstimate(BitmapIndexScanState *node, ParallelContext *pcxt)
 /* ----------------------------------------------------------------
  *		ExecBitmapIndexScanInitializeDSM
  *
- *		Set up bitmap index scan shared instrumentation.
+ *		Set up bitmap index scan shared instrumentation, and the
+ *		parallel index scan descriptor if the scan is shared.
  * ----------------------------------------------------------------
  */
 void
@@ -379,6 +442,27 @@ ExecBitmapIndexScanInitializeDSM(BitmapIndexScanState *node,
 {
 	Size		size;
 
+	if (node->biss_ParallelBuild)
+	{
+		EState	   *estate = node->ss.ps.state;
+		BitmapIndexScan *plan = (BitmapIndexScan *) node->ss.ps.plan;
+		ParallelIndexScanDesc piscan;
+
+		piscan = shm_toc_allocate(pcxt->toc, node->biss_PscanLen);
+		index_parallelscan_initialize(ExecGetRangeTableRelation(estate,
+																plan->scan.scanrelid,
+																false),
+									  node->biss_RelationDesc,
+									  estate->es_snapshot,
+									  node->ss.ps.instrument != NULL,
+									  true, pcxt->nworkers,
+									  &node->biss_SharedInfo, piscan);
+		shm_toc_insert(pcxt->toc, plan->scan.plan.plan_node_id, piscan);
+
+		ExecBitmapIndexScanBeginParallel(node, piscan);
+		return;
+	}
+
 	/* don't need this if not instrumenting or no workers */
 	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
 		return;
@@ -396,6 +480,20 @@ ExecBitmapIndexScanInitializeDSM(BitmapIndexScanState *node,
 	node->biss_SharedInfo->num_workers = pcxt->nworkers;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecBitmapIndexScanReInitializeDSM
+ *
+ *		Reset shared state before beginning a fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecBitmapIndexScanReInitializeDSM(BitmapIndexScanState *node,
+								   ParallelContext *pcxt)
+{
+	if (node->biss_ParallelBuild)
+		index_parallelrescan(node->biss_ScanDesc);
+}
+
 /* ----------------------------------------------------------------
  *		ExecBitmapIndexScanInitializeWorker
  *
@@ -406,6 +504,20 @@ void
 ExecBitmapIndexScanInitializeWorker(BitmapIndexScanState *node,
 									ParallelWorkerContext *pwcxt)
 {
+	if (node->biss_ParallelBuild)
+	{
+		ParallelIndexScanDesc piscan;
+
+		piscan = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id,
+								false);
+		if (node->ss.ps.instrument)
+			node->biss_SharedInfo = (SharedIndexScanInstrumentation *)
+				OffsetToPointer(piscan, piscan->ps_offset_ins);
+
+		ExecBitmapIndexScanBeginParallel(node, piscan);
+		return;
+	}
+
 	/* don't need this if not instrumenting */
 	if (!node->ss.ps.instrument)
 		return;
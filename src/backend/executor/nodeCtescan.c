@@ -15,11 +15,24 @@
 
 #include "postgres.h"
 
+#include "access/htup_details.h"
 #include "executor/executor.h"
 #include "executor/nodeCtescan.h"
 #include "miscadmin.h"
 
+/*
+ * Shared state of a parallel-aware CteScan.  The leader process copies the
+ * whole CTE into a shared tuplestore before the workers start, and then all
+ * the participants read chunks of it, much like a Parallel Seq Scan.
+ */
+typedef struct ParallelCteScanState
+{
+	SharedFileSet fileset;		/* space for the shared tuplestore's files */
+	char		sts[FLEXIBLE_ARRAY_MEMBER]; /* SharedTuplestore */
+} ParallelCteScanState;
+
 static TupleTableSlot *CteScanNext(CteScanState *node);
+static TupleTableSlot *CteScanParallelNext(CteScanState *node);
 
 /* ----------------------------------------------------------------
  *		CteScanNext
@@ -138,6 +151,25 @@ CteScanNext(CteScanState *node)
 	return ExecClearTuple(slot);
 }
 
+/* ----------------------------------------------------------------
+ *		CteScanParallelNext
+ *
+ *		Fetch the next tuple from the shared copy of the CTE
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+CteScanParallelNext(CteScanState *node)
+{
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	MinimalTuple tuple;
+
+	tuple = sts_parallel_scan_next(node->sts, NULL);
+	if (tuple == NULL)
+		return ExecClearTuple(slot);
+
+	return ExecStoreMinimalTuple(tuple, slot, false);
+}
+
 /*
  * CteScanRecheck -- access method routine to recheck a tuple in EvalPlanQual
  */
@@ -161,6 +193,16 @@ ExecCteScan(PlanState *pstate)
 {
 	CteScanState *node = castNode(CteScanState, pstate);
 
+	/*
+	 * A parallel-aware scan reads the shared copy if there is one; there
+	 * isn't if the Gather above us ended up running the plan without a
+	 * parallel context, in which case we read the CTE the usual way.
+	 */
+	if (node->sts != NULL)
+		return ExecScan(&node->ss,
+						(ExecScanAccessMtd) CteScanParallelNext,
+						(ExecScanRecheckMtd) CteScanRecheck);
+
 	return ExecScan(&node->ss,
 					(ExecScanAccessMtd) CteScanNext,
 					(ExecScanRecheckMtd) CteScanRecheck);
@@ -176,6 +218,7 @@ ExecInitCteScan(CteScan *node, EState *estate, int eflags)
 {
 	CteScanState *scanstate;
 	ParamExecData *prmdata;
+	TupleDesc	scandesc;
 
 	/* check for unsupported flags */
 	Assert(!(eflags & EXEC_FLAG_MARK));
@@ -210,6 +253,7 @@ ExecInitCteScan(CteScan *node, EState *estate, int eflags)
 	scanstate->eflags = eflags;
 	scanstate->cte_table = NULL;
 	scanstate->eof_cte = false;
+	scanstate->sts = NULL;
 
 	/*
 	 * Find the already-initialized plan for the CTE query.
@@ -227,7 +271,18 @@ ExecInitCteScan(CteScan *node, EState *estate, int eflags)
 	Assert(prmdata->execPlan == NULL);
 	Assert(!prmdata->isnull);
 	scanstate->leader = castNode(CteScanState, DatumGetPointer(prmdata->value));
-	if (scanstate->leader == NULL)
+	if (node->scan.plan.parallel_aware && IsParallelWorker())
+	{
+		/*
+		 * A parallel worker only reads the copy of the CTE that the leader
+		 * process put in shared memory, so it needs no tuplestore of its
+		 * own.  The CTE query is never run here, and in fact its plan is not
+		 * even available if it isn't parallel-safe.
+		 */
+		scanstate->leader = NULL;
+		scanstate->readptr = -1;
+	}
+	else if (scanstate->leader == NULL)
 	{
 		/* I am the leader */
 		prmdata->value = PointerGetDatum(scanstate);
@@ -257,10 +312,21 @@ ExecInitCteScan(CteScan *node, EState *estate, int eflags)
 
 	/*
 	 * The scan tuple type (ie, the rowtype we expect to find in the work
-	 * table) is the same as the result rowtype of the CTE query.
+	 * table) is the same as the result rowtype of the CTE query.  Without
+	 * the CTE query, build it from the column types in the RTE instead.
 	 */
-	ExecInitScanTupleSlot(estate, &scanstate->ss,
-						  ExecGetResultType(scanstate->cteplanstate),
+	if (scanstate->leader != NULL)
+		scandesc = ExecGetResultType(scanstate->cteplanstate);
+	else
+	{
+		RangeTblEntry *rte = exec_rt_fetch(node->scan.scanrelid, estate);
+
+		scandesc = BuildDescFromLists(rte->eref->colnames,
+									  rte->coltypes,
+									  rte->coltypmods,
+									  rte->colcollations);
+	}
+	ExecInitScanTupleSlot(estate, &scanstate->ss, scandesc,
 						  &TTSOpsMinimalTuple);
 
 	/*
@@ -306,13 +372,19 @@ ExecEndCteScan(CteScanState *node)
 void
 ExecReScanCteScan(CteScanState *node)
 {
-	Tuplestorestate *tuplestorestate = node->leader->cte_table;
+	Tuplestorestate *tuplestorestate;
 
 	if (node->ss.ps.ps_ResultTupleSlot)
 		ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
 
 	ExecScanReScan(&node->ss);
 
+	/* nothing more to do in a parallel worker, which has no tuplestore */
+	if (node->leader == NULL)
+		return;
+
+	tuplestorestate = node->leader->cte_table;
+
 	/*
 	 * Clear the tuplestore if a new scan of the underlying CTE is required.
 	 * This implicitly resets all the tuplestore's read pointers.  Note that
@@ -337,3 +409,133 @@ ExecReScanCteScan(CteScanState *node)
 		tuplestore_rescan(tuplestorestate);
 	}
 }
+
+/* ----------------------------------------------------------------
+ *						Parallel Scan Support
+ * ----------------------------------------------------------------
+ */
+
+/* ----------------------------------------------------------------
+ *		ExecCteScanEstimate
+ *
+ *		Compute the amount of space we'll need in the parallel
+ *		query DSM, and inform pcxt->estimator about our needs.
+ * ----------------------------------------------------------------
+ */
+void
+ExecCteScanEstimate(CteScanState *node, ParallelContext *pcxt)
+{
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   add_size(offsetof(ParallelCteScanState, sts),
+									sts_estimate(pcxt->nworkers + 1)));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecCteScanInitializeDSM
+ *
+ *		Copy the whole CTE into a shared tuplestore, so that the
+ *		workers can scan it.
+ * ----------------------------------------------------------------
+ */
+void
+ExecCteScanInitializeDSM(CteScanState *node, ParallelContext *pcxt)
+{
+	ParallelCteScanState *pstate;
+	char		name[MAXPGPATH];
+
+	pstate = shm_toc_allocate(pcxt->toc,
+							  add_size(offsetof(ParallelCteScanState, sts),
+									   sts_estimate(pcxt->nworkers + 1)));
+	SharedFileSetInit(&pstate->fileset, pcxt->seg);
+	snprintf(name, sizeof(name), "cte%d", node->ss.ps.plan->plan_node_id);
+
+	/* The leader process is participant 0, and the only writer */
+	node->sts = sts_initialize((SharedTuplestore *) pstate->sts,
+							   pcxt->nworkers + 1,
+							   0,
+							   0,
+							   0,
+							   &pstate->fileset,
+							   name);
+
+	/*
+	 * Run the CTE query to completion, through our own read pointer into the
+	 * CTE's tuplestore, so that other CteScans on the same CTE still see all
+	 * of its rows.
+	 */
+	for (;;)
+	{
+		TupleTableSlot *slot;
+		MinimalTuple tuple;
+		bool		shouldFree;
+
+		CHECK_FOR_INTERRUPTS();
+
+		slot = CteScanNext(node);
+		if (TupIsNull(slot))
+			break;
+
+		tuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+		sts_puttuple(node->sts, NULL, tuple);
+		if (shouldFree)
+			heap_free_minimal_tuple(tuple);
+	}
+	sts_end_write(node->sts);
+	sts_begin_parallel_scan(node->sts);
+
+	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pstate);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecCteScanReInitializeDSM
+ *
+ *		Reset shared state before beginning a fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecCteScanReInitializeDSM(CteScanState *node, ParallelContext *pcxt)
+{
+	/*
+	 * The CTE can't have changed, since we only get here for CTEs that
+	 * don't depend on any outer parameters, so just read it again.
+	 */
+	sts_reinitialize(node->sts);
+	sts_begin_parallel_scan(node->sts);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecCteScanInitializeWorker
+ *
+ *		Attach to the shared tuplestore the leader set up.
+ * ----------------------------------------------------------------
+ */
+void
+ExecCteScanInitializeWorker(CteScanState *node,
+							ParallelWorkerContext *pwcxt)
+{
+	ParallelCteScanState *pstate;
+
+	pstate = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, false);
+	node->sts = sts_attach((SharedTuplestore *) pstate->sts,
+						   ParallelWorkerNumber + 1,
+						   &pstate->fileset);
+	sts_begin_parallel_scan(node->sts);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecShutdownCteScan
+ *
+ *		Close our read file of the shared tuplestore before the DSM
+ *		segment goes away.
+ * ----------------------------------------------------------------
+ */
+void
+ExecShutdownCteScan(CteScanState *node)
+{
+	if (node->sts != NULL)
+	{
+		sts_end_parallel_scan(node->sts);
+		node->sts = NULL;
+	}
+}
@@ -116,6 +116,8 @@ ExecInitGather(Gather *node, EState *estate, int eflags)
 	 */
 	gatherstate->funnel_slot = ExecInitExtraTupleSlot(estate, tupDesc,
 													  &TTSOpsMinimalTuple);
+	gatherstate->worker_dest = PARALLEL_DEST_TUPLES;
+	gatherstate->worker_dest_info = NULL;
 
 	/*
 	 * Gather doesn't support checking a qual (it's always more efficient to
@@ -167,7 +169,9 @@ ExecGather(PlanState *pstate)
 												 estate,
 												 gather->initParam,
 												 gather->num_workers,
-												 node->tuples_needed);
+												 node->tuples_needed,
+												 node->worker_dest,
+												 node->worker_dest_info);
 			else
 				ExecParallelReinitialize(outerPlanState(node),
 										 node->pei,
@@ -390,6 +394,34 @@ gather_readnext(GatherState *gatherstate)
 	}
 }
 
+/* ----------------------------------------------------------------
+ *		ExecGatherSetWorkerDest
+ *
+ *		Make the workers pass the tuples they produce to a DestReceiver
+ *		of the given kind instead of sending them to us, so that they
+ *		share the work of the query's own DestReceiver.  That only makes
+ *		sense for a Gather at the top of the plan, without a projection.
+ *		'dest_info' is passed on to the workers, so it must be a node tree
+ *		that can be serialized.  If the workers still send something,
+ *		'dest_desc' describes their tuples; we return those in funnel_slot,
+ *		which lets the caller tell them from the tuples of the leader's own
+ *		share of the plan.  Must be called before the node first runs.
+ * ----------------------------------------------------------------
+ */
+void
+ExecGatherSetWorkerDest(GatherState *node, ParallelDestKind dest,
+						Node *dest_info, TupleDesc dest_desc)
+{
+	Assert(!node->initialized && node->pei == NULL);
+	Assert(node->ps.ps_ProjInfo == NULL);
+
+	node->worker_dest = dest;
+	node->worker_dest_info = dest_info;
+	if (dest_desc != NULL)
+		node->funnel_slot = ExecInitExtraTupleSlot(node->ps.state, dest_desc,
+												   &TTSOpsMinimalTuple);
+}
+
 /* ----------------------------------------------------------------
  *		ExecShutdownGatherWorkers
  *
@@ -34,6 +34,7 @@
 #include "executor/hashjoin.h"
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
+#include "lib/bloomfilter.h"
 #include "miscadmin.h"
 #include "port/pg_bitutils.h"
 #include "utils/lsyscache.h"
@@ -41,8 +42,16 @@
 #include "utils/syscache.h"
 #include "utils/wait_event.h"
 
+/* Number of tuples to prefetch buckets for at a time when rebuilding */
+#define HASH_PREFETCH_GROUP		16
+
+/* Hash tables smaller than this are assumed to be cached well enough */
+#define HASH_CLUSTER_MIN_SPACE	((Size) 8 * 1024 * 1024)
+
+static bool ExecHashReserveSpace(HashJoinTable hashtable, Size space);
 static void ExecHashIncreaseNumBatches(HashJoinTable hashtable);
 static void ExecHashIncreaseNumBuckets(HashJoinTable hashtable);
+static void ExecHashTableClusterBuckets(HashJoinTable hashtable);
 static void ExecParallelHashIncreaseNumBatches(HashJoinTable hashtable);
 static void ExecParallelHashIncreaseNumBuckets(HashJoinTable hashtable);
 static void ExecHashBuildSkewHash(HashState *hashstate,
@@ -140,6 +149,7 @@ MultiExecPrivateHash(HashState *node)
 	HashJoinTable hashtable;
 	TupleTableSlot *slot;
 	ExprContext *econtext;
+	bloom_filter *filter = NULL;
 
 	/*
 	 * get state info from node
@@ -152,6 +162,23 @@ MultiExecPrivateHash(HashState *node)
 	 */
 	econtext = node->ps.ps_ExprContext;
 
+	/*
+	 * If the hash join pushed a runtime filter down into its outer scan, fill
+	 * a Bloom filter with the hash values as we go.  It lives as long as the
+	 * hash table does.  It isn't published to the scan until it's complete,
+	 * since a partial filter would discard rows that do have a match.
+	 */
+	if (node->runtime_filter)
+	{
+		MemoryContext oldcxt;
+
+		Assert(node->runtime_filter->filter == NULL);
+		oldcxt = MemoryContextSwitchTo(hashtable->hashCxt);
+		filter = bloom_create_compact(Max(outerNode->plan->plan_rows, 1.0),
+									  work_mem, 0);
+		MemoryContextSwitchTo(oldcxt);
+	}
+
 	/*
 	 * Get all tuples from the node below the Hash node and insert into the
 	 * hash table (or temp files).
@@ -177,6 +204,9 @@ MultiExecPrivateHash(HashState *node)
 			uint32		hashvalue = DatumGetUInt32(hashdatum);
 			int			bucketNumber;
 
+			if (filter)
+				bloom_add_hash(filter, hashvalue);
+
 			bucketNumber = ExecHashGetSkewBucket(hashtable, hashvalue);
 			if (bucketNumber != INVALID_SKEW_BUCKET_NO)
 			{
@@ -204,6 +234,20 @@ MultiExecPrivateHash(HashState *node)
 		hashtable->spacePeak = hashtable->spaceUsed;
 
 	hashtable->partialTuples = hashtable->totalTuples;
+
+	/*
+	 * Store a large single-batch table in bucket order, if enabled and
+	 * there's room for the tuples to be copied.
+	 */
+	if (hashjoin_radix_partition &&
+		hashtable->nbatch == 1 && !hashtable->skewEnabled &&
+		hashtable->spaceUsed >= HASH_CLUSTER_MIN_SPACE &&
+		hashtable->spaceUsed * 2 <= hashtable->spaceAllowed &&
+		ExecHashReserveSpace(hashtable, hashtable->spaceUsed * 2))
+		ExecHashTableClusterBuckets(hashtable);
+
+	if (filter)
+		node->runtime_filter->filter = filter;
 }
 
 /* ----------------------------------------------------------------
@@ -506,6 +550,7 @@ ExecHashTableCreate(HashState *state)
 	hashtable->nbatch_original = nbatch;
 	hashtable->nbatch_outstart = nbatch;
 	hashtable->growEnabled = true;
+	hashtable->clustered = false;
 	hashtable->totalTuples = 0;
 	hashtable->partialTuples = 0;
 	hashtable->skewTuples = 0;
@@ -517,6 +562,13 @@ ExecHashTableCreate(HashState *state)
 	hashtable->spaceUsedSkew = 0;
 	hashtable->spaceAllowedSkew =
 		hashtable->spaceAllowed * SKEW_HASH_MEM_PERCENT / 100;
+	MemoryGrantInit(&hashtable->grant);
+	if (state->parallel_state == NULL)
+	{
+		Size		minimum = Min(space_allowed, QUERY_MEMORY_MIN_GRANT);
+
+		(void) MemoryGrantExtend(&hashtable->grant, minimum, minimum);
+	}
 	hashtable->chunks = NULL;
 	hashtable->current_chunk = NULL;
 	hashtable->parallel_state = state->parallel_state;
@@ -974,11 +1026,37 @@ ExecHashTableDestroy(HashJoinTable hashtable)
 
 	/* Release working memory (batchCxt is a child, so it goes away too) */
 	MemoryContextDelete(hashtable->hashCxt);
+	MemoryGrantRelease(&hashtable->grant);
 
 	/* And drop the control block */
 	pfree(hashtable);
 }
 
+/*
+ * ExecHashReserveSpace
+ *		Make sure the hash table may use 'space' bytes of memory
+ *
+ * The hash table may grow up to spaceAllowed, but the memory must also be
+ * reserved from the query memory budget.  We reserve in steps of doubling.
+ * Returns false if 'space' exceeds spaceAllowed or the budget, in which
+ * case the caller should act as if the table had run out of memory.
+ */
+static bool
+ExecHashReserveSpace(HashJoinTable hashtable, Size space)
+{
+	Size		target;
+
+	if (space <= hashtable->grant.size)
+		return true;
+	if (space > hashtable->spaceAllowed)
+		return false;
+
+	target = Max(space, hashtable->grant.size * 2);
+	target = Min(target, hashtable->spaceAllowed);
+
+	return MemoryGrantExtend(&hashtable->grant, target, 0) >= space;
+}
+
 /*
  * Consider adjusting the allowed hash table size, depending on the number
  * of batches, to minimize the overall memory usage (for both the hashtable
@@ -1010,8 +1088,25 @@ ExecHashIncreaseBatchSize(HashJoinTable hashtable)
 	 * We're either doubling spaceAllowed or batchSpace, so which of those
 	 * increases the memory usage the least is the same as comparing the
 	 * values directly.
+	 *
+	 * If we ran out of query memory budget before reaching spaceAllowed, the
+	 * memory we're actually allowed to use is the reserved amount, so double
+	 * that instead.  More batches would need the memory for their buffers
+	 * anyway, so we take it from the budget even if it's exhausted.
 	 */
-	if (hashtable->spaceAllowed <= batchSpace)
+	if (query_memory_budget > 0 &&
+		hashtable->grant.size < hashtable->spaceAllowed)
+	{
+		if (hashtable->grant.size <= batchSpace)
+		{
+			Size		newsize = hashtable->grant.size * 2;
+
+			(void) MemoryGrantExtend(&hashtable->grant, newsize, newsize);
+			hashtable->spaceAllowed = Max(hashtable->spaceAllowed, newsize);
+			return true;
+		}
+	}
+	else if (hashtable->spaceAllowed <= batchSpace)
 	{
 		hashtable->spaceAllowed *= 2;
 		return true;
@@ -1616,7 +1711,11 @@ ExecHashIncreaseNumBuckets(HashJoinTable hashtable)
 	memset(hashtable->buckets.unshared, 0,
 		   hashtable->nbuckets * sizeof(HashJoinTuple));
 
-	/* scan through all tuples in all chunks to rebuild the hash table */
+	/*
+	 * scan through all tuples in all chunks to rebuild the hash table.  The
+	 * buckets are accessed at random, so do it for HASH_PREFETCH_GROUP tuples
+	 * at a time, prefetching all of their buckets before linking them in.
+	 */
 	for (chunk = hashtable->chunks; chunk != NULL; chunk = chunk->next.unshared)
 	{
 		/* process all tuples stored in this chunk */
@@ -1624,20 +1723,31 @@ ExecHashIncreaseNumBuckets(HashJoinTable hashtable)
 
 		while (idx < chunk->used)
 		{
-			HashJoinTuple hashTuple = (HashJoinTuple) (HASH_CHUNK_DATA(chunk) + idx);
-			int			bucketno;
-			int			batchno;
+			HashJoinTuple group[HASH_PREFETCH_GROUP];
+			int			bucketnos[HASH_PREFETCH_GROUP];
+			int			ntuples = 0;
 
-			ExecHashGetBucketAndBatch(hashtable, hashTuple->hashvalue,
-									  &bucketno, &batchno);
+			while (ntuples < HASH_PREFETCH_GROUP && idx < chunk->used)
+			{
+				HashJoinTuple hashTuple = (HashJoinTuple) (HASH_CHUNK_DATA(chunk) + idx);
+				int			batchno;
 
-			/* add the tuple to the proper bucket */
-			hashTuple->next.unshared = hashtable->buckets.unshared[bucketno];
-			hashtable->buckets.unshared[bucketno] = hashTuple;
+				ExecHashGetBucketAndBatch(hashtable, hashTuple->hashvalue,
+										  &bucketnos[ntuples], &batchno);
+				pg_prefetch_mem(&hashtable->buckets.unshared[bucketnos[ntuples]]);
+				group[ntuples++] = hashTuple;
 
-			/* advance index past the tuple */
-			idx += MAXALIGN(HJTUPLE_OVERHEAD +
-							HJTUPLE_MINTUPLE(hashTuple)->t_len);
+				/* advance index past the tuple */
+				idx += MAXALIGN(HJTUPLE_OVERHEAD +
+								HJTUPLE_MINTUPLE(hashTuple)->t_len);
+			}
+
+			/* add the tuples to the proper buckets */
+			for (int i = 0; i < ntuples; i++)
+			{
+				group[i]->next.unshared = hashtable->buckets.unshared[bucketnos[i]];
+				hashtable->buckets.unshared[bucketnos[i]] = group[i];
+			}
 		}
 
 		/* allow this loop to be cancellable */
@@ -1645,6 +1755,71 @@ ExecHashIncreaseNumBuckets(HashJoinTable hashtable)
 	}
 }
 
+/*
+ * ExecHashTableClusterBuckets
+ *		store the tuples of a single-batch hash table in bucket order
+ *
+ * Tuples are stored in the order the inner plan produced them, so the tuples
+ * of neighbouring buckets are scattered all over the table's memory.  Copying
+ * them into fresh chunks bucket by bucket turns any range of the bucket
+ * array, together with the tuples it links to, into one contiguous partition
+ * of memory.  Probes that arrive in bucket order, as a hash join sorts
+ * batches of outer tuples when the table is clustered, then work through the
+ * table one cache-sized partition at a time rather than missing the cache on
+ * every access.
+ *
+ * The caller must make sure there's room for a second copy of the tuples
+ * while this runs.
+ */
+static void
+ExecHashTableClusterBuckets(HashJoinTable hashtable)
+{
+	HashMemoryChunk oldchunks = hashtable->chunks;
+
+	Assert(hashtable->nbatch == 1);
+	Assert(hashtable->parallel_state == NULL);
+
+	hashtable->chunks = NULL;
+
+	for (int bucketno = 0; bucketno < hashtable->nbuckets; bucketno++)
+	{
+		HashJoinTuple *link = &hashtable->buckets.unshared[bucketno];
+		HashJoinTuple hashTuple;
+
+		/* the first tuples of the buckets a little further on come next */
+		if (bucketno + HASH_PREFETCH_GROUP < hashtable->nbuckets &&
+			hashtable->buckets.unshared[bucketno + HASH_PREFETCH_GROUP] != NULL)
+			pg_prefetch_mem(hashtable->buckets.unshared[bucketno + HASH_PREFETCH_GROUP]);
+
+		for (hashTuple = *link; hashTuple != NULL;
+			 hashTuple = hashTuple->next.unshared)
+		{
+			Size		size = HJTUPLE_OVERHEAD +
+				HJTUPLE_MINTUPLE(hashTuple)->t_len;
+			HashJoinTuple copy = (HashJoinTuple) dense_alloc(hashtable, size);
+
+			memcpy(copy, hashTuple, size);
+			*link = copy;
+			link = &copy->next.unshared;
+		}
+
+		/* allow this loop to be cancellable */
+		if ((bucketno & 0xFFFF) == 0)
+			CHECK_FOR_INTERRUPTS();
+	}
+
+	/* release the old chunks */
+	while (oldchunks != NULL)
+	{
+		HashMemoryChunk next = oldchunks->next.unshared;
+
+		pfree(oldchunks);
+		oldchunks = next;
+	}
+
+	hashtable->clustered = true;
+}
+
 static void
 ExecParallelHashIncreaseNumBuckets(HashJoinTable hashtable)
 {
@@ -1769,6 +1944,9 @@ ExecHashTableInsert(HashJoinTable hashtable,
 		int			hashTupleSize;
 		double		ntuples = (hashtable->totalTuples - hashtable->skewTuples);
 
+		/* Start loading the bucket while we copy the tuple */
+		pg_prefetch_mem(&hashtable->buckets.unshared[bucketno]);
+
 		/* Create the HashJoinTuple */
 		hashTupleSize = HJTUPLE_OVERHEAD + tuple->t_len;
 		hashTuple = (HashJoinTuple) dense_alloc(hashtable, hashTupleSize);
@@ -1809,9 +1987,9 @@ ExecHashTableInsert(HashJoinTable hashtable,
 		hashtable->spaceUsed += hashTupleSize;
 		if (hashtable->spaceUsed > hashtable->spacePeak)
 			hashtable->spacePeak = hashtable->spaceUsed;
-		if (hashtable->spaceUsed +
-			hashtable->nbuckets_optimal * sizeof(HashJoinTuple)
-			> hashtable->spaceAllowed)
+		if (!ExecHashReserveSpace(hashtable,
+								  hashtable->spaceUsed +
+								  hashtable->nbuckets_optimal * sizeof(HashJoinTuple)))
 			ExecHashIncreaseNumBatches(hashtable);
 	}
 	else
@@ -2344,6 +2522,7 @@ ExecHashTableReset(HashJoinTable hashtable)
 
 	/* Forget the chunks (the memory was freed by the context reset above). */
 	hashtable->chunks = NULL;
+	hashtable->clustered = false;
 }
 
 /*
@@ -2629,7 +2808,7 @@ ExecHashSkewTableInsert(HashJoinTable hashtable,
 		ExecHashRemoveNextSkewBucket(hashtable);
 
 	/* Check we are not over the total spaceAllowed, either */
-	if (hashtable->spaceUsed > hashtable->spaceAllowed)
+	if (!ExecHashReserveSpace(hashtable, hashtable->spaceUsed))
 		ExecHashIncreaseNumBatches(hashtable);
 
 	if (shouldFree)
@@ -168,6 +168,7 @@
 #include "executor/hashjoin.h"
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
+#include "common/int.h"
 #include "miscadmin.h"
 #include "utils/lsyscache.h"
 #include "utils/sharedtuplestore.h"
@@ -189,9 +190,22 @@
 /* Returns true if doing null-fill on inner relation */
 #define HJ_FILL_INNER(hjstate)	((hjstate)->hj_NullOuterTupleSlot != NULL)
 
+/* GUC variable: outer tuples to fetch ahead for prefetching, 0 disables */
+int			hashjoin_batch_size = 0;
+
+/* GUC variable: push Bloom filters down into outer seqscans */
+bool		hashjoin_bloom_filter = false;
+
+/* GUC variable: store large in-memory hash tables in bucket order */
+bool		hashjoin_radix_partition = false;
+
 static TupleTableSlot *ExecHashJoinOuterGetTuple(PlanState *outerNode,
 												 HashJoinState *hjstate,
 												 uint32 *hashvalue);
+static TupleTableSlot *ExecHashJoinOuterGetBatchedTuple(PlanState *outerNode,
+														 HashJoinState *hjstate,
+														 uint32 *hashvalue);
+static void ExecHashJoinSortOuterBatch(HashJoinState *hjstate, int nrows);
 static TupleTableSlot *ExecParallelHashJoinOuterGetTuple(PlanState *outerNode,
 														 HashJoinState *hjstate,
 														 uint32 *hashvalue);
@@ -202,6 +216,10 @@ static TupleTableSlot *ExecHashJoinGetSavedTuple(HashJoinState *hjstate,
 static bool ExecHashJoinNewBatch(HashJoinState *hjstate);
 static bool ExecParallelHashJoinNewBatch(HashJoinState *hjstate);
 static void ExecParallelHashJoinPartitionOuter(HashJoinState *hjstate);
+static void ExecHashJoinInitRuntimeFilter(HashJoinState *hjstate,
+										  HashState *hashstate,
+										  const Oid *outer_hashfuncid,
+										  const bool *hash_strict);
 
 
 /* ----------------------------------------------------------------
@@ -775,6 +793,26 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	hjstate->hj_OuterTupleSlot = ExecInitExtraTupleSlot(estate, outerDesc,
 														ops);
 
+	/*
+	 * If fetching outer tuples ahead, set up slots to keep them in.  Parallel
+	 * Hash probes its shared table without that, so don't bother then.
+	 */
+	if (hashjoin_batch_size > 0 && !node->join.plan.parallel_aware)
+	{
+		hjstate->hj_OuterBatchSize = hashjoin_batch_size;
+		hjstate->hj_OuterBatchSlots = palloc_array(TupleTableSlot *,
+												   hashjoin_batch_size);
+		for (int i = 0; i < hashjoin_batch_size; i++)
+			hjstate->hj_OuterBatchSlots[i] =
+				ExecInitExtraTupleSlot(estate, outerDesc, ops);
+		hjstate->hj_OuterBatchHashes = palloc_array(uint32,
+													hashjoin_batch_size);
+		hjstate->hj_OuterBatchKeys = palloc_array(uint64,
+												  hashjoin_batch_size);
+		hjstate->hj_OuterBatchSorted = palloc_array(TupleTableSlot *,
+													hashjoin_batch_size);
+	}
+
 	/*
 	 * detect whether we need only consider the first matching inner tuple
 	 */
@@ -860,6 +898,15 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 					 "could not find hash function for hash operator %u",
 					 hashop);
 			hash_strict[i] = op_strict(hashop);
+
+			/*
+			 * The hash table lives only for this join, so we can use a faster
+			 * hash function if there's one, as long as both sides use it.
+			 * Cross-type cases keep their functions, which are compatible.
+			 */
+			if (outer_hashfuncid[i] == inner_hashfuncid[i])
+				outer_hashfuncid[i] = inner_hashfuncid[i] =
+					ExecInMemoryHashFunction(inner_hashfuncid[i]);
 		}
 
 		/*
@@ -893,6 +940,11 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 								0,
 								HJ_FILL_INNER(hjstate));
 
+		/* Push a Bloom filter down into the outer scan, if we can */
+		if (hashjoin_bloom_filter)
+			ExecHashJoinInitRuntimeFilter(hjstate, hashstate,
+										  outer_hashfuncid, hash_strict);
+
 		/*
 		 * Set up the skew table hash function while we have a record of the
 		 * first key's hash function Oid.
@@ -938,6 +990,78 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	return hjstate;
 }
 
+/*
+ * ExecHashJoinInitRuntimeFilter
+ *
+ *		Set up a Bloom filter over the inner side's hash values that the
+ *		outer seqscan applies to its rows, so that rows without a match are
+ *		discarded before they are passed up to us.
+ *
+ * This is only done for join types that don't emit unmatched outer rows,
+ * and for a parallel-oblivious Hash, where one process sees all of the inner
+ * rows.  The outer plan must be a seqscan whose hash keys are plain columns,
+ * so that the outer hash value can be computed from the scan tuple.
+ */
+static void
+ExecHashJoinInitRuntimeFilter(HashJoinState *hjstate, HashState *hashstate,
+							  const Oid *outer_hashfuncid,
+							  const bool *hash_strict)
+{
+	HashJoin   *node = (HashJoin *) hjstate->js.ps.plan;
+	PlanState  *outerState = outerPlanState(hjstate);
+	SeqScanState *scanstate;
+	HashRuntimeFilter *rf;
+	List	   *scan_keys = NIL;
+	ListCell   *lc;
+
+	switch (hjstate->js.jointype)
+	{
+		case JOIN_INNER:
+		case JOIN_SEMI:
+		case JOIN_RIGHT:
+		case JOIN_RIGHT_SEMI:
+		case JOIN_RIGHT_ANTI:
+			break;
+		default:
+			return;
+	}
+
+	if (hashstate->ps.plan->parallel_aware || !IsA(outerState, SeqScanState))
+		return;
+	scanstate = (SeqScanState *) outerState;
+
+	/* Map each outer hash key onto the scan's targetlist */
+	foreach(lc, node->hashkeys)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+		TargetEntry *tle;
+
+		if (!IsA(var, Var) || var->varno != OUTER_VAR ||
+			var->varattno <= 0 ||
+			var->varattno > list_length(outerState->plan->targetlist))
+			return;
+		tle = list_nth_node(TargetEntry, outerState->plan->targetlist,
+							var->varattno - 1);
+		if (!IsA(tle->expr, Var))
+			return;
+		scan_keys = lappend(scan_keys, tle->expr);
+	}
+
+	rf = palloc0_object(HashRuntimeFilter);
+	rf->hashexpr = ExecBuildHash32Expr(scanstate->ss.ps.scandesc,
+									   scanstate->ss.ps.scanops,
+									   outer_hashfuncid,
+									   node->hashcollations,
+									   scan_keys,
+									   hash_strict,
+									   &scanstate->ss.ps,
+									   0,
+									   false);
+
+	hashstate->runtime_filter = rf;
+	scanstate->runtime_filter = rf;
+}
+
 /* ----------------------------------------------------------------
  *		ExecEndHashJoin
  *
@@ -986,6 +1110,10 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 
 	if (curbatch == 0)			/* if it is the first pass */
 	{
+		if (hjstate->hj_OuterBatchSize > 0)
+			return ExecHashJoinOuterGetBatchedTuple(outerNode, hjstate,
+													hashvalue);
+
 		/*
 		 * Check to see if first outer tuple was already fetched by
 		 * ExecHashJoin() and not used yet.
@@ -1051,6 +1179,163 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 	return NULL;
 }
 
+/*
+ * ExecHashJoinOuterGetBatchedTuple
+ *
+ *		the first pass of ExecHashJoinOuterGetTuple(), for when outer tuples
+ *		are fetched hj_OuterBatchSize at a time.
+ *
+ * After fetching a batch of tuples and computing their hash values, we
+ * prefetch the hash table buckets of all of them, and then the first tuple
+ * in each of those buckets, before returning them one by one.  When the hash
+ * table is much larger than the CPU caches, that lets the cache misses of
+ * probing it overlap instead of stalling on them one tuple at a time.
+ */
+static TupleTableSlot *
+ExecHashJoinOuterGetBatchedTuple(PlanState *outerNode,
+								 HashJoinState *hjstate,
+								 uint32 *hashvalue)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	int			bucketno;
+	int			batchno;
+	int			i;
+
+	if (hjstate->hj_OuterBatchNext >= hjstate->hj_OuterBatchCount)
+	{
+		ExprContext *econtext = hjstate->js.ps.ps_ExprContext;
+		int			nrows = 0;
+
+		while (nrows < hjstate->hj_OuterBatchSize)
+		{
+			TupleTableSlot *slot;
+			TupleTableSlot *copy;
+			uint32		hash;
+			bool		isnull;
+
+			/*
+			 * Check to see if first outer tuple was already fetched by
+			 * ExecHashJoin() and not used yet.
+			 */
+			slot = hjstate->hj_FirstOuterTupleSlot;
+			if (!TupIsNull(slot))
+				hjstate->hj_FirstOuterTupleSlot = NULL;
+			else
+				slot = ExecProcNode(outerNode);
+			if (TupIsNull(slot))
+				break;
+
+			econtext->ecxt_outertuple = slot;
+
+			ResetExprContext(econtext);
+
+			hash = DatumGetUInt32(ExecEvalExprSwitchContext(hjstate->hj_OuterHash,
+															econtext,
+															&isnull));
+
+			/*
+			 * A tuple that couldn't match because of a NULL is discarded.
+			 */
+			if (isnull)
+				continue;
+
+			/*
+			 * The outer plan overwrites its slot on the next fetch, so keep a
+			 * copy.  ExecCopySlot() doesn't copy the system attributes kept in
+			 * the slot itself, so do that too.
+			 */
+			copy = hjstate->hj_OuterBatchSlots[nrows];
+			ExecCopySlot(copy, slot);
+			copy->tts_tid = slot->tts_tid;
+			copy->tts_tableOid = slot->tts_tableOid;
+			hjstate->hj_OuterBatchHashes[nrows] = hash;
+
+			ExecHashGetBucketAndBatch(hashtable, hash, &bucketno, &batchno);
+			if (batchno == 0)
+				pg_prefetch_mem(&hashtable->buckets.unshared[bucketno]);
+
+			nrows++;
+		}
+
+		/* release whatever is left over from the previous batch */
+		for (i = nrows; i < hjstate->hj_OuterBatchCount; i++)
+			ExecClearTuple(hjstate->hj_OuterBatchSlots[i]);
+
+		hjstate->hj_OuterBatchCount = nrows;
+		hjstate->hj_OuterBatchNext = 0;
+
+		if (nrows == 0)
+			return NULL;
+
+		/* remember outer relation is not empty for possible rescan */
+		hjstate->hj_OuterNotEmpty = true;
+
+		/* probe a hash table stored in bucket order in bucket order, too */
+		if (hashtable->clustered)
+			ExecHashJoinSortOuterBatch(hjstate, nrows);
+
+		/* by now the buckets should be cached, so follow them */
+		for (i = 0; i < nrows; i++)
+		{
+			ExecHashGetBucketAndBatch(hashtable,
+									  hjstate->hj_OuterBatchHashes[i],
+									  &bucketno, &batchno);
+			if (batchno == 0 &&
+				hashtable->buckets.unshared[bucketno] != NULL)
+				pg_prefetch_mem(hashtable->buckets.unshared[bucketno]);
+		}
+	}
+
+	i = hjstate->hj_OuterBatchNext++;
+	*hashvalue = hjstate->hj_OuterBatchHashes[i];
+	return hjstate->hj_OuterBatchSlots[i];
+}
+
+#define ST_SORT sort_outer_batch_keys
+#define ST_ELEMENT_TYPE uint64
+#define ST_COMPARE(a, b) pg_cmp_u64(*(a), *(b))
+#define ST_SCOPE static
+#define ST_DEFINE
+#include "lib/sort_template.h"
+
+/*
+ * ExecHashJoinSortOuterBatch
+ *
+ *		put the outer tuples fetched ahead in the order of their buckets.
+ *
+ * This is used when the hash table has been stored in bucket order (see
+ * ExecHashTableClusterBuckets()), so that the probes of a batch move through
+ * the table in one direction instead of jumping around it.
+ */
+static void
+ExecHashJoinSortOuterBatch(HashJoinState *hjstate, int nrows)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	uint64	   *keys = hjstate->hj_OuterBatchKeys;
+	int			i;
+
+	/* sort bucket numbers, with each tuple's position in the low bits */
+	for (i = 0; i < nrows; i++)
+	{
+		uint32		bucketno;
+
+		bucketno = hjstate->hj_OuterBatchHashes[i] & (hashtable->nbuckets - 1);
+		keys[i] = ((uint64) bucketno << 32) | i;
+	}
+	sort_outer_batch_keys(keys, nrows);
+
+	/* then rearrange the tuples and hash values to match */
+	for (i = 0; i < nrows; i++)
+		hjstate->hj_OuterBatchSorted[i] =
+			hjstate->hj_OuterBatchSlots[(uint32) keys[i]];
+	memcpy(hjstate->hj_OuterBatchSlots, hjstate->hj_OuterBatchSorted,
+		   nrows * sizeof(TupleTableSlot *));
+	for (i = 0; i < nrows; i++)
+		keys[i] = hjstate->hj_OuterBatchHashes[(uint32) keys[i]];
+	for (i = 0; i < nrows; i++)
+		hjstate->hj_OuterBatchHashes[i] = (uint32) keys[i];
+}
+
 /*
  * ExecHashJoinOuterGetTuple variant for the parallel case.
  */
@@ -1434,7 +1719,8 @@ ExecHashJoinSaveTuple(MinimalTuple tuple, uint32 hashvalue,
 	{
 		MemoryContext oldctx = MemoryContextSwitchTo(hashtable->spillCxt);
 
-		file = BufFileCreateTemp(false);
+		/* batch files are only ever read back in order, so can compress */
+		file = BufFileCreateCompressTemp(false);
 		*fileptr = file;
 
 		MemoryContextSwitchTo(oldctx);
@@ -1547,6 +1833,9 @@ ExecReScanHashJoin(HashJoinState *node)
 											 hashNode->hashtable);
 			/* for safety, be sure to clear child plan node's pointer too */
 			hashNode->hashtable = NULL;
+			/* the runtime filter goes away with the hash table */
+			if (hashNode->runtime_filter)
+				hashNode->runtime_filter->filter = NULL;
 
 			ExecHashTableDestroy(node->hj_HashTable);
 			node->hj_HashTable = NULL;
@@ -1570,6 +1859,12 @@ ExecReScanHashJoin(HashJoinState *node)
 	node->hj_MatchedOuter = false;
 	node->hj_FirstOuterTupleSlot = NULL;
 
+	/* Forget any outer tuples fetched ahead */
+	for (int i = 0; i < node->hj_OuterBatchCount; i++)
+		ExecClearTuple(node->hj_OuterBatchSlots[i]);
+	node->hj_OuterBatchCount = 0;
+	node->hj_OuterBatchNext = 0;
+
 	/*
 	 * if chgParam of subnode is not null then plan will be re-scanned by
 	 * first ExecProcNode.
@@ -21,6 +21,9 @@
  *		ExecEndIndexOnlyScan		releases all storage.
  *		ExecIndexOnlyMarkPos		marks scan position.
  *		ExecIndexOnlyRestrPos		restores scan position.
+ *		ExecIndexOnlyScanInitLowerBound	prepares for
+ *						ExecIndexOnlyScanSetLowerBound
+ *		ExecIndexOnlyScanSetLowerBound	restarts scan at a given first key
  *		ExecIndexOnlyScanEstimate	estimates DSM space needed for
  *						parallel index-only scan
  *		ExecIndexOnlyScanInitializeDSM	initialize DSM for parallel
@@ -47,6 +50,9 @@
 
 
 static TupleTableSlot *IndexOnlyNext(IndexOnlyScanState *node);
+static ItemPointer IndexOnlyGetNextTid(IndexOnlyScanState *node,
+									   IndexScanDesc scandesc,
+									   ScanDirection direction);
 static void StoreIndexTuple(IndexOnlyScanState *node, TupleTableSlot *slot,
 							IndexTuple itup, TupleDesc itupdesc);
 
@@ -102,6 +108,7 @@ IndexOnlyNext(IndexOnlyScanState *node)
 		/* Set it up for index-only scan */
 		node->ioss_ScanDesc->xs_want_itup = true;
 		node->ioss_VMBuffer = InvalidBuffer;
+		index_prefetch_begin(scandesc, node->ioss_PrefetchDistance, true);
 
 		/*
 		 * If no run-time keys to calculate or they are ready, go ahead and
@@ -118,9 +125,10 @@ IndexOnlyNext(IndexOnlyScanState *node)
 	/*
 	 * OK, now that we have what we need, fetch the next tuple.
 	 */
-	while ((tid = index_getnext_tid(scandesc, direction)) != NULL)
+	while ((tid = IndexOnlyGetNextTid(node, scandesc, direction)) != NULL)
 	{
 		bool		tuple_from_heap = false;
+		bool		all_visible;
 
 		CHECK_FOR_INTERRUPTS();
 
@@ -157,10 +165,18 @@ IndexOnlyNext(IndexOnlyScanState *node)
 		 *
 		 * It's worth going through this complexity to avoid needing to lock
 		 * the VM buffer, which could cause significant contention.
+		 *
+		 * When prefetching, the index scan has already done this check, as
+		 * it read the TID, so that it prefetches only the heap blocks that
+		 * we need to visit.
 		 */
-		if (!VM_ALL_VISIBLE(scandesc->heapRelation,
-							ItemPointerGetBlockNumber(tid),
-							&node->ioss_VMBuffer))
+		if (scandesc->xs_prefetch)
+			all_visible = scandesc->xs_prefetch->all_visible;
+		else
+			all_visible = VM_ALL_VISIBLE(scandesc->heapRelation,
+										 ItemPointerGetBlockNumber(tid),
+										 &node->ioss_VMBuffer);
+		if (!all_visible)
 		{
 			/*
 			 * Rats, we have to visit the heap to check visibility.
@@ -248,6 +264,16 @@ IndexOnlyNext(IndexOnlyScanState *node)
 							  ItemPointerGetBlockNumber(tid),
 							  estate->es_snapshot);
 
+		/* In a loose scan, move on to the next distinct value */
+		if (node->ioss_SkipKey)
+		{
+			Datum		value;
+			bool		isnull;
+
+			value = slot_getattr(slot, 1, &isnull);
+			ExecIndexSkipPast(node->ioss_SkipKey, value, isnull);
+		}
+
 		return slot;
 	}
 
@@ -258,6 +284,41 @@ IndexOnlyNext(IndexOnlyScanState *node)
 	return ExecClearTuple(slot);
 }
 
+/*
+ * IndexOnlyGetNextTid
+ *		Fetch the next TID from the index, rescanning it as needed for a
+ *		loose index scan; see IndexGetNextSlot in nodeIndexscan.c.
+ */
+static ItemPointer
+IndexOnlyGetNextTid(IndexOnlyScanState *node, IndexScanDesc scandesc,
+					ScanDirection direction)
+{
+	IndexSkipKey *skip = node->ioss_SkipKey;
+	ItemPointer tid;
+
+	if (skip == NULL)
+		return index_getnext_tid(scandesc, direction);
+
+	Assert(ScanDirectionIsForward(direction));
+
+	for (;;)
+	{
+		if (skip->phase == INDEX_SKIP_DONE)
+			return NULL;
+		if (skip->restart)
+		{
+			index_rescan(scandesc,
+						 node->ioss_ScanKeys, node->ioss_NumScanKeys,
+						 node->ioss_OrderByKeys, node->ioss_NumOrderByKeys);
+			skip->restart = false;
+		}
+		if ((tid = index_getnext_tid(scandesc, direction)) != NULL)
+			return tid;
+		if (!ExecIndexSkipNextPhase(skip))
+			return NULL;
+	}
+}
+
 /*
  * StoreIndexTuple
  *		Fill the slot with data from the index tuple.
@@ -381,6 +442,10 @@ ExecReScanIndexOnlyScan(IndexOnlyScanState *node)
 	}
 	node->ioss_RuntimeKeysReady = true;
 
+	/* a loose scan starts over from the first distinct value */
+	if (node->ioss_SkipKey)
+		ExecIndexResetSkipKey(node->ioss_SkipKey);
+
 	/* reset index scan */
 	if (node->ioss_ScanDesc)
 		index_rescan(node->ioss_ScanDesc,
@@ -513,6 +578,53 @@ ExecIndexOnlyRestrPos(IndexOnlyScanState *node)
 	index_restrpos(node->ioss_ScanDesc);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecIndexOnlyScanInitLowerBound
+ *
+ *		Let the parent node restart the scan at a given first key;
+ *		see ExecIndexScanInitLowerBound.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecIndexOnlyScanInitLowerBound(IndexOnlyScanState *node, Oid opfamily,
+								Oid collation, Oid argtype)
+{
+	IndexOnlyScan *plan = (IndexOnlyScan *) node->ss.ps.plan;
+
+	/* See ExecIndexScanInitLowerBound */
+	if (plan->scan.plan.parallel_aware ||
+		!ScanDirectionIsForward(plan->indexorderdir) ||
+		node->ioss_NumOrderByKeys > 0 ||
+		node->ioss_SkipKey != NULL ||
+		node->ioss_ScanDesc != NULL ||
+		node->ss.ps.state->es_epq_active != NULL)
+		return false;
+
+	node->ioss_LowerBound = ExecIndexAddLowerBound(node->ioss_RelationDesc,
+												   opfamily, collation,
+												   argtype,
+												   &node->ioss_ScanKeys,
+												   &node->ioss_NumScanKeys,
+												   node->ioss_RuntimeKeys,
+												   node->ioss_NumRuntimeKeys);
+	return node->ioss_LowerBound != NULL;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecIndexOnlyScanSetLowerBound
+ *
+ *		Restart the scan at the first entry >= 'value'.
+ * ----------------------------------------------------------------
+ */
+void
+ExecIndexOnlyScanSetLowerBound(IndexOnlyScanState *node, Datum value)
+{
+	Assert(node->ioss_LowerBound != NULL);
+
+	ExecIndexSetLowerBound(node->ioss_LowerBound, value);
+	ExecReScanIndexOnlyScan(node);
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitIndexOnlyScan
  *
@@ -644,6 +756,28 @@ ExecInitIndexOnlyScan(IndexOnlyScan *node, EState *estate, int eflags)
 						   NULL,	/* no ArrayKeys */
 						   NULL);
 
+	/* Set up a loose index scan, as for plain index scans */
+	if (node->indexskipdistinct &&
+		ScanDirectionIsForward(node->indexorderdir) &&
+		indexstate->ioss_NumOrderByKeys == 0 &&
+		!node->scan.plan.parallel_aware &&
+		!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)))
+		indexstate->ioss_SkipKey =
+			ExecIndexAddSkipKey(indexRelation,
+								&indexstate->ioss_ScanKeys,
+								&indexstate->ioss_NumScanKeys,
+								indexstate->ioss_RuntimeKeys,
+								indexstate->ioss_NumRuntimeKeys);
+
+	/*
+	 * Decide whether to read ahead in the index to prefetch heap blocks,
+	 * under the same conditions as for plain index scans.
+	 */
+	if (indexstate->ioss_NumOrderByKeys == 0 &&
+		indexstate->ioss_SkipKey == NULL &&
+		!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)))
+		indexstate->ioss_PrefetchDistance = index_prefetch_distance;
+
 	/*
 	 * If we have runtime keys, we need an ExprContext to evaluate them. The
 	 * node's standard context won't do because we want to reset that context
@@ -791,6 +925,8 @@ ExecIndexOnlyScanInitializeDSM(IndexOnlyScanState *node,
 								 piscan);
 	node->ioss_ScanDesc->xs_want_itup = true;
 	node->ioss_VMBuffer = InvalidBuffer;
+	index_prefetch_begin(node->ioss_ScanDesc, node->ioss_PrefetchDistance,
+						 true);
 
 	/*
 	 * If no run-time keys to calculate or they are ready, go ahead and pass
@@ -856,6 +992,8 @@ ExecIndexOnlyScanInitializeWorker(IndexOnlyScanState *node,
 								 node->ioss_NumOrderByKeys,
 								 piscan);
 	node->ioss_ScanDesc->xs_want_itup = true;
+	index_prefetch_begin(node->ioss_ScanDesc, node->ioss_PrefetchDistance,
+						 true);
 
 	/*
 	 * If no run-time keys to calculate or they are ready, go ahead and pass
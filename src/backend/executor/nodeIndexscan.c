@@ -22,6 +22,8 @@
  *		ExecEndIndexScan		releases all storage.
  *		ExecIndexMarkPos		marks scan position.
  *		ExecIndexRestrPos		restores scan position.
+ *		ExecIndexScanInitLowerBound	prepares for ExecIndexScanSetLowerBound
+ *		ExecIndexScanSetLowerBound	restarts scan at a given first key
  *		ExecIndexScanEstimate	estimates DSM space needed for parallel index scan
  *		ExecIndexScanInitializeDSM initialize DSM for parallel indexscan
  *		ExecIndexScanReInitializeDSM reinitialize DSM for fresh scan
@@ -56,6 +58,8 @@ typedef struct
 } ReorderTuple;
 
 static TupleTableSlot *IndexNext(IndexScanState *node);
+static bool IndexGetNextSlot(IndexScanState *node, IndexScanDesc scandesc,
+							 ScanDirection direction, TupleTableSlot *slot);
 static TupleTableSlot *IndexNextWithReorder(IndexScanState *node);
 static void EvalOrderByExpressions(IndexScanState *node, ExprContext *econtext);
 static bool IndexRecheck(IndexScanState *node, TupleTableSlot *slot);
@@ -67,6 +71,7 @@ static int	reorderqueue_cmp(const pairingheap_node *a,
 static void reorderqueue_push(IndexScanState *node, TupleTableSlot *slot,
 							  const Datum *orderbyvals, const bool *orderbynulls);
 static HeapTuple reorderqueue_pop(IndexScanState *node);
+static void SetSkipPhaseKey(IndexSkipKey *skip);
 
 
 /* ----------------------------------------------------------------
@@ -114,6 +119,7 @@ IndexNext(IndexScanState *node)
 								   node->iss_NumOrderByKeys);
 
 		node->iss_ScanDesc = scandesc;
+		index_prefetch_begin(scandesc, node->iss_PrefetchDistance, false);
 
 		/*
 		 * If no run-time keys to calculate or they are ready, go ahead and
@@ -128,7 +134,7 @@ IndexNext(IndexScanState *node)
 	/*
 	 * ok, now that we have what we need, fetch the next tuple.
 	 */
-	while (index_getnext_slot(scandesc, direction, slot))
+	while (IndexGetNextSlot(node, scandesc, direction, slot))
 	{
 		CHECK_FOR_INTERRUPTS();
 
@@ -147,6 +153,17 @@ IndexNext(IndexScanState *node)
 			}
 		}
 
+		/* In a loose scan, move on to the next distinct value */
+		if (node->iss_SkipKey)
+		{
+			AttrNumber	attno = node->iss_RelationDesc->rd_index->indkey.values[0];
+			Datum		value;
+			bool		isnull;
+
+			value = slot_getattr(slot, attno, &isnull);
+			ExecIndexSkipPast(node->iss_SkipKey, value, isnull);
+		}
+
 		return slot;
 	}
 
@@ -158,6 +175,43 @@ IndexNext(IndexScanState *node)
 	return ExecClearTuple(slot);
 }
 
+/*
+ * IndexGetNextSlot
+ *		Fetch the next tuple from the index.
+ *
+ * For a loose index scan, this takes care of rescanning the index from
+ * just past the last distinct value returned, and of moving on between the
+ * nulls and the non-null values.
+ */
+static bool
+IndexGetNextSlot(IndexScanState *node, IndexScanDesc scandesc,
+				 ScanDirection direction, TupleTableSlot *slot)
+{
+	IndexSkipKey *skip = node->iss_SkipKey;
+
+	if (skip == NULL)
+		return index_getnext_slot(scandesc, direction, slot);
+
+	Assert(ScanDirectionIsForward(direction));
+
+	for (;;)
+	{
+		if (skip->phase == INDEX_SKIP_DONE)
+			return false;
+		if (skip->restart)
+		{
+			index_rescan(scandesc,
+						 node->iss_ScanKeys, node->iss_NumScanKeys,
+						 node->iss_OrderByKeys, node->iss_NumOrderByKeys);
+			skip->restart = false;
+		}
+		if (index_getnext_slot(scandesc, direction, slot))
+			return true;
+		if (!ExecIndexSkipNextPhase(skip))
+			return false;
+	}
+}
+
 /* ----------------------------------------------------------------
  *		IndexNextWithReorder
  *
@@ -580,6 +634,10 @@ ExecReScanIndexScan(IndexScanState *node)
 		}
 	}
 
+	/* a loose scan starts over from the first distinct value */
+	if (node->iss_SkipKey)
+		ExecIndexResetSkipKey(node->iss_SkipKey);
+
 	/* reset index scan */
 	if (node->iss_ScanDesc)
 		index_rescan(node->iss_ScanDesc,
@@ -776,6 +834,268 @@ ExecIndexAdvanceArrayKeys(IndexArrayKeyInfo *arrayKeys, int numArrayKeys)
 	return found;
 }
 
+/*
+ * ExecIndexAddLowerBound
+ *		Add a scan key that restricts the first index column to values >= a
+ *		bound of type 'argtype', which can later be changed between rescans
+ *		with ExecIndexSetLowerBound.
+ *
+ * This only works for an ascending btree column that sorts per 'opfamily'
+ * and 'collation', since the point is to let the index start the scan at
+ * the bound; NULL is returned if the index doesn't qualify.  Until a bound
+ * is set, the key just filters out nulls.  The new key goes first, as btree
+ * wants its keys ordered by column, so the caller's runtime keys, which
+ * point into the scan key array, are adjusted to match.
+ */
+IndexLowerBound *
+ExecIndexAddLowerBound(Relation index, Oid opfamily, Oid collation,
+					   Oid argtype,
+					   ScanKey *scanKeys, int *numScanKeys,
+					   IndexRuntimeKeyInfo *runtimeKeys, int numRuntimeKeys)
+{
+	IndexLowerBound *bound;
+	ScanKey		newKeys;
+	Oid			opno;
+	int			i;
+
+	if (index->rd_rel->relam != BTREE_AM_OID ||
+		index->rd_opfamily[0] != opfamily ||
+		index->rd_indcollation[0] != collation ||
+		(index->rd_indoption[0] & INDOPTION_DESC) != 0)
+		return NULL;
+
+	opno = get_opfamily_member(opfamily, index->rd_opcintype[0], argtype,
+							   BTGreaterEqualStrategyNumber);
+	if (!OidIsValid(opno))
+		return NULL;
+
+	bound = palloc0_object(IndexLowerBound);
+	fmgr_info(get_opcode(opno), &bound->finfo);
+	bound->subtype = argtype;
+	bound->collation = collation;
+	get_typlenbyval(argtype, &bound->typlen, &bound->typbyval);
+	bound->context = CurrentMemoryContext;
+
+	newKeys = palloc_array(ScanKeyData, *numScanKeys + 1);
+	if (*numScanKeys > 0)
+		memcpy(&newKeys[1], *scanKeys, *numScanKeys * sizeof(ScanKeyData));
+	for (i = 0; i < numRuntimeKeys; i++)
+		runtimeKeys[i].scan_key = &newKeys[1] +
+			(runtimeKeys[i].scan_key - *scanKeys);
+
+	bound->scan_key = &newKeys[0];
+	ScanKeyEntryInitialize(bound->scan_key,
+						   SK_ISNULL | SK_SEARCHNOTNULL,
+						   1,
+						   InvalidStrategy,
+						   InvalidOid,
+						   InvalidOid,
+						   InvalidOid,
+						   (Datum) 0);
+
+	*scanKeys = newKeys;
+	(*numScanKeys)++;
+
+	return bound;
+}
+
+/*
+ * ExecIndexSetLowerBound
+ *		Change the bound of a key made by ExecIndexAddLowerBound.
+ *
+ * The new key takes effect at the next rescan of the index.
+ */
+void
+ExecIndexSetLowerBound(IndexLowerBound *bound, Datum value)
+{
+	MemoryContext oldcontext;
+
+	if (bound->isset && !bound->typbyval)
+		pfree(DatumGetPointer(bound->value));
+
+	oldcontext = MemoryContextSwitchTo(bound->context);
+	bound->value = datumCopy(value, bound->typbyval, bound->typlen);
+	MemoryContextSwitchTo(oldcontext);
+	bound->isset = true;
+
+	ScanKeyEntryInitializeWithInfo(bound->scan_key,
+								   0,
+								   1,
+								   BTGreaterEqualStrategyNumber,
+								   bound->subtype,
+								   bound->collation,
+								   &bound->finfo,
+								   bound->value);
+}
+
+/*
+ * ExecIndexAddSkipKey
+ *		Add a scan key on the first index column that turns the scan into a
+ *		loose index scan, returning one entry per distinct value.
+ *
+ * After each entry is returned, the caller reports its first column with
+ * ExecIndexSkipPast, and the key is changed to "> value" (or "< value" if
+ * the column is DESC) so that the next rescan descends straight to the next
+ * distinct value.  Nulls are visited as a group of their own, before or
+ * after the other values according to the column's NULLS FIRST/LAST
+ * option.  Like ExecIndexAddLowerBound, the key goes first and the caller's
+ * runtime keys are adjusted; NULL is returned if the index isn't a btree.
+ */
+IndexSkipKey *
+ExecIndexAddSkipKey(Relation index,
+					ScanKey *scanKeys, int *numScanKeys,
+					IndexRuntimeKeyInfo *runtimeKeys, int numRuntimeKeys)
+{
+	IndexSkipKey *skip;
+	ScanKey		newKeys;
+	StrategyNumber strategy;
+	Oid			opcintype;
+	Oid			opno;
+	int			i;
+
+	if (index->rd_rel->relam != BTREE_AM_OID)
+		return NULL;
+
+	if ((index->rd_indoption[0] & INDOPTION_DESC) != 0)
+		strategy = BTLessStrategyNumber;
+	else
+		strategy = BTGreaterStrategyNumber;
+	opcintype = index->rd_opcintype[0];
+	opno = get_opfamily_member(index->rd_opfamily[0], opcintype, opcintype,
+							   strategy);
+	if (!OidIsValid(opno))
+		return NULL;
+
+	skip = palloc0_object(IndexSkipKey);
+	fmgr_info(get_opcode(opno), &skip->finfo);
+	skip->strategy = strategy;
+	skip->subtype = opcintype;
+	skip->collation = index->rd_indcollation[0];
+	get_typlenbyval(opcintype, &skip->typlen, &skip->typbyval);
+	skip->nulls_first = (index->rd_indoption[0] & INDOPTION_NULLS_FIRST) != 0;
+	skip->context = CurrentMemoryContext;
+
+	newKeys = palloc_array(ScanKeyData, *numScanKeys + 1);
+	if (*numScanKeys > 0)
+		memcpy(&newKeys[1], *scanKeys, *numScanKeys * sizeof(ScanKeyData));
+	for (i = 0; i < numRuntimeKeys; i++)
+		runtimeKeys[i].scan_key = &newKeys[1] +
+			(runtimeKeys[i].scan_key - *scanKeys);
+
+	skip->scan_key = &newKeys[0];
+	ExecIndexResetSkipKey(skip);
+
+	*scanKeys = newKeys;
+	(*numScanKeys)++;
+
+	return skip;
+}
+
+/*
+ * Point the key of a loose index scan at the nulls or at all the non-null
+ * values of the first column, depending on the current phase.
+ */
+static void
+SetSkipPhaseKey(IndexSkipKey *skip)
+{
+	ScanKeyEntryInitialize(skip->scan_key,
+						   skip->phase == INDEX_SKIP_NULLS ?
+						   SK_ISNULL | SK_SEARCHNULL :
+						   SK_ISNULL | SK_SEARCHNOTNULL,
+						   1,
+						   InvalidStrategy,
+						   InvalidOid,
+						   InvalidOid,
+						   InvalidOid,
+						   (Datum) 0);
+}
+
+/*
+ * ExecIndexResetSkipKey
+ *		Make a loose index scan start over from the first distinct value.
+ *
+ * The new key takes effect at the next rescan of the index, which the
+ * caller is responsible for.
+ */
+void
+ExecIndexResetSkipKey(IndexSkipKey *skip)
+{
+	if (skip->isset && !skip->typbyval)
+		pfree(DatumGetPointer(skip->value));
+	skip->isset = false;
+	skip->restart = false;
+
+	skip->phase = skip->nulls_first ? INDEX_SKIP_NULLS : INDEX_SKIP_VALUES;
+	SetSkipPhaseKey(skip);
+}
+
+/*
+ * ExecIndexSkipNextPhase
+ *		Move a loose index scan on to the nulls or non-null values, whichever
+ *		come second, after it has run out of entries.
+ *
+ * Returns false if there's nothing left to visit.  Otherwise, the index
+ * must be rescanned before fetching more entries.
+ */
+bool
+ExecIndexSkipNextPhase(IndexSkipKey *skip)
+{
+	IndexSkipPhase first;
+
+	first = skip->nulls_first ? INDEX_SKIP_NULLS : INDEX_SKIP_VALUES;
+	if (skip->phase != first)
+	{
+		skip->phase = INDEX_SKIP_DONE;
+		skip->restart = false;
+		return false;
+	}
+
+	skip->phase = (first == INDEX_SKIP_NULLS) ?
+		INDEX_SKIP_VALUES : INDEX_SKIP_NULLS;
+	SetSkipPhaseKey(skip);
+	skip->restart = true;
+	return true;
+}
+
+/*
+ * ExecIndexSkipPast
+ *		Report the first column of an entry returned by a loose index scan,
+ *		so that the next rescan skips the rest of the entries sharing it.
+ */
+void
+ExecIndexSkipPast(IndexSkipKey *skip, Datum value, bool isnull)
+{
+	MemoryContext oldcontext;
+
+	/* All the nulls form one group, so we're done with them */
+	if (isnull)
+	{
+		Assert(skip->phase == INDEX_SKIP_NULLS);
+		(void) ExecIndexSkipNextPhase(skip);
+		return;
+	}
+
+	Assert(skip->phase == INDEX_SKIP_VALUES);
+
+	if (skip->isset && !skip->typbyval)
+		pfree(DatumGetPointer(skip->value));
+
+	oldcontext = MemoryContextSwitchTo(skip->context);
+	skip->value = datumCopy(value, skip->typbyval, skip->typlen);
+	MemoryContextSwitchTo(oldcontext);
+	skip->isset = true;
+
+	ScanKeyEntryInitializeWithInfo(skip->scan_key,
+								   0,
+								   1,
+								   skip->strategy,
+								   skip->subtype,
+								   skip->collation,
+								   &skip->finfo,
+								   skip->value);
+	skip->restart = true;
+}
+
 
 /* ----------------------------------------------------------------
  *		ExecEndIndexScan
@@ -892,6 +1212,60 @@ ExecIndexRestrPos(IndexScanState *node)
 	index_restrpos(node->iss_ScanDesc);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecIndexScanInitLowerBound
+ *
+ *		Let the parent node restart the scan at the first index entry
+ *		whose first column is >= a value of type 'argtype', using
+ *		ExecIndexScanSetLowerBound.  Must be called before the scan
+ *		starts.  Returns false if that isn't possible for this scan.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecIndexScanInitLowerBound(IndexScanState *node, Oid opfamily,
+							Oid collation, Oid argtype)
+{
+	IndexScan  *plan = (IndexScan *) node->ss.ps.plan;
+
+	/*
+	 * Only a plain forward scan can be restarted at a bound.  In an EPQ
+	 * recheck, a rescan would return the test tuple again.
+	 */
+	if (plan->scan.plan.parallel_aware ||
+		!ScanDirectionIsForward(plan->indexorderdir) ||
+		node->iss_NumOrderByKeys > 0 ||
+		node->iss_SkipKey != NULL ||
+		node->iss_ScanDesc != NULL ||
+		node->ss.ps.state->es_epq_active != NULL)
+		return false;
+
+	node->iss_LowerBound = ExecIndexAddLowerBound(node->iss_RelationDesc,
+												  opfamily, collation,
+												  argtype,
+												  &node->iss_ScanKeys,
+												  &node->iss_NumScanKeys,
+												  node->iss_RuntimeKeys,
+												  node->iss_NumRuntimeKeys);
+	return node->iss_LowerBound != NULL;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecIndexScanSetLowerBound
+ *
+ *		Restart the scan at the first entry >= 'value'.  Unlike a
+ *		rescan requested through ExecReScan, this doesn't count as a
+ *		new loop for EXPLAIN ANALYZE.
+ * ----------------------------------------------------------------
+ */
+void
+ExecIndexScanSetLowerBound(IndexScanState *node, Datum value)
+{
+	Assert(node->iss_LowerBound != NULL);
+
+	ExecIndexSetLowerBound(node->iss_LowerBound, value);
+	ExecReScanIndexScan(node);
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitIndexScan
  *
@@ -1010,6 +1384,37 @@ ExecInitIndexScan(IndexScan *node, EState *estate, int eflags)
 						   NULL,	/* no ArrayKeys */
 						   NULL);
 
+	/*
+	 * For a loose index scan, add the key that skips over duplicates of the
+	 * first column.  The planner only asks for that on a plain forward scan,
+	 * but if we can't do it anyway, a full scan still gives right answers.
+	 */
+	if (node->indexskipdistinct &&
+		ScanDirectionIsForward(node->indexorderdir) &&
+		indexstate->iss_NumOrderByKeys == 0 &&
+		!node->scan.plan.parallel_aware &&
+		indexstate->iss_RelationDesc->rd_index->indkey.values[0] != 0 &&
+		!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)))
+		indexstate->iss_SkipKey =
+			ExecIndexAddSkipKey(indexstate->iss_RelationDesc,
+								&indexstate->iss_ScanKeys,
+								&indexstate->iss_NumScanKeys,
+								indexstate->iss_RuntimeKeys,
+								indexstate->iss_NumRuntimeKeys);
+
+	/*
+	 * Decide whether to read ahead in the index to prefetch heap blocks.  We
+	 * can't do that if the scan may have to change direction or restore a
+	 * marked position, nor if ORDER BY values need to be rechecked, since
+	 * the index AM has moved on by the time we look at the heap tuple.  A
+	 * loose scan reads only one entry before each rescan, so reading ahead
+	 * would just be wasted.
+	 */
+	if (indexstate->iss_NumOrderByKeys == 0 &&
+		indexstate->iss_SkipKey == NULL &&
+		!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)))
+		indexstate->iss_PrefetchDistance = index_prefetch_distance;
+
 	/* Initialize sort support, if we need to re-check ORDER BY exprs */
 	if (indexstate->iss_NumOrderByKeys > 0)
 	{
@@ -1724,6 +2129,8 @@ ExecIndexScanInitializeDSM(IndexScanState *node,
 								 node->iss_NumScanKeys,
 								 node->iss_NumOrderByKeys,
 								 piscan);
+	index_prefetch_begin(node->iss_ScanDesc, node->iss_PrefetchDistance,
+						 false);
 
 	/*
 	 * If no run-time keys to calculate or they are ready, go ahead and pass
@@ -1788,6 +2195,8 @@ ExecIndexScanInitializeWorker(IndexScanState *node,
 								 node->iss_NumScanKeys,
 								 node->iss_NumOrderByKeys,
 								 piscan);
+	index_prefetch_begin(node->iss_ScanDesc, node->iss_PrefetchDistance,
+						 false);
 
 	/*
 	 * If no run-time keys to calculate or they are ready, go ahead and pass
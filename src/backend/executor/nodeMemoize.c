@@ -18,12 +18,14 @@
  * these when it thinks rescans for previously seen values are likely enough
  * to warrant adding the additional node.
  *
- * The method of cache we use is a hash table.  When the cache fills, we never
- * spill tuples to disk, instead, we choose to evict the least recently used
- * cache entry from the cache.  We remember the least recently used entry by
- * always pushing new entries and entries we look for onto the tail of a
- * doubly linked list.  This means that older items always bubble to the top
- * of this LRU list.
+ * The method of cache we use is a hash table, generated by lib/swisshash.h,
+ * which copes better than simplehash.h with the constant evictions of a full
+ * cache, and never moves an entry when others are evicted.  When the cache
+ * fills, we never spill tuples to disk, instead, we choose to evict the least
+ * recently used cache entry from the cache.  We remember the least recently
+ * used entry by always pushing new entries and entries we look for onto the
+ * tail of a doubly linked list.  This means that older items always bubble to
+ * the top of this LRU list.
  *
  * Sometimes our callers won't run their scans to completion. For example a
  * semi-join only needs to run until it finds a matching tuple, and once it
@@ -50,6 +52,18 @@
  * demanding, then that may allow us to start putting useful entries back into
  * the cache again.
  *
+ * In a parallel query, each participant has its own cache, so the same
+ * parameter values would otherwise be looked up in the subplan once per
+ * process.  When memoize_shared_cache is enabled, completed cache entries
+ * are also published to a dshash table in the query's DSA area, and a miss
+ * in the private cache consults that shared table before rescanning the
+ * subplan.  Shared entries are never evicted; once the shared cache's memory
+ * budget is used up we simply stop adding to it.  Entries are immutable once
+ * published, so they can be read without holding any lock after they've
+ * been found.  This is only safe when the subplan's output depends on the
+ * cache key alone, so nodes whose subplan uses any other parameter don't use
+ * the shared cache.
+ *
  *
  * INTERFACE ROUTINES
  *		ExecMemoize			- lookup cache, exec subplan when not found
@@ -70,6 +84,7 @@
 #include "common/hashfn.h"
 #include "executor/executor.h"
 #include "executor/nodeMemoize.h"
+#include "lib/dshash.h"
 #include "lib/ilist.h"
 #include "miscadmin.h"
 #include "utils/datum.h"
@@ -82,6 +97,8 @@
 #define MEMO_CACHE_BYPASS_MODE		4	/* Bypass mode.  Just read from our
 										 * subplan without caching anything */
 #define MEMO_END_OF_SCAN			5	/* Ready for rescan */
+#define MEMO_SHARED_FETCH_NEXT_TUPLE	6	/* Get another tuple from the
+											 * shared cache */
 
 
 /* Helper macros for memory accounting */
@@ -123,19 +140,74 @@ typedef struct MemoizeEntry
 	bool		complete;		/* Did we read the outer plan to completion? */
 } MemoizeEntry;
 
+/*
+ * SharedMemoizeCache
+ *		Control data for the cache shared by all participants of a parallel
+ *		query, allocated in the query's DSA area.
+ */
+typedef struct SharedMemoizeCache
+{
+	dshash_table_handle table;	/* hash table of SharedMemoizeEntry */
+	pg_atomic_uint64 mem_used;	/* bytes used by SharedMemoizeItems */
+	uint64		mem_limit;		/* memory limit for the shared cache */
+} SharedMemoizeCache;
+
+/*
+ * SharedMemoizeEntry
+ *		The data struct that the shared cache's hash table stores.  Entries
+ *		are keyed by hash value only; the actual cache keys are checked by
+ *		walking the list of items.
+ */
+typedef struct SharedMemoizeEntry
+{
+	uint32		hash;			/* Hash value of the cache key */
+	dsa_pointer items;			/* List of SharedMemoizeItem */
+} SharedMemoizeEntry;
+
+/*
+ * SharedMemoizeItem
+ *		A complete cache entry in the shared cache.  The cache key's
+ *		MinimalTuple follows the header, then ntuples cached MinimalTuples,
+ *		each MAXALIGNed.
+ */
+typedef struct SharedMemoizeItem
+{
+	dsa_pointer next;			/* Next item with the same hash value */
+	int			ntuples;		/* Number of cached tuples */
+} SharedMemoizeItem;
+
+#define SHARED_ITEM_KEY(item) \
+	((MinimalTuple) ((char *) (item) + MAXALIGN(sizeof(SharedMemoizeItem))))
+#define SHARED_ITEM_NEXT_TUPLE(tup) \
+	((MinimalTuple) ((char *) (tup) + MAXALIGN((tup)->t_len)))
+
+static const dshash_parameters shared_memoize_params = {
+	sizeof(uint32),
+	sizeof(SharedMemoizeEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	dshash_memcpy,
+	LWTRANCHE_PARALLEL_MEMOIZE
+};
+
+/* GUC parameter */
+bool		memoize_shared_cache = false;
+
 
 #define SH_PREFIX memoize
 #define SH_ELEMENT_TYPE MemoizeEntry
 #define SH_KEY_TYPE MemoizeKey *
 #define SH_SCOPE static inline
 #define SH_DECLARE
-#include "lib/simplehash.h"
+#include "lib/swisshash.h"
 
 static uint32 MemoizeHash_hash(struct memoize_hash *tb,
 							   const MemoizeKey *key);
 static bool MemoizeHash_equal(struct memoize_hash *tb,
 							  const MemoizeKey *key1,
 							  const MemoizeKey *key2);
+static uint32 memoize_hash_probeslot(MemoizeState *mstate);
+static bool memoize_key_equal(MemoizeState *mstate, MinimalTuple params);
 
 #define SH_PREFIX memoize
 #define SH_ELEMENT_TYPE MemoizeEntry
@@ -147,18 +219,27 @@ static bool MemoizeHash_equal(struct memoize_hash *tb,
 #define SH_STORE_HASH
 #define SH_GET_HASH(tb, a) a->hash
 #define SH_DEFINE
-#include "lib/simplehash.h"
+#include "lib/swisshash.h"
 
 /*
  * MemoizeHash_hash
- *		Hash function for simplehash hashtable.  'key' is unused here as we
+ *		Hash function for swisshash hashtable.  'key' is unused here as we
  *		require that all table lookups first populate the MemoizeState's
  *		probeslot with the key values to be looked up.
  */
 static uint32
 MemoizeHash_hash(struct memoize_hash *tb, const MemoizeKey *key)
 {
-	MemoizeState *mstate = (MemoizeState *) tb->private_data;
+	return memoize_hash_probeslot((MemoizeState *) tb->private_data);
+}
+
+/*
+ * memoize_hash_probeslot
+ *		Compute the hash value of the key stored in mstate's probeslot.
+ */
+static uint32
+memoize_hash_probeslot(MemoizeState *mstate)
+{
 	ExprContext *econtext = mstate->ss.ps.ps_ExprContext;
 	MemoryContext oldcontext;
 	TupleTableSlot *pslot = mstate->probeslot;
@@ -222,13 +303,24 @@ static bool
 MemoizeHash_equal(struct memoize_hash *tb, const MemoizeKey *key1,
 				  const MemoizeKey *key2)
 {
-	MemoizeState *mstate = (MemoizeState *) tb->private_data;
+	return memoize_key_equal((MemoizeState *) tb->private_data,
+							 key1->params);
+}
+
+/*
+ * memoize_key_equal
+ *		Check if the key in 'params' matches the key stored in mstate's
+ *		probeslot.
+ */
+static bool
+memoize_key_equal(MemoizeState *mstate, MinimalTuple params)
+{
 	ExprContext *econtext = mstate->ss.ps.ps_ExprContext;
 	TupleTableSlot *tslot = mstate->tableslot;
 	TupleTableSlot *pslot = mstate->probeslot;
 
 	/* probeslot should have already been prepared by prepare_probe_slot() */
-	ExecStoreMinimalTuple(key1->params, tslot, false);
+	ExecStoreMinimalTuple(params, tslot, false);
 
 	if (mstate->binary_mode)
 	{
@@ -466,7 +558,7 @@ cache_reduce_memory(MemoizeState *mstate, MemoizeKey *specialkey)
 		/*
 		 * Ideally the LRU list pointers would be stored in the entry itself
 		 * rather than in the key.  Unfortunately, we can't do that as the
-		 * simplehash.h code may resize the table and allocate new memory for
+		 * swisshash.h code may resize the table and allocate new memory for
 		 * entries which would result in those pointers pointing to the old
 		 * buckets.  However, it's fine to use the key to store this as that's
 		 * only referenced by a pointer in the entry, which of course follows
@@ -591,25 +683,10 @@ cache_lookup(MemoizeState *mstate, bool *found)
 			return NULL;
 
 		/*
-		 * The process of removing entries from the cache may have caused the
-		 * code in simplehash.h to shuffle elements to earlier buckets in the
-		 * hash table.  If it has, we'll need to find the entry again by
-		 * performing a lookup.  Fortunately, we can detect if this has
-		 * happened by seeing if the entry is still in use and that the key
-		 * pointer matches our expected key.
+		 * Removing other entries from the cache doesn't move the entry we've
+		 * just added, as swisshash.h leaves a tombstone behind instead.
 		 */
-		if (entry->status != memoize_SH_IN_USE || entry->key != key)
-		{
-			/*
-			 * We need to repopulate the probeslot as lookups performed during
-			 * the cache evictions above will have stored some other key.
-			 */
-			prepare_probe_slot(mstate, key);
-
-			/* Re-find the newly added entry */
-			entry = memoize_lookup(mstate->hashtable, NULL);
-			Assert(entry != NULL);
-		}
+		Assert(entry->status == memoize_SH_IN_USE && entry->key == key);
 	}
 
 	return entry;
@@ -669,31 +746,129 @@ cache_store_tuple(MemoizeState *mstate, TupleTableSlot *slot)
 		if (!cache_reduce_memory(mstate, key))
 			return false;
 
-		/*
-		 * The process of removing entries from the cache may have caused the
-		 * code in simplehash.h to shuffle elements to earlier buckets in the
-		 * hash table.  If it has, we'll need to find the entry again by
-		 * performing a lookup.  Fortunately, we can detect if this has
-		 * happened by seeing if the entry is still in use and that the key
-		 * pointer matches our expected key.
-		 */
-		if (entry->status != memoize_SH_IN_USE || entry->key != key)
-		{
-			/*
-			 * We need to repopulate the probeslot as lookups performed during
-			 * the cache evictions above will have stored some other key.
-			 */
-			prepare_probe_slot(mstate, key);
-
-			/* Re-find the entry */
-			mstate->entry = entry = memoize_lookup(mstate->hashtable, NULL);
-			Assert(entry != NULL);
-		}
+		/* As in cache_lookup, the entry can't have moved */
+		Assert(entry->status == memoize_SH_IN_USE && entry->key == key);
 	}
 
 	return true;
 }
 
+/*
+ * shared_cache_lookup
+ *		Look for the current scan parameters in the cache shared with the
+ *		other parallel participants.  mstate's probeslot must have been
+ *		populated by prepare_probe_slot().  Returns the matching item or NULL.
+ */
+static SharedMemoizeItem *
+shared_cache_lookup(MemoizeState *mstate)
+{
+	SharedMemoizeEntry *sentry;
+	dsa_pointer itemp;
+	uint32		hash;
+
+	hash = memoize_hash_probeslot(mstate);
+	sentry = dshash_find(mstate->shared_table, &hash, false);
+	if (sentry == NULL)
+		return NULL;
+	itemp = sentry->items;
+	dshash_release_lock(mstate->shared_table, sentry);
+
+	/*
+	 * Items are never modified once they've been added to the list, so
+	 * there's no need to hold the lock while comparing keys.
+	 */
+	while (DsaPointerIsValid(itemp))
+	{
+		SharedMemoizeItem *item = dsa_get_address(mstate->shared_area, itemp);
+
+		if (memoize_key_equal(mstate, SHARED_ITEM_KEY(item)))
+			return item;
+		itemp = item->next;
+	}
+
+	return NULL;
+}
+
+/*
+ * shared_cache_store
+ *		Publish the complete cache entry 'entry' to the cache shared with the
+ *		other parallel participants, unless the shared cache is full.
+ *
+ * If another participant has published the same key concurrently, we'll
+ * end up with a harmless duplicate; lookups just use whichever comes first.
+ */
+static void
+shared_cache_store(MemoizeState *mstate, MemoizeEntry *entry)
+{
+	SharedMemoizeCache *cache = mstate->shared_cache;
+	SharedMemoizeEntry *sentry;
+	SharedMemoizeItem *item;
+	MemoizeTuple *tuple;
+	MinimalTuple dest;
+	dsa_pointer itemp;
+	Size		size;
+	uint32		hash;
+	bool		found;
+
+	Assert(entry->complete);
+
+	size = MAXALIGN(sizeof(SharedMemoizeItem)) +
+		MAXALIGN(entry->key->params->t_len);
+	for (tuple = entry->tuplehead; tuple != NULL; tuple = tuple->next)
+		size += MAXALIGN(tuple->mintuple->t_len);
+
+	/* Reserve space in the shared cache's memory budget */
+	if (pg_atomic_read_u64(&cache->mem_used) + size > cache->mem_limit)
+		return;
+	if (pg_atomic_add_fetch_u64(&cache->mem_used, size) > cache->mem_limit)
+	{
+		pg_atomic_sub_fetch_u64(&cache->mem_used, size);
+		return;
+	}
+
+	itemp = dsa_allocate_extended(mstate->shared_area, size,
+								  DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(itemp))
+	{
+		pg_atomic_sub_fetch_u64(&cache->mem_used, size);
+		return;
+	}
+
+	/* Copy the key and the tuples into the new item */
+	item = dsa_get_address(mstate->shared_area, itemp);
+	item->ntuples = 0;
+	dest = SHARED_ITEM_KEY(item);
+	memcpy(dest, entry->key->params, entry->key->params->t_len);
+	for (tuple = entry->tuplehead; tuple != NULL; tuple = tuple->next)
+	{
+		dest = SHARED_ITEM_NEXT_TUPLE(dest);
+		memcpy(dest, tuple->mintuple, tuple->mintuple->t_len);
+		item->ntuples++;
+	}
+
+	/* Push it onto the front of the list for its hash value */
+	prepare_probe_slot(mstate, entry->key);
+	hash = memoize_hash_probeslot(mstate);
+	sentry = dshash_find_or_insert(mstate->shared_table, &hash, &found);
+	item->next = found ? sentry->items : InvalidDsaPointer;
+	sentry->items = itemp;
+	dshash_release_lock(mstate->shared_table, sentry);
+}
+
+/*
+ * entry_mark_complete
+ *		Mark 'entry' as complete and share it with the other parallel
+ *		participants, if there are any.
+ */
+static inline void
+entry_mark_complete(MemoizeState *mstate, MemoizeEntry *entry)
+{
+	entry->complete = true;
+
+	if (mstate->shared_table != NULL)
+		shared_cache_store(mstate, entry);
+}
+
 static TupleTableSlot *
 ExecMemoize(PlanState *pstate)
 {
@@ -785,6 +960,46 @@ ExecMemoize(PlanState *pstate)
 					entry_purge_tuples(node, entry);
 				}
 
+				/*
+				 * Before rescanning the outer node, see if another parallel
+				 * participant has already cached the tuples for these
+				 * parameters.
+				 */
+				if (node->shared_table != NULL)
+				{
+					SharedMemoizeItem *item;
+
+					/* cache evictions may have overwritten the probeslot */
+					prepare_probe_slot(node, entry ? entry->key : NULL);
+					item = shared_cache_lookup(node);
+
+					if (item != NULL)
+					{
+						node->stats.shared_hits += 1;	/* stats update */
+
+						/*
+						 * We don't copy the tuples into the local entry, so
+						 * get rid of it.
+						 */
+						if (entry != NULL)
+							remove_cache_entry(node, entry);
+
+						if (item->ntuples == 0)
+						{
+							node->mstatus = MEMO_END_OF_SCAN;
+							return NULL;
+						}
+
+						node->shared_tuple = SHARED_ITEM_NEXT_TUPLE(SHARED_ITEM_KEY(item));
+						node->shared_remaining = item->ntuples - 1;
+						node->mstatus = MEMO_SHARED_FETCH_NEXT_TUPLE;
+
+						slot = node->ss.ps.ps_ResultTupleSlot;
+						ExecStoreMinimalTuple(node->shared_tuple, slot, false);
+						return slot;
+					}
+				}
+
 				/* Scan the outer node for a tuple to cache */
 				outerNode = outerPlanState(node);
 				outerslot = ExecProcNode(outerNode);
@@ -798,7 +1013,7 @@ ExecMemoize(PlanState *pstate)
 					 * scan.
 					 */
 					if (likely(entry))
-						entry->complete = true;
+						entry_mark_complete(node, entry);
 
 					node->mstatus = MEMO_END_OF_SCAN;
 					return NULL;
@@ -830,7 +1045,8 @@ ExecMemoize(PlanState *pstate)
 					 * cache lookups to work even when the scan has not been
 					 * executed to completion.
 					 */
-					entry->complete = node->singlerow;
+					if (node->singlerow)
+						entry_mark_complete(node, entry);
 					node->mstatus = MEMO_FILLING_CACHE;
 				}
 
@@ -862,6 +1078,24 @@ ExecMemoize(PlanState *pstate)
 				return slot;
 			}
 
+		case MEMO_SHARED_FETCH_NEXT_TUPLE:
+			{
+				/* No more tuples in the shared cache entry */
+				if (node->shared_remaining == 0)
+				{
+					node->mstatus = MEMO_END_OF_SCAN;
+					return NULL;
+				}
+
+				node->shared_tuple = SHARED_ITEM_NEXT_TUPLE(node->shared_tuple);
+				node->shared_remaining--;
+
+				slot = node->ss.ps.ps_ResultTupleSlot;
+				ExecStoreMinimalTuple(node->shared_tuple, slot, false);
+
+				return slot;
+			}
+
 		case MEMO_FILLING_CACHE:
 			{
 				TupleTableSlot *outerslot;
@@ -880,7 +1114,7 @@ ExecMemoize(PlanState *pstate)
 				if (TupIsNull(outerslot))
 				{
 					/* No more tuples.  Mark it as complete */
-					entry->complete = true;
+					entry_mark_complete(node, entry);
 					node->mstatus = MEMO_END_OF_SCAN;
 					return NULL;
 				}
@@ -1074,6 +1308,13 @@ ExecInitMemoize(Memoize *node, EState *estate, int eflags)
 	 */
 	mstate->hashtable = NULL;
 
+	/* The shared cache, if any, is set up by ExecMemoizeInitializeDSM */
+	mstate->shared_area = NULL;
+	mstate->shared_cache = NULL;
+	mstate->shared_table = NULL;
+	mstate->shared_tuple = NULL;
+	mstate->shared_remaining = 0;
+
 	return mstate;
 }
 
@@ -1148,6 +1389,8 @@ ExecReScanMemoize(MemoizeState *node)
 	/* nullify pointers used for the last scan */
 	node->entry = NULL;
 	node->last_tuple = NULL;
+	node->shared_tuple = NULL;
+	node->shared_remaining = 0;
 
 	/*
 	 * if chgParam of subnode is not null then plan will be re-scanned by
@@ -1181,6 +1424,18 @@ ExecEstimateCacheEntryOverheadBytes(double ntuples)
  * ----------------------------------------------------------------
  */
 
+/*
+ * Can the parallel participants share a single cache for this node?  That
+ * requires the subplan's output to depend on nothing but the cache key, as
+ * other parameters might have different values in each participant.
+ */
+static bool
+memoize_can_share_cache(MemoizeState *node)
+{
+	return memoize_shared_cache &&
+		bms_is_subset(node->ss.ps.plan->extParam, node->keyparamids);
+}
+
  /* ----------------------------------------------------------------
   *		ExecMemoizeEstimate
   *
@@ -1192,8 +1447,9 @@ ExecMemoizeEstimate(MemoizeState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
-	/* don't need this if not instrumenting or no workers */
-	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+	/* don't need this if not instrumenting or sharing, or no workers */
+	if ((!node->ss.ps.instrument && !memoize_can_share_cache(node)) ||
+		pcxt->nworkers == 0)
 		return;
 
 	size = mul_size(pcxt->nworkers, sizeof(MemoizeInstrumentation));
@@ -1213,8 +1469,9 @@ ExecMemoizeInitializeDSM(MemoizeState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
-	/* don't need this if not instrumenting or no workers */
-	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+	/* don't need this if not instrumenting or sharing, or no workers */
+	if ((!node->ss.ps.instrument && !memoize_can_share_cache(node)) ||
+		pcxt->nworkers == 0)
 		return;
 
 	size = offsetof(SharedMemoizeInfo, sinstrument)
@@ -1223,6 +1480,30 @@ ExecMemoizeInitializeDSM(MemoizeState *node, ParallelContext *pcxt)
 	/* ensure any unfilled slots will contain zeroes */
 	memset(node->shared_info, 0, size);
 	node->shared_info->num_workers = pcxt->nworkers;
+	node->shared_info->shared_cache = InvalidDsaPointer;
+
+	/*
+	 * Create the shared cache.  There's no DSA area if we failed to create a
+	 * DSM segment, in which case there'll be no workers anyway.
+	 */
+	if (memoize_can_share_cache(node) && node->ss.ps.state->es_query_dsa)
+	{
+		dsa_area   *area = node->ss.ps.state->es_query_dsa;
+		dsa_pointer cachep;
+		SharedMemoizeCache *cache;
+
+		cachep = dsa_allocate(area, sizeof(SharedMemoizeCache));
+		cache = dsa_get_address(area, cachep);
+		node->shared_table = dshash_create(area, &shared_memoize_params, NULL);
+		cache->table = dshash_get_hash_table_handle(node->shared_table);
+		pg_atomic_init_u64(&cache->mem_used, 0);
+		cache->mem_limit = node->mem_limit;
+
+		node->shared_area = area;
+		node->shared_cache = cache;
+		node->shared_info->shared_cache = cachep;
+	}
+
 	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id,
 				   node->shared_info);
 }
@@ -1238,6 +1519,18 @@ ExecMemoizeInitializeWorker(MemoizeState *node, ParallelWorkerContext *pwcxt)
 {
 	node->shared_info =
 		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
+
+	if (node->shared_info != NULL &&
+		DsaPointerIsValid(node->shared_info->shared_cache))
+	{
+		dsa_area   *area = node->ss.ps.state->es_query_dsa;
+
+		node->shared_area = area;
+		node->shared_cache = dsa_get_address(area,
+											 node->shared_info->shared_cache);
+		node->shared_table = dshash_attach(area, &shared_memoize_params,
+										   node->shared_cache->table, NULL);
+	}
 }
 
 /* ----------------------------------------------------------------
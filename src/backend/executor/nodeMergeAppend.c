@@ -41,18 +41,18 @@
 #include "executor/executor.h"
 #include "executor/execPartition.h"
 #include "executor/nodeMergeAppend.h"
-#include "lib/binaryheap.h"
+#include "lib/losertree.h"
 #include "miscadmin.h"
 
 /*
- * We have one slot for each item in the heap array.  We use SlotNumber
+ * We have one slot for each source of the merge tree.  We use SlotNumber
  * to store slot indexes.  This doesn't actually provide any formal
  * type-safety, but it makes the code more self-documenting.
  */
 typedef int32 SlotNumber;
 
 static TupleTableSlot *ExecMergeAppend(PlanState *pstate);
-static int	heap_compare_slots(Datum a, Datum b, void *arg);
+static int	tree_compare_slots(int a, int b, void *arg);
 
 
 /* ----------------------------------------------------------------
@@ -127,8 +127,8 @@ ExecInitMergeAppend(MergeAppend *node, EState *estate, int eflags)
 	mergestate->ms_nplans = nplans;
 
 	mergestate->ms_slots = palloc0_array(TupleTableSlot *, nplans);
-	mergestate->ms_heap = binaryheap_allocate(nplans, heap_compare_slots,
-											  mergestate);
+	mergestate->ms_tree = losertree_allocate(nplans, tree_compare_slots,
+											 mergestate);
 
 	/*
 	 * call ExecInitNode on each of the valid plans to be executed and save
@@ -187,7 +187,7 @@ ExecInitMergeAppend(MergeAppend *node, EState *estate, int eflags)
 
 		/*
 		 * It isn't feasible to perform abbreviated key conversion, since
-		 * tuples are pulled into mergestate's binary heap as needed.  It
+		 * tuples are pulled into mergestate's merge tree as needed.  It
 		 * would likely be counter-productive to convert tuples into an
 		 * abbreviated representation as they're pulled up, so opt out of that
 		 * additional optimization entirely.
@@ -237,44 +237,45 @@ ExecMergeAppend(PlanState *pstate)
 
 		/*
 		 * First time through: pull the first tuple from each valid subplan,
-		 * and set up the heap.
+		 * and set up the merge tree.
 		 */
+		losertree_reset(node->ms_tree, node->ms_nplans);
 		i = -1;
 		while ((i = bms_next_member(node->ms_valid_subplans, i)) >= 0)
 		{
 			node->ms_slots[i] = ExecProcNode(node->mergeplans[i]);
 			if (!TupIsNull(node->ms_slots[i]))
-				binaryheap_add_unordered(node->ms_heap, Int32GetDatum(i));
+				losertree_add_unordered(node->ms_tree, i);
 		}
-		binaryheap_build(node->ms_heap);
+		losertree_build(node->ms_tree);
 		node->ms_initialized = true;
 	}
 	else
 	{
 		/*
 		 * Otherwise, pull the next tuple from whichever subplan we returned
-		 * from last time, and reinsert the subplan index into the heap,
-		 * because it might now compare differently against the existing
-		 * elements of the heap.  (We could perhaps simplify the logic a bit
-		 * by doing this before returning from the prior call, but it's better
-		 * to not pull tuples until necessary.)
+		 * from last time, and replay the subplan's matches in the tree,
+		 * because it might now compare differently against the other
+		 * subplans.  (We could perhaps simplify the logic a bit by doing this
+		 * before returning from the prior call, but it's better to not pull
+		 * tuples until necessary.)
 		 */
-		i = DatumGetInt32(binaryheap_first(node->ms_heap));
+		i = losertree_first(node->ms_tree);
 		node->ms_slots[i] = ExecProcNode(node->mergeplans[i]);
 		if (!TupIsNull(node->ms_slots[i]))
-			binaryheap_replace_first(node->ms_heap, Int32GetDatum(i));
+			losertree_replace_first(node->ms_tree);
 		else
-			(void) binaryheap_remove_first(node->ms_heap);
+			losertree_remove_first(node->ms_tree);
 	}
 
-	if (binaryheap_empty(node->ms_heap))
+	if (losertree_empty(node->ms_tree))
 	{
-		/* All the subplans are exhausted, and so is the heap */
+		/* All the subplans are exhausted */
 		result = ExecClearTuple(node->ps.ps_ResultTupleSlot);
 	}
 	else
 	{
-		i = DatumGetInt32(binaryheap_first(node->ms_heap));
+		i = losertree_first(node->ms_tree);
 		result = node->ms_slots[i];
 	}
 
@@ -284,12 +285,12 @@ ExecMergeAppend(PlanState *pstate)
 /*
  * Compare the tuples in the two given slots.
  */
-static int32
-heap_compare_slots(Datum a, Datum b, void *arg)
+static int
+tree_compare_slots(int a, int b, void *arg)
 {
 	MergeAppendState *node = (MergeAppendState *) arg;
-	SlotNumber	slot1 = DatumGetInt32(a);
-	SlotNumber	slot2 = DatumGetInt32(b);
+	SlotNumber	slot1 = a;
+	SlotNumber	slot2 = b;
 
 	TupleTableSlot *s1 = node->ms_slots[slot1];
 	TupleTableSlot *s2 = node->ms_slots[slot2];
@@ -315,10 +316,7 @@ heap_compare_slots(Datum a, Datum b, void *arg)
 									  datum2, isNull2,
 									  sortKey);
 		if (compare != 0)
-		{
-			INVERT_COMPARE_RESULT(compare);
 			return compare;
-		}
 	}
 	return 0;
 }
@@ -387,6 +385,5 @@ ExecReScanMergeAppend(MergeAppendState *node)
 		if (subnode->chgParam == NULL)
 			ExecReScan(subnode);
 	}
-	binaryheap_reset(node->ms_heap);
 	node->ms_initialized = false;
 }
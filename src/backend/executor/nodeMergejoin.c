@@ -94,9 +94,14 @@
 
 #include "access/nbtree.h"
 #include "executor/execdebug.h"
+#include "executor/nodeIndexonlyscan.h"
+#include "executor/nodeIndexscan.h"
 #include "executor/nodeMergejoin.h"
 #include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "parser/parsetree.h"
 #include "utils/lsyscache.h"
+#include "utils/rel.h"
 
 
 /*
@@ -114,6 +119,12 @@
 #define EXEC_MJ_ENDOUTER				10
 #define EXEC_MJ_ENDINNER				11
 
+/*
+ * Number of consecutive inner tuples skipped before we restart the inner
+ * index scan at the current outer key rather than keep stepping over them.
+ */
+#define MJ_INNER_SKIP_THRESHOLD			16
+
 /*
  * Runtime data for each mergejoin clause
  */
@@ -528,6 +539,102 @@ check_constant_qual(List *qual, bool *is_const_false)
 }
 
 
+/*
+ * MJInitInnerBound
+ *
+ * When the inner input is a btree index scan in the merge order, the join
+ * doesn't have to read every inner tuple below the current outer key: it
+ * can restart the index scan at that key instead, which is much cheaper when
+ * the outer keys are sparse compared to the inner ones.  Check whether that
+ * is possible, and if so, set up the index scan for it.
+ *
+ * Only the first merge key is used, which is enough to skip all inner tuples
+ * that sort before the outer tuple.  Skipped inner tuples are never needed
+ * again, except to emit them in a right or full join.
+ */
+static bool
+MJInitInnerBound(MergeJoinState *mergestate, MergeJoin *node)
+{
+	PlanState  *innerPlan = innerPlanState(mergestate);
+	OpExpr	   *clause;
+	Expr	   *innerExpr;
+	Var		   *var;
+	TargetEntry *tle;
+	Oid			argtype;
+
+	if (mergestate->mj_FillInner || mergestate->mj_NumClauses == 0 ||
+		node->mergeReversals[0])
+		return false;
+
+	clause = linitial_node(OpExpr, node->mergeclauses);
+	argtype = exprType((Node *) linitial(clause->args));
+
+	/* The inner side of the clause must be a column of the inner plan */
+	innerExpr = (Expr *) lsecond(clause->args);
+	while (IsA(innerExpr, RelabelType))
+		innerExpr = ((RelabelType *) innerExpr)->arg;
+	if (!IsA(innerExpr, Var) || ((Var *) innerExpr)->varno != INNER_VAR)
+		return false;
+
+	tle = get_tle_by_resno(innerPlan->plan->targetlist,
+						   ((Var *) innerExpr)->varattno);
+	if (tle == NULL)
+		return false;
+	innerExpr = tle->expr;
+	while (IsA(innerExpr, RelabelType))
+		innerExpr = ((RelabelType *) innerExpr)->arg;
+	if (!IsA(innerExpr, Var))
+		return false;
+	var = (Var *) innerExpr;
+
+	/* ... and that column must be the first column of the index */
+	if (IsA(innerPlan, IndexScanState))
+	{
+		IndexScanState *iss = (IndexScanState *) innerPlan;
+
+		if (var->varno != ((Scan *) innerPlan->plan)->scanrelid ||
+			iss->iss_RelationDesc->rd_index->indkey.values[0] != var->varattno)
+			return false;
+		return ExecIndexScanInitLowerBound(iss,
+										   node->mergeFamilies[0],
+										   node->mergeCollations[0],
+										   argtype);
+	}
+	else if (IsA(innerPlan, IndexOnlyScanState))
+	{
+		if (var->varno != INDEX_VAR || var->varattno != 1)
+			return false;
+		return ExecIndexOnlyScanInitLowerBound((IndexOnlyScanState *) innerPlan,
+											   node->mergeFamilies[0],
+											   node->mergeCollations[0],
+											   argtype);
+	}
+
+	return false;
+}
+
+/*
+ * MJRepositionInner
+ *
+ * Restart the inner index scan at the first key of the current outer tuple.
+ */
+static void
+MJRepositionInner(MergeJoinState *mergestate)
+{
+	PlanState  *innerPlan = innerPlanState(mergestate);
+	Datum		value = mergestate->mj_Clauses[0].ldatum;
+
+	Assert(!mergestate->mj_Clauses[0].lisnull);
+
+	if (IsA(innerPlan, IndexScanState))
+		ExecIndexScanSetLowerBound((IndexScanState *) innerPlan, value);
+	else
+		ExecIndexOnlyScanSetLowerBound((IndexOnlyScanState *) innerPlan,
+									   value);
+	mergestate->mj_InnerSkipCount = 0;
+}
+
+
 /* ----------------------------------------------------------------
  *		ExecMergeTupleDump
  *
@@ -654,6 +761,9 @@ ExecMergeJoin(PlanState *pstate)
 				switch (MJEvalOuterValues(node))
 				{
 					case MJEVAL_MATCHABLE:
+						/* Start the inner scan at the outer key, if we can */
+						if (node->mj_InnerBound)
+							MJRepositionInner(node);
 						/* OK to go get the first inner tuple */
 						node->mj_JoinState = EXEC_MJ_INITIALIZE_INNER;
 						break;
@@ -1193,9 +1303,13 @@ ExecMergeJoin(PlanState *pstate)
 					MarkInnerTuple(node->mj_InnerTupleSlot, node);
 
 					node->mj_JoinState = EXEC_MJ_JOINTUPLES;
+					node->mj_InnerSkipCount = 0;
 				}
 				else if (compareResult < 0)
+				{
 					node->mj_JoinState = EXEC_MJ_SKIPOUTER_ADVANCE;
+					node->mj_InnerSkipCount = 0;
+				}
 				else
 					/* compareResult > 0 */
 					node->mj_JoinState = EXEC_MJ_SKIPINNER_ADVANCE;
@@ -1292,6 +1406,14 @@ ExecMergeJoin(PlanState *pstate)
 				if (node->mj_ExtraMarks)
 					ExecMarkPos(innerPlan);
 
+				/*
+				 * If we have been stepping over inner tuples for a while,
+				 * jump ahead to the current outer key instead.
+				 */
+				if (node->mj_InnerBound &&
+					++node->mj_InnerSkipCount >= MJ_INNER_SKIP_THRESHOLD)
+					MJRepositionInner(node);
+
 				/*
 				 * now we get the next inner tuple, if any
 				 */
@@ -1607,6 +1729,10 @@ ExecInitMergeJoin(MergeJoin *node, EState *estate, int eflags)
 											node->mergeNullsFirst,
 											(PlanState *) mergestate);
 
+	/* see if the inner scan can skip ahead */
+	mergestate->mj_InnerBound = MJInitInnerBound(mergestate, node);
+	mergestate->mj_InnerSkipCount = 0;
+
 	/*
 	 * initialize join state
 	 */
@@ -1659,6 +1785,7 @@ ExecReScanMergeJoin(MergeJoinState *node)
 	node->mj_JoinState = EXEC_MJ_INITIALIZE_OUTER;
 	node->mj_MatchedOuter = false;
 	node->mj_MatchedInner = false;
+	node->mj_InnerSkipCount = 0;
 	node->mj_OuterTupleSlot = NULL;
 	node->mj_InnerTupleSlot = NULL;
 
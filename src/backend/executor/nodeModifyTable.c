@@ -132,6 +132,9 @@ typedef struct UpdateContext
 	LockTupleMode lockmode;
 } UpdateContext;
 
+/* Maximum number of updated tuples whose index insertions are batched */
+#define MT_INDEX_BATCH_SIZE		1000
+
 
 static void ExecBatchInsert(ModifyTableState *mtstate,
 							ResultRelInfo *resultRelInfo,
@@ -141,6 +144,12 @@ static void ExecBatchInsert(ModifyTableState *mtstate,
 							EState *estate,
 							bool canSetTag);
 static void ExecPendingInserts(EState *estate);
+static bool ExecCanBatchIndexInserts(ModifyTable *node,
+									 ResultRelInfo *resultRelInfo);
+static void ExecBufferIndexInserts(ModifyTableState *mtstate,
+								   ResultRelInfo *resultRelInfo,
+								   TupleTableSlot *slot);
+static void ExecFlushIndexInserts(ModifyTableState *mtstate);
 static void ExecCrossPartitionUpdateForeignKey(ModifyTableContext *context,
 											   ResultRelInfo *sourcePartInfo,
 											   ResultRelInfo *destPartInfo,
@@ -451,7 +460,8 @@ ExecInitGenerated(ResultRelInfo *resultRelInfo,
 	 * columns.
 	 */
 	if (cmdtype == CMD_UPDATE &&
-		!(rel->trigdesc && rel->trigdesc->trig_update_before_row))
+		!(RelationGetTriggerDesc(rel) &&
+		  RelationGetTriggerDesc(rel)->trig_update_before_row))
 		updatedCols = ExecGetUpdatedCols(resultRelInfo, estate);
 	else
 		updatedCols = NULL;
@@ -2173,6 +2183,8 @@ ExecUpdateAct(ModifyTableContext *context, ResultRelInfo *resultRelInfo,
 {
 	EState	   *estate = context->estate;
 	Relation	resultRelationDesc = resultRelInfo->ri_RelationDesc;
+	TupleTableSlot *oldSlot = resultRelInfo->ri_oldTupleSlot;
+	Bitmapset  *hot_exempt_attrs = NULL;
 	bool		partition_constraint_failed;
 	TM_Result	result;
 
@@ -2291,6 +2303,17 @@ lreplace:
 	if (resultRelationDesc->rd_att->constr)
 		ExecConstraints(resultRelInfo, slot, estate);
 
+	/*
+	 * If the row version being replaced is at hand, check whether the columns
+	 * of expression indexes that changed leave the index values unchanged, so
+	 * that they don't prevent a HOT update.
+	 */
+	if (resultRelInfo->ri_NumIndices > 0 &&
+		oldSlot != NULL && !TTS_EMPTY(oldSlot) &&
+		ItemPointerEquals(&oldSlot->tts_tid, tupleid))
+		hot_exempt_attrs = ExecGetHotExemptAttrs(resultRelInfo, oldSlot,
+												 slot, estate);
+
 	/*
 	 * replace the heap tuple
 	 *
@@ -2305,6 +2328,7 @@ lreplace:
 								estate->es_snapshot,
 								estate->es_crosscheck_snapshot,
 								true /* wait for commit */ ,
+								hot_exempt_attrs,
 								&context->tmfd, &updateCxt->lockmode,
 								&updateCxt->updateIndexes);
 
@@ -2325,13 +2349,30 @@ ExecUpdateEpilogue(ModifyTableContext *context, UpdateContext *updateCxt,
 	ModifyTableState *mtstate = context->mtstate;
 	List	   *recheckIndexes = NIL;
 
-	/* insert index entries for tuple if necessary */
+	/*
+	 * Insert index entries for tuple if necessary.  If allowed, entries for
+	 * indexes that can take them in batches are only buffered here, and
+	 * inserted by ExecFlushIndexInserts() later.  Unique and exclusion
+	 * constraints are still checked for each row right away.
+	 */
 	if (resultRelInfo->ri_NumIndices > 0 && (updateCxt->updateIndexes != TU_None))
-		recheckIndexes = ExecInsertIndexTuples(resultRelInfo,
-											   slot, context->estate,
-											   true, false,
-											   NULL, NIL,
-											   (updateCxt->updateIndexes == TU_Summarizing));
+	{
+		if (resultRelInfo->ri_BatchIndexInserts &&
+			updateCxt->updateIndexes == TU_All)
+		{
+			recheckIndexes = ExecInsertIndexTuplesUnbatched(resultRelInfo,
+															slot,
+															context->estate,
+															true);
+			ExecBufferIndexInserts(mtstate, resultRelInfo, slot);
+		}
+		else
+			recheckIndexes = ExecInsertIndexTuples(resultRelInfo,
+												   slot, context->estate,
+												   true, false,
+												   NULL, NIL,
+												   (updateCxt->updateIndexes == TU_Summarizing));
+	}
 
 	/* AFTER ROW UPDATE Triggers */
 	ExecARUpdateTriggers(context->estate, resultRelInfo,
@@ -2359,6 +2400,115 @@ ExecUpdateEpilogue(ModifyTableContext *context, UpdateContext *updateCxt,
 							 slot, context->estate);
 }
 
+/*
+ * ExecCanBatchIndexInserts -- may UPDATEs of this relation batch their index
+ * insertions?
+ *
+ * The planner has checked that the statement itself can't look at the new
+ * row versions before the end of the statement.  BEFORE ROW triggers and
+ * CHECK constraints can run arbitrary queries, too, so we don't batch when
+ * they could be looking for rows updated earlier.
+ */
+static bool
+ExecCanBatchIndexInserts(ModifyTable *node, ResultRelInfo *resultRelInfo)
+{
+	Relation	rel = resultRelInfo->ri_RelationDesc;
+	TriggerDesc *trigDesc = resultRelInfo->ri_TrigDesc;
+	TupleConstr *constr = RelationGetDescr(rel)->constr;
+
+	if (!node->batchIndexInserts ||
+		!rel->rd_rel->relhasindex ||
+		resultRelInfo->ri_FdwRoutine != NULL)
+		return false;
+
+	if (trigDesc &&
+		(trigDesc->trig_update_before_row || trigDesc->trig_update_instead_row))
+		return false;
+
+	if (constr)
+	{
+		for (int i = 0; i < constr->num_check; i++)
+		{
+			if (contain_volatile_functions(stringToNode(constr->check[i].ccbin)))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * ExecBufferIndexInserts -- remember an updated tuple whose index entries
+ * are to be inserted by ExecFlushIndexInserts()
+ *
+ * Only one result relation's tuples are buffered at a time; switching to
+ * another one flushes the buffer.
+ */
+static void
+ExecBufferIndexInserts(ModifyTableState *mtstate,
+					   ResultRelInfo *resultRelInfo,
+					   TupleTableSlot *slot)
+{
+	EState	   *estate = mtstate->ps.state;
+	TupleTableSlot *batchslot;
+
+	if (mtstate->mt_indexBatchRel != resultRelInfo)
+	{
+		ExecFlushIndexInserts(mtstate);
+
+		/* The slots made for another relation may not fit this one */
+		for (int i = 0; i < mtstate->mt_indexBatchSlotsInitialized; i++)
+			ExecDropSingleTupleTableSlot(mtstate->mt_indexBatchSlots[i]);
+		mtstate->mt_indexBatchSlotsInitialized = 0;
+		mtstate->mt_indexBatchRel = resultRelInfo;
+	}
+
+	if (mtstate->mt_indexBatchSlots == NULL)
+		mtstate->mt_indexBatchSlots =
+			MemoryContextAlloc(estate->es_query_cxt,
+							   sizeof(TupleTableSlot *) * MT_INDEX_BATCH_SIZE);
+
+	/* As in ExecInsert(), use a private tuple descriptor copy per slot */
+	if (mtstate->mt_indexBatchCount >= mtstate->mt_indexBatchSlotsInitialized)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+		TupleDesc	tdesc = CreateTupleDescCopy(slot->tts_tupleDescriptor);
+
+		mtstate->mt_indexBatchSlots[mtstate->mt_indexBatchCount] =
+			MakeSingleTupleTableSlot(tdesc, slot->tts_ops);
+		mtstate->mt_indexBatchSlotsInitialized++;
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	batchslot = mtstate->mt_indexBatchSlots[mtstate->mt_indexBatchCount++];
+	ExecCopySlot(batchslot, slot);
+	batchslot->tts_tid = slot->tts_tid;
+	batchslot->tts_tableOid = slot->tts_tableOid;
+
+	if (mtstate->mt_indexBatchCount >= MT_INDEX_BATCH_SIZE)
+		ExecFlushIndexInserts(mtstate);
+}
+
+/*
+ * ExecFlushIndexInserts -- insert the index entries of buffered tuples
+ */
+static void
+ExecFlushIndexInserts(ModifyTableState *mtstate)
+{
+	if (mtstate->mt_indexBatchCount == 0)
+		return;
+
+	ExecInsertIndexTuplesBatch(mtstate->mt_indexBatchRel,
+							   mtstate->mt_indexBatchSlots,
+							   mtstate->mt_indexBatchCount,
+							   mtstate->ps.state,
+							   true);
+
+	for (int i = 0; i < mtstate->mt_indexBatchCount; i++)
+		ExecClearTuple(mtstate->mt_indexBatchSlots[i]);
+	mtstate->mt_indexBatchCount = 0;
+}
+
 /*
  * Queues up an update event using the target root partitioned table's
  * trigger to check that a cross-partition update hasn't broken any foreign
@@ -4564,6 +4714,9 @@ ExecModifyTable(PlanState *pstate)
 	if (estate->es_insert_pending_result_relations != NIL)
 		ExecPendingInserts(estate);
 
+	/* Likewise for index entries of updated tuples */
+	ExecFlushIndexInserts(node);
+
 	/*
 	 * We're done, but fire AFTER STATEMENT triggers before exiting.
 	 */
@@ -4835,6 +4988,9 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 		CheckValidResultRel(resultRelInfo, operation, node->onConflictAction,
 							mergeActions);
 
+		resultRelInfo->ri_BatchIndexInserts =
+			ExecCanBatchIndexInserts(node, resultRelInfo);
+
 		resultRelInfo++;
 		i++;
 	}
@@ -5239,6 +5395,11 @@ ExecEndModifyTable(ModifyTableState *node)
 		}
 	}
 
+	/* The buffered index insertions were flushed by ExecModifyTable */
+	Assert(node->mt_indexBatchCount == 0);
+	for (i = 0; i < node->mt_indexBatchSlotsInitialized; i++)
+		ExecDropSingleTupleTableSlot(node->mt_indexBatchSlots[i]);
+
 	/*
 	 * Close all the partitioned tables, leaf partitions, and their indices
 	 * and release the slot used for tuple routing, if set.
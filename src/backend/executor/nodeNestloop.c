@@ -22,8 +22,68 @@
 #include "postgres.h"
 
 #include "executor/execdebug.h"
+#include "executor/executor.h"
+#include "executor/nodeHash.h"
 #include "executor/nodeNestloop.h"
 #include "miscadmin.h"
+#include "nodes/makefuncs.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+
+
+/*
+ * Adaptive nestloops
+ *
+ * A nestloop planned with adaptiveHashClauses counts the outer tuples it
+ * fetches.  Once there are more than adaptiveSwitchRows of them, the planner
+ * evidently underestimated the outer side badly, and rescanning the inner
+ * plan for every remaining outer tuple is likely to be very slow.  We then
+ * read the inner plan once more, storing all of its tuples in a hash table
+ * keyed by the inner sides of the hash clauses, and from then on fetch
+ * "inner tuples" from the hash table entry matching the outer tuple instead
+ * of rescanning the inner plan.  Matching tuples are returned in the order
+ * the inner plan produced them, so the join's output is the same as it
+ * would have been otherwise.  If the hash table exceeds the hash memory
+ * limit while we're building it, we throw it away and carry on as a plain
+ * nestloop.
+ */
+typedef struct NestLoopHashTuple
+{
+	struct NestLoopHashTuple *next;
+	MinimalTuple tuple;
+} NestLoopHashTuple;
+
+/* additional data for each hash table entry */
+typedef struct NestLoopHashBucket
+{
+	NestLoopHashTuple *head;
+	NestLoopHashTuple *tail;
+} NestLoopHashBucket;
+
+typedef struct NestLoopHashData
+{
+	int			numCols;		/* number of hash clauses */
+	AttrNumber *keyColIdx;		/* key columns are just 1..numCols */
+	Oid		   *tab_eq_funcoids;	/* inner = inner equality functions */
+	FmgrInfo   *tab_hash_funcs; /* inner hash functions */
+	Oid		   *tab_collations; /* collations for hashing and comparing */
+	TupleDesc	descInner;		/* tupdesc of inner key tuples */
+	ProjectionInfo *projOuter;	/* computes outer key tuple */
+	ProjectionInfo *projInner;	/* computes inner key tuple */
+	ExprState  *outer_hash_expr;	/* hashes outer key tuple */
+	ExprState  *cur_eq_comp;	/* compares outer and inner key tuples */
+	TupleTableSlot *innerSlot;	/* returns tuples from the hash table */
+
+	MemoryContext hashcxt;		/* holds the table, or NULL if none */
+	TupleHashTable hashtable;	/* NULL until we switch to hashing */
+	NestLoopHashTuple *next;	/* next match for current outer tuple */
+} NestLoopHashData;
+
+static bool ExecNestLoopUseHash(NestLoopState *node);
+static bool ExecNestLoopBuildHash(NestLoopState *node);
+static void ExecNestLoopProbeHash(NestLoopState *node);
+static void ExecNestLoopFreeHash(NestLoopState *node);
+static void ExecInitNestLoopHash(NestLoopState *nlstate, NestLoop *node);
 
 
 /* ----------------------------------------------------------------
@@ -145,10 +205,16 @@ ExecNestLoop(PlanState *pstate)
 			}
 
 			/*
-			 * now rescan the inner plan
+			 * now rescan the inner plan, or look up the current outer tuple
+			 * if we've switched to hashing
 			 */
-			ENL1_printf("rescanning inner plan");
-			ExecReScan(innerPlan);
+			if (node->nl_Hash != NULL && ExecNestLoopUseHash(node))
+				ExecNestLoopProbeHash(node);
+			else
+			{
+				ENL1_printf("rescanning inner plan");
+				ExecReScan(innerPlan);
+			}
 		}
 
 		/*
@@ -156,7 +222,23 @@ ExecNestLoop(PlanState *pstate)
 		 */
 		ENL1_printf("getting new inner tuple");
 
-		innerTupleSlot = ExecProcNode(innerPlan);
+		if (node->nl_Hash != NULL && node->nl_Hash->hashtable != NULL)
+		{
+			NestLoopHashData *hashdata = node->nl_Hash;
+			NestLoopHashTuple *htup = hashdata->next;
+
+			if (htup != NULL)
+			{
+				hashdata->next = htup->next;
+				innerTupleSlot = ExecStoreMinimalTuple(htup->tuple,
+													   hashdata->innerSlot,
+													   false);
+			}
+			else
+				innerTupleSlot = NULL;
+		}
+		else
+			innerTupleSlot = ExecProcNode(innerPlan);
 		econtext->ecxt_innertuple = innerTupleSlot;
 
 		if (TupIsNull(innerTupleSlot))
@@ -254,6 +336,304 @@ ExecNestLoop(PlanState *pstate)
 	}
 }
 
+/*
+ * ExecNestLoopUseHash
+ *		Count a new outer tuple, switching to hashing if we've seen too many
+ *		of them.  Returns true if the hash table should be probed for it.
+ */
+static bool
+ExecNestLoopUseHash(NestLoopState *node)
+{
+	NestLoop   *nl = (NestLoop *) node->js.ps.plan;
+
+	if (node->nl_Hash->hashtable != NULL)
+		return true;
+
+	if (node->nl_HashFailed ||
+		++node->nl_OuterRows <= (uint64) nl->adaptiveSwitchRows)
+		return false;
+
+	if (!ExecNestLoopBuildHash(node))
+	{
+		node->nl_HashFailed = true;
+		return false;
+	}
+
+	if (node->nl_SwitchedAfter == 0)
+		node->nl_SwitchedAfter = node->nl_OuterRows - 1;
+
+	return true;
+}
+
+/*
+ * ExecNestLoopBuildHash
+ *		Read the whole inner plan into a new hash table.  Returns false,
+ *		leaving no hash table behind, if it doesn't fit in hash memory.
+ */
+static bool
+ExecNestLoopBuildHash(NestLoopState *node)
+{
+	NestLoopHashData *hashdata = node->nl_Hash;
+	EState	   *estate = node->js.ps.state;
+	ExprContext *econtext = node->js.ps.ps_ExprContext;
+	PlanState  *innerPlan = innerPlanState(node);
+	MemoryContext tuplescxt;
+	size_t		hash_mem_limit = get_hash_memory_limit();
+
+	Assert(hashdata->hashtable == NULL);
+
+	hashdata->hashcxt = AllocSetContextCreate(estate->es_query_cxt,
+											  "NestLoop hash table",
+											  ALLOCSET_DEFAULT_SIZES);
+	tuplescxt = BumpContextCreate(hashdata->hashcxt,
+								  "NestLoop hashed tuples",
+								  ALLOCSET_DEFAULT_SIZES);
+	hashdata->hashtable = BuildTupleHashTable(&node->js.ps,
+											  hashdata->descInner,
+											  &TTSOpsVirtual,
+											  hashdata->numCols,
+											  hashdata->keyColIdx,
+											  hashdata->tab_eq_funcoids,
+											  hashdata->tab_hash_funcs,
+											  hashdata->tab_collations,
+											  innerPlan->plan->plan_rows,
+											  sizeof(NestLoopHashBucket),
+											  hashdata->hashcxt,
+											  tuplescxt,
+											  econtext->ecxt_per_tuple_memory,
+											  false);
+
+	ExecReScan(innerPlan);
+	for (;;)
+	{
+		TupleTableSlot *innerslot;
+		TupleTableSlot *keyslot;
+		TupleHashEntry entry;
+		NestLoopHashBucket *bucket;
+		NestLoopHashTuple *htup;
+		MemoryContext oldcxt;
+		bool		isnew;
+		bool		hasnull = false;
+
+		innerslot = ExecProcNode(innerPlan);
+		if (TupIsNull(innerslot))
+			break;
+
+		/* inner tuples with NULL keys can never match, so skip them */
+		econtext->ecxt_innertuple = innerslot;
+		keyslot = ExecProject(hashdata->projInner);
+		slot_getallattrs(keyslot);
+		for (int i = 0; i < hashdata->numCols; i++)
+		{
+			if (keyslot->tts_isnull[i])
+			{
+				hasnull = true;
+				break;
+			}
+		}
+
+		if (!hasnull)
+		{
+			entry = LookupTupleHashEntry(hashdata->hashtable, keyslot,
+										 &isnew, NULL);
+			bucket = TupleHashEntryGetAdditional(hashdata->hashtable, entry);
+			if (isnew)
+				bucket->head = bucket->tail = NULL;
+
+			oldcxt = MemoryContextSwitchTo(tuplescxt);
+			htup = palloc(sizeof(NestLoopHashTuple));
+			htup->next = NULL;
+			htup->tuple = ExecCopySlotMinimalTuple(innerslot);
+			MemoryContextSwitchTo(oldcxt);
+
+			if (bucket->tail != NULL)
+				bucket->tail->next = htup;
+			else
+				bucket->head = htup;
+			bucket->tail = htup;
+		}
+
+		ResetExprContext(econtext);
+
+		if (MemoryContextMemAllocated(hashdata->hashcxt, true) > hash_mem_limit)
+		{
+			ExecNestLoopFreeHash(node);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * ExecNestLoopProbeHash
+ *		Set up to return the hashed inner tuples matching the current outer
+ *		tuple.
+ */
+static void
+ExecNestLoopProbeHash(NestLoopState *node)
+{
+	NestLoopHashData *hashdata = node->nl_Hash;
+	TupleTableSlot *keyslot;
+	TupleHashEntry entry;
+
+	hashdata->next = NULL;
+
+	keyslot = ExecProject(hashdata->projOuter);
+	slot_getallattrs(keyslot);
+	for (int i = 0; i < hashdata->numCols; i++)
+	{
+		if (keyslot->tts_isnull[i])
+			return;
+	}
+
+	entry = FindTupleHashEntry(hashdata->hashtable, keyslot,
+							   hashdata->cur_eq_comp,
+							   hashdata->outer_hash_expr);
+	if (entry != NULL)
+	{
+		NestLoopHashBucket *bucket;
+
+		bucket = TupleHashEntryGetAdditional(hashdata->hashtable, entry);
+		hashdata->next = bucket->head;
+	}
+}
+
+/*
+ * ExecNestLoopFreeHash
+ *		Throw away the hash table, if any.
+ */
+static void
+ExecNestLoopFreeHash(NestLoopState *node)
+{
+	NestLoopHashData *hashdata = node->nl_Hash;
+
+	if (hashdata->hashcxt != NULL)
+		MemoryContextDelete(hashdata->hashcxt);
+	hashdata->hashcxt = NULL;
+	hashdata->hashtable = NULL;
+	hashdata->next = NULL;
+}
+
+/*
+ * ExecInitNestLoopHash
+ *		Set up what we need to switch an adaptive nestloop to hashing.  The
+ *		hash table itself isn't built until needed.
+ *
+ * This is much the same as what ExecInitSubPlan does for hashed subplans.
+ */
+static void
+ExecInitNestLoopHash(NestLoopState *nlstate, NestLoop *node)
+{
+	EState	   *estate = nlstate->js.ps.state;
+	NestLoopHashData *hashdata;
+	int			ncols = list_length(node->adaptiveHashClauses);
+	Oid		   *cross_eq_funcoids;
+	FmgrInfo   *outer_hash_funcs;
+	List	   *outertlist = NIL;
+	List	   *innertlist = NIL;
+	TupleDesc	descOuter;
+	TupleTableSlot *slot;
+	ListCell   *lc;
+	int			i;
+
+	hashdata = palloc0(sizeof(NestLoopHashData));
+	hashdata->numCols = ncols;
+	hashdata->keyColIdx = (AttrNumber *) palloc(ncols * sizeof(AttrNumber));
+	hashdata->tab_eq_funcoids = (Oid *) palloc(ncols * sizeof(Oid));
+	hashdata->tab_hash_funcs = (FmgrInfo *) palloc(ncols * sizeof(FmgrInfo));
+	hashdata->tab_collations = (Oid *) palloc(ncols * sizeof(Oid));
+	outer_hash_funcs = (FmgrInfo *) palloc(ncols * sizeof(FmgrInfo));
+	cross_eq_funcoids = (Oid *) palloc(ncols * sizeof(Oid));
+
+	i = 1;
+	foreach(lc, node->adaptiveHashClauses)
+	{
+		OpExpr	   *opexpr = lfirst_node(OpExpr, lc);
+		Oid			inner_eq_oper;
+		Oid			left_hashfn;
+		Oid			right_hashfn;
+
+		Assert(list_length(opexpr->args) == 2);
+
+		outertlist = lappend(outertlist,
+							 makeTargetEntry(linitial(opexpr->args),
+											 i, NULL, false));
+		innertlist = lappend(innertlist,
+							 makeTargetEntry(lsecond(opexpr->args),
+											 i, NULL, false));
+
+		/* The clause's operator compares outer and inner keys */
+		cross_eq_funcoids[i - 1] = opexpr->opfuncid;
+
+		/* Look up the equality function for the inner type */
+		if (!get_compatible_hash_operators(opexpr->opno,
+										   NULL, &inner_eq_oper))
+			elog(ERROR, "could not find compatible hash operator for operator %u",
+				 opexpr->opno);
+		hashdata->tab_eq_funcoids[i - 1] = get_opcode(inner_eq_oper);
+
+		/* Look up the associated hash functions */
+		if (!get_op_hash_functions(opexpr->opno,
+								   &left_hashfn, &right_hashfn))
+			elog(ERROR, "could not find hash function for hash operator %u",
+				 opexpr->opno);
+		fmgr_info(left_hashfn, &outer_hash_funcs[i - 1]);
+		fmgr_info(right_hashfn, &hashdata->tab_hash_funcs[i - 1]);
+
+		hashdata->tab_collations[i - 1] = opexpr->inputcollid;
+		hashdata->keyColIdx[i - 1] = i;
+
+		i++;
+	}
+
+	/*
+	 * Both key tuples are computed in the node's own exprcontext, the outer
+	 * one from ecxt_outertuple and the inner one from ecxt_innertuple.
+	 */
+	descOuter = ExecTypeFromTL(outertlist);
+	slot = ExecInitExtraTupleSlot(estate, descOuter, &TTSOpsVirtual);
+	hashdata->projOuter = ExecBuildProjectionInfo(outertlist,
+												  nlstate->js.ps.ps_ExprContext,
+												  slot,
+												  &nlstate->js.ps,
+												  NULL);
+
+	hashdata->descInner = ExecTypeFromTL(innertlist);
+	slot = ExecInitExtraTupleSlot(estate, hashdata->descInner, &TTSOpsVirtual);
+	hashdata->projInner = ExecBuildProjectionInfo(innertlist,
+												  nlstate->js.ps.ps_ExprContext,
+												  slot,
+												  &nlstate->js.ps,
+												  NULL);
+
+	hashdata->outer_hash_expr = ExecBuildHash32FromAttrs(descOuter,
+														 &TTSOpsVirtual,
+														 outer_hash_funcs,
+														 hashdata->tab_collations,
+														 ncols,
+														 hashdata->keyColIdx,
+														 &nlstate->js.ps,
+														 0);
+
+	hashdata->cur_eq_comp = ExecBuildGroupingEqual(descOuter,
+												   hashdata->descInner,
+												   &TTSOpsVirtual,
+												   &TTSOpsMinimalTuple,
+												   ncols,
+												   hashdata->keyColIdx,
+												   cross_eq_funcoids,
+												   hashdata->tab_collations,
+												   &nlstate->js.ps);
+
+	hashdata->innerSlot =
+		ExecInitExtraTupleSlot(estate,
+							   ExecGetResultType(innerPlanState(nlstate)),
+							   &TTSOpsMinimalTuple);
+
+	nlstate->nl_Hash = hashdata;
+}
+
 /* ----------------------------------------------------------------
  *		ExecInitNestLoop
  * ----------------------------------------------------------------
@@ -339,6 +719,10 @@ ExecInitNestLoop(NestLoop *node, EState *estate, int eflags)
 				 (int) node->join.jointype);
 	}
 
+	/* prepare for switching to hashing, if the plan allows it */
+	if (node->adaptiveHashClauses != NIL)
+		ExecInitNestLoopHash(nlstate, node);
+
 	/*
 	 * finally, wipe the current outer tuple clean.
 	 */
@@ -395,6 +779,19 @@ ExecReScanNestLoop(NestLoopState *node)
 	 * outer Vars are used as run-time keys...
 	 */
 
+	/*
+	 * A hash table over the inner side remains valid unless the inner plan
+	 * depends on changed parameters.  Either way, start counting outer rows
+	 * afresh.
+	 */
+	if (node->nl_Hash != NULL)
+	{
+		if (innerPlanState(node)->chgParam != NULL)
+			ExecNestLoopFreeHash(node);
+		node->nl_OuterRows = 0;
+		node->nl_HashFailed = false;
+	}
+
 	node->nl_NeedNewOuter = true;
 	node->nl_MatchedOuter = false;
 }
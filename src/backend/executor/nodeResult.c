@@ -33,6 +33,9 @@
  *		controlled plan at all.  If it's true, we run the controlled
  *		plan normally and pass back the results.
  *
+ *		A Result node with an outer plan may also have an ordinary qual,
+ *		which is checked for each tuple the outer plan returns.
+ *
  *
  * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -109,18 +112,28 @@ ExecResult(PlanState *pstate)
 		if (outerPlan != NULL)
 		{
 			/*
-			 * retrieve tuples from the outer plan until there are no more.
+			 * retrieve tuples from the outer plan until there are no more,
+			 * skipping any that fail the qual.
 			 */
-			outerTupleSlot = ExecProcNode(outerPlan);
+			for (;;)
+			{
+				outerTupleSlot = ExecProcNode(outerPlan);
 
-			if (TupIsNull(outerTupleSlot))
-				return NULL;
+				if (TupIsNull(outerTupleSlot))
+					return NULL;
 
-			/*
-			 * prepare to compute projection expressions, which will expect to
-			 * access the input tuples as varno OUTER.
-			 */
-			econtext->ecxt_outertuple = outerTupleSlot;
+				/*
+				 * prepare to compute projection expressions, which will
+				 * expect to access the input tuples as varno OUTER.
+				 */
+				econtext->ecxt_outertuple = outerTupleSlot;
+
+				if (node->ps.qual == NULL || ExecQual(node->ps.qual, econtext))
+					break;
+
+				InstrCountFiltered1(node, 1);
+				ResetExprContext(econtext);
+			}
 		}
 		else
 		{
@@ -29,18 +29,41 @@
 
 #include "access/relscan.h"
 #include "access/tableam.h"
+#include "executor/execExpr.h"
 #include "executor/execScan.h"
 #include "executor/executor.h"
 #include "executor/nodeSeqscan.h"
+#include "lib/bloomfilter.h"
+#include "optimizer/optimizer.h"
 #include "utils/rel.h"
 
+/* GUC variable: rows fetched ahead for batched qual evaluation, 0 disables */
+int			seqscan_batch_size = 0;
+
+static TableScanDesc SeqBeginScan(SeqScanState *node, TableScanDesc scandesc);
 static TupleTableSlot *SeqNext(SeqScanState *node);
+static bool SeqNextBatch(SeqScanState *node);
+static bool SeqRuntimeFilterRejects(SeqScanState *node,
+									TupleTableSlot *slot);
 
 /* ----------------------------------------------------------------
  *						Scan Support
  * ----------------------------------------------------------------
  */
 
+/*
+ * SeqBeginScan -- finish setting up a newly begun scan
+ *
+ * Tells the table AM which columns we need, if it can use that.
+ */
+static TableScanDesc
+SeqBeginScan(SeqScanState *node, TableScanDesc scandesc)
+{
+	if (node->project_scan)
+		table_scan_set_projection(scandesc, node->scan_attrs);
+	return scandesc;
+}
+
 /* ----------------------------------------------------------------
  *		SeqNext
  *
@@ -69,20 +92,137 @@ SeqNext(SeqScanState *node)
 		 * We reach here if the scan is not parallel, or if we're serially
 		 * executing a scan that was planned to be parallel.
 		 */
-		scandesc = table_beginscan(node->ss.ss_currentRelation,
-								   estate->es_snapshot,
-								   0, NULL);
+		scandesc = SeqBeginScan(node,
+								table_beginscan(node->ss.ss_currentRelation,
+												estate->es_snapshot,
+												0, NULL));
 		node->ss.ss_currentScanDesc = scandesc;
 	}
 
 	/*
-	 * get the next tuple from the table
+	 * get the next tuple from the table, skipping rows that the runtime
+	 * filter of the hash join above us proves to have no join partner
 	 */
-	if (table_scan_getnextslot(scandesc, direction, slot))
+	while (table_scan_getnextslot(scandesc, direction, slot))
+	{
+		if (node->runtime_filter != NULL &&
+			node->runtime_filter->filter != NULL &&
+			SeqRuntimeFilterRejects(node, slot))
+		{
+			InstrCountFiltered2(node, 1);
+			CHECK_FOR_INTERRUPTS();
+			continue;
+		}
 		return slot;
+	}
 	return NULL;
 }
 
+/*
+ * SeqRuntimeFilterRejects -- check a row against the runtime filter
+ *
+ * Returns true if the join hash value of the row is definitely not in the
+ * hash table being probed by the hash join above us, or if the row has a
+ * NULL join key and so can't join at all.
+ */
+static bool
+SeqRuntimeFilterRejects(SeqScanState *node, TupleTableSlot *slot)
+{
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	Datum		hashdatum;
+	bool		isnull;
+
+	ResetExprContext(econtext);
+	econtext->ecxt_scantuple = slot;
+
+	hashdatum = ExecEvalExprSwitchContext(node->runtime_filter->hashexpr,
+										  econtext, &isnull);
+	if (isnull)
+		return true;
+
+	return bloom_lacks_hash(node->runtime_filter->filter,
+							DatumGetUInt32(hashdatum));
+}
+
+/*
+ * SeqNextBatch -- fetch the next batch of rows for ExecSeqScanBatched()
+ *
+ * Fills batchslots[] with up to batchsize rows, straight from the table AM,
+ * and evaluates the batched qual for all of them.  Returns false if the scan
+ * is exhausted.
+ */
+static bool
+SeqNextBatch(SeqScanState *node)
+{
+	EState	   *estate = node->ss.ps.state;
+	TableScanDesc scandesc = node->ss.ss_currentScanDesc;
+	int			nrows = 0;
+
+	if (scandesc == NULL)
+	{
+		/* see SeqNext() */
+		scandesc = SeqBeginScan(node,
+								table_beginscan(node->ss.ss_currentRelation,
+												estate->es_snapshot,
+												0, NULL));
+		node->ss.ss_currentScanDesc = scandesc;
+	}
+
+	while (nrows == 0 && !node->batchdone)
+	{
+		nrows = table_scan_getnextbatch(scandesc, estate->es_direction,
+										node->batchslots, node->batchsize);
+
+		/*
+		 * A short batch means the scan is exhausted.  Don't ask for more, as
+		 * the AM would start over.
+		 */
+		if (nrows < node->batchsize)
+			node->batchdone = true;
+
+		/*
+		 * Discard the rows the runtime filter rejects, moving the slots of
+		 * the rejected rows to the end of the batch.
+		 */
+		if (node->runtime_filter != NULL &&
+			node->runtime_filter->filter != NULL)
+		{
+			int			nkept = 0;
+
+			for (int i = 0; i < nrows; i++)
+			{
+				TupleTableSlot *slot = node->batchslots[i];
+
+				if (SeqRuntimeFilterRejects(node, slot))
+				{
+					InstrCountFiltered2(node, 1);
+					ExecClearTuple(slot);
+					continue;
+				}
+				node->batchslots[i] = node->batchslots[nkept];
+				node->batchslots[nkept++] = slot;
+			}
+			nrows = nkept;
+		}
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	/* release whatever is left over from the previous batch */
+	for (int i = nrows; i < node->batchcount; i++)
+		ExecClearTuple(node->batchslots[i]);
+
+	node->batchcount = nrows;
+	node->batchnext = 0;
+
+	if (nrows == 0)
+		return false;
+
+	ExecQualBatch(node->batchqual, node->batchslots, nrows,
+				  node->batchmatches);
+	return true;
+}
+
 /*
  * SeqRecheck -- access method routine to recheck a tuple in EvalPlanQual
  */
@@ -188,6 +328,69 @@ ExecSeqScanWithQualProject(PlanState *pstate)
 							pstate->ps_ProjInfo);
 }
 
+/*
+ * Variant of ExecSeqScan() that evaluates simple quals in batches.
+ *
+ * Rows are fetched ahead into batchslots[], and the batchable clauses of the
+ * qual are evaluated for all of them at once by ExecQualBatch().  The rows
+ * are then returned one at a time, after checking the rest of the qual, if
+ * any, and projecting.
+ *
+ * The row being returned is swapped into ss_ScanTupleSlot, because that's
+ * where WHERE CURRENT OF (see execCurrent.c) looks for the current row of
+ * the scan.
+ */
+static TupleTableSlot *
+ExecSeqScanBatched(PlanState *pstate)
+{
+	SeqScanState *node = castNode(SeqScanState, pstate);
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	ExprState  *qual = node->ss.ps.qual;
+	ProjectionInfo *projInfo = node->ss.ps.ps_ProjInfo;
+
+	Assert(pstate->state->es_epq_active == NULL);
+	Assert(node->batchqual != NULL);
+
+	for (;;)
+	{
+		TupleTableSlot *slot;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (node->batchnext >= node->batchcount &&
+			!SeqNextBatch(node))
+		{
+			/* end of scan; return an empty slot, like ExecScan() does */
+			if (projInfo)
+				return ExecClearTuple(projInfo->pi_state.resultslot);
+			return ExecClearTuple(node->ss.ss_ScanTupleSlot);
+		}
+
+		slot = node->batchslots[node->batchnext];
+		if (!node->batchmatches[node->batchnext++])
+		{
+			InstrCountFiltered1(node, 1);
+			continue;
+		}
+
+		ResetExprContext(econtext);
+		econtext->ecxt_scantuple = slot;
+
+		if (qual == NULL || ExecQual(qual, econtext))
+		{
+			node->batchslots[node->batchnext - 1] = node->ss.ss_ScanTupleSlot;
+			ExecClearTuple(node->ss.ss_ScanTupleSlot);
+			node->ss.ss_ScanTupleSlot = slot;
+
+			if (projInfo)
+				return ExecProject(projInfo);
+			return slot;
+		}
+
+		InstrCountFiltered1(node, 1);
+	}
+}
+
 /*
  * Variant of ExecSeqScan for when EPQ evaluation is required.  We don't
  * bother adding variants of this for with/without qual and projection as
@@ -211,6 +414,7 @@ SeqScanState *
 ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 {
 	SeqScanState *scanstate;
+	List	   *qual;
 
 	/*
 	 * Once upon a time it was possible to have an outerPlan of a SeqScan, but
@@ -252,11 +456,59 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	ExecInitResultTypeTL(&scanstate->ss.ps);
 	ExecAssignScanProjectionInfo(&scanstate->ss);
 
+	/*
+	 * If the table AM can avoid producing columns nobody looks at, work out
+	 * which ones the targetlist and the qual need.  That includes the
+	 * columns needed by a runtime filter, as these are taken from the
+	 * targetlist.
+	 */
+	if (scanstate->ss.ss_currentRelation->rd_tableam->scan_set_projection != NULL)
+	{
+		pull_varattnos((Node *) node->scan.plan.targetlist,
+					   node->scan.scanrelid, &scanstate->scan_attrs);
+		pull_varattnos((Node *) node->scan.plan.qual,
+					   node->scan.scanrelid, &scanstate->scan_attrs);
+		scanstate->project_scan = true;
+	}
+
+	/*
+	 * If enabled, evaluate what we can of the qual in batches.  That requires
+	 * reading ahead, so it's not possible if the scan direction may change.
+	 */
+	qual = node->scan.plan.qual;
+	if (seqscan_batch_size > 0 && qual != NIL &&
+		estate->es_epq_active == NULL &&
+		(eflags & EXEC_FLAG_BACKWARD) == 0)
+	{
+		List	   *residual;
+
+		scanstate->batchqual = ExecInitQualBatch(qual, seqscan_batch_size,
+												 &residual);
+		if (scanstate->batchqual != NULL)
+		{
+			TupleDesc	tupdesc = RelationGetDescr(scanstate->ss.ss_currentRelation);
+			const TupleTableSlotOps *tts_ops;
+
+			tts_ops = table_slot_callbacks(scanstate->ss.ss_currentRelation);
+
+			scanstate->batchsize = seqscan_batch_size;
+			scanstate->batchslots = palloc_array(TupleTableSlot *,
+												 scanstate->batchsize);
+			for (int i = 0; i < scanstate->batchsize; i++)
+				scanstate->batchslots[i] =
+					ExecAllocTableSlot(&estate->es_tupleTable, tupdesc,
+									   tts_ops);
+			scanstate->batchmatches = palloc_array(bool, scanstate->batchsize);
+
+			qual = residual;
+		}
+	}
+
 	/*
 	 * initialize child expressions
 	 */
 	scanstate->ss.ps.qual =
-		ExecInitQual(node->scan.plan.qual, (PlanState *) scanstate);
+		ExecInitQual(qual, (PlanState *) scanstate);
 
 	/*
 	 * When EvalPlanQual() is not in use, assign ExecProcNode for this node
@@ -265,6 +517,8 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	 */
 	if (scanstate->ss.ps.state->es_epq_active != NULL)
 		scanstate->ss.ps.ExecProcNode = ExecSeqScanEPQ;
+	else if (scanstate->batchqual != NULL)
+		scanstate->ss.ps.ExecProcNode = ExecSeqScanBatched;
 	else if (scanstate->ss.ps.qual == NULL)
 	{
 		if (scanstate->ss.ps.ps_ProjInfo == NULL)
@@ -299,6 +553,13 @@ ExecEndSeqScan(SeqScanState *node)
 	 */
 	scanDesc = node->ss.ss_currentScanDesc;
 
+	/*
+	 * release the rows fetched ahead
+	 */
+	for (int i = 0; i < node->batchcount; i++)
+		ExecClearTuple(node->batchslots[i]);
+	node->batchcount = 0;
+
 	/*
 	 * close heap scan
 	 */
@@ -324,6 +585,13 @@ ExecReScanSeqScan(SeqScanState *node)
 
 	scan = node->ss.ss_currentScanDesc;
 
+	/* forget about any rows fetched ahead */
+	for (int i = 0; i < node->batchcount; i++)
+		ExecClearTuple(node->batchslots[i]);
+	node->batchcount = 0;
+	node->batchnext = 0;
+	node->batchdone = false;
+
 	if (scan != NULL)
 		table_rescan(scan,		/* scan desc */
 					 NULL);		/* new scan keys */
@@ -331,6 +599,33 @@ ExecReScanSeqScan(SeqScanState *node)
 	ExecScanReScan((ScanState *) node);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSeqScanPrefetch
+ *
+ *		Begins the scan, if that hasn't happened yet, and lets the
+ *		table AM start reading its first blocks.  Used by Append to
+ *		overlap the I/O of the partitions it will scan next.
+ * ----------------------------------------------------------------
+ */
+void
+ExecSeqScanPrefetch(SeqScanState *node)
+{
+	EState	   *estate = node->ss.ps.state;
+
+	/* a pending rescan would throw away whatever we read */
+	if (node->ss.ps.plan->parallel_aware || node->ss.ps.chgParam != NULL)
+		return;
+
+	if (node->ss.ss_currentScanDesc == NULL)
+		node->ss.ss_currentScanDesc =
+			SeqBeginScan(node,
+						 table_beginscan(node->ss.ss_currentRelation,
+										 estate->es_snapshot,
+										 0, NULL));
+
+	table_scan_prefetch(node->ss.ss_currentScanDesc);
+}
+
 /* ----------------------------------------------------------------
  *						Parallel Scan Support
  * ----------------------------------------------------------------
@@ -374,7 +669,9 @@ ExecSeqScanInitializeDSM(SeqScanState *node,
 								  estate->es_snapshot);
 	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pscan);
 	node->ss.ss_currentScanDesc =
-		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
+		SeqBeginScan(node,
+					 table_beginscan_parallel(node->ss.ss_currentRelation,
+											  pscan));
 }
 
 /* ----------------------------------------------------------------
@@ -407,5 +704,7 @@ ExecSeqScanInitializeWorker(SeqScanState *node,
 
 	pscan = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, false);
 	node->ss.ss_currentScanDesc =
-		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
+		SeqBeginScan(node,
+					 table_beginscan_parallel(node->ss.ss_currentRelation,
+											  pscan));
 }
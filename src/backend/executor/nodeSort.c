@@ -19,7 +19,32 @@
 #include "executor/execdebug.h"
 #include "executor/nodeSort.h"
 #include "miscadmin.h"
+#include "optimizer/optimizer.h"
+#include "storage/condition_variable.h"
+#include "storage/spin.h"
 #include "utils/tuplesort.h"
+#include "utils/wait_event.h"
+
+/*
+ * State shared by the participants of a parallel-aware sort, which follows
+ * the SharedSortInfo in the node's DSM chunk.  Each participant sorts the
+ * tuples it gets from its own copy of the (partial) outer plan into a run in
+ * the shared fileset, then the leader merges the runs and returns all the
+ * tuples.  The Sharedsort follows this struct.
+ */
+typedef struct ParallelSortShared
+{
+	slock_t		mutex;
+	int			nparticipantsdone;	/* participants that finished sorting */
+	ConditionVariable workersdonecv;	/* signaled by finishing participants */
+} ParallelSortShared;
+
+#define ParallelSortSharedsort(pshared) \
+	((Sharedsort *) ((char *) (pshared) + MAXALIGN(sizeof(ParallelSortShared))))
+
+static Size ExecSortSharedSize(SortState *node, int nworkers);
+static void ExecSortParallelParticipate(SortState *node);
+static Tuplesortstate *ExecSortParallelLeader(SortState *node);
 
 
 /* ----------------------------------------------------------------
@@ -72,6 +97,26 @@ ExecSort(PlanState *pstate)
 	 * tuplesort.c. Subsequent calls just fetch tuples from tuplesort.
 	 */
 
+	if (!node->sort_Done && node->pshared != NULL &&
+		(node->am_worker || node->pcxt->nworkers_launched > 0))
+	{
+		/*
+		 * Parallel-aware sort.  Workers put their tuples into the shared sort
+		 * and return nothing; the leader returns all of the tuples.
+		 */
+		estate->es_direction = ForwardScanDirection;
+		if (node->am_worker)
+			ExecSortParallelParticipate(node);
+		else
+			node->tuplesortstate = ExecSortParallelLeader(node);
+		tuplesortstate = (Tuplesortstate *) node->tuplesortstate;
+		estate->es_direction = dir;
+
+		node->sort_Done = true;
+		node->bounded_Done = node->bounded;
+		node->bound_Done = node->bound;
+	}
+
 	if (!node->sort_Done)
 	{
 		Sort	   *plannode = (Sort *) node->ss.ps.plan;
@@ -187,6 +232,10 @@ ExecSort(PlanState *pstate)
 
 	slot = node->ss.ps.ps_ResultTupleSlot;
 
+	/* A worker of a parallel-aware sort has no tuples to return */
+	if (tuplesortstate == NULL)
+		return ExecClearTuple(slot);
+
 	/*
 	 * Fetch the next sorted item from the appropriate tuplesort function. For
 	 * datum sorts we must manage the slot ourselves and leave it clear when
@@ -246,6 +295,9 @@ ExecInitSort(Sort *node, EState *estate, int eflags)
 	sortstate->bounded = false;
 	sortstate->sort_Done = false;
 	sortstate->tuplesortstate = NULL;
+	sortstate->pshared = NULL;
+	sortstate->sharedsort = NULL;
+	sortstate->pcxt = NULL;
 
 	/*
 	 * Miscellaneous initialization
@@ -280,9 +332,10 @@ ExecInitSort(Sort *node, EState *estate, int eflags)
 
 	/*
 	 * We perform a Datum sort when we're sorting just a single column,
-	 * otherwise we perform a tuple sort.
+	 * otherwise we perform a tuple sort.  A parallel-aware sort always does
+	 * a tuple sort.
 	 */
-	if (outerTupDesc->natts == 1)
+	if (outerTupDesc->natts == 1 && !node->plan.parallel_aware)
 		sortstate->datumSort = true;
 	else
 		sortstate->datumSort = false;
@@ -384,10 +437,12 @@ ExecReScanSort(SortState *node)
 	if (outerPlan->chgParam != NULL ||
 		node->bounded != node->bounded_Done ||
 		node->bound != node->bound_Done ||
-		!node->randomAccess)
+		!node->randomAccess ||
+		node->pshared != NULL)
 	{
 		node->sort_Done = false;
-		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+		if (node->tuplesortstate != NULL)
+			tuplesort_end((Tuplesortstate *) node->tuplesortstate);
 		node->tuplesortstate = NULL;
 
 		/*
@@ -409,28 +464,27 @@ ExecReScanSort(SortState *node)
 /* ----------------------------------------------------------------
  *		ExecSortEstimate
  *
- *		Estimate space required to propagate sort statistics.
+ *		Estimate space required to propagate sort statistics, and for a
+ *		parallel-aware sort, to share the sort itself.
  * ----------------------------------------------------------------
  */
 void
 ExecSortEstimate(SortState *node, ParallelContext *pcxt)
 {
-	Size		size;
-
-	/* don't need this if not instrumenting or no workers */
-	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+	/* don't need this if not instrumenting or parallel-aware, or no workers */
+	if ((!node->ss.ps.instrument && !node->ss.ps.plan->parallel_aware) ||
+		pcxt->nworkers == 0)
 		return;
 
-	size = mul_size(pcxt->nworkers, sizeof(TuplesortInstrumentation));
-	size = add_size(size, offsetof(SharedSortInfo, sinstrument));
-	shm_toc_estimate_chunk(&pcxt->estimator, size);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   ExecSortSharedSize(node, pcxt->nworkers));
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 }
 
 /* ----------------------------------------------------------------
  *		ExecSortInitializeDSM
  *
- *		Initialize DSM space for sort statistics.
+ *		Initialize DSM space for sort statistics and parallel sorting.
  * ----------------------------------------------------------------
  */
 void
@@ -438,24 +492,68 @@ ExecSortInitializeDSM(SortState *node, ParallelContext *pcxt)
 {
 	Size		size;
 
-	/* don't need this if not instrumenting or no workers */
-	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+	/* don't need this if not instrumenting or parallel-aware, or no workers */
+	if ((!node->ss.ps.instrument && !node->ss.ps.plan->parallel_aware) ||
+		pcxt->nworkers == 0)
 		return;
 
 	size = offsetof(SharedSortInfo, sinstrument)
 		+ pcxt->nworkers * sizeof(TuplesortInstrumentation);
-	node->shared_info = shm_toc_allocate(pcxt->toc, size);
+	node->shared_info = shm_toc_allocate(pcxt->toc,
+										 ExecSortSharedSize(node, pcxt->nworkers));
 	/* ensure any unfilled slots will contain zeroes */
 	memset(node->shared_info, 0, size);
 	node->shared_info->num_workers = pcxt->nworkers;
+
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		ParallelSortShared *pshared;
+
+		node->shared_info->parallel_offset = MAXALIGN(size);
+		pshared = (ParallelSortShared *)
+			((char *) node->shared_info + node->shared_info->parallel_offset);
+		SpinLockInit(&pshared->mutex);
+		pshared->nparticipantsdone = 0;
+		ConditionVariableInit(&pshared->workersdonecv);
+
+		/* the leader may participate as well as the workers */
+		tuplesort_initialize_shared(ParallelSortSharedsort(pshared),
+									pcxt->nworkers + 1, pcxt->seg);
+
+		node->pshared = pshared;
+		node->sharedsort = ParallelSortSharedsort(pshared);
+		node->pcxt = pcxt;
+	}
+
 	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id,
 				   node->shared_info);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSortReInitializeDSM
+ *
+ *		Reset shared state before beginning a fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecSortReInitializeDSM(SortState *node, ParallelContext *pcxt)
+{
+	if (node->pshared == NULL)
+		return;
+
+	/*
+	 * The leader's tuplesort from the previous scan may still have the old
+	 * runs open, until ExecReScanSort() ends it.  That's OK, since it won't
+	 * read them again.
+	 */
+	node->pshared->nparticipantsdone = 0;
+	tuplesort_reset_shared(node->sharedsort);
+}
+
 /* ----------------------------------------------------------------
  *		ExecSortInitializeWorker
  *
- *		Attach worker to DSM space for sort statistics.
+ *		Attach worker to DSM space for sort statistics and parallel sorting.
  * ----------------------------------------------------------------
  */
 void
@@ -464,6 +562,14 @@ ExecSortInitializeWorker(SortState *node, ParallelWorkerContext *pwcxt)
 	node->shared_info =
 		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
 	node->am_worker = true;
+
+	if (node->shared_info != NULL && node->shared_info->parallel_offset != 0)
+	{
+		node->pshared = (ParallelSortShared *)
+			((char *) node->shared_info + node->shared_info->parallel_offset);
+		node->sharedsort = ParallelSortSharedsort(node->pshared);
+		tuplesort_attach_shared(node->sharedsort, pwcxt->seg);
+	}
 }
 
 /* ----------------------------------------------------------------
@@ -487,3 +593,142 @@ ExecSortRetrieveInstrumentation(SortState *node)
 	memcpy(si, node->shared_info, size);
 	node->shared_info = si;
 }
+
+/*
+ * Size of the DSM chunk of a sort node with nworkers workers.
+ */
+static Size
+ExecSortSharedSize(SortState *node, int nworkers)
+{
+	Size		size;
+
+	size = mul_size(nworkers, sizeof(TuplesortInstrumentation));
+	size = add_size(size, offsetof(SharedSortInfo, sinstrument));
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		size = add_size(MAXALIGN(size), MAXALIGN(sizeof(ParallelSortShared)));
+		size = add_size(size, tuplesort_estimate_shared(nworkers + 1));
+	}
+	return size;
+}
+
+/*
+ * Sort all tuples of our copy of the outer plan into a run of the shared
+ * sort, and tell the leader that we're done.  Used by workers, and by the
+ * leader when it participates.
+ */
+static void
+ExecSortParallelParticipate(SortState *node)
+{
+	Sort	   *plannode = (Sort *) node->ss.ps.plan;
+	PlanState  *outerNode = outerPlanState(node);
+	SortCoordinateData coordinate;
+	Tuplesortstate *tuplesortstate;
+	TupleTableSlot *slot;
+
+	coordinate.isWorker = true;
+	coordinate.nParticipants = -1;
+	coordinate.sharedsort = node->sharedsort;
+
+	tuplesortstate = tuplesort_begin_heap(ExecGetResultType(outerNode),
+										  plannode->numCols,
+										  plannode->sortColIdx,
+										  plannode->sortOperators,
+										  plannode->collations,
+										  plannode->nullsFirst,
+										  work_mem,
+										  &coordinate,
+										  TUPLESORT_NONE);
+	for (;;)
+	{
+		slot = ExecProcNode(outerNode);
+
+		if (TupIsNull(slot))
+			break;
+		tuplesort_puttupleslot(tuplesortstate, slot);
+	}
+	tuplesort_performsort(tuplesortstate);
+
+	if (node->shared_info && node->am_worker)
+	{
+		TuplesortInstrumentation *si;
+
+		Assert(IsParallelWorker());
+		Assert(ParallelWorkerNumber <= node->shared_info->num_workers);
+		si = &node->shared_info->sinstrument[ParallelWorkerNumber];
+		tuplesort_get_stats(tuplesortstate, si);
+	}
+	tuplesort_end(tuplesortstate);
+
+	SpinLockAcquire(&node->pshared->mutex);
+	node->pshared->nparticipantsdone++;
+	SpinLockRelease(&node->pshared->mutex);
+	ConditionVariableSignal(&node->pshared->workersdonecv);
+}
+
+/*
+ * Participate in the parallel sort if allowed, wait for the workers to
+ * finish their runs, and set up the merge of all the runs.  Returns the
+ * leader's Tuplesortstate, from which the sorted tuples are read.
+ *
+ * Bounded sorts and random access aren't supported by parallel tuplesorts,
+ * so a parallel-aware sort doesn't use them.  That's fine underneath a
+ * Gather Merge, which never needs to go backwards, and which the planner
+ * only puts a parallel-aware sort under if there's no LIMIT.
+ */
+static Tuplesortstate *
+ExecSortParallelLeader(SortState *node)
+{
+	Sort	   *plannode = (Sort *) node->ss.ps.plan;
+	ParallelContext *pcxt = node->pcxt;
+	SortCoordinateData coordinate;
+	Tuplesortstate *tuplesortstate;
+	int			nparticipants;
+
+	nparticipants = pcxt->nworkers_launched;
+	if (parallel_leader_participation)
+	{
+		ExecSortParallelParticipate(node);
+		nparticipants++;
+	}
+
+	/*
+	 * Make sure that every launched worker is really running, so that we
+	 * don't wait forever for a worker that failed to start.
+	 */
+	WaitForParallelWorkersToAttach(pcxt);
+
+	ConditionVariablePrepareToSleep(&node->pshared->workersdonecv);
+	for (;;)
+	{
+		int			ndone;
+
+		SpinLockAcquire(&node->pshared->mutex);
+		ndone = node->pshared->nparticipantsdone;
+		SpinLockRelease(&node->pshared->mutex);
+
+		if (ndone == nparticipants)
+			break;
+
+		ConditionVariableSleep(&node->pshared->workersdonecv,
+							   WAIT_EVENT_PARALLEL_SORT_SCAN);
+	}
+	ConditionVariableCancelSleep();
+
+	coordinate.isWorker = false;
+	coordinate.nParticipants = nparticipants;
+	coordinate.sharedsort = node->sharedsort;
+
+	tuplesortstate = tuplesort_begin_heap(ExecGetResultType(outerPlanState(node)),
+										  plannode->numCols,
+										  plannode->sortColIdx,
+										  plannode->sortOperators,
+										  plannode->collations,
+										  plannode->nullsFirst,
+										  work_mem,
+										  &coordinate,
+										  TUPLESORT_NONE);
+	tuplesort_performsort(tuplesortstate);
+
+	return tuplesortstate;
+}
@@ -10,6 +10,10 @@
  * direct correlation variables from the parent plan level), and "regular"
  * subplans, which are re-evaluated every time their result is required.
  *
+ * A correlated EXPR, EXISTS or ARRAY subplan that the planner marked with
+ * useCache remembers its results in a hash table keyed by the values of its
+ * parParams, so that repeated parameter values don't rerun the subquery.
+ *
  *
  * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -29,21 +33,62 @@
 #include <math.h>
 
 #include "access/htup_details.h"
+#include "catalog/pg_type.h"
+#include "common/hashfn.h"
 #include "executor/executor.h"
 #include "executor/nodeSubplan.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "utils/array.h"
+#include "utils/datum.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 
+/*
+ * An entry in a SubPlan's result cache.  The key is an array holding the
+ * values of the subplan's parParams, in parParam order.
+ */
+typedef struct SubPlanCacheEntry
+{
+	NullableDatum *key;			/* parParam values */
+	Datum		result;			/* the subplan's result for them */
+	bool		resultnull;		/* is the result NULL? */
+	uint32		hash;			/* hash value (cached) */
+	char		status;			/* hash status */
+} SubPlanCacheEntry;
+
+static uint32 subplan_cache_hash(struct subplancache_hash *tb,
+								 const NullableDatum *key);
+static bool subplan_cache_equal(struct subplancache_hash *tb,
+								const NullableDatum *key1,
+								const NullableDatum *key2);
+
+#define SH_PREFIX subplancache
+#define SH_ELEMENT_TYPE SubPlanCacheEntry
+#define SH_KEY_TYPE NullableDatum *
+#define SH_KEY key
+#define SH_HASH_KEY(tb, key) subplan_cache_hash(tb, key)
+#define SH_EQUAL(tb, a, b) subplan_cache_equal(tb, a, b)
+#define SH_SCOPE static inline
+#define SH_STORE_HASH
+#define SH_GET_HASH(tb, a) a->hash
+#define SH_DEFINE
+#define SH_DECLARE
+#include "lib/swisshash.h"
+
+/* initial number of entries in a SubPlan's result cache */
+#define SUBPLAN_CACHE_INITIAL_SIZE	64
+
 static Datum ExecHashSubPlan(SubPlanState *node,
 							 ExprContext *econtext,
 							 bool *isNull);
 static Datum ExecScanSubPlan(SubPlanState *node,
 							 ExprContext *econtext,
 							 bool *isNull);
+static Datum ExecCachedSubPlan(SubPlanState *node,
+							   ExprContext *econtext,
+							   bool *isNull);
 static void buildSubPlanHash(SubPlanState *node, ExprContext *econtext);
 static bool findPartialMatch(TupleHashTable hashtable, TupleTableSlot *slot,
 							 FmgrInfo *eqfunctions);
@@ -84,6 +129,8 @@ ExecSubPlan(SubPlanState *node,
 	/* Select appropriate evaluation strategy */
 	if (subplan->useHashTable)
 		retval = ExecHashSubPlan(node, econtext, isNull);
+	else if (node->cache != NULL)
+		retval = ExecCachedSubPlan(node, econtext, isNull);
 	else
 		retval = ExecScanSubPlan(node, econtext, isNull);
 
@@ -196,6 +243,183 @@ ExecHashSubPlan(SubPlanState *node,
 	return BoolGetDatum(result);
 }
 
+/*
+ * subplan_cache_hash
+ *		Hash the parParam values in 'key'.
+ *
+ * The values are compared in binary mode, see subplan_cache_equal, so we
+ * needn't look up any hash opclass for them.
+ */
+static uint32
+subplan_cache_hash(struct subplancache_hash *tb, const NullableDatum *key)
+{
+	SubPlanState *node = (SubPlanState *) tb->private_data;
+	int			nkeys = list_length(node->subplan->parParam);
+	uint32		hashkey = 0;
+
+	for (int i = 0; i < nkeys; i++)
+	{
+		/* combine successive hashkeys by rotating */
+		hashkey = pg_rotate_left32(hashkey, 1);
+
+		if (!key[i].isnull)
+			hashkey ^= datum_image_hash(key[i].value,
+										node->cacheKeyByVal[i],
+										node->cacheKeyLen[i]);
+	}
+
+	return murmurhash32(hashkey);
+}
+
+/*
+ * subplan_cache_equal
+ *		Are the parParam values in 'key1' and 'key2' binary identical?
+ *
+ * Binary equality is stricter than the types' equality operators, but a
+ * cached result is only ever reused when the subplan would see exactly the
+ * same inputs.
+ */
+static bool
+subplan_cache_equal(struct subplancache_hash *tb, const NullableDatum *key1,
+					const NullableDatum *key2)
+{
+	SubPlanState *node = (SubPlanState *) tb->private_data;
+	int			nkeys = list_length(node->subplan->parParam);
+
+	for (int i = 0; i < nkeys; i++)
+	{
+		if (key1[i].isnull != key2[i].isnull)
+			return false;
+		if (key1[i].isnull)
+			continue;
+		if (!datum_image_eq(key1[i].value, key2[i].value,
+							node->cacheKeyByVal[i], node->cacheKeyLen[i]))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * ExecCachedSubPlan: look up the result for the current parParam values in
+ * the subplan's result cache, running the subplan only on a cache miss
+ */
+static Datum
+ExecCachedSubPlan(SubPlanState *node,
+				  ExprContext *econtext,
+				  bool *isNull)
+{
+	SubPlan    *subplan = node->subplan;
+	int			nkeys = list_length(subplan->parParam);
+	SubPlanCacheEntry *entry;
+	NullableDatum *key;
+	MemoryContext oldcontext;
+	Size		mem_used;
+	Datum		result;
+	bool		found;
+	int			i;
+	ListCell   *l;
+
+	/* The caller has already evaluated the correlation values */
+	i = 0;
+	foreach(l, subplan->parParam)
+	{
+		ParamExecData *prm = &(econtext->ecxt_param_exec_vals[lfirst_int(l)]);
+
+		node->cacheProbe[i].value = prm->value;
+		node->cacheProbe[i].isnull = prm->isnull;
+		i++;
+	}
+
+	entry = subplancache_lookup(node->cache, node->cacheProbe);
+	if (entry != NULL)
+	{
+		node->cacheHits++;
+		*isNull = entry->resultnull;
+
+		/*
+		 * Hand back a copy in the caller's context, so that the result stays
+		 * valid even if the cache is emptied before the caller is done.
+		 */
+		if (entry->resultnull || node->cacheResultByVal)
+			return entry->result;
+		return datumCopy(entry->result, false, node->cacheResultLen);
+	}
+
+	node->cacheMisses++;
+	result = ExecScanSubPlan(node, econtext, isNull);
+
+	/*
+	 * Before adding the new result, make sure the cache stays within its
+	 * memory budget.  We don't try to track which entries are still useful;
+	 * if the budget is exhausted, we simply throw everything away and start
+	 * over.
+	 */
+	mem_used = MemoryContextMemAllocated(node->cacheContext, true);
+	if (mem_used > node->cacheMemLimit)
+	{
+		node->cacheEvictions += node->cache->members;
+		node->cacheMemPeak = Max(node->cacheMemPeak, mem_used);
+		MemoryContextReset(node->cacheContext);
+		node->cache = subplancache_create(node->cacheContext,
+										  SUBPLAN_CACHE_INITIAL_SIZE,
+										  node);
+	}
+
+	oldcontext = MemoryContextSwitchTo(node->cacheContext);
+
+	key = palloc_array(NullableDatum, nkeys);
+	for (i = 0; i < nkeys; i++)
+	{
+		key[i].isnull = node->cacheProbe[i].isnull;
+		if (key[i].isnull)
+			key[i].value = (Datum) 0;
+		else
+			key[i].value = datumCopy(node->cacheProbe[i].value,
+									 node->cacheKeyByVal[i],
+									 node->cacheKeyLen[i]);
+	}
+
+	entry = subplancache_insert(node->cache, key, &found);
+	Assert(!found);
+
+	entry->resultnull = *isNull;
+	if (*isNull)
+		entry->result = (Datum) 0;
+	else
+		entry->result = datumCopy(result, node->cacheResultByVal,
+								  node->cacheResultLen);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return result;
+}
+
+/*
+ * ExecSubPlanResetCache
+ *		Discard the results cached by a SubPlan.
+ *
+ * This must be done whenever a parameter the subplan depends on, other than
+ * its own parParams, changes value.
+ */
+void
+ExecSubPlanResetCache(SubPlanState *node)
+{
+	Size		mem_used;
+
+	Assert(node->cache != NULL);
+
+	if (node->cache->members == 0)
+		return;
+
+	mem_used = MemoryContextMemAllocated(node->cacheContext, true);
+	node->cacheMemPeak = Max(node->cacheMemPeak, mem_used);
+	MemoryContextReset(node->cacheContext);
+	node->cache = subplancache_create(node->cacheContext,
+									  SUBPLAN_CACHE_INITIAL_SIZE,
+									  node);
+}
+
 /*
  * ExecScanSubPlan: default case where we have to rescan subplan each time
  */
@@ -890,6 +1114,12 @@ ExecInitSubPlan(SubPlan *subplan, PlanState *parent)
 	sstate->tab_hash_funcs = NULL;
 	sstate->tab_collations = NULL;
 	sstate->cur_eq_funcs = NULL;
+	sstate->cache = NULL;
+	sstate->cacheContext = NULL;
+	sstate->cacheHits = 0;
+	sstate->cacheMisses = 0;
+	sstate->cacheEvictions = 0;
+	sstate->cacheMemPeak = 0;
 
 	/*
 	 * If this is an initplan, it has output parameters that the parent plan
@@ -916,6 +1146,62 @@ ExecInitSubPlan(SubPlan *subplan, PlanState *parent)
 		}
 	}
 
+	/*
+	 * If we are going to cache the subplan's results, set up the cache.
+	 */
+	if (subplan->useCache)
+	{
+		int			nkeys = list_length(subplan->parParam);
+		int			i;
+		ListCell   *l;
+
+		Assert(nkeys > 0 && !subplan->useHashTable && !subplan->isInitPlan);
+
+		sstate->cacheProbe = palloc_array(NullableDatum, nkeys);
+		sstate->cacheKeyLen = palloc_array(int16, nkeys);
+		sstate->cacheKeyByVal = palloc_array(bool, nkeys);
+
+		/* the args list gives us the parParams' types */
+		i = 0;
+		foreach(l, subplan->args)
+		{
+			get_typlenbyval(exprType((Node *) lfirst(l)),
+							&sstate->cacheKeyLen[i],
+							&sstate->cacheKeyByVal[i]);
+			i++;
+		}
+
+		switch (subplan->subLinkType)
+		{
+			case EXISTS_SUBLINK:
+				get_typlenbyval(BOOLOID, &sstate->cacheResultLen,
+								&sstate->cacheResultByVal);
+				break;
+			case EXPR_SUBLINK:
+				get_typlenbyval(subplan->firstColType,
+								&sstate->cacheResultLen,
+								&sstate->cacheResultByVal);
+				break;
+			case ARRAY_SUBLINK:
+				/* any array is a varlena */
+				sstate->cacheResultLen = -1;
+				sstate->cacheResultByVal = false;
+				break;
+			default:
+				elog(ERROR, "cannot cache results of subplan with sublink type %d",
+					 (int) subplan->subLinkType);
+				break;
+		}
+
+		sstate->cacheMemLimit = get_hash_memory_limit();
+		sstate->cacheContext = AllocSetContextCreate(CurrentMemoryContext,
+													 "SubPlan result cache",
+													 ALLOCSET_DEFAULT_SIZES);
+		sstate->cache = subplancache_create(sstate->cacheContext,
+											SUBPLAN_CACHE_INITIAL_SIZE,
+											sstate);
+	}
+
 	/*
 	 * If we are going to hash the subquery output, initialize relevant stuff.
 	 * (We don't create the hashtable until needed, though.)
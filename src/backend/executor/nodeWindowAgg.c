@@ -166,6 +166,22 @@ typedef struct WindowStatePerAggData
 
 	int64		transValueCount;	/* number of currently-aggregated rows */
 
+	/*
+	 * Two-stack state, used instead of restarting for a moving frame head
+	 * when the aggregate has a combine function but no inverse transition
+	 * function (see eval_windowaggregates).  For rows frontbase through
+	 * frontend - 1, frontValues[pos - frontbase] holds the combined state of
+	 * rows pos through frontend - 1.  The rows from frontend onwards are
+	 * aggregated into transValue as usual.
+	 */
+	bool		use_twostack;	/* use the two-stack strategy? */
+	FmgrInfo	combinefn;		/* only valid if use_twostack */
+	MemoryContext frontcontext; /* holds frontValues; NULL if unused */
+	Datum	   *frontValues;
+	bool	   *frontValueIsNull;
+	int64		frontbase;
+	int64		frontend;
+
 	/* Data local to eval_windowaggregates() */
 	bool		restart;		/* need to restart this agg in this cycle? */
 } WindowStatePerAggData;
@@ -182,7 +198,18 @@ static bool advance_windowaggregate_base(WindowAggState *winstate,
 static void finalize_windowaggregate(WindowAggState *winstate,
 									 WindowStatePerFunc perfuncstate,
 									 WindowStatePerAgg peraggstate,
+									 Datum transValue, bool transValueIsNull,
 									 Datum *result, bool *isnull);
+static void combine_windowaggregate(WindowAggState *winstate,
+									WindowStatePerFunc perfuncstate,
+									WindowStatePerAgg peraggstate,
+									MemoryContext memcontext,
+									Datum *value, bool *isnull,
+									Datum laterValue, bool laterIsNull);
+static void rebuild_windowaggregate_front(WindowAggState *winstate,
+										  WindowStatePerFunc perfuncstate,
+										  WindowStatePerAgg peraggstate,
+										  int64 endpos);
 
 static void eval_windowaggregates(WindowAggState *winstate);
 static void eval_windowfunction(WindowAggState *winstate,
@@ -620,11 +647,15 @@ advance_windowaggregate_base(WindowAggState *winstate,
 /*
  * finalize_windowaggregate
  * parallel to finalize_aggregate in nodeAgg.c
+ *
+ * The transition value to finalize is passed separately, since for two-stack
+ * aggregates it's not peraggstate->transValue.
  */
 static void
 finalize_windowaggregate(WindowAggState *winstate,
 						 WindowStatePerFunc perfuncstate,
 						 WindowStatePerAgg peraggstate,
+						 Datum transValue, bool transValueIsNull,
 						 Datum *result, bool *isnull)
 {
 	MemoryContext oldContext;
@@ -646,11 +677,11 @@ finalize_windowaggregate(WindowAggState *winstate,
 								 perfuncstate->winCollation,
 								 (Node *) winstate, NULL);
 		fcinfo->args[0].value =
-			MakeExpandedObjectReadOnly(peraggstate->transValue,
-									   peraggstate->transValueIsNull,
+			MakeExpandedObjectReadOnly(transValue,
+									   transValueIsNull,
 									   peraggstate->transtypeLen);
-		fcinfo->args[0].isnull = peraggstate->transValueIsNull;
-		anynull = peraggstate->transValueIsNull;
+		fcinfo->args[0].isnull = transValueIsNull;
+		anynull = transValueIsNull;
 
 		/* Fill any remaining argument positions with nulls */
 		for (i = 1; i < numFinalArgs; i++)
@@ -682,15 +713,155 @@ finalize_windowaggregate(WindowAggState *winstate,
 	else
 	{
 		*result =
-			MakeExpandedObjectReadOnly(peraggstate->transValue,
-									   peraggstate->transValueIsNull,
+			MakeExpandedObjectReadOnly(transValue,
+									   transValueIsNull,
 									   peraggstate->transtypeLen);
-		*isnull = peraggstate->transValueIsNull;
+		*isnull = transValueIsNull;
 	}
 
 	MemoryContextSwitchTo(oldContext);
 }
 
+/*
+ * combine_windowaggregate
+ * Combine the transition state *value, which covers some rows, with
+ * laterValue, which covers the rows following those, storing the result
+ * back into *value.
+ *
+ * The combine function runs in memcontext and may modify *value in place, but
+ * not laterValue.  The result may share memory with either input; the caller
+ * is expected to release all of it at once by resetting memcontext.
+ */
+static void
+combine_windowaggregate(WindowAggState *winstate,
+						WindowStatePerFunc perfuncstate,
+						WindowStatePerAgg peraggstate,
+						MemoryContext memcontext,
+						Datum *value, bool *isnull,
+						Datum laterValue, bool laterIsNull)
+{
+	LOCAL_FCINFO(fcinfo, 2);
+	MemoryContext oldContext;
+	Datum		newVal;
+
+	if (peraggstate->combinefn.fn_strict)
+	{
+		/*
+		 * As in nodeAgg.c, a NULL state stands for "no rows yet", so we just
+		 * keep the other one.
+		 */
+		if (laterIsNull)
+			return;
+		if (*isnull)
+		{
+			*value = laterValue;
+			*isnull = false;
+			return;
+		}
+	}
+
+	oldContext = MemoryContextSwitchTo(memcontext);
+
+	InitFunctionCallInfoData(*fcinfo, &(peraggstate->combinefn), 2,
+							 perfuncstate->winCollation,
+							 (Node *) winstate, NULL);
+	fcinfo->args[0].value = *value;
+	fcinfo->args[0].isnull = *isnull;
+	fcinfo->args[1].value = laterValue;
+	fcinfo->args[1].isnull = laterIsNull;
+	winstate->curaggcontext = memcontext;
+	newVal = FunctionCallInvoke(fcinfo);
+	winstate->curaggcontext = NULL;
+
+	MemoryContextSwitchTo(oldContext);
+	*value = newVal;
+	*isnull = fcinfo->isnull;
+}
+
+/*
+ * rebuild_windowaggregate_front
+ * Rebuild the front stack of a two-stack aggregate once the frame head has
+ * moved past it.
+ *
+ * All rows from the frame head up to endpos, which were aggregated into
+ * transValue, move to the front stack, and transValue starts over empty.
+ * Each row is passed through the transition function on its own, and the
+ * resulting states are then combined from the last row backwards, so that
+ * every entry covers the rows from its own position to endpos.  Each row is
+ * thus moved only once, so the cost per row stays constant however wide the
+ * frame is.
+ */
+static void
+rebuild_windowaggregate_front(WindowAggState *winstate,
+							  WindowStatePerFunc perfuncstate,
+							  WindowStatePerAgg peraggstate,
+							  int64 endpos)
+{
+	WindowObject agg_winobj = winstate->agg_winobj;
+	TupleTableSlot *temp_slot = winstate->temp_slot_1;
+	MemoryContext frontcontext = peraggstate->frontcontext;
+	MemoryContext aggcontext = peraggstate->aggcontext;
+	int64		startpos = winstate->frameheadpos;
+	int64		nrows = endpos - startpos;
+	int64		i;
+
+	Assert(nrows > 0);
+
+	MemoryContextReset(frontcontext);
+	peraggstate->frontValues = (Datum *)
+		MemoryContextAlloc(frontcontext, sizeof(Datum) * nrows);
+	peraggstate->frontValueIsNull = (bool *)
+		MemoryContextAlloc(frontcontext, sizeof(bool) * nrows);
+
+	/*
+	 * Compute each row's own transition state.  We borrow the regular
+	 * transition machinery for this, pointing the aggregate's aggcontext at
+	 * frontcontext meanwhile so that the states are allocated there.
+	 */
+	peraggstate->aggcontext = frontcontext;
+	for (i = 0; i < nrows; i++)
+	{
+		if (!window_gettupleslot(agg_winobj, startpos + i, temp_slot))
+			elog(ERROR, "could not re-fetch previously fetched frame row");
+
+		/* Set tuple context for evaluation of aggregate arguments */
+		winstate->tmpcontext->ecxt_outertuple = temp_slot;
+
+		if (peraggstate->initValueIsNull)
+			peraggstate->transValue = peraggstate->initValue;
+		else
+			peraggstate->transValue = datumCopy(peraggstate->initValue,
+												peraggstate->transtypeByVal,
+												peraggstate->transtypeLen);
+		peraggstate->transValueIsNull = peraggstate->initValueIsNull;
+		peraggstate->transValueCount = 0;
+
+		advance_windowaggregate(winstate, perfuncstate, peraggstate);
+
+		peraggstate->frontValues[i] = peraggstate->transValue;
+		peraggstate->frontValueIsNull[i] = peraggstate->transValueIsNull;
+
+		ResetExprContext(winstate->tmpcontext);
+		ExecClearTuple(temp_slot);
+	}
+	peraggstate->aggcontext = aggcontext;
+
+	/* Now turn the per-row states into suffix states */
+	for (i = nrows - 2; i >= 0; i--)
+		combine_windowaggregate(winstate, perfuncstate, peraggstate,
+								frontcontext,
+								&peraggstate->frontValues[i],
+								&peraggstate->frontValueIsNull[i],
+								peraggstate->frontValues[i + 1],
+								peraggstate->frontValueIsNull[i + 1]);
+
+	peraggstate->frontbase = startpos;
+	peraggstate->frontend = endpos;
+
+	/* The remaining stack is empty */
+	initialize_windowaggregate(winstate, perfuncstate, peraggstate);
+}
+
 /*
  * eval_windowaggregates
  * evaluate plain aggregates being used as window functions
@@ -709,6 +880,7 @@ eval_windowaggregates(WindowAggState *winstate)
 	int			wfuncno,
 				numaggs,
 				numaggs_restart,
+				numaggs_twostack,
 				i;
 	int64		aggregatedupto_nonrestarted;
 	MemoryContext oldContext;
@@ -753,6 +925,16 @@ eval_windowaggregates(WindowAggState *winstate)
 	 * must perform the aggregation all over again for all tuples within the
 	 * new frame boundaries.
 	 *
+	 * That would make the cost per row proportional to the frame size, so an
+	 * aggregate that lacks an inverse transition function but has a combine
+	 * function instead uses two stacks of transition states.  Rows entering
+	 * the frame are aggregated into transValue as usual.  When the frame head
+	 * moves past the rows covered by the other, "front" stack, all rows of
+	 * transValue are moved over to it, as an array holding for every row the
+	 * combined state of that row and all later rows in the stack (see
+	 * rebuild_windowaggregate_front).  The aggregate of the frame is then the
+	 * front entry for the frame head combined with transValue.
+	 *
 	 * If there's any exclusion clause, then we may have to aggregate over a
 	 * non-contiguous set of rows, so we punt and recalculate for every row.
 	 * (For some frame end choices, it might be that the frame is always
@@ -821,15 +1003,21 @@ eval_windowaggregates(WindowAggState *winstate)
 	 * Note that we don't strictly need to restart in the last case, but if
 	 * we're going to remove all rows from the aggregation anyway, a restart
 	 * surely is faster.
+	 *
+	 * Two-stack aggregates need no inverse transition function to handle a
+	 * moving frame head.  They don't take part in advancing aggregatedbase,
+	 * so count those that aren't restarting.
 	 *----------
 	 */
 	numaggs_restart = 0;
+	numaggs_twostack = 0;
 	for (i = 0; i < numaggs; i++)
 	{
 		peraggstate = &winstate->peragg[i];
 		if (winstate->currentpos == 0 ||
 			(winstate->aggregatedbase != winstate->frameheadpos &&
-			 !OidIsValid(peraggstate->invtransfn_oid)) ||
+			 !OidIsValid(peraggstate->invtransfn_oid) &&
+			 !peraggstate->use_twostack) ||
 			(winstate->frameOptions & FRAMEOPTION_EXCLUSION) ||
 			winstate->aggregatedupto <= winstate->frameheadpos)
 		{
@@ -837,7 +1025,11 @@ eval_windowaggregates(WindowAggState *winstate)
 			numaggs_restart++;
 		}
 		else
+		{
 			peraggstate->restart = false;
+			if (peraggstate->use_twostack)
+				numaggs_twostack++;
+		}
 	}
 
 	/*
@@ -847,7 +1039,7 @@ eval_windowaggregates(WindowAggState *winstate)
 	 * i.e. advance_windowaggregate_base() can return false, in which case
 	 * we'll restart that aggregate below.
 	 */
-	while (numaggs_restart < numaggs &&
+	while (numaggs_restart + numaggs_twostack < numaggs &&
 		   winstate->aggregatedbase < winstate->frameheadpos)
 	{
 		/*
@@ -870,7 +1062,7 @@ eval_windowaggregates(WindowAggState *winstate)
 			bool		ok;
 
 			peraggstate = &winstate->peragg[i];
-			if (peraggstate->restart)
+			if (peraggstate->restart || peraggstate->use_twostack)
 				continue;
 
 			wfuncno = peraggstate->wfuncno;
@@ -934,6 +1126,16 @@ eval_windowaggregates(WindowAggState *winstate)
 			initialize_windowaggregate(winstate,
 									   &winstate->perfunc[wfuncno],
 									   peraggstate);
+
+			/* A restarted two-stack aggregate starts with an empty front */
+			if (peraggstate->use_twostack)
+			{
+				MemoryContextReset(peraggstate->frontcontext);
+				peraggstate->frontValues = NULL;
+				peraggstate->frontValueIsNull = NULL;
+				peraggstate->frontbase = winstate->frameheadpos;
+				peraggstate->frontend = winstate->frameheadpos;
+			}
 		}
 		else if (!peraggstate->resultValueIsNull)
 		{
@@ -962,6 +1164,24 @@ eval_windowaggregates(WindowAggState *winstate)
 		ExecClearTuple(agg_row_slot);
 	}
 
+	/*
+	 * Non-restarted two-stack aggregates whose front stack no longer covers
+	 * the frame head must refill it from transValue.
+	 */
+	for (i = 0; numaggs_twostack > 0 && i < numaggs; i++)
+	{
+		peraggstate = &winstate->peragg[i];
+		if (!peraggstate->use_twostack || peraggstate->restart ||
+			winstate->frameheadpos < peraggstate->frontend)
+			continue;
+
+		wfuncno = peraggstate->wfuncno;
+		rebuild_windowaggregate_front(winstate,
+									  &winstate->perfunc[wfuncno],
+									  peraggstate,
+									  aggregatedupto_nonrestarted);
+	}
+
 	/*
 	 * Advance until we reach a row not in frame (or end of partition).
 	 *
@@ -1030,14 +1250,50 @@ next_tuple:
 	{
 		Datum	   *result;
 		bool	   *isnull;
+		Datum		transValue;
+		bool		transValueIsNull;
 
 		peraggstate = &winstate->peragg[i];
 		wfuncno = peraggstate->wfuncno;
 		result = &econtext->ecxt_aggvalues[wfuncno];
 		isnull = &econtext->ecxt_aggnulls[wfuncno];
+
+		transValue = peraggstate->transValue;
+		transValueIsNull = peraggstate->transValueIsNull;
+
+		/*
+		 * For a two-stack aggregate, add the front entry for the frame head,
+		 * if any.  That entry is still needed for later rows, so give the
+		 * combine function a copy it may scribble on.
+		 */
+		if (peraggstate->use_twostack &&
+			winstate->frameheadpos < peraggstate->frontend)
+		{
+			int64		frontpos = winstate->frameheadpos - peraggstate->frontbase;
+
+			transValue = peraggstate->frontValues[frontpos];
+			transValueIsNull = peraggstate->frontValueIsNull[frontpos];
+			if (!transValueIsNull && !peraggstate->transtypeByVal)
+			{
+				oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+				transValue = datumCopy(transValue,
+									   peraggstate->transtypeByVal,
+									   peraggstate->transtypeLen);
+				MemoryContextSwitchTo(oldContext);
+			}
+			combine_windowaggregate(winstate,
+									&winstate->perfunc[wfuncno],
+									peraggstate,
+									econtext->ecxt_per_tuple_memory,
+									&transValue, &transValueIsNull,
+									peraggstate->transValue,
+									peraggstate->transValueIsNull);
+		}
+
 		finalize_windowaggregate(winstate,
 								 &winstate->perfunc[wfuncno],
 								 peraggstate,
+								 transValue, transValueIsNull,
 								 result, isnull);
 
 		/*
@@ -1458,6 +1714,8 @@ release_partition(WindowAggState *winstate)
 	{
 		if (winstate->peragg[i].aggcontext != winstate->aggcontext)
 			MemoryContextReset(winstate->peragg[i].aggcontext);
+		if (winstate->peragg[i].frontcontext)
+			MemoryContextReset(winstate->peragg[i].frontcontext);
 	}
 
 	if (winstate->buffer)
@@ -2827,6 +3085,8 @@ ExecEndWindowAgg(WindowAggState *node)
 	{
 		if (node->peragg[i].aggcontext != node->aggcontext)
 			MemoryContextDelete(node->peragg[i].aggcontext);
+		if (node->peragg[i].frontcontext)
+			MemoryContextDelete(node->peragg[i].frontcontext);
 	}
 	MemoryContextDelete(node->partcontext);
 	MemoryContextDelete(node->aggcontext);
@@ -2896,6 +3156,7 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	bool		use_ma_code;
 	Oid			transfn_oid,
 				invtransfn_oid,
+				combinefn_oid,
 				finalfn_oid;
 	bool		finalextra;
 	char		finalmodify;
@@ -2972,6 +3233,25 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 		initvalAttNo = Anum_pg_aggregate_agginitval;
 	}
 
+	/*
+	 * If we can't use moving-aggregate mode, but the frame head can move, we
+	 * may still avoid restarting the aggregation for every row by using the
+	 * two-stack strategy of eval_windowaggregates, which needs a combine
+	 * function instead of an inverse transition function.  It also needs to
+	 * copy transition states, so it's not used for INTERNAL states (checked
+	 * below, once the transition type is resolved).  The same concerns about
+	 * volatile functions and subplans as above apply, and EXCLUDE clauses
+	 * make the frame non-contiguous, so we don't try it then.
+	 */
+	combinefn_oid = InvalidOid;
+	if (!use_ma_code &&
+		OidIsValid(aggform->aggcombinefn) &&
+		!(winstate->frameOptions & (FRAMEOPTION_START_UNBOUNDED_PRECEDING |
+									FRAMEOPTION_EXCLUSION)) &&
+		!contain_volatile_functions((Node *) wfunc) &&
+		!contain_subplans((Node *) wfunc))
+		combinefn_oid = aggform->aggcombinefn;
+
 	/*
 	 * ExecInitWindowAgg already checked permission to call aggregate function
 	 * ... but we still need to check the component functions
@@ -3007,6 +3287,16 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 			InvokeFunctionExecuteHook(invtransfn_oid);
 		}
 
+		if (OidIsValid(combinefn_oid))
+		{
+			aclresult = object_aclcheck(ProcedureRelationId, combinefn_oid, aggOwner,
+										ACL_EXECUTE);
+			if (aclresult != ACLCHECK_OK)
+				aclcheck_error(aclresult, OBJECT_FUNCTION,
+							   get_func_name(combinefn_oid));
+			InvokeFunctionExecuteHook(combinefn_oid);
+		}
+
 		if (OidIsValid(finalfn_oid))
 		{
 			aclresult = object_aclcheck(ProcedureRelationId, finalfn_oid, aggOwner,
@@ -3063,6 +3353,26 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 		fmgr_info_set_expr((Node *) invtransfnexpr, &peraggstate->invtransfn);
 	}
 
+	if (OidIsValid(combinefn_oid) && aggtranstype != INTERNALOID)
+	{
+		Expr	   *combinefnexpr;
+
+		/* the combine function takes two arguments of aggtranstype */
+		build_aggregate_transfn_expr(&aggtranstype,
+									 1,
+									 0,
+									 false,
+									 aggtranstype,
+									 wfunc->inputcollid,
+									 combinefn_oid,
+									 InvalidOid,
+									 &combinefnexpr,
+									 NULL);
+		fmgr_info(combinefn_oid, &peraggstate->combinefn);
+		fmgr_info_set_expr((Node *) combinefnexpr, &peraggstate->combinefn);
+		peraggstate->use_twostack = true;
+	}
+
 	if (OidIsValid(finalfn_oid))
 	{
 		build_aggregate_finalfn_expr(inputTypes,
@@ -3141,8 +3451,11 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	 * make the memory allocation rules for moving aggregates different than
 	 * they have historically been for plain aggregates, but that seems grotty
 	 * and likely to lead to memory leaks.
+	 *
+	 * Two-stack aggregates don't restart along with the others either, and
+	 * they need another context for their front stack.
 	 */
-	if (OidIsValid(invtransfn_oid))
+	if (OidIsValid(invtransfn_oid) || peraggstate->use_twostack)
 		peraggstate->aggcontext =
 			AllocSetContextCreate(CurrentMemoryContext,
 								  "WindowAgg Per Aggregate",
@@ -3150,6 +3463,12 @@ initialize_peragg(WindowAggState *winstate, WindowFunc *wfunc,
 	else
 		peraggstate->aggcontext = winstate->aggcontext;
 
+	if (peraggstate->use_twostack)
+		peraggstate->frontcontext =
+			AllocSetContextCreate(CurrentMemoryContext,
+								  "WindowAgg Front Stack",
+								  ALLOCSET_DEFAULT_SIZES);
+
 	ReleaseSysCache(aggTuple);
 
 	return peraggstate;
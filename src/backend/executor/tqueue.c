@@ -8,6 +8,13 @@
  *
  * A TupleQueueReader reads tuples from a shm_mq and returns the tuples.
  *
+ * To keep the per-message overhead of shm_mq out of the per-tuple cost,
+ * tuples are sent in batches: each message holds one or more MinimalTuples,
+ * each starting at a MAXALIGN'd offset.  Since a MinimalTuple begins with its
+ * length, the reader can walk through the batch without any other framing,
+ * and hands out the tuples in place.  A tuple too large to fit in a batch is
+ * sent as a message of its own, which is a valid batch as well.
+ *
  * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -22,48 +29,56 @@
 #include "access/htup_details.h"
 #include "executor/tqueue.h"
 
+/*
+ * Maximum size of a batch of tuples.  This is well below a quarter of the
+ * size of the tuple queues, which is how much shm_mq lets the sender write
+ * before telling the receiver, so that batching doesn't hold back tuples
+ * much longer than that does anyway.
+ */
+#define TQUEUE_BATCH_SIZE	8192
+
 /*
  * DestReceiver object's private contents
  *
- * queue is a pointer to data supplied by DestReceiver's caller.
+ * queue is a pointer to data supplied by DestReceiver's caller.  batch holds
+ * the tuples not sent yet.
  */
 typedef struct TQueueDestReceiver
 {
 	DestReceiver pub;			/* public fields */
 	shm_mq_handle *queue;		/* shm_mq to send to */
+	char	   *batch;			/* TQUEUE_BATCH_SIZE bytes */
+	Size		batch_used;		/* bytes used in batch */
 } TQueueDestReceiver;
 
 /*
  * TupleQueueReader object's private contents
  *
- * queue is a pointer to data supplied by reader's caller.
+ * queue is a pointer to data supplied by reader's caller.  batch points to
+ * the last message received, which is valid until the next receive, and
+ * batch_offset to the next tuple in it that we haven't returned.
  *
  * "typedef struct TupleQueueReader TupleQueueReader" is in tqueue.h
  */
 struct TupleQueueReader
 {
 	shm_mq_handle *queue;		/* shm_mq to receive from */
+	char	   *batch;
+	Size		batch_len;
+	Size		batch_offset;
 };
 
 /*
- * Receive a tuple from a query, and send it to the designated shm_mq.
+ * Send the given data, one or more tuples, to the shm_mq as one message.
  *
  * Returns true if successful, false if shm_mq has been detached.
  */
 static bool
-tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
+tqueueSendBatch(TQueueDestReceiver *tqueue, const void *data, Size len)
 {
-	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
-	MinimalTuple tuple;
 	shm_mq_result result;
-	bool		should_free;
-
-	/* Send the tuple itself. */
-	tuple = ExecFetchSlotMinimalTuple(slot, &should_free);
-	result = shm_mq_send(tqueue->queue, tuple->t_len, tuple, false, false);
 
-	if (should_free)
-		pfree(tuple);
+	result = shm_mq_send(tqueue->queue, len, data, false, false);
 
 	/* Check for failure. */
 	if (result == SHM_MQ_DETACHED)
@@ -76,6 +91,59 @@ tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
 	return true;
 }
 
+/*
+ * Send the batch of tuples collected so far, if any.
+ */
+static bool
+tqueueFlushBatch(TQueueDestReceiver *tqueue)
+{
+	Size		len = tqueue->batch_used;
+
+	if (len == 0)
+		return true;
+
+	tqueue->batch_used = 0;
+	return tqueueSendBatch(tqueue, tqueue->batch, len);
+}
+
+/*
+ * Receive a tuple from a query, and add it to the batch for the designated
+ * shm_mq, sending the batch when it's full.
+ *
+ * Returns true if successful, false if shm_mq has been detached.
+ */
+static bool
+tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
+{
+	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
+	MinimalTuple tuple;
+	bool		should_free;
+	bool		result = true;
+
+	tuple = ExecFetchSlotMinimalTuple(slot, &should_free);
+
+	/* Send the batch first if the tuple doesn't fit in it. */
+	if (tqueue->batch_used + tuple->t_len > TQUEUE_BATCH_SIZE &&
+		!tqueueFlushBatch(tqueue))
+		result = false;
+	else if (tuple->t_len > TQUEUE_BATCH_SIZE)
+	{
+		/* Send an oversized tuple by itself, without copying it. */
+		result = tqueueSendBatch(tqueue, tuple, tuple->t_len);
+	}
+	else
+	{
+		memcpy(tqueue->batch + tqueue->batch_used, tuple, tuple->t_len);
+		tqueue->batch_used = Min(MAXALIGN(tqueue->batch_used + tuple->t_len),
+								 TQUEUE_BATCH_SIZE);
+	}
+
+	if (should_free)
+		pfree(tuple);
+
+	return result;
+}
+
 /*
  * Prepare to receive tuples from executor.
  */
@@ -93,8 +161,12 @@ tqueueShutdownReceiver(DestReceiver *self)
 {
 	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
 
+	/* Send the tuples we're still holding; it's fine if nobody's listening */
 	if (tqueue->queue != NULL)
+	{
+		(void) tqueueFlushBatch(tqueue);
 		shm_mq_detach(tqueue->queue);
+	}
 	tqueue->queue = NULL;
 }
 
@@ -109,6 +181,7 @@ tqueueDestroyReceiver(DestReceiver *self)
 	/* We probably already detached from queue, but let's be sure */
 	if (tqueue->queue != NULL)
 		shm_mq_detach(tqueue->queue);
+	pfree(tqueue->batch);
 	pfree(self);
 }
 
@@ -128,6 +201,8 @@ CreateTupleQueueDestReceiver(shm_mq_handle *handle)
 	self->pub.rDestroy = tqueueDestroyReceiver;
 	self->pub.mydest = DestTupleQueue;
 	self->queue = handle;
+	self->batch = palloc(TQUEUE_BATCH_SIZE);
+	self->batch_used = 0;
 
 	return (DestReceiver *) self;
 }
@@ -166,7 +241,8 @@ DestroyTupleQueueReader(TupleQueueReader *reader)
  *
  * The returned tuple, if any, is either in shared memory or a private buffer
  * and should not be freed.  The pointer is invalid after the next call to
- * TupleQueueReaderNext().
+ * TupleQueueReaderNext().  (It actually stays valid until the rest of the
+ * batch it came in has been returned, but callers mustn't rely on that.)
  *
  * Even when shm_mq_receive() returns SHM_MQ_WOULD_BLOCK, this can still
  * accumulate bytes from a partially-read message, so it's useful to call
@@ -183,6 +259,15 @@ TupleQueueReaderNext(TupleQueueReader *reader, bool nowait, bool *done)
 	if (done != NULL)
 		*done = false;
 
+	/* Return the next tuple of the current batch, if any is left. */
+	if (reader->batch_offset < reader->batch_len)
+	{
+		tuple = (MinimalTuple) (reader->batch + reader->batch_offset);
+		Assert(reader->batch_offset + tuple->t_len <= reader->batch_len);
+		reader->batch_offset += MAXALIGN(tuple->t_len);
+		return tuple;
+	}
+
 	/* Attempt to read a message. */
 	result = shm_mq_receive(reader->queue, &nbytes, &data, nowait);
 
@@ -200,11 +285,14 @@ TupleQueueReaderNext(TupleQueueReader *reader, bool nowait, bool *done)
 	Assert(result == SHM_MQ_SUCCESS);
 
 	/*
-	 * Return a pointer to the queue memory directly (which had better be
-	 * sufficiently aligned).
+	 * Return a pointer to the first tuple in the queue memory directly (which
+	 * had better be sufficiently aligned), and remember where the rest are.
 	 */
 	tuple = (MinimalTuple) data;
-	Assert(tuple->t_len == nbytes);
+	Assert(tuple->t_len <= nbytes);
+	reader->batch = data;
+	reader->batch_len = nbytes;
+	reader->batch_offset = MAXALIGN(tuple->t_len);
 
 	return tuple;
 }
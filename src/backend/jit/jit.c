@@ -36,9 +36,11 @@ bool		jit_dump_bitcode = false;
 bool		jit_expressions = true;
 bool		jit_profiling_support = false;
 bool		jit_tuple_deforming = true;
+bool		jit_deform_cache = true;
 double		jit_above_cost = 100000;
 double		jit_inline_above_cost = 500000;
 double		jit_optimize_above_cost = 500000;
+int			jit_tier_up_calls = 0;
 
 static JitProviderCallbacks provider;
 static bool provider_successfully_loaded = false;
@@ -142,6 +144,26 @@ jit_release_context(JitContext *context)
 	pfree(context);
 }
 
+/*
+ * Should an expression that would be JIT compiled be interpreted first, and
+ * only be compiled once it has been evaluated jit_tier_up_calls times?
+ *
+ * The caller is responsible for arranging for jit_compile_expr() to be
+ * called once that happens.
+ */
+bool
+jit_tier_up_expr(struct ExprState *state)
+{
+	if (jit_tier_up_calls <= 0 || !jit_enabled)
+		return false;
+
+	if (!state->parent)
+		return false;
+
+	return (state->parent->state->es_jit_flags & (PGJIT_PERFORM | PGJIT_EXPR)) ==
+		(PGJIT_PERFORM | PGJIT_EXPR);
+}
+
 /*
  * Ask provider to JIT compile an expression.
  *
@@ -246,6 +246,32 @@ llvm_create_context(int jitFlags)
 	return context;
 }
 
+/*
+ * Create a context for JITing code that is kept for the lifetime of the
+ * backend, e.g. for caching code that can be shared across queries.
+ *
+ * Unlike a context made by llvm_create_context(), this isn't tracked by a
+ * resource owner and doesn't count as being in use, and it's never released.
+ * Callers must therefore emit whatever they add to it right away, via
+ * llvm_get_function(), so that no module is left pending that would prevent
+ * llvm_recreate_llvm_context() from disposing of the LLVMContextRef.
+ */
+LLVMJitContext *
+llvm_create_persistent_context(int jitFlags)
+{
+	LLVMJitContext *context;
+
+	llvm_assert_in_fatal_section();
+
+	llvm_session_initialize();
+
+	context = MemoryContextAllocZero(TopMemoryContext,
+									 sizeof(LLVMJitContext));
+	context->base.flags = jitFlags;
+
+	return context;
+}
+
 /*
  * Release resources required by one llvm context.
  */
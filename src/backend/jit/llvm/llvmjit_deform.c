@@ -25,6 +25,39 @@
 #include "executor/tuptable.h"
 #include "jit/llvmjit.h"
 #include "jit/llvmjit_emit.h"
+#include "utils/memutils.h"
+
+
+/*
+ * Maximum number of deform functions kept by slot_cached_deform().  Each one
+ * stays in memory for the lifetime of the backend.
+ */
+#define DEFORM_CACHE_MAX_ENTRIES	256
+
+/* the properties of a column that deforming code depends on */
+typedef struct DeformCacheAttr
+{
+	int16		attlen;
+	bool		attbyval;
+	bool		atthasmissing;
+	bool		attisdropped;
+	char		attnullability;
+	uint8		attalignby;
+} DeformCacheAttr;
+
+typedef struct DeformCacheEntry
+{
+	const TupleTableSlotOps *ops;
+	int			natts;			/* number of columns deformed */
+	int			desc_natts;		/* number of columns in tuple descriptor */
+	DeformCacheAttr *attrs;		/* desc_natts entries */
+	void	   *fn;				/* emitted deform function */
+} DeformCacheEntry;
+
+static LLVMJitContext *deform_cache_context = NULL;
+static List *deform_cache = NIL;
+
+static LLVMTypeRef deform_signature(LLVMContextRef lc);
 
 
 /*
@@ -130,14 +163,7 @@ slot_compile_deform(LLVMJitContext *context, TupleDesc desc,
 	}
 
 	/* Create the signature and function */
-	{
-		LLVMTypeRef param_types[1];
-
-		param_types[0] = l_ptr(StructTupleTableSlot);
-
-		deform_sig = LLVMFunctionType(LLVMVoidTypeInContext(lc),
-									  param_types, lengthof(param_types), 0);
-	}
+	deform_sig = deform_signature(lc);
 	v_deform_fn = LLVMAddFunction(mod, funcname, deform_sig);
 	LLVMSetLinkage(v_deform_fn, LLVMInternalLinkage);
 	LLVMSetParamAlignment(LLVMGetParam(v_deform_fn, 0), MAXIMUM_ALIGNOF);
@@ -762,3 +788,133 @@ slot_compile_deform(LLVMJitContext *context, TupleDesc desc,
 
 	return v_deform_fn;
 }
+
+/*
+ * Return the type of deform functions.
+ */
+static LLVMTypeRef
+deform_signature(LLVMContextRef lc)
+{
+	LLVMTypeRef param_types[1];
+
+	param_types[0] = l_ptr(StructTupleTableSlot);
+
+	return LLVMFunctionType(LLVMVoidTypeInContext(lc),
+							param_types, lengthof(param_types), 0);
+}
+
+/*
+ * Like slot_compile_deform(), but reuse a deform function that has already
+ * been emitted for the same tuple layout, slot type and number of columns,
+ * in this or an earlier query.  New deform functions are generated, fully
+ * optimized and emitted in a context that lives as long as the backend.
+ *
+ * That saves generating, optimizing and emitting the same deforming code
+ * again and again for queries repeatedly scanning the same relations, at the
+ * price of the deform function not being inlined into the expression.  The
+ * result is a constant pointer to the function, usable in context's module;
+ * its type is returned in *fntype.  Returns NULL if no deform function could
+ * be generated, or the cache is full.
+ */
+LLVMValueRef
+slot_cached_deform(LLVMJitContext *context, TupleDesc desc,
+				   const TupleTableSlotOps *ops, int natts,
+				   LLVMTypeRef *fntype)
+{
+	DeformCacheAttr *attrs;
+	DeformCacheEntry *entry = NULL;
+	LLVMTypeRef deform_sig;
+	ListCell   *lc;
+
+	/* same checks as slot_compile_deform() */
+	if (ops != &TTSOpsHeapTuple && ops != &TTSOpsBufferHeapTuple &&
+		ops != &TTSOpsMinimalTuple)
+		return NULL;
+
+	/* palloc0 so that padding doesn't get in the way of memcmp() */
+	attrs = palloc0_array(DeformCacheAttr, desc->natts);
+	for (int attnum = 0; attnum < desc->natts; attnum++)
+	{
+		CompactAttribute *att = TupleDescCompactAttr(desc, attnum);
+
+		attrs[attnum].attlen = att->attlen;
+		attrs[attnum].attbyval = att->attbyval;
+		attrs[attnum].atthasmissing = att->atthasmissing;
+		attrs[attnum].attisdropped = att->attisdropped;
+		attrs[attnum].attnullability = att->attnullability;
+		attrs[attnum].attalignby = att->attalignby;
+	}
+
+	foreach(lc, deform_cache)
+	{
+		DeformCacheEntry *e = (DeformCacheEntry *) lfirst(lc);
+
+		if (e->ops == ops && e->natts == natts &&
+			e->desc_natts == desc->natts &&
+			memcmp(e->attrs, attrs, desc->natts * sizeof(DeformCacheAttr)) == 0)
+		{
+			entry = e;
+			break;
+		}
+	}
+
+	if (entry == NULL)
+	{
+		MemoryContext oldcontext;
+		LLVMValueRef v_deform_fn;
+		char	   *funcname;
+		void	   *fn;
+
+		if (list_length(deform_cache) >= DEFORM_CACHE_MAX_ENTRIES)
+		{
+			pfree(attrs);
+			return NULL;
+		}
+
+		if (deform_cache_context == NULL)
+			deform_cache_context =
+				llvm_create_persistent_context(PGJIT_OPT3 | PGJIT_DEFORM);
+
+		/*
+		 * Emit the function right away, and make sure we don't leave a
+		 * half-built module behind if that fails.
+		 */
+		PG_TRY();
+		{
+			v_deform_fn = slot_compile_deform(deform_cache_context, desc,
+											  ops, natts);
+			Assert(v_deform_fn != NULL);
+			LLVMSetLinkage(v_deform_fn, LLVMExternalLinkage);
+			funcname = pstrdup(LLVMGetValueName(v_deform_fn));
+			fn = llvm_get_function(deform_cache_context, funcname);
+		}
+		PG_CATCH();
+		{
+			if (deform_cache_context->module)
+			{
+				LLVMDisposeModule(deform_cache_context->module);
+				deform_cache_context->module = NULL;
+			}
+			PG_RE_THROW();
+		}
+		PG_END_TRY();
+
+		oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+		entry = palloc(sizeof(DeformCacheEntry));
+		entry->ops = ops;
+		entry->natts = natts;
+		entry->desc_natts = desc->natts;
+		entry->attrs = palloc(desc->natts * sizeof(DeformCacheAttr));
+		memcpy(entry->attrs, attrs, desc->natts * sizeof(DeformCacheAttr));
+		entry->fn = fn;
+		deform_cache = lappend(deform_cache, entry);
+		MemoryContextSwitchTo(oldcontext);
+	}
+
+	pfree(attrs);
+
+	deform_sig = deform_signature(LLVMGetModuleContext(llvm_mutable_module(context)));
+	*fntype = deform_sig;
+
+	return l_ptr_const(entry->fn, l_ptr(deform_sig));
+}
@@ -350,6 +350,7 @@ llvm_compile_expr(ExprState *state)
 					LLVMBasicBlockRef b_fetch;
 					LLVMValueRef v_nvalid;
 					LLVMValueRef l_jit_deform = NULL;
+					LLVMTypeRef l_jit_deform_type = NULL;
 					const TupleTableSlotOps *tts_ops = NULL;
 
 					b_fetch = l_bb_before_v(opblocks[opno + 1],
@@ -402,10 +403,22 @@ llvm_compile_expr(ExprState *state)
 					if (tts_ops && desc && (context->base.flags & PGJIT_DEFORM))
 					{
 						INSTR_TIME_SET_CURRENT(deform_starttime);
-						l_jit_deform =
-							slot_compile_deform(context, desc,
-												tts_ops,
-												op->d.fetch.last_var);
+						if (jit_deform_cache)
+							l_jit_deform =
+								slot_cached_deform(context, desc,
+												   tts_ops,
+												   op->d.fetch.last_var,
+												   &l_jit_deform_type);
+						else
+						{
+							l_jit_deform =
+								slot_compile_deform(context, desc,
+													tts_ops,
+													op->d.fetch.last_var);
+							if (l_jit_deform)
+								l_jit_deform_type =
+									LLVMGetFunctionType(l_jit_deform);
+						}
 						INSTR_TIME_SET_CURRENT(deform_endtime);
 						INSTR_TIME_ACCUM_DIFF(context->base.instr.deform_counter,
 											  deform_endtime, deform_starttime);
@@ -418,7 +431,7 @@ llvm_compile_expr(ExprState *state)
 						params[0] = v_slot;
 
 						l_call(b,
-							   LLVMGetFunctionType(l_jit_deform),
+							   l_jit_deform_type,
 							   l_jit_deform,
 							   params, lengthof(params), "");
 					}
@@ -2928,6 +2941,31 @@ llvm_compile_expr(ExprState *state)
 					break;
 				}
 
+			case EEOP_AGG_HASHED_DISTINCT:
+				{
+					AggState   *aggstate = castNode(AggState, state->parent);
+					AggStatePerTrans pertrans = op->d.agg_hashed_distinctcheck.pertrans;
+					int			jumpdistinct = op->d.agg_hashed_distinctcheck.jumpdistinct;
+
+					LLVMValueRef v_fn = llvm_pg_func(mod, "ExecEvalAggHashedDistinct");
+					LLVMValueRef v_args[3];
+					LLVMValueRef v_ret;
+
+					v_args[0] = l_ptr_const(aggstate, l_ptr(StructAggState));
+					v_args[1] = l_ptr_const(pertrans, l_ptr(StructAggStatePerTransData));
+					v_args[2] = l_int32_const(lc, op->d.agg_hashed_distinctcheck.setno);
+
+					v_ret = l_call(b, LLVMGetFunctionType(v_fn), v_fn, v_args, 3, "");
+					v_ret = LLVMBuildZExt(b, v_ret, TypeStorageBool, "");
+
+					LLVMBuildCondBr(b,
+									LLVMBuildICmp(b, LLVMIntEQ, v_ret,
+												  l_sbool_const(1), ""),
+									opblocks[opno + 1],
+									opblocks[jumpdistinct]);
+					break;
+				}
+
 			case EEOP_AGG_ORDERED_TRANS_DATUM:
 				build_EvalXFunc(b, mod, "ExecEvalAggOrderedTransDatum",
 								v_state, op, v_econtext);
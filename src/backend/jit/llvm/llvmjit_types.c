@@ -140,6 +140,7 @@ void	   *referenced_functions[] =
 	ExecAggCopyTransValue,
 	ExecEvalPreOrderedDistinctSingle,
 	ExecEvalPreOrderedDistinctMulti,
+	ExecEvalAggHashedDistinct,
 	ExecEvalAggOrderedTransDatum,
 	ExecEvalAggOrderedTransTuple,
 	ExecEvalArrayCoerce,
@@ -53,8 +53,13 @@ struct bloom_filter
 
 static int	my_bloom_power(uint64 target_bitset_bits);
 static int	optimal_k(uint64 bitset_bits, int64 total_elems);
+static bloom_filter *bloom_create_internal(int64 total_elems,
+										   int bloom_work_mem, uint64 seed,
+										   uint64 min_bytes);
 static void k_hashes(bloom_filter *filter, uint32 *hashes, unsigned char *elem,
 					 size_t len);
+static void k_hashes_from_hash(bloom_filter *filter, uint32 *hashes,
+							   uint64 hash);
 static inline uint32 mod_m(uint32 val, uint64 m);
 
 /*
@@ -85,6 +90,31 @@ static inline uint32 mod_m(uint32 val, uint64 m);
  */
 bloom_filter *
 bloom_create(int64 total_elems, int bloom_work_mem, uint64 seed)
+{
+	return bloom_create_internal(total_elems, bloom_work_mem, seed,
+								 1024 * 1024);
+}
+
+/*
+ * Create Bloom filter in caller's memory context, like bloom_create(), but
+ * without the 1MB floor on the bitset size.
+ *
+ * This suits callers that probe the filter once per row of a large input and
+ * build it from a small set, where a bitset that stays cache-resident matters
+ * more than the sizing slack.  The bitset is at least 1KB.
+ */
+bloom_filter *
+bloom_create_compact(int64 total_elems, int bloom_work_mem, uint64 seed)
+{
+	return bloom_create_internal(total_elems, bloom_work_mem, seed, 1024);
+}
+
+/*
+ * Workhorse for bloom_create() and bloom_create_compact().
+ */
+static bloom_filter *
+bloom_create_internal(int64 total_elems, int bloom_work_mem, uint64 seed,
+					  uint64 min_bytes)
 {
 	bloom_filter *filter;
 	int			bloom_power;
@@ -99,7 +129,7 @@ bloom_create(int64 total_elems, int bloom_work_mem, uint64 seed)
 	 * false positive rate still won't exceed 2% in almost all cases.
 	 */
 	bitset_bytes = Min(bloom_work_mem * UINT64CONST(1024), total_elems * 2);
-	bitset_bytes = Max(1024 * 1024, bitset_bytes);
+	bitset_bytes = Max(min_bytes, bitset_bytes);
 
 	/*
 	 * Size in bits should be the highest power of two <= target.  bitset_bits
@@ -171,6 +201,51 @@ bloom_lacks_element(bloom_filter *filter, unsigned char *elem, size_t len)
 	return false;
 }
 
+/*
+ * Add an already-hashed element to Bloom filter
+ *
+ * This is for callers that have a good 32-bit hash value of the element at
+ * hand anyway, such as hash join.  The value is remixed with the filter's
+ * seed, so the filter's own hash functions remain independent of the
+ * caller's.  Elements added this way can only be tested with
+ * bloom_lacks_hash().
+ */
+void
+bloom_add_hash(bloom_filter *filter, uint32 hash)
+{
+	uint32		hashes[MAX_HASH_FUNCS];
+	int			i;
+
+	k_hashes_from_hash(filter, hashes,
+					   murmurhash64(((uint64) hash) ^ filter->seed));
+
+	for (i = 0; i < filter->k_hash_funcs; i++)
+	{
+		filter->bitset[hashes[i] >> 3] |= 1 << (hashes[i] & 7);
+	}
+}
+
+/*
+ * Test if Bloom filter definitely lacks an element added by bloom_add_hash().
+ */
+bool
+bloom_lacks_hash(bloom_filter *filter, uint32 hash)
+{
+	uint32		hashes[MAX_HASH_FUNCS];
+	int			i;
+
+	k_hashes_from_hash(filter, hashes,
+					   murmurhash64(((uint64) hash) ^ filter->seed));
+
+	for (i = 0; i < filter->k_hash_funcs; i++)
+	{
+		if (!(filter->bitset[hashes[i] >> 3] & (1 << (hashes[i] & 7))))
+			return true;
+	}
+
+	return false;
+}
+
 /*
  * What proportion of bits are currently set?
  *
@@ -249,14 +324,24 @@ optimal_k(uint64 bitset_bits, int64 total_elems)
 static void
 k_hashes(bloom_filter *filter, uint32 *hashes, unsigned char *elem, size_t len)
 {
-	uint64		hash;
+	/* Use 64-bit hashing to get two independent 32-bit hashes */
+	k_hashes_from_hash(filter, hashes,
+					   DatumGetUInt64(hash_any_extended(elem, len,
+														filter->seed)));
+}
+
+/*
+ * Generate k hash values from a 64-bit hash of the element, using its two
+ * halves as the independent hash functions.
+ */
+static void
+k_hashes_from_hash(bloom_filter *filter, uint32 *hashes, uint64 hash)
+{
 	uint32		x,
 				y;
 	uint64		m;
 	int			i;
 
-	/* Use 64-bit hashing to get two independent 32-bit hashes */
-	hash = DatumGetUInt64(hash_any_extended(elem, len, filter->seed));
 	x = (uint32) hash;
 	y = (uint32) (hash >> 32);
 	m = filter->m;
@@ -0,0 +1,215 @@
+/*-------------------------------------------------------------------------
+ *
+ * losertree.c
+ *	  A tournament tree ("tree of losers") for k-way merging
+ *
+ * A loser tree finds the smallest of the leading elements of k sorted
+ * inputs.  It is a complete binary tree with one leaf per input, where each
+ * internal node remembers the loser of the match played between the winners
+ * of its two subtrees, and the overall winner is kept separately.  After the
+ * winning input advances to its next element, only the matches on the path
+ * from its leaf to the root need to be replayed, against the losers stored
+ * there.  That takes exactly ceil(log2 k) comparisons, whereas sifting a new
+ * element down a binary heap takes up to 2 * log2 k, and the nodes visited
+ * are always the same ones for a given input.
+ *
+ * See Knuth, The Art of Computer Programming, Volume 3, section 5.4.1.
+ *
+ * Portions Copyright (c) 2012-2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/lib/losertree.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "lib/losertree.h"
+
+/*
+ * The tree is stored as an array with the root at index 1 and the children
+ * of node i at indexes 2*i and 2*i+1.  With n sources, indexes 1 .. n-1 are
+ * the internal nodes, and the leaf for source s is at index n + s.  That is
+ * a proper binary tree for any n, not just powers of two.
+ */
+
+static int	losertree_play(losertree *tree, int node);
+
+/*
+ * losertree_allocate
+ *
+ * Returns a pointer to a newly-allocated loser tree that can merge up to
+ * 'capacity' sources, ordered by the given comparator function, which will
+ * be invoked with the additional argument specified by 'arg'.  The tree
+ * initially has no sources; see losertree_reset().
+ */
+losertree *
+losertree_allocate(int capacity, losertree_comparator compare, void *arg)
+{
+	Size		sz;
+	losertree  *tree;
+
+	sz = offsetof(losertree, lt_nodes) + sizeof(int) * capacity;
+	tree = (losertree *) palloc(sz + sizeof(bool) * capacity);
+	tree->lt_active = (bool *) ((char *) tree + sz);
+	tree->lt_capacity = capacity;
+	tree->lt_compare = compare;
+	tree->lt_arg = arg;
+
+	tree->lt_nsources = 0;
+	tree->lt_nactive = 0;
+
+	return tree;
+}
+
+/*
+ * losertree_reset
+ *
+ * Prepares the tree for a new merge of 'nsources' sources, all of which are
+ * initially considered exhausted.  Add the ones that have an element with
+ * losertree_add_unordered() and then call losertree_build().
+ */
+void
+losertree_reset(losertree *tree, int nsources)
+{
+	if (nsources > tree->lt_capacity)
+		elog(ERROR, "out of loser tree sources");
+
+	tree->lt_nsources = nsources;
+	tree->lt_nactive = 0;
+	memset(tree->lt_active, 0, sizeof(bool) * nsources);
+}
+
+/*
+ * losertree_free
+ *
+ * Releases memory used by the given loser tree.
+ */
+void
+losertree_free(losertree *tree)
+{
+	pfree(tree);
+}
+
+/*
+ * losertree_add_unordered
+ *
+ * Marks the given source as having a current element.  Once all sources have
+ * been added, losertree_build() must be called before using the tree.
+ */
+void
+losertree_add_unordered(losertree *tree, int source)
+{
+	Assert(source >= 0 && source < tree->lt_nsources);
+	Assert(!tree->lt_active[source]);
+
+	tree->lt_active[source] = true;
+	tree->lt_nactive++;
+}
+
+/*
+ * Does source 'a' win a match against source 'b'?  Exhausted sources lose
+ * against everything, as if their element were larger than any other.
+ */
+static inline bool
+losertree_beats(losertree *tree, int a, int b)
+{
+	if (!tree->lt_active[a])
+		return false;
+	if (!tree->lt_active[b])
+		return true;
+	return tree->lt_compare(a, b, tree->lt_arg) < 0;
+}
+
+/*
+ * Play all the matches in the subtree rooted at 'node', storing the losers,
+ * and return the winning source.
+ */
+static int
+losertree_play(losertree *tree, int node)
+{
+	int			winner;
+	int			loser;
+
+	if (node >= tree->lt_nsources)
+		return node - tree->lt_nsources;
+
+	winner = losertree_play(tree, 2 * node);
+	loser = losertree_play(tree, 2 * node + 1);
+	if (losertree_beats(tree, loser, winner))
+	{
+		int			tmp = winner;
+
+		winner = loser;
+		loser = tmp;
+	}
+	tree->lt_nodes[node] = loser;
+
+	return winner;
+}
+
+/*
+ * losertree_build
+ *
+ * Plays the whole tournament in O(n) comparisons.
+ */
+void
+losertree_build(losertree *tree)
+{
+	if (tree->lt_nsources > 0)
+		tree->lt_nodes[0] = losertree_play(tree, 1);
+}
+
+/*
+ * Replay the matches on the path from the winner's leaf to the root, after
+ * its element has changed.
+ */
+static void
+losertree_replay(losertree *tree)
+{
+	int			winner = tree->lt_nodes[0];
+	int			node = (tree->lt_nsources + winner) / 2;
+
+	while (node > 0)
+	{
+		int			loser = tree->lt_nodes[node];
+
+		if (losertree_beats(tree, loser, winner))
+		{
+			tree->lt_nodes[node] = winner;
+			winner = loser;
+		}
+		node /= 2;
+	}
+	tree->lt_nodes[0] = winner;
+}
+
+/*
+ * losertree_replace_first
+ *
+ * To be called after the caller has advanced the winning source to its next
+ * element.  O(log n).
+ */
+void
+losertree_replace_first(losertree *tree)
+{
+	Assert(!losertree_empty(tree));
+
+	losertree_replay(tree);
+}
+
+/*
+ * losertree_remove_first
+ *
+ * To be called when the winning source has no more elements.  O(log n).
+ */
+void
+losertree_remove_first(losertree *tree)
+{
+	Assert(!losertree_empty(tree));
+
+	tree->lt_active[tree->lt_nodes[0]] = false;
+	tree->lt_nactive--;
+	losertree_replay(tree);
+}
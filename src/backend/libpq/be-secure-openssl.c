@@ -322,6 +322,12 @@ be_tls_init(bool isServerStart)
 	if (SSLPreferServerCiphers)
 		SSL_CTX_set_options(context, SSL_OP_CIPHER_SERVER_PREFERENCE);
 
+#ifdef USE_KTLS
+	/* Let the kernel encrypt records where it can; see ssl_set_port_bio() */
+	if (SSLKernelTLS)
+		SSL_CTX_set_options(context, SSL_OP_ENABLE_KTLS);
+#endif
+
 	/*
 	 * Load CA store, so we can verify client certificates if needed.
 	 */
@@ -640,6 +646,14 @@ aloop:
 		}
 	}
 
+#ifdef USE_KTLS
+	if (SSL_get_options(port->ssl) & SSL_OP_ENABLE_KTLS)
+		ereport(DEBUG1,
+				(errmsg_internal("kernel TLS offload: send=%s, receive=%s",
+								 BIO_get_ktls_send(SSL_get_wbio(port->ssl)) ? "yes" : "no",
+								 BIO_get_ktls_recv(SSL_get_rbio(port->ssl)) ? "yes" : "no")));
+#endif
+
 	/* Get client certificate, if available. */
 	port->peer = SSL_get_peer_certificate(port->ssl);
 
@@ -1025,6 +1039,19 @@ ssl_set_port_bio(Port *port)
 	BIO		   *bio;
 	BIO_METHOD *bio_method;
 
+#ifdef USE_KTLS
+
+	/*
+	 * Kernel TLS needs OpenSSL's own socket BIO, which is what passes the
+	 * session keys to the kernel.  It reads and writes the socket just like
+	 * ours, except that it can't see data we've already read into raw_buf
+	 * (see libpq-be.h), so it's only usable if there is none.
+	 */
+	if ((SSL_get_options(port->ssl) & SSL_OP_ENABLE_KTLS) &&
+		port->raw_buf_remaining == 0)
+		return SSL_set_fd(port->ssl, port->sock);
+#endif
+
 	bio_method = port_bio_method();
 	if (bio_method == NULL)
 		return 0;
@@ -33,6 +33,8 @@
 #include "utils/injection_point.h"
 #include "utils/wait_event.h"
 
+static ssize_t secure_raw_writev(Port *port, const struct iovec *iov, int iovcnt);
+
 char	   *ssl_library;
 char	   *ssl_cert_file;
 char	   *ssl_key_file;
@@ -57,6 +59,9 @@ char	   *SSLECDHCurve;
 /* GUC variable: if false, prefer client ciphers */
 bool		SSLPreferServerCiphers;
 
+/* GUC variable: try to offload record encryption to the kernel? */
+bool		SSLKernelTLS;
+
 int			ssl_min_protocol_version = PG_TLS1_2_VERSION;
 int			ssl_max_protocol_version = PG_TLS_ANY;
 
@@ -303,10 +308,31 @@ secure_raw_read(Port *port, void *ptr, size_t len)
  */
 ssize_t
 secure_write(Port *port, const void *ptr, size_t len)
+{
+	struct iovec iov;
+
+	iov.iov_base = unconstify(void *, ptr);
+	iov.iov_len = len;
+
+	return secure_writev(port, &iov, 1);
+}
+
+/*
+ *	Write data gathered from several buffers to a secure connection.
+ *
+ * Returns the number of bytes written, counting through the buffers in
+ * order.  Encrypted connections only ever write from the first buffer, so
+ * callers must be prepared for short writes; none of the buffers may be
+ * empty.
+ */
+ssize_t
+secure_writev(Port *port, const struct iovec *iov, int iovcnt)
 {
 	ssize_t		n;
 	int			waitfor;
 
+	Assert(iovcnt > 0);
+
 	/* Deal with any already-pending interrupt condition. */
 	ProcessClientWriteInterrupt(false);
 
@@ -315,20 +341,20 @@ retry:
 #ifdef USE_SSL
 	if (port->ssl_in_use)
 	{
-		n = be_tls_write(port, ptr, len, &waitfor);
+		n = be_tls_write(port, iov[0].iov_base, iov[0].iov_len, &waitfor);
 	}
 	else
 #endif
 #ifdef ENABLE_GSS
 	if (port->gss && port->gss->enc)
 	{
-		n = be_gssapi_write(port, ptr, len);
+		n = be_gssapi_write(port, iov[0].iov_base, iov[0].iov_len);
 		waitfor = WL_SOCKET_WRITEABLE;
 	}
 	else
 #endif
 	{
-		n = secure_raw_write(port, ptr, len);
+		n = secure_raw_writev(port, iov, iovcnt);
 		waitfor = WL_SOCKET_WRITEABLE;
 	}
 
@@ -388,3 +414,23 @@ secure_raw_write(Port *port, const void *ptr, size_t len)
 
 	return n;
 }
+
+static ssize_t
+secure_raw_writev(Port *port, const struct iovec *iov, int iovcnt)
+{
+#ifndef WIN32
+	struct msghdr msg;
+
+	if (iovcnt > 1)
+	{
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = unconstify(struct iovec *, iov);
+		msg.msg_iovlen = Min(iovcnt, IOV_MAX);
+
+		return sendmsg(port->sock, &msg, 0);
+	}
+#endif
+
+	/* On Windows, our send() wrapper only takes a single buffer */
+	return secure_raw_write(port, iov[0].iov_base, iov[0].iov_len);
+}
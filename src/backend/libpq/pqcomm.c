@@ -72,6 +72,7 @@
 #include <mstcpip.h>
 #endif
 
+#include "common/compress_stream.h"
 #include "common/ip.h"
 #include "libpq/libpq.h"
 #include "miscadmin.h"
@@ -112,11 +113,15 @@ static List *sock_paths = NIL;
 /*
  * Buffers for low-level I/O.
  *
- * The receive buffer is fixed size. Send buffer is usually 8k, but can be
- * enlarged by pq_putmessage_noblock() if the message doesn't fit otherwise.
+ * The receive buffer is fixed size. Send buffer starts out at 8k.  It is
+ * doubled, up to PQ_SEND_BUFFER_MAX_SIZE, each time it fills up while we are
+ * streaming output, so that backends sending large result sets make fewer
+ * and larger send() calls.  It can also be enlarged by
+ * pq_putmessage_noblock() if the message doesn't fit otherwise.
  */
 
 #define PQ_SEND_BUFFER_SIZE 8192
+#define PQ_SEND_BUFFER_MAX_SIZE (256 * 1024)
 #define PQ_RECV_BUFFER_SIZE 8192
 
 static char *PqSendBuffer;
@@ -128,6 +133,21 @@ static char PqRecvBuffer[PQ_RECV_BUFFER_SIZE];
 static int	PqRecvPointer;		/* Next index to read a byte from PqRecvBuffer */
 static int	PqRecvLength;		/* End of data available in PqRecvBuffer */
 
+/*
+ * Protocol compression, see pq_start_compression().  Compressed output that
+ * couldn't be sent yet is kept by the compressor, and pointed to here.
+ * Compressed input is read into PqCompressedRecvBuffer before being
+ * decompressed into PqRecvBuffer.
+ */
+static bool PqCompressionStarted = false;
+static pg_compress_stream *PqCompressOut = NULL;
+static const char *PqCompressOutPtr;	/* Compressed data not yet sent */
+static size_t PqCompressOutLen;
+static pg_compress_stream *PqDecompressIn = NULL;
+static char PqCompressedRecvBuffer[PQ_RECV_BUFFER_SIZE];
+static size_t PqCompressedRecvPointer;
+static size_t PqCompressedRecvLength;
+
 /*
  * Message status
  */
@@ -144,8 +164,11 @@ static int	socket_flush_if_writable(void);
 static bool socket_is_send_pending(void);
 static int	socket_putmessage(char msgtype, const char *s, size_t len);
 static void socket_putmessage_noblock(char msgtype, const char *s, size_t len);
+static ssize_t internal_read(void *ptr, size_t len);
+static ssize_t internal_write(const void *ptr, size_t len);
 static inline int internal_putbytes(const void *b, size_t len);
 static inline int internal_flush(void);
+static int	internal_flush_with(const char *s, size_t len);
 static pg_noinline int internal_flush_buffer(const char *buf, size_t *start,
 											 size_t *end);
 
@@ -182,6 +205,7 @@ pq_init(ClientSocket *client_sock)
 	port->sock = client_sock->sock;
 	memcpy(&port->raddr.addr, &client_sock->raddr.addr, client_sock->raddr.salen);
 	port->raddr.salen = client_sock->raddr.salen;
+	port->pooled = client_sock->pooled;
 
 	/* fill in the server (local) address */
 	port->laddr.salen = sizeof(port->laddr.addr);
@@ -322,6 +346,103 @@ pq_init(ClientSocket *client_sock)
 	return port;
 }
 
+/* --------------------------------
+ *		pq_switch_socket - continue the session on another socket
+ *
+ * Used by backends serving connections that go through a connection proxy:
+ * once authentication is done, the client socket is handed over to the
+ * proxy, and the backend talks to the proxy through "sock" instead.  Any
+ * input already received from the client but not yet consumed is appended
+ * to "unread", so that the caller can pass it on.  The output buffer must
+ * have been flushed.  Returns the old socket, which the caller is
+ * responsible for closing.
+ * --------------------------------
+ */
+pgsocket
+pq_switch_socket(pgsocket sock, StringInfo unread)
+{
+	pgsocket	oldsock = MyProcPort->sock;
+	int			socket_pos PG_USED_FOR_ASSERTS_ONLY;
+	int			latch_pos PG_USED_FOR_ASSERTS_ONLY;
+
+	Assert(PqSendStart == PqSendPointer);
+	Assert(!PqCommReadingMsg);
+
+	if (PqRecvLength > PqRecvPointer)
+		appendBinaryStringInfo(unread, PqRecvBuffer + PqRecvPointer,
+							   PqRecvLength - PqRecvPointer);
+	PqRecvPointer = PqRecvLength = 0;
+
+#ifndef WIN32
+	if (!pg_set_noblock(sock))
+		ereport(FATAL,
+				(errmsg("could not set socket to nonblocking mode: %m")));
+	if (fcntl(sock, F_SETFD, FD_CLOEXEC) < 0)
+		elog(FATAL, "fcntl(F_SETFD) failed on socket: %m");
+#endif
+
+	MyProcPort->sock = sock;
+
+	/* Rebuild the wait event set for the new socket, same as pq_init */
+	FreeWaitEventSet(FeBeWaitSet);
+	FeBeWaitSet = CreateWaitEventSet(NULL, FeBeWaitSetNEvents);
+	socket_pos = AddWaitEventToSet(FeBeWaitSet, WL_SOCKET_WRITEABLE,
+								   sock, NULL, NULL);
+	latch_pos = AddWaitEventToSet(FeBeWaitSet, WL_LATCH_SET, PGINVALID_SOCKET,
+								  MyLatch, NULL);
+	AddWaitEventToSet(FeBeWaitSet, WL_POSTMASTER_DEATH, PGINVALID_SOCKET,
+					  NULL, NULL);
+	Assert(socket_pos == FeBeWaitSetSocketPos);
+	Assert(latch_pos == FeBeWaitSetLatchPos);
+
+	return oldsock;
+}
+
+/* --------------------------------
+ *		pq_start_compression - start protocol compression, if requested
+ *
+ * The client can ask for compression of the data sent in either direction
+ * with the _pq_.compression startup parameter.  If we accepted that, it
+ * covers everything after the first ReadyForQuery message, which must have
+ * been flushed already; the client starts decompressing and compressing when
+ * it receives that message.  Later calls do nothing.
+ * --------------------------------
+ */
+void
+pq_start_compression(void)
+{
+	Port	   *port = MyProcPort;
+	MemoryContext oldcontext;
+
+	if (PqCompressionStarted || port == NULL)
+		return;
+	PqCompressionStarted = true;
+
+	Assert(PqSendStart == PqSendPointer);
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	if (port->compress_send.algorithm != PG_COMPRESSION_NONE)
+	{
+		PqCompressOut = pg_compress_stream_create(port->compress_send.algorithm,
+												  port->compress_send.level,
+												  false);
+		if (PqCompressOut == NULL)
+			ereport(FATAL,
+					(errmsg("could not initialize %s compression",
+							get_compress_algorithm_name(port->compress_send.algorithm))));
+	}
+	if (port->compress_recv.algorithm != PG_COMPRESSION_NONE)
+	{
+		PqDecompressIn = pg_compress_stream_create(port->compress_recv.algorithm,
+												   0, true);
+		if (PqDecompressIn == NULL)
+			ereport(FATAL,
+					(errmsg("could not initialize %s decompression",
+							get_compress_algorithm_name(port->compress_recv.algorithm))));
+	}
+	MemoryContextSwitchTo(oldcontext);
+}
+
 /* --------------------------------
  *		socket_comm_reset - reset libpq during error recovery
  *
@@ -920,8 +1041,8 @@ pq_recvbuf(void)
 
 		errno = 0;
 
-		r = secure_read(MyProcPort, PqRecvBuffer + PqRecvLength,
-						PQ_RECV_BUFFER_SIZE - PqRecvLength);
+		r = internal_read(PqRecvBuffer + PqRecvLength,
+						  PQ_RECV_BUFFER_SIZE - PqRecvLength);
 
 		if (r < 0)
 		{
@@ -1017,7 +1138,20 @@ pq_getbyte_if_available(unsigned char *c)
 
 	errno = 0;
 
-	r = secure_read(MyProcPort, c, 1);
+	if (PqDecompressIn != NULL)
+	{
+		/* Decompress as much as fits, rather than a byte at a time */
+		PqRecvPointer = PqRecvLength = 0;
+		r = internal_read(PqRecvBuffer, PQ_RECV_BUFFER_SIZE);
+		if (r > 0)
+		{
+			PqRecvLength = r;
+			*c = PqRecvBuffer[PqRecvPointer++];
+			r = 1;
+		}
+	}
+	else
+		r = secure_read(MyProcPort, c, 1);
 	if (r < 0)
 	{
 		/*
@@ -1272,6 +1406,122 @@ pq_getmessage(StringInfo s, int maxlen)
 	return 0;
 }
 
+/* --------------------------------
+ *		internal_read - read data, decompressing it if enabled
+ *
+ * Behaves like secure_read(), except that a decompression failure is
+ * reported here, and returns -1 with errno set to zero, which callers treat
+ * as EOF.
+ * --------------------------------
+ */
+static ssize_t
+internal_read(void *ptr, size_t len)
+{
+	if (PqDecompressIn == NULL)
+		return secure_read(MyProcPort, ptr, len);
+
+	for (;;)
+	{
+		size_t		srclen = PqCompressedRecvLength - PqCompressedRecvPointer;
+		size_t		dstlen = len;
+		ssize_t		r;
+
+		/*
+		 * Try even with no input at hand, as the decompressor might be
+		 * holding back output that didn't fit before.
+		 */
+		if (pg_compress_stream_decompress(PqDecompressIn,
+										  PqCompressedRecvBuffer + PqCompressedRecvPointer,
+										  &srclen, ptr, &dstlen) < 0)
+		{
+			ereport(COMMERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg("could not decompress data from client: %s",
+							pg_compress_stream_error(PqDecompressIn))));
+			errno = 0;
+			return -1;
+		}
+		PqCompressedRecvPointer += srclen;
+		if (dstlen > 0)
+			return dstlen;
+
+		/* Need more input; left-justify what's left of it first */
+		if (PqCompressedRecvPointer > 0)
+		{
+			memmove(PqCompressedRecvBuffer,
+					PqCompressedRecvBuffer + PqCompressedRecvPointer,
+					PqCompressedRecvLength - PqCompressedRecvPointer);
+			PqCompressedRecvLength -= PqCompressedRecvPointer;
+			PqCompressedRecvPointer = 0;
+		}
+
+		r = secure_read(MyProcPort,
+						PqCompressedRecvBuffer + PqCompressedRecvLength,
+						PQ_RECV_BUFFER_SIZE - PqCompressedRecvLength);
+		if (r <= 0)
+			return r;
+		PqCompressedRecvLength += r;
+	}
+}
+
+/* --------------------------------
+ *		internal_write - send data, compressing it first if enabled
+ *
+ * Behaves like secure_write(), except that with compression, data can be
+ * consumed before all of its compressed form has been sent, if the socket is
+ * in non-blocking mode.  The rest goes out first thing in the next call, and
+ * the caller must keep calling, with len == 0 if need be, as long as
+ * PqCompressOutLen > 0.
+ * --------------------------------
+ */
+static ssize_t
+internal_write(const void *ptr, size_t len)
+{
+	ssize_t		r;
+
+	if (PqCompressOut == NULL)
+		return secure_write(MyProcPort, ptr, len);
+
+	while (PqCompressOutLen > 0)
+	{
+		r = secure_write(MyProcPort, PqCompressOutPtr, PqCompressOutLen);
+		if (r <= 0)
+			return r;
+		PqCompressOutPtr += r;
+		PqCompressOutLen -= r;
+	}
+	if (len == 0)
+		return 0;
+
+	if (pg_compress_stream_compress(PqCompressOut, ptr, &len,
+									&PqCompressOutPtr, &PqCompressOutLen) < 0)
+	{
+		ereport(COMMERROR,
+				(errmsg("could not compress data to send to client: %s",
+						pg_compress_stream_error(PqCompressOut))));
+		errno = EIO;
+		return -1;
+	}
+
+	/*
+	 * The input is consumed now, so report it as sent unless sending fails
+	 * for good.  Anything that can't be sent right away waits for the next
+	 * call.
+	 */
+	while (PqCompressOutLen > 0)
+	{
+		r = secure_write(MyProcPort, PqCompressOutPtr, PqCompressOutLen);
+		if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK ||
+					  errno == EINTR))
+			break;
+		if (r <= 0)
+			return r;
+		PqCompressOutPtr += r;
+		PqCompressOutLen -= r;
+	}
+
+	return len;
+}
 
 static inline int
 internal_putbytes(const void *b, size_t len)
@@ -1286,12 +1536,24 @@ internal_putbytes(const void *b, size_t len)
 			socket_set_nonblocking(false);
 			if (internal_flush())
 				return EOF;
+
+			/*
+			 * The buffer is empty now.  Since we're evidently producing a lot
+			 * of output, make it bigger for the rest of the session.
+			 */
+			if (PqSendBufferSize < PQ_SEND_BUFFER_MAX_SIZE)
+			{
+				PqSendBufferSize *= 2;
+				PqSendBuffer = repalloc(PqSendBuffer, PqSendBufferSize);
+			}
 		}
 
 		/*
 		 * If the buffer is empty and data length is larger than the buffer
-		 * size, send it without buffering.  Otherwise, copy as much data as
-		 * possible into the buffer.
+		 * size, send it without buffering.  If the data is large and doesn't
+		 * fit in the remaining space, send the buffer contents and the data
+		 * together, saving a copy and a system call.  Otherwise, copy as
+		 * much data as possible into the buffer.
 		 */
 		if (len >= PqSendBufferSize && PqSendStart == PqSendPointer)
 		{
@@ -1301,6 +1563,15 @@ internal_putbytes(const void *b, size_t len)
 			if (internal_flush_buffer(s, &start, &len))
 				return EOF;
 		}
+		else if (len >= PqSendBufferSize / 2 &&
+				 len > PqSendBufferSize - PqSendPointer &&
+				 PqCompressOut == NULL)
+		{
+			socket_set_nonblocking(false);
+			if (internal_flush_with(s, len))
+				return EOF;
+			len = 0;
+		}
 		else
 		{
 			size_t		amount = PqSendBufferSize - PqSendPointer;
@@ -1351,6 +1622,58 @@ internal_flush(void)
 	return internal_flush_buffer(PqSendBuffer, &PqSendStart, &PqSendPointer);
 }
 
+/* --------------------------------
+ *		internal_flush_with - flush pending output followed by the given data
+ *
+ * The buffered data and the caller's data are handed to the kernel in a
+ * single vectored write where possible.  The socket must be in blocking
+ * mode, and compression must not be active.
+ *
+ * Returns 0 if OK, or EOF if trouble.
+ * --------------------------------
+ */
+static int
+internal_flush_with(const char *s, size_t len)
+{
+	size_t		start = 0;
+
+	Assert(PqCompressOut == NULL);
+
+	while (PqSendStart < PqSendPointer)
+	{
+		struct iovec iov[2];
+		ssize_t		r;
+
+		iov[0].iov_base = PqSendBuffer + PqSendStart;
+		iov[0].iov_len = PqSendPointer - PqSendStart;
+		iov[1].iov_base = unconstify(char *, s);
+		iov[1].iov_len = len;
+
+		r = secure_writev(MyProcPort, iov, 2);
+		if (r <= 0)
+		{
+			if (r < 0 && errno == EINTR)
+				continue;
+
+			/* let internal_flush() report the error */
+			break;
+		}
+
+		if (r < iov[0].iov_len)
+			PqSendStart += r;
+		else
+		{
+			start = r - iov[0].iov_len;
+			PqSendStart = PqSendPointer = 0;
+		}
+	}
+
+	/* Send whatever is left, one buffer at a time */
+	if (internal_flush())
+		return EOF;
+	return internal_flush_buffer(s, &start, &len);
+}
+
 /* --------------------------------
  *		internal_flush_buffer - flush the given buffer content
  *
@@ -1366,13 +1689,14 @@ internal_flush_buffer(const char *buf, size_t *start, size_t *end)
 	const char *bufptr = buf + *start;
 	const char *bufend = buf + *end;
 
-	while (bufptr < bufend)
+	while (bufptr < bufend || PqCompressOutLen > 0)
 	{
 		int			r;
 
-		r = secure_write(MyProcPort, bufptr, bufend - bufptr);
+		r = internal_write(bufptr, bufend - bufptr);
 
-		if (r <= 0)
+		/* Only sending leftover compressed data can legitimately return 0 */
+		if (r < 0 || (r == 0 && bufptr < bufend))
 		{
 			if (errno == EINTR)
 				continue;		/* Ok if we were interrupted */
@@ -1411,6 +1735,7 @@ internal_flush_buffer(const char *buf, size_t *start, size_t *end)
 			 * the connection.
 			 */
 			*start = *end = 0;
+			PqCompressOutLen = 0;
 			ClientConnectionLost = 1;
 			InterruptPending = 1;
 			return EOF;
@@ -1437,7 +1762,7 @@ socket_flush_if_writable(void)
 	int			res;
 
 	/* Quick exit if nothing to do */
-	if (PqSendPointer == PqSendStart)
+	if (PqSendPointer == PqSendStart && PqCompressOutLen == 0)
 		return 0;
 
 	/* No-op if reentrant call */
@@ -1460,7 +1785,7 @@ socket_flush_if_writable(void)
 static bool
 socket_is_send_pending(void)
 {
-	return (PqSendStart < PqSendPointer);
+	return (PqSendStart < PqSendPointer || PqCompressOutLen > 0);
 }
 
 /* --------------------------------
@@ -1541,6 +1866,55 @@ socket_putmessage_noblock(char msgtype, const char *s, size_t len)
 								 * buffer */
 }
 
+/* --------------------------------
+ *		pq_reservemessage_noblock	- make room for a message in the buffer
+ *
+ *		Returns a pointer to space for 'len' bytes of message body in the
+ *		output buffer, enlarging the buffer if needed, so that the caller can
+ *		build the message in place instead of copying it there.  The message
+ *		is sent by a following pq_putreservedmessage() call; nothing else may
+ *		be sent in between.  If the caller errors out before that, the
+ *		reserved space is simply not used.
+ * --------------------------------
+ */
+char *
+pq_reservemessage_noblock(size_t len)
+{
+	size_t		required;
+
+	Assert(PqCommMethods == &PqCommSocketMethods);
+	Assert(!PqCommBusy);
+
+	required = PqSendPointer + 1 + 4 + len;
+	if (required > PqSendBufferSize)
+	{
+		PqSendBuffer = repalloc(PqSendBuffer, required);
+		PqSendBufferSize = required;
+	}
+
+	return PqSendBuffer + PqSendPointer + 1 + 4;
+}
+
+/* --------------------------------
+ *		pq_putreservedmessage	- send a message built in reserved space
+ *
+ *		'len' must be the length passed to pq_reservemessage_noblock().
+ * --------------------------------
+ */
+void
+pq_putreservedmessage(char msgtype, size_t len)
+{
+	uint32		n32;
+
+	Assert(msgtype != 0);
+	Assert(PqSendPointer + 1 + 4 + len <= PqSendBufferSize);
+
+	PqSendBuffer[PqSendPointer] = msgtype;
+	n32 = pg_hton32((uint32) (len + 4));
+	memcpy(PqSendBuffer + PqSendPointer + 1, &n32, 4);
+	PqSendPointer += 1 + 4 + len;
+}
+
 /* --------------------------------
  *		pq_putmessage_v2 - send a message in protocol version 2
  *
@@ -33,6 +33,7 @@
 #include "bootstrap/bootstrap.h"
 #include "common/username.h"
 #include "miscadmin.h"
+#include "portability/instr_time.h"
 #include "postmaster/postmaster.h"
 #include "tcop/tcopprot.h"
 #include "utils/help_config.h"
@@ -205,6 +206,13 @@ main(int argc, char *argv[])
 	if (argc > 1 && argv[1][0] == '-' && argv[1][1] == '-')
 		dispatch_option = parse_dispatch_option(&argv[1][2]);
 
+	/*
+	 * Choose the clock source for instrumentation.  Children of the
+	 * postmaster inherit its choice, or receive it in EXEC_BACKEND builds.
+	 */
+	if (dispatch_option != DISPATCH_FORKCHILD)
+		pg_initialize_timing();
+
 	switch (dispatch_option)
 	{
 		case DISPATCH_CHECK:
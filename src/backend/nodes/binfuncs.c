@@ -0,0 +1,868 @@
+/*-------------------------------------------------------------------------
+ *
+ * binfuncs.c
+ *	  Binary serialization of Postgres tree nodes.
+ *
+ * nodeToString() and stringToNode() use a text format that is meant to be
+ * readable and that is stored in the catalogs.  To pass a node tree to
+ * another backend of the same server, as when sending a plan to parallel
+ * workers, that format is needlessly expensive: every field is printed and
+ * parsed again, and the reader identifies each node by comparing its name
+ * against the names of all node types.  This file provides a compact binary
+ * format for that purpose, in which fields are copied as they are and nodes
+ * are identified by their NodeTag.  The format depends on the exact server
+ * build, so it must never be stored.
+ *
+ * The per-node code is what gen_node_support.pl generates for outfuncs.c and
+ * readfuncs.c, compiled with binary definitions of the WRITE_ and READ_
+ * macros, and dispatched on the NodeTag by a switch generated for this file.
+ * Location fields are not transmitted; they are read back as -1, as in
+ * stringToNode().  Nodes with hand-written text support that don't occur in
+ * plans, as well as CustomScan, whose generated support code is tied to the
+ * text format, are embedded in their text form.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/nodes/binfuncs.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "lib/stringinfo.h"
+#include "miscadmin.h"
+#include "nodes/bitmapset.h"
+#include "nodes/pg_list.h"
+#include "nodes/readfuncs.h"
+#include "nodes/value.h"
+#include "utils/datum.h"
+
+
+/*
+ * Macros to write the different kinds of fields.  They mirror those of
+ * outfuncs.c, so that the generated code can be compiled with them.
+ */
+
+/* The node type is written by binOutNode() */
+#define WRITE_NODE_TYPE(nodelabel) \
+	((void) 0)
+
+#define WRITE_FIELD(fldname) \
+	binWrite(str, &node->fldname, sizeof(node->fldname))
+
+#define WRITE_INT_FIELD(fldname)		WRITE_FIELD(fldname)
+#define WRITE_UINT_FIELD(fldname)		WRITE_FIELD(fldname)
+#define WRITE_INT64_FIELD(fldname)		WRITE_FIELD(fldname)
+#define WRITE_UINT64_FIELD(fldname)		WRITE_FIELD(fldname)
+#define WRITE_OID_FIELD(fldname)		WRITE_FIELD(fldname)
+#define WRITE_LONG_FIELD(fldname)		WRITE_FIELD(fldname)
+#define WRITE_CHAR_FIELD(fldname)		WRITE_FIELD(fldname)
+#define WRITE_ENUM_FIELD(fldname, enumtype) WRITE_FIELD(fldname)
+#define WRITE_FLOAT_FIELD(fldname)		WRITE_FIELD(fldname)
+#define WRITE_BOOL_FIELD(fldname)		WRITE_FIELD(fldname)
+
+#define WRITE_STRING_FIELD(fldname) \
+	binWriteString(str, node->fldname)
+
+/* Parse locations are not transmitted */
+#define WRITE_LOCATION_FIELD(fldname) \
+	((void) 0)
+
+#define WRITE_NODE_FIELD(fldname) \
+	binOutNode(str, node->fldname)
+
+#define WRITE_BITMAPSET_FIELD(fldname) \
+	binWriteBitmapset(str, node->fldname)
+
+#define WRITE_NODE_ARRAY(fldname, len) \
+	binWriteNodeArray(str, (const Node *const *) node->fldname, len)
+
+#define WRITE_ATTRNUMBER_ARRAY(fldname, len) \
+	binWriteArray(str, node->fldname, sizeof(AttrNumber), len)
+
+#define WRITE_OID_ARRAY(fldname, len) \
+	binWriteArray(str, node->fldname, sizeof(Oid), len)
+
+#define WRITE_INDEX_ARRAY(fldname, len) \
+	binWriteArray(str, node->fldname, sizeof(Index), len)
+
+#define WRITE_INT_ARRAY(fldname, len) \
+	binWriteArray(str, node->fldname, sizeof(int), len)
+
+#define WRITE_BOOL_ARRAY(fldname, len) \
+	binWriteArray(str, node->fldname, sizeof(bool), len)
+
+/*
+ * Macros to read the different kinds of fields, mirroring readfuncs.c.
+ * "token" and "length" are only used by the generated code for CustomScan,
+ * which is never called here.
+ */
+
+#define READ_LOCALS_NO_FIELDS(nodeTypeName) \
+	nodeTypeName *local_node = makeNode(nodeTypeName)
+
+#define READ_TEMP_LOCALS() \
+	const char *token pg_attribute_unused(); \
+	int			length pg_attribute_unused()
+
+#define READ_LOCALS(nodeTypeName) \
+	READ_LOCALS_NO_FIELDS(nodeTypeName); \
+	READ_TEMP_LOCALS()
+
+#define READ_FIELD(fldname) \
+	binRead(&local_node->fldname, sizeof(local_node->fldname))
+
+#define READ_INT_FIELD(fldname)			READ_FIELD(fldname)
+#define READ_UINT_FIELD(fldname)		READ_FIELD(fldname)
+#define READ_INT64_FIELD(fldname)		READ_FIELD(fldname)
+#define READ_UINT64_FIELD(fldname)		READ_FIELD(fldname)
+#define READ_OID_FIELD(fldname)			READ_FIELD(fldname)
+#define READ_LONG_FIELD(fldname)		READ_FIELD(fldname)
+#define READ_CHAR_FIELD(fldname)		READ_FIELD(fldname)
+#define READ_ENUM_FIELD(fldname, enumtype) READ_FIELD(fldname)
+#define READ_FLOAT_FIELD(fldname)		READ_FIELD(fldname)
+#define READ_BOOL_FIELD(fldname)		READ_FIELD(fldname)
+
+#define READ_STRING_FIELD(fldname) \
+	(local_node->fldname = binReadString())
+
+#define READ_LOCATION_FIELD(fldname) \
+	(local_node->fldname = -1)
+
+#define READ_NODE_FIELD(fldname) \
+	(local_node->fldname = binReadNode())
+
+#define READ_BITMAPSET_FIELD(fldname) \
+	(local_node->fldname = binReadBitmapset())
+
+#define READ_ATTRNUMBER_ARRAY(fldname, len) \
+	(local_node->fldname = binReadArray(sizeof(AttrNumber), len))
+
+#define READ_OID_ARRAY(fldname, len) \
+	(local_node->fldname = binReadArray(sizeof(Oid), len))
+
+#define READ_INT_ARRAY(fldname, len) \
+	(local_node->fldname = binReadArray(sizeof(int), len))
+
+#define READ_BOOL_ARRAY(fldname, len) \
+	(local_node->fldname = binReadArray(sizeof(bool), len))
+
+#define READ_DONE() \
+	return local_node
+
+/* Position in, and end of, the data being read by binaryToNode() */
+static const char *bin_read_ptr = NULL;
+static const char *bin_read_end = NULL;
+
+static void binOutNode(StringInfo str, const void *obj);
+static void *binReadNode(void);
+
+
+/*
+ * Support functions for writing
+ */
+
+static inline void
+binWrite(StringInfo str, const void *data, Size len)
+{
+	appendBinaryStringInfo(str, data, len);
+}
+
+static void
+binWriteString(StringInfo str, const char *s)
+{
+	int32		len = s ? strlen(s) : -1;
+
+	binWrite(str, &len, sizeof(len));
+	if (len > 0)
+		binWrite(str, s, len);
+}
+
+static void
+binWriteBitmapset(StringInfo str, const Bitmapset *bms)
+{
+	int32		nwords = bms ? bms->nwords : 0;
+
+	binWrite(str, &nwords, sizeof(nwords));
+	if (nwords > 0)
+		binWrite(str, bms->words, nwords * sizeof(bitmapword));
+}
+
+static void
+binWriteArray(StringInfo str, const void *arr, Size elemsize, int len)
+{
+	bool		isnull = (arr == NULL);
+
+	binWrite(str, &isnull, sizeof(isnull));
+	if (!isnull && len > 0)
+		binWrite(str, arr, elemsize * len);
+}
+
+static void
+binWriteNodeArray(StringInfo str, const Node *const *arr, int len)
+{
+	bool		isnull = (arr == NULL);
+
+	binWrite(str, &isnull, sizeof(isnull));
+	if (!isnull)
+	{
+		for (int i = 0; i < len; i++)
+			binOutNode(str, arr[i]);
+	}
+}
+
+static void
+binWriteDatum(StringInfo str, Datum value, int typlen, bool typbyval)
+{
+	Size		len;
+
+	if (typbyval)
+	{
+		binWrite(str, &value, sizeof(Datum));
+		return;
+	}
+
+	len = DatumGetPointer(value) ? datumGetSize(value, typbyval, typlen) : 0;
+	binWrite(str, &len, sizeof(len));
+	if (len > 0)
+		binWrite(str, DatumGetPointer(value), len);
+}
+
+/* Embed a node in its text form */
+static void
+binOutAsText(StringInfo str, const void *obj)
+{
+	char	   *s = nodeToString(obj);
+
+	binWriteString(str, s);
+	pfree(s);
+}
+
+static void
+binOutList(StringInfo str, const List *node)
+{
+	int32		len = list_length(node);
+	const ListCell *lc;
+
+	binWrite(str, &len, sizeof(len));
+
+	foreach(lc, node)
+	{
+		if (IsA(node, List))
+			binOutNode(str, lfirst(lc));
+		else if (IsA(node, IntList))
+			binWrite(str, &lfirst_int(lc), sizeof(int));
+		else if (IsA(node, OidList))
+			binWrite(str, &lfirst_oid(lc), sizeof(Oid));
+		else if (IsA(node, XidList))
+			binWrite(str, &lfirst_xid(lc), sizeof(TransactionId));
+		else
+			elog(ERROR, "unrecognized list node type: %d",
+				 (int) node->type);
+	}
+}
+
+
+/*
+ * Support functions for reading
+ */
+
+static inline void
+binRead(void *dest, Size len)
+{
+	if (len > (Size) (bin_read_end - bin_read_ptr))
+		elog(ERROR, "unexpected end of binary node data");
+	memcpy(dest, bin_read_ptr, len);
+	bin_read_ptr += len;
+}
+
+static char *
+binReadString(void)
+{
+	int32		len;
+	char	   *s;
+
+	binRead(&len, sizeof(len));
+	if (len < 0)
+		return NULL;
+	s = palloc(len + 1);
+	binRead(s, len);
+	s[len] = '\0';
+
+	return s;
+}
+
+static Bitmapset *
+binReadBitmapset(void)
+{
+	int32		nwords;
+	Bitmapset  *bms;
+
+	binRead(&nwords, sizeof(nwords));
+	if (nwords <= 0)
+		return NULL;
+
+	bms = (Bitmapset *) palloc(offsetof(Bitmapset, words) +
+							   nwords * sizeof(bitmapword));
+	bms->type = T_Bitmapset;
+	bms->nwords = nwords;
+	binRead(bms->words, nwords * sizeof(bitmapword));
+
+	return bms;
+}
+
+static void *
+binReadArray(Size elemsize, int len)
+{
+	bool		isnull;
+	void	   *arr;
+
+	binRead(&isnull, sizeof(isnull));
+	if (isnull)
+		return NULL;
+
+	arr = palloc(elemsize * len);
+	if (len > 0)
+		binRead(arr, elemsize * len);
+
+	return arr;
+}
+
+static Datum
+binReadDatum(int typlen, bool typbyval)
+{
+	Datum		value;
+	Size		len;
+	char	   *s;
+
+	if (typbyval)
+	{
+		binRead(&value, sizeof(Datum));
+		return value;
+	}
+
+	binRead(&len, sizeof(len));
+	if (len == 0)
+		return (Datum) 0;
+	s = palloc(len);
+	binRead(s, len);
+
+	return PointerGetDatum(s);
+}
+
+/* Read a node embedded in its text form */
+static void *
+binReadAsText(void)
+{
+	char	   *s = binReadString();
+	void	   *result;
+
+	if (s == NULL)
+		elog(ERROR, "missing text of embedded node");
+	result = stringToNode(s);
+	pfree(s);
+
+	return result;
+}
+
+static List *
+binReadList(NodeTag type)
+{
+	int32		len;
+	List	   *result = NIL;
+
+	binRead(&len, sizeof(len));
+
+	for (int i = 0; i < len; i++)
+	{
+		if (type == T_List)
+			result = lappend(result, binReadNode());
+		else if (type == T_IntList)
+		{
+			int			val;
+
+			binRead(&val, sizeof(val));
+			result = lappend_int(result, val);
+		}
+		else if (type == T_OidList)
+		{
+			Oid			val;
+
+			binRead(&val, sizeof(val));
+			result = lappend_oid(result, val);
+		}
+		else
+		{
+			TransactionId val;
+
+			binRead(&val, sizeof(val));
+			result = lappend_xid(result, val);
+		}
+	}
+
+	return result;
+}
+
+/*
+ * Only the generated code for CustomScan calls this, and that code is never
+ * used here.
+ */
+static char *
+nullable_string(const char *token, int length)
+{
+	if (length == 0)
+		return NULL;
+	return pnstrdup(token, length);
+}
+
+
+#include "outfuncs.funcs.c"
+#include "readfuncs.funcs.c"
+
+
+/*
+ * Support functions for nodes with custom_read_write attribute
+ */
+
+static void
+_outConst(StringInfo str, const Const *node)
+{
+	WRITE_OID_FIELD(consttype);
+	WRITE_INT_FIELD(consttypmod);
+	WRITE_OID_FIELD(constcollid);
+	WRITE_INT_FIELD(constlen);
+	WRITE_BOOL_FIELD(constbyval);
+	WRITE_BOOL_FIELD(constisnull);
+
+	if (!node->constisnull)
+		binWriteDatum(str, node->constvalue, node->constlen, node->constbyval);
+}
+
+static Const *
+_readConst(void)
+{
+	READ_LOCALS(Const);
+
+	READ_OID_FIELD(consttype);
+	READ_INT_FIELD(consttypmod);
+	READ_OID_FIELD(constcollid);
+	READ_INT_FIELD(constlen);
+	READ_BOOL_FIELD(constbyval);
+	READ_BOOL_FIELD(constisnull);
+	READ_LOCATION_FIELD(location);
+
+	if (!local_node->constisnull)
+		local_node->constvalue = binReadDatum(local_node->constlen,
+											  local_node->constbyval);
+
+	READ_DONE();
+}
+
+static void
+_outBoolExpr(StringInfo str, const BoolExpr *node)
+{
+	WRITE_ENUM_FIELD(boolop, BoolExprType);
+	WRITE_NODE_FIELD(args);
+}
+
+static BoolExpr *
+_readBoolExpr(void)
+{
+	READ_LOCALS(BoolExpr);
+
+	READ_ENUM_FIELD(boolop, BoolExprType);
+	READ_NODE_FIELD(args);
+	READ_LOCATION_FIELD(location);
+
+	READ_DONE();
+}
+
+static void
+_outRangeTblEntry(StringInfo str, const RangeTblEntry *node)
+{
+	WRITE_NODE_FIELD(alias);
+	WRITE_NODE_FIELD(eref);
+	WRITE_ENUM_FIELD(rtekind, RTEKind);
+
+	switch (node->rtekind)
+	{
+		case RTE_RELATION:
+			WRITE_OID_FIELD(relid);
+			WRITE_BOOL_FIELD(inh);
+			WRITE_CHAR_FIELD(relkind);
+			WRITE_INT_FIELD(rellockmode);
+			WRITE_UINT_FIELD(perminfoindex);
+			WRITE_NODE_FIELD(tablesample);
+			break;
+		case RTE_SUBQUERY:
+			WRITE_NODE_FIELD(subquery);
+			WRITE_BOOL_FIELD(security_barrier);
+			/* we re-use these RELATION fields, too: */
+			WRITE_OID_FIELD(relid);
+			WRITE_BOOL_FIELD(inh);
+			WRITE_CHAR_FIELD(relkind);
+			WRITE_INT_FIELD(rellockmode);
+			WRITE_UINT_FIELD(perminfoindex);
+			break;
+		case RTE_JOIN:
+			WRITE_ENUM_FIELD(jointype, JoinType);
+			WRITE_INT_FIELD(joinmergedcols);
+			WRITE_NODE_FIELD(joinaliasvars);
+			WRITE_NODE_FIELD(joinleftcols);
+			WRITE_NODE_FIELD(joinrightcols);
+			WRITE_NODE_FIELD(join_using_alias);
+			break;
+		case RTE_FUNCTION:
+			WRITE_NODE_FIELD(functions);
+			WRITE_BOOL_FIELD(funcordinality);
+			break;
+		case RTE_TABLEFUNC:
+			WRITE_NODE_FIELD(tablefunc);
+			break;
+		case RTE_VALUES:
+			WRITE_NODE_FIELD(values_lists);
+			WRITE_NODE_FIELD(coltypes);
+			WRITE_NODE_FIELD(coltypmods);
+			WRITE_NODE_FIELD(colcollations);
+			break;
+		case RTE_CTE:
+			WRITE_STRING_FIELD(ctename);
+			WRITE_UINT_FIELD(ctelevelsup);
+			WRITE_BOOL_FIELD(self_reference);
+			WRITE_NODE_FIELD(coltypes);
+			WRITE_NODE_FIELD(coltypmods);
+			WRITE_NODE_FIELD(colcollations);
+			break;
+		case RTE_NAMEDTUPLESTORE:
+			WRITE_STRING_FIELD(enrname);
+			WRITE_FLOAT_FIELD(enrtuples);
+			WRITE_NODE_FIELD(coltypes);
+			WRITE_NODE_FIELD(coltypmods);
+			WRITE_NODE_FIELD(colcollations);
+			/* we re-use these RELATION fields, too: */
+			WRITE_OID_FIELD(relid);
+			break;
+		case RTE_RESULT:
+			/* no extra fields */
+			break;
+		case RTE_GROUP:
+			WRITE_NODE_FIELD(groupexprs);
+			break;
+		default:
+			elog(ERROR, "unrecognized RTE kind: %d", (int) node->rtekind);
+			break;
+	}
+
+	WRITE_BOOL_FIELD(lateral);
+	WRITE_BOOL_FIELD(inFromCl);
+	WRITE_NODE_FIELD(securityQuals);
+}
+
+static RangeTblEntry *
+_readRangeTblEntry(void)
+{
+	READ_LOCALS(RangeTblEntry);
+
+	READ_NODE_FIELD(alias);
+	READ_NODE_FIELD(eref);
+	READ_ENUM_FIELD(rtekind, RTEKind);
+
+	switch (local_node->rtekind)
+	{
+		case RTE_RELATION:
+			READ_OID_FIELD(relid);
+			READ_BOOL_FIELD(inh);
+			READ_CHAR_FIELD(relkind);
+			READ_INT_FIELD(rellockmode);
+			READ_UINT_FIELD(perminfoindex);
+			READ_NODE_FIELD(tablesample);
+			break;
+		case RTE_SUBQUERY:
+			READ_NODE_FIELD(subquery);
+			READ_BOOL_FIELD(security_barrier);
+			/* we re-use these RELATION fields, too: */
+			READ_OID_FIELD(relid);
+			READ_BOOL_FIELD(inh);
+			READ_CHAR_FIELD(relkind);
+			READ_INT_FIELD(rellockmode);
+			READ_UINT_FIELD(perminfoindex);
+			break;
+		case RTE_JOIN:
+			READ_ENUM_FIELD(jointype, JoinType);
+			READ_INT_FIELD(joinmergedcols);
+			READ_NODE_FIELD(joinaliasvars);
+			READ_NODE_FIELD(joinleftcols);
+			READ_NODE_FIELD(joinrightcols);
+			READ_NODE_FIELD(join_using_alias);
+			break;
+		case RTE_FUNCTION:
+			READ_NODE_FIELD(functions);
+			READ_BOOL_FIELD(funcordinality);
+			break;
+		case RTE_TABLEFUNC:
+			READ_NODE_FIELD(tablefunc);
+			/* The RTE must have a copy of the column type info, if any */
+			if (local_node->tablefunc)
+			{
+				TableFunc  *tf = local_node->tablefunc;
+
+				local_node->coltypes = tf->coltypes;
+				local_node->coltypmods = tf->coltypmods;
+				local_node->colcollations = tf->colcollations;
+			}
+			break;
+		case RTE_VALUES:
+			READ_NODE_FIELD(values_lists);
+			READ_NODE_FIELD(coltypes);
+			READ_NODE_FIELD(coltypmods);
+			READ_NODE_FIELD(colcollations);
+			break;
+		case RTE_CTE:
+			READ_STRING_FIELD(ctename);
+			READ_UINT_FIELD(ctelevelsup);
+			READ_BOOL_FIELD(self_reference);
+			READ_NODE_FIELD(coltypes);
+			READ_NODE_FIELD(coltypmods);
+			READ_NODE_FIELD(colcollations);
+			break;
+		case RTE_NAMEDTUPLESTORE:
+			READ_STRING_FIELD(enrname);
+			READ_FLOAT_FIELD(enrtuples);
+			READ_NODE_FIELD(coltypes);
+			READ_NODE_FIELD(coltypmods);
+			READ_NODE_FIELD(colcollations);
+			/* we re-use these RELATION fields, too: */
+			READ_OID_FIELD(relid);
+			break;
+		case RTE_RESULT:
+			/* no extra fields */
+			break;
+		case RTE_GROUP:
+			READ_NODE_FIELD(groupexprs);
+			break;
+		default:
+			elog(ERROR, "unrecognized RTE kind: %d",
+				 (int) local_node->rtekind);
+			break;
+	}
+
+	READ_BOOL_FIELD(lateral);
+	READ_BOOL_FIELD(inFromCl);
+	READ_NODE_FIELD(securityQuals);
+
+	READ_DONE();
+}
+
+/* These don't occur in plans, so just embed their text form */
+
+static void
+_outForeignKeyOptInfo(StringInfo str, const ForeignKeyOptInfo *node)
+{
+	binOutAsText(str, node);
+}
+
+static void
+_outEquivalenceClass(StringInfo str, const EquivalenceClass *node)
+{
+	binOutAsText(str, node);
+}
+
+static void
+_outExtensibleNode(StringInfo str, const ExtensibleNode *node)
+{
+	binOutAsText(str, node);
+}
+
+static ExtensibleNode *
+_readExtensibleNode(void)
+{
+	return (ExtensibleNode *) binReadAsText();
+}
+
+static void
+_outA_Expr(StringInfo str, const A_Expr *node)
+{
+	binOutAsText(str, node);
+}
+
+static A_Expr *
+_readA_Expr(void)
+{
+	return (A_Expr *) binReadAsText();
+}
+
+static void
+_outA_Const(StringInfo str, const A_Const *node)
+{
+	binOutAsText(str, node);
+}
+
+static A_Const *
+_readA_Const(void)
+{
+	return (A_Const *) binReadAsText();
+}
+
+
+/*
+ * binOutNode -
+ *	  write the binary representation of a node or NULL into str
+ */
+static void
+binOutNode(StringInfo str, const void *obj)
+{
+	int32		tag;
+
+	/* Guard against stack overflow due to overly complex expressions */
+	check_stack_depth();
+
+	tag = obj ? (int32) nodeTag(obj) : (int32) T_Invalid;
+	binWrite(str, &tag, sizeof(tag));
+
+	if (obj == NULL)
+		return;
+
+	/* the generated output code for CustomScan is specific to text */
+	if (IsA(obj, CustomScan))
+	{
+		binOutAsText(str, obj);
+		return;
+	}
+
+	switch (nodeTag(obj))
+	{
+		case T_List:
+		case T_IntList:
+		case T_OidList:
+		case T_XidList:
+			binOutList(str, obj);
+			break;
+		case T_Integer:
+			binWrite(str, &((const Integer *) obj)->ival, sizeof(int));
+			break;
+		case T_Float:
+			binWriteString(str, ((const Float *) obj)->fval);
+			break;
+		case T_Boolean:
+			binWrite(str, &((const Boolean *) obj)->boolval, sizeof(bool));
+			break;
+		case T_String:
+			binWriteString(str, ((const String *) obj)->sval);
+			break;
+		case T_BitString:
+			binWriteString(str, ((const BitString *) obj)->bsval);
+			break;
+		case T_Bitmapset:
+			binWriteBitmapset(str, obj);
+			break;
+#include "outfuncs.switch.c"
+
+		default:
+			elog(ERROR, "could not serialize unrecognized node type: %d",
+				 (int) nodeTag(obj));
+			break;
+	}
+}
+
+/*
+ * binReadNode -
+ *	  read a node written by binOutNode()
+ */
+static void *
+binReadNode(void)
+{
+	int32		tag;
+
+	/* Guard against stack overflow due to overly complex expressions */
+	check_stack_depth();
+
+	binRead(&tag, sizeof(tag));
+
+	if (tag == T_Invalid)
+		return NULL;
+	if (tag == T_CustomScan)
+		return binReadAsText();
+
+	switch ((NodeTag) tag)
+	{
+		case T_List:
+		case T_IntList:
+		case T_OidList:
+		case T_XidList:
+			return binReadList((NodeTag) tag);
+		case T_Integer:
+			{
+				int			val;
+
+				binRead(&val, sizeof(val));
+				return makeInteger(val);
+			}
+		case T_Float:
+			return makeFloat(binReadString());
+		case T_Boolean:
+			{
+				bool		val;
+
+				binRead(&val, sizeof(val));
+				return makeBoolean(val);
+			}
+		case T_String:
+			return makeString(binReadString());
+		case T_BitString:
+			return makeBitString(binReadString());
+		case T_Bitmapset:
+			return binReadBitmapset();
+#include "binfuncs.switch.c"
+
+		default:
+			break;
+	}
+
+	elog(ERROR, "unrecognized node type in binary node data: %d", (int) tag);
+	return NULL;				/* keep compiler quiet */
+}
+
+/*
+ * nodeToBinary -
+ *	   returns the binary representation of the node tree, whose length is
+ *	   stored in *len
+ *
+ * The result can only be read back by binaryToNode() in a process running
+ * the same server binary.
+ */
+char *
+nodeToBinary(const void *obj, Size *len)
+{
+	StringInfoData str;
+
+	initStringInfo(&str);
+	binOutNode(&str, obj);
+	*len = str.len;
+
+	return str.data;
+}
+
+/*
+ * binaryToNode -
+ *	   rebuild a node tree from the output of nodeToBinary()
+ */
+void *
+binaryToNode(const char *data, Size len)
+{
+	void	   *result;
+
+	bin_read_ptr = data;
+	bin_read_end = data + len;
+
+	result = binReadNode();
+
+	if (bin_read_ptr != bin_read_end)
+		elog(ERROR, "unexpected data after the end of binary node data");
+
+	bin_read_ptr = bin_read_end = NULL;
+
+	return result;
+}
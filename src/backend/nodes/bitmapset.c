@@ -42,6 +42,7 @@
 #include "nodes/bitmapset.h"
 #include "nodes/pg_list.h"
 #include "port/pg_bitutils.h"
+#include "port/simd.h"
 
 
 #define WORDNUM(x)	((x) / BITS_PER_BITMAPWORD)
@@ -71,6 +72,112 @@
 
 #define HAS_MULTIPLE_ONES(x)	((bitmapword) RIGHTMOST_ONE(x) != (x))
 
+/*
+ * Sets with many members, such as the relids of queries on thousands of
+ * partitions, are processed a vector of words at a time by the helpers
+ * below.  Each handles as many whole vectors as fit in the given number of
+ * words and returns how many words that was, leaving the rest to the
+ * caller's word-at-a-time loop.  Most sets fit in a word or two, for which
+ * the helpers do nothing.
+ */
+#ifndef USE_NO_SIMD
+#define BMS_VECTOR_WORDS	((int) (sizeof(Vector8) / sizeof(bitmapword)))
+#endif
+
+/* dst[i] |= src[i] */
+static inline int
+bmw_or_vector(bitmapword *dst, const bitmapword *src, int nwords)
+{
+	int			i = 0;
+
+#ifndef USE_NO_SIMD
+	for (; i + BMS_VECTOR_WORDS <= nwords; i += BMS_VECTOR_WORDS)
+	{
+		Vector8		v1;
+		Vector8		v2;
+
+		vector8_load(&v1, (const uint8 *) &dst[i]);
+		vector8_load(&v2, (const uint8 *) &src[i]);
+		vector8_store((uint8 *) &dst[i], vector8_or(v1, v2));
+	}
+#endif
+
+	return i;
+}
+
+/* dst[i] &= src[i] */
+static inline int
+bmw_and_vector(bitmapword *dst, const bitmapword *src, int nwords)
+{
+	int			i = 0;
+
+#ifndef USE_NO_SIMD
+	for (; i + BMS_VECTOR_WORDS <= nwords; i += BMS_VECTOR_WORDS)
+	{
+		Vector8		v1;
+		Vector8		v2;
+
+		vector8_load(&v1, (const uint8 *) &dst[i]);
+		vector8_load(&v2, (const uint8 *) &src[i]);
+		vector8_store((uint8 *) &dst[i], vector8_and(v1, v2));
+	}
+#endif
+
+	return i;
+}
+
+/*
+ * Check that (a[i] & ~b[i]) == 0, that is (a[i] | b[i]) == b[i].  Stops at
+ * the first vector where that isn't so, setting *subset to false.
+ */
+static inline int
+bmw_subset_vector(const bitmapword *a, const bitmapword *b, int nwords,
+				  bool *subset)
+{
+	int			i = 0;
+
+	*subset = true;
+#ifndef USE_NO_SIMD
+	for (; i + BMS_VECTOR_WORDS <= nwords; i += BMS_VECTOR_WORDS)
+	{
+		Vector8		va;
+		Vector8		vb;
+
+		vector8_load(&va, (const uint8 *) &a[i]);
+		vector8_load(&vb, (const uint8 *) &b[i]);
+		if (vector8_highbit_mask(vector8_eq(vector8_or(va, vb), vb)) != 0xFFFF)
+		{
+			*subset = false;
+			break;
+		}
+	}
+#endif
+
+	return i;
+}
+
+/* Skip vectors of zero words, starting at words[start] */
+static inline int
+bmw_skip_zero_vectors(const bitmapword *words, int start, int nwords)
+{
+	int			i = start;
+
+#ifndef USE_NO_SIMD
+	const Vector8 zero = vector8_broadcast(0);
+
+	for (; i + BMS_VECTOR_WORDS <= nwords; i += BMS_VECTOR_WORDS)
+	{
+		Vector8		v;
+
+		vector8_load(&v, (const uint8 *) &words[i]);
+		if (vector8_highbit_mask(vector8_eq(v, zero)) != 0xFFFF)
+			break;
+	}
+#endif
+
+	return i;
+}
+
 #ifdef USE_ASSERT_CHECKING
 /*
  * bms_is_valid_set - for cassert builds to check for valid sets
@@ -276,11 +383,9 @@ bms_union(const Bitmapset *a, const Bitmapset *b)
 	}
 	/* And union the shorter input into the result */
 	otherlen = other->nwords;
-	i = 0;
-	do
-	{
+	i = bmw_or_vector(result->words, other->words, otherlen);
+	for (; i < otherlen; i++)
 		result->words[i] |= other->words[i];
-	} while (++i < otherlen);
 	return result;
 }
 
@@ -317,15 +422,15 @@ bms_intersect(const Bitmapset *a, const Bitmapset *b)
 	}
 	/* And intersect the longer input with the result */
 	resultlen = result->nwords;
-	lastnonzero = -1;
-	i = 0;
-	do
-	{
+	i = bmw_and_vector(result->words, other->words, resultlen);
+	for (; i < resultlen; i++)
 		result->words[i] &= other->words[i];
 
-		if (result->words[i] != 0)
-			lastnonzero = i;
-	} while (++i < resultlen);
+	/* find the last nonzero word */
+	lastnonzero = resultlen - 1;
+	while (lastnonzero >= 0 && result->words[lastnonzero] == 0)
+		lastnonzero--;
+
 	/* If we computed an empty result, we must return NULL */
 	if (lastnonzero == -1)
 	{
@@ -412,6 +517,7 @@ bool
 bms_is_subset(const Bitmapset *a, const Bitmapset *b)
 {
 	int			i;
+	bool		subset;
 
 	Assert(bms_is_valid_set(a));
 	Assert(bms_is_valid_set(b));
@@ -427,12 +533,14 @@ bms_is_subset(const Bitmapset *a, const Bitmapset *b)
 		return false;
 
 	/* Check all 'a' members are set in 'b' */
-	i = 0;
-	do
+	i = bmw_subset_vector(a->words, b->words, a->nwords, &subset);
+	if (!subset)
+		return false;
+	for (; i < a->nwords; i++)
 	{
 		if ((a->words[i] & ~b->words[i]) != 0)
 			return false;
-	} while (++i < a->nwords);
+	}
 	return true;
 }
 
@@ -759,6 +867,12 @@ bms_num_members(const Bitmapset *a)
 		return 0;
 
 	nwords = a->nwords;
+
+	/* Long sets are better counted all at once */
+	if (nwords >= 8)
+		return (int) pg_popcount((const char *) a->words,
+								 nwords * sizeof(bitmapword));
+
 	wordnum = 0;
 	do
 	{
@@ -947,11 +1061,9 @@ bms_add_members(Bitmapset *a, const Bitmapset *b)
 	}
 	/* And union the shorter input into the result */
 	otherlen = other->nwords;
-	i = 0;
-	do
-	{
+	i = bmw_or_vector(result->words, other->words, otherlen);
+	for (; i < otherlen; i++)
 		result->words[i] |= other->words[i];
-	} while (++i < otherlen);
 	if (result != a)
 		pfree(a);
 #ifdef REALLOCATE_BITMAPSETS
@@ -1332,6 +1444,9 @@ bms_next_member(const Bitmapset *a, int prevbit)
 
 		/* in subsequent words, consider all bits */
 		mask = (~(bitmapword) 0);
+
+		/* and skip runs of empty words quickly */
+		wordnum = bmw_skip_zero_vectors(a->words, wordnum + 1, nwords) - 1;
 	}
 	return -2;
 }
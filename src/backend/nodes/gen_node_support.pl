@@ -7,6 +7,7 @@
 # - equalfuncs
 # - readfuncs
 # - outfuncs
+# - binfuncs
 #
 # Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
 # Portions Copyright (c) 1994, Regents of the University of California
@@ -895,7 +896,7 @@ close $cfs;
 close $efs;
 
 
-# outfuncs.c, readfuncs.c
+# outfuncs.c, readfuncs.c, binfuncs.c
 
 push @output_files, 'outfuncs.funcs.c';
 open my $off, '>', "$output_path/outfuncs.funcs.c$tmpext" or die $!;
@@ -905,11 +906,14 @@ push @output_files, 'outfuncs.switch.c';
 open my $ofs, '>', "$output_path/outfuncs.switch.c$tmpext" or die $!;
 push @output_files, 'readfuncs.switch.c';
 open my $rfs, '>', "$output_path/readfuncs.switch.c$tmpext" or die $!;
+push @output_files, 'binfuncs.switch.c';
+open my $bfs, '>', "$output_path/binfuncs.switch.c$tmpext" or die $!;
 
 printf $off $header_comment, 'outfuncs.funcs.c';
 printf $rff $header_comment, 'readfuncs.funcs.c';
 printf $ofs $header_comment, 'outfuncs.switch.c';
 printf $rfs $header_comment, 'readfuncs.switch.c';
+printf $bfs $header_comment, 'binfuncs.switch.c';
 
 print $off $node_includes;
 print $rff $node_includes;
@@ -935,6 +939,10 @@ foreach my $n (@node_types)
 	  . "\t\treturn (Node *) _read${n}();\n"
 	  unless $no_read;
 
+	print $bfs "\t\tcase T_${n}:\n"
+	  . "\t\t\treturn (Node *) _read${n}();\n"
+	  unless $no_read;
+
 	next if elem $n, @custom_read_write;
 
 	print $off "
@@ -1252,6 +1260,7 @@ close $off;
 close $rff;
 close $ofs;
 close $rfs;
+close $bfs;
 
 
 # queryjumblefuncs.c
@@ -42,7 +42,9 @@
 #include "common/hashfn.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
+#include "nodes/plannodes.h"
 #include "nodes/queryjumble.h"
+#include "parser/parsetree.h"
 #include "utils/lsyscache.h"
 #include "parser/scansup.h"
 
@@ -69,6 +71,7 @@ static void RecordConstLocation(JumbleState *jstate,
 								bool extern_param,
 								int location, int len);
 static void _jumbleNode(JumbleState *jstate, Node *node);
+static void _jumblePlan(JumbleState *jstate, PlannedStmt *pstmt, Plan *plan);
 static void _jumbleList(JumbleState *jstate, Node *node);
 static void _jumbleElements(JumbleState *jstate, List *elements, Node *node);
 static void _jumbleParam(JumbleState *jstate, Node *node);
@@ -159,6 +162,48 @@ JumbleQuery(Query *query)
 	return jstate;
 }
 
+/*
+ * JumblePlan
+ *		Compute a 64-bit identifier of the shape of the given plan.
+ *
+ * Two plans get the same identifier if they consist of the same nodes, scan
+ * the same relations through the same indexes, and join and aggregate the
+ * same ways.  Costs, row estimates and expressions are not considered, so
+ * that the identifier doesn't depend on the values of constants.  Note that
+ * the identifier can't be relied on across major versions or servers, since
+ * it contains OIDs.
+ */
+int64
+JumblePlan(PlannedStmt *pstmt)
+{
+	JumbleState *jstate;
+	ListCell   *lc;
+	int64		planId;
+
+	jstate = InitJumble();
+
+	_jumblePlan(jstate, pstmt, pstmt->planTree);
+	foreach(lc, pstmt->subplans)
+		_jumblePlan(jstate, pstmt, lfirst(lc));
+
+	if (jstate->pending_nulls > 0)
+		FlushPendingNulls(jstate);
+
+	planId = DatumGetInt64(hash_any_extended(jstate->jumble,
+											 jstate->jumble_len,
+											 0));
+
+	pfree(jstate->jumble);
+	pfree(jstate->clocations);
+	pfree(jstate);
+
+	/* zero means "no plan identifier" */
+	if (planId == INT64CONST(0))
+		planId = INT64CONST(1);
+
+	return planId;
+}
+
 /*
  * Enables query identifier computation.
  *
@@ -602,6 +647,112 @@ _jumbleNode(JumbleState *jstate, Node *node)
 	Assert(jstate->total_jumble_len > prev_jumble_len);
 }
 
+/*
+ * Jumble a plan tree for JumblePlan().
+ */
+static void
+_jumblePlan(JumbleState *jstate, PlannedStmt *pstmt, Plan *plan)
+{
+	Plan	   *expr = plan;
+	ListCell   *lc;
+	List	   *children = NIL;
+
+	if (plan == NULL)
+	{
+		AppendJumbleNull(jstate);
+		return;
+	}
+
+	check_stack_depth();
+
+	JUMBLE_FIELD(type);
+
+	/* the relation a scan node reads */
+	switch (nodeTag(plan))
+	{
+		case T_SeqScan:
+		case T_SampleScan:
+		case T_IndexScan:
+		case T_IndexOnlyScan:
+		case T_BitmapHeapScan:
+		case T_TidScan:
+		case T_TidRangeScan:
+		case T_ForeignScan:
+		case T_CustomScan:
+			{
+				Index		scanrelid = ((Scan *) plan)->scanrelid;
+
+				if (scanrelid > 0)
+				{
+					RangeTblEntry *rte = rt_fetch(scanrelid, pstmt->rtable);
+
+					AppendJumble32(jstate, (const unsigned char *) &rte->relid);
+				}
+				else
+					AppendJumbleNull(jstate);
+			}
+			break;
+		default:
+			break;
+	}
+
+	/* other fields that make a plan different */
+	switch (nodeTag(plan))
+	{
+		case T_IndexScan:
+			AppendJumble32(jstate,
+						   (const unsigned char *) &((IndexScan *) plan)->indexid);
+			break;
+		case T_IndexOnlyScan:
+			AppendJumble32(jstate,
+						   (const unsigned char *) &((IndexOnlyScan *) plan)->indexid);
+			break;
+		case T_BitmapIndexScan:
+			AppendJumble32(jstate,
+						   (const unsigned char *) &((BitmapIndexScan *) plan)->indexid);
+			break;
+		case T_NestLoop:
+		case T_MergeJoin:
+		case T_HashJoin:
+			AppendJumble32(jstate,
+						   (const unsigned char *) &((Join *) plan)->jointype);
+			break;
+		case T_Agg:
+			AppendJumble32(jstate,
+						   (const unsigned char *) &((Agg *) plan)->aggstrategy);
+			break;
+		case T_ModifyTable:
+			AppendJumble32(jstate,
+						   (const unsigned char *) &((ModifyTable *) plan)->operation);
+			break;
+		case T_Append:
+			children = ((Append *) plan)->appendplans;
+			break;
+		case T_MergeAppend:
+			children = ((MergeAppend *) plan)->mergeplans;
+			break;
+		case T_BitmapAnd:
+			children = ((BitmapAnd *) plan)->bitmapplans;
+			break;
+		case T_BitmapOr:
+			children = ((BitmapOr *) plan)->bitmapplans;
+			break;
+		case T_SubqueryScan:
+			children = list_make1(((SubqueryScan *) plan)->subplan);
+			break;
+		case T_CustomScan:
+			children = ((CustomScan *) plan)->custom_plans;
+			break;
+		default:
+			break;
+	}
+
+	_jumblePlan(jstate, pstmt, plan->lefttree);
+	_jumblePlan(jstate, pstmt, plan->righttree);
+	foreach(lc, children)
+		_jumblePlan(jstate, pstmt, lfirst(lc));
+}
+
 static void
 _jumbleList(JumbleState *jstate, Node *node)
 {
@@ -465,6 +465,40 @@ tbm_union(TIDBitmap *a, const TIDBitmap *b)
 	}
 }
 
+/*
+ * tbm_union_shared - set union with a bitmap prepared for shared iteration
+ *
+ * a is modified in-place.  dp is what tbm_prepare_shared_iterate returned for
+ * the other bitmap, which may have been built by another process; it must not
+ * be iterated over concurrently, since it is read without locking.
+ */
+void
+tbm_union_shared(TIDBitmap *a, dsa_area *dsa, dsa_pointer dp)
+{
+	TBMSharedIteratorState *istate = dsa_get_address(dsa, dp);
+	PTEntryArray *ptbase;
+	PTIterationArray *ptpages;
+	PTIterationArray *ptchunks;
+
+	Assert(!a->iterating);
+	if (istate->nentries == 0)
+		return;
+
+	ptbase = dsa_get_address(dsa, istate->pagetable);
+	if (istate->npages > 0)
+	{
+		ptpages = dsa_get_address(dsa, istate->spages);
+		for (int i = 0; i < istate->npages; i++)
+			tbm_union_page(a, &ptbase->ptentry[ptpages->index[i]]);
+	}
+	if (istate->nchunks > 0)
+	{
+		ptchunks = dsa_get_address(dsa, istate->schunks);
+		for (int i = 0; i < istate->nchunks; i++)
+			tbm_union_page(a, &ptbase->ptentry[ptchunks->index[i]]);
+	}
+}
+
 /* Process one page of b during a union op */
 static void
 tbm_union_page(TIDBitmap *a, const PagetableEntry *bpage)
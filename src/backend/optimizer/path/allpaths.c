@@ -35,6 +35,7 @@
 #include "optimizer/clauses.h"
 #include "optimizer/cost.h"
 #include "optimizer/geqo.h"
+#include "optimizer/joininfo.h"
 #include "optimizer/optimizer.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
@@ -48,6 +49,7 @@
 #include "port/pg_bitutils.h"
 #include "rewrite/rewriteManip.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/selfuncs.h"
 
 
@@ -81,6 +83,7 @@ typedef enum pushdown_safe_type
 bool		enable_geqo = false;	/* just in case GUC doesn't set it */
 bool		enable_eager_aggregate = true;
 int			geqo_threshold;
+bool		linearized_join_search = false;
 double		min_eager_agg_group_size;
 int			min_parallel_table_scan_size;
 int			min_parallel_index_scan_size;
@@ -148,6 +151,12 @@ static void set_result_pathlist(PlannerInfo *root, RelOptInfo *rel,
 static void set_worktable_pathlist(PlannerInfo *root, RelOptInfo *rel,
 								   RangeTblEntry *rte);
 static RelOptInfo *make_rel_from_joinlist(PlannerInfo *root, List *joinlist);
+static RelOptInfo *linearized_dp_join_search(PlannerInfo *root,
+											 int levels_needed,
+											 List *initial_rels);
+static int *linearize_join_order(PlannerInfo *root, int levels_needed,
+								 List *initial_rels);
+static void finish_join_rel(PlannerInfo *root, RelOptInfo *rel);
 static bool subquery_is_pushdown_safe(Query *subquery, Query *topquery,
 									  pushdown_safety_info *safetyInfo);
 static bool recurse_pushdown_safe(Node *setOp, Query *topquery,
@@ -668,9 +677,11 @@ set_rel_consider_parallel(PlannerInfo *root, RelOptInfo *rel,
 			 * taught the workers to read them.  Writing a large number of
 			 * temporary buffers could be expensive, though, and we don't have
 			 * the rest of the necessary infrastructure right now anyway.  So
-			 * for now, bail out if we see a temporary table.
+			 * for now, bail out if we see a temporary table.  The same goes
+			 * for global temporary tables, which use local buffers, too.
 			 */
-			if (get_rel_persistence(rte->relid) == RELPERSISTENCE_TEMP)
+			if (get_rel_persistence(rte->relid) == RELPERSISTENCE_TEMP ||
+				get_rel_persistence(rte->relid) == RELPERSISTENCE_GLOBAL_TEMP)
 				return;
 
 			/*
@@ -766,13 +777,20 @@ set_rel_consider_parallel(PlannerInfo *root, RelOptInfo *rel,
 		case RTE_CTE:
 
 			/*
-			 * CTE tuplestores aren't shared among parallel workers, so we
-			 * force all CTE scans to happen in the leader.  Also, populating
-			 * the CTE would require executing a subplan that's not available
-			 * in the worker, might be parallel-restricted, and must get
-			 * executed only once.
+			 * Populating the CTE requires executing a subplan that might be
+			 * parallel-restricted and must get executed only once, so it is
+			 * always run by the leader.  A parallel-aware CteScan can then
+			 * have the leader copy the result into a shared tuplestore, for
+			 * all participants to scan; see set_cte_pathlist.  That isn't
+			 * possible for the self-reference of a recursive CTE, nor for a
+			 * CTE of a subquery, whose result might depend on parameters
+			 * from the outer query, which would require refilling the shared
+			 * tuplestore while workers are reading it.
 			 */
-			return;
+			if (rte->self_reference ||
+				root->query_level - rte->ctelevelsup != 1)
+				return;
+			break;
 
 		case RTE_NAMEDTUPLESTORE:
 
@@ -3061,7 +3079,25 @@ set_cte_pathlist(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
 	required_outer = rel->lateral_relids;
 
 	/* Generate appropriate path */
-	add_path(rel, create_ctescan_path(root, rel, pathkeys, required_outer));
+	add_path(rel, create_ctescan_path(root, rel, pathkeys, required_outer, 0));
+
+	/*
+	 * If possible, also generate a partial path, for a parallel-aware scan
+	 * of a copy of the CTE in shared memory.  The CTE query itself is still
+	 * run by the leader alone, so it needn't be parallel-safe.
+	 */
+	if (rel->consider_parallel && required_outer == NULL)
+	{
+		double		pages;
+		int			parallel_workers;
+
+		pages = ceil(rel->tuples * rel->reltarget->width / BLCKSZ);
+		parallel_workers = compute_parallel_worker(rel, pages, -1,
+												   max_parallel_workers_per_gather);
+		if (parallel_workers > 0)
+			add_partial_path(rel, create_ctescan_path(root, rel, pathkeys, NULL,
+													  parallel_workers));
+	}
 }
 
 /*
@@ -3846,7 +3882,17 @@ make_rel_from_joinlist(PlannerInfo *root, List *joinlist)
 		if (join_search_hook)
 			return (*join_search_hook) (root, levels_needed, initial_rels);
 		else if (enable_geqo && levels_needed >= geqo_threshold)
-			return geqo(root, levels_needed, initial_rels);
+		{
+			RelOptInfo *rel = NULL;
+
+			if (linearized_join_search)
+				rel = linearized_dp_join_search(root, levels_needed,
+												initial_rels);
+			/* fall back to GEQO if we found no usable linear order */
+			if (rel == NULL)
+				rel = geqo(root, levels_needed, initial_rels);
+			return rel;
+		}
 		else
 			return standard_join_search(root, levels_needed, initial_rels);
 	}
@@ -3921,77 +3967,295 @@ standard_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
 
 		/*
 		 * Run generate_partitionwise_join_paths() and
-		 * generate_useful_gather_paths() for each just-processed joinrel.  We
-		 * could not do this earlier because both regular and partial paths
-		 * can get added to a particular joinrel at multiple times within
-		 * join_search_one_level.
-		 *
-		 * After that, we're done creating paths for the joinrel, so run
-		 * set_cheapest().
-		 *
-		 * In addition, we also run generate_grouped_paths() for the grouped
-		 * relation of each just-processed joinrel, and run set_cheapest() for
-		 * the grouped relation afterwards.
+		 * generate_useful_gather_paths() for each just-processed joinrel, and
+		 * then set_cheapest(); see finish_join_rel().  We could not do this
+		 * earlier because both regular and partial paths can get added to a
+		 * particular joinrel at multiple times within join_search_one_level.
 		 */
 		foreach(lc, root->join_rel_level[lev])
 		{
-			bool		is_top_rel;
-
 			rel = (RelOptInfo *) lfirst(lc);
 
-			is_top_rel = bms_equal(rel->relids, root->all_query_rels);
+			finish_join_rel(root, rel);
+
+#ifdef OPTIMIZER_DEBUG
+			pprint(rel);
+#endif
+		}
+	}
 
-			/* Create paths for partitionwise joins. */
-			generate_partitionwise_join_paths(root, rel);
+	/*
+	 * We should have a single rel at the final level.
+	 */
+	if (root->join_rel_level[levels_needed] == NIL)
+		elog(ERROR, "failed to build any %d-way joins", levels_needed);
+	Assert(list_length(root->join_rel_level[levels_needed]) == 1);
 
-			/*
-			 * Except for the topmost scan/join rel, consider gathering
-			 * partial paths.  We'll do the same for the topmost scan/join rel
-			 * once we know the final targetlist (see grouping_planner's and
-			 * its call to apply_scanjoin_target_to_paths).
-			 */
-			if (!is_top_rel)
-				generate_useful_gather_paths(root, rel, false);
+	rel = (RelOptInfo *) linitial(root->join_rel_level[levels_needed]);
 
-			/* Find and save the cheapest paths for this rel */
-			set_cheapest(rel);
+	root->join_rel_level = NULL;
+
+	return rel;
+}
+
+/*
+ * linearized_dp_join_search
+ *	  Find a join order for a large join problem by dynamic programming over
+ *	  a linear ordering of the jointree items.
+ *
+ * Exhaustive dynamic programming considers every subset of the items, which
+ * is hopeless beyond a dozen or so of them.  Instead we first put the items
+ * into a single sequence, using a greedy heuristic that prefers joins with
+ * small results (see linearize_join_order), and then run the dynamic
+ * programming algorithm over the contiguous subsequences of that sequence
+ * only.  That still finds the best bushy plan among those that respect the
+ * sequence, but needs just O(n^2) join relations and O(n^3) join attempts,
+ * so it copes with dozens of items in a few milliseconds.
+ *
+ * Returns NULL, without having built any join relations, if we can't find a
+ * sequence in which all the items can be joined; the caller then falls back
+ * to GEQO.
+ */
+static RelOptInfo *
+linearized_dp_join_search(PlannerInfo *root, int levels_needed,
+						  List *initial_rels)
+{
+	int		   *order;
+	RelOptInfo **joinrels;
+	RelOptInfo *rel;
+	int			len;
+
+	/* As in standard_join_search, join_rel_level[] can't be in use */
+	Assert(root->join_rel_level == NULL);
+
+	order = linearize_join_order(root, levels_needed, initial_rels);
+	if (order == NULL)
+		return NULL;
+
+	/*
+	 * joinrels[i * levels_needed + j] is the join relation for the items at
+	 * positions i through j of the sequence.
+	 */
+	joinrels = (RelOptInfo **)
+		palloc0(levels_needed * levels_needed * sizeof(RelOptInfo *));
+	for (int i = 0; i < levels_needed; i++)
+		joinrels[i * levels_needed + i] = list_nth(initial_rels, order[i]);
+
+	for (len = 2; len <= levels_needed; len++)
+	{
+		for (int i = 0; i + len <= levels_needed; i++)
+		{
+			int			j = i + len - 1;
+
+			rel = NULL;
 
 			/*
-			 * Except for the topmost scan/join rel, consider generating
-			 * partial aggregation paths for the grouped relation on top of
-			 * the paths of this rel.  After that, we're done creating paths
-			 * for the grouped relation, so run set_cheapest().
+			 * Build paths for every split of the subsequence into two
+			 * nonempty parts.  make_join_rel considers both join orders of
+			 * each pair, and returns the same joinrel for all of them.
 			 */
-			if (rel->grouped_rel != NULL && !is_top_rel)
+			for (int k = i; k < j; k++)
 			{
-				RelOptInfo *grouped_rel = rel->grouped_rel;
+				RelOptInfo *left = joinrels[i * levels_needed + k];
+				RelOptInfo *right = joinrels[(k + 1) * levels_needed + j];
+				RelOptInfo *joinrel;
 
-				Assert(IS_GROUPED_REL(grouped_rel));
+				if (left == NULL || right == NULL)
+					continue;
 
-				generate_grouped_paths(root, grouped_rel, rel);
-				set_cheapest(grouped_rel);
+				joinrel = make_join_rel(root, left, right);
+				if (joinrel != NULL)
+					rel = joinrel;
 			}
 
-#ifdef OPTIMIZER_DEBUG
-			pprint(rel);
-#endif
+			/* Now we're done adding paths to the joinrel */
+			if (rel != NULL)
+				finish_join_rel(root, rel);
+
+			joinrels[i * levels_needed + j] = rel;
 		}
 	}
 
 	/*
-	 * We should have a single rel at the final level.
+	 * linearize_join_order checked that each prefix of the sequence can be
+	 * joined to the next item, so this shouldn't happen.
 	 */
-	if (root->join_rel_level[levels_needed] == NIL)
+	rel = joinrels[levels_needed - 1];
+	if (rel == NULL)
 		elog(ERROR, "failed to build any %d-way joins", levels_needed);
-	Assert(list_length(root->join_rel_level[levels_needed]) == 1);
 
-	rel = (RelOptInfo *) linitial(root->join_rel_level[levels_needed]);
-
-	root->join_rel_level = NULL;
+	pfree(joinrels);
+	pfree(order);
 
 	return rel;
 }
 
+/*
+ * linearize_join_order
+ *	  Choose the sequence of jointree items for linearized_dp_join_search.
+ *
+ * Starting from the item with the fewest rows, we repeatedly append the item
+ * whose join to the items chosen so far is estimated to produce the fewest
+ * rows, considering only items that have a join clause or join order
+ * restriction with them as long as there are any, and only joins that are
+ * legal.  This is the greedy operator ordering heuristic restricted to
+ * left-deep trees; it's cheap and tends to put the selective joins first,
+ * which is what the subsequent dynamic programming pass needs.
+ *
+ * Returns an array of indexes into initial_rels, or NULL if we get stuck.
+ */
+static int *
+linearize_join_order(PlannerInfo *root, int levels_needed, List *initial_rels)
+{
+	int		   *order;
+	bool	   *used;
+	RelOptInfo *prefix;
+	MemoryContext mycontext;
+	MemoryContext oldcxt;
+	int			savelength;
+	struct HTAB *savehash;
+	int			first = 0;
+	int			pos;
+
+	order = palloc_array(int, levels_needed);
+	used = palloc0_array(bool, levels_needed);
+
+	/*
+	 * The join relations we build to compare the candidates are thrown away
+	 * again afterwards, in the same way as geqo_eval() does it: we build them
+	 * in a private memory context, and restore join_rel_list and
+	 * join_rel_hash when we're done.
+	 */
+	mycontext = AllocSetContextCreate(CurrentMemoryContext,
+									  "linearized join search",
+									  ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(mycontext);
+
+	savelength = list_length(root->join_rel_list);
+	savehash = root->join_rel_hash;
+	root->join_rel_hash = NULL;
+
+	/* Start with the smallest item */
+	for (int i = 1; i < levels_needed; i++)
+	{
+		if (((RelOptInfo *) list_nth(initial_rels, i))->rows <
+			((RelOptInfo *) list_nth(initial_rels, first))->rows)
+			first = i;
+	}
+	order[0] = first;
+	used[first] = true;
+	prefix = list_nth(initial_rels, first);
+
+	for (pos = 1; pos < levels_needed; pos++)
+	{
+		RelOptInfo *best_rel = NULL;
+		int			best = -1;
+
+		/*
+		 * First consider only the items that are connected to the prefix; if
+		 * none of them can be joined to it, allow clauseless joins.
+		 */
+		for (int pass = 0; pass < 2 && best_rel == NULL; pass++)
+		{
+			for (int i = 0; i < levels_needed; i++)
+			{
+				RelOptInfo *rel = list_nth(initial_rels, i);
+				RelOptInfo *joinrel;
+
+				if (used[i])
+					continue;
+				if (pass == 0 &&
+					!have_relevant_joinclause(root, prefix, rel) &&
+					!have_join_order_restriction(root, prefix, rel))
+					continue;
+
+				joinrel = make_join_rel(root, prefix, rel);
+				if (joinrel == NULL)
+					continue;
+
+				if (best_rel == NULL || joinrel->rows < best_rel->rows)
+				{
+					best_rel = joinrel;
+					best = i;
+				}
+			}
+		}
+
+		if (best_rel == NULL)
+			break;
+
+		/* The next round joins to best_rel, so it needs its cheapest paths */
+		set_cheapest(best_rel);
+
+		order[pos] = best;
+		used[best] = true;
+		prefix = best_rel;
+	}
+
+	root->join_rel_list = list_truncate(root->join_rel_list, savelength);
+	root->join_rel_hash = savehash;
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(mycontext);
+
+	pfree(used);
+
+	if (pos < levels_needed)
+	{
+		pfree(order);
+		return NULL;
+	}
+
+	return order;
+}
+
+/*
+ * finish_join_rel
+ *	  Complete the paths of a joinrel once all the ways of building it from
+ *	  pairs of input rels have been considered.
+ *
+ * This adds partitionwise join paths and Gather paths, which can only be
+ * built once all the regular and partial paths are in place, and then runs
+ * set_cheapest().  We also run generate_grouped_paths() for the grouped
+ * relation of the joinrel, and set_cheapest() for it afterwards.
+ */
+static void
+finish_join_rel(PlannerInfo *root, RelOptInfo *rel)
+{
+	bool		is_top_rel = bms_equal(rel->relids, root->all_query_rels);
+
+	/* Create paths for partitionwise joins. */
+	generate_partitionwise_join_paths(root, rel);
+
+	/*
+	 * Except for the topmost scan/join rel, consider gathering partial paths.
+	 * We'll do the same for the topmost scan/join rel once we know the final
+	 * targetlist (see grouping_planner's and its call to
+	 * apply_scanjoin_target_to_paths).
+	 */
+	if (!is_top_rel)
+		generate_useful_gather_paths(root, rel, false);
+
+	/* Find and save the cheapest paths for this rel */
+	set_cheapest(rel);
+
+	/*
+	 * Except for the topmost scan/join rel, consider generating partial
+	 * aggregation paths for the grouped relation on top of the paths of this
+	 * rel.  After that, we're done creating paths for the grouped relation,
+	 * so run set_cheapest().
+	 */
+	if (rel->grouped_rel != NULL && !is_top_rel)
+	{
+		RelOptInfo *grouped_rel = rel->grouped_rel;
+
+		Assert(IS_GROUPED_REL(grouped_rel));
+
+		generate_grouped_paths(root, grouped_rel, rel);
+		set_cheapest(grouped_rel);
+	}
+}
+
 /*****************************************************************************
  *			PUSHING QUALS DOWN INTO SUBQUERIES
  *****************************************************************************/
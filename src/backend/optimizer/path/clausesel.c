@@ -154,6 +154,17 @@ clauselist_selectivity_ext(PlannerInfo *root,
 											jointype, sjinfo, rel,
 											&estimatedclauses, false);
 	}
+	else if (use_extended_stats && rel == NULL && varRelid == 0 &&
+			 sjinfo != NULL)
+	{
+		/*
+		 * These are join clauses.  Estimate equalities between columns of
+		 * the same two relations together, if the extended statistics of
+		 * both relations allow it.
+		 */
+		s1 = statext_join_clauselist_selectivity(root, clauses, jointype,
+												 sjinfo, &estimatedclauses);
+	}
 
 	/*
 	 * Apply normal selectivity estimates for remaining clauses. We'll be
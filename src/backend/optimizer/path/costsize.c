@@ -145,6 +145,7 @@ int			max_parallel_workers_per_gather = 2;
 bool		enable_seqscan = true;
 bool		enable_indexscan = true;
 bool		enable_indexonlyscan = true;
+bool		enable_looseindexscan = false;
 bool		enable_bitmapscan = true;
 bool		enable_tidscan = true;
 bool		enable_sort = true;
@@ -153,6 +154,7 @@ bool		enable_hashagg = true;
 bool		enable_nestloop = true;
 bool		enable_material = true;
 bool		enable_memoize = true;
+bool		enable_subplan_cache = false;
 bool		enable_mergejoin = true;
 bool		enable_hashjoin = true;
 bool		enable_gathermerge = true;
@@ -160,9 +162,12 @@ bool		enable_partitionwise_join = false;
 bool		enable_partitionwise_aggregate = false;
 bool		enable_parallel_append = true;
 bool		enable_parallel_hash = true;
+bool		enable_parallel_sort = false;
+bool		enable_parallel_window = false;
 bool		enable_partition_pruning = true;
 bool		enable_presorted_aggregate = true;
 bool		enable_async_append = true;
+bool		enable_adaptive_join = true;
 
 typedef struct
 {
@@ -202,7 +207,6 @@ static void set_rel_width(PlannerInfo *root, RelOptInfo *rel);
 static int32 get_expr_width(PlannerInfo *root, const Node *expr);
 static double relation_byte_size(double tuples, int width);
 static double page_size(double tuples, int width);
-static double get_parallel_divisor(Path *path);
 
 
 /*
@@ -804,6 +808,55 @@ cost_index(IndexPath *path, PlannerInfo *root, double loop_count,
 	path->path.total_cost = startup_cost + run_cost;
 }
 
+/*
+ * cost_loose_index_scan
+ *	  Adjust the rows and costs of a copy of an already-costed index path
+ *	  that has been made into a loose index scan returning 'numGroups' rows.
+ *
+ * A loose scan fetches one tuple per group, at the per-tuple cost of the
+ * full scan, but must descend the index afresh for each group.  We charge a
+ * random page fetch for the leaf page reached by each descent, plus the CPU
+ * cost of the descent, estimated as btcostestimate does.  Since the tuples
+ * fetched are no longer adjacent, a plain index scan must also be assumed
+ * to fetch a different heap page for each group.
+ */
+void
+cost_loose_index_scan(IndexPath *path, PlannerInfo *root, double numGroups)
+{
+	IndexOptInfo *index = path->indexinfo;
+	RelOptInfo *baserel = index->rel;
+	double		spc_random_page_cost;
+	double		heap_pages;
+	Cost		descent_cost;
+	Cost		per_tuple_cost;
+	Cost		run_cost;
+
+	get_tablespace_page_costs(index->reltablespace,
+							  &spc_random_page_cost, NULL);
+
+	numGroups = clamp_row_est(Min(numGroups, path->path.rows));
+
+	descent_cost = spc_random_page_cost;
+	if (index->tuples > 1)
+		descent_cost += ceil(log(index->tuples) / log(2.0)) * cpu_operator_cost;
+	descent_cost += (Max(index->tree_height, 0) + 1) * 50.0 * cpu_operator_cost;
+
+	per_tuple_cost = (path->path.total_cost - path->path.startup_cost) /
+		path->path.rows;
+
+	run_cost = numGroups * (descent_cost + per_tuple_cost);
+
+	get_tablespace_page_costs(baserel->reltablespace,
+							  &spc_random_page_cost, NULL);
+	heap_pages = Min(numGroups, baserel->pages);
+	if (path->path.pathtype == T_IndexOnlyScan)
+		heap_pages *= 1.0 - baserel->allvisfrac;
+	run_cost += heap_pages * spc_random_page_cost;
+
+	path->path.rows = numGroups;
+	path->path.total_cost = path->path.startup_cost + run_cost;
+}
+
 /*
  * extract_nonindex_conditions
  *
@@ -1727,6 +1780,27 @@ cost_ctescan(Path *path, PlannerInfo *root,
 	startup_cost += path->pathtarget->cost.startup;
 	run_cost += path->pathtarget->cost.per_tuple * path->rows;
 
+	/* Adjust costing for parallelism, if used. */
+	if (path->parallel_workers > 0)
+	{
+		double		parallel_divisor = get_parallel_divisor(path);
+
+		/*
+		 * The leader has to copy the whole CTE into the shared tuplestore
+		 * before anyone can start reading it, and that isn't divided.
+		 */
+		startup_cost += cpu_tuple_cost * baserel->tuples;
+
+		/* The CPU cost of the scan itself is divided among all the workers */
+		run_cost /= parallel_divisor;
+
+		/*
+		 * In the case of a parallel plan, the row count needs to represent
+		 * the number of tuples processed per worker.
+		 */
+		path->rows = clamp_row_est(path->rows / parallel_divisor);
+	}
+
 	path->disabled_nodes = 0;
 	path->startup_cost = startup_cost;
 	path->total_cost = startup_cost + run_cost;
@@ -6495,7 +6569,7 @@ page_size(double tuples, int width)
  * Estimate the fraction of the work that each worker will do given the
  * number of workers budgeted for the path.
  */
-static double
+double
 get_parallel_divisor(Path *path)
 {
 	double		parallel_divisor = path->parallel_workers;
@@ -18,8 +18,10 @@
 
 #include <math.h>
 
+#include "access/htup_details.h"
 #include "access/sysattr.h"
 #include "catalog/pg_class.h"
+#include "executor/nodeHash.h"
 #include "foreign/fdwapi.h"
 #include "miscadmin.h"
 #include "nodes/extensible.h"
@@ -72,6 +74,14 @@
 #define CP_LABEL_TLIST		0x0004	/* tlist must contain sortgrouprefs */
 #define CP_IGNORE_TLIST		0x0008	/* caller will replace tlist */
 
+/*
+ * An adaptive nestloop switches to hashing once its outer side has returned
+ * this many times the estimated number of rows, but never before
+ * ADAPTIVE_NESTLOOP_MIN_ROWS rows.
+ */
+#define ADAPTIVE_NESTLOOP_FACTOR	10.0
+#define ADAPTIVE_NESTLOOP_MIN_ROWS	1000.0
+
 
 static Plan *create_plan_recurse(PlannerInfo *root, Path *best_path,
 								 int flags);
@@ -90,6 +100,7 @@ static Plan *create_merge_append_plan(PlannerInfo *root, MergeAppendPath *best_p
 									  int flags);
 static Result *create_group_result_plan(PlannerInfo *root,
 										GroupResultPath *best_path);
+static Result *create_filter_plan(PlannerInfo *root, FilterPath *best_path);
 static ProjectSet *create_project_set_plan(PlannerInfo *root, ProjectSetPath *best_path);
 static Material *create_material_plan(PlannerInfo *root, MaterialPath *best_path,
 									  int flags);
@@ -172,6 +183,8 @@ static Node *fix_indexqual_clause(PlannerInfo *root,
 								  Node *clause, List *indexcolnos);
 static Node *fix_indexqual_operand(Node *node, IndexOptInfo *index, int indexcol);
 static List *get_switched_clauses(List *clauses, Relids outerrelids);
+static List *get_adaptive_hash_clauses(NestPath *best_path,
+									   List *joinrestrictclauses);
 static List *order_qual_clauses(PlannerInfo *root, List *clauses);
 static void copy_generic_path_info(Plan *dest, Path *src);
 static void copy_plan_costsize(Plan *dest, Plan *src);
@@ -448,6 +461,11 @@ create_plan_recurse(PlannerInfo *root, Path *best_path, int flags)
 				plan = (Plan *) create_group_result_plan(root,
 														 (GroupResultPath *) best_path);
 			}
+			else if (IsA(best_path, FilterPath))
+			{
+				plan = (Plan *) create_filter_plan(root,
+												   (FilterPath *) best_path);
+			}
 			else
 			{
 				/* Simple RTE_RESULT base relation */
@@ -1646,6 +1664,40 @@ create_group_result_plan(PlannerInfo *root, GroupResultPath *best_path)
 	return plan;
 }
 
+/*
+ * create_filter_plan
+ *	  Create a Result plan for 'best_path' that filters its subplan's
+ *	  output.
+ *
+ *	  Returns a Plan node.
+ */
+static Result *
+create_filter_plan(PlannerInfo *root, FilterPath *best_path)
+{
+	Result	   *plan;
+	Plan	   *subplan;
+	List	   *tlist;
+	List	   *quals;
+
+	/*
+	 * The quals are expressed in terms of the subpath's target, so make sure
+	 * the subplan computes exactly that.
+	 */
+	subplan = create_plan_recurse(root, best_path->subpath, CP_EXACT_TLIST);
+
+	tlist = build_path_tlist(root, &best_path->path);
+
+	/* best_path->quals is just bare clauses */
+	quals = order_qual_clauses(root, best_path->quals);
+
+	plan = make_gating_result(tlist, NULL, subplan);
+	plan->plan.qual = quals;
+
+	copy_generic_path_info(&plan->plan, (Path *) best_path);
+
+	return plan;
+}
+
 /*
  * create_project_set_plan
  *	  Create a ProjectSet plan for 'best_path'.
@@ -1838,6 +1890,15 @@ create_gather_merge_plan(PlannerInfo *root, GatherMergePath *best_path)
 	 */
 	Assert(pathkeys_contained_in(pathkeys, best_path->subpath->pathkeys));
 
+	/*
+	 * If the input is sorted just for us, let the workers sort into a shared
+	 * sort whose runs the leader's Sort merges directly, rather than passing
+	 * their sorted tuples to us.  A parallel sort can't be bounded, so don't
+	 * do this if a LIMIT would be passed down.
+	 */
+	if (enable_parallel_sort && IsA(subplan, Sort) && root->limit_tuples < 0)
+		subplan->parallel_aware = true;
+
 	/* Now insert the subplan under GatherMerge. */
 	gm_plan->plan.lefttree = subplan;
 
@@ -2330,7 +2391,7 @@ create_groupingsets_plan(PlannerInfo *root, GroupingSetsPath *best_path)
 			agg_plan = (Plan *) make_agg(NIL,
 										 NIL,
 										 strat,
-										 AGGSPLIT_SIMPLE,
+										 best_path->aggsplit,
 										 list_length((List *) linitial(rollup->gsets)),
 										 new_grpColIdx,
 										 extract_grouping_ops(rollup->groupClause),
@@ -2369,7 +2430,7 @@ create_groupingsets_plan(PlannerInfo *root, GroupingSetsPath *best_path)
 		plan = make_agg(build_path_tlist(root, &best_path->path),
 						best_path->qual,
 						best_path->aggstrategy,
-						AGGSPLIT_SIMPLE,
+						best_path->aggsplit,
 						numGroupCols,
 						top_grpColIdx,
 						extract_grouping_ops(rollup->groupClause),
@@ -2433,6 +2494,31 @@ create_minmaxagg_plan(PlannerInfo *root, MinMaxAggPath *best_path)
 
 		/* Convert the plan into an InitPlan in the outer query. */
 		SS_make_initplan_from_plan(root, subroot, plan, mminfo->param);
+
+		/* Likewise for the fallback subquery, if any */
+		if (mminfo->fbpath)
+		{
+			subroot = mminfo->fbsubroot;
+			subparse = subroot->parse;
+
+			plan = create_plan(subroot, mminfo->fbpath);
+
+			plan = (Plan *) make_limit(plan,
+									   subparse->limitOffset,
+									   subparse->limitCount,
+									   subparse->limitOption,
+									   0, NULL, NULL, NULL);
+
+			plan->disabled_nodes = mminfo->fbpath->disabled_nodes;
+			plan->startup_cost = mminfo->fbpath->startup_cost;
+			plan->total_cost = mminfo->fbpath->total_cost;
+			plan->plan_rows = 1;
+			plan->plan_width = mminfo->fbpath->pathtarget->width;
+			plan->parallel_aware = false;
+			plan->parallel_safe = mminfo->fbpath->parallel_safe;
+
+			SS_make_initplan_from_plan(root, subroot, plan, mminfo->fbparam);
+		}
 	}
 
 	/* Generate the output plan --- basically just a Result */
@@ -3024,6 +3110,21 @@ create_indexscan_plan(PlannerInfo *root,
 											indexorderbyops,
 											best_path->indexscandir);
 
+	/*
+	 * A loose index scan returns only the first index entry for each
+	 * distinct value, which is only right if every entry it visits is
+	 * returned.  The planner checks for that, but if some qual that we
+	 * couldn't drop still turned up here, fall back to a full scan, which
+	 * gives the same answer once the parent has removed the duplicates.
+	 */
+	if (best_path->indexskipdistinct && qpqual == NIL)
+	{
+		if (indexonly)
+			((IndexOnlyScan *) scan_plan)->indexskipdistinct = true;
+		else
+			((IndexScan *) scan_plan)->indexskipdistinct = true;
+	}
+
 	copy_generic_path_info(&scan_plan->plan, &best_path->path);
 
 	return scan_plan;
@@ -4330,9 +4431,74 @@ create_nestloop_plan(PlannerInfo *root,
 
 	copy_generic_path_info(&join_plan->join.plan, &best_path->jpath.path);
 
+	/*
+	 * If the inner side doesn't depend on the current outer row, let the
+	 * executor fall back to hashing the inner side in case the outer side
+	 * turns out to return far more rows than estimated.
+	 */
+	if (enable_adaptive_join && nestParams == NIL)
+	{
+		join_plan->adaptiveHashClauses =
+			get_adaptive_hash_clauses(best_path, joinrestrictclauses);
+		if (join_plan->adaptiveHashClauses != NIL)
+			join_plan->adaptiveSwitchRows =
+				Max(ceil(best_path->jpath.outerjoinpath->rows *
+						 ADAPTIVE_NESTLOOP_FACTOR),
+					ADAPTIVE_NESTLOOP_MIN_ROWS);
+	}
+
 	return join_plan;
 }
 
+/*
+ * get_adaptive_hash_clauses
+ *	  Pick out the join clauses an adaptive nestloop could hash on, commuted
+ *	  so that the outer side is on the left, or return NIL if the nestloop
+ *	  should not be adaptive.
+ */
+static List *
+get_adaptive_hash_clauses(NestPath *best_path, List *joinrestrictclauses)
+{
+	Path	   *outer_path = best_path->jpath.outerjoinpath;
+	Path	   *inner_path = best_path->jpath.innerjoinpath;
+	Relids		joinrelids = best_path->jpath.path.parent->relids;
+	List	   *hashclauses = NIL;
+	double		inner_bytes;
+	ListCell   *lc;
+
+	/* Don't bother if the inner side is unlikely to fit in memory anyway */
+	inner_bytes = inner_path->rows *
+		(MAXALIGN(inner_path->pathtarget->width) +
+		 MAXALIGN(SizeofMinimalTupleHeader));
+	if (inner_bytes > get_hash_memory_limit())
+		return NIL;
+
+	foreach(lc, joinrestrictclauses)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+		/*
+		 * Only clauses belonging to the joinqual may be used to filter inner
+		 * rows; pushed-down quals of an outer join don't decide whether the
+		 * outer row has a match.
+		 */
+		if (IS_OUTER_JOIN(best_path->jpath.jointype) &&
+			RINFO_IS_PUSHED_DOWN(rinfo, joinrelids))
+			continue;
+
+		if (rinfo->pseudoconstant || !OidIsValid(rinfo->hashjoinoperator))
+			continue;
+
+		if (!clause_sides_match_join(rinfo, outer_path->parent->relids,
+									 inner_path->parent->relids))
+			continue;
+
+		hashclauses = lappend(hashclauses, rinfo);
+	}
+
+	return get_switched_clauses(hashclauses, outer_path->parent->relids);
+}
+
 static MergeJoin *
 create_mergejoin_plan(PlannerInfo *root,
 					  MergePath *best_path)
@@ -7206,6 +7372,31 @@ make_modifytable(PlannerInfo *root, Plan *subplan,
 	node->fdwPrivLists = fdw_private_list;
 	node->fdwDirectModifyPlans = direct_modify_plans;
 
+	/*
+	 * An UPDATE may put off inserting the index entries of new row versions
+	 * and insert them in batches, provided nothing evaluated during the
+	 * statement can look for those rows through an index.  Only volatile
+	 * functions get to see the statement's own changes, and they may be
+	 * anywhere in the statement, so look at the whole top-level query, not
+	 * just the part being planned here.  Other data-modifying CTEs could
+	 * probe the table's indexes as well (think ON CONFLICT), so don't batch
+	 * if there are any.  RETURNING is excluded as well, so that the
+	 * statement is always run to completion before anything else happens.
+	 */
+	if (operation == CMD_UPDATE && returningLists == NIL)
+	{
+		PlannerInfo *toproot = root;
+
+		while (toproot->parent_root != NULL)
+			toproot = toproot->parent_root;
+
+		node->batchIndexInserts =
+			!toproot->parse->hasModifyingCTE &&
+			!contain_volatile_functions((Node *) toproot->parse);
+	}
+	else
+		node->batchIndexInserts = false;
+
 	return node;
 }
 
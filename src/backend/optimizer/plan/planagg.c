@@ -16,6 +16,15 @@
  * non-optimizable aggregates, there's no point since we'll have to
  * scan all the rows anyway.
  *
+ * If there's no index that can deliver the rows in order, but there's a BRIN
+ * minmax index on the column, we use its summaries to guess a value that's
+ * no smaller than the MIN (for MAX, no larger), and add "col <= value" to
+ * the subquery's quals, so that the BRIN index can skip all the page ranges
+ * that can't hold the answer.  The rows that remain are sorted explicitly.
+ * Since summaries aren't narrowed when rows are deleted, the guess can be
+ * wrong, so this is backed by a second subquery without the extra qual,
+ * which is only executed if the first one comes up empty.
+ *
  *
  * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -28,8 +37,12 @@
  */
 #include "postgres.h"
 
+#include "access/brin.h"
 #include "access/htup_details.h"
+#include "access/stratnum.h"
+#include "access/table.h"
 #include "catalog/pg_aggregate.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_type.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
@@ -45,14 +58,26 @@
 #include "parser/parsetree.h"
 #include "rewrite/rewriteManip.h"
 #include "utils/lsyscache.h"
+#include "utils/rel.h"
 #include "utils/syscache.h"
 
 static bool can_minmax_aggs(PlannerInfo *root, List **context);
 static bool build_minmax_path(PlannerInfo *root, MinMaxAggInfo *mminfo,
 							  Oid eqop, Oid sortop, bool reverse_sort,
 							  bool nulls_first);
+static bool build_minmax_brin_path(PlannerInfo *root, MinMaxAggInfo *mminfo,
+								   Oid eqop, Oid sortop, bool reverse_sort);
+static PlannerInfo *make_minmax_subroot(PlannerInfo *root,
+										MinMaxAggInfo *mminfo,
+										Oid eqop, Oid sortop,
+										bool reverse_sort, bool nulls_first,
+										Expr *extraqual,
+										RelOptInfo **final_rel);
+static Path *make_minmax_sorted_path(PlannerInfo *subroot,
+									 RelOptInfo *final_rel, Cost *path_cost);
+static Expr *make_minmax_brin_qual(PlannerInfo *root, MinMaxAggInfo *mminfo,
+								   Oid sortop);
 static void minmax_qp_callback(PlannerInfo *root, void *extra);
-static Oid	fetch_agg_sort_op(Oid aggfnoid);
 
 
 /*
@@ -179,6 +204,10 @@ preprocess_minmax_aggregates(PlannerInfo *root)
 		if (build_minmax_path(root, mminfo, eqop, mminfo->aggsortop, reverse, !reverse))
 			continue;
 
+		/* Failing that, try to narrow down the rows to sort using BRIN */
+		if (build_minmax_brin_path(root, mminfo, eqop, mminfo->aggsortop, reverse))
+			continue;
+
 		/* No indexable path for this aggregate, so fail */
 		return;
 	}
@@ -201,6 +230,12 @@ preprocess_minmax_aggregates(PlannerInfo *root)
 										  exprType((Node *) mminfo->target),
 										  -1,
 										  exprCollation((Node *) mminfo->target));
+		if (mminfo->fbpath)
+			mminfo->fbparam =
+				SS_make_initplan_output_param(root,
+											  exprType((Node *) mminfo->target),
+											  -1,
+											  exprCollation((Node *) mminfo->target));
 	}
 
 	/*
@@ -300,6 +335,9 @@ can_minmax_aggs(PlannerInfo *root, List **context)
 		mminfo->path = NULL;
 		mminfo->pathcost = 0;
 		mminfo->param = NULL;
+		mminfo->fbsubroot = NULL;
+		mminfo->fbpath = NULL;
+		mminfo->fbparam = NULL;
 
 		*context = lappend(*context, mminfo);
 	}
@@ -317,6 +355,131 @@ can_minmax_aggs(PlannerInfo *root, List **context)
 static bool
 build_minmax_path(PlannerInfo *root, MinMaxAggInfo *mminfo,
 				  Oid eqop, Oid sortop, bool reverse_sort, bool nulls_first)
+{
+	PlannerInfo *subroot;
+	RelOptInfo *final_rel;
+	Path	   *sorted_path;
+	Cost		path_cost;
+	double		path_fraction;
+
+	subroot = make_minmax_subroot(root, mminfo, eqop, sortop,
+								  reverse_sort, nulls_first, NULL,
+								  &final_rel);
+
+	/*
+	 * Get the best presorted path, that being the one that's cheapest for
+	 * fetching just one row.  If there's no such path, fail.
+	 */
+	if (final_rel->rows > 1.0)
+		path_fraction = 1.0 / final_rel->rows;
+	else
+		path_fraction = 1.0;
+
+	sorted_path =
+		get_cheapest_fractional_path_for_pathkeys(final_rel->pathlist,
+												  subroot->query_pathkeys,
+												  NULL,
+												  path_fraction);
+	if (!sorted_path)
+		return false;
+
+	/*
+	 * The path might not return exactly what we want, so fix that.  (We
+	 * assume that this won't change any conclusions about which was the
+	 * cheapest path.)
+	 */
+	sorted_path = apply_projection_to_path(subroot, final_rel, sorted_path,
+										   create_pathtarget(subroot,
+															 subroot->processed_tlist));
+
+	/*
+	 * Determine cost to get just the first row of the presorted path.
+	 *
+	 * Note: cost calculation here should match
+	 * compare_fractional_path_costs().
+	 */
+	path_cost = sorted_path->startup_cost +
+		path_fraction * (sorted_path->total_cost - sorted_path->startup_cost);
+
+	/* Save state for further processing */
+	mminfo->subroot = subroot;
+	mminfo->path = sorted_path;
+	mminfo->pathcost = path_cost;
+
+	return true;
+}
+
+/*
+ * build_minmax_brin_path
+ *		Given a MIN/MAX aggregate, try to build a Path that sorts just the
+ *		rows that a BRIN minmax index says could hold the answer.
+ *
+ * If successful, stash the path in *mminfo, along with the path for the
+ * unrestricted fallback subquery, and return true.  Otherwise, return false.
+ */
+static bool
+build_minmax_brin_path(PlannerInfo *root, MinMaxAggInfo *mminfo,
+					   Oid eqop, Oid sortop, bool reverse_sort)
+{
+	Expr	   *boundqual;
+	PlannerInfo *subroot;
+	PlannerInfo *fbsubroot;
+	RelOptInfo *final_rel;
+	Cost		path_cost;
+	Cost		fbpath_cost;
+
+	boundqual = make_minmax_brin_qual(root, mminfo, sortop);
+	if (boundqual == NULL)
+		return false;
+
+	/*
+	 * Ordering is provided by an explicit sort, so the placement of nulls
+	 * doesn't matter; there are none anyway.
+	 */
+	subroot = make_minmax_subroot(root, mminfo, eqop, sortop,
+								  reverse_sort, reverse_sort, boundqual,
+								  &final_rel);
+	mminfo->path = make_minmax_sorted_path(subroot, final_rel, &path_cost);
+	mminfo->subroot = subroot;
+	mminfo->pathcost = path_cost;
+
+	fbsubroot = make_minmax_subroot(root, mminfo, eqop, sortop,
+									reverse_sort, reverse_sort, NULL,
+									&final_rel);
+	mminfo->fbpath = make_minmax_sorted_path(fbsubroot, final_rel,
+											 &fbpath_cost);
+	mminfo->fbsubroot = fbsubroot;
+
+	/*
+	 * We don't charge for the fallback subquery, as it's only needed if the
+	 * summaries are badly out of date.  But if the bound doesn't make the
+	 * subquery any cheaper, it's pointless.
+	 */
+	if (path_cost >= fbpath_cost)
+	{
+		mminfo->subroot = NULL;
+		mminfo->path = NULL;
+		mminfo->pathcost = 0;
+		mminfo->fbsubroot = NULL;
+		mminfo->fbpath = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * make_minmax_subroot
+ *		Plan the subquery that computes a MIN/MAX aggregate, with an
+ *		additional qual if 'extraqual' isn't NULL.
+ *
+ * Returns the subquery's PlannerInfo, and its final RelOptInfo into
+ * *final_rel.
+ */
+static PlannerInfo *
+make_minmax_subroot(PlannerInfo *root, MinMaxAggInfo *mminfo,
+					Oid eqop, Oid sortop, bool reverse_sort, bool nulls_first,
+					Expr *extraqual, RelOptInfo **final_rel)
 {
 	PlannerInfo *subroot;
 	Query	   *parse;
@@ -324,10 +487,6 @@ build_minmax_path(PlannerInfo *root, MinMaxAggInfo *mminfo,
 	List	   *tlist;
 	NullTest   *ntest;
 	SortGroupClause *sortcl;
-	RelOptInfo *final_rel;
-	Path	   *sorted_path;
-	Cost		path_cost;
-	double		path_fraction;
 
 	/*
 	 * We are going to construct what is effectively a sub-SELECT query, so
@@ -398,6 +557,10 @@ build_minmax_path(PlannerInfo *root, MinMaxAggInfo *mminfo,
 		parse->jointree->quals = (Node *)
 			lcons(ntest, (List *) parse->jointree->quals);
 
+	if (extraqual)
+		parse->jointree->quals = (Node *)
+			lappend((List *) parse->jointree->quals, extraqual);
+
 	/* Build suitable ORDER BY clause */
 	sortcl = makeNode(SortGroupClause);
 	sortcl->tleSortGroupRef = assignSortGroupRef(tle, subroot->processed_tlist);
@@ -422,7 +585,7 @@ build_minmax_path(PlannerInfo *root, MinMaxAggInfo *mminfo,
 	subroot->tuple_fraction = 1.0;
 	subroot->limit_tuples = 1.0;
 
-	final_rel = query_planner(subroot, minmax_qp_callback, NULL);
+	*final_rel = query_planner(subroot, minmax_qp_callback, NULL);
 
 	/*
 	 * Since we didn't go through subquery_planner() to handle the subquery,
@@ -431,49 +594,147 @@ build_minmax_path(PlannerInfo *root, MinMaxAggInfo *mminfo,
 	 * matter if we end up not using the subplan.)
 	 */
 	SS_identify_outer_params(subroot);
-	SS_charge_for_initplans(subroot, final_rel);
+	SS_charge_for_initplans(subroot, *final_rel);
 
-	/*
-	 * Get the best presorted path, that being the one that's cheapest for
-	 * fetching just one row.  If there's no such path, fail.
-	 */
-	if (final_rel->rows > 1.0)
-		path_fraction = 1.0 / final_rel->rows;
-	else
-		path_fraction = 1.0;
+	return subroot;
+}
 
-	sorted_path =
-		get_cheapest_fractional_path_for_pathkeys(final_rel->pathlist,
-												  subroot->query_pathkeys,
-												  NULL,
-												  path_fraction);
-	if (!sorted_path)
-		return false;
+/*
+ * make_minmax_sorted_path
+ *		Build a path that produces the rows of a planned MIN/MAX subquery in
+ *		the requested order, sorting them explicitly if necessary.
+ *
+ * The cost of fetching the first row is returned into *path_cost.
+ */
+static Path *
+make_minmax_sorted_path(PlannerInfo *subroot, RelOptInfo *final_rel,
+						Cost *path_cost)
+{
+	Path	   *path = final_rel->cheapest_total_path;
 
-	/*
-	 * The path might not return exactly what we want, so fix that.  (We
-	 * assume that this won't change any conclusions about which was the
-	 * cheapest path.)
-	 */
-	sorted_path = apply_projection_to_path(subroot, final_rel, sorted_path,
-										   create_pathtarget(subroot,
-															 subroot->processed_tlist));
+	if (!pathkeys_contained_in(subroot->query_pathkeys, path->pathkeys))
+		path = (Path *) create_sort_path(subroot, final_rel, path,
+										 subroot->query_pathkeys, 1.0);
 
-	/*
-	 * Determine cost to get just the first row of the presorted path.
-	 *
-	 * Note: cost calculation here should match
-	 * compare_fractional_path_costs().
-	 */
-	path_cost = sorted_path->startup_cost +
-		path_fraction * (sorted_path->total_cost - sorted_path->startup_cost);
+	path = apply_projection_to_path(subroot, final_rel, path,
+									create_pathtarget(subroot,
+													  subroot->processed_tlist));
 
-	/* Save state for further processing */
-	mminfo->subroot = subroot;
-	mminfo->path = sorted_path;
-	mminfo->pathcost = path_cost;
+	/* A sort has to read all its input before returning the first row */
+	*path_cost = path->total_cost;
 
-	return true;
+	return path;
+}
+
+/*
+ * make_minmax_brin_qual
+ *		Build a qual "target <= bound" for a MIN aggregate, or
+ *		"target >= bound" for MAX, where bound is obtained from the summaries
+ *		of a BRIN minmax index on the target column.
+ *
+ * Returns NULL if there's no usable index.
+ */
+static Expr *
+make_minmax_brin_qual(PlannerInfo *root, MinMaxAggInfo *mminfo, Oid sortop)
+{
+	Var		   *var = (Var *) mminfo->target;
+	RangeTblEntry *rte;
+	Relation	heapRel;
+	List	   *indexoidlist;
+	ListCell   *lc;
+	Expr	   *result = NULL;
+
+	if (!IsA(var, Var) || var->varlevelsup != 0 || var->varattno <= 0)
+		return NULL;
+
+	rte = planner_rt_fetch(var->varno, root);
+	if (rte->rtekind != RTE_RELATION || rte->inh ||
+		(rte->relkind != RELKIND_RELATION && rte->relkind != RELKIND_MATVIEW))
+		return NULL;
+
+	/* The planner already holds a suitable lock on the relation */
+	heapRel = table_open(rte->relid, NoLock);
+	indexoidlist = RelationGetIndexList(heapRel);
+
+	foreach(lc, indexoidlist)
+	{
+		Oid			indexoid = lfirst_oid(lc);
+		Relation	indexRel;
+		int			strategy;
+		Oid			lefttype;
+		Oid			righttype;
+		Oid			boundop;
+		Datum		bound;
+
+		if (get_rel_relam(indexoid) != BRIN_AM_OID)
+			continue;
+
+		indexRel = index_open(indexoid, AccessShareLock);
+
+		if (!indexRel->rd_index->indisvalid)
+		{
+			index_close(indexRel, AccessShareLock);
+			continue;
+		}
+
+		for (int col = 0; col < IndexRelationGetNumberOfKeyAttributes(indexRel); col++)
+		{
+			Oid			opfamily = indexRel->rd_opfamily[col];
+
+			if (indexRel->rd_index->indkey.values[col] != var->varattno)
+				continue;
+
+			/*
+			 * The aggregate's sort operator must be the opfamily's "<" or
+			 * ">", for the same type as the column.
+			 */
+			if (!op_in_opfamily(sortop, opfamily))
+				continue;
+			get_op_opfamily_properties(sortop, opfamily, false,
+									   &strategy, &lefttype, &righttype);
+			if ((strategy != BTLessStrategyNumber &&
+				 strategy != BTGreaterStrategyNumber) ||
+				lefttype != var->vartype || righttype != var->vartype)
+				continue;
+
+			boundop = get_opfamily_member(opfamily, lefttype, righttype,
+										  strategy == BTLessStrategyNumber ?
+										  BTLessEqualStrategyNumber :
+										  BTGreaterEqualStrategyNumber);
+			if (!OidIsValid(boundop))
+				continue;
+
+			if (brinGetMinMaxBound(heapRel, indexRel, col + 1, sortop,
+								   strategy == BTLessStrategyNumber, &bound))
+			{
+				int16		typlen;
+				bool		typbyval;
+
+				get_typlenbyval(var->vartype, &typlen, &typbyval);
+				result = make_opclause(boundop, BOOLOID, false,
+									   (Expr *) copyObject(var),
+									   (Expr *) makeConst(var->vartype,
+														  var->vartypmod,
+														  var->varcollid,
+														  typlen,
+														  bound,
+														  false,
+														  typbyval),
+									   InvalidOid, var->varcollid);
+				break;
+			}
+		}
+
+		index_close(indexRel, AccessShareLock);
+
+		if (result)
+			break;
+	}
+
+	list_free(indexoidlist);
+	table_close(heapRel, NoLock);
+
+	return result;
 }
 
 /*
@@ -498,7 +759,7 @@ minmax_qp_callback(PlannerInfo *root, void *extra)
  * Get the OID of the sort operator, if any, associated with an aggregate.
  * Returns InvalidOid if there is no such operator.
  */
-static Oid
+Oid
 fetch_agg_sort_op(Oid aggfnoid)
 {
 	HeapTuple	aggTuple;
@@ -23,7 +23,9 @@
 #include "access/sysattr.h"
 #include "access/table.h"
 #include "catalog/pg_aggregate.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_inherits.h"
+#include "catalog/pg_operator.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "executor/executor.h"
@@ -60,6 +62,7 @@
 #include "rewrite/rewriteManip.h"
 #include "utils/acl.h"
 #include "utils/backend_status.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
 #include "utils/selfuncs.h"
@@ -180,7 +183,8 @@ static void consider_groupingsets_paths(PlannerInfo *root,
 										bool can_hash,
 										grouping_sets_data *gd,
 										const AggClauseCosts *agg_costs,
-										double dNumGroups);
+										double dNumGroups,
+										AggSplit aggsplit);
 static RelOptInfo *create_window_paths(PlannerInfo *root,
 									   RelOptInfo *input_rel,
 									   PathTarget *input_target,
@@ -188,13 +192,22 @@ static RelOptInfo *create_window_paths(PlannerInfo *root,
 									   bool output_target_parallel_safe,
 									   WindowFuncLists *wflists,
 									   List *activeWindows);
-static void create_one_window_path(PlannerInfo *root,
-								   RelOptInfo *window_rel,
-								   Path *path,
-								   PathTarget *input_target,
-								   PathTarget *output_target,
-								   WindowFuncLists *wflists,
-								   List *activeWindows);
+static Path *create_one_window_path(PlannerInfo *root,
+									RelOptInfo *window_rel,
+									Path *path,
+									PathTarget *input_target,
+									PathTarget *output_target,
+									WindowFuncLists *wflists,
+									List *activeWindows);
+static void create_partial_window_path(PlannerInfo *root,
+									   RelOptInfo *input_rel,
+									   RelOptInfo *window_rel,
+									   PathTarget *input_target,
+									   PathTarget *output_target,
+									   WindowFuncLists *wflists,
+									   List *activeWindows);
+static Expr *make_window_bucket_qual(Expr *keyexpr, Oid hashfn,
+									 int nbuckets, int bucket);
 static RelOptInfo *create_distinct_paths(PlannerInfo *root,
 										 RelOptInfo *input_rel,
 										 PathTarget *target);
@@ -208,6 +221,12 @@ static RelOptInfo *create_final_distinct_paths(PlannerInfo *root,
 static List *get_useful_pathkeys_for_distinct(PlannerInfo *root,
 											  List *needed_pathkeys,
 											  List *path_pathkeys);
+static Path *make_loose_index_path(PlannerInfo *root, RelOptInfo *input_rel,
+								   Path *path, SortGroupClause *clause,
+								   List *needed_pathkeys, bool check_aggs,
+								   double numGroups);
+static bool loose_index_aggs_ok(PlannerInfo *root, RelOptInfo *rel,
+								IndexOptInfo *index);
 static RelOptInfo *create_ordered_paths(PlannerInfo *root,
 										RelOptInfo *input_rel,
 										PathTarget *target,
@@ -251,6 +270,8 @@ static Path *make_ordered_path(PlannerInfo *root,
 							   Path *cheapest_path,
 							   List *pathkeys,
 							   double limit_tuples);
+static GroupByOrdering *make_partial_groupingsets_ordering(PlannerInfo *root,
+															grouping_sets_data *gd);
 static void gather_grouping_paths(PlannerInfo *root, RelOptInfo *rel);
 static bool can_partial_agg(PlannerInfo *root);
 static void apply_scanjoin_target_to_paths(PlannerInfo *root,
@@ -3682,6 +3703,9 @@ standard_qp_callback(PlannerInfo *root, void *extra)
  * If doing grouping sets, we also annotate the gsets data with the estimates
  * for each set and each individual rollup list, with a view to later
  * determining whether some combination of them could be hashed instead.
+ * If gd is NULL despite grouping sets, we estimate the number of distinct
+ * combinations of all the grouping columns, which is what a partial
+ * aggregation step below the grouping sets step produces.
  */
 static double
 get_number_of_groups(PlannerInfo *root,
@@ -3696,13 +3720,11 @@ get_number_of_groups(PlannerInfo *root,
 	{
 		List	   *groupExprs;
 
-		if (parse->groupingSets)
+		if (parse->groupingSets && gd != NULL)
 		{
 			/* Add up the estimates for each grouping set */
 			ListCell   *lc;
 
-			Assert(gd);			/* keep Coverity happy */
-
 			dNumGroups = 0;
 
 			foreach(lc, gd->rollups)
@@ -3761,7 +3783,10 @@ get_number_of_groups(PlannerInfo *root,
 		}
 		else
 		{
-			/* Plain GROUP BY -- estimate based on optimized groupClause */
+			/*
+			 * Plain GROUP BY, or all the grouping columns together -- estimate
+			 * based on optimized groupClause
+			 */
 			groupExprs = get_sortgrouplist_exprs(root->processed_groupClause,
 												 target_list);
 
@@ -4186,6 +4211,9 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
  * it, by combinations of hashing and sorting.  This can be called multiple
  * times, so it's important that it not scribble on input.  No result is
  * returned, but any generated paths are added to grouped_rel.
+ *
+ * aggsplit is AGGSPLIT_FINAL_DESERIAL if the input path has been partially
+ * aggregated already, else AGGSPLIT_SIMPLE.
  */
 static void
 consider_groupingsets_paths(PlannerInfo *root,
@@ -4195,7 +4223,8 @@ consider_groupingsets_paths(PlannerInfo *root,
 							bool can_hash,
 							grouping_sets_data *gd,
 							const AggClauseCosts *agg_costs,
-							double dNumGroups)
+							double dNumGroups,
+							AggSplit aggsplit)
 {
 	Query	   *parse = root->parse;
 	Size		hash_mem_limit = get_hash_memory_limit();
@@ -4359,6 +4388,7 @@ consider_groupingsets_paths(PlannerInfo *root,
 										  path,
 										  (List *) parse->havingQual,
 										  strat,
+										  aggsplit,
 										  new_rollups,
 										  agg_costs));
 		return;
@@ -4517,6 +4547,7 @@ consider_groupingsets_paths(PlannerInfo *root,
 											  path,
 											  (List *) parse->havingQual,
 											  AGG_MIXED,
+											  aggsplit,
 											  rollups,
 											  agg_costs));
 		}
@@ -4532,6 +4563,7 @@ consider_groupingsets_paths(PlannerInfo *root,
 										  path,
 										  (List *) parse->havingQual,
 										  AGG_SORTED,
+										  aggsplit,
 										  gd->rollups,
 										  agg_costs));
 }
@@ -4595,15 +4627,25 @@ create_window_paths(PlannerInfo *root,
 			pathkeys_count_contained_in(root->window_pathkeys, path->pathkeys,
 										&presorted_keys) ||
 			presorted_keys > 0)
-			create_one_window_path(root,
-								   window_rel,
-								   path,
-								   input_target,
-								   output_target,
-								   wflists,
-								   activeWindows);
+			add_path(window_rel,
+					 create_one_window_path(root,
+											window_rel,
+											path,
+											input_target,
+											output_target,
+											wflists,
+											activeWindows));
 	}
 
+	/*
+	 * Consider splitting the window partitions between parallel workers, and
+	 * if we succeed, add Gather paths for that.
+	 */
+	create_partial_window_path(root, input_rel, window_rel, input_target,
+							   output_target, wflists, activeWindows);
+	if (window_rel->partial_pathlist != NIL)
+		generate_useful_gather_paths(root, window_rel, false);
+
 	/*
 	 * If there is an FDW that's responsible for all baserels of the query,
 	 * let it consider adding ForeignPaths.
@@ -4627,7 +4669,7 @@ create_window_paths(PlannerInfo *root,
 
 /*
  * Stack window-function implementation steps atop the given Path, and
- * add the result to window_rel.
+ * return the result, which belongs to window_rel.
  *
  * window_rel: upperrel to contain result
  * path: input Path to use (must return input_target)
@@ -4636,7 +4678,7 @@ create_window_paths(PlannerInfo *root,
  * wflists: result of find_window_functions
  * activeWindows: result of select_active_windows
  */
-static void
+static Path *
 create_one_window_path(PlannerInfo *root,
 					   RelOptInfo *window_rel,
 					   Path *path,
@@ -4792,7 +4834,183 @@ create_one_window_path(PlannerInfo *root,
 								  topwindow ? topqual : NIL, topwindow);
 	}
 
-	add_path(window_rel, path);
+	return path;
+}
+
+/*
+ * create_partial_window_path
+ *
+ * Window functions can be computed in parallel if each participant sees all
+ * the rows of the window partitions it's responsible for.  We get that by
+ * splitting the rows into buckets by the hash of a key that's part of every
+ * active window's PARTITION BY clause, and building a Parallel Append with
+ * one non-partial child per bucket.  Each child reads the entire input,
+ * keeps only the rows of its own bucket, and sorts them and computes the
+ * window functions as usual.  Each bucket is processed by exactly one
+ * participant, so the Parallel Append is a valid partial path of window_rel.
+ *
+ * Reading the input once per bucket is expensive, so we leave it to the
+ * cost comparison to decide whether the cheaper sorts make up for it.
+ */
+static void
+create_partial_window_path(PlannerInfo *root,
+						   RelOptInfo *input_rel,
+						   RelOptInfo *window_rel,
+						   PathTarget *input_target,
+						   PathTarget *output_target,
+						   WindowFuncLists *wflists,
+						   List *activeWindows)
+{
+	Path	   *input_path = input_rel->cheapest_total_path;
+	WindowClause *firstwc = linitial_node(WindowClause, activeWindows);
+	Expr	   *keyexpr = NULL;
+	Oid			hashfn = InvalidOid;
+	int			nworkers = max_parallel_workers_per_gather;
+	int			nbuckets;
+	List	   *subpaths = NIL;
+	AppendPath *appendpath;
+	ListCell   *lc;
+
+	if (!enable_parallel_window || !window_rel->consider_parallel ||
+		nworkers <= 0)
+		return;
+
+	/*
+	 * The input must be safe to run in each participant.  It mustn't be
+	 * partial, since each bucket needs to see all the rows.
+	 */
+	if (!input_path->parallel_safe || input_path->param_info != NULL)
+		return;
+
+	/* Find a hashable key shared by every window's PARTITION BY clause */
+	foreach(lc, firstwc->partitionClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		Oid			righthashfn;
+		Expr	   *expr;
+		bool		shared = true;
+		ListCell   *lc2;
+
+		if (!sgc->hashable)
+			continue;
+
+		for_each_from(lc2, activeWindows, 1)
+		{
+			WindowClause *wc = lfirst_node(WindowClause, lc2);
+			ListCell   *lc3;
+			bool		found = false;
+
+			foreach(lc3, wc->partitionClause)
+			{
+				SortGroupClause *sgc2 = lfirst_node(SortGroupClause, lc3);
+
+				if (sgc2->tleSortGroupRef == sgc->tleSortGroupRef)
+				{
+					found = true;
+					break;
+				}
+			}
+			if (!found)
+			{
+				shared = false;
+				break;
+			}
+		}
+		if (!shared)
+			continue;
+
+		expr = (Expr *) get_sortgroupclause_expr(sgc, root->processed_tlist);
+		if (contain_volatile_functions((Node *) expr))
+			continue;
+
+		if (!get_op_hash_functions(sgc->eqop, &hashfn, &righthashfn) ||
+			get_func_rettype(hashfn) != INT4OID)
+			continue;
+
+		keyexpr = expr;
+		break;
+	}
+
+	if (keyexpr == NULL)
+		return;
+
+	/* One bucket for each worker, plus one for the leader */
+	nbuckets = nworkers + 1;
+
+	for (int i = 0; i < nbuckets; i++)
+	{
+		Path	   *path;
+		List	   *quals;
+
+		quals = list_make1(make_window_bucket_qual(keyexpr, hashfn,
+												   nbuckets, i));
+		path = (Path *) create_filter_path(root, window_rel, input_path,
+										   quals,
+										   input_path->rows / nbuckets);
+		if (!path->parallel_safe)
+			return;
+
+		path = create_one_window_path(root, window_rel, path, input_target,
+									  output_target, wflists, activeWindows);
+		subpaths = lappend(subpaths, path);
+	}
+
+	/* The Append, and any Gather above it, return the window output rows */
+	window_rel->reltarget = output_target;
+
+	appendpath = create_append_path(root, window_rel, subpaths, NIL, NIL,
+									NULL, nworkers, true, -1);
+
+	add_partial_path(window_rel, (Path *) appendpath);
+}
+
+/*
+ * make_window_bucket_qual
+ *
+ * Build a qual that is true for the rows whose 'keyexpr' hashes into bucket
+ * number 'bucket' of 'nbuckets'.  Rows with a NULL key go into bucket 0.
+ */
+static Expr *
+make_window_bucket_qual(Expr *keyexpr, Oid hashfn, int nbuckets, int bucket)
+{
+	Expr	   *hashexpr;
+	Expr	   *modexpr;
+	Expr	   *absexpr;
+	CoalesceExpr *coalesce;
+
+	hashexpr = (Expr *) makeFuncExpr(hashfn, INT4OID,
+									 list_make1(copyObject(keyexpr)),
+									 InvalidOid, exprCollation((Node *) keyexpr),
+									 COERCE_EXPLICIT_CALL);
+	modexpr = (Expr *) makeFuncExpr(F_INT4MOD, INT4OID,
+									list_make2(hashexpr,
+											   makeConst(INT4OID, -1, InvalidOid,
+														 sizeof(int32),
+														 Int32GetDatum(nbuckets),
+														 false, true)),
+									InvalidOid, InvalidOid,
+									COERCE_EXPLICIT_CALL);
+	absexpr = (Expr *) makeFuncExpr(F_INT4ABS, INT4OID,
+									list_make1(modexpr),
+									InvalidOid, InvalidOid,
+									COERCE_EXPLICIT_CALL);
+
+	coalesce = makeNode(CoalesceExpr);
+	coalesce->coalescetype = INT4OID;
+	coalesce->coalescecollid = InvalidOid;
+	coalesce->args = list_make2(absexpr,
+								makeConst(INT4OID, -1, InvalidOid,
+										  sizeof(int32), Int32GetDatum(0),
+										  false, true));
+	coalesce->location = -1;
+
+	return make_opclause(Int4EqualOperator, BOOLOID, false,
+						 (Expr *) coalesce,
+						 (Expr *) makeConst(INT4OID, -1, InvalidOid,
+											sizeof(int32),
+											Int32GetDatum(bucket),
+											false, true),
+						 InvalidOid, InvalidOid);
 }
 
 /*
@@ -5191,6 +5409,39 @@ create_final_distinct_paths(PlannerInfo *root, RelOptInfo *input_rel,
 				}
 			}
 		}
+
+		/*
+		 * With DISTINCT on the leading column of an index, we can also
+		 * consider a loose index scan, which descends the index once per
+		 * distinct value instead of reading all the duplicates.  We still
+		 * put a Unique node on top, in case createplan.c has to fall back
+		 * to a full scan.
+		 */
+		if (enable_looseindexscan &&
+			list_length(root->processed_distinctClause) == 1 &&
+			list_length(root->distinct_pathkeys) == 1)
+		{
+			SortGroupClause *clause;
+
+			clause = linitial_node(SortGroupClause,
+								   root->processed_distinctClause);
+			foreach(lc, input_rel->pathlist)
+			{
+				Path	   *loose_path;
+
+				loose_path = make_loose_index_path(root, input_rel,
+												   (Path *) lfirst(lc),
+												   clause, needed_pathkeys,
+												   false, numDistinctRows);
+				if (loose_path == NULL)
+					continue;
+
+				add_path(distinct_rel, (Path *)
+						 create_unique_path(root, distinct_rel,
+											loose_path, 1,
+											numDistinctRows));
+			}
+		}
 	}
 
 	/*
@@ -5307,6 +5558,149 @@ get_useful_pathkeys_for_distinct(PlannerInfo *root, List *needed_pathkeys,
 	return useful_pathkeys_list;
 }
 
+/*
+ * make_loose_index_path
+ *	  Try to make a loose index scan out of 'path', for a DISTINCT or GROUP BY
+ *	  whose only grouping clause is 'clause'.
+ *
+ * A loose index scan returns only the first row it finds for each distinct
+ * value of the leading index column, so it can stand in for the full scan
+ * under a Unique or Agg node if the grouping expression is that column and
+ * every row the index returns is one we want, ie, the scan has no filter
+ * conditions.  'path' must be an unparameterized forward scan sorted by
+ * 'needed_pathkeys', possibly under a projection.  If 'check_aggs' is true,
+ * the query's aggregates must also be computable from the first row of each
+ * group; see loose_index_aggs_ok().  Returns NULL if any of this fails.
+ */
+static Path *
+make_loose_index_path(PlannerInfo *root, RelOptInfo *input_rel, Path *path,
+					  SortGroupClause *clause, List *needed_pathkeys,
+					  bool check_aggs, double numGroups)
+{
+	ProjectionPath *proj = NULL;
+	IndexPath  *ipath;
+	IndexPath  *loose;
+	IndexOptInfo *index;
+	Var		   *var;
+	ListCell   *lc;
+
+	if (input_rel->reloptkind != RELOPT_BASEREL)
+		return NULL;
+
+	if (IsA(path, ProjectionPath))
+	{
+		proj = (ProjectionPath *) path;
+		path = proj->subpath;
+	}
+	if (!IsA(path, IndexPath))
+		return NULL;
+	ipath = (IndexPath *) path;
+	index = ipath->indexinfo;
+
+	if (index->relam != BTREE_AM_OID ||
+		index->indexkeys[0] == 0 ||
+		ipath->indexscandir != ForwardScanDirection ||
+		ipath->indexorderbys != NIL ||
+		ipath->path.param_info != NULL ||
+		ipath->path.parallel_aware ||
+		!pathkeys_contained_in(needed_pathkeys, ipath->path.pathkeys))
+		return NULL;
+
+	/* The grouping expression must be the leading index column */
+	var = (Var *) get_sortgroupclause_expr(clause, root->processed_tlist);
+	if (!IsA(var, Var) ||
+		var->varno != input_rel->relid ||
+		var->varattno != index->indexkeys[0] ||
+		var->varlevelsup != 0 ||
+		var->varcollid != index->indexcollations[0] ||
+		!op_in_opfamily(clause->eqop, index->opfamily[0]))
+		return NULL;
+
+	/* Any condition the index doesn't enforce would need a filter */
+	foreach(lc, index->indrestrictinfo)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+		if (!rinfo->pseudoconstant &&
+			!is_redundant_with_indexclauses(rinfo, ipath->indexclauses))
+			return NULL;
+	}
+
+	if (check_aggs && !loose_index_aggs_ok(root, input_rel, index))
+		return NULL;
+
+	loose = makeNode(IndexPath);
+	memcpy(loose, ipath, sizeof(IndexPath));
+	loose->indexskipdistinct = true;
+	cost_loose_index_scan(loose, root, numGroups);
+
+	if (proj)
+		return (Path *) create_projection_path(root, proj->path.parent,
+											   (Path *) loose,
+											   proj->path.pathtarget);
+	return (Path *) loose;
+}
+
+/*
+ * loose_index_aggs_ok
+ *	  Can the query's aggregates be computed from just the first row of each
+ *	  group returned by a loose scan on 'index'?
+ *
+ * That's so for aggregates that have a sort operator, like min() and max(),
+ * when their argument is the second index column and the index sorts that
+ * column by the same operator with nulls last.  The first row of each group
+ * then holds the aggregate's result, or a null if all the group's values
+ * are null, in which case the result is null too.
+ */
+static bool
+loose_index_aggs_ok(PlannerInfo *root, RelOptInfo *rel, IndexOptInfo *index)
+{
+	ListCell   *lc;
+
+	if (index->nkeycolumns < 2 ||
+		index->indexkeys[1] == 0 ||
+		index->nulls_first[1])
+		return false;
+
+	foreach(lc, root->agginfos)
+	{
+		AggInfo    *agginfo = lfirst_node(AggInfo, lc);
+		Aggref	   *aggref = linitial_node(Aggref, agginfo->aggrefs);
+		Var		   *var;
+		Oid			aggsortop;
+		Oid			indexsortop;
+
+		if (aggref->aggkind != AGGKIND_NORMAL ||
+			list_length(aggref->args) != 1 ||
+			aggref->aggorder != NIL ||
+			aggref->aggdistinct != NIL ||
+			aggref->aggfilter != NULL)
+			return false;
+
+		var = (Var *) linitial_node(TargetEntry, aggref->args)->expr;
+		if (!IsA(var, Var) ||
+			var->varno != rel->relid ||
+			var->varattno != index->indexkeys[1] ||
+			var->varlevelsup != 0 ||
+			aggref->inputcollid != index->indexcollations[1])
+			return false;
+
+		aggsortop = fetch_agg_sort_op(aggref->aggfnoid);
+		if (!OidIsValid(aggsortop))
+			return false;
+		indexsortop = get_opfamily_member(index->sortopfamily[1],
+										  index->opcintype[1],
+										  index->opcintype[1],
+										  index->reverse_sort[1] ?
+										  BTGreaterStrategyNumber :
+										  BTLessStrategyNumber);
+		if (aggsortop != indexsortop)
+			return false;
+	}
+
+	return true;
+}
+
 /*
  * create_ordered_paths
  *
@@ -5653,6 +6047,10 @@ make_group_input_target(PlannerInfo *root, PathTarget *final_target)
  * used outside of Aggrefs in the aggregation tlist and HAVING.  (Presumably,
  * these would be Vars that are grouped by or used in grouping expressions.)
  *
+ * With grouping sets, the partial step runs below the grouping step, so we
+ * must also remove the grouping step's RT index from the expressions, as
+ * make_group_input_target does.  GROUPING() is left for the finalize step.
+ *
  * grouping_target is the tlist to be emitted by the topmost aggregation step.
  * havingQual represents the HAVING clause.
  */
@@ -5661,6 +6059,8 @@ make_partial_grouping_target(PlannerInfo *root,
 							 PathTarget *grouping_target,
 							 Node *havingQual)
 {
+	Query	   *parse = root->parse;
+	bool		strip_group_rtindex;
 	PathTarget *partial_target;
 	List	   *non_group_cols;
 	List	   *non_group_exprs;
@@ -5669,6 +6069,7 @@ make_partial_grouping_target(PlannerInfo *root,
 
 	partial_target = create_empty_pathtarget();
 	non_group_cols = NIL;
+	strip_group_rtindex = (parse->hasGroupRTE && parse->groupingSets != NIL);
 
 	i = 0;
 	foreach(lc, grouping_target->exprs)
@@ -5684,6 +6085,11 @@ make_partial_grouping_target(PlannerInfo *root,
 			 * It's a grouping column, so add it to the partial_target as-is.
 			 * (This allows the upper agg step to repeat the grouping calcs.)
 			 */
+			if (strip_group_rtindex)
+				expr = (Expr *)
+					remove_nulling_relids((Node *) expr,
+										  bms_make_singleton(root->group_rtindex),
+										  NULL);
 			add_column_to_pathtarget(partial_target, expr, sgref);
 		}
 		else
@@ -5715,8 +6121,18 @@ make_partial_grouping_target(PlannerInfo *root,
 									  PVC_INCLUDE_AGGREGATES |
 									  PVC_RECURSE_WINDOWFUNCS |
 									  PVC_INCLUDE_PLACEHOLDERS);
+	if (strip_group_rtindex)
+		non_group_exprs = (List *)
+			remove_nulling_relids((Node *) non_group_exprs,
+								  bms_make_singleton(root->group_rtindex),
+								  NULL);
 
-	add_new_columns_to_pathtarget(partial_target, non_group_exprs);
+	foreach(lc, non_group_exprs)
+	{
+		/* GROUPING()'s arguments are grouping columns, so present already */
+		if (!IsA(lfirst(lc), GroupingFunc))
+			add_new_column_to_pathtarget(partial_target, lfirst(lc));
+	}
 
 	/*
 	 * Adjust Aggrefs to put them in partial mode.  At this point all Aggrefs
@@ -7034,7 +7450,7 @@ plan_create_index_workers(Oid tableOid, Oid indexOid)
 	 * Furthermore, any index predicate or index expressions must be parallel
 	 * safe.
 	 */
-	if (heap->rd_rel->relpersistence == RELPERSISTENCE_TEMP ||
+	if (RelationUsesLocalBuffers(heap) ||
 		!is_parallel_safe(root, (Node *) RelationGetIndexExpressions(index)) ||
 		!is_parallel_safe(root, (Node *) RelationGetIndexPredicate(index)))
 	{
@@ -7090,6 +7506,94 @@ done:
 	return parallel_workers;
 }
 
+/*
+ * plan_rewrite_table_workers
+ *		Use the planner to decide how many parallel worker processes
+ *		a table rewrite or verification scan in ALTER TABLE should
+ *		request for use
+ *
+ * tableOid is the table being rewritten or checked.  As for CREATE INDEX, the
+ * parallel_workers storage parameter is accepted as is, and otherwise the
+ * number of workers is based on the size of the table.  Either way, it is
+ * capped at max_parallel_maintenance_workers.  There is no sort, so
+ * maintenance_work_mem is not considered.
+ *
+ * The caller is responsible for checking that whatever the workers are to
+ * evaluate is parallel safe.
+ *
+ * Note: caller had better already hold some type of lock on the table.
+ */
+int
+plan_rewrite_table_workers(Oid tableOid)
+{
+	PlannerInfo *root;
+	Query	   *query;
+	PlannerGlobal *glob;
+	RangeTblEntry *rte;
+	Relation	heap;
+	RelOptInfo *rel;
+	int			parallel_workers;
+	BlockNumber heap_blocks;
+	double		reltuples;
+	double		allvisfrac;
+
+	/*
+	 * We don't allow performing parallel operation in standalone backend or
+	 * when parallelism is disabled.
+	 */
+	if (!IsUnderPostmaster || max_parallel_maintenance_workers == 0)
+		return 0;
+
+	/* Set up largely-dummy planner state, as in plan_create_index_workers */
+	query = makeNode(Query);
+	query->commandType = CMD_SELECT;
+
+	glob = makeNode(PlannerGlobal);
+
+	root = makeNode(PlannerInfo);
+	root->parse = query;
+	root->glob = glob;
+	root->query_level = 1;
+	root->planner_cxt = CurrentMemoryContext;
+	root->wt_param_id = -1;
+	root->join_domains = list_make1(makeNode(JoinDomain));
+
+	rte = makeNode(RangeTblEntry);
+	rte->rtekind = RTE_RELATION;
+	rte->relid = tableOid;
+	rte->relkind = RELKIND_RELATION;	/* Don't be too picky. */
+	rte->rellockmode = AccessShareLock;
+	rte->lateral = false;
+	rte->inh = true;
+	rte->inFromCl = true;
+	query->rtable = list_make1(rte);
+	addRTEPermissionInfo(&query->rteperminfos, rte);
+
+	setup_simple_rel_arrays(root);
+
+	rel = build_simple_rel(root, 1, NULL);
+
+	/* Rel is assumed already locked by the caller */
+	heap = table_open(tableOid, NoLock);
+
+	/* Parallel workers can't access the leader's temporary tables */
+	if (RelationUsesLocalBuffers(heap))
+		parallel_workers = 0;
+	else if (rel->rel_parallel_workers != -1)
+		parallel_workers = Min(rel->rel_parallel_workers,
+							   max_parallel_maintenance_workers);
+	else
+	{
+		estimate_rel_size(heap, NULL, &heap_blocks, &reltuples, &allvisfrac);
+		parallel_workers = compute_parallel_worker(rel, heap_blocks, -1,
+												   max_parallel_maintenance_workers);
+	}
+
+	table_close(heap, NoLock);
+
+	return parallel_workers;
+}
+
 /*
  * add_paths_to_grouping_rel
  *
@@ -7129,12 +7633,18 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 
 		/*
 		 * Estimate number of groups for final phase of partial aggregation.
+		 * With grouping sets, that phase forms the same groups as non-split
+		 * aggregation does, and re-estimating would overwrite the per-set
+		 * estimates that get_number_of_groups saved in gd.
 		 */
-		dNumFinalGroups =
-			get_number_of_groups(root,
-								 cheapest_partially_grouped_path->rows,
-								 gd,
-								 extra->targetList);
+		if (parse->groupingSets)
+			dNumFinalGroups = dNumGroups;
+		else
+			dNumFinalGroups =
+				get_number_of_groups(root,
+									 cheapest_partially_grouped_path->rows,
+									 gd,
+									 extra->targetList);
 	}
 
 	if (can_sort)
@@ -7177,7 +7687,8 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 				{
 					consider_groupingsets_paths(root, grouped_rel,
 												path, true, can_hash,
-												gd, agg_costs, dNumGroups);
+												gd, agg_costs, dNumGroups,
+												AGGSPLIT_SIMPLE);
 				}
 				else if (parse->hasAggs)
 				{
@@ -7219,6 +7730,54 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 			}
 		}
 
+		/*
+		 * With GROUP BY on the leading column of an index, consider a loose
+		 * index scan that reads just the first row of each group, if that
+		 * row is enough to compute the aggregates.
+		 */
+		if (enable_looseindexscan && !parse->groupingSets &&
+			list_length(root->processed_groupClause) == 1 &&
+			root->num_groupby_pathkeys == 1 &&
+			list_length(root->group_pathkeys) == 1)
+		{
+			SortGroupClause *clause;
+
+			clause = linitial_node(SortGroupClause,
+								   root->processed_groupClause);
+			foreach(lc, input_rel->pathlist)
+			{
+				Path	   *path;
+
+				path = make_loose_index_path(root, input_rel,
+											 (Path *) lfirst(lc),
+											 clause, root->group_pathkeys,
+											 parse->hasAggs, dNumGroups);
+				if (path == NULL)
+					continue;
+
+				if (parse->hasAggs)
+					add_path(grouped_rel, (Path *)
+							 create_agg_path(root,
+											 grouped_rel,
+											 path,
+											 grouped_rel->reltarget,
+											 AGG_SORTED,
+											 AGGSPLIT_SIMPLE,
+											 root->processed_groupClause,
+											 havingQual,
+											 agg_costs,
+											 dNumGroups));
+				else
+					add_path(grouped_rel, (Path *)
+							 create_group_path(root,
+											   grouped_rel,
+											   path,
+											   root->processed_groupClause,
+											   havingQual,
+											   dNumGroups));
+			}
+		}
+
 		/*
 		 * Instead of operating directly on the input relation, we can
 		 * consider finalizing a partially aggregated path.
@@ -7255,7 +7814,13 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 					if (path == NULL)
 						continue;
 
-					if (parse->hasAggs)
+					if (parse->groupingSets)
+						consider_groupingsets_paths(root, grouped_rel,
+													path, true, can_hash,
+													gd, agg_final_costs,
+													dNumFinalGroups,
+													AGGSPLIT_FINAL_DESERIAL);
+					else if (parse->hasAggs)
 						add_path(grouped_rel, (Path *)
 								 create_agg_path(root,
 												 grouped_rel,
@@ -7290,7 +7855,8 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 			 */
 			consider_groupingsets_paths(root, grouped_rel,
 										cheapest_path, false, true,
-										gd, agg_costs, dNumGroups);
+										gd, agg_costs, dNumGroups,
+										AGGSPLIT_SIMPLE);
 		}
 		else
 		{
@@ -7316,17 +7882,25 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 		 */
 		if (partially_grouped_rel && partially_grouped_rel->pathlist)
 		{
-			add_path(grouped_rel, (Path *)
-					 create_agg_path(root,
-									 grouped_rel,
-									 cheapest_partially_grouped_path,
-									 grouped_rel->reltarget,
-									 AGG_HASHED,
-									 AGGSPLIT_FINAL_DESERIAL,
-									 root->processed_groupClause,
-									 havingQual,
-									 agg_final_costs,
-									 dNumFinalGroups));
+			if (parse->groupingSets)
+				consider_groupingsets_paths(root, grouped_rel,
+											cheapest_partially_grouped_path,
+											false, true,
+											gd, agg_final_costs,
+											dNumFinalGroups,
+											AGGSPLIT_FINAL_DESERIAL);
+			else
+				add_path(grouped_rel, (Path *)
+						 create_agg_path(root,
+										 grouped_rel,
+										 cheapest_partially_grouped_path,
+										 grouped_rel->reltarget,
+										 AGG_HASHED,
+										 AGGSPLIT_FINAL_DESERIAL,
+										 root->processed_groupClause,
+										 havingQual,
+										 agg_final_costs,
+										 dNumFinalGroups));
 		}
 	}
 
@@ -7376,6 +7950,20 @@ create_partial_grouping_paths(PlannerInfo *root,
 	ListCell   *lc;
 	bool		can_hash = (extra->flags & GROUPING_CAN_USE_HASH) != 0;
 	bool		can_sort = (extra->flags & GROUPING_CAN_USE_SORT) != 0;
+	GroupByOrdering *gsets_ordering = NULL;
+
+	/*
+	 * With grouping sets, the partial step groups by all of the grouping
+	 * columns at once, and the finalize step forms the grouping sets from
+	 * its output.  So here we must be able to sort or hash by all of the
+	 * columns together, not just by those of some of the sets.
+	 */
+	if (parse->groupingSets)
+	{
+		gsets_ordering = make_partial_groupingsets_ordering(root, gd);
+		can_sort = (gsets_ordering != NULL);
+		can_hash = can_hash && grouping_is_hashable(parse->groupClause);
+	}
 
 	/*
 	 * Check whether any partially aggregated paths have been generated
@@ -7464,18 +8052,21 @@ create_partial_grouping_paths(PlannerInfo *root,
 		extra->partial_costs_set = true;
 	}
 
-	/* Estimate number of partial groups. */
+	/*
+	 * Estimate number of partial groups.  We pass gd = NULL because the
+	 * partial step doesn't form grouping sets, see above.
+	 */
 	if (cheapest_total_path != NULL)
 		dNumPartialGroups =
 			get_number_of_groups(root,
 								 cheapest_total_path->rows,
-								 gd,
+								 NULL,
 								 extra->targetList);
 	if (cheapest_partial_path != NULL)
 		dNumPartialPartialGroups =
 			get_number_of_groups(root,
 								 cheapest_partial_path->rows,
-								 gd,
+								 NULL,
 								 extra->targetList);
 
 	if (can_sort && cheapest_total_path != NULL)
@@ -7495,7 +8086,10 @@ create_partial_grouping_paths(PlannerInfo *root,
 			List	   *pathkey_orderings = NIL;
 
 			/* generate alternative group orderings that might be useful */
-			pathkey_orderings = get_useful_group_keys_orderings(root, path);
+			if (gsets_ordering)
+				pathkey_orderings = list_make1(gsets_ordering);
+			else
+				pathkey_orderings = get_useful_group_keys_orderings(root, path);
 
 			Assert(list_length(pathkey_orderings) > 0);
 
@@ -7552,7 +8146,10 @@ create_partial_grouping_paths(PlannerInfo *root,
 			List	   *pathkey_orderings = NIL;
 
 			/* generate alternative group orderings that might be useful */
-			pathkey_orderings = get_useful_group_keys_orderings(root, path);
+			if (gsets_ordering)
+				pathkey_orderings = list_make1(gsets_ordering);
+			else
+				pathkey_orderings = get_useful_group_keys_orderings(root, path);
 
 			Assert(list_length(pathkey_orderings) > 0);
 
@@ -7753,6 +8350,55 @@ make_ordered_path(PlannerInfo *root, RelOptInfo *rel, Path *path,
 	return path;
 }
 
+/*
+ * make_partial_groupingsets_ordering
+ *		Build the grouping clause and pathkeys for a sort-based partial
+ *		aggregation step below a grouping sets step.
+ *
+ * The partial step groups by all of the grouping columns.  We put the columns
+ * of the first rollup first, so that the partially aggregated rows come out
+ * sorted by group_pathkeys, as the sort-based finalize step needs them.
+ * Returns NULL if the grouping columns can't all be sorted.
+ */
+static GroupByOrdering *
+make_partial_groupingsets_ordering(PlannerInfo *root, grouping_sets_data *gd)
+{
+	Query	   *parse = root->parse;
+	GroupByOrdering *info;
+	List	   *clauses = NIL;
+	bool		sortable;
+	ListCell   *lc;
+
+	if (gd->rollups != NIL)
+		clauses = list_copy(linitial_node(RollupData, gd->rollups)->groupClause);
+
+	foreach(lc, parse->groupClause)
+	{
+		SortGroupClause *gc = lfirst_node(SortGroupClause, lc);
+
+		if (get_sortgroupref_clause_noerr(gc->tleSortGroupRef, clauses) == NULL)
+			clauses = lappend(clauses, gc);
+	}
+
+	if (!grouping_is_sortable(clauses))
+		return NULL;
+
+	/* As in standard_qp_callback, the keys are below the grouping step */
+	info = makeNode(GroupByOrdering);
+	info->pathkeys =
+		make_pathkeys_for_sortclauses_extended(root,
+											   &clauses,
+											   root->processed_tlist,
+											   false,
+											   parse->hasGroupRTE,
+											   &sortable,
+											   false);
+	Assert(sortable);
+	info->clauses = clauses;
+
+	return info;
+}
+
 /*
  * Generate Gather and Gather Merge paths for a grouping relation or partial
  * grouping relation.
@@ -7862,9 +8508,12 @@ can_partial_agg(PlannerInfo *root)
 		 */
 		return false;
 	}
-	else if (parse->groupingSets)
+	else if (parse->groupingSets && parse->groupClause == NIL)
 	{
-		/* We don't know how to do grouping sets in parallel. */
+		/*
+		 * The partial step groups by all of the grouping columns; we don't
+		 * bother with the case of having only empty grouping sets.
+		 */
 		return false;
 	}
 	else if (root->hasNonPartialAggs || root->hasNonSerialAggs)
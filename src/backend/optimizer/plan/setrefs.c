@@ -536,7 +536,9 @@ flatten_rtes_walker(Node *node, flatten_rtes_walker_context *cxt)
  * needed by the executor; this reduces the storage space and copying cost
  * for cached plans.  We keep only the ctename, alias, eref Alias fields,
  * which are needed by EXPLAIN, and perminfoindex which is needed by the
- * executor to fetch the RTE's RTEPermissionInfo.
+ * executor to fetch the RTE's RTEPermissionInfo.  A CTE RTE also keeps its
+ * column types, from which a parallel worker, which doesn't get the CTE's
+ * plan, builds the tuple descriptor for a parallel-aware CteScan.
  */
 static void
 add_rte_to_flat_rtable(PlannerGlobal *glob, List *rteperminfos,
@@ -558,9 +560,12 @@ add_rte_to_flat_rtable(PlannerGlobal *glob, List *rteperminfos,
 	newrte->functions = NIL;
 	newrte->tablefunc = NULL;
 	newrte->values_lists = NIL;
-	newrte->coltypes = NIL;
-	newrte->coltypmods = NIL;
-	newrte->colcollations = NIL;
+	if (newrte->rtekind != RTE_CTE)
+	{
+		newrte->coltypes = NIL;
+		newrte->coltypmods = NIL;
+		newrte->colcollations = NIL;
+	}
 	newrte->groupexprs = NIL;
 	newrte->securityQuals = NIL;
 
@@ -2293,15 +2298,12 @@ fix_scan_expr_mutator(Node *node, fix_scan_expr_context *context)
 	if (IsA(node, Aggref))
 	{
 		Aggref	   *aggref = (Aggref *) node;
-		Param	   *aggparam;
+		Expr	   *aggexpr;
 
-		/* See if the Aggref should be replaced by a Param */
-		aggparam = find_minmax_agg_replacement_param(context->root, aggref);
-		if (aggparam != NULL)
-		{
-			/* Make a copy of the Param for paranoia's sake */
-			return (Node *) copyObject(aggparam);
-		}
+		/* See if the Aggref should be replaced by InitPlan output Params */
+		aggexpr = find_minmax_agg_replacement(context->root, aggref);
+		if (aggexpr != NULL)
+			return (Node *) aggexpr;
 		/* If no match, just fall through to process it normally */
 	}
 	if (IsA(node, CurrentOfExpr))
@@ -2409,6 +2411,15 @@ set_join_references(PlannerInfo *root, Join *join, int rtoffset)
 				  nlp->paramval->varno == OUTER_VAR))
 				elog(ERROR, "NestLoopParam was not reduced to a simple Var");
 		}
+
+		nl->adaptiveHashClauses = fix_join_expr(root,
+												nl->adaptiveHashClauses,
+												outer_itlist,
+												inner_itlist,
+												(Index) 0,
+												rtoffset,
+												NRM_EQUAL,
+												NUM_EXEC_QUAL((Plan *) join));
 	}
 	else if (IsA(join, MergeJoin))
 	{
@@ -2604,6 +2615,14 @@ set_param_references(PlannerInfo *root, Plan *plan)
 				SubPlan    *initsubplan = (SubPlan *) lfirst(l);
 				ListCell   *l2;
 
+				/*
+				 * A CTE's param just links its CteScans together within one
+				 * process; parallel-aware CteScans share the CTE's rows
+				 * through their own DSM state instead.
+				 */
+				if (initsubplan->subLinkType == CTE_SUBLINK)
+					continue;
+
 				foreach(l2, initsubplan->setParam)
 				{
 					initSetParam = bms_add_member(initSetParam, lfirst_int(l2));
@@ -3368,15 +3387,12 @@ fix_upper_expr_mutator(Node *node, fix_upper_expr_context *context)
 	if (IsA(node, Aggref))
 	{
 		Aggref	   *aggref = (Aggref *) node;
-		Param	   *aggparam;
+		Expr	   *aggexpr;
 
-		/* See if the Aggref should be replaced by a Param */
-		aggparam = find_minmax_agg_replacement_param(context->root, aggref);
-		if (aggparam != NULL)
-		{
-			/* Make a copy of the Param for paranoia's sake */
-			return (Node *) copyObject(aggparam);
-		}
+		/* See if the Aggref should be replaced by InitPlan output Params */
+		aggexpr = find_minmax_agg_replacement(context->root, aggref);
+		if (aggexpr != NULL)
+			return (Node *) aggexpr;
 		/* If no match, just fall through to process it normally */
 	}
 	if (IsA(node, AlternativeSubPlan))
@@ -3529,17 +3545,18 @@ set_windowagg_runcondition_references(PlannerInfo *root,
 }
 
 /*
- * find_minmax_agg_replacement_param
+ * find_minmax_agg_replacement
  *		If the given Aggref is one that we are optimizing into a subquery
- *		(cf. planagg.c), then return the Param that should replace it.
- *		Else return NULL.
+ *		(cf. planagg.c), then return a new expression that should replace it.
+ *		That's the Param for the subquery's output, or COALESCE(Param,
+ *		fallback Param) if there's a fallback subquery.  Else return NULL.
  *
  * This is exported so that SS_finalize_plan can use it before setrefs.c runs.
  * Note that it will not find anything until we have built a Plan from a
  * MinMaxAggPath, as root->minmax_aggs will never be filled otherwise.
  */
-Param *
-find_minmax_agg_replacement_param(PlannerInfo *root, Aggref *aggref)
+Expr *
+find_minmax_agg_replacement(PlannerInfo *root, Aggref *aggref)
 {
 	if (root->minmax_aggs != NIL &&
 		list_length(aggref->args) == 1)
@@ -3553,7 +3570,24 @@ find_minmax_agg_replacement_param(PlannerInfo *root, Aggref *aggref)
 
 			if (mminfo->aggfnoid == aggref->aggfnoid &&
 				equal(mminfo->target, curTarget->expr))
-				return mminfo->param;
+			{
+				CoalesceExpr *coalesce;
+
+				if (mminfo->fbparam == NULL)
+					return (Expr *) copyObject(mminfo->param);
+
+				/*
+				 * The fallback InitPlan only runs if COALESCE gets to
+				 * evaluate its Param, since InitPlans are run lazily.
+				 */
+				coalesce = makeNode(CoalesceExpr);
+				coalesce->coalescetype = mminfo->param->paramtype;
+				coalesce->coalescecollid = mminfo->param->paramcollid;
+				coalesce->args = list_make2(copyObject(mminfo->param),
+											copyObject(mminfo->fbparam));
+				coalesce->location = -1;
+				return (Expr *) coalesce;
+			}
 		}
 	}
 	return NULL;
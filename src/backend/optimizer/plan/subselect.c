@@ -244,6 +244,24 @@ make_subplan(PlannerInfo *root, Query *orig_subquery,
 						   subLinkType, subLinkId,
 						   testexpr, NIL, isTopQual);
 
+	/*
+	 * If it's a correlated subplan that yields a single value per execution,
+	 * the executor can remember its results by parameter values, provided
+	 * the result depends on nothing else.  We check the original subquery
+	 * for volatile functions, since that also covers its own sub-selects.
+	 */
+	if (enable_subplan_cache && IsA(result, SubPlan))
+	{
+		SubPlan    *splan = (SubPlan *) result;
+
+		if (splan->parParam != NIL &&
+			(subLinkType == EXISTS_SUBLINK ||
+			 subLinkType == EXPR_SUBLINK ||
+			 subLinkType == ARRAY_SUBLINK) &&
+			!contain_volatile_functions((Node *) orig_subquery))
+			splan->useCache = true;
+	}
+
 	/*
 	 * If it's a correlated EXISTS with an unimportant targetlist, we might be
 	 * able to transform it to the equivalent of an IN and then implement it
@@ -348,6 +366,7 @@ build_subplan(PlannerInfo *root, Plan *plan, Path *path,
 	splan->useHashTable = false;
 	splan->unknownEqFalse = unknownEqFalse;
 	splan->parallel_safe = plan->parallel_safe;
+	splan->useCache = false;
 	splan->setParam = NIL;
 	splan->parParam = NIL;
 	splan->args = NIL;
@@ -3062,12 +3081,12 @@ finalize_primnode(Node *node, finalize_primnode_context *context)
 		 * here.)
 		 */
 		Aggref	   *aggref = (Aggref *) node;
-		Param	   *aggparam;
+		Expr	   *aggexpr;
 
-		aggparam = find_minmax_agg_replacement_param(context->root, aggref);
-		if (aggparam != NULL)
-			context->paramids = bms_add_member(context->paramids,
-											   aggparam->paramid);
+		aggexpr = find_minmax_agg_replacement(context->root, aggref);
+		if (aggexpr != NULL)
+			context->paramids = bms_add_members(context->paramids,
+												pull_paramids(aggexpr));
 		/* Fall through to examine the agg's arguments */
 	}
 	else if (IsA(node, SubPlan))
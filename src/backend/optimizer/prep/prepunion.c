@@ -65,6 +65,9 @@ static List *plan_union_children(PlannerInfo *root,
 								 List *refnames_tlist,
 								 List **tlist_list,
 								 List **istrivial_tlist);
+static Path *create_gathered_dedup_path(PlannerInfo *root, RelOptInfo *rel,
+										Path *partial_path, List *groupList,
+										double dNumGroups);
 static void postprocess_setop_rel(PlannerInfo *root, RelOptInfo *rel);
 static List *generate_setop_tlist(List *colTypes, List *colCollations,
 								  Index varno,
@@ -707,6 +710,7 @@ generate_union_paths(SetOperationStmt *op, PlannerInfo *root,
 	List	   *tlist;
 	List	   *groupList = NIL;
 	Path	   *apath;
+	Path	   *papath = NULL;
 	Path	   *gpath = NULL;
 	bool		try_sorted = false;
 	List	   *union_pathkeys = NIL;
@@ -858,7 +862,6 @@ generate_union_paths(SetOperationStmt *op, PlannerInfo *root,
 	 */
 	if (partial_paths_valid)
 	{
-		Path	   *papath;
 		int			parallel_workers = 0;
 
 		/* Find the highest number of workers requested for any subpath. */
@@ -968,6 +971,24 @@ generate_union_paths(SetOperationStmt *op, PlannerInfo *root,
 												NULL,
 												dNumGroups);
 				add_path(result_rel, path);
+
+				/*
+				 * And on a Gather of the partial Append with the duplicates
+				 * already removed in each worker.
+				 */
+				path = create_gathered_dedup_path(root, result_rel, papath,
+												  groupList, dNumGroups);
+				path = (Path *) create_agg_path(root,
+												result_rel,
+												path,
+												result_rel->reltarget,
+												AGG_HASHED,
+												AGGSPLIT_SIMPLE,
+												groupList,
+												NIL,
+												NULL,
+												dNumGroups);
+				add_path(result_rel, path);
 			}
 		}
 
@@ -1308,6 +1329,48 @@ generate_nonunion_paths(SetOperationStmt *op, PlannerInfo *root,
 										  dNumGroups,
 										  dNumOutputRows);
 		add_path(result_rel, path);
+
+		/*
+		 * Without ALL, duplicates within each input don't matter, so if an
+		 * input can be computed in parallel, we can also remove most of its
+		 * duplicates in the workers, leaving the SetOp less to do.
+		 */
+		if (!op->all)
+		{
+			Path	   *dlpath = lpath;
+			Path	   *drpath = rpath;
+
+			if (lrel->partial_pathlist != NIL)
+			{
+				path = create_gathered_dedup_path(root, lrel,
+												  linitial(lrel->partial_pathlist),
+												  groupList, dLeftGroups);
+				if (path->total_cost < lpath->total_cost)
+					dlpath = path;
+			}
+			if (rrel->partial_pathlist != NIL)
+			{
+				path = create_gathered_dedup_path(root, rrel,
+												  linitial(rrel->partial_pathlist),
+												  groupList, dRightGroups);
+				if (path->total_cost < rpath->total_cost)
+					drpath = path;
+			}
+
+			if (dlpath != lpath || drpath != rpath)
+			{
+				path = (Path *) create_setop_path(root,
+												  result_rel,
+												  dlpath,
+												  drpath,
+												  cmd,
+												  SETOP_HASHED,
+												  groupList,
+												  dNumGroups,
+												  dNumOutputRows);
+				add_path(result_rel, path);
+			}
+		}
 	}
 
 	/*
@@ -1450,6 +1513,42 @@ plan_union_children(PlannerInfo *root,
 	return result;
 }
 
+/*
+ * create_gathered_dedup_path
+ *	  Build a path that removes duplicate rows from a partial path in each
+ *	  parallel worker, and gathers the results.
+ *
+ * Each worker only eliminates the duplicates among the rows it sees itself,
+ * so the output is not unique, and whatever consumes it must still remove
+ * or tolerate the remaining duplicates.  But if there are many of them, that
+ * leaves much less work to be done in the leader.
+ */
+static Path *
+create_gathered_dedup_path(PlannerInfo *root, RelOptInfo *rel,
+						   Path *partial_path, List *groupList,
+						   double dNumGroups)
+{
+	Path	   *path;
+	double		rows;
+
+	path = (Path *) create_agg_path(root,
+									rel,
+									partial_path,
+									partial_path->pathtarget,
+									AGG_HASHED,
+									AGGSPLIT_SIMPLE,
+									groupList,
+									NIL,
+									NULL,
+									Min(dNumGroups, partial_path->rows));
+
+	/* every worker may see every distinct value */
+	rows = compute_gather_rows(path);
+
+	return (Path *) create_gather_path(root, rel, path,
+									   partial_path->pathtarget, NULL, &rows);
+}
+
 /*
  * postprocess_setop_rel - perform steps required after adding paths
  */
@@ -983,6 +983,7 @@ add_row_identity_columns(PlannerInfo *root, Index rtindex,
 		 * Let the foreign table's FDW add whatever junk TLEs it wants.
 		 */
 		FdwRoutine *fdwroutine;
+		TriggerDesc *trigdesc;
 
 		fdwroutine = GetFdwRoutineForRelation(target_relation, false);
 
@@ -1003,10 +1004,11 @@ add_row_identity_columns(PlannerInfo *root, Index rtindex,
 		 * that the executor will have the "old" row to pass to the trigger.
 		 * Alas, this misses system columns.
 		 */
+		trigdesc = RelationGetTriggerDesc(target_relation);
 		if (commandType == CMD_UPDATE ||
-			(target_relation->trigdesc &&
-			 (target_relation->trigdesc->trig_delete_after_row ||
-			  target_relation->trigdesc->trig_delete_before_row)))
+			(trigdesc &&
+			 (trigdesc->trig_delete_after_row ||
+			  trigdesc->trig_delete_before_row)))
 		{
 			var = makeVar(rtindex,
 						  InvalidAttrNumber,
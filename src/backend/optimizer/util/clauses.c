@@ -801,6 +801,27 @@ is_parallel_safe(PlannerInfo *root, Node *node)
 	return !max_parallel_hazard_walker(node, &context);
 }
 
+/*
+ * expression_is_parallel_safe
+ *		Detect whether the given standalone expression, which is not part of
+ *		a query being planned, could safely be evaluated in a parallel worker.
+ *
+ * This is for utility commands that hand work out to parallel workers, such
+ * as COPY FROM with PARALLEL.  As in a planned query, anything parallel
+ * restricted counts as unsafe, since it could only run in the leader.
+ */
+bool
+expression_is_parallel_safe(Node *node)
+{
+	max_parallel_hazard_context context;
+
+	context.max_hazard = PROPARALLEL_SAFE;
+	context.max_interesting = PROPARALLEL_RESTRICTED;
+	context.safe_param_ids = NIL;
+
+	return !max_parallel_hazard_walker(node, &context);
+}
+
 /* core logic for all parallel-hazard checks */
 static bool
 max_parallel_hazard_test(char proparallel, max_parallel_hazard_context *context)
@@ -1953,7 +1953,8 @@ create_valuesscan_path(PlannerInfo *root, RelOptInfo *rel,
  */
 Path *
 create_ctescan_path(PlannerInfo *root, RelOptInfo *rel,
-					List *pathkeys, Relids required_outer)
+					List *pathkeys, Relids required_outer,
+					int parallel_workers)
 {
 	Path	   *pathnode = makeNode(Path);
 
@@ -1962,9 +1963,14 @@ create_ctescan_path(PlannerInfo *root, RelOptInfo *rel,
 	pathnode->pathtarget = rel->reltarget;
 	pathnode->param_info = get_baserel_parampathinfo(root, rel,
 													 required_outer);
-	pathnode->parallel_aware = false;
-	pathnode->parallel_safe = rel->consider_parallel;
-	pathnode->parallel_workers = 0;
+	pathnode->parallel_aware = (parallel_workers > 0);
+
+	/*
+	 * Only a parallel-aware scan can run in a worker, since the CTE's
+	 * tuplestore is local to the leader.
+	 */
+	pathnode->parallel_safe = rel->consider_parallel && parallel_workers > 0;
+	pathnode->parallel_workers = parallel_workers;
 	pathnode->pathkeys = pathkeys;
 
 	cost_ctescan(pathnode, root, rel, pathnode->param_info);
@@ -2513,6 +2519,51 @@ create_hashjoin_path(PlannerInfo *root,
 	return pathnode;
 }
 
+/*
+ * create_filter_path
+ *	  Creates a pathnode that represents filtering the rows of 'subpath'.
+ *
+ * 'rel' is the parent relation associated with the result
+ * 'subpath' is the path representing the source of data
+ * 'quals' is a list of bare clauses over subpath's output
+ * 'rows' is the estimated number of rows passing the quals
+ */
+FilterPath *
+create_filter_path(PlannerInfo *root,
+				   RelOptInfo *rel,
+				   Path *subpath,
+				   List *quals,
+				   double rows)
+{
+	FilterPath *pathnode = makeNode(FilterPath);
+	QualCost	qual_cost;
+
+	pathnode->path.pathtype = T_Result;
+	pathnode->path.parent = rel;
+	pathnode->path.pathtarget = subpath->pathtarget;
+	pathnode->path.param_info = subpath->param_info;
+	pathnode->path.parallel_aware = false;
+	pathnode->path.parallel_safe = rel->consider_parallel &&
+		subpath->parallel_safe &&
+		is_parallel_safe(root, (Node *) quals);
+	pathnode->path.parallel_workers = subpath->parallel_workers;
+	/* Filtering does not change the sort order */
+	pathnode->path.pathkeys = subpath->pathkeys;
+
+	pathnode->subpath = subpath;
+	pathnode->quals = quals;
+
+	cost_qual_eval(&qual_cost, quals, root);
+
+	pathnode->path.rows = clamp_row_est(rows);
+	pathnode->path.disabled_nodes = subpath->disabled_nodes;
+	pathnode->path.startup_cost = subpath->startup_cost + qual_cost.startup;
+	pathnode->path.total_cost = subpath->total_cost + qual_cost.startup +
+		(cpu_tuple_cost + qual_cost.per_tuple) * subpath->rows;
+
+	return pathnode;
+}
+
 /*
  * create_projection_path
  *	  Creates a pathnode that represents performing a projection.
@@ -3070,6 +3121,8 @@ create_agg_path(PlannerInfo *root,
  * 'subpath' is the path representing the source of data
  * 'target' is the PathTarget to be computed
  * 'having_qual' is the HAVING quals if any
+ * 'aggstrategy' is the Agg node's basic implementation strategy
+ * 'aggsplit' is the Agg node's aggregate-splitting mode
  * 'rollups' is a list of RollupData nodes
  * 'agg_costs' contains cost info about the aggregate functions to be computed
  */
@@ -3079,6 +3132,7 @@ create_groupingsets_path(PlannerInfo *root,
 						 Path *subpath,
 						 List *having_qual,
 						 AggStrategy aggstrategy,
+						 AggSplit aggsplit,
 						 List *rollups,
 						 const AggClauseCosts *agg_costs)
 {
@@ -3123,6 +3177,7 @@ create_groupingsets_path(PlannerInfo *root,
 		pathnode->path.pathkeys = NIL;
 
 	pathnode->aggstrategy = aggstrategy;
+	pathnode->aggsplit = aggsplit;
 	pathnode->rollups = rollups;
 	pathnode->qual = having_qual;
 	pathnode->transitionSpace = agg_costs ? agg_costs->transitionSpace : 0;
@@ -3272,7 +3327,8 @@ create_minmaxagg_path(PlannerInfo *root,
 
 		initplan_disabled_nodes += mminfo->path->disabled_nodes;
 		initplan_cost += mminfo->pathcost;
-		if (!mminfo->path->parallel_safe)
+		if (!mminfo->path->parallel_safe ||
+			(mminfo->fbpath && !mminfo->fbpath->parallel_safe))
 			pathnode->path.parallel_safe = false;
 	}
 
@@ -26,6 +26,7 @@
 #include "access/transam.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
+#include "catalog/globaltemp.h"
 #include "catalog/heap.h"
 #include "catalog/pg_am.h"
 #include "catalog/pg_proc.h"
@@ -492,9 +493,13 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 				}
 
 				/*
-				 * Get tree height while we have the index open
+				 * Get tree height while we have the index open.  This
+				 * session's copy of a global temporary index may not have
+				 * been built yet, and planning shouldn't build it.
 				 */
-				if (amroutine->amgettreeheight)
+				if (amroutine->amgettreeheight &&
+					(!RelationIsGlobalTemp(indexRelation) ||
+					 GlobalTempRelationHasStorage(indexRelation)))
 				{
 					info->tree_height = amroutine->amgettreeheight(indexRelation);
 				}
@@ -2515,7 +2520,7 @@ has_row_triggers(PlannerInfo *root, Index rti, CmdType event)
 	/* Assume we already have adequate lock */
 	relation = table_open(rte->relid, NoLock);
 
-	trigDesc = relation->trigdesc;
+	trigDesc = RelationGetTriggerDesc(relation);
 	switch (event)
 	{
 		case CMD_INSERT:
@@ -2571,7 +2576,7 @@ has_transition_tables(PlannerInfo *root, Index rti, CmdType event)
 	/* Assume we already have adequate lock */
 	relation = table_open(rte->relid, NoLock);
 
-	trigDesc = relation->trigdesc;
+	trigDesc = RelationGetTriggerDesc(relation);
 	switch (event)
 	{
 		case CMD_INSERT:
@@ -499,6 +499,14 @@ generateSerialExtraStmts(CreateStmtContext *cxt, ColumnDef *column,
 	 * existing table, so we copy the persistence from there.
 	 */
 	seqpersistence = cxt->rel ? cxt->rel->rd_rel->relpersistence : cxt->relation->relpersistence;
+
+	/*
+	 * A global temporary table's sequences are regular ones, shared by all
+	 * sessions, which saves each session from starting over.
+	 */
+	if (seqpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+		seqpersistence = RELPERSISTENCE_PERMANENT;
+
 	if (loggedEl)
 	{
 		if (seqpersistence == RELPERSISTENCE_TEMP)
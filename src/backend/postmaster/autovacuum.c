@@ -79,6 +79,7 @@
 #include "catalog/pg_namespace.h"
 #include "commands/vacuum.h"
 #include "common/int.h"
+#include "funcapi.h"
 #include "lib/ilist.h"
 #include "libpq/pqsignal.h"
 #include "miscadmin.h"
@@ -196,6 +197,19 @@ typedef struct av_relation
 								 * reloptions, or NULL if none */
 } av_relation;
 
+/*
+ * struct to keep track of tables to vacuum and/or analyze, in the order in
+ * which to process them
+ */
+typedef struct av_candidate
+{
+	Oid			ac_relid;
+	bool		ac_dovacuum;
+	bool		ac_doanalyze;
+	bool		ac_wraparound;	/* vacuum forced to prevent wraparound? */
+	double		ac_score;		/* see relation_needs_vacanalyze */
+} av_candidate;
+
 /* struct to keep track of tables to vacuum and/or analyze, after rechecking */
 typedef struct autovac_table
 {
@@ -351,7 +365,9 @@ static void relation_needs_vacanalyze(Oid relid, AutoVacOpts *relopts,
 									  Form_pg_class classForm,
 									  PgStat_StatTabEntry *tabentry,
 									  int effective_multixact_freeze_max_age,
-									  bool *dovacuum, bool *doanalyze, bool *wraparound);
+									  bool *dovacuum, bool *doanalyze, bool *wraparound,
+									  double *score);
+static int	av_candidate_cmp(const ListCell *a, const ListCell *b);
 
 static void autovacuum_do_vac_analyze(autovac_table *tab,
 									  BufferAccessStrategy bstrategy);
@@ -1902,6 +1918,7 @@ do_autovacuum(void)
 	HeapTuple	tuple;
 	TableScanDesc relScan;
 	Form_pg_database dbForm;
+	List	   *candidates = NIL;
 	List	   *table_oids = NIL;
 	List	   *orphan_oids = NIL;
 	HASHCTL		ctl;
@@ -2014,6 +2031,7 @@ do_autovacuum(void)
 		bool		dovacuum;
 		bool		doanalyze;
 		bool		wraparound;
+		double		score;
 
 		if (classForm->relkind != RELKIND_RELATION &&
 			classForm->relkind != RELKIND_MATVIEW)
@@ -2021,6 +2039,13 @@ do_autovacuum(void)
 
 		relid = classForm->oid;
 
+		/*
+		 * The contents of global temporary tables are private to the
+		 * sessions using them, so there's nothing for us to do.
+		 */
+		if (classForm->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+			continue;
+
 		/*
 		 * Check if it is a temp table (presumably, of some other backend's).
 		 * We cannot safely process other backends' temp tables.
@@ -2054,11 +2079,21 @@ do_autovacuum(void)
 		/* Check if it needs vacuum or analyze */
 		relation_needs_vacanalyze(relid, relopts, classForm, tabentry,
 								  effective_multixact_freeze_max_age,
-								  &dovacuum, &doanalyze, &wraparound);
+								  &dovacuum, &doanalyze, &wraparound,
+								  &score);
 
-		/* Relations that need work are added to table_oids */
+		/* Relations that need work are added to the candidates */
 		if (dovacuum || doanalyze)
-			table_oids = lappend_oid(table_oids, relid);
+		{
+			av_candidate *cand = palloc_object(av_candidate);
+
+			cand->ac_relid = relid;
+			cand->ac_dovacuum = dovacuum;
+			cand->ac_doanalyze = doanalyze;
+			cand->ac_wraparound = wraparound;
+			cand->ac_score = score;
+			candidates = lappend(candidates, cand);
+		}
 
 		/*
 		 * Remember TOAST associations for the second pass.  Note: we must do
@@ -2114,11 +2149,14 @@ do_autovacuum(void)
 		bool		dovacuum;
 		bool		doanalyze;
 		bool		wraparound;
+		double		score;
 
 		/*
 		 * We cannot safely process other backends' temp tables, so skip 'em.
+		 * The same goes for the contents of global temporary tables.
 		 */
-		if (classForm->relpersistence == RELPERSISTENCE_TEMP)
+		if (classForm->relpersistence == RELPERSISTENCE_TEMP ||
+			classForm->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
 			continue;
 
 		relid = classForm->oid;
@@ -2146,11 +2184,21 @@ do_autovacuum(void)
 
 		relation_needs_vacanalyze(relid, relopts, classForm, tabentry,
 								  effective_multixact_freeze_max_age,
-								  &dovacuum, &doanalyze, &wraparound);
+								  &dovacuum, &doanalyze, &wraparound,
+								  &score);
 
 		/* ignore analyze for toast tables */
 		if (dovacuum)
-			table_oids = lappend_oid(table_oids, relid);
+		{
+			av_candidate *cand = palloc_object(av_candidate);
+
+			cand->ac_relid = relid;
+			cand->ac_dovacuum = dovacuum;
+			cand->ac_doanalyze = doanalyze;
+			cand->ac_wraparound = wraparound;
+			cand->ac_score = score;
+			candidates = lappend(candidates, cand);
+		}
 
 		/* Release stuff to avoid leakage */
 		if (free_relopts)
@@ -2162,6 +2210,16 @@ do_autovacuum(void)
 	table_endscan(relScan);
 	table_close(classRel, AccessShareLock);
 
+	/*
+	 * Process the tables in order of urgency rather than in catalog order, so
+	 * that a heavily bloated table or one nearing wraparound doesn't have to
+	 * wait for lots of tables that barely crossed their thresholds.
+	 */
+	list_sort(candidates, av_candidate_cmp);
+	foreach_ptr(av_candidate, cand, candidates)
+		table_oids = lappend_oid(table_oids, cand->ac_relid);
+	list_free_deep(candidates);
+
 	/*
 	 * Recheck orphan temporary tables, and if they still seem orphaned, drop
 	 * them.  We'll eat a transaction per dropped table, which might seem
@@ -2677,6 +2735,10 @@ perform_work_item(AutoVacuumWorkItem *workitem)
 									ObjectIdGetDatum(workitem->avw_relation),
 									Int64GetDatum((int64) workitem->avw_blockNumber));
 				break;
+			case AVW_GINCleanupPendingList:
+				DirectFunctionCall1(gin_clean_pending_list,
+									ObjectIdGetDatum(workitem->avw_relation));
+				break;
 			default:
 				elog(WARNING, "unrecognized work item found: type %d",
 					 workitem->avw_type);
@@ -2937,6 +2999,7 @@ recheck_relation_needs_vacanalyze(Oid relid,
 								  bool *wraparound)
 {
 	PgStat_StatTabEntry *tabentry;
+	double		score;
 
 	/* fetch the pgstat table entry */
 	tabentry = pgstat_fetch_stat_tabentry_ext(classForm->relisshared,
@@ -2944,7 +3007,7 @@ recheck_relation_needs_vacanalyze(Oid relid,
 
 	relation_needs_vacanalyze(relid, avopts, classForm, tabentry,
 							  effective_multixact_freeze_max_age,
-							  dovacuum, doanalyze, wraparound);
+							  dovacuum, doanalyze, wraparound, &score);
 
 	/* Release tabentry to avoid leakage */
 	if (tabentry)
@@ -2993,6 +3056,11 @@ recheck_relation_needs_vacanalyze(Oid relid,
  * autovacuum_vacuum_threshold GUC variable.  Similarly, a vac_scale_factor
  * value < 0 is substituted with the value of
  * autovacuum_vacuum_scale_factor GUC variable.  Ditto for analyze.
+ *
+ * "score" is set to the priority of the table among those needing work: the
+ * largest ratio of any of the quantities above (dead tuples, inserted tuples,
+ * modified tuples, relfrozenxid age and relminmxid age) to its threshold.
+ * A table with a score of 2 has crossed one of its thresholds twice over.
  */
 static void
 relation_needs_vacanalyze(Oid relid,
@@ -3003,7 +3071,8 @@ relation_needs_vacanalyze(Oid relid,
  /* output params below */
 						  bool *dovacuum,
 						  bool *doanalyze,
-						  bool *wraparound)
+						  bool *wraparound,
+						  double *score)
 {
 	bool		force_vacuum;
 	bool		av_enabled;
@@ -3103,6 +3172,17 @@ relation_needs_vacanalyze(Oid relid,
 	}
 	*wraparound = force_vacuum;
 
+	/* Score the XID and MXID ages against their limits */
+	*score = 0;
+	if (TransactionIdIsNormal(relfrozenxid) &&
+		TransactionIdPrecedes(relfrozenxid, recentXid))
+		*score = (double) (recentXid - relfrozenxid) / Max(freeze_max_age, 1);
+	if (MultiXactIdIsValid(classForm->relminmxid) &&
+		MultiXactIdPrecedes(classForm->relminmxid, recentMulti))
+		*score = Max(*score,
+					 (double) (recentMulti - classForm->relminmxid) /
+					 Max(multixact_freeze_max_age, 1));
+
 	/* User disabled it in pg_class.reloptions?  (But ignore if at risk) */
 	if (!av_enabled && !force_vacuum)
 	{
@@ -3171,6 +3251,13 @@ relation_needs_vacanalyze(Oid relid,
 		*dovacuum = force_vacuum || (vactuples > vacthresh) ||
 			(vac_ins_base_thresh >= 0 && instuples > vacinsthresh);
 		*doanalyze = (anltuples > anlthresh);
+
+		/* Score the tuple counts against their thresholds */
+		*score = Max(*score, vactuples / Max(vacthresh, 1));
+		if (vac_ins_base_thresh >= 0)
+			*score = Max(*score, instuples / Max(vacinsthresh, 1));
+		if (*doanalyze)
+			*score = Max(*score, anltuples / Max(anlthresh, 1));
 	}
 	else
 	{
@@ -3188,6 +3275,120 @@ relation_needs_vacanalyze(Oid relid,
 		*doanalyze = false;
 }
 
+/*
+ * qsort comparator for av_candidate, putting the most urgent tables first:
+ * those that must be vacuumed to prevent wraparound, then by score.
+ */
+static int
+av_candidate_cmp(const ListCell *a, const ListCell *b)
+{
+	const av_candidate *ca = lfirst(a);
+	const av_candidate *cb = lfirst(b);
+
+	if (ca->ac_wraparound != cb->ac_wraparound)
+		return ca->ac_wraparound ? -1 : 1;
+	if (ca->ac_score > cb->ac_score)
+		return -1;
+	if (ca->ac_score < cb->ac_score)
+		return 1;
+	return 0;
+}
+
+/*
+ * pg_stat_get_autovacuum_queue
+ *
+ * Returns the tables and materialized views of the current database that
+ * autovacuum would process now, in the order it would process them, as
+ * computed by do_autovacuum from the cumulative statistics.  TOAST tables are
+ * not shown.
+ */
+Datum
+pg_stat_get_autovacuum_queue(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_AUTOVACUUM_QUEUE_COLS	5
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	Relation	classRel;
+	TupleDesc	pg_class_desc;
+	TableScanDesc relScan;
+	HeapTuple	tuple;
+	int			effective_multixact_freeze_max_age;
+	List	   *candidates = NIL;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	recentXid = ReadNextTransactionId();
+	recentMulti = ReadNextMultiXactId();
+	effective_multixact_freeze_max_age = MultiXactMemberFreezeThreshold();
+
+	classRel = table_open(RelationRelationId, AccessShareLock);
+	pg_class_desc = CreateTupleDescCopy(RelationGetDescr(classRel));
+
+	relScan = table_beginscan_catalog(classRel, 0, NULL);
+	while ((tuple = heap_getnext(relScan, ForwardScanDirection)) != NULL)
+	{
+		Form_pg_class classForm = (Form_pg_class) GETSTRUCT(tuple);
+		PgStat_StatTabEntry *tabentry;
+		AutoVacOpts *relopts;
+		bool		dovacuum;
+		bool		doanalyze;
+		bool		wraparound;
+		double		score;
+
+		if ((classForm->relkind != RELKIND_RELATION &&
+			 classForm->relkind != RELKIND_MATVIEW) ||
+			classForm->relpersistence == RELPERSISTENCE_TEMP ||
+			classForm->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+			continue;
+
+		relopts = extract_autovac_opts(tuple, pg_class_desc);
+		tabentry = pgstat_fetch_stat_tabentry_ext(classForm->relisshared,
+												  classForm->oid);
+
+		relation_needs_vacanalyze(classForm->oid, relopts, classForm, tabentry,
+								  effective_multixact_freeze_max_age,
+								  &dovacuum, &doanalyze, &wraparound,
+								  &score);
+
+		if (dovacuum || doanalyze)
+		{
+			av_candidate *cand = palloc_object(av_candidate);
+
+			cand->ac_relid = classForm->oid;
+			cand->ac_dovacuum = dovacuum;
+			cand->ac_doanalyze = doanalyze;
+			cand->ac_wraparound = wraparound;
+			cand->ac_score = score;
+			candidates = lappend(candidates, cand);
+		}
+
+		if (relopts)
+			pfree(relopts);
+		if (tabentry)
+			pfree(tabentry);
+	}
+	table_endscan(relScan);
+	table_close(classRel, AccessShareLock);
+
+	list_sort(candidates, av_candidate_cmp);
+
+	foreach_ptr(av_candidate, cand, candidates)
+	{
+		Datum		values[PG_STAT_GET_AUTOVACUUM_QUEUE_COLS];
+		bool		nulls[PG_STAT_GET_AUTOVACUUM_QUEUE_COLS] = {0};
+
+		values[0] = ObjectIdGetDatum(cand->ac_relid);
+		values[1] = BoolGetDatum(cand->ac_dovacuum);
+		values[2] = BoolGetDatum(cand->ac_doanalyze);
+		values[3] = BoolGetDatum(cand->ac_wraparound);
+		values[4] = Float8GetDatum(cand->ac_score);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+							 values, nulls);
+	}
+
+	return (Datum) 0;
+}
+
 /*
  * autovacuum_do_vac_analyze
  *		Vacuum and/or analyze the specified table
@@ -3284,6 +3485,10 @@ autovac_report_workitem(AutoVacuumWorkItem *workitem,
 			snprintf(activity, MAX_AUTOVAC_ACTIV_LEN,
 					 "autovacuum: BRIN summarize");
 			break;
+		case AVW_GINCleanupPendingList:
+			snprintf(activity, MAX_AUTOVAC_ACTIV_LEN,
+					 "autovacuum: GIN pending list cleanup");
+			break;
 	}
 
 	/*
@@ -3321,6 +3526,9 @@ AutoVacuumingActive(void)
 /*
  * Request one work item to the next autovacuum run processing our database.
  * Return false if the request can't be recorded.
+ *
+ * If an identical request is already waiting to be processed, that one is
+ * good enough, and we report success without recording another.
  */
 bool
 AutoVacuumRequestWork(AutoVacuumWorkItemType type, Oid relationId,
@@ -3331,6 +3539,21 @@ AutoVacuumRequestWork(AutoVacuumWorkItemType type, Oid relationId,
 
 	LWLockAcquire(AutovacuumLock, LW_EXCLUSIVE);
 
+	for (i = 0; i < NUM_WORKITEMS; i++)
+	{
+		AutoVacuumWorkItem *workitem = &AutoVacuumShmem->av_workItems[i];
+
+		if (workitem->avw_used && !workitem->avw_active &&
+			workitem->avw_type == type &&
+			workitem->avw_database == MyDatabaseId &&
+			workitem->avw_relation == relationId &&
+			workitem->avw_blockNumber == blkno)
+		{
+			LWLockRelease(AutovacuumLock);
+			return true;
+		}
+	}
+
 	/*
 	 * Locate an unused work item and fill it with the given data.
 	 */
@@ -0,0 +1,499 @@
+/*-------------------------------------------------------------------------
+ *
+ * background_prune.c
+ *	  Background pruning of recently modified heap pages.
+ *
+ * After an UPDATE or DELETE, the first queries to read the modified pages
+ * prune them and set the hint bits of the tuples, which dirties the pages
+ * and, with data checksums or wal_log_hints, writes full-page images to the
+ * WAL.  So after a bulk update, reads are slow for a while.  When
+ * background_prune_queue_size is set, heap_update() and heap_delete()
+ * instead put the pages they modify in a queue in shared memory, and
+ * background workers prune the pages and set the hint bits once the
+ * modifying transactions have ended, ahead of the readers.
+ *
+ * The queue is served by a launcher, which starts a worker connected to the
+ * database of the entry at the head of the queue.  The worker processes the
+ * entries of its database until it reaches the entry of another database,
+ * or the end of the queue, and then exits, and the launcher starts the next
+ * one.  Entries are only removed from the queue once they have been
+ * processed; if the worker fails, for example because the database has been
+ * dropped, the launcher discards the entries of its database at the head of
+ * the queue so as not to get stuck on them.
+ *
+ * This is all opportunistic: when the queue is full, pages are not queued,
+ * and a page is not pruned if someone else holds a pin on it.  The queries
+ * that read those pages will do the work, as they would have anyway.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/background_prune.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "access/xact.h"
+#include "catalog/pg_am_d.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/background_prune.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/interrupt.h"
+#include "storage/bufmgr.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lmgr.h"
+#include "storage/procarray.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/guc.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/wait_event.h"
+
+/* GUC parameters */
+int			background_prune_queue_size = 0;
+
+/* How long to sleep when there's nothing to do, in ms */
+#define BGPRUNE_NAPTIME			1000
+
+/* Max number of entries a worker processes in one transaction */
+#define BGPRUNE_BATCH_SIZE		256
+
+/*
+ * One queued page, and the transaction that modified it.
+ */
+typedef struct BackgroundPruneEntry
+{
+	Oid			dbid;
+	Oid			relid;
+	BlockNumber blkno;
+	TransactionId xid;
+} BackgroundPruneEntry;
+
+/*
+ * The queue.  Backends append entries at the tail, and the worker, of which
+ * there is only one at a time, removes them from the head.  'mutex' protects
+ * both positions and the entries.
+ */
+typedef struct BackgroundPruneQueue
+{
+	slock_t		mutex;
+	uint64		head;			/* # of entries ever removed */
+	uint64		tail;			/* # of entries ever added */
+	BackgroundPruneEntry entries[FLEXIBLE_ARRAY_MEMBER];
+} BackgroundPruneQueue;
+
+static BackgroundPruneQueue *BackgroundPruneShmem = NULL;
+
+static int	bgprune_peek(BackgroundPruneEntry *entries, int max_entries,
+						 uint64 *head);
+static void bgprune_remove(int nentries);
+static void bgprune_discard(uint64 head, Oid dbid);
+static void bgprune_process(BackgroundPruneEntry *entries, int nentries,
+							BufferAccessStrategy strategy);
+static void bgprune_page(Relation relation, BlockNumber blkno,
+						 TransactionId oldest_xmin,
+						 BufferAccessStrategy strategy);
+
+Size
+BackgroundPruneShmemSize(void)
+{
+	if (background_prune_queue_size == 0)
+		return 0;
+
+	return add_size(offsetof(BackgroundPruneQueue, entries),
+					mul_size(background_prune_queue_size,
+							 sizeof(BackgroundPruneEntry)));
+}
+
+void
+BackgroundPruneShmemInit(void)
+{
+	bool		found;
+
+	if (background_prune_queue_size == 0)
+		return;
+
+	BackgroundPruneShmem = (BackgroundPruneQueue *)
+		ShmemInitStruct("Background Prune Queue", BackgroundPruneShmemSize(),
+						&found);
+	if (!found)
+	{
+		SpinLockInit(&BackgroundPruneShmem->mutex);
+		BackgroundPruneShmem->head = 0;
+		BackgroundPruneShmem->tail = 0;
+	}
+}
+
+/*
+ * Register the launcher background worker.  Called by the postmaster at
+ * startup.
+ */
+void
+BackgroundPruneRegister(void)
+{
+	BackgroundWorker bgw;
+
+	if (background_prune_queue_size == 0)
+		return;
+
+	memset(&bgw, 0, sizeof(bgw));
+	bgw.bgw_flags = BGWORKER_SHMEM_ACCESS;
+	bgw.bgw_start_time = BgWorkerStart_RecoveryFinished;
+	snprintf(bgw.bgw_library_name, MAXPGPATH, "postgres");
+	snprintf(bgw.bgw_function_name, BGW_MAXLEN, "BackgroundPruneLauncherMain");
+	snprintf(bgw.bgw_name, BGW_MAXLEN, "background pruner launcher");
+	snprintf(bgw.bgw_type, BGW_MAXLEN, "background pruner launcher");
+	bgw.bgw_restart_time = 5;
+	bgw.bgw_notify_pid = 0;
+	bgw.bgw_main_arg = (Datum) 0;
+
+	RegisterBackgroundWorker(&bgw);
+}
+
+/*
+ * BackgroundPruneEnqueue
+ *		Queue a heap page that transaction 'xid' just modified.
+ *
+ * Called by heap_update() and heap_delete(), after releasing the buffer.
+ * A bulk modification typically hits the same page many times in a row, so
+ * we remember the last page queued and skip it without taking the lock.
+ */
+void
+BackgroundPruneEnqueue(Relation relation, BlockNumber blkno, TransactionId xid)
+{
+	static Oid	last_relid = InvalidOid;
+	static BlockNumber last_blkno = InvalidBlockNumber;
+	static TransactionId last_xid = InvalidTransactionId;
+	BackgroundPruneQueue *queue = BackgroundPruneShmem;
+
+	if (queue == NULL)
+		return;
+
+	/* The workers can't see other backends' local buffers */
+	if (RelationUsesLocalBuffers(relation))
+		return;
+
+	if (RelationGetRelid(relation) == last_relid && blkno == last_blkno &&
+		xid == last_xid)
+		return;
+	last_relid = RelationGetRelid(relation);
+	last_blkno = blkno;
+	last_xid = xid;
+
+	SpinLockAcquire(&queue->mutex);
+	if (queue->tail - queue->head < (uint64) background_prune_queue_size)
+	{
+		BackgroundPruneEntry *entry;
+
+		entry = &queue->entries[queue->tail % background_prune_queue_size];
+		entry->dbid = MyDatabaseId;
+		entry->relid = last_relid;
+		entry->blkno = blkno;
+		entry->xid = xid;
+		queue->tail++;
+	}
+	SpinLockRelease(&queue->mutex);
+}
+
+/*
+ * Copy up to max_entries entries from the head of the queue, all of the same
+ * database as the first one, without removing them.  Returns the number of
+ * entries copied, and the position of the first one in *head.
+ */
+static int
+bgprune_peek(BackgroundPruneEntry *entries, int max_entries, uint64 *head)
+{
+	BackgroundPruneQueue *queue = BackgroundPruneShmem;
+	int			n = 0;
+
+	SpinLockAcquire(&queue->mutex);
+	*head = queue->head;
+	while (n < max_entries && queue->head + n < queue->tail)
+	{
+		BackgroundPruneEntry *entry;
+
+		entry = &queue->entries[(queue->head + n) % background_prune_queue_size];
+		if (n > 0 && entry->dbid != entries[0].dbid)
+			break;
+		entries[n++] = *entry;
+	}
+	SpinLockRelease(&queue->mutex);
+
+	return n;
+}
+
+/*
+ * Remove entries from the head of the queue, once processed.
+ */
+static void
+bgprune_remove(int nentries)
+{
+	BackgroundPruneQueue *queue = BackgroundPruneShmem;
+
+	SpinLockAcquire(&queue->mutex);
+	Assert(queue->head + nentries <= queue->tail);
+	queue->head += nentries;
+	SpinLockRelease(&queue->mutex);
+}
+
+/*
+ * Discard the entries of database 'dbid' at the head of the queue, if the
+ * head is still at 'head', meaning that the worker for that database
+ * couldn't process any of them.
+ */
+static void
+bgprune_discard(uint64 head, Oid dbid)
+{
+	BackgroundPruneQueue *queue = BackgroundPruneShmem;
+	int			ndiscarded = 0;
+
+	SpinLockAcquire(&queue->mutex);
+	if (queue->head == head)
+	{
+		while (queue->head < queue->tail &&
+			   queue->entries[queue->head % background_prune_queue_size].dbid == dbid)
+		{
+			queue->head++;
+			ndiscarded++;
+		}
+	}
+	SpinLockRelease(&queue->mutex);
+
+	if (ndiscarded > 0)
+		ereport(LOG,
+				(errmsg("background pruner discarded %d queued pages of database %u",
+						ndiscarded, dbid)));
+}
+
+/*
+ * Main entry point of the launcher.
+ */
+void
+BackgroundPruneLauncherMain(Datum main_arg)
+{
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	for (;;)
+	{
+		BackgroundPruneEntry entry;
+		uint64		head;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (ConfigReloadPending)
+		{
+			ConfigReloadPending = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		if (bgprune_peek(&entry, 1, &head) > 0)
+		{
+			BackgroundWorker worker;
+			BackgroundWorkerHandle *handle;
+
+			memset(&worker, 0, sizeof(worker));
+			worker.bgw_flags = BGWORKER_SHMEM_ACCESS |
+				BGWORKER_BACKEND_DATABASE_CONNECTION;
+			worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+			worker.bgw_restart_time = BGW_NEVER_RESTART;
+			snprintf(worker.bgw_library_name, MAXPGPATH, "postgres");
+			snprintf(worker.bgw_function_name, BGW_MAXLEN, "BackgroundPruneWorkerMain");
+			snprintf(worker.bgw_name, BGW_MAXLEN, "background pruner");
+			snprintf(worker.bgw_type, BGW_MAXLEN, "background pruner");
+			worker.bgw_main_arg = ObjectIdGetDatum(entry.dbid);
+			worker.bgw_notify_pid = MyProcPid;
+
+			if (RegisterDynamicBackgroundWorker(&worker, &handle))
+			{
+				if (WaitForBackgroundWorkerShutdown(handle) == BGWH_POSTMASTER_DIED)
+					proc_exit(1);
+				pfree(handle);
+
+				bgprune_discard(head, entry.dbid);
+				continue;
+			}
+
+			/* No free worker slot; try again later */
+		}
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 BGPRUNE_NAPTIME,
+						 WAIT_EVENT_BACKGROUND_PRUNE_MAIN);
+		ResetLatch(MyLatch);
+	}
+}
+
+/*
+ * Main entry point of a worker, processing the entries of one database.
+ */
+void
+BackgroundPruneWorkerMain(Datum main_arg)
+{
+	Oid			dbid = DatumGetObjectId(main_arg);
+	BackgroundPruneEntry *entries;
+	BufferAccessStrategy strategy;
+
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	BackgroundWorkerInitializeConnectionByOid(dbid, InvalidOid, 0);
+
+	entries = palloc_array(BackgroundPruneEntry, BGPRUNE_BATCH_SIZE);
+	strategy = GetAccessStrategy(BAS_VACUUM);
+
+	for (;;)
+	{
+		uint64		head;
+		int			nentries;
+		int			nready;
+
+		CHECK_FOR_INTERRUPTS();
+
+		nentries = bgprune_peek(entries, BGPRUNE_BATCH_SIZE, &head);
+		if (nentries == 0 || entries[0].dbid != MyDatabaseId)
+			break;
+
+		StartTransactionCommand();
+		PushActiveSnapshot(GetTransactionSnapshot());
+
+		/*
+		 * Stop at the first entry whose transaction hasn't ended yet; until
+		 * it has, there is nothing to prune and its hint bits can't be set.
+		 */
+		for (nready = 0; nready < nentries; nready++)
+		{
+			TransactionId xid = entries[nready].xid;
+
+			if (TransactionIdIsValid(xid) && TransactionIdIsInProgress(xid))
+				break;
+		}
+
+		bgprune_process(entries, nready, strategy);
+
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+
+		bgprune_remove(nready);
+
+		if (nready < nentries)
+		{
+			(void) WaitLatch(MyLatch,
+							 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+							 BGPRUNE_NAPTIME,
+							 WAIT_EVENT_BACKGROUND_PRUNE_DELAY);
+			ResetLatch(MyLatch);
+		}
+	}
+
+	proc_exit(0);
+}
+
+/*
+ * Process a batch of entries, in a transaction.
+ */
+static void
+bgprune_process(BackgroundPruneEntry *entries, int nentries,
+				BufferAccessStrategy strategy)
+{
+	Relation	relation = NULL;
+	Oid			relid = InvalidOid;
+	BlockNumber nblocks = 0;
+	TransactionId oldest_xmin = InvalidTransactionId;
+
+	for (int i = 0; i < nentries; i++)
+	{
+		BackgroundPruneEntry *entry = &entries[i];
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* Entries of the same relation usually come in a row */
+		if (entry->relid != relid)
+		{
+			if (relation != NULL)
+				relation_close(relation, AccessShareLock);
+			relation = NULL;
+			relid = entry->relid;
+
+			/* Don't wait behind DDL; skip the relation instead */
+			if (!ConditionalLockRelationOid(relid, AccessShareLock))
+				continue;
+			relation = try_relation_open(relid, NoLock);
+			if (relation == NULL)
+			{
+				UnlockRelationOid(relid, AccessShareLock);
+				continue;
+			}
+			if (relation->rd_rel->relam != HEAP_TABLE_AM_OID)
+			{
+				relation_close(relation, AccessShareLock);
+				relation = NULL;
+				continue;
+			}
+
+			nblocks = RelationGetNumberOfBlocks(relation);
+			oldest_xmin = GetOldestNonRemovableTransactionId(relation);
+		}
+
+		/* the relation may have been truncated since */
+		if (relation != NULL && entry->blkno < nblocks)
+			bgprune_page(relation, entry->blkno, oldest_xmin, strategy);
+	}
+
+	if (relation != NULL)
+		relation_close(relation, AccessShareLock);
+}
+
+/*
+ * Prune one page, if possible, and set the hint bits of its tuples.
+ */
+static void
+bgprune_page(Relation relation, BlockNumber blkno, TransactionId oldest_xmin,
+			 BufferAccessStrategy strategy)
+{
+	Buffer		buffer;
+	Page		page;
+
+	buffer = ReadBufferExtended(relation, MAIN_FORKNUM, blkno, RBM_NORMAL,
+								strategy);
+
+	heap_page_prune_background(relation, buffer);
+
+	/*
+	 * Setting hint bits only requires a share lock, like in any scan.  The
+	 * tuples of an all-visible page aren't checked by scans, so don't bother.
+	 */
+	LockBuffer(buffer, BUFFER_LOCK_SHARE);
+	page = BufferGetPage(buffer);
+	if (!PageIsAllVisible(page))
+	{
+		OffsetNumber maxoff = PageGetMaxOffsetNumber(page);
+
+		for (OffsetNumber offnum = FirstOffsetNumber;
+			 offnum <= maxoff;
+			 offnum = OffsetNumberNext(offnum))
+		{
+			ItemId		itemid = PageGetItemId(page, offnum);
+			HeapTupleData tuple;
+
+			if (!ItemIdIsNormal(itemid))
+				continue;
+
+			tuple.t_data = (HeapTupleHeader) PageGetItem(page, itemid);
+			tuple.t_len = ItemIdGetLength(itemid);
+			tuple.t_tableOid = RelationGetRelid(relation);
+			ItemPointerSet(&tuple.t_self, blkno, offnum);
+
+			(void) HeapTupleSatisfiesVacuum(&tuple, oldest_xmin, buffer);
+		}
+	}
+	UnlockReleaseBuffer(buffer);
+}
@@ -17,7 +17,10 @@
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "port/atomics.h"
+#include "postmaster/background_prune.h"
 #include "postmaster/bgworker_internals.h"
+#include "postmaster/connproxy.h"
+#include "postmaster/session_history.h"
 #include "postmaster/postmaster.h"
 #include "replication/logicallauncher.h"
 #include "replication/logicalworker.h"
@@ -133,8 +136,23 @@ static const struct
 	{
 		"TableSyncWorkerMain", TableSyncWorkerMain
 	},
+	{
+		"ParallelTableSyncWorkerMain", ParallelTableSyncWorkerMain
+	},
 	{
 		"SequenceSyncWorkerMain", SequenceSyncWorkerMain
+	},
+	{
+		"ConnProxyMain", ConnProxyMain
+	},
+	{
+		"SessionHistoryMain", SessionHistoryMain
+	},
+	{
+		"BackgroundPruneLauncherMain", BackgroundPruneLauncherMain
+	},
+	{
+		"BackgroundPruneWorkerMain", BackgroundPruneWorkerMain
 	}
 };
 
@@ -1363,6 +1381,58 @@ LookupBackgroundWorkerFunction(const char *libraryname, const char *funcname)
 		load_external_function(libraryname, funcname, true, NULL);
 }
 
+/*
+ * Identify the slot of the calling background worker, so that another
+ * process can obtain a handle for it with MakeBackgroundWorkerHandle().
+ * Returns false if the postmaster hasn't recorded our PID yet.
+ */
+bool
+GetMyBackgroundWorkerSlot(int *slotno, uint64 *generation)
+{
+	bool		found = false;
+
+	Assert(MyBgworkerEntry != NULL);
+
+	LWLockAcquire(BackgroundWorkerLock, LW_SHARED);
+
+	for (int i = 0; i < BackgroundWorkerData->total_slots; i++)
+	{
+		BackgroundWorkerSlot *slot = &BackgroundWorkerData->slot[i];
+
+		if (slot->in_use && slot->pid == MyProcPid)
+		{
+			*slotno = i;
+			*generation = slot->generation;
+			found = true;
+			break;
+		}
+	}
+
+	LWLockRelease(BackgroundWorkerLock);
+
+	return found;
+}
+
+/*
+ * Construct a handle for the worker identified by GetMyBackgroundWorkerSlot().
+ *
+ * The handle is allocated in the current memory context.  If the worker has
+ * exited meanwhile, the handle behaves like that of any stopped worker.
+ */
+BackgroundWorkerHandle *
+MakeBackgroundWorkerHandle(int slotno, uint64 generation)
+{
+	BackgroundWorkerHandle *handle;
+
+	Assert(slotno >= 0 && slotno < max_worker_processes);
+
+	handle = palloc_object(BackgroundWorkerHandle);
+	handle->slot = slotno;
+	handle->generation = generation;
+
+	return handle;
+}
+
 /*
  * Given a PID, get the bgw_type of the background worker.  Returns NULL if
  * not a valid background worker.
@@ -169,6 +169,43 @@ static pg_time_t ckpt_start_time;
 static XLogRecPtr ckpt_start_recptr;
 static double ckpt_cached_elapsed;
 
+/*
+ * Shape of WAL generation over a checkpoint cycle, for checkpoint pacing.
+ *
+ * WAL is generated much faster right after a checkpoint starts than later
+ * on, because the first modification of each page after the checkpoint
+ * WAL-logs a full-page image.  Pacing the writes by the fraction of
+ * max_wal_size consumed then makes the checkpoint look behind schedule at
+ * the start, and it writes in a burst, just when the full-page images also
+ * put the most pressure on I/O.  So we sample the WAL position against time
+ * while writing a checkpoint, and when the next checkpoint is triggered by
+ * WAL volume, turn the samples into a curve giving the fraction of the
+ * cycle's duration that had elapsed when each fraction of its WAL had been
+ * generated.  The next checkpoint's WAL-based progress is mapped through
+ * that curve.
+ */
+#define CKPT_WAL_SAMPLES		64
+#define CKPT_WAL_CURVE_POINTS	16
+
+typedef struct CkptWalSample
+{
+	double		secs;			/* time since the cycle started */
+	double		bytes;			/* WAL generated since the cycle started */
+} CkptWalSample;
+
+static CkptWalSample ckpt_wal_samples[CKPT_WAL_SAMPLES];
+static int	ckpt_wal_nsamples = 0;
+static double ckpt_wal_sample_interval;
+static bool ckpt_wal_cycle_valid = false;	/* samples are of a checkpoint */
+static double ckpt_wal_curve[CKPT_WAL_CURVE_POINTS + 1];
+static bool ckpt_wal_curve_valid = false;
+
+/*
+ * Duration of the previous checkpoint's sync phase, which the write phase
+ * leaves room for.
+ */
+static double ckpt_prev_sync_secs = 0;
+
 static pg_time_t last_checkpoint_time;
 static pg_time_t last_xlog_switch_time;
 
@@ -177,6 +214,9 @@ static pg_time_t last_xlog_switch_time;
 static void ProcessCheckpointerInterrupts(void);
 static void CheckArchiveTimeout(void);
 static bool IsCheckpointOnSchedule(double progress);
+static void CheckpointWalSample(double secs, double bytes);
+static void CheckpointWalCurveUpdate(pg_time_t now, XLogRecPtr recptr);
+static double CheckpointWalCurveMap(double elapsed_xlogs);
 static bool FastCheckpointRequested(void);
 static bool CompactCheckpointerRequestQueue(void);
 static void UpdateSharedMemoryConfig(void);
@@ -482,9 +522,21 @@ CheckpointerMain(const void *startup_data, size_t startup_data_len)
 			if (do_restartpoint)
 				ckpt_start_recptr = GetXLogReplayRecPtr(NULL);
 			else
-				ckpt_start_recptr = GetInsertRecPtr();
+			{
+				XLogRecPtr	recptr = GetInsertRecPtr();
+
+				/* Learn from the cycle that is ending, before forgetting it */
+				if (ckpt_wal_cycle_valid && (flags & CHECKPOINT_CAUSE_XLOG))
+					CheckpointWalCurveUpdate(now, recptr);
+				else
+					ckpt_wal_curve_valid = false;
+				ckpt_start_recptr = recptr;
+			}
 			ckpt_start_time = now;
 			ckpt_cached_elapsed = 0;
+			ckpt_wal_nsamples = 0;
+			ckpt_wal_sample_interval = (double) CheckPointTimeout / CKPT_WAL_SAMPLES;
+			ckpt_wal_cycle_valid = !do_restartpoint;
 
 			/*
 			 * Do the checkpoint.
@@ -494,6 +546,11 @@ CheckpointerMain(const void *startup_data, size_t startup_data_len)
 			else
 				ckpt_performed = CreateRestartPoint(flags);
 
+			if (ckpt_performed)
+				ckpt_prev_sync_secs =
+					TimestampDifferenceMilliseconds(CheckpointStats.ckpt_sync_t,
+													CheckpointStats.ckpt_sync_end_t) / 1000.0;
+
 			/*
 			 * After any checkpoint, free all smgr objects.  Otherwise we
 			 * would never do so for dropped relations, as the checkpointer
@@ -856,6 +913,11 @@ CheckpointWriteDelay(int flags, double progress)
  * Compares the current progress against the time/segments elapsed since last
  * checkpoint, and returns true if the progress we've made this far is greater
  * than the elapsed time/segments.
+ *
+ * The WAL-based estimate is corrected for the burst of full-page images at
+ * the start of the cycle, see ckpt_wal_curve, and the time-based one leaves
+ * room for a sync phase as long as the previous checkpoint's, so that slow
+ * fsyncs don't make the checkpoint overrun.
  */
 static bool
 IsCheckpointOnSchedule(double progress)
@@ -863,7 +925,9 @@ IsCheckpointOnSchedule(double progress)
 	XLogRecPtr	recptr;
 	struct timeval now;
 	double		elapsed_xlogs,
-				elapsed_time;
+				elapsed_time,
+				elapsed_secs;
+	bool		in_recovery;
 
 	Assert(ckpt_active);
 
@@ -899,12 +963,22 @@ IsCheckpointOnSchedule(double progress)
 	 * checkpoint_completion_target where checkpoint_completion_target is the
 	 * value that was in effect when the WAL was generated).
 	 */
-	if (RecoveryInProgress())
+	in_recovery = RecoveryInProgress();
+	if (in_recovery)
 		recptr = GetXLogReplayRecPtr(NULL);
 	else
 		recptr = GetInsertRecPtr();
+	gettimeofday(&now, NULL);
+	elapsed_secs = (double) ((pg_time_t) now.tv_sec - ckpt_start_time) +
+		now.tv_usec / 1000000.0;
+
+	if (!in_recovery)
+		CheckpointWalSample(elapsed_secs, (double) (recptr - ckpt_start_recptr));
+
 	elapsed_xlogs = (((double) (recptr - ckpt_start_recptr)) /
 					 wal_segment_size) / CheckPointSegments;
+	if (!in_recovery)
+		elapsed_xlogs = CheckpointWalCurveMap(elapsed_xlogs);
 
 	if (progress < elapsed_xlogs)
 	{
@@ -913,11 +987,12 @@ IsCheckpointOnSchedule(double progress)
 	}
 
 	/*
-	 * Check progress against time elapsed and checkpoint_timeout.
+	 * Check progress against time elapsed and checkpoint_timeout, counting
+	 * the time the sync phase will presumably take as already elapsed.
 	 */
-	gettimeofday(&now, NULL);
-	elapsed_time = ((double) ((pg_time_t) now.tv_sec - ckpt_start_time) +
-					now.tv_usec / 1000000.0) / CheckPointTimeout;
+	elapsed_time = (elapsed_secs +
+					Min(ckpt_prev_sync_secs, CheckPointTimeout / 2.0)) /
+		CheckPointTimeout;
 
 	if (progress < elapsed_time)
 	{
@@ -929,6 +1004,119 @@ IsCheckpointOnSchedule(double progress)
 	return true;
 }
 
+/*
+ * CheckpointWalSample -- remember the WAL generated at a point of the cycle
+ *
+ * Samples are taken at most every ckpt_wal_sample_interval seconds.  If the
+ * cycle outlasts the space for them, every other sample is dropped and the
+ * interval doubled.
+ */
+static void
+CheckpointWalSample(double secs, double bytes)
+{
+	if (ckpt_wal_nsamples > 0 &&
+		secs - ckpt_wal_samples[ckpt_wal_nsamples - 1].secs < ckpt_wal_sample_interval)
+		return;
+
+	if (ckpt_wal_nsamples == CKPT_WAL_SAMPLES)
+	{
+		for (int i = 0; i < CKPT_WAL_SAMPLES / 2; i++)
+			ckpt_wal_samples[i] = ckpt_wal_samples[2 * i + 1];
+		ckpt_wal_nsamples = CKPT_WAL_SAMPLES / 2;
+		ckpt_wal_sample_interval *= 2;
+	}
+
+	ckpt_wal_samples[ckpt_wal_nsamples].secs = secs;
+	ckpt_wal_samples[ckpt_wal_nsamples].bytes = bytes;
+	ckpt_wal_nsamples++;
+}
+
+/*
+ * CheckpointWalCurveUpdate -- compute ckpt_wal_curve from the cycle ending
+ *
+ * 'now' and 'recptr' are the time and WAL position at which the next
+ * checkpoint starts.  The samples, which only cover the write phase of the
+ * checkpoint, are completed by the start and the end of the cycle, and
+ * interpolated linearly.
+ */
+static void
+CheckpointWalCurveUpdate(pg_time_t now, XLogRecPtr recptr)
+{
+	double		total_secs = (double) (now - ckpt_start_time);
+	double		total_bytes = (double) (recptr - ckpt_start_recptr);
+	double		prev_secs = 0,
+				prev_bytes = 0;
+	int			next = 0;
+
+	/* Not enough to go on */
+	if (total_secs < 1 || total_bytes < wal_segment_size)
+	{
+		ckpt_wal_curve_valid = false;
+		return;
+	}
+
+	for (int k = 0; k <= CKPT_WAL_CURVE_POINTS; k++)
+	{
+		double		bytes = total_bytes * k / CKPT_WAL_CURVE_POINTS;
+		double		secs;
+
+		/* find the first sample at or beyond this much WAL */
+		while (next < ckpt_wal_nsamples &&
+			   ckpt_wal_samples[next].bytes < bytes)
+		{
+			prev_secs = ckpt_wal_samples[next].secs;
+			prev_bytes = ckpt_wal_samples[next].bytes;
+			next++;
+		}
+
+		if (next < ckpt_wal_nsamples)
+		{
+			double		next_secs = ckpt_wal_samples[next].secs;
+			double		next_bytes = ckpt_wal_samples[next].bytes;
+
+			if (next_bytes > prev_bytes)
+				secs = prev_secs + (next_secs - prev_secs) *
+					(bytes - prev_bytes) / (next_bytes - prev_bytes);
+			else
+				secs = prev_secs;
+		}
+		else if (total_bytes > prev_bytes)
+			secs = prev_secs + (total_secs - prev_secs) *
+				(bytes - prev_bytes) / (total_bytes - prev_bytes);
+		else
+			secs = prev_secs;
+
+		ckpt_wal_curve[k] = Min(Max(secs / total_secs, 0.0), 1.0);
+	}
+
+	ckpt_wal_curve_valid = true;
+}
+
+/*
+ * CheckpointWalCurveMap -- map WAL-based progress through ckpt_wal_curve
+ *
+ * In case the workload changed since the curve was learned, never consider
+ * less than the square of the fraction of WAL consumed as elapsed, so that
+ * the checkpoint can't fall too far behind.
+ */
+static double
+CheckpointWalCurveMap(double elapsed_xlogs)
+{
+	double		pos,
+				result;
+	int			k;
+
+	if (!ckpt_wal_curve_valid || elapsed_xlogs >= 1.0 || elapsed_xlogs <= 0.0)
+		return elapsed_xlogs;
+
+	pos = elapsed_xlogs * CKPT_WAL_CURVE_POINTS;
+	k = (int) pos;
+	result = ckpt_wal_curve[k] +
+		(ckpt_wal_curve[k + 1] - ckpt_wal_curve[k]) * (pos - k);
+
+	return Max(result, elapsed_xlogs * elapsed_xlogs);
+}
+
 
 /* --------------------------------
  *		signal handler routines
@@ -0,0 +1,1566 @@
+/*-------------------------------------------------------------------------
+ *
+ * connproxy.c
+ *	  Connection proxies, which multiplex client sessions onto a pool of
+ *	  backends.
+ *
+ * When connection_proxies is set, the postmaster listens on proxy_port in
+ * addition to the regular port.  A connection made to the proxy port starts
+ * out like any other: a backend is forked for it, which authenticates the
+ * client and sets up the session.  But when the backend is ready for the
+ * first query, it hands the client socket over to one of the proxies,
+ * together with one end of a fresh socket pair that it keeps talking to the
+ * proxy over from then on.  The proxy is chosen by hashing the database, the
+ * user and the startup options, so that all sessions that could share a
+ * backend end up in the same proxy and in the same pool there.
+ *
+ * A proxy relays the protocol traffic of each client to a backend of its
+ * pool, but binds the two together only until the end of each transaction:
+ * when a backend reports ReadyForQuery in idle state, it returns to the pool
+ * and can serve any other client of the pool.  A pool grows by the backends
+ * that hand clients over to it, up to session_pool_size; surplus backends
+ * are told to exit.
+ *
+ * Prepared statements of the extended query protocol are given names that
+ * are unique within the proxy, and are created on demand in whichever
+ * backend a client's Bind or Describe happens to reach, from the Parse
+ * message the proxy remembers for them.  Any other state that outlives a
+ * transaction, such as temporary tables, holdable cursors, LISTEN,
+ * session-level advisory locks or a SET, pins the session to its backend
+ * for good: the backend tells the proxy with a ParameterStatus message, and
+ * the proxy takes it out of the pool.
+ *
+ * The handover uses SCM_RIGHTS, over datagram socket pairs that the
+ * postmaster creates for each proxy at startup, so this isn't available on
+ * Windows.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/connproxy.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "common/hashfn.h"
+#include "libpq/libpq.h"
+#include "libpq/pqformat.h"
+#include "libpq/protocol.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/pg_bswap.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/connproxy.h"
+#include "postmaster/interrupt.h"
+#include "storage/fd.h"
+#include "storage/latch.h"
+#include "tcop/tcopprot.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+/* GUC parameters */
+int			ConnectionProxies = 0;
+int			ProxyPortNumber = 6543;
+int			SessionPoolSize = 10;
+
+/*
+ * Datagram socket pairs for handing clients over to each proxy.  Backends
+ * send on the second socket, the proxy receives on the first.
+ */
+pgsocket	ConnProxySockets[MAX_CONNECTION_PROXIES][2];
+
+/* ParameterStatus by which a backend tells its proxy that it is pinned */
+#define CONN_PROXY_PINNED_PARAM		"session_pinned"
+
+/* Prefix of the names given to prepared statements in the backends */
+#define CONN_PROXY_STMT_PREFIX		"_pool_"
+
+/* Stop reading from a socket when this much input is left unprocessed */
+#define CONN_PROXY_BUFFER_LIMIT		(64 * 1024)
+
+/* Maximum size of a handover message */
+#define CONN_PROXY_HANDOFF_MAX		(64 * 1024)
+
+/*
+ * Handover message sent by a backend, followed by the pool key and by any
+ * input the backend had already received from the client but not consumed.
+ * The client socket and the backend's end of its new socket pair come along
+ * as ancillary data, in that order.
+ */
+typedef struct ConnProxyHandoff
+{
+	int32		pid;			/* PID of the backend */
+	int32		keylen;			/* length of the pool key */
+	int32		unreadlen;		/* length of the unread client input */
+} ConnProxyHandoff;
+
+/*
+ * One socket of a proxy, leading to either a client or a backend.
+ */
+typedef struct ProxyChannel
+{
+	bool		is_client;
+	pgsocket	sock;
+	StringInfoData in;			/* received data; cursor is the next
+								 * unprocessed byte */
+	StringInfoData out;			/* data to send; cursor is the next unsent
+								 * byte */
+	bool		eof;			/* connection closed by the other side? */
+	bool		closing;		/* close once all output is sent? */
+	bool		closed;
+	int			pos;			/* position in proxy_wait_set, or -1 */
+	uint32		events;			/* events registered in proxy_wait_set */
+} ProxyChannel;
+
+typedef struct ProxyPool ProxyPool;
+typedef struct ProxyBackend ProxyBackend;
+
+typedef struct ProxyClient
+{
+	ProxyChannel ch;			/* must be first */
+	ProxyPool  *pool;
+	ProxyBackend *backend;		/* backend serving us, if any */
+	bool		waiting;		/* queued for a backend? */
+	HTAB	   *stmts;			/* prepared statements, by client's name */
+} ProxyClient;
+
+struct ProxyBackend
+{
+	ProxyChannel ch;			/* must be first */
+	int			pid;
+	ProxyPool  *pool;			/* NULL when no longer in the pool */
+	ProxyClient *client;		/* client being served, if any */
+	bool		pinned;			/* bound to its client for good? */
+	bool		terminating;	/* told to exit? */
+	bool		unsynced;		/* extended-protocol messages sent since the
+								 * last Sync? */
+	List	   *pending;		/* ProxyPending, for each message sent that
+								 * awaits a response */
+	List	   *stmts;			/* serials of statements prepared here */
+	List	   *closes;			/* serials of statements to close once idle */
+};
+
+struct ProxyPool
+{
+	char	   *key;
+	int			keylen;
+	List	   *backends;		/* ProxyBackend */
+	List	   *waiting;		/* ProxyClient, in order of arrival */
+};
+
+/*
+ * A prepared statement of a client, as known to the proxy.
+ */
+typedef struct ProxyStatement
+{
+	char		name[NAMEDATALEN];	/* hash key, the client's name */
+	int			serial;			/* unique number, used for the backend name */
+	bool		valid;			/* Parse completed successfully? */
+	char	   *parse;			/* Parse message with the backend name */
+	int			parselen;
+} ProxyStatement;
+
+typedef enum ProxyPendingType
+{
+	PENDING_PARSE,
+	PENDING_CLOSE,
+	PENDING_SYNC,
+} ProxyPendingType;
+
+typedef struct ProxyPending
+{
+	ProxyPendingType type;
+	bool		injected;		/* sent by the proxy, not the client? */
+	int			serial;			/* statement, or 0 if not tracked */
+	char		name[NAMEDATALEN];	/* client's name for the statement */
+} ProxyPending;
+
+static List *proxy_pools = NIL;
+static List *proxy_channels = NIL;
+static WaitEventSet *proxy_wait_set = NULL;
+static bool proxy_wait_set_stale = true;
+static pgsocket proxy_handoff_sock = PGINVALID_SOCKET;
+static int	proxy_next_serial = 0;
+
+#ifndef WIN32
+static void hand_off_client(void);
+static void proxy_accept_handoffs(void);
+static void proxy_new_session(pgsocket clientsock, pgsocket backendsock,
+							  const ConnProxyHandoff *hdr,
+							  const char *key, const char *unread);
+#endif
+static void proxy_update_wait_set(void);
+static void proxy_recv(ProxyChannel *ch);
+static bool proxy_send(ProxyChannel *ch);
+static bool proxy_process(ProxyChannel *ch);
+static void proxy_run(void);
+static void proxy_free_closed(void);
+static bool proxy_client_message(ProxyClient *client, int msglen);
+static bool proxy_backend_message(ProxyBackend *backend, int msglen);
+static void proxy_close_client(ProxyClient *client);
+static void proxy_backend_gone(ProxyBackend *backend);
+static void proxy_terminate_backend(ProxyBackend *backend);
+static void proxy_remove_from_pool(ProxyBackend *backend);
+static void proxy_client_error(ProxyClient *client, const char *msg);
+
+
+/*
+ * Called by a backend serving a client of the proxy port whenever it is
+ * about to send ReadyForQuery.
+ *
+ * The first time, hands the client over to a proxy; afterwards, reports to
+ * the proxy once the session has become pinned.
+ */
+void
+ConnProxyReadyForQuery(void)
+{
+	static bool handed_off = false;
+	static bool pin_reported = false;
+
+	if (!handed_off)
+	{
+#ifndef WIN32
+		hand_off_client();
+#else
+		elog(FATAL, "connection proxies are not supported on this platform");
+#endif
+		handed_off = true;
+	}
+
+	if (MySessionPinned && !pin_reported)
+	{
+		StringInfoData buf;
+
+		pq_beginmessage(&buf, PqMsg_ParameterStatus);
+		pq_sendstring(&buf, CONN_PROXY_PINNED_PARAM);
+		pq_sendstring(&buf, "on");
+		pq_endmessage(&buf);
+		pin_reported = true;
+	}
+}
+
+#ifndef WIN32
+
+/*
+ * Pass the client socket to the proxy responsible for the session's pool,
+ * and continue on a new socket leading to that proxy.
+ */
+static void
+hand_off_client(void)
+{
+	Port	   *port = MyProcPort;
+	StringInfoData msg;
+	ConnProxyHandoff hdr;
+	pgsocket	sv[2];
+	pgsocket	client_sock;
+	int			fds[2];
+	int			proxy;
+	ListCell   *gucopts;
+	struct msghdr mh;
+	struct iovec iov;
+	union
+	{
+		struct cmsghdr hdr;
+		char		buf[CMSG_SPACE(2 * sizeof(int))];
+	}			cmsgbuf;
+	struct cmsghdr *cmsg;
+
+	/*
+	 * Build the pool key.  Sessions can only share backends if they were
+	 * started with the same options, except for application_name, which
+	 * doesn't change behavior.
+	 */
+	memset(&hdr, 0, sizeof(hdr));
+	initStringInfo(&msg);
+	appendBinaryStringInfo(&msg, &hdr, sizeof(hdr));	/* filled in below */
+	appendBinaryStringInfo(&msg, port->database_name,
+						   strlen(port->database_name) + 1);
+	appendBinaryStringInfo(&msg, port->user_name,
+						   strlen(port->user_name) + 1);
+	if (port->cmdline_options)
+		appendStringInfoString(&msg, port->cmdline_options);
+	appendStringInfoChar(&msg, '\0');
+
+	gucopts = list_head(port->guc_options);
+	while (gucopts)
+	{
+		char	   *name;
+		char	   *value;
+
+		name = lfirst(gucopts);
+		gucopts = lnext(port->guc_options, gucopts);
+
+		value = lfirst(gucopts);
+		gucopts = lnext(port->guc_options, gucopts);
+
+		if (strcmp(name, "application_name") == 0)
+			continue;
+		appendBinaryStringInfo(&msg, name, strlen(name) + 1);
+		appendBinaryStringInfo(&msg, value, strlen(value) + 1);
+	}
+	hdr.keylen = msg.len - sizeof(hdr);
+
+	proxy = hash_bytes((unsigned char *) msg.data + sizeof(hdr),
+					   hdr.keylen) % ConnectionProxies;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+		ereport(FATAL,
+				(errcode_for_socket_access(),
+				 errmsg("could not create socket pair for connection proxy: %m")));
+
+	/* Everything sent so far must reach the client directly */
+	pq_flush();
+
+	client_sock = pq_switch_socket(sv[1], &msg);
+	hdr.pid = MyProcPid;
+	hdr.unreadlen = msg.len - sizeof(hdr) - hdr.keylen;
+	memcpy(msg.data, &hdr, sizeof(hdr));
+
+	if (msg.len > CONN_PROXY_HANDOFF_MAX)
+		ereport(FATAL,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("startup data too large to hand connection over to connection proxy")));
+
+	iov.iov_base = msg.data;
+	iov.iov_len = msg.len;
+	memset(&mh, 0, sizeof(mh));
+	mh.msg_iov = &iov;
+	mh.msg_iovlen = 1;
+	mh.msg_control = cmsgbuf.buf;
+	mh.msg_controllen = sizeof(cmsgbuf.buf);
+
+	cmsg = CMSG_FIRSTHDR(&mh);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(2 * sizeof(int));
+	fds[0] = client_sock;
+	fds[1] = sv[0];
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+	/*
+	 * The proxy might be busy, or not running at the moment, so don't block
+	 * in sendmsg() where we couldn't be interrupted.
+	 */
+	while (sendmsg(ConnProxySockets[proxy][1], &mh, MSG_DONTWAIT) < 0)
+	{
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR &&
+			errno != ENOBUFS)
+			ereport(FATAL,
+					(errcode_for_socket_access(),
+					 errmsg("could not hand connection over to connection proxy: %m")));
+
+		(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 10L, WAIT_EVENT_CONN_PROXY_HANDOFF);
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	/* The proxy has its own copies now */
+	closesocket(client_sock);
+	closesocket(sv[0]);
+	pfree(msg.data);
+}
+
+#endif							/* !WIN32 */
+
+/*
+ * Register the connection proxy background workers, and create the sockets
+ * for handing clients over to them.  Called by the postmaster at startup.
+ */
+void
+ConnProxyRegister(void)
+{
+#ifndef WIN32
+	BackgroundWorker bgw;
+#endif
+
+	if (ConnectionProxies == 0)
+		return;
+
+#ifdef WIN32
+	ereport(FATAL,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("connection proxies are not supported on this platform")));
+#else
+	for (int i = 0; i < ConnectionProxies; i++)
+	{
+		if (socketpair(AF_UNIX, SOCK_DGRAM, 0, ConnProxySockets[i]) < 0)
+			ereport(FATAL,
+					(errcode_for_socket_access(),
+					 errmsg("could not create socket pair for connection proxy: %m")));
+		ReserveExternalFD();
+		ReserveExternalFD();
+
+		memset(&bgw, 0, sizeof(bgw));
+		bgw.bgw_flags = BGWORKER_SHMEM_ACCESS;
+		bgw.bgw_start_time = BgWorkerStart_ConsistentState;
+		snprintf(bgw.bgw_library_name, MAXPGPATH, "postgres");
+		snprintf(bgw.bgw_function_name, BGW_MAXLEN, "ConnProxyMain");
+		snprintf(bgw.bgw_name, BGW_MAXLEN, "connection proxy %d", i);
+		snprintf(bgw.bgw_type, BGW_MAXLEN, "connection proxy");
+		bgw.bgw_restart_time = 5;
+		bgw.bgw_notify_pid = 0;
+		bgw.bgw_main_arg = Int32GetDatum(i);
+
+		RegisterBackgroundWorker(&bgw);
+	}
+#endif
+}
+
+/*
+ * Main entry point of a connection proxy.
+ */
+void
+ConnProxyMain(Datum main_arg)
+{
+	int			proxy = DatumGetInt32(main_arg);
+
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+#ifdef WIN32
+	elog(FATAL, "connection proxies are not supported on this platform");
+#else
+	proxy_handoff_sock = ConnProxySockets[proxy][0];
+	if (!pg_set_noblock(proxy_handoff_sock))
+		ereport(ERROR,
+				(errcode_for_socket_access(),
+				 errmsg("could not set socket to nonblocking mode: %m")));
+
+	for (;;)
+	{
+		WaitEvent	events[64];
+		int			nevents;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (ConfigReloadPending)
+		{
+			ConfigReloadPending = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		proxy_update_wait_set();
+		nevents = WaitEventSetWait(proxy_wait_set, -1, events,
+								   lengthof(events),
+								   WAIT_EVENT_CONN_PROXY_MAIN);
+
+		for (int i = 0; i < nevents; i++)
+		{
+			ProxyChannel *ch = (ProxyChannel *) events[i].user_data;
+
+			if (events[i].events & WL_LATCH_SET)
+				ResetLatch(MyLatch);
+			else if (events[i].fd == proxy_handoff_sock)
+				proxy_accept_handoffs();
+			else if (ch && (events[i].events & WL_SOCKET_READABLE))
+				proxy_recv(ch);
+		}
+
+		proxy_run();
+		proxy_free_closed();
+	}
+#endif
+}
+
+#ifndef WIN32
+
+/*
+ * Receive all clients handed over by backends since the last call.
+ */
+static void
+proxy_accept_handoffs(void)
+{
+	static char buf[CONN_PROXY_HANDOFF_MAX];
+
+	for (;;)
+	{
+		struct msghdr mh;
+		struct iovec iov;
+		union
+		{
+			struct cmsghdr hdr;
+			char		buf[CMSG_SPACE(2 * sizeof(int))];
+		}			cmsgbuf;
+		struct cmsghdr *cmsg;
+		ConnProxyHandoff hdr;
+		int			fds[2];
+		int			nfds = 0;
+		ssize_t		n;
+
+		iov.iov_base = buf;
+		iov.iov_len = sizeof(buf);
+		memset(&mh, 0, sizeof(mh));
+		mh.msg_iov = &iov;
+		mh.msg_iovlen = 1;
+		mh.msg_control = cmsgbuf.buf;
+		mh.msg_controllen = sizeof(cmsgbuf.buf);
+
+		n = recvmsg(proxy_handoff_sock, &mh, 0);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return;
+			ereport(ERROR,
+					(errcode_for_socket_access(),
+					 errmsg("could not receive connection handover: %m")));
+		}
+
+		for (cmsg = CMSG_FIRSTHDR(&mh); cmsg; cmsg = CMSG_NXTHDR(&mh, cmsg))
+		{
+			if (cmsg->cmsg_level == SOL_SOCKET &&
+				cmsg->cmsg_type == SCM_RIGHTS &&
+				cmsg->cmsg_len == CMSG_LEN(2 * sizeof(int)))
+			{
+				memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+				nfds = 2;
+			}
+		}
+
+		if (n >= sizeof(hdr))
+			memcpy(&hdr, buf, sizeof(hdr));
+		if ((mh.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) != 0 || nfds != 2 ||
+			n < sizeof(hdr) || hdr.keylen < 0 || hdr.unreadlen < 0 ||
+			n != sizeof(hdr) + hdr.keylen + hdr.unreadlen)
+		{
+			ereport(LOG,
+					(errmsg("connection proxy received invalid connection handover")));
+			if (nfds == 2)
+			{
+				closesocket(fds[0]);
+				closesocket(fds[1]);
+			}
+			continue;
+		}
+
+		proxy_new_session(fds[0], fds[1], &hdr, buf + sizeof(hdr),
+						  buf + sizeof(hdr) + hdr.keylen);
+	}
+}
+
+static void
+proxy_init_channel(ProxyChannel *ch, pgsocket sock, bool is_client)
+{
+	ch->is_client = is_client;
+	ch->sock = sock;
+	initStringInfo(&ch->in);
+	initStringInfo(&ch->out);
+	ch->pos = -1;
+	proxy_channels = lappend(proxy_channels, ch);
+	proxy_wait_set_stale = true;
+}
+
+/*
+ * Find the pool with the given key, creating it if necessary.
+ */
+static ProxyPool *
+proxy_get_pool(const char *key, int keylen)
+{
+	ProxyPool  *pool;
+
+	foreach_ptr(ProxyPool, p, proxy_pools)
+	{
+		if (p->keylen == keylen && memcmp(p->key, key, keylen) == 0)
+			return p;
+	}
+
+	pool = palloc0_object(ProxyPool);
+	pool->key = palloc(keylen);
+	memcpy(pool->key, key, keylen);
+	pool->keylen = keylen;
+	proxy_pools = lappend(proxy_pools, pool);
+	return pool;
+}
+
+static ProxyPending *
+proxy_push_pending(ProxyBackend *backend, ProxyPendingType type,
+				   bool injected, int serial, const char *name)
+{
+	ProxyPending *p = palloc0_object(ProxyPending);
+
+	p->type = type;
+	p->injected = injected;
+	p->serial = serial;
+	if (name)
+		strlcpy(p->name, name, NAMEDATALEN);
+	backend->pending = lappend(backend->pending, p);
+	return p;
+}
+
+/*
+ * Set up a session handed over by a backend.
+ */
+static void
+proxy_new_session(pgsocket clientsock, pgsocket backendsock,
+				  const ConnProxyHandoff *hdr,
+				  const char *key, const char *unread)
+{
+	ProxyPool  *pool;
+	ProxyClient *client;
+	ProxyBackend *backend;
+	HASHCTL		ctl;
+
+	if (!pg_set_noblock(clientsock) || !pg_set_noblock(backendsock))
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not set socket to nonblocking mode: %m")));
+		closesocket(clientsock);
+		closesocket(backendsock);
+		return;
+	}
+
+	pool = proxy_get_pool(key, hdr->keylen);
+
+	client = palloc0_object(ProxyClient);
+	proxy_init_channel(&client->ch, clientsock, true);
+	client->pool = pool;
+	ctl.keysize = NAMEDATALEN;
+	ctl.entrysize = sizeof(ProxyStatement);
+	client->stmts = hash_create("connection proxy statements", 16, &ctl,
+								HASH_ELEM | HASH_STRINGS);
+	appendBinaryStringInfo(&client->ch.in, unread, hdr->unreadlen);
+
+	/* The backend left it to us to tell the client that it's ready */
+	appendStringInfoChar(&client->ch.out, PqMsg_ReadyForQuery);
+	pq_sendint32(&client->ch.out, 5);
+	appendStringInfoChar(&client->ch.out, 'I');
+
+	/* ... and sends its own ReadyForQuery to us instead */
+	backend = palloc0_object(ProxyBackend);
+	proxy_init_channel(&backend->ch, backendsock, false);
+	backend->pid = hdr->pid;
+	proxy_push_pending(backend, PENDING_SYNC, true, 0, NULL);
+
+	if (list_length(pool->backends) < SessionPoolSize)
+	{
+		backend->pool = pool;
+		pool->backends = lappend(pool->backends, backend);
+	}
+	else
+		proxy_terminate_backend(backend);
+}
+
+#endif							/* !WIN32 */
+
+/*
+ * Length of the complete message at the cursor of a channel's input buffer,
+ * 0 if it isn't complete yet, or -1 if the length word is invalid.
+ */
+static int
+proxy_message_length(ProxyChannel *ch)
+{
+	int			avail = ch->in.len - ch->in.cursor;
+	uint32		len;
+
+	if (avail < 5)
+		return 0;
+	memcpy(&len, ch->in.data + ch->in.cursor + 1, 4);
+	len = pg_ntoh32(len);
+	if (len < 4 || len > PQ_LARGE_MESSAGE_LIMIT)
+		return -1;
+	if (avail < 1 + (int) len)
+		return 0;
+	return 1 + len;
+}
+
+static bool
+proxy_wants_input(ProxyChannel *ch)
+{
+	if (ch->closed || ch->closing || ch->eof)
+		return false;
+	return ch->in.len - ch->in.cursor < CONN_PROXY_BUFFER_LIMIT ||
+		proxy_message_length(ch) == 0;
+}
+
+static bool
+proxy_output_full(ProxyChannel *ch)
+{
+	return ch->out.len - ch->out.cursor >= CONN_PROXY_BUFFER_LIMIT;
+}
+
+/*
+ * Shrink a buffer back to its initial size if it has been enlarged for a
+ * large message and is now empty.
+ */
+static void
+proxy_reset_buffer(StringInfo buf)
+{
+	if (buf->maxlen > 4 * CONN_PROXY_BUFFER_LIMIT)
+	{
+		pfree(buf->data);
+		initStringInfo(buf);
+	}
+	else
+		resetStringInfo(buf);
+}
+
+/*
+ * Make the wait set match the sockets and the events we are interested in.
+ *
+ * Registered events can be changed in place, but adding or removing a
+ * socket requires building a new set.
+ */
+static void
+proxy_update_wait_set(void)
+{
+	int			nevents = 3;
+
+	if (!proxy_wait_set_stale)
+	{
+		foreach_ptr(ProxyChannel, ch, proxy_channels)
+		{
+			uint32		events = 0;
+
+			if (proxy_wants_input(ch))
+				events |= WL_SOCKET_READABLE;
+			if (ch->out.cursor < ch->out.len)
+				events |= WL_SOCKET_WRITEABLE;
+
+			if (events == ch->events)
+				continue;
+			if (events == 0 || ch->events == 0)
+			{
+				proxy_wait_set_stale = true;
+				break;
+			}
+			ModifyWaitEvent(proxy_wait_set, ch->pos, events, NULL);
+			ch->events = events;
+		}
+		if (!proxy_wait_set_stale)
+			return;
+	}
+
+	if (proxy_wait_set)
+		FreeWaitEventSet(proxy_wait_set);
+
+	foreach_ptr(ProxyChannel, ch, proxy_channels)
+	{
+		ch->events = 0;
+		if (proxy_wants_input(ch))
+			ch->events |= WL_SOCKET_READABLE;
+		if (ch->out.cursor < ch->out.len)
+			ch->events |= WL_SOCKET_WRITEABLE;
+		if (ch->events != 0)
+			nevents++;
+	}
+
+	proxy_wait_set = CreateWaitEventSet(NULL, nevents);
+	AddWaitEventToSet(proxy_wait_set, WL_LATCH_SET, PGINVALID_SOCKET,
+					  MyLatch, NULL);
+	AddWaitEventToSet(proxy_wait_set, WL_EXIT_ON_PM_DEATH, PGINVALID_SOCKET,
+					  NULL, NULL);
+	AddWaitEventToSet(proxy_wait_set, WL_SOCKET_READABLE, proxy_handoff_sock,
+					  NULL, NULL);
+	foreach_ptr(ProxyChannel, ch, proxy_channels)
+	{
+		if (ch->events != 0)
+			ch->pos = AddWaitEventToSet(proxy_wait_set, ch->events, ch->sock,
+										NULL, ch);
+		else
+			ch->pos = -1;
+	}
+	proxy_wait_set_stale = false;
+}
+
+/*
+ * Read whatever is available on a channel, as far as flow control allows.
+ */
+static void
+proxy_recv(ProxyChannel *ch)
+{
+	while (proxy_wants_input(ch))
+	{
+		ssize_t		n;
+
+		if (ch->in.cursor > 0)
+		{
+			memmove(ch->in.data, ch->in.data + ch->in.cursor,
+					ch->in.len - ch->in.cursor);
+			ch->in.len -= ch->in.cursor;
+			ch->in.cursor = 0;
+		}
+		enlargeStringInfo(&ch->in, 8192);
+
+		n = recv(ch->sock, ch->in.data + ch->in.len,
+				 ch->in.maxlen - ch->in.len - 1, 0);
+		if (n > 0)
+		{
+			ch->in.len += n;
+			ch->in.data[ch->in.len] = '\0';
+		}
+		else if (n < 0 && errno == EINTR)
+			continue;
+		else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return;
+		else
+		{
+			/* EOF, or a broken connection, which we treat the same */
+			ch->eof = true;
+		}
+	}
+}
+
+/*
+ * Send as much of a channel's pending output as the socket takes.  Returns
+ * true if anything was sent.
+ */
+static bool
+proxy_send(ProxyChannel *ch)
+{
+	bool		progress = false;
+
+	while (ch->out.cursor < ch->out.len)
+	{
+		ssize_t		n;
+
+		n = send(ch->sock, ch->out.data + ch->out.cursor,
+				 ch->out.len - ch->out.cursor, 0);
+		if (n > 0)
+		{
+			ch->out.cursor += n;
+			progress = true;
+		}
+		else if (n < 0 && errno == EINTR)
+			continue;
+		else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break;
+		else
+		{
+			/* the connection is broken, so nobody will get the output */
+			ch->out.cursor = ch->out.len;
+			ch->eof = true;
+			progress = true;
+		}
+	}
+
+	if (ch->out.len > 0 && ch->out.cursor == ch->out.len)
+		proxy_reset_buffer(&ch->out);
+
+	return progress;
+}
+
+/*
+ * Handle the complete messages received on a channel, as far as flow control
+ * allows, and deal with the connection having been closed.  Returns true if
+ * anything changed.
+ */
+static bool
+proxy_process(ProxyChannel *ch)
+{
+	bool		progress = false;
+	int			msglen = 0;
+
+	while (!ch->closed && !ch->closing)
+	{
+		msglen = proxy_message_length(ch);
+		if (msglen <= 0)
+			break;
+
+		if (ch->is_client ?
+			!proxy_client_message((ProxyClient *) ch, msglen) :
+			!proxy_backend_message((ProxyBackend *) ch, msglen))
+			break;
+		progress = true;
+	}
+
+	if (ch->closed || ch->closing)
+		return progress;
+
+	if (msglen < 0)
+	{
+		ereport(LOG,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("invalid message length received by connection proxy")));
+		ch->eof = true;
+		msglen = 0;
+	}
+
+	if (ch->in.len > 0 && ch->in.cursor == ch->in.len)
+		proxy_reset_buffer(&ch->in);
+
+	/* Once everything that came before EOF is handled, clean up */
+	if (ch->eof && msglen == 0)
+	{
+		if (ch->is_client)
+			proxy_close_client((ProxyClient *) ch);
+		else
+			proxy_backend_gone((ProxyBackend *) ch);
+		progress = true;
+	}
+
+	return progress;
+}
+
+/*
+ * Move data around until nothing more can be done without waiting.
+ */
+static void
+proxy_run(void)
+{
+	bool		progress;
+
+	do
+	{
+		progress = false;
+
+		foreach_ptr(ProxyChannel, ch, proxy_channels)
+		{
+			if (!ch->closed && proxy_process(ch))
+				progress = true;
+		}
+
+		foreach_ptr(ProxyChannel, ch, proxy_channels)
+		{
+			if (ch->closed)
+				continue;
+			if (proxy_send(ch))
+				progress = true;
+			if (ch->closing && (ch->out.cursor == ch->out.len || ch->eof))
+			{
+				Assert(ch->is_client);
+				proxy_close_client((ProxyClient *) ch);
+				progress = true;
+			}
+		}
+	} while (progress);
+}
+
+static void
+proxy_close_channel(ProxyChannel *ch)
+{
+	closesocket(ch->sock);
+	ch->sock = PGINVALID_SOCKET;
+	ch->closed = true;
+	proxy_wait_set_stale = true;
+}
+
+static void
+proxy_free_closed(void)
+{
+	foreach_ptr(ProxyChannel, ch, proxy_channels)
+	{
+		if (!ch->closed)
+			continue;
+		proxy_channels = foreach_delete_current(proxy_channels, ch);
+		pfree(ch->in.data);
+		pfree(ch->out.data);
+		pfree(ch);
+	}
+}
+
+/*
+ * Append a message with the statement name at offset nameoff in body
+ * replaced by the backend name of the statement with the given serial.
+ */
+static void
+proxy_put_renamed(StringInfo out, char type, const char *body, int bodylen,
+				  int nameoff, int namelen, int serial)
+{
+	char		newname[NAMEDATALEN];
+	int			newlen;
+
+	newlen = snprintf(newname, sizeof(newname), CONN_PROXY_STMT_PREFIX "%d",
+					  serial);
+	appendStringInfoChar(out, type);
+	pq_sendint32(out, 4 + bodylen - namelen + newlen);
+	appendBinaryStringInfo(out, body, nameoff);
+	appendBinaryStringInfo(out, newname, newlen);
+	appendBinaryStringInfo(out, body + nameoff + namelen,
+						   bodylen - nameoff - namelen);
+}
+
+/*
+ * Make sure a statement of the attached client exists in the backend,
+ * sending it the remembered Parse message if needed.
+ */
+static void
+proxy_ensure_statement(ProxyBackend *backend, ProxyStatement *stmt)
+{
+	if (list_member_int(backend->stmts, stmt->serial))
+		return;
+
+	appendBinaryStringInfo(&backend->ch.out, stmt->parse, stmt->parselen);
+	backend->stmts = lappend_int(backend->stmts, stmt->serial);
+	proxy_push_pending(backend, PENDING_PARSE, true, stmt->serial, stmt->name);
+}
+
+/*
+ * Send the Close messages queued for an idle backend, with a Sync of our own.
+ */
+static void
+proxy_send_closes(ProxyBackend *backend)
+{
+	static const char body[2] = {'S', '\0'};
+
+	if (backend->closes == NIL || backend->client || backend->terminating)
+		return;
+
+	foreach_int(serial, backend->closes)
+	{
+		proxy_put_renamed(&backend->ch.out, PqMsg_Close, body, 2, 1, 0,
+						  serial);
+		proxy_push_pending(backend, PENDING_CLOSE, true, serial, NULL);
+	}
+	list_free(backend->closes);
+	backend->closes = NIL;
+
+	appendStringInfoChar(&backend->ch.out, PqMsg_Sync);
+	pq_sendint32(&backend->ch.out, 4);
+	proxy_push_pending(backend, PENDING_SYNC, true, 0, NULL);
+}
+
+/*
+ * A client's statement is gone; arrange for it to be closed in all the
+ * backends of the pool that have it.
+ */
+static void
+proxy_forget_statement(ProxyPool *pool, int serial)
+{
+	foreach_ptr(ProxyBackend, backend, pool->backends)
+	{
+		if (!list_member_int(backend->stmts, serial))
+			continue;
+		backend->stmts = list_delete_int(backend->stmts, serial);
+		backend->closes = lappend_int(backend->closes, serial);
+		proxy_send_closes(backend);
+	}
+}
+
+static ProxyStatement *
+proxy_lookup_statement(ProxyClient *client, const char *name, int namelen)
+{
+	if (namelen == 0 || namelen >= NAMEDATALEN)
+		return NULL;
+	return (ProxyStatement *) hash_search(client->stmts, name, HASH_FIND,
+										  NULL);
+}
+
+static void
+proxy_drop_statement(ProxyClient *client, ProxyStatement *stmt)
+{
+	pfree(stmt->parse);
+	hash_search(client->stmts, stmt->name, HASH_REMOVE, NULL);
+}
+
+static void
+proxy_attach_backend(ProxyClient *client, ProxyBackend *backend)
+{
+	Assert(backend->client == NULL && client->backend == NULL);
+	client->backend = backend;
+	backend->client = client;
+}
+
+/*
+ * Find a backend for a client that has something to send.  Returns false if
+ * the client has to wait.
+ */
+static bool
+proxy_attach(ProxyClient *client)
+{
+	ProxyPool  *pool = client->pool;
+
+	if (client->waiting)
+		return false;
+
+	foreach_ptr(ProxyBackend, backend, pool->backends)
+	{
+		if (backend->client == NULL && !backend->terminating)
+		{
+			proxy_attach_backend(client, backend);
+			return true;
+		}
+	}
+
+	if (pool->backends == NIL)
+	{
+		proxy_client_error(client,
+						   "no backend is available in the connection pool");
+		return false;
+	}
+
+	pool->waiting = lappend(pool->waiting, client);
+	client->waiting = true;
+	return false;
+}
+
+/*
+ * The attached client's transaction is over: let the backend serve others.
+ */
+static void
+proxy_detach(ProxyBackend *backend)
+{
+	ProxyClient *client = backend->client;
+	ProxyPool  *pool = backend->pool;
+
+	client->backend = NULL;
+	backend->client = NULL;
+	proxy_send_closes(backend);
+
+	if (pool->waiting != NIL)
+	{
+		ProxyClient *next = linitial(pool->waiting);
+
+		pool->waiting = list_delete_first(pool->waiting);
+		next->waiting = false;
+		proxy_attach_backend(next, backend);
+	}
+}
+
+/*
+ * Handle a message from a client.  Returns false if it cannot be handled
+ * yet.
+ */
+static bool
+proxy_client_message(ProxyClient *client, int msglen)
+{
+	char	   *msg = client->ch.in.data + client->ch.in.cursor;
+	char		type = msg[0];
+	char	   *body = msg + 5;
+	int			bodylen = msglen - 5;
+	ProxyBackend *backend = client->backend;
+	StringInfo	out;
+	char	   *name;
+	char	   *end;
+	ProxyStatement *stmt;
+
+	if (type == PqMsg_Terminate)
+	{
+		client->ch.in.cursor += msglen;
+		proxy_close_client(client);
+		return true;
+	}
+
+	if (backend == NULL)
+	{
+		if (!proxy_attach(client))
+			return false;
+		backend = client->backend;
+	}
+	if (proxy_output_full(&backend->ch))
+		return false;
+
+	out = &backend->ch.out;
+	switch (type)
+	{
+		case PqMsg_Parse:
+			end = memchr(body, '\0', bodylen);
+			if (end == NULL)
+				goto violation;
+			name = body;
+			backend->unsynced = true;
+
+			if (end - name >= NAMEDATALEN)
+			{
+				/* too long for us to track, so it stays in this backend */
+				backend->pinned = true;
+				proxy_remove_from_pool(backend);
+			}
+			else if (end > name)
+			{
+				bool		found;
+
+				stmt = hash_search(client->stmts, name, HASH_ENTER, &found);
+				if (found)
+				{
+					/* let the backend complain about the duplicate */
+					proxy_ensure_statement(backend, stmt);
+					proxy_put_renamed(out, type, body, bodylen, 0,
+									  end - name, stmt->serial);
+					proxy_push_pending(backend, PENDING_PARSE, false, 0, NULL);
+					break;
+				}
+
+				stmt->serial = ++proxy_next_serial;
+				stmt->valid = false;
+				{
+					StringInfoData parse;
+
+					initStringInfo(&parse);
+					proxy_put_renamed(&parse, type, body, bodylen, 0,
+									  end - name, stmt->serial);
+					stmt->parse = parse.data;
+					stmt->parselen = parse.len;
+				}
+				appendBinaryStringInfo(out, stmt->parse, stmt->parselen);
+				backend->stmts = lappend_int(backend->stmts, stmt->serial);
+				proxy_push_pending(backend, PENDING_PARSE, false,
+								   stmt->serial, name);
+				break;
+			}
+			appendBinaryStringInfo(out, msg, msglen);
+			proxy_push_pending(backend, PENDING_PARSE, false, 0, NULL);
+			break;
+
+		case PqMsg_Bind:
+			/* the statement name follows the portal name */
+			end = memchr(body, '\0', bodylen);
+			if (end == NULL)
+				goto violation;
+			name = end + 1;
+			end = memchr(name, '\0', bodylen - (name - body));
+			if (end == NULL)
+				goto violation;
+			backend->unsynced = true;
+
+			stmt = proxy_lookup_statement(client, name, end - name);
+			if (stmt)
+			{
+				proxy_ensure_statement(backend, stmt);
+				proxy_put_renamed(out, type, body, bodylen, name - body,
+								  end - name, stmt->serial);
+			}
+			else
+				appendBinaryStringInfo(out, msg, msglen);
+			break;
+
+		case PqMsg_Describe:
+		case PqMsg_Close:
+			if (bodylen < 1)
+				goto violation;
+			name = body + 1;
+			end = memchr(name, '\0', bodylen - 1);
+			if (end == NULL)
+				goto violation;
+			backend->unsynced = true;
+
+			stmt = NULL;
+			if (body[0] == 'S')
+				stmt = proxy_lookup_statement(client, name, end - name);
+			if (stmt == NULL)
+				appendBinaryStringInfo(out, msg, msglen);
+			else if (type == PqMsg_Describe)
+			{
+				proxy_ensure_statement(backend, stmt);
+				proxy_put_renamed(out, type, body, bodylen, 1, end - name,
+								  stmt->serial);
+			}
+			else
+			{
+				int			serial = stmt->serial;
+
+				/*
+				 * Close it here, whether it exists or not, and in other
+				 * backends once they are idle.
+				 */
+				proxy_put_renamed(out, type, body, bodylen, 1, end - name,
+								  serial);
+				backend->stmts = list_delete_int(backend->stmts, serial);
+				proxy_drop_statement(client, stmt);
+				proxy_push_pending(backend, PENDING_CLOSE, false, serial,
+								   NULL);
+				proxy_forget_statement(client->pool, serial);
+				break;
+			}
+			if (type == PqMsg_Close)
+				proxy_push_pending(backend, PENDING_CLOSE, false, 0, NULL);
+			break;
+
+		case PqMsg_Sync:
+		case PqMsg_Query:
+		case PqMsg_FunctionCall:
+			appendBinaryStringInfo(out, msg, msglen);
+			proxy_push_pending(backend, PENDING_SYNC, false, 0, NULL);
+			backend->unsynced = false;
+			break;
+
+		case PqMsg_Execute:
+		case PqMsg_Flush:
+			backend->unsynced = true;
+			appendBinaryStringInfo(out, msg, msglen);
+			break;
+
+		default:
+			appendBinaryStringInfo(out, msg, msglen);
+			break;
+	}
+
+	client->ch.in.cursor += msglen;
+	return true;
+
+violation:
+	ereport(LOG,
+			(errcode(ERRCODE_PROTOCOL_VIOLATION),
+			 errmsg("invalid message received by connection proxy")));
+	client->ch.in.cursor += msglen;
+	proxy_close_client(client);
+	return true;
+}
+
+/*
+ * A ReadyForQuery arrived: everything sent before the matching Sync has been
+ * handled.  Messages that got no response were skipped after an error.
+ * Returns false if the Sync was one of ours.
+ */
+static bool
+proxy_sync_done(ProxyBackend *backend)
+{
+	while (backend->pending != NIL)
+	{
+		ProxyPending *p = linitial(backend->pending);
+		bool		injected = p->injected;
+
+		backend->pending = list_delete_first(backend->pending);
+
+		if (p->type == PENDING_SYNC)
+		{
+			pfree(p);
+			return !injected;
+		}
+
+		if (p->type == PENDING_PARSE && p->serial != 0)
+		{
+			backend->stmts = list_delete_int(backend->stmts, p->serial);
+
+			/* a failed Parse of the client creates no statement */
+			if (!injected && backend->client)
+			{
+				ProxyStatement *stmt;
+
+				stmt = proxy_lookup_statement(backend->client, p->name,
+											  strlen(p->name));
+				if (stmt && stmt->serial == p->serial && !stmt->valid)
+					proxy_drop_statement(backend->client, stmt);
+			}
+		}
+		else if (p->type == PENDING_CLOSE && p->serial != 0)
+			backend->closes = lappend_int(backend->closes, p->serial);
+		pfree(p);
+	}
+
+	ereport(LOG,
+			(errmsg("connection proxy received unexpected ReadyForQuery from backend %d",
+					backend->pid)));
+	return true;
+}
+
+/*
+ * Handle a message from a backend.  Returns false if it cannot be handled
+ * yet.
+ */
+static bool
+proxy_backend_message(ProxyBackend *backend, int msglen)
+{
+	char	   *msg = backend->ch.in.data + backend->ch.in.cursor;
+	char		type = msg[0];
+	char	   *body = msg + 5;
+	int			bodylen = msglen - 5;
+	ProxyClient *client = backend->client;
+	bool		forward = true;
+	bool		detach = false;
+
+	if (client && proxy_output_full(&client->ch))
+		return false;
+
+	switch (type)
+	{
+		case PqMsg_ParseComplete:
+		case PqMsg_CloseComplete:
+			{
+				ProxyPending *p;
+
+				p = backend->pending ? linitial(backend->pending) : NULL;
+				if (p == NULL ||
+					p->type != (type == PqMsg_ParseComplete ?
+								PENDING_PARSE : PENDING_CLOSE))
+				{
+					ereport(LOG,
+							(errmsg("connection proxy received unexpected message type \"%c\" from backend %d",
+									type, backend->pid)));
+					break;
+				}
+
+				if (type == PqMsg_ParseComplete && p->serial != 0 &&
+					!p->injected && client)
+				{
+					ProxyStatement *stmt;
+
+					stmt = proxy_lookup_statement(client, p->name,
+												  strlen(p->name));
+					if (stmt && stmt->serial == p->serial)
+						stmt->valid = true;
+				}
+				forward = !p->injected;
+				backend->pending = list_delete_first(backend->pending);
+				pfree(p);
+			}
+			break;
+
+		case PqMsg_ReadyForQuery:
+			forward = proxy_sync_done(backend);
+			if (forward && bodylen >= 1 && body[0] == 'I' && client &&
+				backend->pool && !backend->unsynced)
+			{
+				detach = true;
+				foreach_ptr(ProxyPending, p, backend->pending)
+				{
+					if (p->type == PENDING_SYNC)
+						detach = false;
+				}
+			}
+			break;
+
+		case PqMsg_ParameterStatus:
+			if (bodylen > 0 && strcmp(body, CONN_PROXY_PINNED_PARAM) == 0)
+			{
+				forward = false;
+				backend->pinned = true;
+				if (client == NULL)
+					proxy_terminate_backend(backend);
+				else
+					proxy_remove_from_pool(backend);
+			}
+			break;
+	}
+
+	if (forward && client)
+		appendBinaryStringInfo(&client->ch.out, msg, msglen);
+	backend->ch.in.cursor += msglen;
+
+	if (detach)
+		proxy_detach(backend);
+
+	return true;
+}
+
+/*
+ * Send a fatal error to a client, and close the connection afterwards.
+ */
+static void
+proxy_client_error(ProxyClient *client, const char *msg)
+{
+	StringInfoData buf;
+
+	initStringInfo(&buf);
+	appendStringInfoChar(&buf, PG_DIAG_SEVERITY);
+	appendStringInfoString(&buf, "FATAL");
+	appendStringInfoChar(&buf, '\0');
+	appendStringInfoChar(&buf, PG_DIAG_SEVERITY_NONLOCALIZED);
+	appendStringInfoString(&buf, "FATAL");
+	appendStringInfoChar(&buf, '\0');
+	appendStringInfoChar(&buf, PG_DIAG_SQLSTATE);
+	appendStringInfoString(&buf, unpack_sql_state(ERRCODE_TOO_MANY_CONNECTIONS));
+	appendStringInfoChar(&buf, '\0');
+	appendStringInfoChar(&buf, PG_DIAG_MESSAGE_PRIMARY);
+	appendStringInfoString(&buf, msg);
+	appendStringInfoChar(&buf, '\0');
+	appendStringInfoChar(&buf, '\0');
+
+	appendStringInfoChar(&client->ch.out, PqMsg_ErrorResponse);
+	pq_sendint32(&client->ch.out, 4 + buf.len);
+	appendBinaryStringInfo(&client->ch.out, buf.data, buf.len);
+	pfree(buf.data);
+
+	if (client->waiting)
+	{
+		client->pool->waiting = list_delete_ptr(client->pool->waiting, client);
+		client->waiting = false;
+	}
+	client->ch.closing = true;
+}
+
+/*
+ * A client is gone.
+ */
+static void
+proxy_close_client(ProxyClient *client)
+{
+	HASH_SEQ_STATUS status;
+	ProxyStatement *stmt;
+
+	if (client->ch.closed)
+		return;
+
+	if (client->waiting)
+		client->pool->waiting = list_delete_ptr(client->pool->waiting, client);
+
+	/* A backend left in the middle of something is of no use to others */
+	if (client->backend)
+	{
+		ProxyBackend *backend = client->backend;
+
+		client->backend = NULL;
+		backend->client = NULL;
+		proxy_terminate_backend(backend);
+	}
+
+	hash_seq_init(&status, client->stmts);
+	while ((stmt = hash_seq_search(&status)) != NULL)
+	{
+		proxy_forget_statement(client->pool, stmt->serial);
+		pfree(stmt->parse);
+	}
+	hash_destroy(client->stmts);
+
+	proxy_close_channel(&client->ch);
+}
+
+/*
+ * A backend has exited.  Its client, if any, is disconnected after it got
+ * whatever the backend had to say last.
+ */
+static void
+proxy_backend_gone(ProxyBackend *backend)
+{
+	ProxyClient *client = backend->client;
+
+	proxy_remove_from_pool(backend);
+	if (client)
+	{
+		client->backend = NULL;
+		backend->client = NULL;
+		client->ch.closing = true;
+	}
+
+	list_free_deep(backend->pending);
+	list_free(backend->stmts);
+	list_free(backend->closes);
+	proxy_close_channel(&backend->ch);
+}
+
+/*
+ * Tell a backend to exit.  We close its channel once it has.
+ */
+static void
+proxy_terminate_backend(ProxyBackend *backend)
+{
+	if (backend->terminating)
+		return;
+
+	proxy_remove_from_pool(backend);
+	backend->terminating = true;
+	appendStringInfoChar(&backend->ch.out, PqMsg_Terminate);
+	pq_sendint32(&backend->ch.out, 4);
+}
+
+/*
+ * Take a backend out of its pool, because it exits or is pinned.  Clients
+ * waiting for a backend of an empty pool would wait forever, so they are
+ * disconnected.
+ */
+static void
+proxy_remove_from_pool(ProxyBackend *backend)
+{
+	ProxyPool  *pool = backend->pool;
+
+	if (pool == NULL)
+		return;
+
+	pool->backends = list_delete_ptr(pool->backends, backend);
+	backend->pool = NULL;
+
+	if (pool->backends == NIL)
+	{
+		while (pool->waiting != NIL)
+			proxy_client_error(linitial(pool->waiting),
+							   "no backend is available in the connection pool");
+	}
+}
@@ -35,9 +35,11 @@
 
 #include "libpq/libpq-be.h"
 #include "miscadmin.h"
+#include "portability/instr_time.h"
 #include "postmaster/autovacuum.h"
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
+#include "postmaster/connproxy.h"
 #include "postmaster/fork_process.h"
 #include "postmaster/pgarch.h"
 #include "postmaster/postmaster.h"
@@ -121,6 +123,10 @@ typedef struct
 	int			max_safe_fds;
 	int			MaxBackends;
 	int			num_pmchild_slots;
+#ifdef PG_INSTR_TSC
+	bool		pg_timing_use_tsc;
+	int64		pg_tsc_frequency;
+#endif
 #ifdef WIN32
 	HANDLE		PostmasterHandle;
 	HANDLE		initial_signal_pipe;
@@ -128,6 +134,7 @@ typedef struct
 #else
 	int			postmaster_alive_fds[2];
 	int			syslogPipe[2];
+	pgsocket	ConnProxySockets[MAX_CONNECTION_PROXIES][2];
 #endif
 	char		my_exec_path[MAXPGPATH];
 	char		pkglib_path[MAXPGPATH];
@@ -762,6 +769,11 @@ save_backend_variables(BackendParameters *param,
 	param->MaxBackends = MaxBackends;
 	param->num_pmchild_slots = num_pmchild_slots;
 
+#ifdef PG_INSTR_TSC
+	param->pg_timing_use_tsc = pg_timing_use_tsc;
+	param->pg_tsc_frequency = pg_tsc_frequency;
+#endif
+
 #ifdef WIN32
 	param->PostmasterHandle = PostmasterHandle;
 	if (!write_duplicated_handle(&param->initial_signal_pipe,
@@ -771,6 +783,8 @@ save_backend_variables(BackendParameters *param,
 #else
 	memcpy(&param->postmaster_alive_fds, &postmaster_alive_fds,
 		   sizeof(postmaster_alive_fds));
+	memcpy(&param->ConnProxySockets, &ConnProxySockets,
+		   sizeof(ConnProxySockets));
 #endif
 
 	memcpy(&param->syslogPipe, &syslogPipe, sizeof(syslogPipe));
@@ -1024,12 +1038,19 @@ restore_backend_variables(BackendParameters *param)
 	MaxBackends = param->MaxBackends;
 	num_pmchild_slots = param->num_pmchild_slots;
 
+#ifdef PG_INSTR_TSC
+	pg_timing_use_tsc = param->pg_timing_use_tsc;
+	pg_tsc_frequency = param->pg_tsc_frequency;
+#endif
+
 #ifdef WIN32
 	PostmasterHandle = param->PostmasterHandle;
 	pgwin32_initial_signal_pipe = param->initial_signal_pipe;
 #else
 	memcpy(&postmaster_alive_fds, &param->postmaster_alive_fds,
 		   sizeof(postmaster_alive_fds));
+	memcpy(&ConnProxySockets, &param->ConnProxySockets,
+		   sizeof(ConnProxySockets));
 #endif
 
 	memcpy(&syslogPipe, &param->syslogPipe, sizeof(syslogPipe));
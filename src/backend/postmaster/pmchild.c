@@ -156,6 +156,7 @@ InitPostmasterChildSlots(void)
 			slots[slotno].bkend_type = B_INVALID;
 			slots[slotno].rw = NULL;
 			slots[slotno].bgworker_notify = false;
+			slots[slotno].warm_sock = PGINVALID_SOCKET;
 			dlist_push_tail(&pmchild_pools[btype].freelist, &slots[slotno].elem);
 			slotno++;
 		}
@@ -192,6 +193,7 @@ AssignPostmasterChildSlot(BackendType btype)
 	pmchild->bkend_type = btype;
 	pmchild->rw = NULL;
 	pmchild->bgworker_notify = true;
+	pmchild->warm_sock = PGINVALID_SOCKET;
 
 	/*
 	 * pmchild->child_slot for each entry was initialized when the array of
@@ -235,6 +237,7 @@ AllocDeadEndChild(void)
 		pmchild->bkend_type = B_DEAD_END_BACKEND;
 		pmchild->rw = NULL;
 		pmchild->bgworker_notify = false;
+		pmchild->warm_sock = PGINVALID_SOCKET;
 
 		dlist_push_head(&ActiveChildList, &pmchild->elem);
 	}
@@ -101,14 +101,18 @@
 #include "pgstat.h"
 #include "port/pg_bswap.h"
 #include "postmaster/autovacuum.h"
+#include "postmaster/background_prune.h"
 #include "postmaster/bgworker_internals.h"
+#include "postmaster/connproxy.h"
 #include "postmaster/pgarch.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/session_history.h"
 #include "postmaster/syslogger.h"
 #include "postmaster/walsummarizer.h"
 #include "replication/logicallauncher.h"
 #include "replication/slotsync.h"
 #include "replication/walsender.h"
+#include "storage/aio.h"
 #include "storage/aio_subsys.h"
 #include "storage/fd.h"
 #include "storage/io_worker.h"
@@ -229,11 +233,20 @@ char	   *ListenAddresses;
 int			SuperuserReservedConnections;
 int			ReservedConnections;
 
+/*
+ * WarmBackends is the number of backends that we keep forked ahead of time,
+ * waiting for connections to be handed to them.
+ */
+int			WarmBackends = 0;
+
 /* The socket(s) we're listening to. */
 #define MAXLISTEN	64
 static int	NumListenSockets = 0;
 static pgsocket *ListenSockets = NULL;
 
+/* ListenSockets from this index on are on the connection proxy port */
+static int	FirstProxyListenSocket = MAXLISTEN;
+
 /* still more option variables */
 bool		EnableSSL = false;
 
@@ -411,6 +424,9 @@ static DNSServiceRef bonjour_sdref = NULL;
 static int	io_worker_count = 0;
 static PMChild *io_worker_children[MAX_IO_WORKERS];
 
+/* Number of warm backends that are waiting for a connection. */
+static int	NumWarmBackends = 0;
+
 /*
  * postmaster.c - function prototypes
  */
@@ -447,12 +463,17 @@ static void LaunchMissingBackgroundProcesses(void);
 static void maybe_start_bgworkers(void);
 static bool maybe_reap_io_worker(int pid);
 static void maybe_adjust_io_workers(void);
+static void maybe_adjust_warm_backends(void);
+static bool HandOffToWarmBackend(ClientSocket *client_sock,
+								 BackendStartupData *startup_data);
+static void RetireWarmBackend(PMChild *bp);
 static bool CreateOptsFile(int argc, char *argv[], char *fullprogname);
 static PMChild *StartChildProcess(BackendType type);
 static void StartSysLogger(void);
 static void StartAutovacuumWorker(void);
 static bool StartBackgroundWorker(RegisteredBgWorker *rw);
 static void InitPostmasterDeathWatchHandle(void);
+static bool IsProxyListenSocket(pgsocket sock);
 
 #ifdef WIN32
 #define WNOHANG 0				/* ignored, so any integer value will do */
@@ -857,6 +878,11 @@ PostmasterMain(int argc, char *argv[])
 	if (sync_replication_slots && wal_level == WAL_LEVEL_MINIMAL)
 		ereport(ERROR,
 				(errmsg("replication slot synchronization (\"sync_replication_slots\" = on) requires \"wal_level\" to be \"replica\" or \"logical\"")));
+	if ((io_direct_flags & IO_DIRECT_DATA) && io_method == IOMETHOD_SYNC)
+		ereport(WARNING,
+				(errmsg("direct I/O is used for data files while \"io_method\" is \"sync\""),
+				 errdetail("Relation data will be read without any read-ahead."),
+				 errhint("Set \"io_method\" to \"worker\" or \"io_uring\".")));
 
 	/*
 	 * Other one-time internal sanity checks can go here, if they are fast.
@@ -929,6 +955,15 @@ PostmasterMain(int argc, char *argv[])
 	 */
 	ApplyLauncherRegister();
 
+	/* Likewise for the connection proxies, if any */
+	ConnProxyRegister();
+
+	/* And the session history sampler */
+	SessionHistoryRegister();
+
+	/* And the background pruner */
+	BackgroundPruneRegister();
+
 	/*
 	 * process any libraries that should be preloaded at postmaster start
 	 */
@@ -1275,6 +1310,43 @@ PostmasterMain(int argc, char *argv[])
 		ereport(FATAL,
 				(errmsg("no socket created for listening")));
 
+	/*
+	 * Connections to the proxy port are handed over to the connection
+	 * proxies once authenticated.  Only TCP sockets are opened for it, on the
+	 * same addresses as the regular port.
+	 */
+	FirstProxyListenSocket = NumListenSockets;
+	if (ConnectionProxies > 0 && ListenAddresses)
+	{
+		char	   *rawstring;
+		List	   *elemlist;
+		ListCell   *l;
+
+		rawstring = pstrdup(ListenAddresses);
+		if (!SplitGUCList(rawstring, ',', &elemlist))
+			elemlist = NIL;		/* already complained about above */
+
+		foreach(l, elemlist)
+		{
+			char	   *curhost = (char *) lfirst(l);
+
+			status = ListenServerPort(AF_UNSPEC,
+									  strcmp(curhost, "*") == 0 ? NULL : curhost,
+									  (unsigned short) ProxyPortNumber,
+									  NULL,
+									  ListenSockets,
+									  &NumListenSockets,
+									  MAXLISTEN);
+			if (status != STATUS_OK)
+				ereport(WARNING,
+						(errmsg("could not create connection proxy listen socket for \"%s\"",
+								curhost)));
+		}
+
+		list_free(elemlist);
+		pfree(rawstring);
+	}
+
 	/*
 	 * If no valid TCP ports, write an empty line for listen address,
 	 * indicating the Unix socket must be used.  Note that this line is not
@@ -1710,7 +1782,10 @@ ServerLoop(void)
 				ClientSocket s;
 
 				if (AcceptConnection(events[i].fd, &s) == STATUS_OK)
+				{
+					s.pooled = IsProxyListenSocket(events[i].fd);
 					BackendStartup(&s);
+				}
 
 				/* We no longer need the open socket in this process */
 				if (s.sock != PGINVALID_SOCKET)
@@ -1907,6 +1982,22 @@ ClosePostmasterPorts(bool am_syslogger)
 	}
 	NumListenSockets = 0;
 	ListenSockets = NULL;
+
+	/* Likewise for our ends of the warm backends' handoff sockets */
+	{
+		dlist_iter	iter;
+
+		dlist_foreach(iter, &ActiveChildList)
+		{
+			PMChild    *bp = dlist_container(PMChild, elem, iter.cur);
+
+			if (bp->warm_sock != PGINVALID_SOCKET)
+			{
+				closesocket(bp->warm_sock);
+				bp->warm_sock = PGINVALID_SOCKET;
+			}
+		}
+	}
 #endif
 
 	/*
@@ -2627,6 +2718,8 @@ CleanupBackend(PMChild *bp,
 	 * If the process attached to shared memory, this also checks that it
 	 * detached cleanly.
 	 */
+	if (bp->warm_sock != PGINVALID_SOCKET)
+		RetireWarmBackend(bp);
 	bp_pid = bp->pid;
 	bp_bgworker_notify = bp->bgworker_notify;
 	bp_bkend_type = bp->bkend_type;
@@ -3406,6 +3499,10 @@ LaunchMissingBackgroundProcesses(void)
 	/* Get other worker processes running, if needed */
 	if (StartWorkerNeeded || HaveCrashedWorker)
 		maybe_start_bgworkers();
+
+	/* Keep the configured number of warm backends around */
+	if (WarmBackends > 0 || NumWarmBackends > 0)
+		maybe_adjust_warm_backends();
 }
 
 /*
@@ -3467,6 +3564,15 @@ signal_child(PMChild *pmchild, int signal)
 							 GetBackendTypeDesc(pmchild->bkend_type),
 							 (int) pmchild->pid)));
 
+	/*
+	 * A warm backend doesn't act on signals other than SIGQUIT until it has
+	 * been handed a connection.  Whatever the signal was meant to achieve,
+	 * whether that's shutting down or reloading the configuration, letting
+	 * the warm backend go does it too; we'll start a fresh one if needed.
+	 */
+	if (pmchild->warm_sock != PGINVALID_SOCKET)
+		RetireWarmBackend(pmchild);
+
 	if (kill(pid, signal) < 0)
 		elog(DEBUG3, "kill(%ld,%d) failed: %m", (long) pid, signal);
 #ifdef HAVE_SETSID
@@ -3556,6 +3662,7 @@ BackendStartup(ClientSocket *client_sock)
 	 * connection establishment and setup total duration).
 	 */
 	startup_data.socket_created = GetCurrentTimestamp();
+	startup_data.warm_sock = PGINVALID_SOCKET;
 
 	/*
 	 * Allocate and assign the child slot.  Note we must do this before
@@ -3565,6 +3672,11 @@ BackendStartup(ClientSocket *client_sock)
 	cac = canAcceptConnections(B_BACKEND);
 	if (cac == CAC_OK)
 	{
+		/* If a warm backend is waiting, let it take the connection */
+		if (NumWarmBackends > 0 &&
+			HandOffToWarmBackend(client_sock, &startup_data))
+			return STATUS_OK;
+
 		/* Can change later to B_WAL_SENDER */
 		bn = AssignPostmasterChildSlot(B_BACKEND);
 		if (!bn)
@@ -4445,6 +4557,162 @@ maybe_adjust_io_workers(void)
 }
 
 
+/*
+ * Start or stop warm backends, to keep warm_backends of them waiting for
+ * connections while we are accepting connections, and none otherwise.
+ * Besides responding to changes of the GUC, this replaces the warm backends
+ * that have been handed connections, or retired by signal_child().
+ */
+static void
+maybe_adjust_warm_backends(void)
+{
+#ifndef WIN32
+	int			target = 0;
+
+	if (canAcceptConnections(B_BACKEND) == CAC_OK)
+		target = WarmBackends;
+
+	/* Too many waiting? */
+	if (NumWarmBackends > target)
+	{
+		dlist_iter	iter;
+
+		dlist_foreach(iter, &ActiveChildList)
+		{
+			PMChild    *bp = dlist_container(PMChild, elem, iter.cur);
+
+			if (bp->warm_sock != PGINVALID_SOCKET)
+			{
+				RetireWarmBackend(bp);
+				if (NumWarmBackends <= target)
+					break;
+			}
+		}
+	}
+
+	/* Not enough? */
+	while (NumWarmBackends < target)
+	{
+		PMChild    *bn;
+		BackendStartupData startup_data;
+		pgsocket	sv[2];
+		pid_t		pid;
+
+		/* Stop when all backend slots are taken */
+		bn = AssignPostmasterChildSlot(B_BACKEND);
+		if (!bn)
+			break;
+
+		if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sv) < 0)
+		{
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("could not create socket pair for warm backend: %m")));
+			(void) ReleasePostmasterChildSlot(bn);
+			break;
+		}
+
+		/*
+		 * Our end must not be inherited by any other child, or the warm
+		 * backend wouldn't see it being closed.  ClosePostmasterPorts() takes
+		 * care of that after fork, and this after exec.
+		 */
+		if (fcntl(sv[0], F_SETFD, FD_CLOEXEC) < 0)
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("could not set socket to close-on-exec mode: %m")));
+
+		bn->rw = NULL;
+		bn->bgworker_notify = false;
+		bn->warm_sock = sv[0];
+
+		startup_data.canAcceptConnections = CAC_OK;
+		startup_data.socket_created = 0;
+		startup_data.warm_sock = sv[1];
+
+		pid = postmaster_child_launch(bn->bkend_type, bn->child_slot,
+									  &startup_data, sizeof(startup_data),
+									  NULL);
+		closesocket(sv[1]);
+		if (pid < 0)
+		{
+			/* in parent, fork failed */
+			int			save_errno = errno;
+
+			closesocket(sv[0]);
+			bn->warm_sock = PGINVALID_SOCKET;
+			(void) ReleasePostmasterChildSlot(bn);
+			errno = save_errno;
+			ereport(LOG,
+					(errmsg("could not fork warm backend process: %m")));
+			break;				/* try again next time */
+		}
+
+		bn->pid = pid;
+		NumWarmBackends++;
+	}
+#endif
+}
+
+/*
+ * Hand a new connection to one of the warm backends, so that it can proceed
+ * as if it had just been forked for it.  The warm backend already occupies a
+ * backend child slot, which the connection now uses.
+ *
+ * Returns false if that didn't work out, and the caller should fork a new
+ * backend as usual.
+ */
+static bool
+HandOffToWarmBackend(ClientSocket *client_sock,
+					 BackendStartupData *startup_data)
+{
+#ifndef WIN32
+	dlist_iter	iter;
+
+	dlist_foreach(iter, &ActiveChildList)
+	{
+		PMChild    *bp = dlist_container(PMChild, elem, iter.cur);
+		pgsocket	sock = bp->warm_sock;
+		bool		sent;
+
+		if (sock == PGINVALID_SOCKET)
+			continue;
+
+		/* Whatever happens, this one won't be waiting anymore */
+		bp->warm_sock = PGINVALID_SOCKET;
+		NumWarmBackends--;
+
+		startup_data->canAcceptConnections = CAC_OK;
+		startup_data->fork_started = GetCurrentTimestamp();
+		sent = SendWarmBackendHandoff(sock, startup_data, client_sock);
+		closesocket(sock);
+
+		if (sent)
+		{
+			ereport(DEBUG2,
+					(errmsg_internal("handed connection over to warm backend, pid=%d socket=%d",
+									 (int) bp->pid, (int) client_sock->sock)));
+			return true;
+		}
+	}
+#endif
+	return false;
+}
+
+/*
+ * Tell a warm backend that it's not needed anymore, by closing our end of its
+ * handoff socket.  It exits as soon as it notices.
+ */
+static void
+RetireWarmBackend(PMChild *bp)
+{
+	Assert(bp->warm_sock != PGINVALID_SOCKET);
+
+	closesocket(bp->warm_sock);
+	bp->warm_sock = PGINVALID_SOCKET;
+	NumWarmBackends--;
+}
+
 /*
  * When a backend asks to be notified about worker state changes, we
  * set a flag in its backend entry.  The background worker machinery needs
@@ -4634,3 +4902,17 @@ InitPostmasterDeathWatchHandle(void)
 								 GetLastError())));
 #endif							/* WIN32 */
 }
+
+/*
+ * Is the given listen socket one of those on the connection proxy port?
+ */
+static bool
+IsProxyListenSocket(pgsocket sock)
+{
+	for (int i = FirstProxyListenSocket; i < NumListenSockets; i++)
+	{
+		if (ListenSockets[i] == sock)
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,244 @@
+/*-------------------------------------------------------------------------
+ *
+ * session_history.c
+ *	  Sampled history of the activity of all sessions.
+ *
+ * pg_stat_activity shows only what each backend is doing at the moment it
+ * is queried, so a stall that lasts a few seconds is usually over before
+ * anyone looks.  When session_history_size is set, a background worker
+ * samples the state, query ID and wait event of every process each
+ * session_history_interval milliseconds, and keeps the samples in a ring
+ * buffer in shared memory, where pg_stat_session_history shows them.  The
+ * oldest samples are overwritten once the buffer is full, so its size
+ * determines how far back the history goes.
+ *
+ * Only processes that are doing something are recorded: idle sessions are
+ * left out, as are background processes waiting in their main loop, which
+ * would otherwise fill the buffer with samples of nothing.  The sampler
+ * reads the same shared state as pg_stat_activity, without locking anything
+ * but the buffer, so the backends themselves do no extra work at all.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/session_history.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/interrupt.h"
+#include "postmaster/session_history.h"
+#include "storage/latch.h"
+#include "storage/lwlock.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
+#include "tcop/tcopprot.h"
+#include "utils/guc.h"
+#include "utils/wait_event.h"
+
+/* GUC parameters */
+int			session_history_size = 0;
+int			session_history_interval = 1000;
+
+/*
+ * The ring buffer.  The sampler is the only writer; it and the readers take
+ * SessionHistoryLock.
+ */
+typedef struct SessionHistoryShmemStruct
+{
+	uint64		nwritten;		/* # of entries ever written */
+	SessionHistoryEntry entries[FLEXIBLE_ARRAY_MEMBER];
+} SessionHistoryShmemStruct;
+
+static SessionHistoryShmemStruct *SessionHistoryShmem = NULL;
+
+#define UINT32_ACCESS_ONCE(var)		 ((uint32)(*((volatile uint32 *)&(var))))
+#define WAIT_EVENT_CLASS_MASK	0xFF000000
+
+static void session_history_sample(void);
+
+Size
+SessionHistoryShmemSize(void)
+{
+	if (session_history_size == 0)
+		return 0;
+
+	return add_size(offsetof(SessionHistoryShmemStruct, entries),
+					mul_size(session_history_size,
+							 sizeof(SessionHistoryEntry)));
+}
+
+void
+SessionHistoryShmemInit(void)
+{
+	bool		found;
+
+	if (session_history_size == 0)
+		return;
+
+	SessionHistoryShmem = (SessionHistoryShmemStruct *)
+		ShmemInitStruct("Session History", SessionHistoryShmemSize(), &found);
+	if (!found)
+		SessionHistoryShmem->nwritten = 0;
+}
+
+/*
+ * Register the sampler background worker.  Called by the postmaster at
+ * startup.
+ */
+void
+SessionHistoryRegister(void)
+{
+	BackgroundWorker bgw;
+
+	if (session_history_size == 0)
+		return;
+
+	memset(&bgw, 0, sizeof(bgw));
+	bgw.bgw_flags = BGWORKER_SHMEM_ACCESS;
+	bgw.bgw_start_time = BgWorkerStart_PostmasterStart;
+	snprintf(bgw.bgw_library_name, MAXPGPATH, "postgres");
+	snprintf(bgw.bgw_function_name, BGW_MAXLEN, "SessionHistoryMain");
+	snprintf(bgw.bgw_name, BGW_MAXLEN, "session history sampler");
+	snprintf(bgw.bgw_type, BGW_MAXLEN, "session history sampler");
+	bgw.bgw_restart_time = 5;
+	bgw.bgw_notify_pid = 0;
+	bgw.bgw_main_arg = (Datum) 0;
+
+	RegisterBackgroundWorker(&bgw);
+}
+
+/*
+ * Main entry point of the sampler.
+ */
+void
+SessionHistoryMain(Datum main_arg)
+{
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	for (;;)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		if (ConfigReloadPending)
+		{
+			ConfigReloadPending = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		if (session_history_interval > 0)
+			session_history_sample();
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_EXIT_ON_PM_DEATH |
+						 (session_history_interval > 0 ? WL_TIMEOUT : 0),
+						 session_history_interval,
+						 WAIT_EVENT_SESSION_HISTORY_MAIN);
+		ResetLatch(MyLatch);
+	}
+}
+
+/*
+ * Take one sample of all processes, and append it to the buffer.
+ */
+static void
+session_history_sample(void)
+{
+	TimestampTz now = GetCurrentTimestamp();
+	int			num_backends = pgstat_fetch_stat_numbackends();
+	SessionHistoryEntry *sample;
+	int			nsample = 0;
+
+	sample = palloc_array(SessionHistoryEntry, Max(num_backends, 1));
+
+	/* 1-based index */
+	for (int i = 1; i <= num_backends; i++)
+	{
+		LocalPgBackendStatus *local_beentry;
+		PgBackendStatus *beentry;
+		PGPROC	   *proc;
+		uint32		wait_event_info;
+		SessionHistoryEntry *entry;
+
+		local_beentry = pgstat_get_local_beentry_by_index(i);
+		beentry = &local_beentry->backendStatus;
+
+		if (beentry->st_procpid == MyProcPid)
+			continue;
+		if (beentry->st_state == STATE_IDLE ||
+			beentry->st_state == STATE_DISABLED)
+			continue;
+
+		proc = GetPGProcByNumber(local_beentry->proc_number);
+		wait_event_info = UINT32_ACCESS_ONCE(proc->wait_event_info);
+
+		/* a background process idling in its main loop */
+		if (beentry->st_state == STATE_UNDEFINED &&
+			(wait_event_info & WAIT_EVENT_CLASS_MASK) == PG_WAIT_ACTIVITY)
+			continue;
+
+		entry = &sample[nsample++];
+		entry->sample_time = now;
+		entry->pid = beentry->st_procpid;
+		entry->backend_type = beentry->st_backendType;
+		entry->state = beentry->st_state;
+		entry->datid = beentry->st_databaseid;
+		entry->userid = beentry->st_userid;
+		entry->wait_event_info = wait_event_info;
+		entry->query_id = beentry->st_query_id;
+	}
+
+	/* Don't hold on to the snapshot until the next sample */
+	pgstat_clear_backend_activity_snapshot();
+
+	if (nsample > 0)
+	{
+		LWLockAcquire(SessionHistoryLock, LW_EXCLUSIVE);
+		for (int i = 0; i < nsample; i++)
+		{
+			int			slot = SessionHistoryShmem->nwritten % session_history_size;
+
+			SessionHistoryShmem->entries[slot] = sample[i];
+			SessionHistoryShmem->nwritten++;
+		}
+		LWLockRelease(SessionHistoryLock);
+	}
+
+	pfree(sample);
+}
+
+/*
+ * SessionHistoryGetEntries
+ *		Return a palloc'd copy of the samples in the buffer, oldest first.
+ */
+SessionHistoryEntry *
+SessionHistoryGetEntries(int *nentries)
+{
+	SessionHistoryEntry *result;
+	uint64		first;
+	int			n;
+
+	if (session_history_size == 0)
+	{
+		*nentries = 0;
+		return NULL;
+	}
+
+	result = palloc_array(SessionHistoryEntry, session_history_size);
+
+	LWLockAcquire(SessionHistoryLock, LW_SHARED);
+	n = (int) Min(SessionHistoryShmem->nwritten, (uint64) session_history_size);
+	first = SessionHistoryShmem->nwritten - n;
+	for (int i = 0; i < n; i++)
+		result[i] = SessionHistoryShmem->entries[(first + i) % session_history_size];
+	LWLockRelease(SessionHistoryLock);
+
+	*nentries = n;
+	return result;
+}
@@ -26,6 +26,7 @@
 #include "miscadmin.h"
 #include "postmaster/auxprocess.h"
 #include "postmaster/startup.h"
+#include "replication/walreceiver.h"
 #include "storage/ipc.h"
 #include "storage/pmsignal.h"
 #include "storage/procsignal.h"
@@ -127,14 +128,17 @@ StartupRereadConfig(void)
 	char	   *conninfo = pstrdup(PrimaryConnInfo);
 	char	   *slotname = pstrdup(PrimarySlotName);
 	bool		tempSlot = wal_receiver_create_temp_slot;
+	char	   *compression = pstrdup(wal_receiver_compression);
 	bool		conninfoChanged;
 	bool		slotnameChanged;
 	bool		tempSlotChanged = false;
+	bool		compressionChanged;
 
 	ProcessConfigFile(PGC_SIGHUP);
 
 	conninfoChanged = strcmp(conninfo, PrimaryConnInfo) != 0;
 	slotnameChanged = strcmp(slotname, PrimarySlotName) != 0;
+	compressionChanged = strcmp(compression, wal_receiver_compression) != 0;
 
 	/*
 	 * wal_receiver_create_temp_slot is used only when we have no slot
@@ -144,8 +148,10 @@ StartupRereadConfig(void)
 		tempSlotChanged = tempSlot != wal_receiver_create_temp_slot;
 	pfree(conninfo);
 	pfree(slotname);
+	pfree(compression);
 
-	if (conninfoChanged || slotnameChanged || tempSlotChanged)
+	if (conninfoChanged || slotnameChanged || tempSlotChanged ||
+		compressionChanged)
 		StartupRequestWalReceiverRestart();
 }
 
@@ -19,8 +19,10 @@
 /*
  * forward declarations
  */
+static int	regprefix(regex_t *re, chr **string, size_t *slength,
+					  bool anchored);
 static int	findprefix(struct cnfa *cnfa, struct colormap *cm,
-					   chr *string, size_t *slength);
+					   chr *string, size_t *slength, bool anchored);
 
 
 /*
@@ -46,6 +48,36 @@ int
 pg_regprefix(regex_t *re,
 			 chr **string,
 			 size_t *slength)
+{
+	return regprefix(re, string, slength, true);
+}
+
+/*
+ * pg_regliteral - get a string that every match of a regular expression
+ *		begins with, whether or not the regex is anchored left
+ *
+ * Returns REG_PREFIX if there is such a string, else REG_NOMATCH or a REG_XXX
+ * error code.  The string is returned as for pg_regprefix.  Since a match can
+ * start anywhere in an unanchored search, this tells only that the string
+ * must appear somewhere in the data for the regex to match, which callers
+ * can check cheaply before running the regex engine.
+ */
+int
+pg_regliteral(regex_t *re,
+			  chr **string,
+			  size_t *slength)
+{
+	return regprefix(re, string, slength, false);
+}
+
+/*
+ * regprefix - workhorse for pg_regprefix and pg_regliteral
+ */
+static int
+regprefix(regex_t *re,
+		  chr **string,
+		  size_t *slength,
+		  bool anchored)
 {
 	struct guts *g;
 	struct cnfa *cnfa;
@@ -91,7 +123,7 @@ pg_regprefix(regex_t *re,
 		return REG_ESPACE;
 
 	/* do it */
-	st = findprefix(cnfa, &g->cmap, *string, slength);
+	st = findprefix(cnfa, &g->cmap, *string, slength, anchored);
 
 	assert(*slength <= cnfa->nstates);
 
@@ -116,7 +148,8 @@ static int						/* regprefix return code */
 findprefix(struct cnfa *cnfa,
 		   struct colormap *cm,
 		   chr *string,
-		   size_t *slength)
+		   size_t *slength,
+		   bool anchored)
 {
 	int			st;
 	int			nextst;
@@ -128,12 +161,18 @@ findprefix(struct cnfa *cnfa,
 	 * The "pre" state must have only BOS/BOL outarcs, else pattern isn't
 	 * anchored left.  If we have both BOS and BOL, they must go to the same
 	 * next state.
+	 *
+	 * If the caller doesn't insist on an anchored pattern, the "pre" state
+	 * may also have outarcs for the character before the match, which is
+	 * not part of it.  They must all go to the same next state too, though,
+	 * and there mustn't be any LACONs.
 	 */
 	st = cnfa->pre;
 	nextst = -1;
 	for (ca = cnfa->states[st]; ca->co != COLORLESS; ca++)
 	{
-		if (ca->co == cnfa->bos[0] || ca->co == cnfa->bos[1])
+		if (ca->co == cnfa->bos[0] || ca->co == cnfa->bos[1] ||
+			(!anchored && ca->co < cnfa->ncolors))
 		{
 			if (nextst == -1)
 				nextst = ca->to;
@@ -232,8 +271,12 @@ findprefix(struct cnfa *cnfa,
 	/*
 	 * If we ended at a state that only has EOS/EOL outarcs leading to the
 	 * "post" state, then we have an exact-match string.  Note this is true
-	 * even if the string is of zero length.
+	 * even if the string is of zero length.  That only holds if the pattern
+	 * is anchored, though.
 	 */
+	if (!anchored)
+		return (*slength > 0) ? REG_PREFIX : REG_NOMATCH;
+
 	nextst = -1;
 	for (ca = cnfa->states[st]; ca->co != COLORLESS; ca++)
 	{
@@ -26,10 +26,12 @@
 #include "funcapi.h"
 #include "libpq-fe.h"
 #include "libpq/libpq-be-fe-helpers.h"
+#include "libpq/protocol.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "pqexpbuffer.h"
+#include "replication/walcompress.h"
 #include "replication/walreceiver.h"
 #include "storage/latch.h"
 #include "utils/builtins.h"
@@ -50,6 +52,10 @@ struct WalReceiverConn
 	bool		logical;
 	/* Buffer for currently read records */
 	char	   *recvBuf;
+	/* Decompression of the WAL stream, if it is compressed */
+	WalDecompressor *decompressor;
+	/* Buffer for the decompressed version of the current record */
+	StringInfoData decompressBuf;
 };
 
 /* Prototypes for interface functions */
@@ -115,6 +121,7 @@ static WalReceiverFunctionsType PQWalReceiverFunctions = {
 
 /* Prototypes for private functions */
 static char *stringlist_to_identifierstr(PGconn *conn, List *strings);
+static void libpqrcv_free_decompressor(WalReceiverConn *conn);
 
 /*
  * Module initialization function
@@ -583,9 +590,35 @@ libpqrcv_startstreaming(WalReceiverConn *conn,
 		appendStringInfoChar(&cmd, ')');
 	}
 	else
+	{
 		appendStringInfo(&cmd, " TIMELINE %u",
 						 options->proto.physical.startpointTLI);
 
+		if (options->proto.physical.compression)
+		{
+			appendStringInfo(&cmd, " (compression '%s'",
+							 options->proto.physical.compression);
+			if (options->proto.physical.compression_detail)
+				appendStringInfo(&cmd, ", compression_detail '%s'",
+								 options->proto.physical.compression_detail);
+			appendStringInfoChar(&cmd, ')');
+		}
+	}
+
+	/* Set up decompression, dropping any left over from a previous stream */
+	libpqrcv_free_decompressor(conn);
+	if (!options->logical && options->proto.physical.compression)
+	{
+		pg_compress_algorithm algorithm;
+
+		if (!parse_compress_algorithm(options->proto.physical.compression,
+									  &algorithm))
+			elog(ERROR, "unrecognized compression algorithm: \"%s\"",
+				 options->proto.physical.compression);
+		conn->decompressor = WalDecompressorCreate(algorithm);
+		initStringInfo(&conn->decompressBuf);
+	}
+
 	/* Start streaming. */
 	res = libpqsrv_exec(conn->streamConn,
 						cmd.data,
@@ -736,6 +769,7 @@ libpqrcv_disconnect(WalReceiverConn *conn)
 {
 	libpqsrv_disconnect(conn->streamConn);
 	PQfreemem(conn->recvBuf);
+	libpqrcv_free_decompressor(conn);
 	pfree(conn);
 }
 
@@ -834,11 +868,49 @@ libpqrcv_receive(WalReceiverConn *conn, char **buffer,
 				 errmsg("could not receive data from WAL stream: %s",
 						pchomp(PQerrorMessage(conn->streamConn)))));
 
+	/*
+	 * If the stream is compressed, decompress the WAL carried by a WALData
+	 * message, and return a copy of the message with the WAL in its original
+	 * form.  All other messages are sent as they are.
+	 */
+	if (conn->decompressor && conn->recvBuf[0] == PqReplMsg_WALData)
+	{
+		int			hdrlen = 1 + sizeof(int64) * 3;
+
+		if (rawlen < hdrlen)
+			ereport(ERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg_internal("invalid WAL message received from primary")));
+
+		resetStringInfo(&conn->decompressBuf);
+		appendBinaryStringInfo(&conn->decompressBuf, conn->recvBuf, hdrlen);
+		WalDecompress(conn->decompressor, conn->recvBuf + hdrlen,
+					  rawlen - hdrlen, &conn->decompressBuf);
+
+		*buffer = conn->decompressBuf.data;
+		return conn->decompressBuf.len;
+	}
+
 	/* Return received messages to caller */
 	*buffer = conn->recvBuf;
 	return rawlen;
 }
 
+/*
+ * Release the decompression state of the current stream, if any.
+ */
+static void
+libpqrcv_free_decompressor(WalReceiverConn *conn)
+{
+	if (conn->decompressor == NULL)
+		return;
+
+	WalDecompressorFree(conn->decompressor);
+	conn->decompressor = NULL;
+	pfree(conn->decompressBuf.data);
+	conn->decompressBuf.data = NULL;
+}
+
 /*
  * Send a message to XLOG stream.
  *
@@ -152,11 +152,22 @@
  * session-level locks because both locks could be acquired outside the
  * transaction, and the stream lock in the leader needs to persist across
  * transaction boundaries i.e. until the end of the streaming transaction.
+ *
+ * Non-streamed transactions
+ * -------------------------
+ * With parallel_apply_non_streamed enabled, the leader apply worker also
+ * dispatches transactions that were not streamed to parallel apply workers,
+ * without waiting for each to finish before reading the next one.  See the
+ * comments above pa_can_dispatch() for how they are kept in commit order and
+ * how dependencies between them are handled.
  *-------------------------------------------------------------------------
  */
 
 #include "postgres.h"
 
+#include "access/genam.h"
+#include "access/xact.h"
+#include "common/hashfn.h"
 #include "libpq/pqformat.h"
 #include "libpq/pqmq.h"
 #include "pgstat.h"
@@ -170,7 +181,9 @@
 #include "tcop/tcopprot.h"
 #include "utils/inval.h"
 #include "utils/memutils.h"
+#include "utils/rel.h"
 #include "utils/syscache.h"
+#include "utils/timestamp.h"
 
 #define PG_LOGICAL_APPLY_SHM_MAGIC 0x787ca067
 
@@ -209,6 +222,26 @@
 #define PARALLEL_APPLY_LOCK_STREAM	0
 #define PARALLEL_APPLY_LOCK_XACT	1
 
+/*
+ * Message from the leader apply worker telling a parallel apply worker to
+ * wait for another dispatched transaction to commit.  Followed by the remote
+ * xid and the position in commit order of that transaction.
+ */
+#define PARALLEL_APPLY_MSG_WAIT		'x'
+
+/*
+ * Purge the dependency hash table of keys last used by transactions that have
+ * committed once it has at least this many entries.
+ */
+#define PA_DEPENDENCY_PURGE_MIN		65536
+
+/*
+ * Seeds for the dependency keys that stand for a relation as a whole, see
+ * pa_relation_key().  Those for unique keys of a relation are small numbers.
+ */
+#define PA_DEP_RELATION_ANY			PG_UINT64_MAX
+#define PA_DEP_RELATION_WHOLE		(PG_UINT64_MAX - 1)
+
 /*
  * Hash table entry to map xid to the parallel apply worker state.
  */
@@ -254,9 +287,104 @@ static ParallelApplyWorkerInfo *stream_apply_worker = NULL;
 /* A list to maintain subtransactions, if any. */
 static List *subxactlist = NIL;
 
+/*
+ * A non-streamed transaction that the leader apply worker handed to a
+ * parallel apply worker, from its BEGIN until it is known to have committed.
+ */
+typedef struct ParallelApplyDispatchedXact
+{
+	uint64		seq;			/* position in commit order */
+	TransactionId xid;			/* remote xid */
+	XLogRecPtr	end_lsn;		/* end of commit record, once sent */
+	uint64		waited_seq;		/* latest transaction the worker was told
+								 * to wait for */
+	ParallelApplyWorkerInfo *winfo;
+} ParallelApplyDispatchedXact;
+
+/* Dispatched transactions that have not been seen to commit, oldest first */
+static List *dispatched_xacts = NIL;
+
+/* The dispatched transaction whose messages are being passed on, if any */
+static ParallelApplyDispatchedXact *dispatching_xact = NULL;
+
+/* Position in commit order of the last dispatched transaction */
+static uint64 last_dispatched_seq = 0;
+
+/* ... and of the last one seen to commit */
+static uint64 last_committed_seq = 0;
+
+/*
+ * Position of the last dispatched transaction that all later transactions
+ * have to wait for, because it executed TRUNCATE.
+ */
+static uint64 barrier_seq = 0;
+
+/* When a parallel apply worker last failed to start for dispatching */
+static TimestampTz last_launch_failure = 0;
+
+/*
+ * Hash table entry recording the last dispatched transaction that used a
+ * dependency key.  See pa_track_change().
+ */
+typedef struct ParallelApplyDependency
+{
+	uint64		key;			/* hash key -- must be first */
+	uint64		seq;
+} ParallelApplyDependency;
+
+static HTAB *ParallelApplyDependencyHash = NULL;
+static long dependency_purge_threshold = PA_DEPENDENCY_PURGE_MIN;
+
+/*
+ * What the leader apply worker needs to know about a relation to find the
+ * dependencies between transactions that change it.
+ */
+typedef struct ParallelApplyRelDeps
+{
+	LogicalRepRelId remoteid;	/* hash key -- must be first */
+	bool		valid;
+	Oid			localreloid;
+	bool		whole;			/* only track the relation as a whole? */
+	bool		has_ri;			/* is the first key the replica identity? */
+	bool		ri_full;		/* is the replica identity FULL? */
+	List	   *keys;			/* Lists of remote column numbers, one per
+								 * unique key */
+} ParallelApplyRelDeps;
+
+static HTAB *ParallelApplyRelDepsHash = NULL;
+
+/*
+ * The latest RELATION message for each remote relation, for passing on to
+ * parallel apply workers that have not seen it.  The message is stored the
+ * way the publisher sent it, ready to be put on a worker's queue.
+ */
+typedef struct ParallelApplyRelationMsg
+{
+	LogicalRepRelId remoteid;	/* hash key -- must be first */
+	uint64		gen;
+	int			len;
+	char	   *data;
+} ParallelApplyRelationMsg;
+
+static HTAB *ParallelApplyRelationMsgHash = NULL;
+static uint64 relation_msg_gen = 0;
+
+/*
+ * In a parallel apply worker, the slot of the leader apply worker and its
+ * generation at the time we started.
+ */
+static LogicalRepWorker *ParallelApplyLeader = NULL;
+static uint16 ParallelApplyLeaderGeneration = 0;
+
+static void pa_assign_worker(ParallelApplyWorkerInfo *winfo,
+							 TransactionId xid);
 static void pa_free_worker_info(ParallelApplyWorkerInfo *winfo);
 static ParallelTransState pa_get_xact_state(ParallelApplyWorkerShared *wshared);
 static PartialFileSetState pa_get_fileset_state(void);
+static void pa_wait_for_dispatched_xact(TransactionId xid, uint64 seq);
+static void pa_track_row(LogicalRepMsgType action, LogicalRepRelId remoteid,
+						 bool has_oldtuple, LogicalRepTupleData *oldtup,
+						 bool has_newtuple, LogicalRepTupleData *newtup);
 
 /*
  * Returns true if it is OK to start a parallel apply worker, false otherwise.
@@ -369,6 +497,9 @@ pa_setup_dsm(ParallelApplyWorkerInfo *winfo)
 	pg_atomic_init_u32(&(shared->pending_stream_count), 0);
 	shared->last_commit_end = InvalidXLogRecPtr;
 	shared->fileset_state = FS_EMPTY;
+	shared->xact_seq = 0;
+	shared->prev_xid = InvalidTransactionId;
+	shared->prev_seq = 0;
 
 	shm_toc_insert(toc, PARALLEL_APPLY_KEY_SHARED, shared);
 
@@ -470,9 +601,7 @@ pa_launch_parallel_worker(void)
 void
 pa_allocate_worker(TransactionId xid)
 {
-	bool		found;
 	ParallelApplyWorkerInfo *winfo = NULL;
-	ParallelApplyWorkerEntry *entry;
 
 	if (!pa_can_start())
 		return;
@@ -481,6 +610,18 @@ pa_allocate_worker(TransactionId xid)
 	if (!winfo)
 		return;
 
+	pa_assign_worker(winfo, xid);
+}
+
+/*
+ * Use the given parallel apply worker for the specified xid.
+ */
+static void
+pa_assign_worker(ParallelApplyWorkerInfo *winfo, TransactionId xid)
+{
+	bool		found;
+	ParallelApplyWorkerEntry *entry;
+
 	/* First time through, initialize parallel apply worker state hashtable. */
 	if (!ParallelApplyTxnHash)
 	{
@@ -505,6 +646,9 @@ pa_allocate_worker(TransactionId xid)
 	SpinLockAcquire(&winfo->shared->mutex);
 	winfo->shared->xact_state = PARALLEL_TRANS_UNKNOWN;
 	winfo->shared->xid = xid;
+	winfo->shared->xact_seq = 0;
+	winfo->shared->prev_xid = InvalidTransactionId;
+	winfo->shared->prev_seq = 0;
 	SpinLockRelease(&winfo->shared->mutex);
 
 	winfo->in_use = true;
@@ -573,10 +717,15 @@ pa_free_worker(ParallelApplyWorkerInfo *winfo)
 	 * succeeds. Instead of trying to send the data which anyway would have
 	 * been serialized and then letting the parallel apply worker deal with
 	 * the spurious message, we stop the worker.
+	 *
+	 * When non-streamed transactions are applied in parallel too, workers are
+	 * needed all the time, so keep as many as we are allowed to have.
 	 */
 	if (winfo->serialize_changes ||
 		list_length(ParallelApplyWorkerPool) >
-		(max_parallel_apply_workers_per_subscription / 2))
+		(parallel_apply_non_streamed ?
+		 max_parallel_apply_workers_per_subscription :
+		 max_parallel_apply_workers_per_subscription / 2))
 	{
 		logicalrep_pa_worker_stop(winfo);
 		pa_free_worker_info(winfo);
@@ -778,9 +927,21 @@ LogicalParallelApplyLoop(shm_mq_handle *mqh)
 
 			/*
 			 * The first byte of messages sent from leader apply worker to
-			 * parallel apply workers can only be PqReplMsg_WALData.
+			 * parallel apply workers can only be PqReplMsg_WALData, or
+			 * PARALLEL_APPLY_MSG_WAIT for a transaction it dispatched.
 			 */
 			c = pq_getmsgbyte(&s);
+			if (c == PARALLEL_APPLY_MSG_WAIT)
+			{
+				TransactionId xid = pq_getmsgint(&s, 4);
+				uint64		seq = pq_getmsgint64(&s);
+
+				pa_wait_for_dispatched_xact(xid, seq);
+
+				MemoryContextReset(ApplyMessageContext);
+				MemoryContextSwitchTo(oldcxt);
+				continue;
+			}
 			if (c != PqReplMsg_WALData)
 				elog(ERROR, "unexpected message \"%c\"", c);
 
@@ -951,6 +1112,26 @@ ParallelApplyWorkerMain(Datum main_arg)
 
 	InitializingApplyWorker = false;
 
+	/*
+	 * Remember the slot of our leader, through which we learn of commits by
+	 * other parallel apply workers; see pa_wait_for_dispatched_xact().
+	 */
+	LWLockAcquire(LogicalRepWorkerLock, LW_SHARED);
+	ParallelApplyLeader = logicalrep_worker_find(WORKERTYPE_APPLY,
+												 MyLogicalRepWorker->subid,
+												 InvalidOid, true);
+	if (ParallelApplyLeader &&
+		ParallelApplyLeader->proc->pid == MyLogicalRepWorker->leader_pid)
+		ParallelApplyLeaderGeneration = ParallelApplyLeader->generation;
+	else
+		ParallelApplyLeader = NULL;
+	LWLockRelease(LogicalRepWorkerLock);
+
+	if (!ParallelApplyLeader)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("lost connection to the logical replication apply worker")));
+
 	/* Setup replication origin tracking. */
 	StartTransactionCommand();
 	ReplicationOriginNameForLogicalRep(MySubscription->oid, InvalidOid,
@@ -1645,3 +1826,1015 @@ pa_xact_finish(ParallelApplyWorkerInfo *winfo, XLogRecPtr remote_lsn)
 
 	pa_free_worker(winfo);
 }
+
+/*
+ * Parallel apply of non-streamed transactions
+ * -------------------------------------------
+ *
+ * With parallel_apply_non_streamed, the leader apply worker also hands
+ * ordinary transactions, which arrive whole between BEGIN and COMMIT, to
+ * parallel apply workers: it picks an idle worker at BEGIN, passes on every
+ * message of the transaction, and goes on with the next transaction without
+ * waiting for the worker to finish.
+ *
+ * The dispatched transactions commit strictly in the order in which they
+ * committed on the publisher, which keeps the replication origin advancing
+ * monotonically.  Each worker, before committing, waits for the transaction
+ * dispatched just before its own to commit: it waits on the session lock
+ * that the other worker holds on its transaction (see pa_lock_transaction()),
+ * so that the wait is visible to the deadlock detector, and then checks the
+ * commit position published in the leader's worker slot, to tell a commit
+ * from a failure.  The leader only needs to wait for a dispatched transaction
+ * when it runs out of idle workers, and before it applies something itself.
+ *
+ * Commit order alone doesn't make applying changes concurrently safe; a
+ * change that depends on the effect of an earlier transaction must not be
+ * applied before that transaction has committed.  For that, the leader
+ * computes dependency keys for each change it passes on: a hash of the
+ * replica identity of the old and new row, and of each of the unique keys of
+ * the local table.  When a key was last used by a transaction that may not
+ * have committed yet, the leader tells the worker to wait for that
+ * transaction before the change, using a PARALLEL_APPLY_MSG_WAIT message.
+ * Where the values of a key can't be known from the change, such as the old
+ * values of a unique key other than the replica identity of an UPDATE, and
+ * for tables with expression or exclusion indexes and for partitioned
+ * tables, the change is ordered against all other changes of the table
+ * instead.  TRUNCATE is ordered against everything before and after it.
+ *
+ * Dependencies that arise in other ways are not tracked: through triggers
+ * that fire during replication, or through values that are equal under a
+ * nondeterministic collation but differ in their bytes.  A change affected by
+ * those may see the database in a different state than it would if the
+ * transactions were applied one by one.  Where two such transactions end up
+ * waiting for each other, the deadlock detector sees it, since all waits
+ * between parallel apply workers go through the lock manager.
+ *
+ * Parallel apply workers need RELATION messages to interpret changes, but the
+ * publisher sends each of those only once.  So the leader keeps the latest
+ * one for each relation and passes on those a worker hasn't seen yet when it
+ * dispatches a transaction to it.
+ *
+ * Sending to a worker's queue blocks when the queue is full.  Unlike for
+ * streamed transactions, that can't lead to an undetected deadlock: only the
+ * newest dispatched transaction is ever waiting for messages, and it doesn't
+ * hold up any earlier ones except through locks.
+ */
+
+/*
+ * Returns true if the transaction starting now may be dispatched to a
+ * parallel apply worker.
+ */
+static bool
+pa_can_dispatch(void)
+{
+	if (!am_leader_apply_worker())
+		return false;
+
+	/* Same as pa_can_start() */
+	maybe_reread_subscription();
+
+	if (!parallel_apply_non_streamed ||
+		max_parallel_apply_workers_per_subscription == 0)
+		return false;
+
+	/* The leader decides whether to skip the transaction at BEGIN. */
+	if (XLogRecPtrIsValid(MySubscription->skiplsn))
+		return false;
+
+	/*
+	 * Parallel apply workers only apply changes to tables that are ready,
+	 * see should_apply_changes_for_rel().
+	 */
+	if (!AllTablesyncsReady())
+		return false;
+
+	/*
+	 * Retaining dead tuples for conflict detection relies on the leader
+	 * knowing exactly which transactions have been applied.
+	 */
+	if (MySubscription->retaindeadtuples)
+		return false;
+
+	/*
+	 * A streamed transaction being applied by a parallel apply worker may
+	 * hold locks that a dispatched transaction needs, while it waits for the
+	 * leader to send the rest of it.  The leader, in turn, would wait for the
+	 * dispatched transaction, in a way invisible to the deadlock detector.
+	 */
+	if (ParallelApplyTxnHash &&
+		hash_get_num_entries(ParallelApplyTxnHash) > list_length(dispatched_xacts))
+		return false;
+
+	return true;
+}
+
+/*
+ * Send a message to the worker applying a dispatched transaction, waiting
+ * for room in the queue if needed.
+ */
+static void
+pa_send_dispatched(ParallelApplyWorkerInfo *winfo, Size nbytes,
+				   const void *data)
+{
+	shm_mq_result result;
+
+	result = shm_mq_send(winfo->mq_handle, nbytes, data, false, true);
+	if (result != SHM_MQ_SUCCESS)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not send data to shared-memory queue")));
+}
+
+/*
+ * Release the workers of dispatched transactions that have committed, in
+ * commit order, and record their commits for feedback to the publisher.
+ */
+void
+pa_check_dispatched_xacts(void)
+{
+	MemoryContext oldcontext = CurrentMemoryContext;
+
+	while (dispatched_xacts != NIL)
+	{
+		ParallelApplyDispatchedXact *xact = linitial(dispatched_xacts);
+
+		if (xact == dispatching_xact ||
+			pa_get_xact_state(xact->winfo->shared) != PARALLEL_TRANS_FINISHED)
+			break;
+
+		store_flush_position(xact->end_lsn,
+							 xact->winfo->shared->last_commit_end);
+		pa_free_worker(xact->winfo);
+
+		last_committed_seq = xact->seq;
+		dispatched_xacts = list_delete_first(dispatched_xacts);
+		pfree(xact);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Are there dispatched transactions that may not have committed yet?
+ */
+bool
+pa_has_dispatched_xacts(void)
+{
+	return dispatched_xacts != NIL;
+}
+
+/*
+ * Wait for the dispatched transactions to commit, making way for the leader
+ * to apply something itself.
+ */
+static void
+pa_wait_dispatched_xacts(void)
+{
+	Assert(!dispatching_xact);
+
+	for (;;)
+	{
+		pa_check_dispatched_xacts();
+
+		if (dispatched_xacts == NIL)
+			break;
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 10L,
+						 WAIT_EVENT_LOGICAL_PARALLEL_APPLY_STATE_CHANGE);
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/*
+ * Get an idle parallel apply worker to dispatch a transaction to, starting
+ * one if allowed, or waiting for a dispatched transaction to commit if all
+ * of them are busy.  Returns NULL if no worker can be had.
+ */
+static ParallelApplyWorkerInfo *
+pa_get_idle_worker(void)
+{
+	for (;;)
+	{
+		ListCell   *lc;
+
+		pa_check_dispatched_xacts();
+
+		foreach(lc, ParallelApplyWorkerPool)
+		{
+			ParallelApplyWorkerInfo *winfo = (ParallelApplyWorkerInfo *) lfirst(lc);
+
+			if (!winfo->in_use)
+				return winfo;
+		}
+
+		/*
+		 * Don't keep trying to start workers if there are no free slots, as
+		 * each attempt would complain about it.
+		 */
+		if (list_length(ParallelApplyWorkerPool) <
+			max_parallel_apply_workers_per_subscription &&
+			TimestampDifferenceExceeds(last_launch_failure,
+									   GetCurrentTimestamp(),
+									   wal_retrieve_retry_interval))
+		{
+			ParallelApplyWorkerInfo *winfo = pa_launch_parallel_worker();
+
+			if (winfo)
+				return winfo;
+
+			last_launch_failure = GetCurrentTimestamp();
+		}
+
+		if (dispatched_xacts == NIL)
+			return NULL;
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 10L,
+						 WAIT_EVENT_LOGICAL_PARALLEL_APPLY_STATE_CHANGE);
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/*
+ * Remember a RELATION message, for passing it on to parallel apply workers
+ * later.  Also forget what we knew about the relation's dependency keys.
+ */
+static void
+pa_remember_relation(StringInfo s)
+{
+	LogicalRepRelId remoteid;
+	ParallelApplyRelationMsg *entry;
+	ParallelApplyRelDeps *deps;
+	StringInfoData msg;
+	MemoryContext oldcontext;
+	bool		found;
+
+	/* The message starts with the relation's remote OID. */
+	if (s->len - s->cursor < 4)
+		return;
+	remoteid = pg_ntoh32(*(uint32 *) (s->data + s->cursor));
+
+	if (!ParallelApplyRelationMsgHash)
+	{
+		HASHCTL		ctl;
+
+		ctl.keysize = sizeof(LogicalRepRelId);
+		ctl.entrysize = sizeof(ParallelApplyRelationMsg);
+		ctl.hcxt = ApplyContext;
+		ParallelApplyRelationMsgHash = hash_create("logical replication parallel apply relations",
+												   64, &ctl,
+												   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	entry = hash_search(ParallelApplyRelationMsgHash, &remoteid, HASH_ENTER,
+						&found);
+	if (found)
+		pfree(entry->data);
+
+	/*
+	 * Build the message the way it would come from the publisher, as the
+	 * one being processed may have been read from a spool file without its
+	 * header.
+	 */
+	oldcontext = MemoryContextSwitchTo(ApplyContext);
+	initStringInfo(&msg);
+	pq_sendbyte(&msg, PqReplMsg_WALData);
+	pq_sendint64(&msg, InvalidXLogRecPtr);	/* start_lsn */
+	pq_sendint64(&msg, InvalidXLogRecPtr);	/* end_lsn */
+	pq_sendint64(&msg, 0);		/* send_time */
+	pq_sendbyte(&msg, LOGICAL_REP_MSG_RELATION);
+	appendBinaryStringInfo(&msg, s->data + s->cursor, s->len - s->cursor);
+	MemoryContextSwitchTo(oldcontext);
+
+	entry->gen = ++relation_msg_gen;
+	entry->len = msg.len;
+	entry->data = msg.data;
+
+	if (ParallelApplyRelDepsHash)
+	{
+		deps = hash_search(ParallelApplyRelDepsHash, &remoteid, HASH_FIND,
+						   NULL);
+		if (deps)
+			deps->valid = false;
+	}
+}
+
+/*
+ * Send a parallel apply worker the RELATION messages it hasn't seen yet.
+ */
+static void
+pa_send_relations(ParallelApplyWorkerInfo *winfo)
+{
+	HASH_SEQ_STATUS status;
+	ParallelApplyRelationMsg *entry;
+
+	if (!ParallelApplyRelationMsgHash ||
+		winfo->relation_gen == relation_msg_gen)
+		return;
+
+	hash_seq_init(&status, ParallelApplyRelationMsgHash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (entry->gen > winfo->relation_gen)
+			pa_send_dispatched(winfo, entry->len, entry->data);
+	}
+
+	winfo->relation_gen = relation_msg_gen;
+}
+
+/*
+ * Relcache invalidation callback for the dependency key cache.
+ */
+static void
+pa_rel_deps_invalidate_cb(Datum arg, Oid reloid)
+{
+	HASH_SEQ_STATUS status;
+	ParallelApplyRelDeps *deps;
+
+	hash_seq_init(&status, ParallelApplyRelDepsHash);
+	while ((deps = hash_seq_search(&status)) != NULL)
+	{
+		if (reloid == InvalidOid || deps->localreloid == reloid)
+			deps->valid = false;
+	}
+}
+
+/*
+ * Find out which keys identify the rows of the given remote relation for
+ * the purpose of dependency tracking.
+ */
+static ParallelApplyRelDeps *
+pa_get_rel_deps(LogicalRepRelId remoteid)
+{
+	ParallelApplyRelDeps *deps;
+	LogicalRepRelMapEntry *rel;
+	MemoryContext oldcontext;
+	List	   *indexes;
+	ListCell   *lc;
+	bool		found;
+	int			attnum;
+
+	if (!ParallelApplyRelDepsHash)
+	{
+		HASHCTL		ctl;
+
+		ctl.keysize = sizeof(LogicalRepRelId);
+		ctl.entrysize = sizeof(ParallelApplyRelDeps);
+		ctl.hcxt = ApplyContext;
+		ParallelApplyRelDepsHash = hash_create("logical replication parallel apply dependency keys",
+											   64, &ctl,
+											   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+		CacheRegisterRelcacheCallback(pa_rel_deps_invalidate_cb, (Datum) 0);
+	}
+
+	deps = hash_search(ParallelApplyRelDepsHash, &remoteid, HASH_ENTER,
+					   &found);
+	if (found && deps->valid)
+		return deps;
+
+	if (found)
+	{
+		foreach(lc, deps->keys)
+			list_free(lfirst(lc));
+		list_free(deps->keys);
+	}
+	deps->keys = NIL;
+	deps->whole = false;
+	deps->has_ri = false;
+	deps->ri_full = false;
+
+	/*
+	 * Mark the entry valid first, so that an invalidation that arrives while
+	 * we are looking at the relation is not lost.
+	 */
+	deps->valid = true;
+
+	oldcontext = CurrentMemoryContext;
+	StartTransactionCommand();
+
+	rel = logicalrep_rel_open(remoteid, AccessShareLock);
+	deps->localreloid = rel->localreloid;
+
+	MemoryContextSwitchTo(ApplyContext);
+
+	if (!bms_is_empty(rel->remoterel.attkeys))
+	{
+		List	   *ri = NIL;
+
+		attnum = -1;
+		while ((attnum = bms_next_member(rel->remoterel.attkeys, attnum)) >= 0)
+			ri = lappend_int(ri, attnum);
+
+		deps->keys = list_make1(ri);
+		deps->has_ri = true;
+		deps->ri_full = (list_length(ri) == rel->remoterel.natts);
+	}
+
+	if (rel->localrel->rd_rel->relkind == RELKIND_PARTITIONED_TABLE)
+		deps->whole = true;
+
+	indexes = deps->whole ? NIL : RelationGetIndexList(rel->localrel);
+	foreach(lc, indexes)
+	{
+		Relation	idxrel = index_open(lfirst_oid(lc), AccessShareLock);
+		Form_pg_index idx = idxrel->rd_index;
+
+		if (idx->indisexclusion)
+			deps->whole = true;
+		else if (idx->indisunique)
+		{
+			List	   *key = NIL;
+			Bitmapset  *keycols = NULL;
+
+			for (int i = 0; i < idx->indnkeyatts; i++)
+			{
+				AttrNumber	localattnum = idx->indkey.values[i];
+
+				/* Expressions, and columns the publisher doesn't send */
+				if (localattnum <= 0 ||
+					rel->attrmap->attnums[localattnum - 1] < 0)
+				{
+					deps->whole = true;
+					break;
+				}
+
+				attnum = rel->attrmap->attnums[localattnum - 1];
+				key = lappend_int(key, attnum);
+				keycols = bms_add_member(keycols, attnum);
+			}
+
+			/*
+			 * Rows that conflict on a key containing the whole replica
+			 * identity conflict on the replica identity, too.
+			 */
+			if (deps->whole ||
+				(deps->has_ri &&
+				 bms_is_subset(rel->remoterel.attkeys, keycols)))
+				list_free(key);
+			else
+				deps->keys = lappend(deps->keys, key);
+
+			bms_free(keycols);
+		}
+
+		index_close(idxrel, AccessShareLock);
+
+		if (deps->whole)
+			break;
+	}
+	list_free(indexes);
+
+	logicalrep_rel_close(rel, AccessShareLock);
+	CommitTransactionCommand();
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return deps;
+}
+
+/*
+ * Hash the values of the given key columns in a tuple.  Returns false if
+ * some of them are not known.
+ */
+static bool
+pa_key_hash(LogicalRepRelId remoteid, int keyno, List *key,
+			LogicalRepTupleData *tuple, uint64 *hash)
+{
+	uint64		h = hash_bytes_uint32_extended(remoteid, keyno);
+
+	foreach_int(attnum, key)
+	{
+		char		status;
+
+		if (attnum >= tuple->ncols)
+			return false;
+
+		status = tuple->colstatus[attnum];
+		if (status == LOGICALREP_COLUMN_UNCHANGED)
+			return false;
+
+		h = hash_combine64(h, (uint64) status);
+		if (status != LOGICALREP_COLUMN_NULL)
+			h = hash_combine64(h,
+							   hash_bytes_extended((const unsigned char *) tuple->colvalues[attnum].data,
+												   tuple->colvalues[attnum].len,
+												   0));
+	}
+
+	*hash = h;
+	return true;
+}
+
+/*
+ * The dependency key standing for a relation as a whole.
+ */
+static inline uint64
+pa_relation_key(LogicalRepRelId remoteid, uint64 which)
+{
+	return hash_bytes_uint32_extended(remoteid, which);
+}
+
+/*
+ * Make the worker of the dispatching transaction wait for the dispatched
+ * transaction with the given position in commit order, unless that has
+ * committed or is waited for already.
+ */
+static void
+pa_depend_on(uint64 seq)
+{
+	ListCell   *lc;
+	StringInfoData msg;
+
+	if (seq <= last_committed_seq ||
+		seq <= dispatching_xact->waited_seq ||
+		seq >= dispatching_xact->seq)
+		return;
+
+	foreach(lc, dispatched_xacts)
+	{
+		ParallelApplyDispatchedXact *xact = lfirst(lc);
+
+		if (xact->seq != seq)
+			continue;
+
+		initStringInfo(&msg);
+		pq_sendbyte(&msg, PARALLEL_APPLY_MSG_WAIT);
+		pq_sendint32(&msg, xact->xid);
+		pq_sendint64(&msg, xact->seq);
+		pa_send_dispatched(dispatching_xact->winfo, msg.len, msg.data);
+		pfree(msg.data);
+
+		/* Waiting for it means waiting for everything before it, too */
+		dispatching_xact->waited_seq = seq;
+		return;
+	}
+
+	/* Not found, so it must have committed in the meantime. */
+}
+
+/*
+ * Record that the dispatching transaction uses a dependency key, making it
+ * wait for the last transaction that used it.  If record is false, only wait.
+ */
+static void
+pa_depend_on_key(uint64 key, bool record)
+{
+	ParallelApplyDependency *entry;
+	bool		found;
+
+	entry = hash_search(ParallelApplyDependencyHash, &key,
+						record ? HASH_ENTER : HASH_FIND, &found);
+	if (found)
+		pa_depend_on(entry->seq);
+	if (record)
+		entry->seq = dispatching_xact->seq;
+}
+
+/*
+ * Forget the dependency keys of transactions that have committed.
+ */
+static void
+pa_purge_dependencies(void)
+{
+	HASH_SEQ_STATUS status;
+	ParallelApplyDependency *entry;
+	long		remaining;
+
+	hash_seq_init(&status, ParallelApplyDependencyHash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (entry->seq <= last_committed_seq)
+			hash_search(ParallelApplyDependencyHash, &entry->key,
+						HASH_REMOVE, NULL);
+	}
+
+	/* Don't purge again before the table has grown substantially. */
+	remaining = hash_get_num_entries(ParallelApplyDependencyHash);
+	dependency_purge_threshold = Max(PA_DEPENDENCY_PURGE_MIN, 2 * remaining);
+}
+
+/*
+ * Work out which earlier dispatched transactions a change depends on, and
+ * make the worker wait for them before applying it.
+ */
+static void
+pa_track_change(LogicalRepMsgType action, StringInfo s)
+{
+	StringInfoData msg = *s;
+	LogicalRepRelId remoteid;
+	LogicalRepTupleData oldtup;
+	LogicalRepTupleData newtup;
+	bool		has_oldtuple = false;
+	bool		has_newtuple = false;
+	int			ntuples;
+
+	if (action == LOGICAL_REP_MSG_TRUNCATE)
+	{
+		/*
+		 * TRUNCATE conflicts with every change to the truncated tables, and
+		 * may cascade to tables we know nothing about.  So order it after
+		 * everything before it, and everything after it after it.
+		 */
+		pa_depend_on(dispatching_xact->seq - 1);
+		barrier_seq = dispatching_xact->seq;
+		return;
+	}
+
+	pa_depend_on(barrier_seq);
+
+	switch (action)
+	{
+		case LOGICAL_REP_MSG_INSERT:
+			remoteid = logicalrep_read_insert(&msg, &newtup);
+			has_newtuple = true;
+			break;
+		case LOGICAL_REP_MSG_UPDATE:
+			remoteid = logicalrep_read_update(&msg, &has_oldtuple, &oldtup,
+											  &newtup);
+			has_newtuple = true;
+			break;
+		case LOGICAL_REP_MSG_DELETE:
+			remoteid = logicalrep_read_delete(&msg, &oldtup);
+			has_oldtuple = true;
+			break;
+		case LOGICAL_REP_MSG_MULTI_INSERT:
+			remoteid = logicalrep_read_multi_insert(&msg, &ntuples);
+			for (int i = 0; i < ntuples; i++)
+			{
+				logicalrep_read_multi_insert_tuple(&msg, &newtup);
+				pa_track_row(LOGICAL_REP_MSG_INSERT, remoteid,
+							 false, NULL, true, &newtup);
+			}
+			return;
+		default:
+			elog(ERROR, "unexpected message type \"%s\"",
+				 logicalrep_message_type(action));
+			return;				/* keep compiler quiet */
+	}
+
+	pa_track_row(action, remoteid, has_oldtuple, &oldtup,
+				 has_newtuple, &newtup);
+}
+
+/*
+ * Work out the dependencies of a single row changed by an INSERT, UPDATE or
+ * DELETE, for pa_track_change().
+ */
+static void
+pa_track_row(LogicalRepMsgType action, LogicalRepRelId remoteid,
+			 bool has_oldtuple, LogicalRepTupleData *oldtup,
+			 bool has_newtuple, LogicalRepTupleData *newtup)
+{
+	ParallelApplyRelDeps *deps;
+	bool		whole;
+	int			keyno = 0;
+	ListCell   *lc;
+
+	deps = pa_get_rel_deps(remoteid);
+
+	pa_depend_on_key(pa_relation_key(remoteid, PA_DEP_RELATION_WHOLE), false);
+
+	whole = deps->whole;
+	foreach(lc, deps->keys)
+	{
+		List	   *key = lfirst(lc);
+		bool		is_ri = (keyno == 0 && deps->has_ri);
+		uint64		hash;
+
+		if (whole)
+			break;
+
+		/*
+		 * The key of the row before an UPDATE or DELETE.  Without an old
+		 * tuple, the replica identity didn't change, and the new tuple has
+		 * it.  The old tuple only has the other columns if the replica
+		 * identity is FULL.
+		 */
+		if (action != LOGICAL_REP_MSG_INSERT)
+		{
+			if (!has_oldtuple ? !is_ri : (!is_ri && !deps->ri_full))
+				whole = true;
+			else if (!pa_key_hash(remoteid, keyno, key,
+								  has_oldtuple ? oldtup : newtup, &hash))
+				whole = true;
+			else
+				pa_depend_on_key(hash, true);
+		}
+
+		/*
+		 * The key of the row after an INSERT or UPDATE.  Values that an
+		 * UPDATE left unchanged are covered by the old key.
+		 */
+		if (!whole && has_newtuple)
+		{
+			if (pa_key_hash(remoteid, keyno, key, newtup, &hash))
+				pa_depend_on_key(hash, true);
+			else if (action == LOGICAL_REP_MSG_INSERT)
+				whole = true;
+		}
+
+		keyno++;
+	}
+
+	if (whole)
+	{
+		pa_depend_on_key(pa_relation_key(remoteid, PA_DEP_RELATION_ANY), false);
+		pa_depend_on_key(pa_relation_key(remoteid, PA_DEP_RELATION_WHOLE), true);
+	}
+	pa_depend_on_key(pa_relation_key(remoteid, PA_DEP_RELATION_ANY), true);
+}
+
+/*
+ * Try to dispatch the transaction starting with the given BEGIN message to a
+ * parallel apply worker.
+ *
+ * Returns true if the transaction has been dispatched, in which case the
+ * rest of its messages must be passed on by pa_dispatch_message() and
+ * pa_dispatch_commit().  Otherwise, the leader applies it itself, and all
+ * transactions dispatched before have committed by the time we return.
+ */
+bool
+pa_dispatch_xact(LogicalRepBeginData *begin_data, StringInfo s)
+{
+	ParallelApplyWorkerInfo *winfo = NULL;
+	ParallelApplyDispatchedXact *xact;
+	ParallelApplyDispatchedXact *prev = NULL;
+	MemoryContext oldcontext;
+
+	Assert(!dispatching_xact);
+
+	if (pa_can_dispatch())
+	{
+		/* Process any invalidations affecting the dependency keys. */
+		AcceptInvalidationMessages();
+
+		winfo = pa_get_idle_worker();
+	}
+
+	if (!winfo)
+	{
+		pa_wait_dispatched_xacts();
+		return false;
+	}
+
+	if (!ParallelApplyDependencyHash)
+	{
+		HASHCTL		ctl;
+
+		ctl.keysize = sizeof(uint64);
+		ctl.entrysize = sizeof(ParallelApplyDependency);
+		ctl.hcxt = ApplyContext;
+		ParallelApplyDependencyHash = hash_create("logical replication parallel apply dependencies",
+												  1024, &ctl,
+												  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+	else if (hash_get_num_entries(ParallelApplyDependencyHash) >
+			 dependency_purge_threshold)
+		pa_purge_dependencies();
+
+	if (dispatched_xacts != NIL)
+		prev = llast(dispatched_xacts);
+
+	oldcontext = MemoryContextSwitchTo(ApplyContext);
+	xact = palloc0_object(ParallelApplyDispatchedXact);
+	xact->seq = ++last_dispatched_seq;
+	xact->xid = begin_data->xid;
+	xact->end_lsn = InvalidXLogRecPtr;
+	xact->winfo = winfo;
+	dispatched_xacts = lappend(dispatched_xacts, xact);
+	MemoryContextSwitchTo(oldcontext);
+
+	pa_assign_worker(winfo, begin_data->xid);
+
+	SpinLockAcquire(&winfo->shared->mutex);
+	winfo->shared->xact_seq = xact->seq;
+	winfo->shared->prev_xid = prev ? prev->xid : InvalidTransactionId;
+	winfo->shared->prev_seq = prev ? prev->seq : 0;
+	SpinLockRelease(&winfo->shared->mutex);
+
+	pa_send_relations(winfo);
+	pa_send_dispatched(winfo, s->len, s->data);
+
+	dispatching_xact = xact;
+
+	return true;
+}
+
+/*
+ * Pass on a message of the transaction being dispatched, if any.
+ *
+ * Called by the leader apply worker for every message it processes.  Returns
+ * true if the message was passed on and needs no further processing.
+ * RELATION and COMMIT messages are also processed by the caller.
+ *
+ * If no transaction is being dispatched, wait for the dispatched ones to
+ * commit before the leader applies anything itself.
+ */
+bool
+pa_dispatch_message(LogicalRepMsgType action, StringInfo s)
+{
+	if (!am_leader_apply_worker())
+		return false;
+
+	if (action == LOGICAL_REP_MSG_RELATION)
+		pa_remember_relation(s);
+
+	if (!dispatching_xact)
+	{
+		if (action != LOGICAL_REP_MSG_BEGIN &&
+			action != LOGICAL_REP_MSG_RELATION &&
+			action != LOGICAL_REP_MSG_TYPE)
+			pa_wait_dispatched_xacts();
+		return false;
+	}
+
+	switch (action)
+	{
+		case LOGICAL_REP_MSG_COMMIT:
+			return false;
+
+		case LOGICAL_REP_MSG_RELATION:
+			pa_send_dispatched(dispatching_xact->winfo, s->len, s->data);
+			dispatching_xact->winfo->relation_gen = relation_msg_gen;
+			return false;
+
+		case LOGICAL_REP_MSG_TYPE:
+			pa_send_dispatched(dispatching_xact->winfo, s->len, s->data);
+			return false;
+
+		case LOGICAL_REP_MSG_INSERT:
+		case LOGICAL_REP_MSG_MULTI_INSERT:
+		case LOGICAL_REP_MSG_UPDATE:
+		case LOGICAL_REP_MSG_DELETE:
+		case LOGICAL_REP_MSG_TRUNCATE:
+			pa_track_change(action, s);
+			break;
+
+		case LOGICAL_REP_MSG_ORIGIN:
+		case LOGICAL_REP_MSG_MESSAGE:
+			break;
+
+		default:
+			ereport(ERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg_internal("unexpected message \"%s\" in remote transaction %u",
+									 logicalrep_message_type(action),
+									 dispatching_xact->xid)));
+	}
+
+	pa_send_dispatched(dispatching_xact->winfo, s->len, s->data);
+
+	return true;
+}
+
+/*
+ * Pass on the COMMIT message of the transaction being dispatched, if any.
+ *
+ * Returns true if the transaction was dispatched; its worker commits it.
+ */
+bool
+pa_dispatch_commit(LogicalRepCommitData *commit_data, StringInfo s)
+{
+	if (!dispatching_xact)
+		return false;
+
+	dispatching_xact->end_lsn = commit_data->end_lsn;
+	pa_send_dispatched(dispatching_xact->winfo, s->len, s->data);
+	dispatching_xact = NULL;
+
+	return true;
+}
+
+/*
+ * Start applying a transaction the leader dispatched to us, in a parallel
+ * apply worker.
+ */
+void
+pa_begin_dispatched_xact(TransactionId xid)
+{
+	Assert(am_parallel_apply_worker());
+
+	/*
+	 * Later transactions, and the leader, wait for this lock to find out when
+	 * we are done.
+	 */
+	pa_lock_transaction(xid, AccessExclusiveLock);
+	pa_set_xact_state(MyParallelShared, PARALLEL_TRANS_STARTED);
+}
+
+/*
+ * Has the dispatched transaction at the given position in commit order
+ * committed?  Errors out if the leader is gone.
+ */
+static bool
+pa_dispatched_xact_committed(uint64 seq)
+{
+	bool		committed;
+
+	LWLockAcquire(LogicalRepWorkerLock, LW_SHARED);
+
+	if (!ParallelApplyLeader->in_use ||
+		ParallelApplyLeader->generation != ParallelApplyLeaderGeneration)
+	{
+		LWLockRelease(LogicalRepWorkerLock);
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("lost connection to the logical replication apply worker")));
+	}
+
+	committed = pg_atomic_read_membarrier_u64(&ParallelApplyLeader->parallel_committed_seq) >= seq;
+
+	LWLockRelease(LogicalRepWorkerLock);
+
+	return committed;
+}
+
+/*
+ * Wait for another dispatched transaction to commit, in a parallel apply
+ * worker.
+ *
+ * Waiting on the other worker's transaction lock lets the deadlock detector
+ * see us.  But the lock is free both before that worker has taken it and
+ * after it failed, so check whether the transaction has committed afterwards,
+ * and retry if not.  If the other worker failed, the leader will stop us.
+ */
+static void
+pa_wait_for_dispatched_xact(TransactionId xid, uint64 seq)
+{
+	for (;;)
+	{
+		pa_lock_transaction(xid, AccessShareLock);
+		pa_unlock_transaction(xid, AccessShareLock);
+
+		if (pa_dispatched_xact_committed(seq))
+			return;
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 10L,
+						 WAIT_EVENT_LOGICAL_PARALLEL_APPLY_STATE_CHANGE);
+		ResetLatch(MyLatch);
+
+		ProcessParallelApplyInterrupts();
+	}
+}
+
+/*
+ * Wait for the transaction dispatched before ours to commit, so that we
+ * commit in the publisher's order.
+ */
+void
+pa_wait_for_preceding_xact(void)
+{
+	TransactionId prev_xid;
+	uint64		prev_seq;
+
+	Assert(am_parallel_apply_worker());
+
+	SpinLockAcquire(&MyParallelShared->mutex);
+	prev_xid = MyParallelShared->prev_xid;
+	prev_seq = MyParallelShared->prev_seq;
+	SpinLockRelease(&MyParallelShared->mutex);
+
+	if (prev_seq != 0)
+		pa_wait_for_dispatched_xact(prev_xid, prev_seq);
+}
+
+/*
+ * Finish applying a dispatched transaction, after committing it.
+ */
+void
+pa_end_dispatched_xact(void)
+{
+	TransactionId xid;
+	uint64		seq;
+
+	Assert(am_parallel_apply_worker());
+
+	SpinLockAcquire(&MyParallelShared->mutex);
+	MyParallelShared->last_commit_end = XactLastCommitEnd;
+	MyParallelShared->xact_state = PARALLEL_TRANS_FINISHED;
+	xid = MyParallelShared->xid;
+	seq = MyParallelShared->xact_seq;
+	SpinLockRelease(&MyParallelShared->mutex);
+
+	/* Publish the commit, and let the leader reuse us. */
+	LWLockAcquire(LogicalRepWorkerLock, LW_SHARED);
+	if (ParallelApplyLeader->in_use &&
+		ParallelApplyLeader->generation == ParallelApplyLeaderGeneration)
+	{
+		pg_atomic_write_membarrier_u64(&ParallelApplyLeader->parallel_committed_seq,
+									   seq);
+		if (ParallelApplyLeader->proc)
+			logicalrep_worker_wakeup_ptr(ParallelApplyLeader);
+	}
+	LWLockRelease(LogicalRepWorkerLock);
+
+	pa_unlock_transaction(xid, AccessExclusiveLock);
+}
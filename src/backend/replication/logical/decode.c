@@ -67,6 +67,12 @@ static inline bool FilterPrepare(LogicalDecodingContext *ctx,
 static bool DecodeTXNNeedSkip(LogicalDecodingContext *ctx,
 							  XLogRecordBuffer *buf, Oid txn_dbid,
 							  RepOriginId origin_id);
+static inline bool FilterByRelFileLocator(LogicalDecodingContext *ctx,
+										  XLogRecordBuffer *buf,
+										  ReorderBufferChangeType action,
+										  RelFileLocator *rlocator,
+										  bool toast_insert,
+										  bool clear_toast_afterwards);
 
 /*
  * Take every XLogReadRecord()ed record and perform the actions required to
@@ -574,6 +580,32 @@ FilterByOrigin(LogicalDecodingContext *ctx, RepOriginId origin_id)
 	return filter_by_origin_cb_wrapper(ctx, origin_id);
 }
 
+/*
+ * Ask the output plugin whether it is interested in changes to the relation,
+ * so that those it isn't interested in needn't be decoded and queued.
+ *
+ * That requires looking up the relation in the catalog, which is only
+ * possible once we have a consistent snapshot.
+ */
+static inline bool
+FilterByRelFileLocator(LogicalDecodingContext *ctx, XLogRecordBuffer *buf,
+					   ReorderBufferChangeType action,
+					   RelFileLocator *rlocator, bool toast_insert,
+					   bool clear_toast_afterwards)
+{
+	if (ctx->reorder->filter_change == NULL ||
+		SnapBuildCurrentState(ctx->snapshot_builder) < SNAPBUILD_CONSISTENT)
+		return false;
+
+	return ReorderBufferFilterByRelFileLocator(ctx->reorder,
+											   XLogRecGetXid(buf->record),
+											   buf->origptr,
+											   SnapBuildGetOrBuildSnapshot(ctx->snapshot_builder),
+											   action, rlocator,
+											   toast_insert,
+											   clear_toast_afterwards);
+}
+
 /*
  * Handle rmgr LOGICALMSG_ID records for LogicalDecodingProcessRecord().
  */
@@ -914,6 +946,16 @@ DecodeInsert(LogicalDecodingContext *ctx, XLogRecordBuffer *buf)
 	if (FilterByOrigin(ctx, XLogRecGetOrigin(r)))
 		return;
 
+	/* output plugin isn't interested in this relation, no need to queue */
+	if (FilterByRelFileLocator(ctx, buf,
+							   (xlrec->flags & XLH_INSERT_IS_SPECULATIVE) ?
+							   REORDER_BUFFER_CHANGE_INTERNAL_SPEC_INSERT :
+							   REORDER_BUFFER_CHANGE_INSERT,
+							   &target_locator,
+							   xlrec->flags & XLH_INSERT_ON_TOAST_RELATION,
+							   true))
+		return;
+
 	change = ReorderBufferAllocChange(ctx->reorder);
 	if (!(xlrec->flags & XLH_INSERT_IS_SPECULATIVE))
 		change->action = REORDER_BUFFER_CHANGE_INSERT;
@@ -964,6 +1006,11 @@ DecodeUpdate(LogicalDecodingContext *ctx, XLogRecordBuffer *buf)
 	if (FilterByOrigin(ctx, XLogRecGetOrigin(r)))
 		return;
 
+	/* output plugin isn't interested in this relation, no need to queue */
+	if (FilterByRelFileLocator(ctx, buf, REORDER_BUFFER_CHANGE_UPDATE,
+							   &target_locator, false, true))
+		return;
+
 	change = ReorderBufferAllocChange(ctx->reorder);
 	change->action = REORDER_BUFFER_CHANGE_UPDATE;
 	change->origin_id = XLogRecGetOrigin(r);
@@ -1030,6 +1077,14 @@ DecodeDelete(LogicalDecodingContext *ctx, XLogRecordBuffer *buf)
 	if (FilterByOrigin(ctx, XLogRecGetOrigin(r)))
 		return;
 
+	/* output plugin isn't interested in this relation, no need to queue */
+	if (FilterByRelFileLocator(ctx, buf,
+							   (xlrec->flags & XLH_DELETE_IS_SUPER) ?
+							   REORDER_BUFFER_CHANGE_INTERNAL_SPEC_ABORT :
+							   REORDER_BUFFER_CHANGE_DELETE,
+							   &target_locator, false, true))
+		return;
+
 	change = ReorderBufferAllocChange(ctx->reorder);
 
 	if (xlrec->flags & XLH_DELETE_IS_SUPER)
@@ -1132,6 +1187,12 @@ DecodeMultiInsert(LogicalDecodingContext *ctx, XLogRecordBuffer *buf)
 	if (FilterByOrigin(ctx, XLogRecGetOrigin(r)))
 		return;
 
+	/* output plugin isn't interested in this relation, no need to queue */
+	if (FilterByRelFileLocator(ctx, buf, REORDER_BUFFER_CHANGE_INSERT,
+							   &rlocator, false,
+							   (xlrec->flags & XLH_INSERT_LAST_IN_MULTI) != 0))
+		return;
+
 	/*
 	 * We know that this multi_insert isn't for a catalog, so the block should
 	 * always have data even if a full-page write of it is taken.
@@ -1223,6 +1284,12 @@ DecodeSpecConfirm(LogicalDecodingContext *ctx, XLogRecordBuffer *buf)
 	if (FilterByOrigin(ctx, XLogRecGetOrigin(r)))
 		return;
 
+	/* the speculative insertion wasn't queued either */
+	if (FilterByRelFileLocator(ctx, buf,
+							   REORDER_BUFFER_CHANGE_INTERNAL_SPEC_CONFIRM,
+							   &target_locator, false, true))
+		return;
+
 	change = ReorderBufferAllocChange(ctx->reorder);
 	change->action = REORDER_BUFFER_CHANGE_INTERNAL_SPEC_CONFIRM;
 	change->origin_id = XLogRecGetOrigin(r);
@@ -51,7 +51,9 @@
 /* GUC variables */
 int			max_logical_replication_workers = 4;
 int			max_sync_workers_per_subscription = 2;
+int			max_sync_workers_per_table = 0;
 int			max_parallel_apply_workers_per_subscription = 2;
+bool		parallel_apply_non_streamed = false;
 
 LogicalRepWorker *MyLogicalRepWorker = NULL;
 
@@ -483,6 +485,7 @@ retry:
 	worker->reply_lsn = InvalidXLogRecPtr;
 	TIMESTAMP_NOBEGIN(worker->reply_time);
 	worker->last_seqsync_start_time = 0;
+	pg_atomic_write_u64(&worker->parallel_committed_seq, 0);
 
 	/* Before releasing lock, remember generation for future identification. */
 	generation = worker->generation;
@@ -1055,6 +1058,7 @@ ApplyLauncherShmemInit(void)
 
 			memset(worker, 0, sizeof(LogicalRepWorker));
 			SpinLockInit(&worker->relmutex);
+			pg_atomic_init_u64(&worker->parallel_committed_seq, 0);
 		}
 	}
 }
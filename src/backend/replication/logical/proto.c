@@ -443,6 +443,88 @@ logicalrep_read_insert(StringInfo in, LogicalRepTupleData *newtup)
 	return relid;
 }
 
+/*
+ * Write one tuple of a MULTI INSERT.
+ *
+ * The tuples are collected in a separate buffer, which is then passed to
+ * logicalrep_write_multi_insert() along with their number.
+ */
+void
+logicalrep_write_multi_insert_tuple(StringInfo out, Relation rel,
+									TupleTableSlot *newslot, bool binary,
+									Bitmapset *columns,
+									PublishGencolsType include_gencols_type)
+{
+	pq_sendbyte(out, 'N');		/* new tuple follows */
+	logicalrep_write_tuple(out, rel, newslot, binary, columns,
+						   include_gencols_type);
+}
+
+/*
+ * Write MULTI INSERT to the output stream.
+ *
+ * A single tuple is sent as a plain INSERT, which looks the same apart from
+ * the tuple count.
+ */
+void
+logicalrep_write_multi_insert(StringInfo out, TransactionId xid, Oid relid,
+							  int ntuples, StringInfo tuples)
+{
+	Assert(ntuples > 0);
+
+	pq_sendbyte(out, ntuples > 1 ? LOGICAL_REP_MSG_MULTI_INSERT :
+				LOGICAL_REP_MSG_INSERT);
+
+	/* transaction ID (if not valid, we're not streaming) */
+	if (TransactionIdIsValid(xid))
+		pq_sendint32(out, xid);
+
+	/* use Oid as relation identifier */
+	pq_sendint32(out, relid);
+
+	if (ntuples > 1)
+		pq_sendint32(out, ntuples);
+	pq_sendbytes(out, tuples->data, tuples->len);
+}
+
+/*
+ * Read MULTI INSERT from stream.
+ *
+ * Returns the relation ID and the number of tuples, which the caller then
+ * reads one by one with logicalrep_read_multi_insert_tuple().
+ */
+LogicalRepRelId
+logicalrep_read_multi_insert(StringInfo in, int *ntuples)
+{
+	LogicalRepRelId relid;
+
+	/* read the relation id */
+	relid = pq_getmsgint(in, 4);
+
+	*ntuples = pq_getmsgint(in, 4);
+	if (*ntuples <= 0)
+		elog(ERROR, "invalid number of tuples in multi-insert: %d",
+			 *ntuples);
+
+	return relid;
+}
+
+/*
+ * Read the next tuple of a MULTI INSERT.
+ */
+void
+logicalrep_read_multi_insert_tuple(StringInfo in, LogicalRepTupleData *newtup)
+{
+	char		action;
+
+	action = pq_getmsgbyte(in);
+	if (action != 'N')
+		elog(ERROR, "expected new tuple but got %d",
+			 action);
+
+	logicalrep_read_tuple(in, newtup);
+}
+
 /*
  * Write UPDATE to the output stream.
  */
@@ -1223,6 +1305,8 @@ logicalrep_message_type(LogicalRepMsgType action)
 			return "ORIGIN";
 		case LOGICAL_REP_MSG_INSERT:
 			return "INSERT";
+		case LOGICAL_REP_MSG_MULTI_INSERT:
+			return "MULTI INSERT";
 		case LOGICAL_REP_MSG_UPDATE:
 			return "UPDATE";
 		case LOGICAL_REP_MSG_DELETE:
@@ -82,12 +82,25 @@
  *	  a bit more memory to the oldest subtransactions, because it's likely
  *	  they are the source for the next sequence of changes.
  *
+ *	  Serialized changes are not written out one at a time, but collected
+ *	  into chunks of about REORDER_BUFFER_SPILL_CHUNK_SIZE bytes, each of
+ *	  which is compressed with logical_decoding_spill_compression and written
+ *	  with a small header.  Large transactions therefore need less disk space
+ *	  and I/O, and are read back a whole chunk at a time, with the kernel
+ *	  asked to read ahead of the chunk being restored.
+ *
  * -------------------------------------------------------------------------
  */
 #include "postgres.h"
 
 #include <unistd.h>
 #include <sys/stat.h>
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
 
 #include "access/detoast.h"
 #include "access/heapam.h"
@@ -97,6 +110,7 @@
 #include "access/xlog_internal.h"
 #include "catalog/catalog.h"
 #include "common/int.h"
+#include "common/pg_lzcompress.h"
 #include "lib/binaryheap.h"
 #include "miscadmin.h"
 #include "pgstat.h"
@@ -153,6 +167,12 @@ typedef struct TXNEntryFile
 	File		vfd;			/* -1 when the file is closed */
 	off_t		curOffset;		/* offset for next write or read. Reset to 0
 								 * when vfd is opened. */
+	off_t		prefetchOffset; /* end of the range read-ahead was requested
+								 * for */
+	char	   *chunk;			/* decompressed chunk being restored */
+	Size		chunksize;		/* allocated size of chunk */
+	Size		chunklen;		/* number of valid bytes in chunk */
+	Size		chunkpos;		/* offset of the next change in chunk */
 } TXNEntryFile;
 
 /* k-way in-order change iteration support structures */
@@ -194,6 +214,24 @@ typedef struct ReorderBufferDiskChange
 	/* data follows */
 } ReorderBufferDiskChange;
 
+/*
+ * Header of a chunk of serialized changes in a spill file.  The data that
+ * follows is compressed with the given method, or stored raw if the method
+ * is SPILL_COMPRESSION_NONE.
+ */
+typedef struct ReorderBufferSpillChunk
+{
+	uint32		rawlen;			/* length of the serialized changes */
+	uint32		storedlen;		/* length of the data following the header */
+	int32		method;			/* SpillCompressionMethod */
+} ReorderBufferSpillChunk;
+
+/* Amount of serialized changes collected before they are written out */
+#define REORDER_BUFFER_SPILL_CHUNK_SIZE		(64 * 1024)
+
+/* How far ahead of the chunk being restored to ask the kernel to read */
+#define REORDER_BUFFER_SPILL_READAHEAD		(1024 * 1024)
+
 #define IsSpecInsert(action) \
 ( \
 	((action) == REORDER_BUFFER_CHANGE_INTERNAL_SPEC_INSERT) \
@@ -225,8 +263,9 @@ typedef struct ReorderBufferDiskChange
 int			logical_decoding_work_mem;
 static const Size max_changes_in_memory = 4096; /* XXX for restore only */
 
-/* GUC variable */
+/* GUC variables */
 int			debug_logical_replication_streaming = DEBUG_LOGICAL_REP_STREAMING_BUFFERED;
+int			logical_decoding_spill_compression = SPILL_COMPRESSION_NONE;
 
 /* ---------------------------------------
  * primary reorderbuffer support routines
@@ -266,8 +305,11 @@ static void ReorderBufferCheckMemoryLimit(ReorderBuffer *rb);
 static void ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn);
 static void ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 										 int fd, ReorderBufferChange *change);
+static void ReorderBufferSpillFlush(ReorderBuffer *rb, ReorderBufferTXN *txn,
+									int fd);
 static Size ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 										TXNEntryFile *file, XLogSegNo *segno);
+static bool ReorderBufferReadSpillChunk(ReorderBuffer *rb, TXNEntryFile *file);
 static void ReorderBufferRestoreChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 									   char *data);
 static void ReorderBufferRestoreCleanup(ReorderBuffer *rb, ReorderBufferTXN *txn);
@@ -377,8 +419,16 @@ ReorderBufferAllocate(void)
 	buffer->by_txn_last_xid = InvalidTransactionId;
 	buffer->by_txn_last_txn = NULL;
 
+	buffer->filter_change = NULL;
+	buffer->filter_cache = NULL;
+
 	buffer->outbuf = NULL;
 	buffer->outbufsize = 0;
+	buffer->spillbuf = NULL;
+	buffer->spillbufsize = 0;
+	buffer->spillbuflen = 0;
+	buffer->compressbuf = NULL;
+	buffer->compressbufsize = 0;
 	buffer->size = 0;
 
 	/* txn_heap is ordered by transaction size */
@@ -387,6 +437,7 @@ ReorderBufferAllocate(void)
 	buffer->spillTxns = 0;
 	buffer->spillCount = 0;
 	buffer->spillBytes = 0;
+	buffer->spillCompressedBytes = 0;
 	buffer->streamTxns = 0;
 	buffer->streamCount = 0;
 	buffer->streamBytes = 0;
@@ -1510,6 +1561,8 @@ ReorderBufferIterTXNFinish(ReorderBuffer *rb,
 	{
 		if (state->entries[off].file.vfd != -1)
 			FileClose(state->entries[off].file.vfd);
+		if (state->entries[off].file.chunk)
+			pfree(state->entries[off].file.chunk);
 	}
 
 	/* free memory we might have "leaked" in the last *Next call */
@@ -3734,6 +3787,212 @@ ReorderBufferXidHasCatalogChanges(ReorderBuffer *rb, TransactionId xid)
 	return rbtxn_has_catalog_changes(txn);
 }
 
+/*
+ * Entry in the cache of filter_change decisions.
+ */
+typedef struct ReorderBufferFilterCacheEnt
+{
+	RelFileLocator rlocator;	/* hash key -- must be first */
+	bool		filtered;
+} ReorderBufferFilterCacheEnt;
+
+/*
+ * Ask filter_change whether changes to the relation with the given
+ * relfilelocator are of interest, looking it up with the given snapshot.
+ */
+static bool
+ReorderBufferFilterRelation(ReorderBuffer *rb, Snapshot snapshot,
+							RelFileLocator *rlocator)
+{
+	ReorderBufferFilterCacheEnt *ent;
+	bool		found;
+	bool		using_subtxn;
+	MemoryContext ccxt = CurrentMemoryContext;
+	ResourceOwner cowner = CurrentResourceOwner;
+	bool		filtered = false;
+
+	if (rb->filter_cache == NULL)
+	{
+		HASHCTL		hash_ctl;
+
+		hash_ctl.keysize = sizeof(RelFileLocator);
+		hash_ctl.entrysize = sizeof(ReorderBufferFilterCacheEnt);
+		hash_ctl.hcxt = rb->context;
+
+		rb->filter_cache = hash_create("ReorderBufferFilterCache", 64,
+									   &hash_ctl,
+									   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	ent = hash_search(rb->filter_cache, rlocator, HASH_FIND, NULL);
+	if (ent)
+		return ent->filtered;
+
+	/* Look up the relation, the same way as ReorderBufferProcessTXN() */
+	using_subtxn = IsTransactionOrTransactionBlock();
+	if (using_subtxn)
+		BeginInternalSubTransaction("filter");
+	else
+		StartTransactionCommand();
+
+	SetupHistoricSnapshot(snapshot, NULL);
+
+	PG_TRY();
+	{
+		Oid			reloid;
+		Relation	relation = NULL;
+
+		reloid = RelidByRelfilenumber(rlocator->spcOid, rlocator->relNumber);
+		if (OidIsValid(reloid))
+			relation = RelationIdGetRelation(reloid);
+
+		/*
+		 * Changes to a TOAST table are only of interest if changes to the
+		 * table it belongs to are.  TOAST tables are named after the OID of
+		 * that table.
+		 */
+		if (RelationIsValid(relation) && IsToastRelation(relation))
+		{
+			Oid			mainreloid = InvalidOid;
+			char	   *toast_name = RelationGetRelationName(relation);
+
+			if (strncmp(toast_name, "pg_toast_", 9) == 0)
+				mainreloid = (Oid) strtoul(toast_name + 9, NULL, 10);
+
+			RelationClose(relation);
+			relation = NULL;
+			if (OidIsValid(mainreloid))
+				relation = RelationIdGetRelation(mainreloid);
+		}
+
+		/*
+		 * Leave anything unusual to ReorderBufferProcessTXN(), which skips
+		 * changes that don't concern the output plugin anyway.
+		 */
+		if (RelationIsValid(relation))
+		{
+			if (RelationIsLogicallyLogged(relation) &&
+				!relation->rd_rel->relrewrite)
+				filtered = rb->filter_change(rb, relation);
+			RelationClose(relation);
+		}
+
+		TeardownHistoricSnapshot(false);
+	}
+	PG_CATCH();
+	{
+		TeardownHistoricSnapshot(true);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	if (using_subtxn)
+	{
+		RollbackAndReleaseCurrentSubTransaction();
+		MemoryContextSwitchTo(ccxt);
+		CurrentResourceOwner = cowner;
+	}
+	else
+	{
+		AbortCurrentTransaction();
+		MemoryContextSwitchTo(ccxt);
+	}
+
+	ent = hash_search(rb->filter_cache, rlocator, HASH_ENTER, &found);
+	ent->filtered = filtered;
+
+	return filtered;
+}
+
+/*
+ * ReorderBufferFilterByRelFileLocator
+ *		Can a change to the given relation be discarded without queueing it?
+ *
+ * This lets the output plugin discard changes to relations it is not
+ * interested in as soon as they are decoded, rather than when the transaction
+ * is replayed, which saves building the tuples and keeping them in memory or
+ * on disk meanwhile.  The decision is made with the given snapshot, which
+ * has to be the current catalog snapshot of the snapshot builder: it is what
+ * the change would be replayed with, unless the transaction has modified the
+ * catalog itself.  We don't filter changes in such transactions at all.
+ *
+ * The decisions are cached, until ReorderBufferResetFilterCache() is called
+ * when the catalog snapshot changes.  That means that the decision for a
+ * relation can change between changes of a transaction, so make sure that
+ * TOAST chunks and speculative insertions are kept if and only if the tuple
+ * they belong to is.
+ */
+bool
+ReorderBufferFilterByRelFileLocator(ReorderBuffer *rb, TransactionId xid,
+									XLogRecPtr lsn, Snapshot snapshot,
+									ReorderBufferChangeType action,
+									RelFileLocator *rlocator,
+									bool toast_insert,
+									bool clear_toast_afterwards)
+{
+	ReorderBufferTXN *txn;
+	bool		filtered;
+
+	if (rb->filter_change == NULL)
+		return false;
+
+	txn = ReorderBufferTXNByXid(rb, xid, true, NULL, lsn, true);
+
+	/* Follow the speculative insertion that is being confirmed. */
+	if (action == REORDER_BUFFER_CHANGE_INTERNAL_SPEC_CONFIRM)
+	{
+		filtered = (txn->txn_flags & RBTXN_FILTERED_SPEC_INSERT) != 0;
+		txn->txn_flags &= ~RBTXN_FILTERED_SPEC_INSERT;
+		return filtered;
+	}
+
+	/*
+	 * Aborts of speculative insertions are ignored at replay if the insertion
+	 * was not queued, so always keep them.
+	 */
+	if (action == REORDER_BUFFER_CHANGE_INTERNAL_SPEC_ABORT)
+		return false;
+
+	if (txn->txn_flags & RBTXN_PENDING_TOAST)
+	{
+		/* Do the same as for the TOAST chunks seen before. */
+		filtered = (txn->txn_flags & RBTXN_FILTERED_TOAST) != 0;
+	}
+	else if (rbtxn_has_catalog_changes(txn) ||
+			 rbtxn_has_catalog_changes(rbtxn_get_toptxn(txn)))
+		filtered = false;
+	else
+		filtered = ReorderBufferFilterRelation(rb, snapshot, rlocator);
+
+	if (toast_insert)
+	{
+		txn->txn_flags |= RBTXN_PENDING_TOAST;
+		if (filtered)
+			txn->txn_flags |= RBTXN_FILTERED_TOAST;
+	}
+	else if (clear_toast_afterwards)
+		txn->txn_flags &= ~(RBTXN_PENDING_TOAST | RBTXN_FILTERED_TOAST);
+
+	if (action == REORDER_BUFFER_CHANGE_INTERNAL_SPEC_INSERT && filtered)
+		txn->txn_flags |= RBTXN_FILTERED_SPEC_INSERT;
+
+	return filtered;
+}
+
+/*
+ * ReorderBufferResetFilterCache
+ *		Forget the decisions of filter_change, as the catalog has changed.
+ */
+void
+ReorderBufferResetFilterCache(ReorderBuffer *rb)
+{
+	if (rb->filter_cache == NULL)
+		return;
+
+	hash_destroy(rb->filter_cache);
+	rb->filter_cache = NULL;
+}
+
 /*
  * ReorderBufferXidHasBaseSnapshot
  *		Have we already set the base snapshot for the given txn/subtxn?
@@ -3766,23 +4025,34 @@ ReorderBufferXidHasBaseSnapshot(ReorderBuffer *rb, TransactionId xid)
  */
 
 /*
- * Ensure the IO buffer is >= sz.
+ * Ensure the buffer *buf, currently of size *bufsize, is >= sz.  Existing
+ * contents are preserved.
  */
 static void
-ReorderBufferSerializeReserve(ReorderBuffer *rb, Size sz)
+ReorderBufferReserveBuffer(ReorderBuffer *rb, char **buf, Size *bufsize,
+						   Size sz)
 {
-	if (!rb->outbufsize)
+	if (!*bufsize)
 	{
-		rb->outbuf = MemoryContextAlloc(rb->context, sz);
-		rb->outbufsize = sz;
+		*buf = MemoryContextAlloc(rb->context, sz);
+		*bufsize = sz;
 	}
-	else if (rb->outbufsize < sz)
+	else if (*bufsize < sz)
 	{
-		rb->outbuf = repalloc(rb->outbuf, sz);
-		rb->outbufsize = sz;
+		*buf = repalloc(*buf, sz);
+		*bufsize = sz;
 	}
 }
 
+/*
+ * Ensure the IO buffer is >= sz.
+ */
+static void
+ReorderBufferSerializeReserve(ReorderBuffer *rb, Size sz)
+{
+	ReorderBufferReserveBuffer(rb, &rb->outbuf, &rb->outbufsize, sz);
+}
+
 
 /* Compare two transactions by size */
 static int
@@ -4006,6 +4276,9 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 	elog(DEBUG2, "spill %u changes in XID %u to disk",
 		 (uint32) txn->nentries_mem, txn->xid);
 
+	/* discard anything left behind by a spill that failed partway */
+	rb->spillbuflen = 0;
+
 	/* do the same to all child TXs */
 	dlist_foreach(subtxn_i, &txn->subtxns)
 	{
@@ -4032,7 +4305,10 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 			char		path[MAXPGPATH];
 
 			if (fd != -1)
+			{
+				ReorderBufferSpillFlush(rb, txn, fd);
 				CloseTransientFile(fd);
+			}
 
 			XLByteToSeg(change->lsn, curOpenSegNo, wal_segment_size);
 
@@ -4060,6 +4336,12 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 		spilled++;
 	}
 
+	if (fd != -1)
+	{
+		ReorderBufferSpillFlush(rb, txn, fd);
+		CloseTransientFile(fd);
+	}
+
 	/* Update the memory counter */
 	ReorderBufferChangeMemoryUpdate(rb, NULL, txn, false, size);
 
@@ -4080,9 +4362,6 @@ ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 	Assert(dlist_is_empty(&txn->changes));
 	txn->nentries_mem = 0;
 	txn->txn_flags |= RBTXN_IS_SERIALIZED;
-
-	if (fd != -1)
-		CloseTransientFile(fd);
 }
 
 /*
@@ -4271,9 +4550,113 @@ ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 
 	ondisk->size = sz;
 
+	/* add it to the current chunk, writing that out once it is big enough */
+	ReorderBufferReserveBuffer(rb, &rb->spillbuf, &rb->spillbufsize,
+							   Max(rb->spillbuflen + sz,
+								   REORDER_BUFFER_SPILL_CHUNK_SIZE));
+	memcpy(rb->spillbuf + rb->spillbuflen, rb->outbuf, sz);
+	rb->spillbuflen += sz;
+
+	if (rb->spillbuflen >= REORDER_BUFFER_SPILL_CHUNK_SIZE)
+		ReorderBufferSpillFlush(rb, txn, fd);
+
+	/*
+	 * Keep the transaction's final_lsn up to date with each change we send to
+	 * disk, so that ReorderBufferRestoreCleanup works correctly.  (We used to
+	 * only do this on commit and abort records, but that doesn't work if a
+	 * system crash leaves a transaction without its abort record).
+	 *
+	 * Make sure not to move it backwards.
+	 */
+	if (txn->final_lsn < change->lsn)
+		txn->final_lsn = change->lsn;
+
+	Assert(ondisk->change.action == change->action);
+}
+
+/*
+ * Write the changes collected by ReorderBufferSerializeChange to fd as one
+ * chunk, compressed with logical_decoding_spill_compression.
+ */
+static void
+ReorderBufferSpillFlush(ReorderBuffer *rb, ReorderBufferTXN *txn, int fd)
+{
+	ReorderBufferSpillChunk *hdr;
+	char	   *dest;
+	Size		rawlen = rb->spillbuflen;
+	int			method = logical_decoding_spill_compression;
+	int			len = -1;
+	Size		towrite;
+
+	if (rawlen == 0)
+		return;
+
+	/*
+	 * Compressed data is only kept if it is smaller than the raw data, so the
+	 * buffer never needs to be larger than that, except that pglz insists on
+	 * a little slack.
+	 */
+	ReorderBufferReserveBuffer(rb, &rb->compressbuf, &rb->compressbufsize,
+							   sizeof(ReorderBufferSpillChunk) +
+							   PGLZ_MAX_OUTPUT(rawlen));
+	hdr = (ReorderBufferSpillChunk *) rb->compressbuf;
+	dest = rb->compressbuf + sizeof(ReorderBufferSpillChunk);
+
+	switch ((SpillCompressionMethod) method)
+	{
+		case SPILL_COMPRESSION_NONE:
+			break;
+
+		case SPILL_COMPRESSION_PGLZ:
+			len = pglz_compress(rb->spillbuf, rawlen, dest,
+								PGLZ_strategy_default);
+			break;
+
+		case SPILL_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			len = LZ4_compress_default(rb->spillbuf, dest, rawlen, rawlen - 1);
+			if (len <= 0)
+				len = -1;
+#else
+			elog(ERROR, "LZ4 is not supported by this build");
+#endif
+			break;
+
+		case SPILL_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				size_t		zlen;
+
+				zlen = ZSTD_compress(dest, rawlen - 1, rb->spillbuf, rawlen,
+									 ZSTD_CLEVEL_DEFAULT);
+				len = ZSTD_isError(zlen) ? -1 : (int) zlen;
+			}
+#else
+			elog(ERROR, "zstd is not supported by this build");
+#endif
+			break;
+
+		default:
+			elog(ERROR, "unrecognized spill file compression method: %d",
+				 method);
+			break;
+	}
+
+	/* Store the data raw if it didn't compress */
+	if (len < 0 || (Size) len >= rawlen)
+	{
+		memcpy(dest, rb->spillbuf, rawlen);
+		len = rawlen;
+		method = SPILL_COMPRESSION_NONE;
+	}
+	hdr->rawlen = rawlen;
+	hdr->storedlen = len;
+	hdr->method = method;
+	towrite = sizeof(ReorderBufferSpillChunk) + len;
+
 	errno = 0;
 	pgstat_report_wait_start(WAIT_EVENT_REORDER_BUFFER_WRITE);
-	if (write(fd, rb->outbuf, ondisk->size) != ondisk->size)
+	if (write(fd, rb->compressbuf, towrite) != towrite)
 	{
 		int			save_errno = errno;
 
@@ -4288,18 +4671,8 @@ ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 	}
 	pgstat_report_wait_end();
 
-	/*
-	 * Keep the transaction's final_lsn up to date with each change we send to
-	 * disk, so that ReorderBufferRestoreCleanup works correctly.  (We used to
-	 * only do this on commit and abort records, but that doesn't work if a
-	 * system crash leaves a transaction without its abort record).
-	 *
-	 * Make sure not to move it backwards.
-	 */
-	if (txn->final_lsn < change->lsn)
-		txn->final_lsn = change->lsn;
-
-	Assert(ondisk->change.action == change->action);
+	rb->spillbuflen = 0;
+	rb->spillCompressedBytes += towrite;
 }
 
 /* Returns true, if the output plugin supports streaming, false, otherwise. */
@@ -4568,8 +4941,7 @@ ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 
 	while (restored < max_changes_in_memory && *segno <= last_segno)
 	{
-		int			readBytes;
-		ReorderBufferDiskChange *ondisk;
+		Size		size;
 
 		CHECK_FOR_INTERRUPTS();
 
@@ -4592,8 +4964,11 @@ ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 
 			*fd = PathNameOpenFile(path, O_RDONLY | PG_BINARY);
 
-			/* No harm in resetting the offset even in case of failure */
+			/* No harm in resetting the offsets even in case of failure */
 			file->curOffset = 0;
+			file->prefetchOffset = 0;
+			file->chunklen = 0;
+			file->chunkpos = 0;
 
 			if (*fd < 0 && errno == ENOENT)
 			{
@@ -4609,60 +4984,39 @@ ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 		}
 
 		/*
-		 * Read the statically sized part of a change which has information
-		 * about the total size. If we couldn't read a record, we're at the
-		 * end of this file.
+		 * Read the next chunk of changes once the current one is used up. If
+		 * there is none, we're at the end of this file.
 		 */
-		ReorderBufferSerializeReserve(rb, sizeof(ReorderBufferDiskChange));
-		readBytes = FileRead(file->vfd, rb->outbuf,
-							 sizeof(ReorderBufferDiskChange),
-							 file->curOffset, WAIT_EVENT_REORDER_BUFFER_READ);
-
-		/* eof */
-		if (readBytes == 0)
+		if (file->chunkpos >= file->chunklen &&
+			!ReorderBufferReadSpillChunk(rb, file))
 		{
 			FileClose(*fd);
 			*fd = -1;
 			(*segno)++;
 			continue;
 		}
-		else if (readBytes < 0)
-			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("could not read from reorderbuffer spill file: %m")));
-		else if (readBytes != sizeof(ReorderBufferDiskChange))
-			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("could not read from reorderbuffer spill file: read %d instead of %u bytes",
-							readBytes,
-							(uint32) sizeof(ReorderBufferDiskChange))));
-
-		file->curOffset += readBytes;
-
-		ondisk = (ReorderBufferDiskChange *) rb->outbuf;
-
-		ReorderBufferSerializeReserve(rb,
-									  sizeof(ReorderBufferDiskChange) + ondisk->size);
-		ondisk = (ReorderBufferDiskChange *) rb->outbuf;
 
-		readBytes = FileRead(file->vfd,
-							 rb->outbuf + sizeof(ReorderBufferDiskChange),
-							 ondisk->size - sizeof(ReorderBufferDiskChange),
-							 file->curOffset,
-							 WAIT_EVENT_REORDER_BUFFER_READ);
-
-		if (readBytes < 0)
+		/*
+		 * Changes are not aligned within the chunk, so copy the change into
+		 * the maxaligned IO buffer before restoring it.
+		 */
+		if (file->chunklen - file->chunkpos < sizeof(ReorderBufferDiskChange))
 			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("could not read from reorderbuffer spill file: %m")));
-		else if (readBytes != ondisk->size - sizeof(ReorderBufferDiskChange))
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg_internal("truncated change in reorderbuffer spill file")));
+		memcpy(&size,
+			   file->chunk + file->chunkpos +
+			   offsetof(ReorderBufferDiskChange, size),
+			   sizeof(Size));
+		if (size < sizeof(ReorderBufferDiskChange) ||
+			size > file->chunklen - file->chunkpos)
 			ereport(ERROR,
-					(errcode_for_file_access(),
-					 errmsg("could not read from reorderbuffer spill file: read %d instead of %u bytes",
-							readBytes,
-							(uint32) (ondisk->size - sizeof(ReorderBufferDiskChange)))));
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg_internal("truncated change in reorderbuffer spill file")));
 
-		file->curOffset += readBytes;
+		ReorderBufferSerializeReserve(rb, size);
+		memcpy(rb->outbuf, file->chunk + file->chunkpos, size);
+		file->chunkpos += size;
 
 		/*
 		 * ok, read a full change from disk, now restore it into proper
@@ -4675,6 +5029,135 @@ ReorderBufferRestoreChanges(ReorderBuffer *rb, ReorderBufferTXN *txn,
 	return restored;
 }
 
+/*
+ * Read the next chunk of a spill file into file->chunk, decompressing it if
+ * needed.  Returns false at the end of the file.
+ *
+ * The kernel is asked to read ahead of the chunk, so that restoring a large
+ * transaction does not have to wait for every chunk to come from disk.
+ */
+static bool
+ReorderBufferReadSpillChunk(ReorderBuffer *rb, TXNEntryFile *file)
+{
+	ReorderBufferSpillChunk hdr;
+	char	   *data;
+	int			readBytes;
+	int			rawlen;
+
+	if (file->curOffset + REORDER_BUFFER_SPILL_READAHEAD / 2 >=
+		file->prefetchOffset)
+	{
+		file->prefetchOffset = Max(file->prefetchOffset, file->curOffset);
+		(void) FilePrefetch(file->vfd, file->prefetchOffset,
+							REORDER_BUFFER_SPILL_READAHEAD,
+							WAIT_EVENT_REORDER_BUFFER_READ);
+		file->prefetchOffset += REORDER_BUFFER_SPILL_READAHEAD;
+	}
+
+	readBytes = FileRead(file->vfd, &hdr, sizeof(hdr), file->curOffset,
+						 WAIT_EVENT_REORDER_BUFFER_READ);
+
+	/* eof */
+	if (readBytes == 0)
+		return false;
+	else if (readBytes < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from reorderbuffer spill file: %m")));
+	else if (readBytes != sizeof(hdr))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from reorderbuffer spill file: read %d instead of %u bytes",
+						readBytes,
+						(uint32) sizeof(hdr))));
+
+	file->curOffset += readBytes;
+
+	if (hdr.rawlen == 0 || hdr.storedlen == 0 || hdr.storedlen > hdr.rawlen ||
+		(hdr.method == SPILL_COMPRESSION_NONE && hdr.storedlen != hdr.rawlen))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("invalid chunk header in reorderbuffer spill file")));
+
+	/* Raw data is read straight into the chunk buffer */
+	ReorderBufferReserveBuffer(rb, &file->chunk, &file->chunksize, hdr.rawlen);
+	if (hdr.method == SPILL_COMPRESSION_NONE)
+		data = file->chunk;
+	else
+	{
+		ReorderBufferReserveBuffer(rb, &rb->compressbuf, &rb->compressbufsize,
+								   hdr.storedlen);
+		data = rb->compressbuf;
+	}
+
+	readBytes = FileRead(file->vfd, data, hdr.storedlen, file->curOffset,
+						 WAIT_EVENT_REORDER_BUFFER_READ);
+	if (readBytes < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from reorderbuffer spill file: %m")));
+	else if (readBytes != hdr.storedlen)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from reorderbuffer spill file: read %d instead of %u bytes",
+						readBytes, hdr.storedlen)));
+
+	file->curOffset += readBytes;
+
+	switch ((SpillCompressionMethod) hdr.method)
+	{
+		case SPILL_COMPRESSION_NONE:
+			rawlen = hdr.rawlen;
+			break;
+
+		case SPILL_COMPRESSION_PGLZ:
+			rawlen = pglz_decompress(data, hdr.storedlen, file->chunk,
+									 hdr.rawlen, true);
+			break;
+
+		case SPILL_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			rawlen = LZ4_decompress_safe(data, file->chunk, hdr.storedlen,
+										 hdr.rawlen);
+#else
+			elog(ERROR, "LZ4 is not supported by this build");
+			rawlen = -1;		/* keep compiler quiet */
+#endif
+			break;
+
+		case SPILL_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				size_t		len;
+
+				len = ZSTD_decompress(file->chunk, hdr.rawlen, data,
+									  hdr.storedlen);
+				rawlen = ZSTD_isError(len) ? -1 : (int) len;
+			}
+#else
+			elog(ERROR, "zstd is not supported by this build");
+			rawlen = -1;		/* keep compiler quiet */
+#endif
+			break;
+
+		default:
+			elog(ERROR, "unrecognized spill file compression method: %d",
+				 hdr.method);
+			rawlen = -1;		/* keep compiler quiet */
+			break;
+	}
+
+	if (rawlen < 0 || (uint32) rawlen != hdr.rawlen)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("could not decompress chunk of reorderbuffer spill file")));
+
+	file->chunklen = hdr.rawlen;
+	file->chunkpos = 0;
+
+	return true;
+}
+
 /*
  * Convert change from its on-disk format to in-memory format and queue it onto
  * the TXN's ->changes list.
@@ -14,7 +14,9 @@
  *	  The initial data synchronization is done separately for each table,
  *	  in a separate apply worker that only fetches the initial snapshot data
  *	  from the publisher and then synchronizes the position in the stream with
- *	  the leader apply worker.
+ *	  the leader apply worker.  The copy of a large table can in turn be
+ *	  split between the tablesync worker and some helper processes, see
+ *	  copy_table_parallel().
  *
  *	  There are several reasons for doing the synchronization this way:
  *	   - It allows us to parallelize the initial data synchronization
@@ -95,6 +97,7 @@
 #include "postgres.h"
 
 #include "access/table.h"
+#include "access/twophase.h"
 #include "access/xact.h"
 #include "catalog/indexing.h"
 #include "catalog/pg_subscription_rel.h"
@@ -102,8 +105,11 @@
 #include "commands/copy.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
+#include "optimizer/paths.h"
 #include "parser/parse_relation.h"
 #include "pgstat.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/interrupt.h"
 #include "replication/logicallauncher.h"
 #include "replication/logicalrelation.h"
 #include "replication/logicalworker.h"
@@ -111,12 +117,18 @@
 #include "replication/slot.h"
 #include "replication/walreceiver.h"
 #include "replication/worker_internal.h"
+#include "storage/dsm.h"
 #include "storage/ipc.h"
 #include "storage/lmgr.h"
+#include "storage/procarray.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
 #include "utils/acl.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/guc.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/rls.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
@@ -1034,6 +1046,665 @@ fetch_remote_table_info(char *nspname, char *relname, LogicalRepRelation *lrel,
 	pfree(cmd.data);
 }
 
+/*
+ * Parallel copy of large tables.
+ *
+ * The copy of a large table can be split between the tablesync worker and up
+ * to max_sync_workers_per_table helper processes.  The tablesync worker
+ * exports the snapshot of its transaction on the publisher, in which the
+ * table is consistent with the start of its replication slot, and the
+ * helpers import it into transactions of their own.  The table is divided
+ * into chunks of consecutive blocks, which the participants take on in turn,
+ * each running a COPY restricted to the chunk's range of ctids.  The loading
+ * on the subscriber is done by the same CopyFrom() as a normal table sync.
+ *
+ * The copy must become visible atomically, together with the FINISHEDCOPY
+ * state, or else a failed sync would leave part of the data behind to be
+ * copied again.  So the helpers don't commit their transactions: they
+ * prepare them, with a GID that includes the XID of the tablesync worker's
+ * transaction, which commits the state change.  Prepared transactions that
+ * belong to a committed tablesync transaction are then committed, and those
+ * that don't are rolled back, see finish_parallel_sync_xacts().  That is
+ * also done when a tablesync worker starts, in case its predecessor failed
+ * in the middle.  This needs max_prepared_transactions to be large enough on
+ * the subscriber.
+ *
+ * Helpers are plain background workers, not logical replication workers;
+ * they only live for the duration of the copy.
+ */
+
+/* Number of chunks to aim for per participating process, for balance */
+#define PARALLEL_SYNC_CHUNKS_PER_WORKER		8
+
+typedef struct ParallelSyncShared
+{
+	/* Set up by the tablesync worker, constant afterwards */
+	Oid			subid;
+	Oid			relid;
+	Oid			dbid;
+	Oid			userid;
+	pid_t		leader_pid;
+	ProcNumber	leader_procno;
+	TransactionId leader_xid;
+	bool		binary;			/* COPY in binary format? */
+	BlockNumber chunk_blocks;	/* publisher blocks per chunk */
+	uint32		nchunks;
+	int			nworkers;
+
+	/* Next chunk to copy */
+	pg_atomic_uint32 next_chunk;
+
+	/* Protects prepared[] */
+	slock_t		mutex;
+
+	/* Has helper i + 1 prepared its transaction? */
+	bool		prepared[FLEXIBLE_ARRAY_MEMBER];
+
+	/*
+	 * Followed by the nul-terminated name of the exported snapshot, the
+	 * parts of the COPY command before and after the ctid range condition,
+	 * and the names of the columns to copy.
+	 */
+} ParallelSyncShared;
+
+/* Helpers launched by this tablesync worker, terminated at exit */
+static BackgroundWorkerHandle **parallel_sync_handles = NULL;
+static int	parallel_sync_nhandles = 0;
+
+static void parallel_sync_shutdown(int code, Datum arg);
+
+/*
+ * Form the GID of the transaction prepared by a helper.
+ */
+static void
+parallel_sync_gid(Oid subid, Oid relid, TransactionId leader_xid,
+				  int worker_number, char *gid, int szgid)
+{
+	snprintf(gid, szgid, "pg_sync_%u_%u_%u_%d",
+			 subid, relid, leader_xid, worker_number);
+}
+
+/*
+ * Return the strings stored after the fixed part of the shared state.
+ */
+static void
+parallel_sync_strings(ParallelSyncShared *shared, char **snapshot,
+					  char **cmd_head, char **cmd_tail, List **attnamelist)
+{
+	char	   *p = (char *) &shared->prepared[shared->nworkers];
+	int			natts;
+
+	*snapshot = p;
+	p += strlen(p) + 1;
+	*cmd_head = p;
+	p += strlen(p) + 1;
+	*cmd_tail = p;
+	p += strlen(p) + 1;
+	memcpy(&natts, p, sizeof(int));
+	p += sizeof(int);
+
+	*attnamelist = NIL;
+	for (int i = 0; i < natts; i++)
+	{
+		*attnamelist = lappend(*attnamelist, makeString(p));
+		p += strlen(p) + 1;
+	}
+}
+
+/*
+ * Copy chunks of the table until there are none left.
+ *
+ * Used by both the tablesync worker and its helpers, each with its own
+ * connection to the publisher and transaction on the subscriber.
+ */
+static void
+copy_table_chunks(Relation rel, ParallelSyncShared *shared)
+{
+	char	   *snapshot;
+	char	   *cmd_head;
+	char	   *cmd_tail;
+	List	   *attnamelist;
+	List	   *options = NIL;
+	StringInfoData cmd;
+
+	parallel_sync_strings(shared, &snapshot, &cmd_head, &cmd_tail,
+						  &attnamelist);
+	if (shared->binary)
+		options = list_make1(makeDefElem("format",
+										 (Node *) makeString("binary"), -1));
+
+	if (copybuf == NULL)
+		copybuf = makeStringInfo();
+
+	initStringInfo(&cmd);
+
+	for (;;)
+	{
+		uint32		chunk = pg_atomic_fetch_add_u32(&shared->next_chunk, 1);
+		BlockNumber start;
+		WalRcvExecResult *res;
+		ParseState *pstate;
+		CopyFromState cstate;
+
+		if (chunk >= shared->nchunks)
+			break;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/*
+		 * The last chunk has no upper bound, so that we don't have to rely on
+		 * the size of the table measured by the tablesync worker.
+		 */
+		start = chunk * shared->chunk_blocks;
+		resetStringInfo(&cmd);
+		appendStringInfo(&cmd, "%sctid >= '(%u,0)'", cmd_head, start);
+		if (chunk < shared->nchunks - 1)
+			appendStringInfo(&cmd, " AND ctid < '(%u,0)'",
+							 start + shared->chunk_blocks);
+		appendStringInfoString(&cmd, cmd_tail);
+
+		res = walrcv_exec(LogRepWorkerWalRcvConn, cmd.data, 0, NULL);
+		if (res->status != WALRCV_OK_COPY_OUT)
+			ereport(ERROR,
+					(errcode(ERRCODE_CONNECTION_FAILURE),
+					 errmsg("could not start initial contents copy for table \"%s.%s\": %s",
+							get_namespace_name(RelationGetNamespace(rel)),
+							RelationGetRelationName(rel), res->err)));
+		walrcv_clear_result(res);
+
+		pstate = make_parsestate(NULL);
+		(void) addRangeTableEntryForRelation(pstate, rel, AccessShareLock,
+											 NULL, false, false);
+
+		cstate = BeginCopyFrom(pstate, rel, NULL, NULL, false, copy_read_data,
+							   attnamelist, options);
+		(void) CopyFrom(cstate);
+		EndCopyFrom(cstate);
+		free_parsestate(pstate);
+	}
+
+	pfree(cmd.data);
+}
+
+/*
+ * Copy the table with the help of other processes, if it's large enough to
+ * be worth it.  Returns false if the caller should copy it by itself.
+ *
+ * Must be called in the transaction on the publisher in which the
+ * replication slot was created.
+ */
+static bool
+copy_table_parallel(Relation rel, LogicalRepRelation *lrel, List *qual,
+					List *attnamelist, bool binary)
+{
+	static const Oid sizeRow[] = {INT8OID, INT4OID};
+	static const Oid snapshotRow[] = {TEXTOID};
+	WalRcvExecResult *res;
+	TupleTableSlot *slot;
+	bool		isnull;
+	int64		relsize;
+	int			blcksz;
+	BlockNumber nblocks;
+	BlockNumber chunk_blocks;
+	uint32		nchunks;
+	int			nworkers;
+	char	   *snapshot;
+	StringInfoData cmd_head;
+	StringInfoData cmd_tail;
+	ListCell   *lc;
+	Size		size;
+	dsm_segment *seg;
+	ParallelSyncShared *shared;
+	char	   *p;
+	int			natts;
+
+	nworkers = Min(max_sync_workers_per_table, max_prepared_xacts);
+
+	/*
+	 * The COPY of each chunk needs a TID range scan to be efficient, and
+	 * partitioned tables have to be copied partition by partition.
+	 */
+	if (nworkers <= 0 || lrel->relkind != RELKIND_RELATION ||
+		walrcv_server_version(LogRepWorkerWalRcvConn) < 140000)
+		return false;
+
+	/* How big is the table? */
+	{
+		StringInfoData cmd;
+
+		initStringInfo(&cmd);
+		appendStringInfo(&cmd,
+						 "SELECT pg_catalog.pg_relation_size(%u),"
+						 " pg_catalog.current_setting('block_size')::int4",
+						 lrel->remoteid);
+		res = walrcv_exec(LogRepWorkerWalRcvConn, cmd.data,
+						  lengthof(sizeRow), sizeRow);
+		pfree(cmd.data);
+	}
+	if (res->status != WALRCV_OK_TUPLES)
+		ereport(ERROR,
+				(errcode(ERRCODE_CONNECTION_FAILURE),
+				 errmsg("could not fetch size of table \"%s.%s\" from publisher: %s",
+						lrel->nspname, lrel->relname, res->err)));
+
+	slot = MakeSingleTupleTableSlot(res->tupledesc, &TTSOpsMinimalTuple);
+	if (!tuplestore_gettupleslot(res->tuplestore, true, false, slot))
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_OBJECT),
+				 errmsg("table \"%s.%s\" not found on publisher",
+						lrel->nspname, lrel->relname)));
+	relsize = DatumGetInt64(slot_getattr(slot, 1, &isnull));
+	Assert(!isnull);
+	blcksz = DatumGetInt32(slot_getattr(slot, 2, &isnull));
+	Assert(!isnull);
+	ExecDropSingleTupleTableSlot(slot);
+	walrcv_clear_result(res);
+
+	/*
+	 * Divide the table into chunks of at least min_parallel_table_scan_size,
+	 * but large enough that each process gets a handful of them, so that the
+	 * overhead of each COPY doesn't matter.
+	 */
+	nblocks = (relsize + blcksz - 1) / blcksz;
+	chunk_blocks = Max((int64) min_parallel_table_scan_size * BLCKSZ / blcksz, 1);
+	chunk_blocks = Max(chunk_blocks,
+					   nblocks / ((nworkers + 1) * PARALLEL_SYNC_CHUNKS_PER_WORKER));
+	nchunks = (nblocks + chunk_blocks - 1) / chunk_blocks;
+	if (nchunks < 2)
+		return false;
+	nworkers = Min(nworkers, nchunks - 1);
+
+	/* Export our snapshot on the publisher, for the helpers to import */
+	res = walrcv_exec(LogRepWorkerWalRcvConn,
+					  "SELECT pg_catalog.pg_export_snapshot()",
+					  lengthof(snapshotRow), snapshotRow);
+	if (res->status != WALRCV_OK_TUPLES)
+		ereport(ERROR,
+				(errcode(ERRCODE_CONNECTION_FAILURE),
+				 errmsg("could not export snapshot on publisher: %s",
+						res->err)));
+	slot = MakeSingleTupleTableSlot(res->tupledesc, &TTSOpsMinimalTuple);
+	if (!tuplestore_gettupleslot(res->tuplestore, true, false, slot))
+		elog(ERROR, "pg_export_snapshot() returned no rows");
+	snapshot = TextDatumGetCString(slot_getattr(slot, 1, &isnull));
+	Assert(!isnull);
+	ExecDropSingleTupleTableSlot(slot);
+	walrcv_clear_result(res);
+
+	/*
+	 * Build the COPY command, with the ctid range condition to be inserted
+	 * between head and tail.
+	 */
+	initStringInfo(&cmd_head);
+	appendStringInfoString(&cmd_head, "COPY (SELECT ");
+	for (int i = 0; i < lrel->natts; i++)
+	{
+		if (i > 0)
+			appendStringInfoString(&cmd_head, ", ");
+		appendStringInfoString(&cmd_head, quote_identifier(lrel->attnames[i]));
+	}
+	appendStringInfo(&cmd_head, " FROM ONLY %s WHERE ",
+					 quote_qualified_identifier(lrel->nspname, lrel->relname));
+
+	initStringInfo(&cmd_tail);
+	if (qual != NIL)
+	{
+		appendStringInfoString(&cmd_tail, " AND (");
+		foreach(lc, qual)
+		{
+			if (foreach_current_index(lc) > 0)
+				appendStringInfoString(&cmd_tail, " OR ");
+			appendStringInfo(&cmd_tail, "%s", strVal(lfirst(lc)));
+		}
+		appendStringInfoChar(&cmd_tail, ')');
+	}
+	appendStringInfoString(&cmd_tail, ") TO STDOUT");
+	if (binary)
+		appendStringInfoString(&cmd_tail, " WITH (FORMAT binary)");
+
+	/* Set up the shared state */
+	size = add_size(offsetof(ParallelSyncShared, prepared),
+					mul_size(nworkers, sizeof(bool)));
+	size = add_size(size, strlen(snapshot) + 1);
+	size = add_size(size, cmd_head.len + 1);
+	size = add_size(size, cmd_tail.len + 1);
+	size = add_size(size, sizeof(int));
+	foreach(lc, attnamelist)
+		size = add_size(size, strlen(strVal(lfirst(lc))) + 1);
+
+	seg = dsm_create(size, 0);
+	shared = dsm_segment_address(seg);
+	shared->subid = MyLogicalRepWorker->subid;
+	shared->relid = MyLogicalRepWorker->relid;
+	shared->dbid = MyDatabaseId;
+	shared->userid = MyLogicalRepWorker->userid;
+	shared->leader_pid = MyProcPid;
+	shared->leader_procno = MyProcNumber;
+	shared->leader_xid = GetTopTransactionId();
+	shared->binary = binary;
+	shared->chunk_blocks = chunk_blocks;
+	shared->nchunks = nchunks;
+	shared->nworkers = nworkers;
+	pg_atomic_init_u32(&shared->next_chunk, 0);
+	SpinLockInit(&shared->mutex);
+	memset(shared->prepared, 0, nworkers * sizeof(bool));
+
+	p = (char *) &shared->prepared[nworkers];
+	strcpy(p, snapshot);
+	p += strlen(snapshot) + 1;
+	strcpy(p, cmd_head.data);
+	p += cmd_head.len + 1;
+	strcpy(p, cmd_tail.data);
+	p += cmd_tail.len + 1;
+	natts = list_length(attnamelist);
+	memcpy(p, &natts, sizeof(int));
+	p += sizeof(int);
+	foreach(lc, attnamelist)
+	{
+		strcpy(p, strVal(lfirst(lc)));
+		p += strlen(p) + 1;
+	}
+
+	/* Launch the helpers */
+	if (parallel_sync_handles == NULL)
+	{
+		parallel_sync_handles =
+			MemoryContextAllocZero(TopMemoryContext,
+								   MAX_BACKENDS * sizeof(BackgroundWorkerHandle *));
+		before_shmem_exit(parallel_sync_shutdown, (Datum) 0);
+	}
+
+	for (int i = 0; i < nworkers; i++)
+	{
+		BackgroundWorker bgw;
+		int			worker_number = i + 1;
+
+		memset(&bgw, 0, sizeof(bgw));
+		bgw.bgw_flags = BGWORKER_SHMEM_ACCESS |
+			BGWORKER_BACKEND_DATABASE_CONNECTION;
+		bgw.bgw_start_time = BgWorkerStart_RecoveryFinished;
+		snprintf(bgw.bgw_library_name, MAXPGPATH, "postgres");
+		snprintf(bgw.bgw_function_name, BGW_MAXLEN, "ParallelTableSyncWorkerMain");
+		snprintf(bgw.bgw_name, BGW_MAXLEN,
+				 "logical replication parallel tablesync worker for subscription %u sync %u",
+				 shared->subid, shared->relid);
+		snprintf(bgw.bgw_type, BGW_MAXLEN,
+				 "logical replication parallel tablesync worker");
+		bgw.bgw_restart_time = BGW_NEVER_RESTART;
+		bgw.bgw_notify_pid = MyProcPid;
+		bgw.bgw_main_arg = UInt32GetDatum(dsm_segment_handle(seg));
+		memcpy(bgw.bgw_extra, &worker_number, sizeof(int));
+
+		if (!RegisterDynamicBackgroundWorker(&bgw,
+											 &parallel_sync_handles[i]))
+		{
+			/* The rest of the chunks will be copied by fewer processes */
+			ereport(WARNING,
+					(errcode(ERRCODE_CONFIGURATION_LIMIT_EXCEEDED),
+					 errmsg("out of background worker slots"),
+					 errhint("You might need to increase \"%s\".", "max_worker_processes")));
+			break;
+		}
+		parallel_sync_nhandles++;
+	}
+
+	ereport(DEBUG1,
+			(errmsg_internal("copying table \"%s.%s\" in %u chunks of %u blocks with %d helper processes",
+							 lrel->nspname, lrel->relname, nchunks,
+							 chunk_blocks, parallel_sync_nhandles)));
+
+	/* Do our share of the work */
+	copy_table_chunks(rel, shared);
+
+	/*
+	 * Wait for the helpers to prepare their transactions.  The snapshot they
+	 * import stays valid until we end our transaction on the publisher.
+	 */
+	for (;;)
+	{
+		bool		done = true;
+
+		CHECK_FOR_INTERRUPTS();
+
+		for (int i = 0; i < parallel_sync_nhandles; i++)
+		{
+			pid_t		pid;
+			BgwHandleStatus status;
+			bool		prepared;
+
+			status = GetBackgroundWorkerPid(parallel_sync_handles[i], &pid);
+
+			/* A helper sets its flag before it exits, so check it after */
+			SpinLockAcquire(&shared->mutex);
+			prepared = shared->prepared[i];
+			SpinLockRelease(&shared->mutex);
+
+			if (prepared)
+				continue;
+			if (status == BGWH_STOPPED || status == BGWH_POSTMASTER_DIED)
+				ereport(ERROR,
+						(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+						 errmsg("logical replication parallel tablesync worker exited before finishing the copy of table \"%s.%s\"",
+								lrel->nspname, lrel->relname)));
+			done = false;
+		}
+
+		if (done)
+			break;
+
+		(void) WaitLatch(MyLatch,
+						 WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						 1000L, WAIT_EVENT_LOGICAL_PARALLEL_SYNC_COPY);
+		ResetLatch(MyLatch);
+	}
+
+	for (int i = 0; i < parallel_sync_nhandles; i++)
+	{
+		pfree(parallel_sync_handles[i]);
+		parallel_sync_handles[i] = NULL;
+	}
+	parallel_sync_nhandles = 0;
+	dsm_detach(seg);
+
+	return true;
+}
+
+/*
+ * Terminate helpers that are still running when the tablesync worker exits,
+ * most likely because of an error.
+ */
+static void
+parallel_sync_shutdown(int code, Datum arg)
+{
+	for (int i = 0; i < parallel_sync_nhandles; i++)
+		TerminateBackgroundWorker(parallel_sync_handles[i]);
+}
+
+/*
+ * Commit or roll back the transactions that helpers prepared for the table
+ * being synchronized, depending on whether the transaction of the tablesync
+ * worker that launched them committed.
+ *
+ * Transactions that belong to a tablesync transaction still in progress,
+ * that is, to a tablesync worker that is still exiting, are left alone; they
+ * are dealt with on a later call.
+ */
+static void
+finish_parallel_sync_xacts(void)
+{
+	char		prefix[GIDSIZE];
+	List	   *gids;
+
+	snprintf(prefix, sizeof(prefix), "pg_sync_%u_%u_",
+			 MyLogicalRepWorker->subid, MyLogicalRepWorker->relid);
+
+	gids = LookupGXactsByGidPrefix(prefix);
+
+	foreach_ptr(char, gid, gids)
+	{
+		TransactionId leader_xid;
+		int			worker_number;
+		bool		commit;
+
+		if (sscanf(gid + strlen(prefix), "%u_%d",
+				   &leader_xid, &worker_number) != 2 ||
+			TransactionIdIsInProgress(leader_xid))
+			continue;
+
+		commit = TransactionIdDidCommit(leader_xid);
+
+		StartTransactionCommand();
+		FinishPreparedTransaction(gid, commit);
+		CommitTransactionCommand();
+
+		elog(DEBUG1, "%s prepared transaction \"%s\" of parallel table synchronization",
+			 commit ? "committed" : "rolled back", gid);
+	}
+
+	list_free_deep(gids);
+}
+
+/*
+ * Logical replication parallel tablesync worker entry point.
+ */
+void
+ParallelTableSyncWorkerMain(Datum main_arg)
+{
+	dsm_segment *seg;
+	ParallelSyncShared *shared;
+	int			worker_number;
+	char		originname[NAMEDATALEN];
+	char		appname[NAMEDATALEN];
+	char		gid[GIDSIZE];
+	RepOriginId originid;
+	Relation	rel;
+	UserContext ucxt;
+	WalRcvExecResult *res;
+	char	   *snapshot;
+	char	   *cmd_head;
+	char	   *cmd_tail;
+	List	   *attnamelist;
+	char	   *err;
+	char	   *cmd;
+	MemoryContext oldctx;
+
+	memcpy(&worker_number, MyBgworkerEntry->bgw_extra, sizeof(int));
+
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	seg = dsm_attach(DatumGetUInt32(main_arg));
+	if (!seg)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	shared = dsm_segment_address(seg);
+
+	/* Set up the session like a tablesync worker, see InitializeLogRepWorker */
+	SetConfigOption("session_replication_role", "replica",
+					PGC_SUSET, PGC_S_OVERRIDE);
+	BackgroundWorkerInitializeConnectionByOid(shared->dbid, shared->userid, 0);
+	SetConfigOption("search_path", "", PGC_SUSET, PGC_S_OVERRIDE);
+
+	StartTransactionCommand();
+	oldctx = MemoryContextSwitchTo(TopMemoryContext);
+	MySubscription = GetSubscription(shared->subid, false);
+	MemoryContextSwitchTo(oldctx);
+	SetConfigOption("synchronous_commit", MySubscription->synccommit,
+					PGC_BACKEND, PGC_S_OVERRIDE);
+	CommitTransactionCommand();
+
+	/* Connect to the publisher and import the tablesync worker's snapshot */
+	load_file("libpqwalreceiver", false);
+
+	snprintf(appname, sizeof(appname), "pg_%u_sync_%u_%d",
+			 shared->subid, shared->relid, worker_number);
+	LogRepWorkerWalRcvConn =
+		walrcv_connect(MySubscription->conninfo, true, true,
+					   MySubscription->passwordrequired &&
+					   !MySubscription->ownersuperuser,
+					   appname, &err);
+	if (LogRepWorkerWalRcvConn == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_CONNECTION_FAILURE),
+				 errmsg("parallel table synchronization worker for subscription \"%s\" could not connect to the publisher: %s",
+						MySubscription->name, err)));
+
+	res = walrcv_exec(LogRepWorkerWalRcvConn,
+					  "BEGIN READ ONLY ISOLATION LEVEL REPEATABLE READ",
+					  0, NULL);
+	if (res->status != WALRCV_OK_COMMAND)
+		ereport(ERROR,
+				(errcode(ERRCODE_CONNECTION_FAILURE),
+				 errmsg("table copy could not start transaction on publisher: %s",
+						res->err)));
+	walrcv_clear_result(res);
+
+	parallel_sync_strings(shared, &snapshot, &cmd_head, &cmd_tail,
+						  &attnamelist);
+	cmd = psprintf("SET TRANSACTION SNAPSHOT %s",
+				   quote_literal_cstr(snapshot));
+	res = walrcv_exec(LogRepWorkerWalRcvConn, cmd, 0, NULL);
+	if (res->status != WALRCV_OK_COMMAND)
+		ereport(ERROR,
+				(errcode(ERRCODE_CONNECTION_FAILURE),
+				 errmsg("table copy could not import snapshot on publisher: %s",
+						res->err)));
+	walrcv_clear_result(res);
+
+	StartTransactionCommand();
+
+	/*
+	 * Share the tablesync worker's origin, so that our data is marked as
+	 * coming from the publisher like the rest.
+	 */
+	ReplicationOriginNameForLogicalRep(shared->subid, shared->relid,
+									   originname, sizeof(originname));
+	originid = replorigin_by_name(originname, false);
+	replorigin_session_setup(originid, shared->leader_pid);
+	replorigin_session_origin = originid;
+
+	rel = table_open(shared->relid, RowExclusiveLock);
+
+	if (!MySubscription->runasowner)
+		SwitchToUntrustedUser(rel->rd_rel->relowner, &ucxt);
+
+	PushActiveSnapshot(GetTransactionSnapshot());
+	copy_table_chunks(rel, shared);
+	PopActiveSnapshot();
+
+	/* The prepared transaction must belong to the subscription owner */
+	if (!MySubscription->runasowner)
+		RestoreUserContext(&ucxt);
+
+	table_close(rel, NoLock);
+
+	res = walrcv_exec(LogRepWorkerWalRcvConn, "COMMIT", 0, NULL);
+	if (res->status != WALRCV_OK_COMMAND)
+		ereport(ERROR,
+				(errcode(ERRCODE_CONNECTION_FAILURE),
+				 errmsg("table copy could not finish transaction on publisher: %s",
+						res->err)));
+	walrcv_clear_result(res);
+
+	/* Prepare our transaction, for the tablesync worker to finish */
+	parallel_sync_gid(shared->subid, shared->relid, shared->leader_xid,
+					  worker_number, gid, sizeof(gid));
+	BeginTransactionBlock();
+	CommitTransactionCommand(); /* Completes the preceding Begin command. */
+	PrepareTransactionBlock(gid);
+	CommitTransactionCommand();
+
+	SpinLockAcquire(&shared->mutex);
+	shared->prepared[worker_number - 1] = true;
+	SpinLockRelease(&shared->mutex);
+	SetLatch(&GetPGProcByNumber(shared->leader_procno)->procLatch);
+
+	walrcv_disconnect(LogRepWorkerWalRcvConn);
+	dsm_detach(seg);
+}
+
 /*
  * Copy existing data of a table from publisher.
  *
@@ -1051,6 +1722,7 @@ copy_table(Relation rel)
 	List	   *attnamelist;
 	ParseState *pstate;
 	List	   *options = NIL;
+	bool		binary;
 	bool		gencol_published = false;
 
 	/* Get the publisher relation info. */
@@ -1065,6 +1737,22 @@ copy_table(Relation rel)
 	relmapentry = logicalrep_rel_open(lrel.remoteid, NoLock);
 	Assert(rel == relmapentry->localrel);
 
+	attnamelist = make_copy_attnamelist(relmapentry);
+
+	/*
+	 * Prior to v16, initial table synchronization will use text format even
+	 * if the binary option is enabled for a subscription.
+	 */
+	binary = walrcv_server_version(LogRepWorkerWalRcvConn) >= 160000 &&
+		MySubscription->binary;
+
+	/* Split the copy of a large table between several processes? */
+	if (copy_table_parallel(rel, &lrel, qual, attnamelist, binary))
+	{
+		logicalrep_rel_close(relmapentry, NoLock);
+		return;
+	}
+
 	/* Start copy on the publisher. */
 	initStringInfo(&cmd);
 
@@ -1146,12 +1834,7 @@ copy_table(Relation rel)
 		appendStringInfoString(&cmd, ") TO STDOUT");
 	}
 
-	/*
-	 * Prior to v16, initial table synchronization will use text format even
-	 * if the binary option is enabled for a subscription.
-	 */
-	if (walrcv_server_version(LogRepWorkerWalRcvConn) >= 160000 &&
-		MySubscription->binary)
+	if (binary)
 	{
 		appendStringInfoString(&cmd, " WITH (FORMAT binary)");
 		options = list_make1(makeDefElem("format",
@@ -1173,7 +1856,6 @@ copy_table(Relation rel)
 	(void) addRangeTableEntryForRelation(pstate, rel, AccessShareLock,
 										 NULL, false, false);
 
-	attnamelist = make_copy_attnamelist(relmapentry);
 	cstate = BeginCopyFrom(pstate, rel, NULL, NULL, false, copy_read_data, attnamelist, options);
 
 	/* Do the copy */
@@ -1305,6 +1987,9 @@ LogicalRepSyncTableStart(XLogRecPtr *origin_startpos)
 		 * seems like a better bet.
 		 */
 		ReplicationSlotDropAtPubNode(LogRepWorkerWalRcvConn, slotname, true);
+
+		/* Roll back what parallel tablesync workers copied last time */
+		finish_parallel_sync_xacts();
 	}
 	else if (MyLogicalRepWorker->relstate == SUBREL_STATE_FINISHEDCOPY)
 	{
@@ -1325,6 +2010,12 @@ LogicalRepSyncTableStart(XLogRecPtr *origin_startpos)
 
 		CommitTransactionCommand();
 
+		/*
+		 * Commit what parallel tablesync workers copied, if we crashed
+		 * before doing so.
+		 */
+		finish_parallel_sync_xacts();
+
 		goto copy_table_done;
 	}
 
@@ -1475,6 +2166,9 @@ LogicalRepSyncTableStart(XLogRecPtr *origin_startpos)
 
 	CommitTransactionCommand();
 
+	/* Commit what parallel tablesync workers copied, if any */
+	finish_parallel_sync_xacts();
+
 copy_table_done:
 
 	elog(DEBUG1,
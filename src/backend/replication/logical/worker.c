@@ -587,6 +587,8 @@ static void adjust_xid_advance_interval(RetainDeadTuplesData *rdt_data,
 static void apply_worker_exit(void);
 
 static void apply_handle_commit_internal(LogicalRepCommitData *commit_data);
+static void apply_insert_tuple(LogicalRepRelMapEntry *rel,
+							   LogicalRepTupleData *newtup);
 static void apply_handle_insert_internal(ApplyExecutionData *edata,
 										 ResultRelInfo *relinfo,
 										 TupleTableSlot *remoteslot);
@@ -787,6 +789,10 @@ handle_streamed_transaction(LogicalRepMsgType action, StringInfo s)
 	if (apply_action == TRANS_LEADER_APPLY)
 		return false;
 
+	/* applying a non-streamed transaction dispatched by the leader */
+	if (apply_action == TRANS_PARALLEL_APPLY && !in_streamed_transaction)
+		return false;
+
 	Assert(TransactionIdIsValid(stream_xid));
 
 	/*
@@ -1220,7 +1226,10 @@ apply_handle_begin(StringInfo s)
 
 	remote_final_lsn = begin_data.final_lsn;
 
-	maybe_start_skipping_changes(begin_data.final_lsn);
+	if (am_parallel_apply_worker())
+		pa_begin_dispatched_xact(begin_data.xid);
+	else if (!pa_dispatch_xact(&begin_data, s))
+		maybe_start_skipping_changes(begin_data.final_lsn);
 
 	in_remote_transaction = true;
 
@@ -1246,7 +1255,17 @@ apply_handle_commit(StringInfo s)
 								 LSN_FORMAT_ARGS(commit_data.commit_lsn),
 								 LSN_FORMAT_ARGS(remote_final_lsn))));
 
-	apply_handle_commit_internal(&commit_data);
+	if (am_parallel_apply_worker())
+	{
+		/* Commit in the same order as the publisher did. */
+		pa_wait_for_preceding_xact();
+		apply_handle_commit_internal(&commit_data);
+		pa_end_dispatched_xact();
+	}
+	else if (pa_dispatch_commit(&commit_data, s))
+		in_remote_transaction = false;
+	else
+		apply_handle_commit_internal(&commit_data);
 
 	/*
 	 * Process any tables that are being synchronized in parallel, as well as
@@ -2636,9 +2655,74 @@ apply_handle_insert(StringInfo s)
 	LogicalRepTupleData newtup;
 	LogicalRepRelId relid;
 	UserContext ucxt;
+	bool		run_as_owner;
+
+	/*
+	 * Quick return if we are skipping data modification changes or handling
+	 * streamed transactions.
+	 */
+	if (is_skipping_changes() ||
+		handle_streamed_transaction(LOGICAL_REP_MSG_INSERT, s))
+		return;
+
+	begin_replication_step();
+
+	relid = logicalrep_read_insert(s, &newtup);
+	rel = logicalrep_rel_open(relid, RowExclusiveLock);
+	if (!should_apply_changes_for_rel(rel))
+	{
+		/*
+		 * The relation can't become interesting in the middle of the
+		 * transaction so it's safe to unlock it.
+		 */
+		logicalrep_rel_close(rel, RowExclusiveLock);
+		end_replication_step();
+		return;
+	}
+
+	/*
+	 * Make sure that any user-supplied code runs as the table owner, unless
+	 * the user has opted out of that behavior.
+	 */
+	run_as_owner = MySubscription->runasowner;
+	if (!run_as_owner)
+		SwitchToUntrustedUser(rel->localrel->rd_rel->relowner, &ucxt);
+
+	/* Set relation for error callback */
+	apply_error_callback_arg.rel = rel;
+
+	apply_insert_tuple(rel, &newtup);
+
+	/* Reset relation for error callback */
+	apply_error_callback_arg.rel = NULL;
+
+	if (!run_as_owner)
+		RestoreUserContext(&ucxt);
+
+	logicalrep_rel_close(rel, NoLock);
+
+	end_replication_step();
+}
+
+/*
+ * Handle MULTI INSERT message.
+ *
+ * If the target is a plain table without BEFORE ROW INSERT triggers, the
+ * tuples are stored all at once.  Otherwise they are inserted one by one, as
+ * if each had come in an INSERT message.
+ */
+static void
+apply_handle_multi_insert(StringInfo s)
+{
+	LogicalRepRelMapEntry *rel;
+	LogicalRepTupleData newtup;
+	LogicalRepRelId relid;
+	int			ntuples;
+	UserContext ucxt;
 	ApplyExecutionData *edata;
 	EState	   *estate;
-	TupleTableSlot *remoteslot;
+	ResultRelInfo *relinfo;
+	TupleTableSlot **slots;
 	MemoryContext oldctx;
 	bool		run_as_owner;
 
@@ -2647,12 +2731,12 @@ apply_handle_insert(StringInfo s)
 	 * streamed transactions.
 	 */
 	if (is_skipping_changes() ||
-		handle_streamed_transaction(LOGICAL_REP_MSG_INSERT, s))
+		handle_streamed_transaction(LOGICAL_REP_MSG_MULTI_INSERT, s))
 		return;
 
 	begin_replication_step();
 
-	relid = logicalrep_read_insert(s, &newtup);
+	relid = logicalrep_read_multi_insert(s, &ntuples);
 	rel = logicalrep_rel_open(relid, RowExclusiveLock);
 	if (!should_apply_changes_for_rel(rel))
 	{
@@ -2676,6 +2760,74 @@ apply_handle_insert(StringInfo s)
 	/* Set relation for error callback */
 	apply_error_callback_arg.rel = rel;
 
+	if (rel->localrel->rd_rel->relkind == RELKIND_PARTITIONED_TABLE ||
+		(rel->localrel->trigdesc &&
+		 rel->localrel->trigdesc->trig_insert_before_row))
+	{
+		for (int i = 0; i < ntuples; i++)
+		{
+			logicalrep_read_multi_insert_tuple(s, &newtup);
+			apply_insert_tuple(rel, &newtup);
+		}
+	}
+	else
+	{
+		/* Initialize the executor state. */
+		edata = create_edata_for_relation(rel);
+		estate = edata->estate;
+		relinfo = edata->targetRelInfo;
+
+		/*
+		 * Process and store the remote tuples in slots, which must survive
+		 * until they have all been inserted.
+		 */
+		slots = palloc_array(TupleTableSlot *, ntuples);
+		oldctx = MemoryContextSwitchTo(estate->es_query_cxt);
+		for (int i = 0; i < ntuples; i++)
+		{
+			logicalrep_read_multi_insert_tuple(s, &newtup);
+			slots[i] = ExecInitExtraTupleSlot(estate,
+											  RelationGetDescr(rel->localrel),
+											  &TTSOpsVirtual);
+			slot_store_data(slots[i], rel, &newtup);
+			slot_fill_defaults(rel, estate, slots[i]);
+		}
+		MemoryContextSwitchTo(oldctx);
+
+		ExecOpenIndices(relinfo, false);
+		InitConflictIndexes(relinfo);
+
+		/* Do the inserts. */
+		TargetPrivilegesCheck(relinfo->ri_RelationDesc, ACL_INSERT);
+		ExecSimpleRelationMultiInsert(relinfo, estate, slots, ntuples);
+
+		ExecCloseIndices(relinfo);
+		finish_edata(edata);
+	}
+
+	/* Reset relation for error callback */
+	apply_error_callback_arg.rel = NULL;
+
+	if (!run_as_owner)
+		RestoreUserContext(&ucxt);
+
+	logicalrep_rel_close(rel, NoLock);
+
+	end_replication_step();
+}
+
+/*
+ * Insert a remote tuple, for apply_handle_insert() and
+ * apply_handle_multi_insert()
+ */
+static void
+apply_insert_tuple(LogicalRepRelMapEntry *rel, LogicalRepTupleData *newtup)
+{
+	ApplyExecutionData *edata;
+	EState	   *estate;
+	TupleTableSlot *remoteslot;
+	MemoryContext oldctx;
+
 	/* Initialize the executor state. */
 	edata = create_edata_for_relation(rel);
 	estate = edata->estate;
@@ -2685,7 +2837,7 @@ apply_handle_insert(StringInfo s)
 
 	/* Process and store remote tuple in the slot */
 	oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
-	slot_store_data(remoteslot, rel, &newtup);
+	slot_store_data(remoteslot, rel, newtup);
 	slot_fill_defaults(rel, estate, remoteslot);
 	MemoryContextSwitchTo(oldctx);
 
@@ -2703,16 +2855,6 @@ apply_handle_insert(StringInfo s)
 	}
 
 	finish_edata(edata);
-
-	/* Reset relation for error callback */
-	apply_error_callback_arg.rel = NULL;
-
-	if (!run_as_owner)
-		RestoreUserContext(&ucxt);
-
-	logicalrep_rel_close(rel, NoLock);
-
-	end_replication_step();
 }
 
 /*
@@ -3785,6 +3927,13 @@ apply_dispatch(StringInfo s)
 	saved_command = apply_error_callback_arg.command;
 	apply_error_callback_arg.command = action;
 
+	/* Pass on the message if its transaction is applied in parallel. */
+	if (pa_dispatch_message(action, s))
+	{
+		apply_error_callback_arg.command = saved_command;
+		return;
+	}
+
 	switch (action)
 	{
 		case LOGICAL_REP_MSG_BEGIN:
@@ -3799,6 +3948,10 @@ apply_dispatch(StringInfo s)
 			apply_handle_insert(s);
 			break;
 
+		case LOGICAL_REP_MSG_MULTI_INSERT:
+			apply_handle_multi_insert(s);
+			break;
+
 		case LOGICAL_REP_MSG_UPDATE:
 			apply_handle_update(s);
 			break;
@@ -4142,6 +4295,9 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 			}
 		}
 
+		/* release parallel apply workers that have committed */
+		pa_check_dispatched_xacts();
+
 		/* confirm all writes so far */
 		send_feedback(last_received, false, false);
 
@@ -4324,7 +4480,7 @@ send_feedback(XLogRecPtr recvpos, bool force, bool requestReply)
 	 * No outstanding transactions to flush, we can report the latest received
 	 * position. This is important for synchronous replication.
 	 */
-	if (!have_pending_txes)
+	if (!have_pending_txes && !pa_has_dispatched_xacts())
 		flushpos = writepos = recvpos;
 
 	if (writepos < last_writepos)
@@ -5523,6 +5679,7 @@ set_stream_options(WalRcvStreamOptions *options,
 
 	server_version = walrcv_server_version(LogRepWorkerWalRcvConn);
 	options->proto.logical.proto_version =
+		server_version >= 190000 ? LOGICALREP_PROTO_MULTI_INSERT_VERSION_NUM :
 		server_version >= 160000 ? LOGICALREP_PROTO_STREAM_PARALLEL_VERSION_NUM :
 		server_version >= 150000 ? LOGICALREP_PROTO_TWOPHASE_VERSION_NUM :
 		server_version >= 140000 ? LOGICALREP_PROTO_STREAM_VERSION_NUM :
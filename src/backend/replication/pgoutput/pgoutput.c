@@ -41,6 +41,13 @@ PG_MODULE_MAGIC_EXT(
 					.version = PG_VERSION
 );
 
+/*
+ * Maximum number of inserts, and their size, sent in a single MULTI INSERT
+ * message.
+ */
+#define MULTI_INSERT_MAX_TUPLES		1000
+#define MULTI_INSERT_MAX_BYTES		(64 * 1024)
+
 static void pgoutput_startup(LogicalDecodingContext *ctx,
 							 OutputPluginOptions *opt, bool is_init);
 static void pgoutput_shutdown(LogicalDecodingContext *ctx);
@@ -60,6 +67,8 @@ static void pgoutput_message(LogicalDecodingContext *ctx,
 							 Size sz, const char *message);
 static bool pgoutput_origin_filter(LogicalDecodingContext *ctx,
 								   RepOriginId origin_id);
+static bool pgoutput_change_filter(LogicalDecodingContext *ctx,
+								   Relation relation);
 static void pgoutput_begin_prepare_txn(LogicalDecodingContext *ctx,
 									   ReorderBufferTXN *txn);
 static void pgoutput_prepare_txn(LogicalDecodingContext *ctx,
@@ -223,6 +232,11 @@ static void init_rel_sync_cache(MemoryContext cachectx);
 static void cleanup_rel_sync_cache(TransactionId xid, bool is_commit);
 static RelationSyncEntry *get_rel_sync_entry(PGOutputData *data,
 											 Relation relation);
+static void pgoutput_queue_insert(LogicalDecodingContext *ctx,
+								  TransactionId xid, Relation relation,
+								  TupleTableSlot *slot,
+								  RelationSyncEntry *relentry);
+static void pgoutput_flush_inserts(LogicalDecodingContext *ctx);
 static void send_relation_and_attrs(Relation relation, TransactionId xid,
 									LogicalDecodingContext *ctx,
 									RelationSyncEntry *relentry);
@@ -272,6 +286,7 @@ _PG_output_plugin_init(OutputPluginCallbacks *cb)
 	cb->commit_prepared_cb = pgoutput_commit_prepared_txn;
 	cb->rollback_prepared_cb = pgoutput_rollback_prepared_txn;
 	cb->filter_by_origin_cb = pgoutput_origin_filter;
+	cb->filter_change_cb = pgoutput_change_filter;
 	cb->shutdown_cb = pgoutput_shutdown;
 
 	/* transaction streaming */
@@ -546,6 +561,15 @@ pgoutput_startup(LogicalDecodingContext *ctx, OutputPluginOptions *opt,
 		else
 			ctx->twophase_opt_given = true;
 
+		/* Send consecutive inserts together, if the protocol allows. */
+		if (data->protocol_version >= LOGICALREP_PROTO_MULTI_INSERT_VERSION_NUM)
+		{
+			MemoryContext oldctx = MemoryContextSwitchTo(ctx->context);
+
+			data->insert_tuples = makeStringInfo();
+			MemoryContextSwitchTo(oldctx);
+		}
+
 		/* Init publication state. */
 		data->publications = NIL;
 		publications_valid = false;
@@ -633,6 +657,8 @@ pgoutput_commit_txn(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 
 	Assert(txndata);
 
+	pgoutput_flush_inserts(ctx);
+
 	/*
 	 * We don't need to send the commit message unless some relevant change
 	 * from this transaction has been sent to the downstream.
@@ -677,6 +703,8 @@ static void
 pgoutput_prepare_txn(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 					 XLogRecPtr prepare_lsn)
 {
+	pgoutput_flush_inserts(ctx);
+
 	OutputPluginUpdateProgress(ctx, false);
 
 	OutputPluginPrepareWrite(ctx, true);
@@ -766,6 +794,9 @@ maybe_send_schema(LogicalDecodingContext *ctx,
 	if (schema_sent)
 		return;
 
+	/* The pending inserts were written using the schema sent before. */
+	pgoutput_flush_inserts(ctx);
+
 	/*
 	 * Send the schema.  If the changes will be published using an ancestor's
 	 * schema, not the relation's own, send that ancestor's schema before
@@ -1601,6 +1632,16 @@ pgoutput_change(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 	 */
 	maybe_send_schema(ctx, change, relation, relentry);
 
+	/* Collect inserts into a MULTI INSERT, if the protocol allows. */
+	if (action == REORDER_BUFFER_CHANGE_INSERT && data->insert_tuples)
+	{
+		pgoutput_queue_insert(ctx, xid, targetrel, new_slot, relentry);
+		goto cleanup;
+	}
+
+	/* Anything else has to come after the inserts before it */
+	pgoutput_flush_inserts(ctx);
+
 	OutputPluginPrepareWrite(ctx, true);
 
 	/* Send the data */
@@ -1648,6 +1689,58 @@ cleanup:
 	MemoryContextReset(data->context);
 }
 
+/*
+ * Add an insert to the ones that will be sent as one MULTI INSERT message,
+ * sending those first if they are for another relation or (sub)transaction.
+ */
+static void
+pgoutput_queue_insert(LogicalDecodingContext *ctx, TransactionId xid,
+					  Relation relation, TupleTableSlot *slot,
+					  RelationSyncEntry *relentry)
+{
+	PGOutputData *data = (PGOutputData *) ctx->output_plugin_private;
+
+	if (data->insert_ntuples > 0 &&
+		(data->insert_relid != RelationGetRelid(relation) ||
+		 data->insert_xid != xid))
+		pgoutput_flush_inserts(ctx);
+
+	logicalrep_write_multi_insert_tuple(data->insert_tuples, relation, slot,
+										data->binary, relentry->columns,
+										relentry->include_gencols_type);
+	data->insert_ntuples++;
+	data->insert_relid = RelationGetRelid(relation);
+	data->insert_xid = xid;
+
+	if (data->insert_ntuples >= MULTI_INSERT_MAX_TUPLES ||
+		data->insert_tuples->len >= MULTI_INSERT_MAX_BYTES)
+		pgoutput_flush_inserts(ctx);
+}
+
+/*
+ * Send the inserts collected by pgoutput_queue_insert(), if any.
+ *
+ * This must be done before anything else is sent, so that the subscriber
+ * sees the changes in the order they were made.
+ */
+static void
+pgoutput_flush_inserts(LogicalDecodingContext *ctx)
+{
+	PGOutputData *data = (PGOutputData *) ctx->output_plugin_private;
+
+	if (data->insert_ntuples == 0)
+		return;
+
+	OutputPluginPrepareWrite(ctx, true);
+	logicalrep_write_multi_insert(ctx->out, data->insert_xid,
+								  data->insert_relid, data->insert_ntuples,
+								  data->insert_tuples);
+	OutputPluginWrite(ctx, true);
+
+	resetStringInfo(data->insert_tuples);
+	data->insert_ntuples = 0;
+}
+
 static void
 pgoutput_truncate(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 				  int nrelations, Relation relations[], ReorderBufferChange *change)
@@ -1702,6 +1795,8 @@ pgoutput_truncate(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 
 	if (nrelids > 0)
 	{
+		pgoutput_flush_inserts(ctx);
+
 		OutputPluginPrepareWrite(ctx, true);
 		logicalrep_write_truncate(ctx->out,
 								  xid,
@@ -1727,6 +1822,8 @@ pgoutput_message(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 	if (!data->messages)
 		return;
 
+	pgoutput_flush_inserts(ctx);
+
 	/*
 	 * Remember the xid for the message in streaming mode. See
 	 * pgoutput_change.
@@ -1773,6 +1870,77 @@ pgoutput_origin_filter(LogicalDecodingContext *ctx,
 	return false;
 }
 
+/*
+ * Return true if the relation is not part of any of the publications, so
+ * that its changes can be discarded right away, false otherwise.
+ *
+ * This is called while the transactions are being decoded, not when they are
+ * replayed, so it must not rely on the RelationSyncCache, which reflects the
+ * catalog as of the transaction being replayed.  It is conservative: whether
+ * a change is actually published, considering the actions and row filters of
+ * the publications, is left to pgoutput_change().
+ */
+static bool
+pgoutput_change_filter(LogicalDecodingContext *ctx, Relation relation)
+{
+	PGOutputData *data = (PGOutputData *) ctx->output_plugin_private;
+	List	   *pubids = NIL;
+	List	   *relids;
+	ListCell   *lc;
+	bool		published = false;
+
+	if (!is_publishable_relation(relation))
+		return true;
+
+	foreach(lc, data->publication_names)
+	{
+		char	   *pubname = (char *) lfirst(lc);
+		Publication *pub = GetPublicationByName(pubname, true);
+
+		if (pub == NULL)
+			continue;
+
+		/* Don't bother with what FOR ALL TABLES publications leave out */
+		if (pub->alltables)
+			return false;
+
+		pubids = lappend_oid(pubids, pub->oid);
+	}
+
+	/* Partitions may be published through their ancestors. */
+	relids = list_make1_oid(RelationGetRelid(relation));
+	if (relation->rd_rel->relispartition)
+		relids = list_concat(relids,
+							 get_partition_ancestors(RelationGetRelid(relation)));
+
+	foreach(lc, relids)
+	{
+		Oid			relid = lfirst_oid(lc);
+		List	   *relpubids;
+
+		relpubids = list_concat(GetRelationPublications(relid),
+								GetSchemaPublications(get_rel_namespace(relid)));
+
+		foreach_oid(pubid, relpubids)
+		{
+			if (list_member_oid(pubids, pubid))
+			{
+				published = true;
+				break;
+			}
+		}
+
+		list_free(relpubids);
+		if (published)
+			break;
+	}
+
+	list_free(relids);
+	list_free(pubids);
+
+	return !published;
+}
+
 /*
  * Shutdown the output plugin.
  *
@@ -1873,6 +2041,8 @@ pgoutput_stream_stop(struct LogicalDecodingContext *ctx,
 	/* we should be streaming a transaction */
 	Assert(data->in_streaming);
 
+	pgoutput_flush_inserts(ctx);
+
 	OutputPluginPrepareWrite(ctx, true);
 	logicalrep_write_stream_stop(ctx->out);
 	OutputPluginWrite(ctx, true);
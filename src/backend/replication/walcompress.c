@@ -0,0 +1,362 @@
+/*-------------------------------------------------------------------------
+ *
+ * walcompress.c
+ *	  Streaming compression of WAL sent over physical replication.
+ *
+ * When the client asks for it in START_REPLICATION, walsender compresses
+ * the WAL carried by each WALData message, and libpqwalreceiver decompresses
+ * it before handing the message on.  The messages of one replication stream
+ * form a single compressed stream, so that later messages can refer back to
+ * data in earlier ones, but each message is flushed completely: the receiver
+ * always gets all of the WAL in a message out of it, without waiting for the
+ * next one.
+ *
+ * Portions Copyright (c) 2010-2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/replication/walcompress.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "replication/walcompress.h"
+
+struct WalCompressor
+{
+	pg_compress_algorithm algorithm;
+#ifdef USE_LZ4
+	LZ4F_compressionContext_t lz4_ctx;
+	LZ4F_preferences_t lz4_prefs;
+	bool		lz4_begun;		/* frame header written yet? */
+#endif
+#ifdef USE_ZSTD
+	ZSTD_CCtx  *zstd_cctx;
+#endif
+};
+
+struct WalDecompressor
+{
+	pg_compress_algorithm algorithm;
+#ifdef USE_LZ4
+	LZ4F_decompressionContext_t lz4_ctx;
+#endif
+#ifdef USE_ZSTD
+	ZSTD_DCtx  *zstd_dctx;
+#endif
+};
+
+/* Output space to make available before each call to LZ4F_decompress() */
+#define LZ4_DECOMPRESS_CHUNK	(64 * 1024)
+
+/*
+ * Can the replication stream be compressed with the given algorithm?
+ *
+ * Only the algorithms with a streaming mode that can flush at message
+ * boundaries qualify.  Whether this build supports them is checked by
+ * validate_compress_specification().
+ */
+bool
+WalCompressionSupported(pg_compress_algorithm algorithm)
+{
+	return algorithm == PG_COMPRESSION_LZ4 ||
+		algorithm == PG_COMPRESSION_ZSTD;
+}
+
+/*
+ * Set up compression of a replication stream.
+ */
+WalCompressor *
+WalCompressorCreate(const pg_compress_specification *spec)
+{
+	WalCompressor *compressor;
+
+	Assert(WalCompressionSupported(spec->algorithm));
+
+	compressor = palloc0_object(WalCompressor);
+	compressor->algorithm = spec->algorithm;
+
+	if (spec->algorithm == PG_COMPRESSION_LZ4)
+	{
+#ifdef USE_LZ4
+		LZ4F_errorCode_t ret;
+
+		ret = LZ4F_createCompressionContext(&compressor->lz4_ctx, LZ4F_VERSION);
+		if (LZ4F_isError(ret))
+			elog(ERROR, "could not create lz4 compression context: %s",
+				 LZ4F_getErrorName(ret));
+
+		compressor->lz4_prefs.frameInfo.blockSizeID = LZ4F_max256KB;
+		compressor->lz4_prefs.frameInfo.blockMode = LZ4F_blockLinked;
+		compressor->lz4_prefs.compressionLevel = spec->level;
+		compressor->lz4_prefs.autoFlush = 1;
+#else
+		elog(ERROR, "lz4 compression is not supported by this build");
+#endif
+	}
+	else if (spec->algorithm == PG_COMPRESSION_ZSTD)
+	{
+#ifdef USE_ZSTD
+		size_t		ret;
+
+		compressor->zstd_cctx = ZSTD_createCCtx();
+		if (!compressor->zstd_cctx)
+			elog(ERROR, "could not create zstd compression context");
+
+		ret = ZSTD_CCtx_setParameter(compressor->zstd_cctx,
+									 ZSTD_c_compressionLevel, spec->level);
+		if (ZSTD_isError(ret))
+			elog(ERROR, "could not set zstd compression level to %d: %s",
+				 spec->level, ZSTD_getErrorName(ret));
+
+		if ((spec->options & PG_COMPRESSION_OPTION_WORKERS) != 0)
+		{
+			ret = ZSTD_CCtx_setParameter(compressor->zstd_cctx,
+										 ZSTD_c_nbWorkers, spec->workers);
+			if (ZSTD_isError(ret))
+				ereport(ERROR,
+						errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						errmsg("could not set compression worker count to %d: %s",
+							   spec->workers, ZSTD_getErrorName(ret)));
+		}
+
+		if ((spec->options & PG_COMPRESSION_OPTION_LONG_DISTANCE) != 0)
+		{
+			ret = ZSTD_CCtx_setParameter(compressor->zstd_cctx,
+										 ZSTD_c_enableLongDistanceMatching,
+										 spec->long_distance);
+			if (ZSTD_isError(ret))
+				ereport(ERROR,
+						errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						errmsg("could not enable long-distance mode: %s",
+							   ZSTD_getErrorName(ret)));
+		}
+#else
+		elog(ERROR, "zstd compression is not supported by this build");
+#endif
+	}
+
+	return compressor;
+}
+
+/*
+ * Compress len bytes at data and append the result to out.
+ *
+ * Everything is flushed, so that the receiver can decompress all of it
+ * without seeing any further data.
+ */
+void
+WalCompress(WalCompressor *compressor, const char *data, size_t len,
+			StringInfo out)
+{
+	if (compressor->algorithm == PG_COMPRESSION_LZ4)
+	{
+#ifdef USE_LZ4
+		size_t		bound;
+		size_t		ret;
+
+		if (!compressor->lz4_begun)
+		{
+			enlargeStringInfo(out, LZ4F_HEADER_SIZE_MAX);
+			ret = LZ4F_compressBegin(compressor->lz4_ctx,
+									 out->data + out->len,
+									 LZ4F_HEADER_SIZE_MAX,
+									 &compressor->lz4_prefs);
+			if (LZ4F_isError(ret))
+				elog(ERROR, "could not write lz4 header: %s",
+					 LZ4F_getErrorName(ret));
+			out->len += ret;
+			compressor->lz4_begun = true;
+		}
+
+		bound = LZ4F_compressBound(len, &compressor->lz4_prefs);
+		enlargeStringInfo(out, bound);
+		ret = LZ4F_compressUpdate(compressor->lz4_ctx,
+								  out->data + out->len, bound,
+								  data, len, NULL);
+		if (LZ4F_isError(ret))
+			elog(ERROR, "could not compress data: %s",
+				 LZ4F_getErrorName(ret));
+		out->len += ret;
+
+		/* autoFlush should leave nothing behind, but make sure */
+		bound = LZ4F_compressBound(0, &compressor->lz4_prefs);
+		enlargeStringInfo(out, bound);
+		ret = LZ4F_flush(compressor->lz4_ctx, out->data + out->len, bound,
+						 NULL);
+		if (LZ4F_isError(ret))
+			elog(ERROR, "could not compress data: %s",
+				 LZ4F_getErrorName(ret));
+		out->len += ret;
+#endif
+	}
+	else if (compressor->algorithm == PG_COMPRESSION_ZSTD)
+	{
+#ifdef USE_ZSTD
+		ZSTD_inBuffer inBuf = {data, len, 0};
+		size_t		remaining;
+
+		do
+		{
+			ZSTD_outBuffer outBuf;
+
+			enlargeStringInfo(out, ZSTD_CStreamOutSize());
+			outBuf.dst = out->data + out->len;
+			outBuf.size = ZSTD_CStreamOutSize();
+			outBuf.pos = 0;
+
+			remaining = ZSTD_compressStream2(compressor->zstd_cctx,
+											 &outBuf, &inBuf, ZSTD_e_flush);
+			if (ZSTD_isError(remaining))
+				elog(ERROR, "could not compress data: %s",
+					 ZSTD_getErrorName(remaining));
+			out->len += outBuf.pos;
+		} while (remaining != 0);
+#endif
+	}
+}
+
+void
+WalCompressorFree(WalCompressor *compressor)
+{
+#ifdef USE_LZ4
+	if (compressor->lz4_ctx)
+		LZ4F_freeCompressionContext(compressor->lz4_ctx);
+#endif
+#ifdef USE_ZSTD
+	if (compressor->zstd_cctx)
+		ZSTD_freeCCtx(compressor->zstd_cctx);
+#endif
+	pfree(compressor);
+}
+
+/*
+ * Set up decompression of a replication stream.
+ */
+WalDecompressor *
+WalDecompressorCreate(pg_compress_algorithm algorithm)
+{
+	WalDecompressor *decompressor;
+
+	Assert(WalCompressionSupported(algorithm));
+
+	decompressor = palloc0_object(WalDecompressor);
+	decompressor->algorithm = algorithm;
+
+	if (algorithm == PG_COMPRESSION_LZ4)
+	{
+#ifdef USE_LZ4
+		LZ4F_errorCode_t ret;
+
+		ret = LZ4F_createDecompressionContext(&decompressor->lz4_ctx,
+											  LZ4F_VERSION);
+		if (LZ4F_isError(ret))
+			elog(ERROR, "could not create lz4 decompression context: %s",
+				 LZ4F_getErrorName(ret));
+#else
+		elog(ERROR, "lz4 compression is not supported by this build");
+#endif
+	}
+	else if (algorithm == PG_COMPRESSION_ZSTD)
+	{
+#ifdef USE_ZSTD
+		decompressor->zstd_dctx = ZSTD_createDCtx();
+		if (!decompressor->zstd_dctx)
+			elog(ERROR, "could not create zstd decompression context");
+#else
+		elog(ERROR, "zstd compression is not supported by this build");
+#endif
+	}
+
+	return decompressor;
+}
+
+/*
+ * Decompress len bytes at data and append the result to out.
+ *
+ * The input must be everything the compressor produced for one message;
+ * all of the data compressed for it comes out.
+ */
+void
+WalDecompress(WalDecompressor *decompressor, const char *data, size_t len,
+			  StringInfo out)
+{
+	if (decompressor->algorithm == PG_COMPRESSION_LZ4)
+	{
+#ifdef USE_LZ4
+		size_t		consumed = 0;
+		size_t		avail_out;
+		size_t		produced;
+
+		/*
+		 * Keep going until all input is consumed and the output space was not
+		 * filled up, meaning that nothing is left buffered in the context.
+		 */
+		do
+		{
+			size_t		srcsize = len - consumed;
+			size_t		ret;
+
+			enlargeStringInfo(out, LZ4_DECOMPRESS_CHUNK);
+			avail_out = produced = LZ4_DECOMPRESS_CHUNK;
+			ret = LZ4F_decompress(decompressor->lz4_ctx,
+								  out->data + out->len, &produced,
+								  data + consumed, &srcsize, NULL);
+			if (LZ4F_isError(ret))
+				ereport(ERROR,
+						(errcode(ERRCODE_PROTOCOL_VIOLATION),
+						 errmsg("could not decompress WAL data: %s",
+								LZ4F_getErrorName(ret))));
+			out->len += produced;
+			consumed += srcsize;
+		} while (consumed < len || produced == avail_out);
+#endif
+	}
+	else if (decompressor->algorithm == PG_COMPRESSION_ZSTD)
+	{
+#ifdef USE_ZSTD
+		ZSTD_inBuffer inBuf = {data, len, 0};
+		ZSTD_outBuffer outBuf;
+
+		do
+		{
+			size_t		ret;
+
+			enlargeStringInfo(out, ZSTD_DStreamOutSize());
+			outBuf.dst = out->data + out->len;
+			outBuf.size = ZSTD_DStreamOutSize();
+			outBuf.pos = 0;
+
+			ret = ZSTD_decompressStream(decompressor->zstd_dctx,
+										&outBuf, &inBuf);
+			if (ZSTD_isError(ret))
+				ereport(ERROR,
+						(errcode(ERRCODE_PROTOCOL_VIOLATION),
+						 errmsg("could not decompress WAL data: %s",
+								ZSTD_getErrorName(ret))));
+			out->len += outBuf.pos;
+		} while (inBuf.pos < inBuf.size || outBuf.pos == outBuf.size);
+#endif
+	}
+}
+
+void
+WalDecompressorFree(WalDecompressor *decompressor)
+{
+#ifdef USE_LZ4
+	if (decompressor->lz4_ctx)
+		LZ4F_freeDecompressionContext(decompressor->lz4_ctx);
+#endif
+#ifdef USE_ZSTD
+	if (decompressor->zstd_dctx)
+		ZSTD_freeDCtx(decompressor->zstd_dctx);
+#endif
+	pfree(decompressor);
+}
@@ -65,8 +65,10 @@
 #include "pgstat.h"
 #include "postmaster/auxprocess.h"
 #include "postmaster/interrupt.h"
+#include "replication/walcompress.h"
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
+#include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
@@ -75,6 +77,7 @@
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/guc.h"
+#include "utils/guc_hooks.h"
 #include "utils/pg_lsn.h"
 #include "utils/ps_status.h"
 #include "utils/timestamp.h"
@@ -88,6 +91,8 @@
 int			wal_receiver_status_interval;
 int			wal_receiver_timeout;
 bool		hot_standby_feedback;
+char	   *wal_receiver_compression;
+int			wal_receiver_flush_after;
 
 /* libpqwalreceiver connection */
 static WalReceiverConn *wrconn = NULL;
@@ -145,6 +150,8 @@ static void XLogWalRcvSendReply(bool force, bool requestReply);
 static void XLogWalRcvSendHSFeedback(bool immed);
 static void ProcessWalSndrMessage(XLogRecPtr walEnd, TimestampTz sendTime);
 static void WalRcvComputeNextWakeup(WalRcvWakeupReason reason, TimestampTz now);
+static void split_wal_receiver_compression(const char *value,
+										   char **algorithm, char **detail);
 
 
 /* Main entry point for walreceiver process */
@@ -382,6 +389,9 @@ WalReceiverMain(const void *startup_data, size_t startup_data_len)
 		options.startpoint = startpoint;
 		options.slotname = slotname[0] != '\0' ? slotname : NULL;
 		options.proto.physical.startpointTLI = startpointTLI;
+		split_wal_receiver_compression(wal_receiver_compression,
+									   &options.proto.physical.compression,
+									   &options.proto.physical.compression_detail);
 		if (walrcv_startstreaming(wrconn, &options))
 		{
 			if (first_stream)
@@ -463,6 +473,19 @@ WalReceiverMain(const void *startup_data, size_t startup_data_len)
 							WalRcvComputeNextWakeup(WALRCV_WAKEUP_PING, now);
 							XLogWalRcvProcessMsg(buf[0], &buf[1], len - 1,
 												 startpointTLI);
+
+							/*
+							 * Don't wait until we have read everything the
+							 * primary sent to flush, if we already have
+							 * enough WAL to make it worthwhile.  Otherwise a
+							 * busy stream would hold back the flush and the
+							 * reply that the primary's synchronous commits
+							 * are waiting for.
+							 */
+							if (wal_receiver_flush_after > 0 &&
+								LogstreamResult.Write - LogstreamResult.Flush >=
+								(uint64) wal_receiver_flush_after * XLOG_BLCKSZ)
+								XLogWalRcvFlush(false, startpointTLI);
 						}
 						else if (len == 0)
 							break;
@@ -934,6 +957,14 @@ XLogWalRcvWrite(char *buf, Size nbytes, XLogRecPtr recptr, TimeLineID tli)
 		pgstat_count_io_op_time(IOOBJECT_WAL, IOCONTEXT_NORMAL,
 								IOOP_WRITE, start, 1, byteswritten);
 
+		/*
+		 * If flushing as we go, ask the kernel to start writing the data
+		 * back now, so that it proceeds while we receive more, and the fsync
+		 * in XLogWalRcvFlush() has less left to do.
+		 */
+		if (wal_receiver_flush_after > 0 && byteswritten > 0)
+			pg_flush_data(recvFile, startoff, byteswritten);
+
 		if (byteswritten <= 0)
 		{
 			char		xlogfname[MAXFNAMELEN];
@@ -1338,6 +1369,83 @@ WalRcvComputeNextWakeup(WalRcvWakeupReason reason, TimestampTz now)
 	}
 }
 
+/*
+ * Split a wal_receiver_compression value into the algorithm and the detail
+ * string, if any.  *algorithm is set to NULL if no compression is wanted.
+ */
+static void
+split_wal_receiver_compression(const char *value, char **algorithm,
+							   char **detail)
+{
+	char	   *sep;
+
+	*algorithm = pstrdup(value);
+	*detail = NULL;
+
+	sep = strchr(*algorithm, ':');
+	if (sep != NULL)
+	{
+		*sep = '\0';
+		*detail = sep + 1;
+	}
+
+	if (strcmp(*algorithm, "none") == 0)
+	{
+		pfree(*algorithm);
+		*algorithm = NULL;
+		*detail = NULL;
+	}
+}
+
+/*
+ * GUC check_hook for wal_receiver_compression
+ */
+bool
+check_wal_receiver_compression(char **newval, void **extra, GucSource source)
+{
+	char	   *algname;
+	char	   *detail = NULL;
+	char	   *sep;
+	pg_compress_algorithm algorithm;
+	pg_compress_specification spec;
+	char	   *error_detail;
+
+	algname = pstrdup(*newval);
+	sep = strchr(algname, ':');
+	if (sep != NULL)
+	{
+		*sep = '\0';
+		detail = sep + 1;
+	}
+
+	if (!parse_compress_algorithm(algname, &algorithm))
+	{
+		GUC_check_errdetail("Unrecognized compression algorithm: \"%s\".",
+							algname);
+		pfree(algname);
+		return false;
+	}
+	if (algorithm != PG_COMPRESSION_NONE &&
+		!WalCompressionSupported(algorithm))
+	{
+		GUC_check_errdetail("Only \"%s\" and \"%s\" can be used to compress the WAL stream.",
+							"lz4", "zstd");
+		pfree(algname);
+		return false;
+	}
+
+	parse_compress_specification(algorithm, detail, &spec);
+	error_detail = validate_compress_specification(&spec);
+	pfree(algname);
+	if (error_detail != NULL)
+	{
+		GUC_check_errdetail("%s", error_detail);
+		return false;
+	}
+
+	return true;
+}
+
 /*
  * Wake up the walreceiver main loop.
  *
@@ -76,6 +76,7 @@
 #include "replication/slot.h"
 #include "replication/snapbuild.h"
 #include "replication/syncrep.h"
+#include "replication/walcompress.h"
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
 #include "replication/walsender_private.h"
@@ -172,6 +173,13 @@ static XLogRecPtr sendTimeLineValidUpto = InvalidXLogRecPtr;
  */
 static XLogRecPtr sentPtr = InvalidXLogRecPtr;
 
+/*
+ * Compression of the WAL in physical replication, if the client asked for it,
+ * and space to read the WAL into before compressing it.
+ */
+static WalCompressor *wal_compressor = NULL;
+static char *wal_compress_buf = NULL;
+
 /* Buffers for constructing outgoing messages and processing reply messages. */
 static StringInfoData output_message;
 static StringInfoData reply_message;
@@ -271,6 +279,8 @@ static void ReadReplicationSlot(ReadReplicationSlotCmd *cmd);
 static void CreateReplicationSlot(CreateReplicationSlotCmd *cmd);
 static void DropReplicationSlot(DropReplicationSlotCmd *cmd);
 static void StartReplication(StartReplicationCmd *cmd);
+static void parseStartReplicationOptions(StartReplicationCmd *cmd,
+										 pg_compress_specification *compress);
 static void StartLogicalReplication(StartReplicationCmd *cmd);
 static void ProcessStandbyMessage(void);
 static void ProcessStandbyReplyMessage(void);
@@ -355,6 +365,15 @@ WalSndErrorCleanup(void)
 	if (xlogreader != NULL && xlogreader->seg.ws_file >= 0)
 		wal_segment_close(xlogreader);
 
+	/* The compression library's state is not allocated with palloc */
+	if (wal_compressor != NULL)
+	{
+		WalCompressorFree(wal_compressor);
+		wal_compressor = NULL;
+		pfree(wal_compress_buf);
+		wal_compress_buf = NULL;
+	}
+
 	if (MyReplicationSlot != NULL)
 		ReplicationSlotRelease();
 
@@ -815,6 +834,9 @@ StartReplication(StartReplicationCmd *cmd)
 	StringInfoData buf;
 	XLogRecPtr	FlushPtr;
 	TimeLineID	FlushTLI;
+	pg_compress_specification compress;
+
+	parseStartReplicationOptions(cmd, &compress);
 
 	/* create xlogreader for physical replication */
 	xlogreader =
@@ -972,12 +994,26 @@ StartReplication(StartReplicationCmd *cmd)
 
 		SyncRepInitConfig();
 
+		if (compress.algorithm != PG_COMPRESSION_NONE)
+		{
+			wal_compressor = WalCompressorCreate(&compress);
+			wal_compress_buf = palloc(MAX_SEND_SIZE);
+		}
+
 		/* Main loop of walsender */
 		replication_active = true;
 
 		WalSndLoop(XLogSendPhysical);
 
 		replication_active = false;
+
+		if (wal_compressor)
+		{
+			WalCompressorFree(wal_compressor);
+			wal_compressor = NULL;
+			pfree(wal_compress_buf);
+			wal_compress_buf = NULL;
+		}
 		if (got_STOPPING)
 			proc_exit(0);
 		WalSndSetState(WALSNDSTATE_STARTUP);
@@ -1111,6 +1147,82 @@ logical_read_xlog_page(XLogReaderState *state, XLogRecPtr targetPagePtr, int req
 	return count;
 }
 
+/*
+ * Process options given to START_REPLICATION for physical replication.
+ *
+ * The only ones are compression and compression_detail, which ask for the
+ * WAL to be compressed as in BASE_BACKUP.  Only algorithms that can flush at
+ * the end of each message are accepted.
+ */
+static void
+parseStartReplicationOptions(StartReplicationCmd *cmd,
+							 pg_compress_specification *compress)
+{
+	ListCell   *lc;
+	bool		o_compression = false;
+	bool		o_compression_detail = false;
+	pg_compress_algorithm algorithm = PG_COMPRESSION_NONE;
+	char	   *compression_detail_str = NULL;
+
+	foreach(lc, cmd->options)
+	{
+		DefElem    *defel = (DefElem *) lfirst(lc);
+
+		if (strcmp(defel->defname, "compression") == 0)
+		{
+			char	   *optval = defGetString(defel);
+
+			if (o_compression)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			if (!parse_compress_algorithm(optval, &algorithm))
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("unrecognized compression algorithm: \"%s\"",
+								optval)));
+			if (algorithm != PG_COMPRESSION_NONE &&
+				!WalCompressionSupported(algorithm))
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("compression algorithm \"%s\" is not supported for WAL streaming",
+								optval)));
+			o_compression = true;
+		}
+		else if (strcmp(defel->defname, "compression_detail") == 0)
+		{
+			if (o_compression_detail)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("duplicate option \"%s\"", defel->defname)));
+			compression_detail_str = defGetString(defel);
+			o_compression_detail = true;
+		}
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("unrecognized option: \"%s\"", defel->defname)));
+	}
+
+	if (o_compression_detail && !o_compression)
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("compression detail cannot be specified unless compression is enabled")));
+
+	parse_compress_specification(algorithm, compression_detail_str, compress);
+	if (o_compression)
+	{
+		char	   *error_detail;
+
+		error_detail = validate_compress_specification(compress);
+		if (error_detail != NULL)
+			ereport(ERROR,
+					errcode(ERRCODE_SYNTAX_ERROR),
+					errmsg("invalid compression specification: %s",
+						   error_detail));
+	}
+}
+
 /*
  * Process extra options given to CREATE_REPLICATION_SLOT.
  */
@@ -3198,6 +3310,9 @@ XLogSendPhysical(void)
 	XLogSegNo	segno;
 	WALReadError errinfo;
 	Size		rbytes;
+	Size		msglen;
+	char	   *msgbuf;
+	char	   *walbuf;
 
 	/* If requested switch the WAL sender to the stopping state. */
 	if (got_STOPPING)
@@ -3407,23 +3522,36 @@ XLogSendPhysical(void)
 	pq_sendint64(&output_message, 0);	/* sendtime, filled in last */
 
 	/*
-	 * Read the log directly into the output buffer to avoid extra memcpy
-	 * calls.
+	 * Read the log directly into libpq's output buffer, behind the header
+	 * that we copy there last, to avoid copying the WAL once more.  If it is
+	 * to be compressed, read it into scratch space instead, and compress it
+	 * into output_message behind the header.
 	 */
-	enlargeStringInfo(&output_message, nbytes);
+	if (wal_compressor)
+	{
+		msglen = 0;
+		msgbuf = NULL;
+		walbuf = wal_compress_buf;
+	}
+	else
+	{
+		msglen = output_message.len + nbytes;
+		msgbuf = pq_reservemessage_noblock(msglen);
+		walbuf = msgbuf + output_message.len;
+	}
 
 retry:
 	/* attempt to read WAL from WAL buffers first */
-	rbytes = WALReadFromBuffers(&output_message.data[output_message.len],
-								startptr, nbytes, xlogreader->seg.ws_tli);
-	output_message.len += rbytes;
+	rbytes = WALReadFromBuffers(walbuf, startptr, nbytes,
+								xlogreader->seg.ws_tli);
+	walbuf += rbytes;
 	startptr += rbytes;
 	nbytes -= rbytes;
 
 	/* now read the remaining WAL from WAL file */
 	if (nbytes > 0 &&
 		!WALRead(xlogreader,
-				 &output_message.data[output_message.len],
+				 walbuf,
 				 startptr,
 				 nbytes,
 				 xlogreader->seg.ws_tli,	/* Pass the current TLI because
@@ -3460,9 +3588,6 @@ retry:
 		}
 	}
 
-	output_message.len += nbytes;
-	output_message.data[output_message.len] = '\0';
-
 	/*
 	 * Fill the send timestamp last, so that it is taken as late as possible.
 	 */
@@ -3471,7 +3596,18 @@ retry:
 	memcpy(&output_message.data[1 + sizeof(int64) + sizeof(int64)],
 		   tmpbuf.data, sizeof(int64));
 
-	pq_putmessage_noblock(PqMsg_CopyData, output_message.data, output_message.len);
+	if (wal_compressor)
+	{
+		WalCompress(wal_compressor, wal_compress_buf, endptr - sentPtr,
+					&output_message);
+		pq_putmessage_noblock(PqMsg_CopyData, output_message.data,
+							  output_message.len);
+	}
+	else
+	{
+		memcpy(msgbuf, output_message.data, output_message.len);
+		pq_putreservedmessage(PqMsg_CopyData, msglen);
+	}
 
 	sentPtr = endptr;
 
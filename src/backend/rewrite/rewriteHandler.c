@@ -2523,7 +2523,7 @@ get_view_query(Relation view)
 bool
 view_has_instead_trigger(Relation view, CmdType event, List *mergeActionList)
 {
-	TriggerDesc *trigDesc = view->trigdesc;
+	TriggerDesc *trigDesc = RelationGetTriggerDesc(view);
 
 	switch (event)
 	{
@@ -2930,7 +2930,7 @@ relation_is_updatable(Oid reloid,
 	/* Similarly look for INSTEAD OF triggers, if they are to be included */
 	if (include_triggers)
 	{
-		TriggerDesc *trigDesc = rel->trigdesc;
+		TriggerDesc *trigDesc = RelationGetTriggerDesc(rel);
 
 		if (trigDesc)
 		{
@@ -3124,7 +3124,7 @@ error_view_not_updatable(Relation view,
 						 List *mergeActionList,
 						 const char *detail)
 {
-	TriggerDesc *trigDesc = view->trigdesc;
+	TriggerDesc *trigDesc = RelationGetTriggerDesc(view);
 
 	switch (command)
 	{
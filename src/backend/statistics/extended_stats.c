@@ -29,6 +29,7 @@
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/optimizer.h"
+#include "optimizer/pathnode.h"
 #include "parser/parsetree.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
@@ -2016,6 +2017,642 @@ statext_clauselist_selectivity(PlannerInfo *root, List *clauses, int varRelid,
 	return sel;
 }
 
+/*
+ * statext_join_clause_is_compatible
+ *		Determine whether a join clause can be estimated together with others
+ *		using statistics of the two joined relations.
+ *
+ * We only handle equality clauses of the form (Var = Var), with the Vars
+ * referencing user columns of two different base relations.  On success,
+ * *var1 and *var2 are set to the Vars, ordered so that var1 belongs to the
+ * relation with the lower relid, and *var1isleft tells which argument of the
+ * operator var1 is.
+ */
+static bool
+statext_join_clause_is_compatible(PlannerInfo *root, Node *clause,
+								  OpExpr **opexpr, Var **var1, Var **var2,
+								  bool *var1isleft)
+{
+	RestrictInfo *rinfo;
+	OpExpr	   *expr;
+	Node	   *left;
+	Node	   *right;
+
+	if (!IsA(clause, RestrictInfo))
+		return false;
+	rinfo = (RestrictInfo *) clause;
+
+	/* Pseudoconstants are not really interesting here. */
+	if (rinfo->pseudoconstant)
+		return false;
+
+	/* We need an equality operator, which mergejoinable ones are. */
+	if (!is_opclause(rinfo->clause) || rinfo->mergeopfamilies == NIL)
+		return false;
+	expr = (OpExpr *) rinfo->clause;
+	if (list_length(expr->args) != 2)
+		return false;
+
+	left = linitial(expr->args);
+	right = lsecond(expr->args);
+
+	/* strip RelabelType from either side of the expression */
+	if (IsA(left, RelabelType))
+		left = (Node *) ((RelabelType *) left)->arg;
+	if (IsA(right, RelabelType))
+		right = (Node *) ((RelabelType *) right)->arg;
+
+	if (!IsA(left, Var) || !IsA(right, Var))
+		return false;
+
+	if (((Var *) left)->varlevelsup != 0 ||
+		((Var *) right)->varlevelsup != 0 ||
+		!AttrNumberIsForUserDefinedAttr(((Var *) left)->varattno) ||
+		!AttrNumberIsForUserDefinedAttr(((Var *) right)->varattno) ||
+		((Var *) left)->varno == ((Var *) right)->varno)
+		return false;
+
+	*opexpr = expr;
+	*var1isleft = (((Var *) left)->varno < ((Var *) right)->varno);
+	*var1 = (Var *) (*var1isleft ? left : right);
+	*var2 = (Var *) (*var1isleft ? right : left);
+
+	return true;
+}
+
+/*
+ * statext_join_choose_stats
+ *		Choose the extended statistics of one side of a join to use.
+ *
+ * Looks for the MCV list and ndistinct coefficients covering the largest
+ * number of the given attnums, preferring objects covering fewer other
+ * columns.  The keys of the better of the two are returned.
+ */
+static Bitmapset *
+statext_join_choose_stats(RelOptInfo *rel, bool inh, Bitmapset *attnums,
+						  StatisticExtInfo **mcvstat,
+						  StatisticExtInfo **ndstat)
+{
+	ListCell   *lc;
+	int			best_mcv_matched = 0;
+	int			best_mcv_keys = 0;
+	int			best_nd_matched = 0;
+	int			best_nd_keys = 0;
+
+	*mcvstat = NULL;
+	*ndstat = NULL;
+
+	foreach(lc, rel->statlist)
+	{
+		StatisticExtInfo *info = (StatisticExtInfo *) lfirst(lc);
+		Bitmapset  *matched;
+		int			nmatched;
+		int			nkeys;
+
+		/* skip statistics with mismatching stxdinherit value */
+		if (info->inherit != inh)
+			continue;
+
+		if (info->kind != STATS_EXT_MCV && info->kind != STATS_EXT_NDISTINCT)
+			continue;
+
+		matched = bms_intersect(info->keys, attnums);
+		nmatched = bms_num_members(matched);
+		nkeys = bms_num_members(info->keys);
+		bms_free(matched);
+
+		/* we need at least two columns for this to be of any use */
+		if (nmatched < 2)
+			continue;
+
+		if (info->kind == STATS_EXT_MCV)
+		{
+			if (nmatched > best_mcv_matched ||
+				(nmatched == best_mcv_matched && nkeys < best_mcv_keys))
+			{
+				*mcvstat = info;
+				best_mcv_matched = nmatched;
+				best_mcv_keys = nkeys;
+			}
+		}
+		else
+		{
+			if (nmatched > best_nd_matched ||
+				(nmatched == best_nd_matched && nkeys < best_nd_keys))
+			{
+				*ndstat = info;
+				best_nd_matched = nmatched;
+				best_nd_keys = nkeys;
+			}
+		}
+	}
+
+	if (best_mcv_matched == 0 && best_nd_matched == 0)
+		return NULL;
+
+	return (best_mcv_matched >= best_nd_matched) ?
+		(*mcvstat)->keys : (*ndstat)->keys;
+}
+
+/*
+ * statext_join_ndistinct
+ *		Estimate the number of distinct combinations of values in the given
+ *		columns of one side of a join, and the fraction of rows with a NULL in
+ *		any of them.
+ *
+ * The ndistinct coefficients are used if available.  Otherwise we assume
+ * the columns to be independent, which is the best we can do without them.
+ */
+static double
+statext_join_ndistinct(PlannerInfo *root, RelOptInfo *rel, bool inh,
+					   StatisticExtInfo *ndstat, Var **vars, int nvars,
+					   double *nullfrac)
+{
+	double		ndistinct = 1.0;
+	double		notnullfrac = 1.0;
+	bool		found = false;
+	int			i;
+
+	for (i = 0; i < nvars; i++)
+	{
+		VariableStatData vardata;
+		bool		isdefault;
+
+		examine_variable(root, (Node *) vars[i], 0, &vardata);
+		if (HeapTupleIsValid(vardata.statsTuple))
+			notnullfrac *=
+				1.0 - ((Form_pg_statistic) GETSTRUCT(vardata.statsTuple))->stanullfrac;
+		ndistinct *= get_variable_numdistinct(&vardata, &isdefault);
+		ReleaseVariableStats(vardata);
+	}
+
+	if (ndstat != NULL && bms_num_members(ndstat->keys) >= nvars)
+	{
+		MVNDistinct *stats = statext_ndistinct_load(ndstat->statOid, inh);
+		AttrNumber	attnum_offset;
+
+		/* attnums are offset in the items if there are expressions */
+		attnum_offset = ndstat->exprs ? list_length(ndstat->exprs) + 1 : 0;
+
+		for (i = 0; stats && i < stats->nitems; i++)
+		{
+			MVNDistinctItem *item = &stats->items[i];
+			int			j;
+
+			if (item->nattributes != nvars)
+				continue;
+
+			for (j = 0; j < nvars; j++)
+			{
+				int			k;
+
+				for (k = 0; k < nvars; k++)
+				{
+					if (item->attributes[j] == vars[k]->varattno + attnum_offset)
+						break;
+				}
+				if (k == nvars)
+					break;
+			}
+
+			if (j == nvars)
+			{
+				ndistinct = item->ndistinct;
+				found = true;
+				break;
+			}
+		}
+	}
+
+	/* the independence assumption can't yield more values than rows */
+	if (!found && rel->tuples > 0 && ndistinct > rel->tuples)
+		ndistinct = rel->tuples;
+
+	*nullfrac = 1.0 - notnullfrac;
+
+	return clamp_row_est(ndistinct);
+}
+
+/*
+ * statext_join_mcv_match
+ *		Cross-match the multi-column MCV lists of both sides of a join.
+ *
+ * This is the multi-column counterpart of eqjoinsel_find_matches(): an item
+ * of one list matches an item of the other if all the join clauses are
+ * satisfied by their values.  Items with a NULL in any of the columns never
+ * match.  Returns false if the operators can't be applied to the MCV lists,
+ * because they might leak values the user is not allowed to see.
+ */
+static bool
+statext_join_mcv_match(PlannerInfo *root, int nclauses, OpExpr **opexprs,
+					   bool *var1isleft,
+					   RelOptInfo *rel1, StatisticExtInfo *stat1,
+					   Var **vars1, double nullfrac1, double nd1,
+					   RelOptInfo *rel2, StatisticExtInfo *stat2,
+					   Var **vars2, double nullfrac2, double nd2,
+					   Selectivity *selec)
+{
+	MCVList    *mcv1;
+	MCVList    *mcv2;
+	FmgrInfo   *eqprocs;
+	int		   *dims1;
+	int		   *dims2;
+	bool	   *hasmatch1;
+	bool	   *hasmatch2;
+	bool		leakproof = true;
+	double		matchprodfreq = 0.0,
+				matchfreq1 = 0.0,
+				matchfreq2 = 0.0,
+				unmatchfreq1 = 0.0,
+				unmatchfreq2 = 0.0,
+				otherfreq1,
+				otherfreq2,
+				totalsel1,
+				totalsel2;
+	int			nmatches = 0;
+	int			i,
+				j,
+				k;
+
+	eqprocs = palloc_array(FmgrInfo, nclauses);
+	dims1 = palloc_array(int, nclauses);
+	dims2 = palloc_array(int, nclauses);
+
+	for (k = 0; k < nclauses; k++)
+	{
+		RegProcedure opfuncoid = get_opcode(opexprs[k]->opno);
+
+		if (!get_func_leakproof(opfuncoid))
+			leakproof = false;
+		fmgr_info(opfuncoid, &eqprocs[k]);
+
+		/* MCV dimensions are in attnum order, followed by expressions */
+		dims1[k] = bms_member_index(stat1->keys, vars1[k]->varattno);
+		dims2[k] = bms_member_index(stat2->keys, vars2[k]->varattno);
+	}
+
+	/*
+	 * The operators get to see values from the MCV lists, so if any of them
+	 * isn't leakproof, the user must be allowed to read all the rows of the
+	 * columns involved.  See statext_is_compatible_clause().
+	 */
+	if (!leakproof)
+	{
+		Bitmapset  *attnums1 = NULL;
+		Bitmapset  *attnums2 = NULL;
+
+		for (k = 0; k < nclauses; k++)
+		{
+			attnums1 = bms_add_member(attnums1,
+									  vars1[k]->varattno - FirstLowInvalidHeapAttributeNumber);
+			attnums2 = bms_add_member(attnums2,
+									  vars2[k]->varattno - FirstLowInvalidHeapAttributeNumber);
+		}
+
+		if (!all_rows_selectable(root, rel1->relid, attnums1) ||
+			!all_rows_selectable(root, rel2->relid, attnums2))
+			return false;
+	}
+
+	mcv1 = statext_mcv_load(stat1->statOid, planner_rt_fetch(rel1->relid, root)->inh);
+	mcv2 = statext_mcv_load(stat2->statOid, planner_rt_fetch(rel2->relid, root)->inh);
+
+	hasmatch1 = palloc0_array(bool, mcv1->nitems);
+	hasmatch2 = palloc0_array(bool, mcv2->nitems);
+
+	for (i = 0; i < mcv1->nitems; i++)
+	{
+		MCVItem    *item1 = &mcv1->items[i];
+
+		for (k = 0; k < nclauses; k++)
+		{
+			if (item1->isnull[dims1[k]])
+				break;
+		}
+		if (k < nclauses)
+			continue;
+
+		for (j = 0; j < mcv2->nitems; j++)
+		{
+			MCVItem    *item2 = &mcv2->items[j];
+
+			for (k = 0; k < nclauses; k++)
+			{
+				Datum		value1 = item1->values[dims1[k]];
+				Datum		value2;
+
+				if (item2->isnull[dims2[k]])
+					break;
+				value2 = item2->values[dims2[k]];
+
+				if (!DatumGetBool(FunctionCall2Coll(&eqprocs[k],
+													opexprs[k]->inputcollid,
+													var1isleft[k] ? value1 : value2,
+													var1isleft[k] ? value2 : value1)))
+					break;
+			}
+
+			if (k == nclauses)
+			{
+				if (!hasmatch1[i])
+					nmatches++;
+				hasmatch1[i] = hasmatch2[j] = true;
+				matchprodfreq += item1->frequency * item2->frequency;
+			}
+		}
+	}
+	CLAMP_PROBABILITY(matchprodfreq);
+
+	/*
+	 * Sum up frequencies of matched and unmatched MCV items.  Items with
+	 * NULLs are accounted for by the null fraction.
+	 */
+	for (i = 0; i < mcv1->nitems; i++)
+	{
+		if (hasmatch1[i])
+			matchfreq1 += mcv1->items[i].frequency;
+		else
+		{
+			for (k = 0; k < nclauses; k++)
+			{
+				if (mcv1->items[i].isnull[dims1[k]])
+					break;
+			}
+			if (k == nclauses)
+				unmatchfreq1 += mcv1->items[i].frequency;
+		}
+	}
+	for (j = 0; j < mcv2->nitems; j++)
+	{
+		if (hasmatch2[j])
+			matchfreq2 += mcv2->items[j].frequency;
+		else
+		{
+			for (k = 0; k < nclauses; k++)
+			{
+				if (mcv2->items[j].isnull[dims2[k]])
+					break;
+			}
+			if (k == nclauses)
+				unmatchfreq2 += mcv2->items[j].frequency;
+		}
+	}
+	CLAMP_PROBABILITY(matchfreq1);
+	CLAMP_PROBABILITY(unmatchfreq1);
+	CLAMP_PROBABILITY(matchfreq2);
+	CLAMP_PROBABILITY(unmatchfreq2);
+
+	otherfreq1 = 1.0 - nullfrac1 - matchfreq1 - unmatchfreq1;
+	otherfreq2 = 1.0 - nullfrac2 - matchfreq2 - unmatchfreq2;
+	CLAMP_PROBABILITY(otherfreq1);
+	CLAMP_PROBABILITY(otherfreq2);
+
+	/* Combine the frequencies the same way as eqjoinsel_inner(). */
+	totalsel1 = matchprodfreq;
+	if (nd2 > mcv2->nitems)
+		totalsel1 += unmatchfreq1 * otherfreq2 / (nd2 - mcv2->nitems);
+	if (nd2 > nmatches)
+		totalsel1 += otherfreq1 * (otherfreq2 + unmatchfreq2) /
+			(nd2 - nmatches);
+	totalsel2 = matchprodfreq;
+	if (nd1 > mcv1->nitems)
+		totalsel2 += unmatchfreq2 * otherfreq1 / (nd1 - mcv1->nitems);
+	if (nd1 > nmatches)
+		totalsel2 += otherfreq2 * (otherfreq1 + unmatchfreq1) /
+			(nd1 - nmatches);
+
+	*selec = (totalsel1 < totalsel2) ? totalsel1 : totalsel2;
+
+	return true;
+}
+
+/*
+ * statext_join_clauselist_selectivity
+ *		Estimate equijoin clauses using multi-column statistics of both sides.
+ *
+ * With per-column statistics, "a.x = b.x AND a.y = b.y" is estimated as the
+ * product of the selectivities of the two clauses, which underestimates the
+ * join size badly when x and y are correlated, as the columns of composite
+ * keys usually are.  If both relations have extended statistics on the
+ * joined columns, we instead estimate the clauses together, treating the
+ * columns of each side as a single composite value: multi-column MCV lists
+ * are cross-matched like per-column ones are in eqjoinsel_inner(), and
+ * multi-column ndistinct coefficients are used instead of the per-column
+ * numbers of distinct values.
+ *
+ * MCV lists are used when both sides have one, otherwise we fall back to the
+ * ndistinct-based estimate, assuming independence on the side without
+ * ndistinct coefficients.  If the MCV list covers more columns than the ones
+ * joined on, several of its items may have the same values in the joined
+ * columns; that doesn't affect the frequencies of matched items, but makes
+ * the estimate for the rest of the relation less accurate.
+ *
+ * Semi and anti joins are left to eqjoinsel_semi(), as is any join whose
+ * clauses don't include at least two equalities between columns of the same
+ * pair of relations covered by statistics.
+ *
+ * 'estimatedclauses' is an input/output parameter, as for
+ * statext_clauselist_selectivity().
+ */
+Selectivity
+statext_join_clauselist_selectivity(PlannerInfo *root, List *clauses,
+									JoinType jointype, SpecialJoinInfo *sjinfo,
+									Bitmapset **estimatedclauses)
+{
+	Selectivity sel = 1.0;
+	int			nclauses = list_length(clauses);
+	OpExpr	  **opexprs;
+	Var		  **vars1;
+	Var		  **vars2;
+	bool	   *var1isleft;
+	bool	   *done;
+	int			ncandidates = 0;
+	int			listidx;
+	ListCell   *l;
+
+	if (jointype != JOIN_INNER && jointype != JOIN_LEFT &&
+		jointype != JOIN_FULL)
+		return sel;
+
+	opexprs = palloc0_array(OpExpr *, nclauses);
+	vars1 = palloc_array(Var *, nclauses);
+	vars2 = palloc_array(Var *, nclauses);
+	var1isleft = palloc_array(bool, nclauses);
+	done = palloc0_array(bool, nclauses);
+
+	listidx = 0;
+	foreach(l, clauses)
+	{
+		if (!bms_is_member(listidx, *estimatedclauses) &&
+			statext_join_clause_is_compatible(root, (Node *) lfirst(l),
+											  &opexprs[listidx],
+											  &vars1[listidx],
+											  &vars2[listidx],
+											  &var1isleft[listidx]))
+			ncandidates++;
+		else
+			done[listidx] = true;
+
+		listidx++;
+	}
+
+	if (ncandidates < 2)
+		return sel;
+
+	/* Process the clauses one pair of relations at a time. */
+	for (listidx = 0; listidx < nclauses; listidx++)
+	{
+		Index		relid1;
+		Index		relid2;
+		RelOptInfo *rel1;
+		RelOptInfo *rel2;
+		bool		inh1;
+		bool		inh2;
+		Bitmapset  *attnums1 = NULL;
+		Bitmapset  *attnums2 = NULL;
+		Bitmapset  *keys1;
+		Bitmapset  *keys2;
+		StatisticExtInfo *mcvstat1;
+		StatisticExtInfo *mcvstat2;
+		StatisticExtInfo *ndstat1;
+		StatisticExtInfo *ndstat2;
+		int		   *group;
+		int			ngroup;
+		int			i;
+
+		if (done[listidx])
+			continue;
+
+		relid1 = vars1[listidx]->varno;
+		relid2 = vars2[listidx]->varno;
+
+		/*
+		 * Collect the clauses joining the same relations.  If there are
+		 * several equalities on the same column, use just the first one.
+		 */
+		group = palloc_array(int, nclauses);
+		ngroup = 0;
+		for (i = listidx; i < nclauses; i++)
+		{
+			if (done[i] ||
+				vars1[i]->varno != relid1 || vars2[i]->varno != relid2)
+				continue;
+
+			done[i] = true;
+
+			if (bms_is_member(vars1[i]->varattno, attnums1) ||
+				bms_is_member(vars2[i]->varattno, attnums2))
+				continue;
+
+			attnums1 = bms_add_member(attnums1, vars1[i]->varattno);
+			attnums2 = bms_add_member(attnums2, vars2[i]->varattno);
+			group[ngroup++] = i;
+		}
+
+		if (ngroup < 2)
+			continue;
+
+		rel1 = find_base_rel(root, relid1);
+		rel2 = find_base_rel(root, relid2);
+		if (rel1->rtekind != RTE_RELATION || rel1->statlist == NIL ||
+			rel2->rtekind != RTE_RELATION || rel2->statlist == NIL)
+			continue;
+		inh1 = planner_rt_fetch(relid1, root)->inh;
+		inh2 = planner_rt_fetch(relid2, root)->inh;
+
+		/*
+		 * Find the statistics to use on both sides, and restrict the clauses
+		 * to the ones whose columns they cover.  Then look again, as there
+		 * may be a better choice for the remaining columns.
+		 */
+		keys1 = statext_join_choose_stats(rel1, inh1, attnums1,
+										  &mcvstat1, &ndstat1);
+		keys2 = statext_join_choose_stats(rel2, inh2, attnums2,
+										  &mcvstat2, &ndstat2);
+		if (keys1 == NULL || keys2 == NULL)
+			continue;
+
+		attnums1 = attnums2 = NULL;
+		for (i = 0; i < ngroup; i++)
+		{
+			int			c = group[i];
+
+			if (!bms_is_member(vars1[c]->varattno, keys1) ||
+				!bms_is_member(vars2[c]->varattno, keys2))
+			{
+				group[i--] = group[--ngroup];
+				continue;
+			}
+
+			attnums1 = bms_add_member(attnums1, vars1[c]->varattno);
+			attnums2 = bms_add_member(attnums2, vars2[c]->varattno);
+		}
+
+		if (ngroup < 2)
+			continue;
+
+		(void) statext_join_choose_stats(rel1, inh1, attnums1,
+										 &mcvstat1, &ndstat1);
+		(void) statext_join_choose_stats(rel2, inh2, attnums2,
+										 &mcvstat2, &ndstat2);
+
+		/* Only use statistics covering all the remaining columns. */
+		if (mcvstat1 && !bms_is_subset(attnums1, mcvstat1->keys))
+			mcvstat1 = NULL;
+		if (mcvstat2 && !bms_is_subset(attnums2, mcvstat2->keys))
+			mcvstat2 = NULL;
+		if (ndstat1 && !bms_is_subset(attnums1, ndstat1->keys))
+			ndstat1 = NULL;
+		if (ndstat2 && !bms_is_subset(attnums2, ndstat2->keys))
+			ndstat2 = NULL;
+
+		if ((mcvstat1 || ndstat1) && (mcvstat2 || ndstat2))
+		{
+			Var		  **gvars1 = palloc_array(Var *, ngroup);
+			Var		  **gvars2 = palloc_array(Var *, ngroup);
+			OpExpr	  **gopexprs = palloc_array(OpExpr *, ngroup);
+			bool	   *gvar1isleft = palloc_array(bool, ngroup);
+			double		nd1,
+						nd2,
+						nullfrac1,
+						nullfrac2;
+			Selectivity s;
+
+			for (i = 0; i < ngroup; i++)
+			{
+				gvars1[i] = vars1[group[i]];
+				gvars2[i] = vars2[group[i]];
+				gopexprs[i] = opexprs[group[i]];
+				gvar1isleft[i] = var1isleft[group[i]];
+			}
+
+			nd1 = statext_join_ndistinct(root, rel1, inh1, ndstat1,
+										 gvars1, ngroup, &nullfrac1);
+			nd2 = statext_join_ndistinct(root, rel2, inh2, ndstat2,
+										 gvars2, ngroup, &nullfrac2);
+
+			if (!mcvstat1 || !mcvstat2 ||
+				!statext_join_mcv_match(root, ngroup, gopexprs, gvar1isleft,
+										rel1, mcvstat1, gvars1, nullfrac1, nd1,
+										rel2, mcvstat2, gvars2, nullfrac2, nd2,
+										&s))
+			{
+				/* Same as eqjoinsel_inner() without MCV lists */
+				s = (1.0 - nullfrac1) * (1.0 - nullfrac2);
+				s /= Max(nd1, nd2);
+			}
+
+			CLAMP_PROBABILITY(s);
+			sel *= s;
+
+			for (i = 0; i < ngroup; i++)
+				*estimatedclauses = bms_add_member(*estimatedclauses, group[i]);
+		}
+	}
+
+	return sel;
+}
+
 /*
  * examine_opclause_args
  *		Split an operator expression's arguments into Expr and Const parts.
@@ -212,8 +212,8 @@ pgaio_io_uses_fd(PgAioHandle *ioh, int fd)
 }
 
 /*
- * Return the iovec and its length. Currently only expected to be used by
- * debugging infrastructure
+ * Return the iovec and its length. Used by debugging infrastructure, and by
+ * completion callbacks that need to look at the data transferred.
  */
 int
 pgaio_io_get_iovec_length(PgAioHandle *ioh, struct iovec **iov)
@@ -99,6 +99,7 @@ struct ReadStream
 	int16		forwarded_buffers;
 	int16		pinned_buffers;
 	int16		distance;
+	int16		resume_distance;
 	int16		initialized_buffers;
 	int			read_buffers_flags;
 	bool		sync_mode;		/* using io_method=sync */
@@ -746,7 +747,7 @@ read_stream_begin_relation(int flags,
 								  strategy,
 								  rel,
 								  RelationGetSmgr(rel),
-								  rel->rd_rel->relpersistence,
+								  RelationGetBufferPersistence(rel),
 								  forknum,
 								  callback,
 								  callback_private_data,
@@ -1034,6 +1035,52 @@ read_stream_next_block(ReadStream *stream, BufferAccessStrategy *strategy)
 	return read_stream_get_block(stream, NULL);
 }
 
+/*
+ * A callback can call this and return its result instead of a block number,
+ * to report that it has no block number to return right now, but might have
+ * more later.  The stream then behaves as if it had reached the end, until
+ * read_stream_resume() is called.  Buffers that were already queued can
+ * still be consumed while the stream is paused.
+ */
+BlockNumber
+read_stream_pause(ReadStream *stream)
+{
+	stream->resume_distance = stream->distance;
+	stream->distance = 0;
+	return InvalidBlockNumber;
+}
+
+/*
+ * Allow a stream that was paused by its callback to continue looking ahead.
+ */
+void
+read_stream_resume(ReadStream *stream)
+{
+	stream->distance = Max(stream->resume_distance, 1);
+}
+
+/*
+ * Start I/O for the first blocks of a stream that hasn't returned any
+ * buffers yet, so that they may already be in memory when the consumer gets
+ * around to it.  This is meant for consumers that know they will switch to
+ * this stream soon, e.g. the next partition of an Append.  The look-ahead
+ * distance starts at a full-sized read, as with READ_STREAM_FULL, since a
+ * single-block read would not buy much.  Does nothing if the stream is
+ * already active, paused or at its end.
+ */
+void
+read_stream_prefetch(ReadStream *stream)
+{
+	if (stream->pinned_buffers > 0 || stream->distance == 0 ||
+		stream->fast_path)
+		return;
+
+	stream->distance = Max(stream->distance,
+						   Min(stream->max_pinned_buffers,
+							   stream->io_combine_limit));
+	read_stream_look_ahead(stream);
+}
+
 /*
  * Reset a read stream by releasing any queued up buffers, allowing the stream
  * to be used again for different blocks.  This can be used to clear an
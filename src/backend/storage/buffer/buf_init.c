@@ -130,6 +130,7 @@ BufferManagerShmemInit(void)
 
 			LWLockInitialize(BufferDescriptorGetContentLock(buf),
 							 LWTRANCHE_BUFFER_CONTENT);
+			pg_atomic_init_u32(&buf->content_seq, 0);
 
 			ConditionVariableInit(BufferDescriptorGetIOCV(buf));
 		}
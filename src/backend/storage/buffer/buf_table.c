@@ -21,7 +21,9 @@
  */
 #include "postgres.h"
 
+#include "port/pg_bitutils.h"
 #include "storage/buf_internals.h"
+#include "storage/shmem.h"
 
 /* entry for buffer lookup hashtable */
 typedef struct
@@ -32,6 +34,22 @@ typedef struct
 
 static HTAB *SharedBufHash;
 
+/*
+ * Lookup hints: a direct-mapped array, indexed by the low-order bits of the
+ * tag's hash code, remembering the buffer ID (plus one) last inserted or
+ * found in the table for a tag with those bits.  Reading a hint requires no
+ * lock at all, but the hint may be stale or belong to a colliding tag, so
+ * the caller must verify it after pinning the buffer (see BufferAlloc()).
+ */
+static pg_atomic_uint32 *SharedBufHints;
+static uint32 SharedBufHintMask;
+
+static uint32
+BufTableHintCount(int size)
+{
+	return pg_nextpower2_32(Max(size, 1));
+}
+
 
 /*
  * Estimate space needed for mapping hashtable
@@ -40,7 +58,9 @@ static HTAB *SharedBufHash;
 Size
 BufTableShmemSize(int size)
 {
-	return hash_estimate_size(size, sizeof(BufferLookupEnt));
+	return add_size(hash_estimate_size(size, sizeof(BufferLookupEnt)),
+					mul_size(BufTableHintCount(size),
+							 sizeof(pg_atomic_uint32)));
 }
 
 /*
@@ -51,6 +71,8 @@ void
 InitBufTable(int size)
 {
 	HASHCTL		info;
+	uint32		nhints;
+	bool		found;
 
 	/* assume no locking is needed yet */
 
@@ -63,6 +85,18 @@ InitBufTable(int size)
 								  size, size,
 								  &info,
 								  HASH_ELEM | HASH_BLOBS | HASH_PARTITION | HASH_FIXED_SIZE);
+
+	nhints = BufTableHintCount(size);
+	SharedBufHints = (pg_atomic_uint32 *)
+		ShmemInitStruct("Shared Buffer Lookup Hints",
+						mul_size(nhints, sizeof(pg_atomic_uint32)),
+						&found);
+	if (!found)
+	{
+		for (uint32 i = 0; i < nhints; i++)
+			pg_atomic_init_u32(&SharedBufHints[i], 0);
+	}
+	SharedBufHintMask = nhints - 1;
 }
 
 /*
@@ -101,9 +135,30 @@ BufTableLookup(BufferTag *tagPtr, uint32 hashcode)
 	if (!result)
 		return -1;
 
+	/* Repair the hint if a colliding tag took it over */
+	if (pg_atomic_read_u32(&SharedBufHints[hashcode & SharedBufHintMask]) !=
+		result->id + 1)
+		pg_atomic_write_u32(&SharedBufHints[hashcode & SharedBufHintMask],
+							result->id + 1);
+
 	return result->id;
 }
 
+/*
+ * BufTableLookupHint
+ *		Guess the buffer ID for the given BufferTag without locking; return
+ *		-1 if there's no guess
+ *
+ * The result may be stale, or belong to a different tag.  Callers must pin
+ * the buffer and then check that it has the expected tag; see
+ * BufferAlloc().  No lock is required.
+ */
+int
+BufTableLookupHint(BufferTag *tagPtr, uint32 hashcode)
+{
+	return (int) pg_atomic_read_u32(&SharedBufHints[hashcode & SharedBufHintMask]) - 1;
+}
+
 /*
  * BufTableInsert
  *		Insert a hashtable entry for given tag and buffer ID,
@@ -135,6 +190,9 @@ BufTableInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id)
 
 	result->id = buf_id;
 
+	pg_atomic_write_u32(&SharedBufHints[hashcode & SharedBufHintMask],
+						buf_id + 1);
+
 	return -1;
 }
 
@@ -40,6 +40,7 @@
 #include "access/tableam.h"
 #include "access/xloginsert.h"
 #include "access/xlogutils.h"
+#include "catalog/globaltemp.h"
 #ifdef USE_ASSERT_CHECKING
 #include "catalog/pg_tablespace_d.h"
 #endif
@@ -54,6 +55,7 @@
 #include "storage/aio.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "storage/doublewrite.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/lmgr.h"
@@ -61,7 +63,9 @@
 #include "storage/read_stream.h"
 #include "storage/smgr.h"
 #include "storage/standby.h"
+#include "utils/injection_point.h"
 #include "utils/memdebug.h"
+#include "utils/memutils.h"
 #include "utils/ps_status.h"
 #include "utils/rel.h"
 #include "utils/resowner.h"
@@ -612,6 +616,8 @@ static void PinBuffer_Locked(BufferDesc *buf);
 static void UnpinBuffer(BufferDesc *buf);
 static void UnpinBufferNoOwner(BufferDesc *buf);
 static void BufferSync(int flags);
+static int	SyncBufferRun(CkptSortItem *items, int nitems,
+						  WritebackContext *wb_context, int *nwritten);
 static int	SyncOneBuffer(int buf_id, bool skip_recently_used,
 						  WritebackContext *wb_context);
 static void WaitIO(BufferDesc *buf);
@@ -674,10 +680,19 @@ PrefetchSharedBuffer(SMgrRelation smgr_reln,
 	newHash = BufTableHashCode(&newTag);
 	newPartitionLock = BufMappingPartitionLock(newHash);
 
-	/* see if the block is in the buffer pool already */
-	LWLockAcquire(newPartitionLock, LW_SHARED);
-	buf_id = BufTableLookup(&newTag, newHash);
-	LWLockRelease(newPartitionLock);
+	/*
+	 * See if the block is in the buffer pool already.  As the result is only
+	 * advisory anyway, an unlocked check of the lookup hint's tag is good
+	 * enough to skip the mapping lock for resident blocks.
+	 */
+	buf_id = BufTableLookupHint(&newTag, newHash);
+	if (buf_id < 0 ||
+		!BufferTagsEqual(&newTag, &GetBufferDescriptor(buf_id)->tag))
+	{
+		LWLockAcquire(newPartitionLock, LW_SHARED);
+		buf_id = BufTableLookup(&newTag, newHash);
+		LWLockRelease(newPartitionLock);
+	}
 
 	/* If not in buffers, initiate prefetch */
 	if (buf_id < 0)
@@ -981,7 +996,7 @@ ExtendBufferedRelBy(BufferManagerRelation bmr,
 	Assert(extend_by > 0);
 
 	if (bmr.relpersistence == '\0')
-		bmr.relpersistence = bmr.rel->rd_rel->relpersistence;
+		bmr.relpersistence = RelationGetBufferPersistence(bmr.rel);
 
 	return ExtendBufferedRelCommon(bmr, fork, strategy, flags,
 								   extend_by, InvalidBlockNumber,
@@ -1014,7 +1029,7 @@ ExtendBufferedRelTo(BufferManagerRelation bmr,
 	Assert(extend_to != InvalidBlockNumber && extend_to > 0);
 
 	if (bmr.relpersistence == '\0')
-		bmr.relpersistence = bmr.rel->rd_rel->relpersistence;
+		bmr.relpersistence = RelationGetBufferPersistence(bmr.rel);
 
 	/*
 	 * If desired, create the file if it doesn't exist.  If
@@ -1296,7 +1311,7 @@ ReadBuffer_common(Relation rel, SMgrRelation smgr, char smgr_persistence,
 	}
 
 	if (rel)
-		persistence = rel->rd_rel->relpersistence;
+		persistence = RelationGetBufferPersistence(rel);
 	else
 		persistence = smgr_persistence;
 
@@ -2097,6 +2112,33 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	newHash = BufTableHashCode(&newTag);
 	newPartitionLock = BufMappingPartitionLock(newHash);
 
+	/*
+	 * First, try to find the block without taking the mapping lock, using the
+	 * lookup hint.  Once we have pinned the buffer its tag can't change, so
+	 * if it still holds our block and is valid, we're done.  We check the tag
+	 * before pinning as well, so as not to bump the usage count of unrelated
+	 * buffers because of stale hints.  We don't bother if we already hold a
+	 * pin on the buffer, since PinBuffer() would pin it again even if it's
+	 * not valid.
+	 */
+	existing_buf_id = BufTableLookupHint(&newTag, newHash);
+	if (existing_buf_id >= 0 &&
+		GetPrivateRefCount(existing_buf_id + 1) == 0)
+	{
+		BufferDesc *buf = GetBufferDescriptor(existing_buf_id);
+
+		if (BufferTagsEqual(&newTag, &buf->tag) &&
+			PinBuffer(buf, strategy, true))
+		{
+			if (BufferTagsEqual(&newTag, &buf->tag))
+			{
+				*foundPtr = true;
+				return buf;
+			}
+			UnpinBuffer(buf);
+		}
+	}
+
 	/* see if the block is in the buffer pool already */
 	LWLockAcquire(newPartitionLock, LW_SHARED);
 	existing_buf_id = BufTableLookup(&newTag, newHash);
@@ -3625,43 +3667,64 @@ BufferSync(int flags)
 		BufferDesc *bufHdr = NULL;
 		CkptTsStatus *ts_stat = (CkptTsStatus *)
 			DatumGetPointer(binaryheap_first(ts_heap));
+		CkptSortItem *item = &CkptBufferIds[ts_stat->index];
+		int			max_items;
+		int			nitems;
+		int			nprocessed = 1;
 
-		buf_id = CkptBufferIds[ts_stat->index].buf_id;
+		buf_id = item->buf_id;
 		Assert(buf_id != -1);
 
 		bufHdr = GetBufferDescriptor(buf_id);
 
-		num_processed++;
+		/*
+		 * Thanks to the sort order, buffers holding consecutive blocks of the
+		 * same relation fork are adjacent in CkptBufferIds.  Find out how
+		 * many of the following entries might be combined with this one into
+		 * a single write, up to io_combine_limit.  SyncBufferRun() verifies
+		 * the buffer tags, since entries can become stale and the sort key
+		 * doesn't include the database.
+		 */
+		max_items = Min(io_combine_limit,
+						ts_stat->num_to_scan - ts_stat->num_scanned);
+		for (nitems = 1; nitems < max_items; nitems++)
+		{
+			if (item[nitems].relNumber != item->relNumber ||
+				item[nitems].forkNum != item->forkNum ||
+				item[nitems].blockNum != item->blockNum + nitems)
+				break;
+		}
 
 		/*
 		 * We don't need to acquire the lock here, because we're only looking
 		 * at a single bit. It's possible that someone else writes the buffer
 		 * and clears the flag right after we check, but that doesn't matter
-		 * since SyncOneBuffer will then do nothing.  However, there is a
+		 * since SyncBufferRun will then do nothing.  However, there is a
 		 * further race condition: it's conceivable that between the time we
-		 * examine the bit here and the time SyncOneBuffer acquires the lock,
+		 * examine the bit here and the time SyncBufferRun acquires the lock,
 		 * someone else not only wrote the buffer but replaced it with another
-		 * page and dirtied it.  In that improbable case, SyncOneBuffer will
+		 * page and dirtied it.  In that improbable case, SyncBufferRun will
 		 * write the buffer though we didn't need to.  It doesn't seem worth
 		 * guarding against this, though.
 		 */
 		if (pg_atomic_read_u32(&bufHdr->state) & BM_CHECKPOINT_NEEDED)
 		{
-			if (SyncOneBuffer(buf_id, false, &wb_context) & BUF_WRITTEN)
-			{
-				TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
-				PendingCheckpointerStats.buffers_written++;
-				num_written++;
-			}
+			int			nwritten;
+
+			nprocessed = SyncBufferRun(item, nitems, &wb_context, &nwritten);
+			PendingCheckpointerStats.buffers_written += nwritten;
+			num_written += nwritten;
 		}
 
+		num_processed += nprocessed;
+
 		/*
 		 * Measure progress independent of actually having to flush the buffer
 		 * - otherwise writing become unbalanced.
 		 */
-		ts_stat->progress += ts_stat->progress_slice;
-		ts_stat->num_scanned++;
-		ts_stat->index++;
+		ts_stat->progress += ts_stat->progress_slice * nprocessed;
+		ts_stat->num_scanned += nprocessed;
+		ts_stat->index += nprocessed;
 
 		/* Have all the buffers from the tablespace been processed? */
 		if (ts_stat->num_scanned == ts_stat->num_to_scan)
@@ -3702,41 +3765,50 @@ BufferSync(int flags)
 }
 
 /*
- * BgBufferSync -- Write out some dirty buffers in the pool.
+ * State kept by BgBufferSync() between calls, for each clock-sweep partition.
  *
- * This is called periodically by the background writer process.
+ * This lets us determine the strategy point's advance rate and avoid scanning
+ * already-cleaned buffers.
+ */
+typedef struct BgSyncPartitionState
+{
+	bool		saved_info_valid;
+	int			prev_strategy_buf_id;
+	uint32		prev_strategy_passes;
+	int			next_to_clean;
+	uint32		next_passes;
+
+	/* Moving averages of allocation rate and clean-buffer density */
+	float		smoothed_alloc;
+	float		smoothed_density;
+
+	/* Extra scan-ahead factor while backends keep finding dirty victims */
+	float		demand_boost;
+} BgSyncPartitionState;
+
+/*
+ * BgBufferSyncPartition -- BgBufferSync() for one clock-sweep partition
  *
- * Returns true if it's appropriate for the bgwriter process to go into
- * low-power hibernation mode.  (This happens if the strategy clock-sweep
- * has been "lapped" and no buffer allocations have occurred recently,
- * or if the bgwriter has been effectively disabled by setting
- * bgwriter_lru_maxpages to 0.)
+ * Runs the LRU scan over the partition's range of buffers, ahead of its clock
+ * hand, writing at most maxpages buffers.  Returns true if it's OK to
+ * hibernate as far as this partition is concerned.
  */
-bool
-BgBufferSync(WritebackContext *wb_context)
+static bool
+BgBufferSyncPartition(int partition, BgSyncPartitionState *state, int maxpages,
+					  WritebackContext *wb_context)
 {
 	/* info obtained from freelist.c */
 	int			strategy_buf_id;
 	uint32		strategy_passes;
 	uint32		recent_alloc;
-
-	/*
-	 * Information saved between calls so we can determine the strategy
-	 * point's advance rate and avoid scanning already-cleaned buffers.
-	 */
-	static bool saved_info_valid = false;
-	static int	prev_strategy_buf_id;
-	static uint32 prev_strategy_passes;
-	static int	next_to_clean;
-	static uint32 next_passes;
-
-	/* Moving averages of allocation rate and clean-buffer density */
-	static float smoothed_alloc = 0;
-	static float smoothed_density = 10.0;
+	uint32		recent_dirty_alloc;
+	int			first_buffer;
+	int			num_buffers;
 
 	/* Potentially these could be tunables, but for now, not */
 	float		smoothing_samples = 16;
 	float		scan_whole_pool_milliseconds = 120000.0;
+	float		max_demand_boost = 8.0;
 
 	/* Used to compute how far we scan ahead */
 	long		strategy_delta;
@@ -3760,7 +3832,9 @@ BgBufferSync(WritebackContext *wb_context)
 	 * Find out where the clock-sweep currently is, and how many buffer
 	 * allocations have happened since our last call.
 	 */
-	strategy_buf_id = StrategySyncStart(&strategy_passes, &recent_alloc);
+	strategy_buf_id = StrategySyncStart(partition, &strategy_passes,
+										&recent_alloc, &recent_dirty_alloc);
+	StrategyPartitionInfo(partition, &first_buffer, &num_buffers, NULL, NULL);
 
 	/* Report buffer alloc counts to pgstat */
 	PendingBgWriterStats.buf_alloc += recent_alloc;
@@ -3770,9 +3844,9 @@ BgBufferSync(WritebackContext *wb_context)
 	 * stuff.  We mark the saved state invalid so that we can recover sanely
 	 * if LRU scan is turned back on later.
 	 */
-	if (bgwriter_lru_maxpages <= 0)
+	if (maxpages <= 0)
 	{
-		saved_info_valid = false;
+		state->saved_info_valid = false;
 		return true;
 	}
 
@@ -3784,34 +3858,34 @@ BgBufferSync(WritebackContext *wb_context)
 	 * weird-looking coding of xxx_passes comparisons are to avoid bogus
 	 * behavior when the passes counts wrap around.
 	 */
-	if (saved_info_valid)
+	if (state->saved_info_valid)
 	{
-		int32		passes_delta = strategy_passes - prev_strategy_passes;
+		int32		passes_delta = strategy_passes - state->prev_strategy_passes;
 
-		strategy_delta = strategy_buf_id - prev_strategy_buf_id;
-		strategy_delta += (long) passes_delta * NBuffers;
+		strategy_delta = strategy_buf_id - state->prev_strategy_buf_id;
+		strategy_delta += (long) passes_delta * num_buffers;
 
 		Assert(strategy_delta >= 0);
 
-		if ((int32) (next_passes - strategy_passes) > 0)
+		if ((int32) (state->next_passes - strategy_passes) > 0)
 		{
 			/* we're one pass ahead of the strategy point */
-			bufs_to_lap = strategy_buf_id - next_to_clean;
+			bufs_to_lap = strategy_buf_id - state->next_to_clean;
 #ifdef BGW_DEBUG
 			elog(DEBUG2, "bgwriter ahead: bgw %u-%u strategy %u-%u delta=%ld lap=%d",
-				 next_passes, next_to_clean,
+				 state->next_passes, state->next_to_clean,
 				 strategy_passes, strategy_buf_id,
 				 strategy_delta, bufs_to_lap);
 #endif
 		}
-		else if (next_passes == strategy_passes &&
-				 next_to_clean >= strategy_buf_id)
+		else if (state->next_passes == strategy_passes &&
+				 state->next_to_clean >= strategy_buf_id)
 		{
 			/* on same pass, but ahead or at least not behind */
-			bufs_to_lap = NBuffers - (next_to_clean - strategy_buf_id);
+			bufs_to_lap = num_buffers - (state->next_to_clean - strategy_buf_id);
 #ifdef BGW_DEBUG
 			elog(DEBUG2, "bgwriter ahead: bgw %u-%u strategy %u-%u delta=%ld lap=%d",
-				 next_passes, next_to_clean,
+				 state->next_passes, state->next_to_clean,
 				 strategy_passes, strategy_buf_id,
 				 strategy_delta, bufs_to_lap);
 #endif
@@ -3824,13 +3898,13 @@ BgBufferSync(WritebackContext *wb_context)
 			 */
 #ifdef BGW_DEBUG
 			elog(DEBUG2, "bgwriter behind: bgw %u-%u strategy %u-%u delta=%ld",
-				 next_passes, next_to_clean,
+				 state->next_passes, state->next_to_clean,
 				 strategy_passes, strategy_buf_id,
 				 strategy_delta);
 #endif
-			next_to_clean = strategy_buf_id;
-			next_passes = strategy_passes;
-			bufs_to_lap = NBuffers;
+			state->next_to_clean = strategy_buf_id;
+			state->next_passes = strategy_passes;
+			bufs_to_lap = num_buffers;
 		}
 	}
 	else
@@ -3844,15 +3918,15 @@ BgBufferSync(WritebackContext *wb_context)
 			 strategy_passes, strategy_buf_id);
 #endif
 		strategy_delta = 0;
-		next_to_clean = strategy_buf_id;
-		next_passes = strategy_passes;
-		bufs_to_lap = NBuffers;
+		state->next_to_clean = strategy_buf_id;
+		state->next_passes = strategy_passes;
+		bufs_to_lap = num_buffers;
 	}
 
 	/* Update saved info for next time */
-	prev_strategy_buf_id = strategy_buf_id;
-	prev_strategy_passes = strategy_passes;
-	saved_info_valid = true;
+	state->prev_strategy_buf_id = strategy_buf_id;
+	state->prev_strategy_passes = strategy_passes;
+	state->saved_info_valid = true;
 
 	/*
 	 * Compute how many buffers had to be scanned for each new allocation, ie,
@@ -3863,7 +3937,7 @@ BgBufferSync(WritebackContext *wb_context)
 	if (strategy_delta > 0 && recent_alloc > 0)
 	{
 		scans_per_alloc = (float) strategy_delta / (float) recent_alloc;
-		smoothed_density += (scans_per_alloc - smoothed_density) /
+		state->smoothed_density += (scans_per_alloc - state->smoothed_density) /
 			smoothing_samples;
 	}
 
@@ -3872,22 +3946,35 @@ BgBufferSync(WritebackContext *wb_context)
 	 * strategy point and where we've scanned ahead to, based on the smoothed
 	 * density estimate.
 	 */
-	bufs_ahead = NBuffers - bufs_to_lap;
-	reusable_buffers_est = (float) bufs_ahead / smoothed_density;
+	bufs_ahead = num_buffers - bufs_to_lap;
+	reusable_buffers_est = (float) bufs_ahead / state->smoothed_density;
 
 	/*
 	 * Track a moving average of recent buffer allocations.  Here, rather than
 	 * a true average we want a fast-attack, slow-decline behavior: we
 	 * immediately follow any increase.
 	 */
-	if (smoothed_alloc <= (float) recent_alloc)
-		smoothed_alloc = recent_alloc;
+	if (state->smoothed_alloc <= (float) recent_alloc)
+		state->smoothed_alloc = recent_alloc;
 	else
-		smoothed_alloc += ((float) recent_alloc - smoothed_alloc) /
+		state->smoothed_alloc += ((float) recent_alloc - state->smoothed_alloc) /
 			smoothing_samples;
 
+	/*
+	 * The estimate above assumes the allocation rate stays about the same,
+	 * but if backends found dirty victims since the last round, we didn't
+	 * clean far enough ahead, typically because demand is rising faster than
+	 * smoothed_alloc follows it.  Scan further ahead in that case, more so
+	 * each round it keeps happening, and relax slowly once it stops.
+	 */
+	if (recent_dirty_alloc > 0)
+		state->demand_boost = Min(state->demand_boost * 1.5, max_demand_boost);
+	else
+		state->demand_boost -= (state->demand_boost - 1.0) / smoothing_samples;
+
 	/* Scale the estimate by a GUC to allow more aggressive tuning. */
-	upcoming_alloc_est = (int) (smoothed_alloc * bgwriter_lru_multiplier);
+	upcoming_alloc_est = (int) (state->smoothed_alloc * bgwriter_lru_multiplier *
+								state->demand_boost);
 
 	/*
 	 * If recent_alloc remains at zero for many cycles, smoothed_alloc will
@@ -3898,7 +3985,7 @@ BgBufferSync(WritebackContext *wb_context)
 	 * syndrome.  It will pop back up as soon as recent_alloc increases.
 	 */
 	if (upcoming_alloc_est == 0)
-		smoothed_alloc = 0;
+		state->smoothed_alloc = 0;
 
 	/*
 	 * Even in cases where there's been little or no buffer allocation
@@ -3908,9 +3995,9 @@ BgBufferSync(WritebackContext *wb_context)
 	 *
 	 * (scan_whole_pool_milliseconds / BgWriterDelay) computes how many times
 	 * the BGW will be called during the scan_whole_pool time; slice the
-	 * buffer pool into that many sections.
+	 * partition into that many sections.
 	 */
-	min_scan_buffers = (int) (NBuffers / (scan_whole_pool_milliseconds / BgWriterDelay));
+	min_scan_buffers = (int) (num_buffers / (scan_whole_pool_milliseconds / BgWriterDelay));
 
 	if (upcoming_alloc_est < (min_scan_buffers + reusable_buffers_est))
 	{
@@ -3925,7 +4012,7 @@ BgBufferSync(WritebackContext *wb_context)
 	 * Now write out dirty reusable buffers, working forward from the
 	 * next_to_clean point, until we have lapped the strategy scan, or cleaned
 	 * enough buffers to match our estimate of the next cycle's allocation
-	 * requirements, or hit the bgwriter_lru_maxpages limit.
+	 * requirements, or hit our share of the bgwriter_lru_maxpages limit.
 	 */
 
 	num_to_scan = bufs_to_lap;
@@ -3935,20 +4022,20 @@ BgBufferSync(WritebackContext *wb_context)
 	/* Execute the LRU scan */
 	while (num_to_scan > 0 && reusable_buffers < upcoming_alloc_est)
 	{
-		int			sync_state = SyncOneBuffer(next_to_clean, true,
+		int			sync_state = SyncOneBuffer(state->next_to_clean, true,
 											   wb_context);
 
-		if (++next_to_clean >= NBuffers)
+		if (++state->next_to_clean >= first_buffer + num_buffers)
 		{
-			next_to_clean = 0;
-			next_passes++;
+			state->next_to_clean = first_buffer;
+			state->next_passes++;
 		}
 		num_to_scan--;
 
 		if (sync_state & BUF_WRITTEN)
 		{
 			reusable_buffers++;
-			if (++num_written >= bgwriter_lru_maxpages)
+			if (++num_written >= maxpages)
 			{
 				PendingBgWriterStats.maxwritten_clean++;
 				break;
@@ -3962,8 +4049,8 @@ BgBufferSync(WritebackContext *wb_context)
 
 #ifdef BGW_DEBUG
 	elog(DEBUG1, "bgwriter: recent_alloc=%u smoothed=%.2f delta=%ld ahead=%d density=%.2f reusable_est=%d upcoming_est=%d scanned=%d wrote=%d reusable=%d",
-		 recent_alloc, smoothed_alloc, strategy_delta, bufs_ahead,
-		 smoothed_density, reusable_buffers_est, upcoming_alloc_est,
+		 recent_alloc, state->smoothed_alloc, strategy_delta, bufs_ahead,
+		 state->smoothed_density, reusable_buffers_est, upcoming_alloc_est,
 		 bufs_to_lap - num_to_scan,
 		 num_written,
 		 reusable_buffers - reusable_buffers_est);
@@ -3982,13 +4069,13 @@ BgBufferSync(WritebackContext *wb_context)
 	if (new_strategy_delta > 0 && new_recent_alloc > 0)
 	{
 		scans_per_alloc = (float) new_strategy_delta / (float) new_recent_alloc;
-		smoothed_density += (scans_per_alloc - smoothed_density) /
+		state->smoothed_density += (scans_per_alloc - state->smoothed_density) /
 			smoothing_samples;
 
 #ifdef BGW_DEBUG
 		elog(DEBUG2, "bgwriter: cleaner density alloc=%u scan=%ld density=%.2f new smoothed=%.2f",
 			 new_recent_alloc, new_strategy_delta,
-			 scans_per_alloc, smoothed_density);
+			 scans_per_alloc, state->smoothed_density);
 #endif
 	}
 
@@ -3996,6 +4083,266 @@ BgBufferSync(WritebackContext *wb_context)
 	return (bufs_to_lap == 0 && recent_alloc == 0);
 }
 
+/*
+ * BgBufferSync -- Write out some dirty buffers in the pool.
+ *
+ * This is called periodically by the background writer process.
+ *
+ * Each clock-sweep partition is handled separately by BgBufferSyncPartition(),
+ * with bgwriter_lru_maxpages split evenly between them.
+ *
+ * Returns true if it's appropriate for the bgwriter process to go into
+ * low-power hibernation mode.  (This happens if the strategy clock-sweep
+ * has been "lapped" and no buffer allocations have occurred recently,
+ * or if the bgwriter has been effectively disabled by setting
+ * bgwriter_lru_maxpages to 0.)
+ */
+bool
+BgBufferSync(WritebackContext *wb_context)
+{
+	static BgSyncPartitionState *states = NULL;
+	int			nparts = StrategyNumPartitions();
+	int			maxpages;
+	bool		hibernate = true;
+
+	if (states == NULL)
+	{
+		states = (BgSyncPartitionState *)
+			MemoryContextAllocZero(TopMemoryContext,
+								   nparts * sizeof(BgSyncPartitionState));
+		for (int i = 0; i < nparts; i++)
+		{
+			states[i].smoothed_density = 10.0;
+			states[i].demand_boost = 1.0;
+		}
+	}
+
+	/* round up, so that each partition may write at least one page */
+	maxpages = (bgwriter_lru_maxpages + nparts - 1) / nparts;
+
+	for (int i = 0; i < nparts; i++)
+	{
+		if (!BgBufferSyncPartition(i, &states[i], maxpages, wb_context))
+			hibernate = false;
+	}
+
+	return hibernate;
+}
+
+/*
+ * SyncBufferRun -- write out a run of buffers during a checkpoint.
+ *
+ * items[] describes buffers that, according to the checkpoint sort, hold
+ * consecutive blocks of one relation fork.  The first buffer is always
+ * processed like SyncOneBuffer() would process it.  As many of the following
+ * ones as possible are then added to the same vectored write, stopping at
+ * the first buffer that no longer holds the expected block, no longer needs
+ * to be written for this checkpoint, or can't be locked or have I/O started
+ * on it without waiting.  Waiting while we hold locks and I/O on the earlier
+ * buffers of the run could deadlock against backends locking the same pages
+ * in a different order.
+ *
+ * Returns the number of items processed, which is at least 1, and sets
+ * *nwritten to the number of buffers that were written.
+ */
+static int
+SyncBufferRun(CkptSortItem *items, int nitems, WritebackContext *wb_context,
+			  int *nwritten)
+{
+	static char *bounce_buffers = NULL;
+	BufferDesc *bufs[MAX_IO_COMBINE_LIMIT];
+	const void *pages[MAX_IO_COMBINE_LIMIT];
+	BufferTag	tag;
+	RelFileLocator rlocator;
+	XLogRecPtr	max_lsn = InvalidXLogRecPtr;
+	bool		permanent = false;
+	ErrorContextCallback errcallback;
+	SMgrRelation reln = NULL;
+	instr_time	io_start;
+	int			nbufs = 0;
+
+	Assert(nitems >= 1 && nitems <= MAX_IO_COMBINE_LIMIT);
+
+	*nwritten = 0;
+	ClearBufferTag(&tag);		/* keep compiler quiet */
+
+	while (nbufs < nitems)
+	{
+		BufferDesc *bufHdr = GetBufferDescriptor(items[nbufs].buf_id);
+		LWLock	   *content_lock = BufferDescriptorGetContentLock(bufHdr);
+		uint32		buf_state;
+
+		/* Make sure we can handle the pin */
+		ReservePrivateRefCountEntry();
+		ResourceOwnerEnlarge(CurrentResourceOwner);
+
+		/*
+		 * Check whether the buffer needs writing; see SyncOneBuffer.  Buffers
+		 * after the first one must also still hold the next block of the run,
+		 * and still be part of this checkpoint.
+		 */
+		buf_state = LockBufHdr(bufHdr);
+		if (!(buf_state & BM_VALID) || !(buf_state & BM_DIRTY))
+		{
+			UnlockBufHdr(bufHdr);
+			break;
+		}
+		if (nbufs == 0)
+		{
+			tag = bufHdr->tag;
+			rlocator = BufTagGetRelFileLocator(&tag);
+		}
+		else if (!(buf_state & BM_CHECKPOINT_NEEDED) ||
+				 !BufTagMatchesRelFileLocator(&bufHdr->tag, &rlocator) ||
+				 BufTagGetForkNum(&bufHdr->tag) != BufTagGetForkNum(&tag) ||
+				 bufHdr->tag.blockNum != tag.blockNum + nbufs)
+		{
+			UnlockBufHdr(bufHdr);
+			break;
+		}
+
+		PinBuffer_Locked(bufHdr);
+
+		if (nbufs == 0)
+			LWLockAcquire(content_lock, LW_SHARED);
+		else if (!LWLockConditionalAcquire(content_lock, LW_SHARED))
+		{
+			UnpinBuffer(bufHdr);
+			break;
+		}
+
+		/*
+		 * If StartBufferIO returns false, then someone else flushed the
+		 * buffer before we could.
+		 */
+		if (!StartBufferIO(bufHdr, false, nbufs > 0))
+		{
+			LWLockRelease(content_lock);
+			UnpinBuffer(bufHdr);
+			break;
+		}
+
+		/*
+		 * Run PageGetLSN while holding header lock, since we don't have the
+		 * buffer locked exclusively in all cases.  As in FlushBuffer, clear
+		 * BM_JUST_DIRTIED to detect changes while we write.
+		 */
+		buf_state = LockBufHdr(bufHdr);
+		max_lsn = Max(max_lsn, BufferGetLSN(bufHdr));
+		if (buf_state & BM_PERMANENT)
+			permanent = true;
+		UnlockBufHdrExt(bufHdr, buf_state,
+						0, BM_JUST_DIRTIED,
+						0);
+
+		bufs[nbufs++] = bufHdr;
+
+		/* A single write can't cross a segment boundary */
+		if (nbufs == 1)
+		{
+			reln = smgropen(rlocator, INVALID_PROC_NUMBER);
+			nitems = Min(nitems,
+						 smgrmaxcombine(reln, BufTagGetForkNum(&tag),
+										tag.blockNum));
+		}
+	}
+
+	/* Nothing to write?  Then we've dealt with the first item only. */
+	if (nbufs == 0)
+		return 1;
+
+	/* Setup error traceback support for ereport() */
+	errcallback.callback = shared_buffer_write_error_callback;
+	errcallback.arg = bufs[0];
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	/*
+	 * Force XLOG flush up to the highest LSN of the run, for the reasons
+	 * explained in FlushBuffer.
+	 */
+	if (permanent)
+		XLogFlush(max_lsn);
+
+	/*
+	 * We hold only share locks, so hint bits might change while we write.  If
+	 * we need checksums, copy the pages to private storage first, like
+	 * PageSetChecksumCopy does for a single page.
+	 */
+	if (DataChecksumsEnabled() && bounce_buffers == NULL)
+		bounce_buffers = MemoryContextAllocAligned(TopMemoryContext,
+												   (Size) MAX_IO_COMBINE_LIMIT * BLCKSZ,
+												   PG_IO_ALIGN_SIZE,
+												   0);
+	for (int i = 0; i < nbufs; i++)
+	{
+		Page		page = (Page) BufHdrGetBlock(bufs[i]);
+
+		TRACE_POSTGRESQL_BUFFER_FLUSH_START(BufTagGetForkNum(&tag),
+											tag.blockNum + i,
+											reln->smgr_rlocator.locator.spcOid,
+											reln->smgr_rlocator.locator.dbOid,
+											reln->smgr_rlocator.locator.relNumber);
+
+		if (DataChecksumsEnabled())
+		{
+			char	   *copy = bounce_buffers + (Size) i * BLCKSZ;
+
+			memcpy(copy, page, BLCKSZ);
+			PageSetChecksumInplace((Page) copy, tag.blockNum + i);
+			pages[i] = copy;
+		}
+		else
+			pages[i] = page;
+	}
+
+	/* Protect the pages from being torn, if desired, with a single fsync */
+	if (double_write_buffer && permanent)
+		DoubleWritePages(rlocator, BufTagGetForkNum(&tag), tag.blockNum,
+						 pages, nbufs);
+
+	io_start = pgstat_prepare_io_time(track_io_timing);
+
+	smgrwritev(reln, BufTagGetForkNum(&tag), tag.blockNum, pages, nbufs,
+			   false);
+
+	/* Only checkpointer calls this, so IOContext is always IOCONTEXT_NORMAL */
+	pgstat_count_io_op_time(IOOBJECT_RELATION, IOCONTEXT_NORMAL,
+							IOOP_WRITE, io_start, nbufs, (uint64) nbufs * BLCKSZ);
+
+	pgBufferUsage.shared_blks_written += nbufs;
+
+	for (int i = 0; i < nbufs; i++)
+	{
+		BufferDesc *bufHdr = bufs[i];
+		BufferTag	buftag = bufHdr->tag;
+
+		/*
+		 * Mark the buffer as clean (unless BM_JUST_DIRTIED has become set) and
+		 * end the BM_IO_IN_PROGRESS state.
+		 */
+		TerminateBufferIO(bufHdr, true, 0, true, false);
+
+		TRACE_POSTGRESQL_BUFFER_FLUSH_DONE(BufTagGetForkNum(&buftag),
+										   buftag.blockNum,
+										   reln->smgr_rlocator.locator.spcOid,
+										   reln->smgr_rlocator.locator.dbOid,
+										   reln->smgr_rlocator.locator.relNumber);
+
+		LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
+		UnpinBuffer(bufHdr);
+
+		ScheduleBufferTagForWriteback(wb_context, IOCONTEXT_NORMAL, &buftag);
+		TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(bufHdr->buf_id);
+	}
+
+	/* Pop the error context stack */
+	error_context_stack = errcallback.previous;
+
+	*nwritten = nbufs;
+	return nbufs;
+}
+
 /*
  * SyncOneBuffer -- process a single buffer during syncing.
  *
@@ -4382,7 +4729,7 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln, IOObject io_object,
 	ErrorContextCallback errcallback;
 	instr_time	io_start;
 	Block		bufBlock;
-	char	   *bufToWrite;
+	const void *bufToWrite;
 	uint32		buf_state;
 
 	/*
@@ -4457,6 +4804,12 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln, IOObject io_object,
 	 */
 	bufToWrite = PageSetChecksumCopy((Page) bufBlock, buf->tag.blockNum);
 
+	/* Protect the page from being torn, if desired */
+	if (double_write_buffer && (buf_state & BM_PERMANENT))
+		DoubleWritePages(BufTagGetRelFileLocator(&buf->tag),
+						 BufTagGetForkNum(&buf->tag), buf->tag.blockNum,
+						 &bufToWrite, 1);
+
 	io_start = pgstat_prepare_io_time(track_io_timing);
 
 	/*
@@ -4531,6 +4884,14 @@ FlushUnlockedBuffer(BufferDesc *buf, SMgrRelation reln,
 BlockNumber
 RelationGetNumberOfBlocksInFork(Relation relation, ForkNumber forkNum)
 {
+	/*
+	 * A global temporary relation is empty until this session first uses it,
+	 * so that asking for its size, say while planning, doesn't create files.
+	 */
+	if (RelationIsGlobalTemp(relation) &&
+		!GlobalTempRelationHasStorage(relation))
+		return 0;
+
 	if (RELKIND_HAS_TABLE_AM(relation->rd_rel->relkind))
 	{
 		/*
@@ -5711,7 +6072,10 @@ LockBuffer(Buffer buffer, BufferLockMode mode)
 	else if (mode == BUFFER_LOCK_SHARE)
 		LWLockAcquire(BufferDescriptorGetContentLock(buf), LW_SHARED);
 	else if (mode == BUFFER_LOCK_EXCLUSIVE)
+	{
 		LWLockAcquire(BufferDescriptorGetContentLock(buf), LW_EXCLUSIVE);
+		pg_atomic_fetch_add_u32(&buf->content_seq, 1);
+	}
 	else
 		elog(ERROR, "unrecognized buffer lock mode: %d", mode);
 }
@@ -5732,8 +6096,55 @@ ConditionalLockBuffer(Buffer buffer)
 
 	buf = GetBufferDescriptor(buffer - 1);
 
-	return LWLockConditionalAcquire(BufferDescriptorGetContentLock(buf),
-									LW_EXCLUSIVE);
+	if (!LWLockConditionalAcquire(BufferDescriptorGetContentLock(buf),
+								  LW_EXCLUSIVE))
+		return false;
+	pg_atomic_fetch_add_u32(&buf->content_seq, 1);
+	return true;
+}
+
+/*
+ * Copy the contents of a pinned buffer without acquiring its content lock.
+ *
+ * The page is copied into 'dest', which must have room for BLCKSZ bytes.
+ * Returns false if the page might have been modified while we were copying
+ * it, in which case 'dest' holds garbage and the caller should lock the
+ * buffer the usual way instead.  A true result means that 'dest' is a
+ * consistent image of the page as it was at some point during the call.
+ *
+ * Only modifications made under an exclusive content lock are detected, so
+ * this must not be used for pages that are changed while holding just a
+ * share lock, such as by setting hint bits.  It is also pointless for local
+ * buffers, which are never locked, so those are refused.
+ */
+bool
+CopyBufferOptimistic(Buffer buffer, char *dest)
+{
+	BufferDesc *buf;
+	uint32		seq;
+
+	Assert(BufferIsPinned(buffer));
+	if (BufferIsLocal(buffer))
+		return false;
+
+	buf = GetBufferDescriptor(buffer - 1);
+
+	/*
+	 * Exclusive lockers increment content_seq after acquiring the lock and
+	 * before modifying the page.  So if the lock isn't held exclusively after
+	 * we've read the counter, and the counter is still the same after we've
+	 * copied the page, nobody can have modified it in between.
+	 */
+	seq = pg_atomic_read_u32(&buf->content_seq);
+	pg_read_barrier();
+	if (LWLockHeldExclusively(BufferDescriptorGetContentLock(buf)))
+		return false;
+	pg_read_barrier();
+	memcpy(dest, BufHdrGetBlock(buf), BLCKSZ);
+	INJECTION_POINT("copy-buffer-optimistic-before-recheck", NULL);
+	pg_read_barrier();
+
+	return pg_atomic_read_u32(&buf->content_seq) == seq;
 }
 
 /*
@@ -6925,6 +7336,7 @@ MarkDirtyUnpinnedBufferInternal(Buffer buf, BufferDesc *desc,
 	if (!(buf_state & BM_DIRTY))
 	{
 		LWLockAcquire(BufferDescriptorGetContentLock(desc), LW_EXCLUSIVE);
+		pg_atomic_fetch_add_u32(&desc->content_seq, 1);
 		MarkBufferDirty(buf);
 		result = true;
 		LWLockRelease(BufferDescriptorGetContentLock(desc));
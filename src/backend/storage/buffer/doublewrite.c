@@ -0,0 +1,395 @@
+/*-------------------------------------------------------------------------
+ *
+ * doublewrite.c
+ *	  Double-write buffer for protection against torn data pages.
+ *
+ * If the operating system crashes while a data page is being written, the
+ * page might be left half old and half new on disk.  WAL replay cannot fix
+ * such a torn page unless the WAL contains a full image of it, which is what
+ * full_page_writes arranges for.  As an alternative, with double_write_buffer
+ * enabled, every write of a permanent relation's buffer first writes the
+ * page images to a private file of the writing process in pg_dblwr and
+ * fsyncs it, and only then writes them in place.  A page that is torn in
+ * place therefore has an intact copy in pg_dblwr, and DoubleWriteRecover()
+ * puts it back before WAL replay begins.
+ *
+ * Each file is a ring of DOUBLE_WRITE_SLOTS slots.  It starts with an array
+ * of slot headers, each identifying the page, carrying a CRC of itself and
+ * the page image, and recording the WAL position when the slot was written.
+ * The page images follow.  A batch of consecutive blocks, as written by the
+ * checkpointer, occupies consecutive slots and costs a single fsync.
+ *
+ * A slot is needed until the in-place write it protects has reached durable
+ * storage.  That is guaranteed once a checkpoint whose redo pointer is past
+ * the slot's WAL position has completed: the buffer was still dirty while
+ * the slot was being written, so the checkpoint either found the in-place
+ * write already done or waited for it, and synced it.  Recovery therefore
+ * only restores slots that are not older than its starting redo pointer,
+ * and a process recycles its ring without further ado if all slots are
+ * older than the last completed checkpoint.  Otherwise, it syncs the data
+ * files of the pages in the ring itself before reusing it.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/buffer/doublewrite.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "access/xlog.h"
+#include "access/xlog_internal.h"
+#include "access/xlogrecovery.h"
+#include "port/pg_crc32c.h"
+#include "storage/bufmgr.h"
+#include "storage/bufpage.h"
+#include "storage/doublewrite.h"
+#include "storage/fd.h"
+#include "storage/proc.h"
+#include "storage/smgr.h"
+#include "utils/memutils.h"
+#include "utils/wait_event.h"
+
+#define DOUBLE_WRITE_MAGIC		0xD0B1E001
+
+/* Number of slots in each process's file */
+#define DOUBLE_WRITE_SLOTS		(2 * MAX_IO_COMBINE_LIMIT)
+
+typedef struct DoubleWriteSlotHeader
+{
+	uint32		magic;
+	pg_crc32c	crc;			/* CRC of the rest of the header, and page */
+	XLogRecPtr	lsn;			/* WAL position when the slot was written */
+	RelFileLocator rlocator;
+	ForkNumber	forknum;
+	BlockNumber blkno;
+} DoubleWriteSlotHeader;
+
+/* Size of the header array at the start of each file */
+#define DOUBLE_WRITE_HEADER_SIZE \
+	TYPEALIGN(BLCKSZ, DOUBLE_WRITE_SLOTS * sizeof(DoubleWriteSlotHeader))
+
+#define DoubleWritePageOffset(slot) \
+	(DOUBLE_WRITE_HEADER_SIZE + (pgoff_t) (slot) * BLCKSZ)
+
+/* GUC parameter */
+bool		double_write_buffer = false;
+
+/* Our file, and an image of its slot headers */
+static File dwFile = -1;
+static DoubleWriteSlotHeader *dwHeaders = NULL;
+static int	dwNextSlot;
+
+/* Copies of the pages being written */
+static char *dwPages = NULL;
+
+static void DoubleWriteOpen(void);
+static void DoubleWriteRecycle(void);
+static pg_crc32c DoubleWriteChecksum(const DoubleWriteSlotHeader *hdr,
+									 const char *page);
+static void DoubleWriteFileWrite(const void *buf, size_t len, pgoff_t offset,
+								 const char *path);
+
+/*
+ * Open our double-write file.
+ */
+static void
+DoubleWriteOpen(void)
+{
+	char		path[MAXPGPATH];
+	ssize_t		nread;
+
+	snprintf(path, sizeof(path), "%s/%d", PG_DBLWR_DIR, MyProcNumber);
+
+	if (dwHeaders == NULL)
+	{
+		dwHeaders = MemoryContextAllocZero(TopMemoryContext,
+										   DOUBLE_WRITE_HEADER_SIZE);
+		dwPages = MemoryContextAllocAligned(TopMemoryContext,
+											(Size) MAX_IO_COMBINE_LIMIT * BLCKSZ,
+											PG_IO_ALIGN_SIZE, 0);
+	}
+
+	dwFile = PathNameOpenFile(path, O_RDWR | O_CREAT | PG_BINARY);
+	if (dwFile < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", path)));
+
+	/*
+	 * A process that had our ProcNumber before may have left slots behind
+	 * that are still needed.  Read their headers, and process them like our
+	 * own before overwriting any of them.
+	 */
+	nread = FileRead(dwFile, dwHeaders, DOUBLE_WRITE_HEADER_SIZE, 0,
+					 WAIT_EVENT_DOUBLE_WRITE_READ);
+	if (nread < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m", path)));
+	if (nread < DOUBLE_WRITE_HEADER_SIZE)
+		memset((char *) dwHeaders + nread, 0, DOUBLE_WRITE_HEADER_SIZE - nread);
+
+	dwNextSlot = DOUBLE_WRITE_SLOTS;
+}
+
+/*
+ * Prepare for overwriting the slots of our ring from the beginning.
+ *
+ * The in-place writes protected by the slots must be durable first.  That's
+ * already the case if a checkpoint has completed since they were written;
+ * otherwise sync the data files they went to.
+ */
+static void
+DoubleWriteRecycle(void)
+{
+	XLogRecPtr	redo;
+	TimeLineID	tli;
+	DoubleWriteSlotHeader *tosync[DOUBLE_WRITE_SLOTS];
+	int			nsync = 0;
+
+	GetOldestRestartPoint(&redo, &tli);
+
+	for (int i = 0; i < DOUBLE_WRITE_SLOTS; i++)
+	{
+		DoubleWriteSlotHeader *hdr = &dwHeaders[i];
+		int			j;
+
+		if (hdr->magic != DOUBLE_WRITE_MAGIC || hdr->lsn < redo)
+			continue;
+
+		for (j = 0; j < nsync; j++)
+		{
+			if (RelFileLocatorEquals(tosync[j]->rlocator, hdr->rlocator) &&
+				tosync[j]->forknum == hdr->forknum)
+				break;
+		}
+		if (j == nsync)
+			tosync[nsync++] = hdr;
+	}
+
+	for (int i = 0; i < nsync; i++)
+	{
+		SMgrRelation reln = smgropen(tosync[i]->rlocator, INVALID_PROC_NUMBER);
+
+		if (smgrexists(reln, tosync[i]->forknum))
+			smgrimmedsync(reln, tosync[i]->forknum);
+	}
+
+	dwNextSlot = 0;
+}
+
+static pg_crc32c
+DoubleWriteChecksum(const DoubleWriteSlotHeader *hdr, const char *page)
+{
+	pg_crc32c	crc;
+
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc, &hdr->lsn,
+				sizeof(DoubleWriteSlotHeader) - offsetof(DoubleWriteSlotHeader, lsn));
+	COMP_CRC32C(crc, page, BLCKSZ);
+	FIN_CRC32C(crc);
+
+	return crc;
+}
+
+static void
+DoubleWriteFileWrite(const void *buf, size_t len, pgoff_t offset,
+					 const char *path)
+{
+	while (len > 0)
+	{
+		ssize_t		nwritten;
+
+		nwritten = FileWrite(dwFile, buf, len, offset,
+							 WAIT_EVENT_DOUBLE_WRITE_WRITE);
+		if (nwritten < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not write to file \"%s\": %m", path)));
+		if (nwritten == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_DISK_FULL),
+					 errmsg("could not write to file \"%s\": wrote only %zu of %zu bytes",
+							path, (size_t) nwritten, len),
+					 errhint("Check free disk space.")));
+
+		buf = (const char *) buf + nwritten;
+		len -= nwritten;
+		offset += nwritten;
+	}
+}
+
+/*
+ * Durably write copies of 'npages' consecutive blocks of a relation fork,
+ * starting at 'blocknum', to our double-write file.  The caller must then
+ * write them in place before writing any other pages.
+ *
+ * The page pointers are replaced with pointers to the copies, which stay
+ * valid until the next call.  Writing the copies in place makes sure that
+ * what's written there is exactly what's in the double-write file, even if
+ * hint bits are being set concurrently.
+ */
+void
+DoubleWritePages(RelFileLocator rlocator, ForkNumber forknum,
+				 BlockNumber blocknum, const void **pages, int npages)
+{
+	char		path[MAXPGPATH];
+	XLogRecPtr	lsn;
+
+	Assert(npages > 0 && npages <= MAX_IO_COMBINE_LIMIT);
+
+	if (dwFile < 0)
+		DoubleWriteOpen();
+	if (dwNextSlot + npages > DOUBLE_WRITE_SLOTS)
+		DoubleWriteRecycle();
+
+	lsn = RecoveryInProgress() ? GetXLogReplayRecPtr(NULL) : GetXLogInsertRecPtr();
+
+	for (int i = 0; i < npages; i++)
+	{
+		DoubleWriteSlotHeader *hdr = &dwHeaders[dwNextSlot + i];
+		char	   *copy = dwPages + (Size) i * BLCKSZ;
+
+		memcpy(copy, pages[i], BLCKSZ);
+
+		memset(hdr, 0, sizeof(DoubleWriteSlotHeader));
+		hdr->magic = DOUBLE_WRITE_MAGIC;
+		hdr->lsn = lsn;
+		hdr->rlocator = rlocator;
+		hdr->forknum = forknum;
+		hdr->blkno = blocknum + i;
+		hdr->crc = DoubleWriteChecksum(hdr, copy);
+
+		pages[i] = copy;
+	}
+
+	snprintf(path, sizeof(path), "%s/%d", PG_DBLWR_DIR, MyProcNumber);
+
+	DoubleWriteFileWrite(dwPages, (size_t) npages * BLCKSZ,
+						 DoubleWritePageOffset(dwNextSlot), path);
+	DoubleWriteFileWrite(&dwHeaders[dwNextSlot],
+						 npages * sizeof(DoubleWriteSlotHeader),
+						 dwNextSlot * sizeof(DoubleWriteSlotHeader), path);
+
+	if (FileSync(dwFile, WAIT_EVENT_DOUBLE_WRITE_SYNC) < 0)
+		ereport(data_sync_elevel(ERROR),
+				(errcode_for_file_access(),
+				 errmsg("could not fsync file \"%s\": %m", path)));
+
+	dwNextSlot += npages;
+}
+
+/*
+ * Restore pages from the double-write files before replaying WAL from
+ * 'redo'.
+ *
+ * A slot is restored if it is valid, was written after 'redo', and the page
+ * in place is not verifiably newer.  The files are removed afterwards, since
+ * all the pages that could need them have been put back and synced.
+ */
+void
+DoubleWriteRecover(XLogRecPtr redo)
+{
+	DIR		   *dir;
+	struct dirent *de;
+	DoubleWriteSlotHeader *headers;
+	char	   *page;
+	char	   *cur;
+	int			nrestored = 0;
+
+	headers = palloc(DOUBLE_WRITE_HEADER_SIZE);
+	page = palloc_aligned(BLCKSZ, PG_IO_ALIGN_SIZE, 0);
+	cur = palloc_aligned(BLCKSZ, PG_IO_ALIGN_SIZE, 0);
+
+	dir = AllocateDir(PG_DBLWR_DIR);
+	while ((de = ReadDir(dir, PG_DBLWR_DIR)) != NULL)
+	{
+		char		path[MAXPGPATH];
+		int			fd;
+		ssize_t		nread;
+
+		if (strspn(de->d_name, "0123456789") != strlen(de->d_name))
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%s", PG_DBLWR_DIR, de->d_name);
+		fd = OpenTransientFile(path, O_RDONLY | PG_BINARY);
+		if (fd < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\": %m", path)));
+
+		pgstat_report_wait_start(WAIT_EVENT_DOUBLE_WRITE_READ);
+		nread = pg_pread(fd, headers, DOUBLE_WRITE_HEADER_SIZE, 0);
+		pgstat_report_wait_end();
+		if (nread < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m", path)));
+
+		for (int i = 0; i < nread / (ssize_t) sizeof(DoubleWriteSlotHeader) &&
+			 i < DOUBLE_WRITE_SLOTS; i++)
+		{
+			DoubleWriteSlotHeader *hdr = &headers[i];
+			SMgrRelation reln;
+
+			if (hdr->magic != DOUBLE_WRITE_MAGIC || hdr->lsn < redo)
+				continue;
+
+			pgstat_report_wait_start(WAIT_EVENT_DOUBLE_WRITE_READ);
+			nread = pg_pread(fd, page, BLCKSZ, DoubleWritePageOffset(i));
+			pgstat_report_wait_end();
+			if (nread != BLCKSZ)
+				continue;
+
+			/* A torn slot means that the in-place write never started */
+			if (!EQ_CRC32C(hdr->crc, DoubleWriteChecksum(hdr, page)))
+				continue;
+
+			reln = smgropen(hdr->rlocator, INVALID_PROC_NUMBER);
+			if (!smgrexists(reln, hdr->forknum) ||
+				hdr->blkno >= smgrnblocks(reln, hdr->forknum))
+				continue;
+
+			smgrread(reln, hdr->forknum, hdr->blkno, cur);
+			if (memcmp(cur, page, BLCKSZ) == 0)
+				continue;
+			if (PageGetLSN((Page) cur) > PageGetLSN((Page) page) &&
+				PageIsVerified((Page) cur, hdr->blkno, 0, NULL))
+				continue;
+
+			smgrwrite(reln, hdr->forknum, hdr->blkno, page, true);
+			smgrimmedsync(reln, hdr->forknum);
+			nrestored++;
+		}
+
+		if (CloseTransientFile(fd) != 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not close file \"%s\": %m", path)));
+
+		if (unlink(path) < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not remove file \"%s\": %m", path)));
+	}
+	FreeDir(dir);
+
+	fsync_fname(PG_DBLWR_DIR, true);
+
+	if (nrestored > 0)
+		ereport(LOG,
+				(errmsg_plural("restored %d page from the double-write buffer",
+							   "restored %d pages from the double-write buffer",
+							   nrestored, nrestored)));
+
+	pfree(headers);
+	pfree(page);
+	pfree(cur);
+}
@@ -17,25 +17,38 @@
 
 #include "pgstat.h"
 #include "port/atomics.h"
+#include "port/pg_numa.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
 #include "storage/proc.h"
 
 #define INT_ACCESS_ONCE(var)	((int)(*((volatile int *)&(var))))
 
+/* GUC variable: number of clock-sweep partitions, -1 means one per NUMA node */
+int			clock_sweep_partitions = -1;
 
 /*
- * The shared freelist control information.
+ * State of one clock-sweep partition.
+ *
+ * The buffer pool is divided into contiguous ranges of buffers, each swept
+ * by its own clock hand.  Backends normally only advance the hand of their
+ * "home" partition, so that on machines with many cores they don't all
+ * contend on a single atomic variable.
  */
-typedef struct
+typedef struct ClockSweepPartition
 {
-	/* Spinlock: protects the values below */
-	slock_t		buffer_strategy_lock;
+	/* Spinlock: protects completePasses, see ClockSweepTick() */
+	slock_t		lock;
+
+	/* Range of buffers covered by this partition */
+	int			firstBuffer;
+	int			numBuffers;
 
 	/*
-	 * clock-sweep hand: index of next buffer to consider grabbing. Note that
-	 * this isn't a concrete buffer - we only ever increase the value. So, to
-	 * get an actual buffer, it needs to be used modulo NBuffers.
+	 * clock-sweep hand: index of next buffer to consider grabbing, relative
+	 * to firstBuffer. Note that this isn't a concrete buffer - we only ever
+	 * increase the value. So, to get an actual buffer, it needs to be used
+	 * modulo numBuffers.
 	 */
 	pg_atomic_uint32 nextVictimBuffer;
 
@@ -45,16 +58,41 @@ typedef struct
 	 */
 	uint32		completePasses; /* Complete cycles of the clock-sweep */
 	pg_atomic_uint32 numBufferAllocs;	/* Buffers allocated since last reset */
+	pg_atomic_uint32 numDirtyAllocs;	/* Of those, how many were dirty */
+	pg_atomic_uint64 numTotalAllocs;	/* Buffers allocated since startup */
+} ClockSweepPartition;
+
+/* Pad each partition to a cache line, to avoid false sharing */
+typedef union ClockSweepPartitionPadded
+{
+	ClockSweepPartition part;
+	char		pad[PG_CACHE_LINE_SIZE];
+} ClockSweepPartitionPadded;
+
+StaticAssertDecl(sizeof(ClockSweepPartition) <= PG_CACHE_LINE_SIZE,
+				 "ClockSweepPartition must fit in a cache line");
+
+/*
+ * The shared freelist control information.
+ */
+typedef struct
+{
+	/* Spinlock: protects the values below */
+	slock_t		buffer_strategy_lock;
 
 	/*
 	 * Bgworker process to be notified upon activity or -1 if none. See
 	 * StrategyNotifyBgWriter.
 	 */
 	int			bgwprocno;
+
+	/* Number of entries in ClockSweepPartitions, fixed at startup */
+	int			numPartitions;
 } BufferStrategyControl;
 
 /* Pointers to shared state */
 static BufferStrategyControl *StrategyControl = NULL;
+static ClockSweepPartitionPadded *ClockSweepPartitions = NULL;
 
 /*
  * Private (non-shared) state for managing a ring of shared buffers to re-use.
@@ -83,7 +121,6 @@ typedef struct BufferAccessStrategyData
 	Buffer		buffers[FLEXIBLE_ARRAY_MEMBER];
 }			BufferAccessStrategyData;
 
-
 /* Prototypes for internal functions */
 static BufferDesc *GetBufferFromRing(BufferAccessStrategy strategy,
 									 uint32 *buf_state);
@@ -93,11 +130,11 @@ static void AddBufferToRing(BufferAccessStrategy strategy,
 /*
  * ClockSweepTick - Helper routine for StrategyGetBuffer()
  *
- * Move the clock hand one buffer ahead of its current position and return the
- * id of the buffer now under the hand.
+ * Move the clock hand of the given partition one buffer ahead of its current
+ * position and return the id of the buffer now under the hand.
  */
 static inline uint32
-ClockSweepTick(void)
+ClockSweepTick(ClockSweepPartition *part)
 {
 	uint32		victim;
 
@@ -107,14 +144,14 @@ ClockSweepTick(void)
 	 * apparent order.
 	 */
 	victim =
-		pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, 1);
+		pg_atomic_fetch_add_u32(&part->nextVictimBuffer, 1);
 
-	if (victim >= NBuffers)
+	if (victim >= part->numBuffers)
 	{
 		uint32		originalVictim = victim;
 
 		/* always wrap what we look up in BufferDescriptors */
-		victim = victim % NBuffers;
+		victim = victim % part->numBuffers;
 
 		/*
 		 * If we're the one that just caused a wraparound, force
@@ -140,19 +177,104 @@ ClockSweepTick(void)
 				 * could lead to an overflow of nextVictimBuffers, but that's
 				 * highly unlikely and wouldn't be particularly harmful.
 				 */
-				SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
+				SpinLockAcquire(&part->lock);
 
-				wrapped = expected % NBuffers;
+				wrapped = expected % part->numBuffers;
 
-				success = pg_atomic_compare_exchange_u32(&StrategyControl->nextVictimBuffer,
+				success = pg_atomic_compare_exchange_u32(&part->nextVictimBuffer,
 														 &expected, wrapped);
 				if (success)
-					StrategyControl->completePasses++;
-				SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+					part->completePasses++;
+				SpinLockRelease(&part->lock);
+			}
+		}
+	}
+	return part->firstBuffer + victim;
+}
+
+/*
+ * ClockSweepGetBuffer - Helper routine for StrategyGetBuffer()
+ *
+ * Run the clock sweep over one partition until an unpinned buffer with zero
+ * usage count is found.  The buffer is returned pinned, but not yet tracked
+ * by TrackNewBufferPin().  Returns NULL if every buffer in the partition is
+ * pinned.
+ */
+static BufferDesc *
+ClockSweepGetBuffer(ClockSweepPartition *part, uint32 *buf_state)
+{
+	int			trycounter = part->numBuffers;
+
+	for (;;)
+	{
+		BufferDesc *buf;
+		uint32		old_buf_state;
+		uint32		local_buf_state;
+
+		buf = GetBufferDescriptor(ClockSweepTick(part));
+
+		/*
+		 * Check whether the buffer can be used and pin it if so. Do this
+		 * using a CAS loop, to avoid having to lock the buffer header.
+		 */
+		old_buf_state = pg_atomic_read_u32(&buf->state);
+		for (;;)
+		{
+			local_buf_state = old_buf_state;
+
+			/*
+			 * If the buffer is pinned or has a nonzero usage_count, we cannot
+			 * use it; decrement the usage_count (unless pinned) and keep
+			 * scanning.
+			 */
+
+			if (BUF_STATE_GET_REFCOUNT(local_buf_state) != 0)
+			{
+				if (--trycounter == 0)
+				{
+					/*
+					 * We've scanned all the buffers of this partition without
+					 * making any state changes, so they are all pinned (or
+					 * were when we looked at them).  Let the caller decide
+					 * what to do about it.
+					 */
+					return NULL;
+				}
+				break;
+			}
+
+			/* See equivalent code in PinBuffer() */
+			if (unlikely(local_buf_state & BM_LOCKED))
+			{
+				old_buf_state = WaitBufHdrUnlocked(buf);
+				continue;
+			}
+
+			if (BUF_STATE_GET_USAGECOUNT(local_buf_state) != 0)
+			{
+				local_buf_state -= BUF_USAGECOUNT_ONE;
+
+				if (pg_atomic_compare_exchange_u32(&buf->state, &old_buf_state,
+												   local_buf_state))
+				{
+					trycounter = part->numBuffers;
+					break;
+				}
+			}
+			else
+			{
+				/* pin the buffer if the CAS succeeds */
+				local_buf_state += BUF_REFCOUNT_ONE;
+
+				if (pg_atomic_compare_exchange_u32(&buf->state, &old_buf_state,
+												   local_buf_state))
+				{
+					*buf_state = local_buf_state;
+					return buf;
+				}
 			}
 		}
 	}
-	return victim;
 }
 
 /*
@@ -175,7 +297,8 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state, bool *from_r
 {
 	BufferDesc *buf;
 	int			bgwprocno;
-	int			trycounter;
+	int			nparts;
+	int			home;
 
 	*from_ring = false;
 
@@ -220,132 +343,152 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state, bool *from_r
 	}
 
 	/*
-	 * We count buffer allocation requests so that the bgwriter can estimate
-	 * the rate of buffer consumption.  Note that buffers recycled by a
-	 * strategy object are intentionally not counted here.
+	 * Use the "clock sweep" algorithm to find a free buffer, starting with
+	 * our home partition.  Backends are spread over the partitions by their
+	 * proc number, which keeps the pressure on the partitions roughly even.
+	 * Only if every buffer in the home partition is pinned do we move on to
+	 * the others.
 	 */
-	pg_atomic_fetch_add_u32(&StrategyControl->numBufferAllocs, 1);
+	nparts = StrategyControl->numPartitions;
+	home = (MyProcNumber == INVALID_PROC_NUMBER) ? 0 : MyProcNumber % nparts;
 
-	/* Use the "clock sweep" algorithm to find a free buffer */
-	trycounter = NBuffers;
-	for (;;)
+	for (int i = 0; i < nparts; i++)
 	{
-		uint32		old_buf_state;
-		uint32		local_buf_state;
+		ClockSweepPartition *part = &ClockSweepPartitions[(home + i) % nparts].part;
 
-		buf = GetBufferDescriptor(ClockSweepTick());
+		buf = ClockSweepGetBuffer(part, buf_state);
+		if (buf == NULL)
+			continue;
 
 		/*
-		 * Check whether the buffer can be used and pin it if so. Do this
-		 * using a CAS loop, to avoid having to lock the buffer header.
+		 * We count buffer allocation requests so that the bgwriter can
+		 * estimate the rate of buffer consumption in each partition.  Note
+		 * that buffers recycled by a strategy object are intentionally not
+		 * counted here.  Victims that are still dirty, which the backend
+		 * will have to write out itself, tell the bgwriter it's lagging.
 		 */
-		old_buf_state = pg_atomic_read_u32(&buf->state);
-		for (;;)
-		{
-			local_buf_state = old_buf_state;
+		pg_atomic_fetch_add_u32(&part->numBufferAllocs, 1);
+		pg_atomic_fetch_add_u64(&part->numTotalAllocs, 1);
+		if (*buf_state & BM_DIRTY)
+			pg_atomic_fetch_add_u32(&part->numDirtyAllocs, 1);
 
-			/*
-			 * If the buffer is pinned or has a nonzero usage_count, we cannot
-			 * use it; decrement the usage_count (unless pinned) and keep
-			 * scanning.
-			 */
-
-			if (BUF_STATE_GET_REFCOUNT(local_buf_state) != 0)
-			{
-				if (--trycounter == 0)
-				{
-					/*
-					 * We've scanned all the buffers without making any state
-					 * changes, so all the buffers are pinned (or were when we
-					 * looked at them). We could hope that someone will free
-					 * one eventually, but it's probably better to fail than
-					 * to risk getting stuck in an infinite loop.
-					 */
-					elog(ERROR, "no unpinned buffers available");
-				}
-				break;
-			}
-
-			/* See equivalent code in PinBuffer() */
-			if (unlikely(local_buf_state & BM_LOCKED))
-			{
-				old_buf_state = WaitBufHdrUnlocked(buf);
-				continue;
-			}
+		/* Found a usable buffer */
+		if (strategy != NULL)
+			AddBufferToRing(strategy, buf);
 
-			if (BUF_STATE_GET_USAGECOUNT(local_buf_state) != 0)
-			{
-				local_buf_state -= BUF_USAGECOUNT_ONE;
+		TrackNewBufferPin(BufferDescriptorGetBuffer(buf));
 
-				if (pg_atomic_compare_exchange_u32(&buf->state, &old_buf_state,
-												   local_buf_state))
-				{
-					trycounter = NBuffers;
-					break;
-				}
-			}
-			else
-			{
-				/* pin the buffer if the CAS succeeds */
-				local_buf_state += BUF_REFCOUNT_ONE;
-
-				if (pg_atomic_compare_exchange_u32(&buf->state, &old_buf_state,
-												   local_buf_state))
-				{
-					/* Found a usable buffer */
-					if (strategy != NULL)
-						AddBufferToRing(strategy, buf);
-					*buf_state = local_buf_state;
-
-					TrackNewBufferPin(BufferDescriptorGetBuffer(buf));
-
-					return buf;
-				}
-			}
-		}
+		return buf;
 	}
+
+	/*
+	 * We've scanned all the buffers without making any state changes, so all
+	 * the buffers are pinned (or were when we looked at them). We could hope
+	 * that someone will free one eventually, but it's probably better to fail
+	 * than to risk getting stuck in an infinite loop.
+	 */
+	elog(ERROR, "no unpinned buffers available");
+	return NULL;				/* keep compiler quiet */
 }
 
 /*
  * StrategySyncStart -- tell BgBufferSync where to start syncing
  *
- * The result is the buffer index of the best buffer to sync first.
- * BgBufferSync() will proceed circularly around the buffer array from there.
+ * The result is the buffer index of the best buffer to sync first within the
+ * given clock-sweep partition.  BgBufferSync() will proceed circularly around
+ * the partition's range of buffers from there.
  *
  * In addition, we return the completed-pass count (which is effectively
- * the higher-order bits of nextVictimBuffer) and the count of recent buffer
- * allocs if non-NULL pointers are passed.  The alloc count is reset after
- * being read.
+ * the higher-order bits of nextVictimBuffer), the count of recent buffer
+ * allocs and the count of those that found their victim dirty if non-NULL
+ * pointers are passed.  The alloc counts are reset after being read.
  */
 int
-StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc)
+StrategySyncStart(int partition, uint32 *complete_passes, uint32 *num_buf_alloc,
+				  uint32 *num_dirty_alloc)
 {
+	ClockSweepPartition *part;
 	uint32		nextVictimBuffer;
 	int			result;
 
-	SpinLockAcquire(&StrategyControl->buffer_strategy_lock);
-	nextVictimBuffer = pg_atomic_read_u32(&StrategyControl->nextVictimBuffer);
-	result = nextVictimBuffer % NBuffers;
+	Assert(partition >= 0 && partition < StrategyControl->numPartitions);
+	part = &ClockSweepPartitions[partition].part;
+
+	SpinLockAcquire(&part->lock);
+	nextVictimBuffer = pg_atomic_read_u32(&part->nextVictimBuffer);
+	result = part->firstBuffer + nextVictimBuffer % part->numBuffers;
 
 	if (complete_passes)
 	{
-		*complete_passes = StrategyControl->completePasses;
+		*complete_passes = part->completePasses;
 
 		/*
 		 * Additionally add the number of wraparounds that happened before
 		 * completePasses could be incremented. C.f. ClockSweepTick().
 		 */
-		*complete_passes += nextVictimBuffer / NBuffers;
+		*complete_passes += nextVictimBuffer / part->numBuffers;
 	}
 
 	if (num_buf_alloc)
 	{
-		*num_buf_alloc = pg_atomic_exchange_u32(&StrategyControl->numBufferAllocs, 0);
+		*num_buf_alloc = pg_atomic_exchange_u32(&part->numBufferAllocs, 0);
 	}
-	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
+
+	if (num_dirty_alloc)
+	{
+		*num_dirty_alloc = pg_atomic_exchange_u32(&part->numDirtyAllocs, 0);
+	}
+	SpinLockRelease(&part->lock);
 	return result;
 }
 
+/*
+ * StrategyNumPartitions -- number of clock-sweep partitions
+ */
+int
+StrategyNumPartitions(void)
+{
+	return StrategyControl->numPartitions;
+}
+
+/*
+ * StrategyPartitionInfo -- report the layout and activity of a partition
+ *
+ * Returns the range of buffers covered by the given clock-sweep partition,
+ * the number of complete passes its clock hand has made and the number of
+ * buffers allocated from it since startup.  NULL pointers may be passed for
+ * values that aren't needed.  Unlike StrategySyncStart(), this doesn't reset
+ * any counters, so it can be used for monitoring.
+ */
+void
+StrategyPartitionInfo(int partition, int *first_buffer, int *num_buffers,
+					  uint32 *complete_passes, uint64 *num_allocs)
+{
+	ClockSweepPartition *part;
+
+	Assert(partition >= 0 && partition < StrategyControl->numPartitions);
+	part = &ClockSweepPartitions[partition].part;
+
+	if (first_buffer)
+		*first_buffer = part->firstBuffer;
+	if (num_buffers)
+		*num_buffers = part->numBuffers;
+
+	if (complete_passes)
+	{
+		uint32		nextVictimBuffer;
+
+		SpinLockAcquire(&part->lock);
+		nextVictimBuffer = pg_atomic_read_u32(&part->nextVictimBuffer);
+		*complete_passes = part->completePasses +
+			nextVictimBuffer / part->numBuffers;
+		SpinLockRelease(&part->lock);
+	}
+
+	if (num_allocs)
+		*num_allocs = pg_atomic_read_u64(&part->numTotalAllocs);
+}
+
 /*
  * StrategyNotifyBgWriter -- set or clear allocation notification latch
  *
@@ -368,6 +511,31 @@ StrategyNotifyBgWriter(int bgwprocno)
 }
 
 
+/*
+ * ClockSweepNumPartitions -- decide how many clock-sweep partitions to use
+ *
+ * With the default setting of -1 we use one partition per NUMA node, or a
+ * single partition if NUMA support isn't available.  Only meaningful while
+ * the shared memory is being sized and created; everybody else must look at
+ * StrategyControl->numPartitions.
+ */
+static int
+ClockSweepNumPartitions(void)
+{
+	int			nparts = clock_sweep_partitions;
+
+	if (nparts < 0)
+	{
+		if (pg_numa_init() != -1)
+			nparts = pg_numa_get_max_node() + 1;
+		else
+			nparts = 1;
+	}
+
+	/* every partition needs at least one buffer */
+	return Max(1, Min(nparts, NBuffers));
+}
+
 /*
  * StrategyShmemSize
  *
@@ -387,6 +555,10 @@ StrategyShmemSize(void)
 	/* size of the shared replacement strategy control block */
 	size = add_size(size, MAXALIGN(sizeof(BufferStrategyControl)));
 
+	/* size of the clock-sweep partitions */
+	size = add_size(size, mul_size(ClockSweepNumPartitions(),
+								   sizeof(ClockSweepPartitionPadded)));
+
 	return size;
 }
 
@@ -401,6 +573,7 @@ void
 StrategyInitialize(bool init)
 {
 	bool		found;
+	int			nparts;
 
 	/*
 	 * Initialize the shared buffer lookup hashtable.
@@ -431,18 +604,51 @@ StrategyInitialize(bool init)
 
 		SpinLockInit(&StrategyControl->buffer_strategy_lock);
 
-		/* Initialize the clock-sweep pointer */
-		pg_atomic_init_u32(&StrategyControl->nextVictimBuffer, 0);
-
-		/* Clear statistics */
-		StrategyControl->completePasses = 0;
-		pg_atomic_init_u32(&StrategyControl->numBufferAllocs, 0);
-
 		/* No pending notification */
 		StrategyControl->bgwprocno = -1;
+
+		StrategyControl->numPartitions = ClockSweepNumPartitions();
 	}
 	else
 		Assert(!init);
+
+	nparts = StrategyControl->numPartitions;
+
+	/* Shared memory structs are cache line aligned, as is each partition */
+	ClockSweepPartitions = (ClockSweepPartitionPadded *)
+		ShmemInitStruct("Buffer Strategy Partitions",
+						mul_size(nparts, sizeof(ClockSweepPartitionPadded)),
+						&found);
+
+	if (!found)
+	{
+		/*
+		 * Split the buffers into contiguous ranges of (almost) equal size.
+		 * The first NBuffers % nparts partitions get one extra buffer.
+		 */
+		int			first = 0;
+
+		for (int i = 0; i < nparts; i++)
+		{
+			ClockSweepPartition *part = &ClockSweepPartitions[i].part;
+
+			SpinLockInit(&part->lock);
+
+			part->firstBuffer = first;
+			part->numBuffers = NBuffers / nparts + (i < NBuffers % nparts ? 1 : 0);
+			first += part->numBuffers;
+
+			/* Initialize the clock-sweep pointer */
+			pg_atomic_init_u32(&part->nextVictimBuffer, 0);
+
+			/* Clear statistics */
+			part->completePasses = 0;
+			pg_atomic_init_u32(&part->numBufferAllocs, 0);
+			pg_atomic_init_u32(&part->numDirtyAllocs, 0);
+			pg_atomic_init_u64(&part->numTotalAllocs, 0);
+		}
+		Assert(first == NBuffers);
+	}
 }
 
 
@@ -59,6 +59,8 @@ static int	NLocalPinnedBuffers = 0;
 static void InitLocalBuffers(void);
 static Block GetLocalBufferStorage(void);
 static Buffer GetLocalVictimBuffer(void);
+static void FlushLocalBufferRun(BufferDesc *bufHdr);
+static void WriteLocalBuffers(BufferDesc **bufs, int nbufs, SMgrRelation reln);
 
 
 /*
@@ -182,9 +184,6 @@ LocalBufferAlloc(SMgrRelation smgr, ForkNumber forkNum, BlockNumber blockNum,
 void
 FlushLocalBuffer(BufferDesc *bufHdr, SMgrRelation reln)
 {
-	instr_time	io_start;
-	Page		localpage = (char *) LocalBufHdrGetBlock(bufHdr);
-
 	Assert(LocalRefCount[-BufferDescriptorGetBuffer(bufHdr) - 1] > 0);
 
 	/*
@@ -194,30 +193,107 @@ FlushLocalBuffer(BufferDesc *bufHdr, SMgrRelation reln)
 	if (!StartLocalBufferIO(bufHdr, false, false))
 		elog(ERROR, "failed to start write IO on local buffer");
 
+	WriteLocalBuffers(&bufHdr, 1, reln);
+}
+
+/*
+ * Write out a dirty victim buffer, together with the dirty, unpinned buffers
+ * holding the blocks that follow it, up to io_combine_limit blocks in all.
+ *
+ * Temporary tables are typically filled in block order, and the clock sweep
+ * visits the buffers in the order they were filled, so this turns the
+ * eviction of a freshly loaded table into a series of large writes instead
+ * of one write per block.  The neighbors are only cleaned, not evicted; when
+ * the clock sweep reaches them, they can be reused without any I/O.
+ */
+static void
+FlushLocalBufferRun(BufferDesc *bufHdr)
+{
+	BufferDesc *bufs[MAX_IO_COMBINE_LIMIT];
+	int			nbufs = 1;
+
+	if (!StartLocalBufferIO(bufHdr, false, false))
+		elog(ERROR, "failed to start write IO on local buffer");
+	bufs[0] = bufHdr;
+
+	while (nbufs < io_combine_limit &&
+		   bufHdr->tag.blockNum + nbufs != InvalidBlockNumber)
+	{
+		BufferTag	tag = bufHdr->tag;
+		LocalBufferLookupEnt *hresult;
+		BufferDesc *next;
+		uint32		buf_state;
+
+		tag.blockNum += nbufs;
+		hresult = (LocalBufferLookupEnt *)
+			hash_search(LocalBufHash, &tag, HASH_FIND, NULL);
+		if (!hresult)
+			break;
+
+		/* skip buffers in use, including those with AIO in progress */
+		next = GetLocalBufferDescriptor(hresult->id);
+		buf_state = pg_atomic_read_u32(&next->state);
+		if (LocalRefCount[hresult->id] != 0 ||
+			BUF_STATE_GET_REFCOUNT(buf_state) != 0 ||
+			pgaio_wref_valid(&next->io_wref) ||
+			(buf_state & (BM_VALID | BM_DIRTY)) != (BM_VALID | BM_DIRTY))
+			break;
+
+		if (!StartLocalBufferIO(next, false, true))
+			break;
+		bufs[nbufs++] = next;
+	}
+
+	WriteLocalBuffers(bufs, nbufs, NULL);
+}
+
+/*
+ * Write out local buffers holding consecutive blocks of one relation fork,
+ * for which StartLocalBufferIO() has been called, and mark them clean.
+ */
+static void
+WriteLocalBuffers(BufferDesc **bufs, int nbufs, SMgrRelation reln)
+{
+	BufferDesc *bufHdr = bufs[0];
+	const void *pages[MAX_IO_COMBINE_LIMIT];
+	instr_time	io_start;
+
+	Assert(nbufs >= 1 && nbufs <= MAX_IO_COMBINE_LIMIT);
+
 	/* Find smgr relation for buffer */
 	if (reln == NULL)
 		reln = smgropen(BufTagGetRelFileLocator(&bufHdr->tag),
 						MyProcNumber);
 
-	PageSetChecksumInplace(localpage, bufHdr->tag.blockNum);
+	for (int i = 0; i < nbufs; i++)
+	{
+		Page		localpage = (char *) LocalBufHdrGetBlock(bufs[i]);
+
+		Assert(bufs[i]->tag.blockNum == bufHdr->tag.blockNum + i);
+		PageSetChecksumInplace(localpage, bufs[i]->tag.blockNum);
+		pages[i] = localpage;
+	}
 
 	io_start = pgstat_prepare_io_time(track_io_timing);
 
 	/* And write... */
-	smgrwrite(reln,
-			  BufTagGetForkNum(&bufHdr->tag),
-			  bufHdr->tag.blockNum,
-			  localpage,
-			  false);
+	smgrwritev(reln,
+			   BufTagGetForkNum(&bufHdr->tag),
+			   bufHdr->tag.blockNum,
+			   pages,
+			   nbufs,
+			   false);
 
 	/* Temporary table I/O does not use Buffer Access Strategies */
 	pgstat_count_io_op_time(IOOBJECT_TEMP_RELATION, IOCONTEXT_NORMAL,
-							IOOP_WRITE, io_start, 1, BLCKSZ);
+							IOOP_WRITE, io_start, nbufs,
+							(uint64) nbufs * BLCKSZ);
 
 	/* Mark not-dirty */
-	TerminateLocalBufferIO(bufHdr, true, 0, false);
+	for (int i = 0; i < nbufs; i++)
+		TerminateLocalBufferIO(bufs[i], true, 0, false);
 
-	pgBufferUsage.local_blks_written++;
+	pgBufferUsage.local_blks_written += nbufs;
 }
 
 static Buffer
@@ -287,7 +363,7 @@ GetLocalVictimBuffer(void)
 	 * the case, write it out before reusing it!
 	 */
 	if (pg_atomic_read_u32(&bufHdr->state) & BM_DIRTY)
-		FlushLocalBuffer(bufHdr, NULL);
+		FlushLocalBufferRun(bufHdr);
 
 	/*
 	 * Remove the victim buffer from the hashtable and mark as invalid.
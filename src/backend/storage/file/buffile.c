@@ -40,18 +40,34 @@
  * when the corresponding files need to be survived across the transaction and
  * need to be opened and closed multiple times.  Such files need to be created
  * as a member of a FileSet.
+ *
+ * Finally, a private temporary file created with BufFileCreateCompressTemp
+ * has each buffer compressed with the method selected by
+ * temp_file_compression before it is written out.  Such a file is written
+ * as a sequence of variable-length chunks, so only sequential access is
+ * possible: the file can be written, rewound to the start, and read back.
+ * Seeking anywhere else is not supported.
  *-------------------------------------------------------------------------
  */
 
 #include "postgres.h"
 
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
 #include "commands/tablespace.h"
+#include "common/pg_lzcompress.h"
 #include "executor/instrument.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "storage/buffile.h"
 #include "storage/bufmgr.h"
 #include "storage/fd.h"
+#include "utils/memutils.h"
 #include "utils/resowner.h"
 
 /*
@@ -62,6 +78,44 @@
 #define MAX_PHYSICAL_FILESIZE	0x40000000
 #define BUFFILE_SEG_SIZE		(MAX_PHYSICAL_FILESIZE / BLCKSZ)
 
+/*
+ * In a compressed BufFile, each buffer is written as a header followed by
+ * the compressed data, or by the raw data if it didn't compress.  A chunk
+ * never spans two segments; a segment is ended early instead.
+ */
+typedef struct BufFileChunkHeader
+{
+	int32		rawlen;			/* number of bytes in the buffer */
+	int32		storedlen;		/* bytes that follow; == rawlen if stored raw */
+} BufFileChunkHeader;
+
+#ifdef USE_LZ4
+#define LZ4_MAX_BLCKSZ		LZ4_COMPRESSBOUND(BLCKSZ)
+#else
+#define LZ4_MAX_BLCKSZ		0
+#endif
+
+#ifdef USE_ZSTD
+#define ZSTD_MAX_BLCKSZ		ZSTD_COMPRESSBOUND(BLCKSZ)
+#else
+#define ZSTD_MAX_BLCKSZ		0
+#endif
+
+#define PGLZ_MAX_BLCKSZ		PGLZ_MAX_OUTPUT(BLCKSZ)
+
+/* Buffer size required to store a compressed buffer */
+#define COMPRESS_BUFSIZE	Max(Max(PGLZ_MAX_BLCKSZ, LZ4_MAX_BLCKSZ), ZSTD_MAX_BLCKSZ)
+
+/* GUC variable */
+int			temp_file_compression = TEMP_FILE_COMPRESSION_NONE;
+
+/*
+ * Scratch space for compressing and decompressing buffers.  Buffers are only
+ * compressed and decompressed synchronously, so one is enough for all
+ * BufFiles in the backend.
+ */
+static char *compress_buffer = NULL;
+
 /*
  * This data structure represents a buffered file that consists of one or
  * more physical files (each accessed through a virtual file descriptor
@@ -76,6 +130,7 @@ struct BufFile
 	bool		isInterXact;	/* keep open over transactions? */
 	bool		dirty;			/* does buffer need to be written? */
 	bool		readOnly;		/* has the file been set to read only? */
+	int			compress;		/* TempFileCompression method, or NONE */
 
 	FileSet    *fileset;		/* space for fileset based segment files */
 	const char *name;			/* name of fileset based BufFile */
@@ -108,6 +163,8 @@ static BufFile *makeBufFile(File firstfile);
 static void extendBufFile(BufFile *file);
 static void BufFileLoadBuffer(BufFile *file);
 static void BufFileDumpBuffer(BufFile *file);
+static void BufFileLoadCompressedBuffer(BufFile *file);
+static void BufFileDumpCompressedBuffer(BufFile *file);
 static void BufFileFlush(BufFile *file);
 static File MakeNewFileSetSegment(BufFile *buffile, int segment);
 
@@ -122,6 +179,7 @@ makeBufFileCommon(int nfiles)
 	file->numFiles = nfiles;
 	file->isInterXact = false;
 	file->dirty = false;
+	file->compress = TEMP_FILE_COMPRESSION_NONE;
 	file->resowner = CurrentResourceOwner;
 	file->curFile = 0;
 	file->curOffset = 0;
@@ -215,6 +273,31 @@ BufFileCreateTemp(bool interXact)
 	return file;
 }
 
+/*
+ * Create a BufFile for a new temporary file, like BufFileCreateTemp, whose
+ * buffers are compressed using the temp_file_compression method in effect
+ * now.  If that is "none", this is the same as BufFileCreateTemp.
+ *
+ * The caller must write the file sequentially, rewind it with
+ * BufFileSeek(file, 0, 0, SEEK_SET), and then read it sequentially.  Other
+ * seeks and BufFileTell are not supported.
+ */
+BufFile *
+BufFileCreateCompressTemp(bool interXact)
+{
+	BufFile    *file = BufFileCreateTemp(interXact);
+
+	file->compress = temp_file_compression;
+
+	if (file->compress != TEMP_FILE_COMPRESSION_NONE &&
+		compress_buffer == NULL)
+		compress_buffer = MemoryContextAlloc(TopMemoryContext,
+											 sizeof(BufFileChunkHeader) +
+											 COMPRESS_BUFSIZE);
+
+	return file;
+}
+
 /*
  * Build the name for a given segment of a given BufFile.
  */
@@ -437,6 +520,12 @@ BufFileLoadBuffer(BufFile *file)
 	instr_time	io_start;
 	instr_time	io_time;
 
+	if (file->compress != TEMP_FILE_COMPRESSION_NONE)
+	{
+		BufFileLoadCompressedBuffer(file);
+		return;
+	}
+
 	/*
 	 * Advance to next component file if necessary and possible.
 	 */
@@ -497,6 +586,12 @@ BufFileDumpBuffer(BufFile *file)
 	int64		bytestowrite;
 	File		thisfile;
 
+	if (file->compress != TEMP_FILE_COMPRESSION_NONE)
+	{
+		BufFileDumpCompressedBuffer(file);
+		return;
+	}
+
 	/*
 	 * Unlike BufFileLoadBuffer, we must dump the whole buffer even if it
 	 * crosses a component-file boundary; so we need a loop.
@@ -579,6 +674,244 @@ BufFileDumpBuffer(BufFile *file)
 	file->nbytes = 0;
 }
 
+/*
+ * BufFileLoadCompressedBuffer
+ *
+ * Like BufFileLoadBuffer, for a compressed file: read the chunk starting at
+ * curOffset and decompress it into the buffer.  Unlike BufFileLoadBuffer,
+ * curOffset is advanced past the chunk, since the physical size of the
+ * chunk has no relation to the number of bytes in the buffer.
+ */
+static void
+BufFileLoadCompressedBuffer(BufFile *file)
+{
+	BufFileChunkHeader hdr;
+	File		thisfile;
+	char	   *data = compress_buffer;
+	int			nread;
+	int			rawlen;
+	instr_time	io_start;
+	instr_time	io_time;
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+	else
+		INSTR_TIME_SET_ZERO(io_start);
+
+	/*
+	 * Read the chunk header, advancing to the next component file when we
+	 * reach the end of this one.  Segments are ended early when the next
+	 * chunk wouldn't fit, so a short read here doesn't mean EOF if there is
+	 * another segment.
+	 */
+	for (;;)
+	{
+		thisfile = file->files[file->curFile];
+		nread = FileRead(thisfile, &hdr, sizeof(hdr), file->curOffset,
+						 WAIT_EVENT_BUFFILE_READ);
+		if (nread < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m",
+							FilePathName(thisfile))));
+		if (nread > 0 || file->curFile + 1 >= file->numFiles)
+			break;
+		file->curFile++;
+		file->curOffset = 0;
+	}
+
+	if (nread == 0)
+		return;					/* EOF */
+
+	if (nread != sizeof(hdr) ||
+		hdr.rawlen <= 0 || hdr.rawlen > BLCKSZ ||
+		hdr.storedlen <= 0 || hdr.storedlen > COMPRESS_BUFSIZE)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("invalid chunk header in temporary file \"%s\"",
+								 FilePathName(thisfile))));
+
+	/* Data stored raw goes straight into the buffer */
+	if (hdr.storedlen == hdr.rawlen)
+		data = file->buffer.data;
+
+	nread = FileRead(thisfile, data, hdr.storedlen,
+					 file->curOffset + sizeof(hdr),
+					 WAIT_EVENT_BUFFILE_READ);
+	if (nread != hdr.storedlen)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read file \"%s\": %m",
+						FilePathName(thisfile))));
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_ACCUM_DIFF(pgBufferUsage.temp_blk_read_time, io_time, io_start);
+	}
+
+	file->curOffset += sizeof(hdr) + hdr.storedlen;
+	pgBufferUsage.temp_blks_read++;
+
+	if (data == file->buffer.data)
+	{
+		file->nbytes = hdr.rawlen;
+		return;
+	}
+
+	switch ((TempFileCompression) file->compress)
+	{
+		case TEMP_FILE_COMPRESSION_PGLZ:
+			rawlen = pglz_decompress(data, hdr.storedlen,
+									 file->buffer.data, hdr.rawlen, true);
+			break;
+
+		case TEMP_FILE_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			rawlen = LZ4_decompress_safe(data, file->buffer.data,
+										 hdr.storedlen, hdr.rawlen);
+#else
+			elog(ERROR, "LZ4 is not supported by this build");
+#endif
+			break;
+
+		case TEMP_FILE_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				size_t		len;
+
+				len = ZSTD_decompress(file->buffer.data, hdr.rawlen,
+									  data, hdr.storedlen);
+				rawlen = ZSTD_isError(len) ? -1 : (int) len;
+			}
+#else
+			elog(ERROR, "zstd is not supported by this build");
+#endif
+			break;
+
+		default:
+			elog(ERROR, "unrecognized temporary file compression method: %d",
+				 file->compress);
+			rawlen = -1;		/* keep compiler quiet */
+			break;
+	}
+
+	if (rawlen != hdr.rawlen)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg_internal("could not decompress chunk of temporary file \"%s\"",
+								 FilePathName(thisfile))));
+
+	file->nbytes = rawlen;
+}
+
+/*
+ * BufFileDumpCompressedBuffer
+ *
+ * Like BufFileDumpBuffer, for a compressed file: compress the buffer and
+ * write it out as one chunk at curOffset.  Compressed files are only ever
+ * written sequentially, so the whole buffer is written and curOffset is
+ * left at the end of the chunk.
+ */
+static void
+BufFileDumpCompressedBuffer(BufFile *file)
+{
+	BufFileChunkHeader *hdr = (BufFileChunkHeader *) compress_buffer;
+	char	   *dest = compress_buffer + sizeof(BufFileChunkHeader);
+	int			len = -1;
+	int			towrite;
+	File		thisfile;
+	instr_time	io_start;
+	instr_time	io_time;
+
+	Assert(file->pos == file->nbytes);
+
+	switch ((TempFileCompression) file->compress)
+	{
+		case TEMP_FILE_COMPRESSION_PGLZ:
+			len = pglz_compress(file->buffer.data, file->nbytes, dest,
+								PGLZ_strategy_default);
+			break;
+
+		case TEMP_FILE_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			len = LZ4_compress_default(file->buffer.data, dest,
+									   file->nbytes, COMPRESS_BUFSIZE);
+			if (len <= 0)
+				len = -1;
+#else
+			elog(ERROR, "LZ4 is not supported by this build");
+#endif
+			break;
+
+		case TEMP_FILE_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				size_t		zlen;
+
+				zlen = ZSTD_compress(dest, COMPRESS_BUFSIZE,
+									 file->buffer.data, file->nbytes,
+									 ZSTD_CLEVEL_DEFAULT);
+				len = ZSTD_isError(zlen) ? -1 : (int) zlen;
+			}
+#else
+			elog(ERROR, "zstd is not supported by this build");
+#endif
+			break;
+
+		default:
+			elog(ERROR, "unrecognized temporary file compression method: %d",
+				 file->compress);
+			break;
+	}
+
+	/* Store the data raw if it didn't compress */
+	if (len < 0 || len >= file->nbytes)
+	{
+		memcpy(dest, file->buffer.data, file->nbytes);
+		len = file->nbytes;
+	}
+	hdr->rawlen = file->nbytes;
+	hdr->storedlen = len;
+	towrite = sizeof(BufFileChunkHeader) + len;
+
+	/* Start a new component file if the chunk doesn't fit in this one */
+	if (file->curOffset + towrite > MAX_PHYSICAL_FILESIZE)
+	{
+		while (file->curFile + 1 >= file->numFiles)
+			extendBufFile(file);
+		file->curFile++;
+		file->curOffset = 0;
+	}
+
+	thisfile = file->files[file->curFile];
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+	else
+		INSTR_TIME_SET_ZERO(io_start);
+
+	if (FileWrite(thisfile, compress_buffer, towrite, file->curOffset,
+				  WAIT_EVENT_BUFFILE_WRITE) != towrite)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to file \"%s\": %m",
+						FilePathName(thisfile))));
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_ACCUM_DIFF(pgBufferUsage.temp_blk_write_time, io_time, io_start);
+	}
+
+	file->curOffset += towrite;
+	pgBufferUsage.temp_blks_written++;
+
+	file->dirty = false;
+	file->pos = 0;
+	file->nbytes = 0;
+}
+
 /*
  * BufFileRead variants
  *
@@ -603,7 +936,8 @@ BufFileReadCommon(BufFile *file, void *ptr, size_t size, bool exact, bool eofOK)
 		if (file->pos >= file->nbytes)
 		{
 			/* Try to load more data into buffer. */
-			file->curOffset += file->pos;
+			if (file->compress == TEMP_FILE_COMPRESSION_NONE)
+				file->curOffset += file->pos;
 			file->pos = 0;
 			file->nbytes = 0;
 			BufFileLoadBuffer(file);
@@ -689,6 +1023,7 @@ BufFileWrite(BufFile *file, const void *ptr, size_t size)
 			else
 			{
 				/* Hmm, went directly from reading to writing? */
+				Assert(file->compress == TEMP_FILE_COMPRESSION_NONE);
 				file->curOffset += file->pos;
 				file->pos = 0;
 				file->nbytes = 0;
@@ -742,6 +1077,20 @@ BufFileSeek(BufFile *file, int fileno, pgoff_t offset, int whence)
 	int			newFile;
 	pgoff_t		newOffset;
 
+	/* A compressed file can only be rewound to the start */
+	if (file->compress != TEMP_FILE_COMPRESSION_NONE)
+	{
+		if (whence != SEEK_SET || fileno != 0 || offset != 0)
+			elog(ERROR, "cannot seek in a compressed temporary file");
+
+		BufFileFlush(file);
+		file->curFile = 0;
+		file->curOffset = 0;
+		file->pos = 0;
+		file->nbytes = 0;
+		return 0;
+	}
+
 	switch (whence)
 	{
 		case SEEK_SET:
@@ -831,6 +1180,7 @@ BufFileSeek(BufFile *file, int fileno, pgoff_t offset, int whence)
 void
 BufFileTell(BufFile *file, int *fileno, pgoff_t *offset)
 {
+	Assert(file->compress == TEMP_FILE_COMPRESSION_NONE);
 	*fileno = file->curFile;
 	*offset = file->curOffset + file->pos;
 }
@@ -855,6 +1205,40 @@ BufFileSeekBlock(BufFile *file, int64 blknum)
 					   SEEK_SET);
 }
 
+/*
+ * BufFilePrefetchBlock --- hint that blocks will be read soon
+ *
+ * Asks the kernel to start reading nblocks BLCKSZ-sized blocks beginning at
+ * block blknum, so that a later BufFileSeekBlock() and read of them doesn't
+ * have to wait for I/O.  This is only a hint: blocks beyond the end of the
+ * file are ignored, and errors are not reported.  The logical position of
+ * the file is not moved.
+ */
+void
+BufFilePrefetchBlock(BufFile *file, int64 blknum, int nblocks)
+{
+	while (nblocks > 0)
+	{
+		int			fileno = (int) (blknum / BUFFILE_SEG_SIZE);
+		int64		segblk = blknum % BUFFILE_SEG_SIZE;
+		int			n;
+
+		if (fileno >= file->numFiles)
+			break;
+
+		/* don't cross a segment boundary in one request */
+		n = (int) Min((int64) nblocks, BUFFILE_SEG_SIZE - segblk);
+
+		(void) FilePrefetch(file->files[fileno],
+							(pgoff_t) segblk * BLCKSZ,
+							(pgoff_t) n * BLCKSZ,
+							WAIT_EVENT_BUFFILE_READ);
+
+		blknum += n;
+		nblocks -= n;
+	}
+}
+
 /*
  * Returns the amount of data in the given BufFile, in bytes.
  *
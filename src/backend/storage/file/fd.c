@@ -2440,6 +2440,50 @@ retry:
 	return FileZero(file, offset, amount, wait_event_info);
 }
 
+/*
+ * Deallocate the file space backing the given range, leaving the file size
+ * unchanged.  Subsequent reads of the range return zeroes.
+ *
+ * This is only supported where fallocate(FALLOC_FL_PUNCH_HOLE) is available.
+ * Elsewhere, and when the filesystem does not support it, -1 is returned
+ * with errno set to EOPNOTSUPP; the range is then left untouched.
+ *
+ * Returns 0 on success, -1 otherwise. In the latter case errno is set to the
+ * appropriate error.
+ */
+int
+FilePunchHole(File file, pgoff_t offset, pgoff_t amount, uint32 wait_event_info)
+{
+#if defined(FALLOC_FL_PUNCH_HOLE) && defined(FALLOC_FL_KEEP_SIZE)
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FilePunchHole: %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) amount));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return -1;
+
+retry:
+	pgstat_report_wait_start(wait_event_info);
+	returnCode = fallocate(VfdCache[file].fd,
+						   FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+						   offset, amount);
+	pgstat_report_wait_end();
+
+	if (returnCode < 0 && errno == EINTR)
+		goto retry;
+
+	return returnCode;
+#else
+	errno = EOPNOTSUPP;
+	return -1;
+#endif
+}
+
 pgoff_t
 FileSize(File file)
 {
@@ -3985,7 +4029,7 @@ data_sync_elevel(int elevel)
 }
 
 bool
-check_debug_io_direct(char **newval, void **extra, GucSource source)
+check_io_direct(char **newval, void **extra, GucSource source)
 {
 	bool		result = true;
 	int			flags;
@@ -3994,7 +4038,7 @@ check_debug_io_direct(char **newval, void **extra, GucSource source)
 	if (strcmp(*newval, "") != 0)
 	{
 		GUC_check_errdetail("\"%s\" is not supported on this platform.",
-							"debug_io_direct");
+							"io_direct");
 		result = false;
 	}
 	flags = 0;
@@ -4009,7 +4053,7 @@ check_debug_io_direct(char **newval, void **extra, GucSource source)
 	if (!SplitGUCList(rawstring, ',', &elemlist))
 	{
 		GUC_check_errdetail("Invalid list syntax in parameter \"%s\".",
-							"debug_io_direct");
+							"io_direct");
 		pfree(rawstring);
 		list_free(elemlist);
 		return false;
@@ -4042,7 +4086,7 @@ check_debug_io_direct(char **newval, void **extra, GucSource source)
 	if (result && (flags & (IO_DIRECT_WAL | IO_DIRECT_WAL_INIT)))
 	{
 		GUC_check_errdetail("\"%s\" is not supported for WAL because %s is too small.",
-							"debug_io_direct", "XLOG_BLCKSZ");
+							"io_direct", "XLOG_BLCKSZ");
 		result = false;
 	}
 #endif
@@ -4050,7 +4094,7 @@ check_debug_io_direct(char **newval, void **extra, GucSource source)
 	if (result && (flags & IO_DIRECT_DATA))
 	{
 		GUC_check_errdetail("\"%s\" is not supported for data because %s is too small.",
-							"debug_io_direct", "BLCKSZ");
+							"io_direct", "BLCKSZ");
 		result = false;
 	}
 #endif
@@ -4062,7 +4106,7 @@ check_debug_io_direct(char **newval, void **extra, GucSource source)
 	if (!result)
 		return result;
 
-	/* Save the flags in *extra, for use by assign_debug_io_direct */
+	/* Save the flags in *extra, for use by assign_io_direct */
 	*extra = guc_malloc(LOG, sizeof(int));
 	if (!*extra)
 		return false;
@@ -4072,7 +4116,7 @@ check_debug_io_direct(char **newval, void **extra, GucSource source)
 }
 
 void
-assign_debug_io_direct(const char *newval, void *extra)
+assign_io_direct(const char *newval, void *extra)
 {
 	int		   *flags = (int *) extra;
 
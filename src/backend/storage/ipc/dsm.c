@@ -802,31 +802,7 @@ dsm_detach_all(void)
 void
 dsm_detach(dsm_segment *seg)
 {
-	/*
-	 * Invoke registered callbacks.  Just in case one of those callbacks
-	 * throws a further error that brings us back here, pop the callback
-	 * before invoking it, to avoid infinite error recursion.  Don't allow
-	 * interrupts while running the individual callbacks in non-error code
-	 * paths, to avoid leaving cleanup work unfinished if we're interrupted by
-	 * a statement timeout or similar.
-	 */
-	HOLD_INTERRUPTS();
-	while (!slist_is_empty(&seg->on_detach))
-	{
-		slist_node *node;
-		dsm_segment_detach_callback *cb;
-		on_dsm_detach_callback function;
-		Datum		arg;
-
-		node = slist_pop_head_node(&seg->on_detach);
-		cb = slist_container(dsm_segment_detach_callback, node, node);
-		function = cb->function;
-		arg = cb->arg;
-		pfree(cb);
-
-		function(seg, arg);
-	}
-	RESUME_INTERRUPTS();
+	dsm_run_detach_callbacks(seg);
 
 	/*
 	 * Try to remove the mapping, if one exists.  Normally, there will be, but
@@ -1163,6 +1139,42 @@ cancel_on_dsm_detach(dsm_segment *seg, on_dsm_detach_callback function,
 	}
 }
 
+/*
+ * Invoke and forget the registered on-detach callbacks of a segment, as if
+ * we were detaching from it, but keep it mapped.
+ *
+ * This allows a segment to be reused for a new purpose, e.g. by parallel.c,
+ * once everything that was stored in it has been cleaned up.
+ */
+void
+dsm_run_detach_callbacks(dsm_segment *seg)
+{
+	/*
+	 * Just in case one of the callbacks throws a further error that brings
+	 * us back here, pop the callback before invoking it, to avoid infinite
+	 * error recursion.  Don't allow interrupts while running the individual
+	 * callbacks in non-error code paths, to avoid leaving cleanup work
+	 * unfinished if we're interrupted by a statement timeout or similar.
+	 */
+	HOLD_INTERRUPTS();
+	while (!slist_is_empty(&seg->on_detach))
+	{
+		slist_node *node;
+		dsm_segment_detach_callback *cb;
+		on_dsm_detach_callback function;
+		Datum		arg;
+
+		node = slist_pop_head_node(&seg->on_detach);
+		cb = slist_container(dsm_segment_detach_callback, node, node);
+		function = cb->function;
+		arg = cb->arg;
+		pfree(cb);
+
+		function(seg, arg);
+	}
+	RESUME_INTERRUPTS();
+}
+
 /*
  * Discard all registered on-detach callbacks without executing them.
  */
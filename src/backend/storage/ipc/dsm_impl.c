@@ -66,6 +66,7 @@
 #include "postmaster/postmaster.h"
 #include "storage/dsm_impl.h"
 #include "storage/fd.h"
+#include "storage/pg_shmem.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
 
@@ -119,6 +120,12 @@ int			min_dynamic_shared_memory;
 
 #define SEGMENT_NAME_PREFIX			"Global/PostgreSQL"
 
+/*
+ * Smallest POSIX segment for which we ask for transparent huge pages.  This
+ * is the usual PMD size on Linux; smaller segments can't use huge pages.
+ */
+#define DSM_HUGE_PAGE_MIN_SIZE		(2 * 1024 * 1024)
+
 /*------
  * Perform a low-level shared memory operation in a platform-specific way,
  * as dictated by the selected implementation.  Each implementation is
@@ -332,6 +339,24 @@ dsm_impl_posix(dsm_op op, dsm_handle handle, Size request_size,
 						name)));
 		return false;
 	}
+
+#ifdef MADV_HUGEPAGE
+
+	/*
+	 * POSIX segments can't be mapped with MAP_HUGETLB, but on Linux large
+	 * ones can still be backed by transparent huge pages, if the
+	 * administrator has enabled them for shared memory
+	 * (transparent_hugepage/shmem_enabled set to "advise" or "always").  Do
+	 * this in every process that maps the segment, since the advice applies
+	 * to the mapping.  If it fails, we just keep using regular pages.
+	 */
+	if (huge_pages != HUGE_PAGES_OFF &&
+		request_size >= DSM_HUGE_PAGE_MIN_SIZE &&
+		madvise(address, request_size, MADV_HUGEPAGE) != 0)
+		elog(DEBUG1, "madvise(MADV_HUGEPAGE) failed for shared memory segment \"%s\": %m",
+			 name);
+#endif
+
 	*mapped_address = address;
 	*mapped_size = request_size;
 	close(fd);
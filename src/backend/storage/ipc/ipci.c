@@ -18,6 +18,7 @@
 #include "access/commit_ts.h"
 #include "access/multixact.h"
 #include "access/nbtree.h"
+#include "access/parallel.h"
 #include "access/subtrans.h"
 #include "access/syncscan.h"
 #include "access/transam.h"
@@ -25,12 +26,17 @@
 #include "access/xlogprefetcher.h"
 #include "access/xlogrecovery.h"
 #include "access/xlogwait.h"
+#include "catalog/globaltemp.h"
+#include "catalog/indexcapture.h"
 #include "commands/async.h"
+#include "commands/sequence.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
+#include "postmaster/background_prune.h"
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
+#include "postmaster/session_history.h"
 #include "postmaster/walsummarizer.h"
 #include "replication/logicallauncher.h"
 #include "replication/origin.h"
@@ -52,6 +58,8 @@
 #include "storage/sinvaladt.h"
 #include "utils/guc.h"
 #include "utils/injection_point.h"
+#include "utils/querymem.h"
+#include "utils/sharedcatcache.h"
 
 /* GUCs */
 int			shared_memory_type = DEFAULT_SHARED_MEMORY_TYPE;
@@ -115,6 +123,7 @@ CalculateShmemSize(void)
 	size = add_size(size, SUBTRANSShmemSize());
 	size = add_size(size, TwoPhaseShmemSize());
 	size = add_size(size, BackgroundWorkerShmemSize());
+	size = add_size(size, ParallelWorkerPoolShmemSize());
 	size = add_size(size, MultiXactShmemSize());
 	size = add_size(size, LWLockShmemSize());
 	size = add_size(size, ProcArrayShmemSize());
@@ -133,7 +142,15 @@ CalculateShmemSize(void)
 	size = add_size(size, ApplyLauncherShmemSize());
 	size = add_size(size, BTreeShmemSize());
 	size = add_size(size, SyncScanShmemSize());
+	size = add_size(size, SMgrSizeCacheShmemSize());
+	size = add_size(size, SharedCatCacheShmemSize());
+	size = add_size(size, QueryMemoryShmemSize());
 	size = add_size(size, AsyncShmemSize());
+	size = add_size(size, SequenceShmemSize());
+	size = add_size(size, GlobalTempShmemSize());
+	size = add_size(size, SessionHistoryShmemSize());
+	size = add_size(size, BackgroundPruneShmemSize());
+	size = add_size(size, IndexCaptureShmemSize());
 	size = add_size(size, StatsShmemSize());
 	size = add_size(size, WaitEventCustomShmemSize());
 	size = add_size(size, InjectionPointShmemSize());
@@ -296,6 +313,7 @@ CreateOrAttachShmemStructs(void)
 	BackendStatusShmemInit();
 	TwoPhaseShmemInit();
 	BackgroundWorkerShmemInit();
+	ParallelWorkerPoolShmemInit();
 
 	/*
 	 * Set up shared-inval messaging
@@ -323,7 +341,15 @@ CreateOrAttachShmemStructs(void)
 	 */
 	BTreeShmemInit();
 	SyncScanShmemInit();
+	SMgrSizeCacheShmemInit();
+	SharedCatCacheShmemInit();
+	QueryMemoryShmemInit();
 	AsyncShmemInit();
+	SequenceShmemInit();
+	GlobalTempShmemInit();
+	SessionHistoryShmemInit();
+	BackgroundPruneShmemInit();
+	IndexCaptureShmemInit();
 	StatsShmemInit();
 	WaitEventCustomShmemInit();
 	InjectionPointShmemInit();
@@ -47,6 +47,7 @@
 
 #include <signal.h>
 
+#include "access/parallel.h"
 #include "access/subtrans.h"
 #include "access/transam.h"
 #include "access/twophase.h"
@@ -56,6 +57,7 @@
 #include "catalog/pg_authid.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/pg_bitutils.h"
 #include "port/pg_lfind.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
@@ -99,6 +101,40 @@ typedef struct ProcArrayStruct
 	int			pgprocnos[FLEXIBLE_ARRAY_MEMBER];
 } ProcArrayStruct;
 
+/*
+ * The most recently built snapshot, shared between backends.
+ *
+ * Building a snapshot requires looking at the xid of every backend in the
+ * ProcArray, which becomes expensive with thousands of connections.  But
+ * the result only depends on the set of running transactions, which can
+ * only change when xactCompletionCount is advanced (see
+ * GetSnapshotDataReuse()).  So once one backend has built a snapshot, other
+ * backends can copy the list of running xids from here, instead of scanning
+ * the ProcArray, until the next transaction completes.  That makes taking a
+ * snapshot proportional to the number of running transactions rather than
+ * to the number of connections.
+ *
+ * Only a backend that has no xid of its own publishes a snapshot, so that
+ * the list is complete, and only if it has no subxids to record, so that no
+ * space for subxids is needed.  A backend copying the snapshot leaves out
+ * its own xid.
+ *
+ * The contents are written and read while holding ProcArrayLock in shared
+ * mode, so xactCompletionCount cannot change meanwhile.  completionCount is
+ * set last, after the rest of the contents, and only one backend at a time
+ * can be replacing the contents.
+ */
+typedef struct SharedSnapshotData
+{
+	pg_atomic_uint64 completionCount;	/* xactCompletionCount the contents
+										 * are valid for, or 0 */
+	pg_atomic_flag building;	/* set while contents are being replaced */
+	TransactionId xmin;
+	int			xcnt;
+	bool		suboverflowed;
+	TransactionId xip[FLEXIBLE_ARRAY_MEMBER];	/* PROCARRAY_MAXPROCS entries */
+} SharedSnapshotData;
+
 /*
  * State for the GlobalVisTest* family of functions. Those functions can
  * e.g. be used to decide if a deleted row can be removed without violating
@@ -268,6 +304,8 @@ typedef enum KAXCompressReason
 
 static ProcArrayStruct *procArray;
 
+static SharedSnapshotData *sharedSnapshot;
+
 static PGPROC *allProcs;
 
 /*
@@ -279,7 +317,7 @@ static TransactionId cachedXidIsNotInProgress = InvalidTransactionId;
  * Bookkeeping for tracking emulated transactions in recovery
  */
 static TransactionId *KnownAssignedXids;
-static bool *KnownAssignedXidsValid;
+static uint64 *KnownAssignedXidsValid;
 static TransactionId latestObservedXid = InvalidTransactionId;
 
 /*
@@ -344,6 +382,9 @@ static void DisplayXidCache(void);
 #endif							/* XIDCACHE_DEBUG */
 
 /* Primitives for KnownAssignedXids array handling for standby */
+static inline bool KnownAssignedXidIsValid(int index);
+static inline void KnownAssignedXidSetValid(int index, bool valid);
+static inline int KnownAssignedXidsNextValid(int index, int head);
 static void KnownAssignedXidsCompress(KAXCompressReason reason, bool haveLock);
 static void KnownAssignedXidsAdd(TransactionId from_xid, TransactionId to_xid,
 								 bool exclusive_lock);
@@ -399,15 +440,23 @@ ProcArrayShmemSize(void)
 #define TOTAL_MAX_CACHED_SUBXIDS \
 	((PGPROC_MAX_CACHED_SUBXIDS + 1) * PROCARRAY_MAXPROCS)
 
+	/* The valid flags of KnownAssignedXids are a bitmap of 64-bit words */
+#define KAX_VALID_WORDS \
+	((TOTAL_MAX_CACHED_SUBXIDS + 63) / 64)
+
 	if (EnableHotStandby)
 	{
 		size = add_size(size,
 						mul_size(sizeof(TransactionId),
 								 TOTAL_MAX_CACHED_SUBXIDS));
 		size = add_size(size,
-						mul_size(sizeof(bool), TOTAL_MAX_CACHED_SUBXIDS));
+						mul_size(sizeof(uint64), KAX_VALID_WORDS));
 	}
 
+	/* Size of the shared snapshot */
+	size = add_size(size, offsetof(SharedSnapshotData, xip));
+	size = add_size(size, mul_size(sizeof(TransactionId), PROCARRAY_MAXPROCS));
+
 	return size;
 }
 
@@ -446,6 +495,23 @@ ProcArrayShmemInit(void)
 
 	allProcs = ProcGlobal->allProcs;
 
+	/* Create or attach to the shared snapshot */
+	sharedSnapshot = (SharedSnapshotData *)
+		ShmemInitStruct("Shared Snapshot",
+						add_size(offsetof(SharedSnapshotData, xip),
+								 mul_size(sizeof(TransactionId),
+										  PROCARRAY_MAXPROCS)),
+						&found);
+
+	if (!found)
+	{
+		pg_atomic_init_u64(&sharedSnapshot->completionCount, 0);
+		pg_atomic_init_flag(&sharedSnapshot->building);
+		sharedSnapshot->xmin = InvalidTransactionId;
+		sharedSnapshot->xcnt = 0;
+		sharedSnapshot->suboverflowed = false;
+	}
+
 	/* Create or attach to the KnownAssignedXids arrays too, if needed */
 	if (EnableHotStandby)
 	{
@@ -454,9 +520,9 @@ ProcArrayShmemInit(void)
 							mul_size(sizeof(TransactionId),
 									 TOTAL_MAX_CACHED_SUBXIDS),
 							&found);
-		KnownAssignedXidsValid = (bool *)
+		KnownAssignedXidsValid = (uint64 *)
 			ShmemInitStruct("KnownAssignedXidsValid",
-							mul_size(sizeof(bool), TOTAL_MAX_CACHED_SUBXIDS),
+							mul_size(sizeof(uint64), KAX_VALID_WORDS),
 							&found);
 	}
 }
@@ -2087,6 +2153,95 @@ GetSnapshotDataReuse(Snapshot snapshot)
 	return true;
 }
 
+/*
+ * Helper function for GetSnapshotData() that copies the running xids from
+ * the shared snapshot, if it is valid for curXactCompletionCount.  Our own
+ * xid is left out of the copy, but taken into account in *xmin.  Returns
+ * false if the shared snapshot can't be used.
+ */
+static bool
+GetSnapshotDataShared(Snapshot snapshot, uint64 curXactCompletionCount,
+					  TransactionId myxid, TransactionId *xmin, int *count,
+					  bool *suboverflowed)
+{
+	SharedSnapshotData *shared = sharedSnapshot;
+	XidCacheStatus *mySubxidState = &ProcGlobal->subxidStates[MyProc->pgxactoff];
+	TransactionId *xip = snapshot->xip;
+	int			xcnt;
+	int			n = 0;
+
+	Assert(LWLockHeldByMe(ProcArrayLock));
+
+	if (pg_atomic_read_u64(&shared->completionCount) != curXactCompletionCount)
+		return false;
+
+	/* We'd have to leave out our own subxids too; not worth the trouble */
+	if (mySubxidState->count > 0 || mySubxidState->overflowed)
+		return false;
+
+	pg_read_barrier();			/* pairs with GetSnapshotDataPublish */
+
+	xcnt = shared->xcnt;
+	if (TransactionIdIsNormal(myxid))
+	{
+		for (int i = 0; i < xcnt; i++)
+		{
+			if (shared->xip[i] != myxid)
+				xip[n++] = shared->xip[i];
+		}
+	}
+	else
+	{
+		memcpy(xip, shared->xip, xcnt * sizeof(TransactionId));
+		n = xcnt;
+	}
+
+	/* *xmin already accounts for xmax and our own xid */
+	if (NormalTransactionIdPrecedes(shared->xmin, *xmin))
+		*xmin = shared->xmin;
+	*count = n;
+	*suboverflowed = shared->suboverflowed;
+
+	return true;
+}
+
+/*
+ * Helper function for GetSnapshotData() that makes a snapshot just built the
+ * hard way available to other backends.
+ */
+static void
+GetSnapshotDataPublish(Snapshot snapshot, uint64 curXactCompletionCount,
+					   TransactionId xmin, int count, bool suboverflowed)
+{
+	SharedSnapshotData *shared = sharedSnapshot;
+
+	Assert(LWLockHeldByMe(ProcArrayLock));
+
+	if (pg_atomic_read_u64(&shared->completionCount) == curXactCompletionCount)
+		return;
+
+	/* If someone else is already at it, let them */
+	if (!pg_atomic_test_set_flag(&shared->building))
+		return;
+
+	/* Recheck, in case someone else published it while we checked the flag */
+	if (pg_atomic_read_u64(&shared->completionCount) != curXactCompletionCount)
+	{
+		pg_atomic_write_u64(&shared->completionCount, 0);
+		pg_write_barrier();
+
+		shared->xmin = xmin;
+		shared->xcnt = count;
+		shared->suboverflowed = suboverflowed;
+		memcpy(shared->xip, snapshot->xip, count * sizeof(TransactionId));
+
+		pg_write_barrier();		/* pairs with GetSnapshotDataShared */
+		pg_atomic_write_u64(&shared->completionCount, curXactCompletionCount);
+	}
+
+	pg_atomic_clear_flag(&shared->building);
+}
+
 /*
  * GetSnapshotData -- returns information about running transactions.
  *
@@ -2206,7 +2361,13 @@ GetSnapshotData(Snapshot snapshot)
 
 	snapshot->takenDuringRecovery = RecoveryInProgress();
 
-	if (!snapshot->takenDuringRecovery)
+	if (!snapshot->takenDuringRecovery &&
+		GetSnapshotDataShared(snapshot, curXactCompletionCount, myxid,
+							  &xmin, &count, &suboverflowed))
+	{
+		/* Got the running xids from another backend's snapshot */
+	}
+	else if (!snapshot->takenDuringRecovery)
 	{
 		int			numProcs = arrayP->numProcs;
 		TransactionId *xip = snapshot->xip;
@@ -2310,6 +2471,14 @@ GetSnapshotData(Snapshot snapshot)
 				}
 			}
 		}
+
+		/*
+		 * If the snapshot covers all running xids, let other backends reuse
+		 * it.  It does if we have no xid of our own to leave out.
+		 */
+		if (!TransactionIdIsValid(myxid) && (subcount == 0 || suboverflowed))
+			GetSnapshotDataPublish(snapshot, curXactCompletionCount,
+								   xmin, count, suboverflowed);
 	}
 	else
 	{
@@ -2363,6 +2532,10 @@ GetSnapshotData(Snapshot snapshot)
 
 	LWLockRelease(ProcArrayLock);
 
+	/* Visibility checks using this snapshot will have to visit pg_subtrans */
+	if (suboverflowed)
+		SubTransReportOverflowedSnapshot();
+
 	/* maintain state for GlobalVis* */
 	{
 		TransactionId def_vis_xid;
@@ -3724,6 +3897,9 @@ CountOtherDBBackends(Oid databaseId, int *nbackends, int *nprepared)
 
 		CHECK_FOR_INTERRUPTS();
 
+		/* Idle pooled parallel workers can just go away */
+		ParallelWorkerPoolTerminate(databaseId);
+
 		*nbackends = *nprepared = 0;
 
 		LWLockAcquire(ProcArrayLock, LW_SHARED);
@@ -4555,15 +4731,17 @@ KnownAssignedTransactionIdsIdleMaintenance(void)
  *
  * To keep individual deletions cheap, we need to allow gaps in the array.
  * This is implemented by marking array elements as valid or invalid using
- * the parallel boolean array KnownAssignedXidsValid[].  A deletion is done
- * by setting KnownAssignedXidsValid[i] to false, *without* clearing the
+ * the parallel bitmap KnownAssignedXidsValid[], one bit per element.  A
+ * deletion is done by clearing the element's bit, *without* clearing the
  * XID entry itself.  This preserves the property that the XID entries are
  * sorted, so we can do binary searches easily.  Periodically we compress
  * out the unused entries; that's much cheaper than having to compress the
- * array immediately on every deletion.
+ * array immediately on every deletion.  Between compressions, scans of the
+ * array use the bitmap to step over runs of deleted entries 64 at a time.
  *
  * The actually valid items in KnownAssignedXids[] and KnownAssignedXidsValid[]
- * are those with indexes tail <= i < head; items outside this subscript range
+ * are those with indexes tail <= i < head, and bits for other indexes must
+ * be ignored; items outside this subscript range
  * have unspecified contents.  When head reaches the end of the array, we
  * force compression of unused entries rather than wrapping around, since
  * allowing wraparound would greatly complicate the search logic.  We maintain
@@ -4584,7 +4762,9 @@ KnownAssignedTransactionIdsIdleMaintenance(void)
  * memory ordering, we need to be careful that other processors see the array
  * element changes before they see the head pointer change.  We handle this by
  * using memory barriers when reading or writing the head/tail pointers (unless
- * the caller holds ProcArrayLock exclusively).
+ * the caller holds ProcArrayLock exclusively).  Setting the valid bit of a new
+ * element rewrites a bitmap word that readers may be looking at, but the
+ * bits of the elements below the head that they can see are unchanged.
  *
  * Algorithmic analysis:
  *
@@ -4593,9 +4773,9 @@ KnownAssignedTransactionIdsIdleMaintenance(void)
  *
  *	* Adding a new XID is O(1) and needs no lock (unless compression must
  *		happen)
- *	* Compressing the array is O(S) and requires exclusive lock
+ *	* Compressing the array is O(N + S/64) and requires exclusive lock
  *	* Removing an XID is O(logS) and requires exclusive lock
- *	* Taking a snapshot is O(S) and requires shared lock
+ *	* Taking a snapshot is O(N + S/64) and requires shared lock
  *	* Checking for an XID is O(logS) and requires shared lock
  *
  * In comparison, using a hash table for KnownAssignedXids would mean that
@@ -4608,7 +4788,54 @@ KnownAssignedTransactionIdsIdleMaintenance(void)
  * currently valid XIDs in the array (N).  Except in special cases, we'll
  * compress when S >= 2N.  Bounding S at 2N in turn bounds the time for
  * taking a snapshot to be O(N), which it would have to be anyway.
+ *
+ * Since the XIDs in a snapshot taken during recovery come from this array,
+ * they are in sorted order too, so XidInMVCCSnapshot() can binary-search
+ * them.
+ */
+
+/*
+ * Is KnownAssignedXids[index] valid?
+ */
+static inline bool
+KnownAssignedXidIsValid(int index)
+{
+	return (KnownAssignedXidsValid[index / 64] &
+			(UINT64CONST(1) << (index % 64))) != 0;
+}
+
+/*
+ * Mark KnownAssignedXids[index] as valid or invalid.
+ */
+static inline void
+KnownAssignedXidSetValid(int index, bool valid)
+{
+	if (valid)
+		KnownAssignedXidsValid[index / 64] |= UINT64CONST(1) << (index % 64);
+	else
+		KnownAssignedXidsValid[index / 64] &= ~(UINT64CONST(1) << (index % 64));
+}
+
+/*
+ * Return the index of the first valid element at or after index, or head if
+ * there's none before head.
  */
+static inline int
+KnownAssignedXidsNextValid(int index, int head)
+{
+	while (index < head)
+	{
+		uint64		word = KnownAssignedXidsValid[index / 64] >> (index % 64);
+
+		if (word != 0)
+			return Min(index + pg_rightmost_one_pos64(word), head);
+
+		/* skip to the start of the next word */
+		index = (index / 64 + 1) * 64;
+	}
+
+	return head;
+}
 
 
 /*
@@ -4703,20 +4930,22 @@ KnownAssignedXidsCompress(KAXCompressReason reason, bool haveLock)
 
 	/*
 	 * We compress the array by reading the valid values from tail to head,
-	 * re-aligning data to 0th element.
+	 * re-aligning data to 0th element.  Then all the elements before the new
+	 * head are valid.
 	 */
 	compress_index = 0;
-	for (i = tail; i < head; i++)
-	{
-		if (KnownAssignedXidsValid[i])
-		{
-			KnownAssignedXids[compress_index] = KnownAssignedXids[i];
-			KnownAssignedXidsValid[compress_index] = true;
-			compress_index++;
-		}
-	}
+	for (i = KnownAssignedXidsNextValid(tail, head);
+		 i < head;
+		 i = KnownAssignedXidsNextValid(i + 1, head))
+		KnownAssignedXids[compress_index++] = KnownAssignedXids[i];
 	Assert(compress_index == pArray->numKnownAssignedXids);
 
+	memset(KnownAssignedXidsValid, 0xFF,
+		   (compress_index / 64) * sizeof(uint64));
+	if (compress_index % 64 != 0)
+		KnownAssignedXidsValid[compress_index / 64] =
+			(UINT64CONST(1) << (compress_index % 64)) - 1;
+
 	pArray->tailKnownAssignedXids = 0;
 	pArray->headKnownAssignedXids = compress_index;
 
@@ -4813,7 +5042,7 @@ KnownAssignedXidsAdd(TransactionId from_xid, TransactionId to_xid,
 	for (i = 0; i < nxids; i++)
 	{
 		KnownAssignedXids[head] = next_xid;
-		KnownAssignedXidsValid[head] = true;
+		KnownAssignedXidSetValid(head, true);
 		TransactionIdAdvance(next_xid);
 		head++;
 	}
@@ -4864,7 +5093,7 @@ KnownAssignedXidsSearch(TransactionId xid, bool remove)
 
 	/*
 	 * Standard binary search.  Note we can ignore the KnownAssignedXidsValid
-	 * array here, since even invalid entries will contain sorted XIDs.
+	 * bitmap here, since even invalid entries will contain sorted XIDs.
 	 */
 	first = tail;
 	last = head - 1;
@@ -4890,12 +5119,12 @@ KnownAssignedXidsSearch(TransactionId xid, bool remove)
 	if (result_index < 0)
 		return false;			/* not in array */
 
-	if (!KnownAssignedXidsValid[result_index])
+	if (!KnownAssignedXidIsValid(result_index))
 		return false;			/* in array, but invalid */
 
 	if (remove)
 	{
-		KnownAssignedXidsValid[result_index] = false;
+		KnownAssignedXidSetValid(result_index, false);
 
 		pArray->numKnownAssignedXids--;
 		Assert(pArray->numKnownAssignedXids >= 0);
@@ -4906,9 +5135,7 @@ KnownAssignedXidsSearch(TransactionId xid, bool remove)
 		 */
 		if (result_index == tail)
 		{
-			tail++;
-			while (tail < head && !KnownAssignedXidsValid[tail])
-				tail++;
+			tail = KnownAssignedXidsNextValid(tail + 1, head);
 			if (tail >= head)
 			{
 				/* Array is empty, so we can reset both pointers */
@@ -5017,20 +5244,19 @@ KnownAssignedXidsRemovePreceding(TransactionId removeXid)
 	tail = pArray->tailKnownAssignedXids;
 	head = pArray->headKnownAssignedXids;
 
-	for (i = tail; i < head; i++)
+	for (i = KnownAssignedXidsNextValid(tail, head);
+		 i < head;
+		 i = KnownAssignedXidsNextValid(i + 1, head))
 	{
-		if (KnownAssignedXidsValid[i])
-		{
-			TransactionId knownXid = KnownAssignedXids[i];
+		TransactionId knownXid = KnownAssignedXids[i];
 
-			if (TransactionIdFollowsOrEquals(knownXid, removeXid))
-				break;
+		if (TransactionIdFollowsOrEquals(knownXid, removeXid))
+			break;
 
-			if (!StandbyTransactionIdIsPrepared(knownXid))
-			{
-				KnownAssignedXidsValid[i] = false;
-				count++;
-			}
+		if (!StandbyTransactionIdIsPrepared(knownXid))
+		{
+			KnownAssignedXidSetValid(i, false);
+			count++;
 		}
 	}
 
@@ -5040,11 +5266,7 @@ KnownAssignedXidsRemovePreceding(TransactionId removeXid)
 	/*
 	 * Advance the tail pointer if we've marked the tail item invalid.
 	 */
-	for (i = tail; i < head; i++)
-	{
-		if (KnownAssignedXidsValid[i])
-			break;
-	}
+	i = KnownAssignedXidsNextValid(tail, head);
 	if (i >= head)
 	{
 		/* Array is empty, so we can reset both pointers */
@@ -5104,32 +5326,31 @@ KnownAssignedXidsGetAndSetXmin(TransactionId *xarray, TransactionId *xmin,
 
 	pg_read_barrier();			/* pairs with KnownAssignedXidsAdd */
 
-	for (i = tail; i < head; i++)
+	/* Skip any gaps in the array */
+	for (i = KnownAssignedXidsNextValid(tail, head);
+		 i < head;
+		 i = KnownAssignedXidsNextValid(i + 1, head))
 	{
-		/* Skip any gaps in the array */
-		if (KnownAssignedXidsValid[i])
-		{
-			TransactionId knownXid = KnownAssignedXids[i];
+		TransactionId knownXid = KnownAssignedXids[i];
 
-			/*
-			 * Update xmin if required.  Only the first XID need be checked,
-			 * since the array is sorted.
-			 */
-			if (count == 0 &&
-				TransactionIdPrecedes(knownXid, *xmin))
-				*xmin = knownXid;
+		/*
+		 * Update xmin if required.  Only the first XID need be checked, since
+		 * the array is sorted.
+		 */
+		if (count == 0 &&
+			TransactionIdPrecedes(knownXid, *xmin))
+			*xmin = knownXid;
 
-			/*
-			 * Filter out anything >= xmax, again relying on sorted property
-			 * of array.
-			 */
-			if (TransactionIdIsValid(xmax) &&
-				TransactionIdFollowsOrEquals(knownXid, xmax))
-				break;
+		/*
+		 * Filter out anything >= xmax, again relying on sorted property of
+		 * array.
+		 */
+		if (TransactionIdIsValid(xmax) &&
+			TransactionIdFollowsOrEquals(knownXid, xmax))
+			break;
 
-			/* Add knownXid into output array */
-			xarray[count++] = knownXid;
-		}
+		/* Add knownXid into output array */
+		xarray[count++] = knownXid;
 	}
 
 	return count;
@@ -5154,12 +5375,10 @@ KnownAssignedXidsGetOldestXmin(void)
 
 	pg_read_barrier();			/* pairs with KnownAssignedXidsAdd */
 
-	for (i = tail; i < head; i++)
-	{
-		/* Skip any gaps in the array */
-		if (KnownAssignedXidsValid[i])
-			return KnownAssignedXids[i];
-	}
+	/* Skip any gaps in the array */
+	i = KnownAssignedXidsNextValid(tail, head);
+	if (i < head)
+		return KnownAssignedXids[i];
 
 	return InvalidTransactionId;
 }
@@ -5189,13 +5408,12 @@ KnownAssignedXidsDisplay(int trace_level)
 
 	initStringInfo(&buf);
 
-	for (i = tail; i < head; i++)
+	for (i = KnownAssignedXidsNextValid(tail, head);
+		 i < head;
+		 i = KnownAssignedXidsNextValid(i + 1, head))
 	{
-		if (KnownAssignedXidsValid[i])
-		{
-			nxids++;
-			appendStringInfo(&buf, "[%d]=%u ", i, KnownAssignedXids[i]);
-		}
+		nxids++;
+		appendStringInfo(&buf, "[%d]=%u ", i, KnownAssignedXids[i]);
 	}
 
 	elog(trace_level, "%d KnownAssignedXids (num=%d tail=%d head=%d) %s",
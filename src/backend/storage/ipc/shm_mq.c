@@ -110,7 +110,8 @@ struct shm_mq
  *
  * mqh_send_pending, is number of bytes that is written to the queue but not
  * yet updated in the shared memory.  We will not update it until the written
- * data is 1/4th of the ring size or the tuple queue is full.  This will
+ * data is 1/4th of the ring size, the tuple queue is full or the receiver is
+ * sleeping.  This will
  * prevent frequent CPU cache misses, and it will also avoid frequent
  * SetLatch() calls, which are quite expensive.
  *
@@ -533,9 +534,16 @@ shm_mq_sendv(shm_mq_handle *mqh, shm_mq_iovec *iov, int iovcnt, bool nowait,
 	/*
 	 * If the caller has requested force flush or we have written more than
 	 * 1/4 of the ring size, mark it as written in shared memory and notify
-	 * the receiver.
+	 * the receiver.  Do so as well if the receiver seems to be sleeping,
+	 * presumably waiting for data: holding back what we've written would
+	 * only leave it idle.  A busy receiver thus gets woken up rarely, while
+	 * an idle one gets the data without delay.  maybe_sleeping is read
+	 * without any barrier, but it's only a hint; if we miss that the receiver
+	 * went to sleep, it gets the data later, as it would otherwise.
 	 */
-	if (force_flush || mqh->mqh_send_pending > (mq->mq_ring_size >> 2))
+	if (force_flush || mqh->mqh_send_pending > (mq->mq_ring_size >> 2) ||
+		(receiver != NULL && mqh->mqh_send_pending > 0 &&
+		 receiver->procLatch.maybe_sleeping))
 	{
 		shm_mq_inc_bytes_written(mq, mqh->mqh_send_pending);
 		if (receiver != NULL)
@@ -19,6 +19,7 @@
 #include "storage/latch.h"
 #include "storage/sinvaladt.h"
 #include "utils/inval.h"
+#include "utils/sharedcatcache.h"
 
 
 uint64		SharedInvalidMessageCounter;
@@ -46,6 +47,8 @@ volatile sig_atomic_t catchupInterruptPending = false;
 void
 SendSharedInvalidMessages(const SharedInvalidationMessage *msgs, int n)
 {
+	/* Shared catalog cache entries must be gone before anyone sees these */
+	SharedCatCacheInvalidate(msgs, n);
 	SIInsertDataEntries(msgs, n);
 }
 
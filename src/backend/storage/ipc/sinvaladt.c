@@ -18,6 +18,7 @@
 #include <unistd.h>
 
 #include "miscadmin.h"
+#include "port/pg_bitutils.h"
 #include "storage/ipc.h"
 #include "storage/proc.h"
 #include "storage/procnumber.h"
@@ -41,12 +42,11 @@
  * smallest nextMsgNum --- it may lag behind.  We only update it when
  * SICleanupQueue is called, and we try not to do that often.)
  *
- * In reality, the messages are stored in a circular buffer of MAXNUMMESSAGES
- * entries.  We translate MsgNum values into circular-buffer indexes by
- * computing MsgNum % MAXNUMMESSAGES (this should be fast as long as
- * MAXNUMMESSAGES is a constant and a power of 2).  As long as maxMsgNum
- * doesn't exceed minMsgNum by more than MAXNUMMESSAGES, we have enough space
- * in the buffer.  If the buffer does overflow, we recover by setting the
+ * In reality, the messages are stored in a circular buffer of queueSize
+ * entries, invalidation_queue_size rounded up to a power of 2.  We translate
+ * MsgNum values into circular-buffer indexes by masking off the high bits
+ * of MsgNum.  As long as maxMsgNum doesn't exceed minMsgNum by more than
+ * queueSize, we have enough space in the buffer.  If the buffer does overflow, we recover by setting the
  * "reset" flag for each backend that has fallen too far behind.  A backend
  * that is in "reset" state is ignored while determining minMsgNum.  When
  * it does finally attempt to receive inval messages, it must discard all
@@ -68,12 +68,21 @@
  * of "stuck" backends, we won't need a lot of extra interrupts, since ones
  * that aren't stuck will propagate their interrupts to the next guy.
  *
+ * Most messages concern a single database, and only backends connected to
+ * that database act on them.  Before signaling or resetting a backend that
+ * has fallen far behind, SICleanupQueue advances it past any messages at the
+ * head of its part of the queue that are about other databases, as it would
+ * have ignored them anyway.  That way, idle backends connected to databases
+ * other than the one where DDL is happening don't hold up the queue, and
+ * neither need to be woken up to catch up nor lose their caches in a reset.
+ * Readers skip such messages too.
+ *
  * We would have problems if the MsgNum values overflow an integer, so
  * whenever minMsgNum exceeds MSGNUMWRAPAROUND, we subtract MSGNUMWRAPAROUND
  * from all the MsgNum variables simultaneously.  MSGNUMWRAPAROUND can be
  * large so that we don't need to do this often.  It must be a multiple of
- * MAXNUMMESSAGES so that the existing circular-buffer entries don't need
- * to be moved when we do it.
+ * queueSize so that the existing circular-buffer entries don't need to be
+ * moved when we do it.
  *
  * Access to the shared sinval array is protected by two locks, SInvalReadLock
  * and SInvalWriteLock.  Readers take SInvalReadLock in shared mode; this
@@ -105,11 +114,11 @@
 /*
  * Configurable parameters.
  *
- * MAXNUMMESSAGES: max number of shared-inval messages we can buffer.
- * Must be a power of 2 for speed.
+ * queueSize (in SISeg): max number of shared-inval messages we can buffer.
+ * Set from invalidation_queue_size, rounded up to a power of 2 for speed.
  *
  * MSGNUMWRAPAROUND: how often to reduce MsgNum variables to avoid overflow.
- * Must be a multiple of MAXNUMMESSAGES.  Should be large.
+ * Must be a multiple of queueSize.  Should be large.
  *
  * CLEANUP_MIN: the minimum number of messages that must be in the buffer
  * before we bother to call SICleanupQueue.
@@ -126,13 +135,22 @@
  * per iteration.
  */
 
-#define MAXNUMMESSAGES 4096
-#define MSGNUMWRAPAROUND (MAXNUMMESSAGES * 262144)
-#define CLEANUP_MIN (MAXNUMMESSAGES / 2)
-#define CLEANUP_QUANTUM (MAXNUMMESSAGES / 16)
-#define SIG_THRESHOLD (MAXNUMMESSAGES / 2)
+#define MAXQUEUESIZE (1 << 20)	/* must match the maximum of the GUC */
+#define MSGNUMWRAPAROUND (1 << 30)
+#define CLEANUP_MIN(segP) ((segP)->queueSize / 2)
+#define CLEANUP_QUANTUM(segP) ((segP)->queueSize / 16)
+#define SIG_THRESHOLD(segP) ((segP)->queueSize / 2)
 #define WRITE_QUANTUM 64
 
+StaticAssertDecl(MSGNUMWRAPAROUND % MAXQUEUESIZE == 0,
+				 "MSGNUMWRAPAROUND must be a multiple of the queue size");
+
+/* Translate a MsgNum into an index into the circular buffer */
+#define SIBufferIndex(segP, msgnum) ((msgnum) & ((segP)->queueSize - 1))
+
+/* GUC parameter */
+int			invalidation_queue_size = 4096;
+
 /* Per-backend state in shared invalidation structure */
 typedef struct ProcState
 {
@@ -170,13 +188,15 @@ typedef struct SISeg
 	int			minMsgNum;		/* oldest message still needed */
 	int			maxMsgNum;		/* next message number to be assigned */
 	int			nextThreshold;	/* # of messages to call SICleanupQueue */
+	int			queueSize;		/* # of entries in buffer, a power of 2 */
 
 	slock_t		msgnumLock;		/* spinlock protecting maxMsgNum */
 
 	/*
-	 * Circular buffer holding shared-inval messages
+	 * Circular buffer holding shared-inval messages, allocated after the
+	 * procState array
 	 */
-	SharedInvalidationMessage buffer[MAXNUMMESSAGES];
+	SharedInvalidationMessage *buffer;
 
 	/*
 	 * Per-backend invalidation state info.
@@ -211,6 +231,51 @@ static LocalTransactionId nextLocalTransactionId;
 static void CleanupInvalidationState(int status, Datum arg);
 
 
+/*
+ * Number of entries in the circular buffer
+ */
+static int
+SIQueueSize(void)
+{
+	return (int) pg_nextpower2_32(Min(invalidation_queue_size, MAXQUEUESIZE));
+}
+
+/*
+ * SIMessageIsForDatabase
+ *		Does a backend connected to database dbid need to see msg?
+ *
+ * Only messages about the backend's own database and about shared catalogs
+ * matter to it, as in LocalExecuteInvalidationMessage, except that smgr
+ * messages are about physical files that any backend might have open.  An
+ * invalid dbid means the backend isn't connected to a database (yet), in
+ * which case we don't try to be selective.
+ */
+static inline bool
+SIMessageIsForDatabase(const SharedInvalidationMessage *msg, Oid dbid)
+{
+	Oid			msgdbid;
+
+	if (!OidIsValid(dbid))
+		return true;
+
+	if (msg->id >= 0)
+		msgdbid = msg->cc.dbId;
+	else if (msg->id == SHAREDINVALCATALOG_ID)
+		msgdbid = msg->cat.dbId;
+	else if (msg->id == SHAREDINVALRELCACHE_ID)
+		msgdbid = msg->rc.dbId;
+	else if (msg->id == SHAREDINVALRELMAP_ID)
+		msgdbid = msg->rm.dbId;
+	else if (msg->id == SHAREDINVALSNAPSHOT_ID)
+		msgdbid = msg->sn.dbId;
+	else if (msg->id == SHAREDINVALRELSYNC_ID)
+		msgdbid = msg->rs.dbId;
+	else
+		return true;
+
+	return msgdbid == dbid || msgdbid == InvalidOid;
+}
+
 /*
  * SharedInvalShmemSize --- return shared-memory space needed
  */
@@ -222,6 +287,9 @@ SharedInvalShmemSize(void)
 	size = offsetof(SISeg, procState);
 	size = add_size(size, mul_size(sizeof(ProcState), NumProcStateSlots));	/* procState */
 	size = add_size(size, mul_size(sizeof(int), NumProcStateSlots));	/* pgprocnos */
+	size = MAXALIGN(size);
+	size = add_size(size, mul_size(sizeof(SharedInvalidationMessage),
+								   SIQueueSize()));	/* buffer */
 
 	return size;
 }
@@ -245,7 +313,8 @@ SharedInvalShmemInit(void)
 	/* Clear message counters, save size of procState array, init spinlock */
 	shmInvalBuffer->minMsgNum = 0;
 	shmInvalBuffer->maxMsgNum = 0;
-	shmInvalBuffer->nextThreshold = CLEANUP_MIN;
+	shmInvalBuffer->queueSize = SIQueueSize();
+	shmInvalBuffer->nextThreshold = CLEANUP_MIN(shmInvalBuffer);
 	SpinLockInit(&shmInvalBuffer->msgnumLock);
 
 	/* The buffer[] array is initially all unused, so we need not fill it */
@@ -262,6 +331,8 @@ SharedInvalShmemInit(void)
 	}
 	shmInvalBuffer->numProcs = 0;
 	shmInvalBuffer->pgprocnos = (int *) &shmInvalBuffer->procState[i];
+	shmInvalBuffer->buffer = (SharedInvalidationMessage *)
+		MAXALIGN(&shmInvalBuffer->pgprocnos[NumProcStateSlots]);
 }
 
 /*
@@ -401,7 +472,7 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
 		for (;;)
 		{
 			numMsgs = segP->maxMsgNum - segP->minMsgNum;
-			if (numMsgs + nthistime > MAXNUMMESSAGES ||
+			if (numMsgs + nthistime > segP->queueSize ||
 				numMsgs >= segP->nextThreshold)
 				SICleanupQueue(true, nthistime);
 			else
@@ -414,7 +485,7 @@ SIInsertDataEntries(const SharedInvalidationMessage *data, int n)
 		max = segP->maxMsgNum;
 		while (nthistime-- > 0)
 		{
-			segP->buffer[max % MAXNUMMESSAGES] = *data++;
+			segP->buffer[SIBufferIndex(segP, max)] = *data++;
 			max++;
 		}
 
@@ -528,7 +599,8 @@ SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
 
 	/*
 	 * Retrieve messages and advance backend's counter, until data array is
-	 * full or there are no more messages.
+	 * full or there are no more messages.  Messages about other databases
+	 * are skipped over.
 	 *
 	 * There may be other backends that haven't read the message(s), so we
 	 * cannot delete them here.  SICleanupQueue() will eventually remove them
@@ -537,7 +609,11 @@ SIGetDataEntries(SharedInvalidationMessage *data, int datasize)
 	n = 0;
 	while (n < datasize && stateP->nextMsgNum < max)
 	{
-		data[n++] = segP->buffer[stateP->nextMsgNum % MAXNUMMESSAGES];
+		SharedInvalidationMessage *msg;
+
+		msg = &segP->buffer[SIBufferIndex(segP, stateP->nextMsgNum)];
+		if (SIMessageIsForDatabase(msg, MyDatabaseId))
+			data[n++] = *msg;
 		stateP->nextMsgNum++;
 	}
 
@@ -597,8 +673,8 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 	 * a problem even when they are the only active backend.
 	 */
 	min = segP->maxMsgNum;
-	minsig = min - SIG_THRESHOLD;
-	lowbound = min - MAXNUMMESSAGES + minFree;
+	minsig = min - SIG_THRESHOLD(segP);
+	lowbound = min - segP->queueSize + minFree;
 
 	for (i = 0; i < segP->numProcs; i++)
 	{
@@ -610,6 +686,24 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 		if (stateP->resetState || stateP->sendOnly)
 			continue;
 
+		/*
+		 * If this backend is far enough behind to need signaling or a reset,
+		 * first skip it past messages about other databases, which it would
+		 * ignore anyway.  Its PGPROC's databaseId is set once it is connected
+		 * to a database, and never changes after that.  (It is safe for us to
+		 * change its nextMsgNum, as we hold SInvalReadLock exclusively.)
+		 */
+		if (n < minsig)
+		{
+			Oid			dbid = GetPGProcByNumber(segP->pgprocnos[i])->databaseId;
+
+			while (n < segP->maxMsgNum &&
+				   !SIMessageIsForDatabase(&segP->buffer[SIBufferIndex(segP, n)],
+										   dbid))
+				n++;
+			stateP->nextMsgNum = n;
+		}
+
 		/*
 		 * If we must free some space and this backend is preventing it, force
 		 * him into reset state and then ignore until he catches up.
@@ -652,10 +746,11 @@ SICleanupQueue(bool callerHasWriteLock, int minFree)
 	 * threshold at which we should repeat SICleanupQueue().
 	 */
 	numMsgs = segP->maxMsgNum - segP->minMsgNum;
-	if (numMsgs < CLEANUP_MIN)
-		segP->nextThreshold = CLEANUP_MIN;
+	if (numMsgs < CLEANUP_MIN(segP))
+		segP->nextThreshold = CLEANUP_MIN(segP);
 	else
-		segP->nextThreshold = (numMsgs / CLEANUP_QUANTUM + 1) * CLEANUP_QUANTUM;
+		segP->nextThreshold = (numMsgs / CLEANUP_QUANTUM(segP) + 1) *
+			CLEANUP_QUANTUM(segP);
 
 	/*
 	 * Lastly, signal anyone who needs a catchup interrupt.  Since
@@ -880,7 +880,12 @@ LockAcquireExtended(const LOCKTAG *locktag,
 
 	/* Identify owner for lock */
 	if (sessionLock)
+	{
 		owner = NULL;
+		/* Session-level advisory locks tie the session to this backend */
+		if (lockmethodid == USER_LOCKMETHOD)
+			MySessionPinned = true;
+	}
 	else
 		owner = CurrentResourceOwner;
 
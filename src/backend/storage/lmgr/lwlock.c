@@ -72,6 +72,37 @@
  *
  * This protects us against the problem from above as nobody can release too
  *	  quick, before we're queued, since after Phase 2 we're already queued.
+ *
+ *
+ * Queued tranches
+ *
+ * Under heavy contention, the scheme above makes all waiters retry: every
+ * release wakes up waiters that then race each other, and newly arriving
+ * lockers, for the lock word, and most of them go back to sleep.  On big
+ * machines that traffic on a single cache line can dominate.  The tranches
+ * listed in lwlock_queued_tranches therefore use a strict FIFO protocol
+ * instead:
+ *
+ * - A locker never takes the lock while anyone is waiting for it, even if
+ *	 it's free for the moment.  Checking for that and setting
+ *	 LW_FLAG_HAS_WAITERS happen in one atomic operation, with the wait list
+ *	 locked, so there is no window in which the lock can be released without
+ *	 the releaser noticing the new waiter.
+ *
+ * - The last releaser hands the lock directly to the waiters at the head of
+ *	 the queue: one exclusive waiter, or all shared waiters up to the next
+ *	 exclusive one.  The lock state is updated on their behalf, so they never
+ *	 retry.  LW_WAIT_UNTIL_FREE waiters are woken without being granted.
+ *
+ * - Waiters briefly spin on their own PGPROC, rather than on the lock, before
+ *	 going to sleep on their semaphore; as in MCS locks, there's no shared
+ *	 cache line being polled.
+ *
+ * Once somebody waits, every holder has to lock the wait list to release
+ * the lock, so the lock's state can't change under a releaser holding it.
+ * The price of fairness is that a lock is not reacquired by a process that
+ * still has a time slice left, so this is only worthwhile for locks that are
+ * contended by many processes at once.  LWLockWaitForVar() is not supported.
  * -------------------------------------------------------------------------
  */
 #include "postgres.h"
@@ -84,7 +115,9 @@
 #include "storage/proclist.h"
 #include "storage/procnumber.h"
 #include "storage/spin.h"
+#include "utils/guc_hooks.h"
 #include "utils/memutils.h"
+#include "utils/varlena.h"
 
 #ifdef LWLOCK_STATS
 #include "utils/hsearch.h"
@@ -160,6 +193,15 @@ char	  **LWLockTrancheNames = NULL;
  */
 LWLockPadded *MainLWLockArray = NULL;
 
+/*
+ * Built-in tranches that use queued locking, per lwlock_queued_tranches.
+ * The setting can only change at server start, so all processes agree.
+ */
+static bool LWLockTrancheQueued[LWTRANCHE_FIRST_USER_DEFINED];
+
+/* How often a waiter for a queued lock checks for it before sleeping */
+#define LWLOCK_QUEUED_SPINS	1000
+
 /*
  * We use this structure to keep track of locked LWLocks for release
  * during error recovery.  Normally, only a few will be held at once, but
@@ -201,8 +243,6 @@ int		   *LWLockCounter = NULL;
 /* backend-local counter of registered tranches */
 static int	LocalLWLockCounter;
 
-#define MAX_NAMED_TRANCHES 256
-
 static void InitializeLWLocks(void);
 static inline void LWLockReportWaitStart(LWLock *lock);
 static inline void LWLockReportWaitEnd(void);
@@ -730,6 +770,17 @@ LWLockReportWaitEnd(void)
 	pgstat_report_wait_end();
 }
 
+/*
+ * Count an acquisition of a light-weight lock in the cumulative statistics.
+ * This is done on every acquisition, so keep it cheap.
+ */
+static inline void
+LWLockCountAcquire(LWLock *lock)
+{
+	if (likely(lock->tranche < NUM_LWLOCK_TRANCHES))
+		PendingLWLockStats[lock->tranche].acquisitions++;
+}
+
 /*
  * Return the name of an LWLock tranche.
  */
@@ -849,6 +900,74 @@ LWLockAttemptLock(LWLock *lock, LWLockMode mode)
 	pg_unreachable();
 }
 
+/*
+ * Does the lock belong to a tranche that uses queued locking?
+ */
+static inline bool
+LWLockIsQueued(LWLock *lock)
+{
+	return lock->tranche < LWTRANCHE_FIRST_USER_DEFINED &&
+		LWLockTrancheQueued[lock->tranche];
+}
+
+/*
+ * Like LWLockAttemptLock(), for locks of queued tranches.
+ *
+ * The lock is not acquired while anybody is waiting for it, even if it is
+ * free for the moment.  If 'set_waiters' is true, the caller must hold the
+ * wait list lock, and LW_FLAG_HAS_WAITERS is set in the same atomic operation
+ * if the lock can't be acquired; the caller must then queue itself.
+ *
+ * Returns true if the lock isn't free and we need to wait.
+ */
+static bool
+LWLockAttemptLockQueued(LWLock *lock, LWLockMode mode, bool set_waiters)
+{
+	uint32		old_state;
+
+	Assert(mode == LW_EXCLUSIVE || mode == LW_SHARED);
+
+	old_state = pg_atomic_read_u32(&lock->state);
+
+	while (true)
+	{
+		uint32		desired_state;
+		bool		lock_free;
+
+		desired_state = old_state;
+
+		if (old_state & LW_FLAG_HAS_WAITERS)
+			lock_free = false;
+		else if (mode == LW_EXCLUSIVE)
+			lock_free = (old_state & LW_LOCK_MASK) == 0;
+		else
+			lock_free = (old_state & LW_VAL_EXCLUSIVE) == 0;
+
+		if (lock_free)
+			desired_state += (mode == LW_EXCLUSIVE) ?
+				LW_VAL_EXCLUSIVE : LW_VAL_SHARED;
+		else if (set_waiters)
+			desired_state |= LW_FLAG_HAS_WAITERS;
+
+		/* As in LWLockAttemptLock, always swap to get a memory barrier */
+		if (pg_atomic_compare_exchange_u32(&lock->state,
+										   &old_state, desired_state))
+		{
+			if (lock_free)
+			{
+#ifdef LOCK_DEBUG
+				if (mode == LW_EXCLUSIVE)
+					lock->owner = MyProc;
+#endif
+				return false;
+			}
+			else
+				return true;
+		}
+	}
+	pg_unreachable();
+}
+
 /*
  * Lock the LWLock's wait list against concurrent activity.
  *
@@ -861,9 +980,9 @@ static void
 LWLockWaitListLock(LWLock *lock)
 {
 	uint32		old_state;
+	uint32		delays = 0;
 #ifdef LWLOCK_STATS
 	lwlock_stats *lwstats;
-	uint32		delays = 0;
 
 	lwstats = get_lwlock_stats_entry(lock);
 #endif
@@ -890,9 +1009,7 @@ LWLockWaitListLock(LWLock *lock)
 				perform_spin_delay(&delayStatus);
 				old_state = pg_atomic_read_u32(&lock->state);
 			}
-#ifdef LWLOCK_STATS
 			delays += delayStatus.delays;
-#endif
 			finish_spin_delay(&delayStatus);
 		}
 
@@ -902,6 +1019,9 @@ LWLockWaitListLock(LWLock *lock)
 		 */
 	}
 
+	if (unlikely(delays > 0))
+		pgstat_count_lwlock_spin_delays(lock->tranche, delays);
+
 #ifdef LWLOCK_STATS
 	lwstats->spin_delay_count += delays;
 #endif
@@ -1166,6 +1286,165 @@ LWLockDequeueSelf(LWLock *lock)
 #endif
 }
 
+/*
+ * Acquire a lock of a queued tranche, or add ourselves to its queue.
+ *
+ * 'waitmode' is the mode to queue ourselves with, either 'mode' or
+ * LW_WAIT_UNTIL_FREE.  Returns true if we have been queued, in which case
+ * the lock will be handed to us (unless LW_WAIT_UNTIL_FREE) by whoever
+ * releases it last.
+ */
+static bool
+LWLockAttemptLockOrQueueSelf(LWLock *lock, LWLockMode mode,
+							 LWLockMode waitmode)
+{
+	bool		mustwait;
+
+	/* See LWLockQueueSelf */
+	if (MyProc == NULL)
+		elog(PANIC, "cannot wait without a PGPROC structure");
+
+	if (MyProc->lwWaiting != LW_WS_NOT_WAITING)
+		elog(PANIC, "queueing for lock while waiting on another one");
+
+	LWLockWaitListLock(lock);
+
+	mustwait = LWLockAttemptLockQueued(lock, mode, true);
+	if (mustwait)
+	{
+		MyProc->lwWaiting = LW_WS_WAITING;
+		MyProc->lwWaitMode = waitmode;
+
+		if (waitmode == LW_WAIT_UNTIL_FREE)
+			proclist_push_head(&lock->waiters, MyProcNumber, lwWaitLink);
+		else
+			proclist_push_tail(&lock->waiters, MyProcNumber, lwWaitLink);
+	}
+
+	LWLockWaitListUnlock(lock);
+
+#ifdef LOCK_DEBUG
+	if (mustwait)
+		pg_atomic_fetch_add_u32(&lock->nwaiters, 1);
+#endif
+
+	return mustwait;
+}
+
+/*
+ * Spin for a while on our own PGPROC, waiting to be granted a queued lock.
+ *
+ * The caller must still absorb the wakeup from the semaphore afterwards;
+ * if we were granted the lock, that won't block for long.
+ */
+static void
+LWLockSpinQueued(PGPROC *proc)
+{
+	volatile PGPROC *vproc = proc;
+
+	for (int i = 0; i < LWLOCK_QUEUED_SPINS; i++)
+	{
+		if (vproc->lwWaiting == LW_WS_NOT_WAITING)
+			break;
+		pg_spin_delay();
+	}
+}
+
+/*
+ * Release a lock of a queued tranche, handing it to the next waiters.
+ */
+static void
+LWLockReleaseQueued(LWLock *lock, LWLockMode mode)
+{
+	uint32		lockval;
+	uint32		granted = 0;
+	uint32		old_state;
+	proclist_head wakeup;
+	proclist_mutable_iter iter;
+
+	lockval = (mode == LW_EXCLUSIVE) ? LW_VAL_EXCLUSIVE : LW_VAL_SHARED;
+
+	/* If nobody is waiting, just release the lock */
+	old_state = pg_atomic_read_u32(&lock->state);
+	while (!(old_state & LW_FLAG_HAS_WAITERS))
+	{
+		if (pg_atomic_compare_exchange_u32(&lock->state, &old_state,
+										   old_state - lockval))
+			return;
+	}
+
+	/*
+	 * Somebody is waiting.  Nobody can acquire the lock now, and the other
+	 * holders need the wait list lock to release it, so its state can't
+	 * change while we hold that.
+	 */
+	proclist_init(&wakeup);
+
+	LWLockWaitListLock(lock);
+
+	old_state = pg_atomic_read_u32(&lock->state);
+	Assert(old_state & LW_FLAG_HAS_WAITERS);
+	Assert((old_state & LW_LOCK_MASK) >= lockval);
+
+	/* If we were the last holder, pick the waiters that get the lock next */
+	if (((old_state - lockval) & LW_LOCK_MASK) == 0)
+	{
+		proclist_foreach_modify(iter, &lock->waiters, lwWaitLink)
+		{
+			PGPROC	   *waiter = GetPGProcByNumber(iter.cur);
+
+			/* An exclusive waiter can't share the lock with anyone */
+			if (waiter->lwWaitMode == LW_EXCLUSIVE && granted != 0)
+				break;
+
+			proclist_delete(&lock->waiters, iter.cur, lwWaitLink);
+			proclist_push_tail(&wakeup, iter.cur, lwWaitLink);
+
+			Assert(waiter->lwWaiting == LW_WS_WAITING);
+			waiter->lwWaiting = LW_WS_PENDING_WAKEUP;
+
+			if (waiter->lwWaitMode == LW_EXCLUSIVE)
+			{
+				granted = LW_VAL_EXCLUSIVE;
+#ifdef LOCK_DEBUG
+				lock->owner = waiter;
+#endif
+				break;
+			}
+			else if (waiter->lwWaitMode == LW_SHARED)
+				granted += LW_VAL_SHARED;
+		}
+	}
+
+	/* release our hold, grant it, and unlock the wait list, all at once */
+	while (true)
+	{
+		uint32		desired_state;
+
+		desired_state = old_state - lockval + granted;
+		if (proclist_is_empty(&lock->waiters))
+			desired_state &= ~LW_FLAG_HAS_WAITERS;
+		desired_state &= ~LW_FLAG_LOCKED;
+
+		if (pg_atomic_compare_exchange_u32(&lock->state, &old_state,
+										   desired_state))
+			break;
+	}
+
+	/* Awaken the waiters I removed from the queue, as in LWLockWakeup */
+	proclist_foreach_modify(iter, &wakeup, lwWaitLink)
+	{
+		PGPROC	   *waiter = GetPGProcByNumber(iter.cur);
+
+		LOG_LWDEBUG("LWLockRelease", lock, "hand over to waiter");
+		proclist_delete(&wakeup, iter.cur, lwWaitLink);
+
+		pg_write_barrier();
+		waiter->lwWaiting = LW_WS_NOT_WAITING;
+		PGSemaphoreUnlock(waiter->sem);
+	}
+}
+
 /*
  * LWLockAcquire - acquire a lightweight lock in the specified mode
  *
@@ -1180,6 +1459,8 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 	PGPROC	   *proc = MyProc;
 	bool		result = true;
 	int			extraWaits = 0;
+	bool		queued;
+	instr_time	wait_start;
 #ifdef LWLOCK_STATS
 	lwlock_stats *lwstats;
 
@@ -1190,6 +1471,16 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 
 	PRINT_LWDEBUG("LWLockAcquire", lock, mode);
 
+	INSTR_TIME_SET_ZERO(wait_start);
+
+	/*
+	 * A backend that already holds a queued lock in shared mode may take it
+	 * again without queueing behind the waiters, which would never be
+	 * granted the lock before it's released.
+	 */
+	queued = LWLockIsQueued(lock) &&
+		!(mode == LW_SHARED && LWLockHeldByMe(lock));
+
 #ifdef LWLOCK_STATS
 	/* Count lock acquisition attempts */
 	if (mode == LW_EXCLUSIVE)
@@ -1231,6 +1522,9 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 	 * outweighs the inefficiency of sometimes wasting a process dispatch
 	 * cycle because the lock is not free when a released waiter finally gets
 	 * to run.  See pgsql-hackers archives for 29-Dec-01.
+	 *
+	 * Queued tranches make the opposite trade-off; see the notes at the top
+	 * of the file.  There, we're only woken up once we own the lock.
 	 */
 	for (;;)
 	{
@@ -1240,7 +1534,10 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 		 * Try to grab the lock the first time, we're not in the waitqueue
 		 * yet/anymore.
 		 */
-		mustwait = LWLockAttemptLock(lock, mode);
+		if (queued)
+			mustwait = LWLockAttemptLockQueued(lock, mode, false);
+		else
+			mustwait = LWLockAttemptLock(lock, mode);
 
 		if (!mustwait)
 		{
@@ -1248,6 +1545,12 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 			break;				/* got the lock */
 		}
 
+		if (queued && !LWLockAttemptLockOrQueueSelf(lock, mode, mode))
+		{
+			LOG_LWDEBUG("LWLockAcquire", lock, "acquired before queueing");
+			break;
+		}
+
 		/*
 		 * Ok, at this point we couldn't grab the lock on the first try. We
 		 * cannot simply queue ourselves to the end of the list and wait to be
@@ -1259,19 +1562,25 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 		 * existed before we checked for the lock.
 		 */
 
-		/* add to the queue */
-		LWLockQueueSelf(lock, mode);
+		if (!queued)
+		{
+			/* add to the queue */
+			LWLockQueueSelf(lock, mode);
 
-		/* we're now guaranteed to be woken up if necessary */
-		mustwait = LWLockAttemptLock(lock, mode);
+			/* we're now guaranteed to be woken up if necessary */
+			mustwait = LWLockAttemptLock(lock, mode);
 
-		/* ok, grabbed the lock the second time round, need to undo queueing */
-		if (!mustwait)
-		{
-			LOG_LWDEBUG("LWLockAcquire", lock, "acquired, undoing queue");
+			/*
+			 * ok, grabbed the lock the second time round, need to undo
+			 * queueing
+			 */
+			if (!mustwait)
+			{
+				LOG_LWDEBUG("LWLockAcquire", lock, "acquired, undoing queue");
 
-			LWLockDequeueSelf(lock);
-			break;
+				LWLockDequeueSelf(lock);
+				break;
+			}
 		}
 
 		/*
@@ -1288,10 +1597,17 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 		lwstats->block_count++;
 #endif
 
+		/* the wait time counts from the first time we sleep */
+		if (result)
+			INSTR_TIME_SET_CURRENT(wait_start);
+
 		LWLockReportWaitStart(lock);
 		if (TRACE_POSTGRESQL_LWLOCK_WAIT_START_ENABLED())
 			TRACE_POSTGRESQL_LWLOCK_WAIT_START(T_NAME(lock), mode);
 
+		if (queued)
+			LWLockSpinQueued(proc);
+
 		for (;;)
 		{
 			PGSemaphoreLock(proc->sem);
@@ -1301,7 +1617,8 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 		}
 
 		/* Retrying, allow LWLockRelease to release waiters again. */
-		pg_atomic_fetch_or_u32(&lock->state, LW_FLAG_RELEASE_OK);
+		if (!queued)
+			pg_atomic_fetch_or_u32(&lock->state, LW_FLAG_RELEASE_OK);
 
 #ifdef LOCK_DEBUG
 		{
@@ -1318,13 +1635,22 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 
 		LOG_LWDEBUG("LWLockAcquire", lock, "awakened");
 
-		/* Now loop back and try to acquire lock again. */
 		result = false;
+
+		/* A queued lock has been handed to us */
+		if (queued)
+			break;
+
+		/* Now loop back and try to acquire lock again. */
 	}
 
 	if (TRACE_POSTGRESQL_LWLOCK_ACQUIRE_ENABLED())
 		TRACE_POSTGRESQL_LWLOCK_ACQUIRE(T_NAME(lock), mode);
 
+	LWLockCountAcquire(lock);
+	if (!result)
+		pgstat_count_lwlock_wait(lock->tranche, wait_start);
+
 	/* Add lock to list of locks held by this backend */
 	held_lwlocks[num_held_lwlocks].lock = lock;
 	held_lwlocks[num_held_lwlocks++].mode = mode;
@@ -1366,7 +1692,10 @@ LWLockConditionalAcquire(LWLock *lock, LWLockMode mode)
 	HOLD_INTERRUPTS();
 
 	/* Check for the lock */
-	mustwait = LWLockAttemptLock(lock, mode);
+	if (LWLockIsQueued(lock))
+		mustwait = LWLockAttemptLockQueued(lock, mode, false);
+	else
+		mustwait = LWLockAttemptLock(lock, mode);
 
 	if (mustwait)
 	{
@@ -1379,6 +1708,8 @@ LWLockConditionalAcquire(LWLock *lock, LWLockMode mode)
 	}
 	else
 	{
+		LWLockCountAcquire(lock);
+
 		/* Add lock to list of locks held by this backend */
 		held_lwlocks[num_held_lwlocks].lock = lock;
 		held_lwlocks[num_held_lwlocks++].mode = mode;
@@ -1408,6 +1739,7 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 	PGPROC	   *proc = MyProc;
 	bool		mustwait;
 	int			extraWaits = 0;
+	bool		queued = LWLockIsQueued(lock);
 #ifdef LWLOCK_STATS
 	lwlock_stats *lwstats;
 
@@ -1433,16 +1765,27 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 	 * NB: We're using nearly the same twice-in-a-row lock acquisition
 	 * protocol as LWLockAcquire(). Check its comments for details.
 	 */
-	mustwait = LWLockAttemptLock(lock, mode);
+	if (queued)
+		mustwait = LWLockAttemptLockQueued(lock, mode, false);
+	else
+		mustwait = LWLockAttemptLock(lock, mode);
 
 	if (mustwait)
 	{
-		LWLockQueueSelf(lock, LW_WAIT_UNTIL_FREE);
+		if (queued)
+			mustwait = LWLockAttemptLockOrQueueSelf(lock, mode,
+													LW_WAIT_UNTIL_FREE);
+		else
+		{
+			LWLockQueueSelf(lock, LW_WAIT_UNTIL_FREE);
 
-		mustwait = LWLockAttemptLock(lock, mode);
+			mustwait = LWLockAttemptLock(lock, mode);
+		}
 
 		if (mustwait)
 		{
+			instr_time	wait_start;
+
 			/*
 			 * Wait until awakened.  Like in LWLockAcquire, be prepared for
 			 * bogus wakeups.
@@ -1453,10 +1796,14 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 			lwstats->block_count++;
 #endif
 
+			INSTR_TIME_SET_CURRENT(wait_start);
 			LWLockReportWaitStart(lock);
 			if (TRACE_POSTGRESQL_LWLOCK_WAIT_START_ENABLED())
 				TRACE_POSTGRESQL_LWLOCK_WAIT_START(T_NAME(lock), mode);
 
+			if (queued)
+				LWLockSpinQueued(proc);
+
 			for (;;)
 			{
 				PGSemaphoreLock(proc->sem);
@@ -1476,10 +1823,11 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 			if (TRACE_POSTGRESQL_LWLOCK_WAIT_DONE_ENABLED())
 				TRACE_POSTGRESQL_LWLOCK_WAIT_DONE(T_NAME(lock), mode);
 			LWLockReportWaitEnd();
+			pgstat_count_lwlock_wait(lock->tranche, wait_start);
 
 			LOG_LWDEBUG("LWLockAcquireOrWait", lock, "awakened");
 		}
-		else
+		else if (!queued)
 		{
 			LOG_LWDEBUG("LWLockAcquireOrWait", lock, "acquired, undoing queue");
 
@@ -1510,6 +1858,7 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 	else
 	{
 		LOG_LWDEBUG("LWLockAcquireOrWait", lock, "succeeded");
+		LWLockCountAcquire(lock);
 		/* Add lock to list of locks held by this backend */
 		held_lwlocks[num_held_lwlocks].lock = lock;
 		held_lwlocks[num_held_lwlocks++].mode = mode;
@@ -1605,6 +1954,9 @@ LWLockWaitForVar(LWLock *lock, pg_atomic_uint64 *valptr, uint64 oldval,
 
 	PRINT_LWDEBUG("LWLockWaitForVar", lock, LW_WAIT_UNTIL_FREE);
 
+	/* see the notes on queued tranches at the top of the file */
+	Assert(!LWLockIsQueued(lock));
+
 	/*
 	 * Lock out cancel/die interrupts while we sleep on the lock.  There is no
 	 * cleanup mechanism to remove us from the wait queue if we got
@@ -1618,6 +1970,7 @@ LWLockWaitForVar(LWLock *lock, pg_atomic_uint64 *valptr, uint64 oldval,
 	for (;;)
 	{
 		bool		mustwait;
+		instr_time	wait_start;
 
 		mustwait = LWLockConflictsWithVar(lock, valptr, oldval, newval,
 										  &result);
@@ -1671,6 +2024,7 @@ LWLockWaitForVar(LWLock *lock, pg_atomic_uint64 *valptr, uint64 oldval,
 		lwstats->block_count++;
 #endif
 
+		INSTR_TIME_SET_CURRENT(wait_start);
 		LWLockReportWaitStart(lock);
 		if (TRACE_POSTGRESQL_LWLOCK_WAIT_START_ENABLED())
 			TRACE_POSTGRESQL_LWLOCK_WAIT_START(T_NAME(lock), LW_EXCLUSIVE);
@@ -1695,6 +2049,7 @@ LWLockWaitForVar(LWLock *lock, pg_atomic_uint64 *valptr, uint64 oldval,
 		if (TRACE_POSTGRESQL_LWLOCK_WAIT_DONE_ENABLED())
 			TRACE_POSTGRESQL_LWLOCK_WAIT_DONE(T_NAME(lock), LW_EXCLUSIVE);
 		LWLockReportWaitEnd();
+		pgstat_count_lwlock_wait(lock->tranche, wait_start);
 
 		LOG_LWDEBUG("LWLockWaitForVar", lock, "awakened");
 
@@ -1836,6 +2191,15 @@ LWLockReleaseInternal(LWLock *lock, LWLockMode mode)
 	uint32		oldstate;
 	bool		check_waiters;
 
+	if (LWLockIsQueued(lock))
+	{
+		LWLockReleaseQueued(lock, mode);
+
+		if (TRACE_POSTGRESQL_LWLOCK_RELEASE_ENABLED())
+			TRACE_POSTGRESQL_LWLOCK_RELEASE(T_NAME(lock));
+		return;
+	}
+
 	/*
 	 * Release my hold on lock, after that it can immediately be acquired by
 	 * others, even if we still have to wakeup other waiters.
@@ -2033,3 +2397,100 @@ LWLockHeldByMeInMode(LWLock *lock, LWLockMode mode)
 	}
 	return false;
 }
+
+/*
+ * LWLockHeldExclusively - test whether anyone holds the lock in exclusive mode
+ *
+ * The answer may be out of date by the time the caller looks at it, so this
+ * is only useful together with some other means of detecting concurrent
+ * activity.
+ */
+bool
+LWLockHeldExclusively(LWLock *lock)
+{
+	return (pg_atomic_read_u32(&lock->state) & LW_VAL_EXCLUSIVE) != 0;
+}
+
+/*
+ * GUC check_hook for lwlock_queued_tranches
+ */
+bool
+check_lwlock_queued_tranches(char **newval, void **extra, GucSource source)
+{
+	char	   *rawstring;
+	List	   *elemlist;
+	bool	   *queued;
+	bool		result = true;
+
+	/* Need a modifiable copy of string */
+	rawstring = pstrdup(*newval);
+
+	if (!SplitIdentifierString(rawstring, ',', &elemlist))
+	{
+		GUC_check_errdetail("Invalid list syntax in parameter \"%s\".",
+							"lwlock_queued_tranches");
+		pfree(rawstring);
+		list_free(elemlist);
+		return false;
+	}
+
+	queued = (bool *) guc_malloc(LOG, sizeof(LWLockTrancheQueued));
+	if (!queued)
+	{
+		pfree(rawstring);
+		list_free(elemlist);
+		return false;
+	}
+	memset(queued, 0, sizeof(LWLockTrancheQueued));
+
+	foreach_ptr(char, item, elemlist)
+	{
+		int			i;
+
+		for (i = 0; i < LWTRANCHE_FIRST_USER_DEFINED; i++)
+		{
+			if (BuiltinTrancheNames[i] != NULL &&
+				pg_strcasecmp(item, BuiltinTrancheNames[i]) == 0)
+				break;
+		}
+
+		if (i == LWTRANCHE_FIRST_USER_DEFINED)
+		{
+			GUC_check_errdetail("Unrecognized LWLock tranche \"%s\".", item);
+			result = false;
+			break;
+		}
+
+		/* WAL insertion locks rely on LWLockWaitForVar() */
+		if (i == LWTRANCHE_WAL_INSERT)
+		{
+			GUC_check_errdetail("LWLock tranche \"%s\" cannot be queued.",
+								BuiltinTrancheNames[i]);
+			result = false;
+			break;
+		}
+
+		queued[i] = true;
+	}
+
+	pfree(rawstring);
+	list_free(elemlist);
+
+	if (!result)
+	{
+		guc_free(queued);
+		return false;
+	}
+
+	*extra = queued;
+	return true;
+}
+
+/*
+ * GUC assign_hook for lwlock_queued_tranches
+ */
+void
+assign_lwlock_queued_tranches(const char *newval, void *extra)
+{
+	memcpy(LWLockTrancheQueued, extra, sizeof(LWLockTrancheQueued));
+}
@@ -4023,6 +4023,7 @@ CheckForSerializableConflictOut(Relation relation, TransactionId xid, Snapshot s
 	SERIALIZABLEXIDTAG sxidtag;
 	SERIALIZABLEXID *sxid;
 	SERIALIZABLEXACT *sxact;
+	LWLockMode	lockmode = LW_SHARED;
 
 	if (!SerializationNeededForRead(relation, snapshot))
 		return;
@@ -4043,9 +4044,14 @@ CheckForSerializableConflictOut(Relation relation, TransactionId xid, Snapshot s
 
 	/*
 	 * Find sxact or summarized info for the top level xid.
+	 *
+	 * Usually there turns out to be nothing to do, which a shared lock is
+	 * enough to find out.  If we do need to change something, we start over
+	 * with an exclusive lock, since things may have changed meanwhile.
 	 */
 	sxidtag.xid = xid;
-	LWLockAcquire(SerializableXactHashLock, LW_EXCLUSIVE);
+restart:
+	LWLockAcquire(SerializableXactHashLock, lockmode);
 	sxid = (SERIALIZABLEXID *)
 		hash_search(SerializableXidHash, &sxidtag, HASH_FIND, NULL);
 	if (!sxid)
@@ -4077,7 +4083,16 @@ CheckForSerializableConflictOut(Relation relation, TransactionId xid, Snapshot s
 						 errdetail_internal("Reason code: Canceled on identification as a pivot, with conflict out to old committed transaction %u.", xid),
 						 errhint("The transaction might succeed if retried.")));
 
-			MySerializableXact->flags |= SXACT_FLAG_SUMMARY_CONFLICT_OUT;
+			if (!SxactHasSummaryConflictOut(MySerializableXact))
+			{
+				if (lockmode != LW_EXCLUSIVE)
+				{
+					LWLockRelease(SerializableXactHashLock);
+					lockmode = LW_EXCLUSIVE;
+					goto restart;
+				}
+				MySerializableXact->flags |= SXACT_FLAG_SUMMARY_CONFLICT_OUT;
+			}
 		}
 
 		/* It's not serializable or otherwise not important. */
@@ -4103,6 +4118,12 @@ CheckForSerializableConflictOut(Relation relation, TransactionId xid, Snapshot s
 	{
 		if (!SxactIsPrepared(sxact))
 		{
+			if (lockmode != LW_EXCLUSIVE)
+			{
+				LWLockRelease(SerializableXactHashLock);
+				lockmode = LW_EXCLUSIVE;
+				goto restart;
+			}
 			sxact->flags |= SXACT_FLAG_DOOMED;
 			LWLockRelease(SerializableXactHashLock);
 			return;
@@ -4148,6 +4169,13 @@ CheckForSerializableConflictOut(Relation relation, TransactionId xid, Snapshot s
 		return;
 	}
 
+	if (lockmode != LW_EXCLUSIVE)
+	{
+		LWLockRelease(SerializableXactHashLock);
+		lockmode = LW_EXCLUSIVE;
+		goto restart;
+	}
+
 	/*
 	 * Flag the conflict.  But first, if this conflict creates a dangerous
 	 * structure, ereport an error.
@@ -4169,6 +4197,8 @@ CheckTargetForConflictsIn(PREDICATELOCKTARGETTAG *targettag)
 	PREDICATELOCK *mypredlock = NULL;
 	PREDICATELOCKTAG mypredlocktag;
 	dlist_mutable_iter iter;
+	dlist_iter	liter;
+	bool		others;
 
 	Assert(MySerializableXact != InvalidSerializableXact);
 
@@ -4189,11 +4219,31 @@ CheckTargetForConflictsIn(PREDICATELOCKTARGETTAG *targettag)
 		return;
 	}
 
+	/*
+	 * Often, such as when a transaction updates a row it has read before, the
+	 * only locks on the target are our own.  We can see that without
+	 * SerializableXactHashLock, as the partition lock protects the list of
+	 * locks on the target.
+	 */
+	others = false;
+	dlist_foreach(liter, &target->predicateLocks)
+	{
+		PREDICATELOCK *predlock =
+			dlist_container(PREDICATELOCK, targetLink, liter.cur);
+
+		if (predlock->tag.myXact != MySerializableXact)
+		{
+			others = true;
+			break;
+		}
+	}
+
 	/*
 	 * Each lock for an overlapping transaction represents a conflict: a
 	 * rw-dependency in to this transaction.
 	 */
-	LWLockAcquire(SerializableXactHashLock, LW_SHARED);
+	if (others)
+		LWLockAcquire(SerializableXactHashLock, LW_SHARED);
 
 	dlist_foreach_modify(iter, &target->predicateLocks)
 	{
@@ -4246,7 +4296,8 @@ CheckTargetForConflictsIn(PREDICATELOCKTARGETTAG *targettag)
 			LWLockAcquire(SerializableXactHashLock, LW_SHARED);
 		}
 	}
-	LWLockRelease(SerializableXactHashLock);
+	if (others)
+		LWLockRelease(SerializableXactHashLock);
 	LWLockRelease(partitionLock);
 
 	/*
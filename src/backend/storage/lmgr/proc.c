@@ -225,6 +225,7 @@ InitProcGlobal(void)
 	ProcGlobal->checkpointerProc = INVALID_PROC_NUMBER;
 	pg_atomic_init_u32(&ProcGlobal->procArrayGroupFirst, INVALID_PROC_NUMBER);
 	pg_atomic_init_u32(&ProcGlobal->clogGroupFirst, INVALID_PROC_NUMBER);
+	pg_atomic_init_u32(&ProcGlobal->walGroupFirst, INVALID_PROC_NUMBER);
 
 	/*
 	 * Create and initialize all the PGPROC structures we'll need.  There are
@@ -368,6 +369,8 @@ InitProcGlobal(void)
 		 */
 		pg_atomic_init_u32(&(proc->procArrayGroupNext), INVALID_PROC_NUMBER);
 		pg_atomic_init_u32(&(proc->clogGroupNext), INVALID_PROC_NUMBER);
+		pg_atomic_init_u32(&(proc->walGroupNext), INVALID_PROC_NUMBER);
+		pg_atomic_init_u32(&(proc->walGroupDone), 0);
 		pg_atomic_init_u64(&(proc->waitStart), 0);
 	}
 
@@ -2073,3 +2076,39 @@ BecomeLockGroupMember(PGPROC *leader, int pid)
 
 	return ok;
 }
+
+/*
+ * LeaveLockGroup -- leave the lock group joined with BecomeLockGroupMember(),
+ * without exiting.
+ *
+ * The caller must not hold any heavyweight locks.  Returns false, leaving
+ * the group alone, if the leader has already exited and we're its last
+ * member; in that case we must exit, so that ProcKill() returns the
+ * leader's PGPROC.
+ */
+bool
+LeaveLockGroup(void)
+{
+	PGPROC	   *leader = MyProc->lockGroupLeader;
+	LWLock	   *leader_lwlock;
+	bool		ok = false;
+
+	Assert(leader != NULL && leader != MyProc);
+
+	leader_lwlock = LockHashPartitionLockByProc(leader);
+	LWLockAcquire(leader_lwlock, LW_EXCLUSIVE);
+	dlist_delete(&MyProc->lockGroupLink);
+	if (dlist_is_empty(&leader->lockGroupMembers))
+	{
+		/* The leader is gone; stay put, and let ProcKill() clean up */
+		dlist_push_tail(&leader->lockGroupMembers, &MyProc->lockGroupLink);
+	}
+	else
+	{
+		MyProc->lockGroupLeader = NULL;
+		ok = true;
+	}
+	LWLockRelease(leader_lwlock);
+
+	return ok;
+}
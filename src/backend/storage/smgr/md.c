@@ -36,6 +36,7 @@
 #include "storage/bufmgr.h"
 #include "storage/fd.h"
 #include "storage/md.h"
+#include "storage/pagecompress.h"
 #include "storage/relfilelocator.h"
 #include "storage/smgr.h"
 #include "storage/sync.h"
@@ -96,6 +97,9 @@ typedef struct _MdfdVec
 
 static MemoryContext MdCxt;		/* context for all MdfdVec objects */
 
+/* Space for the compressed image of a page being written */
+static PGIOAlignedBlock md_compress_buf;
+
 
 /* Populate a file tag describing an md.c segment file. */
 #define INIT_MD_FILETAG(a,xx_rlocator,xx_forknum,xx_segno) \
@@ -162,6 +166,9 @@ static MdfdVec *_mdfd_getseg(SMgrRelation reln, ForkNumber forknum,
 							 BlockNumber blkno, bool skipFsync, int behavior);
 static BlockNumber _mdnblocks(SMgrRelation reln, ForkNumber forknum,
 							  MdfdVec *seg);
+static inline bool md_page_compressible(SMgrRelation reln, ForkNumber forknum,
+										const void *buffer);
+static void md_punch_hole(MdfdVec *seg, BlockNumber blocknum, int stored);
 
 static PgAioResult md_readv_complete(PgAioHandle *ioh, PgAioResult prior_result, uint8 cb_data);
 static void md_readv_report(PgAioResult result, const PgAioTargetData *td, int elevel);
@@ -489,6 +496,7 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 {
 	pgoff_t		seekpos;
 	int			nbytes;
+	int			stored = BLCKSZ;
 	MdfdVec    *v;
 
 	/* If this build supports direct I/O, the buffer must be I/O aligned. */
@@ -519,6 +527,13 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 
 	Assert(seekpos < (pgoff_t) BLCKSZ * RELSEG_SIZE);
 
+	if (md_page_compressible(reln, forknum, buffer))
+	{
+		stored = PageCompress(buffer, md_compress_buf.data, blocknum);
+		if (stored < BLCKSZ)
+			buffer = md_compress_buf.data;
+	}
+
 	if ((nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_EXTEND)) != BLCKSZ)
 	{
 		if (nbytes < 0)
@@ -536,6 +551,9 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 				 errhint("Check free disk space.")));
 	}
 
+	if (stored < BLCKSZ)
+		md_punch_hole(v, blocknum, stored);
+
 	if (!skipFsync && !SmgrIsTemp(reln))
 		register_dirty_segment(reln, forknum, v);
 
@@ -773,6 +791,45 @@ mdprefetch(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	return true;
 }
 
+/*
+ * Should the given page be compressed when written?
+ *
+ * Only pages of the main fork of permanent or unlogged relations are
+ * compressed, either because the relation asks for it or because the page
+ * was compressed before.  See pagecompress.c.
+ */
+static inline bool
+md_page_compressible(SMgrRelation reln, ForkNumber forknum, const void *buffer)
+{
+	if (forknum != MAIN_FORKNUM || SmgrIsTemp(reln))
+		return false;
+
+	return reln->smgr_compress ||
+		(((const PageHeaderData *) buffer)->pd_flags & PD_COMPRESSED) != 0;
+}
+
+/*
+ * Deallocate the part of a block's slot that a compressed page image, of
+ * which 'stored' bytes are significant, doesn't need.
+ *
+ * Failure is not an error: the unused part of the slot holds zeroes either
+ * way, we just don't save the space.
+ */
+static void
+md_punch_hole(MdfdVec *seg, BlockNumber blocknum, int stored)
+{
+	pgoff_t		seekpos;
+
+	seekpos = (pgoff_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+	if (FilePunchHole(seg->mdfd_vfd, seekpos + stored, BLCKSZ - stored,
+					  WAIT_EVENT_DATA_FILE_WRITE) < 0)
+		ereport(DEBUG1,
+				(errcode_for_file_access(),
+				 errmsg_internal("could not deallocate space of block %u in file \"%s\": %m",
+								 blocknum, FilePathName(seg->mdfd_vfd))));
+}
+
 /*
  * Convert an array of buffer address into an array of iovec objects, and
  * return the number that were required.  'iov' must have enough space for up
@@ -972,6 +1029,13 @@ mdreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 			iovcnt = compute_remaining_iovec(iov, iov, iovcnt, nbytes);
 		}
 
+		/*
+		 * Replace compressed page images with the pages.  A page that can't
+		 * be decompressed is left alone, to fail page verification.
+		 */
+		for (BlockNumber i = 0; i < nblocks_this_segment; i++)
+			(void) PageDecompress(buffers[i]);
+
 		nblocks -= nblocks_this_segment;
 		buffers += nblocks_this_segment;
 		blocknum += nblocks_this_segment;
@@ -1070,6 +1134,7 @@ mdwritev(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		int			iovcnt;
 		pgoff_t		seekpos;
 		int			nbytes;
+		int			stored = BLCKSZ;
 		MdfdVec    *v;
 		BlockNumber nblocks_this_segment;
 		size_t		transferred_this_segment;
@@ -1090,7 +1155,31 @@ mdwritev(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		if (nblocks_this_segment != nblocks)
 			elog(ERROR, "write crosses segment boundary");
 
-		iovcnt = buffers_to_iovec(iov, (void **) buffers, nblocks_this_segment);
+		/* Pages to be compressed are written one at a time */
+		for (BlockNumber i = 0; i < nblocks_this_segment; i++)
+		{
+			if (md_page_compressible(reln, forknum, buffers[i]))
+			{
+				if (i == 0)
+				{
+					stored = PageCompress(buffers[0], md_compress_buf.data,
+										  blocknum);
+					nblocks_this_segment = 1;
+				}
+				else
+					nblocks_this_segment = i;
+				break;
+			}
+		}
+
+		if (stored < BLCKSZ)
+		{
+			void	   *image = md_compress_buf.data;
+
+			iovcnt = buffers_to_iovec(iov, &image, 1);
+		}
+		else
+			iovcnt = buffers_to_iovec(iov, (void **) buffers, nblocks_this_segment);
 		size_this_segment = nblocks_this_segment * BLCKSZ;
 		transferred_this_segment = 0;
 
@@ -1144,6 +1233,9 @@ mdwritev(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 			iovcnt = compute_remaining_iovec(iov, iov, iovcnt, nbytes);
 		}
 
+		if (stored < BLCKSZ)
+			md_punch_hole(v, blocknum, stored);
+
 		if (!skipFsync && !SmgrIsTemp(reln))
 			register_dirty_segment(reln, forknum, v);
 
@@ -2028,6 +2120,26 @@ md_readv_complete(PgAioHandle *ioh, PgAioResult prior_result, uint8 cb_data)
 		result.id = PGAIO_HCB_MD_READV;
 	}
 
+	/*
+	 * Replace compressed page images with the pages, before the buffer
+	 * manager's completion callback verifies them.  Like mdreadv(), leave
+	 * pages that can't be decompressed alone.
+	 */
+	if (result.status != PGAIO_RS_ERROR)
+	{
+		struct iovec *iov;
+		int			iovcnt = pgaio_io_get_iovec_length(ioh, &iov);
+		int			nblocks = result.result;
+
+		for (int i = 0; i < iovcnt && nblocks > 0; i++)
+		{
+			for (size_t off = 0;
+				 off < iov[i].iov_len && nblocks > 0;
+				 off += BLCKSZ, nblocks--)
+				(void) PageDecompress((char *) iov[i].iov_base + off);
+		}
+	}
+
 	return result;
 }
 
@@ -0,0 +1,194 @@
+/*-------------------------------------------------------------------------
+ *
+ * pagecompress.c
+ *	  Transparent compression of relation pages on disk
+ *
+ * A compressed page still occupies its own BLCKSZ slot in the relation file,
+ * so block numbers map to file offsets exactly as for uncompressed pages and
+ * the buffer manager only ever sees regular pages.  The compressed image is
+ * written at the start of the slot, and md.c deallocates the unused tail of
+ * the slot by punching a hole in the file.  Disk space is saved in units of
+ * PAGE_COMPRESS_UNIT_SIZE, and reading a compressed page does less physical
+ * I/O, since the hole needn't be read from the device.
+ *
+ * The image starts with a header that overlays PageHeaderData: pd_lsn and
+ * pd_checksum keep their positions and meaning, so that tools verifying
+ * checksums or LSNs of on-disk pages (pg_checksums, base backups) need not
+ * know about compression.  The layout version field carries
+ * PG_PAGE_COMPRESSED_LAYOUT_VERSION, which tells the image apart from a
+ * regular page; a page that fails to decompress is left in place and fails
+ * the usual page verification.
+ *
+ * Before compressing, PD_COMPRESSED is set in (a copy of) the page.  That
+ * flag comes back when the page is read, and makes every later write of the
+ * page compress it again, including writes done by processes that have no
+ * idea which relation the page belongs to.  A page is only decompressed for
+ * good when it is rebuilt from scratch, e.g. by a table rewrite.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/smgr/pagecompress.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+
+#include "access/xlog.h"
+#include "common/pg_lzcompress.h"
+#include "storage/checksum.h"
+#include "storage/pagecompress.h"
+
+/*
+ * Header of a compressed page image.  Fields at the same offsets as in
+ * PageHeaderData have the same meaning; pc_length sits where pd_upper would
+ * be, so that the image never looks like a new page.
+ */
+typedef struct PageCompressHeader
+{
+	PageXLogRecPtr pc_lsn;		/* LSN of the page */
+	uint16		pc_checksum;	/* checksum of the image, if enabled */
+	uint16		pc_method;		/* compression method, see below */
+	uint16		pc_reserved1;
+	uint16		pc_length;		/* length of the compressed data */
+	uint16		pc_reserved2;
+	uint16		pc_pagesize_version;	/* BLCKSZ |
+										 * PG_PAGE_COMPRESSED_LAYOUT_VERSION */
+} PageCompressHeader;
+
+#define SizeOfPageCompressHeader	sizeof(PageCompressHeader)
+
+StaticAssertDecl(offsetof(PageCompressHeader, pc_checksum) ==
+				 offsetof(PageHeaderData, pd_checksum),
+				 "pc_checksum must overlay pd_checksum");
+StaticAssertDecl(offsetof(PageCompressHeader, pc_pagesize_version) ==
+				 offsetof(PageHeaderData, pd_pagesize_version),
+				 "pc_pagesize_version must overlay pd_pagesize_version");
+
+/* values of pc_method */
+#define PAGE_COMPRESS_PGLZ			1
+#define PAGE_COMPRESS_LZ4			2
+
+/*
+ * Does the buffer hold a compressed page image?
+ */
+bool
+PageIsCompressedImage(const void *image)
+{
+	const PageCompressHeader *hdr = (const PageCompressHeader *) image;
+
+	return hdr->pc_pagesize_version ==
+		(BLCKSZ | PG_PAGE_COMPRESSED_LAYOUT_VERSION) &&
+		hdr->pc_length > 0 &&
+		hdr->pc_length <= BLCKSZ - SizeOfPageCompressHeader;
+}
+
+/*
+ * Try to compress a page for writing it out as block 'blkno'.
+ *
+ * On success, the compressed image is constructed in 'image', which must be
+ * BLCKSZ bytes, and the number of leading bytes of it that need to be kept
+ * on disk is returned; that is always a multiple of PAGE_COMPRESS_UNIT_SIZE.
+ * The remainder of the image is zeroed.  If compression wouldn't save at
+ * least one unit, BLCKSZ is returned and the page should be written as is.
+ *
+ * 'page' must already carry its final checksum, if checksums are enabled.
+ */
+int
+PageCompress(const void *page, void *image, BlockNumber blkno)
+{
+	static PGAlignedBlock copy;
+#ifdef USE_LZ4
+	static char payload[BLCKSZ];
+#else
+	static char payload[PGLZ_MAX_OUTPUT(BLCKSZ)];
+#endif
+	PageCompressHeader *hdr = (PageCompressHeader *) image;
+	int			max_len = BLCKSZ - PAGE_COMPRESS_UNIT_SIZE - SizeOfPageCompressHeader;
+	int			len;
+	uint16		method;
+
+	if (max_len <= 0 || PageIsNew(page))
+		return BLCKSZ;
+
+	/* Mark the page, so that it will be compressed again when re-written */
+	memcpy(copy.data, page, BLCKSZ);
+	if (!(((PageHeader) copy.data)->pd_flags & PD_COMPRESSED))
+	{
+		((PageHeader) copy.data)->pd_flags |= PD_COMPRESSED;
+		if (DataChecksumsEnabled())
+			((PageHeader) copy.data)->pd_checksum =
+				pg_checksum_page(copy.data, blkno);
+	}
+
+#ifdef USE_LZ4
+	method = PAGE_COMPRESS_LZ4;
+	len = LZ4_compress_default(copy.data, payload, BLCKSZ, max_len);
+	if (len <= 0)
+		return BLCKSZ;
+#else
+	method = PAGE_COMPRESS_PGLZ;
+	len = pglz_compress(copy.data, BLCKSZ, payload, PGLZ_strategy_always);
+	if (len < 0 || len > max_len)
+		return BLCKSZ;
+#endif
+
+	memset(image, 0, BLCKSZ);
+	hdr->pc_lsn = ((const PageHeaderData *) page)->pd_lsn;
+	hdr->pc_method = method;
+	hdr->pc_length = len;
+	hdr->pc_pagesize_version = BLCKSZ | PG_PAGE_COMPRESSED_LAYOUT_VERSION;
+	memcpy((char *) image + SizeOfPageCompressHeader, payload, len);
+
+	if (DataChecksumsEnabled())
+		hdr->pc_checksum = pg_checksum_page(image, blkno);
+
+	return TYPEALIGN(PAGE_COMPRESS_UNIT_SIZE, SizeOfPageCompressHeader + len);
+}
+
+/*
+ * If the buffer holds a compressed page image, replace it with the page.
+ *
+ * Returns false if the image could not be decompressed, in which case the
+ * buffer is left unchanged.  This does not allocate memory or throw errors,
+ * so that it can be used while completing asynchronous reads.
+ */
+bool
+PageDecompress(void *buffer)
+{
+	static PGAlignedBlock raw;
+	PageCompressHeader *hdr = (PageCompressHeader *) buffer;
+	const char *payload = (const char *) buffer + SizeOfPageCompressHeader;
+	int			len;
+
+	if (!PageIsCompressedImage(buffer))
+		return true;
+
+	switch (hdr->pc_method)
+	{
+		case PAGE_COMPRESS_PGLZ:
+			len = pglz_decompress(payload, hdr->pc_length, raw.data,
+								  BLCKSZ, true);
+			break;
+#ifdef USE_LZ4
+		case PAGE_COMPRESS_LZ4:
+			len = LZ4_decompress_safe(payload, raw.data, hdr->pc_length,
+									  BLCKSZ);
+			break;
+#endif
+		default:
+			return false;
+	}
+
+	if (len != BLCKSZ)
+		return false;
+
+	memcpy(buffer, raw.data, BLCKSZ);
+	return true;
+}
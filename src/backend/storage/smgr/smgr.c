@@ -40,6 +40,19 @@
  * themselves, as there could pointers to them in active use.  See
  * smgrrelease() and smgrreleaseall().
  *
+ * The sizes of relation forks are also cached in a shared hash table, so that
+ * smgrnblocks() doesn't need to ask the kernel every time.  Entries are only
+ * created by smgrnblocks(), which asks the kernel while holding the entry's
+ * partition lock exclusively; smgrextend(), smgrzeroextend() and
+ * smgrtruncate() update an existing entry under the same lock after changing
+ * the file, so an entry can never fall behind the size on disk.  Entries are
+ * removed when a fork is created or unlinked, and when a database is dropped
+ * or moved.  Temporary relations are not cached, and the cache isn't used
+ * during recovery, where the startup process has its own caching in
+ * smgr_cached_nblocks.  The size of the table is set by
+ * relation_size_cache_entries; when it is full, sizes that don't fit are
+ * simply not cached.
+ *
  * NB: We need to hold interrupts across most of the functions in this file,
  * as otherwise interrupt processing, e.g. due to a < ERROR elog/ereport, can
  * trigger procsignal processing, which in turn can trigger
@@ -63,13 +76,16 @@
  */
 #include "postgres.h"
 
+#include "access/xlog.h"
 #include "access/xlogutils.h"
 #include "lib/ilist.h"
 #include "miscadmin.h"
 #include "storage/aio.h"
 #include "storage/bufmgr.h"
 #include "storage/ipc.h"
+#include "storage/lwlock.h"
 #include "storage/md.h"
+#include "storage/shmem.h"
 #include "storage/smgr.h"
 #include "utils/hsearch.h"
 #include "utils/inval.h"
@@ -153,6 +169,32 @@ static const f_smgr smgrsw[] = {
 
 static const int NSmgr = lengthof(smgrsw);
 
+/*
+ * Shared relation size cache.
+ */
+#define NUM_SMGR_SIZE_CACHE_PARTITIONS	16
+
+typedef struct SMgrSizeCacheTag
+{
+	RelFileLocator locator;
+	ForkNumber	forknum;
+} SMgrSizeCacheTag;
+
+typedef struct SMgrSizeCacheEnt
+{
+	SMgrSizeCacheTag tag;		/* hash key; must be first */
+	BlockNumber nblocks;
+} SMgrSizeCacheEnt;
+
+/* GUC variable */
+int			relation_size_cache_entries = 4096;
+
+static HTAB *SMgrSizeCache = NULL;
+static LWLockPadded *SMgrSizeCacheLocks = NULL;
+
+#define SMgrSizeCachePartitionLock(hashcode) \
+	(&SMgrSizeCacheLocks[(hashcode) % NUM_SMGR_SIZE_CACHE_PARTITIONS].lock)
+
 /*
  * Each backend has a hashtable that stores all extant SMgrRelation objects.
  * In addition, "unpinned" SMgrRelation objects are chained together in a list.
@@ -164,6 +206,10 @@ static dlist_head unpinned_relns;
 /* local function prototypes */
 static void smgrshutdown(int code, Datum arg);
 static void smgrdestroy(SMgrRelation reln);
+static void smgr_size_cache_update(SMgrRelation reln, ForkNumber forknum,
+								   BlockNumber nblocks, bool extend);
+static void smgr_size_cache_forget(RelFileLocatorBackend rlocator,
+								   ForkNumber forknum);
 
 static void smgr_aio_reopen(PgAioHandle *ioh);
 static char *smgr_aio_describe_identity(const PgAioTargetData *sd);
@@ -222,6 +268,165 @@ smgrshutdown(int code, Datum arg)
 	RESUME_INTERRUPTS();
 }
 
+/*
+ * SMgrSizeCacheShmemSize --- report amount of shared memory space needed
+ */
+Size
+SMgrSizeCacheShmemSize(void)
+{
+	Size		size = 0;
+
+	if (relation_size_cache_entries <= 0)
+		return size;
+
+	size = add_size(size, mul_size(NUM_SMGR_SIZE_CACHE_PARTITIONS,
+								   sizeof(LWLockPadded)));
+	size = add_size(size, hash_estimate_size(relation_size_cache_entries,
+											 sizeof(SMgrSizeCacheEnt)));
+	return size;
+}
+
+/*
+ * SMgrSizeCacheShmemInit --- initialize the shared relation size cache
+ */
+void
+SMgrSizeCacheShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+
+	if (relation_size_cache_entries <= 0)
+		return;
+
+	SMgrSizeCacheLocks = (LWLockPadded *)
+		ShmemInitStruct("Relation Size Cache Locks",
+						NUM_SMGR_SIZE_CACHE_PARTITIONS * sizeof(LWLockPadded),
+						&found);
+	if (!found)
+	{
+		for (int i = 0; i < NUM_SMGR_SIZE_CACHE_PARTITIONS; i++)
+			LWLockInitialize(&SMgrSizeCacheLocks[i].lock,
+							 LWTRANCHE_RELSIZE_CACHE);
+	}
+
+	info.keysize = sizeof(SMgrSizeCacheTag);
+	info.entrysize = sizeof(SMgrSizeCacheEnt);
+	info.num_partitions = NUM_SMGR_SIZE_CACHE_PARTITIONS;
+
+	SMgrSizeCache = ShmemInitHash("Relation Size Cache",
+								  relation_size_cache_entries,
+								  relation_size_cache_entries,
+								  &info,
+								  HASH_ELEM | HASH_BLOBS | HASH_PARTITION |
+								  HASH_FIXED_SIZE);
+}
+
+/*
+ * Can the size of this relation be kept in the shared size cache?
+ */
+static inline bool
+smgr_size_cache_usable(RelFileLocatorBackend rlocator)
+{
+	return SMgrSizeCache != NULL &&
+		!RelFileLocatorBackendIsTemp(rlocator) &&
+		!RecoveryInProgress();
+}
+
+static inline void
+smgr_size_cache_tag(SMgrSizeCacheTag *tag, RelFileLocator locator,
+					ForkNumber forknum)
+{
+	/* Make sure any padding bytes are zero, since we use HASH_BLOBS */
+	memset(tag, 0, sizeof(SMgrSizeCacheTag));
+	tag->locator = locator;
+	tag->forknum = forknum;
+}
+
+/*
+ * smgr_size_cache_update() -- Update the cached size of a fork after it
+ *							   has been changed on disk.
+ *
+ * If 'extend' is true the fork was extended to at least 'nblocks' blocks,
+ * otherwise it was truncated to exactly 'nblocks' blocks.  Only existing
+ * entries are updated; see the comments at the top of the file.
+ */
+static void
+smgr_size_cache_update(SMgrRelation reln, ForkNumber forknum,
+					   BlockNumber nblocks, bool extend)
+{
+	SMgrSizeCacheTag tag;
+	SMgrSizeCacheEnt *entry;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+
+	if (!smgr_size_cache_usable(reln->smgr_rlocator))
+		return;
+
+	smgr_size_cache_tag(&tag, reln->smgr_rlocator.locator, forknum);
+	hashcode = get_hash_value(SMgrSizeCache, &tag);
+	partitionLock = SMgrSizeCachePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	entry = (SMgrSizeCacheEnt *)
+		hash_search_with_hash_value(SMgrSizeCache, &tag, hashcode,
+									HASH_FIND, NULL);
+	if (entry != NULL && (!extend || entry->nblocks < nblocks))
+		entry->nblocks = nblocks;
+	LWLockRelease(partitionLock);
+}
+
+/*
+ * smgr_size_cache_forget() -- Remove the cached size of a fork, if any.
+ */
+static void
+smgr_size_cache_forget(RelFileLocatorBackend rlocator, ForkNumber forknum)
+{
+	SMgrSizeCacheTag tag;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+
+	if (SMgrSizeCache == NULL || RelFileLocatorBackendIsTemp(rlocator))
+		return;
+
+	smgr_size_cache_tag(&tag, rlocator.locator, forknum);
+	hashcode = get_hash_value(SMgrSizeCache, &tag);
+	partitionLock = SMgrSizeCachePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	hash_search_with_hash_value(SMgrSizeCache, &tag, hashcode,
+								HASH_REMOVE, NULL);
+	LWLockRelease(partitionLock);
+}
+
+/*
+ * smgrforgetdbsizes() -- Remove all cached sizes for a database.
+ *
+ * This is used when all files of a database are removed or moved at once,
+ * bypassing smgrdounlinkall().
+ */
+void
+smgrforgetdbsizes(Oid dbid)
+{
+	HASH_SEQ_STATUS status;
+	SMgrSizeCacheEnt *entry;
+
+	if (SMgrSizeCache == NULL)
+		return;
+
+	for (int i = 0; i < NUM_SMGR_SIZE_CACHE_PARTITIONS; i++)
+		LWLockAcquire(&SMgrSizeCacheLocks[i].lock, LW_EXCLUSIVE);
+
+	hash_seq_init(&status, SMgrSizeCache);
+	while ((entry = (SMgrSizeCacheEnt *) hash_seq_search(&status)) != NULL)
+	{
+		if (entry->tag.locator.dbOid == dbid)
+			hash_search(SMgrSizeCache, &entry->tag, HASH_REMOVE, NULL);
+	}
+
+	for (int i = NUM_SMGR_SIZE_CACHE_PARTITIONS; --i >= 0;)
+		LWLockRelease(&SMgrSizeCacheLocks[i].lock);
+}
+
 /*
  * smgropen() -- Return an SMgrRelation object, creating it if need be.
  *
@@ -273,6 +478,7 @@ smgropen(RelFileLocator rlocator, ProcNumber backend)
 		reln->smgr_targblock = InvalidBlockNumber;
 		for (int i = 0; i <= MAX_FORKNUM; ++i)
 			reln->smgr_cached_nblocks[i] = InvalidBlockNumber;
+		reln->smgr_compress = false;
 		reln->smgr_which = 0;	/* we only have md.c at present */
 
 		/* it is not pinned yet */
@@ -481,6 +687,7 @@ void
 smgrcreate(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 {
 	HOLD_INTERRUPTS();
+	smgr_size_cache_forget(reln->smgr_rlocator, forknum);
 	smgrsw[reln->smgr_which].smgr_create(reln, forknum, isRedo);
 	RESUME_INTERRUPTS();
 }
@@ -569,9 +776,12 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 
 		rlocators[i] = rlocator;
 
-		/* Close the forks at smgr level */
+		/* Close the forks at smgr level, and forget their cached sizes */
 		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+		{
 			smgrsw[which].smgr_close(rels[i], forknum);
+			smgr_size_cache_forget(rlocator, forknum);
+		}
 	}
 
 	/*
@@ -635,6 +845,8 @@ smgrextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	else
 		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
 
+	smgr_size_cache_update(reln, forknum, blocknum + 1, true);
+
 	RESUME_INTERRUPTS();
 }
 
@@ -664,6 +876,8 @@ smgrzeroextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	else
 		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
 
+	smgr_size_cache_update(reln, forknum, blocknum + nblocks, true);
+
 	RESUME_INTERRUPTS();
 }
 
@@ -814,6 +1028,10 @@ smgrwriteback(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 /*
  * smgrnblocks() -- Calculate the number of blocks in the
  *					supplied relation.
+ *
+ * Outside recovery, the size of non-temporary relations is looked up in the
+ * shared relation size cache first, and entered there if it had to be
+ * obtained from the kernel.
  */
 BlockNumber
 smgrnblocks(SMgrRelation reln, ForkNumber forknum)
@@ -827,7 +1045,53 @@ smgrnblocks(SMgrRelation reln, ForkNumber forknum)
 
 	HOLD_INTERRUPTS();
 
-	result = smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
+	if (smgr_size_cache_usable(reln->smgr_rlocator))
+	{
+		SMgrSizeCacheTag tag;
+		SMgrSizeCacheEnt *entry;
+		uint32		hashcode;
+		LWLock	   *partitionLock;
+
+		smgr_size_cache_tag(&tag, reln->smgr_rlocator.locator, forknum);
+		hashcode = get_hash_value(SMgrSizeCache, &tag);
+		partitionLock = SMgrSizeCachePartitionLock(hashcode);
+
+		LWLockAcquire(partitionLock, LW_SHARED);
+		entry = (SMgrSizeCacheEnt *)
+			hash_search_with_hash_value(SMgrSizeCache, &tag, hashcode,
+										HASH_FIND, NULL);
+		if (entry != NULL)
+			result = entry->nblocks;
+		LWLockRelease(partitionLock);
+
+		if (result == InvalidBlockNumber)
+		{
+			/*
+			 * Ask the kernel while holding the lock exclusively, so that a
+			 * concurrent extension can't be missed: it updates the entry
+			 * under the same lock after writing the new blocks.  If the
+			 * table is full, just don't cache the size.
+			 */
+			LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+			entry = (SMgrSizeCacheEnt *)
+				hash_search_with_hash_value(SMgrSizeCache, &tag, hashcode,
+											HASH_FIND, NULL);
+			if (entry != NULL)
+				result = entry->nblocks;
+			else
+			{
+				result = smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
+				entry = (SMgrSizeCacheEnt *)
+					hash_search_with_hash_value(SMgrSizeCache, &tag, hashcode,
+												HASH_ENTER_NULL, NULL);
+				if (entry != NULL)
+					entry->nblocks = result;
+			}
+			LWLockRelease(partitionLock);
+		}
+	}
+	else
+		result = smgrsw[reln->smgr_which].smgr_nblocks(reln, forknum);
 
 	reln->smgr_cached_nblocks[forknum] = result;
 
@@ -912,6 +1176,9 @@ smgrtruncate(SMgrRelation reln, ForkNumber *forknum, int nforks,
 		 * outright wrong until then.
 		 */
 		reln->smgr_cached_nblocks[forknum[i]] = nblocks[i];
+
+		/* The shared cache, on the other hand, must be exact */
+		smgr_size_cache_update(reln, forknum[i], nblocks[i], false);
 	}
 }
 
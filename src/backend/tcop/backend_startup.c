@@ -15,10 +15,14 @@
 
 #include "postgres.h"
 
+#ifndef WIN32
+#include <sys/socket.h>
+#endif
 #include <unistd.h>
 
 #include "access/xlog.h"
 #include "access/xlogrecovery.h"
+#include "common/compress_stream.h"
 #include "common/ip.h"
 #include "common/string.h"
 #include "libpq/libpq.h"
@@ -57,11 +61,35 @@ char	   *log_connections_string = NULL;
  */
 ConnectionTiming conn_timing = {.ready_for_use = TIMESTAMP_MINUS_INFINITY};
 
+/* Largest value accepted for the _pq_.column_batch_rows protocol option */
+#define MAX_COLUMN_BATCH_ROWS	(1024 * 1024)
+
+/* Set if this backend was pre-forked and waited for its connection */
+bool		WarmBackendStart = false;
+
+#ifndef WIN32
+/*
+ * Message that the postmaster sends to a warm backend, along with the client
+ * socket itself as SCM_RIGHTS ancillary data.
+ */
+typedef struct WarmBackendHandoff
+{
+	BackendStartupData startup_data;
+	ClientSocket client_sock;
+} WarmBackendHandoff;
+
+static void WaitForWarmBackendHandoff(pgsocket sock,
+									  BackendStartupData *startup_data,
+									  ClientSocket *client_sock);
+#endif
+
 static void BackendInitialize(ClientSocket *client_sock, CAC_state cac);
 static int	ProcessSSLStartup(Port *port);
 static int	ProcessStartupPacket(Port *port, bool ssl_done, bool gss_done);
 static void ProcessCancelRequestPacket(Port *port, void *pkt, int pktlen);
 static void SendNegotiateProtocolVersion(List *unrecognized_protocol_options);
+static bool ProcessCompressionOption(Port *port, const char *value);
+static bool ProcessColumnBatchOption(Port *port, const char *value);
 static void process_startup_packet_die(SIGNAL_ARGS);
 static void StartupPacketTimeoutHandler(void);
 static bool validate_log_connections_options(List *elemlist, uint32 *flags);
@@ -76,9 +104,11 @@ void
 BackendMain(const void *startup_data, size_t startup_data_len)
 {
 	const BackendStartupData *bsdata = startup_data;
+#ifndef WIN32
+	BackendStartupData handoff_data;
+#endif
 
 	Assert(startup_data_len == sizeof(BackendStartupData));
-	Assert(MyClientSocket != NULL);
 
 #ifdef EXEC_BACKEND
 
@@ -106,6 +136,30 @@ BackendMain(const void *startup_data, size_t startup_data_len)
 #endif
 #endif
 
+#ifndef WIN32
+
+	/*
+	 * A warm backend was started ahead of any connection.  Wait for the
+	 * postmaster to give us one, along with the startup data it would have
+	 * passed to a freshly forked backend.
+	 */
+	if (bsdata->warm_sock != PGINVALID_SOCKET)
+	{
+		if (MyClientSocket == NULL)
+			MyClientSocket = palloc_object(ClientSocket);
+		WaitForWarmBackendHandoff(bsdata->warm_sock, &handoff_data,
+								  MyClientSocket);
+		bsdata = &handoff_data;
+		WarmBackendStart = true;
+
+		/* The handoff takes the place of the fork in the timings */
+		conn_timing.socket_create = bsdata->socket_created;
+		conn_timing.fork_start = bsdata->fork_started;
+		conn_timing.fork_end = GetCurrentTimestamp();
+	}
+#endif
+	Assert(MyClientSocket != NULL);
+
 	/* Perform additional initialization and collect startup packet */
 	BackendInitialize(MyClientSocket, bsdata->canAcceptConnections);
 
@@ -124,6 +178,124 @@ BackendMain(const void *startup_data, size_t startup_data_len)
 	PostgresMain(MyProcPort->database_name, MyProcPort->user_name);
 }
 
+#ifndef WIN32
+
+/*
+ * SendWarmBackendHandoff -- hand a new connection to a warm backend
+ *
+ * Called in the postmaster.  'sock' is the postmaster's end of the warm
+ * backend's handoff socket.  We don't block: if the message can't be sent
+ * right away, the backend is presumably gone, and the caller should fall back
+ * to forking a new one.  Returns true on success.
+ */
+bool
+SendWarmBackendHandoff(pgsocket sock, const BackendStartupData *startup_data,
+					   const ClientSocket *client_sock)
+{
+	WarmBackendHandoff msg;
+	struct msghdr mh;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	union
+	{
+		struct cmsghdr align;
+		char		buf[CMSG_SPACE(sizeof(int))];
+	}			cmsgbuf;
+
+	memset(&msg, 0, sizeof(msg));
+	memcpy(&msg.startup_data, startup_data, sizeof(BackendStartupData));
+	memcpy(&msg.client_sock, client_sock, sizeof(ClientSocket));
+
+	iov.iov_base = &msg;
+	iov.iov_len = sizeof(msg);
+	memset(&mh, 0, sizeof(mh));
+	mh.msg_iov = &iov;
+	mh.msg_iovlen = 1;
+	mh.msg_control = cmsgbuf.buf;
+	mh.msg_controllen = sizeof(cmsgbuf.buf);
+
+	cmsg = CMSG_FIRSTHDR(&mh);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &client_sock->sock, sizeof(int));
+
+	if (sendmsg(sock, &mh, MSG_DONTWAIT) != sizeof(msg))
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not hand connection over to warm backend: %m")));
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * WaitForWarmBackendHandoff -- wait for the postmaster to send a connection
+ *
+ * All signals except SIGQUIT are still blocked here, so this sleeps until a
+ * connection arrives or the postmaster closes its end of the socket, which is
+ * how it tells a warm backend that it is no longer needed.  Nothing has been
+ * done that would need cleaning up, so just exit in that case.
+ */
+static void
+WaitForWarmBackendHandoff(pgsocket sock, BackendStartupData *startup_data,
+						  ClientSocket *client_sock)
+{
+	WarmBackendHandoff msg;
+	struct msghdr mh;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	union
+	{
+		struct cmsghdr align;
+		char		buf[CMSG_SPACE(sizeof(int))];
+	}			cmsgbuf;
+	pgsocket	client_fd = PGINVALID_SOCKET;
+	ssize_t		n;
+
+	for (;;)
+	{
+		iov.iov_base = &msg;
+		iov.iov_len = sizeof(msg);
+		memset(&mh, 0, sizeof(mh));
+		mh.msg_iov = &iov;
+		mh.msg_iovlen = 1;
+		mh.msg_control = cmsgbuf.buf;
+		mh.msg_controllen = sizeof(cmsgbuf.buf);
+
+		n = recvmsg(sock, &mh, 0);
+		if (n >= 0 || errno != EINTR)
+			break;
+	}
+
+	if (n == 0)
+		proc_exit(0);
+	if (n < 0)
+		ereport(FATAL,
+				(errcode_for_socket_access(),
+				 errmsg("could not receive connection from postmaster: %m")));
+
+	for (cmsg = CMSG_FIRSTHDR(&mh); cmsg; cmsg = CMSG_NXTHDR(&mh, cmsg))
+	{
+		if (cmsg->cmsg_level == SOL_SOCKET &&
+			cmsg->cmsg_type == SCM_RIGHTS &&
+			cmsg->cmsg_len == CMSG_LEN(sizeof(int)))
+			memcpy(&client_fd, CMSG_DATA(cmsg), sizeof(int));
+	}
+	if (n != sizeof(msg) || client_fd == PGINVALID_SOCKET ||
+		(mh.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) != 0)
+		elog(FATAL, "invalid connection handoff from postmaster");
+
+	closesocket(sock);
+
+	memcpy(startup_data, &msg.startup_data, sizeof(BackendStartupData));
+	memcpy(client_sock, &msg.client_sock, sizeof(ClientSocket));
+	client_sock->sock = client_fd;
+}
+#endif							/* !WIN32 */
+
 
 /*
  * BackendInitialize -- initialize an interactive (postmaster-child)
@@ -726,6 +898,8 @@ ProcessStartupPacket(Port *port, bool ssl_done, bool gss_done)
 	{
 		int32		offset = sizeof(ProtocolVersion);
 		List	   *unrecognized_protocol_options = NIL;
+		char	   *compression = NULL;
+		char	   *column_batch_rows = NULL;
 
 		/*
 		 * Scan packet body for name/option pairs.  We can assume any string
@@ -775,12 +949,16 @@ ProcessStartupPacket(Port *port, bool ssl_done, bool gss_done)
 									valptr),
 							 errhint("Valid values are: \"false\", 0, \"true\", 1, \"database\".")));
 			}
+			else if (strcmp(nameptr, "_pq_.compression") == 0)
+				compression = valptr;
+			else if (strcmp(nameptr, "_pq_.column_batch_rows") == 0)
+				column_batch_rows = valptr;
 			else if (strncmp(nameptr, "_pq_.", 5) == 0)
 			{
 				/*
 				 * Any option beginning with _pq_. is reserved for use as a
-				 * protocol-level option, but at present no such options are
-				 * defined.
+				 * protocol-level option.  Those we don't know about are
+				 * reported back to the client.
 				 */
 				unrecognized_protocol_options =
 					lappend(unrecognized_protocol_options, pstrdup(nameptr));
@@ -816,6 +994,35 @@ ProcessStartupPacket(Port *port, bool ssl_done, bool gss_done)
 					(errcode(ERRCODE_PROTOCOL_VIOLATION),
 					 errmsg("invalid startup packet layout: expected terminator as last byte")));
 
+		/*
+		 * Connection proxies only relay plain protocol traffic, so
+		 * replication and encrypted connections made to the proxy port are
+		 * served by this backend directly.
+		 */
+		if (am_walsender || port->ssl_in_use)
+			port->pooled = false;
+#ifdef ENABLE_GSS
+		if (port->gss && port->gss->enc)
+			port->pooled = false;
+#endif
+
+		/*
+		 * If we can't compress as requested, treat the compression option
+		 * like any other we don't recognize, so that the client carries on
+		 * without compression.
+		 */
+		if (compression != NULL && !ProcessCompressionOption(port, compression))
+			unrecognized_protocol_options =
+				lappend(unrecognized_protocol_options,
+						pstrdup("_pq_.compression"));
+
+		/* Likewise for column batches */
+		if (column_batch_rows != NULL &&
+			!ProcessColumnBatchOption(port, column_batch_rows))
+			unrecognized_protocol_options =
+				lappend(unrecognized_protocol_options,
+						pstrdup("_pq_.column_batch_rows"));
+
 		/*
 		 * If the client requested a newer protocol version or if the client
 		 * requested any protocol options we didn't recognize, let them know
@@ -910,6 +1117,125 @@ ProcessCancelRequestPacket(Port *port, void *pkt, int pktlen)
 	SendCancelRequest(pg_ntoh32(canc->backendPID), canc->cancelAuthCode, len);
 }
 
+/*
+ * Process the _pq_.compression protocol option.
+ *
+ * The value is a space-separated list of compression specifications in the
+ * usual METHOD[:DETAIL] form, each optionally prefixed with "server-" or
+ * "client-" to say which side compresses.  "server-" covers the data we
+ * send, "client-" the data the client sends, and a specification without a
+ * prefix covers both directions.  Compression starts in both directions
+ * after the first ReadyForQuery message.
+ *
+ * Returns false if we can't compress as requested, in which case no
+ * compression is used at all.  A malformed value is an error.
+ */
+static bool
+ProcessCompressionOption(Port *port, const char *value)
+{
+	pg_compress_specification send_spec = {0};
+	pg_compress_specification recv_spec = {0};
+	char	   *copy = pstrdup(value);
+	char	   *tok;
+	char	   *brk;
+
+	/* Connection proxies relay the client's bytes without looking at them */
+	if (port->pooled)
+		return false;
+
+	for (tok = strtok_r(copy, " ", &brk); tok != NULL;
+		 tok = strtok_r(NULL, " ", &brk))
+	{
+		pg_compress_algorithm algorithm;
+		pg_compress_specification spec;
+		bool		send = true;
+		bool		recv = true;
+		char	   *detail;
+		char	   *error;
+
+		if (strncmp(tok, "server-", 7) == 0)
+		{
+			recv = false;
+			tok += 7;
+		}
+		else if (strncmp(tok, "client-", 7) == 0)
+		{
+			send = false;
+			tok += 7;
+		}
+
+		detail = strchr(tok, ':');
+		if (detail != NULL)
+			*detail++ = '\0';
+
+		if (!parse_compress_algorithm(tok, &algorithm))
+			ereport(FATAL,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid value for parameter \"%s\": \"%s\"",
+							"_pq_.compression", value),
+					 errdetail("Unrecognized compression algorithm: \"%s\".",
+							   tok)));
+
+		/* An algorithm this build lacks is not the client's fault */
+		if (algorithm != PG_COMPRESSION_NONE &&
+			!pg_compress_stream_supported(algorithm))
+			return false;
+
+		parse_compress_specification(algorithm, detail, &spec);
+		error = validate_compress_specification(&spec);
+		if (error == NULL && spec.options != 0)
+			error = _("only the compression level can be specified");
+		if (error != NULL)
+			ereport(FATAL,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid value for parameter \"%s\": \"%s\"",
+							"_pq_.compression", value),
+					 errdetail_internal("%s", error)));
+
+		if (send)
+			send_spec = spec;
+		if (recv)
+			recv_spec = spec;
+	}
+
+	port->compress_send = send_spec;
+	port->compress_recv = recv_spec;
+	pfree(copy);
+
+	return true;
+}
+
+/*
+ * Process the _pq_.column_batch_rows protocol option.
+ *
+ * The value is the maximum number of rows the client wants in each
+ * ColumnBatch message, or 0 to receive DataRow messages as usual.  Returns
+ * false if we can't send batches on this connection.  A malformed value is
+ * an error.
+ */
+static bool
+ProcessColumnBatchOption(Port *port, const char *value)
+{
+	int			rows;
+
+	/* Pooled backends were started without the option */
+	if (port->pooled)
+		return false;
+
+	if (!parse_int(value, &rows, 0, NULL) ||
+		rows < 0 || rows > MAX_COLUMN_BATCH_ROWS)
+		ereport(FATAL,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid value for parameter \"%s\": \"%s\"",
+						"_pq_.column_batch_rows", value),
+				 errdetail("Valid values are between \"%d\" and \"%d\".",
+						   0, MAX_COLUMN_BATCH_ROWS)));
+
+	port->column_batch_rows = rows;
+
+	return true;
+}
+
 /*
  * Send a NegotiateProtocolVersion to the client.  This lets the client know
  * that they have either requested a newer minor protocol version than we are
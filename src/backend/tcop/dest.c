@@ -269,6 +269,9 @@ ReadyForQuery(CommandDest dest)
 			}
 			/* Flush output at end of cycle in any case. */
 			pq_flush();
+
+			/* Protocol compression, if any, starts after the first one */
+			pq_start_compression();
 			break;
 
 		case DestNone:
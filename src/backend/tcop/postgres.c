@@ -39,6 +39,7 @@
 #include "commands/event_trigger.h"
 #include "commands/explain_state.h"
 #include "commands/prepare.h"
+#include "common/hashfn.h"
 #include "common/pg_prng.h"
 #include "jit/jit.h"
 #include "libpq/libpq.h"
@@ -54,6 +55,7 @@
 #include "pg_getopt.h"
 #include "pg_trace.h"
 #include "pgstat.h"
+#include "postmaster/connproxy.h"
 #include "postmaster/interrupt.h"
 #include "postmaster/postmaster.h"
 #include "replication/logicallauncher.h"
@@ -105,11 +107,25 @@ int			client_connection_check_interval = 0;
 /* flags for non-system relation kinds to restrict use */
 int			restrict_nonsystem_relation_kind;
 
+/* max number of statements kept in the simple query cache, 0 disables */
+int			simple_query_cache_size = 0;
+
 /* ----------------
  *		private typedefs etc
  * ----------------
  */
 
+/*
+ * Entry of the simple query cache.  Entries are hashed on a hash of the
+ * query text; the full text is in the plansource.
+ */
+typedef struct SimpleQueryCacheEntry
+{
+	uint64		hash;			/* hash key, must be first */
+	CachedPlanSource *plansource;
+	dlist_node	lru_node;		/* most recently used first */
+} SimpleQueryCacheEntry;
+
 /* type of argument for bind_param_error_callback */
 typedef struct BindParamCbData
 {
@@ -150,6 +166,16 @@ static bool ignore_till_sync = false;
  */
 static CachedPlanSource *unnamed_stmt_psrc = NULL;
 
+/*
+ * Simple query cache: saved CachedPlanSources for statements received with
+ * the simple Query protocol, so that a client sending the same query string
+ * over and over doesn't need to have it parsed, analyzed and planned each
+ * time.  plancache.c takes care of invalidation, just as for prepared
+ * statements.
+ */
+static HTAB *simple_query_cache = NULL;
+static dlist_head simple_query_lru = DLIST_STATIC_INIT(simple_query_lru);
+
 /* assorted command-line switches */
 static const char *userDoption = NULL;	/* -D switch */
 static bool EchoQuery = false;	/* -E switch */
@@ -183,6 +209,9 @@ static bool IsTransactionExitStmt(Node *parsetree);
 static bool IsTransactionExitStmtList(List *pstmts);
 static bool IsTransactionStmtList(List *pstmts);
 static void drop_unnamed_stmt(void);
+static CachedPlanSource *simple_query_cache_lookup(const char *query_string);
+static bool simple_query_cacheable(RawStmt *parsetree);
+static void simple_query_cache_insert(CachedPlanSource *psrc);
 static void log_disconnections(int code, Datum arg);
 static void enable_statement_timeout(void);
 static void disable_statement_timeout(void);
@@ -1020,6 +1049,7 @@ exec_simple_query(const char *query_string)
 	MemoryContext oldcontext;
 	List	   *parsetree_list;
 	ListCell   *parsetree_item;
+	CachedPlanSource *cached_psrc;
 	bool		save_log_statement_stats = log_statement_stats;
 	bool		was_logged = false;
 	bool		use_implicit_block;
@@ -1065,9 +1095,15 @@ exec_simple_query(const char *query_string)
 
 	/*
 	 * Do basic parsing of the query or queries (this should be safe even if
-	 * we are in aborted transaction state!)
+	 * we are in aborted transaction state!), unless we have seen this query
+	 * string before and kept it in the simple query cache.  In that case,
+	 * the cached raw parse tree stands in for the result of parsing.
 	 */
-	parsetree_list = pg_parse_query(query_string);
+	cached_psrc = simple_query_cache_lookup(query_string);
+	if (cached_psrc)
+		parsetree_list = list_make1(cached_psrc->raw_parse_tree);
+	else
+		parsetree_list = pg_parse_query(query_string);
 
 	/* Log immediately if dictated by log_statement */
 	if (check_log_statement(parsetree_list))
@@ -1104,8 +1140,10 @@ exec_simple_query(const char *query_string)
 		CommandTag	commandTag;
 		QueryCompletion qc;
 		MemoryContext per_parsetree_context = NULL;
+		CachedPlanSource *psrc = cached_psrc;
+		CachedPlan *cplan = NULL;
 		List	   *querytree_list,
-				   *plantree_list;
+				   *plantree_list = NIL;
 		Portal		portal;
 		DestReceiver *receiver;
 		int16		format;
@@ -1161,9 +1199,10 @@ exec_simple_query(const char *query_string)
 		CHECK_FOR_INTERRUPTS();
 
 		/*
-		 * Set up a snapshot if parse analysis/planning will need one.
+		 * Set up a snapshot if parse analysis/planning will need one.  A
+		 * cached statement is planned below, once its portal exists.
 		 */
-		if (analyze_requires_snapshot(parsetree))
+		if (psrc == NULL && analyze_requires_snapshot(parsetree))
 		{
 			PushActiveSnapshot(GetTransactionSnapshot());
 			snapshot_set = true;
@@ -1192,11 +1231,60 @@ exec_simple_query(const char *query_string)
 		else
 			oldcontext = MemoryContextSwitchTo(MessageContext);
 
-		querytree_list = pg_analyze_and_rewrite_fixedparams(parsetree, query_string,
-															NULL, 0, NULL);
+		if (psrc == NULL)
+		{
+			bool		cache_it;
+
+			/*
+			 * If the query string is a single plannable statement, set it up
+			 * as a CachedPlanSource to be kept in the simple query cache.
+			 * This must be done before parse analysis, which needs to see the
+			 * unmodified raw parse tree.
+			 */
+			cache_it = (simple_query_cache_size > 0 &&
+						list_length(parsetree_list) == 1 &&
+						simple_query_cacheable(parsetree));
+			if (cache_it)
+				psrc = CreateCachedPlan(parsetree, query_string, commandTag);
+
+			querytree_list = pg_analyze_and_rewrite_fixedparams(parsetree, query_string,
+																NULL, 0, NULL);
 
-		plantree_list = pg_plan_queries(querytree_list, query_string,
-										CURSOR_OPT_PARALLEL_OK, NULL);
+			if (cache_it)
+			{
+				ListCell   *lc;
+
+				foreach(lc, querytree_list)
+				{
+					if (lfirst_node(Query, lc)->commandType == CMD_UTILITY)
+						cache_it = false;
+				}
+			}
+
+			if (cache_it)
+			{
+				CompleteCachedPlan(psrc,
+								   querytree_list,
+								   NULL,
+								   NULL,
+								   0,
+								   NULL,
+								   NULL,
+								   CURSOR_OPT_PARALLEL_OK,
+								   true);
+				simple_query_cache_insert(psrc);
+			}
+			else
+			{
+				if (psrc)
+				{
+					DropCachedPlan(psrc);
+					psrc = NULL;
+				}
+				plantree_list = pg_plan_queries(querytree_list, query_string,
+												CURSOR_OPT_PARALLEL_OK, NULL);
+			}
+		}
 
 		/*
 		 * Done with the snapshot used for parsing/planning.
@@ -1222,17 +1310,53 @@ exec_simple_query(const char *query_string)
 		/* Don't display the portal in pg_cursors */
 		portal->visible = false;
 
+		/*
+		 * Obtain the plan of a cached statement.  This is done only now, so
+		 * that nothing can fail between GetCachedPlan and PortalDefineQuery,
+		 * which would leak the plan's refcount.  The refcount is assigned to
+		 * the Portal and released at portal destruction.
+		 */
+		if (psrc)
+		{
+			bool		plan_snapshot = analyze_requires_snapshot(parsetree);
+
+			if (plan_snapshot)
+				PushActiveSnapshot(GetTransactionSnapshot());
+			cplan = GetCachedPlan(psrc, NULL, NULL, NULL);
+			plantree_list = cplan->stmt_list;
+			if (plan_snapshot)
+				PopActiveSnapshot();
+		}
+
 		/*
 		 * We don't have to copy anything into the portal, because everything
 		 * we are passing here is in MessageContext or the
-		 * per_parsetree_context, and so will outlive the portal anyway.
+		 * per_parsetree_context, and so will outlive the portal anyway.  A
+		 * cached plan is kept alive by its refcount.
 		 */
 		PortalDefineQuery(portal,
 						  NULL,
 						  query_string,
 						  commandTag,
 						  plantree_list,
-						  NULL);
+						  cplan);
+
+		/* Portal is defined, set the plan ID based on its contents. */
+		if (cplan)
+		{
+			ListCell   *lc;
+
+			foreach(lc, portal->stmts)
+			{
+				PlannedStmt *plan = lfirst_node(PlannedStmt, lc);
+
+				if (plan->planId != INT64CONST(0))
+				{
+					pgstat_report_plan_id(plan->planId, false);
+					break;
+				}
+			}
+		}
 
 		/*
 		 * Start the portal.  No parameters here.
@@ -2919,6 +3043,99 @@ drop_unnamed_stmt(void)
 	}
 }
 
+/*
+ * Look up a query string in the simple query cache.
+ */
+static CachedPlanSource *
+simple_query_cache_lookup(const char *query_string)
+{
+	SimpleQueryCacheEntry *entry;
+	uint64		hash;
+
+	if (simple_query_cache == NULL || simple_query_cache_size <= 0)
+		return NULL;
+
+	hash = hash_bytes_extended((const unsigned char *) query_string,
+							   strlen(query_string), 0);
+	entry = (SimpleQueryCacheEntry *) hash_search(simple_query_cache, &hash,
+												  HASH_FIND, NULL);
+	if (entry == NULL ||
+		strcmp(entry->plansource->query_string, query_string) != 0)
+		return NULL;
+
+	dlist_move_head(&simple_query_lru, &entry->lru_node);
+
+	return entry->plansource;
+}
+
+/*
+ * Can a statement be kept in the simple query cache?  Only statements that
+ * go through the planner are worth it; the caller checks again after parse
+ * analysis, which can turn a SELECT into a utility command (SELECT INTO).
+ */
+static bool
+simple_query_cacheable(RawStmt *parsetree)
+{
+	switch (nodeTag(parsetree->stmt))
+	{
+		case T_InsertStmt:
+		case T_DeleteStmt:
+		case T_UpdateStmt:
+		case T_MergeStmt:
+		case T_SelectStmt:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Save a completed CachedPlanSource in the simple query cache, evicting the
+ * least recently used statements if the cache is full.
+ */
+static void
+simple_query_cache_insert(CachedPlanSource *psrc)
+{
+	SimpleQueryCacheEntry *entry;
+	uint64		hash;
+	bool		found;
+
+	if (simple_query_cache == NULL)
+	{
+		HASHCTL		ctl;
+
+		ctl.keysize = sizeof(uint64);
+		ctl.entrysize = sizeof(SimpleQueryCacheEntry);
+		simple_query_cache = hash_create("Simple query cache", 64, &ctl,
+										 HASH_ELEM | HASH_BLOBS);
+	}
+
+	while (hash_get_num_entries(simple_query_cache) >= simple_query_cache_size &&
+		   !dlist_is_empty(&simple_query_lru))
+	{
+		entry = dlist_tail_element(SimpleQueryCacheEntry, lru_node,
+								   &simple_query_lru);
+		dlist_delete(&entry->lru_node);
+		DropCachedPlan(entry->plansource);
+		hash_search(simple_query_cache, &entry->hash, HASH_REMOVE, NULL);
+	}
+
+	hash = hash_bytes_extended((const unsigned char *) psrc->query_string,
+							   strlen(psrc->query_string), 0);
+	entry = (SimpleQueryCacheEntry *) hash_search(simple_query_cache, &hash,
+												  HASH_ENTER, &found);
+	if (found)
+	{
+		/* a different query with the same hash; replace it */
+		dlist_delete(&entry->lru_node);
+		DropCachedPlan(entry->plansource);
+	}
+	entry->plansource = psrc;
+	dlist_push_head(&simple_query_lru, &entry->lru_node);
+
+	SaveCachedPlan(psrc);
+}
+
 
 /* --------------------------------
  *		signal handler routines used in PostgresMain()
@@ -4332,9 +4549,11 @@ PostgresMain(const char *dbname, const char *username)
 		InitWalSender();
 
 	/*
-	 * Send this backend's cancellation info to the frontend.
+	 * Send this backend's cancellation info to the frontend.  Not for clients
+	 * of a connection proxy, which may be served by any of the backends in
+	 * the pool and so cannot cancel their queries.
 	 */
-	if (whereToSendOutput == DestRemote)
+	if (whereToSendOutput == DestRemote && !MyProcPort->pooled)
 	{
 		StringInfoData buf;
 
@@ -4689,6 +4908,10 @@ PostgresMain(const char *dbname, const char *username)
 							   (double) auth_duration / NS_PER_US));
 			}
 
+			/* Hand the client over to a connection proxy, if it came via one */
+			if (MyProcPort && MyProcPort->pooled)
+				ConnProxyReadyForQuery();
+
 			ReadyForQuery(whereToSendOutput);
 			send_ready_for_query = false;
 		}
@@ -96,6 +96,8 @@ CreateQueryDesc(PlannedStmt *plannedstmt,
 	/* not yet executed */
 	qd->already_executed = false;
 
+	qd->cplan = NULL;
+
 	return qd;
 }
 
@@ -497,6 +499,12 @@ PortalStart(Portal portal, ParamListInfo params,
 											portal->queryEnv,
 											0);
 
+				/*
+				 * Let the executor keep its state in the cached plan, if
+				 * any, for the next execution of the statement.
+				 */
+				queryDesc->cplan = portal->cplan;
+
 				/*
 				 * If it's a scrollable cursor, executor needs to support
 				 * REWIND and backwards scan, as well as whatever the caller
@@ -3,6 +3,16 @@
  * dict_ispell.c
  *		Ispell dictionary interface
  *
+ * Compiling a large Ispell or Hunspell dictionary takes a while and a lot of
+ * memory, and normally every backend does it for itself.  When
+ * shared_ispell_dictionaries is set, compiled dictionary images (see
+ * spell.c) are also stored in dynamic shared memory, where other backends
+ * of the same database can use them directly.  An image is identified by
+ * the paths of the dictionary and affix files, and their sizes and
+ * modification times, so that editing the files makes backends compile
+ * them again.  Shared images are never freed, since backends might be using
+ * them; once shared_ispell_dictionaries images are stored, no more are.
+ *
  * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
  *
  *
@@ -13,13 +23,24 @@
  */
 #include "postgres.h"
 
+#include <sys/stat.h>
+
 #include "catalog/pg_collation_d.h"
 #include "commands/defrem.h"
+#include "common/hashfn.h"
+#include "lib/dshash.h"
+#include "lib/stringinfo.h"
+#include "miscadmin.h"
+#include "port/atomics.h"
+#include "storage/dsm_registry.h"
 #include "tsearch/dicts/spell.h"
 #include "tsearch/ts_public.h"
 #include "utils/fmgrprotos.h"
 #include "utils/formatting.h"
+#include "utils/memutils.h"
 
+/* GUC parameter */
+int			shared_ispell_dictionaries = 0;
 
 typedef struct
 {
@@ -27,51 +48,213 @@ typedef struct
 	IspellDict	obj;
 } DictISpell;
 
+typedef struct SharedIspellControl
+{
+	pg_atomic_uint32 nentries;
+} SharedIspellControl;
+
+typedef struct SharedIspellKey
+{
+	Oid			dbid;			/* database the image was compiled in */
+	uint64		hash;			/* hash of the key text */
+} SharedIspellKey;
+
+/*
+ * A hash table entry.  "data" points to a chunk holding the full key text
+ * (as built by shared_ispell_key()), padded to a MAXALIGN boundary, and the
+ * image.
+ */
+typedef struct SharedIspellEntry
+{
+	SharedIspellKey key;
+	dsa_pointer data;
+	Size		keylen;
+} SharedIspellEntry;
+
+static const dshash_parameters shared_ispell_hash_params = {
+	sizeof(SharedIspellKey),
+	sizeof(SharedIspellEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	dshash_memcpy
+};
+
+static SharedIspellControl *SharedIspellCtl = NULL;
+static dsa_area *SharedIspellArea = NULL;
+static dshash_table *SharedIspellHash = NULL;
+
+static void
+shared_ispell_init(void *ptr, void *arg)
+{
+	SharedIspellControl *ctl = (SharedIspellControl *) ptr;
+
+	pg_atomic_init_u32(&ctl->nentries, 0);
+}
+
+/*
+ * Build the lookup key for the image of a dictionary.  The full key text
+ * goes into "buf", so that hash collisions can be told apart from matches.
+ *
+ * Returns false if the dictionary can't be shared.
+ */
+static bool
+shared_ispell_key(const char *dictfile, const char *afffile,
+				  SharedIspellKey *key, StringInfo buf)
+{
+	const char *files[2] = {dictfile, afffile};
+	bool		found;
+
+	if (shared_ispell_dictionaries <= 0 || !IsUnderPostmaster)
+		return false;
+
+	initStringInfo(buf);
+	for (int i = 0; i < lengthof(files); i++)
+	{
+		struct stat st;
+		int64		mtime;
+		int64		size;
+
+		if (stat(files[i], &st) != 0)
+		{
+			pfree(buf->data);
+			return false;
+		}
+		mtime = (int64) st.st_mtime;
+		size = (int64) st.st_size;
+		appendBinaryStringInfo(buf, files[i], strlen(files[i]) + 1);
+		appendBinaryStringInfo(buf, &mtime, sizeof(mtime));
+		appendBinaryStringInfo(buf, &size, sizeof(size));
+	}
+
+	key->dbid = MyDatabaseId;
+	key->hash = hash_bytes_extended((const unsigned char *) buf->data,
+									buf->len, 0);
+
+	if (SharedIspellCtl == NULL)
+	{
+		SharedIspellArea = GetNamedDSA("shared_ispell_area", &found);
+		SharedIspellHash = GetNamedDSHash("shared_ispell",
+										  &shared_ispell_hash_params, &found);
+		SharedIspellCtl = GetNamedDSMSegment("shared_ispell_control",
+											 sizeof(SharedIspellControl),
+											 shared_ispell_init,
+											 &found, NULL);
+	}
+
+	return true;
+}
+
+/*
+ * Look for a shared image with the given key.
+ */
+static NIImage *
+shared_ispell_lookup(SharedIspellKey *key, StringInfo buf)
+{
+	SharedIspellEntry *entry;
+	NIImage    *image = NULL;
+
+	entry = dshash_find(SharedIspellHash, key, false);
+	if (entry == NULL)
+		return NULL;
+
+	if (entry->keylen == buf->len)
+	{
+		char	   *data = dsa_get_address(SharedIspellArea, entry->data);
+
+		if (memcmp(data, buf->data, buf->len) == 0)
+			image = (NIImage *) (data + MAXALIGN(buf->len));
+	}
+	dshash_release_lock(SharedIspellHash, entry);
+
+	return image;
+}
+
+/*
+ * Offer a freshly compiled image to other backends.
+ *
+ * Returns the shared copy of the image, which may have been stored by
+ * somebody else in the meantime, or NULL if there is none.
+ */
+static NIImage *
+shared_ispell_insert(SharedIspellKey *key, StringInfo buf, NIImage *image)
+{
+	SharedIspellEntry *entry;
+	dsa_pointer dp;
+	char	   *data;
+	bool		found;
+
+	if (pg_atomic_read_u32(&SharedIspellCtl->nentries) >=
+		shared_ispell_dictionaries)
+		return NULL;
+
+	entry = dshash_find_or_insert(SharedIspellHash, key, &found);
+	if (found)
+	{
+		/* Somebody beat us to it */
+		dshash_release_lock(SharedIspellHash, entry);
+		return shared_ispell_lookup(key, buf);
+	}
+
+	pg_atomic_fetch_add_u32(&SharedIspellCtl->nentries, 1);
+	dp = dsa_allocate_extended(SharedIspellArea,
+							   MAXALIGN(buf->len) + image->size,
+							   DSA_ALLOC_HUGE | DSA_ALLOC_NO_OOM);
+	if (dp == InvalidDsaPointer)
+	{
+		dshash_delete_entry(SharedIspellHash, entry);
+		pg_atomic_fetch_sub_u32(&SharedIspellCtl->nentries, 1);
+		return NULL;
+	}
+
+	entry->data = dp;
+	entry->keylen = buf->len;
+
+	data = dsa_get_address(SharedIspellArea, dp);
+	memcpy(data, buf->data, buf->len);
+	memcpy(data + MAXALIGN(buf->len), image, image->size);
+
+	dshash_release_lock(SharedIspellHash, entry);
+
+	return (NIImage *) (data + MAXALIGN(buf->len));
+}
+
 Datum
 dispell_init(PG_FUNCTION_ARGS)
 {
 	List	   *dictoptions = (List *) PG_GETARG_POINTER(0);
 	DictISpell *d;
-	bool		affloaded = false,
-				dictloaded = false,
-				stoploaded = false;
+	char	   *dictfile = NULL,
+			   *afffile = NULL;
+	bool		stoploaded = false;
+	SharedIspellKey key;
+	StringInfoData keybuf;
+	bool		shared;
+	NIImage    *image = NULL;
 	ListCell   *l;
 
 	d = palloc0_object(DictISpell);
 
-	NIStartBuild(&(d->obj));
-
 	foreach(l, dictoptions)
 	{
 		DefElem    *defel = (DefElem *) lfirst(l);
 
 		if (strcmp(defel->defname, "dictfile") == 0)
 		{
-			char	   *filename;
-
-			if (dictloaded)
+			if (dictfile)
 				ereport(ERROR,
 						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 						 errmsg("multiple DictFile parameters")));
-			filename = get_tsearch_config_filename(defGetString(defel),
+			dictfile = get_tsearch_config_filename(defGetString(defel),
 												   "dict");
-			NIImportDictionary(&(d->obj), filename);
-			pfree(filename);
-			dictloaded = true;
 		}
 		else if (strcmp(defel->defname, "afffile") == 0)
 		{
-			char	   *filename;
-
-			if (affloaded)
+			if (afffile)
 				ereport(ERROR,
 						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 						 errmsg("multiple AffFile parameters")));
-			filename = get_tsearch_config_filename(defGetString(defel),
-												   "affix");
-			NIImportAffixes(&(d->obj), filename);
-			pfree(filename);
-			affloaded = true;
+			afffile = get_tsearch_config_filename(defGetString(defel),
+												  "affix");
 		}
 		else if (strcmp(defel->defname, "stopwords") == 0)
 		{
@@ -91,25 +274,56 @@ dispell_init(PG_FUNCTION_ARGS)
 		}
 	}
 
-	if (affloaded && dictloaded)
-	{
-		NISortDictionary(&(d->obj));
-		NISortAffixes(&(d->obj));
-	}
-	else if (!affloaded)
+	if (!afffile)
 	{
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("missing AffFile parameter")));
 	}
-	else
+	else if (!dictfile)
 	{
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("missing DictFile parameter")));
 	}
 
-	NIFinishBuild(&(d->obj));
+	/* Use a shared image of the dictionary, if there is one */
+	shared = shared_ispell_key(dictfile, afffile, &key, &keybuf);
+	if (shared)
+		image = shared_ispell_lookup(&key, &keybuf);
+
+	if (image != NULL)
+		NIUseImage(&(d->obj), image);
+	else
+	{
+		MemoryContext oldcxt;
+
+		/* Everything but the image itself is temporary */
+		NIStartBuild(&(d->obj));
+		oldcxt = MemoryContextSwitchTo(d->obj.buildCxt);
+		NIImportDictionary(&(d->obj), dictfile);
+		NIImportAffixes(&(d->obj), afffile);
+		NISortDictionary(&(d->obj));
+		NISortAffixes(&(d->obj));
+		MemoryContextSwitchTo(oldcxt);
+		NIFinishBuild(&(d->obj));
+
+		/* Offer the image to other backends, and use the shared copy */
+		if (shared)
+		{
+			image = shared_ispell_insert(&key, &keybuf, d->obj.image);
+			if (image != NULL)
+			{
+				pfree(d->obj.image);
+				d->obj.image = image;
+			}
+		}
+	}
+
+	if (shared)
+		pfree(keybuf.data);
+	pfree(dictfile);
+	pfree(afffile);
 
 	PG_RETURN_POINTER(d);
 }
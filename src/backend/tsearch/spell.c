@@ -43,6 +43,9 @@
  *		and stores them in Suffix and Prefix fields.
  *	  The affix list is got from the Affix field.
  *
+ *	- NIFinishBuild() - copies the trees and everything they refer to into
+ *	  the image, a single chunk of memory that NINormalizeWord() works on.
+ *
  * Memory management
  * -----------------
  *
@@ -52,7 +55,10 @@
  * NIFinishBuild().
  *
  * All resources which should cleared by NIFinishBuild() is initialized using
- * tmpalloc() and tmpalloc0().
+ * tmpalloc() and tmpalloc0().  The caller runs the other steps in the
+ * Conf->buildCxt context as well, since only the image is kept in the end.
+ * The image doesn't contain pointers, so it can also be shared between
+ * backends; NIUseImage() sets up a dictionary that uses an existing image.
  *
  * IDENTIFICATION
  *	  src/backend/tsearch/spell.c
@@ -72,14 +78,24 @@
 
 /*
  * Initialization requires a lot of memory that's not needed
- * after the initialization is done.  During initialization,
- * CurrentMemoryContext is the long-lived memory context associated
- * with the dictionary cache entry.  We keep the short-lived stuff
- * in the Conf->buildCxt context.
+ * after the initialization is done.  The long-lived memory context
+ * associated with the dictionary cache entry is Conf->dictCxt, and
+ * we keep the short-lived stuff in the Conf->buildCxt context.
  */
 #define tmpalloc(sz)  MemoryContextAlloc(Conf->buildCxt, (sz))
 #define tmpalloc0(sz)  MemoryContextAllocZero(Conf->buildCxt, (sz))
 
+/* Get a pointer to the part of the image at offset "off", or NULL if 0 */
+#define NIPTR(Conf, off) \
+	((off) == 0 ? NULL : (void *) ((char *) (Conf)->image + (off)))
+/* Get a string in the image; strings are never left out */
+#define NISTR(Conf, off)	((const char *) (Conf)->image + (off))
+#define NIAFFIX(Conf, affixno) \
+	(((NIAffix *) NIPTR(Conf, (Conf)->image->affixes)) + (affixno))
+
+static regex_t *CompileAffixRegex(const char *mask, int type);
+static NIImage *MakeImage(IspellDict *Conf);
+
 /*
  * Prepare for constructing an ISpell dictionary.
  *
@@ -88,6 +104,8 @@
 void
 NIStartBuild(IspellDict *Conf)
 {
+	Conf->dictCxt = CurrentMemoryContext;
+
 	/*
 	 * The temp context is a child of CurTransactionContext, so that it will
 	 * go away automatically on error.
@@ -99,10 +117,25 @@ NIStartBuild(IspellDict *Conf)
 
 /*
  * Clean up when dictionary construction is complete.
+ *
+ * The compiled dictionary is copied into an image in Conf->dictCxt, and
+ * everything else is released.
  */
 void
 NIFinishBuild(IspellDict *Conf)
 {
+	NIImage    *image;
+
+	image = MakeImage(Conf);
+	Conf->image = MemoryContextAllocHuge(Conf->dictCxt, image->size);
+	memcpy(Conf->image, image, image->size);
+
+	/* Keep the regular expressions we compiled to check them */
+	Conf->masks = MemoryContextAllocZero(Conf->dictCxt,
+										 Max(Conf->naffixes, 1) * sizeof(void *));
+	for (int i = 0; i < Conf->naffixes; i++)
+		Conf->masks[i] = Conf->Affix[i].pregex;
+
 	/* Release no-longer-needed temp memory */
 	MemoryContextDelete(Conf->buildCxt);
 	/* Just for cleanliness, zero the now-dangling pointers */
@@ -110,6 +143,28 @@ NIFinishBuild(IspellDict *Conf)
 	Conf->Spell = NULL;
 	Conf->firstfree = NULL;
 	Conf->CompoundAffixFlags = NULL;
+	Conf->Affix = NULL;
+	Conf->Suffix = NULL;
+	Conf->Prefix = NULL;
+	Conf->Dictionary = NULL;
+	Conf->AffixData = NULL;
+	Conf->CompoundAffix = NULL;
+}
+
+/*
+ * Set up a dictionary that uses an image compiled earlier, maybe by another
+ * backend.  The image must stay valid as long as the dictionary is used.
+ *
+ * The IspellDict struct is assumed to be zeroed when allocated.
+ */
+void
+NIUseImage(IspellDict *Conf, NIImage *image)
+{
+	Conf->dictCxt = CurrentMemoryContext;
+	Conf->image = image;
+	Conf->masks = palloc0_array(void *, Max(image->naffixes, 1));
+	Conf->flagMode = image->flagMode;
+	Conf->usecompound = image->usecompound;
 }
 
 
@@ -441,19 +496,19 @@ getNextFlagFromString(IspellDict *Conf, const char **sflagset, char *sflag)
 }
 
 /*
- * Checks if the affix set Conf->AffixData[affix] contains affixflag.
- * Conf->AffixData[affix] does not contain affixflag if this flag is not used
+ * Checks if the affix set flagset, an entry of Conf->AffixData, contains
+ * affixflag.  The set does not contain affixflag if this flag is not used
  * actually by the .dict file.
  *
  * Conf: current dictionary.
- * affix: index of the Conf->AffixData array.
+ * flagset: the affix set.
  * affixflag: the affix flag.
  *
- * Returns true if the string Conf->AffixData[affix] contains affixflag,
- * otherwise returns false.
+ * Returns true if the string flagset contains affixflag, otherwise returns
+ * false.
  */
 static bool
-IsAffixFlagInUse(IspellDict *Conf, int affix, const char *affixflag)
+IsAffixFlagInUse(IspellDict *Conf, const char *flagset, const char *affixflag)
 {
 	const char *flagcur;
 	char		flag[BUFSIZ];
@@ -461,9 +516,7 @@ IsAffixFlagInUse(IspellDict *Conf, int affix, const char *affixflag)
 	if (*affixflag == 0)
 		return true;
 
-	Assert(affix < Conf->nAffixData);
-
-	flagcur = Conf->AffixData[affix];
+	flagcur = flagset;
 
 	while (*flagcur)
 	{
@@ -603,8 +656,9 @@ NIImportDictionary(IspellDict *Conf, const char *filename)
 static int
 FindWord(IspellDict *Conf, const char *word, const char *affixflag, int flag)
 {
-	SPNode	   *node = Conf->Dictionary;
-	SPNodeData *StopLow,
+	NIDictNode *node = NIPTR(Conf, Conf->image->dictionary);
+	NIOffset   *affixData = NIPTR(Conf, Conf->image->affixData);
+	NIDictNodeData *StopLow,
 			   *StopHigh,
 			   *StopMiddle;
 	const uint8 *ptr = (const uint8 *) word;
@@ -639,10 +693,13 @@ FindWord(IspellDict *Conf, const char *word, const char *affixflag, int flag)
 					 * Check if this affix rule is presented in the affix set
 					 * with index StopMiddle->affix.
 					 */
-					if (IsAffixFlagInUse(Conf, StopMiddle->affix, affixflag))
+					Assert(StopMiddle->affix < Conf->image->nAffixData);
+					if (IsAffixFlagInUse(Conf,
+										 NISTR(Conf, affixData[StopMiddle->affix]),
+										 affixflag))
 						return 1;
 				}
-				node = StopMiddle->node;
+				node = NIPTR(Conf, StopMiddle->node);
 				ptr++;
 				break;
 			}
@@ -702,56 +759,38 @@ NIAddAffix(IspellDict *Conf, const char *flag, char flagflags, const char *mask,
 	{
 		Affix->issimple = 1;
 		Affix->isregis = 0;
+		Affix->pregex = NULL;
 	}
-	/* This affix rule will use regis to search word ending */
+	/*
+	 * This affix rule will use regis to search word ending.  We compile that
+	 * when it is first used.
+	 */
 	else if (RS_isRegis(mask))
 	{
 		Affix->issimple = 0;
 		Affix->isregis = 1;
-		RS_compile(&(Affix->reg.regis), (type == FF_SUFFIX),
-				   *mask ? mask : VoidString);
+		Affix->pregex = NULL;
 	}
 	/* This affix rule will use regex_t to search word ending */
 	else
 	{
-		int			masklen;
-		int			wmasklen;
-		int			err;
-		pg_wchar   *wmask;
-		char	   *tmask;
+		MemoryContext oldcxt;
 
 		Affix->issimple = 0;
 		Affix->isregis = 0;
-		tmask = (char *) tmpalloc(strlen(mask) + 3);
-		if (type == FF_SUFFIX)
-			sprintf(tmask, "%s$", mask);
-		else
-			sprintf(tmask, "^%s", mask);
-
-		masklen = strlen(tmask);
-		wmask = (pg_wchar *) tmpalloc((masklen + 1) * sizeof(pg_wchar));
-		wmasklen = pg_mb2wchar_with_len(tmask, wmask, masklen);
 
 		/*
-		 * The regex and all internal state created by pg_regcomp are
-		 * allocated in the dictionary's memory context, and will be freed
-		 * automatically when it is destroyed.
+		 * Compile the regex now, to check it.  It and all internal state
+		 * created by pg_regcomp are allocated in the dictionary's memory
+		 * context, and will be freed automatically when it is destroyed.
 		 */
-		Affix->reg.pregex = palloc_object(regex_t);
-		err = pg_regcomp(Affix->reg.pregex, wmask, wmasklen,
-						 REG_ADVANCED | REG_NOSUB,
-						 DEFAULT_COLLATION_OID);
-		if (err)
-		{
-			char		errstr[100];
-
-			pg_regerror(err, Affix->reg.pregex, errstr, sizeof(errstr));
-			ereport(ERROR,
-					(errcode(ERRCODE_INVALID_REGULAR_EXPRESSION),
-					 errmsg("invalid regular expression: %s", errstr)));
-		}
+		oldcxt = MemoryContextSwitchTo(Conf->dictCxt);
+		Affix->pregex = CompileAffixRegex(mask, type);
+		MemoryContextSwitchTo(oldcxt);
 	}
 
+	Affix->mask = cpstrdup(Conf, mask);
+
 	Affix->flagflags = flagflags;
 	if ((Affix->flagflags & FF_COMPOUNDONLY) || (Affix->flagflags & FF_COMPOUNDPERMITFLAG))
 	{
@@ -1968,7 +2007,7 @@ isAffixInUse(IspellDict *Conf, const char *affixflag)
 	int			i;
 
 	for (i = 0; i < Conf->nAffixData; i++)
-		if (IsAffixFlagInUse(Conf, i, affixflag))
+		if (IsAffixFlagInUse(Conf, Conf->AffixData[i], affixflag))
 			return true;
 
 	return false;
@@ -2029,10 +2068,303 @@ NISortAffixes(IspellDict *Conf)
 	mkVoidAffix(Conf, false, firstsuffix);
 }
 
-static AffixNodeData *
-FindAffixes(AffixNode *node, const char *word, int wrdlen, int *level, int type)
+/*
+ * Building the image.
+ *
+ * The image is assembled in a buffer that grows as needed, so we can only
+ * keep offsets into it, not pointers, while adding to it.
+ */
+typedef struct ImageBuf
+{
+	char	   *data;
+	Size		len;
+	Size		maxlen;
+} ImageBuf;
+
+#define IBPTR(buf, off) ((void *) ((buf)->data + (off)))
+
+/*
+ * Allocate zeroed, maxaligned space in the image, and return its offset.
+ */
+static NIOffset
+ImageAlloc(ImageBuf *buf, Size size)
 {
-	AffixNodeData *StopLow,
+	NIOffset	off;
+
+	size = MAXALIGN(size);
+	if (buf->len + size > buf->maxlen)
+	{
+		Size		newlen = buf->maxlen;
+
+		while (buf->len + size > newlen)
+			newlen *= 2;
+		if (newlen > PG_UINT32_MAX)
+			ereport(ERROR,
+					(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+					 errmsg("ispell dictionary is too large")));
+		buf->data = repalloc_huge(buf->data, newlen);
+		memset(buf->data + buf->maxlen, 0, newlen - buf->maxlen);
+		buf->maxlen = newlen;
+	}
+
+	off = buf->len;
+	buf->len += size;
+	return off;
+}
+
+static NIOffset
+ImageString(ImageBuf *buf, const char *str)
+{
+	Size		len = strlen(str) + 1;
+	NIOffset	off = ImageAlloc(buf, len);
+
+	memcpy(IBPTR(buf, off), str, len);
+	return off;
+}
+
+static NIOffset
+ImageDictNode(ImageBuf *buf, SPNode *node)
+{
+	NIOffset	off;
+
+	/* since this function recurses, it could be driven to stack overflow */
+	check_stack_depth();
+
+	if (node == NULL)
+		return 0;
+
+	off = ImageAlloc(buf, offsetof(NIDictNode, data) +
+					 node->length * sizeof(NIDictNodeData));
+	((NIDictNode *) IBPTR(buf, off))->length = node->length;
+
+	for (int i = 0; i < node->length; i++)
+	{
+		SPNodeData *src = &node->data[i];
+		NIOffset	child = ImageDictNode(buf, src->node);
+		NIDictNodeData *dst = &((NIDictNode *) IBPTR(buf, off))->data[i];
+
+		dst->val = src->val;
+		dst->isword = src->isword;
+		dst->compoundflag = src->compoundflag;
+		dst->affix = src->affix;
+		dst->node = child;
+	}
+
+	return off;
+}
+
+static NIOffset
+ImageAffixNode(IspellDict *Conf, ImageBuf *buf, AffixNode *node)
+{
+	NIOffset	off;
+
+	/* since this function recurses, it could be driven to stack overflow */
+	check_stack_depth();
+
+	if (node == NULL)
+		return 0;
+
+	off = ImageAlloc(buf, offsetof(NIAffixNode, data) +
+					 node->length * sizeof(NIAffixNodeData));
+	((NIAffixNode *) IBPTR(buf, off))->isvoid = node->isvoid;
+	((NIAffixNode *) IBPTR(buf, off))->length = node->length;
+
+	for (int i = 0; i < node->length; i++)
+	{
+		AffixNodeData *src = &node->data[i];
+		NIOffset	aff = 0;
+		NIOffset	child;
+		NIAffixNodeData *dst;
+
+		if (src->naff > 0)
+		{
+			aff = ImageAlloc(buf, src->naff * sizeof(uint32));
+			for (int j = 0; j < src->naff; j++)
+				((uint32 *) IBPTR(buf, aff))[j] = src->aff[j] - Conf->Affix;
+		}
+		child = ImageAffixNode(Conf, buf, src->node);
+
+		dst = &((NIAffixNode *) IBPTR(buf, off))->data[i];
+		dst->val = src->val;
+		dst->naff = src->naff;
+		dst->aff = aff;
+		dst->node = child;
+	}
+
+	return off;
+}
+
+/*
+ * Copy the compiled dictionary into an image, allocated in the current
+ * memory context.
+ */
+static NIImage *
+MakeImage(IspellDict *Conf)
+{
+	ImageBuf	buf;
+	NIImage    *image;
+	NIOffset	off;
+
+	buf.maxlen = 8192;
+	buf.data = palloc0(buf.maxlen);
+	buf.len = 0;
+	(void) ImageAlloc(&buf, sizeof(NIImage));
+
+#define IMAGE ((NIImage *) IBPTR(&buf, 0))
+
+	IMAGE->flagMode = Conf->flagMode;
+	IMAGE->usecompound = Conf->usecompound;
+
+	/* Affixes */
+	IMAGE->naffixes = Conf->naffixes;
+	off = ImageAlloc(&buf, Max(Conf->naffixes, 1) * sizeof(NIAffix));
+	IMAGE->affixes = off;
+	for (int i = 0; i < Conf->naffixes; i++)
+	{
+		AFFIX	   *src = &Conf->Affix[i];
+		NIAffix		dst;
+
+		dst.flag = ImageString(&buf, src->flag);
+		dst.find = ImageString(&buf, src->find);
+		dst.repl = ImageString(&buf, src->repl);
+		dst.mask = ImageString(&buf, src->mask);
+		dst.type = src->type;
+		dst.flagflags = src->flagflags;
+		dst.issimple = src->issimple;
+		dst.isregis = src->isregis;
+		dst.replen = src->replen;
+		((NIAffix *) IBPTR(&buf, off))[i] = dst;
+	}
+
+	/* Sets of affix flags */
+	IMAGE->nAffixData = Conf->nAffixData;
+	off = ImageAlloc(&buf, Max(Conf->nAffixData, 1) * sizeof(NIOffset));
+	IMAGE->affixData = off;
+	for (int i = 0; i < Conf->nAffixData; i++)
+	{
+		NIOffset	str = ImageString(&buf, Conf->AffixData[i]);
+
+		((NIOffset *) IBPTR(&buf, off))[i] = str;
+	}
+
+	/* Compound affixes */
+	if (Conf->CompoundAffix != NULL)
+	{
+		int			n = 0;
+
+		while (Conf->CompoundAffix[n].affix)
+			n++;
+		off = ImageAlloc(&buf, (n + 1) * sizeof(NICompoundAffix));
+		IMAGE->compoundAffix = off;
+		for (int i = 0; i < n; i++)
+		{
+			NIOffset	str = ImageString(&buf, Conf->CompoundAffix[i].affix);
+			NICompoundAffix *dst = &((NICompoundAffix *) IBPTR(&buf, off))[i];
+
+			dst->affix = str;
+			dst->len = Conf->CompoundAffix[i].len;
+			dst->issuffix = Conf->CompoundAffix[i].issuffix;
+		}
+	}
+
+	/* The trees */
+	off = ImageDictNode(&buf, Conf->Dictionary);
+	IMAGE->dictionary = off;
+	off = ImageAffixNode(Conf, &buf, Conf->Suffix);
+	IMAGE->suffix = off;
+	off = ImageAffixNode(Conf, &buf, Conf->Prefix);
+	IMAGE->prefix = off;
+
+	IMAGE->size = buf.len;
+
+#undef IMAGE
+
+	image = (NIImage *) buf.data;
+	return image;
+}
+
+/*
+ * Compile an affix condition that is a regular expression.
+ */
+static regex_t *
+CompileAffixRegex(const char *mask, int type)
+{
+	int			masklen;
+	int			wmasklen;
+	int			err;
+	pg_wchar   *wmask;
+	char	   *tmask;
+	regex_t    *regex;
+
+	tmask = (char *) palloc(strlen(mask) + 3);
+	if (type == FF_SUFFIX)
+		sprintf(tmask, "%s$", mask);
+	else
+		sprintf(tmask, "^%s", mask);
+
+	masklen = strlen(tmask);
+	wmask = (pg_wchar *) palloc((masklen + 1) * sizeof(pg_wchar));
+	wmasklen = pg_mb2wchar_with_len(tmask, wmask, masklen);
+
+	/*
+	 * The regex and all internal state created by pg_regcomp are allocated
+	 * in the current memory context.
+	 */
+	regex = palloc_object(regex_t);
+	err = pg_regcomp(regex, wmask, wmasklen,
+					 REG_ADVANCED | REG_NOSUB,
+					 DEFAULT_COLLATION_OID);
+	if (err)
+	{
+		char		errstr[100];
+
+		pg_regerror(err, regex, errstr, sizeof(errstr));
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_REGULAR_EXPRESSION),
+				 errmsg("invalid regular expression: %s", errstr)));
+	}
+
+	pfree(wmask);
+	pfree(tmask);
+
+	return regex;
+}
+
+/*
+ * Get the compiled condition of affix number affixno, a regex_t or a Regis.
+ * They are compiled into the dictionary's own memory context when first
+ * needed, since the image can't hold them.
+ */
+static void *
+GetAffixMask(IspellDict *Conf, int affixno)
+{
+	if (Conf->masks[affixno] == NULL)
+	{
+		NIAffix    *Affix = NIAFFIX(Conf, affixno);
+		const char *mask = NISTR(Conf, Affix->mask);
+		MemoryContext oldcxt;
+
+		oldcxt = MemoryContextSwitchTo(Conf->dictCxt);
+		if (Affix->isregis)
+		{
+			Regis	   *regis = palloc0_object(Regis);
+
+			RS_compile(regis, (Affix->type == FF_SUFFIX), mask);
+			Conf->masks[affixno] = regis;
+		}
+		else
+			Conf->masks[affixno] = CompileAffixRegex(mask, Affix->type);
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	return Conf->masks[affixno];
+}
+
+static NIAffixNodeData *
+FindAffixes(IspellDict *Conf, NIAffixNode *node, const char *word, int wrdlen,
+			int *level, int type)
+{
+	NIAffixNodeData *StopLow,
 			   *StopHigh,
 			   *StopMiddle;
 	uint8 symbol;
@@ -2041,7 +2373,7 @@ FindAffixes(AffixNode *node, const char *word, int wrdlen, int *level, int type)
 	{							/* search void affixes */
 		if (node->data->naff)
 			return node->data;
-		node = node->data->node;
+		node = NIPTR(Conf, node->data->node);
 	}
 
 	while (node && *level < wrdlen)
@@ -2058,7 +2390,7 @@ FindAffixes(AffixNode *node, const char *word, int wrdlen, int *level, int type)
 				(*level)++;
 				if (StopMiddle->naff)
 					return StopMiddle;
-				node = StopMiddle->node;
+				node = NIPTR(Conf, StopMiddle->node);
 				break;
 			}
 			else if (StopMiddle->val < symbol)
@@ -2073,8 +2405,12 @@ FindAffixes(AffixNode *node, const char *word, int wrdlen, int *level, int type)
 }
 
 static char *
-CheckAffix(const char *word, size_t len, AFFIX *Affix, int flagflags, char *newword, int *baselen)
+CheckAffix(IspellDict *Conf, const char *word, size_t len, int affixno,
+		   int flagflags, char *newword, int *baselen)
 {
+	NIAffix    *Affix = NIAFFIX(Conf, affixno);
+	const char *find = NISTR(Conf, Affix->find);
+
 	/*
 	 * Check compound allow flags
 	 */
@@ -2113,7 +2449,7 @@ CheckAffix(const char *word, size_t len, AFFIX *Affix, int flagflags, char *neww
 	if (Affix->type == FF_SUFFIX)
 	{
 		strcpy(newword, word);
-		strcpy(newword + len - Affix->replen, Affix->find);
+		strcpy(newword + len - Affix->replen, find);
 		if (baselen)			/* store length of non-changed part of word */
 			*baselen = len - Affix->replen;
 	}
@@ -2123,9 +2459,9 @@ CheckAffix(const char *word, size_t len, AFFIX *Affix, int flagflags, char *neww
 		 * if prefix is an all non-changed part's length then all word
 		 * contains only prefix and suffix, so out
 		 */
-		if (baselen && *baselen + strlen(Affix->find) <= Affix->replen)
+		if (baselen && *baselen + strlen(find) <= Affix->replen)
 			return NULL;
-		strcpy(newword, Affix->find);
+		strcpy(newword, find);
 		strcat(newword, word + Affix->replen);
 	}
 
@@ -2136,7 +2472,7 @@ CheckAffix(const char *word, size_t len, AFFIX *Affix, int flagflags, char *neww
 		return newword;
 	else if (Affix->isregis)
 	{
-		if (RS_execute(&(Affix->reg.regis), newword))
+		if (RS_execute((Regis *) GetAffixMask(Conf, affixno), newword))
 			return newword;
 	}
 	else
@@ -2150,7 +2486,7 @@ CheckAffix(const char *word, size_t len, AFFIX *Affix, int flagflags, char *neww
 		data = palloc_array(pg_wchar, newword_len + 1);
 		data_len = pg_mb2wchar_with_len(newword, data, newword_len);
 
-		if (pg_regexec(Affix->reg.pregex, data, data_len,
+		if (pg_regexec((regex_t *) GetAffixMask(Conf, affixno), data, data_len,
 					   0, NULL, 0, NULL, 0) == REG_OKAY)
 		{
 			pfree(data);
@@ -2180,8 +2516,10 @@ addToResult(char **forms, char **cur, char *word)
 static char **
 NormalizeSubWord(IspellDict *Conf, const char *word, int flag)
 {
-	AffixNodeData *suffix = NULL,
+	NIAffixNodeData *suffix = NULL,
 			   *prefix = NULL;
+	uint32	   *saff,
+			   *paff;
 	int			slevel = 0,
 				plevel = 0;
 	int			wrdlen = strlen(word),
@@ -2190,7 +2528,7 @@ NormalizeSubWord(IspellDict *Conf, const char *word, int flag)
 	char	  **cur;
 	char		newword[2 * MAXNORMLEN] = "";
 	char		pnewword[2 * MAXNORMLEN] = "";
-	AffixNode  *snode = Conf->Suffix,
+	NIAffixNode *snode = NIPTR(Conf, Conf->image->suffix),
 			   *pnode;
 	int			i,
 				j;
@@ -2210,23 +2548,25 @@ NormalizeSubWord(IspellDict *Conf, const char *word, int flag)
 	}
 
 	/* Find all other NORMAL forms of the 'word' (check only prefix) */
-	pnode = Conf->Prefix;
+	pnode = NIPTR(Conf, Conf->image->prefix);
 	plevel = 0;
 	while (pnode)
 	{
-		prefix = FindAffixes(pnode, word, wrdlen, &plevel, FF_PREFIX);
+		prefix = FindAffixes(Conf, pnode, word, wrdlen, &plevel, FF_PREFIX);
 		if (!prefix)
 			break;
+		paff = NIPTR(Conf, prefix->aff);
 		for (j = 0; j < prefix->naff; j++)
 		{
-			if (CheckAffix(word, wrdlen, prefix->aff[j], flag, newword, NULL))
+			if (CheckAffix(Conf, word, wrdlen, paff[j], flag, newword, NULL))
 			{
 				/* prefix success */
-				if (FindWord(Conf, newword, prefix->aff[j]->flag, flag))
+				if (FindWord(Conf, newword,
+							 NISTR(Conf, NIAFFIX(Conf, paff[j])->flag), flag))
 					cur += addToResult(forms, cur, newword);
 			}
 		}
-		pnode = prefix->node;
+		pnode = NIPTR(Conf, prefix->node);
 	}
 
 	/*
@@ -2238,45 +2578,50 @@ NormalizeSubWord(IspellDict *Conf, const char *word, int flag)
 		int			baselen = 0;
 
 		/* find possible suffix */
-		suffix = FindAffixes(snode, word, wrdlen, &slevel, FF_SUFFIX);
+		suffix = FindAffixes(Conf, snode, word, wrdlen, &slevel, FF_SUFFIX);
 		if (!suffix)
 			break;
+		saff = NIPTR(Conf, suffix->aff);
 		/* foreach suffix check affix */
 		for (i = 0; i < suffix->naff; i++)
 		{
-			if (CheckAffix(word, wrdlen, suffix->aff[i], flag, newword, &baselen))
+			NIAffix    *sAffix = NIAFFIX(Conf, saff[i]);
+
+			if (CheckAffix(Conf, word, wrdlen, saff[i], flag, newword, &baselen))
 			{
 				/* suffix success */
-				if (FindWord(Conf, newword, suffix->aff[i]->flag, flag))
+				if (FindWord(Conf, newword, NISTR(Conf, sAffix->flag), flag))
 					cur += addToResult(forms, cur, newword);
 
 				/* now we will look changed word with prefixes */
-				pnode = Conf->Prefix;
+				pnode = NIPTR(Conf, Conf->image->prefix);
 				plevel = 0;
 				swrdlen = strlen(newword);
 				while (pnode)
 				{
-					prefix = FindAffixes(pnode, newword, swrdlen, &plevel, FF_PREFIX);
+					prefix = FindAffixes(Conf, pnode, newword, swrdlen, &plevel, FF_PREFIX);
 					if (!prefix)
 						break;
+					paff = NIPTR(Conf, prefix->aff);
 					for (j = 0; j < prefix->naff; j++)
 					{
-						if (CheckAffix(newword, swrdlen, prefix->aff[j], flag, pnewword, &baselen))
+						if (CheckAffix(Conf, newword, swrdlen, paff[j], flag, pnewword, &baselen))
 						{
 							/* prefix success */
-							const char *ff = (prefix->aff[j]->flagflags & suffix->aff[i]->flagflags & FF_CROSSPRODUCT) ?
-								VoidString : prefix->aff[j]->flag;
+							NIAffix    *pAffix = NIAFFIX(Conf, paff[j]);
+							const char *ff = (pAffix->flagflags & sAffix->flagflags & FF_CROSSPRODUCT) ?
+								VoidString : NISTR(Conf, pAffix->flag);
 
 							if (FindWord(Conf, pnewword, ff, flag))
 								cur += addToResult(forms, cur, pnewword);
 						}
 					}
-					pnode = prefix->node;
+					pnode = NIPTR(Conf, prefix->node);
 				}
 			}
 		}
 
-		snode = suffix->node;
+		snode = NIPTR(Conf, suffix->node);
 	}
 
 	if (cur == forms)
@@ -2296,7 +2641,8 @@ typedef struct SplitVar
 } SplitVar;
 
 static int
-CheckCompoundAffixes(CMPDAffix **ptr, const char *word, int len, bool CheckInPlace)
+CheckCompoundAffixes(IspellDict *Conf, NICompoundAffix **ptr, const char *word,
+					 int len, bool CheckInPlace)
 {
 	bool		issuffix;
 
@@ -2308,7 +2654,8 @@ CheckCompoundAffixes(CMPDAffix **ptr, const char *word, int len, bool CheckInPla
 	{
 		while ((*ptr)->affix)
 		{
-			if (len > (*ptr)->len && strncmp((*ptr)->affix, word, (*ptr)->len) == 0)
+			if (len > (*ptr)->len &&
+				strncmp(NISTR(Conf, (*ptr)->affix), word, (*ptr)->len) == 0)
 			{
 				len = (*ptr)->len;
 				issuffix = (*ptr)->issuffix;
@@ -2324,7 +2671,8 @@ CheckCompoundAffixes(CMPDAffix **ptr, const char *word, int len, bool CheckInPla
 
 		while ((*ptr)->affix)
 		{
-			if (len > (*ptr)->len && (affbegin = strstr(word, (*ptr)->affix)) != NULL)
+			if (len > (*ptr)->len &&
+				(affbegin = strstr(word, NISTR(Conf, (*ptr)->affix))) != NULL)
 			{
 				len = (*ptr)->len + (affbegin - word);
 				issuffix = (*ptr)->issuffix;
@@ -2376,17 +2724,17 @@ AddStem(SplitVar *v, char *word)
 }
 
 static SplitVar *
-SplitToVariants(IspellDict *Conf, SPNode *snode, SplitVar *orig, const char *word, int wordlen, int startpos, int minpos)
+SplitToVariants(IspellDict *Conf, NIDictNode *snode, SplitVar *orig, const char *word, int wordlen, int startpos, int minpos)
 {
 	SplitVar   *var = NULL;
-	SPNodeData *StopLow,
+	NIDictNodeData *StopLow,
 			   *StopHigh,
 			   *StopMiddle = NULL;
-	SPNode	   *node = (snode) ? snode : Conf->Dictionary;
+	NIDictNode *node = (snode) ? snode : NIPTR(Conf, Conf->image->dictionary);
 	int			level = (snode) ? minpos : startpos;	/* recursive
 														 * minpos==level */
 	int			lenaff;
-	CMPDAffix  *caff;
+	NICompoundAffix *caff;
 	char	   *notprobed;
 	int			compoundflag = 0;
 
@@ -2400,8 +2748,8 @@ SplitToVariants(IspellDict *Conf, SPNode *snode, SplitVar *orig, const char *wor
 	while (level < wordlen)
 	{
 		/* find word with epenthetic or/and compound affix */
-		caff = Conf->CompoundAffix;
-		while (level > startpos && (lenaff = CheckCompoundAffixes(&caff, word + level, wordlen - level, (node) ? true : false)) >= 0)
+		caff = NIPTR(Conf, Conf->image->compoundAffix);
+		while (level > startpos && (lenaff = CheckCompoundAffixes(Conf, &caff, word + level, wordlen - level, (node) ? true : false)) >= 0)
 		{
 			/*
 			 * there is one of compound affixes, so check word for existings
@@ -2507,13 +2855,13 @@ SplitToVariants(IspellDict *Conf, SPNode *snode, SplitVar *orig, const char *wor
 						/* we can find next word */
 						level++;
 						AddStem(var, pnstrdup(word + startpos, level - startpos));
-						node = Conf->Dictionary;
+						node = NIPTR(Conf, Conf->image->dictionary);
 						startpos = level;
 						continue;
 					}
 				}
 			}
-			node = StopMiddle->node;
+			node = NIPTR(Conf, StopMiddle->node);
 		}
 		else
 			node = NULL;
@@ -14,8 +14,10 @@
 
 #include "postgres.h"
 
+#include "common/hashfn.h"
 #include "tsearch/ts_cache.h"
 #include "tsearch/ts_utils.h"
+#include "utils/memutils.h"
 #include "varatt.h"
 
 #define IGNORE_LONGLEXEME	1
@@ -55,6 +57,9 @@ typedef struct
 
 	ParsedLex  *lastRes;
 	TSLexeme   *tmpRes;
+
+	/* set when a dictionary asks for the next word, see parsetext */
+	bool		multiword;
 } LexizeData;
 
 static void
@@ -67,6 +72,7 @@ LexizeInit(LexizeData *ld, TSConfigCacheEntry *cfg)
 	ld->waste.head = ld->waste.tail = NULL;
 	ld->lastRes = NULL;
 	ld->tmpRes = NULL;
+	ld->multiword = false;
 }
 
 static void
@@ -221,6 +227,7 @@ LexizeExec(LexizeData *ld, ParsedLex **correspondLexem)
 					ld->curDictId = map->dictIds[i];
 					ld->posDict = i + 1;
 					ld->curSub = curVal->next;
+					ld->multiword = true;
 					if (res)
 						setNewTmpRes(ld, curVal, res);
 					return LexizeExec(ld, correspondLexem);
@@ -346,6 +353,115 @@ LexizeExec(LexizeData *ld, ParsedLex **correspondLexem)
 	return NULL;
 }
 
+/*
+ * Cache of the dictionary results for the words of one document.
+ *
+ * Natural-language text repeats the same words over and over, and running
+ * each of them through the dictionaries again (an Ispell or Snowball lookup,
+ * say) is where most of the time of to_tsvector() goes.  As long as no
+ * dictionary asks for the following words, a word of a given token type
+ * always normalizes to the same lexemes, so parsetext remembers them.
+ * Short documents don't repeat enough to pay for the hash table, and the
+ * number of entries is limited to bound the memory used for huge ones.
+ */
+#define LEXCACHE_MIN_DOCLEN		1024
+#define LEXCACHE_MAX_ENTRIES	16384
+
+typedef struct LexemeCacheKey
+{
+	int			type;
+	int			len;
+	const char *lemm;
+} LexemeCacheKey;
+
+typedef struct LexemeCacheEntry
+{
+	LexemeCacheKey key;
+	char		status;			/* hash status */
+	TSLexeme   *norms;			/* NULL if no dictionary recognized it */
+} LexemeCacheEntry;
+
+static inline uint32
+lexcache_hash_key(LexemeCacheKey key)
+{
+	return hash_combine(murmurhash32((uint32) key.type),
+						hash_bytes((const unsigned char *) key.lemm, key.len));
+}
+
+static inline bool
+lexcache_key_equal(LexemeCacheKey a, LexemeCacheKey b)
+{
+	return a.type == b.type && a.len == b.len &&
+		memcmp(a.lemm, b.lemm, a.len) == 0;
+}
+
+#define SH_PREFIX		lexcache
+#define SH_ELEMENT_TYPE	LexemeCacheEntry
+#define SH_KEY_TYPE		LexemeCacheKey
+#define SH_KEY			key
+#define SH_HASH_KEY(tb, key)	lexcache_hash_key(key)
+#define SH_EQUAL(tb, a, b)		lexcache_key_equal(a, b)
+#define SH_SCOPE		static inline
+#define SH_DECLARE
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
+/*
+ * Copy a result of LexizeExec into the given context.
+ */
+static TSLexeme *
+copy_norms(MemoryContext cxt, TSLexeme *norms)
+{
+	TSLexeme   *res;
+	int			n = 0;
+	int			i;
+
+	while (norms[n].lexeme)
+		n++;
+
+	res = MemoryContextAlloc(cxt, sizeof(TSLexeme) * (n + 1));
+	for (i = 0; i < n; i++)
+	{
+		res[i] = norms[i];
+		res[i].lexeme = MemoryContextStrdup(cxt, norms[i].lexeme);
+	}
+	memset(&res[n], 0, sizeof(TSLexeme));
+
+	return res;
+}
+
+/*
+ * Add the lexemes of one normalized word to prs.  If copy is true, the
+ * lexeme strings belong to someone else and are copied.
+ */
+static void
+addnorms(ParsedText *prs, TSLexeme *norms, bool copy)
+{
+	TSLexeme   *ptr = norms;
+
+	prs->pos++;					/* set pos */
+
+	while (ptr->lexeme)
+	{
+		if (prs->curwords == prs->lenwords)
+		{
+			prs->lenwords *= 2;
+			prs->words = (ParsedWord *) repalloc(prs->words, prs->lenwords * sizeof(ParsedWord));
+		}
+
+		if (ptr->flags & TSL_ADDPOS)
+			prs->pos++;
+		prs->words[prs->curwords].len = strlen(ptr->lexeme);
+		prs->words[prs->curwords].word = copy ? pstrdup(ptr->lexeme) : ptr->lexeme;
+		prs->words[prs->curwords].nvariant = ptr->nvariant;
+		prs->words[prs->curwords].flags = ptr->flags & TSL_PREFIX;
+		prs->words[prs->curwords].alen = 0;
+		prs->words[prs->curwords].pos.pos = LIMITPOS(prs->pos);
+		ptr++;
+		prs->curwords++;
+	}
+}
+
 /*
  * Parse string and lexize words.
  *
@@ -362,6 +478,8 @@ parsetext(Oid cfgId, ParsedText *prs, char *buf, int buflen)
 	TSConfigCacheEntry *cfg;
 	TSParserCacheEntry *prsobj;
 	void	   *prsdata;
+	MemoryContext cacheCxt = NULL;
+	lexcache_hash *cache = NULL;
 
 	cfg = lookup_ts_config_cache(cfgId);
 	prsobj = lookup_ts_parser_cache(cfg->prsId);
@@ -372,6 +490,14 @@ parsetext(Oid cfgId, ParsedText *prs, char *buf, int buflen)
 
 	LexizeInit(&ldata, cfg);
 
+	if (buflen >= LEXCACHE_MIN_DOCLEN)
+	{
+		cacheCxt = AllocSetContextCreate(CurrentMemoryContext,
+										 "tsvector lexeme cache",
+										 ALLOCSET_DEFAULT_SIZES);
+		cache = lexcache_create(cacheCxt, 256, NULL);
+	}
+
 	do
 	{
 		type = DatumGetInt32(FunctionCall3(&(prsobj->prstoken),
@@ -397,38 +523,70 @@ parsetext(Oid cfgId, ParsedText *prs, char *buf, int buflen)
 #endif
 		}
 
-		LexizeAddLemm(&ldata, type, lemm, lenlemm);
-
-		while ((norms = LexizeExec(&ldata, NULL)) != NULL)
+		/*
+		 * The cache can only be used for a word that starts afresh, not one
+		 * that a dictionary is collecting as part of a phrase.  Token types
+		 * without dictionaries, such as spaces, are not worth caching.
+		 */
+		if (cache != NULL && type > 0 && type < cfg->lenmap &&
+			cfg->map[type].len > 0 &&
+			ldata.towork.head == NULL && ldata.curDictId == InvalidOid)
 		{
-			TSLexeme   *ptr = norms;
+			LexemeCacheKey key;
+			LexemeCacheEntry *entry;
+			TSLexeme   *cached = NULL;
+			bool		full = (cache->members >= LEXCACHE_MAX_ENTRIES);
+			bool		found;
+
+			key.type = type;
+			key.len = lenlemm;
+			key.lemm = lemm;
+
+			entry = lexcache_lookup(cache, key);
+			if (entry != NULL)
+			{
+				if (entry->norms)
+					addnorms(prs, entry->norms, true);
+				continue;
+			}
 
-			prs->pos++;			/* set pos */
+			ldata.multiword = false;
+			LexizeAddLemm(&ldata, type, lemm, lenlemm);
 
-			while (ptr->lexeme)
+			while ((norms = LexizeExec(&ldata, NULL)) != NULL)
 			{
-				if (prs->curwords == prs->lenwords)
-				{
-					prs->lenwords *= 2;
-					prs->words = (ParsedWord *) repalloc(prs->words, prs->lenwords * sizeof(ParsedWord));
-				}
+				if (!full && !ldata.multiword)
+					cached = copy_norms(cacheCxt, norms);
+				addnorms(prs, norms, false);
+				pfree(norms);
+			}
 
-				if (ptr->flags & TSL_ADDPOS)
-					prs->pos++;
-				prs->words[prs->curwords].len = strlen(ptr->lexeme);
-				prs->words[prs->curwords].word = ptr->lexeme;
-				prs->words[prs->curwords].nvariant = ptr->nvariant;
-				prs->words[prs->curwords].flags = ptr->flags & TSL_PREFIX;
-				prs->words[prs->curwords].alen = 0;
-				prs->words[prs->curwords].pos.pos = LIMITPOS(prs->pos);
-				ptr++;
-				prs->curwords++;
+			if (!full && !ldata.multiword)
+			{
+				char	   *copy = MemoryContextAlloc(cacheCxt, lenlemm);
+
+				memcpy(copy, lemm, lenlemm);
+				key.lemm = copy;
+				entry = lexcache_insert(cache, key, &found);
+				Assert(!found);
+				entry->norms = cached;
 			}
+			continue;
+		}
+
+		LexizeAddLemm(&ldata, type, lemm, lenlemm);
+
+		while ((norms = LexizeExec(&ldata, NULL)) != NULL)
+		{
+			addnorms(prs, norms, false);
 			pfree(norms);
 		}
 	} while (type > 0);
 
 	FunctionCall1(&(prsobj->prsend), PointerGetDatum(prsdata));
+
+	if (cacheCxt)
+		MemoryContextDelete(cacheCxt);
 }
 
 /*
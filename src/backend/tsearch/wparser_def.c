@@ -244,6 +244,7 @@ typedef struct TParser
 	char	   *str;			/* multibyte string */
 	int			lenstr;			/* length of mbstring */
 	pg_wchar   *pgwstr;			/* wide character string for C-locale */
+	pg_locale_t locale;			/* database default locale */
 
 	/* State of parse */
 	int			charmaxlen;
@@ -264,6 +265,7 @@ typedef struct TParser
 
 /* forward decls here */
 static bool TParserGet(TParser *prs);
+static void init_ascii_ctype(pg_locale_t locale);
 
 
 static TParserPosition *
@@ -289,6 +291,8 @@ TParserInit(char *str, int len)
 	TParser    *prs = palloc0_object(TParser);
 
 	prs->charmaxlen = pg_database_encoding_max_length();
+	prs->locale = pg_database_locale();
+	init_ascii_ctype(prs->locale);
 	prs->str = str;
 	prs->lenstr = len;
 	prs->pgwstr = palloc_array(pg_wchar, prs->lenstr + 1);
@@ -321,6 +325,7 @@ TParserCopyInit(const TParser *orig)
 	TParser    *prs = palloc0_object(TParser);
 
 	prs->charmaxlen = orig->charmaxlen;
+	prs->locale = orig->locale;
 	prs->str = orig->str + orig->state->posbyte;
 	prs->lenstr = orig->lenstr - orig->state->posbyte;
 
@@ -379,6 +384,60 @@ TParserCopyClose(TParser *prs)
 }
 
 
+/*
+ * Character classes of the ASCII characters in the database default locale.
+ * The parser asks several of these questions about nearly every character,
+ * so they are answered from a table that is filled in once per locale,
+ * rather than by calling into the locale provider each time.
+ */
+#define CT_alnum	0x0001
+#define CT_alpha	0x0002
+#define CT_digit	0x0004
+#define CT_lower	0x0008
+#define CT_print	0x0010
+#define CT_punct	0x0020
+#define CT_space	0x0040
+#define CT_upper	0x0080
+#define CT_xdigit	0x0100
+
+static pg_locale_t ascii_ctype_locale = NULL;
+static uint16 ascii_ctype[128];
+
+static void
+init_ascii_ctype(pg_locale_t locale)
+{
+	pg_wchar	wc;
+
+	if (ascii_ctype_locale == locale)
+		return;
+
+	for (wc = 0; wc < lengthof(ascii_ctype); wc++)
+	{
+		uint16		ct = 0;
+
+		if (pg_iswalnum(wc, locale))
+			ct |= CT_alnum;
+		if (pg_iswalpha(wc, locale))
+			ct |= CT_alpha;
+		if (pg_iswdigit(wc, locale))
+			ct |= CT_digit;
+		if (pg_iswlower(wc, locale))
+			ct |= CT_lower;
+		if (pg_iswprint(wc, locale))
+			ct |= CT_print;
+		if (pg_iswpunct(wc, locale))
+			ct |= CT_punct;
+		if (pg_iswspace(wc, locale))
+			ct |= CT_space;
+		if (pg_iswupper(wc, locale))
+			ct |= CT_upper;
+		if (pg_iswxdigit(wc, locale))
+			ct |= CT_xdigit;
+		ascii_ctype[wc] = ct;
+	}
+	ascii_ctype_locale = locale;
+}
+
 /*
  * Character-type support functions using the database default locale. If the
  * locale is C, and the input character is non-ascii, the value to be returned
@@ -390,13 +449,14 @@ TParserCopyClose(TParser *prs)
 static int																	\
 p_is##type(TParser *prs)													\
 {																			\
-	pg_locale_t locale = pg_database_locale();								\
 	pg_wchar	wc;															\
 	Assert(prs->state);														\
 	wc = prs->pgwstr[prs->state->poschar];									\
-	if (prs->charmaxlen > 1 && locale->ctype_is_c && wc > 0x7f)				\
+	if (wc < lengthof(ascii_ctype))											\
+		return (ascii_ctype[wc] & CT_##type) != 0;							\
+	if (prs->charmaxlen > 1 && prs->locale->ctype_is_c)						\
 		return nonascii;													\
-	return pg_isw##type(wc, pg_database_locale());						\
+	return pg_isw##type(wc, prs->locale);									\
 }																			\
 																			\
 static int																	\
@@ -322,6 +322,7 @@ pgstat_bestart_initial(void)
 	lbeentry.st_progress_command_target = InvalidOid;
 	lbeentry.st_query_id = INT64CONST(0);
 	lbeentry.st_plan_id = INT64CONST(0);
+	lbeentry.st_allocated_bytes = *my_allocated_bytes;
 
 	/*
 	 * we don't zero st_progress_param here to save cycles; nobody should
@@ -369,6 +370,9 @@ pgstat_bestart_initial(void)
 #endif
 
 	PGSTAT_END_WRITE_ACTIVITY(vbeentry);
+
+	/* From now on, keep our memory allocation total in the shared entry */
+	MemoryAccountingAttach(&MyBEEntry->st_allocated_bytes);
 }
 
 /* ----------
@@ -510,6 +514,9 @@ pgstat_beshutdown_hook(int code, Datum arg)
 {
 	volatile PgBackendStatus *beentry = MyBEEntry;
 
+	/* Stop updating the allocation total in the shared entry */
+	MemoryAccountingDetach();
+
 	/*
 	 * Clear my status entry, following the protocol of bumping st_changecount
 	 * before and after.  We use a volatile pointer here to ensure the
@@ -482,6 +482,25 @@ static const PgStat_KindInfo pgstat_kind_builtin_infos[PGSTAT_KIND_BUILTIN_SIZE]
 		.reset_all_cb = pgstat_wal_reset_all_cb,
 		.snapshot_cb = pgstat_wal_snapshot_cb,
 	},
+
+	[PGSTAT_KIND_LWLOCK] = {
+		.name = "lwlock",
+
+		.fixed_amount = true,
+		/* extensions' tranche IDs can change across restarts */
+		.write_to_file = false,
+
+		.snapshot_ctl_off = offsetof(PgStat_Snapshot, lwlock),
+		.shared_ctl_off = offsetof(PgStat_ShmemControl, lwlock),
+		.shared_data_off = offsetof(PgStatShared_LWLock, stats),
+		.shared_data_len = sizeof(((PgStatShared_LWLock *) 0)->stats),
+
+		.init_backend_cb = pgstat_lwlock_init_backend_cb,
+		.flush_static_cb = pgstat_lwlock_flush_cb,
+		.init_shmem_cb = pgstat_lwlock_init_shmem_cb,
+		.reset_all_cb = pgstat_lwlock_reset_all_cb,
+		.snapshot_cb = pgstat_lwlock_snapshot_cb,
+	},
 };
 
 /*
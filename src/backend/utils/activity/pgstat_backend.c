@@ -215,7 +215,8 @@ pgstat_flush_backend_entry_io(PgStat_EntryRef *entry_ref)
 static inline bool
 pgstat_backend_wal_have_pending(void)
 {
-	return (pgWalUsage.wal_records != prevBackendWalUsage.wal_records);
+	return (pgWalUsage.wal_records != prevBackendWalUsage.wal_records ||
+			pgWalUsage.commit_delays != prevBackendWalUsage.commit_delays);
 }
 
 /*
@@ -253,6 +254,8 @@ pgstat_flush_backend_entry_wal(PgStat_EntryRef *entry_ref)
 	WALSTAT_ACC(wal_fpi, wal_usage_diff);
 	WALSTAT_ACC(wal_bytes, wal_usage_diff);
 	WALSTAT_ACC(wal_fpi_bytes, wal_usage_diff);
+	WALSTAT_ACC(commit_delays, wal_usage_diff);
+	WALSTAT_ACC(commit_delay_time, wal_usage_diff);
 #undef WALSTAT_ACC
 
 	/*
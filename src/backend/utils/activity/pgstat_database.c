@@ -17,7 +17,9 @@
 
 #include "postgres.h"
 
+#include "postmaster/postmaster.h"
 #include "storage/procsignal.h"
+#include "tcop/backend_startup.h"
 #include "utils/pgstat_internal.h"
 #include "utils/timestamp.h"
 
@@ -235,6 +237,12 @@ pgstat_report_connect(Oid dboid)
 
 	dbentry = pgstat_prep_database_pending(MyDatabaseId);
 	dbentry->sessions++;
+
+	/* Did a warm backend take this connection, if there were any? */
+	if (WarmBackendStart)
+		dbentry->warm_backend_hits++;
+	else if (WarmBackends > 0)
+		dbentry->warm_backend_misses++;
 }
 
 /*
@@ -480,6 +488,8 @@ pgstat_database_flush_cb(PgStat_EntryRef *entry_ref, bool nowait)
 	PGSTAT_ACCUM_DBCOUNT(sessions_killed);
 	PGSTAT_ACCUM_DBCOUNT(parallel_workers_to_launch);
 	PGSTAT_ACCUM_DBCOUNT(parallel_workers_launched);
+	PGSTAT_ACCUM_DBCOUNT(warm_backend_hits);
+	PGSTAT_ACCUM_DBCOUNT(warm_backend_misses);
 #undef PGSTAT_ACCUM_DBCOUNT
 
 	pgstat_unlock_entry(entry_ref);
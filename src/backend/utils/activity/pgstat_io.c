@@ -17,12 +17,54 @@
 #include "postgres.h"
 
 #include "executor/instrument.h"
+#include "port/pg_bitutils.h"
 #include "storage/bufmgr.h"
 #include "utils/pgstat_internal.h"
 
 static PgStat_PendingIO PendingIOStats;
 static bool have_iostats = false;
 
+/*
+ * Pending latency histograms.  These are not kept per backend, so they are
+ * separate from PendingIOStats, which pgstat_backend.c shares the layout of.
+ */
+static PgStat_BktypeIOHist PendingIOHist;
+static bool have_iohist = false;
+
+/* upper bound of histogram bucket 0, in microseconds */
+#define PGSTAT_IO_HIST_MIN_SHIFT	3
+
+/*
+ * Return the latency histogram bucket for an IO operation that took
+ * 'io_time'.
+ */
+static inline int
+pgstat_io_hist_bucket(instr_time io_time)
+{
+	uint64		us = INSTR_TIME_GET_MICROSEC(io_time);
+	int			bucket;
+
+	if (us < (UINT64CONST(1) << PGSTAT_IO_HIST_MIN_SHIFT))
+		return 0;
+
+	bucket = pg_leftmost_one_pos64(us) - PGSTAT_IO_HIST_MIN_SHIFT + 1;
+	return Min(bucket, PGSTAT_IO_HIST_BUCKETS - 1);
+}
+
+/*
+ * Return the lower bound, in microseconds, of the given latency histogram
+ * bucket.  The upper bound is that of the next bucket.
+ */
+uint64
+pgstat_get_io_hist_bucket_bound(int bucket)
+{
+	Assert(bucket >= 0 && bucket <= PGSTAT_IO_HIST_BUCKETS);
+
+	if (bucket == 0)
+		return 0;
+	return UINT64CONST(1) << (bucket + PGSTAT_IO_HIST_MIN_SHIFT - 1);
+}
+
 /*
  * Check that stats have not been counted for any combination of IOObject,
  * IOContext, and IOOp which are not tracked for the passed-in BackendType. If
@@ -152,6 +194,10 @@ pgstat_count_io_op_time(IOObject io_object, IOContext io_context, IOOp io_op,
 		INSTR_TIME_ADD(PendingIOStats.pending_times[io_object][io_context][io_op],
 					   io_time);
 
+		/* one operation of 'cnt' blocks has a single latency */
+		PendingIOHist.buckets[io_object][io_context][io_op][pgstat_io_hist_bucket(io_time)]++;
+		have_iohist = true;
+
 		/* Add the per-backend count */
 		pgstat_count_backend_io_op_time(io_object, io_context, io_op,
 										io_time);
@@ -190,6 +236,7 @@ pgstat_io_flush_cb(bool nowait)
 {
 	LWLock	   *bktype_lock;
 	PgStat_BktypeIO *bktype_shstats;
+	PgStat_BktypeIOHist *bktype_shhist;
 
 	if (!have_iostats)
 		return false;
@@ -197,6 +244,8 @@ pgstat_io_flush_cb(bool nowait)
 	bktype_lock = &pgStatLocal.shmem->io.locks[MyBackendType];
 	bktype_shstats =
 		&pgStatLocal.shmem->io.stats.stats[MyBackendType];
+	bktype_shhist =
+		&pgStatLocal.shmem->io.stats.hist[MyBackendType];
 
 	if (!nowait)
 		LWLockAcquire(bktype_lock, LW_EXCLUSIVE);
@@ -221,6 +270,13 @@ pgstat_io_flush_cb(bool nowait)
 
 				bktype_shstats->times[io_object][io_context][io_op] +=
 					INSTR_TIME_GET_MICROSEC(time);
+
+				if (have_iohist)
+				{
+					for (int i = 0; i < PGSTAT_IO_HIST_BUCKETS; i++)
+						bktype_shhist->buckets[io_object][io_context][io_op][i] +=
+							PendingIOHist.buckets[io_object][io_context][io_op][i];
+				}
 			}
 		}
 	}
@@ -230,8 +286,11 @@ pgstat_io_flush_cb(bool nowait)
 	LWLockRelease(bktype_lock);
 
 	memset(&PendingIOStats, 0, sizeof(PendingIOStats));
+	if (have_iohist)
+		memset(&PendingIOHist, 0, sizeof(PendingIOHist));
 
 	have_iostats = false;
+	have_iohist = false;
 
 	return false;
 }
@@ -274,6 +333,33 @@ pgstat_get_io_object_name(IOObject io_object)
 	pg_unreachable();
 }
 
+const char *
+pgstat_get_io_op_name(IOOp io_op)
+{
+	switch (io_op)
+	{
+		case IOOP_EVICT:
+			return "evict";
+		case IOOP_FSYNC:
+			return "fsync";
+		case IOOP_HIT:
+			return "hit";
+		case IOOP_REUSE:
+			return "reuse";
+		case IOOP_WRITEBACK:
+			return "writeback";
+		case IOOP_EXTEND:
+			return "extend";
+		case IOOP_READ:
+			return "read";
+		case IOOP_WRITE:
+			return "write";
+	}
+
+	elog(ERROR, "unrecognized IOOp value: %d", io_op);
+	pg_unreachable();
+}
+
 void
 pgstat_io_init_shmem_cb(void *stats)
 {
@@ -301,6 +387,8 @@ pgstat_io_reset_all_cb(TimestampTz ts)
 			pgStatLocal.shmem->io.stats.stat_reset_timestamp = ts;
 
 		memset(bktype_shstats, 0, sizeof(*bktype_shstats));
+		memset(&pgStatLocal.shmem->io.stats.hist[i], 0,
+			   sizeof(PgStat_BktypeIOHist));
 		LWLockRelease(bktype_lock);
 	}
 }
@@ -326,6 +414,7 @@ pgstat_io_snapshot_cb(void)
 
 		/* using struct assignment due to better type safety */
 		*bktype_snap = *bktype_shstats;
+		pgStatLocal.snapshot.io.hist[i] = pgStatLocal.shmem->io.stats.hist[i];
 		LWLockRelease(bktype_lock);
 	}
 }
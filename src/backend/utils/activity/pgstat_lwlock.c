@@ -0,0 +1,199 @@
+/* -------------------------------------------------------------------------
+ *
+ * pgstat_lwlock.c
+ *	  Implementation of LWLock statistics.
+ *
+ * This file contains the implementation of LWLock statistics, which count
+ * the acquisitions of LWLocks and the time spent waiting for them, per
+ * tranche.  It is kept separate from pgstat.c to enforce the line between
+ * the statistics access / storage implementation and the details about
+ * individual types of statistics.
+ *
+ * Acquisitions are counted by lwlock.c itself, directly in
+ * PendingLWLockStats, as that has to be as cheap as possible.  In
+ * particular, that doesn't set pgstat_report_fixed, so acquisitions alone
+ * are flushed along with other statistics only.  Waits and spin delays are
+ * rare enough to be counted here.
+ *
+ * The statistics are not written to disk at shutdown, since the tranche IDs
+ * assigned to extensions needn't be the same after a restart.
+ *
+ * Copyright (c) 2001-2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/activity/pgstat_lwlock.c
+ * -------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "utils/pgstat_internal.h"
+#include "utils/timestamp.h"
+
+
+/*
+ * LWLock statistics counts waiting to be flushed out.  Changes are reported
+ * while holding spinlocks and within critical sections, so this must be
+ * static memory.
+ */
+PgStat_LWLockStats PendingLWLockStats[NUM_LWLOCK_TRANCHES];
+
+
+/*
+ * Tell pgstat_report_stat() that there is something to flush.
+ *
+ * This is skipped once the stats system has been shut down, as LWLocks are
+ * still used during the rest of the shutdown, and the postmaster never
+ * reports statistics.
+ */
+static inline void
+pgstat_lwlock_have_pending(void)
+{
+	if (IsUnderPostmaster && pgStatLocal.shmem != NULL &&
+		!pgStatLocal.shmem->is_shutdown)
+		pgstat_report_fixed = true;
+}
+
+/*
+ * Count a wait for a lock of the given tranche, which began at 'wait_start'
+ * and has just ended.
+ */
+void
+pgstat_count_lwlock_wait(int tranche_id, instr_time wait_start)
+{
+	instr_time	wait_time;
+
+	if (tranche_id < 0 || tranche_id >= NUM_LWLOCK_TRANCHES)
+		return;
+
+	INSTR_TIME_SET_CURRENT(wait_time);
+	INSTR_TIME_SUBTRACT(wait_time, wait_start);
+
+	PendingLWLockStats[tranche_id].waits++;
+	PendingLWLockStats[tranche_id].wait_time +=
+		INSTR_TIME_GET_MICROSEC(wait_time);
+
+	pgstat_lwlock_have_pending();
+}
+
+/*
+ * Count spin delays while acquiring the wait list lock of a lock of the
+ * given tranche.
+ */
+void
+pgstat_count_lwlock_spin_delays(int tranche_id, int delays)
+{
+	if (tranche_id < 0 || tranche_id >= NUM_LWLOCK_TRANCHES)
+		return;
+
+	PendingLWLockStats[tranche_id].spin_delays += delays;
+
+	pgstat_lwlock_have_pending();
+}
+
+/*
+ * Support function for the SQL-callable pgstat* functions.  Returns a
+ * pointer to the statistics of all tranches, indexed by tranche ID, and the
+ * time they were last reset.
+ */
+PgStat_LWLockStats *
+pgstat_fetch_lwlock(TimestampTz *stat_reset_timestamp)
+{
+	pgstat_snapshot_fixed(PGSTAT_KIND_LWLOCK);
+
+	*stat_reset_timestamp = pgStatLocal.snapshot.lwlock.stat_reset_timestamp;
+	return pgStatLocal.snapshot.lwlock.stats;
+}
+
+/*
+ * Flush out locally pending LWLock statistics
+ *
+ * If nowait is true, this function returns true if the lock could not be
+ * acquired. Otherwise return false.
+ */
+bool
+pgstat_lwlock_flush_cb(bool nowait)
+{
+	PgStatShared_LWLock *stats_shmem = &pgStatLocal.shmem->lwlock;
+	static const PgStat_LWLockStats all_zeroes;
+	int			ntranches = 0;
+
+	/* don't take the lock if there's nothing to flush */
+	for (int i = 0; i < NUM_LWLOCK_TRANCHES; i++)
+	{
+		if (memcmp(&PendingLWLockStats[i], &all_zeroes,
+				   sizeof(PgStat_LWLockStats)) != 0)
+			ntranches = i + 1;
+	}
+	if (ntranches == 0)
+		return false;
+
+	if (!nowait)
+		LWLockAcquire(&stats_shmem->lock, LW_EXCLUSIVE);
+	else if (!LWLockConditionalAcquire(&stats_shmem->lock, LW_EXCLUSIVE))
+		return true;
+
+	for (int i = 0; i < ntranches; i++)
+	{
+		PgStat_LWLockStats *sharedent = &stats_shmem->stats.stats[i];
+		PgStat_LWLockStats *pendingent = &PendingLWLockStats[i];
+
+#define LWLOCK_ACC(fld) sharedent->fld += pendingent->fld
+		LWLOCK_ACC(acquisitions);
+		LWLOCK_ACC(waits);
+		LWLOCK_ACC(wait_time);
+		LWLOCK_ACC(spin_delays);
+#undef LWLOCK_ACC
+	}
+
+	/*
+	 * Done, clear the pending entries.  That includes our own acquisition of
+	 * the lock above, which was counted before we added up the counts.
+	 */
+	MemSet(PendingLWLockStats, 0, ntranches * sizeof(PgStat_LWLockStats));
+
+	LWLockRelease(&stats_shmem->lock);
+
+	return false;
+}
+
+void
+pgstat_lwlock_init_backend_cb(void)
+{
+	/* forget anything the postmaster counted before forking us */
+	MemSet(PendingLWLockStats, 0, sizeof(PgStat_LWLockStats) *
+		   NUM_LWLOCK_TRANCHES);
+}
+
+void
+pgstat_lwlock_init_shmem_cb(void *stats)
+{
+	PgStatShared_LWLock *stats_shmem = (PgStatShared_LWLock *) stats;
+
+	LWLockInitialize(&stats_shmem->lock, LWTRANCHE_PGSTATS_DATA);
+
+	/* the statistics are not restored from disk, so they start out fresh */
+	stats_shmem->stats.stat_reset_timestamp = GetCurrentTimestamp();
+}
+
+void
+pgstat_lwlock_reset_all_cb(TimestampTz ts)
+{
+	PgStatShared_LWLock *stats_shmem = &pgStatLocal.shmem->lwlock;
+
+	LWLockAcquire(&stats_shmem->lock, LW_EXCLUSIVE);
+	memset(&stats_shmem->stats, 0, sizeof(stats_shmem->stats));
+	stats_shmem->stats.stat_reset_timestamp = ts;
+	LWLockRelease(&stats_shmem->lock);
+}
+
+void
+pgstat_lwlock_snapshot_cb(void)
+{
+	PgStatShared_LWLock *stats_shmem = &pgStatLocal.shmem->lwlock;
+
+	LWLockAcquire(&stats_shmem->lock, LW_SHARED);
+	memcpy(&pgStatLocal.snapshot.lwlock, &stats_shmem->stats,
+		   sizeof(pgStatLocal.snapshot.lwlock));
+	LWLockRelease(&stats_shmem->lock);
+}
@@ -83,6 +83,9 @@ PGSTAT_COUNT_SLRU(flush)
 /* pgstat_count_slru_truncate */
 PGSTAT_COUNT_SLRU(truncate)
 
+/* pgstat_count_slru_overflowed_snapshot */
+PGSTAT_COUNT_SLRU(overflowed_snapshot)
+
 /*
  * Support function for the SQL-callable pgstat* functions. Returns
  * a pointer to the slru statistics struct.
@@ -165,6 +168,7 @@ pgstat_slru_flush_cb(bool nowait)
 		SLRU_ACC(blocks_exists);
 		SLRU_ACC(flush);
 		SLRU_ACC(truncate);
+		SLRU_ACC(overflowed_snapshot);
 #undef SLRU_ACC
 	}
 
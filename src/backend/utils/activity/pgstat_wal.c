@@ -77,7 +77,8 @@ pgstat_fetch_stat_wal(void)
 static inline bool
 pgstat_wal_have_pending(void)
 {
-	return pgWalUsage.wal_records != prevWalUsage.wal_records;
+	return pgWalUsage.wal_records != prevWalUsage.wal_records ||
+		pgWalUsage.commit_delays != prevWalUsage.commit_delays;
 }
 
 /*
@@ -123,6 +124,8 @@ pgstat_wal_flush_cb(bool nowait)
 	WALSTAT_ACC(wal_bytes, wal_usage_diff);
 	WALSTAT_ACC(wal_fpi_bytes, wal_usage_diff);
 	WALSTAT_ACC(wal_buffers_full, wal_usage_diff);
+	WALSTAT_ACC(commit_delays, wal_usage_diff);
+	WALSTAT_ACC(commit_delay_time, wal_usage_diff);
 #undef WALSTAT_ACC
 
 	LWLockRelease(&stats_shmem->lock);
@@ -320,16 +320,28 @@ float4out(PG_FUNCTION_ARGS)
 {
 	float4		num = PG_GETARG_FLOAT4(0);
 	char	   *ascii = (char *) palloc(32);
+
+	float4out_buf(num, ascii);
+	PG_RETURN_CSTRING(ascii);
+}
+
+/*
+ * float4out_buf - guts of float4out()
+ *
+ * Writes the result into buf, which must be at least 32 bytes long.
+ */
+void
+float4out_buf(float4 num, char *buf)
+{
 	int			ndig = FLT_DIG + extra_float_digits;
 
 	if (extra_float_digits > 0)
 	{
-		float_to_shortest_decimal_buf(num, ascii);
-		PG_RETURN_CSTRING(ascii);
+		float_to_shortest_decimal_buf(num, buf);
+		return;
 	}
 
-	(void) pg_strfromd(ascii, 32, ndig, num);
-	PG_RETURN_CSTRING(ascii);
+	(void) pg_strfromd(buf, 32, ndig, num);
 }
 
 /*
@@ -537,16 +549,27 @@ char *
 float8out_internal(double num)
 {
 	char	   *ascii = (char *) palloc(32);
+
+	float8out_buf(num, ascii);
+	return ascii;
+}
+
+/*
+ * float8out_buf - like float8out_internal(), but writes the result into buf,
+ * which must be at least 32 bytes long.
+ */
+void
+float8out_buf(double num, char *buf)
+{
 	int			ndig = DBL_DIG + extra_float_digits;
 
 	if (extra_float_digits > 0)
 	{
-		double_to_shortest_decimal_buf(num, ascii);
-		return ascii;
+		double_to_shortest_decimal_buf(num, buf);
+		return;
 	}
 
-	(void) pg_strfromd(ascii, 32, ndig, num);
-	return ascii;
+	(void) pg_strfromd(buf, 32, ndig, num);
 }
 
 /*
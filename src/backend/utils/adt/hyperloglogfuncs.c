@@ -0,0 +1,258 @@
+/*-------------------------------------------------------------------------
+ *
+ * hyperloglogfuncs.c
+ *	  Approximate count of distinct values, using HyperLogLog.
+ *
+ * approx_count_distinct() feeds the hash values of its inputs, computed with
+ * the hash function of the type's default hash opclass, to lib/hyperloglog.c.
+ * Unlike count(DISTINCT ...), it needs neither a sort nor a hash table of the
+ * values seen, just a fixed number of registers per group, and since two sets
+ * of registers can be merged, it supports partial aggregation.
+ *
+ * The precision is the number of bits of the hash used to select a register,
+ * so there are 2^precision one-byte registers; the standard error of the
+ * estimate is about 1.04 / sqrt(2^precision).
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/adt/hyperloglogfuncs.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "fmgr.h"
+#include "lib/hyperloglog.h"
+#include "libpq/pqformat.h"
+#include "utils/builtins.h"
+#include "utils/fmgrprotos.h"
+#include "utils/typcache.h"
+#include "varatt.h"
+
+/* the range allowed by initHyperLogLog() */
+#define APPROX_COUNT_DISTINCT_MIN_PRECISION		4
+#define APPROX_COUNT_DISTINCT_MAX_PRECISION		16
+
+/* 4096 registers, for a standard error of about 1.6% */
+#define APPROX_COUNT_DISTINCT_DEFAULT_PRECISION	12
+
+static Datum approx_count_distinct_add(FunctionCallInfo fcinfo,
+									   int precision);
+static hyperLogLogState *approx_count_distinct_init(MemoryContext context,
+													int precision);
+
+
+/*
+ * Create a transition state with the given precision in 'context'.
+ */
+static hyperLogLogState *
+approx_count_distinct_init(MemoryContext context, int precision)
+{
+	hyperLogLogState *state;
+	MemoryContext oldcontext;
+
+	if (precision < APPROX_COUNT_DISTINCT_MIN_PRECISION ||
+		precision > APPROX_COUNT_DISTINCT_MAX_PRECISION)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("precision must be between %d and %d",
+						APPROX_COUNT_DISTINCT_MIN_PRECISION,
+						APPROX_COUNT_DISTINCT_MAX_PRECISION)));
+
+	oldcontext = MemoryContextSwitchTo(context);
+	state = palloc_object(hyperLogLogState);
+	initHyperLogLog(state, precision);
+	MemoryContextSwitchTo(oldcontext);
+
+	return state;
+}
+
+/*
+ * Add the value in argument 1 to the state in argument 0.
+ */
+static Datum
+approx_count_distinct_add(FunctionCallInfo fcinfo, int precision)
+{
+	MemoryContext aggcontext;
+	hyperLogLogState *state;
+	TypeCacheEntry *typentry;
+	uint32		hash;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "approx_count_distinct_transfn called in non-aggregate context");
+
+	if (PG_ARGISNULL(0))
+		state = approx_count_distinct_init(aggcontext, precision);
+	else
+	{
+		state = (hyperLogLogState *) PG_GETARG_POINTER(0);
+		if (state->registerWidth != precision)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("precision must be the same for all input rows")));
+	}
+
+	/* Null values are not counted */
+	if (PG_ARGISNULL(1))
+		PG_RETURN_POINTER(state);
+
+	/* Look up the hash function the first time through */
+	typentry = (TypeCacheEntry *) fcinfo->flinfo->fn_extra;
+	if (typentry == NULL)
+	{
+		Oid			typid = get_fn_expr_argtype(fcinfo->flinfo, 1);
+
+		typentry = lookup_type_cache(typid, TYPECACHE_HASH_PROC_FINFO);
+		if (!OidIsValid(typentry->hash_proc_finfo.fn_oid))
+			ereport(ERROR,
+					(errcode(ERRCODE_UNDEFINED_FUNCTION),
+					 errmsg("could not identify a hash function for type %s",
+							format_type_be(typid))));
+		fcinfo->flinfo->fn_extra = typentry;
+	}
+
+	hash = DatumGetUInt32(FunctionCall1Coll(&typentry->hash_proc_finfo,
+											PG_GET_COLLATION(),
+											PG_GETARG_DATUM(1)));
+	addHyperLogLog(state, hash);
+
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * approx_count_distinct_transfn
+ *		Transition function for approx_count_distinct(anyelement).
+ */
+Datum
+approx_count_distinct_transfn(PG_FUNCTION_ARGS)
+{
+	return approx_count_distinct_add(fcinfo,
+									 APPROX_COUNT_DISTINCT_DEFAULT_PRECISION);
+}
+
+/*
+ * approx_count_distinct_precision_transfn
+ *		Transition function for approx_count_distinct(anyelement, integer).
+ */
+Datum
+approx_count_distinct_precision_transfn(PG_FUNCTION_ARGS)
+{
+	if (PG_ARGISNULL(2))
+		ereport(ERROR,
+				(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+				 errmsg("precision must not be null")));
+
+	return approx_count_distinct_add(fcinfo, PG_GETARG_INT32(2));
+}
+
+/*
+ * approx_count_distinct_combine
+ *		Combine two transition states, by merging their registers.
+ */
+Datum
+approx_count_distinct_combine(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	hyperLogLogState *state1;
+	hyperLogLogState *state2;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "approx_count_distinct_combine called in non-aggregate context");
+
+	state1 = PG_ARGISNULL(0) ? NULL : (hyperLogLogState *) PG_GETARG_POINTER(0);
+	state2 = PG_ARGISNULL(1) ? NULL : (hyperLogLogState *) PG_GETARG_POINTER(1);
+
+	if (state2 == NULL)
+	{
+		if (state1 == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state1);
+	}
+
+	if (state1 == NULL)
+		state1 = approx_count_distinct_init(aggcontext, state2->registerWidth);
+	else if (state1->registerWidth != state2->registerWidth)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("precision must be the same for all input rows")));
+
+	mergeHyperLogLog(state1, state2);
+
+	PG_RETURN_POINTER(state1);
+}
+
+/*
+ * approx_count_distinct_serialize
+ *		Serialize a transition state: the precision, then the registers.
+ */
+Datum
+approx_count_distinct_serialize(PG_FUNCTION_ARGS)
+{
+	hyperLogLogState *state;
+	StringInfoData buf;
+
+	/* cannot be called directly because of internal-type argument */
+	Assert(AggCheckCallContext(fcinfo, NULL));
+
+	state = (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+	pq_begintypsend(&buf);
+	pq_sendbyte(&buf, state->registerWidth);
+	pq_sendbytes(&buf, state->hashesArr, state->nRegisters);
+
+	PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+/*
+ * approx_count_distinct_deserialize
+ *		Inverse of approx_count_distinct_serialize.
+ */
+Datum
+approx_count_distinct_deserialize(PG_FUNCTION_ARGS)
+{
+	bytea	   *sstate;
+	hyperLogLogState *state;
+	StringInfoData buf;
+	int			precision;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	sstate = PG_GETARG_BYTEA_PP(0);
+
+	initReadOnlyStringInfo(&buf, VARDATA_ANY(sstate),
+						   VARSIZE_ANY_EXHDR(sstate));
+
+	precision = pq_getmsgbyte(&buf);
+	state = approx_count_distinct_init(CurrentMemoryContext, precision);
+	memcpy(state->hashesArr, pq_getmsgbytes(&buf, state->nRegisters),
+		   state->nRegisters);
+	pq_getmsgend(&buf);
+
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * approx_count_distinct_finalfn
+ *		Return the estimated number of distinct values.
+ */
+Datum
+approx_count_distinct_finalfn(PG_FUNCTION_ARGS)
+{
+	hyperLogLogState *state;
+
+	/* cannot be called directly because of internal-type argument */
+	Assert(AggCheckCallContext(fcinfo, NULL));
+
+	/* no rows at all */
+	if (PG_ARGISNULL(0))
+		PG_RETURN_INT64(0);
+
+	state = (hyperLogLogState *) PG_GETARG_POINTER(0);
+
+	PG_RETURN_INT64((int64) rint(estimateHyperLogLog(state)));
+}
@@ -13,6 +13,8 @@
  */
 #include "postgres.h"
 
+#include "access/detoast.h"
+#include "access/heaptoast.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_type.h"
 #include "common/hashfn.h"
@@ -39,6 +41,8 @@
 #define JSONB_MAX_ELEMS (Min(MaxAllocSize / sizeof(JsonbValue), JB_CMASK))
 #define JSONB_MAX_PAIRS (Min(MaxAllocSize / sizeof(JsonbPair), JB_CMASK))
 
+static int	findKeyIndexInContainer(JsonbContainer *container,
+									const char *keyVal, int keyLen);
 static void fillJsonbValue(JsonbContainer *container, int index,
 						   char *base_addr, uint32 offset,
 						   JsonbValue *result);
@@ -402,11 +406,9 @@ JsonbValue *
 getKeyJsonValueFromContainer(JsonbContainer *container,
 							 const char *keyVal, int keyLen, JsonbValue *res)
 {
-	JEntry	   *children = container->children;
 	int			count = JsonContainerSize(container);
-	char	   *baseAddr;
-	uint32		stopLow,
-				stopHigh;
+	int			keyIndex;
+	int			index;
 
 	Assert(JsonContainerIsObject(container));
 
@@ -414,11 +416,44 @@ getKeyJsonValueFromContainer(JsonbContainer *container,
 	if (count <= 0)
 		return NULL;
 
+	keyIndex = findKeyIndexInContainer(container, keyVal, keyLen);
+	if (keyIndex < 0)
+		return NULL;
+
+	/* Found our key, return corresponding value */
+	index = keyIndex + count;
+
+	if (!res)
+		res = palloc_object(JsonbValue);
+
+	fillJsonbValue(container, index, (char *) (container->children + count * 2),
+				   getJsonbOffset(container, index),
+				   res);
+
+	return res;
+}
+
+/*
+ * Binary search a non-empty Jsonb object for a key.  Returns the index of the
+ * key, or -1 if it is not present.  The value's index is that plus the number
+ * of pairs.
+ *
+ * Only the JEntry array and the keys are looked at.
+ */
+static int
+findKeyIndexInContainer(JsonbContainer *container,
+						const char *keyVal, int keyLen)
+{
+	int			count = JsonContainerSize(container);
+	char	   *baseAddr;
+	uint32		stopLow,
+				stopHigh;
+
 	/*
 	 * Binary search the container. Since we know this is an object, account
 	 * for *Pairs* of Jentrys
 	 */
-	baseAddr = (char *) (children + count * 2);
+	baseAddr = (char *) (container->children + count * 2);
 	stopLow = 0;
 	stopHigh = count;
 	while (stopLow < stopHigh)
@@ -437,30 +472,136 @@ getKeyJsonValueFromContainer(JsonbContainer *container,
 											  keyVal, keyLen);
 
 		if (difference == 0)
-		{
-			/* Found our key, return corresponding value */
-			int			index = stopMiddle + count;
+			return stopMiddle;
+		else if (difference < 0)
+			stopLow = stopMiddle + 1;
+		else
+			stopHigh = stopMiddle;
+	}
 
-			if (!res)
-				res = palloc_object(JsonbValue);
+	/* Not found */
+	return -1;
+}
 
-			fillJsonbValue(container, index, baseAddr,
-						   getJsonbOffset(container, index),
-						   res);
+/*
+ * Copy bytes [offset, offset + length) of the data of a toasted jsonb into
+ * the same position in 'result'.
+ */
+static void
+fetchJsonbSlice(struct varlena *attr, Jsonb *result,
+				uint32 offset, uint32 length)
+{
+	struct varlena *slice;
+
+	slice = detoast_attr_slice(attr, offset, length);
+	if (VARSIZE_ANY_EXHDR(slice) != length)
+		elog(ERROR, "unexpected size of jsonb slice: %zu instead of %u",
+			 (size_t) VARSIZE_ANY_EXHDR(slice), length);
+	memcpy(VARDATA(result) + offset, VARDATA_ANY(slice), length);
+	pfree(slice);
+}
 
-			return res;
-		}
-		else
+/*
+ * DatumGetJsonbPForKey
+ *
+ * Detoast a jsonb datum just far enough to look up one top-level key with
+ * getKeyJsonValueFromContainer(), for the -> and ->> operators.
+ *
+ * A large document stored out of line would otherwise be fetched and
+ * decompressed in full for every lookup.  The parts needed for the lookup
+ * are all at known positions: the root header, the root's JEntry array, the
+ * keys, which are stored together ahead of the values, and finally the one
+ * value being looked up.  Only those are fetched, with detoast_attr_slice(),
+ * into a buffer of the full size; the rest of it is left uninitialized, so
+ * the result must not be used for anything but that lookup.  For a
+ * compressed value, each slice still decompresses everything before it, but
+ * the header and keys are near the start, and a value near the start saves
+ * most of the work.
+ *
+ * Values that are not stored out of line are detoasted as usual.
+ */
+Jsonb *
+DatumGetJsonbPForKey(Datum d, const char *keyVal, int keyLen)
+{
+	struct varlena *attr = (struct varlena *) DatumGetPointer(d);
+	struct varatt_external toast_pointer;
+	Jsonb	   *result;
+	uint32		datasize;
+	uint32		fetched;
+	uint32		needed;
+	int			count;
+	int			keyIndex;
+	uint32		valueOffset;
+	uint32		valueLength;
+
+	if (!VARATT_IS_EXTERNAL_ONDISK(attr))
+		return DatumGetJsonbP(d);
+
+	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+	datasize = toast_pointer.va_rawsize - VARHDRSZ;
+	if (datasize < sizeof(uint32))
+		return DatumGetJsonbP(d);
+
+	result = (Jsonb *) palloc(VARHDRSZ + datasize);
+	SET_VARSIZE(result, VARHDRSZ + datasize);
+
+	/*
+	 * The first chunk usually holds the JEntry array and the keys of all but
+	 * very large objects, so start with that.
+	 */
+	fetched = Min(datasize, TOAST_MAX_CHUNK_SIZE);
+	fetchJsonbSlice(attr, result, 0, fetched);
+
+	count = JsonContainerSize(&result->root);
+	if (!JsonContainerIsObject(&result->root) || count <= 0)
+		return result;
+
+	/* the JEntry array */
+	needed = sizeof(uint32) + 2 * count * sizeof(JEntry);
+	if (needed > datasize)
+		goto corrupt;
+	if (needed > fetched)
+	{
+		fetchJsonbSlice(attr, result, fetched, needed - fetched);
+		fetched = needed;
+	}
+
+	/* the keys */
+	needed += getJsonbOffset(&result->root, count);
+	if (needed > datasize)
+		goto corrupt;
+	if (needed > fetched)
+	{
+		fetchJsonbSlice(attr, result, fetched, needed - fetched);
+		fetched = needed;
+	}
+
+	/* and the value, if the key is there */
+	keyIndex = findKeyIndexInContainer(&result->root, keyVal, keyLen);
+	if (keyIndex < 0)
+		return result;
+
+	valueOffset = sizeof(uint32) + 2 * count * sizeof(JEntry) +
+		getJsonbOffset(&result->root, keyIndex + count);
+	valueLength = getJsonbLength(&result->root, keyIndex + count);
+	if (valueOffset > datasize || valueLength > datasize - valueOffset)
+		goto corrupt;
+	if (valueOffset + valueLength > fetched)
+	{
+		if (valueOffset < fetched)
 		{
-			if (difference < 0)
-				stopLow = stopMiddle + 1;
-			else
-				stopHigh = stopMiddle;
+			valueLength -= fetched - valueOffset;
+			valueOffset = fetched;
 		}
+		fetchJsonbSlice(attr, result, valueOffset, valueLength);
 	}
 
-	/* Not found */
-	return NULL;
+	return result;
+
+corrupt:
+	/* let the usual code path deal with whatever is wrong */
+	pfree(result);
+	return DatumGetJsonbP(d);
 }
 
 /*
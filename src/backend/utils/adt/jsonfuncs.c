@@ -861,8 +861,10 @@ json_object_field(PG_FUNCTION_ARGS)
 Datum
 jsonb_object_field(PG_FUNCTION_ARGS)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
 	text	   *key = PG_GETARG_TEXT_PP(1);
+	Jsonb	   *jb = DatumGetJsonbPForKey(PG_GETARG_DATUM(0),
+										  VARDATA_ANY(key),
+										  VARSIZE_ANY_EXHDR(key));
 	JsonbValue *v;
 	JsonbValue	vbuf;
 
@@ -899,8 +901,10 @@ json_object_field_text(PG_FUNCTION_ARGS)
 Datum
 jsonb_object_field_text(PG_FUNCTION_ARGS)
 {
-	Jsonb	   *jb = PG_GETARG_JSONB_P(0);
 	text	   *key = PG_GETARG_TEXT_PP(1);
+	Jsonb	   *jb = DatumGetJsonbPForKey(PG_GETARG_DATUM(0),
+										  VARDATA_ANY(key),
+										  VARSIZE_ANY_EXHDR(key));
 	JsonbValue *v;
 	JsonbValue	vbuf;
 
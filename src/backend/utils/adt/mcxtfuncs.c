@@ -22,6 +22,7 @@
 #include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/hsearch.h"
+#include "utils/memutils.h"
 
 /* ----------
  * The max bytes for showing identifiers of MemoryContext.
@@ -175,6 +176,46 @@ PutMemoryContextsStatsTupleStore(Tuplestorestate *tupstore,
 	list_free(path);
 }
 
+/*
+ * PutBlockCacheStatsTupleStore
+ *		Add details for the memory block cache to 'tupstore'.
+ *
+ * The cache isn't a memory context, but the memory it holds would be
+ * missing from the totals without it.  It's shown as a child of
+ * TopMemoryContext.
+ */
+static void
+PutBlockCacheStatsTupleStore(Tuplestorestate *tupstore, TupleDesc tupdesc,
+							 int context_id)
+{
+	Datum		values[PG_GET_BACKEND_MEMORY_CONTEXTS_COLS];
+	bool		nulls[PG_GET_BACKEND_MEMORY_CONTEXTS_COLS];
+	MemoryContextCounters stat;
+	List	   *path;
+
+	MemoryBlockCacheStats(&stat);
+
+	memset(values, 0, sizeof(values));
+	memset(nulls, 0, sizeof(nulls));
+
+	/* TopMemoryContext always has a context_id of 1 */
+	path = list_make2_int(1, context_id);
+
+	values[0] = CStringGetTextDatum("Block Cache");
+	nulls[1] = true;
+	values[2] = CStringGetTextDatum("BlockCache");
+	values[3] = Int32GetDatum(list_length(path));	/* level */
+	values[4] = int_list_to_array(path);
+	values[5] = Int64GetDatum(stat.totalspace);
+	values[6] = Int64GetDatum(stat.nblocks);
+	values[7] = Int64GetDatum(stat.freespace);
+	values[8] = Int64GetDatum(stat.freechunks);
+	values[9] = Int64GetDatum(stat.totalspace - stat.freespace);
+
+	tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	list_free(path);
+}
+
 /*
  * pg_get_backend_memory_contexts
  *		SQL SRF showing backend memory context.
@@ -242,6 +283,9 @@ pg_get_backend_memory_contexts(PG_FUNCTION_ARGS)
 			contexts = lappend(contexts, c);
 	}
 
+	PutBlockCacheStatsTupleStore(rsinfo->setResult, rsinfo->setDesc,
+								 context_id);
+
 	hash_destroy(context_id_lookup);
 
 	return (Datum) 0;
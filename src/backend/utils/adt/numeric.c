@@ -4732,11 +4732,206 @@ typedef struct NumericAggState
 	int64		NaNcount;		/* count of NaN values */
 	int64		pInfcount;		/* count of +Inf values */
 	int64		nInfcount;		/* count of -Inf values */
+
+	/*
+	 * For sum() and avg(), inputs that all have the same dscale (typically
+	 * because they come from a numeric(p,s) column) and fit in an int64 once
+	 * scaled to an integer are summed in fastSumX instead, which is much
+	 * cheaper than sumX.  The sum of processed numbers is sumX plus fastSumX
+	 * / 10^fastScale.  fastScale is set by the first such input, and stays
+	 * fixed as long as fastCount > 0.  Since the inputs are less than 2^63
+	 * and there are less than 2^63 of them, fastSumX cannot overflow.
+	 */
+	int64		fastCount;		/* count of values in fastSumX */
+	int			fastScale;		/* scale of values in fastSumX */
+	INT128		fastSumX;		/* sum of those values, as integers */
 } NumericAggState;
 
 #define NA_TOTAL_COUNT(na) \
 	((na)->N + (na)->NaNcount + (na)->pInfcount + (na)->nInfcount)
 
+/*
+ * Convert a NumericVar to an int64, scaled by 10^var->dscale.  Returns false
+ * if the result doesn't fit.
+ */
+static bool
+numericvar_to_scaled_int64(const NumericVar *var, int64 *result)
+{
+#if DEC_DIGITS == 4
+	static const int pow10[] = {1, 10, 100, 1000};
+#elif DEC_DIGITS == 2
+	static const int pow10[] = {1, 10};
+#elif DEC_DIGITS == 1
+	static const int pow10[] = {1};
+#else
+#error unsupported NBASE
+#endif
+	int			fracdigits;
+	int64		val = 0;
+
+	StaticAssertDecl(lengthof(pow10) == DEC_DIGITS, "mismatch with DEC_DIGITS");
+
+	/* number of NBASE digits after the decimal point needed for dscale */
+	fracdigits = (var->dscale + DEC_DIGITS - 1) / DEC_DIGITS;
+
+	/* digits beyond dscale should be zero, and stripped */
+	if (var->weight - var->ndigits + 1 < -fracdigits)
+		return false;
+
+	/* compute the value scaled by NBASE^fracdigits */
+	for (int w = var->weight; w >= -fracdigits; w--)
+	{
+		int			i = var->weight - w;
+		NumericDigit dig = i < var->ndigits ? var->digits[i] : 0;
+
+		if (unlikely(pg_mul_s64_overflow(val, NBASE, &val)) ||
+			unlikely(pg_add_s64_overflow(val, dig, &val)))
+			return false;
+	}
+
+	/* divide out the excess powers of ten; this is exact */
+	val /= pow10[fracdigits * DEC_DIGITS - var->dscale];
+
+	*result = var->sign == NUMERIC_NEG ? -val : val;
+	return true;
+}
+
+/*
+ * Try to add X to the fastSumX of a sum() or avg() aggregate state, or to
+ * subtract it if "negate" is true.  Returns false if X cannot be handled
+ * that way, in which case the caller must use sumX.
+ */
+static bool
+fast_sum_accum(NumericAggState *state, const NumericVar *X, bool negate)
+{
+	int64		val;
+
+	if (state->calcSumX2)
+		return false;
+
+	if (negate)
+	{
+		/*
+		 * Keep at least one value in fastSumX; the input might have been
+		 * added to sumX, and fastScale must not change while fastSumX is not
+		 * zero.
+		 */
+		if (state->fastCount <= 1 || X->dscale != state->fastScale)
+			return false;
+	}
+	else if (state->fastCount > 0 && X->dscale != state->fastScale)
+		return false;
+
+	if (!numericvar_to_scaled_int64(X, &val))
+		return false;
+
+	if (negate)
+	{
+		int128_sub_int64(&state->fastSumX, val);
+		state->fastCount--;
+	}
+	else
+	{
+		if (state->fastCount == 0)
+			state->fastScale = X->dscale;
+		int128_add_int64(&state->fastSumX, val);
+		state->fastCount++;
+	}
+
+	return true;
+}
+
+/*
+ * Convert the fastSumX of an aggregate state to a NumericVar.
+ */
+static void
+fast_sum_to_numericvar(const NumericAggState *state, NumericVar *var)
+{
+#if DEC_DIGITS == 4
+	static const int pow10[] = {1, 10, 100, 1000};
+#elif DEC_DIGITS == 2
+	static const int pow10[] = {1, 10};
+#elif DEC_DIGITS == 1
+	static const int pow10[] = {1};
+#else
+#error unsupported NBASE
+#endif
+	int			w;
+	int			m;
+
+	int128_to_numericvar(state->fastSumX, var);
+
+	/*
+	 * Divide by 10^fastScale, by decreasing the weight.  As in
+	 * int64_div_fast_to_numeric(), if fastScale isn't a multiple of
+	 * DEC_DIGITS, first multiply by the power of ten that makes up the
+	 * difference.
+	 */
+	w = state->fastScale / DEC_DIGITS;
+	m = state->fastScale % DEC_DIGITS;
+	if (var->ndigits > 0)
+	{
+		if (m > 0)
+		{
+			NumericVar	factor;
+
+			init_var(&factor);
+			int64_to_numericvar(pow10[DEC_DIGITS - m], &factor);
+			mul_var(var, &factor, var, 0);
+			free_var(&factor);
+			w++;
+		}
+		var->weight -= w;
+	}
+	var->dscale = state->fastScale;
+}
+
+/*
+ * Compute the sum of the processed numbers of an aggregate state.
+ */
+static void
+numeric_agg_state_sumX(NumericAggState *state, NumericVar *result)
+{
+	accum_sum_final(&state->sumX, result);
+
+	if (state->fastCount > 0)
+	{
+		NumericVar	fast_var;
+
+		init_var(&fast_var);
+		fast_sum_to_numericvar(state, &fast_var);
+		add_var(result, &fast_var, result);
+		free_var(&fast_var);
+	}
+}
+
+/*
+ * Add the fastSumX of state2 to state1, for the combine functions.  Must be
+ * called in the aggregate context.
+ */
+static void
+fast_sum_combine(NumericAggState *state1, const NumericAggState *state2)
+{
+	if (state2->fastCount == 0)
+		return;
+
+	if (state1->fastCount == 0 || state1->fastScale == state2->fastScale)
+	{
+		state1->fastScale = state2->fastScale;
+		int128_add_int128(&state1->fastSumX, state2->fastSumX);
+		state1->fastCount += state2->fastCount;
+	}
+	else
+	{
+		NumericVar	fast_var;
+
+		init_var(&fast_var);
+		fast_sum_to_numericvar(state2, &fast_var);
+		accum_sum_add(&state1->sumX, &fast_var);
+		free_var(&fast_var);
+	}
+}
+
 /*
  * Prepare state data for a numeric aggregate function that needs to compute
  * sum, count and optionally sum of squares of the input.
@@ -4815,6 +5010,13 @@ do_numeric_accum(NumericAggState *state, Numeric newval)
 	else if (X.dscale == state->maxScale)
 		state->maxScaleCount++;
 
+	/* Try the fast path for sum() and avg() */
+	if (fast_sum_accum(state, &X, false))
+	{
+		state->N++;
+		return;
+	}
+
 	/* if we need X^2, calculate that in short-lived context */
 	if (state->calcSumX2)
 	{
@@ -4915,9 +5117,13 @@ do_numeric_discard(NumericAggState *state, Numeric newval)
 
 	if (state->N-- > 1)
 	{
-		/* Negate X, to subtract it from the sum */
-		X.sign = (X.sign == NUMERIC_POS ? NUMERIC_NEG : NUMERIC_POS);
-		accum_sum_add(&(state->sumX), &X);
+		/* Subtract X from the sum */
+		if (!fast_sum_accum(state, &X, true))
+		{
+			/* Negate X, to subtract it from sumX */
+			X.sign = (X.sign == NUMERIC_POS ? NUMERIC_NEG : NUMERIC_POS);
+			accum_sum_add(&(state->sumX), &X);
+		}
 
 		if (state->calcSumX2)
 		{
@@ -4934,6 +5140,8 @@ do_numeric_discard(NumericAggState *state, Numeric newval)
 		accum_sum_reset(&state->sumX);
 		if (state->calcSumX2)
 			accum_sum_reset(&state->sumX2);
+		state->fastCount = 0;
+		state->fastSumX = int64_to_int128(0);
 	}
 
 	MemoryContextSwitchTo(old_context);
@@ -4996,6 +5204,9 @@ numeric_combine(PG_FUNCTION_ARGS)
 
 		accum_sum_copy(&state1->sumX, &state2->sumX);
 		accum_sum_copy(&state1->sumX2, &state2->sumX2);
+		state1->fastCount = state2->fastCount;
+		state1->fastScale = state2->fastScale;
+		state1->fastSumX = state2->fastSumX;
 
 		MemoryContextSwitchTo(old_context);
 
@@ -5027,6 +5238,7 @@ numeric_combine(PG_FUNCTION_ARGS)
 		/* Accumulate sums */
 		accum_sum_combine(&state1->sumX, &state2->sumX);
 		accum_sum_combine(&state1->sumX2, &state2->sumX2);
+		fast_sum_combine(state1, state2);
 
 		MemoryContextSwitchTo(old_context);
 	}
@@ -5087,6 +5299,9 @@ numeric_avg_combine(PG_FUNCTION_ARGS)
 		state1->maxScaleCount = state2->maxScaleCount;
 
 		accum_sum_copy(&state1->sumX, &state2->sumX);
+		state1->fastCount = state2->fastCount;
+		state1->fastScale = state2->fastScale;
+		state1->fastSumX = state2->fastSumX;
 
 		MemoryContextSwitchTo(old_context);
 
@@ -5117,6 +5332,7 @@ numeric_avg_combine(PG_FUNCTION_ARGS)
 
 		/* Accumulate sums */
 		accum_sum_combine(&state1->sumX, &state2->sumX);
+		fast_sum_combine(state1, state2);
 
 		MemoryContextSwitchTo(old_context);
 	}
@@ -5150,7 +5366,7 @@ numeric_avg_serialize(PG_FUNCTION_ARGS)
 	pq_sendint64(&buf, state->N);
 
 	/* sumX */
-	accum_sum_final(&state->sumX, &tmp_var);
+	numeric_agg_state_sumX(state, &tmp_var);
 	numericvar_serialize(&buf, &tmp_var);
 
 	/* maxScale */
@@ -5260,7 +5476,7 @@ numeric_serialize(PG_FUNCTION_ARGS)
 	pq_sendint64(&buf, state->N);
 
 	/* sumX */
-	accum_sum_final(&state->sumX, &tmp_var);
+	numeric_agg_state_sumX(state, &tmp_var);
 	numericvar_serialize(&buf, &tmp_var);
 
 	/* sumX2 */
@@ -5942,7 +6158,7 @@ numeric_avg(PG_FUNCTION_ARGS)
 	N_datum = NumericGetDatum(int64_to_numeric(state->N));
 
 	init_var(&sumX_var);
-	accum_sum_final(&state->sumX, &sumX_var);
+	numeric_agg_state_sumX(state, &sumX_var);
 	sumX_datum = NumericGetDatum(make_result(&sumX_var));
 	free_var(&sumX_var);
 
@@ -5974,7 +6190,7 @@ numeric_sum(PG_FUNCTION_ARGS)
 		PG_RETURN_NUMERIC(make_result(&const_ninf));
 
 	init_var(&sumX_var);
-	accum_sum_final(&state->sumX, &sumX_var);
+	numeric_agg_state_sumX(state, &sumX_var);
 	result = make_result(&sumX_var);
 	free_var(&sumX_var);
 
@@ -6037,7 +6253,7 @@ numeric_stddev_internal(NumericAggState *state,
 	init_var(&vsumX2);
 
 	int64_to_numericvar(state->N, &vN);
-	accum_sum_final(&(state->sumX), &vsumX);
+	numeric_agg_state_sumX(state, &vsumX);
 	accum_sum_final(&(state->sumX2), &vsumX2);
 
 	init_var(&vNminus1);
@@ -15,6 +15,7 @@
 #include "postgres.h"
 
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/xlog.h"
 #include "access/xlogprefetcher.h"
 #include "catalog/catalog.h"
@@ -25,7 +26,9 @@
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/bgworker.h"
+#include "postmaster/session_history.h"
 #include "replication/logicallauncher.h"
+#include "storage/lwlock.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
 #include "utils/acl.h"
@@ -345,6 +348,34 @@ pg_stat_get_progress_info(PG_FUNCTION_ARGS)
 	return (Datum) 0;
 }
 
+/*
+ * Name of a backend state as shown in pg_stat_activity, or NULL if undefined.
+ */
+static const char *
+pgstat_get_backend_state_name(BackendState state)
+{
+	switch (state)
+	{
+		case STATE_STARTING:
+			return "starting";
+		case STATE_IDLE:
+			return "idle";
+		case STATE_RUNNING:
+			return "active";
+		case STATE_IDLEINTRANSACTION:
+			return "idle in transaction";
+		case STATE_FASTPATH:
+			return "fastpath function call";
+		case STATE_IDLEINTRANSACTION_ABORTED:
+			return "idle in transaction (aborted)";
+		case STATE_DISABLED:
+			return "disabled";
+		case STATE_UNDEFINED:
+			break;
+	}
+	return NULL;
+}
+
 /*
  * Returns activity of PG backends.
  */
@@ -411,34 +442,12 @@ pg_stat_get_activity(PG_FUNCTION_ARGS)
 		if (HAS_PGSTAT_PERMISSIONS(beentry->st_userid))
 		{
 			char	   *clipped_activity;
+			const char *state = pgstat_get_backend_state_name(beentry->st_state);
 
-			switch (beentry->st_state)
-			{
-				case STATE_STARTING:
-					values[4] = CStringGetTextDatum("starting");
-					break;
-				case STATE_IDLE:
-					values[4] = CStringGetTextDatum("idle");
-					break;
-				case STATE_RUNNING:
-					values[4] = CStringGetTextDatum("active");
-					break;
-				case STATE_IDLEINTRANSACTION:
-					values[4] = CStringGetTextDatum("idle in transaction");
-					break;
-				case STATE_FASTPATH:
-					values[4] = CStringGetTextDatum("fastpath function call");
-					break;
-				case STATE_IDLEINTRANSACTION_ABORTED:
-					values[4] = CStringGetTextDatum("idle in transaction (aborted)");
-					break;
-				case STATE_DISABLED:
-					values[4] = CStringGetTextDatum("disabled");
-					break;
-				case STATE_UNDEFINED:
-					nulls[4] = true;
-					break;
-			}
+			if (state)
+				values[4] = CStringGetTextDatum(state);
+			else
+				nulls[4] = true;
 
 			clipped_activity = pgstat_clip_activity(beentry->st_activity_raw);
 			values[5] = CStringGetTextDatum(clipped_activity);
@@ -706,6 +715,123 @@ pg_stat_get_activity(PG_FUNCTION_ARGS)
 	return (Datum) 0;
 }
 
+/*
+ * Returns the amount of memory allocated by the memory contexts of each
+ * backend.
+ */
+Datum
+pg_stat_get_backend_memory(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_BACKEND_MEMORY_COLS	3
+	int			num_backends = pgstat_fetch_stat_numbackends();
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	/* 1-based index */
+	for (int curr_backend = 1; curr_backend <= num_backends; curr_backend++)
+	{
+		Datum		values[PG_STAT_GET_BACKEND_MEMORY_COLS] = {0};
+		bool		nulls[PG_STAT_GET_BACKEND_MEMORY_COLS] = {0};
+		PgBackendStatus *beentry;
+
+		beentry = &pgstat_get_local_beentry_by_index(curr_backend)->backendStatus;
+
+		values[0] = Int32GetDatum(beentry->st_procpid);
+		values[1] = CStringGetTextDatum(GetBackendTypeDesc(beentry->st_backendType));
+		values[2] = Int64GetDatum((int64) beentry->st_allocated_bytes);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	return (Datum) 0;
+}
+
+/*
+ * Returns the sampled history of the activity of PG backends.
+ */
+Datum
+pg_stat_get_session_history(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_SESSION_HISTORY_COLS	9
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	SessionHistoryEntry *entries;
+	int			nentries;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	entries = SessionHistoryGetEntries(&nentries);
+
+	for (int i = 0; i < nentries; i++)
+	{
+		SessionHistoryEntry *entry = &entries[i];
+		Datum		values[PG_STAT_GET_SESSION_HISTORY_COLS] = {0};
+		bool		nulls[PG_STAT_GET_SESSION_HISTORY_COLS] = {0};
+		const char *backend_type = NULL;
+
+		values[0] = TimestampTzGetDatum(entry->sample_time);
+		values[1] = Int32GetDatum(entry->pid);
+
+		if (OidIsValid(entry->datid))
+			values[2] = ObjectIdGetDatum(entry->datid);
+		else
+			nulls[2] = true;
+
+		if (OidIsValid(entry->userid))
+			values[3] = ObjectIdGetDatum(entry->userid);
+		else
+			nulls[3] = true;
+
+		/* the worker may be gone, in which case it's just a bgworker */
+		if (entry->backend_type == B_BG_WORKER)
+			backend_type = GetBackgroundWorkerTypeByPid(entry->pid);
+		if (backend_type == NULL)
+			backend_type = GetBackendTypeDesc(entry->backend_type);
+		values[4] = CStringGetTextDatum(backend_type);
+
+		/* Values only available to role member or pg_read_all_stats */
+		if (HAS_PGSTAT_PERMISSIONS(entry->userid))
+		{
+			const char *state = pgstat_get_backend_state_name(entry->state);
+			const char *wait_event_type;
+			const char *wait_event;
+
+			if (state)
+				values[5] = CStringGetTextDatum(state);
+			else
+				nulls[5] = true;
+
+			wait_event_type = pgstat_get_wait_event_type(entry->wait_event_info);
+			if (wait_event_type)
+				values[6] = CStringGetTextDatum(wait_event_type);
+			else
+				nulls[6] = true;
+
+			wait_event = pgstat_get_wait_event(entry->wait_event_info);
+			if (wait_event)
+				values[7] = CStringGetTextDatum(wait_event);
+			else
+				nulls[7] = true;
+
+			if (entry->query_id != 0)
+				values[8] = Int64GetDatum(entry->query_id);
+			else
+				nulls[8] = true;
+		}
+		else
+		{
+			nulls[5] = true;
+			nulls[6] = true;
+			nulls[7] = true;
+			nulls[8] = true;
+		}
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	return (Datum) 0;
+}
+
 
 Datum
 pg_backend_pid(PG_FUNCTION_ARGS)
@@ -1091,6 +1217,12 @@ PG_STAT_GET_DBENTRY_INT64(parallel_workers_to_launch)
 /* pg_stat_get_db_parallel_workers_launched */
 PG_STAT_GET_DBENTRY_INT64(parallel_workers_launched)
 
+/* pg_stat_get_db_warm_backend_hits */
+PG_STAT_GET_DBENTRY_INT64(warm_backend_hits)
+
+/* pg_stat_get_db_warm_backend_misses */
+PG_STAT_GET_DBENTRY_INT64(warm_backend_misses)
+
 /* pg_stat_get_db_temp_bytes */
 PG_STAT_GET_DBENTRY_INT64(temp_bytes)
 
@@ -1591,6 +1723,74 @@ pg_stat_get_io(PG_FUNCTION_ARGS)
 	return (Datum) 0;
 }
 
+/*
+ * Returns the latency histograms of timed IO operations, one row for each
+ * non-empty bucket.
+ */
+Datum
+pg_stat_get_io_histogram(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_IO_HISTOGRAM_COLS	8
+	ReturnSetInfo *rsinfo;
+	PgStat_IO  *backends_io_stats;
+
+	InitMaterializedSRF(fcinfo, 0);
+	rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+
+	backends_io_stats = pgstat_fetch_stat_io();
+
+	for (int bktype = 0; bktype < BACKEND_NUM_TYPES; bktype++)
+	{
+		PgStat_BktypeIOHist *bktype_hist = &backends_io_stats->hist[bktype];
+		Datum		bktype_desc;
+
+		if (!pgstat_tracks_io_bktype(bktype))
+			continue;
+
+		bktype_desc = CStringGetTextDatum(GetBackendTypeDesc(bktype));
+
+		for (int io_obj = 0; io_obj < IOOBJECT_NUM_TYPES; io_obj++)
+		{
+			for (int io_context = 0; io_context < IOCONTEXT_NUM_TYPES; io_context++)
+			{
+				for (int io_op = 0; io_op < IOOP_NUM_TYPES; io_op++)
+				{
+					for (int i = 0; i < PGSTAT_IO_HIST_BUCKETS; i++)
+					{
+						PgStat_Counter count =
+							bktype_hist->buckets[io_obj][io_context][io_op][i];
+						Datum		values[PG_STAT_GET_IO_HISTOGRAM_COLS] = {0};
+						bool		nulls[PG_STAT_GET_IO_HISTOGRAM_COLS] = {0};
+
+						if (count == 0)
+							continue;
+
+						values[0] = bktype_desc;
+						values[1] = CStringGetTextDatum(pgstat_get_io_object_name(io_obj));
+						values[2] = CStringGetTextDatum(pgstat_get_io_context_name(io_context));
+						values[3] = CStringGetTextDatum(pgstat_get_io_op_name(io_op));
+						values[4] = Float8GetDatum(pg_stat_us_to_ms(pgstat_get_io_hist_bucket_bound(i)));
+						if (i < PGSTAT_IO_HIST_BUCKETS - 1)
+							values[5] = Float8GetDatum(pg_stat_us_to_ms(pgstat_get_io_hist_bucket_bound(i + 1)));
+						else
+							nulls[5] = true;
+						values[6] = Int64GetDatum(count);
+						if (backends_io_stats->stat_reset_timestamp != 0)
+							values[7] = TimestampTzGetDatum(backends_io_stats->stat_reset_timestamp);
+						else
+							nulls[7] = true;
+
+						tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+											 values, nulls);
+					}
+				}
+			}
+		}
+	}
+
+	return (Datum) 0;
+}
+
 /*
  * Returns I/O statistics for a backend with given PID.
  */
@@ -1637,7 +1837,7 @@ static Datum
 pg_stat_wal_build_tuple(PgStat_WalCounters wal_counters,
 						TimestampTz stat_reset_timestamp)
 {
-#define PG_STAT_WAL_COLS	6
+#define PG_STAT_WAL_COLS	8
 	TupleDesc	tupdesc;
 	Datum		values[PG_STAT_WAL_COLS] = {0};
 	bool		nulls[PG_STAT_WAL_COLS] = {0};
@@ -1655,7 +1855,11 @@ pg_stat_wal_build_tuple(PgStat_WalCounters wal_counters,
 					   NUMERICOID, -1, 0);
 	TupleDescInitEntry(tupdesc, (AttrNumber) 5, "wal_buffers_full",
 					   INT8OID, -1, 0);
-	TupleDescInitEntry(tupdesc, (AttrNumber) 6, "stats_reset",
+	TupleDescInitEntry(tupdesc, (AttrNumber) 6, "commit_delays",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 7, "commit_delay_time",
+					   FLOAT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 8, "stats_reset",
 					   TIMESTAMPTZOID, -1, 0);
 
 	BlessTupleDesc(tupdesc);
@@ -1678,11 +1882,14 @@ pg_stat_wal_build_tuple(PgStat_WalCounters wal_counters,
 									Int32GetDatum(-1));
 
 	values[4] = Int64GetDatum(wal_counters.wal_buffers_full);
+	values[5] = Int64GetDatum(wal_counters.commit_delays);
+	/* convert counter from microsec to millisec for display */
+	values[6] = Float8GetDatum(((double) wal_counters.commit_delay_time) / 1000.0);
 
 	if (stat_reset_timestamp != 0)
-		values[5] = TimestampTzGetDatum(stat_reset_timestamp);
+		values[7] = TimestampTzGetDatum(stat_reset_timestamp);
 	else
-		nulls[5] = true;
+		nulls[7] = true;
 
 	/* Returns the record as Datum */
 	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
@@ -1731,7 +1938,7 @@ pg_stat_get_wal(PG_FUNCTION_ARGS)
 Datum
 pg_stat_get_slru(PG_FUNCTION_ARGS)
 {
-#define PG_STAT_GET_SLRU_COLS	9
+#define PG_STAT_GET_SLRU_COLS	10
 	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
 	int			i;
 	PgStat_SLRUStats *stats;
@@ -1764,7 +1971,67 @@ pg_stat_get_slru(PG_FUNCTION_ARGS)
 		values[5] = Int64GetDatum(stat.blocks_exists);
 		values[6] = Int64GetDatum(stat.flush);
 		values[7] = Int64GetDatum(stat.truncate);
-		values[8] = TimestampTzGetDatum(stat.stat_reset_timestamp);
+		values[8] = Int64GetDatum(stat.overflowed_snapshot);
+		values[9] = TimestampTzGetDatum(stat.stat_reset_timestamp);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+	}
+
+	return (Datum) 0;
+}
+
+/*
+ * Returns statistics of LWLock tranches.
+ */
+Datum
+pg_stat_get_lwlock(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_LWLOCK_COLS	6
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	PgStat_LWLockStats *stats;
+	TimestampTz reset_time;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	/* request LWLock stats from the cumulative stats system */
+	stats = pgstat_fetch_lwlock(&reset_time);
+
+	for (int i = 0; i < NUM_LWLOCK_TRANCHES; i++)
+	{
+		/* for each row */
+		Datum		values[PG_STAT_GET_LWLOCK_COLS] = {0};
+		bool		nulls[PG_STAT_GET_LWLOCK_COLS] = {0};
+		PgStat_LWLockStats *stat = &stats[i];
+		const char *name;
+
+		/*
+		 * Show all builtin tranches, but only those extension tranches that
+		 * have been used; the others might not even exist.
+		 */
+		if (i < LWTRANCHE_FIRST_USER_DEFINED)
+		{
+			name = GetLWLockIdentifier(PG_WAIT_LWLOCK, i);
+			if (name == NULL)
+				continue;		/* unused ID of an individual LWLock */
+		}
+		else
+		{
+			if (stat->acquisitions == 0 && stat->waits == 0 &&
+				stat->spin_delays == 0)
+				continue;
+			name = GetLWLockIdentifier(PG_WAIT_LWLOCK, i);
+		}
+
+		values[0] = PointerGetDatum(cstring_to_text(name));
+		values[1] = Int64GetDatum(stat->acquisitions);
+		values[2] = Int64GetDatum(stat->waits);
+		/* convert microseconds to milliseconds */
+		values[3] = Float8GetDatum(((double) stat->wait_time) / 1000.0);
+		values[4] = Int64GetDatum(stat->spin_delays);
+		if (reset_time != 0)
+			values[5] = TimestampTzGetDatum(reset_time);
+		else
+			nulls[5] = true;
 
 		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
 	}
@@ -1772,6 +2039,44 @@ pg_stat_get_slru(PG_FUNCTION_ARGS)
 	return (Datum) 0;
 }
 
+/*
+ * Returns the state of the pool of parallel workers.
+ */
+Datum
+pg_stat_get_parallel_worker_pool(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[4] = {0};
+	bool		nulls[4] = {0};
+	int			idle;
+	int			active;
+	uint64		hits;
+	uint64		misses;
+
+	/* Initialise attributes information in the tuple descriptor */
+	tupdesc = CreateTemplateTupleDesc(4);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 1, "idle_workers",
+					   INT4OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 2, "active_workers",
+					   INT4OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 3, "hits",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 4, "misses",
+					   INT8OID, -1, 0);
+
+	BlessTupleDesc(tupdesc);
+
+	ParallelWorkerPoolGetStats(&idle, &active, &hits, &misses);
+
+	values[0] = Int32GetDatum(idle);
+	values[1] = Int32GetDatum(active);
+	values[2] = Int64GetDatum(hits);
+	values[3] = Int64GetDatum(misses);
+
+	/* Returns the record as Datum */
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
 #define PG_STAT_GET_XACT_RELENTRY_INT64(stat)			\
 Datum													\
 CppConcat(pg_stat_get_xact_,stat)(PG_FUNCTION_ARGS)		\
@@ -1909,6 +2214,7 @@ pg_stat_reset_shared(PG_FUNCTION_ARGS)
 		pgstat_reset_of_kind(PGSTAT_KIND_BGWRITER);
 		pgstat_reset_of_kind(PGSTAT_KIND_CHECKPOINTER);
 		pgstat_reset_of_kind(PGSTAT_KIND_IO);
+		pgstat_reset_of_kind(PGSTAT_KIND_LWLOCK);
 		XLogPrefetchResetStats();
 		pgstat_reset_of_kind(PGSTAT_KIND_SLRU);
 		pgstat_reset_of_kind(PGSTAT_KIND_WAL);
@@ -1926,6 +2232,8 @@ pg_stat_reset_shared(PG_FUNCTION_ARGS)
 		pgstat_reset_of_kind(PGSTAT_KIND_CHECKPOINTER);
 	else if (strcmp(target, "io") == 0)
 		pgstat_reset_of_kind(PGSTAT_KIND_IO);
+	else if (strcmp(target, "lwlock") == 0)
+		pgstat_reset_of_kind(PGSTAT_KIND_LWLOCK);
 	else if (strcmp(target, "recovery_prefetch") == 0)
 		XLogPrefetchResetStats();
 	else if (strcmp(target, "slru") == 0)
@@ -1936,7 +2244,7 @@ pg_stat_reset_shared(PG_FUNCTION_ARGS)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("unrecognized reset target: \"%s\"", target),
-				 errhint("Target must be \"archiver\", \"bgwriter\", \"checkpointer\", \"io\", \"recovery_prefetch\", \"slru\", or \"wal\".")));
+				 errhint("Target must be \"archiver\", \"bgwriter\", \"checkpointer\", \"io\", \"lwlock\", \"recovery_prefetch\", \"slru\", or \"wal\".")));
 
 	PG_RETURN_VOID();
 }
@@ -2129,7 +2437,7 @@ pg_stat_get_archiver(PG_FUNCTION_ARGS)
 Datum
 pg_stat_get_replication_slot(PG_FUNCTION_ARGS)
 {
-#define PG_STAT_GET_REPLICATION_SLOT_COLS 13
+#define PG_STAT_GET_REPLICATION_SLOT_COLS 14
 	text	   *slotname_text = PG_GETARG_TEXT_P(0);
 	NameData	slotname;
 	TupleDesc	tupdesc;
@@ -2148,23 +2456,25 @@ pg_stat_get_replication_slot(PG_FUNCTION_ARGS)
 					   INT8OID, -1, 0);
 	TupleDescInitEntry(tupdesc, (AttrNumber) 4, "spill_bytes",
 					   INT8OID, -1, 0);
-	TupleDescInitEntry(tupdesc, (AttrNumber) 5, "stream_txns",
+	TupleDescInitEntry(tupdesc, (AttrNumber) 5, "spill_compressed_bytes",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 6, "stream_txns",
 					   INT8OID, -1, 0);
-	TupleDescInitEntry(tupdesc, (AttrNumber) 6, "stream_count",
+	TupleDescInitEntry(tupdesc, (AttrNumber) 7, "stream_count",
 					   INT8OID, -1, 0);
-	TupleDescInitEntry(tupdesc, (AttrNumber) 7, "stream_bytes",
+	TupleDescInitEntry(tupdesc, (AttrNumber) 8, "stream_bytes",
 					   INT8OID, -1, 0);
-	TupleDescInitEntry(tupdesc, (AttrNumber) 8, "mem_exceeded_count",
+	TupleDescInitEntry(tupdesc, (AttrNumber) 9, "mem_exceeded_count",
 					   INT8OID, -1, 0);
-	TupleDescInitEntry(tupdesc, (AttrNumber) 9, "total_txns",
+	TupleDescInitEntry(tupdesc, (AttrNumber) 10, "total_txns",
 					   INT8OID, -1, 0);
-	TupleDescInitEntry(tupdesc, (AttrNumber) 10, "total_bytes",
+	TupleDescInitEntry(tupdesc, (AttrNumber) 11, "total_bytes",
 					   INT8OID, -1, 0);
-	TupleDescInitEntry(tupdesc, (AttrNumber) 11, "slotsync_skip_count",
+	TupleDescInitEntry(tupdesc, (AttrNumber) 12, "slotsync_skip_count",
 					   INT8OID, -1, 0);
-	TupleDescInitEntry(tupdesc, (AttrNumber) 12, "slotsync_last_skip",
+	TupleDescInitEntry(tupdesc, (AttrNumber) 13, "slotsync_last_skip",
 					   TIMESTAMPTZOID, -1, 0);
-	TupleDescInitEntry(tupdesc, (AttrNumber) 13, "stats_reset",
+	TupleDescInitEntry(tupdesc, (AttrNumber) 14, "stats_reset",
 					   TIMESTAMPTZOID, -1, 0);
 	BlessTupleDesc(tupdesc);
 
@@ -2184,23 +2494,24 @@ pg_stat_get_replication_slot(PG_FUNCTION_ARGS)
 	values[1] = Int64GetDatum(slotent->spill_txns);
 	values[2] = Int64GetDatum(slotent->spill_count);
 	values[3] = Int64GetDatum(slotent->spill_bytes);
-	values[4] = Int64GetDatum(slotent->stream_txns);
-	values[5] = Int64GetDatum(slotent->stream_count);
-	values[6] = Int64GetDatum(slotent->stream_bytes);
-	values[7] = Int64GetDatum(slotent->mem_exceeded_count);
-	values[8] = Int64GetDatum(slotent->total_txns);
-	values[9] = Int64GetDatum(slotent->total_bytes);
-	values[10] = Int64GetDatum(slotent->slotsync_skip_count);
+	values[4] = Int64GetDatum(slotent->spill_compressed_bytes);
+	values[5] = Int64GetDatum(slotent->stream_txns);
+	values[6] = Int64GetDatum(slotent->stream_count);
+	values[7] = Int64GetDatum(slotent->stream_bytes);
+	values[8] = Int64GetDatum(slotent->mem_exceeded_count);
+	values[9] = Int64GetDatum(slotent->total_txns);
+	values[10] = Int64GetDatum(slotent->total_bytes);
+	values[11] = Int64GetDatum(slotent->slotsync_skip_count);
 
 	if (slotent->slotsync_last_skip == 0)
-		nulls[11] = true;
+		nulls[12] = true;
 	else
-		values[11] = TimestampTzGetDatum(slotent->slotsync_last_skip);
+		values[12] = TimestampTzGetDatum(slotent->slotsync_last_skip);
 
 	if (slotent->stat_reset_timestamp == 0)
-		nulls[12] = true;
+		nulls[13] = true;
 	else
-		values[12] = TimestampTzGetDatum(slotent->stat_reset_timestamp);
+		values[13] = TimestampTzGetDatum(slotent->stat_reset_timestamp);
 
 	/* Returns the record as Datum */
 	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
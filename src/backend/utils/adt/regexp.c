@@ -30,10 +30,13 @@
 #include "postgres.h"
 
 #include "catalog/pg_type.h"
+#include "common/hashfn.h"
 #include "funcapi.h"
+#include "lib/ilist.h"
 #include "regex/regex.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/hsearch.h"
 #include "utils/memutils.h"
 #include "utils/varlena.h"
 
@@ -67,50 +70,57 @@ typedef struct regexp_matches_ctx
 } regexp_matches_ctx;
 
 /*
- * We cache precompiled regular expressions using a "self organizing list"
- * structure, in which recently-used items tend to be near the front.
- * Whenever we use an entry, it's moved up to the front of the list.
- * Over time, an item's average position corresponds to its frequency of use.
+ * We cache precompiled regular expressions in a hash table keyed by the
+ * pattern, compile flags and collation.  The entries are also kept in a list
+ * ordered by recency of use: whenever we use an entry, it's moved up to the
+ * front of the list, and when the cache is full, entries are dropped from
+ * the end of it.  A reusable pattern thus stays in the cache as long as it's
+ * used at least once while the cache fills up with others, however many
+ * non-reusable patterns go by.
  *
- * When we first create an entry, it's inserted at the front of
- * the array, dropping the entry at the end of the array if necessary to
- * make room.  (This might seem to be weighting the new entry too heavily,
- * but if we insert new entries further back, we'll be unable to adjust to
- * a sudden shift in the query mix where we are presented with MAX_CACHED_RES
- * never-before-seen items used circularly.  We ought to be able to handle
- * that case, so we have to insert at the front.)
- *
- * Knuth mentions a variant strategy in which a used item is moved up just
- * one place in the list.  Although he says this uses fewer comparisons on
- * average, it seems not to adapt very well to the situation where you have
- * both some reusable patterns and a steady stream of non-reusable patterns.
- * A reusable pattern that isn't used at least as often as non-reusable
- * patterns are seen will "fail to keep up" and will drop off the end of the
- * cache.  With move-to-front, a reusable pattern is guaranteed to stay in
- * the cache as long as it's used at least once in every MAX_CACHED_RES uses.
+ * The cache is limited both in the number of entries and in the total
+ * amount of memory the compiled regexps use, since a single complex regexp
+ * can take up a lot.
  */
 
 /* this is the maximum number of cached regular expressions */
 #ifndef MAX_CACHED_RES
-#define MAX_CACHED_RES	32
+#define MAX_CACHED_RES	1024
+#endif
+
+/* and this is the maximum amount of memory they may use, in bytes */
+#ifndef MAX_CACHED_RES_SIZE
+#define MAX_CACHED_RES_SIZE	(8 * 1024 * 1024)
 #endif
 
 /* A parent memory context for regular expressions. */
 static MemoryContext RegexpCacheMemoryContext;
 
+/* hash key of a cached regular expression */
+typedef struct cached_re_key
+{
+	char	   *pat;			/* original RE (not null terminated!) */
+	int			pat_len;		/* length of original RE, in bytes */
+	int			flags;			/* compile flags: extended,icase etc */
+	Oid			collation;		/* collation to use */
+} cached_re_key;
+
 /* this structure describes one cached regular expression */
 typedef struct cached_re_str
 {
+	cached_re_key cre_key;		/* hash key, must be first */
+	dlist_node	cre_node;		/* link in the list, most recently used first */
 	MemoryContext cre_context;	/* memory context for this regexp */
-	char	   *cre_pat;		/* original RE (not null terminated!) */
-	int			cre_pat_len;	/* length of original RE, in bytes */
-	int			cre_flags;		/* compile flags: extended,icase etc */
-	Oid			cre_collation;	/* collation to use */
+	Size		cre_size;		/* memory used by cre_context */
+	char	   *cre_literal;	/* string any match must contain, or NULL */
+	int			cre_literal_len;	/* length of cre_literal, in bytes */
 	regex_t		cre_re;			/* the compiled regular expression */
 } cached_re_str;
 
+static HTAB *re_hash = NULL;	/* cached re's */
+static dlist_head re_lru = DLIST_STATIC_INIT(re_lru);
 static int	num_res = 0;		/* # of cached re's */
-static cached_re_str re_array[MAX_CACHED_RES];	/* cached re's */
+static Size re_size = 0;		/* total cre_size of cached re's */
 
 
 /* Local functions */
@@ -121,10 +131,46 @@ static regexp_matches_ctx *setup_regexp_matches(text *orig_str, text *pattern,
 												bool use_subpatterns,
 												bool ignore_degenerate,
 												bool fetching_unmatched);
+static uint32 cached_re_hash(const void *key, Size keysize);
+static int	cached_re_match(const void *key1, const void *key2, Size keysize);
+static bool RE_literal_present(const char *literal, int literal_len,
+							   const char *dat, int dat_len);
+static cached_re_str *RE_compile_and_cache_entry(text *text_re, int cflags,
+												 Oid collation);
 static ArrayType *build_regexp_match_result(regexp_matches_ctx *matchctx);
 static Datum build_regexp_split_result(regexp_matches_ctx *splitctx);
 
 
+/*
+ * Hash and match functions for the cache's hash table.
+ */
+static uint32
+cached_re_hash(const void *key, Size keysize)
+{
+	const cached_re_key *k = (const cached_re_key *) key;
+	uint32		h;
+
+	h = hash_bytes((const unsigned char *) k->pat, k->pat_len);
+	h = hash_combine(h, murmurhash32((uint32) k->flags));
+	h = hash_combine(h, murmurhash32((uint32) k->collation));
+
+	return h;
+}
+
+static int
+cached_re_match(const void *key1, const void *key2, Size keysize)
+{
+	const cached_re_key *k1 = (const cached_re_key *) key1;
+	const cached_re_key *k2 = (const cached_re_key *) key2;
+
+	if (k1->pat_len == k2->pat_len &&
+		k1->flags == k2->flags &&
+		k1->collation == k2->collation &&
+		memcmp(k1->pat, k2->pat, k1->pat_len) == 0)
+		return 0;
+	return 1;
+}
+
 /*
  * RE_compile_and_cache - compile a RE, caching if possible
  *
@@ -136,52 +182,69 @@ static Datum build_regexp_split_result(regexp_matches_ctx *splitctx);
  *
  * Pattern is given in the database encoding.  We internally convert to
  * an array of pg_wchar, which is what Spencer's regex package wants.
+ *
+ * The result is valid until the next call.
  */
 regex_t *
 RE_compile_and_cache(text *text_re, int cflags, Oid collation)
+{
+	return &RE_compile_and_cache_entry(text_re, cflags, collation)->cre_re;
+}
+
+/*
+ * RE_compile_and_cache_entry - workhorse for RE_compile_and_cache
+ *
+ * Returns the cache entry, which also has the literal prefilter string.
+ */
+static cached_re_str *
+RE_compile_and_cache_entry(text *text_re, int cflags, Oid collation)
 {
 	int			text_re_len = VARSIZE_ANY_EXHDR(text_re);
 	char	   *text_re_val = VARDATA_ANY(text_re);
 	pg_wchar   *pattern;
 	int			pattern_len;
-	int			i;
 	int			regcomp_result;
+	cached_re_key key;
+	cached_re_str *entry;
 	cached_re_str re_temp;
+	pg_wchar   *literal;
+	size_t		literal_len;
 	char		errMsg[100];
 	MemoryContext oldcontext;
 
-	/*
-	 * Look for a match among previously compiled REs.  Since the data
-	 * structure is self-organizing with most-used entries at the front, our
-	 * search strategy can just be to scan from the front.
-	 */
-	for (i = 0; i < num_res; i++)
+	/* Set up the cache on first go through. */
+	if (unlikely(re_hash == NULL))
 	{
-		if (re_array[i].cre_pat_len == text_re_len &&
-			re_array[i].cre_flags == cflags &&
-			re_array[i].cre_collation == collation &&
-			memcmp(re_array[i].cre_pat, text_re_val, text_re_len) == 0)
-		{
-			/*
-			 * Found a match; move it to front if not there already.
-			 */
-			if (i > 0)
-			{
-				re_temp = re_array[i];
-				memmove(&re_array[1], &re_array[0], i * sizeof(cached_re_str));
-				re_array[0] = re_temp;
-			}
-
-			return &re_array[0].cre_re;
-		}
+		HASHCTL		ctl;
+
+		if (RegexpCacheMemoryContext == NULL)
+			RegexpCacheMemoryContext =
+				AllocSetContextCreate(TopMemoryContext,
+									  "RegexpCacheMemoryContext",
+									  ALLOCSET_SMALL_SIZES);
+
+		ctl.keysize = sizeof(cached_re_key);
+		ctl.entrysize = sizeof(cached_re_str);
+		ctl.hash = cached_re_hash;
+		ctl.match = cached_re_match;
+		ctl.hcxt = RegexpCacheMemoryContext;
+		re_hash = hash_create("Regexp cache", 64, &ctl,
+							  HASH_ELEM | HASH_FUNCTION | HASH_COMPARE |
+							  HASH_CONTEXT);
 	}
 
-	/* Set up the cache memory on first go through. */
-	if (unlikely(RegexpCacheMemoryContext == NULL))
-		RegexpCacheMemoryContext =
-			AllocSetContextCreate(TopMemoryContext,
-								  "RegexpCacheMemoryContext",
-								  ALLOCSET_SMALL_SIZES);
+	/* Look for a match among previously compiled REs. */
+	key.pat = text_re_val;
+	key.pat_len = text_re_len;
+	key.flags = cflags;
+	key.collation = collation;
+	entry = hash_search(re_hash, &key, HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		/* Found a match; move it to front if not there already. */
+		dlist_move_head(&re_lru, &entry->cre_node);
+		return entry;
+	}
 
 	/*
 	 * Couldn't find it, so try to compile the new RE.  To avoid leaking
@@ -224,44 +287,74 @@ RE_compile_and_cache(text *text_re, int cflags, Oid collation)
 	}
 
 	/* Copy the pattern into the per-regexp memory context. */
-	re_temp.cre_pat = palloc(text_re_len + 1);
-	memcpy(re_temp.cre_pat, text_re_val, text_re_len);
+	re_temp.cre_key.pat = palloc(text_re_len + 1);
+	memcpy(re_temp.cre_key.pat, text_re_val, text_re_len);
 
 	/*
 	 * NUL-terminate it only for the benefit of the identifier used for the
 	 * memory context, visible in the pg_backend_memory_contexts view.
 	 */
-	re_temp.cre_pat[text_re_len] = 0;
-	MemoryContextSetIdentifier(re_temp.cre_context, re_temp.cre_pat);
+	re_temp.cre_key.pat[text_re_len] = 0;
+	MemoryContextSetIdentifier(re_temp.cre_context, re_temp.cre_key.pat);
 
-	re_temp.cre_pat_len = text_re_len;
-	re_temp.cre_flags = cflags;
-	re_temp.cre_collation = collation;
+	re_temp.cre_key.pat_len = text_re_len;
+	re_temp.cre_key.flags = cflags;
+	re_temp.cre_key.collation = collation;
 
 	/*
-	 * Okay, we have a valid new item in re_temp; insert it into the storage
-	 * array.  Discard last entry if needed.
+	 * Find a string that any match must contain, so that RE_execute can
+	 * reject data that doesn't contain it without running the regex engine
+	 * at all, or even converting the data to wide characters.  We search for
+	 * it in the data in the database encoding.  In some encodings that might
+	 * find it at a position that isn't a character boundary, but that only
+	 * means we run the regex engine when we needn't.
 	 */
-	if (num_res >= MAX_CACHED_RES)
+	re_temp.cre_literal = NULL;
+	re_temp.cre_literal_len = 0;
+	if (pg_regliteral(&re_temp.cre_re, &literal, &literal_len) == REG_PREFIX)
 	{
-		--num_res;
-		Assert(num_res < MAX_CACHED_RES);
+		re_temp.cre_literal =
+			palloc(pg_database_encoding_max_length() * literal_len + 1);
+		re_temp.cre_literal_len = pg_wchar2mb_with_len(literal,
+													   re_temp.cre_literal,
+													   literal_len);
+		pfree(literal);
+	}
+
+	re_temp.cre_size = MemoryContextMemAllocated(re_temp.cre_context, true);
+
+	/*
+	 * Okay, we have a valid new item in re_temp; insert it into the cache.
+	 * Discard the least recently used entries as needed to make room.
+	 */
+	while (num_res > 0 &&
+		   (num_res >= MAX_CACHED_RES ||
+			re_size + re_temp.cre_size > MAX_CACHED_RES_SIZE))
+	{
+		cached_re_str *victim;
+
+		victim = dlist_tail_element(cached_re_str, cre_node, &re_lru);
+		dlist_delete(&victim->cre_node);
+		num_res--;
+		re_size -= victim->cre_size;
+		(void) hash_search(re_hash, &victim->cre_key, HASH_REMOVE, NULL);
 		/* Delete the memory context holding the regexp and pattern. */
-		MemoryContextDelete(re_array[num_res].cre_context);
+		MemoryContextDelete(victim->cre_context);
 	}
 
+	entry = hash_search(re_hash, &re_temp.cre_key, HASH_ENTER, NULL);
+
 	/* Re-parent the memory context to our long-lived cache context. */
 	MemoryContextSetParent(re_temp.cre_context, RegexpCacheMemoryContext);
 
-	if (num_res > 0)
-		memmove(&re_array[1], &re_array[0], num_res * sizeof(cached_re_str));
-
-	re_array[0] = re_temp;
+	*entry = re_temp;
+	dlist_push_head(&re_lru, &entry->cre_node);
 	num_res++;
+	re_size += entry->cre_size;
 
 	MemoryContextSwitchTo(oldcontext);
 
-	return &re_array[0].cre_re;
+	return entry;
 }
 
 /*
@@ -307,12 +400,41 @@ RE_wchar_execute(regex_t *re, pg_wchar *data, int data_len,
 	return (regexec_result == REG_OKAY);
 }
 
+/*
+ * RE_literal_present - does the data contain the given string?
+ *
+ * memchr() is usually vectorized, so use it to find candidate positions.
+ */
+static bool
+RE_literal_present(const char *literal, int literal_len,
+				   const char *dat, int dat_len)
+{
+	const char *p = dat;
+	const char *last;
+
+	if (literal_len > dat_len)
+		return false;
+
+	last = dat + dat_len - literal_len;
+	while (p <= last)
+	{
+		p = memchr(p, literal[0], last - p + 1);
+		if (p == NULL)
+			return false;
+		if (memcmp(p + 1, literal + 1, literal_len - 1) == 0)
+			return true;
+		p++;
+	}
+
+	return false;
+}
+
 /*
  * RE_execute - execute a RE
  *
  * Returns true on match, false on no match
  *
- *	re --- the compiled pattern as returned by RE_compile_and_cache
+ *	cre --- the compiled pattern as returned by RE_compile_and_cache_entry
  *	dat --- the data to match against (need not be null-terminated)
  *	dat_len --- the length of the data string
  *	nmatch, pmatch	--- optional return area for match details
@@ -321,19 +443,25 @@ RE_wchar_execute(regex_t *re, pg_wchar *data, int data_len,
  * convert to array of pg_wchar which is what Spencer's regex package wants.
  */
 static bool
-RE_execute(regex_t *re, char *dat, int dat_len,
+RE_execute(cached_re_str *cre, char *dat, int dat_len,
 		   int nmatch, regmatch_t *pmatch)
 {
 	pg_wchar   *data;
 	int			data_len;
 	bool		match;
 
+	/* Quick out if the data doesn't contain a string any match must have */
+	if (cre->cre_literal != NULL &&
+		!RE_literal_present(cre->cre_literal, cre->cre_literal_len,
+							dat, dat_len))
+		return false;
+
 	/* Convert data string to wide characters */
 	data = palloc_array(pg_wchar, dat_len + 1);
 	data_len = pg_mb2wchar_with_len(dat, data, dat_len);
 
 	/* Perform RE match and return result */
-	match = RE_wchar_execute(re, data, data_len, 0, nmatch, pmatch);
+	match = RE_wchar_execute(&cre->cre_re, data, data_len, 0, nmatch, pmatch);
 
 	pfree(data);
 	return match;
@@ -359,16 +487,16 @@ RE_compile_and_execute(text *text_re, char *dat, int dat_len,
 					   int cflags, Oid collation,
 					   int nmatch, regmatch_t *pmatch)
 {
-	regex_t    *re;
+	cached_re_str *cre;
 
 	/* Use REG_NOSUB if caller does not want sub-match details */
 	if (nmatch < 2)
 		cflags |= REG_NOSUB;
 
 	/* Compile RE */
-	re = RE_compile_and_cache(text_re, cflags, collation);
+	cre = RE_compile_and_cache_entry(text_re, cflags, collation);
 
-	return RE_execute(re, dat, dat_len, nmatch, pmatch);
+	return RE_execute(cre, dat, dat_len, nmatch, pmatch);
 }
 
 
@@ -584,13 +712,15 @@ textregexsubstr(PG_FUNCTION_ARGS)
 {
 	text	   *s = PG_GETARG_TEXT_PP(0);
 	text	   *p = PG_GETARG_TEXT_PP(1);
+	cached_re_str *cre;
 	regex_t    *re;
 	regmatch_t	pmatch[2];
 	int			so,
 				eo;
 
 	/* Compile RE */
-	re = RE_compile_and_cache(p, REG_ADVANCED, PG_GET_COLLATION());
+	cre = RE_compile_and_cache_entry(p, REG_ADVANCED, PG_GET_COLLATION());
+	re = &cre->cre_re;
 
 	/*
 	 * We pass two regmatch_t structs to get info about the overall match and
@@ -598,7 +728,7 @@ textregexsubstr(PG_FUNCTION_ARGS)
 	 * is a parenthesized subexpression, we return what it matched; else
 	 * return what the whole regexp matched.
 	 */
-	if (!RE_execute(re,
+	if (!RE_execute(cre,
 					VARDATA_ANY(s), VARSIZE_ANY_EXHDR(s),
 					2, pmatch))
 		PG_RETURN_NULL();		/* definitely no match */
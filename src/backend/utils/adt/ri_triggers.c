@@ -23,11 +23,14 @@
 
 #include "postgres.h"
 
+#include "access/genam.h"
 #include "access/htup_details.h"
+#include "access/stratnum.h"
 #include "access/sysattr.h"
 #include "access/table.h"
 #include "access/tableam.h"
 #include "access/xact.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_constraint.h"
 #include "commands/trigger.h"
@@ -121,6 +124,7 @@ typedef struct RI_ConstraintInfo
 	char		confmatchtype;	/* foreign key's match type */
 	bool		hasperiod;		/* if the foreign key uses PERIOD */
 	int			nkeys;			/* number of key columns */
+	Oid			conindid;		/* unique index on the referenced columns */
 	int16		pk_attnums[RI_MAX_NUMKEYS]; /* attnums of referenced cols */
 	int16		fk_attnums[RI_MAX_NUMKEYS]; /* attnums of referencing cols */
 	Oid			pf_eq_oprs[RI_MAX_NUMKEYS]; /* equality operators (PK = FK) */
@@ -226,6 +230,9 @@ static const RI_ConstraintInfo *ri_LoadConstraintInfo(Oid constraintOid);
 static Oid	get_ri_constraint_root(Oid constrOid);
 static SPIPlanPtr ri_PlanCheck(const char *querystr, int nargs, Oid *argtypes,
 							   RI_QueryKey *qkey, Relation fk_rel, Relation pk_rel);
+static bool ri_FastPathCheck(const RI_ConstraintInfo *riinfo,
+							 Relation fk_rel, Relation pk_rel,
+							 TupleTableSlot *newslot);
 static bool ri_PerformCheck(const RI_ConstraintInfo *riinfo,
 							RI_QueryKey *qkey, SPIPlanPtr qplan,
 							Relation fk_rel, Relation pk_rel,
@@ -351,6 +358,16 @@ RI_FKey_check(TriggerData *trigdata)
 			break;
 	}
 
+	/*
+	 * In the common case of a plain PK table, look the key up by probing its
+	 * unique index directly rather than through SPI.
+	 */
+	if (ri_FastPathCheck(riinfo, fk_rel, pk_rel, newslot))
+	{
+		table_close(pk_rel, RowShareLock);
+		return PointerGetDatum(NULL);
+	}
+
 	SPI_connect();
 
 	/* Fetch or prepare a saved plan for the real check */
@@ -1534,6 +1551,7 @@ RI_Initial_Check(Trigger *trigger, Relation fk_rel, Relation pk_rel)
 	const char *pk_only;
 	int			save_nestlevel;
 	char		workmembuf[32];
+	char		workersbuf[32];
 	int			spi_result;
 	SPIPlanPtr	qplan;
 
@@ -1608,6 +1626,7 @@ RI_Initial_Check(Trigger *trigger, Relation fk_rel, Relation pk_rel)
 	 *	 (fk.keycol1 IS NOT NULL [AND ...])
 	 * For MATCH FULL:
 	 *	 (fk.keycol1 IS NOT NULL [OR ...])
+	 *	 LIMIT 1
 	 *
 	 * We attach COLLATE clauses to the operators when comparing columns
 	 * that have different collations.
@@ -1681,7 +1700,13 @@ RI_Initial_Check(Trigger *trigger, Relation fk_rel, Relation pk_rel)
 				break;
 		}
 	}
-	appendStringInfoChar(&querybuf, ')');
+
+	/*
+	 * We need at most one tuple.  Say so in the query rather than by passing
+	 * a tuple count limit to SPI, because the executor doesn't run plans in
+	 * parallel if asked to stop early.
+	 */
+	appendStringInfoString(&querybuf, ") LIMIT 1");
 
 	/*
 	 * Temporarily increase work_mem so that the check query can be executed
@@ -1691,7 +1716,10 @@ RI_Initial_Check(Trigger *trigger, Relation fk_rel, Relation pk_rel)
 	 * this seems to meet the criteria for being considered a "maintenance"
 	 * operation, and accordingly we use maintenance_work_mem.  However, we
 	 * must also set hash_mem_multiplier to 1, since it is surely not okay to
-	 * let that get applied to the maintenance_work_mem value.
+	 * let that get applied to the maintenance_work_mem value.  For the same
+	 * reason, the number of workers the query may use if it's run in parallel
+	 * is limited by max_parallel_maintenance_workers rather than
+	 * max_parallel_workers_per_gather.
 	 *
 	 * We use the equivalent of a function SET option to allow the setting to
 	 * persist for exactly the duration of the check query.  guc.c also takes
@@ -1706,14 +1734,20 @@ RI_Initial_Check(Trigger *trigger, Relation fk_rel, Relation pk_rel)
 	(void) set_config_option("hash_mem_multiplier", "1",
 							 PGC_USERSET, PGC_S_SESSION,
 							 GUC_ACTION_SAVE, true, 0, false);
+	snprintf(workersbuf, sizeof(workersbuf), "%d",
+			 max_parallel_maintenance_workers);
+	(void) set_config_option("max_parallel_workers_per_gather", workersbuf,
+							 PGC_USERSET, PGC_S_SESSION,
+							 GUC_ACTION_SAVE, true, 0, false);
 
 	SPI_connect();
 
 	/*
 	 * Generate the plan.  We don't need to cache it, and there are no
-	 * arguments to the plan.
+	 * arguments to the plan.  The query only reads the two tables, so it can
+	 * be run in parallel.
 	 */
-	qplan = SPI_prepare(querybuf.data, 0, NULL);
+	qplan = SPI_prepare_cursor(querybuf.data, 0, NULL, CURSOR_OPT_PARALLEL_OK);
 
 	if (qplan == NULL)
 		elog(ERROR, "SPI_prepare returned %s for %s",
@@ -1723,14 +1757,14 @@ RI_Initial_Check(Trigger *trigger, Relation fk_rel, Relation pk_rel)
 	 * Run the plan.  For safety we force a current snapshot to be used. (In
 	 * transaction-snapshot mode, this arguably violates transaction isolation
 	 * rules, but we really haven't got much choice.) We don't need to
-	 * register the snapshot, because SPI_execute_snapshot will see to it. We
-	 * need at most one tuple returned, so pass limit = 1.
+	 * register the snapshot, because SPI_execute_snapshot will see to it.
+	 * The query returns at most one tuple.
 	 */
 	spi_result = SPI_execute_snapshot(qplan,
 									  NULL, NULL,
 									  GetLatestSnapshot(),
 									  InvalidSnapshot,
-									  true, false, 1);
+									  true, false, 0);
 
 	/* Check result */
 	if (spi_result != SPI_OK_SELECT)
@@ -2319,6 +2353,7 @@ ri_LoadConstraintInfo(Oid constraintOid)
 	riinfo->confdeltype = conForm->confdeltype;
 	riinfo->confmatchtype = conForm->confmatchtype;
 	riinfo->hasperiod = conForm->conperiod;
+	riinfo->conindid = conForm->conindid;
 
 	DeconstructFkConstraintRow(tup,
 							   &riinfo->nkeys,
@@ -2477,6 +2512,244 @@ ri_PlanCheck(const char *querystr, int nargs, Oid *argtypes,
 	return qplan;
 }
 
+/*
+ * ri_FastPathCheck -
+ *
+ * Check that the FK row's key exists in the PK table by probing the PK's
+ * unique index directly, instead of running the RI_PLAN_CHECK_LOOKUPPK
+ * query through SPI.  Setting up and shutting down an executor for every
+ * inserted or updated FK row dominates the cost of bulk loads into
+ * referencing tables; an index probe plus a tuple lock is all the query
+ * really does.
+ *
+ * To keep the semantics identical to the SPI query, we scan with the
+ * snapshot SPI would have taken, as the PK table's owner, and lock the row
+ * found the way ExecLockRows() would, including rechecking the key if we
+ * had to follow the row's update chain in READ COMMITTED mode.
+ *
+ * Returns false, having done nothing, if the fast path can't be used for
+ * this constraint; the caller must then fall back to SPI.  Returns true if
+ * the key was found and locked, and reports a violation if it wasn't.
+ */
+static bool
+ri_FastPathCheck(const RI_ConstraintInfo *riinfo,
+				 Relation fk_rel, Relation pk_rel,
+				 TupleTableSlot *newslot)
+{
+	Relation	idxrel;
+	ScanKeyData skey[INDEX_MAX_KEYS];
+	FmgrInfo	eq_finfo[RI_MAX_NUMKEYS];
+	Oid			eq_collation[RI_MAX_NUMKEYS];
+	Datum		fk_vals[RI_MAX_NUMKEYS];
+	Oid			pk_owner = RelationGetForm(pk_rel)->relowner;
+	IndexScanDesc scan;
+	TupleTableSlot *pkslot;
+	Snapshot	snapshot;
+	Oid			save_userid;
+	int			save_sec_context;
+	int			lockflags;
+	bool		found = false;
+
+	/*
+	 * Temporal FKs need range_agg() over several PK rows, and partitioned PK
+	 * tables need the executor to find the right partition.
+	 */
+	if (riinfo->hasperiod ||
+		pk_rel->rd_rel->relkind != RELKIND_RELATION ||
+		!OidIsValid(riinfo->conindid))
+		return false;
+
+	/*
+	 * If the PK table's owner lacks the table-level privileges the query
+	 * needs, let the SPI path raise its usual error (or honor column-level
+	 * grants).
+	 */
+	if (pg_class_aclcheck(RelationGetRelid(pk_rel), pk_owner,
+						  ACL_SELECT) != ACLCHECK_OK ||
+		pg_class_aclcheck(RelationGetRelid(pk_rel), pk_owner,
+						  ACL_UPDATE) != ACLCHECK_OK)
+		return false;
+
+	/* The planner would take this lock on the index, too */
+	idxrel = index_open(riinfo->conindid, AccessShareLock);
+
+	if (idxrel->rd_rel->relam != BTREE_AM_OID ||
+		IndexRelationGetNumberOfKeyAttributes(idxrel) != riinfo->nkeys)
+	{
+		index_close(idxrel, NoLock);
+		return false;
+	}
+
+	/*
+	 * Build one equality scan key per index column.  The constraint's key
+	 * columns need not be in index column order, and btree wants its scan
+	 * keys sorted by attribute number, so place each key by its index
+	 * column.  We only handle the case where the PK = FK operator belongs to
+	 * the index's opfamily and the FK value can be passed to it without a
+	 * conversion; anything else is left to the SPI query.
+	 */
+	for (int i = 0; i < riinfo->nkeys; i++)
+	{
+		Oid			eq_opr = riinfo->pf_eq_oprs[i];
+		Oid			fk_type = RIAttType(fk_rel, riinfo->fk_attnums[i]);
+		int			idxcol = -1;
+		int			strategy;
+		Oid			lefttype;
+		Oid			righttype;
+		bool		isnull;
+
+		for (int j = 0; j < riinfo->nkeys; j++)
+		{
+			if (idxrel->rd_index->indkey.values[j] == riinfo->pk_attnums[i])
+			{
+				idxcol = j;
+				break;
+			}
+		}
+
+		if (idxcol < 0 ||
+			!op_in_opfamily(eq_opr, idxrel->rd_opfamily[idxcol]))
+		{
+			index_close(idxrel, NoLock);
+			return false;
+		}
+
+		get_op_opfamily_properties(eq_opr, idxrel->rd_opfamily[idxcol], false,
+								   &strategy, &lefttype, &righttype);
+		if (strategy != BTEqualStrategyNumber ||
+			lefttype != idxrel->rd_opcintype[idxcol] ||
+			!IsBinaryCoercible(fk_type, righttype))
+		{
+			index_close(idxrel, NoLock);
+			return false;
+		}
+
+		fk_vals[i] = slot_getattr(newslot, riinfo->fk_attnums[i], &isnull);
+		Assert(!isnull);
+
+		fmgr_info(get_opcode(eq_opr), &eq_finfo[i]);
+		eq_collation[i] = idxrel->rd_indcollation[idxcol];
+
+		ScanKeyEntryInitialize(&skey[idxcol],
+							   0,
+							   idxcol + 1,
+							   strategy,
+							   righttype,
+							   eq_collation[i],
+							   eq_finfo[i].fn_oid,
+							   fk_vals[i]);
+	}
+
+	/* Switch to proper UID to perform check as, like ri_PerformCheck() */
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+	SetUserIdAndSecContext(pk_owner,
+						   save_sec_context | SECURITY_LOCAL_USERID_CHANGE |
+						   SECURITY_NOFORCE_RLS);
+
+	/* Take the snapshot SPI_execute_snapshot() would have taken */
+	CommandCounterIncrement();
+	PushActiveSnapshot(GetTransactionSnapshot());
+	snapshot = GetActiveSnapshot();
+
+	/* Same lock flags as ExecLockRows() */
+	lockflags = TUPLE_LOCK_FLAG_LOCK_UPDATE_IN_PROGRESS;
+	if (!IsolationUsesXactSnapshot())
+		lockflags |= TUPLE_LOCK_FLAG_FIND_LAST_VERSION;
+
+	pkslot = table_slot_create(pk_rel, NULL);
+	scan = index_beginscan(pk_rel, idxrel, snapshot, NULL, riinfo->nkeys, 0);
+	index_rescan(scan, skey, riinfo->nkeys, NULL, 0);
+
+	while (!found && index_getnext_slot(scan, ForwardScanDirection, pkslot))
+	{
+		TM_FailureData tmfd;
+		TM_Result	test;
+
+		test = table_tuple_lock(pk_rel, &pkslot->tts_tid, snapshot, pkslot,
+								GetCurrentCommandId(true),
+								LockTupleKeyShare, LockWaitBlock,
+								lockflags, &tmfd);
+
+		switch (test)
+		{
+			case TM_SelfModified:
+				/* updated or deleted by ourselves; ignore, as the executor does */
+				break;
+
+			case TM_Ok:
+
+				/*
+				 * If we locked a newer version of the row, its key might no
+				 * longer match; recheck it, as EvalPlanQual would.
+				 */
+				found = true;
+				if (tmfd.traversed)
+				{
+					for (int i = 0; i < riinfo->nkeys; i++)
+					{
+						Datum		pk_val;
+						bool		isnull;
+
+						pk_val = slot_getattr(pkslot, riinfo->pk_attnums[i],
+											  &isnull);
+						if (isnull ||
+							!DatumGetBool(FunctionCall2Coll(&eq_finfo[i],
+															eq_collation[i],
+															pk_val,
+															fk_vals[i])))
+						{
+							found = false;
+							break;
+						}
+					}
+				}
+				break;
+
+			case TM_Updated:
+				if (IsolationUsesXactSnapshot())
+					ereport(ERROR,
+							(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+							 errmsg("could not serialize access due to concurrent update")));
+				elog(ERROR, "unexpected table_tuple_lock status: %u", test);
+				break;
+
+			case TM_Deleted:
+				if (IsolationUsesXactSnapshot())
+					ereport(ERROR,
+							(errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+							 errmsg("could not serialize access due to concurrent update")));
+				/* tuple was deleted, so it doesn't satisfy the check */
+				break;
+
+			case TM_Invisible:
+				elog(ERROR, "attempted to lock invisible tuple");
+				break;
+
+			default:
+				elog(ERROR, "unrecognized table_tuple_lock status: %u", test);
+				break;
+		}
+	}
+
+	index_endscan(scan);
+	ExecDropSingleTupleTableSlot(pkslot);
+	PopActiveSnapshot();
+
+	/* Restore UID and security context */
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+
+	index_close(idxrel, NoLock);
+
+	if (!found)
+		ri_ReportViolation(riinfo,
+						   pk_rel, fk_rel,
+						   newslot,
+						   NULL,
+						   RI_PLAN_CHECK_LOOKUPPK, false, false);
+
+	return true;
+}
+
 /*
  * Perform a query to enforce an RI restriction
  */
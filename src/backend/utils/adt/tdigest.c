@@ -0,0 +1,431 @@
+/*-------------------------------------------------------------------------
+ *
+ * tdigest.c
+ *	  Approximate percentiles, using a t-digest.
+ *
+ * percentile_cont() and percentile_disc() are exact, but they need all of
+ * their input in a sort, which can't be split among parallel workers.
+ * approx_percentile() instead summarizes its input in a t-digest (Dunning
+ * and Ertl, "Computing Extremely Accurate Quantiles Using t-Digests"): a
+ * bounded number of centroids, each the mean and weight of a run of adjacent
+ * input values.  The centroids near the tails are kept small, so extreme
+ * percentiles like the 99th remain accurate, while those near the median can
+ * be large.  Two digests are combined by merging their centroids, so the
+ * aggregate supports partial aggregation.
+ *
+ * New values are appended to the centroid array as centroids of weight 1.
+ * When the array is full, it is sorted, and adjacent centroids are merged
+ * for as long as the result stays within the size limit that the scale
+ * function sets for that part of the distribution.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/adt/tdigest.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "fmgr.h"
+#include "libpq/pqformat.h"
+#include "utils/float.h"
+#include "utils/fmgrprotos.h"
+#include "varatt.h"
+
+/*
+ * The compression parameter, delta in the paper.  A merged digest has at
+ * most about delta * pi / 2 centroids, and its error is roughly inversely
+ * proportional to delta.
+ */
+#define TDIGEST_COMPRESSION		100.0
+
+/* number of centroids kept before merging */
+#define TDIGEST_CAPACITY		1000
+
+typedef struct TDigestCentroid
+{
+	double		mean;
+	double		count;
+} TDigestCentroid;
+
+typedef struct TDigestState
+{
+	double		fraction;		/* the percentile to compute */
+	double		count;			/* total weight of the centroids */
+	double		min;			/* smallest input value */
+	double		max;			/* largest input value */
+	int			ncentroids;		/* # of centroids in use */
+	bool		merged;			/* are the centroids sorted and merged? */
+	TDigestCentroid centroids[TDIGEST_CAPACITY];
+} TDigestState;
+
+static TDigestState *tdigest_init(MemoryContext context, double fraction);
+static void tdigest_add(TDigestState *state, double mean, double count);
+static void tdigest_compress(TDigestState *state);
+static double tdigest_quantile(TDigestState *state);
+static int	tdigest_centroid_cmp(const void *a, const void *b);
+
+
+/*
+ * Create an empty digest in 'context'.
+ */
+static TDigestState *
+tdigest_init(MemoryContext context, double fraction)
+{
+	TDigestState *state;
+
+	if (fraction < 0 || fraction > 1 || isnan(fraction))
+		ereport(ERROR,
+				(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+				 errmsg("percentile value %g is not between 0 and 1",
+						fraction)));
+
+	state = (TDigestState *) MemoryContextAlloc(context, sizeof(TDigestState));
+	state->fraction = fraction;
+	state->count = 0;
+	state->min = get_float8_infinity();
+	state->max = -get_float8_infinity();
+	state->ncentroids = 0;
+	state->merged = true;
+
+	return state;
+}
+
+/*
+ * Add a centroid to the digest, merging the existing ones first if there
+ * is no room for it.
+ */
+static void
+tdigest_add(TDigestState *state, double mean, double count)
+{
+	if (state->ncentroids >= TDIGEST_CAPACITY)
+		tdigest_compress(state);
+
+	state->centroids[state->ncentroids].mean = mean;
+	state->centroids[state->ncentroids].count = count;
+	state->ncentroids++;
+	state->merged = false;
+
+	state->count += count;
+	if (mean < state->min)
+		state->min = mean;
+	if (mean > state->max)
+		state->max = mean;
+}
+
+static int
+tdigest_centroid_cmp(const void *a, const void *b)
+{
+	const TDigestCentroid *ca = (const TDigestCentroid *) a;
+	const TDigestCentroid *cb = (const TDigestCentroid *) b;
+
+	if (ca->mean < cb->mean)
+		return -1;
+	if (ca->mean > cb->mean)
+		return 1;
+	return 0;
+}
+
+/*
+ * Sort the centroids, and merge adjacent ones as far as the scale function
+ * allows.
+ *
+ * The scale function k(q) = delta / (2 pi) * asin(2q - 1) maps a quantile to
+ * a "centroid index"; a centroid may span the quantiles from q to the point
+ * where k has grown by one.  As k is steepest at the tails, the centroids
+ * there stay small.
+ */
+static void
+tdigest_compress(TDigestState *state)
+{
+	TDigestCentroid *c = state->centroids;
+	double		total = state->count;
+	double		sofar = 0;
+	double		limit;
+	int			n = 0;
+
+	if (state->merged || state->ncentroids <= 1)
+	{
+		state->merged = true;
+		return;
+	}
+
+	qsort(c, state->ncentroids, sizeof(TDigestCentroid), tdigest_centroid_cmp);
+
+	/* weight at which the first centroid must be closed */
+	limit = total * (sin(asin(-1.0) + 2 * M_PI / TDIGEST_COMPRESSION) + 1) / 2;
+
+	for (int i = 1; i < state->ncentroids; i++)
+	{
+		if (sofar + c[n].count + c[i].count <= limit)
+		{
+			/* fold c[i] into the current centroid */
+			c[n].count += c[i].count;
+			c[n].mean += (c[i].mean - c[n].mean) * c[i].count / c[n].count;
+		}
+		else
+		{
+			double		k;
+
+			sofar += c[n].count;
+
+			/* the next centroid may grow until k has increased by 1 */
+			k = asin(2 * sofar / total - 1) + 2 * M_PI / TDIGEST_COMPRESSION;
+			if (k >= M_PI / 2)
+				limit = total;
+			else
+				limit = total * (sin(k) + 1) / 2;
+
+			c[++n] = c[i];
+		}
+	}
+
+	state->ncentroids = n + 1;
+	state->merged = true;
+}
+
+/*
+ * Estimate the value at state->fraction of the distribution.
+ *
+ * Each centroid stands for its weight spread evenly around its mean, so we
+ * interpolate linearly between the means of the two centroids on either
+ * side of the target weight, or between the outer centroids and the
+ * smallest and largest inputs.
+ */
+static double
+tdigest_quantile(TDigestState *state)
+{
+	TDigestCentroid *c = state->centroids;
+	int			n;
+	double		target;
+	double		left;
+
+	tdigest_compress(state);
+	n = state->ncentroids;
+
+	if (n == 1)
+		return c[0].mean;
+
+	target = state->fraction * state->count;
+
+	/* below the middle of the first centroid */
+	if (target < c[0].count / 2)
+	{
+		if (c[0].count == 1)
+			return state->min;
+		return state->min + (c[0].mean - state->min) *
+			target / (c[0].count / 2);
+	}
+
+	/* above the middle of the last centroid */
+	if (target > state->count - c[n - 1].count / 2)
+	{
+		double		beyond = state->count - target;
+
+		if (c[n - 1].count == 1)
+			return state->max;
+		return state->max - (state->max - c[n - 1].mean) *
+			beyond / (c[n - 1].count / 2);
+	}
+
+	/* between the middles of two centroids */
+	left = c[0].count / 2;
+	for (int i = 0; i < n - 1; i++)
+	{
+		double		gap = (c[i].count + c[i + 1].count) / 2;
+
+		if (target <= left + gap)
+			return c[i].mean + (c[i + 1].mean - c[i].mean) *
+				(target - left) / gap;
+		left += gap;
+	}
+
+	return c[n - 1].mean;
+}
+
+/*
+ * approx_percentile_transfn
+ *		Transition function for approx_percentile(float8, float8).
+ */
+Datum
+approx_percentile_transfn(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	TDigestState *state;
+	double		fraction;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "approx_percentile_transfn called in non-aggregate context");
+
+	if (PG_ARGISNULL(2))
+		ereport(ERROR,
+				(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+				 errmsg("percentile value must not be null")));
+	fraction = PG_GETARG_FLOAT8(2);
+
+	if (PG_ARGISNULL(0))
+		state = tdigest_init(aggcontext, fraction);
+	else
+	{
+		state = (TDigestState *) PG_GETARG_POINTER(0);
+		if (state->fraction != fraction)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("percentile value must be the same for all input rows")));
+	}
+
+	/* Null values are ignored */
+	if (!PG_ARGISNULL(1))
+	{
+		double		value = PG_GETARG_FLOAT8(1);
+
+		if (isnan(value))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("cannot compute a percentile of NaN values")));
+		tdigest_add(state, value, 1);
+	}
+
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * approx_percentile_combine
+ *		Combine two digests, by adding the centroids of one to the other.
+ */
+Datum
+approx_percentile_combine(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggcontext;
+	TDigestState *state1;
+	TDigestState *state2;
+
+	if (!AggCheckCallContext(fcinfo, &aggcontext))
+		elog(ERROR, "approx_percentile_combine called in non-aggregate context");
+
+	state1 = PG_ARGISNULL(0) ? NULL : (TDigestState *) PG_GETARG_POINTER(0);
+	state2 = PG_ARGISNULL(1) ? NULL : (TDigestState *) PG_GETARG_POINTER(1);
+
+	if (state2 == NULL)
+	{
+		if (state1 == NULL)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state1);
+	}
+
+	if (state1 == NULL)
+		state1 = tdigest_init(aggcontext, state2->fraction);
+	else if (state1->fraction != state2->fraction)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("percentile value must be the same for all input rows")));
+
+	for (int i = 0; i < state2->ncentroids; i++)
+		tdigest_add(state1, state2->centroids[i].mean,
+					state2->centroids[i].count);
+
+	/* the extremes may have been merged into larger centroids */
+	if (state2->min < state1->min)
+		state1->min = state2->min;
+	if (state2->max > state1->max)
+		state1->max = state2->max;
+
+	PG_RETURN_POINTER(state1);
+}
+
+/*
+ * approx_percentile_serialize
+ *		Serialize a digest, after merging its centroids to make it smaller.
+ */
+Datum
+approx_percentile_serialize(PG_FUNCTION_ARGS)
+{
+	TDigestState *state;
+	StringInfoData buf;
+
+	/* cannot be called directly because of internal-type argument */
+	Assert(AggCheckCallContext(fcinfo, NULL));
+
+	state = (TDigestState *) PG_GETARG_POINTER(0);
+
+	tdigest_compress(state);
+
+	pq_begintypsend(&buf);
+	pq_sendfloat8(&buf, state->fraction);
+	pq_sendfloat8(&buf, state->min);
+	pq_sendfloat8(&buf, state->max);
+	pq_sendint32(&buf, state->ncentroids);
+	for (int i = 0; i < state->ncentroids; i++)
+	{
+		pq_sendfloat8(&buf, state->centroids[i].mean);
+		pq_sendfloat8(&buf, state->centroids[i].count);
+	}
+
+	PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+/*
+ * approx_percentile_deserialize
+ *		Inverse of approx_percentile_serialize.
+ */
+Datum
+approx_percentile_deserialize(PG_FUNCTION_ARGS)
+{
+	bytea	   *sstate;
+	TDigestState *state;
+	StringInfoData buf;
+	int			ncentroids;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	sstate = PG_GETARG_BYTEA_PP(0);
+
+	initReadOnlyStringInfo(&buf, VARDATA_ANY(sstate),
+						   VARSIZE_ANY_EXHDR(sstate));
+
+	state = tdigest_init(CurrentMemoryContext, pq_getmsgfloat8(&buf));
+	state->min = pq_getmsgfloat8(&buf);
+	state->max = pq_getmsgfloat8(&buf);
+	ncentroids = pq_getmsgint(&buf, 4);
+	if (ncentroids < 0 || ncentroids > TDIGEST_CAPACITY)
+		elog(ERROR, "invalid number of centroids in serialized t-digest: %d",
+			 ncentroids);
+
+	for (int i = 0; i < ncentroids; i++)
+	{
+		state->centroids[i].mean = pq_getmsgfloat8(&buf);
+		state->centroids[i].count = pq_getmsgfloat8(&buf);
+		state->count += state->centroids[i].count;
+	}
+	state->ncentroids = ncentroids;
+	pq_getmsgend(&buf);
+
+	PG_RETURN_POINTER(state);
+}
+
+/*
+ * approx_percentile_finalfn
+ *		Return the estimated percentile, or NULL if there were no inputs.
+ */
+Datum
+approx_percentile_finalfn(PG_FUNCTION_ARGS)
+{
+	TDigestState *state;
+
+	/* cannot be called directly because of internal-type argument */
+	Assert(AggCheckCallContext(fcinfo, NULL));
+
+	if (PG_ARGISNULL(0))
+		PG_RETURN_NULL();
+
+	state = (TDigestState *) PG_GETARG_POINTER(0);
+	if (state->ncentroids == 0)
+		PG_RETURN_NULL();
+
+	PG_RETURN_FLOAT8(tdigest_quantile(state));
+}
@@ -235,10 +235,23 @@ timestamp_out(PG_FUNCTION_ARGS)
 {
 	Timestamp	timestamp = PG_GETARG_TIMESTAMP(0);
 	char	   *result;
+	char		buf[MAXDATELEN + 1];
+
+	timestamp_out_buf(timestamp, buf);
+
+	result = pstrdup(buf);
+	PG_RETURN_CSTRING(result);
+}
+
+/* timestamp_out_buf()
+ * Guts of timestamp_out(); buf must be at least MAXDATELEN + 1 bytes long.
+ */
+void
+timestamp_out_buf(Timestamp timestamp, char *buf)
+{
 	struct pg_tm tt,
 			   *tm = &tt;
 	fsec_t		fsec;
-	char		buf[MAXDATELEN + 1];
 
 	if (TIMESTAMP_NOT_FINITE(timestamp))
 		EncodeSpecialTimestamp(timestamp, buf);
@@ -248,9 +261,6 @@ timestamp_out(PG_FUNCTION_ARGS)
 		ereport(ERROR,
 				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
 				 errmsg("timestamp out of range")));
-
-	result = pstrdup(buf);
-	PG_RETURN_CSTRING(result);
 }
 
 /*
@@ -777,12 +787,25 @@ timestamptz_out(PG_FUNCTION_ARGS)
 {
 	TimestampTz dt = PG_GETARG_TIMESTAMPTZ(0);
 	char	   *result;
+	char		buf[MAXDATELEN + 1];
+
+	timestamptz_out_buf(dt, buf);
+
+	result = pstrdup(buf);
+	PG_RETURN_CSTRING(result);
+}
+
+/* timestamptz_out_buf()
+ * Guts of timestamptz_out(); buf must be at least MAXDATELEN + 1 bytes long.
+ */
+void
+timestamptz_out_buf(TimestampTz dt, char *buf)
+{
 	int			tz;
 	struct pg_tm tt,
 			   *tm = &tt;
 	fsec_t		fsec;
 	const char *tzn;
-	char		buf[MAXDATELEN + 1];
 
 	if (TIMESTAMP_NOT_FINITE(dt))
 		EncodeSpecialTimestamp(dt, buf);
@@ -792,9 +815,6 @@ timestamptz_out(PG_FUNCTION_ARGS)
 		ereport(ERROR,
 				(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
 				 errmsg("timestamp out of range")));
-
-	result = pstrdup(buf);
-	PG_RETURN_CSTRING(result);
 }
 
 /*
@@ -0,0 +1,149 @@
+/*-------------------------------------------------------------------------
+ *
+ * cachemem.c
+ *	  Memory limit and statistics for the backend-local caches.
+ *
+ * The catalog caches, the relation cache and the saved plans of a backend
+ * grow without bound: every catalog row, relation and prepared statement
+ * ever used stays cached until it is invalidated.  With many relations and
+ * many long-lived connections, that adds up.  When catalog_cache_memory_limit
+ * is set, we evict the least recently used entries of all three caches until
+ * their combined memory is below 90% of the limit, so that we don't have to
+ * come back right after the next transaction.
+ *
+ * Eviction happens only at the end of a top-level transaction.  Within a
+ * transaction, code holds on to catcache tuples, relcache entries and plans
+ * without a reference count for the duration of a command, so evicting them
+ * there would not be safe.  At transaction end, the entries that are not
+ * pinned are exactly those that invalidation processing would throw away,
+ * too.  Only the generic plans of saved plans are evicted; the
+ * CachedPlanSources themselves are owned by their callers.
+ *
+ * Each cache keeps its entries in LRU order and stamps them with the value
+ * of a backend-wide clock whenever they are used, so that we can compare
+ * entries across caches.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/cachemem.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "funcapi.h"
+#include "utils/builtins.h"
+#include "utils/cachemem.h"
+#include "utils/catcache.h"
+#include "utils/plancache.h"
+#include "utils/relcache.h"
+#include "utils/tuplestore.h"
+
+/* GUC parameter */
+int			catalog_cache_memory_limit = 0;
+
+uint64		CacheAccessClock = 0;
+
+static Size
+CacheMemoryTotal(void)
+{
+	return CatCacheMemory() + RelationCacheMemory() + PlanCacheMemory();
+}
+
+/*
+ * AtEOXact_CacheMemory
+ *
+ *	Enforce catalog_cache_memory_limit at the end of a top-level transaction.
+ */
+void
+AtEOXact_CacheMemory(void)
+{
+	Size		limit;
+	Size		target;
+
+	if (catalog_cache_memory_limit <= 0)
+		return;
+
+	limit = (Size) catalog_cache_memory_limit * 1024;
+	if (CacheMemoryTotal() <= limit)
+		return;
+
+	target = limit - limit / 10;
+	while (CacheMemoryTotal() > target)
+	{
+		uint64		catuse = CatCacheOldestUse();
+		uint64		reluse = RelationCacheOldestUse();
+		uint64		planuse = PlanCacheOldestUse();
+
+		/* A tick of 0 means that the cache has nothing to evict */
+		if (catuse != 0 &&
+			(reluse == 0 || catuse < reluse) &&
+			(planuse == 0 || catuse < planuse))
+			CatCacheEvictOldest();
+		else if (reluse != 0 &&
+				 (planuse == 0 || reluse < planuse))
+			RelationCacheEvictOldest();
+		else if (planuse != 0)
+			PlanCacheEvictOldest();
+		else
+			break;
+	}
+}
+
+/*
+ * pg_get_backend_cache_stats
+ *		SQL SRF showing the statistics of the backend-local caches.
+ */
+Datum
+pg_get_backend_cache_stats(PG_FUNCTION_ARGS)
+{
+#define PG_GET_BACKEND_CACHE_STATS_COLS	11
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	CacheStatsEntry *catstats;
+	CacheStatsEntry extra[2];
+	int			ncat;
+
+	InitMaterializedSRF(fcinfo, 0);
+
+	ncat = CatCacheGetStats(&catstats);
+	RelationCacheGetStats(&extra[0]);
+	PlanCacheGetStats(&extra[1]);
+
+	for (int i = 0; i < ncat + lengthof(extra); i++)
+	{
+		CacheStatsEntry *stats = i < ncat ? &catstats[i] : &extra[i - ncat];
+		Datum		values[PG_GET_BACKEND_CACHE_STATS_COLS];
+		bool		nulls[PG_GET_BACKEND_CACHE_STATS_COLS];
+
+		memset(nulls, 0, sizeof(nulls));
+
+		values[0] = CStringGetTextDatum(stats->cache);
+		if (stats->cacheId >= 0)
+			values[1] = Int32GetDatum(stats->cacheId);
+		else
+			nulls[1] = true;
+		if (OidIsValid(stats->relid))
+			values[2] = ObjectIdGetDatum(stats->relid);
+		else
+			nulls[2] = true;
+		values[3] = Int64GetDatum(stats->entries);
+		values[4] = Int64GetDatum((int64) stats->memory);
+		values[5] = Int64GetDatum((int64) stats->searches);
+		values[6] = Int64GetDatum((int64) stats->hits);
+		/* only catcaches have negative entries */
+		if (stats->cacheId >= 0)
+			values[7] = Int64GetDatum((int64) stats->neg_hits);
+		else
+			nulls[7] = true;
+		values[8] = Int64GetDatum((int64) stats->loads);
+		values[9] = Int64GetDatum((int64) stats->invals);
+		values[10] = Int64GetDatum((int64) stats->evictions);
+
+		tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc,
+							 values, nulls);
+	}
+
+	return (Datum) 0;
+}
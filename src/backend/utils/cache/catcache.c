@@ -31,6 +31,7 @@
 #endif
 #include "storage/lmgr.h"
 #include "utils/builtins.h"
+#include "utils/cachemem.h"
 #include "utils/catcache.h"
 #include "utils/datum.h"
 #include "utils/fmgroids.h"
@@ -39,6 +40,7 @@
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/resowner.h"
+#include "utils/sharedcatcache.h"
 #include "utils/syscache.h"
 
 /*
@@ -94,6 +96,9 @@ static pg_noinline HeapTuple SearchCatCacheMiss(CatCache *cache,
 												Index hashIndex,
 												Datum v1, Datum v2,
 												Datum v3, Datum v4);
+static CatCTup *SearchCatCacheShared(CatCache *cache, int nkeys, Oid dbid,
+									 uint32 hashValue, Index hashIndex,
+									 const Datum *arguments);
 
 static uint32 CatalogCacheComputeHashValue(CatCache *cache, int nkeys,
 										   Datum v1, Datum v2, Datum v3, Datum v4);
@@ -454,6 +459,18 @@ CatalogCacheCompareTuple(const CatCache *cache, int nkeys,
 	return true;
 }
 
+/*
+ *		CatCacheTouch
+ *
+ * Mark an entry as most recently used.
+ */
+static inline void
+CatCacheTouch(CatCTup *ct)
+{
+	dlist_move_head(&CacheHdr->ch_lru, &ct->lru_elem);
+	ct->lastused = CacheAccessTick();
+}
+
 
 #ifdef CATCACHE_STATS
 
@@ -549,8 +566,9 @@ CatCacheRemoveCTup(CatCache *cache, CatCTup *ct)
 		return;					/* nothing left to do */
 	}
 
-	/* delink from linked list */
+	/* delink from linked lists */
 	dlist_delete(&ct->cache_elem);
+	dlist_delete(&ct->lru_elem);
 
 	/*
 	 * Free keys when we're dealing with a negative entry, normal entries just
@@ -560,6 +578,8 @@ CatCacheRemoveCTup(CatCache *cache, CatCTup *ct)
 		CatCacheFreeKeys(cache->cc_tupdesc, cache->cc_nkeys,
 						 cache->cc_keyno, ct->keys);
 
+	cache->cc_memory -= GetMemoryChunkSpace(ct);
+	CacheHdr->ch_memory -= GetMemoryChunkSpace(ct);
 	pfree(ct);
 
 	--cache->cc_ntup;
@@ -609,6 +629,125 @@ CatCacheRemoveCList(CatCache *cache, CatCList *cl)
 	--cache->cc_nlist;
 }
 
+/*
+ * Can this entry be evicted?  Entries that are referenced directly or
+ * through a list can't.
+ */
+static inline bool
+CatCacheEvictable(CatCTup *ct)
+{
+	return ct->refcount == 0 && !ct->dead &&
+		(ct->c_list == NULL || ct->c_list->refcount == 0);
+}
+
+static CatCTup *
+CatCacheOldestEvictable(void)
+{
+	dlist_iter	iter;
+
+	if (CacheHdr == NULL)
+		return NULL;
+
+	dlist_reverse_foreach(iter, &CacheHdr->ch_lru)
+	{
+		CatCTup    *ct = dlist_container(CatCTup, lru_elem, iter.cur);
+
+		if (CatCacheEvictable(ct))
+			return ct;
+	}
+	return NULL;
+}
+
+/*
+ *		CatCacheMemory
+ *
+ * Report the memory used by the entries of all catalog caches.  Lists and
+ * the hash buckets are not counted.
+ */
+Size
+CatCacheMemory(void)
+{
+	return CacheHdr ? CacheHdr->ch_memory : 0;
+}
+
+/*
+ *		CatCacheOldestUse
+ *
+ * Report when the least recently used entry that could be evicted was last
+ * used, or 0 if there is none.
+ */
+uint64
+CatCacheOldestUse(void)
+{
+	CatCTup    *ct = CatCacheOldestEvictable();
+
+	return ct ? ct->lastused : 0;
+}
+
+/*
+ *		CatCacheEvictOldest
+ *
+ * Evict the least recently used entry that can be evicted.  If it belongs to
+ * a list, the list goes away, too.
+ *
+ * Like invalidation, this may only be done at points where nobody relies on
+ * unreferenced entries staying around; see AtEOXact_CacheMemory().
+ */
+void
+CatCacheEvictOldest(void)
+{
+	CatCTup    *ct = CatCacheOldestEvictable();
+
+	if (ct == NULL)
+		return;
+
+	ct->my_cache->cc_evictions++;
+	CatCacheRemoveCTup(ct->my_cache, ct);
+}
+
+/*
+ *		CatCacheGetStats
+ *
+ * Return the statistics of all catalog caches in a palloc'd array.
+ */
+int
+CatCacheGetStats(CacheStatsEntry **stats)
+{
+	slist_iter	iter;
+	int			n = 0;
+
+	if (CacheHdr == NULL)
+	{
+		*stats = NULL;
+		return 0;
+	}
+
+	slist_foreach(iter, &CacheHdr->ch_caches)
+		n++;
+	*stats = palloc0_array(CacheStatsEntry, n);
+
+	n = 0;
+	slist_foreach(iter, &CacheHdr->ch_caches)
+	{
+		CatCache   *cache = slist_container(CatCache, cc_next, iter.cur);
+		CacheStatsEntry *entry = &(*stats)[n++];
+
+		entry->cache = "catcache";
+		entry->cacheId = cache->id;
+		entry->relid = cache->cc_reloid;
+		entry->entries = cache->cc_ntup;
+		entry->memory = cache->cc_memory;
+		entry->searches = cache->cc_searches + cache->cc_lsearches;
+		entry->hits = cache->cc_hits + cache->cc_lhits;
+		entry->neg_hits = cache->cc_neg_hits;
+		entry->loads = cache->cc_newloads;
+		entry->invals = cache->cc_invals;
+		entry->evictions = cache->cc_evictions;
+	}
+
+	return n;
+}
+
 
 /*
  *	CatCacheInvalidate
@@ -680,9 +819,7 @@ CatCacheInvalidate(CatCache *cache, uint32 hashValue)
 			else
 				CatCacheRemoveCTup(cache, ct);
 			CACHE_elog(DEBUG2, "CatCacheInvalidate: invalidated");
-#ifdef CATCACHE_STATS
 			cache->cc_invals++;
-#endif
 			/* could be multiple matches, so keep looking! */
 		}
 	}
@@ -779,9 +916,7 @@ ResetCatalogCache(CatCache *cache, bool debug_discard)
 			}
 			else
 				CatCacheRemoveCTup(cache, ct);
-#ifdef CATCACHE_STATS
 			cache->cc_invals++;
-#endif
 		}
 	}
 
@@ -923,6 +1058,8 @@ InitCatCache(int id,
 		CacheHdr = palloc_object(CatCacheHeader);
 		slist_init(&CacheHdr->ch_caches);
 		CacheHdr->ch_ntup = 0;
+		dlist_init(&CacheHdr->ch_lru);
+		CacheHdr->ch_memory = 0;
 #ifdef CATCACHE_STATS
 		/* set up to dump stats at backend exit */
 		on_proc_exit(CatCachePrintStats, 0);
@@ -1416,9 +1553,7 @@ SearchCatCacheInternal(CatCache *cache,
 	 */
 	ConditionalCatalogCacheInitializeCache(cache);
 
-#ifdef CATCACHE_STATS
 	cache->cc_searches++;
-#endif
 
 	/* Initialize local parameter array */
 	arguments[0] = v1;
@@ -1459,6 +1594,7 @@ SearchCatCacheInternal(CatCache *cache,
 		 * near the front of the hashbucket's list.)
 		 */
 		dlist_move_head(bucket, &ct->cache_elem);
+		CatCacheTouch(ct);
 
 		/*
 		 * If it's a positive entry, bump its refcount and return it. If it's
@@ -1473,9 +1609,7 @@ SearchCatCacheInternal(CatCache *cache,
 			CACHE_elog(DEBUG2, "SearchCatCache(%s): found in bucket %d",
 					   cache->cc_relname, hashIndex);
 
-#ifdef CATCACHE_STATS
 			cache->cc_hits++;
-#endif
 
 			return &ct->tuple;
 		}
@@ -1484,9 +1618,7 @@ SearchCatCacheInternal(CatCache *cache,
 			CACHE_elog(DEBUG2, "SearchCatCache(%s): found neg entry in bucket %d",
 					   cache->cc_relname, hashIndex);
 
-#ifdef CATCACHE_STATS
 			cache->cc_neg_hits++;
-#endif
 
 			return NULL;
 		}
@@ -1519,6 +1651,9 @@ SearchCatCacheMiss(CatCache *cache,
 	CatCTup    *ct;
 	bool		stale;
 	Datum		arguments[CATCACHE_MAXKEYS];
+	Oid			shareddbid;
+	bool		useshared;
+	uint64		generation = 0;
 
 	/* Initialize local parameter array */
 	arguments[0] = v1;
@@ -1526,6 +1661,20 @@ SearchCatCacheMiss(CatCache *cache,
 	arguments[2] = v3;
 	arguments[3] = v4;
 
+	/*
+	 * Another backend might already have loaded the tuple into the shared
+	 * catalog cache, if there is one.
+	 */
+	shareddbid = cache->cc_relisshared ? InvalidOid : MyDatabaseId;
+	useshared = SharedCatCacheUsable();
+	if (useshared)
+	{
+		ct = SearchCatCacheShared(cache, nkeys, shareddbid, hashValue,
+								  hashIndex, arguments);
+		if (ct != NULL)
+			return &ct->tuple;
+	}
+
 	/*
 	 * Tuple was not found in cache, so we have to try to retrieve it directly
 	 * from the relation.  If found, we will add it to the cache; if not
@@ -1561,6 +1710,10 @@ SearchCatCacheMiss(CatCache *cache,
 
 	do
 	{
+		/* This also makes sure we read the tuple with a fresh snapshot */
+		if (useshared)
+			generation = SharedCatCacheStartLoad();
+
 		scandesc = systable_beginscan(relation,
 									  cache->cc_indexoid,
 									  IndexScanOK(cache),
@@ -1632,13 +1785,68 @@ SearchCatCacheMiss(CatCache *cache,
 	CACHE_elog(DEBUG2, "SearchCatCache(%s): put in bucket %d",
 			   cache->cc_relname, hashIndex);
 
-#ifdef CATCACHE_STATS
 	cache->cc_newloads++;
-#endif
+
+	if (useshared)
+		SharedCatCacheInsert(shareddbid, cache->id, hashValue, &ct->tuple,
+							 generation);
 
 	return &ct->tuple;
 }
 
+/*
+ * Make a cache entry from the shared catalog cache, if it has the tuple.
+ *
+ * Returns the new entry with its refcount set to 1, or NULL if the shared
+ * cache can't help.
+ */
+static CatCTup *
+SearchCatCacheShared(CatCache *cache,
+					 int nkeys,
+					 Oid dbid,
+					 uint32 hashValue,
+					 Index hashIndex,
+					 const Datum *arguments)
+{
+	HeapTuple	ntp;
+	Datum		keys[CATCACHE_MAXKEYS];
+	CatCTup    *ct = NULL;
+	int			i;
+
+	ntp = SharedCatCacheLookup(dbid, cache->id, hashValue);
+	if (ntp == NULL)
+		return NULL;
+
+	/* The shared cache only knows the hash value, so compare the keys */
+	for (i = 0; i < nkeys; i++)
+	{
+		bool		isnull;
+
+		keys[i] = heap_getattr(ntp, cache->cc_keyno[i], cache->cc_tupdesc,
+							   &isnull);
+		Assert(!isnull);
+	}
+
+	if (CatalogCacheCompareTuple(cache, nkeys, keys, arguments))
+		ct = CatalogCacheCreateEntry(cache, ntp, NULL, hashValue, hashIndex);
+	heap_freetuple(ntp);
+
+	if (ct == NULL)
+		return NULL;
+
+	/* immediately set the refcount to 1 */
+	ResourceOwnerEnlarge(CurrentResourceOwner);
+	ct->refcount++;
+	ResourceOwnerRememberCatCacheRef(CurrentResourceOwner, &ct->tuple);
+
+	CACHE_elog(DEBUG2, "SearchCatCache(%s): loaded from shared cache into bucket %d",
+			   cache->cc_relname, hashIndex);
+
+	cache->cc_newloads++;
+
+	return ct;
+}
+
 /*
  *	ReleaseCatCache
  *
@@ -1754,9 +1962,7 @@ SearchCatCacheList(CatCache *cache,
 
 	Assert(nkeys > 0 && nkeys < cache->cc_nkeys);
 
-#ifdef CATCACHE_STATS
 	cache->cc_lsearches++;
-#endif
 
 	/* Initialize local parameter array */
 	arguments[0] = v1;
@@ -1831,6 +2037,10 @@ SearchCatCacheList(CatCache *cache,
 		 */
 		dlist_move_head(lbucket, &cl->cache_elem);
 
+		/* The members are in use, too, as far as eviction is concerned */
+		for (i = 0; i < cl->n_members; i++)
+			CatCacheTouch(cl->members[i]);
+
 		/* Bump the list's refcount and return it */
 		ResourceOwnerEnlarge(CurrentResourceOwner);
 		cl->refcount++;
@@ -1839,9 +2049,7 @@ SearchCatCacheList(CatCache *cache,
 		CACHE_elog(DEBUG2, "SearchCatCacheList(%s): found list",
 				   cache->cc_relname);
 
-#ifdef CATCACHE_STATS
 		cache->cc_lhits++;
-#endif
 
 		return cl;
 	}
@@ -2267,9 +2475,13 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, Datum *arguments,
 	ct->hash_value = hashValue;
 
 	dlist_push_head(&cache->cc_bucket[hashIndex], &ct->cache_elem);
+	dlist_push_head(&CacheHdr->ch_lru, &ct->lru_elem);
+	ct->lastused = CacheAccessTick();
 
 	cache->cc_ntup++;
 	CacheHdr->ch_ntup++;
+	cache->cc_memory += GetMemoryChunkSpace(ct);
+	CacheHdr->ch_memory += GetMemoryChunkSpace(ct);
 
 	/*
 	 * If the hash table has become too full, enlarge the buckets array. Quite
@@ -130,6 +130,7 @@
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/relmapper.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -1222,9 +1223,16 @@ AtEOXact_Inval(bool isCommit)
 		AppendInvalidationMessages(&transInvalInfo->PriorCmdInvalidMsgs,
 								   &transInvalInfo->ii.CurrentCmdInvalidMsgs);
 
+		/* Shared plans must be gone before anyone hears of the change */
+		SharedPlanCacheBeginInvalidation();
+		ProcessInvalidationMessagesMulti(&transInvalInfo->PriorCmdInvalidMsgs,
+										 SharedPlanCacheInvalidate);
+
 		ProcessInvalidationMessagesMulti(&transInvalInfo->PriorCmdInvalidMsgs,
 										 SendSharedInvalidMessages);
 
+		SharedPlanCacheEndInvalidation();
+
 		if (transInvalInfo->ii.RelcacheInitFileInval)
 			RelationCacheInitFilePostInvalidate();
 	}
@@ -1238,6 +1246,18 @@ AtEOXact_Inval(bool isCommit)
 	transInvalInfo = NULL;
 }
 
+/*
+ * CacheInvalidationPending
+ *		Has the current transaction queued any transactional invalidation?
+ *
+ * If so, it has modified catalogs in ways other sessions can't see yet.
+ */
+bool
+CacheInvalidationPending(void)
+{
+	return transInvalInfo != NULL;
+}
+
 /*
  * PreInplace_Inval
  *		Process queued-up invalidation before inplace update critical section.
@@ -58,6 +58,7 @@
 
 #include "access/transam.h"
 #include "catalog/namespace.h"
+#include "executor/execPartition.h"
 #include "executor/executor.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
@@ -67,10 +68,12 @@
 #include "storage/lmgr.h"
 #include "tcop/pquery.h"
 #include "tcop/utility.h"
+#include "utils/cachemem.h"
 #include "utils/inval.h"
 #include "utils/memutils.h"
 #include "utils/resowner.h"
 #include "utils/rls.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -83,6 +86,17 @@
  */
 static dlist_head saved_plan_list = DLIST_STATIC_INIT(saved_plan_list);
 
+/*
+ * The list is kept in LRU order, most recently used first.  The memory of
+ * the saved plans' generic plans is tracked so that they can be released
+ * when catalog_cache_memory_limit is exceeded.
+ */
+static Size PlanCacheMemoryUsed = 0;
+static uint64 PlanCacheSearches = 0;
+static uint64 PlanCacheHits = 0;
+static uint64 PlanCacheLoads = 0;
+static uint64 PlanCacheEvictions = 0;
+
 /*
  * This is the head of the backend's list of CachedExpressions.
  */
@@ -93,14 +107,18 @@ static bool StmtPlanRequiresRevalidation(CachedPlanSource *plansource);
 static bool BuildingPlanRequiresSnapshot(CachedPlanSource *plansource);
 static List *RevalidateCachedQuery(CachedPlanSource *plansource,
 								   QueryEnvironment *queryEnv);
-static bool CheckCachedPlan(CachedPlanSource *plansource);
+static bool CheckCachedPlan(CachedPlanSource *plansource,
+							ParamListInfo boundParams);
 static CachedPlan *BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 								   ParamListInfo boundParams, QueryEnvironment *queryEnv);
 static bool choose_custom_plan(CachedPlanSource *plansource,
 							   ParamListInfo boundParams);
 static double cached_plan_cost(CachedPlan *plan, bool include_planner);
 static Query *QueryListGetPrimaryStmt(List *stmts);
-static void AcquireExecutorLocks(List *stmt_list, bool acquire);
+static void AcquireExecutorLocks(CachedPlan *plan, bool acquire,
+								 ParamListInfo boundParams);
+static void LockUnprunedPartitions(PlannedStmt *plannedstmt,
+								   ParamListInfo boundParams);
 static void AcquirePlannerLocks(List *stmt_list, bool acquire);
 static void ScanQueryForLocks(Query *parsetree, bool acquire);
 static bool ScanQueryWalker(Node *node, bool *acquire);
@@ -153,6 +171,8 @@ InitPlanCache(void)
 	CacheRegisterSyscacheCallback(AMOPOPID, PlanCacheSysCallback, (Datum) 0);
 	CacheRegisterSyscacheCallback(FOREIGNSERVEROID, PlanCacheSysCallback, (Datum) 0);
 	CacheRegisterSyscacheCallback(FOREIGNDATAWRAPPEROID, PlanCacheSysCallback, (Datum) 0);
+
+	SharedPlanCacheAttach();
 }
 
 /*
@@ -238,6 +258,8 @@ CreateCachedPlan(RawStmt *raw_parse_tree,
 	plansource->is_saved = false;
 	plansource->is_valid = false;
 	plansource->generation = 0;
+	plansource->last_used = 0;
+	plansource->gplan_memory = 0;
 	plansource->generic_cost = -1;
 	plansource->total_custom_cost = 0;
 	plansource->num_generic_plans = 0;
@@ -337,6 +359,8 @@ CreateOneShotCachedPlan(RawStmt *raw_parse_tree,
 	plansource->is_saved = false;
 	plansource->is_valid = false;
 	plansource->generation = 0;
+	plansource->last_used = 0;
+	plansource->gplan_memory = 0;
 	plansource->generic_cost = -1;
 	plansource->total_custom_cost = 0;
 	plansource->num_generic_plans = 0;
@@ -572,7 +596,8 @@ SaveCachedPlan(CachedPlanSource *plansource)
 	/*
 	 * Add the entry to the global list of cached plans.
 	 */
-	dlist_push_tail(&saved_plan_list, &plansource->node);
+	dlist_push_head(&saved_plan_list, &plansource->node);
+	plansource->last_used = CacheAccessTick();
 
 	plansource->is_saved = true;
 }
@@ -624,10 +649,91 @@ ReleaseGenericPlan(CachedPlanSource *plansource)
 
 		Assert(plan->magic == CACHEDPLAN_MAGIC);
 		plansource->gplan = NULL;
+		PlanCacheMemoryUsed -= plansource->gplan_memory;
+		plansource->gplan_memory = 0;
 		ReleaseCachedPlan(plan, NULL);
 	}
 }
 
+/*
+ * Find the least recently used saved plan whose generic plan is not in use
+ * by anyone else.
+ */
+static CachedPlanSource *
+PlanCacheOldestEvictable(void)
+{
+	dlist_iter	iter;
+
+	dlist_reverse_foreach(iter, &saved_plan_list)
+	{
+		CachedPlanSource *plansource = dlist_container(CachedPlanSource,
+													   node, iter.cur);
+
+		if (plansource->gplan && plansource->gplan->refcount == 1)
+			return plansource;
+	}
+	return NULL;
+}
+
+/*
+ * PlanCacheMemory: memory used by the generic plans of saved plans.
+ */
+Size
+PlanCacheMemory(void)
+{
+	return PlanCacheMemoryUsed;
+}
+
+/*
+ * PlanCacheOldestUse: last use tick of the least recently used saved plan
+ * having an evictable generic plan, or 0 if there is none.
+ */
+uint64
+PlanCacheOldestUse(void)
+{
+	CachedPlanSource *plansource = PlanCacheOldestEvictable();
+
+	return plansource ? plansource->last_used : 0;
+}
+
+/*
+ * PlanCacheEvictOldest: release the generic plan of the least recently used
+ * saved plan.  The CachedPlanSource itself stays, so the only cost is that
+ * the plan will have to be rebuilt when it's next needed.
+ */
+void
+PlanCacheEvictOldest(void)
+{
+	CachedPlanSource *plansource = PlanCacheOldestEvictable();
+
+	if (plansource == NULL)
+		return;
+
+	PlanCacheEvictions++;
+	ReleaseGenericPlan(plansource);
+}
+
+/*
+ * PlanCacheGetStats: fill in statistics for pg_backend_cache_stats.
+ */
+void
+PlanCacheGetStats(CacheStatsEntry *stats)
+{
+	dlist_iter	iter;
+
+	memset(stats, 0, sizeof(CacheStatsEntry));
+	stats->cache = "plancache";
+	stats->cacheId = -1;
+	stats->relid = InvalidOid;
+	dlist_foreach(iter, &saved_plan_list)
+		stats->entries++;
+	stats->memory = PlanCacheMemoryUsed;
+	stats->searches = PlanCacheSearches;
+	stats->hits = PlanCacheHits;
+	stats->loads = PlanCacheLoads;
+	stats->evictions = PlanCacheEvictions;
+}
+
 /*
  * We must skip "overhead" operations that involve database access when the
  * cached plan's subject statement is a transaction control command or one
@@ -947,7 +1053,7 @@ RevalidateCachedQuery(CachedPlanSource *plansource,
  * (We must do this for the "true" result to be race-condition-free.)
  */
 static bool
-CheckCachedPlan(CachedPlanSource *plansource)
+CheckCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams)
 {
 	CachedPlan *plan = plansource->gplan;
 
@@ -981,7 +1087,7 @@ CheckCachedPlan(CachedPlanSource *plansource)
 		 */
 		Assert(plan->refcount > 0);
 
-		AcquireExecutorLocks(plan->stmt_list, true);
+		AcquireExecutorLocks(plan, true, boundParams);
 
 		/*
 		 * If plan was transient, check to see if TransactionXmin has
@@ -1003,7 +1109,7 @@ CheckCachedPlan(CachedPlanSource *plansource)
 		}
 
 		/* Oops, the race case happened.  Release useless locks. */
-		AcquireExecutorLocks(plan->stmt_list, false);
+		AcquireExecutorLocks(plan, false, boundParams);
 	}
 
 	/*
@@ -1041,6 +1147,17 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	MemoryContext plan_context;
 	MemoryContext oldcxt = CurrentMemoryContext;
 	ListCell   *lc;
+	bool		shared;
+	uint64		shared_generation = 0;
+
+	/*
+	 * Generic plans of saved statements may be shared with other sessions
+	 * through the shared plan cache.  This must be set up before we check
+	 * the querytree, since it may process pending invalidations.
+	 */
+	shared = boundParams == NULL && SharedPlanCacheEligible(plansource);
+	if (shared)
+		shared_generation = SharedPlanCacheStartBuild();
 
 	/*
 	 * Normally the querytree should be valid already, but if it's not,
@@ -1072,26 +1189,39 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	}
 
 	/*
-	 * If a snapshot is already set (the normal case), we can just use that
-	 * for planning.  But if it isn't, and we need one, install one.
+	 * Use the plan another session built for the same statement, if any.
 	 */
-	snapshot_set = false;
-	if (!ActiveSnapshotSet() &&
-		BuildingPlanRequiresSnapshot(plansource))
+	plist = NIL;
+	if (shared)
+		plist = SharedPlanCacheLookup(plansource);
+
+	if (plist == NIL)
 	{
-		PushActiveSnapshot(GetTransactionSnapshot());
-		snapshot_set = true;
-	}
+		/*
+		 * If a snapshot is already set (the normal case), we can just use
+		 * that for planning.  But if it isn't, and we need one, install one.
+		 */
+		snapshot_set = false;
+		if (!ActiveSnapshotSet() &&
+			BuildingPlanRequiresSnapshot(plansource))
+		{
+			PushActiveSnapshot(GetTransactionSnapshot());
+			snapshot_set = true;
+		}
 
-	/*
-	 * Generate the plan.
-	 */
-	plist = pg_plan_queries(qlist, plansource->query_string,
-							plansource->cursor_options, boundParams);
+		/*
+		 * Generate the plan.
+		 */
+		plist = pg_plan_queries(qlist, plansource->query_string,
+								plansource->cursor_options, boundParams);
 
-	/* Release snapshot if we got one */
-	if (snapshot_set)
-		PopActiveSnapshot();
+		/* Release snapshot if we got one */
+		if (snapshot_set)
+			PopActiveSnapshot();
+
+		if (shared)
+			SharedPlanCacheInsert(plansource, plist, shared_generation);
+	}
 
 	/*
 	 * Normally we make a dedicated memory context for the CachedPlan and its
@@ -1155,6 +1285,7 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	plan->is_oneshot = plansource->is_oneshot;
 	plan->is_saved = false;
 	plan->is_valid = true;
+	plan->execstate = NULL;
 
 	/* assign generation number to new plan */
 	plan->generation = ++(plansource->generation);
@@ -1310,16 +1441,26 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 	/* Make sure the querytree list is valid and we have parse-time locks */
 	qlist = RevalidateCachedQuery(plansource, queryEnv);
 
+	/* Keep the list of saved plans in LRU order */
+	if (plansource->is_saved)
+	{
+		dlist_move_head(&saved_plan_list, &plansource->node);
+		plansource->last_used = CacheAccessTick();
+		PlanCacheSearches++;
+	}
+
 	/* Decide whether to use a custom plan */
 	customplan = choose_custom_plan(plansource, boundParams);
 
 	if (!customplan)
 	{
-		if (CheckCachedPlan(plansource))
+		if (CheckCachedPlan(plansource, boundParams))
 		{
 			/* We want a generic plan, and we already have a valid one */
 			plan = plansource->gplan;
 			Assert(plan->magic == CACHEDPLAN_MAGIC);
+			if (plansource->is_saved)
+				PlanCacheHits++;
 		}
 		else
 		{
@@ -1336,6 +1477,10 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 				/* saved plans all live under CacheMemoryContext */
 				MemoryContextSetParent(plan->context, CacheMemoryContext);
 				plan->is_saved = true;
+				plansource->gplan_memory =
+					MemoryContextMemAllocated(plan->context, true);
+				PlanCacheMemoryUsed += plansource->gplan_memory;
+				PlanCacheLoads++;
 			}
 			else
 			{
@@ -1370,6 +1515,8 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 	{
 		/* Build a custom plan */
 		plan = BuildCachedPlan(plansource, qlist, boundParams, queryEnv);
+		if (plansource->is_saved)
+			PlanCacheLoads++;
 		/* Accumulate total costs of custom plans */
 		plansource->total_custom_cost += cached_plan_cost(plan, true);
 
@@ -1740,6 +1887,8 @@ CopyCachedPlan(CachedPlanSource *plansource)
 	newsource->is_saved = false;
 	newsource->is_valid = plansource->is_valid;
 	newsource->generation = plansource->generation;
+	newsource->last_used = 0;
+	newsource->gplan_memory = 0;
 
 	/* We may as well copy any acquired cost knowledge */
 	newsource->generic_cost = plansource->generic_cost;
@@ -1904,15 +2053,26 @@ QueryListGetPrimaryStmt(List *stmts)
 /*
  * AcquireExecutorLocks: acquire locks needed for execution of a cached plan;
  * or release them if acquire is false.
+ *
+ * For statements with initial partition pruning steps, leaf partitions that
+ * are pruned away for the given boundParams are never locked, which matters
+ * for generic plans over many partitions.  We first lock the unprunable
+ * relations (which include all partitioned tables), and then let initial
+ * pruning lock whichever partitions survive.  When releasing, only the
+ * unprunable relations of such statements are unlocked; any surviving
+ * partitions stay locked until end of transaction, which is harmless in the
+ * rare race case that needs to release.
  */
 static void
-AcquireExecutorLocks(List *stmt_list, bool acquire)
+AcquireExecutorLocks(CachedPlan *plan, bool acquire, ParamListInfo boundParams)
 {
 	ListCell   *lc1;
 
-	foreach(lc1, stmt_list)
+	foreach(lc1, plan->stmt_list)
 	{
 		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc1);
+		bool		prune_locks;
+		Index		rti;
 		ListCell   *lc2;
 
 		if (plannedstmt->commandType == CMD_UTILITY)
@@ -1931,14 +2091,29 @@ AcquireExecutorLocks(List *stmt_list, bool acquire)
 			continue;
 		}
 
+		/*
+		 * Pruning expressions may call stable functions, so we can only do
+		 * this when the caller has set up a snapshot.  This must give the
+		 * same answer for the acquire and the release call.
+		 */
+		prune_locks = plannedstmt->partPruneInfos != NIL && ActiveSnapshotSet();
+
+		rti = 0;
 		foreach(lc2, plannedstmt->rtable)
 		{
 			RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc2);
 
+			rti++;
+
 			if (!(rte->rtekind == RTE_RELATION ||
 				  (rte->rtekind == RTE_SUBQUERY && OidIsValid(rte->relid))))
 				continue;
 
+			/* Partitions subject to initial pruning are handled below */
+			if (prune_locks &&
+				!bms_is_member(rti, plannedstmt->unprunableRelids))
+				continue;
+
 			/*
 			 * Acquire the appropriate type of lock on each relation OID. Note
 			 * that we don't actually try to open the rel, and hence will not
@@ -1950,9 +2125,46 @@ AcquireExecutorLocks(List *stmt_list, bool acquire)
 			else
 				UnlockRelationOid(rte->relid, rte->rellockmode);
 		}
+
+		/*
+		 * Don't bother pruning if locking the unprunable relations has
+		 * already invalidated the plan; the pruning info may be stale, and
+		 * the caller is going to throw the plan away anyway.
+		 */
+		if (prune_locks && acquire && plan->is_valid)
+			LockUnprunedPartitions(plannedstmt, boundParams);
 	}
 }
 
+/*
+ * LockUnprunedPartitions: run the initial pruning steps of a planned
+ * statement and lock the partitions that survive.
+ *
+ * This uses a throwaway EState; ExecDoInitialPruning takes the locks for
+ * us.  The executor will repeat the pruning when the plan is started.
+ */
+static void
+LockUnprunedPartitions(PlannedStmt *plannedstmt, ParamListInfo boundParams)
+{
+	EState	   *estate;
+	MemoryContext oldcxt;
+
+	estate = CreateExecutorState();
+	oldcxt = MemoryContextSwitchTo(estate->es_query_cxt);
+
+	ExecInitRangeTable(estate, plannedstmt->rtable, plannedstmt->permInfos,
+					   bms_copy(plannedstmt->unprunableRelids));
+	estate->es_param_list_info = boundParams;
+	estate->es_part_prune_infos = plannedstmt->partPruneInfos;
+
+	ExecDoInitialPruning(estate);
+
+	MemoryContextSwitchTo(oldcxt);
+
+	ExecCloseRangeTableRelations(estate);
+	FreeExecutorState(estate);
+}
+
 /*
  * AcquirePlannerLocks: acquire locks needed for planning of a querytree list;
  * or release them if acquire is false.
@@ -41,6 +41,7 @@
 #include "access/xact.h"
 #include "catalog/binary_upgrade.h"
 #include "catalog/catalog.h"
+#include "catalog/globaltemp.h"
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
 #include "catalog/partition.h"
@@ -79,6 +80,7 @@
 #include "storage/smgr.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/cachemem.h"
 #include "utils/catcache.h"
 #include "utils/datum.h"
 #include "utils/fmgroids.h"
@@ -203,6 +205,18 @@ static TupleDesc *EOXactTupleDescArray;
 static int	NextEOXactTupleDescNum = 0;
 static int	EOXactTupleDescArrayLen = 0;
 
+/*
+ * Entries built by RelationBuildDesc(), most recently used first, and their
+ * estimated total memory.  Also some statistics; see RelationCacheGetStats().
+ */
+static dlist_head RelationCacheLRU = DLIST_STATIC_INIT(RelationCacheLRU);
+static Size RelationCacheMemoryUsed = 0;
+static uint64 RelationCacheSearches = 0;
+static uint64 RelationCacheHits = 0;
+static uint64 RelationCacheLoads = 0;
+static uint64 RelationCacheInvals = 0;
+static uint64 RelationCacheEvictions = 0;
+
 /*
  *		macros to manipulate the lookup hashtable
  */
@@ -275,6 +289,8 @@ static HTAB *OpClassCache = NULL;
 
 static void RelationCloseCleanup(Relation relation);
 static void RelationDestroyRelation(Relation relation, bool remember_tupdesc);
+static Size RelationCacheEntrySize(Relation relation);
+static bool RelationCacheEvictable(Relation relation);
 static void RelationInvalidateRelation(Relation relation);
 static void RelationClearRelation(Relation relation);
 static void RelationRebuildRelation(Relation relation);
@@ -1165,6 +1181,11 @@ retry:
 			relation->rd_backend = INVALID_PROC_NUMBER;
 			relation->rd_islocaltemp = false;
 			break;
+		case RELPERSISTENCE_GLOBAL_TEMP:
+			/* every session has its own storage for the relation */
+			relation->rd_backend = ProcNumberForTempRelations();
+			relation->rd_islocaltemp = true;
+			break;
 		case RELPERSISTENCE_TEMP:
 			if (isTempOrTempToastNamespace(relation->rd_rel->relnamespace))
 			{
@@ -1242,7 +1263,7 @@ retry:
 	RelationParseRelOptions(relation, pg_class_tuple);
 
 	/*
-	 * Fetch rules and triggers that affect this relation.
+	 * Fetch rules that affect this relation.
 	 *
 	 * Note that RelationBuildRuleLock() relies on this being done after
 	 * extracting the relation's reloptions.
@@ -1255,10 +1276,9 @@ retry:
 		relation->rd_rulescxt = NULL;
 	}
 
-	if (relation->rd_rel->relhastriggers)
-		RelationBuildTriggers(relation);
-	else
-		relation->trigdesc = NULL;
+	/* triggers are not loaded till asked for */
+	relation->trigdesc = NULL;
+	relation->rd_trigvalid = false;
 
 	if (relation->rd_rel->relrowsecurity)
 		RelationBuildRowSecurity(relation);
@@ -1311,8 +1331,16 @@ retry:
 	 * we'll elog a WARNING and leak the already-present entry.
 	 */
 	if (insertIt)
+	{
 		RelationCacheInsert(relation, true);
 
+		/* Make it subject to eviction */
+		relation->rd_cachemem = RelationCacheEntrySize(relation);
+		RelationCacheMemoryUsed += relation->rd_cachemem;
+		dlist_push_head(&RelationCacheLRU, &relation->rd_lru);
+		relation->rd_lastused = CacheAccessTick();
+	}
+
 	/* It's fully valid */
 	relation->rd_isvalid = true;
 
@@ -1386,6 +1414,12 @@ RelationInitPhysicalAddr(Relation relation)
 		}
 
 		relation->rd_locator.relNumber = relation->rd_rel->relfilenode;
+
+		/* this session may have replaced its storage of a global temp rel */
+		if (relation->rd_rel->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+			relation->rd_locator.relNumber =
+				GlobalTempMapRelFileNumber(relation->rd_id,
+										   relation->rd_rel->relfilenode);
 	}
 	else
 	{
@@ -2102,6 +2136,8 @@ RelationIdGetRelation(Oid relationId)
 
 	AssertCouldGetRelation();
 
+	RelationCacheSearches++;
+
 	/*
 	 * first try to find reldesc in the cache
 	 */
@@ -2116,6 +2152,13 @@ RelationIdGetRelation(Oid relationId)
 			return NULL;
 		}
 
+		RelationCacheHits++;
+		if (!dlist_node_is_detached(&rd->rd_lru))
+		{
+			dlist_move_head(&RelationCacheLRU, &rd->rd_lru);
+			rd->rd_lastused = CacheAccessTick();
+		}
+
 		RelationIncrementReferenceCount(rd);
 		/* revalidate cache entry if necessary */
 		if (!rd->rd_isvalid)
@@ -2141,7 +2184,10 @@ RelationIdGetRelation(Oid relationId)
 	 */
 	rd = RelationBuildDesc(relationId, true);
 	if (RelationIsValid(rd))
+	{
+		RelationCacheLoads++;
 		RelationIncrementReferenceCount(rd);
+	}
 	return rd;
 }
 
@@ -2440,6 +2486,12 @@ RelationDestroyRelation(Relation relation, bool remember_tupdesc)
 {
 	Assert(RelationHasReferenceCountZero(relation));
 
+	if (!dlist_node_is_detached(&relation->rd_lru))
+	{
+		dlist_delete_thoroughly(&relation->rd_lru);
+		RelationCacheMemoryUsed -= relation->rd_cachemem;
+	}
+
 	/*
 	 * Make sure smgr and lower levels close the relation's files, if they
 	 * weren't closed already.  (This was probably done by caller, but let's
@@ -2758,6 +2810,10 @@ RelationRebuildRelation(Relation relation)
 		/* pgstat_info / enabled must be preserved */
 		SWAPFIELD(struct PgStat_TableStatus *, pgstat_info);
 		SWAPFIELD(bool, pgstat_enabled);
+		/* LRU list membership must be preserved */
+		SWAPFIELD(dlist_node, rd_lru);
+		SWAPFIELD(uint64, rd_lastused);
+		SWAPFIELD(Size, rd_cachemem);
 		/* preserve old partition key if we have one */
 		if (keep_partkey)
 		{
@@ -2826,6 +2882,8 @@ RelationRebuildRelation(Relation relation)
 static void
 RelationFlushRelation(Relation relation)
 {
+	RelationCacheInvals++;
+
 	if (relation->rd_createSubid != InvalidSubTransactionId ||
 		relation->rd_firstRelfilelocatorSubid != InvalidSubTransactionId)
 	{
@@ -3367,6 +3425,136 @@ AtEOXact_cleanup(Relation relation, bool isCommit)
 	}
 }
 
+/*
+ * RelationCacheEntrySize
+ *
+ *	Estimate the memory used by a relcache entry.  The private memory contexts
+ *	are counted exactly, but other substructures allocated in
+ *	CacheMemoryContext, like the index lists and statistics, are not.
+ */
+static Size
+RelationCacheEntrySize(Relation relation)
+{
+	Size		size;
+
+	size = GetMemoryChunkSpace(relation) +
+		GetMemoryChunkSpace(relation->rd_rel) +
+		GetMemoryChunkSpace(relation->rd_att);
+
+	if (relation->rd_indexcxt)
+		size += MemoryContextMemAllocated(relation->rd_indexcxt, true);
+	if (relation->rd_rulescxt)
+		size += MemoryContextMemAllocated(relation->rd_rulescxt, true);
+	if (relation->rd_rsdesc)
+		size += MemoryContextMemAllocated(relation->rd_rsdesc->rscxt, true);
+	if (relation->rd_partkeycxt)
+		size += MemoryContextMemAllocated(relation->rd_partkeycxt, true);
+	if (relation->rd_pdcxt)
+		size += MemoryContextMemAllocated(relation->rd_pdcxt, true);
+	if (relation->rd_pddcxt)
+		size += MemoryContextMemAllocated(relation->rd_pddcxt, true);
+	if (relation->rd_partcheckcxt)
+		size += MemoryContextMemAllocated(relation->rd_partcheckcxt, true);
+
+	return size;
+}
+
+/*
+ * Can the entry be thrown away without anyone noticing?  The conditions are
+ * the same under which RelationFlushRelation() would remove it.
+ */
+static bool
+RelationCacheEvictable(Relation relation)
+{
+	return RelationHasReferenceCountZero(relation) &&
+		!relation->rd_isnailed &&
+		relation->rd_createSubid == InvalidSubTransactionId &&
+		relation->rd_firstRelfilelocatorSubid == InvalidSubTransactionId &&
+		relation->rd_droppedSubid == InvalidSubTransactionId;
+}
+
+static Relation
+RelationCacheOldestEvictable(void)
+{
+	dlist_iter	iter;
+
+	dlist_reverse_foreach(iter, &RelationCacheLRU)
+	{
+		Relation	relation = dlist_container(RelationData, rd_lru, iter.cur);
+
+		if (RelationCacheEvictable(relation))
+			return relation;
+	}
+	return NULL;
+}
+
+/*
+ * RelationCacheMemory
+ *
+ *	Estimated memory used by the relcache entries that are subject to
+ *	eviction.
+ */
+Size
+RelationCacheMemory(void)
+{
+	return RelationCacheMemoryUsed;
+}
+
+/*
+ * RelationCacheOldestUse
+ *
+ *	Return the last use tick of the least recently used evictable entry, or 0
+ *	if there is none.
+ */
+uint64
+RelationCacheOldestUse(void)
+{
+	Relation	relation = RelationCacheOldestEvictable();
+
+	return relation ? relation->rd_lastused : 0;
+}
+
+/*
+ * RelationCacheEvictOldest
+ *
+ *	Remove the least recently used evictable entry.  This must only be
+ *	called outside a transaction's use of the relcache, i.e. at transaction
+ *	end, since callers may hold Relation pointers without a reference count
+ *	for the duration of a command.
+ */
+void
+RelationCacheEvictOldest(void)
+{
+	Relation	relation = RelationCacheOldestEvictable();
+
+	if (relation == NULL)
+		return;
+
+	RelationCacheEvictions++;
+	RelationClearRelation(relation);
+}
+
+/*
+ * RelationCacheGetStats
+ *
+ *	Fill in statistics about the relcache for pg_backend_cache_stats.
+ */
+void
+RelationCacheGetStats(CacheStatsEntry *stats)
+{
+	memset(stats, 0, sizeof(CacheStatsEntry));
+	stats->cache = "relcache";
+	stats->cacheId = -1;
+	stats->relid = InvalidOid;
+	stats->entries = hash_get_num_entries(RelationIdCache);
+	stats->memory = RelationCacheMemoryUsed;
+	stats->searches = RelationCacheSearches;
+	stats->hits = RelationCacheHits;
+	stats->loads = RelationCacheLoads;
+	stats->invals = RelationCacheInvals;
+	stats->evictions = RelationCacheEvictions;
+}
+
 /*
  * AtEOSubXact_RelationCache
  *
@@ -3661,6 +3849,10 @@ RelationBuildLocalRelation(const char *relname,
 			rel->rd_backend = ProcNumberForTempRelations();
 			rel->rd_islocaltemp = true;
 			break;
+		case RELPERSISTENCE_GLOBAL_TEMP:
+			rel->rd_backend = ProcNumberForTempRelations();
+			rel->rd_islocaltemp = true;
+			break;
 		default:
 			elog(ERROR, "invalid relpersistence: %c", relpersistence);
 			break;
@@ -3781,6 +3973,18 @@ RelationSetNewRelfilenumber(Relation relation, char persistence)
 	TransactionId freezeXid = InvalidTransactionId;
 	RelFileLocator newrlocator;
 
+	/*
+	 * The relfilenumber of a global temporary relation is shared by all
+	 * sessions, so leave pg_class alone and give just this session's contents
+	 * new storage.
+	 */
+	if (RelationIsGlobalTemp(relation))
+	{
+		Assert(persistence == RELPERSISTENCE_GLOBAL_TEMP);
+		GlobalTempRelationSetNewRelfilenumber(relation);
+		return;
+	}
+
 	if (!IsBinaryUpgrade)
 	{
 		/* Allocate a new relfilenumber */
@@ -4306,10 +4510,11 @@ RelationCacheInitializePhase3(void)
 		/*
 		 * Fix data that isn't saved in relcache cache file.
 		 *
-		 * relhasrules or relhastriggers could possibly be wrong or out of
-		 * date.  If we don't actually find any rules or triggers, clear the
-		 * local copy of the flag so that we don't get into an infinite loop
-		 * here.  We don't make any attempt to fix the pg_class entry, though.
+		 * relhasrules could possibly be wrong or out of date.  If we don't
+		 * actually find any rules, clear the local copy of the flag so that
+		 * we don't get into an infinite loop here.  We don't make any attempt
+		 * to fix the pg_class entry, though.  Triggers are loaded on demand
+		 * by RelationGetTriggerDesc, so there's nothing to do for them.
 		 */
 		if (relation->rd_rel->relhasrules && relation->rd_rules == NULL)
 		{
@@ -4318,13 +4523,6 @@ RelationCacheInitializePhase3(void)
 				relation->rd_rel->relhasrules = false;
 			restart = true;
 		}
-		if (relation->rd_rel->relhastriggers && relation->trigdesc == NULL)
-		{
-			RelationBuildTriggers(relation);
-			if (relation->trigdesc == NULL)
-				relation->rd_rel->relhastriggers = false;
-			restart = true;
-		}
 
 		/*
 		 * Re-load the row security policies if the relation has them, since
@@ -4713,6 +4911,33 @@ CheckConstraintCmp(const void *a, const void *b)
 	return strcmp(ca->ccname, cb->ccname);
 }
 
+/*
+ * RelationGetTriggerDesc -- get the trigger info for the relation
+ *
+ * Returns NULL if the relation has no triggers.  The TriggerDesc is loaded
+ * from pg_trigger the first time it's asked for, rather than when the
+ * relcache entry is built, since many relations are opened without ever
+ * firing a trigger; with many partitions that would be a lot of wasted
+ * pg_trigger scans.
+ *
+ * CAUTION: the returned struct is part of the relcache's data, and could
+ * vanish in a relcache entry reset.  Callers that need it across catalog
+ * accesses should copy it with CopyTriggerDesc().
+ */
+TriggerDesc *
+RelationGetTriggerDesc(Relation relation)
+{
+	/* Quick exit if we already loaded it. */
+	if (relation->rd_trigvalid)
+		return relation->trigdesc;
+
+	if (relation->rd_rel->relhastriggers)
+		RelationBuildTriggers(relation);
+	relation->rd_trigvalid = true;
+
+	return relation->trigdesc;
+}
+
 /*
  * RelationGetFKeyList -- get a list of foreign key info for the relation
  *
@@ -6452,6 +6677,7 @@ load_relcache_init_file(bool shared)
 		rel->rd_rules = NULL;
 		rel->rd_rulescxt = NULL;
 		rel->trigdesc = NULL;
+		rel->rd_trigvalid = false;
 		rel->rd_rsdesc = NULL;
 		rel->rd_partkey = NULL;
 		rel->rd_partkeycxt = NULL;
@@ -6497,6 +6723,9 @@ load_relcache_init_file(bool shared)
 		rel->rd_droppedSubid = InvalidSubTransactionId;
 		rel->rd_amcache = NULL;
 		rel->pgstat_info = NULL;
+		dlist_node_init(&rel->rd_lru);
+		rel->rd_lastused = 0;
+		rel->rd_cachemem = 0;
 
 		/*
 		 * Recompute lock and physical addressing info.  This is needed in
@@ -0,0 +1,535 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.c
+ *	  Cluster-wide cache of catalog tuples in shared memory.
+ *
+ * Every backend has its own catalog caches (see catcache.c), which it fills
+ * by scanning the catalogs.  With many sessions, all of them load the same
+ * pg_class, pg_attribute etc. rows over and over again.  When
+ * shared_catalog_cache_size is set, the tuples that backends load into their
+ * catalog caches are also stored in shared memory, from which other backends
+ * can copy them without scanning the catalogs.  Only the tuples of
+ * single-row lookups are shared; lists and negative entries are kept in the
+ * backend-local caches alone.
+ *
+ * Entries are keyed by database, cache ID and the hash value of the cache
+ * keys, the same information that catcache invalidation messages carry.
+ * Since different keys can hash to the same value, catcache.c compares the
+ * keys of a shared tuple before using it.  The hash table lives in the main
+ * shared memory segment, and the tuples themselves in a DSA area of fixed
+ * size that is created in place right behind our control struct.  When
+ * either one is full, we throw away an eighth of the entries.
+ *
+ * Each invalidation message is applied to the shared cache by the process
+ * sending it, before it is put in the sinval queue, so that no backend can
+ * read a stale shared tuple after it has processed the message.  To stop
+ * concurrent backends from inserting tuples that they read before the
+ * change, every invalidation first advances a generation counter, and an
+ * entry is only inserted if the counter is unchanged since before the
+ * catalog snapshot used to read the tuple was taken.  Since a transaction's
+ * invalidation messages are sent after it has become visible to new
+ * snapshots, this is enough to keep stale tuples out.  That holds for
+ * inplace updates too, which send their messages right after modifying the
+ * tuple.
+ *
+ * Invalidation may happen within a critical section, so nothing on that
+ * path may allocate memory.  That's why we don't use dshash here, and why
+ * the DSA area may not grow beyond its initial segment.  Every backend
+ * attaches to it at startup, in InitCatalogCache().
+ *
+ * Nothing is shared during recovery, nor by backends that have uncommitted
+ * catalog changes of their own or that use historic snapshots for logical
+ * decoding.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedcatcache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "access/xlog.h"
+#include "miscadmin.h"
+#include "port/atomics.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/dsa.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
+#include "utils/sharedcatcache.h"
+#include "utils/snapmgr.h"
+
+#define NUM_SHARED_CATCACHE_PARTITIONS	16
+
+/* Bytes of tuple storage per hash table entry */
+#define SHARED_CATCACHE_BYTES_PER_ENTRY	256
+
+/* Larger tuples are only cached locally */
+#define SHARED_CATCACHE_MAX_TUPLE	BLCKSZ
+
+/* Eviction throws away entries whose hash value falls into one of these */
+#define SHARED_CATCACHE_EVICT_SLICES	8
+
+/* GUC parameter */
+int			shared_catalog_cache_size = 0;
+
+/*
+ * Shared state.  The raw DSA area follows directly, after MAXALIGN padding.
+ */
+typedef struct SharedCatCacheControl
+{
+	pg_atomic_uint64 generation;
+	pg_atomic_uint32 evict_clock;
+	LWLockPadded locks[NUM_SHARED_CATCACHE_PARTITIONS];
+} SharedCatCacheControl;
+
+typedef struct SharedCatCacheTag
+{
+	Oid			dbid;			/* database ID, or 0 if a shared catalog */
+	int			cacheId;		/* syscache ID */
+	uint32		hashValue;		/* hash value of the cache keys */
+} SharedCatCacheTag;
+
+typedef struct SharedCatCacheEnt
+{
+	SharedCatCacheTag tag;		/* hash key; must be first */
+	Oid			reloid;			/* catalog the tuple belongs to */
+	ItemPointerData t_self;
+	uint32		t_len;
+	dsa_pointer data;			/* tuple header and data, t_len bytes */
+} SharedCatCacheEnt;
+
+static SharedCatCacheControl *SharedCatCtl = NULL;
+static HTAB *SharedCatCache = NULL;
+static dsa_area *SharedCatCacheArea = NULL;
+
+#define SharedCatCachePartitionLock(hashcode) \
+	(&SharedCatCtl->locks[(hashcode) % NUM_SHARED_CATCACHE_PARTITIONS].lock)
+
+static inline Size
+shared_catcache_area_size(void)
+{
+	return (Size) shared_catalog_cache_size * 1024 * 1024;
+}
+
+static inline int64
+shared_catcache_entries(void)
+{
+	return Min(shared_catcache_area_size() / SHARED_CATCACHE_BYTES_PER_ENTRY,
+			   INT_MAX);
+}
+
+static inline void *
+shared_catcache_raw_area(void)
+{
+	return (char *) SharedCatCtl + MAXALIGN(sizeof(SharedCatCacheControl));
+}
+
+/*
+ * SharedCatCacheShmemSize --- report amount of shared memory space needed
+ */
+Size
+SharedCatCacheShmemSize(void)
+{
+	Size		size = 0;
+
+	if (shared_catalog_cache_size <= 0)
+		return size;
+
+	size = add_size(size, MAXALIGN(sizeof(SharedCatCacheControl)));
+	size = add_size(size, shared_catcache_area_size());
+	size = add_size(size, hash_estimate_size(shared_catcache_entries(),
+											 sizeof(SharedCatCacheEnt)));
+	return size;
+}
+
+/*
+ * SharedCatCacheShmemInit --- initialize the shared catalog cache
+ */
+void
+SharedCatCacheShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+
+	if (shared_catalog_cache_size <= 0)
+		return;
+
+	SharedCatCtl = (SharedCatCacheControl *)
+		ShmemInitStruct("Shared Catalog Cache",
+						add_size(MAXALIGN(sizeof(SharedCatCacheControl)),
+								 shared_catcache_area_size()),
+						&found);
+	if (!found)
+	{
+		dsa_area   *dsa;
+
+		pg_atomic_init_u64(&SharedCatCtl->generation, 1);
+		pg_atomic_init_u32(&SharedCatCtl->evict_clock, 0);
+		for (int i = 0; i < NUM_SHARED_CATCACHE_PARTITIONS; i++)
+			LWLockInitialize(&SharedCatCtl->locks[i].lock,
+							 LWTRANCHE_SHARED_CATCACHE);
+
+		/*
+		 * The area must never need another segment, since attaching to one
+		 * allocates memory; see the comments at the top of the file.
+		 */
+		dsa = dsa_create_in_place(shared_catcache_raw_area(),
+								  shared_catcache_area_size(),
+								  LWTRANCHE_SHARED_CATCACHE_DSA, NULL);
+		dsa_pin(dsa);
+		dsa_set_size_limit(dsa, shared_catcache_area_size());
+		dsa_detach(dsa);
+	}
+
+	info.keysize = sizeof(SharedCatCacheTag);
+	info.entrysize = sizeof(SharedCatCacheEnt);
+	info.num_partitions = NUM_SHARED_CATCACHE_PARTITIONS;
+
+	SharedCatCache = ShmemInitHash("Shared Catalog Cache Hash",
+								   shared_catcache_entries(),
+								   shared_catcache_entries(),
+								   &info,
+								   HASH_ELEM | HASH_BLOBS | HASH_PARTITION |
+								   HASH_FIXED_SIZE);
+}
+
+static void
+shared_catcache_detach(int code, Datum arg)
+{
+	dsa_detach(SharedCatCacheArea);
+	SharedCatCacheArea = NULL;
+
+	/* see pgstat_detach_shmem() */
+	dsa_release_in_place(shared_catcache_raw_area());
+}
+
+/*
+ * Attach to the shared catalog cache.
+ *
+ * This is done at backend startup, rather than on first use, because we
+ * must be able to apply invalidation messages within critical sections.
+ */
+void
+SharedCatCacheAttach(void)
+{
+	MemoryContext oldcontext;
+
+	if (SharedCatCtl == NULL || !IsUnderPostmaster ||
+		SharedCatCacheArea != NULL)
+		return;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	SharedCatCacheArea = dsa_attach_in_place(shared_catcache_raw_area(), NULL);
+	dsa_pin_mapping(SharedCatCacheArea);
+	MemoryContextSwitchTo(oldcontext);
+
+	on_shmem_exit(shared_catcache_detach, (Datum) 0);
+}
+
+/*
+ * Can the shared catalog cache be used right now?
+ */
+bool
+SharedCatCacheUsable(void)
+{
+	if (SharedCatCacheArea == NULL)
+		return false;
+
+	/* We don't see the invalidations replayed from WAL */
+	if (RecoveryInProgress())
+		return false;
+
+	/* Logical decoding reads the catalogs as of the past */
+	if (HistoricSnapshotActive())
+		return false;
+
+	/* Our own uncommitted catalog changes would be visible to us */
+	if (CacheInvalidationPending())
+		return false;
+
+	return true;
+}
+
+static inline uint32
+shared_catcache_tag(SharedCatCacheTag *tag, Oid dbid, int cacheId,
+					uint32 hashValue)
+{
+	tag->dbid = dbid;
+	tag->cacheId = cacheId;
+	tag->hashValue = hashValue;
+
+	return get_hash_value(SharedCatCache, tag);
+}
+
+/*
+ * Look up a catalog tuple in the shared cache.
+ *
+ * Returns a copy of the tuple in CurrentMemoryContext, allocated as a single
+ * chunk, or NULL if there is none.  The caller must check that the tuple's
+ * keys match; only their hash value is compared here.
+ */
+HeapTuple
+SharedCatCacheLookup(Oid dbid, int cacheId, uint32 hashValue)
+{
+	SharedCatCacheTag tag;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	SharedCatCacheEnt *entry;
+	HeapTuple	tuple = NULL;
+
+	hashcode = shared_catcache_tag(&tag, dbid, cacheId, hashValue);
+	partitionLock = SharedCatCachePartitionLock(hashcode);
+
+	LWLockAcquire(partitionLock, LW_SHARED);
+	entry = (SharedCatCacheEnt *)
+		hash_search_with_hash_value(SharedCatCache, &tag, hashcode,
+									HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		tuple = (HeapTuple) palloc(HEAPTUPLESIZE + entry->t_len);
+		tuple->t_len = entry->t_len;
+		tuple->t_self = entry->t_self;
+		tuple->t_tableOid = entry->reloid;
+		tuple->t_data = (HeapTupleHeader) ((char *) tuple + HEAPTUPLESIZE);
+		memcpy(tuple->t_data,
+			   dsa_get_address(SharedCatCacheArea, entry->data),
+			   entry->t_len);
+	}
+	LWLockRelease(partitionLock);
+
+	return tuple;
+}
+
+/*
+ * Prepare to read a catalog tuple that is to be inserted into the shared
+ * cache.
+ *
+ * Returns the generation to pass to SharedCatCacheInsert().  The catalog
+ * snapshot is refreshed, so that the tuple is read with a snapshot that
+ * includes every transaction whose invalidations advanced the generation
+ * so far.
+ */
+uint64
+SharedCatCacheStartLoad(void)
+{
+	uint64		generation;
+
+	generation = pg_atomic_read_u64(&SharedCatCtl->generation);
+	pg_memory_barrier();
+	InvalidateCatalogSnapshot();
+
+	return generation;
+}
+
+/*
+ * Remove the entries of one database, optionally only those of a single
+ * catalog, from the shared cache.
+ */
+static void
+shared_catcache_remove_matching(Oid dbid, Oid reloid)
+{
+	HASH_SEQ_STATUS status;
+	SharedCatCacheEnt *entry;
+
+	for (int i = 0; i < NUM_SHARED_CATCACHE_PARTITIONS; i++)
+		LWLockAcquire(&SharedCatCtl->locks[i].lock, LW_EXCLUSIVE);
+
+	hash_seq_init(&status, SharedCatCache);
+	while ((entry = (SharedCatCacheEnt *) hash_seq_search(&status)) != NULL)
+	{
+		if (entry->tag.dbid != dbid)
+			continue;
+		if (OidIsValid(reloid) && entry->reloid != reloid)
+			continue;
+
+		dsa_free(SharedCatCacheArea, entry->data);
+		hash_search(SharedCatCache, &entry->tag, HASH_REMOVE, NULL);
+	}
+
+	for (int i = NUM_SHARED_CATCACHE_PARTITIONS; --i >= 0;)
+		LWLockRelease(&SharedCatCtl->locks[i].lock);
+}
+
+/*
+ * Make room in the shared cache, by removing all entries whose hash value
+ * falls into the next slice.
+ */
+static void
+shared_catcache_evict(void)
+{
+	HASH_SEQ_STATUS status;
+	SharedCatCacheEnt *entry;
+	uint32		slice;
+
+	slice = pg_atomic_fetch_add_u32(&SharedCatCtl->evict_clock, 1) %
+		SHARED_CATCACHE_EVICT_SLICES;
+
+	for (int i = 0; i < NUM_SHARED_CATCACHE_PARTITIONS; i++)
+		LWLockAcquire(&SharedCatCtl->locks[i].lock, LW_EXCLUSIVE);
+
+	hash_seq_init(&status, SharedCatCache);
+	while ((entry = (SharedCatCacheEnt *) hash_seq_search(&status)) != NULL)
+	{
+		if (entry->tag.hashValue % SHARED_CATCACHE_EVICT_SLICES != slice)
+			continue;
+
+		dsa_free(SharedCatCacheArea, entry->data);
+		hash_search(SharedCatCache, &entry->tag, HASH_REMOVE, NULL);
+	}
+
+	for (int i = NUM_SHARED_CATCACHE_PARTITIONS; --i >= 0;)
+		LWLockRelease(&SharedCatCtl->locks[i].lock);
+}
+
+/*
+ * Offer a catalog tuple, as just loaded into the local catalog cache, to
+ * other backends.  The tuple must not have any out-of-line fields.
+ *
+ * generation is the value SharedCatCacheStartLoad() returned before the
+ * tuple was read.
+ */
+void
+SharedCatCacheInsert(Oid dbid, int cacheId, uint32 hashValue,
+					 HeapTuple tuple, uint64 generation)
+{
+	SharedCatCacheTag tag;
+	uint32		hashcode;
+	LWLock	   *partitionLock;
+	SharedCatCacheEnt *entry = NULL;
+	bool		found = false;
+	dsa_pointer dp;
+
+	Assert(!HeapTupleHasExternal(tuple));
+
+	if (tuple->t_len > SHARED_CATCACHE_MAX_TUPLE)
+		return;
+
+	dp = dsa_allocate_extended(SharedCatCacheArea, tuple->t_len,
+							   DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(dp))
+	{
+		shared_catcache_evict();
+		dp = dsa_allocate_extended(SharedCatCacheArea, tuple->t_len,
+								   DSA_ALLOC_NO_OOM);
+		if (!DsaPointerIsValid(dp))
+			return;
+	}
+	memcpy(dsa_get_address(SharedCatCacheArea, dp), tuple->t_data,
+		   tuple->t_len);
+
+	hashcode = shared_catcache_tag(&tag, dbid, cacheId, hashValue);
+	partitionLock = SharedCatCachePartitionLock(hashcode);
+
+	/*
+	 * Check the generation while holding the partition lock, so that an
+	 * invalidation that advances it after this point is sure to see and
+	 * remove our entry.
+	 */
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	if (pg_atomic_read_u64(&SharedCatCtl->generation) == generation)
+	{
+		entry = (SharedCatCacheEnt *)
+			hash_search_with_hash_value(SharedCatCache, &tag, hashcode,
+										HASH_ENTER_NULL, &found);
+		if (entry != NULL && !found)
+		{
+			entry->reloid = tuple->t_tableOid;
+			entry->t_self = tuple->t_self;
+			entry->t_len = tuple->t_len;
+			entry->data = dp;
+			dp = InvalidDsaPointer;
+		}
+	}
+	else
+		found = true;			/* don't evict anything below */
+	LWLockRelease(partitionLock);
+
+	if (DsaPointerIsValid(dp))
+		dsa_free(SharedCatCacheArea, dp);
+
+	/* If the hash table is full, make room for next time */
+	if (entry == NULL && !found)
+		shared_catcache_evict();
+}
+
+/*
+ * Remove the shared cache entries affected by an array of invalidation
+ * messages.
+ *
+ * This is called by SendSharedInvalidMessages(), possibly within a critical
+ * section, so there must be no memory allocation here.
+ */
+void
+SharedCatCacheInvalidate(const SharedInvalidationMessage *msgs, int n)
+{
+	bool		advanced = false;
+
+	if (SharedCatCacheArea == NULL)
+		return;
+
+	for (int i = 0; i < n; i++)
+	{
+		const SharedInvalidationMessage *msg = &msgs[i];
+
+		if (msg->id < 0 && msg->id != SHAREDINVALCATALOG_ID)
+			continue;
+
+		/* Stop concurrent backends from inserting what they read before */
+		if (!advanced)
+		{
+			pg_atomic_fetch_add_u64(&SharedCatCtl->generation, 1);
+			advanced = true;
+		}
+
+		if (msg->id >= 0)
+		{
+			SharedCatCacheTag tag;
+			uint32		hashcode;
+			LWLock	   *partitionLock;
+			SharedCatCacheEnt *entry;
+			dsa_pointer dp = InvalidDsaPointer;
+
+			hashcode = shared_catcache_tag(&tag, msg->cc.dbId, msg->cc.id,
+										   msg->cc.hashValue);
+			partitionLock = SharedCatCachePartitionLock(hashcode);
+
+			LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+			entry = (SharedCatCacheEnt *)
+				hash_search_with_hash_value(SharedCatCache, &tag, hashcode,
+											HASH_FIND, NULL);
+			if (entry != NULL)
+			{
+				dp = entry->data;
+				hash_search_with_hash_value(SharedCatCache, &tag, hashcode,
+											HASH_REMOVE, NULL);
+			}
+			LWLockRelease(partitionLock);
+
+			if (DsaPointerIsValid(dp))
+				dsa_free(SharedCatCacheArea, dp);
+		}
+		else
+			shared_catcache_remove_matching(msg->cat.dbId, msg->cat.catId);
+	}
+}
+
+/*
+ * Remove all entries of a database that is being dropped, so that they
+ * can't be mistaken for those of a later database with the same OID.
+ */
+void
+SharedCatCacheForgetDatabase(Oid dbid)
+{
+	if (SharedCatCacheArea == NULL)
+		return;
+
+	pg_atomic_fetch_add_u64(&SharedCatCtl->generation, 1);
+	shared_catcache_remove_matching(dbid, InvalidOid);
+}
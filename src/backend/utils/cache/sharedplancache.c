@@ -0,0 +1,535 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.c
+ *	  Cluster-wide cache of generic plans for prepared statements.
+ *
+ * Normally every backend plans each of its prepared statements itself, even
+ * when hundreds of sessions prepare exactly the same statements.  When
+ * shared_plan_cache_entries is set, generic plans built by plancache.c are
+ * also stored, in nodeToString() form, in a dshash table in dynamic shared
+ * memory, so that other sessions preparing the same statement can read the
+ * plan back instead of planning it again.
+ *
+ * A shared plan is only reused if everything the planner looked at matches:
+ * the query text, parameter types and cursor options, the database, the
+ * current user, search_path and row_security, and the values of all
+ * planner-related settings (those marked GUC_EXPLAIN) that differ from
+ * their defaults.  Plans are not shared if they might depend on state that
+ * only this session can see: temporary objects, uncommitted catalog
+ * changes, or parser hooks such as PL/pgSQL variables.
+ *
+ * Once a backend has loaded a shared plan, it owns a private copy, which
+ * plancache.c invalidates through the usual sinval callbacks.  The shared
+ * copy must be dropped by somebody, too: each transaction that commits
+ * catalog changes removes the shared plans that depend on them, before it
+ * sends its invalidation messages.  A generation counter, bumped before and
+ * after that, stops concurrent sessions from inserting plans that they
+ * might have built from catalog contents that are about to be invalidated.
+ *
+ * Non-transactional (inplace) catalog updates, which only change
+ * statistics, do not remove shared plans.  Nothing is shared during
+ * recovery, since we do not see the invalidations replayed from WAL here.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedplancache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/xlog.h"
+#include "catalog/namespace.h"
+#include "common/hashfn.h"
+#include "lib/dshash.h"
+#include "lib/stringinfo.h"
+#include "miscadmin.h"
+#include "nodes/plannodes.h"
+#include "port/atomics.h"
+#include "storage/dsm_registry.h"
+#include "utils/guc_tables.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
+#include "utils/rls.h"
+#include "utils/sharedplancache.h"
+#include "utils/syscache.h"
+
+/* GUC parameter */
+int			shared_plan_cache_entries = 0;
+
+/*
+ * Shared state.  "generation" advances whenever a committing transaction
+ * starts or finishes removing shared plans, and "active" counts the
+ * transactions doing so; see SharedPlanCacheStartBuild().
+ */
+typedef struct SharedPlanCacheControl
+{
+	pg_atomic_uint64 generation;
+	pg_atomic_uint32 active;
+	pg_atomic_uint32 nentries;
+} SharedPlanCacheControl;
+
+typedef struct SharedPlanKey
+{
+	Oid			dbid;			/* database the plan was built in */
+	Oid			roleid;			/* user the plan was built for */
+	uint64		hash;			/* hash of the rest of the key, see below */
+} SharedPlanKey;
+
+typedef struct SharedPlanInvalItem
+{
+	int			cacheId;
+	uint32		hashValue;
+} SharedPlanInvalItem;
+
+/*
+ * A hash table entry.  "data" points to a chunk holding, in this order, the
+ * OIDs of the relations the plan depends on, its other dependencies, the
+ * full key text (as built by shared_plan_key()) and the plan string.
+ */
+typedef struct SharedPlanEntry
+{
+	SharedPlanKey key;
+	dsa_pointer data;
+	int			nrelids;
+	int			nitems;
+	Size		keylen;
+	Size		planlen;
+} SharedPlanEntry;
+
+static const dshash_parameters shared_plan_hash_params = {
+	sizeof(SharedPlanKey),
+	sizeof(SharedPlanEntry),
+	dshash_memcmp,
+	dshash_memhash,
+	dshash_memcpy
+};
+
+static SharedPlanCacheControl *SharedPlanCtl = NULL;
+static dsa_area *SharedPlanArea = NULL;
+static dshash_table *SharedPlanHash = NULL;
+
+static void
+shared_plan_cache_init(void *ptr, void *arg)
+{
+	SharedPlanCacheControl *ctl = (SharedPlanCacheControl *) ptr;
+
+	pg_atomic_init_u64(&ctl->generation, 1);
+	pg_atomic_init_u32(&ctl->active, 0);
+	pg_atomic_init_u32(&ctl->nentries, 0);
+}
+
+/*
+ * Attach to the shared plan cache, creating it if needed.
+ *
+ * This is done at backend startup, rather than on first use, because every
+ * backend must be able to remove shared plans at commit time, where we'd
+ * rather not risk failing to attach.
+ */
+void
+SharedPlanCacheAttach(void)
+{
+	bool		found;
+
+	if (shared_plan_cache_entries <= 0 || !IsUnderPostmaster ||
+		SharedPlanCtl != NULL)
+		return;
+
+	SharedPlanArea = GetNamedDSA("shared_plan_cache_area", &found);
+	SharedPlanHash = GetNamedDSHash("shared_plan_cache",
+									&shared_plan_hash_params, &found);
+	SharedPlanCtl = GetNamedDSMSegment("shared_plan_cache_control",
+									   sizeof(SharedPlanCacheControl),
+									   shared_plan_cache_init,
+									   &found, NULL);
+}
+
+static int
+guc_name_compare(const void *a, const void *b)
+{
+	const struct config_generic *ca = *(struct config_generic *const *) a;
+	const struct config_generic *cb = *(struct config_generic *const *) b;
+
+	return strcmp(ca->name, cb->name);
+}
+
+/*
+ * Build the lookup key for a plan of plansource in the current environment.
+ * The full key text goes into "buf", so that hash collisions can be told
+ * apart from matches.
+ */
+static void
+shared_plan_key(CachedPlanSource *plansource, SharedPlanKey *key,
+				StringInfo buf)
+{
+	struct config_generic **gucs;
+	int			num;
+
+	initStringInfo(buf);
+	appendBinaryStringInfo(buf, plansource->query_string,
+						   strlen(plansource->query_string) + 1);
+	appendBinaryStringInfo(buf, &plansource->num_params, sizeof(int));
+	if (plansource->num_params > 0)
+		appendBinaryStringInfo(buf, plansource->param_types,
+							   plansource->num_params * sizeof(Oid));
+	appendBinaryStringInfo(buf, &plansource->cursor_options, sizeof(int));
+	appendBinaryStringInfo(buf, &row_security, sizeof(bool));
+	appendBinaryStringInfo(buf, namespace_search_path,
+						   strlen(namespace_search_path) + 1);
+
+	/* Planner settings, in a stable order */
+	gucs = get_explain_guc_options(&num);
+	qsort(gucs, num, sizeof(struct config_generic *), guc_name_compare);
+	for (int i = 0; i < num; i++)
+	{
+		char	   *value = ShowGUCOption(gucs[i], false);
+
+		appendBinaryStringInfo(buf, gucs[i]->name, strlen(gucs[i]->name) + 1);
+		appendBinaryStringInfo(buf, value, strlen(value) + 1);
+		pfree(value);
+	}
+	pfree(gucs);
+
+	key->dbid = MyDatabaseId;
+	key->roleid = GetUserId();
+	key->hash = hash_bytes_extended((const unsigned char *) buf->data,
+									buf->len, 0);
+}
+
+/*
+ * Can the generic plan of plansource be shared with other sessions?
+ */
+bool
+SharedPlanCacheEligible(CachedPlanSource *plansource)
+{
+	Oid			tempNamespaceId;
+	Oid			tempToastNamespaceId;
+
+	if (SharedPlanCtl == NULL || shared_plan_cache_entries <= 0)
+		return false;
+
+	if (!plansource->is_saved || plansource->is_oneshot)
+		return false;
+
+	/* The query text must be all there is to the statement */
+	if (plansource->raw_parse_tree == NULL ||
+		plansource->parserSetup != NULL ||
+		plansource->postRewrite != NULL)
+		return false;
+
+	if (RecoveryInProgress())
+		return false;
+
+	/* Our own uncommitted catalog changes would be visible to the planner */
+	if (CacheInvalidationPending())
+		return false;
+
+	/* Unqualified names might resolve to our temporary objects */
+	GetTempNamespaceState(&tempNamespaceId, &tempToastNamespaceId);
+	if (OidIsValid(tempNamespaceId))
+		return false;
+
+	return true;
+}
+
+/*
+ * Prepare to build a shared generic plan.
+ *
+ * Returns the generation to pass to SharedPlanCacheInsert(), or 0 if a
+ * concurrent transaction is removing shared plans right now, in which case
+ * the plan we are about to build must not be inserted.  We also make sure
+ * to have processed the invalidations of all transactions that finished
+ * doing so, so that our plan reflects their catalog changes.
+ */
+uint64
+SharedPlanCacheStartBuild(void)
+{
+	uint64		generation;
+
+	generation = pg_atomic_read_u64(&SharedPlanCtl->generation);
+	pg_memory_barrier();
+	if (pg_atomic_read_u32(&SharedPlanCtl->active) != 0)
+		generation = 0;
+
+	AcceptInvalidationMessages();
+
+	return generation;
+}
+
+/*
+ * Look for a shared generic plan of plansource.
+ *
+ * Returns a list of PlannedStmts in CurrentMemoryContext, or NIL if there is
+ * none.
+ */
+List *
+SharedPlanCacheLookup(CachedPlanSource *plansource)
+{
+	SharedPlanKey key;
+	StringInfoData buf;
+	SharedPlanEntry *entry;
+	char	   *data;
+	char	   *plan = NULL;
+
+	shared_plan_key(plansource, &key, &buf);
+
+	entry = dshash_find(SharedPlanHash, &key, false);
+	if (entry == NULL)
+	{
+		pfree(buf.data);
+		return NIL;
+	}
+
+	data = dsa_get_address(SharedPlanArea, entry->data);
+	data += entry->nrelids * sizeof(Oid) +
+		entry->nitems * sizeof(SharedPlanInvalItem);
+	if (entry->keylen == buf.len && memcmp(data, buf.data, buf.len) == 0)
+	{
+		plan = palloc(entry->planlen + 1);
+		memcpy(plan, data + entry->keylen, entry->planlen + 1);
+	}
+	dshash_release_lock(SharedPlanHash, entry);
+	pfree(buf.data);
+
+	if (plan == NULL)
+		return NIL;
+
+	return (List *) stringToNode(plan);
+}
+
+/*
+ * Offer a freshly built generic plan of plansource to other sessions.
+ */
+void
+SharedPlanCacheInsert(CachedPlanSource *plansource, List *stmt_list,
+					  uint64 generation)
+{
+	SharedPlanKey key;
+	StringInfoData buf;
+	SharedPlanEntry *entry;
+	List	   *relids;
+	List	   *items;
+	char	   *plan;
+	Size		planlen;
+	Size		size;
+	dsa_pointer dp;
+	char	   *data;
+	bool		found;
+	ListCell   *lc;
+
+	if (generation == 0)
+		return;
+
+	if (pg_atomic_read_u32(&SharedPlanCtl->nentries) >=
+		shared_plan_cache_entries)
+		return;
+
+	relids = list_copy(plansource->relationOids);
+	items = list_copy(plansource->invalItems);
+	foreach(lc, stmt_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc);
+
+		/* Transient plans are only good for this backend's snapshot */
+		if (plannedstmt->commandType == CMD_UTILITY ||
+			plannedstmt->transientPlan)
+			return;
+
+		relids = list_concat_unique_oid(relids, plannedstmt->relationOids);
+		items = list_concat(items, plannedstmt->invalItems);
+	}
+
+	plan = nodeToString(stmt_list);
+	planlen = strlen(plan);
+	shared_plan_key(plansource, &key, &buf);
+
+	size = list_length(relids) * sizeof(Oid) +
+		list_length(items) * sizeof(SharedPlanInvalItem) +
+		buf.len + planlen + 1;
+	if (!AllocSizeIsValid(size))
+		return;
+
+	entry = dshash_find_or_insert(SharedPlanHash, &key, &found);
+	if (found)
+	{
+		/* Somebody beat us to it */
+		dshash_release_lock(SharedPlanHash, entry);
+		return;
+	}
+
+	/*
+	 * Count the entry before checking the generation; see
+	 * SharedPlanCacheInvalidate().
+	 */
+	pg_atomic_fetch_add_u32(&SharedPlanCtl->nentries, 1);
+	if (pg_atomic_read_u64(&SharedPlanCtl->generation) != generation ||
+		(dp = dsa_allocate_extended(SharedPlanArea, size,
+									DSA_ALLOC_NO_OOM)) == InvalidDsaPointer)
+	{
+		dshash_delete_entry(SharedPlanHash, entry);
+		pg_atomic_fetch_sub_u32(&SharedPlanCtl->nentries, 1);
+		return;
+	}
+
+	entry->data = dp;
+	entry->nrelids = list_length(relids);
+	entry->nitems = list_length(items);
+	entry->keylen = buf.len;
+	entry->planlen = planlen;
+
+	data = dsa_get_address(SharedPlanArea, dp);
+	foreach(lc, relids)
+	{
+		*(Oid *) data = lfirst_oid(lc);
+		data += sizeof(Oid);
+	}
+	foreach(lc, items)
+	{
+		PlanInvalItem *item = lfirst_node(PlanInvalItem, lc);
+		SharedPlanInvalItem *sitem = (SharedPlanInvalItem *) data;
+
+		sitem->cacheId = item->cacheId;
+		sitem->hashValue = item->hashValue;
+		data += sizeof(SharedPlanInvalItem);
+	}
+	memcpy(data, buf.data, buf.len);
+	memcpy(data + buf.len, plan, planlen + 1);
+
+	dshash_release_lock(SharedPlanHash, entry);
+
+	pfree(buf.data);
+	pfree(plan);
+}
+
+/*
+ * Does an invalidation message affect a shared plan?  This mirrors the
+ * plancache.c syscache and relcache callbacks.
+ */
+static bool
+shared_plan_is_invalidated(SharedPlanEntry *entry, const char *data,
+						   const SharedInvalidationMessage *msg)
+{
+	const Oid  *relids = (const Oid *) data;
+	const SharedPlanInvalItem *items =
+		(const SharedPlanInvalItem *) (relids + entry->nrelids);
+
+	if (msg->id >= 0)
+	{
+		if (OidIsValid(msg->cc.dbId) && msg->cc.dbId != entry->key.dbid)
+			return false;
+
+		switch (msg->cc.id)
+		{
+			case NAMESPACEOID:
+			case OPEROID:
+			case AMOPOPID:
+			case FOREIGNSERVEROID:
+			case FOREIGNDATAWRAPPEROID:
+				/* plancache.c resets all plans for these */
+				return true;
+			default:
+				break;
+		}
+
+		for (int i = 0; i < entry->nitems; i++)
+		{
+			if (items[i].cacheId == msg->cc.id &&
+				(msg->cc.hashValue == 0 ||
+				 items[i].hashValue == msg->cc.hashValue))
+				return true;
+		}
+	}
+	else if (msg->id == SHAREDINVALCATALOG_ID)
+	{
+		if (!OidIsValid(msg->cat.dbId) || msg->cat.dbId == entry->key.dbid)
+			return true;
+	}
+	else if (msg->id == SHAREDINVALRELCACHE_ID)
+	{
+		if (OidIsValid(msg->rc.dbId) && msg->rc.dbId != entry->key.dbid)
+			return false;
+
+		if (!OidIsValid(msg->rc.relId))
+			return true;
+
+		for (int i = 0; i < entry->nrelids; i++)
+		{
+			if (relids[i] == msg->rc.relId)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Called by a committing transaction before it sends invalidation messages.
+ */
+void
+SharedPlanCacheBeginInvalidation(void)
+{
+	if (SharedPlanCtl == NULL)
+		return;
+
+	pg_atomic_fetch_add_u32(&SharedPlanCtl->active, 1);
+	pg_atomic_fetch_add_u64(&SharedPlanCtl->generation, 1);
+}
+
+/*
+ * Remove the shared plans affected by an array of invalidation messages.
+ *
+ * This must be called between SharedPlanCacheBeginInvalidation() and
+ * sending the messages.  We must not fail here, so there is no memory
+ * allocation.
+ */
+void
+SharedPlanCacheInvalidate(const SharedInvalidationMessage *msgs, int n)
+{
+	dshash_seq_status status;
+	SharedPlanEntry *entry;
+
+	if (SharedPlanCtl == NULL || n == 0)
+		return;
+
+	/*
+	 * The generation bump in SharedPlanCacheBeginInvalidation() acts as a
+	 * barrier: anybody who hasn't counted an entry yet is going to see the
+	 * new generation and won't insert it.
+	 */
+	if (pg_atomic_read_u32(&SharedPlanCtl->nentries) == 0)
+		return;
+
+	dshash_seq_init(&status, SharedPlanHash, true);
+	while ((entry = dshash_seq_next(&status)) != NULL)
+	{
+		const char *data = dsa_get_address(SharedPlanArea, entry->data);
+
+		for (int i = 0; i < n; i++)
+		{
+			if (shared_plan_is_invalidated(entry, data, &msgs[i]))
+			{
+				dsa_free(SharedPlanArea, entry->data);
+				dshash_delete_current(&status);
+				pg_atomic_fetch_sub_u32(&SharedPlanCtl->nentries, 1);
+				break;
+			}
+		}
+	}
+	dshash_seq_term(&status);
+}
+
+/*
+ * Called by a committing transaction after it has sent its invalidation
+ * messages.
+ */
+void
+SharedPlanCacheEndInvalidation(void)
+{
+	if (SharedPlanCtl == NULL)
+		return;
+
+	pg_atomic_fetch_add_u64(&SharedPlanCtl->generation, 1);
+	pg_atomic_fetch_sub_u32(&SharedPlanCtl->active, 1);
+}
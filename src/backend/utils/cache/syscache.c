@@ -36,6 +36,7 @@
 #include "utils/inval.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
+#include "utils/sharedcatcache.h"
 #include "utils/syscache.h"
 
 /*---------------------------------------------------------------------------
@@ -162,6 +163,8 @@ InitCatalogCache(void)
 				sizeof(Oid), oid_compare);
 
 	CacheInitialized = true;
+
+	SharedCatCacheAttach();
 }
 
 /*
@@ -53,6 +53,13 @@ uint8		MyCancelKey[MAX_CANCEL_KEY_LENGTH];
 int			MyCancelKeyLength = 0;
 int			MyPMChildSlot;
 
+/*
+ * Set once the session has acquired state that outlives a transaction, such
+ * as temporary tables or held cursors.  A connection proxy must then keep the
+ * client on this backend.
+ */
+bool		MySessionPinned = false;
+
 /*
  * MyLatch points to the latch that should be used for signal handling by the
  * current process. It will either point to a process local latch if the
@@ -891,6 +891,19 @@ InitializeSystemUser(const char *authn_id, const char *auth_method)
 	pfree(system_user);
 }
 
+/*
+ * Forget the system user, so that it can be initialized again.  This is
+ * used by pooled parallel workers, which take on the system user of each
+ * leader they work for.
+ */
+void
+ResetSystemUser(void)
+{
+	if (SystemUser)
+		pfree(unconstify(char *, SystemUser));
+	SystemUser = NULL;
+}
+
 /*
  * SQL-function SYSTEM_USER
  */
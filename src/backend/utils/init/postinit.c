@@ -305,6 +305,11 @@ PerformAuthentication(Port *port)
 								 be_gssapi_get_delegation(port) ? _("yes") : _("no"));
 		}
 #endif
+		if (port->compress_send.algorithm != PG_COMPRESSION_NONE ||
+			port->compress_recv.algorithm != PG_COMPRESSION_NONE)
+			appendStringInfo(&logmsg, _(" compression (send=%s, receive=%s)"),
+							 get_compress_algorithm_name(port->compress_send.algorithm),
+							 get_compress_algorithm_name(port->compress_recv.algorithm));
 
 		ereport(LOG, errmsg_internal("%s", logmsg.data));
 		pfree(logmsg.data);
@@ -192,6 +192,7 @@ static const char *const map_old_guc_names[] = {
 	"sort_mem", "work_mem",
 	"vacuum_mem", "maintenance_work_mem",
 	"ssl_ecdh_curve", "ssl_groups",
+	"debug_io_direct", "io_direct",
 	NULL
 };
 
@@ -3338,6 +3339,13 @@ set_config_with_handle(const char *name, config_handle *handle,
 		return 0;
 	}
 
+	/*
+	 * A session-level SET stays in effect after the transaction, so it ties
+	 * the session to this backend.
+	 */
+	if (changeVal && source == PGC_S_SESSION && action == GUC_ACTION_SET)
+		MySessionPinned = true;
+
 	/*
 	 * Check if the option can be set at this time. See guc.h for the precise
 	 * rules.
@@ -437,7 +437,7 @@ AllocSetContextCreateInternal(MemoryContext parent,
 	 * Allocate the initial block.  Unlike other aset.c blocks, it starts with
 	 * the context header and its block header follows that.
 	 */
-	set = (AllocSet) malloc(firstBlockSize);
+	set = (AllocSet) MemoryBlockAlloc(firstBlockSize);
 	if (set == NULL)
 	{
 		if (TopMemoryContext)
@@ -590,8 +590,10 @@ AllocSetReset(MemoryContext context)
 		}
 		else
 		{
+			Size		blksize = block->endptr - ((char *) block);
+
 			/* Normal case, release the block */
-			context->mem_allocated -= block->endptr - ((char *) block);
+			context->mem_allocated -= blksize;
 
 #ifdef CLOBBER_FREED_MEMORY
 			wipe_mem(block, block->freeptr - ((char *) block));
@@ -604,7 +606,7 @@ AllocSetReset(MemoryContext context)
 			 */
 			VALGRIND_MEMPOOL_FREE(set, block);
 
-			free(block);
+			MemoryBlockFree(block, blksize);
 		}
 		block = next;
 	}
@@ -635,7 +637,7 @@ AllocSetDelete(MemoryContext context)
 {
 	AllocSet	set = (AllocSet) context;
 	AllocBlock	block = set->blocks;
-	Size		keepersize PG_USED_FOR_ASSERTS_ONLY;
+	Size		keepersize;
 
 	Assert(AllocSetIsValid(set));
 
@@ -679,7 +681,8 @@ AllocSetDelete(MemoryContext context)
 				VALGRIND_DESTROY_MEMPOOL(oldset);
 
 				/* All that remains is to free the header/initial block */
-				free(oldset);
+				MemoryBlockFree(oldset,
+								KeeperBlock(oldset)->endptr - ((char *) oldset));
 			}
 			Assert(freelist->num_free == 0);
 		}
@@ -696,9 +699,10 @@ AllocSetDelete(MemoryContext context)
 	while (block != NULL)
 	{
 		AllocBlock	next = block->next;
+		Size		blksize = block->endptr - ((char *) block);
 
 		if (!IsKeeperBlock(set, block))
-			context->mem_allocated -= block->endptr - ((char *) block);
+			context->mem_allocated -= blksize;
 
 #ifdef CLOBBER_FREED_MEMORY
 		wipe_mem(block, block->freeptr - ((char *) block));
@@ -708,7 +712,7 @@ AllocSetDelete(MemoryContext context)
 		{
 			/* As in AllocSetReset, free block-header vchunks explicitly */
 			VALGRIND_MEMPOOL_FREE(set, block);
-			free(block);
+			MemoryBlockFree(block, blksize);
 		}
 
 		block = next;
@@ -724,7 +728,7 @@ AllocSetDelete(MemoryContext context)
 	VALGRIND_DESTROY_MEMPOOL(set);
 
 	/* Finally, free the context header, including the keeper block */
-	free(set);
+	MemoryBlockFree(set, keepersize);
 }
 
 /*
@@ -753,7 +757,7 @@ AllocSetAllocLarge(MemoryContext context, Size size, int flags)
 #endif
 
 	blksize = chunk_size + ALLOC_BLOCKHDRSZ + ALLOC_CHUNKHDRSZ;
-	block = (AllocBlock) malloc(blksize);
+	block = (AllocBlock) MemoryBlockAlloc(blksize);
 	if (block == NULL)
 		return MemoryContextAllocationFailure(context, size, flags);
 
@@ -949,7 +953,7 @@ AllocSetAllocFromNewBlock(MemoryContext context, Size size, int flags,
 		blksize <<= 1;
 
 	/* Try to allocate it */
-	block = (AllocBlock) malloc(blksize);
+	block = (AllocBlock) MemoryBlockAlloc(blksize);
 
 	/*
 	 * We could be asking for pretty big blocks here, so cope if malloc fails.
@@ -960,7 +964,7 @@ AllocSetAllocFromNewBlock(MemoryContext context, Size size, int flags,
 		blksize >>= 1;
 		if (blksize < required_size)
 			break;
-		block = (AllocBlock) malloc(blksize);
+		block = (AllocBlock) MemoryBlockAlloc(blksize);
 	}
 
 	if (block == NULL)
@@ -1118,6 +1122,7 @@ AllocSetFree(void *pointer)
 	{
 		/* Release single-chunk block. */
 		AllocBlock	block = ExternalChunkGetBlock(chunk);
+		Size		blksize;
 
 		/*
 		 * Try to verify that we have a sane block pointer: the block header
@@ -1146,7 +1151,8 @@ AllocSetFree(void *pointer)
 		if (block->next)
 			block->next->prev = block->prev;
 
-		set->header.mem_allocated -= block->endptr - ((char *) block);
+		blksize = block->endptr - ((char *) block);
+		set->header.mem_allocated -= blksize;
 
 #ifdef CLOBBER_FREED_MEMORY
 		wipe_mem(block, block->freeptr - ((char *) block));
@@ -1155,7 +1161,7 @@ AllocSetFree(void *pointer)
 		/* As in AllocSetReset, free block-header vchunks explicitly */
 		VALGRIND_MEMPOOL_FREE(set, block);
 
-		free(block);
+		MemoryBlockFree(block, blksize);
 	}
 	else
 	{
@@ -1275,7 +1281,7 @@ AllocSetRealloc(void *pointer, Size size, int flags)
 		blksize = chksize + ALLOC_BLOCKHDRSZ + ALLOC_CHUNKHDRSZ;
 		oldblksize = block->endptr - ((char *) block);
 
-		newblock = (AllocBlock) realloc(block, blksize);
+		newblock = (AllocBlock) MemoryBlockRealloc(block, oldblksize, blksize);
 		if (newblock == NULL)
 		{
 			/* Disallow access to the chunk header. */
@@ -0,0 +1,384 @@
+/*-------------------------------------------------------------------------
+ *
+ * blockcache.c
+ *	  Per-backend cache of the memory blocks of memory contexts.
+ *
+ * AllocSet, Generation and Bump contexts obtain their blocks from malloc()
+ * and give them back with free() when the context is reset or deleted.
+ * Every query creates and deletes a handful of contexts, so a workload of
+ * many short queries keeps allocating and freeing the same few block sizes,
+ * and the cost of doing that in malloc() is noticeable.  To avoid it, freed
+ * blocks are kept here, in a freelist per size class, and handed out again
+ * to the next context that asks for a block of the same size.
+ *
+ * Only blocks whose size is a power of 2 between BLOCK_CACHE_MIN_SIZE and
+ * BLOCK_CACHE_MAX_SIZE are cached.  That covers the regular blocks of the
+ * usual context sizes; dedicated blocks for large chunks and Slab blocks,
+ * whose sizes are arbitrary, normally go straight to malloc() and free().  The total size of
+ * the cached blocks is limited by memory_block_cache_size.
+ *
+ * Under Valgrind the cache is disabled, so that it sees every block being
+ * freed.
+ *
+ * Since every block goes through here, this is also where we keep track of
+ * the total amount of memory the process's memory contexts have obtained
+ * from malloc(), cached blocks included.  The total is published in the
+ * process's PgBackendStatus entry, so that memory use can be monitored
+ * across all backends, and it is checked against max_backend_memory when a
+ * new block is needed.
+ *
+ * Finally, blocks of at least memory_block_large_threshold are placed with
+ * more care than malloc() takes: they are aligned to the transparent huge
+ * page size and advised to use huge pages, and their pages are taken from
+ * the NUMA node of the CPU that first touches them.  Hash join bucket
+ * arrays, sort arrays and hash aggregation tables of many megabytes are
+ * probed at random, so with regular pages nearly every probe misses the
+ * TLB, and if the server runs under an interleaving NUMA policy (as set up
+ * by "numactl --interleave" for the benefit of shared memory) most of them
+ * also go to another node.  Parallel workers each touch their own blocks
+ * first, so their memory ends up on the node they run on.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/mmgr/blockcache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <sys/mman.h>
+
+#include "miscadmin.h"
+#include "port/pg_bitutils.h"
+#include "port/pg_numa.h"
+#include "storage/pg_shmem.h"
+#include "utils/memutils.h"
+#include "utils/memutils_internal.h"
+
+#define BLOCK_CACHE_MIN_SHIFT	13	/* 8kB */
+#define BLOCK_CACHE_MAX_SHIFT	20	/* 1MB */
+#define BLOCK_CACHE_MIN_SIZE	((Size) 1 << BLOCK_CACHE_MIN_SHIFT)
+#define BLOCK_CACHE_MAX_SIZE	((Size) 1 << BLOCK_CACHE_MAX_SHIFT)
+#define BLOCK_CACHE_NCLASSES	(BLOCK_CACHE_MAX_SHIFT - BLOCK_CACHE_MIN_SHIFT + 1)
+
+/*
+ * Alignment of large blocks.  This is the transparent huge page size on
+ * x86-64, and on other Linux platforms with 4kB pages.
+ */
+#define LARGE_BLOCK_ALIGN		((Size) 2 * 1024 * 1024)
+
+/* GUC parameters */
+int			memory_block_cache_size = 4096;
+int			max_backend_memory = 0;
+int			memory_block_large_threshold = 0;
+
+/*
+ * Bytes obtained from malloc() by this process's memory contexts.  Until the
+ * process has a PgBackendStatus entry my_allocated_bytes points to a local
+ * counter, afterwards to the entry's st_allocated_bytes.  Only this process
+ * writes it; readers in other processes may see a slightly stale value.
+ */
+static uint64 local_allocated_bytes = 0;
+uint64	   *my_allocated_bytes = &local_allocated_bytes;
+
+/* Set when a block is refused because of max_backend_memory */
+bool		backend_memory_limit_hit = false;
+
+/* A cached block; the link is stored in the block itself */
+typedef struct CachedBlock
+{
+	struct CachedBlock *next;
+} CachedBlock;
+
+static CachedBlock *BlockCacheFreeList[BLOCK_CACHE_NCLASSES];
+static int	BlockCacheCount[BLOCK_CACHE_NCLASSES];
+
+/* Total size of all cached blocks */
+static Size BlockCacheBytes = 0;
+
+static void BlockCacheTrim(Size limit);
+static bool MemoryBlockAllowed(Size size);
+static void *MemoryBlockMalloc(Size size);
+
+/*
+ * Return the size class of a block of 'size' bytes, or -1 if such blocks
+ * are not cached.
+ */
+static inline int
+BlockCacheSizeClass(Size size)
+{
+#ifdef USE_VALGRIND
+	return -1;
+#else
+	if (size < BLOCK_CACHE_MIN_SIZE || size > BLOCK_CACHE_MAX_SIZE ||
+		(size & (size - 1)) != 0)
+		return -1;
+
+	return pg_leftmost_one_pos64(size) - BLOCK_CACHE_MIN_SHIFT;
+#endif
+}
+
+/*
+ * Is a block of 'size' bytes to be allocated as a large block?
+ */
+static inline bool
+MemoryBlockIsLarge(Size size)
+{
+#ifdef MADV_HUGEPAGE
+	return memory_block_large_threshold > 0 &&
+		size >= (Size) memory_block_large_threshold * 1024;
+#else
+	return false;
+#endif
+}
+
+/*
+ * MemoryBlockAlloc
+ *		Allocate a block for a memory context, like malloc().
+ *
+ * Returns NULL if out of memory.
+ */
+void *
+MemoryBlockAlloc(Size size)
+{
+	int			sizeclass = BlockCacheSizeClass(size);
+	void	   *block;
+
+	if (sizeclass >= 0 && BlockCacheFreeList[sizeclass] != NULL)
+	{
+		CachedBlock *cached = BlockCacheFreeList[sizeclass];
+
+		BlockCacheFreeList[sizeclass] = cached->next;
+		BlockCacheCount[sizeclass]--;
+		BlockCacheBytes -= size;
+
+		return cached;
+	}
+
+	if (!MemoryBlockAllowed(size))
+		return NULL;
+
+	block = MemoryBlockMalloc(size);
+
+	/* If malloc() fails, give back what we have cached and try again */
+	if (block == NULL && BlockCacheBytes > 0)
+	{
+		BlockCacheTrim(0);
+		block = MemoryBlockMalloc(size);
+	}
+
+	if (block != NULL)
+		*my_allocated_bytes += size;
+
+	return block;
+}
+
+/*
+ * MemoryBlockRealloc
+ *		Resize a block obtained from MemoryBlockAlloc(), like realloc().
+ *
+ * Returns NULL if out of memory, in which case the old block is untouched.
+ */
+void *
+MemoryBlockRealloc(void *block, Size oldsize, Size newsize)
+{
+	void	   *newblock;
+
+	if (newsize > oldsize && !MemoryBlockAllowed(newsize - oldsize))
+		return NULL;
+
+	if (MemoryBlockIsLarge(newsize))
+	{
+		/*
+		 * realloc() wouldn't keep the alignment, so allocate a new large
+		 * block and copy.  Large blocks usually grow by doubling, so this
+		 * doesn't happen often.
+		 */
+		newblock = MemoryBlockMalloc(newsize);
+		if (newblock != NULL)
+		{
+			memcpy(newblock, block, Min(oldsize, newsize));
+			free(block);
+		}
+	}
+	else
+		newblock = realloc(block, newsize);
+
+	if (newblock != NULL)
+	{
+		*my_allocated_bytes -= oldsize;
+		*my_allocated_bytes += newsize;
+	}
+
+	return newblock;
+}
+
+/*
+ * MemoryBlockFree
+ *		Release a block obtained from MemoryBlockAlloc() or malloc().
+ *
+ * 'size' must be the size the block was allocated with.
+ */
+void
+MemoryBlockFree(void *block, Size size)
+{
+	int			sizeclass = BlockCacheSizeClass(size);
+	Size		limit = (Size) memory_block_cache_size * 1024;
+
+	if (sizeclass >= 0 && BlockCacheBytes + size <= limit)
+	{
+		CachedBlock *cached = (CachedBlock *) block;
+
+		cached->next = BlockCacheFreeList[sizeclass];
+		BlockCacheFreeList[sizeclass] = cached;
+		BlockCacheCount[sizeclass]++;
+		BlockCacheBytes += size;
+		return;
+	}
+
+	free(block);
+	*my_allocated_bytes -= size;
+
+	/* memory_block_cache_size may have been lowered */
+	if (BlockCacheBytes > limit)
+		BlockCacheTrim(limit);
+}
+
+/*
+ * Free cached blocks, largest first, until no more than 'limit' bytes are
+ * cached.
+ */
+static void
+BlockCacheTrim(Size limit)
+{
+	for (int i = BLOCK_CACHE_NCLASSES - 1; i >= 0; i--)
+	{
+		Size		size = BLOCK_CACHE_MIN_SIZE << i;
+
+		while (BlockCacheBytes > limit && BlockCacheFreeList[i] != NULL)
+		{
+			CachedBlock *cached = BlockCacheFreeList[i];
+
+			BlockCacheFreeList[i] = cached->next;
+			BlockCacheCount[i]--;
+			BlockCacheBytes -= size;
+			free(cached);
+			*my_allocated_bytes -= size;
+		}
+	}
+}
+
+/*
+ * Get a block from the C library, placing it as described at the top of the
+ * file if it is large.  The result can be released with free() either way.
+ */
+static void *
+MemoryBlockMalloc(Size size)
+{
+#ifdef MADV_HUGEPAGE
+	static int	numa_nodes = -1;
+	void	   *block;
+
+	if (!MemoryBlockIsLarge(size))
+		return malloc(size);
+
+	if (posix_memalign(&block, LARGE_BLOCK_ALIGN, size) != 0)
+		return NULL;
+
+	/*
+	 * The memory policy only affects pages that haven't been touched yet,
+	 * which for blocks this large is normally all of them, since the C
+	 * library maps them fresh from the kernel.  Failures don't matter; we
+	 * just get regular placement.
+	 */
+	if (huge_pages != HUGE_PAGES_OFF)
+		(void) madvise(block, size, MADV_HUGEPAGE);
+
+	if (numa_nodes < 0)
+		numa_nodes = pg_numa_init() == -1 ? 1 : pg_numa_get_max_node() + 1;
+	if (numa_nodes > 1)
+		(void) pg_numa_bind_local(block, size);
+
+	return block;
+#else
+	return malloc(size);
+#endif
+}
+
+/*
+ * Check whether obtaining another 'size' bytes from malloc() is allowed by
+ * max_backend_memory.
+ *
+ * The limit applies to regular backends and background workers only, and is
+ * not enforced inside critical sections, where a failure would become a
+ * PANIC, nor while building an error report.  Cached blocks are given back
+ * before refusing.
+ */
+static bool
+MemoryBlockAllowed(Size size)
+{
+	uint64		limit;
+
+	if (max_backend_memory == 0 ||
+		(MyBackendType != B_BACKEND && MyBackendType != B_BG_WORKER) ||
+		CritSectionCount > 0 ||
+		CurrentMemoryContext == ErrorContext)
+		return true;
+
+	limit = (uint64) max_backend_memory * 1024;
+	if (*my_allocated_bytes + size <= limit)
+		return true;
+
+	if (BlockCacheBytes > 0)
+	{
+		BlockCacheTrim(0);
+		if (*my_allocated_bytes + size <= limit)
+			return true;
+	}
+
+	backend_memory_limit_hit = true;
+	return false;
+}
+
+/*
+ * MemoryAccountingAttach
+ *		Start keeping this process's allocation total in *counter, which is
+ *		in shared memory.
+ */
+void
+MemoryAccountingAttach(uint64 *counter)
+{
+	*counter = *my_allocated_bytes;
+	my_allocated_bytes = counter;
+}
+
+/*
+ * MemoryAccountingDetach
+ *		Go back to keeping the allocation total in process-local memory.
+ */
+void
+MemoryAccountingDetach(void)
+{
+	local_allocated_bytes = *my_allocated_bytes;
+	my_allocated_bytes = &local_allocated_bytes;
+}
+
+/*
+ * MemoryBlockCacheStats
+ *		Report the blocks currently held in the cache.
+ *
+ * All of the cache's memory counts as free space.
+ */
+void
+MemoryBlockCacheStats(MemoryContextCounters *counters)
+{
+	memset(counters, 0, sizeof(MemoryContextCounters));
+
+	for (int i = 0; i < BLOCK_CACHE_NCLASSES; i++)
+		counters->nblocks += BlockCacheCount[i];
+	counters->totalspace = BlockCacheBytes;
+	counters->freespace = BlockCacheBytes;
+	counters->freechunks = counters->nblocks;
+}
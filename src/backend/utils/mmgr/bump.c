@@ -176,7 +176,7 @@ BumpContextCreate(MemoryContext parent, const char *name, Size minContextSize,
 	 * Allocate the initial block.  Unlike other bump.c blocks, it starts with
 	 * the context header and its block header follows that.
 	 */
-	set = (BumpContext *) malloc(allocSize);
+	set = (BumpContext *) MemoryBlockAlloc(allocSize);
 	if (set == NULL)
 	{
 		MemoryContextStats(TopMemoryContext);
@@ -293,6 +293,9 @@ BumpReset(MemoryContext context)
 void
 BumpDelete(MemoryContext context)
 {
+	BumpContext *set = (BumpContext *) context;
+	Size		allocSize = (char *) KeeperBlock(set)->endptr - (char *) set;
+
 	/* Reset to release all releasable BumpBlocks */
 	BumpReset(context);
 
@@ -300,7 +303,7 @@ BumpDelete(MemoryContext context)
 	VALGRIND_DESTROY_MEMPOOL(context);
 
 	/* And free the context header and keeper block */
-	free(context);
+	MemoryBlockFree(context, allocSize);
 }
 
 /*
@@ -334,7 +337,7 @@ BumpAllocLarge(MemoryContext context, Size size, int flags)
 	required_size = chunk_size + Bump_CHUNKHDRSZ;
 	blksize = required_size + Bump_BLOCKHDRSZ;
 
-	block = (BumpBlock *) malloc(blksize);
+	block = (BumpBlock *) MemoryBlockAlloc(blksize);
 	if (block == NULL)
 		return MemoryContextAllocationFailure(context, size, flags);
 
@@ -473,7 +476,7 @@ BumpAllocFromNewBlock(MemoryContext context, Size size, int flags,
 	if (blksize < required_size)
 		blksize = pg_nextpower2_size_t(required_size);
 
-	block = (BumpBlock *) malloc(blksize);
+	block = (BumpBlock *) MemoryBlockAlloc(blksize);
 
 	if (block == NULL)
 		return MemoryContextAllocationFailure(context, size, flags);
@@ -620,22 +623,24 @@ BumpBlockFreeBytes(BumpBlock *block)
 static inline void
 BumpBlockFree(BumpContext *set, BumpBlock *block)
 {
+	Size		blksize = (char *) block->endptr - (char *) block;
+
 	/* Make sure nobody tries to free the keeper block */
 	Assert(!IsKeeperBlock(set, block));
 
 	/* release the block from the list of blocks */
 	dlist_delete(&block->node);
 
-	((MemoryContext) set)->mem_allocated -= ((char *) block->endptr - (char *) block);
+	((MemoryContext) set)->mem_allocated -= blksize;
 
 #ifdef CLOBBER_FREED_MEMORY
-	wipe_mem(block, ((char *) block->endptr - (char *) block));
+	wipe_mem(block, blksize);
 #endif
 
 	/* As in aset.c, free block-header vchunks explicitly */
 	VALGRIND_MEMPOOL_FREE(set, block);
 
-	free(block);
+	MemoryBlockFree(block, blksize);
 }
 
 /*
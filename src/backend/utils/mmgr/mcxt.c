@@ -1197,10 +1197,20 @@ MemoryContextCreate(MemoryContext node,
 void *
 MemoryContextAllocationFailure(MemoryContext context, Size size, int flags)
 {
+	bool		limit_hit = backend_memory_limit_hit;
+
+	backend_memory_limit_hit = false;
+
 	if ((flags & MCXT_ALLOC_NO_OOM) == 0)
 	{
 		if (TopMemoryContext)
 			MemoryContextStats(TopMemoryContext);
+		if (limit_hit)
+			ereport(ERROR,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("out of memory"),
+					 errdetail("Failed on request of size %zu in memory context \"%s\" because the backend would exceed \"%s\".",
+							   size, context->name, "max_backend_memory")));
 		ereport(ERROR,
 				(errcode(ERRCODE_OUT_OF_MEMORY),
 				 errmsg("out of memory"),
@@ -0,0 +1,200 @@
+/*-------------------------------------------------------------------------
+ *
+ * querymem.c
+ *	  Cluster-wide budget for the working memory of queries.
+ *
+ * work_mem and hash_mem_multiplier limit each sort and hash table of each
+ * process separately, so the memory that all queries together may use is
+ * unbounded: a burst of complex queries, especially parallel ones, can
+ * exhaust the machine's memory, while most of the time much of it sits
+ * idle.  query_memory_budget puts a limit on the sum.  Sorts, hash joins and
+ * hash aggregates reserve their memory from it as they grow, up to their
+ * usual work_mem-based limit, and switch to their disk-based strategies
+ * early when the budget is exhausted.
+ *
+ * All there is in shared memory is a counter of the bytes currently
+ * reserved, which we adjust with atomic operations; there are no waits.
+ * Every reservation is granted a small minimum even when the budget is
+ * exhausted, so that queries always make progress.  The budget is thus a
+ * soft limit, and it only covers the memory that the executor nodes
+ * account for, not memory used in other ways.
+ *
+ * If an error is thrown, the nodes holding reservations are not shut down
+ * normally.  To keep such reservations from leaking, each backend returns
+ * whatever it still has reserved at the end of each top-level transaction,
+ * and begins a new "epoch"; releasing a grant obtained in an earlier epoch
+ * is a no-op.
+ *
+ * With query_memory_budget = 0 grants are simply granted in full, without
+ * touching the shared counter, so the feature costs nothing when it's off.
+ * A grant only returns to the budget what it actually took from it.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/mmgr/querymem.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "port/atomics.h"
+#include "storage/ipc.h"
+#include "storage/shmem.h"
+#include "utils/querymem.h"
+
+/* GUC parameter */
+int			query_memory_budget = 0;
+
+typedef struct QueryMemoryControl
+{
+	pg_atomic_uint64 reserved;	/* bytes reserved by all backends */
+} QueryMemoryControl;
+
+static QueryMemoryControl *QueryMemory = NULL;
+
+/* Bytes reserved by this backend in the current epoch */
+static Size MyQueryMemoryReserved = 0;
+
+/* Grants with a different epoch have already been returned */
+static uint64 MyQueryMemoryEpoch = 1;
+
+static bool QueryMemoryExitRegistered = false;
+
+static void QueryMemoryShmemExit(int code, Datum arg);
+
+Size
+QueryMemoryShmemSize(void)
+{
+	return sizeof(QueryMemoryControl);
+}
+
+void
+QueryMemoryShmemInit(void)
+{
+	bool		found;
+
+	QueryMemory = (QueryMemoryControl *)
+		ShmemInitStruct("Query Memory Budget", sizeof(QueryMemoryControl),
+						&found);
+	if (!found)
+		pg_atomic_init_u64(&QueryMemory->reserved, 0);
+}
+
+/*
+ * MemoryGrantInit
+ *		Initialize an empty grant.
+ */
+void
+MemoryGrantInit(MemoryGrant *grant)
+{
+	grant->size = 0;
+	grant->charged = 0;
+	grant->epoch = MyQueryMemoryEpoch;
+}
+
+/*
+ * MemoryGrantExtend
+ *		Try to grow a grant to 'target' bytes.
+ *
+ * The grant is grown as far as the budget allows, but to at least 'minimum'
+ * bytes even if that exceeds the budget.  Returns the new size of the grant,
+ * which may be larger than 'target' if it was larger already.
+ */
+Size
+MemoryGrantExtend(MemoryGrant *grant, Size target, Size minimum)
+{
+	Size		budget = (Size) query_memory_budget * 1024;
+	Size		want;
+	Size		need;
+	uint64		reserved;
+	Size		get;
+
+	/* A grant from a previous transaction has been returned already */
+	if (grant->epoch != MyQueryMemoryEpoch)
+		MemoryGrantInit(grant);
+
+	if (target <= grant->size)
+		return grant->size;
+
+	/* No budget, nothing to account for */
+	if (budget == 0)
+	{
+		grant->size = target;
+		return grant->size;
+	}
+
+	want = target - grant->size;
+	need = minimum > grant->size ? Min(minimum - grant->size, want) : 0;
+
+	if (!QueryMemoryExitRegistered)
+	{
+		before_shmem_exit(QueryMemoryShmemExit, 0);
+		QueryMemoryExitRegistered = true;
+	}
+
+	reserved = pg_atomic_read_u64(&QueryMemory->reserved);
+	for (;;)
+	{
+		if (reserved >= budget)
+			get = need;
+		else
+			get = Max(Min(want, budget - reserved), need);
+
+		if (get == 0)
+			break;
+		/* on failure, this updates "reserved", and we try again */
+		if (pg_atomic_compare_exchange_u64(&QueryMemory->reserved,
+										   &reserved, reserved + get))
+			break;
+	}
+
+	grant->size += get;
+	grant->charged += get;
+	MyQueryMemoryReserved += get;
+
+	return grant->size;
+}
+
+/*
+ * MemoryGrantRelease
+ *		Return the memory of a grant to the budget.
+ */
+void
+MemoryGrantRelease(MemoryGrant *grant)
+{
+	if (grant->epoch == MyQueryMemoryEpoch && grant->charged > 0)
+	{
+		Assert(MyQueryMemoryReserved >= grant->charged);
+		pg_atomic_sub_fetch_u64(&QueryMemory->reserved, grant->charged);
+		MyQueryMemoryReserved -= grant->charged;
+	}
+	grant->size = 0;
+	grant->charged = 0;
+}
+
+/*
+ * AtEOXact_QueryMemory
+ *		Return any memory still reserved at the end of a transaction.
+ *
+ * After a successful transaction there normally isn't any, but after an
+ * error the nodes holding grants were never shut down.
+ */
+void
+AtEOXact_QueryMemory(void)
+{
+	if (MyQueryMemoryReserved > 0)
+	{
+		pg_atomic_sub_fetch_u64(&QueryMemory->reserved,
+								MyQueryMemoryReserved);
+		MyQueryMemoryReserved = 0;
+	}
+	MyQueryMemoryEpoch++;
+}
+
+static void
+QueryMemoryShmemExit(int code, Datum arg)
+{
+	AtEOXact_QueryMemory();
+}
@@ -361,7 +361,7 @@ SlabContextCreate(MemoryContext parent,
 
 
 
-	slab = (SlabContext *) malloc(Slab_CONTEXT_HDRSZ(chunksPerBlock));
+	slab = (SlabContext *) MemoryBlockAlloc(Slab_CONTEXT_HDRSZ(chunksPerBlock));
 	if (slab == NULL)
 	{
 		MemoryContextStats(TopMemoryContext);
@@ -460,7 +460,7 @@ SlabReset(MemoryContext context)
 		/* As in aset.c, free block-header vchunks explicitly */
 		VALGRIND_MEMPOOL_FREE(slab, block);
 
-		free(block);
+		MemoryBlockFree(block, slab->blockSize);
 		context->mem_allocated -= slab->blockSize;
 	}
 
@@ -480,7 +480,7 @@ SlabReset(MemoryContext context)
 			/* As in aset.c, free block-header vchunks explicitly */
 			VALGRIND_MEMPOOL_FREE(slab, block);
 
-			free(block);
+			MemoryBlockFree(block, slab->blockSize);
 			context->mem_allocated -= slab->blockSize;
 		}
 	}
@@ -512,7 +512,8 @@ SlabDelete(MemoryContext context)
 	VALGRIND_DESTROY_MEMPOOL(context);
 
 	/* And free the context header */
-	free(context);
+	MemoryBlockFree(context,
+					Slab_CONTEXT_HDRSZ(((SlabContext *) context)->chunksPerBlock));
 }
 
 /*
@@ -587,7 +588,7 @@ SlabAllocFromNewBlock(MemoryContext context, Size size, int flags)
 	}
 	else
 	{
-		block = (SlabBlock *) malloc(slab->blockSize);
+		block = (SlabBlock *) MemoryBlockAlloc(slab->blockSize);
 
 		if (unlikely(block == NULL))
 			return MemoryContextAllocationFailure(context, size, flags);
@@ -827,7 +828,7 @@ SlabFree(void *pointer)
 			/* As in aset.c, free block-header vchunks explicitly */
 			VALGRIND_MEMPOOL_FREE(slab, block);
 
-			free(block);
+			MemoryBlockFree(block, slab->blockSize);
 			slab->header.mem_allocated -= slab->blockSize;
 		}
 
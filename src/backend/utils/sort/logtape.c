@@ -289,6 +289,28 @@ ltsReadBlock(LogicalTapeSet *lts, int64 blocknum, void *buffer)
 	BufFileReadExact(lts->pfile, buffer, BLCKSZ);
 }
 
+/*
+ * Ask the kernel to start reading the blocks that the next
+ * ltsReadFillBuffer() call on this tape will want.
+ *
+ * A tape's blocks are chained by their trailers, so we only know the first
+ * of them for sure.  But thanks to preallocation, the blocks of a tape are
+ * mostly consecutive in the underlying file, so hinting a buffer's worth of
+ * blocks starting there usually covers the whole next read.  When a merge
+ * reads from many tapes, this lets the reads for all of them be in flight
+ * at once, instead of the merge stalling on each tape's read in turn.
+ */
+static void
+ltsPrefetchBuffer(LogicalTape *lt)
+{
+	if (lt->nextBlockNumber == -1L)
+		return;
+
+	BufFilePrefetchBlock(lt->tapeSet->pfile,
+						 lt->nextBlockNumber + lt->offsetBlockNumber,
+						 (int) (lt->buffer_size / BLCKSZ));
+}
+
 /*
  * Read as many blocks as we can into the per-tape buffer.
  *
@@ -330,6 +352,9 @@ ltsReadFillBuffer(LogicalTape *lt)
 		/* Advance to next block, if we have buffer space left */
 	} while (lt->buffer_size - lt->nbytes > BLCKSZ);
 
+	/* Start reading the next bufferload while the caller consumes this one */
+	ltsPrefetchBuffer(lt);
+
 	return (lt->nbytes > 0);
 }
 
@@ -917,6 +942,16 @@ LogicalTapeRewindForRead(LogicalTape *lt, size_t buffer_size)
 		lt->nprealloc = 0;
 		lt->prealloc_size = 0;
 	}
+
+	/*
+	 * Get the first bufferload on its way.  The read buffer is set up
+	 * lazily, so mirror what ltsInitReadBuffer() will do.
+	 */
+	if (!lt->frozen)
+	{
+		lt->nextBlockNumber = lt->firstBlockNumber;
+		ltsPrefetchBuffer(lt);
+	}
 }
 
 /*
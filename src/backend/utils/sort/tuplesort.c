@@ -42,10 +42,10 @@
  * end of the input is reached, we dump out remaining tuples in memory into
  * a final run, then merge the runs.
  *
- * When merging runs, we use a heap containing just the frontmost tuple from
- * each source run; we repeatedly output the smallest tuple and replace it
- * with the next tuple from its source tape (if any).  When the heap empties,
- * the merge is complete.  The basic merge algorithm thus needs very little
+ * When merging runs, we keep just the frontmost tuple from each source run,
+ * organized in a tournament tree (see lib/losertree.c); we repeatedly output
+ * the smallest tuple and replace it with the next tuple from its source tape
+ * (if any).  When all source runs are exhausted, the merge is complete.  The basic merge algorithm thus needs very little
  * memory --- only M tuples for an M-way merge, and M is constrained to a
  * small number.  However, we can still make good use of our full workMem
  * allocation by pre-reading additional blocks from each source tape.  Without
@@ -102,12 +102,15 @@
 #include <limits.h>
 
 #include "commands/tablespace.h"
+#include "lib/losertree.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
+#include "port/pg_bitutils.h"
 #include "storage/shmem.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
+#include "utils/querymem.h"
 #include "utils/tuplesort.h"
 
 /*
@@ -195,6 +198,9 @@ struct Tuplesortstate
 								 * tuples to tape */
 	int64		availMem;		/* remaining memory available, in bytes */
 	int64		allowedMem;		/* total memory allowed, in bytes */
+	int64		maxMem;			/* workMem; allowedMem can grow up to this */
+	MemoryGrant grant;			/* allowedMem reserved from the query memory
+								 * budget */
 	int			maxTapes;		/* max number of input tapes to merge in each
 								 * pass */
 	int64		maxSpace;		/* maximum amount of space occupied among sort
@@ -208,15 +214,23 @@ struct Tuplesortstate
 	/*
 	 * This array holds the tuples now in sort memory.  If we are in state
 	 * INITIAL, the tuples are in no particular order; if we are in state
-	 * SORTEDINMEM, the tuples are in final sorted order; in states BUILDRUNS
-	 * and FINALMERGE, the tuples are organized in "heap" order per Algorithm
-	 * H.  In state SORTEDONTAPE, the array is not used.
+	 * SORTEDINMEM, the tuples are in final sorted order; in state BUILDRUNS,
+	 * the tuples are organized in "heap" order per Algorithm H.  While
+	 * merging (including state FINALMERGE), memtuples[i] holds the frontmost
+	 * tuple of input tape i, and memtupcount is zero.  In state SORTEDONTAPE,
+	 * the array is not used.
 	 */
 	SortTuple  *memtuples;		/* array of SortTuple structs */
 	int			memtupcount;	/* number of tuples currently present */
 	int			memtupsize;		/* allocated length of memtuples array */
 	bool		growmemtuples;	/* memtuples' growth still underway? */
 
+	/*
+	 * Tournament tree over the input tapes of a merge, ordering them by their
+	 * frontmost tuples in memtuples[].
+	 */
+	losertree  *mergetree;
+
 	/*
 	 * Memory for tuples is sometimes allocated using a simple slab allocator,
 	 * rather than with palloc().  Currently, we switch to slab allocation
@@ -463,6 +477,7 @@ static void dumptuples(Tuplesortstate *state, bool alltuples);
 static void make_bounded_heap(Tuplesortstate *state);
 static void sort_bounded_heap(Tuplesortstate *state);
 static void tuplesort_sort_memtuples(Tuplesortstate *state);
+static int	tuplesort_merge_compare(int a, int b, void *arg);
 static void tuplesort_heap_insert(Tuplesortstate *state, SortTuple *tuple);
 static void tuplesort_heap_replace_top(Tuplesortstate *state, SortTuple *tuple);
 static void tuplesort_heap_delete_top(Tuplesortstate *state);
@@ -613,6 +628,245 @@ qsort_tuple_int32_compare(SortTuple *a, SortTuple *b, Tuplesortstate *state)
 #define ST_DEFINE
 #include "lib/sort_template.h"
 
+/*
+ * Radix sort for SortTuples whose leading key is compared by one of the
+ * specialized comparators above.
+ *
+ * For those comparators the ordering of non-NULL datum1 values is fully
+ * determined by their bits, so once each datum1 is mapped to an unsigned
+ * key (flipping the sign bit for signed types, and all bits for DESC keys)
+ * we can distribute the tuples by key byte instead of comparing them.  We
+ * use an in-place most-significant-digit-first radix sort ("American flag
+ * sort"), which needs no extra memory beyond the memtuples array, skips the
+ * leading bytes that all keys share, and hands small buckets to the
+ * matching specialized quicksort.  Tuples that turn out to have an equal
+ * leading key (including all the NULLs) are then ordered by the tiebreak
+ * comparator, just as the quicksort would do.
+ *
+ * The radix sort is only worth it for larger inputs; below
+ * RADIX_SORT_MIN_TUPLES we go straight to quicksort.
+ */
+#define RADIX_SORT_MIN_TUPLES		1024
+#define RADIX_SORT_QSORT_CUTOFF		64
+
+typedef void (*SortTupleSortFunc) (SortTuple *data, size_t n,
+								   Tuplesortstate *state);
+
+typedef struct RadixSortContext
+{
+	Tuplesortstate *state;
+	SortTupleSortFunc qsort_func;	/* specialized quicksort for small buckets */
+	uint64		mask;			/* significant bits of datum1 */
+	uint64		flip;			/* XOR'd in to make keys sort as unsigned */
+	int			nbytes;			/* number of significant key bytes */
+} RadixSortContext;
+
+static inline uint64
+radix_sort_key(const SortTuple *stup, RadixSortContext *cxt)
+{
+	return ((uint64) stup->datum1 & cxt->mask) ^ cxt->flip;
+}
+
+static inline int
+radix_sort_byte(const SortTuple *stup, int level, RadixSortContext *cxt)
+{
+	return (int) ((radix_sort_key(stup, cxt) >>
+				   ((cxt->nbytes - 1 - level) * BITS_PER_BYTE)) & 0xFF);
+}
+
+/*
+ * Sort a group of tuples whose leading keys are all equal.
+ */
+static void
+radix_sort_ties(SortTuple *data, size_t n, RadixSortContext *cxt)
+{
+	Tuplesortstate *state = cxt->state;
+
+	if (n < 2 || state->base.onlyKey != NULL)
+		return;
+
+	qsort_tuple(data, n, state->base.comparetup_tiebreak, state);
+}
+
+/*
+ * Sort tuples that have no NULL leading key and agree on all key bytes
+ * before "level".
+ */
+static void
+radix_sort_level(SortTuple *data, size_t n, int level, RadixSortContext *cxt)
+{
+	size_t		counts[256];
+	size_t		offsets[256];
+	size_t		ends[256];
+	size_t		start;
+	int			b;
+
+	for (;;)
+	{
+		if (n < RADIX_SORT_QSORT_CUTOFF)
+		{
+			cxt->qsort_func(data, n, cxt->state);
+			return;
+		}
+		if (level >= cxt->nbytes)
+		{
+			radix_sort_ties(data, n, cxt);
+			return;
+		}
+
+		CHECK_FOR_INTERRUPTS();
+
+		memset(counts, 0, sizeof(counts));
+		for (size_t i = 0; i < n; i++)
+			counts[radix_sort_byte(&data[i], level, cxt)]++;
+
+		/* If everything landed in one bucket, just look at the next byte */
+		if (counts[radix_sort_byte(&data[0], level, cxt)] != n)
+			break;
+		level++;
+	}
+
+	start = 0;
+	for (b = 0; b < 256; b++)
+	{
+		offsets[b] = start;
+		start += counts[b];
+		ends[b] = start;
+	}
+
+	/* Permute the tuples into their buckets by following swap cycles */
+	for (b = 0; b < 256; b++)
+	{
+		while (offsets[b] < ends[b])
+		{
+			SortTuple	tup = data[offsets[b]];
+			int			tb = radix_sort_byte(&tup, level, cxt);
+
+			while (tb != b)
+			{
+				SortTuple	displaced = data[offsets[tb]];
+
+				data[offsets[tb]++] = tup;
+				tup = displaced;
+				tb = radix_sort_byte(&tup, level, cxt);
+			}
+			data[offsets[b]++] = tup;
+		}
+	}
+
+	start = 0;
+	for (b = 0; b < 256; b++)
+	{
+		if (counts[b] > 1)
+			radix_sort_level(data + start, counts[b], level + 1, cxt);
+		start += counts[b];
+	}
+}
+
+/*
+ * Sort state->memtuples with a radix sort, if the leading key allows it.
+ * Returns false, without doing anything, if it doesn't.
+ */
+static bool
+radix_sort_memtuples(Tuplesortstate *state)
+{
+	SortSupport ssup = &state->base.sortKeys[0];
+	SortTuple  *data = state->memtuples;
+	size_t		n = state->memtupcount;
+	RadixSortContext cxt;
+	SortTuple  *nonnull;
+	size_t		nnonnull;
+	size_t		nnulls = 0;
+	uint64		first;
+	uint64		diff;
+
+	cxt.state = state;
+	if (ssup->comparator == ssup_datum_unsigned_cmp)
+	{
+		cxt.qsort_func = qsort_tuple_unsigned;
+		cxt.mask = PG_UINT64_MAX;
+		cxt.flip = 0;
+		cxt.nbytes = sizeof(uint64);
+	}
+	else if (ssup->comparator == ssup_datum_signed_cmp)
+	{
+		cxt.qsort_func = qsort_tuple_signed;
+		cxt.mask = PG_UINT64_MAX;
+		cxt.flip = UINT64CONST(1) << 63;
+		cxt.nbytes = sizeof(uint64);
+	}
+	else if (ssup->comparator == ssup_datum_int32_cmp)
+	{
+		cxt.qsort_func = qsort_tuple_int32;
+		cxt.mask = PG_UINT32_MAX;
+		cxt.flip = UINT64CONST(1) << 31;
+		cxt.nbytes = sizeof(uint32);
+	}
+	else
+		return false;
+
+	if (ssup->ssup_reverse)
+		cxt.flip ^= cxt.mask;
+
+	/*
+	 * Move the NULLs to the front or the back, as the sort order demands.
+	 * They all compare equal on the leading key.
+	 */
+	if (ssup->ssup_nulls_first)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			if (data[i].isnull1)
+			{
+				SortTuple	tmp = data[nnulls];
+
+				data[nnulls++] = data[i];
+				data[i] = tmp;
+			}
+		}
+		radix_sort_ties(data, nnulls, &cxt);
+		nonnull = data + nnulls;
+	}
+	else
+	{
+		size_t		nvalues = 0;
+
+		for (size_t i = 0; i < n; i++)
+		{
+			if (!data[i].isnull1)
+			{
+				SortTuple	tmp = data[nvalues];
+
+				data[nvalues++] = data[i];
+				data[i] = tmp;
+			}
+		}
+		nnulls = n - nvalues;
+		radix_sort_ties(data + nvalues, nnulls, &cxt);
+		nonnull = data;
+	}
+	nnonnull = n - nnulls;
+
+	if (nnonnull < 2)
+		return true;
+
+	/* Skip the leading key bytes that are the same in every tuple */
+	first = radix_sort_key(&nonnull[0], &cxt);
+	diff = 0;
+	for (size_t i = 1; i < nnonnull; i++)
+		diff |= radix_sort_key(&nonnull[i], &cxt) ^ first;
+
+	if (diff == 0)
+		radix_sort_ties(nonnull, nnonnull, &cxt);
+	else
+		radix_sort_level(nonnull, nnonnull,
+						 (cxt.nbytes * BITS_PER_BYTE - 1 -
+						  pg_leftmost_one_pos64(diff)) / BITS_PER_BYTE,
+						 &cxt);
+
+	return true;
+}
+
 /*
  *		tuplesort_begin_xxx
  *
@@ -685,8 +939,17 @@ tuplesort_begin_common(int workMem, SortCoordinate coordinate, int sortopt)
 	 * for the work_mem GUC.  This is a defense against parallel sort callers
 	 * that divide out memory among many workers in a way that leaves each
 	 * with very little memory.
-	 */
-	state->allowedMem = Max(workMem, 64) * (int64) 1024;
+	 *
+	 * With a query memory budget, we start out with just that minimum
+	 * reserved from it, and reserve more as the sort grows; see
+	 * tuplesort_grow_grant().  Without one, we may use all of it right away.
+	 */
+	state->maxMem = Max(workMem, 64) * (int64) 1024;
+	MemoryGrantInit(&state->grant);
+	state->allowedMem = MemoryGrantExtend(&state->grant,
+										  query_memory_budget > 0 ?
+										  QUERY_MEMORY_MIN_GRANT : state->maxMem,
+										  QUERY_MEMORY_MIN_GRANT);
 	state->base.sortcontext = sortcontext;
 	state->base.maincontext = maincontext;
 
@@ -791,6 +1054,11 @@ tuplesort_begin_batch(Tuplesortstate *state)
 		state->memtuples = (SortTuple *) palloc(state->memtupsize * sizeof(SortTuple));
 		USEMEM(state, GetMemoryChunkSpace(state->memtuples));
 	}
+	if (state->mergetree != NULL)
+	{
+		losertree_free(state->mergetree);
+		state->mergetree = NULL;
+	}
 
 	/* workMem must be large enough for the minimal memtuples array */
 	if (LACKMEM(state))
@@ -938,6 +1206,8 @@ tuplesort_end(Tuplesortstate *state)
 {
 	tuplesort_free(state);
 
+	MemoryGrantRelease(&state->grant);
+
 	/*
 	 * Free the main memory context, including the Tuplesortstate struct
 	 * itself.
@@ -1019,6 +1289,33 @@ tuplesort_reset(Tuplesortstate *state)
 	state->slabFreeHead = NULL;
 }
 
+/*
+ * Reserve more memory from the query memory budget, so that availMem grows
+ * by at least 'needed' bytes.  We grow in steps of doubling allowedMem, up to
+ * maxMem.  Returns false if we didn't get enough.
+ */
+static bool
+tuplesort_grow_grant(Tuplesortstate *state, int64 needed)
+{
+	int64		target;
+	int64		added;
+
+	if (state->allowedMem >= state->maxMem)
+		return false;
+
+	target = Max(state->allowedMem * 2, state->allowedMem + needed);
+	target = Min(target, state->maxMem);
+	added = (int64) MemoryGrantExtend(&state->grant, target, 0) -
+		state->allowedMem;
+	if (added <= 0)
+		return false;
+
+	state->availMem += added;
+	state->allowedMem += added;
+
+	return added >= needed;
+}
+
 /*
  * Grow the memtuples[] array, if possible within our memory constraint.  We
  * must not exceed INT_MAX tuples in memory or the caller-provided memory
@@ -1045,6 +1342,10 @@ grow_memtuples(Tuplesortstate *state)
 	if (!state->growmemtuples)
 		return false;
 
+	/* Try to get enough memory to double our usage */
+	if (memNowUsed > state->availMem)
+		(void) tuplesort_grow_grant(state, memNowUsed - state->availMem);
+
 	/* Select new value of memtupsize */
 	if (memNowUsed <= state->availMem)
 	{
@@ -1223,7 +1524,12 @@ tuplesort_puttuple_common(Tuplesortstate *state, SortTuple *tuple,
 			 * complete the sort that way.  In the worst case, if later input
 			 * tuples are larger than earlier ones, this might cause us to
 			 * exceed workMem significantly.
+			 *
+			 * Before deciding we've run out of memory, try to reserve more.
 			 */
+			if (LACKMEM(state))
+				(void) tuplesort_grow_grant(state, -state->availMem);
+
 			if (state->bounded &&
 				(state->memtupcount > state->bound * 2 ||
 				 (state->memtupcount > state->bound && LACKMEM(state))))
@@ -1640,13 +1946,12 @@ tuplesort_gettuple_common(Tuplesortstate *state, bool forward,
 			/*
 			 * This code should match the inner loop of mergeonerun().
 			 */
-			if (state->memtupcount > 0)
+			if (!losertree_empty(state->mergetree))
 			{
-				int			srcTapeIndex = state->memtuples[0].srctape;
+				int			srcTapeIndex = losertree_first(state->mergetree);
 				LogicalTape *srcTape = state->inputTapes[srcTapeIndex];
-				SortTuple	newtup;
 
-				*stup = state->memtuples[0];
+				*stup = state->memtuples[srcTapeIndex];
 
 				/*
 				 * Remember the tuple we return, so that we can recycle its
@@ -1655,16 +1960,17 @@ tuplesort_gettuple_common(Tuplesortstate *state, bool forward,
 				state->lastReturnedTuple = stup->tuple;
 
 				/*
-				 * Pull next tuple from tape, and replace the returned tuple
-				 * at top of the heap with it.
+				 * Pull next tuple from tape, and replay the tape's matches in
+				 * the tree with it.
 				 */
-				if (!mergereadnext(state, srcTape, &newtup))
+				if (!mergereadnext(state, srcTape,
+								   &state->memtuples[srcTapeIndex]))
 				{
 					/*
 					 * If no more data, we've reached end of run on this tape.
-					 * Remove the top node from the heap.
+					 * Retire the tape from the tree.
 					 */
-					tuplesort_heap_delete_top(state);
+					losertree_remove_first(state->mergetree);
 					state->nInputRuns--;
 
 					/*
@@ -1674,8 +1980,8 @@ tuplesort_gettuple_common(Tuplesortstate *state, bool forward,
 					LogicalTapeClose(srcTape);
 					return true;
 				}
-				newtup.srctape = srcTapeIndex;
-				tuplesort_heap_replace_top(state, &newtup);
+				state->memtuples[srcTapeIndex].srctape = srcTapeIndex;
+				losertree_replace_first(state->mergetree);
 				return true;
 			}
 			return false;
@@ -2003,6 +2309,7 @@ static void
 mergeruns(Tuplesortstate *state)
 {
 	int			tapenum;
+	MemoryContext oldcontext;
 
 	Assert(state->status == TSS_BUILDRUNS);
 	Assert(state->memtupcount == 0);
@@ -2056,18 +2363,25 @@ mergeruns(Tuplesortstate *state)
 		init_slab_allocator(state, 0);
 
 	/*
-	 * Allocate a new 'memtuples' array, for the heap.  It will hold one tuple
-	 * from each input tape.
+	 * Allocate a new 'memtuples' array, and the tree to merge with.  The
+	 * array will hold one tuple from each input tape.
 	 *
-	 * We could shrink this, too, between passes in a multi-pass merge, but we
-	 * don't bother.  (The initial input tapes are still in outputTapes.  The
-	 * number of input tapes will not increase between passes.)
+	 * We could shrink these, too, between passes in a multi-pass merge, but
+	 * we don't bother.  (The initial input tapes are still in outputTapes.
+	 * The number of input tapes will not increase between passes.)
 	 */
 	state->memtupsize = state->nOutputTapes;
 	state->memtuples = (SortTuple *) MemoryContextAlloc(state->base.maincontext,
 														state->nOutputTapes * sizeof(SortTuple));
 	USEMEM(state, GetMemoryChunkSpace(state->memtuples));
 
+	oldcontext = MemoryContextSwitchTo(state->base.maincontext);
+	state->mergetree = losertree_allocate(state->nOutputTapes,
+										  tuplesort_merge_compare,
+										  state);
+	MemoryContextSwitchTo(oldcontext);
+	USEMEM(state, GetMemoryChunkSpace(state->mergetree));
+
 	/*
 	 * Use all the remaining memory we have available for tape buffers among
 	 * all the input tapes.  At the beginning of each merge pass, we will
@@ -2185,54 +2499,56 @@ mergeruns(Tuplesortstate *state)
 static void
 mergeonerun(Tuplesortstate *state)
 {
+	losertree  *mergetree = state->mergetree;
 	int			srcTapeIndex;
 	LogicalTape *srcTape;
+	SortTuple  *stup;
 
 	/*
 	 * Start the merge by loading one tuple from each active source tape into
-	 * the heap.
+	 * the tree.
 	 */
 	beginmerge(state);
 
 	Assert(state->slabAllocatorUsed);
 
 	/*
-	 * Execute merge by repeatedly extracting lowest tuple in heap, writing it
-	 * out, and replacing it with next tuple from same tape (if there is
-	 * another one).
+	 * Execute merge by repeatedly writing out the lowest tuple, and replacing
+	 * it with next tuple from same tape (if there is another one).
 	 */
-	while (state->memtupcount > 0)
+	while (!losertree_empty(mergetree))
 	{
-		SortTuple	stup;
+		CHECK_FOR_INTERRUPTS();
 
 		/* write the tuple to destTape */
-		srcTapeIndex = state->memtuples[0].srctape;
+		srcTapeIndex = losertree_first(mergetree);
 		srcTape = state->inputTapes[srcTapeIndex];
-		WRITETUP(state, state->destTape, &state->memtuples[0]);
+		stup = &state->memtuples[srcTapeIndex];
+		WRITETUP(state, state->destTape, stup);
 
 		/* recycle the slot of the tuple we just wrote out, for the next read */
-		if (state->memtuples[0].tuple)
-			RELEASE_SLAB_SLOT(state, state->memtuples[0].tuple);
+		if (stup->tuple)
+			RELEASE_SLAB_SLOT(state, stup->tuple);
 
 		/*
-		 * pull next tuple from the tape, and replace the written-out tuple in
-		 * the heap with it.
+		 * pull next tuple from the tape, and replay the tape's matches in the
+		 * tree with it.
 		 */
-		if (mergereadnext(state, srcTape, &stup))
+		if (mergereadnext(state, srcTape, stup))
 		{
-			stup.srctape = srcTapeIndex;
-			tuplesort_heap_replace_top(state, &stup);
+			stup->srctape = srcTapeIndex;
+			losertree_replace_first(mergetree);
 		}
 		else
 		{
-			tuplesort_heap_delete_top(state);
+			losertree_remove_first(mergetree);
 			state->nInputRuns--;
 		}
 	}
 
 	/*
-	 * When the heap empties, we're done.  Write an end-of-run marker on the
-	 * output tape.
+	 * When all tapes are exhausted, we're done.  Write an end-of-run marker
+	 * on the output tape.
 	 */
 	markrunend(state->destTape);
 }
@@ -2240,7 +2556,7 @@ mergeonerun(Tuplesortstate *state)
 /*
  * beginmerge - initialize for a merge pass
  *
- * Fill the merge heap with the first tuple from each input tape.
+ * Load the first tuple from each input tape, and build the merge tree.
  */
 static void
 beginmerge(Tuplesortstate *state)
@@ -2248,21 +2564,23 @@ beginmerge(Tuplesortstate *state)
 	int			activeTapes;
 	int			srcTapeIndex;
 
-	/* Heap should be empty here */
+	/* The memtuples array is not used as a heap here */
 	Assert(state->memtupcount == 0);
 
 	activeTapes = Min(state->nInputTapes, state->nInputRuns);
 
+	losertree_reset(state->mergetree, activeTapes);
 	for (srcTapeIndex = 0; srcTapeIndex < activeTapes; srcTapeIndex++)
 	{
-		SortTuple	tup;
+		SortTuple  *tup = &state->memtuples[srcTapeIndex];
 
-		if (mergereadnext(state, state->inputTapes[srcTapeIndex], &tup))
+		if (mergereadnext(state, state->inputTapes[srcTapeIndex], tup))
 		{
-			tup.srctape = srcTapeIndex;
-			tuplesort_heap_insert(state, &tup);
+			tup->srctape = srcTapeIndex;
+			losertree_add_unordered(state->mergetree, srcTapeIndex);
 		}
 	}
+	losertree_build(state->mergetree);
 }
 
 /*
@@ -2671,6 +2989,11 @@ tuplesort_sort_memtuples(Tuplesortstate *state)
 		 */
 		if (state->base.haveDatum1 && state->base.sortKeys)
 		{
+			/* Larger inputs are better served by a radix sort */
+			if (state->memtupcount >= RADIX_SORT_MIN_TUPLES &&
+				radix_sort_memtuples(state))
+				return;
+
 			if (state->base.sortKeys[0].comparator == ssup_datum_unsigned_cmp)
 			{
 				qsort_tuple_unsigned(state->memtuples,
@@ -2710,6 +3033,18 @@ tuplesort_sort_memtuples(Tuplesortstate *state)
 	}
 }
 
+/*
+ * Comparator for the merge tree: compare the frontmost tuples of two input
+ * tapes.
+ */
+static int
+tuplesort_merge_compare(int a, int b, void *arg)
+{
+	Tuplesortstate *state = (Tuplesortstate *) arg;
+
+	return COMPARETUP(state, &state->memtuples[a], &state->memtuples[b]);
+}
+
 /*
  * Insert a new tuple into an empty or existing heap, maintaining the
  * heap invariant.  Caller is responsible for ensuring there's room.
@@ -2936,6 +3271,26 @@ tuplesort_initialize_shared(Sharedsort *shared, int nWorkers, dsm_segment *seg)
 	}
 }
 
+/*
+ * tuplesort_reset_shared - reset shared tuplesort state for another sort
+ *
+ * Must be called from leader process before workers are launched again, once
+ * all Tuplesortstates of the previous sort have been ended.  The shared
+ * fileset is kept; participants overwrite their files from the previous sort.
+ */
+void
+tuplesort_reset_shared(Sharedsort *shared)
+{
+	int			i;
+
+	shared->currentWorker = 0;
+	shared->workersFinished = 0;
+	for (i = 0; i < shared->nTapes; i++)
+	{
+		shared->tapes[i].firstblocknumber = 0L;
+	}
+}
+
 /*
  * tuplesort_attach_shared - attach to shared tuplesort state
  *
@@ -202,6 +202,12 @@ static Snapshot FirstXactSnapshot = NULL;
 /* Define pathname of exported-snapshot files */
 #define SNAPSHOT_EXPORT_DIR "pg_snapshots"
 
+/*
+ * Above this many XIDs, XidInMVCCSnapshot binary-searches the subxip array of
+ * a snapshot taken during recovery rather than scanning it.
+ */
+#define SUBXIP_BSEARCH_THRESHOLD 128
+
 /* Structure holding info about exported snapshot. */
 typedef struct ExportedSnapshot
 {
@@ -217,6 +223,8 @@ static Snapshot CopySnapshot(Snapshot snapshot);
 static void UnregisterSnapshotNoOwner(Snapshot snapshot);
 static void FreeSnapshot(Snapshot snapshot);
 static void SnapshotResetXmin(void);
+static bool XidInSortedArray(TransactionId xid, const TransactionId *xids,
+							 uint32 nxids);
 
 /* ResourceOwner callbacks to track snapshot references */
 static void ResOwnerReleaseSnapshot(Datum res);
@@ -1954,14 +1962,51 @@ XidInMVCCSnapshot(TransactionId xid, Snapshot snapshot)
 		 * We now have either a top-level xid higher than xmin or an
 		 * indeterminate xid. We don't know whether it's top level or subxact
 		 * but it doesn't matter. If it's present, the xid is visible.
+		 *
+		 * The xids were copied from KnownAssignedXids, so they're sorted.
+		 * Binary-search them if there are many, as there can be when the
+		 * primary runs many transactions or subtransactions at once.
 		 */
-		if (pg_lfind32(xid, snapshot->subxip, snapshot->subxcnt))
+		if (snapshot->subxcnt > SUBXIP_BSEARCH_THRESHOLD)
+		{
+			if (XidInSortedArray(xid, snapshot->subxip, snapshot->subxcnt))
+				return true;
+		}
+		else if (pg_lfind32(xid, snapshot->subxip, snapshot->subxcnt))
 			return true;
 	}
 
 	return false;
 }
 
+/*
+ * Is xid in the array xids[], which is sorted in TransactionIdPrecedes order?
+ *
+ * All the XIDs, including xid, must be within a range narrow enough for
+ * TransactionIdPrecedes to be a total order, as they are between the xmin and
+ * xmax of a snapshot.
+ */
+static bool
+XidInSortedArray(TransactionId xid, const TransactionId *xids, uint32 nxids)
+{
+	uint32		low = 0;
+	uint32		high = nxids;
+
+	while (low < high)
+	{
+		uint32		mid = low + (high - low) / 2;
+
+		if (xids[mid] == xid)
+			return true;
+		if (TransactionIdPrecedes(xids[mid], xid))
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return false;
+}
+
 /* ResourceOwner callbacks */
 
 static void
@@ -97,6 +97,7 @@ typedef struct AmcheckOptions
 	bool		on_error_stop;
 	int64		startblock;
 	int64		endblock;
+	int64		chunk_blocks;
 	const char *skip;
 
 	/* btree index checking options */
@@ -130,6 +131,7 @@ static AmcheckOptions opts = {
 	.on_error_stop = false,
 	.startblock = -1,
 	.endblock = -1,
+	.chunk_blocks = 131072,
 	.skip = "none",
 	.parent_check = false,
 	.rootdescend = false,
@@ -163,9 +165,19 @@ typedef struct RelationInfo
 	char	   *relname;
 	int			relpages;
 	int			blocks_to_check;
+	int64		startblock;		/* first block to check, or -1 */
+	int64		endblock;		/* last block to check, or -1 */
+	int			chunkno;		/* 0, or number of the chunk if split */
 	char	   *sql;			/* set during query run, pg_free'd after */
 } RelationInfo;
 
+/*
+ * SQL expression for the current number of blocks of relation c.
+ */
+#define RELATION_BLOCKS_SQL \
+	"(pg_catalog.pg_relation_size(c.oid) / " \
+	"pg_catalog.current_setting('block_size')::pg_catalog.int8)"
+
 /*
  * Query for determining if contrib's amcheck is installed.  If so, selects the
  * namespace name where amcheck's functions can be found.
@@ -272,6 +284,7 @@ main(int argc, char *argv[])
 		{"parent-check", no_argument, NULL, 12},
 		{"install-missing", optional_argument, NULL, 13},
 		{"checkunique", no_argument, NULL, 14},
+		{"heap-chunk-size", required_argument, NULL, 15},
 
 		{NULL, 0, NULL, 0}
 	};
@@ -442,6 +455,15 @@ main(int argc, char *argv[])
 			case 14:
 				opts.checkunique = true;
 				break;
+			case 15:
+				errno = 0;
+				optval = strtoul(optarg, &endptr, 10);
+				if (endptr == optarg || *endptr != '\0' || errno != 0)
+					pg_fatal("invalid chunk size");
+				if (optval > MaxBlockNumber)
+					pg_fatal("chunk size out of bounds");
+				opts.chunk_blocks = optval;
+				break;
 			default:
 				/* getopt_long already emitted a complaint */
 				pg_log_error_hint("Try \"%s --help\" for more information.", progname);
@@ -672,12 +694,15 @@ main(int argc, char *argv[])
 
 	/*
 	 * Set parallel_workers to the lesser of opts.jobs and the number of
-	 * relations.
+	 * relations, counting each chunk of a split table.
 	 */
 	parallel_workers = 0;
 	for (cell = relations.head; cell; cell = cell->next)
 	{
-		reltotal++;
+		RelationInfo *rel = (RelationInfo *) cell->ptr;
+
+		if (rel->chunkno <= 1)
+			reltotal++;
 		if (parallel_workers < opts.jobs)
 			parallel_workers++;
 	}
@@ -733,7 +758,8 @@ main(int argc, char *argv[])
 		progress_report(reltotal, relprogress, pagestotal, pageschecked,
 						latest_datname, false, false);
 
-		relprogress++;
+		if (rel->chunkno <= 1)
+			relprogress++;
 		pageschecked += rel->blocks_to_check;
 
 		/*
@@ -769,8 +795,13 @@ main(int argc, char *argv[])
 			{
 				if (opts.show_progress && progress_since_last_stderr)
 					fprintf(stderr, "\n");
-				pg_log_info("checking heap table \"%s.%s.%s\"",
-							rel->datinfo->datname, rel->nspname, rel->relname);
+				if (rel->chunkno > 0)
+					pg_log_info("checking heap table \"%s.%s.%s\" starting at block %lld",
+								rel->datinfo->datname, rel->nspname, rel->relname,
+								(long long) rel->startblock);
+				else
+					pg_log_info("checking heap table \"%s.%s.%s\"",
+								rel->datinfo->datname, rel->nspname, rel->relname);
 				progress_since_last_stderr = false;
 			}
 			prepare_heap_command(&sql, rel, free_slot->connection);
@@ -835,6 +866,10 @@ main(int argc, char *argv[])
  * The constructed SQL command will silently skip temporary tables, as checking
  * them would needlessly draw errors from the underlying amcheck function.
  *
+ * For a chunk of a split table, the block range is clamped to the current
+ * size of the table, since relpages, which the chunks were computed from,
+ * may be out of date.
+ *
  * sql: buffer into which the heap table checking command will be written
  * rel: relation information for the heap table to be checked
  * conn: the connection to be used, for string escaping purposes
@@ -852,15 +887,22 @@ prepare_heap_command(PQExpBuffer sql, RelationInfo *rel, PGconn *conn)
 					  opts.reconcile_toast ? "true" : "false",
 					  opts.skip);
 
-	if (opts.startblock >= 0)
-		appendPQExpBuffer(sql, ", startblock := " INT64_FORMAT, opts.startblock);
-	if (opts.endblock >= 0)
-		appendPQExpBuffer(sql, ", endblock := " INT64_FORMAT, opts.endblock);
+	if (rel->startblock >= 0)
+		appendPQExpBuffer(sql, ", startblock := " INT64_FORMAT, rel->startblock);
+	if (rel->endblock >= 0 && rel->chunkno > 0)
+		appendPQExpBuffer(sql, ", endblock := LEAST(" INT64_FORMAT ", %s - 1)",
+						  rel->endblock, RELATION_BLOCKS_SQL);
+	else if (rel->endblock >= 0)
+		appendPQExpBuffer(sql, ", endblock := " INT64_FORMAT, rel->endblock);
 
 	appendPQExpBuffer(sql,
 					  "\n) v WHERE c.oid = %u "
 					  "AND c.relpersistence != " CppAsString2(RELPERSISTENCE_TEMP),
 					  rel->reloid);
+
+	if (rel->chunkno > 1)
+		appendPQExpBuffer(sql, " AND " INT64_FORMAT " < %s",
+						  rel->startblock, RELATION_BLOCKS_SQL);
 }
 
 /*
@@ -1206,6 +1248,7 @@ help(const char *progname)
 	printf(_("      --skip=OPTION               do NOT check \"all-frozen\" or \"all-visible\" blocks\n"));
 	printf(_("      --startblock=BLOCK          begin checking table(s) at the given block number\n"));
 	printf(_("      --endblock=BLOCK            check table(s) only up to the given block number\n"));
+	printf(_("      --heap-chunk-size=BLOCKS    with --jobs, check larger tables in chunks of this size\n"));
 	printf(_("\nB-tree index checking options:\n"));
 	printf(_("      --checkunique               check unique constraint if index is unique\n"));
 	printf(_("      --heapallindexed            check that all heap tuples are found within indexes\n"));
@@ -2203,6 +2246,8 @@ compile_relation_list_one_db(PGconn *conn, SimplePtrList *relations,
 			/* Current record pertains to a relation */
 
 			RelationInfo *rel = (RelationInfo *) pg_malloc0(sizeof(RelationInfo));
+			int64		first,
+						last;
 
 			Assert(OidIsValid(oid));
 			Assert((is_heap && !is_btree) || (is_btree && !is_heap));
@@ -2214,6 +2259,13 @@ compile_relation_list_one_db(PGconn *conn, SimplePtrList *relations,
 			rel->relname = pstrdup(relname);
 			rel->relpages = relpages;
 			rel->blocks_to_check = relpages;
+			rel->startblock = -1;
+			rel->endblock = -1;
+			if (is_heap)
+			{
+				rel->startblock = opts.startblock;
+				rel->endblock = opts.endblock;
+			}
 			if (is_heap && (opts.startblock >= 0 || opts.endblock >= 0))
 			{
 				/*
@@ -2233,7 +2285,43 @@ compile_relation_list_one_db(PGconn *conn, SimplePtrList *relations,
 			}
 			*pagecount += rel->blocks_to_check;
 
-			simple_ptr_list_append(relations, rel);
+			/*
+			 * If we can check several relations at once, split large tables
+			 * into chunks of blocks to be checked in parallel, too.  The last
+			 * chunk extends to the end of the table (or --endblock), in case
+			 * the table has grown since relpages was last updated.
+			 */
+			first = Max(opts.startblock, 0);
+			last = first + rel->blocks_to_check - 1;
+			if (is_heap && opts.jobs > 1 && opts.chunk_blocks > 0 &&
+				rel->blocks_to_check > opts.chunk_blocks)
+			{
+				int64		start;
+				int			chunkno = 1;
+
+				for (start = first; start <= last; start += opts.chunk_blocks)
+				{
+					RelationInfo *chunk = (RelationInfo *) pg_malloc(sizeof(RelationInfo));
+
+					memcpy(chunk, rel, sizeof(RelationInfo));
+					chunk->chunkno = chunkno++;
+					chunk->startblock = start;
+					if (last - start + 1 > opts.chunk_blocks)
+					{
+						chunk->endblock = start + opts.chunk_blocks - 1;
+						chunk->blocks_to_check = opts.chunk_blocks;
+					}
+					else
+					{
+						chunk->endblock = opts.endblock;
+						chunk->blocks_to_check = last - start + 1;
+					}
+					simple_ptr_list_append(relations, chunk);
+				}
+				pg_free(rel);
+			}
+			else
+				simple_ptr_list_append(relations, rel);
 		}
 	}
 	PQclear(res);
@@ -512,6 +512,34 @@ $node->command_checks_all(
 	'pg_amcheck over schema s2 with corrupt tables excluded reports no corruption'
 );
 
+# Check a table split into chunks of blocks that are checked in parallel.
+#
+$node->safe_psql(
+	'db1', qq(
+	CREATE TABLE s2.chunked AS
+		SELECT gs AS i, repeat('x', 100) AS t
+		FROM generate_series(1, 2000) AS gs;
+	VACUUM s2.chunked;
+));
+
+$node->command_checks_all(
+	[
+		@cmd,
+		'--table' => 's2.chunked',
+		'--jobs' => '3',
+		'--heap-chunk-size' => '10',
+		'db1'
+	],
+	0,
+	[$no_output_re],
+	[$no_output_re],
+	'pg_amcheck over table checked in chunks reports no corruption');
+
+command_fails_like(
+	[ @cmd, '--schema' => 's5', '--heap-chunk-size' => 'junk', 'db1' ],
+	qr/invalid chunk size/,
+	'pg_amcheck rejects garbage heap-chunk-size');
+
 # Check errors about bad block range command line arguments.  We use schema s5
 # to avoid getting messages about corrupt tables or indexes.
 #
@@ -20,6 +20,9 @@
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <signal.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
 #include <time.h>
 #ifdef HAVE_LIBZ
 #include <zlib.h>
@@ -107,6 +110,11 @@ typedef void (*WriteDataCallback) (size_t nbytes, char *buf,
  */
 #define MINIMUM_VERSION_FOR_WAL_SUMMARIES 170000
 
+/*
+ * Parallel backups are supported from version 19.
+ */
+#define MINIMUM_VERSION_FOR_PARALLEL_BACKUP 190000
+
 /*
  * Different ways to include WAL
  */
@@ -155,6 +163,7 @@ static bool manifest = true;
 static bool manifest_force_encode = false;
 static char *manifest_checksums = NULL;
 static DataDirSyncMethod sync_method = DATA_DIR_SYNC_METHOD_FSYNC;
+static int	num_jobs = 1;
 
 static bool success = false;
 static bool made_new_pgdata = false;
@@ -182,6 +191,23 @@ static bool in_log_streamer = false;
 /* Flag to indicate if child process exited unexpectedly */
 static volatile sig_atomic_t bgchild_exited = false;
 
+/*
+ * The other processes of a parallel backup, each receiving the archives sent
+ * over one connection; see StartBackupJobs().  The leader is job 0.
+ */
+static pid_t *job_pids = NULL;
+static int	njobs_started = 0;
+static int	current_job = 0;
+static bool in_backup_job = false;
+
+/* Bytes received by each job, in memory shared by all of them */
+static uint64 *job_progress = NULL;
+
+/* Pipe whose closing tells the jobs that they may exit */
+#ifndef WIN32
+static int	jobpipe[2] = {-1, -1};
+#endif
+
 /* End position for xlog streaming, empty string if unknown yet */
 static XLogRecPtr xlogendptr;
 
@@ -236,7 +262,7 @@ static void tablespace_list_append(const char *arg);
 static void
 cleanup_directories_atexit(void)
 {
-	if (success || in_log_streamer)
+	if (success || in_log_streamer || in_backup_job)
 		return;
 
 	if (!noclean && !checksum_failure)
@@ -311,6 +337,19 @@ kill_bgchild_atexit(void)
 	if (bgchild > 0 && !bgchild_exited)
 		kill(bgchild, SIGTERM);
 }
+
+/*
+ * Likewise for the other jobs of a parallel backup.
+ */
+static void
+kill_backup_jobs_atexit(void)
+{
+	for (int i = 0; i < njobs_started; i++)
+	{
+		if (job_pids[i] > 0)
+			kill(job_pids[i], SIGTERM);
+	}
+}
 #endif
 
 /*
@@ -418,6 +457,8 @@ usage(void)
 	printf(_("  -c, --checkpoint=fast|spread\n"
 			 "                         set fast or spread (default) checkpointing\n"));
 	printf(_("  -C, --create-slot      create replication slot\n"));
+	printf(_("  -j, --jobs=NUM         use this many parallel connections to transfer\n"
+			 "                         the data files\n"));
 	printf(_("  -l, --label=LABEL      set backup label\n"));
 	printf(_("  -n, --no-clean         do not clean up after errors\n"));
 	printf(_("  -N, --no-sync          do not wait for changes to be written safely to disk\n"));
@@ -818,19 +859,28 @@ static void
 progress_report(int tablespacenum, bool force, bool finished)
 {
 	int			percent;
+	uint64		done = totaldone;
 	char		totaldone_str[32];
 	char		totalsize_str[32];
 	pg_time_t	now;
 
-	if (!showprogress)
+	/* In a parallel backup, only the leader reports progress. */
+	if (!showprogress || in_backup_job)
 		return;
 
 	now = time(NULL);
 	if (now == last_progress_report && !force && !finished)
 		return;					/* Max once per second */
 
+	/* Count what the other jobs of a parallel backup have received, too. */
+	if (job_progress != NULL)
+	{
+		for (int i = 1; i < num_jobs; i++)
+			done += job_progress[i];
+	}
+
 	last_progress_report = now;
-	percent = totalsize_kb ? (int) ((totaldone / 1024) * 100 / totalsize_kb) : 0;
+	percent = totalsize_kb ? (int) ((done / 1024) * 100 / totalsize_kb) : 0;
 
 	/*
 	 * Avoid overflowing past 100% or the full size. This may make the total
@@ -840,11 +890,11 @@ progress_report(int tablespacenum, bool force, bool finished)
 	 */
 	if (percent > 100)
 		percent = 100;
-	if (totaldone / 1024 > totalsize_kb)
-		totalsize_kb = totaldone / 1024;
+	if (done / 1024 > totalsize_kb)
+		totalsize_kb = done / 1024;
 
 	snprintf(totaldone_str, sizeof(totaldone_str), UINT64_FORMAT,
-			 totaldone / 1024);
+			 done / 1024);
 	snprintf(totalsize_str, sizeof(totalsize_str), UINT64_FORMAT, totalsize_kb);
 
 #define VERBOSE_FILENAME_LENGTH 35
@@ -1164,7 +1214,8 @@ CreateBackupStreamer(char *archive_name, char *spclocation,
 			directory = get_tablespace_mapping(spclocation);
 		streamer = astreamer_extractor_new(directory,
 										   get_tablespace_mapping,
-										   progress_update_filename);
+										   progress_update_filename,
+										   num_jobs > 1);
 	}
 	else
 	{
@@ -1457,6 +1508,8 @@ ReceiveArchiveStreamChunk(size_t r, char *copybuf, void *callback_data)
 				 */
 				totaldone = GetCopyDataUInt64(r, copybuf, &cursor);
 				GetCopyDataEnd(r, copybuf, cursor);
+				if (job_progress != NULL)
+					job_progress[current_job] = totaldone;
 
 				/*
 				 * The server shouldn't send progress report messages too
@@ -1751,6 +1804,160 @@ ReceiveBackupManifestInMemoryChunk(size_t r, char *copybuf,
 	appendPQExpBuffer(buf, copybuf, r);
 }
 
+#ifndef WIN32
+/*
+ * Main function of a job of a parallel backup: join the backup with the
+ * given BASE_BACKUP command, and extract the archives we receive.
+ */
+static int
+BackupJobMain(int job, const char *command,
+			  pg_compress_specification *client_compress)
+{
+	PGresult   *res;
+	char		c;
+
+	/*
+	 * The leader's connection, WAL receiver and output directories are none
+	 * of our business, so make sure that our exit leaves them alone.
+	 */
+	in_backup_job = true;
+	current_job = job;
+	conn = NULL;
+	bgchild = -1;
+	njobs_started = 0;
+	writerecoveryconf = false;
+	close(jobpipe[1]);
+
+	conn = GetConnection();
+	if (!conn)
+		/* Error message already written in GetConnection() */
+		exit(1);
+
+	if (PQsendQuery(conn, command) == 0)
+		pg_fatal("could not send replication command \"%s\": %s",
+				 "BASE_BACKUP", PQerrorMessage(conn));
+
+	/* We know the start position and the tablespaces already. */
+	for (int i = 0; i < 2; i++)
+	{
+		res = PQgetResult(conn);
+		if (PQresultStatus(res) != PGRES_TUPLES_OK)
+			pg_fatal("could not initiate base backup: %s",
+					 PQerrorMessage(conn));
+		PQclear(res);
+	}
+
+	ReceiveArchiveStream(conn, client_compress);
+
+	/* The end position we get is meaningless, so just check for errors. */
+	res = PQgetResult(conn);
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		pg_fatal("backup failed: %s",
+				 PQerrorMessage(conn));
+	PQclear(res);
+
+	res = PQgetResult(conn);
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+		pg_fatal("final receive failed: %s",
+				 PQerrorMessage(conn));
+	PQclear(res);
+
+	PQfinish(conn);
+	conn = NULL;
+
+	/* Don't exit until the leader closes the pipe; see StartBackupJobs(). */
+	while (read(jobpipe[0], &c, 1) < 0 && errno == EINTR)
+		;
+
+	return 0;
+}
+
+/*
+ * Start the other jobs of a parallel backup.
+ *
+ * Each job is a process of its own, which opens another replication
+ * connection to join the backup that we have started, and extracts the
+ * archives it receives into the same directories as we do.  The server
+ * sends every file over only one of the connections.
+ *
+ * A job that has received everything doesn't exit until we close the write
+ * end of jobpipe, because its exit would trigger our SIGCHLD handler, which
+ * takes any child exiting while we're receiving data as a failure.  We close
+ * the pipe once our own share of the backup has been received, at which
+ * point the server has sent the jobs' shares, too.
+ */
+static void
+StartBackupJobs(const char *command,
+				pg_compress_specification *client_compress)
+{
+	if (pipe(jobpipe) < 0)
+		pg_fatal("could not create pipe for background process: %m");
+
+	job_progress = mmap(NULL, num_jobs * sizeof(uint64),
+						PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+						-1, 0);
+	if (job_progress == MAP_FAILED)
+		pg_fatal("could not allocate shared memory: %m");
+	memset(job_progress, 0, num_jobs * sizeof(uint64));
+
+	job_pids = pg_malloc_array(pid_t, num_jobs - 1);
+	atexit(kill_backup_jobs_atexit);
+
+	if (verbose)
+		pg_log_info("starting %d parallel backup jobs", num_jobs - 1);
+
+	for (int i = 1; i < num_jobs; i++)
+	{
+		pid_t		pid;
+
+		/* Don't let the child write out our buffered output again. */
+		fflush(NULL);
+
+		pid = fork();
+		if (pid == 0)
+		{
+			/* in child process */
+			exit(BackupJobMain(i, command, client_compress));
+		}
+		else if (pid < 0)
+			pg_fatal("could not create background process: %m");
+
+		job_pids[njobs_started++] = pid;
+	}
+
+	close(jobpipe[0]);
+}
+
+/*
+ * Let the jobs of a parallel backup exit, and check that all of them
+ * succeeded.
+ */
+static void
+WaitForBackupJobs(void)
+{
+	close(jobpipe[1]);
+
+	for (int i = 0; i < njobs_started; i++)
+	{
+		int			status;
+		pid_t		r;
+
+		r = waitpid(job_pids[i], &status, 0);
+		if (r == (pid_t) -1)
+			pg_fatal("could not wait for child process: %m");
+		job_pids[i] = -1;
+		if (status != 0)
+			pg_fatal("%s", wait_result_to_str(status));
+	}
+
+	/*
+	 * The jobs' exits have set bgchild_exited, but that flag is about the WAL
+	 * receiver, whose exit status we check separately anyway.
+	 */
+	bgchild_exited = false;
+}
+#endif							/* !WIN32 */
+
 static void
 BaseBackup(char *compression_algorithm, char *compression_detail,
 		   CompressionLocation compressloc,
@@ -1772,9 +1979,12 @@ BaseBackup(char *compression_algorithm, char *compression_detail,
 	int			writing_to_stdout;
 	bool		use_new_option_syntax = false;
 	PQExpBufferData buf;
+	PQExpBufferData jobbuf;
+	char	   *jobcmd = NULL;
 
 	Assert(conn != NULL);
 	initPQExpBuffer(&buf);
+	initPQExpBuffer(&jobbuf);
 
 	/*
 	 * Check server version. BASE_BACKUP command was introduced in 9.1, so we
@@ -1897,6 +2107,33 @@ BaseBackup(char *compression_algorithm, char *compression_detail,
 		AppendPlainCommandOption(&buf, use_new_option_syntax, "INCREMENTAL");
 	}
 
+	/*
+	 * The other jobs of a parallel backup send a BASE_BACKUP command of their
+	 * own, with only the options that affect how their files are sent.
+	 */
+	if (num_jobs > 1)
+	{
+		if (serverVersion < MINIMUM_VERSION_FOR_PARALLEL_BACKUP)
+			pg_fatal("server does not support parallel backup");
+		AppendIntegerCommandOption(&buf, use_new_option_syntax, "PARALLEL",
+								   num_jobs);
+
+		AppendStringCommandOption(&jobbuf, true, "LABEL", label);
+		if (maxrate > 0)
+			AppendIntegerCommandOption(&jobbuf, true, "MAX_RATE", maxrate);
+		if (!verify_checksums)
+			AppendIntegerCommandOption(&jobbuf, true, "VERIFY_CHECKSUMS", 0);
+		AppendStringCommandOption(&jobbuf, true, "TARGET", "client");
+		if (compressloc == COMPRESS_LOCATION_SERVER)
+		{
+			AppendStringCommandOption(&jobbuf, true, "COMPRESSION",
+									  compression_algorithm);
+			if (compression_detail != NULL)
+				AppendStringCommandOption(&jobbuf, true, "COMPRESSION_DETAIL",
+										  compression_detail);
+		}
+	}
+
 	/*
 	 * Continue building up the options list for the BASE_BACKUP command.
 	 */
@@ -2010,6 +2247,26 @@ BaseBackup(char *compression_algorithm, char *compression_detail,
 		pg_fatal("could not send replication command \"%s\": %s",
 				 "BASE_BACKUP", PQerrorMessage(conn));
 
+	/*
+	 * In a parallel backup, the server first tells us how the other jobs can
+	 * join the backup.
+	 */
+	if (num_jobs > 1)
+	{
+		res = PQgetResult(conn);
+		if (PQresultStatus(res) != PGRES_TUPLES_OK)
+			pg_fatal("could not initiate base backup: %s",
+					 PQerrorMessage(conn));
+		if (PQntuples(res) != 1 || PQnfields(res) != 1)
+			pg_fatal("server returned unexpected response to BASE_BACKUP command; got %d rows and %d fields, expected %d rows and %d fields",
+					 PQntuples(res), PQnfields(res), 1, 1);
+
+		AppendStringCommandOption(&jobbuf, true, "PARALLEL_WORKER",
+								  PQgetvalue(res, 0, 0));
+		jobcmd = psprintf("BASE_BACKUP (%s)", jobbuf.data);
+		PQclear(res);
+	}
+
 	/*
 	 * Get the starting WAL location
 	 */
@@ -2125,8 +2382,18 @@ BaseBackup(char *compression_algorithm, char *compression_detail,
 
 	if (serverMajor >= 1500)
 	{
+#ifndef WIN32
+		if (num_jobs > 1)
+			StartBackupJobs(jobcmd, client_compress);
+#endif
+
 		/* Receive a single tar stream with everything. */
 		ReceiveArchiveStream(conn, client_compress);
+
+#ifndef WIN32
+		if (num_jobs > 1)
+			WaitForBackupJobs();
+#endif
 	}
 	else
 	{
@@ -2362,6 +2629,7 @@ main(int argc, char **argv)
 		{"pgdata", required_argument, NULL, 'D'},
 		{"format", required_argument, NULL, 'F'},
 		{"incremental", required_argument, NULL, 'i'},
+		{"jobs", required_argument, NULL, 'j'},
 		{"checkpoint", required_argument, NULL, 'c'},
 		{"create-slot", no_argument, NULL, 'C'},
 		{"max-rate", required_argument, NULL, 'r'},
@@ -2424,7 +2692,7 @@ main(int argc, char **argv)
 
 	atexit(cleanup_directories_atexit);
 
-	while ((c = getopt_long(argc, argv, "c:Cd:D:F:h:i:l:nNp:Pr:Rs:S:t:T:U:vwWX:zZ:",
+	while ((c = getopt_long(argc, argv, "c:Cd:D:F:h:i:j:l:nNp:Pr:Rs:S:t:T:U:vwWX:zZ:",
 							long_options, &option_index)) != -1)
 	{
 		switch (c)
@@ -2462,6 +2730,11 @@ main(int argc, char **argv)
 			case 'i':
 				incremental_manifest = pg_strdup(optarg);
 				break;
+			case 'j':
+				if (!option_parse_int(optarg, "-j/--jobs", 1,
+									  MAX_PARALLEL_BACKUP, &num_jobs))
+					exit(1);
+				break;
 			case 'l':
 				label = pg_strdup(optarg);
 				break;
@@ -2692,6 +2965,35 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
+	/*
+	 * The archives of a parallel backup are extracted into the same
+	 * directories concurrently, which only works with plain format.
+	 */
+	if (num_jobs > 1)
+	{
+#ifdef WIN32
+		pg_fatal("parallel backups are not supported on this platform");
+#endif
+		if (backup_target != NULL)
+		{
+			pg_log_error("parallel backup is not possible when a backup target is specified");
+			pg_log_error_hint("Try \"%s --help\" for more information.", progname);
+			exit(1);
+		}
+		if (format != 'p')
+		{
+			pg_log_error("only plain format backups can be taken in parallel");
+			pg_log_error_hint("Try \"%s --help\" for more information.", progname);
+			exit(1);
+		}
+		if (incremental_manifest != NULL)
+		{
+			pg_log_error("incremental backups cannot be taken in parallel");
+			pg_log_error_hint("Try \"%s --help\" for more information.", progname);
+			exit(1);
+		}
+	}
+
 	/*
 	 * Sanity checks for WAL method.
 	 */
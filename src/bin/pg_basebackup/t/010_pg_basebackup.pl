@@ -1070,6 +1070,31 @@ $backupdir = $node->backup_dir . '/backup3';
 my @dst_tblspc = glob "$backupdir/pg_tblspc/$tblspc_oid/PG_*";
 is(@dst_tblspc, 1, 'tblspc directory copied');
 
+# Test a parallel backup. Each connection sends only part of the files, so
+# check that none are missing by verifying the backup against its manifest.
+$node->safe_psql('postgres',
+	'CREATE TABLE parallel_test AS SELECT generate_series(1, 10000) AS a;');
+$node->command_ok(
+	[
+		@pg_basebackup_defs,
+		'--pgdata' => "$tempdir/backup_parallel",
+		'--jobs' => '3',
+	],
+	'pg_basebackup with --jobs runs');
+$node->command_ok([ 'pg_verifybackup', "$tempdir/backup_parallel" ],
+	'parallel backup can be verified');
+rmtree("$tempdir/backup_parallel");
+
+$node->command_fails_like(
+	[
+		@pg_basebackup_defs,
+		'--pgdata' => "$tempdir/backup_parallel",
+		'--format' => 'tar',
+		'--jobs' => '2',
+	],
+	qr/only plain format backups can be taken in parallel/,
+	'pg_basebackup with --jobs requires plain format');
+
 # Can't take backup with referring manifest of different cluster
 #
 # Set up another new database instance with force initdb option. We don't want
@@ -15,6 +15,11 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <limits.h>
+#ifndef WIN32
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#endif
 
 #ifdef HAVE_COPYFILE_H
 #include <copyfile.h>
@@ -80,6 +85,7 @@ typedef struct cb_options
 	bool		no_manifest;
 	DataDirSyncMethod sync_method;
 	CopyMethod	copy_method;
+	int			jobs;
 } cb_options;
 
 /*
@@ -98,15 +104,58 @@ typedef struct cb_tablespace
 	struct cb_tablespace *next;
 } cb_tablespace;
 
+/*
+ * A file to be copied or reconstructed into the output directory.
+ *
+ * For an incremental file, manifest_prefix is the prefix of its manifest
+ * path, which the reconstruction code needs in order to look up the
+ * corresponding files in the prior backups; for any other file, it's NULL.
+ * bare_file_name is the name of the output file, without any directory.
+ */
+typedef struct cb_file_task
+{
+	char	   *ifullpath;
+	char	   *ofullpath;
+	char	   *manifest_prefix;
+	char	   *bare_file_name;
+	char	   *manifest_path;
+	char	   *input_directory;
+	pg_checksum_type checksum_type;
+} cb_file_task;
+
+/*
+ * What we need to know about an output file to generate its manifest entry.
+ */
+typedef struct cb_file_result
+{
+	uint64		size;
+	time_t		mtime;
+	int			checksum_length;
+	uint8		checksum_payload[PG_CHECKSUM_MAX_LENGTH];
+} cb_file_result;
+
 /* Directories to be removed if we exit uncleanly. */
 static cb_cleanup_dir *cleanup_dir_list = NULL;
 
+/* Files waiting to be processed by parallel jobs. */
+static cb_file_task *file_tasks = NULL;
+static int	n_file_tasks = 0;
+static int	max_file_tasks = 0;
+
 static void add_tablespace_mapping(cb_options *opt, char *arg);
 static StringInfo check_backup_label_files(int n_backups, char **backup_dirs);
 static uint64 check_control_files(int n_backups, char **backup_dirs);
 static void check_input_dir_permissions(char *dir);
 static void cleanup_directories_atexit(void);
 static void create_output_directory(char *dirname, cb_options *opt);
+#ifndef WIN32
+static int	file_task_worker(int fd, int n_prior_backups,
+							 char **prior_backup_dirs,
+							 manifest_data **manifests,
+							 bool want_result, cb_options *opt,
+							 cb_file_result *results);
+#endif
+static void free_file_task(cb_file_task *task);
 static void help(const char *progname);
 static bool parse_oid(char *s, Oid *result);
 static void process_directory_recursively(Oid tsoid,
@@ -118,6 +167,20 @@ static void process_directory_recursively(Oid tsoid,
 										  manifest_data **manifests,
 										  manifest_writer *mwriter,
 										  cb_options *opt);
+static void process_file(cb_file_task *task,
+						 int n_prior_backups,
+						 char **prior_backup_dirs,
+						 manifest_data **manifests,
+						 bool want_result,
+						 cb_options *opt,
+						 cb_file_result *result);
+#ifndef WIN32
+static void process_file_tasks(int n_prior_backups,
+							   char **prior_backup_dirs,
+							   manifest_data **manifests,
+							   manifest_writer *mwriter,
+							   cb_options *opt);
+#endif
 static void remember_to_cleanup_directory(char *target_path, bool rmtopdir);
 static void reset_directory_cleanup_list(void);
 static cb_tablespace *scan_for_existing_tablespaces(char *pathname,
@@ -133,6 +196,7 @@ main(int argc, char *argv[])
 	static struct option long_options[] = {
 		{"debug", no_argument, NULL, 'd'},
 		{"dry-run", no_argument, NULL, 'n'},
+		{"jobs", required_argument, NULL, 'j'},
 		{"no-sync", no_argument, NULL, 'N'},
 		{"output", required_argument, NULL, 'o'},
 		{"tablespace-mapping", required_argument, NULL, 'T'},
@@ -173,9 +237,10 @@ main(int argc, char *argv[])
 	opt.manifest_checksums = CHECKSUM_TYPE_CRC32C;
 	opt.sync_method = DATA_DIR_SYNC_METHOD_FSYNC;
 	opt.copy_method = COPY_METHOD_COPY;
+	opt.jobs = 1;
 
 	/* process command-line options */
-	while ((c = getopt_long(argc, argv, "dknNo:T:",
+	while ((c = getopt_long(argc, argv, "dj:knNo:T:",
 							long_options, &optindex)) != -1)
 	{
 		switch (c)
@@ -184,6 +249,11 @@ main(int argc, char *argv[])
 				opt.debug = true;
 				pg_logging_increase_verbosity();
 				break;
+			case 'j':
+				if (!option_parse_int(optarg, "-j/--jobs", 1, INT_MAX,
+									  &opt.jobs))
+					exit(1);
+				break;
 			case 'k':
 				opt.copy_method = COPY_METHOD_LINK;
 				break;
@@ -242,6 +312,11 @@ main(int argc, char *argv[])
 	if (opt.no_manifest)
 		opt.manifest_checksums = CHECKSUM_TYPE_NONE;
 
+#ifdef WIN32
+	if (opt.jobs > 1)
+		pg_fatal("parallel jobs are not supported on this platform");
+#endif
+
 	if (opt.dry_run)
 		pg_log_info("Executing in dry-run mode.\n"
 					"The target directory will not be modified.");
@@ -422,6 +497,13 @@ main(int argc, char *argv[])
 									  manifests, mwriter, &opt);
 	}
 
+#ifndef WIN32
+	/* If we're using parallel jobs, the files still need to be processed. */
+	if (opt.jobs > 1)
+		process_file_tasks(n_prior_backups, prior_backup_dirs, manifests,
+						   mwriter, &opt);
+#endif
+
 	/* Finalize the backup_manifest, if we're generating one. */
 	if (mwriter != NULL)
 		finalize_manifest(mwriter,
@@ -765,6 +847,51 @@ create_output_directory(char *dirname, cb_options *opt)
 	}
 }
 
+#ifndef WIN32
+/*
+ * Main loop of a parallel job: process the files whose indexes we read from
+ * the pipe, until the leader closes it.
+ *
+ * The leader writes each index with a single write() of sizeof(int) bytes,
+ * which is atomic, so a read() of the same size never gets a partial index
+ * even though all the jobs read from the same pipe.
+ */
+static int
+file_task_worker(int fd, int n_prior_backups, char **prior_backup_dirs,
+				 manifest_data **manifests, bool want_result,
+				 cb_options *opt, cb_file_result *results)
+{
+	int			taskno;
+	ssize_t		rc;
+
+	while ((rc = read(fd, &taskno, sizeof(taskno))) == sizeof(taskno))
+		process_file(&file_tasks[taskno], n_prior_backups, prior_backup_dirs,
+					 manifests, want_result, opt, &results[taskno]);
+
+	if (rc < 0)
+		pg_fatal("could not read from pipe: %m");
+	else if (rc != 0)
+		pg_fatal("could not read from pipe: read %d of %d",
+				 (int) rc, (int) sizeof(taskno));
+
+	return 0;
+}
+#endif							/* !WIN32 */
+
+/*
+ * Free the memory allocated for a file task.
+ */
+static void
+free_file_task(cb_file_task *task)
+{
+	pfree(task->ifullpath);
+	pfree(task->ofullpath);
+	if (task->manifest_prefix != NULL)
+		pfree(task->manifest_prefix);
+	pfree(task->bare_file_name);
+	pfree(task->manifest_path);
+}
+
 /*
  * help
  *
@@ -780,6 +907,7 @@ help(const char *progname)
 	printf(_("  %s [OPTION]... DIRECTORY...\n"), progname);
 	printf(_("\nOptions:\n"));
 	printf(_("  -d, --debug               generate lots of debugging output\n"));
+	printf(_("  -j, --jobs=NUM            use this many parallel jobs to process files\n"));
 	printf(_("  -k, --link                link files instead of copying\n"));
 	printf(_("  -n, --dry-run             do not actually do anything\n"));
 	printf(_("  -N, --no-sync             do not wait for changes to be written safely to disk\n"));
@@ -858,7 +986,6 @@ process_directory_recursively(Oid tsoid,
 	bool		is_pg_tblspc = false;
 	bool		is_pg_wal = false;
 	bool		is_incremental_dir = false;
-	manifest_data *latest_manifest = manifests[n_prior_backups];
 	pg_checksum_type checksum_type;
 
 	/*
@@ -955,12 +1082,8 @@ process_directory_recursively(Oid tsoid,
 	{
 		PGFileType	type;
 		char		ifullpath[MAXPGPATH];
-		char		ofullpath[MAXPGPATH];
-		char		manifest_path[MAXPGPATH];
 		Oid			oid = InvalidOid;
-		int			checksum_length = 0;
-		uint8	   *checksum_payload = NULL;
-		pg_checksum_context checksum_ctx;
+		cb_file_task task;
 
 		/* Ignore "." and ".." entries. */
 		if (strcmp(de->d_name, ".") == 0 ||
@@ -1027,143 +1150,328 @@ process_directory_recursively(Oid tsoid,
 			 strcmp(de->d_name, "backup_manifest") == 0))
 			continue;
 
-		/*
-		 * If it's an incremental file, hand it off to the reconstruction
-		 * code, which will figure out what to do.
-		 */
+		/* Describe the work to be done for this file. */
+		task.ifullpath = pstrdup(ifullpath);
+		task.input_directory = input_directory;
+		task.checksum_type = checksum_type;
 		if (is_incremental_dir &&
 			strncmp(de->d_name, INCREMENTAL_PREFIX,
 					INCREMENTAL_PREFIX_LENGTH) == 0)
 		{
-			/* Output path should not include "INCREMENTAL." prefix. */
-			snprintf(ofullpath, MAXPGPATH, "%s/%s", ofulldir,
-					 de->d_name + INCREMENTAL_PREFIX_LENGTH);
-
-
-			/* Manifest path likewise omits incremental prefix. */
-			snprintf(manifest_path, MAXPGPATH, "%s%s", manifest_prefix,
-					 de->d_name + INCREMENTAL_PREFIX_LENGTH);
-
-			/* Reconstruction logic will do the rest. */
-			reconstruct_from_incremental_file(ifullpath, ofullpath,
-											  manifest_prefix,
-											  de->d_name + INCREMENTAL_PREFIX_LENGTH,
-											  n_prior_backups,
-											  prior_backup_dirs,
-											  manifests,
-											  manifest_path,
-											  checksum_type,
-											  &checksum_length,
-											  &checksum_payload,
-											  opt->copy_method,
-											  opt->debug,
-											  opt->dry_run);
+			/*
+			 * It's an incremental file, so it will be handed off to the
+			 * reconstruction code. Output and manifest paths should not
+			 * include the "INCREMENTAL." prefix.
+			 */
+			task.manifest_prefix = pstrdup(manifest_prefix);
+			task.bare_file_name =
+				pstrdup(de->d_name + INCREMENTAL_PREFIX_LENGTH);
 		}
 		else
 		{
-			/* Construct the path that the backup_manifest will use. */
-			snprintf(manifest_path, MAXPGPATH, "%s%s", manifest_prefix,
-					 de->d_name);
+			task.manifest_prefix = NULL;
+			task.bare_file_name = pstrdup(de->d_name);
+		}
+		task.ofullpath = psprintf("%s/%s", ofulldir, task.bare_file_name);
+		task.manifest_path = psprintf("%s%s", manifest_prefix,
+									  task.bare_file_name);
 
-			/*
-			 * It's not an incremental file, so we need to copy the entire
-			 * file to the output directory.
-			 *
-			 * If a checksum of the required type already exists in the
-			 * backup_manifest for the final input directory, we can save some
-			 * work by reusing that checksum instead of computing a new one.
-			 */
-			if (checksum_type != CHECKSUM_TYPE_NONE &&
-				latest_manifest != NULL)
+		/*
+		 * If the files are to be processed in parallel, just remember the
+		 * task for later; see process_file_tasks(). Otherwise, do it now.
+		 */
+		if (opt->jobs > 1)
+		{
+			if (n_file_tasks == max_file_tasks)
 			{
-				manifest_file *mfile;
-
-				mfile = manifest_files_lookup(latest_manifest->files,
-											  manifest_path);
-				if (mfile == NULL)
-				{
-					char	   *bmpath;
-
-					/*
-					 * The directory is out of sync with the backup_manifest,
-					 * so emit a warning.
-					 */
-					bmpath = psprintf("%s/%s", input_directory,
-									  "backup_manifest");
-					pg_log_warning("manifest file \"%s\" contains no entry for file \"%s\"",
-								   bmpath, manifest_path);
-					pfree(bmpath);
-				}
-				else if (mfile->checksum_type == checksum_type)
-				{
-					checksum_length = mfile->checksum_length;
-					checksum_payload = mfile->checksum_payload;
-				}
+				max_file_tasks = Max(max_file_tasks * 2, 1024);
+				file_tasks = pg_realloc_array(file_tasks, cb_file_task,
+											  max_file_tasks);
 			}
+			file_tasks[n_file_tasks++] = task;
+		}
+		else
+		{
+			cb_file_result result;
+
+			process_file(&task, n_prior_backups, prior_backup_dirs,
+						 manifests, mwriter != NULL, opt, &result);
+			if (mwriter != NULL)
+				add_file_to_manifest(mwriter, task.manifest_path,
+									 result.size, result.mtime,
+									 task.checksum_type,
+									 result.checksum_length,
+									 result.checksum_payload);
+			free_file_task(&task);
+		}
+	}
 
-			/*
-			 * If we're reusing a checksum, then we don't need copy_file() to
-			 * compute one for us, but otherwise, it needs to compute whatever
-			 * type of checksum we need.
-			 */
-			if (checksum_length != 0)
-				pg_checksum_init(&checksum_ctx, CHECKSUM_TYPE_NONE);
-			else
-				pg_checksum_init(&checksum_ctx, checksum_type);
+	closedir(dir);
+}
 
-			/* Actually copy the file. */
-			snprintf(ofullpath, MAXPGPATH, "%s/%s", ofulldir, de->d_name);
-			copy_file(ifullpath, ofullpath, &checksum_ctx,
-					  opt->copy_method, opt->dry_run);
+/*
+ * Copy or reconstruct one file into the output directory.
+ *
+ * If want_result is true, *result is filled in with the data needed for the
+ * file's backup_manifest entry.
+ */
+static void
+process_file(cb_file_task *task,
+			 int n_prior_backups,
+			 char **prior_backup_dirs,
+			 manifest_data **manifests,
+			 bool want_result,
+			 cb_options *opt,
+			 cb_file_result *result)
+{
+	manifest_data *latest_manifest = manifests[n_prior_backups];
+	pg_checksum_type checksum_type = task->checksum_type;
+	int			checksum_length = 0;
+	uint8	   *checksum_payload = NULL;
+	bool		free_checksum_payload = false;
+	pg_checksum_context checksum_ctx;
 
-			/*
-			 * If copy_file() performed a checksum calculation for us, then
-			 * save the results (except in dry-run mode, when there's no
-			 * point).
-			 */
-			if (checksum_ctx.type != CHECKSUM_TYPE_NONE && !opt->dry_run)
+	if (task->manifest_prefix != NULL)
+	{
+		/* Reconstruction logic will do the rest. */
+		reconstruct_from_incremental_file(task->ifullpath, task->ofullpath,
+										  task->manifest_prefix,
+										  task->bare_file_name,
+										  n_prior_backups,
+										  prior_backup_dirs,
+										  manifests,
+										  task->manifest_path,
+										  checksum_type,
+										  &checksum_length,
+										  &checksum_payload,
+										  opt->copy_method,
+										  opt->debug,
+										  opt->dry_run);
+		free_checksum_payload = true;
+	}
+	else
+	{
+		/*
+		 * It's not an incremental file, so we need to copy the entire file to
+		 * the output directory.
+		 *
+		 * If a checksum of the required type already exists in the
+		 * backup_manifest for the final input directory, we can save some
+		 * work by reusing that checksum instead of computing a new one.
+		 */
+		if (checksum_type != CHECKSUM_TYPE_NONE &&
+			latest_manifest != NULL)
+		{
+			manifest_file *mfile;
+
+			mfile = manifest_files_lookup(latest_manifest->files,
+										  task->manifest_path);
+			if (mfile == NULL)
 			{
-				checksum_payload = pg_malloc(PG_CHECKSUM_MAX_LENGTH);
-				checksum_length = pg_checksum_final(&checksum_ctx,
-													checksum_payload);
+				char	   *bmpath;
+
+				/*
+				 * The directory is out of sync with the backup_manifest, so
+				 * emit a warning.
+				 */
+				bmpath = psprintf("%s/%s", task->input_directory,
+								  "backup_manifest");
+				pg_log_warning("manifest file \"%s\" contains no entry for file \"%s\"",
+							   bmpath, task->manifest_path);
+				pfree(bmpath);
+			}
+			else if (mfile->checksum_type == checksum_type)
+			{
+				checksum_length = mfile->checksum_length;
+				checksum_payload = mfile->checksum_payload;
 			}
 		}
 
-		/* Generate manifest entry, if needed. */
-		if (mwriter != NULL)
+		/*
+		 * If we're reusing a checksum, then we don't need copy_file() to
+		 * compute one for us, but otherwise, it needs to compute whatever
+		 * type of checksum we need.
+		 */
+		if (checksum_length != 0)
+			pg_checksum_init(&checksum_ctx, CHECKSUM_TYPE_NONE);
+		else
+			pg_checksum_init(&checksum_ctx, checksum_type);
+
+		/* Actually copy the file. */
+		copy_file(task->ifullpath, task->ofullpath, &checksum_ctx,
+				  opt->copy_method, opt->dry_run);
+
+		/*
+		 * If copy_file() performed a checksum calculation for us, then save
+		 * the results (except in dry-run mode, when there's no point).
+		 */
+		if (checksum_ctx.type != CHECKSUM_TYPE_NONE && !opt->dry_run)
 		{
-			struct stat sb;
+			checksum_payload = pg_malloc(PG_CHECKSUM_MAX_LENGTH);
+			checksum_length = pg_checksum_final(&checksum_ctx,
+												checksum_payload);
+			free_checksum_payload = true;
+		}
+	}
 
-			/*
-			 * In order to generate a manifest entry, we need the file size
-			 * and mtime. We have no way to know the correct mtime except to
-			 * stat() the file, so just do that and get the size as well.
-			 *
-			 * If we didn't need the mtime here, we could try to obtain the
-			 * file size from the reconstruction or file copy process above,
-			 * although that is actually not convenient in all cases. If we
-			 * write the file ourselves then clearly we can keep a count of
-			 * bytes, but if we use something like CopyFile() then it's
-			 * trickier. Since we have to stat() anyway to get the mtime,
-			 * there's no point in worrying about it.
-			 */
-			if (stat(ofullpath, &sb) < 0)
-				pg_fatal("could not stat file \"%s\": %m", ofullpath);
-
-			/* OK, now do the work. */
-			add_file_to_manifest(mwriter, manifest_path,
-								 sb.st_size, sb.st_mtime,
-								 checksum_type, checksum_length,
-								 checksum_payload);
+	/* Report what's needed for the manifest entry. */
+	if (want_result)
+	{
+		struct stat sb;
+
+		/*
+		 * In order to generate a manifest entry, we need the file size and
+		 * mtime. We have no way to know the correct mtime except to stat()
+		 * the file, so just do that and get the size as well.
+		 *
+		 * If we didn't need the mtime here, we could try to obtain the file
+		 * size from the reconstruction or file copy process above, although
+		 * that is actually not convenient in all cases. If we write the file
+		 * ourselves then clearly we can keep a count of bytes, but if we use
+		 * something like CopyFile() then it's trickier. Since we have to
+		 * stat() anyway to get the mtime, there's no point in worrying about
+		 * it.
+		 */
+		if (stat(task->ofullpath, &sb) < 0)
+			pg_fatal("could not stat file \"%s\": %m", task->ofullpath);
+
+		result->size = sb.st_size;
+		result->mtime = sb.st_mtime;
+		Assert(checksum_length <= PG_CHECKSUM_MAX_LENGTH);
+		result->checksum_length = checksum_length;
+		if (checksum_length > 0)
+			memcpy(result->checksum_payload, checksum_payload,
+				   checksum_length);
+	}
+
+	/* Avoid leaking memory. */
+	if (free_checksum_payload && checksum_payload != NULL)
+		pfree(checksum_payload);
+}
+
+#ifndef WIN32
+/*
+ * Process the files collected by process_directory_recursively() using
+ * opt->jobs parallel jobs, and add their manifest entries.
+ *
+ * Each job is a child process that takes the index of the next file to
+ * process from a pipe, so that a job that got a few large files doesn't hold
+ * up the others.  The jobs report the data for the manifest entries through
+ * shared memory, and we write the manifest ourselves once they're all done.
+ */
+static void
+process_file_tasks(int n_prior_backups, char **prior_backup_dirs,
+				   manifest_data **manifests, manifest_writer *mwriter,
+				   cb_options *opt)
+{
+	int			taskpipe[2];
+	int			njobs = Min(opt->jobs, n_file_tasks);
+	pid_t	   *pids;
+	cb_file_result *results;
+	int			failed_status = 0;
+
+	if (n_file_tasks == 0)
+		return;
+
+	results = mmap(NULL, n_file_tasks * sizeof(cb_file_result),
+				   PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (results == MAP_FAILED)
+		pg_fatal("could not allocate shared memory: %m");
+
+	if (pipe(taskpipe) < 0)
+		pg_fatal("could not create pipe: %m");
+
+	/* If all the jobs die, we want an error from write(), not a signal. */
+	pqsignal(SIGPIPE, SIG_IGN);
+
+	pg_log_debug("processing %d files using %d parallel jobs",
+				 n_file_tasks, njobs);
+
+	pids = pg_malloc_array(pid_t, njobs);
+	for (int i = 0; i < njobs; i++)
+	{
+		/* Don't let the child write out our buffered output again. */
+		fflush(NULL);
+
+		pids[i] = fork();
+		if (pids[i] == 0)
+		{
+			/* in child process; cleaning up is the leader's job */
+			reset_directory_cleanup_list();
+			close(taskpipe[1]);
+			exit(file_task_worker(taskpipe[0], n_prior_backups,
+								  prior_backup_dirs, manifests,
+								  mwriter != NULL, opt, results));
 		}
+		else if (pids[i] < 0)
+			pg_fatal("could not create child process: %m");
+	}
+	close(taskpipe[0]);
 
-		/* Avoid leaking memory. */
-		if (checksum_payload != NULL)
-			pfree(checksum_payload);
+	/*
+	 * Hand out the files. The write only fails if all the jobs have exited,
+	 * which we'll hear about below.
+	 */
+	for (int i = 0; i < n_file_tasks; i++)
+	{
+		if (write(taskpipe[1], &i, sizeof(i)) != sizeof(i))
+			break;
 	}
+	close(taskpipe[1]);
 
-	closedir(dir);
+	/*
+	 * Wait for the jobs to finish. If one fails, there's no point in letting
+	 * the others continue, but we must make sure that they've exited before
+	 * we remove the output directories.
+	 */
+	for (int i = 0; i < njobs; i++)
+	{
+		int			status;
+		pid_t		pid;
+
+		pid = waitpid(-1, &status, 0);
+		if (pid == (pid_t) -1)
+			pg_fatal("could not wait for child process: %m");
+
+		if (status != 0 && failed_status == 0)
+		{
+			failed_status = status;
+			for (int j = 0; j < njobs; j++)
+			{
+				if (pids[j] != pid)
+					kill(pids[j], SIGTERM);
+			}
+		}
+	}
+	if (failed_status != 0)
+		pg_fatal("%s", wait_result_to_str(failed_status));
+
+	/* Generate the manifest entries, if needed. */
+	if (mwriter != NULL)
+	{
+		for (int i = 0; i < n_file_tasks; i++)
+		{
+			cb_file_task *task = &file_tasks[i];
+			cb_file_result *result = &results[i];
+
+			add_file_to_manifest(mwriter, task->manifest_path,
+								 result->size, result->mtime,
+								 task->checksum_type,
+								 result->checksum_length,
+								 result->checksum_payload);
+		}
+	}
+
+	munmap(results, n_file_tasks * sizeof(cb_file_result));
+	pfree(pids);
+
+	for (int i = 0; i < n_file_tasks; i++)
+		free_file_task(&file_tasks[i]);
+	pfree(file_tasks);
+	file_tasks = NULL;
+	n_file_tasks = max_file_tasks = 0;
 }
+#endif							/* !WIN32 */
 
 /*
  * Add a directory to the list of output directories to clean up.
@@ -22,6 +22,12 @@
 #include "reconstruct.h"
 #include "storage/block.h"
 
+/*
+ * Maximum number of blocks that write_reconstructed_file() reads or writes
+ * with a single system call.
+ */
+#define RECONSTRUCT_BATCH_BLOCKS	32
+
 /*
  * An rfile stores the data that we need in order to be able to use some file
  * on disk for reconstruction. For any given output file, we create one rfile
@@ -61,11 +67,15 @@ static void write_reconstructed_file(char *input_filename,
 									 CopyMethod copy_method,
 									 bool debug,
 									 bool dry_run);
+static unsigned find_batch_length(rfile **sourcemap, off_t *offsetmap,
+								  unsigned start, unsigned block_length);
+static void prefetch_batch(rfile **sourcemap, off_t *offsetmap,
+						   unsigned start, unsigned block_length);
 static void read_bytes(rfile *rf, void *buffer, unsigned length);
-static void write_block(int fd, char *output_filename,
-						uint8 *buffer,
-						pg_checksum_context *checksum_ctx);
-static void read_block(rfile *s, off_t off, uint8 *buffer);
+static void write_blocks(int fd, char *output_filename,
+						 uint8 *buffer, unsigned nblocks,
+						 pg_checksum_context *checksum_ctx);
+static void read_blocks(rfile *s, off_t off, uint8 *buffer, unsigned nblocks);
 
 /*
  * Reconstruct a full file from an incremental file and a chain of prior
@@ -563,6 +573,7 @@ write_reconstructed_file(char *input_filename,
 	int			wfd = -1;
 	unsigned	i;
 	unsigned	zero_blocks = 0;
+	uint8	   *buffer = NULL;
 
 	/* Debugging output. */
 	if (debug)
@@ -639,57 +650,73 @@ write_reconstructed_file(char *input_filename,
 					pg_file_create_mode)) < 0)
 		pg_fatal("could not open file \"%s\": %m", output_filename);
 
-	/* Read and write the blocks as required. */
-	for (i = 0; i < block_length; ++i)
+	if (!dry_run)
+		buffer = pg_malloc(RECONSTRUCT_BATCH_BLOCKS * BLCKSZ);
+
+	/*
+	 * Read and write the blocks as required.
+	 *
+	 * Consecutive blocks that are stored next to each other in the same
+	 * source file are handled as a batch, so that we need only one read and
+	 * one write system call for each batch rather than for each block.  While
+	 * we're copying one batch, we ask the kernel to start reading the next
+	 * one, which may well come from a different file.
+	 */
+	i = 0;
+	while (i < block_length)
 	{
-		uint8		buffer[BLCKSZ];
 		rfile	   *s = sourcemap[i];
+		unsigned	nblocks;
+
+		nblocks = find_batch_length(sourcemap, offsetmap, i, block_length);
 
 		/* Update accounting information. */
 		if (s == NULL)
-			++zero_blocks;
+			zero_blocks += nblocks;
 		else
 		{
-			s->num_blocks_read++;
+			s->num_blocks_read += nblocks;
 			s->highest_offset_read = Max(s->highest_offset_read,
-										 offsetmap[i] + BLCKSZ);
+										 offsetmap[i + nblocks - 1] + BLCKSZ);
 		}
 
 		/* Skip the rest of this in dry-run mode. */
 		if (dry_run)
+		{
+			i += nblocks;
 			continue;
+		}
 
-		/* Read or zero-fill the block as appropriate. */
+		/* Get the next batch on its way. */
+		prefetch_batch(sourcemap, offsetmap, i + nblocks, block_length);
+
+		/* Read or zero-fill the blocks as appropriate. */
 		if (s == NULL)
 		{
 			/*
-			 * New block not mentioned in the WAL summary. Should have been an
-			 * uninitialized block, so just zero-fill it.
+			 * New blocks not mentioned in the WAL summary. Should have been
+			 * uninitialized blocks, so just zero-fill them.
 			 */
-			memset(buffer, 0, BLCKSZ);
-
-			/* Write out the block, update the checksum if needed. */
-			write_block(wfd, output_filename, buffer, checksum_ctx);
+			memset(buffer, 0, nblocks * BLCKSZ);
 
-			/* Nothing else to do for zero-filled blocks. */
-			continue;
+			/* Write out the blocks, update the checksum if needed. */
+			write_blocks(wfd, output_filename, buffer, nblocks, checksum_ctx);
 		}
-
-		/* Copy the block using the appropriate copy method. */
-		if (copy_method != COPY_METHOD_COPY_FILE_RANGE)
+		else if (copy_method != COPY_METHOD_COPY_FILE_RANGE)
 		{
 			/*
-			 * Read the block from the correct source file, and then write it
-			 * out, possibly with a checksum update.
+			 * Read the blocks from the correct source file, and then write
+			 * them out, possibly with a checksum update.
 			 */
-			read_block(s, offsetmap[i], buffer);
-			write_block(wfd, output_filename, buffer, checksum_ctx);
+			read_blocks(s, offsetmap[i], buffer, nblocks);
+			write_blocks(wfd, output_filename, buffer, nblocks, checksum_ctx);
 		}
 		else					/* use copy_file_range */
 		{
 #if defined(HAVE_COPY_FILE_RANGE)
 			/* copy_file_range modifies the offset, so use a local copy */
 			off_t		off = offsetmap[i];
+			size_t		nbytes = (size_t) nblocks * BLCKSZ;
 			size_t		nwritten = 0;
 
 			/*
@@ -698,9 +725,9 @@ write_reconstructed_file(char *input_filename,
 			 */
 			do
 			{
-				int			wb;
+				ssize_t		wb;
 
-				wb = copy_file_range(s->fd, &off, wfd, NULL, BLCKSZ - nwritten, 0);
+				wb = copy_file_range(s->fd, &off, wfd, NULL, nbytes - nwritten, 0);
 
 				if (wb < 0)
 					pg_fatal("error while copying file range from \"%s\" to \"%s\": %m",
@@ -708,26 +735,31 @@ write_reconstructed_file(char *input_filename,
 
 				nwritten += wb;
 
-			} while (BLCKSZ > nwritten);
+			} while (nbytes > nwritten);
 
 			/*
-			 * When checksum calculation not needed, we're done, otherwise
-			 * read the block and pass it to the checksum calculation.
+			 * When checksum calculation is needed, read the blocks and pass
+			 * them to the checksum calculation.
 			 */
-			if (checksum_ctx->type == CHECKSUM_TYPE_NONE)
-				continue;
-
-			read_block(s, offsetmap[i], buffer);
+			if (checksum_ctx->type != CHECKSUM_TYPE_NONE)
+			{
+				read_blocks(s, offsetmap[i], buffer, nblocks);
 
-			if (pg_checksum_update(checksum_ctx, buffer, BLCKSZ) < 0)
-				pg_fatal("could not update checksum of file \"%s\"",
-						 output_filename);
+				if (pg_checksum_update(checksum_ctx, buffer, nbytes) < 0)
+					pg_fatal("could not update checksum of file \"%s\"",
+							 output_filename);
+			}
 #else
 			pg_fatal("copy_file_range not supported on this platform");
 #endif
 		}
+
+		i += nblocks;
 	}
 
+	if (buffer != NULL)
+		pfree(buffer);
+
 	/* Debugging output. */
 	if (zero_blocks > 0)
 	{
@@ -743,49 +775,97 @@ write_reconstructed_file(char *input_filename,
 }
 
 /*
- * Write the block into the file (using the file descriptor), and
+ * Find the number of blocks, starting at block "start" of the output file,
+ * that can be copied as one batch: they must all come from the same source
+ * file, at consecutive offsets, or all be zero-filled.
+ */
+static unsigned
+find_batch_length(rfile **sourcemap, off_t *offsetmap,
+				  unsigned start, unsigned block_length)
+{
+	rfile	   *s = sourcemap[start];
+	unsigned	nblocks = 1;
+
+	while (nblocks < RECONSTRUCT_BATCH_BLOCKS &&
+		   start + nblocks < block_length &&
+		   sourcemap[start + nblocks] == s &&
+		   (s == NULL ||
+			offsetmap[start + nblocks] == offsetmap[start] + nblocks * BLCKSZ))
+		nblocks++;
+
+	return nblocks;
+}
+
+/*
+ * Advise the kernel that we'll soon read the batch of blocks beginning at
+ * block "start" of the output file.
+ */
+static void
+prefetch_batch(rfile **sourcemap, off_t *offsetmap,
+			   unsigned start, unsigned block_length)
+{
+#if defined(USE_POSIX_FADVISE) && defined(POSIX_FADV_WILLNEED)
+	rfile	   *s;
+	unsigned	nblocks;
+
+	if (start >= block_length || sourcemap[start] == NULL)
+		return;
+
+	s = sourcemap[start];
+	nblocks = find_batch_length(sourcemap, offsetmap, start, block_length);
+
+	/* This is only a hint, so ignore errors. */
+	(void) posix_fadvise(s->fd, offsetmap[start], (off_t) nblocks * BLCKSZ,
+						 POSIX_FADV_WILLNEED);
+#endif
+}
+
+/*
+ * Write nblocks blocks into the file (using the file descriptor), and
  * if needed update the checksum calculation.
  *
- * The buffer is expected to contain BLCKSZ bytes. The filename is
+ * The buffer is expected to contain nblocks * BLCKSZ bytes. The filename is
  * provided only for the error message.
  */
 static void
-write_block(int fd, char *output_filename,
-			uint8 *buffer, pg_checksum_context *checksum_ctx)
+write_blocks(int fd, char *output_filename,
+			 uint8 *buffer, unsigned nblocks,
+			 pg_checksum_context *checksum_ctx)
 {
+	int			nbytes = nblocks * BLCKSZ;
 	int			wb;
 
-	if ((wb = write(fd, buffer, BLCKSZ)) != BLCKSZ)
+	if ((wb = write(fd, buffer, nbytes)) != nbytes)
 	{
 		if (wb < 0)
 			pg_fatal("could not write file \"%s\": %m", output_filename);
 		else
 			pg_fatal("could not write file \"%s\": wrote %d of %d",
-					 output_filename, wb, BLCKSZ);
+					 output_filename, wb, nbytes);
 	}
 
 	/* Update the checksum computation. */
-	if (pg_checksum_update(checksum_ctx, buffer, BLCKSZ) < 0)
+	if (pg_checksum_update(checksum_ctx, buffer, nbytes) < 0)
 		pg_fatal("could not update checksum of file \"%s\"",
 				 output_filename);
 }
 
 /*
- * Read a block of data (BLCKSZ bytes) into the buffer.
+ * Read nblocks blocks of data, starting at offset "off", into the buffer.
  */
 static void
-read_block(rfile *s, off_t off, uint8 *buffer)
+read_blocks(rfile *s, off_t off, uint8 *buffer, unsigned nblocks)
 {
+	int			nbytes = nblocks * BLCKSZ;
 	int			rb;
 
-	/* Read the block from the correct source, except if dry-run. */
-	rb = pg_pread(s->fd, buffer, BLCKSZ, off);
-	if (rb != BLCKSZ)
+	rb = pg_pread(s->fd, buffer, nbytes, off);
+	if (rb != nbytes)
 	{
 		if (rb < 0)
 			pg_fatal("could not read from file \"%s\": %m", s->filename);
 		else
 			pg_fatal("could not read from file \"%s\", offset %llu: read %d of %d",
-					 s->filename, (unsigned long long) off, rb, BLCKSZ);
+					 s->filename, (unsigned long long) off, rb, nbytes);
 	}
 }
@@ -2,7 +2,8 @@
 
 use strict;
 use warnings FATAL => 'all';
-use File::Compare qw(compare_text);
+use File::Compare qw(compare compare_text);
+use File::Find;
 use PostgreSQL::Test::Cluster;
 use PostgreSQL::Test::Utils;
 use Test::More;
@@ -202,4 +203,42 @@ compare_files(
 		return $_[0] ne $_[1];
 	});
 
+# Combine the backups again, once with a single job and once with several
+# parallel jobs, and check that both produce the same files.
+my %combined;
+foreach my $jobs (1, 3)
+{
+	my $outpath = $tempdir . "/combined$jobs";
+	$primary->command_ok(
+		[
+			'pg_combinebackup', '--no-sync',
+			'--output' => $outpath,
+			'--tablespace-mapping' => "${tsbackup2path}=${outpath}ts",
+			'--jobs' => $jobs,
+			$backup1path, $backup2path
+		],
+		"combine backups with $jobs jobs");
+	$primary->command_ok([ 'pg_verifybackup', '--no-parse-wal', $outpath ],
+		"verify backup combined with $jobs jobs");
+	$combined{$jobs} = $outpath;
+}
+
+my @mismatches;
+foreach my $suffix ('', 'ts')
+{
+	my $dir1 = $combined{1} . $suffix;
+	my $dir3 = $combined{3} . $suffix;
+	find(
+		{
+			wanted => sub {
+				return if !-f $_ || -l $_ || $_ =~ m{/backup_manifest$};
+				(my $other = $_) =~ s{^\Q$dir1\E}{$dir3};
+				push @mismatches, $_ if compare($_, $other) != 0;
+			},
+			no_chdir => 1
+		},
+		$dir1);
+}
+is_deeply(\@mismatches, [], "parallel jobs produce the same files");
+
 done_testing();
@@ -2006,7 +2006,10 @@ buildTocEntryArrays(ArchiveHandle *AH)
 		 * tableDataId provides the TABLE DATA item's dump ID for each TABLE
 		 * TOC entry that has a DATA item.  We compute this by reversing the
 		 * TABLE DATA item's dependency, knowing that a TABLE DATA item has
-		 * just one dependency and it is the TABLE item.
+		 * just one dependency and it is the TABLE item.  If the table's data
+		 * was split into chunks, there are several TABLE DATA items, which
+		 * we chain together through nextTableDataId, starting from the one
+		 * tableDataId shows.
 		 */
 		if (strcmp(te->desc, "TABLE DATA") == 0 && te->nDeps > 0)
 		{
@@ -2020,7 +2023,16 @@ buildTocEntryArrays(ArchiveHandle *AH)
 			if (tableId <= 0 || tableId > maxDumpId)
 				pg_fatal("bad table dumpId for TABLE DATA item");
 
-			AH->tableDataId[tableId] = te->dumpId;
+			if (AH->tableDataId[tableId] == 0)
+				AH->tableDataId[tableId] = te->dumpId;
+			else
+			{
+				TocEntry   *prev = AH->tocsByDumpId[AH->tableDataId[tableId]];
+
+				while (prev->nextTableDataId != 0)
+					prev = AH->tocsByDumpId[prev->nextTableDataId];
+				prev->nextTableDataId = te->dumpId;
+			}
 		}
 	}
 }
@@ -4964,8 +4976,11 @@ fix_dependencies(ArchiveHandle *AH)
  * Change dependencies on table items to depend on table data items instead,
  * but only in POST_DATA items.
  *
+ * If a table's data was split into chunks, the item is made to depend on all
+ * of them.
+ *
  * Also, for any item having such dependency(s), set its dataLength to the
- * largest dataLength of the table data items it depends on.  This ensures
+ * largest dataLength of the tables whose data it depends on.  This ensures
  * that parallel restore will prioritize larger jobs (index builds, FK
  * constraint checks, etc) over smaller ones, avoiding situations where we
  * end a restore with only one active job working on a large table.
@@ -4975,13 +4990,15 @@ repoint_table_dependencies(ArchiveHandle *AH)
 {
 	TocEntry   *te;
 	int			i;
+	int			nDeps;
 	DumpId		olddep;
 
 	for (te = AH->toc->next; te != AH->toc; te = te->next)
 	{
 		if (te->section != SECTION_POST_DATA)
 			continue;
-		for (i = 0; i < te->nDeps; i++)
+		nDeps = te->nDeps;
+		for (i = 0; i < nDeps; i++)
 		{
 			olddep = te->dependencies[i];
 			if (olddep <= AH->maxDumpId &&
@@ -4989,11 +5006,27 @@ repoint_table_dependencies(ArchiveHandle *AH)
 			{
 				DumpId		tabledataid = AH->tableDataId[olddep];
 				TocEntry   *tabledatate = AH->tocsByDumpId[tabledataid];
+				pgoff_t		dataLength = tabledatate->dataLength;
 
 				te->dependencies[i] = tabledataid;
-				te->dataLength = Max(te->dataLength, tabledatate->dataLength);
 				pg_log_debug("transferring dependency %d -> %d to %d",
 							 te->dumpId, olddep, tabledataid);
+
+				while (tabledatate->nextTableDataId != 0)
+				{
+					tabledataid = tabledatate->nextTableDataId;
+					tabledatate = AH->tocsByDumpId[tabledataid];
+					dataLength += tabledatate->dataLength;
+
+					te->dependencies = pg_realloc_array(te->dependencies,
+														DumpId, te->nDeps + 1);
+					te->dependencies[te->nDeps++] = tabledataid;
+					te->depCount++;
+					pg_log_debug("adding dependency %d -> %d",
+								 te->dumpId, tabledataid);
+				}
+
+				te->dataLength = Max(te->dataLength, dataLength);
 			}
 		}
 	}
@@ -5107,6 +5140,10 @@ reduce_dependencies(ArchiveHandle *AH, TocEntry *te,
 /*
  * Set the created flag on the DATA member corresponding to the given
  * TABLE member
+ *
+ * If the table's data was split into chunks, we leave the flag unset: the
+ * TRUNCATE that restore_toc_entry issues before loading a newly created
+ * table would throw away the chunks loaded concurrently.
  */
 static void
 mark_create_done(ArchiveHandle *AH, TocEntry *te)
@@ -5115,7 +5152,8 @@ mark_create_done(ArchiveHandle *AH, TocEntry *te)
 	{
 		TocEntry   *ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
 
-		ted->created = true;
+		if (ted->nextTableDataId == 0)
+			ted->created = true;
 	}
 }
 
@@ -5134,6 +5172,11 @@ inhibit_data_for_failed_table(ArchiveHandle *AH, TocEntry *te)
 		TocEntry   *ted = AH->tocsByDumpId[AH->tableDataId[te->dumpId]];
 
 		ted->reqs = 0;
+		while (ted->nextTableDataId != 0)
+		{
+			ted = AH->tocsByDumpId[ted->nextTableDataId];
+			ted->reqs = 0;
+		}
 	}
 }
 
@@ -192,6 +192,10 @@ static const CatalogId nilCatalogId = {0, 0};
 static bool have_extra_float_digits = false;
 static int	extra_float_digits;
 
+/* --table-chunk-size, in megabytes, and the same in the server's pages */
+static int	table_chunk_size = 0;
+static BlockNumber table_chunk_pages = 0;
+
 /* sorted table of role names */
 static RoleNameItem *rolenames = NULL;
 static int	nrolenames = 0;
@@ -267,6 +271,7 @@ static void prohibit_crossdb_refs(PGconn *conn, const char *dbname,
 
 static NamespaceInfo *findNamespace(Oid nsoid);
 static void dumpTableData(Archive *fout, const TableDataInfo *tdinfo);
+static int	getTableDataChunks(const TableDataInfo *tdinfo);
 static void refreshMatViewData(Archive *fout, const TableDataInfo *tdinfo);
 static const char *getRoleName(const char *roleoid_str);
 static void collectRoleNames(Archive *fout);
@@ -538,6 +543,7 @@ main(int argc, char **argv)
 		{"exclude-extension", required_argument, NULL, 17},
 		{"sequence-data", no_argument, &dopt.sequence_data, 1},
 		{"restrict-key", required_argument, NULL, 25},
+		{"table-chunk-size", required_argument, NULL, 26},
 
 		{NULL, 0, NULL, 0}
 	};
@@ -802,6 +808,12 @@ main(int argc, char **argv)
 				dopt.restrict_key = pg_strdup(optarg);
 				break;
 
+			case 26:			/* table chunk size */
+				if (!option_parse_int(optarg, "--table-chunk-size", 1, INT_MAX,
+									  &table_chunk_size))
+					exit_nicely(1);
+				break;
+
 			default:
 				/* getopt_long already emitted a complaint */
 				pg_log_error_hint("Try \"%s --help\" for more information.", progname);
@@ -1015,6 +1027,31 @@ main(int argc, char **argv)
 	if (fout->isStandby)
 		dopt.no_unlogged_table_data = true;
 
+	/*
+	 * Splitting tables into chunks relies on TID Range Scans to read each
+	 * chunk efficiently.  Convert the chunk size to the server's pages.
+	 */
+	if (table_chunk_size > 0)
+	{
+		if (fout->remoteVersion < 140000)
+			pg_log_warning("--table-chunk-size is ignored for server versions older than %s",
+						   "14");
+		else
+		{
+			PGresult   *res;
+			int			blcksz;
+
+			res = ExecuteSqlQueryForSingleRow(fout,
+											  "SELECT current_setting('block_size')");
+			blcksz = atoi(PQgetvalue(res, 0, 0));
+			PQclear(res);
+
+			table_chunk_pages = (BlockNumber)
+				Min((uint64) table_chunk_size * 1024 * 1024 / blcksz,
+					(uint64) MaxBlockNumber);
+		}
+	}
+
 	/*
 	 * Find the last built-in OID, if needed (prior to 8.1)
 	 *
@@ -1403,6 +1440,8 @@ help(const char *progname)
 			 "                               match at least one entity each\n"));
 	printf(_("  --table-and-children=PATTERN dump only the specified table(s), including\n"
 			 "                               child and partition tables\n"));
+	printf(_("  --table-chunk-size=SIZE      dump the data of tables larger than SIZE\n"
+			 "                               megabytes in chunks of that size\n"));
 	printf(_("  --use-set-session-authorization\n"
 			 "                               use SET SESSION AUTHORIZATION commands instead of\n"
 			 "                               ALTER OWNER commands to set ownership\n"));
@@ -2427,7 +2466,7 @@ dumpTableData_copy(Archive *fout, const void *dcontext)
 		else
 			appendPQExpBufferStr(q, "* ");
 
-		appendPQExpBuffer(q, "FROM %s %s) TO stdout;",
+		appendPQExpBuffer(q, "FROM ONLY %s %s) TO stdout;",
 						  fmtQualifiedDumpable(tbinfo),
 						  tdinfo->filtercond ? tdinfo->filtercond : "");
 	}
@@ -2930,50 +2969,116 @@ dumpTableData(Archive *fout, const TableDataInfo *tdinfo)
 	 */
 	if (tdinfo->dobj.dump & DUMP_COMPONENT_DATA)
 	{
-		TocEntry   *te;
-
-		te = ArchiveEntry(fout, tdinfo->dobj.catId, tdinfo->dobj.dumpId,
-						  ARCHIVE_OPTS(.tag = tbinfo->dobj.name,
-									   .namespace = tbinfo->dobj.namespace->dobj.name,
-									   .owner = tbinfo->rolname,
-									   .description = "TABLE DATA",
-									   .section = SECTION_DATA,
-									   .createStmt = tdDefn,
-									   .copyStmt = copyStmt,
-									   .deps = &(tbinfo->dobj.dumpId),
-									   .nDeps = 1,
-									   .dumpFn = dumpFn,
-									   .dumpArg = tdinfo));
+		int			nchunks = getTableDataChunks(tdinfo);
 
-		/*
-		 * Set the TocEntry's dataLength in case we are doing a parallel dump
-		 * and want to order dump jobs by table size.  We choose to measure
-		 * dataLength in table pages (including TOAST pages) during dump, so
-		 * no scaling is needed.
-		 *
-		 * However, relpages is declared as "integer" in pg_class, and hence
-		 * also in TableInfo, but it's really BlockNumber a/k/a unsigned int.
-		 * Cast so that we get the right interpretation of table sizes
-		 * exceeding INT_MAX pages.
-		 */
-		te->dataLength = (BlockNumber) tbinfo->relpages;
-		te->dataLength += (BlockNumber) tbinfo->toastpages;
+		for (int chunk = 0; chunk < nchunks; chunk++)
+		{
+			const TableDataInfo *chunkinfo = tdinfo;
+			DumpId		dumpId = tdinfo->dobj.dumpId;
+			BlockNumber npages = (BlockNumber) tbinfo->relpages;
+			BlockNumber ntoastpages = (BlockNumber) tbinfo->toastpages;
+			TocEntry   *te;
 
-		/*
-		 * If pgoff_t is only 32 bits wide, the above refinement is useless,
-		 * and instead we'd better worry about integer overflow.  Clamp to
-		 * INT_MAX if the correct result exceeds that.
-		 */
-		if (sizeof(te->dataLength) == 4 &&
-			(tbinfo->relpages < 0 || tbinfo->toastpages < 0 ||
-			 te->dataLength < 0))
-			te->dataLength = INT_MAX;
+			/*
+			 * Each chunk but the first is a TOC entry of its own, with a new
+			 * dump ID.  The chunks are ranges of the table's pages; the first
+			 * and last ranges are open-ended, in case the table has grown
+			 * since relpages was last updated.
+			 */
+			if (nchunks > 1)
+			{
+				TableDataInfo *c = pg_malloc(sizeof(TableDataInfo));
+				BlockNumber startblk = chunk * table_chunk_pages;
+
+				*c = *tdinfo;
+				if (chunk == 0)
+					c->filtercond = psprintf("WHERE ctid < '(%u,0)'::pg_catalog.tid",
+											 startblk + table_chunk_pages);
+				else if (chunk == nchunks - 1)
+					c->filtercond = psprintf("WHERE ctid >= '(%u,0)'::pg_catalog.tid",
+											 startblk);
+				else
+					c->filtercond = psprintf("WHERE ctid >= '(%u,0)'::pg_catalog.tid"
+											 " AND ctid < '(%u,0)'::pg_catalog.tid",
+											 startblk, startblk + table_chunk_pages);
+				chunkinfo = c;
+
+				if (chunk > 0)
+					dumpId = createDumpId();
+				npages = Min(npages - startblk, table_chunk_pages);
+				ntoastpages = ntoastpages / nchunks;
+			}
+
+			te = ArchiveEntry(fout, tdinfo->dobj.catId, dumpId,
+							  ARCHIVE_OPTS(.tag = tbinfo->dobj.name,
+										   .namespace = tbinfo->dobj.namespace->dobj.name,
+										   .owner = tbinfo->rolname,
+										   .description = "TABLE DATA",
+										   .section = SECTION_DATA,
+										   .createStmt = tdDefn,
+										   .copyStmt = copyStmt,
+										   .deps = &(tbinfo->dobj.dumpId),
+										   .nDeps = 1,
+										   .dumpFn = dumpFn,
+										   .dumpArg = chunkinfo));
+
+			/*
+			 * Set the TocEntry's dataLength in case we are doing a parallel
+			 * dump and want to order dump jobs by table size.  We choose to
+			 * measure dataLength in table pages (including TOAST pages)
+			 * during dump, so no scaling is needed.
+			 *
+			 * However, relpages is declared as "integer" in pg_class, and
+			 * hence also in TableInfo, but it's really BlockNumber a/k/a
+			 * unsigned int.  Cast so that we get the right interpretation of
+			 * table sizes exceeding INT_MAX pages.
+			 */
+			te->dataLength = npages;
+			te->dataLength += ntoastpages;
+
+			/*
+			 * If pgoff_t is only 32 bits wide, the above refinement is
+			 * useless, and instead we'd better worry about integer overflow.
+			 * Clamp to INT_MAX if the correct result exceeds that.
+			 */
+			if (sizeof(te->dataLength) == 4 &&
+				(npages > INT_MAX || ntoastpages > INT_MAX ||
+				 te->dataLength < 0))
+				te->dataLength = INT_MAX;
+		}
 	}
 
 	destroyPQExpBuffer(copyBuf);
 	destroyPQExpBuffer(clistBuf);
 }
 
+/*
+ * getTableDataChunks -
+ *	  decide how many TABLE DATA entries to split the contents of a table into
+ *
+ * With --table-chunk-size, the data of a large table is dumped as several
+ * chunks, each a range of the table's pages, so that a parallel dump or
+ * restore can process the chunks concurrently.  Only plain heap tables are
+ * split, since other table access methods might not support TID Range Scans;
+ * so are not tables that already have a filter condition.
+ */
+static int
+getTableDataChunks(const TableDataInfo *tdinfo)
+{
+	TableInfo  *tbinfo = tdinfo->tdtable;
+	BlockNumber relpages = (BlockNumber) tbinfo->relpages;
+
+	if (table_chunk_pages == 0 || relpages <= table_chunk_pages)
+		return 1;
+	if (tdinfo->filtercond != NULL)
+		return 1;
+	if (tbinfo->relkind != RELKIND_RELATION ||
+		tbinfo->amname == NULL || strcmp(tbinfo->amname, "heap") != 0)
+		return 1;
+
+	return (relpages - 1) / table_chunk_pages + 1;
+}
+
 /*
  * refreshMatViewData -
  *	  load or refresh the contents of a single materialized view
@@ -3060,6 +3165,10 @@ makeTableDataInfo(DumpOptions *dopt, TableInfo *tbinfo)
 	if (tbinfo->relkind == RELKIND_PARTITIONED_TABLE)
 		return;
 
+	/* Global temporary tables have no data outside of sessions */
+	if (tbinfo->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+		return;
+
 	/* Don't dump data in unlogged tables, if so requested */
 	if (tbinfo->relpersistence == RELPERSISTENCE_UNLOGGED &&
 		dopt->no_unlogged_table_data)
@@ -7213,6 +7322,7 @@ getTables(Archive *fout, int *numTables)
 	int			i_relpersistence;
 	int			i_relispopulated;
 	int			i_relreplident;
+	int			i_relisincremental;
 	int			i_relrowsec;
 	int			i_relforcerowsec;
 	int			i_relfrozenxid;
@@ -7299,6 +7409,24 @@ getTables(Archive *fout, int *numTables)
 		appendPQExpBufferStr(query,
 							 "'d' AS relreplident, ");
 
+	/*
+	 * Incremental materialized views are recognized by the internal triggers
+	 * maintaining them.
+	 */
+	if (fout->remoteVersion >= 190000)
+		appendPQExpBufferStr(query,
+							 "c.relkind = " CppAsString2(RELKIND_MATVIEW) " AND "
+							 "EXISTS (SELECT 1 FROM pg_catalog.pg_depend dt "
+							 "JOIN pg_catalog.pg_trigger t ON t.oid = dt.objid "
+							 "WHERE dt.classid = 'pg_catalog.pg_trigger'::pg_catalog.regclass "
+							 "AND dt.refclassid = 'pg_catalog.pg_class'::pg_catalog.regclass "
+							 "AND dt.refobjid = c.oid "
+							 "AND t.tgfoid = 'pg_catalog.matview_incremental_maintenance'::pg_catalog.regproc) "
+							 "AS relisincremental, ");
+	else
+		appendPQExpBufferStr(query,
+							 "false AS relisincremental, ");
+
 	if (fout->remoteVersion >= 90500)
 		appendPQExpBufferStr(query,
 							 "c.relrowsecurity, c.relforcerowsecurity, ");
@@ -7437,6 +7565,7 @@ getTables(Archive *fout, int *numTables)
 	i_relpersistence = PQfnumber(res, "relpersistence");
 	i_relispopulated = PQfnumber(res, "relispopulated");
 	i_relreplident = PQfnumber(res, "relreplident");
+	i_relisincremental = PQfnumber(res, "relisincremental");
 	i_relrowsec = PQfnumber(res, "relrowsecurity");
 	i_relforcerowsec = PQfnumber(res, "relforcerowsecurity");
 	i_relfrozenxid = PQfnumber(res, "relfrozenxid");
@@ -7515,6 +7644,7 @@ getTables(Archive *fout, int *numTables)
 		tblinfo[i].relpersistence = *(PQgetvalue(res, i, i_relpersistence));
 		tblinfo[i].relispopulated = (strcmp(PQgetvalue(res, i, i_relispopulated), "t") == 0);
 		tblinfo[i].relreplident = *(PQgetvalue(res, i, i_relreplident));
+		tblinfo[i].relisincremental = (strcmp(PQgetvalue(res, i, i_relisincremental), "t") == 0);
 		tblinfo[i].rowsec = (strcmp(PQgetvalue(res, i, i_relrowsec), "t") == 0);
 		tblinfo[i].forcerowsec = (strcmp(PQgetvalue(res, i, i_relforcerowsec), "t") == 0);
 		tblinfo[i].frozenxid = atooid(PQgetvalue(res, i, i_relfrozenxid));
@@ -17241,10 +17371,13 @@ dumpTableSchema(Archive *fout, const TableInfo *tbinfo)
 		 * PostgreSQL 18 has disabled UNLOGGED for partitioned tables, so
 		 * ignore it when dumping if it was set in this case.
 		 */
-		appendPQExpBuffer(q, "CREATE %s%s %s",
+		appendPQExpBuffer(q, "CREATE %s%s%s %s",
 						  (tbinfo->relpersistence == RELPERSISTENCE_UNLOGGED &&
 						   tbinfo->relkind != RELKIND_PARTITIONED_TABLE) ?
-						  "UNLOGGED " : "",
+						  "UNLOGGED " :
+						  tbinfo->relpersistence == RELPERSISTENCE_GLOBAL_TEMP ?
+						  "GLOBAL TEMPORARY " : "",
+						  tbinfo->relisincremental ? "INCREMENTAL " : "",
 						  reltypename,
 						  qualrelname);
 
@@ -17905,6 +18038,9 @@ dumpTableSchema(Archive *fout, const TableInfo *tbinfo)
 					case 'l':
 						cmname = "lz4";
 						break;
+					case 'z':
+						cmname = "zstd";
+						break;
 					default:
 						cmname = NULL;
 						break;
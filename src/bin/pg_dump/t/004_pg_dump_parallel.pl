@@ -44,6 +44,11 @@ create table tht_p1 partition of tht for values with (modulus 3, remainder 0);
 create table tht_p2 partition of tht for values with (modulus 3, remainder 1);
 create table tht_p3 partition of tht for values with (modulus 3, remainder 2);
 insert into tht select (x%10)::text::digit, x from generate_series(1,1000) x;
+
+-- table large enough to be split by --table-chunk-size=1
+create table tbig (id int primary key, filler text);
+insert into tbig select x, repeat('x', 100) from generate_series(1,30000) x;
+vacuum analyze tbig;
 	});
 
 $node->command_ok(
@@ -87,4 +92,36 @@ $node->command_ok(
 	],
 	'parallel restore as inserts');
 
+$node->command_ok(
+	[
+		'pg_dump',
+		'--format' => 'directory',
+		'--no-sync',
+		'--jobs' => 2,
+		'--file' => "$backupdir/dump3",
+		'--table-chunk-size' => 1,
+		$node->connstr($dbname1),
+	],
+	'parallel dump with table chunks');
+
+my ($stdout, $stderr) = run_command(
+	[ 'pg_restore', '--list', "$backupdir/dump3" ]);
+my $nchunks = () = $stdout =~ /TABLE DATA public tbig /g;
+cmp_ok($nchunks, '>', 1, 'table data is split into chunks');
+
+$node->run_log([ 'createdb', 'regression_dest3' ]);
+$node->command_ok(
+	[
+		'pg_restore', '--verbose',
+		'--dbname' => $node->connstr('regression_dest3'),
+		'--jobs' => 3,
+		"$backupdir/dump3",
+	],
+	'parallel restore of table chunks');
+
+is( $node->safe_psql(
+		'regression_dest3', 'select count(*), sum(id) from tbig'),
+	'30000|450015000',
+	'table chunks restored');
+
 done_testing();
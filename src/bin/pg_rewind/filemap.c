@@ -132,6 +132,9 @@ static const char *const excludeDirContents[] =
 	/* Contents removed on startup, see dsm_cleanup_for_mmap(). */
 	"pg_dynshmem",				/* defined as PG_DYNSHMEM_DIR */
 
+	/* Only needed for crash recovery, see DoubleWriteRecover(). */
+	"pg_dblwr",					/* defined as PG_DBLWR_DIR */
+
 	/* Contents removed on startup, see AsyncShmemInit(). */
 	"pg_notify",
 
@@ -11,6 +11,7 @@
 
 #include "catalog/pg_type_d.h"
 #include "common/connect.h"
+#include "fe_utils/parallel_slot.h"
 #include "file_ops.h"
 #include "filemap.h"
 #include "lib/stringinfo.h"
@@ -25,6 +26,23 @@
 #define MAX_CHUNK_SIZE (1024 * 1024)
 #define MAX_CHUNKS_PER_QUERY 1000
 
+/* The query to fetch a batch of chunks */
+#define FETCH_CHUNKS_SQL \
+	"SELECT path, begin,\n" \
+	"  pg_read_binary_file(path, begin, len, true) AS chunk\n" \
+	"FROM unnest ($1::text[], $2::int8[], $3::int4[]) as x(path, begin, len)"
+
+/*
+ * Commands to run on the additional connections used to fetch chunks in
+ * parallel; see init_libpq_conn().
+ */
+#define FETCH_CONN_INIT_SQL \
+	"SET statement_timeout = 0; " \
+	"SET lock_timeout = 0; " \
+	"SET idle_in_transaction_session_timeout = 0; " \
+	"SET transaction_timeout = 0; " \
+	"SET default_transaction_read_only = on"
+
 /* represents a request to fetch a piece of a file from the source */
 typedef struct
 {
@@ -33,6 +51,14 @@ typedef struct
 	size_t		length;
 } fetch_range_request;
 
+/* a batch of requests that is fetched with one query */
+typedef struct
+{
+	int			num_requests;
+	int			chunkno;		/* # of chunks received so far */
+	fetch_range_request requests[MAX_CHUNKS_PER_QUERY];
+} fetch_batch;
+
 typedef struct
 {
 	rewind_source common;		/* common interface functions */
@@ -43,8 +69,17 @@ typedef struct
 	 * Queue of chunks that have been requested with the queue_fetch_range()
 	 * function, but have not been fetched from the remote server yet.
 	 */
-	int			num_requests;
-	fetch_range_request request_queue[MAX_CHUNKS_PER_QUERY];
+	fetch_batch queue;
+
+	/*
+	 * If we were asked to use several connections to fetch chunks, the
+	 * connections, and the batch each of them is busy with. In that case,
+	 * a full queue is sent on an idle connection without waiting for the
+	 * results, which are processed as they arrive.
+	 */
+	ParallelSlotArray *slots;
+	fetch_batch *slot_batches;
+	ConnParams	cparams;
 
 	/* temporary space for process_queued_fetch_requests() */
 	StringInfoData paths;
@@ -58,6 +93,11 @@ static void run_simple_command(PGconn *conn, const char *sql);
 static void appendArrayEscapedString(StringInfo buf, const char *str);
 
 static void process_queued_fetch_requests(libpq_source *src);
+static void dispatch_queued_fetch_requests(libpq_source *src);
+static void build_fetch_params(libpq_source *src, fetch_batch *batch);
+static void process_fetch_result(fetch_batch *batch, PGresult *res);
+static bool fetch_result_handler(PGresult *res, PGconn *conn, void *context);
+static void wait_for_fetch_slots(libpq_source *src);
 
 /* public interface functions */
 static void libpq_traverse_files(rewind_source *source,
@@ -76,9 +116,14 @@ static void libpq_destroy(rewind_source *source);
  *
  * The caller has already established the connection, but should not try
  * to use it while the source is active.
+ *
+ * If nconns is greater than 1, file contents are fetched over nconns
+ * additional connections made with connstr, so that the source server can
+ * work on several batches of requests at once, and we needn't wait for the
+ * round trip between two batches.
  */
 rewind_source *
-init_libpq_source(PGconn *conn)
+init_libpq_source(PGconn *conn, const char *connstr, int nconns)
 {
 	libpq_source *src;
 
@@ -86,6 +131,15 @@ init_libpq_source(PGconn *conn)
 
 	src = pg_malloc0(sizeof(libpq_source));
 
+	if (nconns > 1)
+	{
+		src->cparams.dbname = connstr;
+		src->cparams.prompt_password = TRI_NO;
+		src->slots = ParallelSlotsSetup(nconns, &src->cparams, "pg_rewind",
+										false, FETCH_CONN_INIT_SQL);
+		src->slot_batches = pg_malloc_array(fetch_batch, nconns);
+	}
+
 	src->common.traverse_files = libpq_traverse_files;
 	src->common.fetch_file = libpq_fetch_file;
 	src->common.queue_fetch_file = libpq_queue_fetch_file;
@@ -142,11 +196,7 @@ init_libpq_conn(PGconn *conn)
 	pg_free(str);
 
 	/* Prepare a statement we'll use to fetch files */
-	res = PQprepare(conn, "fetch_chunks_stmt",
-					"SELECT path, begin,\n"
-					"  pg_read_binary_file(path, begin, len, true) AS chunk\n"
-					"FROM unnest ($1::text[], $2::int8[], $3::int4[]) as x(path, begin, len)",
-					3, NULL);
+	res = PQprepare(conn, "fetch_chunks_stmt", FETCH_CHUNKS_SQL, 3, NULL);
 
 	if (PQresultStatus(res) != PGRES_COMMAND_OK)
 		pg_fatal("could not prepare statement to fetch file contents: %s",
@@ -366,9 +416,9 @@ libpq_queue_fetch_range(rewind_source *source, const char *path, off_t off,
 	 * same filename. If it didn't, we would fail to merge requests, but it
 	 * wouldn't affect correctness.
 	 */
-	if (src->num_requests > 0)
+	if (src->queue.num_requests > 0)
 	{
-		fetch_range_request *prev = &src->request_queue[src->num_requests - 1];
+		fetch_range_request *prev = &src->queue.requests[src->queue.num_requests - 1];
 
 		if (prev->offset + prev->length == off &&
 			prev->length < MAX_CHUNK_SIZE &&
@@ -399,14 +449,14 @@ libpq_queue_fetch_range(rewind_source *source, const char *path, off_t off,
 		int32		thislen;
 
 		/* if the queue is full, perform all the work queued up so far */
-		if (src->num_requests == MAX_CHUNKS_PER_QUERY)
+		if (src->queue.num_requests == MAX_CHUNKS_PER_QUERY)
 			process_queued_fetch_requests(src);
 
 		thislen = Min(len, MAX_CHUNK_SIZE);
-		src->request_queue[src->num_requests].path = path;
-		src->request_queue[src->num_requests].offset = off;
-		src->request_queue[src->num_requests].length = thislen;
-		src->num_requests++;
+		src->queue.requests[src->queue.num_requests].path = path;
+		src->queue.requests[src->queue.num_requests].offset = off;
+		src->queue.requests[src->queue.num_requests].length = thislen;
+		src->queue.num_requests++;
 
 		off += thislen;
 		len -= thislen;
@@ -419,7 +469,10 @@ libpq_queue_fetch_range(rewind_source *source, const char *path, off_t off,
 static void
 libpq_finish_fetch(rewind_source *source)
 {
-	process_queued_fetch_requests((libpq_source *) source);
+	libpq_source *src = (libpq_source *) source;
+
+	process_queued_fetch_requests(src);
+	wait_for_fetch_slots(src);
 }
 
 static void
@@ -427,18 +480,104 @@ process_queued_fetch_requests(libpq_source *src)
 {
 	const char *params[3];
 	PGresult   *res;
-	int			chunkno;
 
-	if (src->num_requests == 0)
+	if (src->queue.num_requests == 0)
+		return;
+
+	/* With several connections, let one of them do it in the background. */
+	if (src->slots != NULL)
+	{
+		dispatch_queued_fetch_requests(src);
 		return;
+	}
 
-	pg_log_debug("getting %d file chunks", src->num_requests);
+	pg_log_debug("getting %d file chunks", src->queue.num_requests);
 
 	/*
-	 * The prepared statement, 'fetch_chunks_stmt', takes three arrays with
-	 * the same length as parameters: paths, offsets and lengths. Construct
-	 * the string representations of them.
+	 * Execute the prepared statement, 'fetch_chunks_stmt'.
 	 */
+	build_fetch_params(src, &src->queue);
+	params[0] = src->paths.data;
+	params[1] = src->offsets.data;
+	params[2] = src->lengths.data;
+
+	if (PQsendQueryPrepared(src->conn, "fetch_chunks_stmt", 3, params, NULL, NULL, 1) != 1)
+		pg_fatal("could not send query: %s", PQerrorMessage(src->conn));
+
+	if (PQsetSingleRowMode(src->conn) != 1)
+		pg_fatal("could not set libpq connection to single row mode");
+
+	src->queue.chunkno = 0;
+	while ((res = PQgetResult(src->conn)) != NULL)
+	{
+		process_fetch_result(&src->queue, res);
+		PQclear(res);
+	}
+
+	src->queue.num_requests = 0;
+}
+
+/*
+ * Send the queued requests over an idle connection, waiting for one to
+ * become idle if necessary, and return without waiting for the results.
+ * They are processed by fetch_result_handler() whenever we wait for a
+ * connection again.
+ */
+static void
+dispatch_queued_fetch_requests(libpq_source *src)
+{
+	ParallelSlot *slot;
+	fetch_batch *batch;
+	const char *params[3];
+
+	slot = ParallelSlotsGetIdle(src->slots, NULL);
+	if (slot == NULL)
+		pg_fatal("could not fetch file chunks from source server");
+
+	/* Hand the queue over to the slot. */
+	batch = &src->slot_batches[slot - src->slots->slots];
+	memcpy(batch->requests, src->queue.requests,
+		   src->queue.num_requests * sizeof(fetch_range_request));
+	batch->num_requests = src->queue.num_requests;
+	batch->chunkno = 0;
+	src->queue.num_requests = 0;
+
+	pg_log_debug("getting %d file chunks on connection %d",
+				 batch->num_requests, (int) (slot - src->slots->slots));
+
+	build_fetch_params(src, batch);
+	params[0] = src->paths.data;
+	params[1] = src->offsets.data;
+	params[2] = src->lengths.data;
+
+	ParallelSlotSetHandler(slot, fetch_result_handler, batch);
+	if (PQsendQueryParams(slot->connection, FETCH_CHUNKS_SQL, 3, NULL,
+						  params, NULL, NULL, 1) != 1)
+		pg_fatal("could not send query: %s",
+				 PQerrorMessage(slot->connection));
+
+	if (PQsetSingleRowMode(slot->connection) != 1)
+		pg_fatal("could not set libpq connection to single row mode");
+}
+
+/*
+ * Wait for the requests sent on all connections to be processed.
+ */
+static void
+wait_for_fetch_slots(libpq_source *src)
+{
+	if (src->slots != NULL && !ParallelSlotsWaitCompletion(src->slots))
+		pg_fatal("could not fetch file chunks from source server");
+}
+
+/*
+ * Construct the string representations of the three arrays, with the same
+ * length, that the query to fetch a batch takes as parameters: paths,
+ * offsets and lengths.
+ */
+static void
+build_fetch_params(libpq_source *src, fetch_batch *batch)
+{
 	resetStringInfo(&src->paths);
 	resetStringInfo(&src->offsets);
 	resetStringInfo(&src->lengths);
@@ -446,9 +585,9 @@ process_queued_fetch_requests(libpq_source *src)
 	appendStringInfoChar(&src->paths, '{');
 	appendStringInfoChar(&src->offsets, '{');
 	appendStringInfoChar(&src->lengths, '{');
-	for (int i = 0; i < src->num_requests; i++)
+	for (int i = 0; i < batch->num_requests; i++)
 	{
-		fetch_range_request *rq = &src->request_queue[i];
+		fetch_range_request *rq = &batch->requests[i];
 
 		if (i > 0)
 		{
@@ -464,19 +603,48 @@ process_queued_fetch_requests(libpq_source *src)
 	appendStringInfoChar(&src->paths, '}');
 	appendStringInfoChar(&src->offsets, '}');
 	appendStringInfoChar(&src->lengths, '}');
+}
 
-	/*
-	 * Execute the prepared statement.
-	 */
-	params[0] = src->paths.data;
-	params[1] = src->offsets.data;
-	params[2] = src->lengths.data;
-
-	if (PQsendQueryPrepared(src->conn, "fetch_chunks_stmt", 3, params, NULL, NULL, 1) != 1)
-		pg_fatal("could not send query: %s", PQerrorMessage(src->conn));
+/*
+ * ParallelSlotResultHandler for the queries sent by
+ * dispatch_queued_fetch_requests().
+ */
+static bool
+fetch_result_handler(PGresult *res, PGconn *conn, void *context)
+{
+	process_fetch_result((fetch_batch *) context, res);
+	return true;
+}
 
-	if (PQsetSingleRowMode(src->conn) != 1)
-		pg_fatal("could not set libpq connection to single row mode");
+/*
+ * Process one result of the query to fetch a batch, and write the chunk it
+ * contains to the target data directory.
+ */
+static void
+process_fetch_result(fetch_batch *batch, PGresult *res)
+{
+	fetch_range_request *rq;
+	char	   *filename;
+	int			filenamelen;
+	int64		chunkoff;
+	int			chunksize;
+	char	   *chunk;
+
+	switch (PQresultStatus(res))
+	{
+		case PGRES_SINGLE_TUPLE:
+			break;
+
+		case PGRES_TUPLES_OK:
+			/* final zero-row result */
+			if (batch->chunkno != batch->num_requests)
+				pg_fatal("unexpected number of data chunks received");
+			return;
+
+		default:
+			pg_fatal("unexpected result while fetching remote files: %s",
+					 PQresultErrorMessage(res));
+	}
 
 	/*----
 	 * The result set is of format:
@@ -486,124 +654,95 @@ process_queued_fetch_requests(libpq_source *src)
 	 * chunk	bytea	-- file content
 	 *----
 	 */
-	chunkno = 0;
-	while ((res = PQgetResult(src->conn)) != NULL)
-	{
-		fetch_range_request *rq = &src->request_queue[chunkno];
-		char	   *filename;
-		int			filenamelen;
-		int64		chunkoff;
-		int			chunksize;
-		char	   *chunk;
-
-		switch (PQresultStatus(res))
-		{
-			case PGRES_SINGLE_TUPLE:
-				break;
-
-			case PGRES_TUPLES_OK:
-				PQclear(res);
-				continue;		/* final zero-row result */
+	if (batch->chunkno >= batch->num_requests)
+		pg_fatal("received more data chunks than requested");
+	rq = &batch->requests[batch->chunkno];
 
-			default:
-				pg_fatal("unexpected result while fetching remote files: %s",
-						 PQresultErrorMessage(res));
-		}
-
-		if (chunkno > src->num_requests)
-			pg_fatal("received more data chunks than requested");
+	/* sanity check the result set */
+	if (PQnfields(res) != 3 || PQntuples(res) != 1)
+		pg_fatal("unexpected result set size while fetching remote files");
 
-		/* sanity check the result set */
-		if (PQnfields(res) != 3 || PQntuples(res) != 1)
-			pg_fatal("unexpected result set size while fetching remote files");
+	if (PQftype(res, 0) != TEXTOID ||
+		PQftype(res, 1) != INT8OID ||
+		PQftype(res, 2) != BYTEAOID)
+	{
+		pg_fatal("unexpected data types in result set while fetching remote files: %u %u %u",
+				 PQftype(res, 0), PQftype(res, 1), PQftype(res, 2));
+	}
 
-		if (PQftype(res, 0) != TEXTOID ||
-			PQftype(res, 1) != INT8OID ||
-			PQftype(res, 2) != BYTEAOID)
-		{
-			pg_fatal("unexpected data types in result set while fetching remote files: %u %u %u",
-					 PQftype(res, 0), PQftype(res, 1), PQftype(res, 2));
-		}
+	if (PQfformat(res, 0) != 1 &&
+		PQfformat(res, 1) != 1 &&
+		PQfformat(res, 2) != 1)
+	{
+		pg_fatal("unexpected result format while fetching remote files");
+	}
 
-		if (PQfformat(res, 0) != 1 &&
-			PQfformat(res, 1) != 1 &&
-			PQfformat(res, 2) != 1)
-		{
-			pg_fatal("unexpected result format while fetching remote files");
-		}
+	if (PQgetisnull(res, 0, 0) ||
+		PQgetisnull(res, 0, 1))
+	{
+		pg_fatal("unexpected null values in result while fetching remote files");
+	}
 
-		if (PQgetisnull(res, 0, 0) ||
-			PQgetisnull(res, 0, 1))
-		{
-			pg_fatal("unexpected null values in result while fetching remote files");
-		}
+	if (PQgetlength(res, 0, 1) != sizeof(int64))
+		pg_fatal("unexpected result length while fetching remote files");
 
-		if (PQgetlength(res, 0, 1) != sizeof(int64))
-			pg_fatal("unexpected result length while fetching remote files");
+	/* Read result set to local variables */
+	memcpy(&chunkoff, PQgetvalue(res, 0, 1), sizeof(int64));
+	chunkoff = pg_ntoh64(chunkoff);
+	chunksize = PQgetlength(res, 0, 2);
 
-		/* Read result set to local variables */
-		memcpy(&chunkoff, PQgetvalue(res, 0, 1), sizeof(int64));
-		chunkoff = pg_ntoh64(chunkoff);
-		chunksize = PQgetlength(res, 0, 2);
+	filenamelen = PQgetlength(res, 0, 0);
+	filename = pg_malloc(filenamelen + 1);
+	memcpy(filename, PQgetvalue(res, 0, 0), filenamelen);
+	filename[filenamelen] = '\0';
 
-		filenamelen = PQgetlength(res, 0, 0);
-		filename = pg_malloc(filenamelen + 1);
-		memcpy(filename, PQgetvalue(res, 0, 0), filenamelen);
-		filename[filenamelen] = '\0';
+	chunk = PQgetvalue(res, 0, 2);
 
-		chunk = PQgetvalue(res, 0, 2);
+	/*
+	 * If a file has been deleted on the source, remove it on the target as
+	 * well.  Note that multiple unlink() calls may happen on the same file if
+	 * multiple data chunks are associated with it, hence ignore
+	 * unconditionally anything missing.
+	 */
+	if (PQgetisnull(res, 0, 2))
+	{
+		pg_log_debug("received null value for chunk for file \"%s\", file has been deleted",
+					 filename);
+		remove_target_file(filename, true);
+	}
+	else
+	{
+		pg_log_debug("received chunk for file \"%s\", offset %" PRId64 ", size %d",
+					 filename, chunkoff, chunksize);
 
-		/*
-		 * If a file has been deleted on the source, remove it on the target
-		 * as well.  Note that multiple unlink() calls may happen on the same
-		 * file if multiple data chunks are associated with it, hence ignore
-		 * unconditionally anything missing.
-		 */
-		if (PQgetisnull(res, 0, 2))
+		if (strcmp(filename, rq->path) != 0)
 		{
-			pg_log_debug("received null value for chunk for file \"%s\", file has been deleted",
-						 filename);
-			remove_target_file(filename, true);
+			pg_fatal("received data for file \"%s\", when requested for \"%s\"",
+					 filename, rq->path);
 		}
-		else
-		{
-			pg_log_debug("received chunk for file \"%s\", offset %" PRId64 ", size %d",
-						 filename, chunkoff, chunksize);
-
-			if (strcmp(filename, rq->path) != 0)
-			{
-				pg_fatal("received data for file \"%s\", when requested for \"%s\"",
-						 filename, rq->path);
-			}
-			if (chunkoff != rq->offset)
-				pg_fatal("received data at offset %" PRId64 " of file \"%s\", when requested for offset %lld",
-						 chunkoff, rq->path, (long long int) rq->offset);
-
-			/*
-			 * We should not receive more data than we requested, or
-			 * pg_read_binary_file() messed up.  We could receive less,
-			 * though, if the file was truncated in the source after we
-			 * checked its size. That's OK, there should be a WAL record of
-			 * the truncation, which will get replayed when you start the
-			 * target system for the first time after pg_rewind has completed.
-			 */
-			if (chunksize > rq->length)
-				pg_fatal("received more than requested for file \"%s\"", rq->path);
-
-			open_target_file(filename, false);
+		if (chunkoff != rq->offset)
+			pg_fatal("received data at offset %" PRId64 " of file \"%s\", when requested for offset %lld",
+					 chunkoff, rq->path, (long long int) rq->offset);
 
-			write_target_range(chunk, chunkoff, chunksize);
-		}
+		/*
+		 * We should not receive more data than we requested, or
+		 * pg_read_binary_file() messed up.  We could receive less, though,
+		 * if the file was truncated in the source after we checked its size.
+		 * That's OK, there should be a WAL record of the truncation, which
+		 * will get replayed when you start the target system for the first
+		 * time after pg_rewind has completed.
+		 */
+		if (chunksize > rq->length)
+			pg_fatal("received more than requested for file \"%s\"", rq->path);
 
-		pg_free(filename);
+		open_target_file(filename, false);
 
-		PQclear(res);
-		chunkno++;
+		write_target_range(chunk, chunkoff, chunksize);
 	}
-	if (chunkno != src->num_requests)
-		pg_fatal("unexpected number of data chunks received");
 
-	src->num_requests = 0;
+	pg_free(filename);
+
+	batch->chunkno++;
 }
 
 /*
@@ -675,6 +814,12 @@ libpq_destroy(rewind_source *source)
 {
 	libpq_source *src = (libpq_source *) source;
 
+	if (src->slots != NULL)
+	{
+		ParallelSlotsTerminate(src->slots);
+		pfree(src->slots);
+		pfree(src->slot_batches);
+	}
 	pfree(src->paths.data);
 	pfree(src->offsets.data);
 	pfree(src->lengths.data);
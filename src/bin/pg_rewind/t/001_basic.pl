@@ -13,7 +13,7 @@ use RewindTest;
 
 sub run_test
 {
-	my $test_mode = shift;
+	my ($test_mode, @rewind_options) = @_;
 
 	RewindTest::setup_cluster($test_mode);
 	RewindTest::start_primary();
@@ -156,7 +156,7 @@ sub run_test
 		$node_primary->start;
 	}
 
-	RewindTest::run_pg_rewind($test_mode);
+	RewindTest::run_pg_rewind($test_mode, @rewind_options);
 
 	check_query(
 		'SELECT * FROM space_tbl ORDER BY d',
@@ -209,6 +209,7 @@ in primary, before promotion
 # Run the test in both modes
 run_test('local');
 run_test('remote');
+run_test('remote', '--jobs' => 3);
 run_test('archive');
 
 done_testing();
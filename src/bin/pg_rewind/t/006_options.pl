@@ -44,5 +44,14 @@ command_fails(
 		'--write-recovery-conf'
 	],
 	'no local source with --write-recovery-conf');
+command_fails(
+	[
+		'pg_rewind',
+		'--debug',
+		'--target-pgdata' => $primary_pgdata,
+		'--source-pgdata' => $standby_pgdata,
+		'--jobs' => 2
+	],
+	'no local source with --jobs');
 
 done_testing();
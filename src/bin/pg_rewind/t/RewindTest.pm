@@ -207,7 +207,7 @@ sub promote_standby
 
 sub run_pg_rewind
 {
-	my $test_mode = shift;
+	my ($test_mode, @extra_options) = @_;
 	my $primary_pgdata = $node_primary->data_dir;
 	my $standby_pgdata = $node_standby->data_dir;
 	my $standby_connstr = $node_standby->connstr('postgres');
@@ -279,8 +279,9 @@ sub run_pg_rewind
 				'--no-sync',
 				'--write-recovery-conf',
 				'--config-file' => "$tmp_folder/primary-postgresql.conf.tmp",
+				@extra_options,
 			],
-			'pg_rewind remote');
+			join(' ', 'pg_rewind remote', @extra_options));
 
 		# Check that pg_rewind with dbname and --write-recovery-conf
 		# wrote the dbname in the generated primary_conninfo value.
@@ -0,0 +1,5 @@
+# src/bin/pg_test_costs/nls.mk
+CATALOG_NAME     = pg_test_costs
+GETTEXT_FILES    = $(FRONTEND_COMMON_GETTEXT_FILES) pg_test_costs.c ../../common/fe_memutils.c
+GETTEXT_TRIGGERS = $(FRONTEND_COMMON_GETTEXT_TRIGGERS) die
+GETTEXT_FLAGS    = $(FRONTEND_COMMON_GETTEXT_FLAGS)
@@ -0,0 +1,497 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_test_costs --- measure the I/O costs the planner's cost model is
+ *					 based on
+ *
+ * The planner charges seq_page_cost for each page read sequentially and
+ * random_page_cost for each page read in random order, and prefetches up to
+ * effective_io_concurrency pages ahead.  The defaults were chosen for
+ * spinning disks.  This program times sequential and random reads of a test
+ * file on the storage of interest, and random reads with increasing
+ * prefetch distances, and suggests values for those settings.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ *
+ * src/bin/pg_test_costs/pg_test_costs.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres_fe.h"
+
+#include <limits.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include "common/logging.h"
+#include "common/pg_prng.h"
+#include "getopt_long.h"
+#include "portability/instr_time.h"
+
+/*
+ * put the test file in the local directory
+ * unless the user specifies otherwise
+ */
+#define COSTS_FILENAME	"./pg_test_costs.out"
+
+/* size of the writes used to create the test file */
+#define WRITE_CHUNK_SIZE	(1024 * 1024)
+
+/* limits for --size and --max-prefetch */
+#define MAX_FILE_SIZE_MB	(1024 * 1024)
+#define MAX_PREFETCH		1024
+
+/* how many reads between checks of the clock */
+#define READS_PER_CHECK		16
+
+#define LABEL_FORMAT		"        %-34s"
+/* translator: maintain alignment with LABEL_FORMAT */
+#define PAGES_FORMAT		gettext_noop("%13.0f pages/sec  %8.2f usecs/page\n")
+
+static const char *progname;
+
+static unsigned int secs_per_test = 5;
+static unsigned int file_size_mb = 1024;
+static unsigned int max_prefetch = 64;
+static char *filename = COSTS_FILENAME;
+static int	needs_unlink = 0;
+static uint32 nblocks;
+alignas(PGAlignedBlock) static char buf[WRITE_CHUNK_SIZE];
+
+
+static void handle_args(int argc, char *argv[]);
+static void create_file(void);
+static void drop_cache(int fd, uint32 blkno, uint32 count);
+static double test_sequential(void);
+static double test_random(unsigned int distance);
+static void read_block(int fd, uint32 blkno);
+static void print_rate(const char *label, double usecs_per_page);
+static void signal_cleanup(SIGNAL_ARGS);
+
+#define die(msg) pg_fatal("%s: %m", _(msg))
+
+
+int
+main(int argc, char *argv[])
+{
+	double		seq_usecs;
+	double		random_usecs;
+	double		best_usecs;
+	unsigned int best_distance = 0;
+	double		random_page_cost;
+	unsigned int io_concurrency;
+	double		prefetch_usecs[32];
+	unsigned int ntests = 0;
+
+	pg_logging_init(argv[0]);
+	set_pglocale_pgservice(argv[0], PG_TEXTDOMAIN("pg_test_costs"));
+	progname = get_progname(argv[0]);
+
+	handle_args(argc, argv);
+
+	/* Prevent leaving behind the test file */
+	pqsignal(SIGINT, signal_cleanup);
+	pqsignal(SIGTERM, signal_cleanup);
+#ifndef WIN32
+	pqsignal(SIGHUP, signal_cleanup);
+#endif
+
+	pg_initialize_timing();
+	pg_prng_seed(&pg_global_prng_state, (uint64) time(NULL));
+
+	create_file();
+
+	printf(_("\nCompare sequential and random reads of %d kB pages:\n"),
+		   BLCKSZ / 1024);
+	seq_usecs = test_sequential();
+	print_rate(_("sequential"), seq_usecs);
+	random_usecs = test_random(0);
+	print_rate(_("random"), random_usecs);
+
+	/*
+	 * Now see how far ahead we have to prefetch to get the most out of the
+	 * device.  Stop early once doubling the distance no longer helps.
+	 */
+	best_usecs = random_usecs;
+#ifdef USE_PREFETCH
+	printf(_("\nCompare random reads with different prefetch distances:\n"));
+	for (unsigned int distance = 1; distance <= max_prefetch; distance *= 2)
+	{
+		char		label[64];
+		double		usecs;
+
+		snprintf(label, sizeof(label),
+				 ngettext("%u page ahead", "%u pages ahead", distance),
+				 distance);
+		usecs = test_random(distance);
+		print_rate(label, usecs);
+		prefetch_usecs[ntests++] = usecs;
+
+		/* give up once we're not gaining at least 5% anymore */
+		if (distance >= 8 && usecs > best_usecs * 0.95)
+			break;
+
+		if (usecs < best_usecs)
+		{
+			best_usecs = usecs;
+			best_distance = distance;
+		}
+	}
+#else
+	printf(_("\nPrefetching is not supported on this platform.\n"));
+#endif
+
+	/*
+	 * The suggested effective_io_concurrency is the smallest distance that
+	 * gets within 10% of the best random read throughput we saw.
+	 */
+	io_concurrency = 0;
+	if (best_distance > 0)
+	{
+		unsigned int distance = 1;
+
+		for (unsigned int i = 0; i < ntests; i++, distance *= 2)
+		{
+			if (prefetch_usecs[i] <= best_usecs * 1.1)
+			{
+				io_concurrency = distance;
+				break;
+			}
+		}
+	}
+
+	/* seq_page_cost is the unit the other costs are measured in */
+	random_page_cost = Max(random_usecs / seq_usecs, 1.0);
+
+	printf(_("\nSuggested settings for this storage:\n"));
+	printf("        seq_page_cost = 1.0\n");
+	printf("        random_page_cost = %.1f\n", random_page_cost);
+#ifdef USE_PREFETCH
+	printf("        effective_io_concurrency = %u\n", io_concurrency);
+#endif
+	printf(_("\nThese assume that none of the data is cached; if much of your data set\n"
+			 "usually is, a lower random_page_cost is appropriate.  To apply them to a\n"
+			 "tablespace only, use\n"
+			 "        ALTER TABLESPACE name SET (random_page_cost = %.1f"),
+		   random_page_cost);
+#ifdef USE_PREFETCH
+	printf(", effective_io_concurrency = %u", io_concurrency);
+#endif
+	printf(");\n");
+
+	unlink(filename);
+
+	return 0;
+}
+
+static void
+handle_args(int argc, char *argv[])
+{
+	static struct option long_options[] = {
+		{"filename", required_argument, NULL, 'f'},
+		{"secs-per-test", required_argument, NULL, 's'},
+		{"size", required_argument, NULL, 'S'},
+		{"max-prefetch", required_argument, NULL, 'p'},
+		{NULL, 0, NULL, 0}
+	};
+
+	int			option;			/* Command line option */
+	int			optindex = 0;	/* used by getopt_long */
+	unsigned long optval;		/* used for option parsing */
+	char	   *endptr;
+
+	if (argc > 1)
+	{
+		if (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-?") == 0)
+		{
+			printf(_("Usage: %s [-f FILENAME] [-s SECS-PER-TEST] [-S SIZE-MB] [-p MAX-PREFETCH]\n"), progname);
+			exit(0);
+		}
+		if (strcmp(argv[1], "--version") == 0 || strcmp(argv[1], "-V") == 0)
+		{
+			puts("pg_test_costs (PostgreSQL) " PG_VERSION);
+			exit(0);
+		}
+	}
+
+	while ((option = getopt_long(argc, argv, "f:s:S:p:",
+								 long_options, &optindex)) != -1)
+	{
+		const char *optname;
+
+		switch (option)
+		{
+			case 'f':
+				filename = pg_strdup(optarg);
+				continue;
+			case 's':
+				optname = "--secs-per-test";
+				break;
+			case 'S':
+				optname = "--size";
+				break;
+			case 'p':
+				optname = "--max-prefetch";
+				break;
+			default:
+				/* getopt_long already emitted a complaint */
+				pg_log_error_hint("Try \"%s --help\" for more information.", progname);
+				exit(1);
+		}
+
+		/* all the other options take a positive integer */
+		errno = 0;
+		optval = strtoul(optarg, &endptr, 10);
+
+		if (endptr == optarg || *endptr != '\0' ||
+			errno != 0 || optval != (unsigned int) optval)
+		{
+			pg_log_error("invalid argument for option %s", optname);
+			pg_log_error_hint("Try \"%s --help\" for more information.", progname);
+			exit(1);
+		}
+
+		switch (option)
+		{
+			case 's':
+				if (optval == 0)
+					pg_fatal("%s must be in range %u..%u",
+							 optname, 1, UINT_MAX);
+				secs_per_test = (unsigned int) optval;
+				break;
+			case 'S':
+				if (optval == 0 || optval > MAX_FILE_SIZE_MB)
+					pg_fatal("%s must be in range %u..%u",
+							 optname, 1, MAX_FILE_SIZE_MB);
+				file_size_mb = (unsigned int) optval;
+				break;
+			case 'p':
+				if (optval == 0 || optval > MAX_PREFETCH)
+					pg_fatal("%s must be in range %u..%u",
+							 optname, 1, MAX_PREFETCH);
+				max_prefetch = (unsigned int) optval;
+				break;
+		}
+	}
+
+	if (argc > optind)
+	{
+		pg_log_error("too many command-line arguments (first is \"%s\")",
+					 argv[optind]);
+		pg_log_error_hint("Try \"%s --help\" for more information.", progname);
+		exit(1);
+	}
+
+	nblocks = file_size_mb * (1024 * 1024 / BLCKSZ);
+
+	printf(ngettext("%u second per test\n",
+					"%u seconds per test\n",
+					secs_per_test),
+		   secs_per_test);
+	printf(_("%u MB test file\n"), file_size_mb);
+#ifndef USE_POSIX_FADVISE
+	printf(_("Cannot drop the test file from the OS cache on this platform;\n"
+			 "use a test file larger than the amount of memory.\n"));
+#endif
+}
+
+/*
+ * Create the test file, and make sure none of it is cached.
+ */
+static void
+create_file(void)
+{
+	int			fd;
+
+	/* fill the buffer with random data, so compression doesn't help */
+	for (int i = 0; i < WRITE_CHUNK_SIZE; i++)
+		buf[i] = (char) pg_prng_int32(&pg_global_prng_state);
+
+	if ((fd = open(filename, O_RDWR | O_CREAT | O_TRUNC | PG_BINARY,
+				   S_IRUSR | S_IWUSR)) == -1)
+		die("could not open output file");
+	needs_unlink = 1;
+
+	for (unsigned int i = 0; i < file_size_mb; i++)
+	{
+		if (write(fd, buf, WRITE_CHUNK_SIZE) != WRITE_CHUNK_SIZE)
+			die("write failed");
+	}
+
+	/* the pages must be clean before the kernel lets us drop them */
+	if (fsync(fd) != 0)
+		die("fsync failed");
+
+	drop_cache(fd, 0, nblocks);
+
+	close(fd);
+}
+
+/*
+ * Ask the kernel to forget the given range of blocks, so that the next read
+ * of them goes to the storage.
+ */
+static void
+drop_cache(int fd, uint32 blkno, uint32 count)
+{
+#ifdef USE_POSIX_FADVISE
+	(void) posix_fadvise(fd, (off_t) blkno * BLCKSZ, (off_t) count * BLCKSZ,
+						 POSIX_FADV_DONTNEED);
+#endif
+}
+
+static void
+read_block(int fd, uint32 blkno)
+{
+	if (pg_pread(fd, buf, BLCKSZ, (off_t) blkno * BLCKSZ) != BLCKSZ)
+		die("read failed");
+}
+
+/*
+ * Read the file sequentially, starting over at the beginning when we reach
+ * the end, for secs_per_test seconds.  Returns the average time per page in
+ * microseconds.
+ */
+static double
+test_sequential(void)
+{
+	int			fd;
+	instr_time	start_t,
+				now_t;
+	uint64		reads = 0;
+	uint32		blkno = 0;
+
+	if ((fd = open(filename, O_RDONLY | PG_BINARY, 0)) == -1)
+		die("could not open output file");
+
+	INSTR_TIME_SET_CURRENT(start_t);
+	for (;;)
+	{
+		read_block(fd, blkno);
+		reads++;
+
+		if (++blkno == nblocks)
+		{
+			/* pages we read in the previous pass must not be cached */
+			drop_cache(fd, 0, nblocks);
+			blkno = 0;
+		}
+
+		if (reads % READS_PER_CHECK == 0)
+		{
+			INSTR_TIME_SET_CURRENT(now_t);
+			INSTR_TIME_SUBTRACT(now_t, start_t);
+			if (INSTR_TIME_GET_DOUBLE(now_t) >= secs_per_test)
+				break;
+		}
+	}
+
+	drop_cache(fd, 0, nblocks);
+	close(fd);
+
+	return INSTR_TIME_GET_MICROSEC(now_t) / (double) reads;
+}
+
+/*
+ * Read randomly chosen pages for secs_per_test seconds, advising the kernel
+ * of the page 'distance' reads ahead if 'distance' is not 0.  Returns the
+ * average time per page in microseconds.
+ */
+static double
+test_random(unsigned int distance)
+{
+	int			fd;
+	instr_time	start_t,
+				now_t;
+	uint64		reads = 0;
+	uint32	   *upcoming;
+	unsigned int next = 0;
+
+	if ((fd = open(filename, O_RDONLY | PG_BINARY, 0)) == -1)
+		die("could not open output file");
+
+#ifdef USE_POSIX_FADVISE
+	/* sequential read-ahead would only pull in pages we don't want */
+	(void) posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+#endif
+
+	/*
+	 * 'upcoming' is a ring of the next 'distance' pages to read, all of which
+	 * have been prefetched already.
+	 */
+	upcoming = pg_malloc_array(uint32, Max(distance, 1));
+	for (unsigned int i = 0; i < distance; i++)
+	{
+		upcoming[i] = pg_prng_uint64_range(&pg_global_prng_state, 0, nblocks - 1);
+#ifdef USE_PREFETCH
+		(void) posix_fadvise(fd, (off_t) upcoming[i] * BLCKSZ, BLCKSZ,
+							 POSIX_FADV_WILLNEED);
+#endif
+	}
+
+	INSTR_TIME_SET_CURRENT(start_t);
+	for (;;)
+	{
+		uint32		blkno;
+		uint32		newblkno;
+
+		newblkno = pg_prng_uint64_range(&pg_global_prng_state, 0, nblocks - 1);
+		if (distance > 0)
+		{
+			blkno = upcoming[next];
+			upcoming[next] = newblkno;
+			next = (next + 1) % distance;
+#ifdef USE_PREFETCH
+			(void) posix_fadvise(fd, (off_t) newblkno * BLCKSZ, BLCKSZ,
+								 POSIX_FADV_WILLNEED);
+#endif
+		}
+		else
+			blkno = newblkno;
+
+		read_block(fd, blkno);
+		reads++;
+
+		/* make sure a later read of the same page isn't a cache hit */
+		drop_cache(fd, blkno, 1);
+
+		if (reads % READS_PER_CHECK == 0)
+		{
+			INSTR_TIME_SET_CURRENT(now_t);
+			INSTR_TIME_SUBTRACT(now_t, start_t);
+			if (INSTR_TIME_GET_DOUBLE(now_t) >= secs_per_test)
+				break;
+		}
+	}
+
+	pg_free(upcoming);
+	drop_cache(fd, 0, nblocks);
+	close(fd);
+
+	return INSTR_TIME_GET_MICROSEC(now_t) / (double) reads;
+}
+
+static void
+print_rate(const char *label, double usecs_per_page)
+{
+	printf(LABEL_FORMAT, label);
+	printf(_(PAGES_FORMAT), 1000000.0 / usecs_per_page, usecs_per_page);
+	fflush(stdout);
+}
+
+static void
+signal_cleanup(SIGNAL_ARGS)
+{
+	int			rc;
+
+	/* Delete the file if it exists. Ignore errors */
+	if (needs_unlink)
+		unlink(filename);
+	/* Finish incomplete line on stdout */
+	rc = write(STDOUT_FILENO, "\n", 1);
+	(void) rc;					/* silence compiler warnings */
+	_exit(1);
+}
@@ -0,0 +1,53 @@
+# Copyright (c) 2025, PostgreSQL Global Development Group
+
+use strict;
+use warnings FATAL => 'all';
+
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+#########################################
+# Basic checks
+
+program_help_ok('pg_test_costs');
+program_version_ok('pg_test_costs');
+program_options_handling_ok('pg_test_costs');
+
+#########################################
+# Test invalid option combinations
+
+command_fails_like(
+	[ 'pg_test_costs', '--secs-per-test' => 'a' ],
+	qr/\Qpg_test_costs: error: invalid argument for option --secs-per-test\E/,
+	'pg_test_costs: invalid argument for option --secs-per-test');
+command_fails_like(
+	[ 'pg_test_costs', '--secs-per-test' => '0' ],
+	qr/\Qpg_test_costs: error: --secs-per-test must be in range 1..4294967295\E/,
+	'pg_test_costs: --secs-per-test must be in range');
+command_fails_like(
+	[ 'pg_test_costs', '--size' => '0' ],
+	qr/\Qpg_test_costs: error: --size must be in range 1..1048576\E/,
+	'pg_test_costs: --size must be in range');
+command_fails_like(
+	[ 'pg_test_costs', '--max-prefetch' => '2000' ],
+	qr/\Qpg_test_costs: error: --max-prefetch must be in range 1..1024\E/,
+	'pg_test_costs: --max-prefetch must be in range');
+
+#########################################
+# Run the tests on a small file
+
+my $tempdir = PostgreSQL::Test::Utils::tempdir;
+
+command_like(
+	[
+		'pg_test_costs',
+		'--filename' => "$tempdir/pg_test_costs.out",
+		'--secs-per-test' => '1',
+		'--size' => '1',
+		'--max-prefetch' => '2',
+	],
+	qr/random_page_cost = \d+\.\d/,
+	'pg_test_costs: suggests random_page_cost');
+ok(!-e "$tempdir/pg_test_costs.out", 'pg_test_costs: test file removed');
+
+done_testing();
@@ -7,6 +7,7 @@
 #include "postgres_fe.h"
 
 #include <limits.h>
+#include <math.h>
 
 #include "getopt_long.h"
 #include "port/pg_bitutils.h"
@@ -30,6 +31,7 @@ static long long int largest_diff_count;
 
 
 static void handle_args(int argc, char *argv[]);
+static void report_clock_source(void);
 static uint64 test_timing(unsigned int duration);
 static void output(uint64 loop_count);
 
@@ -43,6 +45,9 @@ main(int argc, char *argv[])
 
 	handle_args(argc, argv);
 
+	pg_initialize_timing();
+	report_clock_source();
+
 	loop_count = test_timing(test_duration);
 
 	output(loop_count);
@@ -149,6 +154,23 @@ handle_args(int argc, char *argv[])
 		   test_duration);
 }
 
+/*
+ * Report the clock source that instr_time uses, as the server would choose it
+ */
+static void
+report_clock_source(void)
+{
+#ifdef PG_INSTR_TSC
+	if (pg_timing_use_tsc)
+	{
+		printf(_("Using the time stamp counter at %.3f MHz.\n"),
+			   pg_tsc_frequency / 1e6);
+		return;
+	}
+#endif
+	printf(_("Using the system clock.\n"));
+}
+
 static uint64
 test_timing(unsigned int duration)
 {
@@ -160,6 +182,10 @@ test_timing(unsigned int duration)
 	instr_time	start_time,
 				end_time,
 				temp;
+#ifdef PG_INSTR_TSC
+	instr_time	sys_start_time,
+				sys_end_time;
+#endif
 
 	/*
 	 * Pre-zero the statistics data structures.  They're already zero by
@@ -173,6 +199,9 @@ test_timing(unsigned int duration)
 
 	total_time = duration > 0 ? duration * INT64CONST(1000000000) : 0;
 
+#ifdef PG_INSTR_TSC
+	sys_start_time = pg_clock_gettime_ns();
+#endif
 	INSTR_TIME_SET_CURRENT(start_time);
 	cur = INSTR_TIME_GET_NANOSEC(start_time);
 
@@ -222,12 +251,34 @@ test_timing(unsigned int duration)
 	}
 
 	INSTR_TIME_SET_CURRENT(end_time);
+#ifdef PG_INSTR_TSC
+	sys_end_time = pg_clock_gettime_ns();
+#endif
 
 	INSTR_TIME_SUBTRACT(end_time, start_time);
 
 	printf(_("Average loop time including overhead: %0.2f ns\n"),
 		   INSTR_TIME_GET_DOUBLE(end_time) * 1e9 / loop_count);
 
+#ifdef PG_INSTR_TSC
+
+	/*
+	 * Check the time stamp counter's frequency by comparing the elapsed time
+	 * it measured with the system clock's measurement.
+	 */
+	if (pg_timing_use_tsc)
+	{
+		double		tsc_ns = INSTR_TIME_GET_NANOSEC(end_time);
+		double		sys_ns = sys_end_time.ticks - sys_start_time.ticks;
+		double		deviation = (tsc_ns - sys_ns) * 100 / sys_ns;
+
+		printf(_("Time stamp counter deviation from system clock: %0.4f%%\n"),
+			   deviation);
+		if (fabs(deviation) > 0.1)
+			fprintf(stderr, _("The time stamp counter frequency appears to be inaccurate.\n"));
+	}
+#endif
+
 	return loop_count;
 }
 
@@ -18,10 +18,16 @@
 #include <limits.h>
 #include <sys/stat.h>
 #include <time.h>
+#ifndef WIN32
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#endif
 
 #include "access/xlog_internal.h"
 #include "common/logging.h"
 #include "common/parse_manifest.h"
+#include "fe_utils/option_utils.h"
 #include "fe_utils/simple_list.h"
 #include "getopt_long.h"
 #include "pg_verifybackup.h"
@@ -46,6 +52,12 @@
  */
 #define READ_CHUNK_SIZE				(128 * 1024)
 
+/*
+ * How many bytes should we read at once when computing checksums?  Backups
+ * can be large, so we use bigger reads for that than for anything else.
+ */
+#define CHECKSUM_CHUNK_SIZE			(1024 * 1024)
+
 /*
  * Tar file information needed for content verification.
  */
@@ -87,7 +99,13 @@ static void precheck_tar_backup_file(verifier_context *context, char *relpath,
 static void verify_tar_file(verifier_context *context, char *relpath,
 							char *fullpath, astreamer *streamer);
 static void report_extra_backup_files(verifier_context *context);
+static void mark_unchanged_files(verifier_context *context,
+								 char *since_manifest_path);
 static void verify_backup_checksums(verifier_context *context);
+#ifndef WIN32
+static void verify_checksums_in_parallel(verifier_context *context,
+										 manifest_file **files, int nfiles);
+#endif
 static void verify_file_checksum(verifier_context *context,
 								 manifest_file *m, char *fullpath,
 								 uint8 *buffer);
@@ -111,6 +129,15 @@ static bool show_progress = false;
 static uint64 total_size = 0;
 static uint64 done_size = 0;
 
+/* number of parallel jobs to verify checksums with */
+static int	num_jobs = 1;
+
+/*
+ * In a parallel job, where to publish our done_size for the leader's progress
+ * report.
+ */
+static uint64 *job_done_size = NULL;
+
 /*
  * Main entry point.
  */
@@ -120,6 +147,7 @@ main(int argc, char **argv)
 	static struct option long_options[] = {
 		{"exit-on-error", no_argument, NULL, 'e'},
 		{"ignore", required_argument, NULL, 'i'},
+		{"jobs", required_argument, NULL, 'j'},
 		{"manifest-path", required_argument, NULL, 'm'},
 		{"format", required_argument, NULL, 'F'},
 		{"no-parse-wal", no_argument, NULL, 'n'},
@@ -127,12 +155,14 @@ main(int argc, char **argv)
 		{"quiet", no_argument, NULL, 'q'},
 		{"skip-checksums", no_argument, NULL, 's'},
 		{"wal-directory", required_argument, NULL, 'w'},
+		{"since-manifest", required_argument, NULL, 1},
 		{NULL, 0, NULL, 0}
 	};
 
 	int			c;
 	verifier_context context;
 	char	   *manifest_path = NULL;
+	char	   *since_manifest_path = NULL;
 	bool		no_parse_wal = false;
 	bool		quiet = false;
 	char	   *wal_directory = NULL;
@@ -180,7 +210,7 @@ main(int argc, char **argv)
 	simple_string_list_append(&context.ignore_list, "recovery.signal");
 	simple_string_list_append(&context.ignore_list, "standby.signal");
 
-	while ((c = getopt_long(argc, argv, "eF:i:m:nPqsw:", long_options, NULL)) != -1)
+	while ((c = getopt_long(argc, argv, "eF:i:j:m:nPqsw:", long_options, NULL)) != -1)
 	{
 		switch (c)
 		{
@@ -195,6 +225,11 @@ main(int argc, char **argv)
 					simple_string_list_append(&context.ignore_list, arg);
 					break;
 				}
+			case 'j':
+				if (!option_parse_int(optarg, "-j/--jobs", 1, INT_MAX,
+									  &num_jobs))
+					exit(1);
+				break;
 			case 'm':
 				manifest_path = pstrdup(optarg);
 				canonicalize_path(manifest_path);
@@ -224,6 +259,10 @@ main(int argc, char **argv)
 				wal_directory = pstrdup(optarg);
 				canonicalize_path(wal_directory);
 				break;
+			case 1:
+				since_manifest_path = pstrdup(optarg);
+				canonicalize_path(since_manifest_path);
+				break;
 			default:
 				/* getopt_long already emitted a complaint */
 				pg_log_error_hint("Try \"%s --help\" for more information.", progname);
@@ -255,6 +294,11 @@ main(int argc, char **argv)
 		pg_fatal("cannot specify both %s and %s",
 				 "-P/--progress", "-q/--quiet");
 
+#ifdef WIN32
+	if (num_jobs > 1)
+		pg_fatal("parallel jobs are not supported on this platform");
+#endif
+
 	/* Unless --no-parse-wal was specified, we will need pg_waldump. */
 	if (!no_parse_wal)
 	{
@@ -296,6 +340,13 @@ main(int argc, char **argv)
 	 */
 	context.manifest = parse_manifest_file(manifest_path);
 
+	/*
+	 * If we were given a manifest that was verified before, we needn't
+	 * verify the checksums of the files that it lists in the same way.
+	 */
+	if (since_manifest_path != NULL)
+		mark_unchanged_files(&context, since_manifest_path);
+
 	/*
 	 * If the backup directory cannot be found, treat this as a fatal error.
 	 */
@@ -570,6 +621,7 @@ verifybackup_per_file_cb(JsonManifestParseContext *context,
 	m->checksum_payload = checksum_payload;
 	m->matched = false;
 	m->bad = false;
+	m->unchanged = false;
 }
 
 /*
@@ -1050,6 +1102,49 @@ report_extra_backup_files(verifier_context *context)
 								m->pathname);
 }
 
+/*
+ * Mark the files whose manifest entries are identical to their entries in
+ * the manifest at since_manifest_path, which the user tells us belongs to a
+ * backup that was verified before, so that we don't verify their checksums
+ * again.
+ *
+ * This is meant for backups that are updated in place or that share files
+ * with earlier backups, such as ones combined by pg_combinebackup --link:
+ * only the files that changed since the earlier verification need their
+ * contents read. The other checks still apply to all files.
+ */
+static void
+mark_unchanged_files(verifier_context *context, char *since_manifest_path)
+{
+	manifest_data *manifest = context->manifest;
+	manifest_data *since_manifest;
+	manifest_files_iterator it;
+	manifest_file *m;
+
+	since_manifest = parse_manifest_file(since_manifest_path);
+
+	if (manifest->version != 1 && since_manifest->version != 1 &&
+		manifest->system_identifier != since_manifest->system_identifier)
+		report_fatal_error("manifest \"%s\" is for a different system than the backup",
+						   since_manifest_path);
+
+	manifest_files_start_iterate(manifest->files, &it);
+	while ((m = manifest_files_iterate(manifest->files, &it)) != NULL)
+	{
+		manifest_file *since_m;
+
+		since_m = manifest_files_lookup(since_manifest->files, m->pathname);
+		if (since_m != NULL &&
+			m->checksum_type != CHECKSUM_TYPE_NONE &&
+			since_m->size == m->size &&
+			since_m->checksum_type == m->checksum_type &&
+			since_m->checksum_length == m->checksum_length &&
+			memcmp(since_m->checksum_payload, m->checksum_payload,
+				   m->checksum_length) == 0)
+			m->unchanged = true;
+	}
+}
+
 /*
  * Verify checksums for hash table entries that are otherwise unproblematic.
  * If we've already reported some problem related to a hash table entry, or
@@ -1061,37 +1156,186 @@ verify_backup_checksums(verifier_context *context)
 	manifest_data *manifest = context->manifest;
 	manifest_files_iterator it;
 	manifest_file *m;
+	manifest_file **files;
+	int			nfiles = 0;
 	uint8	   *buffer;
 
 	progress_report(false);
 
-	buffer = pg_malloc(READ_CHUNK_SIZE * sizeof(uint8));
-
+	/* Collect the files to verify. */
+	files = pg_malloc_array(manifest_file *, manifest->files->members);
 	manifest_files_start_iterate(manifest->files, &it);
 	while ((m = manifest_files_iterate(manifest->files, &it)) != NULL)
 	{
 		if (should_verify_checksum(m) &&
 			!should_ignore_relpath(context, m->pathname))
-		{
-			char	   *fullpath;
+			files[nfiles++] = m;
+	}
 
-			/* Compute the full pathname to the target file. */
-			fullpath = psprintf("%s/%s", context->backup_directory,
-								m->pathname);
+#ifndef WIN32
+	if (num_jobs > 1 && nfiles > 1)
+	{
+		verify_checksums_in_parallel(context, files, nfiles);
+		pfree(files);
+		progress_report(true);
+		return;
+	}
+#endif
 
-			/* Do the actual checksum verification. */
-			verify_file_checksum(context, m, fullpath, buffer);
+	buffer = pg_malloc(CHECKSUM_CHUNK_SIZE * sizeof(uint8));
 
-			/* Avoid leaking memory. */
-			pfree(fullpath);
-		}
+	for (int i = 0; i < nfiles; i++)
+	{
+		char	   *fullpath;
+
+		/* Compute the full pathname to the target file. */
+		fullpath = psprintf("%s/%s", context->backup_directory,
+							files[i]->pathname);
+
+		/* Do the actual checksum verification. */
+		verify_file_checksum(context, files[i], fullpath, buffer);
+
+		/* Avoid leaking memory. */
+		pfree(fullpath);
 	}
 
 	pfree(buffer);
+	pfree(files);
 
 	progress_report(true);
 }
 
+#ifndef WIN32
+/*
+ * Verify the checksums of the given files using num_jobs child processes.
+ *
+ * The jobs take the index of the next file to verify from a pipe, so that
+ * one job that got a few large files doesn't hold up the others. Each index
+ * is written with a single write() of sizeof(int) bytes, which is atomic, so
+ * a read() of the same size never gets a partial index. The jobs report
+ * problems themselves, and tell us about them by their exit status.
+ */
+static void
+verify_checksums_in_parallel(verifier_context *context,
+							 manifest_file **files, int nfiles)
+{
+	int			taskpipe[2];
+	int			njobs = Min(num_jobs, nfiles);
+	int			nrunning;
+	pid_t	   *pids;
+	uint64	   *shared_done_size;
+
+	shared_done_size = mmap(NULL, njobs * sizeof(uint64),
+							PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+							-1, 0);
+	if (shared_done_size == MAP_FAILED)
+		report_fatal_error("could not allocate shared memory: %m");
+	memset(shared_done_size, 0, njobs * sizeof(uint64));
+
+	if (pipe(taskpipe) < 0)
+		report_fatal_error("could not create pipe: %m");
+
+	/* If all the jobs die, we want an error from write(), not a signal. */
+	pqsignal(SIGPIPE, SIG_IGN);
+
+	pids = pg_malloc_array(pid_t, njobs);
+	for (int i = 0; i < njobs; i++)
+	{
+		/* Don't let the child write out our buffered output again. */
+		fflush(NULL);
+
+		pids[i] = fork();
+		if (pids[i] == 0)
+		{
+			uint8	   *buffer;
+			int			taskno;
+			ssize_t		rc;
+
+			/* in child process; the leader reports progress */
+			close(taskpipe[1]);
+			show_progress = false;
+			job_done_size = &shared_done_size[i];
+
+			buffer = pg_malloc(CHECKSUM_CHUNK_SIZE * sizeof(uint8));
+			while ((rc = read(taskpipe[0], &taskno, sizeof(taskno))) ==
+				   sizeof(taskno))
+			{
+				manifest_file *m = files[taskno];
+				char	   *fullpath;
+
+				fullpath = psprintf("%s/%s", context->backup_directory,
+									m->pathname);
+				verify_file_checksum(context, m, fullpath, buffer);
+				pfree(fullpath);
+			}
+			if (rc != 0)
+				report_fatal_error("could not read from pipe: %m");
+
+			exit(context->saw_any_error ? 1 : 0);
+		}
+		else if (pids[i] < 0)
+			report_fatal_error("could not create child process: %m");
+	}
+	close(taskpipe[0]);
+
+	/*
+	 * Hand out the files. The write only fails if all the jobs have exited,
+	 * which we'll hear about below.
+	 */
+	for (int i = 0; i < nfiles; i++)
+	{
+		if (write(taskpipe[1], &i, sizeof(i)) != sizeof(i))
+			break;
+	}
+	close(taskpipe[1]);
+
+	/* Wait for the jobs to finish, reporting progress meanwhile. */
+	nrunning = njobs;
+	while (nrunning > 0)
+	{
+		int			status;
+		pid_t		pid;
+
+		pid = waitpid(-1, &status, show_progress ? WNOHANG : 0);
+		if (pid == (pid_t) -1)
+			report_fatal_error("could not wait for child process: %m");
+
+		done_size = 0;
+		for (int i = 0; i < njobs; i++)
+			done_size += shared_done_size[i];
+
+		if (pid == 0)
+		{
+			progress_report(false);
+			pg_usleep(100000L);
+			continue;
+		}
+		nrunning--;
+
+		if (status != 0)
+		{
+			/* A job that exited with an error has reported it already. */
+			if (!WIFEXITED(status))
+				pg_log_error("%s", wait_result_to_str(status));
+			context->saw_any_error = true;
+
+			if (context->exit_on_error)
+			{
+				for (int i = 0; i < njobs; i++)
+				{
+					if (pids[i] != pid)
+						kill(pids[i], SIGTERM);
+				}
+				exit(1);
+			}
+		}
+	}
+
+	pfree(pids);
+	munmap(shared_done_size, njobs * sizeof(uint64));
+}
+#endif							/* !WIN32 */
+
 /*
  * Verify the checksum of a single file.
  */
@@ -1115,6 +1359,11 @@ verify_file_checksum(verifier_context *context, manifest_file *m,
 		return;
 	}
 
+#if defined(USE_POSIX_FADVISE) && defined(POSIX_FADV_SEQUENTIAL)
+	/* We'll read the whole file in order, so ask for aggressive readahead. */
+	(void) posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
 	/* Initialize checksum context. */
 	if (pg_checksum_init(&checksum_ctx, m->checksum_type) < 0)
 	{
@@ -1125,7 +1374,7 @@ verify_file_checksum(verifier_context *context, manifest_file *m,
 	}
 
 	/* Read the file chunk by chunk, updating the checksum as we go. */
-	while ((rc = read(fd, buffer, READ_CHUNK_SIZE)) > 0)
+	while ((rc = read(fd, buffer, CHECKSUM_CHUNK_SIZE)) > 0)
 	{
 		bytes_read += rc;
 		if (pg_checksum_update(&checksum_ctx, buffer, rc) < 0)
@@ -1138,6 +1387,8 @@ verify_file_checksum(verifier_context *context, manifest_file *m,
 
 		/* Report progress */
 		done_size += rc;
+		if (job_done_size != NULL)
+			*job_done_size = done_size;
 		progress_report(false);
 	}
 	if (rc < 0)
@@ -1371,12 +1622,15 @@ usage(void)
 	printf(_("  -e, --exit-on-error         exit immediately on error\n"));
 	printf(_("  -F, --format=p|t            backup format (plain, tar)\n"));
 	printf(_("  -i, --ignore=RELATIVE_PATH  ignore indicated path\n"));
+	printf(_("  -j, --jobs=NUM              use this many parallel jobs to verify checksums\n"));
 	printf(_("  -m, --manifest-path=PATH    use specified path for manifest\n"));
 	printf(_("  -n, --no-parse-wal          do not try to parse WAL files\n"));
 	printf(_("  -P, --progress              show progress information\n"));
 	printf(_("  -q, --quiet                 do not print any output, except for errors\n"));
 	printf(_("  -s, --skip-checksums        skip checksum verification\n"));
 	printf(_("  -w, --wal-directory=PATH    use specified path for WAL files\n"));
+	printf(_("      --since-manifest=PATH   skip checksums of files unchanged since the\n"
+			 "                              backup with this manifest was verified\n"));
 	printf(_("  -V, --version               output version information, then exit\n"));
 	printf(_("  -?, --help                  show this help, then exit\n"));
 	printf(_("\nReport bugs to <%s>.\n"), PACKAGE_BUGREPORT);
@@ -35,10 +35,12 @@ typedef struct manifest_file
 	uint8	   *checksum_payload;
 	bool		matched;
 	bool		bad;
+	bool		unchanged;		/* same as in the --since-manifest manifest */
 } manifest_file;
 
 #define should_verify_checksum(m) \
-	(((m)->matched) && !((m)->bad) && (((m)->checksum_type) != CHECKSUM_TYPE_NONE))
+	(((m)->matched) && !((m)->bad) && !((m)->unchanged) && \
+	 (((m)->checksum_type) != CHECKSUM_TYPE_NONE))
 
 /*
  * Define a hash table which we can use to store information about the files
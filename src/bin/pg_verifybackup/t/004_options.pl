@@ -39,6 +39,10 @@ $primary->command_ok(
 	[ 'pg_verifybackup', '--format' => 'plain', $backup_path ],
 	"verifies with --format=plain");
 
+# Should also work with parallel jobs.
+$primary->command_ok([ 'pg_verifybackup', '--jobs' => 3, $backup_path ],
+	"verifies with --jobs");
+
 # Should not work if we specify --format=y because that's invalid.
 $primary->command_fails_like(
 	[ 'pg_verifybackup', '--format' => 'y', $backup_path ],
@@ -75,6 +79,23 @@ command_fails_like(
 	qr/checksum mismatch for file \"PG_VERSION\"/,
 	'--quiet checksum mismatch');
 
+# Parallel jobs should notice the problem, too.
+command_fails_like(
+	[ 'pg_verifybackup', '--jobs' => 3, $backup_path ],
+	qr/checksum mismatch for file \"PG_VERSION\"/,
+	'--jobs checksum mismatch');
+
+# If the manifest is the same as one that was verified before, no checksums
+# are verified, so the problem goes unnoticed.
+command_like(
+	[
+		'pg_verifybackup',
+		'--since-manifest' => "$backup_path/backup_manifest",
+		$backup_path
+	],
+	qr/backup successfully verified/,
+	'--since-manifest skips checksums of unchanged files');
+
 # Since we didn't change the length of the file, verification should succeed
 # if we ignore checksums. Check that we get the right message, too.
 command_like(
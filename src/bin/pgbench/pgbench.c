@@ -268,6 +268,7 @@ static bool is_connect;			/* establish connection for each transaction */
 static bool report_per_command = false; /* report per-command latencies,
 										 * retries after errors and failures
 										 * (errors without retrying) */
+static bool latency_percentiles = false;	/* report latency percentiles */
 static int	main_pid;			/* main process id used in log filename */
 
 /*
@@ -349,6 +350,17 @@ typedef struct
 #define MAX_SCRIPTS		128		/* max number of SQL scripts allowed */
 #define SHELL_COMMAND_SIZE	256 /* maximum size allowed for shell command */
 
+/*
+ * Latency histogram buckets, in the manner of HdrHistogram: each value below
+ * 2^HIST_SUB_BITS microseconds has a bucket of its own, and each power of two
+ * above that is split into 2^(HIST_SUB_BITS - 1) buckets, so that all values
+ * in a bucket are within about 3% of each other.  Values of 2^HIST_MAX_BITS
+ * microseconds (about 76 hours) and more all go to the last bucket.
+ */
+#define HIST_SUB_BITS	6
+#define HIST_MAX_BITS	38
+#define HIST_BUCKETS	((HIST_MAX_BITS - HIST_SUB_BITS + 2) << (HIST_SUB_BITS - 1))
+
 /*
  * Simple data structure to keep stats about something.
  *
@@ -362,6 +374,8 @@ typedef struct SimpleStats
 	double		max;			/* the maximum seen */
 	double		sum;			/* sum of values */
 	double		sum2;			/* sum of squared values */
+	int64		hist[HIST_BUCKETS]; /* histogram of values in microseconds,
+									 * under --latency-percentiles */
 } SimpleStats;
 
 /*
@@ -852,6 +866,23 @@ static bool socket_has_input(socket_set *sa, int fd, int idx);
 /* callback used to build rows for COPY during data loading */
 typedef void (*initRowMethod) (PQExpBufferData *sql, int64 curr);
 
+/*
+ * State of a thread loading a range of pgbench_accounts over its own
+ * connection, when data generation is done with several jobs
+ */
+typedef struct
+{
+	THREAD_T	thread;			/* thread handle */
+	PGconn	   *con;			/* connection used by this thread */
+	bool		server_side;	/* generate the rows on the server? */
+	int64		start;			/* first row to generate, counting from 0 */
+	int64		end;			/* one past the last row to generate */
+	volatile int64 done;		/* rows sent so far, for progress reports */
+	volatile bool finished;		/* has the thread completed its range? */
+} InitAccountsWorker;
+
+static THREAD_FUNC_RETURN_TYPE THREAD_FUNC_CC initAccountsWorker(void *arg);
+
 /* callback functions for our flex lexer */
 static const PsqlScanCallbacks pgbench_callbacks = {
 	NULL,						/* don't need get_variable functionality */
@@ -919,6 +950,7 @@ usage(void)
 		   "                           p: create primary key indexes on the standard tables\n"
 		   "                           f: create foreign keys between the standard tables\n"
 		   "  -F, --fillfactor=NUM     set fill factor\n"
+		   "  -j, --jobs=NUM           number of connections used to generate data (default: 1)\n"
 		   "  -n, --no-vacuum          do not run VACUUM during initialization\n"
 		   "  -q, --quiet              quiet logging (one message each 5 seconds)\n"
 		   "  -s, --scale=NUM          scaling factor\n"
@@ -960,6 +992,7 @@ usage(void)
 		   "  --continue-on-error      continue running after an SQL error\n"
 		   "  --exit-on-abort          exit when any client is aborted\n"
 		   "  --failures-detailed      report the failures grouped by basic types\n"
+		   "  --latency-percentiles    report latency percentiles\n"
 		   "  --log-prefix=PREFIX      prefix for transaction time log file\n"
 		   "                           (default: \"pgbench_log\")\n"
 		   "  --max-tries=NUM          max number of tries to run transaction (default: 1)\n"
@@ -1387,6 +1420,80 @@ initSimpleStats(SimpleStats *ss)
 	memset(ss, 0, sizeof(SimpleStats));
 }
 
+/*
+ * Return the histogram bucket of a value in microseconds.
+ */
+static int
+histBucket(double val)
+{
+	uint64		v = (val > 0) ? (uint64) val : 0;
+	int			shift;
+
+	if (v < (UINT64CONST(1) << HIST_SUB_BITS))
+		return (int) v;
+
+	shift = pg_leftmost_one_pos64(v) - HIST_SUB_BITS + 1;
+	if (shift > HIST_MAX_BITS - HIST_SUB_BITS)
+		return HIST_BUCKETS - 1;
+
+	/* v >> shift is between 2^(HIST_SUB_BITS - 1) and 2^HIST_SUB_BITS */
+	return ((shift + 1) << (HIST_SUB_BITS - 1)) +
+		(int) (v >> shift) - (1 << (HIST_SUB_BITS - 1));
+}
+
+/*
+ * Return the value in the middle of a histogram bucket.
+ */
+static double
+histBucketValue(int bucket)
+{
+	int			shift;
+	int			m;
+
+	if (bucket < (1 << HIST_SUB_BITS))
+		return bucket;
+
+	shift = (bucket >> (HIST_SUB_BITS - 1)) - 1;
+	m = (bucket & ((1 << (HIST_SUB_BITS - 1)) - 1)) + (1 << (HIST_SUB_BITS - 1));
+
+	return ldexp(m + 0.5, shift);
+}
+
+/*
+ * Return the given percentile of the values accumulated in a SimpleStats
+ * struct, or of those accumulated since "base" was taken, if not NULL.
+ */
+static double
+histPercentile(SimpleStats *ss, SimpleStats *base, double percentile)
+{
+	int64		total = 0;
+	int64		target;
+	int64		seen = 0;
+	double		result = 0.0;
+
+	for (int i = 0; i < HIST_BUCKETS; i++)
+		total += ss->hist[i] - (base ? base->hist[i] : 0);
+	if (total <= 0)
+		return 0.0;
+
+	target = Max((int64) ceil(total * percentile / 100.0), 1);
+	for (int i = 0; i < HIST_BUCKETS; i++)
+	{
+		seen += ss->hist[i] - (base ? base->hist[i] : 0);
+		if (seen >= target)
+		{
+			result = histBucketValue(i);
+			break;
+		}
+	}
+
+	/* the extremes are known exactly */
+	if (base == NULL)
+		result = Max(Min(result, ss->max), ss->min);
+
+	return result;
+}
+
 /*
  * Accumulate one value into a SimpleStats struct.
  */
@@ -1400,6 +1507,8 @@ addToSimpleStats(SimpleStats *ss, double val)
 	ss->count++;
 	ss->sum += val;
 	ss->sum2 += val * val;
+	if (latency_percentiles)
+		ss->hist[histBucket(val)]++;
 }
 
 /*
@@ -1415,6 +1524,11 @@ mergeSimpleStats(SimpleStats *acc, SimpleStats *ss)
 	acc->count += ss->count;
 	acc->sum += ss->sum;
 	acc->sum2 += ss->sum2;
+	if (latency_percentiles)
+	{
+		for (int i = 0; i < HIST_BUCKETS; i++)
+			acc->hist[i] += ss->hist[i];
+	}
 }
 
 /*
@@ -4101,8 +4215,7 @@ advanceConnectionState(TState *thread, CState *st, StatsData *agg)
 
 					command = sql_script[st->use_file].commands[st->command];
 					/* XXX could use a mutex here, but we choose not to */
-					addToSimpleStats(&command->stats,
-									 PG_TIME_GET_DOUBLE(now - st->stmt_begin));
+					addToSimpleStats(&command->stats, now - st->stmt_begin);
 				}
 
 				/* Go ahead with next command, to be executed or skipped */
@@ -4757,7 +4870,7 @@ processXactStats(TState *thread, CState *st, pg_time_usec_t *now,
 	double		latency = 0.0,
 				lag = 0.0;
 	bool		detailed = progress || throttle_delay || latency_limit ||
-		use_log || per_script_stats;
+		use_log || per_script_stats || latency_percentiles;
 
 	if (detailed && !skipped && st->estatus == ESTATUS_NO_ERROR)
 	{
@@ -5024,13 +5137,42 @@ initAccount(PQExpBufferData *sql, int64 curr)
 					  curr + 1, curr / naccounts + 1);
 }
 
+/*
+ * Print a progress message about data generation
+ *
+ * *prev_chars is the length of the previous message, which is overwritten if
+ * reporting to a terminal; it is updated to the length of this one.
+ */
+static void
+initReportProgress(const char *table, int64 j, int64 total,
+				   pg_time_usec_t start, int *prev_chars, char eol)
+{
+	double		elapsed_sec = PG_TIME_GET_DOUBLE(pg_time_now() - start);
+	double		remaining_sec = ((double) total - j) * elapsed_sec / j;
+	int			chars;
+
+	chars = fprintf(stderr, INT64_FORMAT " of " INT64_FORMAT " tuples (%d%%) of %s done (elapsed %.2f s, remaining %.2f s)",
+					j, total,
+					(int) ((j * 100) / total),
+					table, elapsed_sec, remaining_sec);
+
+	/*
+	 * If the previous progress message is longer than the current one, add
+	 * spaces to the current line to fully overwrite any remaining characters
+	 * from the previous message.
+	 */
+	if (*prev_chars > chars)
+		fprintf(stderr, "%*c", *prev_chars - chars, ' ');
+	fputc(eol, stderr);
+	*prev_chars = chars;
+}
+
 static void
 initPopulateTable(PGconn *con, const char *table, int64 base,
 				  initRowMethod init_row)
 {
 	int			n;
 	int64		k;
-	int			chars = 0;
 	int			prev_chars = 0;
 	PGresult   *res;
 	PQExpBufferData sql;
@@ -5083,48 +5225,16 @@ initPopulateTable(PGconn *con, const char *table, int64 base,
 		 * 100k inserted rows.
 		 */
 		if ((!use_quiet) && (j % 100000 == 0))
-		{
-			double		elapsed_sec = PG_TIME_GET_DOUBLE(pg_time_now() - start);
-			double		remaining_sec = ((double) total - j) * elapsed_sec / j;
-
-			chars = fprintf(stderr, INT64_FORMAT " of " INT64_FORMAT " tuples (%d%%) of %s done (elapsed %.2f s, remaining %.2f s)",
-							j, total,
-							(int) ((j * 100) / total),
-							table, elapsed_sec, remaining_sec);
-
-			/*
-			 * If the previous progress message is longer than the current
-			 * one, add spaces to the current line to fully overwrite any
-			 * remaining characters from the previous message.
-			 */
-			if (prev_chars > chars)
-				fprintf(stderr, "%*c", prev_chars - chars, ' ');
-			fputc(eol, stderr);
-			prev_chars = chars;
-		}
+			initReportProgress(table, j, total, start, &prev_chars, eol);
 		/* let's not call the timing for each row, but only each 100 rows */
 		else if (use_quiet && (j % 100 == 0))
 		{
 			double		elapsed_sec = PG_TIME_GET_DOUBLE(pg_time_now() - start);
-			double		remaining_sec = ((double) total - j) * elapsed_sec / j;
 
 			/* have we reached the next interval (or end)? */
 			if ((j == total) || (elapsed_sec >= log_interval * LOG_STEP_SECONDS))
 			{
-				chars = fprintf(stderr, INT64_FORMAT " of " INT64_FORMAT " tuples (%d%%) of %s done (elapsed %.2f s, remaining %.2f s)",
-								j, total,
-								(int) ((j * 100) / total),
-								table, elapsed_sec, remaining_sec);
-
-				/*
-				 * If the previous progress message is longer than the current
-				 * one, add spaces to the current line to fully overwrite any
-				 * remaining characters from the previous message.
-				 */
-				if (prev_chars > chars)
-					fprintf(stderr, "%*c", prev_chars - chars, ' ');
-				fputc(eol, stderr);
-				prev_chars = chars;
+				initReportProgress(table, j, total, start, &prev_chars, eol);
 
 				/* skip to the next interval */
 				log_interval = (int) ceil(elapsed_sec / LOG_STEP_SECONDS);
@@ -5132,8 +5242,8 @@ initPopulateTable(PGconn *con, const char *table, int64 base,
 		}
 	}
 
-	if (chars != 0 && eol != '\n')
-		fprintf(stderr, "%*c\r", chars, ' ');	/* Clear the current line */
+	if (prev_chars != 0 && eol != '\n')
+		fprintf(stderr, "%*c\r", prev_chars, ' ');	/* Clear the current line */
 
 	if (PQputline(con, "\\.\n"))
 		pg_fatal("very last PQputline failed");
@@ -5143,6 +5253,170 @@ initPopulateTable(PGconn *con, const char *table, int64 base,
 	termPQExpBuffer(&sql);
 }
 
+/*
+ * Thread body loading a range of pgbench_accounts, see
+ * initPopulateAccountsParallel()
+ */
+static THREAD_FUNC_RETURN_TYPE THREAD_FUNC_CC
+initAccountsWorker(void *arg)
+{
+	InitAccountsWorker *worker = (InitAccountsWorker *) arg;
+	PGconn	   *con = worker->con;
+	PQExpBufferData sql;
+
+	initPQExpBuffer(&sql);
+
+	if (worker->server_side)
+	{
+		printfPQExpBuffer(&sql,
+						  "insert into pgbench_accounts(aid,bid,abalance,filler) "
+						  "select aid, (aid - 1) / %d + 1, 0, '' "
+						  "from generate_series(" INT64_FORMAT ", " INT64_FORMAT ") as aid",
+						  naccounts, worker->start + 1, worker->end);
+		executeStatement(con, sql.data);
+	}
+	else
+	{
+		PGresult   *res;
+		int64		k;
+
+		/*
+		 * No FREEZE here: the table was truncated by another transaction, so
+		 * the server would reject it.
+		 */
+		res = PQexec(con, "copy pgbench_accounts from stdin");
+		if (PQresultStatus(res) != PGRES_COPY_IN)
+			pg_fatal("unexpected copy in result: %s", PQerrorMessage(con));
+		PQclear(res);
+
+		for (k = worker->start; k < worker->end; k++)
+		{
+			initAccount(&sql, k);
+			if (PQputline(con, sql.data))
+				pg_fatal("PQputline failed");
+			worker->done++;
+
+			if (CancelRequested)
+				break;
+		}
+
+		if (PQputline(con, "\\.\n"))
+			pg_fatal("very last PQputline failed");
+		if (PQendcopy(con))
+			pg_fatal("PQendcopy failed");
+	}
+
+	termPQExpBuffer(&sql);
+	worker->finished = true;
+
+	THREAD_FUNC_RETURN;
+}
+
+/*
+ * Fill pgbench_accounts using one thread and connection per job, each
+ * generating a contiguous range of accounts.  With a range-partitioned
+ * table, the threads therefore mostly load different partitions.
+ *
+ * The caller must have committed the truncation of the table, as the rows
+ * are inserted in separate transactions.
+ */
+static void
+initPopulateAccountsParallel(bool server_side)
+{
+	int64		total = (int64) naccounts * scale;
+	int			njobs = nthreads;
+	InitAccountsWorker *workers;
+	int			i;
+
+	/* no point in having threads with nothing to do */
+	if (njobs > total)
+		njobs = (int) total;
+
+	workers = pg_malloc0_array(InitAccountsWorker, njobs);
+
+	for (i = 0; i < njobs; i++)
+	{
+		InitAccountsWorker *worker = &workers[i];
+
+		if ((worker->con = doConnect()) == NULL)
+			pg_fatal("could not create connection for initialization");
+		worker->server_side = server_side;
+		worker->start = total * i / njobs;
+		worker->end = total * (i + 1) / njobs;
+	}
+
+	for (i = 0; i < njobs; i++)
+	{
+		errno = THREAD_CREATE(&workers[i].thread, initAccountsWorker,
+							  &workers[i]);
+		if (errno != 0)
+			pg_fatal("could not create thread: %m");
+	}
+
+	/*
+	 * Report the progress of client-side generation as a whole, with the
+	 * same frequency as initPopulateTable().
+	 *
+	 * XXX: No locking.  The counters may be read while being updated, which
+	 * is fine for a progress report.
+	 */
+	if (!server_side)
+	{
+		pg_time_usec_t start = pg_time_now();
+		int			log_interval = 1;
+		int64		reported = 0;
+		int			prev_chars = 0;
+		char		eol = isatty(fileno(stderr)) ? '\r' : '\n';
+
+		for (;;)
+		{
+			int64		done = 0;
+			bool		finished = true;
+
+			pg_usleep(100000);
+
+			for (i = 0; i < njobs; i++)
+			{
+				done += workers[i].done;
+				if (!workers[i].finished)
+					finished = false;
+			}
+
+			if (finished || CancelRequested)
+				break;
+			if (done == 0)
+				continue;
+
+			if (!use_quiet && done / 100000 > reported / 100000)
+			{
+				initReportProgress("pgbench_accounts", done, total, start,
+								   &prev_chars, eol);
+				reported = done;
+			}
+			else if (use_quiet &&
+					 PG_TIME_GET_DOUBLE(pg_time_now() - start) >=
+					 log_interval * LOG_STEP_SECONDS)
+			{
+				initReportProgress("pgbench_accounts", done, total, start,
+								   &prev_chars, eol);
+				log_interval = (int) ceil(PG_TIME_GET_DOUBLE(pg_time_now() - start) /
+										  LOG_STEP_SECONDS);
+			}
+		}
+
+		if (prev_chars != 0 && eol != '\n')
+			fprintf(stderr, "%*c\r", prev_chars, ' ');	/* Clear the current line */
+	}
+
+	for (i = 0; i < njobs; i++)
+	{
+		THREAD_JOIN(workers[i].thread);
+		PQfinish(workers[i].con);
+	}
+
+	pg_free(workers);
+}
+
 /*
  * Fill the standard tables with some data generated and sent from the client.
  *
@@ -5169,9 +5443,21 @@ initGenerateDataClientSide(PGconn *con)
 	 */
 	initPopulateTable(con, "pgbench_branches", nbranches, initBranch);
 	initPopulateTable(con, "pgbench_tellers", ntellers, initTeller);
-	initPopulateTable(con, "pgbench_accounts", naccounts, initAccount);
 
-	executeStatement(con, "commit");
+	if (nthreads > 1)
+	{
+		/*
+		 * pgbench_accounts is loaded over several connections, which must see
+		 * the truncation and the branches committed first.
+		 */
+		executeStatement(con, "commit");
+		initPopulateAccountsParallel(false);
+	}
+	else
+	{
+		initPopulateTable(con, "pgbench_accounts", naccounts, initAccount);
+		executeStatement(con, "commit");
+	}
 }
 
 /*
@@ -5211,16 +5497,24 @@ initGenerateDataServerSide(PGconn *con)
 					  "from generate_series(1, %d) as tid", ntellers, ntellers * scale);
 	executeStatement(con, sql.data);
 
-	printfPQExpBuffer(&sql,
-					  "insert into pgbench_accounts(aid,bid,abalance,filler) "
-					  "select aid, (aid - 1) / %d + 1, 0, '' "
-					  "from generate_series(1, " INT64_FORMAT ") as aid",
-					  naccounts, (int64) naccounts * scale);
-	executeStatement(con, sql.data);
+	if (nthreads > 1)
+	{
+		/* as in initGenerateDataClientSide() */
+		executeStatement(con, "commit");
+		initPopulateAccountsParallel(true);
+	}
+	else
+	{
+		printfPQExpBuffer(&sql,
+						  "insert into pgbench_accounts(aid,bid,abalance,filler) "
+						  "select aid, (aid - 1) / %d + 1, 0, '' "
+						  "from generate_series(1, " INT64_FORMAT ") as aid",
+						  naccounts, (int64) naccounts * scale);
+		executeStatement(con, sql.data);
+		executeStatement(con, "commit");
+	}
 
 	termPQExpBuffer(&sql);
-
-	executeStatement(con, "commit");
 }
 
 /*
@@ -5340,6 +5634,20 @@ runInitSteps(const char *initialize_steps)
 	setup_cancel_handler(NULL);
 	SetCancelConn(con);
 
+	/*
+	 * With several jobs, also let the server use as many processes to build
+	 * indexes, vacuum them and validate foreign keys.  The leader process
+	 * participates, hence one less worker than jobs.
+	 */
+	if (nthreads > 1 && PQserverVersion(con) >= 110000)
+	{
+		char		sql[64];
+
+		snprintf(sql, sizeof(sql), "set max_parallel_maintenance_workers = %d",
+				 nthreads - 1);
+		executeStatement(con, sql);
+	}
+
 	for (step = initialize_steps; *step != '\0'; step++)
 	{
 		char	   *op = NULL;
@@ -6398,6 +6706,13 @@ printProgressReport(TState *threads, int64 test_start, pg_time_usec_t now,
 		fprintf(stderr,
 				", " INT64_FORMAT " retried, " INT64_FORMAT " retries",
 				retried, cur.retries - last->retries);
+
+	if (latency_percentiles && cnt > 0)
+		fprintf(stderr, ", lat p50 %.3f p90 %.3f p99 %.3f p99.9 %.3f ms",
+				0.001 * histPercentile(&cur.latency, &last->latency, 50),
+				0.001 * histPercentile(&cur.latency, &last->latency, 90),
+				0.001 * histPercentile(&cur.latency, &last->latency, 99),
+				0.001 * histPercentile(&cur.latency, &last->latency, 99.9));
 	fprintf(stderr, "\n");
 
 	*last = cur;
@@ -6414,6 +6729,19 @@ printSimpleStats(const char *prefix, SimpleStats *ss)
 
 		printf("%s average = %.3f ms\n", prefix, 0.001 * latency);
 		printf("%s stddev = %.3f ms\n", prefix, 0.001 * stddev);
+
+		if (latency_percentiles)
+		{
+			printf("%s p50 = %.3f ms\n", prefix,
+				   0.001 * histPercentile(ss, NULL, 50));
+			printf("%s p90 = %.3f ms\n", prefix,
+				   0.001 * histPercentile(ss, NULL, 90));
+			printf("%s p99 = %.3f ms\n", prefix,
+				   0.001 * histPercentile(ss, NULL, 99));
+			printf("%s p99.9 = %.3f ms\n", prefix,
+				   0.001 * histPercentile(ss, NULL, 99.9));
+			printf("%s max = %.3f ms\n", prefix, 0.001 * ss->max);
+		}
 	}
 }
 
@@ -6531,7 +6859,7 @@ printResults(StatsData *total,
 			   latency_limit / 1000.0, latency_late, total->cnt,
 			   (total->cnt > 0) ? 100.0 * latency_late / total->cnt : 0.0);
 
-	if (throttle_delay || progress || latency_limit)
+	if (throttle_delay || progress || latency_limit || latency_percentiles)
 		printSimpleStats("latency", &total->latency);
 	else
 	{
@@ -6651,8 +6979,10 @@ printResults(StatsData *total,
 			{
 				Command   **commands;
 
-				printf("%sstatement latencies in milliseconds%s:\n",
+				printf("%sstatement latencies in milliseconds%s%s:\n",
 					   per_script_stats ? " - " : "",
+					   (latency_percentiles ?
+						" (average, p50, p90, p99, p99.9, max)" : ""),
 					   (max_tries == 1 ?
 						" and failures" :
 						", failures and retries"));
@@ -6663,16 +6993,22 @@ printResults(StatsData *total,
 				{
 					SimpleStats *cstats = &(*commands)->stats;
 
+					printf("   %11.3f",
+						   (cstats->count > 0) ?
+						   0.001 * cstats->sum / cstats->count : 0.0);
+					if (latency_percentiles)
+						printf(" %11.3f %11.3f %11.3f %11.3f %11.3f",
+							   0.001 * histPercentile(cstats, NULL, 50),
+							   0.001 * histPercentile(cstats, NULL, 90),
+							   0.001 * histPercentile(cstats, NULL, 99),
+							   0.001 * histPercentile(cstats, NULL, 99.9),
+							   0.001 * cstats->max);
 					if (max_tries == 1)
-						printf("   %11.3f  %10" PRId64 " %s\n",
-							   (cstats->count > 0) ?
-							   1000.0 * cstats->sum / cstats->count : 0.0,
+						printf("  %10" PRId64 " %s\n",
 							   (*commands)->failures,
 							   (*commands)->first_line);
 					else
-						printf("   %11.3f  %10" PRId64 " %10" PRId64 " %s\n",
-							   (cstats->count > 0) ?
-							   1000.0 * cstats->sum / cstats->count : 0.0,
+						printf("  %10" PRId64 " %10" PRId64 " %s\n",
 							   (*commands)->failures,
 							   (*commands)->retries,
 							   (*commands)->first_line);
@@ -6779,6 +7115,7 @@ main(int argc, char **argv)
 		{"exit-on-abort", no_argument, NULL, 16},
 		{"debug", no_argument, NULL, 17},
 		{"continue-on-error", no_argument, NULL, 18},
+		{"latency-percentiles", no_argument, NULL, 19},
 		{NULL, 0, NULL, 0}
 	};
 
@@ -6944,7 +7281,6 @@ main(int argc, char **argv)
 				initialization_option_set = true;
 				break;
 			case 'j':			/* jobs */
-				benchmarking_option_set = true;
 				if (!option_parse_int(optarg, "-j/--jobs", 1, INT_MAX,
 									  &nthreads))
 				{
@@ -7136,6 +7472,10 @@ main(int argc, char **argv)
 				benchmarking_option_set = true;
 				continue_on_error = true;
 				break;
+			case 19:			/* latency-percentiles */
+				benchmarking_option_set = true;
+				latency_percentiles = true;
+				break;
 			default:
 				/* getopt_long already emitted a complaint */
 				pg_log_error_hint("Try \"%s --help\" for more information.", progname);
@@ -7174,9 +7514,10 @@ main(int argc, char **argv)
 	/*
 	 * Don't need more threads than there are clients.  (This is not merely an
 	 * optimization; throttle_delay is calculated incorrectly below if some
-	 * threads have no clients assigned to them.)
+	 * threads have no clients assigned to them.)  In initialization mode,
+	 * the threads load data instead.
 	 */
-	if (nthreads > nclients)
+	if (!is_init_mode && nthreads > nclients)
 		nthreads = nclients;
 
 	/*
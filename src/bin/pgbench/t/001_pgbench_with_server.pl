@@ -164,6 +164,35 @@ $node->pgbench(
 # Check data state, after server-side data generation.
 check_data_state($node, 'server-side');
 
+# Generate data with several jobs, client-side then server-side
+$node->pgbench(
+	'--initialize --jobs=3 --partitions=2 --foreign-keys',
+	0,
+	[qr{^$}],
+	[
+		qr{creating 2 partitions},
+		qr{generating data \(client-side\)},
+		qr{creating primary keys},
+		qr{creating foreign keys},
+		qr{done in \d+\.\d\d s }
+	],
+	'pgbench parallel client-side initialization');
+
+check_data_state($node, 'parallel client-side');
+
+$node->pgbench(
+	'--initialize --init-steps=dtGvpf --jobs=3 --unlogged-tables --partitions=3',
+	0,
+	[qr{^$}],
+	[
+		qr{generating data \(server-side\)},
+		qr{creating primary keys},
+		qr{done in \d+\.\d\d s }
+	],
+	'pgbench parallel server-side initialization');
+
+check_data_state($node, 'parallel server-side');
+
 # Run all builtin scripts, for a few transactions each
 $node->pgbench(
 	'--transactions=5 -Dfoo=bla --client=2 --protocol=simple --builtin=t'
@@ -208,6 +237,21 @@ $node->pgbench(
 	],
 	'pgbench select only');
 
+$node->pgbench(
+	'-t 100 -c 2 -b se -n -r --latency-percentiles',
+	0,
+	[
+		qr{processed: 200/200},
+		qr{latency average = \d+\.\d+ ms},
+		qr{latency p50 = \d+\.\d+ ms},
+		qr{latency p99\.9 = \d+\.\d+ ms},
+		qr{latency max = \d+\.\d+ ms},
+		qr{statement latencies in milliseconds \(average, p50, p90, p99, p99\.9, max\) and failures:},
+		qr{(\s+\d+\.\d+){6}\s+0\s+SELECT abalance}
+	],
+	[qr{^$}],
+	'pgbench latency percentiles');
+
 # check if threads are supported
 my $nthreads = 2;
 
@@ -0,0 +1,565 @@
+/*-------------------------------------------------------------------------
+ *
+ * compress_stream.c
+ *	  Streaming compression and decompression with the algorithms of
+ *	  common/compression.h.
+ *
+ * A compressing stream turns each chunk of input into output that is
+ * flushed, so that the receiving side can decompress everything sent so far
+ * without waiting for more.  This is what a network protocol needs; it costs
+ * some compression ratio with small chunks.
+ *
+ * This is used by both the backend and libpq, so it must not exit or throw
+ * errors in frontend code: failures are reported with a return value of -1,
+ * and pg_compress_stream_error() describes them.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		  src/common/compress_stream.c
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef FRONTEND
+#include "postgres.h"
+#else
+#include "postgres_fe.h"
+#endif
+
+#ifdef USE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
+#include "common/compress_stream.h"
+
+/*
+ * In backend, use palloc/pfree to ease the error handling.  In frontend,
+ * use malloc to be able to return a failure status back to the caller.
+ */
+#ifndef FRONTEND
+#define ALLOC(size) palloc(size)
+#define REALLOC(ptr, size) repalloc(ptr, size)
+#define FREE(ptr) pfree(ptr)
+#else
+#define ALLOC(size) malloc(size)
+#define REALLOC(ptr, size) realloc(ptr, size)
+#define FREE(ptr) free(ptr)
+#endif
+
+struct pg_compress_stream
+{
+	pg_compress_algorithm algorithm;
+	bool		decompress;
+	const char *error;
+
+	/* compressed output, when compressing */
+	char	   *buf;
+	size_t		bufsize;
+
+	union
+	{
+#ifdef HAVE_LIBZ
+		z_stream	gzip;
+#endif
+#ifdef USE_LZ4
+		struct
+		{
+			LZ4F_cctx  *cctx;
+			LZ4F_dctx  *dctx;
+			LZ4F_preferences_t prefs;
+			bool		started;
+		}			lz4;
+#endif
+#ifdef USE_ZSTD
+		struct
+		{
+			ZSTD_CCtx  *cctx;
+			ZSTD_DCtx  *dctx;
+		}			zstd;
+#endif
+		int			dummy;
+	}			u;
+};
+
+#if defined(HAVE_LIBZ) || defined(USE_LZ4) || defined(USE_ZSTD)
+static bool enlarge_buffer(pg_compress_stream *cs, size_t needed);
+#endif
+
+/*
+ * Does this build support streaming with the given algorithm?
+ */
+bool
+pg_compress_stream_supported(pg_compress_algorithm algorithm)
+{
+	switch (algorithm)
+	{
+		case PG_COMPRESSION_NONE:
+			return false;
+		case PG_COMPRESSION_GZIP:
+#ifdef HAVE_LIBZ
+			return true;
+#else
+			return false;
+#endif
+		case PG_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			return true;
+#else
+			return false;
+#endif
+		case PG_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			return true;
+#else
+			return false;
+#endif
+	}
+	return false;
+}
+
+/*
+ * The level to use when none was specified, as parse_compress_specification()
+ * would assign it.
+ */
+int
+pg_compress_stream_default_level(pg_compress_algorithm algorithm)
+{
+	switch (algorithm)
+	{
+		case PG_COMPRESSION_GZIP:
+#ifdef HAVE_LIBZ
+			return Z_DEFAULT_COMPRESSION;
+#else
+			break;
+#endif
+		case PG_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			return ZSTD_CLEVEL_DEFAULT;
+#else
+			break;
+#endif
+		case PG_COMPRESSION_LZ4:
+		case PG_COMPRESSION_NONE:
+			break;
+	}
+	return 0;
+}
+
+/*
+ * pg_compress_stream_create
+ *
+ * Set up a stream that compresses with the given algorithm and level, or
+ * that decompresses.  Returns NULL on failure, which can only be out of
+ * memory, or an algorithm that this build doesn't support.  The backend
+ * issues an error, without returning, if out of memory.
+ */
+pg_compress_stream *
+pg_compress_stream_create(pg_compress_algorithm algorithm, int level,
+						  bool decompress)
+{
+	pg_compress_stream *cs;
+
+	if (!pg_compress_stream_supported(algorithm))
+		return NULL;
+
+	cs = ALLOC(sizeof(pg_compress_stream));
+	if (cs == NULL)
+		return NULL;
+	memset(cs, 0, sizeof(pg_compress_stream));
+	cs->algorithm = algorithm;
+	cs->decompress = decompress;
+
+	switch (algorithm)
+	{
+		case PG_COMPRESSION_GZIP:
+#ifdef HAVE_LIBZ
+			{
+				int			rc;
+
+				if (decompress)
+					rc = inflateInit(&cs->u.gzip);
+				else
+					rc = deflateInit(&cs->u.gzip, level);
+				if (rc != Z_OK)
+				{
+					FREE(cs);
+					return NULL;
+				}
+			}
+#endif
+			break;
+		case PG_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			{
+				LZ4F_errorCode_t rc;
+
+				if (decompress)
+					rc = LZ4F_createDecompressionContext(&cs->u.lz4.dctx,
+														 LZ4F_VERSION);
+				else
+				{
+					rc = LZ4F_createCompressionContext(&cs->u.lz4.cctx,
+													   LZ4F_VERSION);
+					cs->u.lz4.prefs.compressionLevel = level;
+					cs->u.lz4.prefs.autoFlush = 1;
+				}
+				if (LZ4F_isError(rc))
+				{
+					FREE(cs);
+					return NULL;
+				}
+			}
+#endif
+			break;
+		case PG_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			if (decompress)
+			{
+				cs->u.zstd.dctx = ZSTD_createDCtx();
+				if (cs->u.zstd.dctx == NULL)
+				{
+					FREE(cs);
+					return NULL;
+				}
+			}
+			else
+			{
+				cs->u.zstd.cctx = ZSTD_createCCtx();
+				if (cs->u.zstd.cctx == NULL)
+				{
+					FREE(cs);
+					return NULL;
+				}
+				if (ZSTD_isError(ZSTD_CCtx_setParameter(cs->u.zstd.cctx,
+														ZSTD_c_compressionLevel,
+														level)))
+				{
+					ZSTD_freeCCtx(cs->u.zstd.cctx);
+					FREE(cs);
+					return NULL;
+				}
+			}
+#endif
+			break;
+		case PG_COMPRESSION_NONE:
+			break;
+	}
+
+	return cs;
+}
+
+/*
+ * pg_compress_stream_compress
+ *
+ * Compress up to *srclen bytes at src, at most PG_COMPRESS_STREAM_CHUNK of
+ * them, and flush.  On return, *srclen is the number of bytes consumed, and
+ * *dst and *dstlen point to the compressed data, which stays valid until the
+ * next call.  Returns 0 on success, or -1 on failure.
+ */
+int
+pg_compress_stream_compress(pg_compress_stream *cs,
+							const void *src, size_t *srclen,
+							const char **dst, size_t *dstlen)
+{
+	size_t		len = Min(*srclen, PG_COMPRESS_STREAM_CHUNK);
+	size_t		outlen = 0;
+
+	Assert(!cs->decompress);
+
+	switch (cs->algorithm)
+	{
+		case PG_COMPRESSION_GZIP:
+#ifdef HAVE_LIBZ
+			{
+				z_stream   *zs = &cs->u.gzip;
+
+				if (!enlarge_buffer(cs, deflateBound(zs, len) + 16))
+					return -1;
+
+				zs->next_in = (Bytef *) src;
+				zs->avail_in = len;
+				zs->next_out = (Bytef *) cs->buf;
+				zs->avail_out = cs->bufsize;
+				for (;;)
+				{
+					int			rc;
+
+					rc = deflate(zs, Z_SYNC_FLUSH);
+					if (rc != Z_OK && rc != Z_BUF_ERROR)
+					{
+						cs->error = zs->msg ? zs->msg : "deflate failed";
+						return -1;
+					}
+					/* done when there was room left over */
+					if (zs->avail_out > 0)
+						break;
+					outlen = cs->bufsize;
+					if (!enlarge_buffer(cs, cs->bufsize * 2))
+						return -1;
+					zs->next_out = (Bytef *) cs->buf + outlen;
+					zs->avail_out = cs->bufsize - outlen;
+				}
+				outlen = cs->bufsize - zs->avail_out;
+			}
+#endif
+			break;
+		case PG_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			{
+				size_t		rc;
+
+				if (!enlarge_buffer(cs, LZ4F_HEADER_SIZE_MAX +
+									LZ4F_compressBound(len, &cs->u.lz4.prefs) +
+									LZ4F_compressBound(0, &cs->u.lz4.prefs)))
+					return -1;
+
+				if (!cs->u.lz4.started)
+				{
+					rc = LZ4F_compressBegin(cs->u.lz4.cctx, cs->buf,
+											cs->bufsize, &cs->u.lz4.prefs);
+					if (LZ4F_isError(rc))
+					{
+						cs->error = LZ4F_getErrorName(rc);
+						return -1;
+					}
+					outlen += rc;
+					cs->u.lz4.started = true;
+				}
+				rc = LZ4F_compressUpdate(cs->u.lz4.cctx, cs->buf + outlen,
+										 cs->bufsize - outlen, src, len, NULL);
+				if (LZ4F_isError(rc))
+				{
+					cs->error = LZ4F_getErrorName(rc);
+					return -1;
+				}
+				outlen += rc;
+				rc = LZ4F_flush(cs->u.lz4.cctx, cs->buf + outlen,
+								cs->bufsize - outlen, NULL);
+				if (LZ4F_isError(rc))
+				{
+					cs->error = LZ4F_getErrorName(rc);
+					return -1;
+				}
+				outlen += rc;
+			}
+#endif
+			break;
+		case PG_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				ZSTD_inBuffer in = {src, len, 0};
+				ZSTD_outBuffer out;
+
+				if (!enlarge_buffer(cs, ZSTD_compressBound(len)))
+					return -1;
+
+				out.dst = cs->buf;
+				out.size = cs->bufsize;
+				out.pos = 0;
+				for (;;)
+				{
+					size_t		rc;
+
+					rc = ZSTD_compressStream2(cs->u.zstd.cctx, &out, &in,
+											  ZSTD_e_flush);
+					if (ZSTD_isError(rc))
+					{
+						cs->error = ZSTD_getErrorName(rc);
+						return -1;
+					}
+					if (rc == 0)
+						break;
+					if (!enlarge_buffer(cs, cs->bufsize * 2))
+						return -1;
+					out.dst = cs->buf;
+					out.size = cs->bufsize;
+				}
+				outlen = out.pos;
+			}
+#endif
+			break;
+		case PG_COMPRESSION_NONE:
+			break;
+	}
+
+	*srclen = len;
+	*dst = cs->buf;
+	*dstlen = outlen;
+	return 0;
+}
+
+/*
+ * pg_compress_stream_decompress
+ *
+ * Decompress the *srclen bytes at src into the *dstlen bytes of space at dst.
+ * On return, *srclen is the number of input bytes consumed, and *dstlen the
+ * number of bytes produced.  Input may be left over when the output space
+ * ran out, and output may be produced without any input, from what the
+ * decompressor held back before.  Returns 0 on success, or -1 if the input
+ * is corrupt.
+ */
+int
+pg_compress_stream_decompress(pg_compress_stream *cs,
+							  const void *src, size_t *srclen,
+							  void *dst, size_t *dstlen)
+{
+	Assert(cs->decompress);
+
+	switch (cs->algorithm)
+	{
+		case PG_COMPRESSION_GZIP:
+#ifdef HAVE_LIBZ
+			{
+				z_stream   *zs = &cs->u.gzip;
+				int			rc;
+
+				zs->next_in = (Bytef *) src;
+				zs->avail_in = *srclen;
+				zs->next_out = dst;
+				zs->avail_out = *dstlen;
+
+				rc = inflate(zs, Z_SYNC_FLUSH);
+				if (rc != Z_OK && rc != Z_BUF_ERROR && rc != Z_STREAM_END)
+				{
+					cs->error = zs->msg ? zs->msg : "inflate failed";
+					return -1;
+				}
+				*srclen -= zs->avail_in;
+				*dstlen -= zs->avail_out;
+			}
+#endif
+			break;
+		case PG_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			{
+				size_t		rc;
+
+				rc = LZ4F_decompress(cs->u.lz4.dctx, dst, dstlen, src, srclen,
+									 NULL);
+				if (LZ4F_isError(rc))
+				{
+					cs->error = LZ4F_getErrorName(rc);
+					return -1;
+				}
+			}
+#endif
+			break;
+		case PG_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				ZSTD_inBuffer in = {src, *srclen, 0};
+				ZSTD_outBuffer out = {dst, *dstlen, 0};
+				size_t		rc;
+
+				rc = ZSTD_decompressStream(cs->u.zstd.dctx, &out, &in);
+				if (ZSTD_isError(rc))
+				{
+					cs->error = ZSTD_getErrorName(rc);
+					return -1;
+				}
+				*srclen = in.pos;
+				*dstlen = out.pos;
+			}
+#endif
+			break;
+		case PG_COMPRESSION_NONE:
+			break;
+	}
+
+	return 0;
+}
+
+/*
+ * pg_compress_stream_error
+ *
+ * Returns a string providing details about the last error that occurred.
+ */
+const char *
+pg_compress_stream_error(pg_compress_stream *cs)
+{
+	if (cs->error)
+		return cs->error;
+	return "success";
+}
+
+/*
+ * pg_compress_stream_free
+ *
+ * Free a stream.  If NULL, this does nothing.
+ */
+void
+pg_compress_stream_free(pg_compress_stream *cs)
+{
+	if (cs == NULL)
+		return;
+
+	switch (cs->algorithm)
+	{
+		case PG_COMPRESSION_GZIP:
+#ifdef HAVE_LIBZ
+			if (cs->decompress)
+				inflateEnd(&cs->u.gzip);
+			else
+				deflateEnd(&cs->u.gzip);
+#endif
+			break;
+		case PG_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			if (cs->decompress)
+				LZ4F_freeDecompressionContext(cs->u.lz4.dctx);
+			else
+				LZ4F_freeCompressionContext(cs->u.lz4.cctx);
+#endif
+			break;
+		case PG_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			if (cs->decompress)
+				ZSTD_freeDCtx(cs->u.zstd.dctx);
+			else
+				ZSTD_freeCCtx(cs->u.zstd.cctx);
+#endif
+			break;
+		case PG_COMPRESSION_NONE:
+			break;
+	}
+
+	if (cs->buf)
+		FREE(cs->buf);
+	FREE(cs);
+}
+
+#if defined(HAVE_LIBZ) || defined(USE_LZ4) || defined(USE_ZSTD)
+
+/*
+ * Make sure the output buffer holds at least 'needed' bytes, keeping its
+ * contents.
+ */
+static bool
+enlarge_buffer(pg_compress_stream *cs, size_t needed)
+{
+	char	   *newbuf;
+
+	if (cs->bufsize >= needed)
+		return true;
+
+	if (cs->buf == NULL)
+		newbuf = ALLOC(needed);
+	else
+		newbuf = REALLOC(cs->buf, needed);
+	if (newbuf == NULL)
+	{
+		cs->error = "out of memory";
+		return false;
+	}
+	cs->buf = newbuf;
+	cs->bufsize = needed;
+	return true;
+}
+
+#endif
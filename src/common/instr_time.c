@@ -0,0 +1,193 @@
+/*-------------------------------------------------------------------------
+ *
+ * instr_time.c
+ *	  Choice of the clock source for instr_time
+ *
+ * See portability/instr_time.h.  On x86-64, we use the time stamp counter
+ * when it is safe to do so: the CPU must report an invariant TSC, which runs
+ * at a constant rate regardless of frequency scaling and sleep states, and
+ * support RDTSCP.  That still doesn't guarantee that the counters of all
+ * CPUs are synchronized, particularly in virtual machines, so on Linux we
+ * additionally insist that the kernel itself uses the TSC as its clock
+ * source, which it only does after checking exactly that.
+ *
+ * The TSC frequency is taken from CPUID where the hypervisor or the CPU
+ * reports it, else measured against clock_gettime().  pg_test_timing shows
+ * the result and checks it against the system clock.
+ *
+ * Copyright (c) 2001-2025, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/common/instr_time.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "c.h"
+
+#include "portability/instr_time.h"
+
+#if defined(PG_INSTR_TSC) && defined(HAVE__GET_CPUID)
+#include <cpuid.h>
+#define PG_INSTR_TSC_CPUID 1
+#endif
+
+#ifdef PG_INSTR_TSC
+
+bool		pg_timing_use_tsc = false;
+int64		pg_tsc_frequency = 0;
+
+/* How long to measure the TSC frequency for, if CPUID doesn't tell */
+#define TSC_CALIBRATION_NS	(10 * NS_PER_MS)
+
+#ifdef PG_INSTR_TSC_CPUID
+
+/*
+ * Does the CPU have an invariant TSC and RDTSCP?
+ */
+static bool
+tsc_is_invariant(void)
+{
+	unsigned int eax,
+				ebx,
+				ecx,
+				edx;
+
+	/* RDTSCP is in CPUID.80000001H:EDX[27] */
+	if (!__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx) ||
+		(edx & (1 << 27)) == 0)
+		return false;
+
+	/* invariant TSC is in CPUID.80000007H:EDX[8] */
+	if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) ||
+		(edx & (1 << 8)) == 0)
+		return false;
+
+	return true;
+}
+
+/*
+ * Does the kernel use the TSC as its clock source?  Where we can't tell, we
+ * rely on the invariant TSC flag.
+ */
+static bool
+tsc_is_kernel_clocksource(void)
+{
+#ifdef __linux__
+	FILE	   *fp;
+	char		buf[32];
+	bool		result = false;
+
+	fp = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+	if (fp == NULL)
+		return false;
+	if (fgets(buf, sizeof(buf), fp) != NULL)
+		result = (strcmp(buf, "tsc\n") == 0 || strcmp(buf, "tsc") == 0);
+	fclose(fp);
+
+	return result;
+#else
+	return true;
+#endif
+}
+
+/*
+ * Get the TSC frequency from CPUID, or return 0 if it isn't reported.
+ */
+static int64
+tsc_frequency_from_cpuid(void)
+{
+	unsigned int eax,
+				ebx,
+				ecx,
+				edx;
+
+	/*
+	 * Under a hypervisor (CPUID.1:ECX[31]), leaf 0x40000010 reports the TSC
+	 * frequency in kHz, if the hypervisor's maximum leaf includes it.
+	 */
+	if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1U << 31)) != 0)
+	{
+		__cpuid(0x40000000, eax, ebx, ecx, edx);
+		if (eax >= 0x40000010)
+		{
+			__cpuid(0x40000010, eax, ebx, ecx, edx);
+			if (eax > 0)
+				return (int64) eax * 1000;
+		}
+	}
+
+	/*
+	 * Leaf 0x15 gives the ratio of the TSC to the core crystal clock, and
+	 * often, but not always, the crystal clock frequency.
+	 */
+	if (__get_cpuid(0x15, &eax, &ebx, &ecx, &edx) &&
+		eax > 0 && ebx > 0 && ecx > 0)
+		return (int64) ecx * ebx / eax;
+
+	return 0;
+}
+
+/*
+ * Measure the TSC frequency against the system clock.
+ */
+static int64
+tsc_frequency_from_calibration(void)
+{
+	instr_time	clock_start,
+				clock_now;
+	int64		tsc_start,
+				tsc_now;
+	int64		elapsed_ns;
+
+	clock_start = pg_clock_gettime_ns();
+	tsc_start = pg_rdtscp();
+
+	do
+	{
+		clock_now = pg_clock_gettime_ns();
+		tsc_now = pg_rdtscp();
+		elapsed_ns = clock_now.ticks - clock_start.ticks;
+	} while (elapsed_ns < TSC_CALIBRATION_NS);
+
+	return (int64) ((double) (tsc_now - tsc_start) * NS_PER_S / elapsed_ns);
+}
+
+#endif							/* PG_INSTR_TSC_CPUID */
+
+#endif							/* PG_INSTR_TSC */
+
+/*
+ * pg_initialize_timing
+ *		Decide which clock source instr_time uses in this process.
+ *
+ * This must be called before any instr_time is measured, since values from
+ * different clock sources can't be mixed.  Child processes inherit the
+ * decision.
+ */
+void
+pg_initialize_timing(void)
+{
+#ifdef PG_INSTR_TSC
+	pg_timing_use_tsc = false;
+	pg_tsc_frequency = 0;
+
+#ifdef PG_INSTR_TSC_CPUID
+	if (tsc_is_invariant() && tsc_is_kernel_clocksource())
+	{
+		int64		frequency = tsc_frequency_from_cpuid();
+
+		if (frequency == 0)
+			frequency = tsc_frequency_from_calibration();
+
+		/* pg_ticks_to_ns() relies on the frequency being below 2^33 */
+		if (frequency > 0 && frequency < (INT64CONST(1) << 33))
+		{
+			pg_tsc_frequency = frequency;
+			pg_timing_use_tsc = true;
+		}
+	}
+#endif
+#endif							/* PG_INSTR_TSC */
+}
@@ -19,7 +19,8 @@
 
 #include "common/jsonapi.h"
 #include "mb/pg_wchar.h"
-#include "port/pg_lfind.h"
+#include "port/pg_bitutils.h"
+#include "port/simd.h"
 
 #ifdef JSONAPI_USE_PQEXPBUFFER
 #include "pqexpbuffer.h"
@@ -1570,6 +1571,91 @@ parse_array(JsonLexContext *lex, const JsonSemAction *sem)
 	return JSON_SUCCESS;
 }
 
+#ifndef USE_NO_SIMD
+
+/*
+ * Skip a run of whitespace one vector at a time, counting the newlines in it,
+ * and return a pointer to the first byte that isn't whitespace.  The last
+ * partial vector's worth of input is left for the caller's scalar loop.
+ */
+static inline const char *
+json_lex_skip_whitespace(JsonLexContext *lex, const char *s, const char *end)
+{
+	const Vector8 space = vector8_broadcast(' ');
+	const Vector8 tab = vector8_broadcast('\t');
+	const Vector8 newline = vector8_broadcast('\n');
+	const Vector8 cr = vector8_broadcast('\r');
+
+	while (end - s >= (ptrdiff_t) sizeof(Vector8))
+	{
+		Vector8		chunk;
+		Vector8		isnewline;
+		uint32		notspace;
+		uint32		newlines;
+		int			nspace = sizeof(Vector8);
+
+		vector8_load(&chunk, (const uint8 *) s);
+		isnewline = vector8_eq(chunk, newline);
+		notspace = ~vector8_highbit_mask(vector8_or(vector8_or(vector8_eq(chunk, space),
+															   vector8_eq(chunk, tab)),
+													vector8_or(isnewline,
+															   vector8_eq(chunk, cr))));
+		notspace &= (UINT64CONST(1) << sizeof(Vector8)) - 1;
+		if (notspace != 0)
+			nspace = pg_rightmost_one_pos32(notspace);
+
+		/* account for the newlines before the first non-whitespace byte */
+		newlines = vector8_highbit_mask(isnewline) &
+			((UINT64CONST(1) << nspace) - 1);
+		while (newlines != 0)
+		{
+			++lex->line_number;
+			lex->line_start = s + pg_rightmost_one_pos32(newlines) + 1;
+			newlines &= newlines - 1;
+		}
+
+		s += nspace;
+		if (notspace != 0)
+			break;
+	}
+
+	return s;
+}
+
+/*
+ * Return a pointer to the first byte at or after p that json_lex_string must
+ * look at individually: a quote, a backslash or a control character.  Each
+ * vector is loaded once, and the position of the byte within it is taken
+ * from the comparison mask.  If the remaining input contains no such byte,
+ * the position of the last partial vector is returned.
+ */
+static inline const char *
+json_lex_string_skip_plain(const char *p, const char *end)
+{
+	const Vector8 quote = vector8_broadcast('"');
+	const Vector8 backslash = vector8_broadcast('\\');
+	const Vector8 maxctrl = vector8_broadcast(31);
+
+	while (end - p >= (ptrdiff_t) sizeof(Vector8))
+	{
+		Vector8		chunk;
+		uint32		mask;
+
+		vector8_load(&chunk, (const uint8 *) p);
+		mask = vector8_highbit_mask(vector8_or(vector8_or(vector8_eq(chunk, quote),
+														  vector8_eq(chunk, backslash)),
+											   vector8_eq(vector8_min(chunk, maxctrl),
+														  chunk)));
+		if (mask != 0)
+			return p + pg_rightmost_one_pos32(mask);
+		p += sizeof(Vector8);
+	}
+
+	return p;
+}
+
+#endif							/* ! USE_NO_SIMD */
+
 /*
  * Lex one token from the input stream.
  *
@@ -1800,7 +1886,17 @@ json_lex(JsonLexContext *lex)
 		/* end of partial token processing */
 	}
 
-	/* Skip leading whitespace. */
+	/*
+	 * Skip leading whitespace.  Pretty-printed input has long runs of it, so
+	 * skip those a vector at a time, but don't bother for the single spaces
+	 * that commonly separate tokens.
+	 */
+#ifndef USE_NO_SIMD
+	if (end - s > (ptrdiff_t) sizeof(Vector8) &&
+		(s[0] == ' ' || s[0] == '\t' || s[0] == '\n' || s[0] == '\r') &&
+		(s[1] == ' ' || s[1] == '\t' || s[1] == '\n' || s[1] == '\r'))
+		s = json_lex_skip_whitespace(lex, s, end);
+#endif
 	while (s < end && (*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r'))
 	{
 		if (*s++ == '\n')
@@ -2166,11 +2262,9 @@ json_lex_string(JsonLexContext *lex)
 			 * Skip to the first byte that requires special handling, so we
 			 * can batch calls to jsonapi_appendBinaryStringInfo.
 			 */
-			while (p < end - sizeof(Vector8) &&
-				   !pg_lfind8('\\', (uint8 *) p, sizeof(Vector8)) &&
-				   !pg_lfind8('"', (uint8 *) p, sizeof(Vector8)) &&
-				   !pg_lfind8_le(31, (uint8 *) p, sizeof(Vector8)))
-				p += sizeof(Vector8);
+#ifndef USE_NO_SIMD
+			p = json_lex_string_skip_plain(p, end);
+#endif
 
 			for (; p < end; p++)
 			{
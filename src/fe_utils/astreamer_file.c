@@ -35,6 +35,7 @@ typedef struct astreamer_extractor
 	char	   *basepath;
 	const char *(*link_map) (const char *);
 	void		(*report_output_file) (const char *);
+	bool		allow_existing_dirs;
 	char		filename[MAXPGPATH];
 	FILE	   *file;
 } astreamer_extractor;
@@ -58,7 +59,8 @@ static void astreamer_extractor_content(astreamer *streamer,
 										astreamer_archive_context context);
 static void astreamer_extractor_finalize(astreamer *streamer);
 static void astreamer_extractor_free(astreamer *streamer);
-static void extract_directory(const char *filename, mode_t mode);
+static void extract_directory(const char *filename, mode_t mode,
+							  bool allow_existing);
 static void extract_link(const char *filename, const char *linktarget);
 static FILE *create_file_for_extract(const char *filename, mode_t mode);
 
@@ -181,11 +183,16 @@ astreamer_plain_writer_free(astreamer *streamer)
  * 'report_output_file' is a function that will be called each time we open a
  * new output file. The pathname to that file is passed as an argument. If
  * NULL, the call is skipped.
+ *
+ * If 'allow_existing_dirs' is true, directories that already exist are not
+ * an error. That's needed when several archives that contain the same
+ * directories are extracted into the same place.
  */
 astreamer *
 astreamer_extractor_new(const char *basepath,
 						const char *(*link_map) (const char *),
-						void (*report_output_file) (const char *))
+						void (*report_output_file) (const char *),
+						bool allow_existing_dirs)
 {
 	astreamer_extractor *streamer;
 
@@ -195,6 +202,7 @@ astreamer_extractor_new(const char *basepath,
 	streamer->basepath = pstrdup(basepath);
 	streamer->link_map = link_map;
 	streamer->report_output_file = report_output_file;
+	streamer->allow_existing_dirs = allow_existing_dirs;
 
 	return &streamer->base;
 }
@@ -229,7 +237,8 @@ astreamer_extractor_content(astreamer *streamer, astreamer_member *member,
 
 			/* Dispatch based on file type. */
 			if (member->is_directory)
-				extract_directory(mystreamer->filename, member->mode);
+				extract_directory(mystreamer->filename, member->mode,
+								  mystreamer->allow_existing_dirs);
 			else if (member->is_link)
 			{
 				const char *linktarget = member->linktarget;
@@ -317,10 +326,11 @@ should_allow_existing_directory(const char *pathname)
  * Create a directory.
  */
 static void
-extract_directory(const char *filename, mode_t mode)
+extract_directory(const char *filename, mode_t mode, bool allow_existing)
 {
 	if (mkdir(filename, pg_dir_create_mode) != 0 &&
-		(errno != EEXIST || !should_allow_existing_directory(filename)))
+		(errno != EEXIST ||
+		 !(allow_existing || should_allow_existing_directory(filename))))
 		pg_fatal("could not create directory \"%s\": %m",
 				 filename);
 
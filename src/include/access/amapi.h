@@ -127,6 +127,15 @@ typedef bool (*aminsert_function) (Relation indexRelation,
 								   bool indexUnchanged,
 								   IndexInfo *indexInfo);
 
+/* insert a batch of tuples, without uniqueness checks */
+typedef void (*aminsertbatch_function) (Relation indexRelation,
+										int ntuples,
+										Datum *values,
+										bool *isnull,
+										ItemPointer heap_tids,
+										Relation heapRelation,
+										IndexInfo *indexInfo);
+
 /* cleanup after insert */
 typedef void (*aminsertcleanup_function) (Relation indexRelation,
 										  IndexInfo *indexInfo);
@@ -296,6 +305,7 @@ typedef struct IndexAmRoutine
 	ambuildempty_function ambuildempty;
 	aminsert_function aminsert;
 	aminsertcleanup_function aminsertcleanup;	/* can be NULL */
+	aminsertbatch_function aminsertbatch;	/* can be NULL */
 	ambulkdelete_function ambulkdelete;
 	amvacuumcleanup_function amvacuumcleanup;
 	amcanreturn_function amcanreturn;	/* can be NULL */
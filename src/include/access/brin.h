@@ -52,7 +52,16 @@ typedef struct BrinStatsData
 	  false)
 
 
+/*
+ * brinGetMinMaxBound() reads all the summaries of the index, so it gives up
+ * on indexes larger than this.
+ */
+#define BRIN_MINMAX_BOUND_MAX_PAGES		1024
+
 extern void brinGetStats(Relation index, BrinStatsData *stats);
+extern bool brinGetMinMaxBound(Relation heapRel, Relation index,
+							   AttrNumber attno, Oid sortop, bool upper,
+							   Datum *bound);
 
 extern void _brin_parallel_build_main(dsm_segment *seg, shm_toc *toc);
 
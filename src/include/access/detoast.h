@@ -79,4 +79,15 @@ extern Size toast_raw_datum_size(Datum value);
  */
 extern Size toast_datum_size(Datum value);
 
+/* ----------
+ * Cache of detoasted values, used by detoast_attr() while active
+ * ----------
+ */
+typedef struct DetoastCache DetoastCache;
+
+extern DetoastCache *detoast_cache_create(MemoryContext parent, Size limit);
+extern DetoastCache *detoast_cache_activate(DetoastCache *cache);
+extern void detoast_cache_reset(DetoastCache *cache);
+extern void AtAbort_DetoastCache(void);
+
 #endif							/* DETOAST_H */
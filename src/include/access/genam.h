@@ -155,6 +155,9 @@ typedef struct IndexOrderByDistance
 	bool		isnull;
 } IndexOrderByDistance;
 
+/* GUC parameter (in indexam.c) */
+extern PGDLLIMPORT int index_prefetch_distance;
+
 /*
  * generalized index_ interface routines (in indexam.c)
  */
@@ -170,6 +173,13 @@ extern bool index_insert(Relation indexRelation,
 						 IndexUniqueCheck checkUnique,
 						 bool indexUnchanged,
 						 IndexInfo *indexInfo);
+extern void index_insert_batch(Relation indexRelation,
+							   int ntuples,
+							   Datum *values,
+							   bool *isnull,
+							   ItemPointer heap_tids,
+							   Relation heapRelation,
+							   IndexInfo *indexInfo);
 extern void index_insert_cleanup(Relation indexRelation,
 								 IndexInfo *indexInfo);
 
@@ -204,6 +214,12 @@ extern IndexScanDesc index_beginscan_parallel(Relation heaprel,
 											  IndexScanInstrumentation *instrument,
 											  int nkeys, int norderbys,
 											  ParallelIndexScanDesc pscan);
+extern IndexScanDesc index_beginscan_parallel_bitmap(Relation indexrel,
+													 IndexScanInstrumentation *instrument,
+													 int nkeys,
+													 ParallelIndexScanDesc pscan);
+extern void index_prefetch_begin(IndexScanDesc scan, int distance,
+								 bool index_only);
 extern ItemPointer index_getnext_tid(IndexScanDesc scan,
 									 ScanDirection direction);
 extern bool index_fetch_heap(IndexScanDesc scan, TupleTableSlot *slot);
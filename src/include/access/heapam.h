@@ -87,6 +87,7 @@ typedef struct HeapScanDescData
 	 */
 	ScanDirection rs_dir;
 	BlockNumber rs_prefetch_block;
+	bool		rs_stream_inited;	/* read stream callback has started */
 
 	/*
 	 * For parallel scans to store page allocation data.  NULL when not
@@ -339,6 +340,9 @@ extern bool heap_getnextslot(TableScanDesc sscan,
 							 ScanDirection direction, TupleTableSlot *slot);
 extern void heap_set_tidrange(TableScanDesc sscan, ItemPointer mintid,
 							  ItemPointer maxtid);
+extern int	heap_getnextbatch(TableScanDesc sscan, ScanDirection direction,
+							  TupleTableSlot **slots, int nslots);
+extern void heap_scan_prefetch(TableScanDesc sscan);
 extern bool heap_getnextslot_tidrange(TableScanDesc sscan,
 									  ScanDirection direction,
 									  TupleTableSlot *slot);
@@ -367,6 +371,7 @@ extern void heap_abort_speculative(Relation relation, const ItemPointerData *tid
 extern TM_Result heap_update(Relation relation, const ItemPointerData *otid,
 							 HeapTuple newtup,
 							 CommandId cid, Snapshot crosscheck, bool wait,
+							 const Bitmapset *hot_exempt_attrs,
 							 TM_FailureData *tmfd, LockTupleMode *lockmode,
 							 TU_UpdateIndexes *update_indexes);
 extern TM_Result heap_lock_tuple(Relation relation, HeapTuple tuple,
@@ -410,6 +415,7 @@ extern TransactionId heap_index_delete_tuples(Relation rel,
 
 /* in heap/pruneheap.c */
 extern void heap_page_prune_opt(Relation relation, Buffer buffer);
+extern void heap_page_prune_background(Relation relation, Buffer buffer);
 extern void heap_page_prune_and_freeze(PruneFreezeParams *params,
 									   PruneFreezeResult *presult,
 									   OffsetNumber *off_loc,
@@ -433,6 +439,14 @@ extern void log_heap_prune_and_freeze(Relation relation, Buffer buffer,
 /* in heap/vacuumlazy.c */
 extern void heap_vacuum_rel(Relation rel,
 							const VacuumParams params, BufferAccessStrategy bstrategy);
+extern void heap_vacuum_parallel_scan_worker(Relation rel, int nindexes,
+											 TidStore *dead_items,
+											 VacDeadItemsInfo *dead_items_info,
+											 void *scan_state,
+											 BufferAccessStrategy bstrategy);
+
+/* in heap/heapam_handler.c */
+extern void heap_parallel_cluster_main(dsm_segment *seg, shm_toc *toc);
 
 /* in heap/heapam_visibility.c */
 extern bool HeapTupleSatisfiesVisibility(HeapTuple htup, Snapshot snapshot,
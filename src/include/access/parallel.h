@@ -26,6 +26,8 @@ typedef struct ParallelWorkerInfo
 {
 	BackgroundWorkerHandle *bgwhandle;
 	shm_mq_handle *error_mqh;
+	int			pool_slot;		/* slot in the worker pool, or -1 */
+	uint64		pool_generation;
 } ParallelWorkerInfo;
 
 typedef struct ParallelContext
@@ -57,6 +59,9 @@ extern PGDLLIMPORT volatile sig_atomic_t ParallelMessagePending;
 extern PGDLLIMPORT int ParallelWorkerNumber;
 extern PGDLLIMPORT bool InitializingParallelWorker;
 
+/* GUC parameter */
+extern PGDLLIMPORT int parallel_worker_pool_size;
+
 #define		IsParallelWorker()		(ParallelWorkerNumber >= 0)
 
 extern ParallelContext *CreateParallelContext(const char *library_name,
@@ -78,4 +83,10 @@ extern void ParallelWorkerReportLastRecEnd(XLogRecPtr last_xlog_end);
 
 extern void ParallelWorkerMain(Datum main_arg);
 
+extern Size ParallelWorkerPoolShmemSize(void);
+extern void ParallelWorkerPoolShmemInit(void);
+extern void ParallelWorkerPoolTerminate(Oid dbid);
+extern void ParallelWorkerPoolGetStats(int *idle, int *active, uint64 *hits,
+									   uint64 *misses);
+
 #endif							/* PARALLEL_H */
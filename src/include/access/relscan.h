@@ -16,6 +16,7 @@
 
 #include "access/htup_details.h"
 #include "access/itup.h"
+#include "access/sdir.h"
 #include "nodes/tidbitmap.h"
 #include "port/atomics.h"
 #include "storage/buf.h"
@@ -123,8 +124,67 @@ typedef struct ParallelBlockTableScanWorkerData *ParallelBlockTableScanWorker;
 typedef struct IndexFetchTableData
 {
 	Relation	rel;
+
+	/*
+	 * A block-oriented table AM sets stream_capable in its index_fetch_begin
+	 * callback if it can consume table blocks from a read stream.  If so, the
+	 * index scan code may install a read stream in rs that returns the blocks
+	 * of the TIDs that will subsequently be passed to index_fetch_tuple, in
+	 * the same order, with consecutive duplicate blocks appearing only once.
+	 * The AM must then take the next buffer from the stream whenever it needs
+	 * a block other than the one it has pinned already.
+	 */
+	bool		stream_capable;
+	struct ReadStream *rs;
 } IndexFetchTableData;
 
+/*
+ * Queue of TIDs read ahead from an amgettuple-based index scan, used to feed
+ * the table blocks they reference into a read stream.  See indexam.c.
+ */
+typedef struct IndexPrefetchEntry
+{
+	ItemPointerData tid;
+	bool		recheck;
+	/* only used by index-only scans: */
+	bool		all_visible;	/* table block all-visible per the VM? */
+	IndexTuple	itup;			/* copy of xs_itup, or NULL */
+	HeapTuple	hitup;			/* copy of xs_hitup, or NULL */
+} IndexPrefetchEntry;
+
+typedef struct IndexPrefetchData
+{
+	int			distance;		/* max # of TIDs to read ahead of caller */
+	ScanDirection direction;	/* direction we're reading the index in */
+	bool		exhausted;		/* index AM returned no more TIDs? */
+	bool		paused;			/* read stream paused waiting for space? */
+	BlockNumber last_block;		/* last block returned to the read stream */
+
+	/*
+	 * For index-only scans, the visibility map is checked as TIDs are read,
+	 * and only the blocks that aren't all-visible are read.  all_visible is
+	 * the result for the TID last returned to the caller.
+	 */
+	bool		index_only;
+	bool		all_visible;
+	Buffer		vmbuffer;		/* VM buffer pinned for the checks, if any */
+	MemoryContext tuple_cxt;	/* holds the copies of index tuples */
+	IndexTuple	cur_itup;		/* copies handed to the caller, to be */
+	HeapTuple	cur_hitup;		/* freed on the next call */
+
+	/*
+	 * Circular buffer of TIDs.  Positions increase monotonically and are
+	 * mapped to array slots by masking with (size - 1).  Entries before
+	 * next_return have been handed to the caller, and entries before
+	 * next_stream have been examined by the read stream callback.
+	 */
+	IndexPrefetchEntry *entries;
+	uint32		size;			/* always a power of 2 */
+	uint64		next_return;
+	uint64		next_stream;
+	uint64		next_free;
+} IndexPrefetchData;
+
 struct IndexScanInstrumentation;
 
 /*
@@ -175,6 +235,7 @@ typedef struct IndexScanDescData
 	bool		xs_heap_continue;	/* T if must keep walking, potential
 									 * further results */
 	IndexFetchTableData *xs_heapfetch;
+	struct IndexPrefetchData *xs_prefetch;	/* NULL if not prefetching */
 
 	bool		xs_recheck;		/* T means scan keys must be rechecked */
 
@@ -123,6 +123,14 @@ typedef struct SlruCtlData
 	 */
 	bool		long_segment_names;
 
+	/*
+	 * Backend-local state for detecting sequential reads: the last page this
+	 * backend read from disk, and the page up to which read-ahead has already
+	 * been requested.
+	 */
+	int64		last_read_pageno;
+	int64		readahead_pageno;
+
 	/*
 	 * Which sync handler function to use when handing sync requests over to
 	 * the checkpointer.  SYNC_HANDLER_NONE to disable fsync (eg pg_notify).
@@ -14,6 +14,7 @@
 extern void SubTransSetParent(TransactionId xid, TransactionId parent);
 extern TransactionId SubTransGetParent(TransactionId xid);
 extern TransactionId SubTransGetTopmostTransaction(TransactionId xid);
+extern void SubTransReportOverflowedSnapshot(void);
 
 extern Size SUBTRANSShmemSize(void);
 extern void SUBTRANSShmemInit(void);
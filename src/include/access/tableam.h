@@ -351,6 +351,39 @@ typedef struct TableAmRoutine
 									 ScanDirection direction,
 									 TupleTableSlot *slot);
 
+	/*
+	 * Optional: return up to `nslots` next tuples from `scan`, stored in
+	 * slots[0..n-1], and return n.  Fewer than `nslots` tuples are returned
+	 * only at the end of the scan; like scan_getnextslot, the scan is not
+	 * expected to be continued after that.  AMs storing tuples in batches,
+	 * e.g. column stores, can hand out a batch at a time much more cheaply
+	 * than tuple by tuple.  If not provided, table_scan_getnextbatch() calls
+	 * scan_getnextslot repeatedly.
+	 */
+	int			(*scan_getnextbatch) (TableScanDesc scan,
+									  ScanDirection direction,
+									  TupleTableSlot **slots, int nslots);
+
+	/*
+	 * Optional: tell the scan which columns of the returned tuples will be
+	 * looked at.  `attrs` contains attribute numbers offset by
+	 * FirstLowInvalidHeapAttributeNumber, as built by pull_varattnos(); a
+	 * whole-row reference (attribute number 0) means all columns.  Columns
+	 * not in `attrs` may be returned as NULL, which allows AMs storing
+	 * columns separately to not read them at all.  Called right after
+	 * scan_begin, if at all; the setting stays in effect across rescans.
+	 */
+	void		(*scan_set_projection) (TableScanDesc scan, Bitmapset *attrs);
+
+	/*
+	 * Optional: start I/O for the first blocks a forward scan will return,
+	 * without returning anything.  Called between scan_begin (or
+	 * scan_rescan) and the first scan_getnextslot, when the caller expects
+	 * to get to this scan soon, e.g. the next partition of an Append.
+	 * Should not wait for the reads to complete.
+	 */
+	void		(*scan_prefetch) (TableScanDesc scan);
+
 	/*-----------
 	 * Optional functions to provide scanning for ranges of ItemPointers.
 	 * Implementations must either provide both of these functions, or neither
@@ -547,6 +580,7 @@ typedef struct TableAmRoutine
 								 Snapshot snapshot,
 								 Snapshot crosscheck,
 								 bool wait,
+								 const Bitmapset *hot_exempt_attrs,
 								 TM_FailureData *tmfd,
 								 LockTupleMode *lockmode,
 								 TU_UpdateIndexes *update_indexes);
@@ -1036,6 +1070,65 @@ table_scan_getnextslot(TableScanDesc sscan, ScanDirection direction, TupleTableS
 	return sscan->rs_rd->rd_tableam->scan_getnextslot(sscan, direction, slot);
 }
 
+/*
+ * Return up to `nslots` next tuples from `scan`, stored in slots[], and
+ * return their number.  Fewer than `nslots` means the end of the scan.
+ */
+static inline int
+table_scan_getnextbatch(TableScanDesc sscan, ScanDirection direction,
+						TupleTableSlot **slots, int nslots)
+{
+	const TableAmRoutine *tableam = sscan->rs_rd->rd_tableam;
+	int			n;
+
+	/* We don't expect actual scans using NoMovementScanDirection */
+	Assert(direction == ForwardScanDirection ||
+		   direction == BackwardScanDirection);
+	Assert(nslots > 0);
+
+	/* see table_scan_getnextslot() */
+	if (unlikely(TransactionIdIsValid(CheckXidAlive) && !bsysscan))
+		elog(ERROR, "unexpected table_scan_getnextbatch call during logical decoding");
+
+	if (tableam->scan_getnextbatch == NULL)
+	{
+		for (n = 0; n < nslots; n++)
+		{
+			slots[n]->tts_tableOid = RelationGetRelid(sscan->rs_rd);
+			if (!tableam->scan_getnextslot(sscan, direction, slots[n]))
+				break;
+		}
+		return n;
+	}
+
+	n = tableam->scan_getnextbatch(sscan, direction, slots, nslots);
+	for (int i = 0; i < n; i++)
+		slots[i]->tts_tableOid = RelationGetRelid(sscan->rs_rd);
+	return n;
+}
+
+/*
+ * Tell `scan` which columns of the returned tuples the caller needs, if the
+ * AM can make use of that.  See scan_set_projection.
+ */
+static inline void
+table_scan_set_projection(TableScanDesc sscan, Bitmapset *attrs)
+{
+	if (sscan->rs_rd->rd_tableam->scan_set_projection != NULL)
+		sscan->rs_rd->rd_tableam->scan_set_projection(sscan, attrs);
+}
+
+/*
+ * Start reading the first blocks of `sscan` ahead of time, if the AM
+ * supports that.  See scan_prefetch.
+ */
+static inline void
+table_scan_prefetch(TableScanDesc sscan)
+{
+	if (sscan->rs_rd->rd_tableam->scan_prefetch != NULL)
+		sscan->rs_rd->rd_tableam->scan_prefetch(sscan);
+}
+
 /* ----------------------------------------------------------------------------
  * TID Range scanning related functions.
  * ----------------------------------------------------------------------------
@@ -1486,6 +1579,11 @@ table_tuple_delete(Relation rel, ItemPointer tid, CommandId cid,
  *		cmax/cmin if successful)
  *	crosscheck - if not InvalidSnapshot, also check old tuple against this
  *	wait - true if should wait for any conflicting update to commit/abort
+ *	hot_exempt_attrs - if not NULL, columns (offset by
+ *		FirstLowInvalidHeapAttributeNumber) whose modification the caller has
+ *		verified doesn't change any index key, see ExecGetHotExemptAttrs().
+ *		The AM may ignore changes to them when deciding whether new index
+ *		entries are required.
  *
  * Output parameters:
  *	slot - newly constructed tuple data to store
@@ -1511,12 +1609,13 @@ table_tuple_delete(Relation rel, ItemPointer tid, CommandId cid,
 static inline TM_Result
 table_tuple_update(Relation rel, ItemPointer otid, TupleTableSlot *slot,
 				   CommandId cid, Snapshot snapshot, Snapshot crosscheck,
-				   bool wait, TM_FailureData *tmfd, LockTupleMode *lockmode,
+				   bool wait, const Bitmapset *hot_exempt_attrs,
+				   TM_FailureData *tmfd, LockTupleMode *lockmode,
 				   TU_UpdateIndexes *update_indexes)
 {
 	return rel->rd_tableam->tuple_update(rel, otid, slot,
 										 cid, snapshot, crosscheck,
-										 wait, tmfd,
+										 wait, hot_exempt_attrs, tmfd,
 										 lockmode, update_indexes);
 }
 
@@ -243,7 +243,8 @@ typedef struct TransamVariablesData
 	 * modified the database) that completed in some form since the start of
 	 * the server. This currently is solely used to check whether
 	 * GetSnapshotData() needs to recompute the contents of the snapshot, or
-	 * not. There are likely other users of this.  Always above 1.
+	 * can reuse its own previous snapshot or the one shared by another
+	 * backend. There are likely other users of this.  Always above 1.
 	 */
 	uint64		xactCompletionCount;
 
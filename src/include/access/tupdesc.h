@@ -139,12 +139,17 @@ typedef struct TupleDescData
 	int32		tdtypmod;		/* typmod for tuple type */
 	int			tdrefcount;		/* reference count, or -1 if not counting */
 	TupleConstr *constr;		/* constraints, or NULL if none */
+	int16		tdfixedprefix;	/* # of leading fixed-width attributes, or
+								 * -1 if not computed yet */
+	int16		tdwideprefix;	/* # of those that are Datum-sized and
+								 * pass-by-value, see TupleDescComputeFixedPrefix */
 	/* compact_attrs[N] is the compact metadata of Attribute Number N+1 */
 	CompactAttribute compact_attrs[FLEXIBLE_ARRAY_MEMBER];
 }			TupleDescData;
 typedef struct TupleDescData *TupleDesc;
 
 extern void populate_compact_attribute(TupleDesc tupdesc, int attnum);
+extern void TupleDescComputeFixedPrefix(TupleDesc tupdesc);
 
 /*
  * Calculates the base address of the Form_pg_attribute at the end of the
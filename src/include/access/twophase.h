@@ -27,6 +27,7 @@ typedef struct GlobalTransactionData *GlobalTransaction;
 
 /* GUC variable */
 extern PGDLLIMPORT int max_prepared_xacts;
+extern PGDLLIMPORT int twophase_state_cache_size;
 
 extern Size TwoPhaseShmemSize(void);
 extern void TwoPhaseShmemInit(void);
@@ -67,6 +68,7 @@ extern bool LookupGXact(const char *gid, XLogRecPtr prepare_end_lsn,
 extern void TwoPhaseTransactionGid(Oid subid, TransactionId xid, char *gid_res,
 								   int szgid);
 extern bool LookupGXactBySubid(Oid subid);
+extern List *LookupGXactsByGidPrefix(const char *prefix);
 
 extern TransactionId TwoPhaseGetOldestXidInCommit(void);
 
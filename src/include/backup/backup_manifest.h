@@ -38,6 +38,12 @@ typedef struct backup_manifest_info
 extern void InitializeBackupManifest(backup_manifest_info *manifest,
 									 backup_manifest_option want_manifest,
 									 pg_checksum_type manifest_checksum_type);
+extern void InitializeBackupManifestFileList(backup_manifest_info *manifest,
+											 BufFile *buffile,
+											 pg_checksum_type manifest_checksum_type,
+											 bool force_encode);
+extern void AppendBackupManifestFileList(backup_manifest_info *manifest,
+										 BufFile *file);
 extern void AddFileToBackupManifest(backup_manifest_info *manifest,
 									Oid spcoid,
 									const char *pathname, size_t size,
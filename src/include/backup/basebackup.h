@@ -20,6 +20,11 @@
 #define MAX_RATE_LOWER	32
 #define MAX_RATE_UPPER	1048576
 
+/*
+ * Maximum number of connections of a parallel base backup.
+ */
+#define MAX_PARALLEL_BACKUP	64
+
 /*
  * Information about a tablespace
  *
@@ -0,0 +1,67 @@
+/*-------------------------------------------------------------------------
+ *
+ * basebackup_parallel.h
+ *	  Coordination of a base backup sent over several connections
+ *
+ * Portions Copyright (c) 2010-2025, PostgreSQL Global Development Group
+ *
+ * src/include/backup/basebackup_parallel.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef BASEBACKUP_PARALLEL_H
+#define BASEBACKUP_PARALLEL_H
+
+#include "access/xlogdefs.h"
+#include "backup/backup_manifest.h"
+#include "nodes/pg_list.h"
+#include "storage/buffile.h"
+
+struct ParallelBackupShared;
+struct dsm_segment;
+
+/*
+ * Backend-local state of one participant in a parallel base backup.
+ *
+ * Participant 0 is the connection that ran BASE_BACKUP with the PARALLEL
+ * option; it starts and stops the backup and sends everything that isn't a
+ * relation file.  The others are the connections that ran BASE_BACKUP with
+ * PARALLEL_WORKER, and send only their share of the relation files.
+ */
+typedef struct ParallelBackupState
+{
+	struct dsm_segment *seg;
+	struct ParallelBackupShared *shared;
+	int			participant;
+	int			nparticipants;
+
+	/* Copied from the leader's backup, for the benefit of the workers. */
+	XLogRecPtr	startptr;
+	TimeLineID	starttli;
+	bool		started_in_recovery;
+	bool		sendtblspclinks;
+	List	   *tablespaces;
+	backup_manifest_option manifest;
+	pg_checksum_type manifest_checksum_type;
+} ParallelBackupState;
+
+extern ParallelBackupState *ParallelBackupBegin(int nparticipants,
+												XLogRecPtr startptr,
+												TimeLineID starttli,
+												bool sendtblspclinks,
+												List *tablespaces,
+												backup_manifest_option manifest,
+												pg_checksum_type manifest_checksum_type);
+extern void ParallelBackupSendToken(ParallelBackupState *pstate);
+extern void ParallelBackupFinish(ParallelBackupState *pstate,
+								 backup_manifest_info *manifest);
+
+extern ParallelBackupState *ParallelBackupAttach(const char *token);
+extern BufFile *ParallelBackupCreateManifestFile(ParallelBackupState *pstate);
+extern void ParallelBackupWorkerDone(ParallelBackupState *pstate);
+
+extern bool ParallelBackupIncludesFile(ParallelBackupState *pstate,
+									   const char *path, bool distribute);
+extern void ParallelBackupCheckAborted(ParallelBackupState *pstate);
+
+#endif
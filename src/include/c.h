@@ -418,6 +418,18 @@
 #define unlikely(x) ((x) != 0)
 #endif
 
+/*
+ * Hint to the CPU that the memory at the given address will be read soon, so
+ * that it can start loading it into the cache.  This helps code that misses
+ * the cache on addresses it can compute ahead of time, such as hash table
+ * lookups for a group of keys.  It never faults, even on invalid addresses.
+ */
+#ifdef __GNUC__
+#define pg_prefetch_mem(addr)	__builtin_prefetch(addr)
+#else
+#define pg_prefetch_mem(addr)	((void) (addr))
+#endif
+
 /*
  * CppAsString
  *		Convert the argument to a string, using the C preprocessor.
@@ -0,0 +1,42 @@
+/*-------------------------------------------------------------------------
+ *
+ * globaltemp.h
+ *	  prototypes for functions in backend/catalog/globaltemp.c
+ *
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/catalog/globaltemp.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef GLOBALTEMP_H
+#define GLOBALTEMP_H
+
+#include "common/relpath.h"
+#include "utils/relcache.h"
+
+extern Size GlobalTempShmemSize(void);
+extern void GlobalTempShmemInit(void);
+extern void GlobalTempGetOldestXids(Oid dbid, TransactionId *frozenxid,
+									MultiXactId *minmxid);
+
+extern void GlobalTempRelationInitStorage(Relation rel);
+extern void GlobalTempRelationInitIndexes(Relation heap);
+extern bool GlobalTempRelationHasStorage(Relation rel);
+extern void GlobalTempRelationRemember(Relation rel);
+extern RelFileNumber GlobalTempMapRelFileNumber(Oid relid,
+												RelFileNumber relfilenumber);
+extern void GlobalTempRelationSetNewRelfilenumber(Relation relation);
+extern void GlobalTempRelationGetXids(Relation rel, TransactionId *frozenxid,
+									  MultiXactId *minmxid);
+extern void GlobalTempRelationSetXids(Relation rel, TransactionId frozenxid,
+									  MultiXactId minmxid);
+
+extern void PreCommit_GlobalTemp(void);
+extern void AtEOXact_GlobalTemp(bool isCommit);
+extern void AtEOSubXact_GlobalTemp(bool isCommit, SubTransactionId mySubid,
+								   SubTransactionId parentSubid);
+
+#endif							/* GLOBALTEMP_H */
@@ -0,0 +1,29 @@
+/*-------------------------------------------------------------------------
+ *
+ * indexcapture.h
+ *	  Capture of tuples inserted during concurrent index builds.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ *
+ * src/include/catalog/indexcapture.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef INDEXCAPTURE_H
+#define INDEXCAPTURE_H
+
+#include "storage/itemptr.h"
+
+/* GUC parameters */
+extern PGDLLIMPORT int concurrent_index_capture_size;
+
+extern Size IndexCaptureShmemSize(void);
+extern void IndexCaptureShmemInit(void);
+
+extern bool IndexCaptureBegin(Oid indexId);
+extern void IndexCaptureRecord(Oid indexId, ItemPointer tid);
+extern int64 *IndexCaptureCollect(Oid indexId, int64 *ntids);
+extern void IndexCaptureEnd(Oid indexId);
+extern void AtAbort_IndexCapture(void);
+
+#endif							/* INDEXCAPTURE_H */
@@ -14,6 +14,7 @@
 #ifndef COPY_H
 #define COPY_H
 
+#include "access/parallel.h"
 #include "nodes/execnodes.h"
 #include "nodes/parsenodes.h"
 #include "parser/parse_node.h"
@@ -50,8 +51,9 @@ typedef enum CopyLogVerbosityChoice
 
 /*
  * A struct to hold COPY options, in a parsed form. All of these are related
- * to formatting, except for 'freeze', which doesn't really belong here, but
- * it's expedient to parse it along with all the other options.
+ * to formatting, except for 'freeze' and 'nworkers', which don't really
+ * belong here, but it's expedient to parse them along with all the other
+ * options.
  */
 typedef struct CopyFormatOptions
 {
@@ -60,6 +62,7 @@ typedef struct CopyFormatOptions
 								 * -1 if not specified */
 	bool		binary;			/* binary format? */
 	bool		freeze;			/* freeze rows on loading? */
+	int			nworkers;		/* parallel workers requested, 0 if none */
 	bool		csv_mode;		/* Comma Separated Value format? */
 	int			header_line;	/* number of lines to skip or COPY_HEADER_XXX
 								 * value (see the above) */
@@ -107,12 +110,17 @@ extern bool NextCopyFrom(CopyFromState cstate, ExprContext *econtext,
 						 Datum *values, bool *nulls);
 extern bool NextCopyFromRawFields(CopyFromState cstate,
 								  char ***fields, int *nfields);
+extern void CopyFromSetRange(CopyFromState cstate, pgoff_t start, pgoff_t end);
 extern void CopyFromErrorCallback(void *arg);
 extern char *CopyLimitPrintoutLength(const char *str);
 
 extern uint64 CopyFrom(CopyFromState cstate);
 
+extern void ParallelCopyFromMain(dsm_segment *seg, shm_toc *toc);
+
 extern DestReceiver *CreateCopyDestReceiver(void);
+extern DestReceiver *CreateCopyToWorkerDestReceiver(List *info,
+													DestReceiver *leader);
 
 /*
  * internal prototypes
@@ -77,6 +77,8 @@ typedef struct CopyFromStateData
 	char	   *filename;		/* filename, or NULL for STDIN */
 	bool		is_program;		/* is 'filename' a program to popen? */
 	copy_data_source_cb data_source_cb; /* function for reading data */
+	List	   *attnamelist;	/* column names as given, for parallel workers */
+	List	   *options;		/* COPY options as given, for parallel workers */
 
 	CopyFormatOptions opts;
 	bool	   *convert_select_flags;	/* per-column CSV/TEXT CS flags */
@@ -181,6 +183,15 @@ typedef struct CopyFromStateData
 #define RAW_BUF_BYTES(cstate) ((cstate)->raw_buf_len - (cstate)->raw_buf_index)
 
 	uint64		bytes_processed;	/* number of bytes processed so far */
+
+	/* the part of the file to read, if set with CopyFromSetRange() */
+	bool		range_set;
+	bool		range_done;		/* has the last line of the range been read? */
+	pgoff_t		range_pos;		/* file offset of the next byte to read */
+	pgoff_t		range_end;		/* end of the range, or -1 for end of file */
+
+	/* input lines handed over by the leader, in a parallel COPY worker */
+	struct ParallelCopyWorkerState *pcopy;
 } CopyFromStateData;
 
 extern void ReceiveCopyBegin(CopyFromState cstate);
@@ -194,4 +205,11 @@ extern bool CopyFromCSVOneRow(CopyFromState cstate, ExprContext *econtext,
 extern bool CopyFromBinaryOneRow(CopyFromState cstate, ExprContext *econtext,
 								 Datum *values, bool *nulls);
 
+/* raw line reader for the leader of a parallel COPY, in copyfromparse.c */
+extern bool NextCopyFromRawLine(CopyFromState cstate);
+
+/* parallel COPY FROM, in copyfromparallel.c */
+extern bool ParallelCopyFrom(CopyFromState cstate, uint64 *processed);
+extern bool CopyFromParallelNextLine(CopyFromState cstate);
+
 #endif							/* COPYFROM_INTERNAL_H */
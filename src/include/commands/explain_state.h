@@ -51,6 +51,7 @@ typedef struct ExplainState
 	bool		buffers;		/* print buffer usage */
 	bool		wal;			/* print WAL usage */
 	bool		timing;			/* print detailed node timing */
+	bool		sampling;		/* time only a sample of each node's calls */
 	bool		summary;		/* print total planning and execution timing */
 	bool		memory;			/* print planner's memory usage information */
 	bool		settings;		/* print modified settings */
@@ -71,6 +72,7 @@ typedef struct ExplainState
 								 * entry */
 	/* state related to the current plan node */
 	ExplainWorkersState *workers_state; /* needed if parallel plan */
+	struct SubPlanState *subplan_state; /* SubPlan whose plan is shown */
 	/* extensions */
 	void	  **extension_state;
 	int			extension_state_allocated;
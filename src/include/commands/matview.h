@@ -33,4 +33,7 @@ extern DestReceiver *CreateTransientRelDestReceiver(Oid transientoid);
 
 extern bool MatViewIncrementalMaintenanceIsEnabled(void);
 
+extern void CheckIncrementalMatViewQuery(Query *query);
+extern void CreateIncrementalMatViewTriggers(Oid matviewOid, Query *query);
+
 #endif							/* MATVIEW_H */
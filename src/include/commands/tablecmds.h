@@ -18,7 +18,9 @@
 #include "catalog/dependency.h"
 #include "catalog/objectaddress.h"
 #include "nodes/parsenodes.h"
+#include "storage/dsm.h"
 #include "storage/lock.h"
+#include "storage/shm_toc.h"
 #include "utils/relcache.h"
 
 typedef struct AlterTableUtilityContext AlterTableUtilityContext;	/* avoid including
@@ -39,6 +41,8 @@ extern void AlterTable(AlterTableStmt *stmt, LOCKMODE lockmode,
 
 extern LOCKMODE AlterTableGetLockLevel(List *cmds);
 
+extern void ATRewriteTableParallelMain(dsm_segment *seg, shm_toc *toc);
+
 extern void ATExecChangeOwner(Oid relationOid, Oid newOwnerId, bool recursing, LOCKMODE lockmode);
 
 extern void AlterTableInternal(Oid relid, List *cmds, bool recurse);
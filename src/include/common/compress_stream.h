@@ -0,0 +1,39 @@
+/*-------------------------------------------------------------------------
+ *
+ * compress_stream.h
+ *	  Streaming compression and decompression with the algorithms of
+ *	  common/compression.h.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		  src/include/common/compress_stream.h
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef PG_COMPRESS_STREAM_H
+#define PG_COMPRESS_STREAM_H
+
+#include "common/compression.h"
+
+/* Largest amount of input consumed by one pg_compress_stream_compress() */
+#define PG_COMPRESS_STREAM_CHUNK	(64 * 1024)
+
+/* opaque context, private to each implementation */
+typedef struct pg_compress_stream pg_compress_stream;
+
+extern bool pg_compress_stream_supported(pg_compress_algorithm algorithm);
+extern int	pg_compress_stream_default_level(pg_compress_algorithm algorithm);
+extern pg_compress_stream *pg_compress_stream_create(pg_compress_algorithm algorithm,
+													 int level,
+													 bool decompress);
+extern int	pg_compress_stream_compress(pg_compress_stream *cs,
+										const void *src, size_t *srclen,
+										const char **dst, size_t *dstlen);
+extern int	pg_compress_stream_decompress(pg_compress_stream *cs,
+										  const void *src, size_t *srclen,
+										  void *dst, size_t *dstlen);
+extern const char *pg_compress_stream_error(pg_compress_stream *cs);
+extern void pg_compress_stream_free(pg_compress_stream *cs);
+
+#endif							/* PG_COMPRESS_STREAM_H */
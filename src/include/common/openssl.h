@@ -38,6 +38,14 @@
 #define MAX_OPENSSL_TLS_VERSION  "TLSv1"
 #endif
 
+/*
+ * Kernel TLS offload, where OpenSSL hands the session keys to the kernel
+ * after the handshake.  It only works with OpenSSL's own socket BIO.
+ */
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+#define USE_KTLS
+#endif
+
 #endif							/* USE_OPENSSL */
 
 #endif							/* COMMON_OPENSSL_H */
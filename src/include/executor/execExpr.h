@@ -289,6 +289,7 @@ typedef enum ExprEvalOp
 	EEOP_AGG_PLAIN_TRANS_BYREF,
 	EEOP_AGG_PRESORTED_DISTINCT_SINGLE,
 	EEOP_AGG_PRESORTED_DISTINCT_MULTI,
+	EEOP_AGG_HASHED_DISTINCT,
 	EEOP_AGG_ORDERED_TRANS_DATUM,
 	EEOP_AGG_ORDERED_TRANS_TUPLE,
 
@@ -733,6 +734,14 @@ typedef struct ExprEvalStep
 			int			jumpdistinct;
 		}			agg_presorted_distinctcheck;
 
+		/* for EEOP_AGG_HASHED_DISTINCT */
+		struct
+		{
+			AggStatePerTrans pertrans;
+			int			setno;
+			int			jumpdistinct;
+		}			agg_hashed_distinctcheck;
+
 		/* for EEOP_AGG_PLAIN_TRANS_[INIT_][STRICT_]{BYVAL,BYREF} */
 		/* for EEOP_AGG_ORDERED_TRANS_{DATUM,TUPLE} */
 		struct
@@ -912,9 +921,58 @@ extern bool ExecEvalPreOrderedDistinctSingle(AggState *aggstate,
 											 AggStatePerTrans pertrans);
 extern bool ExecEvalPreOrderedDistinctMulti(AggState *aggstate,
 											AggStatePerTrans pertrans);
+extern bool ExecEvalAggHashedDistinct(AggState *aggstate,
+									  AggStatePerTrans pertrans, int setno);
 extern void ExecEvalAggOrderedTransDatum(ExprState *state, ExprEvalStep *op,
 										 ExprContext *econtext);
 extern void ExecEvalAggOrderedTransTuple(ExprState *state, ExprEvalStep *op,
 										 ExprContext *econtext);
 
+
+/*
+ * Support for batched qual evaluation.
+ *
+ * An ExprBatchQual holds the clauses of a qual that have the simple form
+ * "column op constant", so that ExecQualBatch() can evaluate them for many
+ * rows at a time using tight per-column loops.  See ExecInitQualBatch().
+ */
+typedef enum ExprBatchOp
+{
+	EBOP_EQ,
+	EBOP_NE,
+	EBOP_LT,
+	EBOP_LE,
+	EBOP_GT,
+	EBOP_GE,
+} ExprBatchOp;
+
+typedef enum ExprBatchType
+{
+	EBTYPE_INT4,				/* also used for date */
+	EBTYPE_INT8,
+	EBTYPE_FLOAT8,
+} ExprBatchType;
+
+typedef struct ExprBatchClause
+{
+	AttrNumber	attnum;			/* column of the scan tuple */
+	ExprBatchType type;			/* type of the column and the constant */
+	ExprBatchOp op;				/* comparison, with the column on the left */
+	Datum		constval;		/* the constant, never NULL */
+} ExprBatchClause;
+
+typedef struct ExprBatchQual
+{
+	int			maxrows;		/* maximum number of rows in a batch */
+	Datum	   *values;			/* workspace for one column of a batch */
+	bool	   *isnull;
+	int			nclauses;
+	ExprBatchClause clauses[FLEXIBLE_ARRAY_MEMBER];
+} ExprBatchQual;
+
+extern ExprBatchQual *ExecInitQualBatch(List *qual, int maxrows,
+										List **residual);
+extern void ExecQualBatch(ExprBatchQual *bq, TupleTableSlot **slots,
+						  int nslots, bool *matches);
+
 #endif							/* EXEC_EXPR_H */
@@ -32,6 +32,9 @@ typedef struct ParallelExecutorInfo
 	dsa_area   *area;			/* points to DSA area in DSM */
 	dsa_pointer param_exec;		/* serialized PARAM_EXEC parameters */
 	bool		finished;		/* set true by ExecParallelFinish */
+	ParallelDestKind worker_dest;	/* see ExecGatherSetWorkerDest */
+	uint64	   *worker_processed;	/* workers' tuple counts, if not
+									 * PARALLEL_DEST_TUPLES */
 	/* These two arrays have pcxt->nworkers_launched entries: */
 	shm_mq_handle **tqueue;		/* tuple queues for worker output */
 	struct TupleQueueReader **reader;	/* tuple reader/writer support */
@@ -39,7 +42,9 @@ typedef struct ParallelExecutorInfo
 
 extern ParallelExecutorInfo *ExecInitParallelPlan(PlanState *planstate,
 												  EState *estate, Bitmapset *sendParams, int nworkers,
-												  int64 tuples_needed);
+												  int64 tuples_needed,
+												  ParallelDestKind worker_dest,
+												  Node *worker_dest_info);
 extern void ExecParallelCreateReaders(ParallelExecutorInfo *pei);
 extern void ExecParallelFinish(ParallelExecutorInfo *pei);
 extern void ExecParallelCleanup(ParallelExecutorInfo *pei);
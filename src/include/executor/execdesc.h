@@ -51,6 +51,12 @@ typedef struct QueryDesc
 	/* This field is set by ExecutePlan */
 	bool		already_executed;	/* true if previously executed */
 
+	/*
+	 * The cached plan the statement belongs to, if the caller wants its
+	 * executor state to be kept for reuse; set NULL by CreateQueryDesc
+	 */
+	struct CachedPlan *cplan;
+
 	/* This is always set NULL by the core system, but plugins can change it */
 	struct Instrumentation *totaltime;	/* total time spent in ExecutorRun */
 } QueryDesc;
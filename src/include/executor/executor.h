@@ -120,12 +120,15 @@ extern bool execCurrentOf(CurrentOfExpr *cexpr,
 /*
  * prototypes from functions in execGrouping.c
  */
+extern PGDLLIMPORT bool fast_hash_functions;
+
 extern ExprState *execTuplesMatchPrepare(TupleDesc desc,
 										 int numCols,
 										 const AttrNumber *keyColIdx,
 										 const Oid *eqOperators,
 										 const Oid *collations,
 										 PlanState *parent);
+extern Oid	ExecInMemoryHashFunction(Oid hashfn);
 extern void execTuplesHashPrepare(int numCols,
 								  const Oid *eqOperators,
 								  Oid **eqFuncOids,
@@ -232,6 +235,8 @@ ExecGetJunkAttribute(TupleTableSlot *slot, AttrNumber attno, bool *isNull)
 /*
  * prototypes from functions in execMain.c
  */
+extern PGDLLIMPORT bool executor_state_reuse;
+
 extern void ExecutorStart(QueryDesc *queryDesc, int eflags);
 extern void standard_ExecutorStart(QueryDesc *queryDesc, int eflags);
 extern void ExecutorRun(QueryDesc *queryDesc,
@@ -745,6 +750,16 @@ extern List *ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 								   bool noDupErr,
 								   bool *specConflict, List *arbiterIndexes,
 								   bool onlySummarizing);
+extern void ExecInsertIndexTuplesBatch(ResultRelInfo *resultRelInfo,
+									   TupleTableSlot **slots, int nslots,
+									   EState *estate, bool update);
+extern List *ExecInsertIndexTuplesUnbatched(ResultRelInfo *resultRelInfo,
+											TupleTableSlot *slot,
+											EState *estate, bool update);
+extern Bitmapset *ExecGetHotExemptAttrs(ResultRelInfo *resultRelInfo,
+										TupleTableSlot *oldslot,
+										TupleTableSlot *newslot,
+										EState *estate);
 extern bool ExecCheckIndexConstraints(ResultRelInfo *resultRelInfo,
 									  TupleTableSlot *slot,
 									  EState *estate, ItemPointer conflictTid,
@@ -779,6 +794,9 @@ extern bool RelationFindDeletedTupleInfoByIndex(Relation rel, Oid idxoid,
 												TimestampTz *delete_time);
 extern void ExecSimpleRelationInsert(ResultRelInfo *resultRelInfo,
 									 EState *estate, TupleTableSlot *slot);
+extern void ExecSimpleRelationMultiInsert(ResultRelInfo *resultRelInfo,
+										  EState *estate,
+										  TupleTableSlot **slots, int nslots);
 extern void ExecSimpleRelationUpdate(ResultRelInfo *resultRelInfo,
 									 EState *estate, EPQState *epqstate,
 									 TupleTableSlot *searchslot, TupleTableSlot *slot);
@@ -55,6 +55,8 @@ typedef struct WalUsage
 	uint64		wal_bytes;		/* size of WAL records produced */
 	uint64		wal_fpi_bytes;	/* size of WAL full page images produced */
 	int64		wal_buffers_full;	/* # of times the WAL buffers became full */
+	int64		commit_delays;	/* # of waits for group commit followers */
+	int64		commit_delay_time;	/* time spent in those waits, in usec */
 } WalUsage;
 
 /* Flag bits included in InstrAlloc's instrument_options bitmask */
@@ -64,9 +66,17 @@ typedef enum InstrumentOption
 	INSTRUMENT_BUFFERS = 1 << 1,	/* needs buffer usage */
 	INSTRUMENT_ROWS = 1 << 2,	/* needs row count */
 	INSTRUMENT_WAL = 1 << 3,	/* needs WAL usage */
-	INSTRUMENT_ALL = PG_INT32_MAX
+	INSTRUMENT_TIMER_SAMPLED = 1 << 4,	/* time only a sample of calls */
+	/* sampling is a mode of the timer rather than something to measure */
+	INSTRUMENT_ALL = PG_INT32_MAX & ~INSTRUMENT_TIMER_SAMPLED
 } InstrumentOption;
 
+/*
+ * With INSTRUMENT_TIMER_SAMPLED, on average one in this many calls of a node
+ * is timed.
+ */
+#define INSTR_SAMPLE_INTERVAL	100
+
 typedef struct Instrumentation
 {
 	/* Parameters set at node creation: */
@@ -74,8 +84,11 @@ typedef struct Instrumentation
 	bool		need_bufusage;	/* true if we need buffer usage data */
 	bool		need_walusage;	/* true if we need WAL usage data */
 	bool		async_mode;		/* true if node is in async mode */
+	bool		sample_timer;	/* true if timing only a sample of calls */
 	/* Info about current plan cycle: */
 	bool		running;		/* true if we've completed first tuple */
+	bool		timing_call;	/* true if the current call is being timed */
+	int			sample_countdown;	/* calls until the next one is timed */
 	instr_time	starttime;		/* start time of current iteration of node */
 	instr_time	counter;		/* accumulated runtime for this node */
 	double		firsttuple;		/* time for first tuple of this cycle */
@@ -92,6 +105,12 @@ typedef struct Instrumentation
 	double		nfiltered2;		/* # of tuples removed by "other" quals */
 	BufferUsage bufusage;		/* total buffer usage */
 	WalUsage	walusage;		/* total WAL usage */
+	/* Totals of sampled timing, from which startup and total are estimated: */
+	double		calls;			/* # of calls */
+	double		sampled_calls;	/* # of calls that were timed */
+	double		sampled_time;	/* time spent in those calls (in seconds) */
+	double		startup_sampled;	/* # of timed first calls of a cycle */
+	double		startup_sampled_time;	/* time spent in those (in seconds) */
 } Instrumentation;
 
 typedef struct WorkerInstrumentation
@@ -53,6 +53,13 @@ typedef struct AggStatePerTransData
 	 */
 	bool		aggsortrequired;
 
+	/*
+	 * True for DISTINCT Aggrefs that eliminate duplicates with a hash table
+	 * as the input arrives, instead of sorting it.  aggsortrequired is false
+	 * for these.
+	 */
+	bool		aggdistincthash;
+
 	/*
 	 * Number of aggregated input columns.  This includes ORDER BY expressions
 	 * in both the plain-agg and ordered-set cases.  Ordered-set direct args
@@ -161,6 +168,17 @@ typedef struct AggStatePerTransData
 
 	Tuplesortstate **sortstates;	/* sort objects, if DISTINCT or ORDER BY */
 
+	/*
+	 * If aggdistincthash is set, each input value is instead looked up in a
+	 * hash table of the values already seen in the group, and passed to the
+	 * transition function straight away if it's new.  Should the table grow
+	 * beyond hash_mem, it stops accepting new values; from then on the values
+	 * not found in it go to a sort object as above, which is processed at
+	 * the end of the group.  Again we need one of each per grouping set.
+	 */
+	TupleHashTable *distincttables;
+	bool	   *distinctfull;	/* table is full, sort the rest? */
+
 	/*
 	 * This field is a pre-initialized FunctionCallInfo struct used for
 	 * calling this aggregate's transfn.  We save a few cycles per row by not
@@ -325,6 +343,7 @@ typedef struct AggStatePerHashData
 extern AggState *ExecInitAgg(Agg *node, EState *estate, int eflags);
 extern void ExecEndAgg(AggState *node);
 extern void ExecReScanAgg(AggState *node);
+extern void agg_begin_input_sort(AggStatePerTrans pertrans, int setno);
 
 extern Size hash_agg_entry_size(int numTrans, Size tupleWidth,
 								Size transitionSpace);
@@ -20,5 +20,7 @@ extern GatherState *ExecInitGather(Gather *node, EState *estate, int eflags);
 extern void ExecEndGather(GatherState *node);
 extern void ExecShutdownGather(GatherState *node);
 extern void ExecReScanGather(GatherState *node);
+extern void ExecGatherSetWorkerDest(GatherState *node, ParallelDestKind dest,
+									Node *dest_info, TupleDesc dest_desc);
 
 #endif							/* NODEGATHER_H */
@@ -18,6 +18,10 @@
 #include "nodes/execnodes.h"
 #include "storage/buffile.h"
 
+extern PGDLLIMPORT int hashjoin_batch_size;
+extern PGDLLIMPORT bool hashjoin_bloom_filter;
+extern PGDLLIMPORT bool hashjoin_radix_partition;
+
 extern HashJoinState *ExecInitHashJoin(HashJoin *node, EState *estate, int eflags);
 extern void ExecEndHashJoin(HashJoinState *node);
 extern void ExecReScanHashJoin(HashJoinState *node);
@@ -21,6 +21,11 @@ extern IndexOnlyScanState *ExecInitIndexOnlyScan(IndexOnlyScan *node, EState *es
 extern void ExecEndIndexOnlyScan(IndexOnlyScanState *node);
 extern void ExecIndexOnlyMarkPos(IndexOnlyScanState *node);
 extern void ExecIndexOnlyRestrPos(IndexOnlyScanState *node);
+extern bool ExecIndexOnlyScanInitLowerBound(IndexOnlyScanState *node,
+											Oid opfamily, Oid collation,
+											Oid argtype);
+extern void ExecIndexOnlyScanSetLowerBound(IndexOnlyScanState *node,
+										   Datum value);
 extern void ExecReScanIndexOnlyScan(IndexOnlyScanState *node);
 
 /* Support functions for parallel index-only scans */
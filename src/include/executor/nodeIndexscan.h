@@ -22,6 +22,9 @@ extern IndexScanState *ExecInitIndexScan(IndexScan *node, EState *estate, int ef
 extern void ExecEndIndexScan(IndexScanState *node);
 extern void ExecIndexMarkPos(IndexScanState *node);
 extern void ExecIndexRestrPos(IndexScanState *node);
+extern bool ExecIndexScanInitLowerBound(IndexScanState *node, Oid opfamily,
+										Oid collation, Oid argtype);
+extern void ExecIndexScanSetLowerBound(IndexScanState *node, Datum value);
 extern void ExecReScanIndexScan(IndexScanState *node);
 extern void ExecIndexScanEstimate(IndexScanState *node, ParallelContext *pcxt);
 extern void ExecIndexScanInitializeDSM(IndexScanState *node, ParallelContext *pcxt);
@@ -44,5 +47,18 @@ extern void ExecIndexEvalRuntimeKeys(ExprContext *econtext,
 extern bool ExecIndexEvalArrayKeys(ExprContext *econtext,
 								   IndexArrayKeyInfo *arrayKeys, int numArrayKeys);
 extern bool ExecIndexAdvanceArrayKeys(IndexArrayKeyInfo *arrayKeys, int numArrayKeys);
+extern IndexLowerBound *ExecIndexAddLowerBound(Relation index, Oid opfamily,
+											   Oid collation, Oid argtype,
+											   ScanKey *scanKeys, int *numScanKeys,
+											   IndexRuntimeKeyInfo *runtimeKeys,
+											   int numRuntimeKeys);
+extern void ExecIndexSetLowerBound(IndexLowerBound *bound, Datum value);
+extern IndexSkipKey *ExecIndexAddSkipKey(Relation index,
+										 ScanKey *scanKeys, int *numScanKeys,
+										 IndexRuntimeKeyInfo *runtimeKeys,
+										 int numRuntimeKeys);
+extern void ExecIndexResetSkipKey(IndexSkipKey *skip);
+extern bool ExecIndexSkipNextPhase(IndexSkipKey *skip);
+extern void ExecIndexSkipPast(IndexSkipKey *skip, Datum value, bool isnull);
 
 #endif							/* NODEINDEXSCAN_H */
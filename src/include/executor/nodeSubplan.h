@@ -30,4 +30,6 @@ extern void ExecSetParamPlan(SubPlanState *node, ExprContext *econtext);
 
 extern void ExecSetParamPlanMulti(const Bitmapset *params, ExprContext *econtext);
 
+extern void ExecSubPlanResetCache(SubPlanState *node);
+
 #endif							/* NODESUBPLAN_H */
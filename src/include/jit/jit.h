@@ -87,9 +87,11 @@ extern PGDLLIMPORT bool jit_dump_bitcode;
 extern PGDLLIMPORT bool jit_expressions;
 extern PGDLLIMPORT bool jit_profiling_support;
 extern PGDLLIMPORT bool jit_tuple_deforming;
+extern PGDLLIMPORT bool jit_deform_cache;
 extern PGDLLIMPORT double jit_above_cost;
 extern PGDLLIMPORT double jit_inline_above_cost;
 extern PGDLLIMPORT double jit_optimize_above_cost;
+extern PGDLLIMPORT int jit_tier_up_calls;
 
 
 extern void jit_reset_after_error(void);
@@ -99,6 +101,7 @@ extern void jit_release_context(JitContext *context);
  * Functions for attempting to JIT code. Callers must accept that these might
  * not be able to perform JIT (i.e. return false).
  */
+extern bool jit_tier_up_expr(struct ExprState *state);
 extern bool jit_compile_expr(struct ExprState *state);
 extern void InstrJitAgg(JitInstrumentation *dst, JitInstrumentation *add);
 
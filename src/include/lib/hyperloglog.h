@@ -62,6 +62,8 @@ typedef struct hyperLogLogState
 extern void initHyperLogLog(hyperLogLogState *cState, uint8 bwidth);
 extern void initHyperLogLogError(hyperLogLogState *cState, double error);
 extern void addHyperLogLog(hyperLogLogState *cState, uint32 hash);
+extern void mergeHyperLogLog(hyperLogLogState *cState,
+							 const hyperLogLogState *oState);
 extern double estimateHyperLogLog(hyperLogLogState *cState);
 extern void freeHyperLogLog(hyperLogLogState *cState);
 
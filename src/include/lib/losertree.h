@@ -0,0 +1,61 @@
+/*
+ * losertree.h
+ *
+ * A tournament tree ("tree of losers") for k-way merging
+ *
+ * Portions Copyright (c) 2012-2025, PostgreSQL Global Development Group
+ *
+ * src/include/lib/losertree.h
+ */
+
+#ifndef LOSERTREE_H
+#define LOSERTREE_H
+
+/*
+ * The tree merges a number of sorted input sources, identified by numbers
+ * 0 .. nsources - 1.  The elements themselves are kept by the caller; the
+ * comparator is passed two source numbers and compares the current leading
+ * elements of those sources.  It must return <0 iff a's element sorts before
+ * b's, 0 iff they are equal, and >0 iff a's element sorts after b's.
+ */
+typedef int (*losertree_comparator) (int a, int b, void *arg);
+
+/*
+ * losertree
+ *
+ *		lt_capacity		maximum number of sources
+ *		lt_nsources		number of sources in the current merge
+ *		lt_nactive		how many of those are not exhausted
+ *		lt_compare		comparison function for the sources' elements
+ *		lt_arg			user data for comparison function
+ *		lt_active		per source, whether it has a current element
+ *		lt_nodes		lt_nodes[0] is the winning source, and lt_nodes[1 ..
+ *						nsources - 1] hold the source that lost the match
+ *						played at that internal node of the tree
+ */
+typedef struct losertree
+{
+	int			lt_capacity;
+	int			lt_nsources;
+	int			lt_nactive;
+	losertree_comparator lt_compare;
+	void	   *lt_arg;
+	bool	   *lt_active;
+	int			lt_nodes[FLEXIBLE_ARRAY_MEMBER];
+} losertree;
+
+extern losertree *losertree_allocate(int capacity,
+									 losertree_comparator compare,
+									 void *arg);
+extern void losertree_reset(losertree *tree, int nsources);
+extern void losertree_free(losertree *tree);
+extern void losertree_add_unordered(losertree *tree, int source);
+extern void losertree_build(losertree *tree);
+extern void losertree_replace_first(losertree *tree);
+extern void losertree_remove_first(losertree *tree);
+
+#define losertree_empty(t)			((t)->lt_nactive == 0)
+#define losertree_first(t)			(AssertMacro(!losertree_empty(t)), \
+									 (t)->lt_nodes[0])
+
+#endif							/* LOSERTREE_H */
@@ -0,0 +1,1025 @@
+/*
+ * swisshash.h
+ *
+ *	  When included this file generates a "templated" (by way of macros)
+ *	  open-addressing hash table implementation specialized to user-defined
+ *	  types, using SIMD instructions to probe several buckets at once.
+ *
+ *	  The generated interface is the same as that of simplehash.h, so a hash
+ *	  table can be switched from one to the other by changing the #include.
+ *	  The differences are in the table layout and hence in the performance
+ *	  characteristics, see below.
+ *
+ * Usage notes:
+ *
+ *	  The parameters are the same as for simplehash.h, see there.  As there,
+ *	  the element type is required to contain a "status" member; it is kept
+ *	  in sync with the control bytes described below, so that code holding a
+ *	  pointer to an element can check whether it is still in use.
+ *
+ *	  Unlike simplehash.h, deleting an element never moves other elements, so
+ *	  pointers to elements stay valid until the next insertion that grows the
+ *	  table.  The order in which elements are returned by iteration differs
+ *	  from simplehash.h, so switching a hash table whose iteration order is
+ *	  visible to users will change results.
+ *
+ * Hash table design:
+ *
+ *	  The design follows the "Swiss table" of the Abseil library.  Besides the
+ *	  array of elements, the table has an array of one-byte control words, one
+ *	  per bucket, each either EMPTY, DELETED (a tombstone), or holding the
+ *	  top 7 bits of the hash of the element in the bucket.  A lookup starts at
+ *	  the bucket selected by the low bits of the hash, and compares the
+ *	  control bytes of a whole group of consecutive buckets with the 7 bits
+ *	  of the key's hash at once, using port/simd.h; only the elements whose
+ *	  control bytes match have to be compared with the key, which is usually
+ *	  just the one sought.  A group containing an EMPTY control byte ends the
+ *	  lookup, otherwise the next group is chosen by triangular (quadratic)
+ *	  probing.  The first control bytes are duplicated after the end of the
+ *	  array, so that a group can start at any bucket without wrapping around.
+ *
+ *	  Compared to simplehash.h's robin hood hashing, lookups touch the
+ *	  element array only for likely matches, and unsuccessful lookups are
+ *	  cheap even at high fill factors, but deletions leave tombstones behind
+ *	  unless the deleted bucket was never part of a full group.  Tombstones
+ *	  count towards the fill factor, and are removed by rebuilding the table,
+ *	  at the same size if it is mostly tombstones.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/lib/swisshash.h
+ */
+
+#include "port/pg_bitutils.h"
+#include "port/simd.h"
+
+/* helpers */
+#define SH_MAKE_PREFIX(a) CppConcat(a,_)
+#define SH_MAKE_NAME(name) SH_MAKE_NAME_(SH_MAKE_PREFIX(SH_PREFIX),name)
+#define SH_MAKE_NAME_(a,b) CppConcat(a,b)
+
+/* name macros for: */
+
+/* type declarations */
+#define SH_TYPE SH_MAKE_NAME(hash)
+#define SH_STATUS SH_MAKE_NAME(status)
+#define SH_STATUS_EMPTY SH_MAKE_NAME(SH_EMPTY)
+#define SH_STATUS_IN_USE SH_MAKE_NAME(SH_IN_USE)
+#define SH_ITERATOR SH_MAKE_NAME(iterator)
+
+/* function declarations */
+#define SH_CREATE SH_MAKE_NAME(create)
+#define SH_DESTROY SH_MAKE_NAME(destroy)
+#define SH_RESET SH_MAKE_NAME(reset)
+#define SH_INSERT SH_MAKE_NAME(insert)
+#define SH_INSERT_HASH SH_MAKE_NAME(insert_hash)
+#define SH_DELETE_ITEM SH_MAKE_NAME(delete_item)
+#define SH_DELETE SH_MAKE_NAME(delete)
+#define SH_LOOKUP SH_MAKE_NAME(lookup)
+#define SH_LOOKUP_HASH SH_MAKE_NAME(lookup_hash)
+#define SH_GROW SH_MAKE_NAME(grow)
+#define SH_START_ITERATE SH_MAKE_NAME(start_iterate)
+#define SH_START_ITERATE_AT SH_MAKE_NAME(start_iterate_at)
+#define SH_ITERATE SH_MAKE_NAME(iterate)
+#define SH_ALLOCATE SH_MAKE_NAME(allocate)
+#define SH_FREE SH_MAKE_NAME(free)
+#define SH_ESTIMATE_SPACE SH_MAKE_NAME(estimate_space)
+#define SH_STAT SH_MAKE_NAME(stat)
+
+/* internal helper functions (no externally visible prototypes) */
+#define SH_COMPUTE_SIZE SH_MAKE_NAME(compute_size)
+#define SH_UPDATE_PARAMETERS SH_MAKE_NAME(update_parameters)
+#define SH_ALLOCATE_CTRL SH_MAKE_NAME(allocate_ctrl)
+#define SH_SET_CTRL SH_MAKE_NAME(set_ctrl)
+#define SH_FIND_FREE SH_MAKE_NAME(find_free)
+#define SH_ENTRY_HASH SH_MAKE_NAME(entry_hash)
+#define SH_INSERT_HASH_INTERNAL SH_MAKE_NAME(insert_hash_internal)
+#define SH_LOOKUP_HASH_INTERNAL SH_MAKE_NAME(lookup_hash_internal)
+
+/* generate forward declarations necessary to use the hash table */
+#ifdef SH_DECLARE
+
+/* type definitions */
+typedef struct SH_TYPE
+{
+	/*
+	 * Size of data / bucket array, 64 bits to handle UINT32_MAX sized hash
+	 * tables.  Note that the maximum number of elements is lower
+	 * (SH_MAX_FILLFACTOR)
+	 */
+	uint64		size;
+
+	/* how many elements have valid contents */
+	uint32		members;
+
+	/* how many buckets are tombstones */
+	uint32		deleted;
+
+	/* mask for bucket and size calculations, based on size */
+	uint32		sizemask;
+
+	/* boundary of members + deleted after which to grow or rebuild */
+	uint32		grow_threshold;
+
+	/* control bytes, size + group width of them */
+	uint8	   *ctrl;
+
+	/* hash buckets */
+	SH_ELEMENT_TYPE *data;
+
+#ifndef SH_RAW_ALLOCATOR
+	/* memory context to use for allocations */
+	MemoryContext ctx;
+#endif
+
+	/* user defined data, useful for callbacks */
+	void	   *private_data;
+}			SH_TYPE;
+
+typedef enum SH_STATUS
+{
+	SH_STATUS_EMPTY = 0x00,
+	SH_STATUS_IN_USE = 0x01
+} SH_STATUS;
+
+typedef struct SH_ITERATOR
+{
+	uint32		cur;			/* current element */
+	uint32		end;
+	bool		done;			/* iterator exhausted? */
+}			SH_ITERATOR;
+
+/* externally visible function prototypes */
+#ifdef SH_RAW_ALLOCATOR
+/* <prefix>_hash <prefix>_create(uint32 nelements, void *private_data) */
+SH_SCOPE	SH_TYPE *SH_CREATE(uint32 nelements, void *private_data);
+#else
+/*
+ * <prefix>_hash <prefix>_create(MemoryContext ctx, uint32 nelements,
+ *								 void *private_data)
+ */
+SH_SCOPE	SH_TYPE *SH_CREATE(MemoryContext ctx, uint32 nelements,
+							   void *private_data);
+#endif
+
+/* void <prefix>_destroy(<prefix>_hash *tb) */
+SH_SCOPE void SH_DESTROY(SH_TYPE * tb);
+
+/* void <prefix>_reset(<prefix>_hash *tb) */
+SH_SCOPE void SH_RESET(SH_TYPE * tb);
+
+/* void <prefix>_grow(<prefix>_hash *tb, uint64 newsize) */
+SH_SCOPE void SH_GROW(SH_TYPE * tb, uint64 newsize);
+
+/* <element> *<prefix>_insert(<prefix>_hash *tb, <key> key, bool *found) */
+SH_SCOPE	SH_ELEMENT_TYPE *SH_INSERT(SH_TYPE * tb, SH_KEY_TYPE key, bool *found);
+
+/*
+ * <element> *<prefix>_insert_hash(<prefix>_hash *tb, <key> key, uint32 hash,
+ * 								  bool *found)
+ */
+SH_SCOPE	SH_ELEMENT_TYPE *SH_INSERT_HASH(SH_TYPE * tb, SH_KEY_TYPE key,
+											uint32 hash, bool *found);
+
+/* <element> *<prefix>_lookup(<prefix>_hash *tb, <key> key) */
+SH_SCOPE	SH_ELEMENT_TYPE *SH_LOOKUP(SH_TYPE * tb, SH_KEY_TYPE key);
+
+/* <element> *<prefix>_lookup_hash(<prefix>_hash *tb, <key> key, uint32 hash) */
+SH_SCOPE	SH_ELEMENT_TYPE *SH_LOOKUP_HASH(SH_TYPE * tb, SH_KEY_TYPE key,
+											uint32 hash);
+
+/* void <prefix>_delete_item(<prefix>_hash *tb, <element> *entry) */
+SH_SCOPE void SH_DELETE_ITEM(SH_TYPE * tb, SH_ELEMENT_TYPE * entry);
+
+/* bool <prefix>_delete(<prefix>_hash *tb, <key> key) */
+SH_SCOPE bool SH_DELETE(SH_TYPE * tb, SH_KEY_TYPE key);
+
+/* void <prefix>_start_iterate(<prefix>_hash *tb, <prefix>_iterator *iter) */
+SH_SCOPE void SH_START_ITERATE(SH_TYPE * tb, SH_ITERATOR * iter);
+
+/*
+ * void <prefix>_start_iterate_at(<prefix>_hash *tb, <prefix>_iterator *iter,
+ *								  uint32 at)
+ */
+SH_SCOPE void SH_START_ITERATE_AT(SH_TYPE * tb, SH_ITERATOR * iter, uint32 at);
+
+/* <element> *<prefix>_iterate(<prefix>_hash *tb, <prefix>_iterator *iter) */
+SH_SCOPE	SH_ELEMENT_TYPE *SH_ITERATE(SH_TYPE * tb, SH_ITERATOR * iter);
+
+/* size_t <prefix>_estimate_space(double nentries) */
+SH_SCOPE size_t SH_ESTIMATE_SPACE(double nentries);
+
+/* void <prefix>_stat(<prefix>_hash *tb) */
+SH_SCOPE void SH_STAT(SH_TYPE * tb);
+
+#endif							/* SH_DECLARE */
+
+
+/* generate implementation of the hash table */
+#ifdef SH_DEFINE
+
+#ifndef SH_RAW_ALLOCATOR
+#include "utils/memutils.h"
+#endif
+
+/* max data array size,we allow up to PG_UINT32_MAX buckets, including 0 */
+#define SH_MAX_SIZE (((uint64) PG_UINT32_MAX) + 1)
+
+/* normal fillfactor, unless already close to maximum */
+#ifndef SH_FILLFACTOR
+#define SH_FILLFACTOR (0.875)
+#endif
+/* increase fillfactor if we otherwise would error out */
+#define SH_MAX_FILLFACTOR (0.98)
+
+#ifdef SH_STORE_HASH
+#define SH_COMPARE_KEYS(tb, ahash, akey, b) (ahash == SH_GET_HASH(tb, b) && SH_EQUAL(tb, b->SH_KEY, akey))
+#else
+#define SH_COMPARE_KEYS(tb, ahash, akey, b) (SH_EQUAL(tb, b->SH_KEY, akey))
+#endif
+
+/*
+ * Wrap the following definitions in include guards, to avoid multiple
+ * definition errors if this header is included more than once.  The rest of
+ * the file deliberately has no include guards, because it can be included
+ * with different parameters to define functions and types with non-colliding
+ * names.
+ */
+#ifndef SWISSHASH_H
+#define SWISSHASH_H
+
+/* these are the same as in simplehash.h, which may be included too */
+#ifndef sh_error
+#ifdef FRONTEND
+#define sh_error(...) pg_fatal(__VA_ARGS__)
+#define sh_log(...) pg_log_info(__VA_ARGS__)
+#else
+#define sh_error(...) elog(ERROR, __VA_ARGS__)
+#define sh_log(...) elog(LOG, __VA_ARGS__)
+#endif
+#endif
+
+/*
+ * Control byte values.  A full bucket has the high bit clear and the top 7
+ * bits of the element's hash in the other bits.
+ */
+#define SWH_CTRL_EMPTY		0x80
+#define SWH_CTRL_DELETED	0xFE
+#define SWH_IS_FULL(c)		(((c) & 0x80) == 0)
+#define SWH_H2(hash)		((uint8) ((hash) >> 25))
+
+/*
+ * Probe the control bytes with SIMD instructions where port/simd.h has them.
+ * Defining SWISSHASH_NO_SIMD before this file is first included selects the
+ * portable implementation instead, so that it can be tested anywhere.
+ */
+#if !defined(USE_NO_SIMD) && !defined(SWISSHASH_NO_SIMD)
+#define SWH_USE_SIMD
+#endif
+
+/* number of buckets probed at once */
+#ifdef SWH_USE_SIMD
+#define SWH_GROUP_WIDTH		((uint32) sizeof(Vector8))
+#else
+#define SWH_GROUP_WIDTH		8
+#endif
+
+/*
+ * Return a bitmask with bit i set if the i-th control byte of the group
+ * starting at 'group' is equal to 'c'.
+ */
+static inline uint32
+swh_match_byte(const uint8 *group, uint8 c)
+{
+#ifdef SWH_USE_SIMD
+	Vector8		v;
+
+	vector8_load(&v, group);
+	return vector8_highbit_mask(vector8_eq(v, vector8_broadcast(c)));
+#else
+	uint32		mask = 0;
+
+	for (int i = 0; i < SWH_GROUP_WIDTH; i++)
+	{
+		if (group[i] == c)
+			mask |= UINT32_C(1) << i;
+	}
+	return mask;
+#endif
+}
+
+/*
+ * Like swh_match_byte, for the control bytes that are EMPTY or DELETED.
+ */
+static inline uint32
+swh_match_empty_or_deleted(const uint8 *group)
+{
+#ifdef SWH_USE_SIMD
+	Vector8		v;
+
+	vector8_load(&v, group);
+	return vector8_highbit_mask(v);
+#else
+	uint32		mask = 0;
+
+	for (int i = 0; i < SWH_GROUP_WIDTH; i++)
+	{
+		if (!SWH_IS_FULL(group[i]))
+			mask |= UINT32_C(1) << i;
+	}
+	return mask;
+#endif
+}
+
+#endif							/* SWISSHASH_H */
+
+/*
+ * Compute allocation size for hashtable. Result can be passed to
+ * SH_UPDATE_PARAMETERS.  (Keep SH_ESTIMATE_SPACE in sync with this!)
+ */
+static inline uint64
+SH_COMPUTE_SIZE(uint64 newsize)
+{
+	uint64		size;
+
+	/* a group must fit in the table */
+	size = Max(newsize, SWH_GROUP_WIDTH);
+
+	/* round up size to the next power of 2, that's how bucketing works */
+	size = pg_nextpower2_64(size);
+	Assert(size <= SH_MAX_SIZE);
+
+	/*
+	 * Verify that allocation of ->data is possible on this platform, without
+	 * overflowing Size.
+	 */
+	if (unlikely((((uint64) sizeof(SH_ELEMENT_TYPE)) * size) >= SIZE_MAX / 2))
+		sh_error("hash table too large");
+
+	return size;
+}
+
+/*
+ * Update sizing parameters for hashtable. Called when creating and growing
+ * the hashtable.
+ */
+static inline void
+SH_UPDATE_PARAMETERS(SH_TYPE * tb, uint64 newsize)
+{
+	uint64		size = SH_COMPUTE_SIZE(newsize);
+
+	/* now set size */
+	tb->size = size;
+	tb->sizemask = (uint32) (size - 1);
+
+	/*
+	 * Compute the next threshold at which we need to grow the hash table
+	 * again.  It's always below the size, so that there's at least one EMPTY
+	 * bucket to end lookups.
+	 */
+	if (tb->size == SH_MAX_SIZE)
+		tb->grow_threshold = ((double) tb->size) * SH_MAX_FILLFACTOR;
+	else
+		tb->grow_threshold = ((double) tb->size) * SH_FILLFACTOR;
+}
+
+static inline uint32
+SH_ENTRY_HASH(SH_TYPE * tb, SH_ELEMENT_TYPE * entry)
+{
+#ifdef SH_STORE_HASH
+	return SH_GET_HASH(tb, entry);
+#else
+	return SH_HASH_KEY(tb, entry->SH_KEY);
+#endif
+}
+
+/* default memory allocator function */
+static inline void *SH_ALLOCATE(SH_TYPE * type, Size size);
+static inline void SH_FREE(SH_TYPE * type, void *pointer);
+
+#ifndef SH_USE_NONDEFAULT_ALLOCATOR
+
+/* default memory allocator function */
+static inline void *
+SH_ALLOCATE(SH_TYPE * type, Size size)
+{
+#ifdef SH_RAW_ALLOCATOR
+	return SH_RAW_ALLOCATOR(size);
+#else
+	return MemoryContextAllocExtended(type->ctx, size,
+									  MCXT_ALLOC_HUGE | MCXT_ALLOC_ZERO);
+#endif
+}
+
+/* default memory free function */
+static inline void
+SH_FREE(SH_TYPE * type, void *pointer)
+{
+	pfree(pointer);
+}
+
+#endif
+
+/*
+ * Allocate the control bytes for tb->size buckets, all EMPTY.  They're never
+ * allocated with SH_ALLOCATE, which is for the array of elements only.
+ */
+static inline void
+SH_ALLOCATE_CTRL(SH_TYPE * tb)
+{
+	Size		size = tb->size + SWH_GROUP_WIDTH;
+
+#ifdef SH_RAW_ALLOCATOR
+	tb->ctrl = (uint8 *) SH_RAW_ALLOCATOR(size);
+#else
+	tb->ctrl = (uint8 *) MemoryContextAllocExtended(tb->ctx, size,
+													MCXT_ALLOC_HUGE);
+#endif
+	memset(tb->ctrl, SWH_CTRL_EMPTY, size);
+}
+
+/* set a control byte, and its copy after the end of the array if any */
+static inline void
+SH_SET_CTRL(SH_TYPE * tb, uint32 bucket, uint8 c)
+{
+	tb->ctrl[bucket] = c;
+	if (bucket < SWH_GROUP_WIDTH)
+		tb->ctrl[tb->size + bucket] = c;
+}
+
+/*
+ * Return the first bucket that is EMPTY or DELETED in the probe sequence of
+ * the hash.
+ */
+static inline uint32
+SH_FIND_FREE(SH_TYPE * tb, uint32 hash)
+{
+	uint32		pos = hash & tb->sizemask;
+	uint32		stride = 0;
+
+	for (;;)
+	{
+		uint32		mask = swh_match_empty_or_deleted(&tb->ctrl[pos]);
+
+		if (mask != 0)
+			return (pos + pg_rightmost_one_pos32(mask)) & tb->sizemask;
+
+		stride += SWH_GROUP_WIDTH;
+		pos = (pos + stride) & tb->sizemask;
+	}
+}
+
+/*
+ * Create a hash table with enough space for `nelements` distinct members.
+ * Memory for the hash table is allocated from the passed-in context.  If
+ * desired, the array of elements can be allocated using a passed-in allocator;
+ * this could be useful in order to place the array of elements in a shared
+ * memory, or in a context that will outlive the rest of the hash table.
+ * Memory other than for the array of elements will still be allocated from
+ * the passed-in context.
+ */
+#ifdef SH_RAW_ALLOCATOR
+SH_SCOPE	SH_TYPE *
+SH_CREATE(uint32 nelements, void *private_data)
+#else
+SH_SCOPE	SH_TYPE *
+SH_CREATE(MemoryContext ctx, uint32 nelements, void *private_data)
+#endif
+{
+	SH_TYPE    *tb;
+	uint64		size;
+
+#ifdef SH_RAW_ALLOCATOR
+	tb = (SH_TYPE *) SH_RAW_ALLOCATOR(sizeof(SH_TYPE));
+#else
+	tb = (SH_TYPE *) MemoryContextAllocZero(ctx, sizeof(SH_TYPE));
+	tb->ctx = ctx;
+#endif
+	tb->private_data = private_data;
+
+	/* increase nelements by fillfactor, want to store nelements elements */
+	size = Min((double) SH_MAX_SIZE, ((double) nelements) / SH_FILLFACTOR);
+
+	size = SH_COMPUTE_SIZE(size);
+
+	tb->data = (SH_ELEMENT_TYPE *) SH_ALLOCATE(tb, sizeof(SH_ELEMENT_TYPE) * size);
+
+	SH_UPDATE_PARAMETERS(tb, size);
+	SH_ALLOCATE_CTRL(tb);
+	return tb;
+}
+
+/* destroy a previously created hash table */
+SH_SCOPE void
+SH_DESTROY(SH_TYPE * tb)
+{
+	SH_FREE(tb, tb->data);
+	pfree(tb->ctrl);
+	pfree(tb);
+}
+
+/* reset the contents of a previously created hash table */
+SH_SCOPE void
+SH_RESET(SH_TYPE * tb)
+{
+	memset(tb->data, 0, sizeof(SH_ELEMENT_TYPE) * tb->size);
+	memset(tb->ctrl, SWH_CTRL_EMPTY, tb->size + SWH_GROUP_WIDTH);
+	tb->members = 0;
+	tb->deleted = 0;
+}
+
+/*
+ * Rebuild a hash table with at least `newsize` buckets, which removes all
+ * tombstones.  `newsize` may be the current size.
+ *
+ * Usually this will automatically be called by insertions, when necessary.
+ * But resizing to the exact input size can be advantageous
+ * performance-wise, when known at some point.
+ */
+SH_SCOPE void
+SH_GROW(SH_TYPE * tb, uint64 newsize)
+{
+	uint64		oldsize = tb->size;
+	SH_ELEMENT_TYPE *olddata = tb->data;
+	uint8	   *oldctrl = tb->ctrl;
+
+	newsize = SH_COMPUTE_SIZE(newsize);
+	Assert(newsize >= oldsize);
+
+	/*
+	 * Allocate the new arrays first; if that fails, the table is still
+	 * intact.
+	 */
+	tb->data = (SH_ELEMENT_TYPE *) SH_ALLOCATE(tb, sizeof(SH_ELEMENT_TYPE) * newsize);
+	SH_UPDATE_PARAMETERS(tb, newsize);
+	SH_ALLOCATE_CTRL(tb);
+	tb->deleted = 0;
+
+	/* the keys are known to be distinct, so just find a free bucket */
+	for (uint64 i = 0; i < oldsize; i++)
+	{
+		SH_ELEMENT_TYPE *oldentry = &olddata[i];
+		uint32		hash;
+		uint32		bucket;
+
+		if (!SWH_IS_FULL(oldctrl[i]))
+			continue;
+
+		hash = SH_ENTRY_HASH(tb, oldentry);
+		bucket = SH_FIND_FREE(tb, hash);
+		SH_SET_CTRL(tb, bucket, oldctrl[i]);
+		memcpy(&tb->data[bucket], oldentry, sizeof(SH_ELEMENT_TYPE));
+	}
+
+	SH_FREE(tb, olddata);
+	pfree(oldctrl);
+}
+
+/*
+ * This is a separate static inline function, so it can be reliably be inlined
+ * into its wrapper functions even if SH_SCOPE is extern.
+ */
+static inline SH_ELEMENT_TYPE *
+SH_INSERT_HASH_INTERNAL(SH_TYPE * tb, SH_KEY_TYPE key, uint32 hash, bool *found)
+{
+	uint8		h2 = SWH_H2(hash);
+	uint32		pos = hash & tb->sizemask;
+	uint32		stride = 0;
+	bool		have_free = false;
+	uint32		freebucket = 0;
+	SH_ELEMENT_TYPE *entry;
+
+	/*
+	 * Look for an existing entry, remembering the first free bucket on the
+	 * way, until a group with an EMPTY bucket shows that the key isn't there.
+	 */
+	for (;;)
+	{
+		uint8	   *group = &tb->ctrl[pos];
+		uint32		mask = swh_match_byte(group, h2);
+
+		while (mask != 0)
+		{
+			uint32		bucket = (pos + pg_rightmost_one_pos32(mask)) & tb->sizemask;
+
+			entry = &tb->data[bucket];
+			if (SH_COMPARE_KEYS(tb, hash, key, entry))
+			{
+				Assert(entry->status == SH_STATUS_IN_USE);
+				*found = true;
+				return entry;
+			}
+			mask &= mask - 1;
+		}
+
+		if (!have_free)
+		{
+			mask = swh_match_empty_or_deleted(group);
+			if (mask != 0)
+			{
+				have_free = true;
+				freebucket = (pos + pg_rightmost_one_pos32(mask)) & tb->sizemask;
+			}
+		}
+
+		if (swh_match_byte(group, SWH_CTRL_EMPTY) != 0)
+			break;
+
+		stride += SWH_GROUP_WIDTH;
+		pos = (pos + stride) & tb->sizemask;
+	}
+
+	Assert(have_free);
+
+	/*
+	 * Reusing a tombstone doesn't change the number of buckets in use, but
+	 * using up an EMPTY bucket may require growing first.  If most of the
+	 * buckets in use are tombstones, it's enough to rebuild the table at the
+	 * same size.
+	 */
+	if (tb->ctrl[freebucket] == SWH_CTRL_EMPTY &&
+		unlikely(tb->members + tb->deleted >= tb->grow_threshold))
+	{
+		if (tb->members < tb->grow_threshold / 2)
+			SH_GROW(tb, tb->size);
+		else if (tb->size < SH_MAX_SIZE)
+			SH_GROW(tb, tb->size * 2);
+		else if (tb->deleted > 0)
+			SH_GROW(tb, tb->size);
+		else
+			sh_error("hash table size exceeded");
+
+		freebucket = SH_FIND_FREE(tb, hash);
+	}
+
+	if (tb->ctrl[freebucket] == SWH_CTRL_DELETED)
+		tb->deleted--;
+	tb->members++;
+	SH_SET_CTRL(tb, freebucket, h2);
+
+	entry = &tb->data[freebucket];
+	entry->SH_KEY = key;
+#ifdef SH_STORE_HASH
+	SH_GET_HASH(tb, entry) = hash;
+#endif
+	entry->status = SH_STATUS_IN_USE;
+	*found = false;
+	return entry;
+}
+
+/*
+ * Insert the key key into the hash-table, set *found to true if the key
+ * already exists, false otherwise. Returns the hash-table entry in either
+ * case.
+ */
+SH_SCOPE	SH_ELEMENT_TYPE *
+SH_INSERT(SH_TYPE * tb, SH_KEY_TYPE key, bool *found)
+{
+	uint32		hash = SH_HASH_KEY(tb, key);
+
+	return SH_INSERT_HASH_INTERNAL(tb, key, hash, found);
+}
+
+/*
+ * Insert the key key into the hash-table using an already-calculated
+ * hash. Set *found to true if the key already exists, false
+ * otherwise. Returns the hash-table entry in either case.
+ */
+SH_SCOPE	SH_ELEMENT_TYPE *
+SH_INSERT_HASH(SH_TYPE * tb, SH_KEY_TYPE key, uint32 hash, bool *found)
+{
+	return SH_INSERT_HASH_INTERNAL(tb, key, hash, found);
+}
+
+/*
+ * This is a separate static inline function, so it can be reliably be inlined
+ * into its wrapper functions even if SH_SCOPE is extern.
+ */
+static inline SH_ELEMENT_TYPE *
+SH_LOOKUP_HASH_INTERNAL(SH_TYPE * tb, SH_KEY_TYPE key, uint32 hash)
+{
+	uint8		h2 = SWH_H2(hash);
+	uint32		pos = hash & tb->sizemask;
+	uint32		stride = 0;
+
+	for (;;)
+	{
+		uint8	   *group = &tb->ctrl[pos];
+		uint32		mask = swh_match_byte(group, h2);
+
+		while (mask != 0)
+		{
+			uint32		bucket = (pos + pg_rightmost_one_pos32(mask)) & tb->sizemask;
+			SH_ELEMENT_TYPE *entry = &tb->data[bucket];
+
+			if (SH_COMPARE_KEYS(tb, hash, key, entry))
+			{
+				Assert(entry->status == SH_STATUS_IN_USE);
+				return entry;
+			}
+			mask &= mask - 1;
+		}
+
+		if (swh_match_byte(group, SWH_CTRL_EMPTY) != 0)
+			return NULL;
+
+		stride += SWH_GROUP_WIDTH;
+		pos = (pos + stride) & tb->sizemask;
+	}
+}
+
+/*
+ * Lookup entry in hash table.  Returns NULL if key not present.
+ */
+SH_SCOPE	SH_ELEMENT_TYPE *
+SH_LOOKUP(SH_TYPE * tb, SH_KEY_TYPE key)
+{
+	uint32		hash = SH_HASH_KEY(tb, key);
+
+	return SH_LOOKUP_HASH_INTERNAL(tb, key, hash);
+}
+
+/*
+ * Lookup entry in hash table using an already-calculated hash.
+ *
+ * Returns NULL if key not present.
+ */
+SH_SCOPE	SH_ELEMENT_TYPE *
+SH_LOOKUP_HASH(SH_TYPE * tb, SH_KEY_TYPE key, uint32 hash)
+{
+	return SH_LOOKUP_HASH_INTERNAL(tb, key, hash);
+}
+
+/*
+ * Delete entry from hash table by key.  Returns whether to-be-deleted key was
+ * present.
+ */
+SH_SCOPE bool
+SH_DELETE(SH_TYPE * tb, SH_KEY_TYPE key)
+{
+	SH_ELEMENT_TYPE *entry = SH_LOOKUP(tb, key);
+
+	if (entry == NULL)
+		return false;
+
+	SH_DELETE_ITEM(tb, entry);
+	return true;
+}
+
+/*
+ * Delete entry from hash table by entry pointer.  No other entry moves.
+ */
+SH_SCOPE void
+SH_DELETE_ITEM(SH_TYPE * tb, SH_ELEMENT_TYPE * entry)
+{
+	uint32		bucket = entry - tb->data;
+	uint32		empty_before;
+	uint32		empty_after;
+
+	Assert(SWH_IS_FULL(tb->ctrl[bucket]));
+	Assert(entry->status == SH_STATUS_IN_USE);
+
+	entry->status = SH_STATUS_EMPTY;
+	tb->members--;
+
+	/*
+	 * A lookup can only have probed past this bucket if some group containing
+	 * it had no EMPTY bucket.  If every group containing it has one, that
+	 * never happened, and the bucket can become EMPTY rather than a
+	 * tombstone.  That's the case if the run of non-EMPTY buckets around it
+	 * is shorter than a group.
+	 */
+	empty_before = swh_match_byte(&tb->ctrl[(bucket - SWH_GROUP_WIDTH) & tb->sizemask],
+								  SWH_CTRL_EMPTY);
+	empty_after = swh_match_byte(&tb->ctrl[bucket], SWH_CTRL_EMPTY);
+
+	if (empty_before != 0 && empty_after != 0 &&
+		(SWH_GROUP_WIDTH - 1 - pg_leftmost_one_pos32(empty_before)) +
+		pg_rightmost_one_pos32(empty_after) < SWH_GROUP_WIDTH)
+		SH_SET_CTRL(tb, bucket, SWH_CTRL_EMPTY);
+	else
+	{
+		SH_SET_CTRL(tb, bucket, SWH_CTRL_DELETED);
+		tb->deleted++;
+	}
+}
+
+/*
+ * Initialize iterator.
+ */
+SH_SCOPE void
+SH_START_ITERATE(SH_TYPE * tb, SH_ITERATOR * iter)
+{
+	/*
+	 * Entries never move on deletion, so unlike in simplehash.h any bucket
+	 * will do as the start and end.
+	 */
+	iter->cur = tb->sizemask;
+	iter->end = iter->cur;
+	iter->done = false;
+}
+
+/*
+ * Initialize iterator to a specific bucket. That's really only useful for
+ * cases where callers are partially iterating over the hashspace, and that
+ * iteration deletes and inserts elements based on visited entries. Doing that
+ * repeatedly could lead to an unbalanced keyspace when always starting at the
+ * same position.
+ */
+SH_SCOPE void
+SH_START_ITERATE_AT(SH_TYPE * tb, SH_ITERATOR * iter, uint32 at)
+{
+	iter->cur = at & tb->sizemask;	/* ensure at is within a valid range */
+	iter->end = iter->cur;
+	iter->done = false;
+}
+
+/*
+ * Iterate over all entries in the hash-table. Return the next occupied entry,
+ * or NULL if done.
+ *
+ * During iteration entries may be deleted, without leading to elements being
+ * skipped or returned twice.  Insertions are allowed too, but if one of them
+ * grows the table, there's neither a guarantee that all nodes are visited at
+ * least once, nor a guarantee that a node is visited at most once.
+ */
+SH_SCOPE	SH_ELEMENT_TYPE *
+SH_ITERATE(SH_TYPE * tb, SH_ITERATOR * iter)
+{
+	/* validate sanity of the given iterator */
+	Assert(iter->cur < tb->size);
+	Assert(iter->end < tb->size);
+
+	while (!iter->done)
+	{
+		uint32		bucket = iter->cur;
+
+		/* next element in backward direction */
+		iter->cur = (iter->cur - 1) & tb->sizemask;
+
+		if ((iter->cur & tb->sizemask) == (iter->end & tb->sizemask))
+			iter->done = true;
+		if (SWH_IS_FULL(tb->ctrl[bucket]))
+		{
+			return &tb->data[bucket];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Estimate the amount of space needed for a hashtable with nentries entries.
+ * Return SIZE_MAX if that's too many entries.
+ *
+ * nentries is "double" because this is meant for use by the planner,
+ * which typically works with double rowcount estimates.  So we'd need to
+ * clamp to integer somewhere and that might as well be here.  We do expect
+ * the value not to be NaN or negative, else the result will be garbage.
+ */
+SH_SCOPE size_t
+SH_ESTIMATE_SPACE(double nentries)
+{
+	uint64		size;
+	uint64		space;
+
+	/* scale request by SH_FILLFACTOR, as SH_CREATE does */
+	nentries = nentries / SH_FILLFACTOR;
+
+	/* fail if we'd overrun SH_MAX_SIZE entries */
+	if (nentries >= SH_MAX_SIZE)
+		return SIZE_MAX;
+
+	/* should be safe to convert to uint64 */
+	size = (uint64) nentries;
+
+	/* a group must fit in the table */
+	size = Max(size, SWH_GROUP_WIDTH);
+
+	/* round up size to the next power of 2, that's how bucketing works */
+	size = pg_nextpower2_64(size);
+
+	/* calculate space needed for ->data and ->ctrl */
+	space = ((uint64) sizeof(SH_ELEMENT_TYPE) + 1) * size + SWH_GROUP_WIDTH;
+
+	/* verify that allocation of ->data is possible on this platform */
+	if (space >= SIZE_MAX / 2)
+		return SIZE_MAX;
+
+	return (size_t) space + sizeof(SH_TYPE);
+}
+
+/*
+ * Report some statistics about the state of the hashtable. For
+ * debugging/profiling purposes only.
+ */
+SH_SCOPE void
+SH_STAT(SH_TYPE * tb)
+{
+	uint32		max_groups = 0;
+	uint64		total_groups = 0;
+	double		avg_groups;
+	double		fillfactor;
+
+	for (uint64 i = 0; i < tb->size; i++)
+	{
+		uint32		hash;
+		uint32		pos;
+		uint32		stride = 0;
+		uint32		ngroups = 1;
+
+		if (!SWH_IS_FULL(tb->ctrl[i]))
+			continue;
+
+		/* count the groups a lookup of this element probes */
+		hash = SH_ENTRY_HASH(tb, &tb->data[i]);
+		pos = hash & tb->sizemask;
+		while (((i - pos) & tb->sizemask) >= SWH_GROUP_WIDTH)
+		{
+			stride += SWH_GROUP_WIDTH;
+			pos = (pos + stride) & tb->sizemask;
+			ngroups++;
+		}
+
+		if (ngroups > max_groups)
+			max_groups = ngroups;
+		total_groups += ngroups;
+	}
+
+	if (tb->members > 0)
+	{
+		fillfactor = (tb->members + tb->deleted) / ((double) tb->size);
+		avg_groups = ((double) total_groups) / tb->members;
+	}
+	else
+	{
+		fillfactor = 0;
+		avg_groups = 0;
+	}
+
+	sh_log("size: " UINT64_FORMAT ", members: %u, deleted: %u, filled: %f, max groups probed: %u, avg groups probed: %f",
+		   tb->size, tb->members, tb->deleted, fillfactor, max_groups, avg_groups);
+}
+
+#endif							/* SH_DEFINE */
+
+
+/* undefine external parameters, so next hash table can be defined */
+#undef SH_PREFIX
+#undef SH_KEY_TYPE
+#undef SH_KEY
+#undef SH_ELEMENT_TYPE
+#undef SH_HASH_KEY
+#undef SH_SCOPE
+#undef SH_DECLARE
+#undef SH_DEFINE
+#undef SH_GET_HASH
+#undef SH_STORE_HASH
+#undef SH_USE_NONDEFAULT_ALLOCATOR
+#undef SH_EQUAL
+
+/* undefine locally declared macros */
+#undef SH_MAKE_PREFIX
+#undef SH_MAKE_NAME
+#undef SH_MAKE_NAME_
+#undef SH_FILLFACTOR
+#undef SH_MAX_FILLFACTOR
+#undef SH_MAX_SIZE
+
+/* types */
+#undef SH_TYPE
+#undef SH_STATUS
+#undef SH_STATUS_EMPTY
+#undef SH_STATUS_IN_USE
+#undef SH_ITERATOR
+
+/* external function names */
+#undef SH_CREATE
+#undef SH_DESTROY
+#undef SH_RESET
+#undef SH_INSERT
+#undef SH_INSERT_HASH
+#undef SH_DELETE_ITEM
+#undef SH_DELETE
+#undef SH_LOOKUP
+#undef SH_LOOKUP_HASH
+#undef SH_GROW
+#undef SH_START_ITERATE
+#undef SH_START_ITERATE_AT
+#undef SH_ITERATE
+#undef SH_ALLOCATE
+#undef SH_FREE
+#undef SH_ESTIMATE_SPACE
+#undef SH_STAT
+
+/* internal function names */
+#undef SH_COMPUTE_SIZE
+#undef SH_UPDATE_PARAMETERS
+#undef SH_COMPARE_KEYS
+#undef SH_ALLOCATE_CTRL
+#undef SH_SET_CTRL
+#undef SH_FIND_FREE
+#undef SH_ENTRY_HASH
+#undef SH_INSERT_HASH_INTERNAL
+#undef SH_LOOKUP_HASH_INTERNAL
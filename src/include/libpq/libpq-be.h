@@ -18,6 +18,7 @@
 #ifndef LIBPQ_BE_H
 #define LIBPQ_BE_H
 
+#include "common/compression.h"
 #include "common/scram-common.h"
 
 #include <sys/time.h>
@@ -132,6 +133,7 @@ typedef struct Port
 	ProtocolVersion proto;		/* FE/BE protocol version */
 	SockAddr	laddr;			/* local addr (postmaster) */
 	SockAddr	raddr;			/* remote addr (client) */
+	bool		pooled;			/* connected through a connection proxy? */
 	char	   *remote_host;	/* name (or ip addr) of remote host */
 	char	   *remote_hostname;	/* name (not ip addr) of remote host, if
 									 * available */
@@ -159,6 +161,20 @@ typedef struct Port
 	 */
 	char	   *application_name;
 
+	/*
+	 * Protocol compression requested by the client in the startup packet, for
+	 * the data we send and the data we receive.  The algorithm is
+	 * PG_COMPRESSION_NONE for a direction that isn't compressed.
+	 */
+	pg_compress_specification compress_send;
+	pg_compress_specification compress_recv;
+
+	/*
+	 * Maximum number of rows per ColumnBatch message, if the client asked
+	 * for query results in column batches instead of DataRow messages, or 0.
+	 */
+	int			column_batch_rows;
+
 	/*
 	 * Information that needs to be held during the authentication cycle.
 	 */
@@ -249,6 +265,7 @@ typedef struct ClientSocket
 {
 	pgsocket	sock;			/* File descriptor */
 	SockAddr	raddr;			/* remote addr (client) */
+	bool		pooled;			/* accepted on the proxy port? */
 } ClientSocket;
 
 #ifdef USE_SSL
@@ -18,6 +18,7 @@
 
 #include "lib/stringinfo.h"
 #include "libpq/libpq-be.h"
+#include "port/pg_iovec.h"
 #include "storage/latch.h"
 
 
@@ -71,6 +72,8 @@ extern int	AcceptConnection(pgsocket server_fd, ClientSocket *client_sock);
 extern void TouchSocketFiles(void);
 extern void RemoveSocketFiles(void);
 extern Port *pq_init(ClientSocket *client_sock);
+extern pgsocket pq_switch_socket(pgsocket sock, StringInfo unread);
+extern void pq_start_compression(void);
 extern int	pq_getbytes(void *b, size_t len);
 extern void pq_startmsgread(void);
 extern void pq_endmsgread(void);
@@ -81,6 +84,8 @@ extern int	pq_peekbyte(void);
 extern int	pq_getbyte_if_available(unsigned char *c);
 extern ssize_t pq_buffer_remaining_data(void);
 extern int	pq_putmessage_v2(char msgtype, const char *s, size_t len);
+extern char *pq_reservemessage_noblock(size_t len);
+extern void pq_putreservedmessage(char msgtype, size_t len);
 extern bool pq_check_connection(void);
 
 /*
@@ -93,6 +98,7 @@ extern int	secure_open_server(Port *port);
 extern void secure_close(Port *port);
 extern ssize_t secure_read(Port *port, void *ptr, size_t len);
 extern ssize_t secure_write(Port *port, const void *ptr, size_t len);
+extern ssize_t secure_writev(Port *port, const struct iovec *iov, int iovcnt);
 extern ssize_t secure_raw_read(Port *port, void *ptr, size_t len);
 extern ssize_t secure_raw_write(Port *port, const void *ptr, size_t len);
 
@@ -114,6 +120,7 @@ extern PGDLLIMPORT char *SSLCipherSuites;
 extern PGDLLIMPORT char *SSLCipherList;
 extern PGDLLIMPORT char *SSLECDHCurve;
 extern PGDLLIMPORT bool SSLPreferServerCiphers;
+extern PGDLLIMPORT bool SSLKernelTLS;
 #ifdef USE_SSL
 extern PGDLLIMPORT bool ssl_loaded_verify_locations;
 #endif
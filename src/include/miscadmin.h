@@ -180,6 +180,7 @@ extern PGDLLIMPORT int max_worker_processes;
 extern PGDLLIMPORT int max_parallel_workers;
 
 extern PGDLLIMPORT int commit_timestamp_buffers;
+extern PGDLLIMPORT int multixact_cache_size;
 extern PGDLLIMPORT int multixact_member_buffers;
 extern PGDLLIMPORT int multixact_offset_buffers;
 extern PGDLLIMPORT int notify_buffers;
@@ -195,6 +196,7 @@ extern PGDLLIMPORT struct Latch *MyLatch;
 extern PGDLLIMPORT uint8 MyCancelKey[];
 extern PGDLLIMPORT int MyCancelKeyLength;
 extern PGDLLIMPORT int MyPMChildSlot;
+extern PGDLLIMPORT bool MySessionPinned;
 
 extern PGDLLIMPORT char OutputFileName[];
 extern PGDLLIMPORT char my_exec_path[];
@@ -434,6 +436,7 @@ extern Oid	GetCurrentRoleId(void);
 extern void SetCurrentRoleId(Oid roleid, bool is_superuser);
 extern void InitializeSystemUser(const char *authn_id,
 								 const char *auth_method);
+extern void ResetSystemUser(void);
 extern const char *GetSystemUser(void);
 
 /* in utils/misc/superuser.c */
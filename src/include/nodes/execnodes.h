@@ -42,6 +42,7 @@
 #include "storage/condition_variable.h"
 #include "utils/hsearch.h"
 #include "utils/queryenvironment.h"
+#include "utils/querymem.h"
 #include "utils/reltrigger.h"
 #include "utils/sharedtuplestore.h"
 #include "utils/snapshot.h"
@@ -145,6 +146,12 @@ typedef struct ExprState
 	 * ExecInitExprRec().
 	 */
 	ErrorSaveContext *escontext;
+
+	/*
+	 * Number of evaluations left before an interpreted expression gets JIT
+	 * compiled, or 0 if it is not to be compiled later.
+	 */
+	uint32		jit_calls_left;
 } ExprState;
 
 
@@ -545,6 +552,9 @@ typedef struct ResultRelInfo
 	TupleTableSlot **ri_Slots;	/* input tuples for batch insert */
 	TupleTableSlot **ri_PlanSlots;
 
+	/* may UPDATE batch index insertions?  see ExecUpdateEpilogue() */
+	bool		ri_BatchIndexInserts;
+
 	/* list of WithCheckOption's to be checked */
 	List	   *ri_WithCheckOptions;
 
@@ -764,6 +774,12 @@ typedef struct EState
 	struct JitContext *es_jit;
 	struct JitInstrumentation *es_jit_worker_instr;
 
+	/* Cache of detoasted values, active during ExecutorRun */
+	struct DetoastCache *es_detoast_cache;
+
+	/* State kept for reuse by the next execution of a cached plan, or NULL */
+	struct CachedExecState *es_cached_state;
+
 	/*
 	 * Lists of ResultRelInfos for foreign tables on which batch-inserts are
 	 * to be executed and owning ModifyTableStates, stored in the same order.
@@ -1006,6 +1022,8 @@ typedef struct SetExprState
  *		SubPlanState node
  * ----------------
  */
+struct subplancache_hash;
+
 typedef struct SubPlanState
 {
 	NodeTag		type;
@@ -1035,6 +1053,19 @@ typedef struct SubPlanState
 	ExprState  *lhs_hash_expr;	/* hash expr for lefthand datatype(s) */
 	FmgrInfo   *cur_eq_funcs;	/* equality functions for LHS vs. table */
 	ExprState  *cur_eq_comp;	/* equality comparator for LHS vs. table */
+	/* these are used when caching the subplan's results (useCache): */
+	struct subplancache_hash *cache;	/* results keyed by parParam values */
+	MemoryContext cacheContext; /* context holding cache and its entries */
+	NullableDatum *cacheProbe;	/* parParam values being looked up */
+	int16	   *cacheKeyLen;	/* typlen of each parParam */
+	bool	   *cacheKeyByVal;	/* typbyval of each parParam */
+	int16		cacheResultLen; /* typlen of the subplan's result */
+	bool		cacheResultByVal;	/* typbyval of the subplan's result */
+	Size		cacheMemLimit;	/* empty the cache when it grows past this */
+	Size		cacheMemPeak;	/* largest size the cache has reached */
+	uint64		cacheHits;		/* lookups that found a cached result */
+	uint64		cacheMisses;	/* lookups that had to run the subplan */
+	uint64		cacheEvictions; /* entries thrown away to save memory */
 } SubPlanState;
 
 /*
@@ -1470,6 +1501,15 @@ typedef struct ModifyTableState
 	List	   *mt_updateColnosLists;
 	List	   *mt_mergeActionLists;
 	List	   *mt_mergeJoinConditions;
+
+	/*
+	 * For UPDATE, copies of updated tuples whose index entries haven't been
+	 * inserted yet, all belonging to mt_indexBatchRel.
+	 */
+	ResultRelInfo *mt_indexBatchRel;
+	TupleTableSlot **mt_indexBatchSlots;
+	int			mt_indexBatchCount; /* number of buffered tuples */
+	int			mt_indexBatchSlotsInitialized;	/* number of slots made */
 } ModifyTableState;
 
 /* ----------------
@@ -1517,6 +1557,8 @@ struct AppendState
 	bool		as_valid_subplans_identified;	/* is as_valid_subplans valid? */
 	Bitmapset  *as_valid_subplans;
 	Bitmapset  *as_valid_asyncplans;	/* valid asynchronous plans indexes */
+	int			as_prefetch_subplans;	/* # of upcoming subplans to start
+										 * reading ahead of time */
 	bool		(*choose_next_subplan) (AppendState *);
 };
 
@@ -1543,7 +1585,7 @@ typedef struct MergeAppendState
 	int			ms_nkeys;
 	SortSupport ms_sortkeys;	/* array of length ms_nkeys */
 	TupleTableSlot **ms_slots;	/* array of length ms_nplans */
-	struct binaryheap *ms_heap; /* binary heap of slot indices */
+	struct losertree *ms_tree;	/* merge tree over slot indices */
 	bool		ms_initialized; /* are subplans started? */
 	struct PartitionPruneState *ms_prune_state;
 	Bitmapset  *ms_valid_subplans;
@@ -1626,12 +1668,31 @@ typedef struct ScanState
 
 /* ----------------
  *	 SeqScanState information
+ *
+ *		batchqual		batchable part of the qual, or NULL if not batching
+ *		batchslots		rows fetched ahead for batched qual evaluation
+ *		batchmatches	whether each of batchslots passed batchqual
+ *		batchsize		number of elements of batchslots
+ *		batchcount		number of rows currently in batchslots
+ *		batchnext		index of next row of batchslots to return
  * ----------------
  */
+struct ExprBatchQual;
+
 typedef struct SeqScanState
 {
 	ScanState	ss;				/* its first field is NodeTag */
 	Size		pscan_len;		/* size of parallel heap scan descriptor */
+	struct ExprBatchQual *batchqual;
+	TupleTableSlot **batchslots;
+	bool	   *batchmatches;
+	int			batchsize;
+	int			batchcount;
+	int			batchnext;
+	bool		batchdone;		/* table AM has returned its last batch */
+	struct HashRuntimeFilter *runtime_filter;	/* from hash join, or NULL */
+	bool		project_scan;	/* pass scan_attrs to the table AM? */
+	Bitmapset  *scan_attrs;		/* columns needed, as for pull_varattnos() */
 } SeqScanState;
 
 /* ----------------
@@ -1677,6 +1738,57 @@ typedef struct
 	bool	   *elem_nulls;		/* array of num_elems is-null flags */
 } IndexArrayKeyInfo;
 
+/*
+ * A lower bound on the first index column that the parent of an index scan
+ * can change between rescans; a merge join uses it to jump over runs of
+ * inner tuples that can't match.  See ExecIndexAddLowerBound().
+ */
+typedef struct
+{
+	ScanKeyData *scan_key;		/* scankey to put value into */
+	FmgrInfo	finfo;			/* ">=" comparison function */
+	Oid			subtype;		/* datatype of the bound */
+	Oid			collation;		/* collation of the comparison */
+	int16		typlen;			/* typlen of subtype */
+	bool		typbyval;		/* typbyval of subtype */
+	Datum		value;			/* current bound, if any; copied */
+	bool		isset;			/* has a bound been set? */
+	MemoryContext context;		/* where to keep the copy of the bound */
+} IndexLowerBound;
+
+/*
+ * Which part of the first index column a loose index scan is visiting:
+ * the nulls, the non-null values, or neither because both are done.
+ */
+typedef enum IndexSkipPhase
+{
+	INDEX_SKIP_NULLS,
+	INDEX_SKIP_VALUES,
+	INDEX_SKIP_DONE,
+} IndexSkipPhase;
+
+/*
+ * State of a loose index scan, which returns only the first visible entry
+ * for each distinct value of the first index column and then restarts the
+ * scan just past that value.  See ExecIndexAddSkipKey().
+ */
+typedef struct
+{
+	ScanKeyData *scan_key;		/* scankey to put value into */
+	FmgrInfo	finfo;			/* ">" (or "<" if DESC) comparison function */
+	StrategyNumber strategy;	/* strategy of finfo's operator */
+	Oid			subtype;		/* datatype of the column */
+	Oid			collation;		/* collation of the comparison */
+	int16		typlen;			/* typlen of subtype */
+	bool		typbyval;		/* typbyval of subtype */
+	bool		nulls_first;	/* do nulls sort before values? */
+	IndexSkipPhase phase;		/* what we're scanning now */
+	Datum		value;			/* last value returned, if any; copied */
+	bool		isset;			/* is value valid? */
+	bool		restart;		/* must index be rescanned before fetching? */
+	MemoryContext context;		/* where to keep the copy of the value */
+} IndexSkipKey;
+
 /* ----------------
  *	 IndexScanState information
  *
@@ -1694,6 +1806,9 @@ typedef struct
  *		ScanDesc		   index scan descriptor
  *		Instrument		   local index scan instrumentation
  *		SharedInfo		   parallel worker instrumentation (no leader entry)
+ *		PrefetchDistance   # of TIDs to read ahead for heap prefetching
+ *		LowerBound		   bound on first column set by parent, or NULL
+ *		SkipKey			   loose index scan state, or NULL
  *
  *		ReorderQueue	   tuples that need reordering due to re-check
  *		ReachedEnd		   have we fetched all tuples from index already?
@@ -1722,6 +1837,9 @@ typedef struct IndexScanState
 	struct IndexScanDescData *iss_ScanDesc;
 	IndexScanInstrumentation iss_Instrument;
 	SharedIndexScanInstrumentation *iss_SharedInfo;
+	int			iss_PrefetchDistance;
+	IndexLowerBound *iss_LowerBound;
+	IndexSkipKey *iss_SkipKey;
 
 	/* These are needed for re-checking ORDER BY expr ordering */
 	pairingheap *iss_ReorderQueue;
@@ -1750,8 +1868,11 @@ typedef struct IndexScanState
  *		ScanDesc		   index scan descriptor
  *		Instrument		   local index scan instrumentation
  *		SharedInfo		   parallel worker instrumentation (no leader entry)
+ *		LowerBound		   bound on first column set by parent, or NULL
+ *		SkipKey			   loose index scan state, or NULL
  *		TableSlot		   slot for holding tuples fetched from the table
  *		VMBuffer		   buffer in use for visibility map testing, if any
+ *		PrefetchDistance   # of TIDs to read ahead for heap prefetching
  *		PscanLen		   size of parallel index-only scan descriptor
  *		NameCStringAttNums attnums of name typed columns to pad to NAMEDATALEN
  *		NameCStringCount   number of elements in the NameCStringAttNums array
@@ -1773,8 +1894,11 @@ typedef struct IndexOnlyScanState
 	struct IndexScanDescData *ioss_ScanDesc;
 	IndexScanInstrumentation ioss_Instrument;
 	SharedIndexScanInstrumentation *ioss_SharedInfo;
+	IndexLowerBound *ioss_LowerBound;
+	IndexSkipKey *ioss_SkipKey;
 	TupleTableSlot *ioss_TableSlot;
 	Buffer		ioss_VMBuffer;
+	int			ioss_PrefetchDistance;
 	Size		ioss_PscanLen;
 	AttrNumber *ioss_NameCStringAttNums;
 	int			ioss_NameCStringCount;
@@ -1796,6 +1920,8 @@ typedef struct IndexOnlyScanState
  *		ScanDesc		   index scan descriptor
  *		Instrument		   local index scan instrumentation
  *		SharedInfo		   parallel worker instrumentation (no leader entry)
+ *		ParallelBuild	   true if participants share the index scan
+ *		PscanLen		   size of parallel index scan descriptor
  * ----------------
  */
 typedef struct BitmapIndexScanState
@@ -1814,6 +1940,8 @@ typedef struct BitmapIndexScanState
 	struct IndexScanDescData *biss_ScanDesc;
 	IndexScanInstrumentation biss_Instrument;
 	SharedIndexScanInstrumentation *biss_SharedInfo;
+	bool		biss_ParallelBuild;
+	Size		biss_PscanLen;
 } BitmapIndexScanState;
 
 /* ----------------
@@ -1836,6 +1964,8 @@ typedef struct BitmapHeapScanInstrumentation
  *						to see this state will set the state to BM_INPROGRESS
  *						and that process will be responsible for creating
  *						TIDBitmap.
+ *		BM_BUILDING		Participants are building TIDBitmaps from their share
+ *						of the index scan; workers that see this join in.
  *		BM_INPROGRESS	TIDBitmap creation is in progress; workers need to
  *						sleep until it's finished.
  *		BM_FINISHED		TIDBitmap creation is done, so now all workers can
@@ -1845,6 +1975,7 @@ typedef struct BitmapHeapScanInstrumentation
 typedef enum
 {
 	BM_INITIAL,
+	BM_BUILDING,
 	BM_INPROGRESS,
 	BM_FINISHED,
 } SharedBitmapState;
@@ -1854,6 +1985,8 @@ typedef enum
  *		tbmiterator				iterator for scanning current pages
  *		mutex					mutual exclusion for state
  *		state					current state of the TIDBitmap
+ *		nbuilders				# of participants still building a bitmap
+ *		partial					bitmap built by a participant, to be merged
  *		cv						conditional wait variable
  * ----------------
  */
@@ -1862,6 +1995,8 @@ typedef struct ParallelBitmapHeapState
 	dsa_pointer tbmiterator;
 	slock_t		mutex;
 	SharedBitmapState state;
+	int			nbuilders;
+	dsa_pointer partial;
 	ConditionVariable cv;
 } ParallelBitmapHeapState;
 
@@ -1889,6 +2024,7 @@ typedef struct SharedBitmapHeapInstrumentation
  *		pstate			   shared state for parallel bitmap scan
  *		sinstrument		   statistics for parallel workers
  *		recheck			   do current page's tuples need recheck
+ *		parallel_build	   do all participants build the bitmap
  * ----------------
  */
 typedef struct BitmapHeapScanState
@@ -1901,6 +2037,7 @@ typedef struct BitmapHeapScanState
 	ParallelBitmapHeapState *pstate;
 	SharedBitmapHeapInstrumentation *sinstrument;
 	bool		recheck;
+	bool		parallel_build;
 } BitmapHeapScanState;
 
 /* ----------------
@@ -2063,6 +2200,8 @@ typedef struct CteScanState
 	int			eflags;			/* capability flags to pass to tuplestore */
 	int			readptr;		/* index of my tuplestore read pointer */
 	PlanState  *cteplanstate;	/* PlanState for the CTE query itself */
+	/* Shared copy of the CTE's rows, if this is a parallel-aware scan */
+	SharedTuplestoreAccessor *sts;
 	/* Link to the "leader" CteScanState (possibly this same node) */
 	struct CteScanState *leader;
 	/* The remaining fields are only valid in the "leader" CteScanState */
@@ -2171,14 +2310,25 @@ typedef struct JoinState
  *		NeedNewOuter	   true if need new outer tuple on next call
  *		MatchedOuter	   true if found a join match for current outer tuple
  *		NullInnerTupleSlot prepared null tuple for left outer joins
+ *		Hash			   state for switching to hashing, NULL if not adaptive
+ *		OuterRows		   outer tuples fetched in the current scan
+ *		SwitchedAfter	   outer tuples fetched before first switching to
+ *						   hashing, or 0 if we never did
+ *		HashFailed		   true if the hash table exceeded the memory limit
  * ----------------
  */
+struct NestLoopHashData;
+
 typedef struct NestLoopState
 {
 	JoinState	js;				/* its first field is NodeTag */
 	bool		nl_NeedNewOuter;
 	bool		nl_MatchedOuter;
 	TupleTableSlot *nl_NullInnerTupleSlot;
+	struct NestLoopHashData *nl_Hash;
+	uint64		nl_OuterRows;
+	uint64		nl_SwitchedAfter;
+	bool		nl_HashFailed;
 } NestLoopState;
 
 /* ----------------
@@ -2201,6 +2351,8 @@ typedef struct NestLoopState
  *		NullInnerTupleSlot prepared null tuple for left outer joins
  *		OuterEContext	   workspace for computing outer tuple's join values
  *		InnerEContext	   workspace for computing inner tuple's join values
+ *		InnerBound		   true if inner index scan can skip ahead to a key
+ *		InnerSkipCount	   # of inner tuples skipped since last match
  * ----------------
  */
 /* private in nodeMergejoin.c: */
@@ -2226,6 +2378,8 @@ typedef struct MergeJoinState
 	TupleTableSlot *mj_NullInnerTupleSlot;
 	ExprContext *mj_OuterEContext;
 	ExprContext *mj_InnerEContext;
+	bool		mj_InnerBound;
+	int			mj_InnerSkipCount;
 } MergeJoinState;
 
 /* ----------------
@@ -2276,6 +2430,13 @@ typedef struct HashJoinState
 	int			hj_JoinState;
 	bool		hj_MatchedOuter;
 	bool		hj_OuterNotEmpty;
+	TupleTableSlot **hj_OuterBatchSlots;	/* outer tuples fetched ahead */
+	uint32	   *hj_OuterBatchHashes;	/* their hash values */
+	uint64	   *hj_OuterBatchKeys;	/* workspace for sorting them */
+	TupleTableSlot **hj_OuterBatchSorted;	/* workspace for sorting them */
+	int			hj_OuterBatchSize;	/* 0 if not fetching ahead */
+	int			hj_OuterBatchCount; /* number of tuples fetched ahead */
+	int			hj_OuterBatchNext;	/* next of them to return */
 } HashJoinState;
 
 
@@ -2304,6 +2465,8 @@ typedef struct MaterialState
 struct MemoizeEntry;
 struct MemoizeTuple;
 struct MemoizeKey;
+struct SharedMemoizeCache;
+struct dshash_table;
 
 typedef struct MemoizeInstrumentation
 {
@@ -2318,6 +2481,9 @@ typedef struct MemoizeInstrumentation
 									 * able to free enough space to store the
 									 * current scan's tuples. */
 	uint64		mem_peak;		/* peak memory usage in bytes */
+	uint64		shared_hits;	/* number of cache misses where the tuples
+								 * were found in the cache shared with the
+								 * other parallel participants */
 } MemoizeInstrumentation;
 
 /* ----------------
@@ -2327,6 +2493,8 @@ typedef struct MemoizeInstrumentation
 typedef struct SharedMemoizeInfo
 {
 	int			num_workers;
+	dsa_pointer shared_cache;	/* SharedMemoizeCache in the query's DSA
+								 * area, or InvalidDsaPointer */
 	MemoizeInstrumentation sinstrument[FLEXIBLE_ARRAY_MEMBER];
 } SharedMemoizeInfo;
 
@@ -2369,6 +2537,13 @@ typedef struct MemoizeState
 	SharedMemoizeInfo *shared_info; /* statistics for parallel workers */
 	Bitmapset  *keyparamids;	/* Param->paramids of expressions belonging to
 								 * param_exprs */
+	struct dsa_area *shared_area;	/* DSA area holding shared_cache */
+	struct SharedMemoizeCache *shared_cache;	/* cache shared by all parallel
+												 * participants, or NULL */
+	struct dshash_table *shared_table;	/* shared_cache's hash table */
+	MinimalTuple shared_tuple;	/* last tuple returned from shared_cache */
+	int			shared_remaining;	/* tuples left to return from
+									 * shared_cache */
 } MemoizeState;
 
 /* ----------------
@@ -2392,6 +2567,8 @@ typedef struct PresortedKeyData
 typedef struct SharedSortInfo
 {
 	int			num_workers;
+	Size		parallel_offset;	/* offset of ParallelSortShared for a
+									 * parallel-aware sort, or 0 */
 	TuplesortInstrumentation sinstrument[FLEXIBLE_ARRAY_MEMBER];
 } SharedSortInfo;
 
@@ -2412,6 +2589,10 @@ typedef struct SortState
 	bool		am_worker;		/* are we a worker? */
 	bool		datumSort;		/* Datum sort instead of tuple sort? */
 	SharedSortInfo *shared_info;	/* one entry per worker */
+	struct ParallelSortShared *pshared; /* state shared by participants of a
+										 * parallel-aware sort, or NULL */
+	struct Sharedsort *sharedsort;	/* tuplesort's part of pshared */
+	struct ParallelContext *pcxt;	/* leader's parallel context */
 } SortState;
 
 /* ----------------
@@ -2587,6 +2768,8 @@ typedef struct AggState
 									 * and we must not create new groups */
 	Size		hash_mem_limit; /* limit before spilling hash table */
 	uint64		hash_ngroups_limit; /* limit before spilling hash table */
+	MemoryGrant hash_mem_grant; /* hash table memory reserved from the query
+								 * memory budget */
 	int			hash_planned_partitions;	/* number of partitions planned
 											 * for first pass */
 	double		hashentrysize;	/* estimate revised during execution */
@@ -2605,6 +2788,14 @@ typedef struct AggState
 	AggStatePerGroup *all_pergroups;	/* array of first ->pergroups, than
 										 * ->hash_pergroup */
 	SharedAggInfo *shared_info; /* one entry per worker */
+
+	/* these fields are used by partial aggregation in AGG_HASHED mode: */
+	bool		hash_flush_mode;	/* we hit a limit during the current pass
+									 * and must emit the groups before reading
+									 * more input */
+	bool		hash_ever_flushed;	/* ever flushed during this execution? */
+	uint64		hash_ntuples_current;	/* input tuples absorbed by the groups
+										 * currently in memory */
 } AggState;
 
 /* ----------------
@@ -2732,6 +2923,19 @@ typedef struct UniqueState
 	ExprState  *eqfunction;		/* tuple equality qual */
 } UniqueState;
 
+/* ----------------
+ * What the parallel workers of a Gather do with the tuples they produce.
+ * Normally they send them to the leader, but the leader's DestReceiver can
+ * arrange for them to do its job themselves; see ExecGatherSetWorkerDest().
+ * ----------------
+ */
+typedef enum ParallelDestKind
+{
+	PARALLEL_DEST_TUPLES,		/* send tuples to the leader */
+	PARALLEL_DEST_INTOREL,		/* insert into a relation, send nothing */
+	PARALLEL_DEST_COPY,			/* send them as formatted COPY TO rows */
+} ParallelDestKind;
+
 /* ----------------
  * GatherState information
  *
@@ -2747,6 +2951,8 @@ typedef struct GatherState
 	int64		tuples_needed;	/* tuple bound, see ExecSetTupleBound */
 	/* these fields are set up once: */
 	TupleTableSlot *funnel_slot;
+	ParallelDestKind worker_dest;	/* what workers do with their tuples */
+	Node	   *worker_dest_info;	/* details for worker_dest, if any */
 	struct ParallelExecutorInfo *pei;
 	/* all remaining fields are reinitialized during a rescan: */
 	int			nworkers_launched;	/* original number of workers */
@@ -2784,7 +2990,7 @@ typedef struct GatherMergeState
 	TupleTableSlot **gm_slots;	/* array with nreaders+1 entries */
 	struct TupleQueueReader **reader;	/* array with nreaders active entries */
 	struct GMReaderTupleBuffer *gm_tuple_buffers;	/* nreaders tuple buffers */
-	struct binaryheap *gm_heap; /* binary heap of slot indices */
+	struct losertree *gm_tree;	/* merge tree over slot indices */
 } GatherMergeState;
 
 /* ----------------
@@ -2810,6 +3016,23 @@ typedef struct SharedHashInfo
 	HashInstrumentation hinstrument[FLEXIBLE_ARRAY_MEMBER];
 } SharedHashInfo;
 
+/* ----------------
+ *	 HashRuntimeFilter information
+ *
+ *		A Bloom filter over the join hash values of a Hash node's input,
+ *		which the hash join pushes down into its outer scan so that rows
+ *		that cannot find a match are discarded before reaching the join.
+ *		filter is NULL while the hash table is not built; hashexpr computes
+ *		the same hash value as the join's outer hash expression, but over
+ *		the scan tuple.
+ * ----------------
+ */
+typedef struct HashRuntimeFilter
+{
+	struct bloom_filter *filter;	/* filter, or NULL if not built yet */
+	ExprState  *hashexpr;		/* hash value of a scan tuple */
+} HashRuntimeFilter;
+
 /* ----------------
  *	 HashState information
  * ----------------
@@ -2840,6 +3063,9 @@ typedef struct HashState
 
 	/* Parallel hash state. */
 	struct ParallelHashJoinState *parallel_state;
+
+	/* Bloom filter to fill for the outer scan, or NULL */
+	HashRuntimeFilter *runtime_filter;
 } HashState;
 
 /* ----------------
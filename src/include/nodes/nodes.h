@@ -220,6 +220,12 @@ extern int *readIntCols(int numCols);
 extern Oid *readOidCols(int numCols);
 extern int16 *readAttrNumberCols(int numCols);
 
+/*
+ * nodes/binfuncs.c
+ */
+extern char *nodeToBinary(const void *obj, Size *len);
+extern void *binaryToNode(const char *data, Size len);
+
 /*
  * nodes/copyfuncs.c
  */
@@ -1946,6 +1946,10 @@ typedef struct Path
  *		BackwardScanDirection: backward scan of an ordered index
  * Unordered indexes will always have an indexscandir of ForwardScanDirection.
  *
+ * 'indexskipdistinct' is true for a loose index scan, which returns only the
+ * first visible tuple for each distinct value of the first index column.
+ * Such paths are made only for DISTINCT and GROUP BY; see planner.c.
+ *
  * 'indextotalcost' and 'indexselectivity' are saved in the IndexPath so that
  * we need not recompute them when considering using the same index in a
  * bitmap index/heap scan (see BitmapHeapPath).  The costs of the IndexPath
@@ -1960,6 +1964,7 @@ typedef struct IndexPath
 	List	   *indexorderbys;
 	List	   *indexorderbycols;
 	ScanDirection indexscandir;
+	bool		indexskipdistinct;
 	Cost		indextotalcost;
 	Selectivity indexselectivity;
 } IndexPath;
@@ -2218,6 +2223,20 @@ typedef struct GroupResultPath
 	List	   *quals;
 } GroupResultPath;
 
+/*
+ * FilterPath represents use of a Result plan node to filter the rows
+ * returned by its input path, without projecting them.  The quals may only
+ * reference expressions computed by the input path's target.
+ *
+ * Note that quals is a list of bare clauses, not RestrictInfos.
+ */
+typedef struct FilterPath
+{
+	Path		path;
+	Path	   *subpath;		/* path representing input source */
+	List	   *quals;
+} FilterPath;
+
 /*
  * MaterialPath represents use of a Material plan node, i.e., caching of
  * the output of its subpath.  This is used when the subpath is expensive
@@ -2525,6 +2544,7 @@ typedef struct GroupingSetsPath
 	Path		path;
 	Path	   *subpath;		/* path representing input source */
 	AggStrategy aggstrategy;	/* basic strategy */
+	AggSplit	aggsplit;		/* agg-splitting mode, see nodes.h */
 	List	   *rollups;		/* list of RollupData */
 	List	   *qual;			/* quals (HAVING quals), if any */
 	uint64		transitionSpace;	/* for pass-by-ref transition data */
@@ -3354,6 +3374,15 @@ typedef struct MinMaxAggInfo
 
 	/* param for subplan's output */
 	Param	   *param;
+
+	/*
+	 * If the subquery is restricted to rows below a bound obtained from a
+	 * BRIN index (see planagg.c), the unrestricted subquery to fall back on
+	 * when it comes up empty, and the param for its output; else NULL.
+	 */
+	PlannerInfo *fbsubroot pg_node_attr(read_write_ignore);
+	Path	   *fbpath;
+	Param	   *fbparam;
 } MinMaxAggInfo;
 
 /*
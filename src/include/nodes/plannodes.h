@@ -376,6 +376,8 @@ typedef struct ModifyTable
 	List	   *mergeActionLists;
 	/* per-target-table join conditions for MERGE */
 	List	   *mergeJoinConditions;
+	/* may an UPDATE batch its index insertions? */
+	bool		batchIndexInserts;
 } ModifyTable;
 
 struct PartitionPruneInfo;		/* forward reference to struct below */
@@ -578,6 +580,10 @@ typedef struct SampleScan
  *
  * indexorderdir specifies the scan ordering, for indexscans on amcanorder
  * indexes (for other indexes it should be "don't care").
+ *
+ * indexskipdistinct requests a loose index scan, which returns only the
+ * first row for each distinct value of the first index column.  The planner
+ * only sets it when the parent node needs nothing more than that.
  * ----------------
  */
 typedef struct IndexScan
@@ -597,6 +603,8 @@ typedef struct IndexScan
 	List	   *indexorderbyops;
 	/* forward or backward or don't care */
 	ScanDirection indexorderdir;
+	/* return one row per distinct first column? */
+	bool		indexskipdistinct;
 } IndexScan;
 
 /* ----------------
@@ -645,6 +653,8 @@ typedef struct IndexOnlyScan
 	List	   *indextlist;
 	/* forward or backward or don't care */
 	ScanDirection indexorderdir;
+	/* return one row per distinct first column? */
+	bool		indexskipdistinct;
 } IndexOnlyScan;
 
 /* ----------------
@@ -980,6 +990,11 @@ typedef struct Join
  * Vars, but perhaps someday that'd be worth relaxing.  (Note: during plan
  * creation, the paramval can actually be a PlaceHolderVar expression; but it
  * must be a Var with varno OUTER_VAR by the time it gets to the executor.)
+ *
+ * If adaptiveHashClauses is not NIL, the join switches to building a hash
+ * table over the inner side once more than adaptiveSwitchRows outer rows
+ * have been fetched.  Each clause is a hashjoinable "outer op inner"
+ * OpExpr taken from the joinqual, and there are no nestParams.
  * ----------------
  */
 typedef struct NestLoop
@@ -987,6 +1002,10 @@ typedef struct NestLoop
 	Join		join;
 	/* list of NestLoopParam nodes */
 	List	   *nestParams;
+	/* hashable join clauses, or NIL if not adaptive */
+	List	   *adaptiveHashClauses;
+	/* number of outer rows after which to switch to hashing */
+	Cardinality adaptiveSwitchRows;
 } NestLoop;
 
 typedef struct NestLoopParam
@@ -169,6 +169,7 @@ typedef struct IntoClause
 	/* materialized view's SELECT query */
 	struct Query *viewQuery pg_node_attr(query_jumble_ignore);
 	bool		skipData;		/* true for WITH NO DATA */
+	bool		incremental;	/* maintain matview incrementally? */
 } IntoClause;
 
 
@@ -1084,6 +1085,10 @@ typedef struct SubLink
  * output column position.  (parParam and setParam are integer Lists, not
  * Bitmapsets, because their ordering is significant.)
  *
+ * If useCache is true, the executor remembers the subplan's result for each
+ * distinct set of parParam values it has seen; this is only done for
+ * correlated EXISTS, EXPR and ARRAY sublinks without volatile functions.
+ *
  * Also, the planner computes startup and per-call costs for use of the
  * SubPlan.  Note that these include the cost of the subquery proper,
  * evaluation of the testexpr if any, and any hashtable management overhead.
@@ -1116,6 +1121,7 @@ typedef struct SubPlan
 								 * simpler handling of null values */
 	bool		parallel_safe;	/* is the subplan parallel-safe? */
 	/* Note: parallel_safe does not consider contents of testexpr or args */
+	bool		useCache;		/* true to cache results by parParam values */
 	/* Information for passing params into and out of the subselect: */
 	/* setParam and parParam are lists of integers (param IDs) */
 	List	   *setParam;		/* initplan and MULTIEXPR subqueries have to
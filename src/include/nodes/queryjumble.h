@@ -89,9 +89,11 @@ enum ComputeQueryIdType
 /* GUC parameters */
 extern PGDLLIMPORT int compute_query_id;
 
+struct PlannedStmt;
 
 extern const char *CleanQuerytext(const char *query, int *location, int *len);
 extern JumbleState *JumbleQuery(Query *query);
+extern int64 JumblePlan(struct PlannedStmt *pstmt);
 extern void EnableQueryId(void);
 
 extern PGDLLIMPORT bool query_id_enabled;
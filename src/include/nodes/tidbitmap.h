@@ -90,6 +90,7 @@ extern void tbm_add_tuples(TIDBitmap *tbm,
 extern void tbm_add_page(TIDBitmap *tbm, BlockNumber pageno);
 
 extern void tbm_union(TIDBitmap *a, const TIDBitmap *b);
+extern void tbm_union_shared(TIDBitmap *a, dsa_area *dsa, dsa_pointer dp);
 extern void tbm_intersect(TIDBitmap *a, const TIDBitmap *b);
 
 extern int	tbm_extract_page_tuple(TBMIterateResult *iteritem,
@@ -115,6 +115,7 @@ extern Expr *expression_planner_with_deps(Expr *expr,
 
 extern bool plan_cluster_use_sort(Oid tableOid, Oid indexOid);
 extern int	plan_create_index_workers(Oid tableOid, Oid indexOid);
+extern int	plan_rewrite_table_workers(Oid tableOid);
 
 /* in plan/setrefs.c: */
 
@@ -35,6 +35,7 @@ extern RelOptInfo *query_planner(PlannerInfo *root,
  * prototypes for plan/planagg.c
  */
 extern void preprocess_minmax_aggregates(PlannerInfo *root);
+extern Oid	fetch_agg_sort_op(Oid aggfnoid);
 
 /*
  * prototypes for plan/createplan.c
@@ -126,8 +127,8 @@ extern List *remove_useless_self_joins(PlannerInfo *root, List *joinlist);
  */
 extern Plan *set_plan_references(PlannerInfo *root, Plan *plan);
 extern bool trivial_subqueryscan(SubqueryScan *plan);
-extern Param *find_minmax_agg_replacement_param(PlannerInfo *root,
-												Aggref *aggref);
+extern Expr *find_minmax_agg_replacement(PlannerInfo *root,
+										 Aggref *aggref);
 extern void record_plan_function_dependency(PlannerInfo *root, Oid funcid);
 extern void record_plan_type_dependency(PlannerInfo *root, Oid typid);
 extern bool extract_query_dependencies_walker(Node *node, PlannerInfo *context);
@@ -214,7 +214,7 @@ typedef struct PgStat_TableXactStatus
  * ------------------------------------------------------------
  */
 
-#define PGSTAT_FILE_FORMAT_ID	0x01A5BCBB
+#define PGSTAT_FILE_FORMAT_ID	0x01A5BCC0
 
 typedef struct PgStat_ArchiverStats
 {
@@ -336,10 +336,23 @@ typedef struct PgStat_PendingIO
 	instr_time	pending_times[IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES][IOOP_NUM_TYPES];
 } PgStat_PendingIO;
 
+/*
+ * Latency histograms of timed IO operations.  Bucket 0 counts operations
+ * that took less than 8 microseconds, bucket i > 0 those that took between
+ * 2^(i+2) and 2^(i+3) microseconds, and the last bucket everything longer.
+ */
+#define PGSTAT_IO_HIST_BUCKETS	20
+
+typedef struct PgStat_BktypeIOHist
+{
+	PgStat_Counter buckets[IOOBJECT_NUM_TYPES][IOCONTEXT_NUM_TYPES][IOOP_NUM_TYPES][PGSTAT_IO_HIST_BUCKETS];
+} PgStat_BktypeIOHist;
+
 typedef struct PgStat_IO
 {
 	TimestampTz stat_reset_timestamp;
 	PgStat_BktypeIO stats[BACKEND_NUM_TYPES];
+	PgStat_BktypeIOHist hist[BACKEND_NUM_TYPES];
 } PgStat_IO;
 
 typedef struct PgStat_StatDBEntry
@@ -376,6 +389,8 @@ typedef struct PgStat_StatDBEntry
 	PgStat_Counter sessions_killed;
 	PgStat_Counter parallel_workers_to_launch;
 	PgStat_Counter parallel_workers_launched;
+	PgStat_Counter warm_backend_hits;
+	PgStat_Counter warm_backend_misses;
 
 	TimestampTz stat_reset_timestamp;
 } PgStat_StatDBEntry;
@@ -394,6 +409,7 @@ typedef struct PgStat_StatReplSlotEntry
 	PgStat_Counter spill_txns;
 	PgStat_Counter spill_count;
 	PgStat_Counter spill_bytes;
+	PgStat_Counter spill_compressed_bytes;
 	PgStat_Counter stream_txns;
 	PgStat_Counter stream_count;
 	PgStat_Counter stream_bytes;
@@ -405,6 +421,14 @@ typedef struct PgStat_StatReplSlotEntry
 	TimestampTz stat_reset_timestamp;
 } PgStat_StatReplSlotEntry;
 
+typedef struct PgStat_LWLockStats
+{
+	PgStat_Counter acquisitions;
+	PgStat_Counter waits;
+	PgStat_Counter wait_time;	/* time in microseconds */
+	PgStat_Counter spin_delays;
+} PgStat_LWLockStats;
+
 typedef struct PgStat_SLRUStats
 {
 	PgStat_Counter blocks_zeroed;
@@ -414,6 +438,7 @@ typedef struct PgStat_SLRUStats
 	PgStat_Counter blocks_exists;
 	PgStat_Counter flush;
 	PgStat_Counter truncate;
+	PgStat_Counter overflowed_snapshot;
 	TimestampTz stat_reset_timestamp;
 } PgStat_SLRUStats;
 
@@ -480,6 +505,8 @@ typedef struct PgStat_WalCounters
 	uint64		wal_bytes;
 	uint64		wal_fpi_bytes;
 	PgStat_Counter wal_buffers_full;
+	PgStat_Counter commit_delays;
+	PgStat_Counter commit_delay_time;	/* times in microseconds */
 } PgStat_WalCounters;
 
 /* -------
@@ -606,6 +633,8 @@ extern void pgstat_count_io_op_time(IOObject io_object, IOContext io_context,
 extern PgStat_IO *pgstat_fetch_stat_io(void);
 extern const char *pgstat_get_io_context_name(IOContext io_context);
 extern const char *pgstat_get_io_object_name(IOObject io_object);
+extern const char *pgstat_get_io_op_name(IOOp io_op);
+extern uint64 pgstat_get_io_hist_bucket_bound(int bucket);
 
 extern bool pgstat_tracks_io_bktype(BackendType bktype);
 extern bool pgstat_tracks_io_object(BackendType bktype,
@@ -657,6 +686,15 @@ extern PgStat_StatFuncEntry *pgstat_fetch_stat_funcentry(Oid func_id);
 extern PgStat_FunctionCounts *find_funcstat_entry(Oid func_id);
 
 
+/*
+ * Functions in pgstat_lwlock.c
+ */
+
+extern void pgstat_count_lwlock_wait(int tranche_id, instr_time wait_start);
+extern void pgstat_count_lwlock_spin_delays(int tranche_id, int delays);
+extern PgStat_LWLockStats *pgstat_fetch_lwlock(TimestampTz *stat_reset_timestamp);
+
+
 /*
  * Functions in pgstat_relation.c
  */
@@ -766,6 +804,7 @@ extern void pgstat_count_slru_blocks_written(int slru_idx);
 extern void pgstat_count_slru_blocks_exists(int slru_idx);
 extern void pgstat_count_slru_flush(int slru_idx);
 extern void pgstat_count_slru_truncate(int slru_idx);
+extern void pgstat_count_slru_overflowed_snapshot(int slru_idx);
 extern const char *pgstat_get_slru_name(int slru_idx);
 extern int	pgstat_get_slru_index(const char *name);
 extern PgStat_SLRUStats *pgstat_fetch_slru(void);
@@ -851,4 +890,12 @@ extern PGDLLIMPORT PgStat_Counter pgStatTransactionIdleTime;
 /* updated by the traffic cop and in errfinish() */
 extern PGDLLIMPORT SessionEndType pgStatSessionEndCause;
 
+
+/*
+ * Variables in pgstat_lwlock.c
+ */
+
+/* Acquisitions, indexed by tranche ID, are counted directly by lwlock.c */
+extern PGDLLIMPORT PgStat_LWLockStats PendingLWLockStats[];
+
 #endif							/* PGSTAT_H */
@@ -5,7 +5,9 @@
  *
  * This file provides an abstraction layer to hide portability issues in
  * interval timing.  On Unix we use clock_gettime(), and on Windows we use
- * QueryPerformanceCounter().  These macros also give some breathing room to
+ * QueryPerformanceCounter().  On x86-64, programs that call
+ * pg_initialize_timing() at startup read the CPU's time stamp counter
+ * instead, if it is reliable.  These macros also give some breathing room to
  * use other high-precision-timing APIs.
  *
  * The basic data type is instr_time, which all callers should treat as an
@@ -78,6 +80,9 @@ typedef struct instr_time
 #define NS_PER_MS	INT64CONST(1000000)
 #define NS_PER_US	INT64CONST(1000)
 
+/* choose the fastest reliable clock source; see src/common/instr_time.c */
+extern void pg_initialize_timing(void);
+
 
 #ifndef WIN32
 
@@ -119,11 +124,78 @@ pg_clock_gettime_ns(void)
 	return now;
 }
 
+/*
+ * Even when clock_gettime() is implemented in the vDSO, reading the time
+ * stamp counter is several times cheaper, and under some hypervisors
+ * clock_gettime() is a real system call.  That matters for EXPLAIN ANALYZE,
+ * which reads the clock twice per row and plan node.  So on x86-64,
+ * pg_initialize_timing() sets pg_timing_use_tsc if the TSC runs at a constant
+ * rate, the kernel uses it as its own clock source, and we know its
+ * frequency.  In that case the ticks are TSC cycles instead of nanoseconds.
+ */
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__INTEL_COMPILER))
+#define PG_INSTR_TSC 1
+#endif
+
+#ifdef PG_INSTR_TSC
+
+extern PGDLLIMPORT bool pg_timing_use_tsc;
+extern PGDLLIMPORT int64 pg_tsc_frequency;	/* TSC ticks per second */
+
+/*
+ * RDTSCP, unlike RDTSC, waits for all earlier instructions to complete, so
+ * it can't be reordered before the code being timed.
+ */
+static inline int64
+pg_rdtscp(void)
+{
+	uint32		lo,
+				hi,
+				aux;
+
+	__asm__ __volatile__("rdtscp" : "=a"(lo), "=d"(hi), "=c"(aux));
+
+	return ((int64) hi << 32) | lo;
+}
+
+#endif							/* PG_INSTR_TSC */
+
+/* helper for INSTR_TIME_SET_CURRENT */
+static inline instr_time
+pg_get_ticks(void)
+{
+#ifdef PG_INSTR_TSC
+	if (pg_timing_use_tsc)
+	{
+		instr_time	now;
+
+		now.ticks = pg_rdtscp();
+		return now;
+	}
+#endif
+
+	return pg_clock_gettime_ns();
+}
+
+/* helper for INSTR_TIME_GET_NANOSEC */
+static inline int64
+pg_ticks_to_ns(int64 ticks)
+{
+#ifdef PG_INSTR_TSC
+	/* split the division to avoid overflow; the frequency is below 2^33 */
+	if (pg_timing_use_tsc)
+		return (ticks / pg_tsc_frequency) * NS_PER_S +
+			(ticks % pg_tsc_frequency) * NS_PER_S / pg_tsc_frequency;
+#endif
+
+	return ticks;
+}
+
 #define INSTR_TIME_SET_CURRENT(t) \
-	((t) = pg_clock_gettime_ns())
+	((t) = pg_get_ticks())
 
 #define INSTR_TIME_GET_NANOSEC(t) \
-	((int64) (t).ticks)
+	pg_ticks_to_ns((t).ticks)
 
 
 #else							/* WIN32 */
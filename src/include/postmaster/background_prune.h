@@ -0,0 +1,31 @@
+/*-------------------------------------------------------------------------
+ *
+ * background_prune.h
+ *	  Background pruning of recently modified heap pages.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ *
+ * src/include/postmaster/background_prune.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef BACKGROUND_PRUNE_H
+#define BACKGROUND_PRUNE_H
+
+#include "storage/block.h"
+#include "utils/relcache.h"
+
+/* GUC parameters */
+extern PGDLLIMPORT int background_prune_queue_size;
+
+extern Size BackgroundPruneShmemSize(void);
+extern void BackgroundPruneShmemInit(void);
+
+extern void BackgroundPruneRegister(void);
+extern void BackgroundPruneLauncherMain(Datum main_arg);
+extern void BackgroundPruneWorkerMain(Datum main_arg);
+
+extern void BackgroundPruneEnqueue(Relation relation, BlockNumber blkno,
+								   TransactionId xid);
+
+#endif							/* BACKGROUND_PRUNE_H */
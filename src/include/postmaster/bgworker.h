@@ -126,6 +126,11 @@ extern BgwHandleStatus
 			WaitForBackgroundWorkerShutdown(BackgroundWorkerHandle *);
 extern const char *GetBackgroundWorkerTypeByPid(pid_t pid);
 
+/* Hand out a handle for a running bgworker to another process */
+extern bool GetMyBackgroundWorkerSlot(int *slotno, uint64 *generation);
+extern BackgroundWorkerHandle *MakeBackgroundWorkerHandle(int slotno,
+														  uint64 generation);
+
 /* Terminate a bgworker */
 extern void TerminateBackgroundWorker(BackgroundWorkerHandle *handle);
 
@@ -0,0 +1,31 @@
+/*-------------------------------------------------------------------------
+ *
+ * connproxy.h
+ *	  Connection proxies, which multiplex client sessions onto a smaller
+ *	  number of backends.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ *
+ * src/include/postmaster/connproxy.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef CONNPROXY_H
+#define CONNPROXY_H
+
+/* Upper limit for connection_proxies */
+#define MAX_CONNECTION_PROXIES	64
+
+/* GUC parameters */
+extern PGDLLIMPORT int ConnectionProxies;
+extern PGDLLIMPORT int ProxyPortNumber;
+extern PGDLLIMPORT int SessionPoolSize;
+
+/* Sockets for handing clients over to the proxies, see connproxy.c */
+extern PGDLLIMPORT pgsocket ConnProxySockets[MAX_CONNECTION_PROXIES][2];
+
+extern void ConnProxyRegister(void);
+extern void ConnProxyMain(Datum main_arg);
+extern void ConnProxyReadyForQuery(void);
+
+#endif							/* CONNPROXY_H */
@@ -44,6 +44,7 @@ typedef struct
 	BackendType bkend_type;		/* child process flavor, see above */
 	struct RegisteredBgWorker *rw;	/* bgworker info, if this is a bgworker */
 	bool		bgworker_notify;	/* gets bgworker start/stop notifications */
+	pgsocket	warm_sock;		/* handoff socket, if this is a warm backend */
 	dlist_node	elem;			/* list link in ActiveChildList */
 } PMChild;
 
@@ -55,6 +56,7 @@ extern PGDLLIMPORT int num_pmchild_slots;
 extern PGDLLIMPORT bool EnableSSL;
 extern PGDLLIMPORT int SuperuserReservedConnections;
 extern PGDLLIMPORT int ReservedConnections;
+extern PGDLLIMPORT int WarmBackends;
 extern PGDLLIMPORT int PostPortNumber;
 extern PGDLLIMPORT int Unix_socket_permissions;
 extern PGDLLIMPORT char *Unix_socket_group;
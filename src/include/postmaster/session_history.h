@@ -0,0 +1,46 @@
+/*-------------------------------------------------------------------------
+ *
+ * session_history.h
+ *	  Sampled history of the activity of all sessions.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ *
+ * src/include/postmaster/session_history.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SESSION_HISTORY_H
+#define SESSION_HISTORY_H
+
+#include "miscadmin.h"
+#include "utils/backend_status.h"
+#include "utils/timestamp.h"
+
+/*
+ * One sample of one backend.
+ */
+typedef struct SessionHistoryEntry
+{
+	TimestampTz sample_time;
+	int			pid;
+	BackendType backend_type;
+	BackendState state;
+	Oid			datid;
+	Oid			userid;
+	uint32		wait_event_info;
+	int64		query_id;
+} SessionHistoryEntry;
+
+/* GUC parameters */
+extern PGDLLIMPORT int session_history_size;
+extern PGDLLIMPORT int session_history_interval;
+
+extern Size SessionHistoryShmemSize(void);
+extern void SessionHistoryShmemInit(void);
+
+extern void SessionHistoryRegister(void);
+extern void SessionHistoryMain(Datum main_arg);
+
+extern SessionHistoryEntry *SessionHistoryGetEntries(int *nentries);
+
+#endif							/* SESSION_HISTORY_H */
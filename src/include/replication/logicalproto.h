@@ -36,13 +36,18 @@
  * LOGICALREP_PROTO_STREAM_PARALLEL_VERSION_NUM is the minimum protocol version
  * where we support applying large streaming transactions in parallel.
  * Introduced in PG16.
+ *
+ * LOGICALREP_PROTO_MULTI_INSERT_VERSION_NUM is the minimum protocol version
+ * where the publisher may send consecutive inserts into the same relation as
+ * a single MULTI INSERT message.  Introduced in PG19.
  */
 #define LOGICALREP_PROTO_MIN_VERSION_NUM 1
 #define LOGICALREP_PROTO_VERSION_NUM 1
 #define LOGICALREP_PROTO_STREAM_VERSION_NUM 2
 #define LOGICALREP_PROTO_TWOPHASE_VERSION_NUM 3
 #define LOGICALREP_PROTO_STREAM_PARALLEL_VERSION_NUM 4
-#define LOGICALREP_PROTO_MAX_VERSION_NUM LOGICALREP_PROTO_STREAM_PARALLEL_VERSION_NUM
+#define LOGICALREP_PROTO_MULTI_INSERT_VERSION_NUM 5
+#define LOGICALREP_PROTO_MAX_VERSION_NUM LOGICALREP_PROTO_MULTI_INSERT_VERSION_NUM
 
 /*
  * Logical message types
@@ -60,6 +65,7 @@ typedef enum LogicalRepMsgType
 	LOGICAL_REP_MSG_COMMIT = 'C',
 	LOGICAL_REP_MSG_ORIGIN = 'O',
 	LOGICAL_REP_MSG_INSERT = 'I',
+	LOGICAL_REP_MSG_MULTI_INSERT = 'i',
 	LOGICAL_REP_MSG_UPDATE = 'U',
 	LOGICAL_REP_MSG_DELETE = 'D',
 	LOGICAL_REP_MSG_TRUNCATE = 'T',
@@ -227,6 +233,17 @@ extern void logicalrep_write_insert(StringInfo out, TransactionId xid,
 									bool binary, Bitmapset *columns,
 									PublishGencolsType include_gencols_type);
 extern LogicalRepRelId logicalrep_read_insert(StringInfo in, LogicalRepTupleData *newtup);
+extern void logicalrep_write_multi_insert_tuple(StringInfo out, Relation rel,
+												TupleTableSlot *newslot,
+												bool binary, Bitmapset *columns,
+												PublishGencolsType include_gencols_type);
+extern void logicalrep_write_multi_insert(StringInfo out, TransactionId xid,
+										  Oid relid, int ntuples,
+										  StringInfo tuples);
+extern LogicalRepRelId logicalrep_read_multi_insert(StringInfo in,
+													int *ntuples);
+extern void logicalrep_read_multi_insert_tuple(StringInfo in,
+											   LogicalRepTupleData *newtup);
 extern void logicalrep_write_update(StringInfo out, TransactionId xid,
 									Relation rel, TupleTableSlot *oldslot,
 									TupleTableSlot *newslot, bool binary,
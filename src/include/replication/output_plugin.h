@@ -96,6 +96,14 @@ typedef void (*LogicalDecodeMessageCB) (struct LogicalDecodingContext *ctx,
 typedef bool (*LogicalDecodeFilterByOriginCB) (struct LogicalDecodingContext *ctx,
 											   RepOriginId origin_id);
 
+/*
+ * Filter changes by relation.  Return true if the plugin has no interest in
+ * changes to the relation, so that they can be discarded right when they are
+ * decoded, without being assembled into transactions.
+ */
+typedef bool (*LogicalDecodeFilterChangeCB) (struct LogicalDecodingContext *ctx,
+											 Relation relation);
+
 /*
  * Called to shutdown an output plugin.
  */
@@ -240,6 +248,9 @@ typedef struct OutputPluginCallbacks
 	LogicalDecodeStreamChangeCB stream_change_cb;
 	LogicalDecodeStreamMessageCB stream_message_cb;
 	LogicalDecodeStreamTruncateCB stream_truncate_cb;
+
+	/* filtering of changes before they are queued */
+	LogicalDecodeFilterChangeCB filter_change_cb;
 } OutputPluginCallbacks;
 
 /* Functions in replication/logical/logical.c */
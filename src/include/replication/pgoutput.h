@@ -13,6 +13,7 @@
 #ifndef PGOUTPUT_H
 #define PGOUTPUT_H
 
+#include "lib/stringinfo.h"
 #include "nodes/pg_list.h"
 
 typedef struct PGOutputData
@@ -25,6 +26,16 @@ typedef struct PGOutputData
 	bool		in_streaming;	/* true if we are streaming a chunk of
 								 * transaction */
 
+	/*
+	 * Inserts into the same relation not sent yet, to be sent together as a
+	 * MULTI INSERT message.  Only used with a protocol version that has
+	 * those.
+	 */
+	StringInfo	insert_tuples;	/* the tuples, as written to the stream */
+	int			insert_ntuples; /* their number, 0 if none is pending */
+	Oid			insert_relid;	/* the relation they were inserted into */
+	TransactionId insert_xid;	/* the xid sent with them, if streaming */
+
 	/* client-supplied info: */
 	uint32		protocol_version;
 	List	   *publication_names;
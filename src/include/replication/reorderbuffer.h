@@ -26,6 +26,7 @@
 /* GUC variables */
 extern PGDLLIMPORT int logical_decoding_work_mem;
 extern PGDLLIMPORT int debug_logical_replication_streaming;
+extern PGDLLIMPORT int logical_decoding_spill_compression;
 
 /* possible values for debug_logical_replication_streaming */
 typedef enum
@@ -34,6 +35,15 @@ typedef enum
 	DEBUG_LOGICAL_REP_STREAMING_IMMEDIATE,
 }			DebugLogicalRepStreamingMode;
 
+/* possible values for logical_decoding_spill_compression */
+typedef enum
+{
+	SPILL_COMPRESSION_NONE = 0,
+	SPILL_COMPRESSION_PGLZ,
+	SPILL_COMPRESSION_LZ4,
+	SPILL_COMPRESSION_ZSTD,
+}			SpillCompressionMethod;
+
 /*
  * Types of the change passed to a 'change' callback.
  *
@@ -177,6 +187,9 @@ typedef struct ReorderBufferChange
 #define RBTXN_IS_COMMITTED			0x0400
 #define RBTXN_IS_ABORTED			0x0800
 #define RBTXN_DISTR_INVAL_OVERFLOWED	0x1000
+#define RBTXN_PENDING_TOAST			0x2000
+#define RBTXN_FILTERED_TOAST		0x4000
+#define RBTXN_FILTERED_SPEC_INSERT	0x8000
 
 #define RBTXN_PREPARE_STATUS_MASK	(RBTXN_IS_PREPARED | RBTXN_SKIPPED_PREPARE | RBTXN_SENT_PREPARE)
 
@@ -571,6 +584,10 @@ typedef void (*ReorderBufferUpdateProgressTxnCB) (ReorderBuffer *rb,
 												  ReorderBufferTXN *txn,
 												  XLogRecPtr lsn);
 
+/* filter change callback signature */
+typedef bool (*ReorderBufferFilterChangeCB) (ReorderBuffer *rb,
+											 Relation relation);
+
 struct ReorderBuffer
 {
 	/*
@@ -640,6 +657,19 @@ struct ReorderBuffer
 	 */
 	ReorderBufferUpdateProgressTxnCB update_progress_txn;
 
+	/*
+	 * Optional callback to be called to decide whether changes to a relation
+	 * are of interest, before they are queued.  See
+	 * ReorderBufferFilterByRelFileLocator().
+	 */
+	ReorderBufferFilterChangeCB filter_change;
+
+	/*
+	 * relfilelocator => whether its changes are filtered out, as decided by
+	 * filter_change for the current catalog snapshot.
+	 */
+	HTAB	   *filter_cache;
+
 	/*
 	 * Pointer that will be passed untouched to the callbacks.
 	 */
@@ -668,6 +698,15 @@ struct ReorderBuffer
 	char	   *outbuf;
 	Size		outbufsize;
 
+	/* serialized changes waiting to be written out as one spill file chunk */
+	char	   *spillbuf;
+	Size		spillbufsize;
+	Size		spillbuflen;
+
+	/* buffer for compressing and decompressing spill file chunks */
+	char	   *compressbuf;
+	Size		compressbufsize;
+
 	/* memory accounting */
 	Size		size;
 
@@ -684,6 +723,8 @@ struct ReorderBuffer
 	int64		spillTxns;		/* number of transactions spilled to disk */
 	int64		spillCount;		/* spill-to-disk invocation counter */
 	int64		spillBytes;		/* amount of data spilled to disk */
+	int64		spillCompressedBytes;	/* amount of data written to spill
+										 * files, after compression */
 
 	/* Statistics about transactions streamed to the decoding output plugin */
 	int64		streamTxns;		/* number of transactions streamed */
@@ -763,6 +804,15 @@ extern void ReorderBufferProcessXid(ReorderBuffer *rb, TransactionId xid, XLogRe
 
 extern void ReorderBufferXidSetCatalogChanges(ReorderBuffer *rb, TransactionId xid, XLogRecPtr lsn);
 extern bool ReorderBufferXidHasCatalogChanges(ReorderBuffer *rb, TransactionId xid);
+extern bool ReorderBufferFilterByRelFileLocator(ReorderBuffer *rb,
+												TransactionId xid,
+												XLogRecPtr lsn,
+												Snapshot snapshot,
+												ReorderBufferChangeType action,
+												RelFileLocator *rlocator,
+												bool toast_insert,
+												bool clear_toast_afterwards);
+extern void ReorderBufferResetFilterCache(ReorderBuffer *rb);
 extern bool ReorderBufferXidHasBaseSnapshot(ReorderBuffer *rb, TransactionId xid);
 
 extern bool ReorderBufferRememberPrepareInfo(ReorderBuffer *rb, TransactionId xid,
@@ -0,0 +1,33 @@
+/*-------------------------------------------------------------------------
+ *
+ * walcompress.h
+ *	  Streaming compression of WAL sent over physical replication.
+ *
+ * Portions Copyright (c) 2010-2025, PostgreSQL Global Development Group
+ *
+ * src/include/replication/walcompress.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef _WALCOMPRESS_H
+#define _WALCOMPRESS_H
+
+#include "common/compression.h"
+#include "lib/stringinfo.h"
+
+typedef struct WalCompressor WalCompressor;
+typedef struct WalDecompressor WalDecompressor;
+
+extern bool WalCompressionSupported(pg_compress_algorithm algorithm);
+
+extern WalCompressor *WalCompressorCreate(const pg_compress_specification *spec);
+extern void WalCompress(WalCompressor *compressor, const char *data,
+						size_t len, StringInfo out);
+extern void WalCompressorFree(WalCompressor *compressor);
+
+extern WalDecompressor *WalDecompressorCreate(pg_compress_algorithm algorithm);
+extern void WalDecompress(WalDecompressor *decompressor, const char *data,
+						  size_t len, StringInfo out);
+extern void WalDecompressorFree(WalDecompressor *decompressor);
+
+#endif							/* _WALCOMPRESS_H */
@@ -109,6 +109,13 @@ typedef struct LogicalRepWorker
 	TimestampTz reply_time;
 
 	TimestampTz last_seqsync_start_time;
+
+	/*
+	 * In the slot of a leader apply worker, the position in commit order of
+	 * the last non-streamed transaction that one of its parallel apply
+	 * workers has committed.  See applyparallelworker.c.
+	 */
+	pg_atomic_uint64 parallel_committed_seq;
 } LogicalRepWorker;
 
 /*
@@ -197,6 +204,16 @@ typedef struct ParallelApplyWorkerShared
 	 */
 	PartialFileSetState fileset_state;
 	FileSet		fileset;
+
+	/*
+	 * For a non-streamed transaction handed to the worker as a whole, its
+	 * position in commit order, and the remote xid and position of the
+	 * transaction that has to commit just before it (prev_seq is 0 if there
+	 * is none).  All zero for streaming transactions.
+	 */
+	uint64		xact_seq;
+	TransactionId prev_xid;
+	uint64		prev_seq;
 } ParallelApplyWorkerShared;
 
 /*
@@ -231,6 +248,12 @@ typedef struct ParallelApplyWorkerInfo
 	 */
 	bool		in_use;
 
+	/*
+	 * Generation of the newest RELATION message the worker has been sent.
+	 * See pa_send_relations().
+	 */
+	uint64		relation_gen;
+
 	ParallelApplyWorkerShared *shared;
 } ParallelApplyWorkerInfo;
 
@@ -359,6 +382,16 @@ extern void pa_decr_and_wait_stream_block(void);
 extern void pa_xact_finish(ParallelApplyWorkerInfo *winfo,
 						   XLogRecPtr remote_lsn);
 
+extern bool pa_dispatch_xact(LogicalRepBeginData *begin_data, StringInfo s);
+extern bool pa_dispatch_message(LogicalRepMsgType action, StringInfo s);
+extern bool pa_dispatch_commit(LogicalRepCommitData *commit_data,
+							   StringInfo s);
+extern void pa_check_dispatched_xacts(void);
+extern bool pa_has_dispatched_xacts(void);
+extern void pa_begin_dispatched_xact(TransactionId xid);
+extern void pa_wait_for_preceding_xact(void);
+extern void pa_end_dispatched_xact(void);
+
 #define isParallelApplyWorker(worker) ((worker)->in_use && \
 									   (worker)->type == WORKERTYPE_PARALLEL_APPLY)
 #define isTableSyncWorker(worker) ((worker)->in_use && \
@@ -292,6 +292,7 @@ extern void pgaio_io_get_wref(PgAioHandle *ioh, PgAioWaitRef *iow);
 /* functions in aio_io.c */
 struct iovec;
 extern int	pgaio_io_get_iovec(PgAioHandle *ioh, struct iovec **iov);
+extern int	pgaio_io_get_iovec_length(PgAioHandle *ioh, struct iovec **iov);
 
 extern PgAioOp pgaio_io_get_op(PgAioHandle *ioh);
 extern PgAioOpData *pgaio_io_get_op_data(PgAioHandle *ioh);
@@ -290,6 +290,13 @@ typedef struct BufferDesc
 
 	PgAioWaitRef io_wref;		/* set iff AIO is in progress */
 	LWLock		content_lock;	/* to lock access to buffer contents */
+
+	/*
+	 * Incremented each time content_lock is acquired in exclusive mode, so
+	 * that readers that copy the page without locking it can tell whether it
+	 * might have been modified meanwhile.  See CopyBufferOptimistic().
+	 */
+	pg_atomic_uint32 content_seq;
 } BufferDesc;
 
 /*
@@ -507,7 +514,12 @@ extern BufferDesc *StrategyGetBuffer(BufferAccessStrategy strategy,
 extern bool StrategyRejectBuffer(BufferAccessStrategy strategy,
 								 BufferDesc *buf, bool from_ring);
 
-extern int	StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc);
+extern int	StrategySyncStart(int partition, uint32 *complete_passes,
+							  uint32 *num_buf_alloc, uint32 *num_dirty_alloc);
+extern int	StrategyNumPartitions(void);
+extern void StrategyPartitionInfo(int partition, int *first_buffer,
+								  int *num_buffers, uint32 *complete_passes,
+								  uint64 *num_allocs);
 extern void StrategyNotifyBgWriter(int bgwprocno);
 
 extern Size StrategyShmemSize(void);
@@ -518,6 +530,7 @@ extern Size BufTableShmemSize(int size);
 extern void InitBufTable(int size);
 extern uint32 BufTableHashCode(BufferTag *tagPtr);
 extern int	BufTableLookup(BufferTag *tagPtr, uint32 hashcode);
+extern int	BufTableLookupHint(BufferTag *tagPtr, uint32 hashcode);
 extern int	BufTableInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id);
 extern void BufTableDelete(BufferTag *tagPtr, uint32 hashcode);
 
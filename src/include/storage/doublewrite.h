@@ -0,0 +1,32 @@
+/*-------------------------------------------------------------------------
+ *
+ * doublewrite.h
+ *	  Double-write buffer for protection against torn data pages.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/doublewrite.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef DOUBLEWRITE_H
+#define DOUBLEWRITE_H
+
+#include "access/xlogdefs.h"
+#include "common/relpath.h"
+#include "storage/block.h"
+#include "storage/relfilelocator.h"
+
+/* Directory holding one double-write file per process */
+#define PG_DBLWR_DIR		"pg_dblwr"
+
+/* GUC parameters */
+extern PGDLLIMPORT bool double_write_buffer;
+
+extern void DoubleWritePages(RelFileLocator rlocator, ForkNumber forknum,
+							 BlockNumber blocknum, const void **pages,
+							 int npages);
+extern void DoubleWriteRecover(XLogRecPtr redo);
+
+#endif							/* DOUBLEWRITE_H */
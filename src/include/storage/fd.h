@@ -130,6 +130,7 @@ extern int	FileStartReadV(struct PgAioHandle *ioh, File file, int iovcnt, pgoff_
 extern int	FileSync(File file, uint32 wait_event_info);
 extern int	FileZero(File file, pgoff_t offset, pgoff_t amount, uint32 wait_event_info);
 extern int	FileFallocate(File file, pgoff_t offset, pgoff_t amount, uint32 wait_event_info);
+extern int	FilePunchHole(File file, pgoff_t offset, pgoff_t amount, uint32 wait_event_info);
 
 extern pgoff_t FileSize(File file);
 extern int	FileTruncate(File file, pgoff_t offset, uint32 wait_event_info);
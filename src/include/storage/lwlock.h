@@ -90,12 +90,18 @@ extern PGDLLIMPORT int *LWLockCounter;
 /* Number of partitions of the shared buffer mapping hashtable */
 #define NUM_BUFFER_PARTITIONS  128
 
-/* Number of partitions the shared lock tables are divided into */
-#define LOG2_NUM_LOCK_PARTITIONS  4
+/*
+ * Number of partitions the shared lock tables are divided into.  Locks that
+ * can't use the fast path, such as advisory locks and self-conflicting
+ * relation locks, all go through these partitions, so with many backends
+ * taking such locks at a high rate the partition locks are easily
+ * contended.
+ */
+#define LOG2_NUM_LOCK_PARTITIONS  6
 #define NUM_LOCK_PARTITIONS  (1 << LOG2_NUM_LOCK_PARTITIONS)
 
 /* Number of partitions the shared predicate lock tables are divided into */
-#define LOG2_NUM_PREDICATELOCK_PARTITIONS  4
+#define LOG2_NUM_PREDICATELOCK_PARTITIONS  6
 #define NUM_PREDICATELOCK_PARTITIONS  (1 << LOG2_NUM_PREDICATELOCK_PARTITIONS)
 
 /* Offsets for various chunks of preallocated lwlocks. */
@@ -134,6 +140,7 @@ extern void ForEachLWLockHeldByMe(void (*callback) (LWLock *, LWLockMode, void *
 extern bool LWLockHeldByMe(LWLock *lock);
 extern bool LWLockAnyHeldByMe(LWLock *lock, int nlocks, size_t stride);
 extern bool LWLockHeldByMeInMode(LWLock *lock, LWLockMode mode);
+extern bool LWLockHeldExclusively(LWLock *lock);
 
 extern bool LWLockWaitForVar(LWLock *lock, pg_atomic_uint64 *valptr, uint64 oldval, uint64 *newval);
 extern void LWLockUpdateVar(LWLock *lock, pg_atomic_uint64 *valptr, uint64 val);
@@ -186,6 +193,12 @@ typedef enum BuiltinTrancheIds
 	LWTRANCHE_FIRST_USER_DEFINED,
 }			BuiltinTrancheIds;
 
+/* Maximum number of tranches that LWLockNewTrancheId can create */
+#define MAX_NAMED_TRANCHES 256
+
+/* Upper bound of all tranche IDs, builtin or not */
+#define NUM_LWLOCK_TRANCHES (LWTRANCHE_FIRST_USER_DEFINED + MAX_NAMED_TRANCHES)
+
 /*
  * Prior to PostgreSQL 9.4, we used an enum type called LWLockId to refer
  * to LWLocks.  New code should instead use LWLock *.  However, for the
@@ -87,6 +87,7 @@ PG_LWLOCK(52, SerialControl)
 PG_LWLOCK(53, AioWorkerSubmissionQueue)
 PG_LWLOCK(54, WaitLSN)
 PG_LWLOCK(55, LogicalDecodingControl)
+PG_LWLOCK(56, SessionHistory)
 
 /*
  * There also exist several built-in LWLock tranches.  As with the predefined
@@ -137,3 +138,7 @@ PG_LWLOCKTRANCHE(SUBTRANS_SLRU, SubtransSLRU)
 PG_LWLOCKTRANCHE(XACT_SLRU, XactSLRU)
 PG_LWLOCKTRANCHE(PARALLEL_VACUUM_DSA, ParallelVacuumDSA)
 PG_LWLOCKTRANCHE(AIO_URING_COMPLETION, AioUringCompletion)
+PG_LWLOCKTRANCHE(PARALLEL_MEMOIZE, ParallelMemoize)
+PG_LWLOCKTRANCHE(RELSIZE_CACHE, RelationSizeCache)
+PG_LWLOCKTRANCHE(SHARED_CATCACHE, SharedCatalogCache)
+PG_LWLOCKTRANCHE(SHARED_CATCACHE_DSA, SharedCatalogCacheDSA)
@@ -0,0 +1,37 @@
+/*-------------------------------------------------------------------------
+ *
+ * pagecompress.h
+ *	  Transparent compression of relation pages on disk
+ *
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/pagecompress.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PAGECOMPRESS_H
+#define PAGECOMPRESS_H
+
+#include "storage/block.h"
+#include "storage/bufpage.h"
+
+/*
+ * Compressed pages occupy a multiple of this many bytes of their BLCKSZ slot
+ * in the relation file; the rest of the slot is deallocated.  It matches the
+ * block size of common filesystems.
+ */
+#define PAGE_COMPRESS_UNIT_SIZE		4096
+
+/*
+ * Layout version stored in place of PG_PAGE_LAYOUT_VERSION by a compressed
+ * page image.  A regular page can therefore never be mistaken for one.
+ */
+#define PG_PAGE_COMPRESSED_LAYOUT_VERSION	0xC4
+
+extern bool PageIsCompressedImage(const void *image);
+extern int	PageCompress(const void *page, void *image, BlockNumber blkno);
+extern bool PageDecompress(void *buffer);
+
+#endif							/* PAGECOMPRESS_H */
@@ -312,6 +312,13 @@ struct PGPROC
 	XLogRecPtr	clogGroupMemberLsn; /* WAL location of commit record for clog
 									 * group member */
 
+	/* Support for group WAL space reservation. */
+	pg_atomic_uint32 walGroupNext;	/* next WAL reservation group member */
+	pg_atomic_uint32 walGroupDone;	/* set by the leader once reserved */
+	uint64		walGroupSize;	/* WAL space requested by group member */
+	uint64		walGroupStartPos;	/* start of the reserved space */
+	uint64		walGroupPrevPos;	/* start of the previous record */
+
 	/* Lock manager data, recording fast-path locks taken by this backend. */
 	LWLock		fpInfoLock;		/* protects per-backend fast-path state */
 	uint64	   *fpLockBits;		/* lock modes held for each fast-path slot */
@@ -422,6 +429,8 @@ typedef struct PROC_HDR
 	pg_atomic_uint32 procArrayGroupFirst;
 	/* First pgproc waiting for group transaction status update */
 	pg_atomic_uint32 clogGroupFirst;
+	/* First pgproc waiting for group WAL space reservation */
+	pg_atomic_uint32 walGroupFirst;
 
 	/*
 	 * Current slot numbers of some auxiliary processes. There can be only one
@@ -519,5 +528,6 @@ extern PGPROC *AuxiliaryPidGetProc(int pid);
 
 extern void BecomeLockGroupLeader(void);
 extern bool BecomeLockGroupMember(PGPROC *leader, int pid);
+extern bool LeaveLockGroup(void);
 
 #endif							/* _PROC_H_ */
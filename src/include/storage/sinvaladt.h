@@ -25,6 +25,9 @@
 #include "storage/lock.h"
 #include "storage/sinval.h"
 
+/* GUC parameter */
+extern PGDLLIMPORT int invalidation_queue_size;
+
 /*
  * prototypes for functions in sinvaladt.c
  */
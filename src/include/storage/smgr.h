@@ -46,7 +46,12 @@ typedef struct SMgrRelationData
 	BlockNumber smgr_targblock; /* current insertion target block */
 	BlockNumber smgr_cached_nblocks[MAX_FORKNUM + 1];	/* last known size */
 
-	/* additional public fields may someday exist here */
+	/*
+	 * If set, pages of the main fork are compressed on write, if possible.
+	 * Set by the owner of the relcache entry based on the relation's
+	 * page_compression storage parameter.
+	 */
+	bool		smgr_compress;
 
 	/*
 	 * Fields below here are intended to be private to smgr.c and its
@@ -76,7 +81,12 @@ typedef SMgrRelationData *SMgrRelation;
 
 extern PGDLLIMPORT const PgAioTargetInfo aio_smgr_target_info;
 
+extern PGDLLIMPORT int relation_size_cache_entries;
+
 extern void smgrinit(void);
+extern Size SMgrSizeCacheShmemSize(void);
+extern void SMgrSizeCacheShmemInit(void);
+extern void smgrforgetdbsizes(Oid dbid);
 extern SMgrRelation smgropen(RelFileLocator rlocator, ProcNumber backend);
 extern bool smgrexists(SMgrRelation reln, ForkNumber forknum);
 extern void smgrpin(SMgrRelation reln);
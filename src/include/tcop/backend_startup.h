@@ -16,6 +16,8 @@
 
 #include "utils/timestamp.h"
 
+struct ClientSocket;
+
 /* GUCs */
 extern PGDLLIMPORT bool Trace_connection_negotiation;
 extern PGDLLIMPORT uint32 log_connections;
@@ -23,6 +25,7 @@ extern PGDLLIMPORT char *log_connections_string;
 
 /* Other globals */
 extern PGDLLIMPORT struct ConnectionTiming conn_timing;
+extern PGDLLIMPORT bool WarmBackendStart;
 
 /*
  * CAC_state is passed from postmaster to the backend process, to indicate
@@ -57,6 +60,12 @@ typedef struct BackendStartupData
 	 * connections.
 	 */
 	TimestampTz fork_started;
+
+	/*
+	 * For a warm backend, the socket on which it waits for the postmaster to
+	 * hand it a connection; PGINVALID_SOCKET otherwise.
+	 */
+	pgsocket	warm_sock;
 } BackendStartupData;
 
 /*
@@ -118,5 +127,8 @@ typedef struct ConnectionTiming
 } ConnectionTiming;
 
 pg_noreturn extern void BackendMain(const void *startup_data, size_t startup_data_len);
+extern bool SendWarmBackendHandoff(pgsocket sock,
+								   const BackendStartupData *startup_data,
+								   const struct ClientSocket *client_sock);
 
 #endif							/* BACKEND_STARTUP_H */
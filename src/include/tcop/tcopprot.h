@@ -46,6 +46,8 @@ extern PGDLLIMPORT int log_statement;
 
 extern PGDLLIMPORT int restrict_nonsystem_relation_kind;
 
+extern PGDLLIMPORT int simple_query_cache_size;
+
 extern List *pg_parse_query(const char *query_string);
 extern List *pg_rewrite_query(Query *query);
 extern List *pg_analyze_and_rewrite_fixedparams(RawStmt *parsetree,
@@ -95,16 +95,14 @@ typedef struct aff_struct
 				replen:14;
 	const char *find;
 	const char *repl;
-	union
-	{
-		/*
-		 * Arrays of AFFIX are moved and sorted.  We'll use a pointer to
-		 * regex_t to keep this struct small, and avoid assuming that regex_t
-		 * is movable.
-		 */
-		regex_t    *pregex;
-		Regis		regis;
-	}			reg;
+	const char *mask;			/* condition, unless issimple */
+
+	/*
+	 * The compiled mask, if it's a regular expression.  Arrays of AFFIX are
+	 * moved and sorted.  We'll use a pointer to regex_t to keep this struct
+	 * small, and avoid assuming that regex_t is movable.
+	 */
+	regex_t    *pregex;
 } AFFIX;
 
 /*
@@ -181,8 +179,99 @@ typedef struct CompoundAffixFlag
 
 #define FLAGNUM_MAXSIZE		(1 << 16)
 
+/*
+ * A compiled dictionary.
+ *
+ * NIFinishBuild() copies everything NINormalizeWord() needs into a single
+ * chunk of memory, the image, whose parts refer to each other by their
+ * offset from the start of the chunk.  An image thus works at any address,
+ * which lets backends share one in dynamic shared memory.  Offset 0 is
+ * taken by the NIImage header, so it can stand for a null pointer.
+ *
+ * Apart from that, the image versions of the structs above are the same as
+ * the originals.  Affixes are referred to by their index in the affix array.
+ */
+typedef uint32 NIOffset;
+
 typedef struct
 {
+	uint32		val:8,
+				isword:1,
+				compoundflag:4,
+				affix:19;
+	NIOffset	node;			/* NIDictNode, or 0 */
+} NIDictNodeData;
+
+typedef struct
+{
+	uint32		length;
+	NIDictNodeData data[FLEXIBLE_ARRAY_MEMBER];
+} NIDictNode;
+
+typedef struct
+{
+	NIOffset	flag;
+	NIOffset	find;
+	NIOffset	repl;
+	NIOffset	mask;
+	uint32		type:1,
+				flagflags:7,
+				issimple:1,
+				isregis:1,
+				replen:14;
+} NIAffix;
+
+typedef struct
+{
+	uint32		val:8,
+				naff:24;
+	NIOffset	aff;			/* array of naff affix indexes (uint32) */
+	NIOffset	node;			/* NIAffixNode, or 0 */
+} NIAffixNodeData;
+
+typedef struct
+{
+	uint32		isvoid:1,
+				length:31;
+	NIAffixNodeData data[FLEXIBLE_ARRAY_MEMBER];
+} NIAffixNode;
+
+typedef struct
+{
+	NIOffset	affix;			/* 0 marks the end of the array */
+	int			len;
+	bool		issuffix;
+} NICompoundAffix;
+
+typedef struct
+{
+	Size		size;			/* total size of the image */
+	FlagMode	flagMode;
+	bool		usecompound;
+	int			naffixes;
+	NIOffset	affixes;		/* array of naffixes NIAffix */
+	int			nAffixData;
+	NIOffset	affixData;		/* array of nAffixData string offsets */
+	NIOffset	dictionary;		/* NIDictNode, or 0 */
+	NIOffset	suffix;			/* NIAffixNode, or 0 */
+	NIOffset	prefix;			/* NIAffixNode, or 0 */
+	NIOffset	compoundAffix;	/* array of NICompoundAffix, or 0 */
+} NIImage;
+
+typedef struct
+{
+	/*
+	 * The compiled dictionary, and the regular expressions and regis of its
+	 * affixes, indexed like its affix array.  These can't be part of the
+	 * image, so we compile them when first needed.
+	 */
+	NIImage    *image;
+	void	  **masks;
+	MemoryContext dictCxt;		/* long-lived context to compile them in */
+
+	/*
+	 * All follow fields are actually needed only for initialization
+	 */
 	int			maffixes;
 	int			naffixes;
 	AFFIX	   *Affix;
@@ -200,11 +289,7 @@ typedef struct
 	CMPDAffix  *CompoundAffix;
 
 	bool		usecompound;
-	FlagMode	flagMode;
-
-	/*
-	 * All follow fields are actually needed only for initialization
-	 */
+	FlagMode	flagMode;		/* also used with the image */
 
 	/* Array of Hunspell options in affix file */
 	CompoundAffixFlag *CompoundAffixFlags;
@@ -229,6 +314,9 @@ typedef struct
 	size_t		avail;			/* free space remaining at firstfree */
 } IspellDict;
 
+/* GUC parameter, in dict_ispell.c */
+extern PGDLLIMPORT int shared_ispell_dictionaries;
+
 extern TSLexeme *NINormalizeWord(IspellDict *Conf, const char *word);
 
 extern void NIStartBuild(IspellDict *Conf);
@@ -237,5 +325,6 @@ extern void NIImportDictionary(IspellDict *Conf, const char *filename);
 extern void NISortDictionary(IspellDict *Conf);
 extern void NISortAffixes(IspellDict *Conf);
 extern void NIFinishBuild(IspellDict *Conf);
+extern void NIUseImage(IspellDict *Conf, NIImage *image);
 
 #endif
@@ -174,6 +174,13 @@ typedef struct PgBackendStatus
 
 	/* plan identifier, optionally computed using planner_hook */
 	int64		st_plan_id;
+
+	/*
+	 * Total size of the memory blocks held by the backend's memory contexts.
+	 * This is updated by the memory context code without following the
+	 * st_changecount protocol; see my_allocated_bytes.
+	 */
+	uint64		st_allocated_bytes;
 } PgBackendStatus;
 
 
@@ -0,0 +1,50 @@
+/*-------------------------------------------------------------------------
+ *
+ * cachemem.h
+ *	  Memory limit and statistics for the backend-local caches.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/cachemem.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef CACHEMEM_H
+#define CACHEMEM_H
+
+/* GUC parameter */
+extern PGDLLIMPORT int catalog_cache_memory_limit;
+
+/*
+ * Entries of the catalog, relation and plan caches remember the value of
+ * this clock when they were last used, so that the least recently used
+ * entry of all caches can be found.
+ */
+extern PGDLLIMPORT uint64 CacheAccessClock;
+
+static inline uint64
+CacheAccessTick(void)
+{
+	return ++CacheAccessClock;
+}
+
+/* Statistics of one cache, as reported by pg_backend_cache_stats */
+typedef struct CacheStatsEntry
+{
+	const char *cache;			/* "catcache", "relcache" or "plancache" */
+	int			cacheId;		/* syscache ID, or -1 */
+	Oid			relid;			/* catalog of a catcache, or InvalidOid */
+	int64		entries;
+	Size		memory;			/* estimated memory of the entries */
+	uint64		searches;
+	uint64		hits;
+	uint64		neg_hits;
+	uint64		loads;
+	uint64		invals;
+	uint64		evictions;
+} CacheStatsEntry;
+
+extern void AtEOXact_CacheMemory(void);
+
+#endif							/* CACHEMEM_H */
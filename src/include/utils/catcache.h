@@ -65,10 +65,9 @@ typedef struct catcache
 											 * scans */
 
 	/*
-	 * Keep these at the end, so that compiling catcache.c with CATCACHE_STATS
-	 * doesn't break ABI for other modules
+	 * Statistics, reported by pg_backend_cache_stats and, if compiled with
+	 * CATCACHE_STATS, at backend exit
 	 */
-#ifdef CATCACHE_STATS
 	uint64		cc_searches;	/* total # searches against this cache */
 	uint64		cc_hits;		/* # of matches against existing entry */
 	uint64		cc_neg_hits;	/* # of matches against negative entry */
@@ -81,7 +80,8 @@ typedef struct catcache
 	uint64		cc_invals;		/* # of entries invalidated from cache */
 	uint64		cc_lsearches;	/* total # list-searches */
 	uint64		cc_lhits;		/* # of matches against existing lists */
-#endif
+	uint64		cc_evictions;	/* # of entries evicted to save memory */
+	Size		cc_memory;		/* memory used by this cache's entries */
 } CatCache;
 
 
@@ -133,6 +133,13 @@ typedef struct catctup
 	struct catclist *c_list;	/* containing CatCList, or NULL if none */
 
 	CatCache   *my_cache;		/* link to owning catcache */
+
+	/*
+	 * All entries of all caches are also kept in one dlist in LRU order, for
+	 * evicting entries when catalog_cache_memory_limit is exceeded.
+	 */
+	dlist_node	lru_elem;		/* list member of global LRU list */
+	uint64		lastused;		/* CacheAccessClock at last use */
 	/* properly aligned tuple data follows, unless a negative entry */
 } CatCTup;
 
@@ -190,6 +197,8 @@ typedef struct catcacheheader
 {
 	slist_head	ch_caches;		/* head of list of CatCache structs */
 	int			ch_ntup;		/* # of tuples in all caches */
+	dlist_head	ch_lru;			/* all tuples, most recently used first */
+	Size		ch_memory;		/* memory used by tuples in all caches */
 } CatCacheHeader;
 
 
@@ -224,6 +233,13 @@ extern CatCList *SearchCatCacheList(CatCache *cache, int nkeys,
 									Datum v3);
 extern void ReleaseCatCacheList(CatCList *list);
 
+extern Size CatCacheMemory(void);
+extern uint64 CatCacheOldestUse(void);
+extern void CatCacheEvictOldest(void);
+/* caller must include utils/cachemem.h */
+struct CacheStatsEntry;
+extern int	CatCacheGetStats(struct CacheStatsEntry **stats);
+
 extern void ResetCatalogCaches(void);
 extern void ResetCatalogCachesExt(bool debug_discard);
 extern void CatalogCacheFlushCatalog(Oid catId);
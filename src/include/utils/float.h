@@ -41,6 +41,8 @@ extern float4 float4in_internal(char *num, char **endptr_p,
 								const char *type_name, const char *orig_string,
 								struct Node *escontext);
 extern char *float8out_internal(float8 num);
+extern void float4out_buf(float4 num, char *buf);
+extern void float8out_buf(float8 num, char *buf);
 extern int	float4_cmp_internal(float4 a, float4 b);
 extern int	float8_cmp_internal(float8 a, float8 b);
 
@@ -429,6 +429,7 @@ extern JsonbValue *findJsonbValueFromContainer(JsonbContainer *container,
 extern JsonbValue *getKeyJsonValueFromContainer(JsonbContainer *container,
 												const char *keyVal, int keyLen,
 												JsonbValue *res);
+extern Jsonb *DatumGetJsonbPForKey(Datum d, const char *keyVal, int keyLen);
 extern JsonbValue *getIthJsonbValueFromContainer(JsonbContainer *container,
 												 uint32 i);
 extern void pushJsonbValue(JsonbInState *pstate,
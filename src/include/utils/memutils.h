@@ -104,6 +104,17 @@ extern void MemoryContextCheck(MemoryContext context);
 extern void HandleLogMemoryContextInterrupt(void);
 extern void ProcessLogMemoryContextInterrupt(void);
 
+/* blockcache.c */
+extern PGDLLIMPORT int memory_block_cache_size;
+extern PGDLLIMPORT int max_backend_memory;
+extern PGDLLIMPORT int memory_block_large_threshold;
+extern PGDLLIMPORT uint64 *my_allocated_bytes;
+extern PGDLLIMPORT bool backend_memory_limit_hit;
+
+extern void MemoryBlockCacheStats(MemoryContextCounters *counters);
+extern void MemoryAccountingAttach(uint64 *counter);
+extern void MemoryAccountingDetach(void);
+
 /*
  * Memory-context-type-specific functions
  */
@@ -18,6 +18,14 @@
 
 #include "utils/memutils.h"
 
+/*
+ * Blocks of all context types are obtained and released with these, in
+ * blockcache.c, rather than malloc(), realloc() and free().
+ */
+extern void *MemoryBlockAlloc(Size size);
+extern void *MemoryBlockRealloc(void *block, Size oldsize, Size newsize);
+extern void MemoryBlockFree(void *block, Size size);
+
 /* These functions implement the MemoryContext API for AllocSet context. */
 extern void *AllocSetAlloc(MemoryContext context, Size size, int flags);
 extern void AllocSetFree(void *pointer);
@@ -457,13 +457,26 @@ typedef struct PgStatShared_Checkpointer
 typedef struct PgStatShared_IO
 {
 	/*
-	 * locks[i] protects stats.stats[i]. locks[0] also protects
-	 * stats.stat_reset_timestamp.
+	 * locks[i] protects stats.stats[i] and stats.hist[i]. locks[0] also
+	 * protects stats.stat_reset_timestamp.
 	 */
 	LWLock		locks[BACKEND_NUM_TYPES];
 	PgStat_IO	stats;
 } PgStatShared_IO;
 
+typedef struct PgStat_LWLock
+{
+	TimestampTz stat_reset_timestamp;
+	PgStat_LWLockStats stats[NUM_LWLOCK_TRANCHES];	/* indexed by tranche ID */
+} PgStat_LWLock;
+
+typedef struct PgStatShared_LWLock
+{
+	/* lock protects ->stats */
+	LWLock		lock;
+	PgStat_LWLock stats;
+} PgStatShared_LWLock;
+
 typedef struct PgStatShared_SLRU
 {
 	/* lock protects ->stats */
@@ -572,6 +585,7 @@ typedef struct PgStat_ShmemControl
 	PgStatShared_IO io;
 	PgStatShared_SLRU slru;
 	PgStatShared_Wal wal;
+	PgStatShared_LWLock lwlock;
 
 	/*
 	 * Custom stats data with fixed-numbered objects, indexed by (PgStat_Kind
@@ -606,6 +620,8 @@ typedef struct PgStat_Snapshot
 
 	PgStat_WalStats wal;
 
+	PgStat_LWLock lwlock;
+
 	/*
 	 * Data in snapshot for custom fixed-numbered statistics, indexed by
 	 * (PgStat_Kind - PGSTAT_KIND_CUSTOM_MIN).  Each entry is allocated in
@@ -805,6 +821,17 @@ extern PgStatShared_Common *pgstat_init_entry(PgStat_Kind kind,
 											  PgStatShared_HashEntry *shhashent);
 
 
+/*
+ * Functions in pgstat_lwlock.c
+ */
+
+extern void pgstat_lwlock_init_backend_cb(void);
+extern bool pgstat_lwlock_flush_cb(bool nowait);
+extern void pgstat_lwlock_init_shmem_cb(void *stats);
+extern void pgstat_lwlock_reset_all_cb(TimestampTz ts);
+extern void pgstat_lwlock_snapshot_cb(void);
+
+
 /*
  * Functions in pgstat_slru.c
  */
@@ -139,6 +139,8 @@ typedef struct CachedPlanSource
 	int			generation;		/* increments each time we create a plan */
 	/* If CachedPlanSource has been saved, it is a member of a global list */
 	dlist_node	node;			/* list link, if is_saved */
+	uint64		last_used;		/* CacheAccessClock at last use, if is_saved */
+	Size		gplan_memory;	/* memory of gplan, if is_saved */
 	/* State kept to help decide whether to use custom or generic plans: */
 	double		generic_cost;	/* cost of generic plan, or -1 if not known */
 	double		total_custom_cost;	/* total cost of custom plans so far */
@@ -170,6 +172,8 @@ typedef struct CachedPlan
 	int			generation;		/* parent's generation number for this plan */
 	int			refcount;		/* count of live references to this struct */
 	MemoryContext context;		/* context containing this CachedPlan */
+	/* executor state left behind by the last execution, or NULL */
+	struct CachedExecState *execstate;
 } CachedPlan;
 
 /*
@@ -253,4 +257,11 @@ extern bool CachedPlanIsSimplyValid(CachedPlanSource *plansource,
 extern CachedExpression *GetCachedExpression(Node *expr);
 extern void FreeCachedExpression(CachedExpression *cexpr);
 
+extern Size PlanCacheMemory(void);
+extern uint64 PlanCacheOldestUse(void);
+extern void PlanCacheEvictOldest(void);
+/* caller must include utils/cachemem.h */
+struct CacheStatsEntry;
+extern void PlanCacheGetStats(struct CacheStatsEntry *stats);
+
 #endif							/* PLANCACHE_H */
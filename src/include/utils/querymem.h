@@ -0,0 +1,45 @@
+/*-------------------------------------------------------------------------
+ *
+ * querymem.h
+ *	  Cluster-wide budget for the working memory of queries.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/querymem.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef QUERYMEM_H
+#define QUERYMEM_H
+
+/* GUC parameter */
+extern PGDLLIMPORT int query_memory_budget;
+
+/*
+ * Every sort or hash table may reserve this much even if the budget is
+ * exhausted, so that queries can make progress.
+ */
+#define QUERY_MEMORY_MIN_GRANT	(64 * 1024)
+
+/*
+ * Memory reserved from the budget by one sort, hash table etc.  A zeroed
+ * struct is a valid empty grant.
+ */
+typedef struct MemoryGrant
+{
+	Size		size;			/* bytes currently reserved */
+	Size		charged;		/* of which taken from the shared budget */
+	uint64		epoch;			/* see querymem.c */
+} MemoryGrant;
+
+extern Size QueryMemoryShmemSize(void);
+extern void QueryMemoryShmemInit(void);
+
+extern void MemoryGrantInit(MemoryGrant *grant);
+extern Size MemoryGrantExtend(MemoryGrant *grant, Size target, Size minimum);
+extern void MemoryGrantRelease(MemoryGrant *grant);
+
+extern void AtEOXact_QueryMemory(void);
+
+#endif							/* QUERYMEM_H */
@@ -20,6 +20,7 @@
 #include "catalog/pg_class.h"
 #include "catalog/pg_index.h"
 #include "catalog/pg_publication.h"
+#include "lib/ilist.h"
 #include "nodes/bitmapset.h"
 #include "partitioning/partdefs.h"
 #include "rewrite/prs2lock.h"
@@ -114,10 +115,13 @@ typedef struct RelationData
 	LockInfoData rd_lockInfo;	/* lock mgr's info for locking relation */
 	RuleLock   *rd_rules;		/* rewrite rules */
 	MemoryContext rd_rulescxt;	/* private memory cxt for rd_rules, if any */
-	TriggerDesc *trigdesc;		/* Trigger info, or NULL if rel has none */
 	/* use "struct" here to avoid needing to include rowsecurity.h: */
 	struct RowSecurityDesc *rd_rsdesc;	/* row security policies, or NULL */
 
+	/* data managed by RelationGetTriggerDesc: */
+	TriggerDesc *trigdesc;		/* Trigger info, or NULL if rel has none */
+	bool		rd_trigvalid;	/* true if trigdesc has been computed */
+
 	/* data managed by RelationGetFKeyList: */
 	List	   *rd_fkeylist;	/* list of ForeignKeyCacheInfo (see below) */
 	bool		rd_fkeyvalid;	/* true if list has been computed */
@@ -253,6 +257,14 @@ typedef struct RelationData
 	bool		pgstat_enabled; /* should relation stats be counted */
 	/* use "struct" here to avoid needing to include pgstat.h: */
 	struct PgStat_TableStatus *pgstat_info; /* statistics collection area */
+
+	/*
+	 * Entries built by RelationBuildDesc() are kept in a dlist in LRU order,
+	 * for evicting them when catalog_cache_memory_limit is exceeded.
+	 */
+	dlist_node	rd_lru;			/* LRU list link, or detached */
+	uint64		rd_lastused;	/* CacheAccessClock at last use */
+	Size		rd_cachemem;	/* estimated memory, when linked */
 } RelationData;
 
 
@@ -355,6 +367,7 @@ typedef struct StdRdOptions
 	 * to freeze. 0 if disabled, -1 if unspecified.
 	 */
 	double		vacuum_max_eager_freeze_failure_rate;
+	bool		page_compression;	/* compress pages on disk? */
 } StdRdOptions;
 
 #define HEAP_MIN_FILLFACTOR			10
@@ -410,6 +423,17 @@ typedef struct StdRdOptions
 	((relation)->rd_options ? \
 	 ((StdRdOptions *) (relation)->rd_options)->parallel_workers : (defaultpw))
 
+/*
+ * RelationGetPageCompression
+ *		Returns the table's page_compression setting.  Indexes are handled
+ *		by their access methods.  Note multiple eval of argument!
+ */
+#define RelationGetPageCompression(relation) \
+	(((relation)->rd_rel->relkind == RELKIND_RELATION || \
+	  (relation)->rd_rel->relkind == RELKIND_MATVIEW) && \
+	 (relation)->rd_options ? \
+	 ((StdRdOptions *) (relation)->rd_options)->page_compression : false)
+
 /* ViewOptions->check_option values */
 typedef enum ViewOptCheckOption
 {
@@ -580,6 +604,7 @@ RelationGetSmgr(Relation rel)
 	{
 		rel->rd_smgr = smgropen(rel->rd_locator, rel->rd_backend);
 		smgrpin(rel->rd_smgr);
+		rel->rd_smgr->smgr_compress = RelationGetPageCompression(rel);
 	}
 	return rel->rd_smgr;
 }
@@ -640,12 +665,32 @@ RelationCloseSmgr(Relation relation)
 	  (relation->rd_createSubid == InvalidSubTransactionId &&			\
 	   relation->rd_firstRelfilelocatorSubid == InvalidSubTransactionId)))
 
+/*
+ * RelationIsGlobalTemp
+ *		True if relation is a global temporary table, or an index or TOAST
+ *		table of one.  Its definition is shared, but its contents are private
+ *		to each session.
+ */
+#define RelationIsGlobalTemp(relation) \
+	((relation)->rd_rel->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+
 /*
  * RelationUsesLocalBuffers
  *		True if relation's pages are stored in local buffers.
  */
 #define RelationUsesLocalBuffers(relation) \
-	((relation)->rd_rel->relpersistence == RELPERSISTENCE_TEMP)
+	((relation)->rd_rel->relpersistence == RELPERSISTENCE_TEMP || \
+	 (relation)->rd_rel->relpersistence == RELPERSISTENCE_GLOBAL_TEMP)
+
+/*
+ * RelationGetBufferPersistence
+ *		The persistence the buffer manager should treat relation's pages with.
+ *
+ * Global temporary tables are stored like temporary tables.
+ */
+#define RelationGetBufferPersistence(relation) \
+	(RelationIsGlobalTemp(relation) ? RELPERSISTENCE_TEMP : \
+	 (relation)->rd_rel->relpersistence)
 
 /*
  * RELATION_IS_LOCAL
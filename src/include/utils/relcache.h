@@ -51,6 +51,7 @@ extern void RelationClose(Relation relation);
 /*
  * Routines to compute/retrieve additional cached information
  */
+extern struct TriggerDesc *RelationGetTriggerDesc(Relation relation);
 extern List *RelationGetFKeyList(Relation relation);
 extern List *RelationGetIndexList(Relation relation);
 extern List *RelationGetStatExtList(Relation relation);
@@ -143,6 +144,13 @@ extern void AssertPendingSyncs_RelationCache(void);
 #define AssertPendingSyncs_RelationCache() do {} while (0)
 #endif
 extern void AtEOXact_RelationCache(bool isCommit);
+
+/* caller must include utils/cachemem.h */
+struct CacheStatsEntry;
+extern Size RelationCacheMemory(void);
+extern uint64 RelationCacheOldestUse(void);
+extern void RelationCacheEvictOldest(void);
+extern void RelationCacheGetStats(struct CacheStatsEntry *stats);
 extern void AtEOSubXact_RelationCache(bool isCommit, SubTransactionId mySubid,
 									  SubTransactionId parentSubid);
 
@@ -0,0 +1,37 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.h
+ *	  Cluster-wide cache of catalog tuples in shared memory.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedcatcache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDCATCACHE_H
+#define SHAREDCATCACHE_H
+
+#include "access/htup.h"
+#include "storage/sinval.h"
+
+/* GUC parameter */
+extern PGDLLIMPORT int shared_catalog_cache_size;
+
+extern Size SharedCatCacheShmemSize(void);
+extern void SharedCatCacheShmemInit(void);
+extern void SharedCatCacheAttach(void);
+
+extern bool SharedCatCacheUsable(void);
+extern HeapTuple SharedCatCacheLookup(Oid dbid, int cacheId,
+									  uint32 hashValue);
+extern uint64 SharedCatCacheStartLoad(void);
+extern void SharedCatCacheInsert(Oid dbid, int cacheId, uint32 hashValue,
+								 HeapTuple tuple, uint64 generation);
+
+extern void SharedCatCacheInvalidate(const SharedInvalidationMessage *msgs,
+									 int n);
+extern void SharedCatCacheForgetDatabase(Oid dbid);
+
+#endif							/* SHAREDCATCACHE_H */
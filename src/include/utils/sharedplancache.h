@@ -0,0 +1,35 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.h
+ *	  Cluster-wide cache of generic plans for prepared statements.
+ *
+ * Portions Copyright (c) 1996-2025, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedplancache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDPLANCACHE_H
+#define SHAREDPLANCACHE_H
+
+#include "storage/sinval.h"
+#include "utils/plancache.h"
+
+/* GUC parameter */
+extern PGDLLIMPORT int shared_plan_cache_entries;
+
+extern void SharedPlanCacheAttach(void);
+
+extern bool SharedPlanCacheEligible(CachedPlanSource *plansource);
+extern uint64 SharedPlanCacheStartBuild(void);
+extern List *SharedPlanCacheLookup(CachedPlanSource *plansource);
+extern void SharedPlanCacheInsert(CachedPlanSource *plansource,
+								  List *stmt_list, uint64 generation);
+
+extern void SharedPlanCacheBeginInvalidation(void);
+extern void SharedPlanCacheInvalidate(const SharedInvalidationMessage *msgs,
+									  int n);
+extern void SharedPlanCacheEndInvalidation(void);
+
+#endif							/* SHAREDPLANCACHE_H */
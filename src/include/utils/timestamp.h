@@ -124,6 +124,8 @@ extern TimestampTz time_t_to_timestamptz(pg_time_t tm);
 extern pg_time_t timestamptz_to_time_t(TimestampTz t);
 
 extern const char *timestamptz_to_str(TimestampTz t);
+extern void timestamp_out_buf(Timestamp timestamp, char *buf);
+extern void timestamptz_out_buf(TimestampTz dt, char *buf);
 
 extern int	tm2timestamp(struct pg_tm *tm, fsec_t fsec, int *tzp, Timestamp *result);
 extern int	timestamp2tm(Timestamp dt, int *tzp, struct pg_tm *tm,
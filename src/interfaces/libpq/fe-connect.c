@@ -328,6 +328,10 @@ static const internalPQconninfoOption PQconninfoOptions[] = {
 		"SSL-SNI", "", 1,
 	offsetof(struct pg_conn, sslsni)},
 
+	{"sslktls", "PGSSLKTLS", "0", NULL,
+		"SSL-Kernel-TLS", "", 1,
+	offsetof(struct pg_conn, sslktls)},
+
 	{"requirepeer", "PGREQUIREPEER", NULL, NULL,
 		"Require-Peer", "", 10,
 	offsetof(struct pg_conn, requirepeer)},
@@ -389,6 +393,14 @@ static const internalPQconninfoOption PQconninfoOptions[] = {
 		"Load-Balance-Hosts", "", 8,	/* sizeof("disable") = 8 */
 	offsetof(struct pg_conn, load_balance_hosts)},
 
+	{"compression", "PGCOMPRESSION", NULL, NULL,
+		"Compression", "", 40,
+	offsetof(struct pg_conn, compression)},
+
+	{"column_batch_rows", NULL, NULL, NULL,
+		"Column-Batch-Rows", "", 8,
+	offsetof(struct pg_conn, column_batch_rows)},
+
 	{"scram_client_key", NULL, NULL, NULL, "SCRAM-Client-Key", "D", SCRAM_MAX_KEY_LEN * 2,
 	offsetof(struct pg_conn, scram_client_key)},
 
@@ -510,6 +522,7 @@ static void default_threadlock(int acquire);
 static bool sslVerifyProtocolVersion(const char *version);
 static bool sslVerifyProtocolRange(const char *min, const char *max);
 static bool pqParseProtocolVersion(const char *value, ProtocolVersion *result, PGconn *conn, const char *context);
+static bool pqParseCompression(PGconn *conn);
 
 
 /* global variable because fe-auth.c needs to access it */
@@ -546,6 +559,9 @@ pqDropConnection(PGconn *conn, bool flushInput)
 	/* Always discard any unsent data */
 	conn->outCount = 0;
 
+	/* Protocol compression starts over with the next connection, if any */
+	pqEndCompression(conn);
+
 	/* Likewise, discard any pending pipelined commands */
 	pqFreeCommandQueue(conn->cmd_queue_head);
 	conn->cmd_queue_head = conn->cmd_queue_tail = NULL;
@@ -2160,6 +2176,37 @@ pqConnectOptions2(PGconn *conn)
 		return false;
 	}
 
+	/*
+	 * validate compression option
+	 */
+	if (!pqParseCompression(conn))
+	{
+		conn->status = CONNECTION_BAD;
+		return false;
+	}
+
+	/*
+	 * validate column_batch_rows option
+	 */
+	conn->batch_rows = 0;
+	if (conn->column_batch_rows && conn->column_batch_rows[0])
+	{
+		if (!pqParseIntParam(conn->column_batch_rows, &conn->batch_rows,
+							 conn, "column_batch_rows"))
+		{
+			conn->status = CONNECTION_BAD;
+			return false;
+		}
+		if (conn->batch_rows < 0)
+		{
+			conn->status = CONNECTION_BAD;
+			libpq_append_conn_error(conn, "invalid %s value: \"%s\"",
+									"column_batch_rows",
+									conn->column_batch_rows);
+			return false;
+		}
+	}
+
 	/*
 	 * Resolve special "auto" client_encoding from the locale
 	 */
@@ -3758,6 +3805,8 @@ keep_going:						/* We will come back to here until there is
 
 				free(startpacket);
 
+				conn->compression_pending = (conn->compress_request != NULL);
+				conn->column_batches = (conn->batch_rows > 0);
 				conn->status = CONNECTION_AWAITING_RESPONSE;
 				return PGRES_POLLING_READING;
 			}
@@ -5105,6 +5154,7 @@ freePGconn(PGconn *conn)
 	free(conn->sslcrl);
 	free(conn->sslcrldir);
 	free(conn->sslsni);
+	free(conn->sslktls);
 	free(conn->requirepeer);
 	free(conn->gssencmode);
 	free(conn->krbsrvname);
@@ -5117,6 +5167,9 @@ freePGconn(PGconn *conn)
 	free(conn->target_session_attrs);
 	free(conn->require_auth);
 	free(conn->load_balance_hosts);
+	free(conn->compression);
+	free(conn->column_batch_rows);
+	free(conn->compress_request);
 	free(conn->scram_client_key);
 	free(conn->scram_server_key);
 	free(conn->sslkeylogfile);
@@ -7690,6 +7743,16 @@ PQfullProtocolVersion(const PGconn *conn)
 	return PG_PROTOCOL_FULL(conn->pversion);
 }
 
+int
+PQcolumnBatchRows(const PGconn *conn)
+{
+	if (!conn)
+		return 0;
+	if (conn->status == CONNECTION_BAD)
+		return 0;
+	return conn->column_batches ? conn->batch_rows : 0;
+}
+
 int
 PQserverVersion(const PGconn *conn)
 {
@@ -8342,6 +8405,161 @@ pqParseProtocolVersion(const char *value, ProtocolVersion *result, PGconn *conn,
 	return false;
 }
 
+/*
+ * Parse the "compression" option, which holds one or two space-separated
+ * specifications of the form [{client|server}-]METHOD[:DETAIL], and work
+ * out what to request from the server.  "client-" covers what we send,
+ * "server-" what the server sends, and a specification without a prefix
+ * covers both.  The only detail accepted is the compression level, either
+ * as a bare integer or as "level=N".
+ */
+static bool
+pqParseCompression(PGconn *conn)
+{
+	static const struct
+	{
+		const char *name;
+		pg_compress_algorithm algorithm;
+	}			methods[] =
+	{
+		{"none", PG_COMPRESSION_NONE},
+		{"gzip", PG_COMPRESSION_GZIP},
+		{"lz4", PG_COMPRESSION_LZ4},
+		{"zstd", PG_COMPRESSION_ZSTD},
+	};
+	pg_compress_algorithm algs[2] = {PG_COMPRESSION_NONE, PG_COMPRESSION_NONE};
+	const char *levels[2] = {NULL, NULL};
+	int			level_lens[2] = {0, 0};
+	const char *p = conn->compression;
+	PQExpBufferData request;
+
+	free(conn->compress_request);
+	conn->compress_request = NULL;
+	conn->compress_send_alg = PG_COMPRESSION_NONE;
+	conn->compress_recv_alg = PG_COMPRESSION_NONE;
+
+	if (p == NULL)
+		return true;
+
+	/* Index 0 is what we send, index 1 what the server sends */
+	while (*(p += strspn(p, " \t")) != '\0')
+	{
+		size_t		toklen = strcspn(p, " \t");
+		size_t		namelen;
+		const char *detail = NULL;
+		int			detaillen = 0;
+		bool		client = true;
+		bool		server = true;
+		int			i;
+
+		if (strncmp(p, "client-", 7) == 0)
+			server = false;
+		else if (strncmp(p, "server-", 7) == 0)
+			client = false;
+		if (!client || !server)
+		{
+			p += 7;
+			toklen -= 7;
+		}
+
+		namelen = strcspn(p, ": \t");
+		if (namelen < toklen)
+		{
+			char	   *end;
+
+			detail = p + namelen + 1;
+			detaillen = toklen - namelen - 1;
+			if (strncmp(detail, "level=", 6) == 0)
+			{
+				detail += 6;
+				detaillen -= 6;
+			}
+			(void) strtol(detail, &end, 10);
+			if (detaillen == 0 || end != detail + detaillen)
+			{
+				libpq_append_conn_error(conn, "invalid compression level: \"%.*s\"",
+										detaillen, detail);
+				return false;
+			}
+		}
+
+		for (i = 0; i < lengthof(methods); i++)
+		{
+			if (strlen(methods[i].name) == namelen &&
+				strncmp(p, methods[i].name, namelen) == 0)
+				break;
+		}
+		if (i == lengthof(methods))
+		{
+			libpq_append_conn_error(conn, "invalid %s value: \"%s\"",
+									"compression", conn->compression);
+			return false;
+		}
+		if (methods[i].algorithm != PG_COMPRESSION_NONE &&
+			!pg_compress_stream_supported(methods[i].algorithm))
+		{
+			libpq_append_conn_error(conn, "compression method \"%s\" is not supported by this build",
+									methods[i].name);
+			return false;
+		}
+
+		if (client)
+		{
+			algs[0] = methods[i].algorithm;
+			levels[0] = detail;
+			level_lens[0] = detaillen;
+		}
+		if (server)
+		{
+			algs[1] = methods[i].algorithm;
+			levels[1] = detail;
+			level_lens[1] = detaillen;
+		}
+
+		p += toklen;
+	}
+
+	conn->compress_send_alg = algs[0];
+	conn->compress_send_level = levels[0] ? atoi(levels[0]) :
+		pg_compress_stream_default_level(algs[0]);
+	conn->compress_recv_alg = algs[1];
+
+	if (algs[0] == PG_COMPRESSION_NONE && algs[1] == PG_COMPRESSION_NONE)
+		return true;
+
+	/*
+	 * Tell the server exactly what to do in both directions, leaving out
+	 * those without compression.
+	 */
+	initPQExpBuffer(&request);
+	for (int dir = 1; dir >= 0; dir--)
+	{
+		if (algs[dir] == PG_COMPRESSION_NONE)
+			continue;
+		if (request.len > 0)
+			appendPQExpBufferChar(&request, ' ');
+		for (int i = 0; i < lengthof(methods); i++)
+		{
+			if (methods[i].algorithm == algs[dir])
+				appendPQExpBuffer(&request, "%s-%s",
+								  dir == 0 ? "client" : "server",
+								  methods[i].name);
+		}
+		if (levels[dir])
+			appendPQExpBuffer(&request, ":level=%.*s",
+							  level_lens[dir], levels[dir]);
+	}
+	if (PQExpBufferBroken(&request))
+	{
+		termPQExpBuffer(&request);
+		libpq_append_conn_error(conn, "out of memory");
+		return false;
+	}
+	conn->compress_request = request.data;
+
+	return true;
+}
+
 /*
  * To keep the API consistent, the locking stubs are always provided, even
  * if they are not required.
@@ -28,6 +28,7 @@
 #include "libpq-fe.h"
 #include "libpq-int.h"
 #include "mb/pg_wchar.h"
+#include "port/pg_bswap.h"
 
 /* keep this in same order as ExecStatusType in libpq-fe.h */
 char	   *const pgresStatus[] = {
@@ -170,6 +171,9 @@ PQmakeEmptyPGresult(PGconn *conn, ExecStatusType status)
 	result->attDescs = NULL;
 	result->tuples = NULL;
 	result->tupArrSize = 0;
+	result->batches = NULL;
+	result->nbatches = 0;
+	result->batchArrSize = 0;
 	result->numParameters = 0;
 	result->paramDescs = NULL;
 	result->resultStatus = status;
@@ -760,12 +764,14 @@ PQclear(PGresult *res)
 		free(block);
 	}
 
-	/* Free the top-level tuple pointer array */
+	/* Free the top-level tuple pointer and batch arrays */
 	free(res->tuples);
+	free(res->batches);
 
 	/* zero out the pointer fields to catch programming errors */
 	res->attDescs = NULL;
 	res->tuples = NULL;
+	res->batches = NULL;
 	res->paramDescs = NULL;
 	res->errFields = NULL;
 	res->events = NULL;
@@ -1211,31 +1217,23 @@ pqSaveParameterStatus(PGconn *conn, const char *name, const char *value)
 
 
 /*
- * pqRowProcessor
- *	  Add the received row to the current async result (conn->result).
- *	  Returns 1 if OK, 0 if error occurred.
+ * pqGetRowResult
+ *	  Get the PGresult that received rows should be added to.
  *
- * On error, *errmsgp can be set to an error string to be returned.
- * (Such a string should already be translated via libpq_gettext().)
- * If it is left NULL, the error is presumed to be "out of memory".
+ * In partial-result mode, if we don't already have a partial PGresult
+ * then make one by cloning conn->result (which should hold the correct
+ * result metadata by now).  Then the original conn->result is moved over
+ * to saved_result so that we can re-use it as a reference for future
+ * partial results.  The saved result will become active again after
+ * pqPrepareAsyncResult() returns the partial result to the application.
+ *
+ * Returns NULL on malloc failure.
  */
-int
-pqRowProcessor(PGconn *conn, const char **errmsgp)
+static PGresult *
+pqGetRowResult(PGconn *conn)
 {
 	PGresult   *res = conn->result;
-	int			nfields = res->numAttributes;
-	const PGdataValue *columns = conn->rowBuf;
-	PGresAttValue *tup;
-	int			i;
 
-	/*
-	 * In partial-result mode, if we don't already have a partial PGresult
-	 * then make one by cloning conn->result (which should hold the correct
-	 * result metadata by now).  Then the original conn->result is moved over
-	 * to saved_result so that we can re-use it as a reference for future
-	 * partial results.  The saved result will become active again after
-	 * pqPrepareAsyncResult() returns the partial result to the application.
-	 */
 	if (conn->partialResMode && conn->saved_result == NULL)
 	{
 		/* Copy everything that should be in the result at this point */
@@ -1243,7 +1241,7 @@ pqRowProcessor(PGconn *conn, const char **errmsgp)
 						   PG_COPYRES_ATTRS | PG_COPYRES_EVENTS |
 						   PG_COPYRES_NOTICEHOOKS);
 		if (!res)
-			return 0;
+			return NULL;
 		/* Change result status to appropriate special value */
 		res->resultStatus = (conn->singleRowMode ? PGRES_SINGLE_TUPLE : PGRES_TUPLES_CHUNK);
 		/* And stash it as the active result */
@@ -1251,6 +1249,31 @@ pqRowProcessor(PGconn *conn, const char **errmsgp)
 		conn->result = res;
 	}
 
+	return res;
+}
+
+/*
+ * pqRowProcessor
+ *	  Add the received row to the current async result (conn->result).
+ *	  Returns 1 if OK, 0 if error occurred.
+ *
+ * On error, *errmsgp can be set to an error string to be returned.
+ * (Such a string should already be translated via libpq_gettext().)
+ * If it is left NULL, the error is presumed to be "out of memory".
+ */
+int
+pqRowProcessor(PGconn *conn, const char **errmsgp)
+{
+	PGresult   *res;
+	int			nfields = conn->result->numAttributes;
+	const PGdataValue *columns = conn->rowBuf;
+	PGresAttValue *tup;
+	int			i;
+
+	res = pqGetRowResult(conn);
+	if (!res)
+		return 0;
+
 	/*
 	 * Basically we just allocate space in the PGresult for each field and
 	 * copy the data over.
@@ -1307,6 +1330,115 @@ pqRowProcessor(PGconn *conn, const char **errmsgp)
 	return 1;
 }
 
+/* Padding of the parts of a ColumnBatch message */
+#define BATCH_PAD(n)	(((size_t) (n) + 3) & ~((size_t) 3))
+
+/*
+ * pqBatchProcessor
+ *	  Add a ColumnBatch message to the current result.
+ *
+ * ntups is the row count from the message header, and body/len the rest of
+ * the message.  The data is copied into the PGresult as a whole, and the
+ * value offsets of each column are converted to host byte order in place,
+ * so that applications can read the columns without any per-value work.
+ *
+ * Returns 1 if OK, 0 if error occurred.  As with pqRowProcessor, *errmsgp
+ * is left NULL on malloc failure, meaning "out of memory".
+ */
+int
+pqBatchProcessor(PGconn *conn, int ntups, const char *body, int len,
+				 const char **errmsgp)
+{
+	PGresult   *res;
+	int			nfields = conn->result->numAttributes;
+	PGresBatchColumn *columns;
+	char	   *copy;
+	char	   *p;
+	char	   *end;
+
+	res = pqGetRowResult(conn);
+	if (!res)
+		return 0;
+
+	columns = (PGresBatchColumn *)
+		pqResultAlloc(res, nfields * sizeof(PGresBatchColumn), true);
+	copy = pqResultAlloc(res, len, true);
+	if (columns == NULL || copy == NULL)
+		return 0;
+	memcpy(copy, body, len);
+
+	/*
+	 * Each column has ntups + 1 value offsets, then the validity bitmap and
+	 * the values, both padded to a multiple of 4 bytes.
+	 */
+	p = copy;
+	end = copy + len;
+	for (int i = 0; i < nfields; i++)
+	{
+		int		   *offsets = (int *) p;
+		size_t		vlen = BATCH_PAD(((size_t) ntups + 7) / 8);
+
+		if ((size_t) (end - p) / sizeof(int) < (size_t) ntups + 1)
+			goto bad_layout;
+		p += ((size_t) ntups + 1) * sizeof(int);
+
+		for (int j = 0; j <= ntups; j++)
+		{
+			offsets[j] = (int) pg_ntoh32(offsets[j]);
+			if (j == 0 ? offsets[j] != 0 : offsets[j] < offsets[j - 1])
+				goto bad_layout;
+		}
+
+		if ((size_t) (end - p) < vlen)
+			goto bad_layout;
+		columns[i].validity = (unsigned char *) p;
+		p += vlen;
+
+		if ((size_t) (end - p) < BATCH_PAD(offsets[ntups]))
+			goto bad_layout;
+		columns[i].data = p;
+		columns[i].offsets = offsets;
+		p += BATCH_PAD(offsets[ntups]);
+	}
+	if (p != end)
+		goto bad_layout;
+
+	/* Add the batch to the PGresult's batch array */
+	if (res->nbatches >= res->batchArrSize)
+	{
+		int			newSize;
+		PGresColumnBatch *newBatches;
+
+		if (res->batchArrSize >= INT_MAX / 2)
+		{
+			*errmsgp = libpq_gettext("PGresult cannot support more than INT_MAX column batches");
+			return 0;
+		}
+		newSize = (res->batchArrSize > 0) ? res->batchArrSize * 2 : 16;
+		newBatches = (PGresColumnBatch *)
+			realloc(res->batches, newSize * sizeof(PGresColumnBatch));
+		if (!newBatches)
+			return 0;
+		res->memorySize +=
+			(newSize - res->batchArrSize) * sizeof(PGresColumnBatch);
+		res->batchArrSize = newSize;
+		res->batches = newBatches;
+	}
+	res->batches[res->nbatches].ntups = ntups;
+	res->batches[res->nbatches].columns = columns;
+	res->nbatches++;
+
+	/* In partial-result mode, make each batch available immediately */
+	if (conn->partialResMode)
+		conn->asyncStatus = PGASYNC_READY_MORE;
+
+	return 1;
+
+bad_layout:
+	*errmsgp = libpq_gettext("invalid column layout in \"b\" message");
+	return 0;
+}
+
 
 /*
  * pqAllocCmdQueueEntry
@@ -3561,6 +3693,29 @@ check_tuple_field_number(const PGresult *res,
 	return true;
 }
 
+static int
+check_batch_field_number(const PGresult *res,
+						 int batch_num, int field_num)
+{
+	if (!res)
+		return false;			/* no way to display error message... */
+	if (batch_num < 0 || batch_num >= res->nbatches)
+	{
+		pqInternalNotice(&res->noticeHooks,
+						 "batch number %d is out of range 0..%d",
+						 batch_num, res->nbatches - 1);
+		return false;
+	}
+	if (field_num < 0 || field_num >= res->numAttributes)
+	{
+		pqInternalNotice(&res->noticeHooks,
+						 "column number %d is out of range 0..%d",
+						 field_num, res->numAttributes - 1);
+		return false;
+	}
+	return true;
+}
+
 static int
 check_param_number(const PGresult *res, int param_num)
 {
@@ -3925,6 +4080,72 @@ PQgetisnull(const PGresult *res, int tup_num, int field_num)
 		return 0;
 }
 
+/* PQnbatches:
+ *	returns the number of column batches in the result.  Rows received in
+ *	column batches are not counted by PQntuples.
+ */
+int
+PQnbatches(const PGresult *res)
+{
+	if (!res)
+		return 0;
+	return res->nbatches;
+}
+
+/* PQbatchNtuples:
+ *	returns the number of rows in the given column batch.
+ */
+int
+PQbatchNtuples(const PGresult *res, int batch_num)
+{
+	if (!res)
+		return 0;
+	if (batch_num < 0 || batch_num >= res->nbatches)
+	{
+		pqInternalNotice(&res->noticeHooks,
+						 "batch number %d is out of range 0..%d",
+						 batch_num, res->nbatches - 1);
+		return 0;
+	}
+	return res->batches[batch_num].ntups;
+}
+
+/* PQbatchValidity:
+ *	returns the validity bitmap of a column in a column batch: bit (i % 8)
+ *	of byte (i / 8) is set if the value in row i is not null.
+ */
+const unsigned char *
+PQbatchValidity(const PGresult *res, int batch_num, int field_num)
+{
+	if (!check_batch_field_number(res, batch_num, field_num))
+		return NULL;
+	return res->batches[batch_num].columns[field_num].validity;
+}
+
+/* PQbatchOffsets:
+ *	returns the value offsets of a column in a column batch.  The value in
+ *	row i starts at offset i in the column's data, and ends at offset i + 1.
+ */
+const int *
+PQbatchOffsets(const PGresult *res, int batch_num, int field_num)
+{
+	if (!check_batch_field_number(res, batch_num, field_num))
+		return NULL;
+	return res->batches[batch_num].columns[field_num].offsets;
+}
+
+/* PQbatchData:
+ *	returns the values of a column in a column batch, back to back and
+ *	without terminating zero bytes.
+ */
+const char *
+PQbatchData(const PGresult *res, int batch_num, int field_num)
+{
+	if (!check_batch_field_number(res, batch_num, field_num))
+		return NULL;
+	return res->batches[batch_num].columns[field_num].data;
+}
+
 /* PQnparams:
  *	returns the number of input parameters of a prepared statement.
  */
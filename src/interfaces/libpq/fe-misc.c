@@ -53,6 +53,8 @@
 
 static int	pqPutMsgBytes(const void *buf, size_t len, PGconn *conn);
 static int	pqSendSome(PGconn *conn, int len);
+static ssize_t pqReadSome(PGconn *conn, void *ptr, size_t len);
+static ssize_t pqWriteSome(PGconn *conn, const void *ptr, size_t len);
 static int	pqSocketCheck(PGconn *conn, int forRead, int forWrite,
 						  pg_usec_time_t end_time);
 
@@ -654,8 +656,8 @@ pqReadData(PGconn *conn)
 
 	/* OK, try to read some data */
 retry3:
-	nread = pqsecure_read(conn, conn->inBuffer + conn->inEnd,
-						  conn->inBufSize - conn->inEnd);
+	nread = pqReadSome(conn, conn->inBuffer + conn->inEnd,
+					   conn->inBufSize - conn->inEnd);
 	if (nread < 0)
 	{
 		switch (SOCK_ERRNO)
@@ -678,7 +680,7 @@ retry3:
 				goto definitelyFailed;
 
 			default:
-				/* pqsecure_read set the error message for us */
+				/* pqReadSome set the error message for us */
 				return -1;
 		}
 	}
@@ -704,6 +706,17 @@ retry3:
 			someread = 1;
 			goto retry3;
 		}
+
+		/*
+		 * Data the decompressor holds back would not wake up a caller
+		 * waiting on the socket, so make room for it and get it now.
+		 */
+		if (conn->zinPending &&
+			pqCheckInBufferSpace(conn->inEnd + (size_t) 8192, conn) == 0)
+		{
+			someread = 1;
+			goto retry3;
+		}
 		return 1;
 	}
 
@@ -749,8 +762,8 @@ retry3:
 	 * arrived.
 	 */
 retry4:
-	nread = pqsecure_read(conn, conn->inBuffer + conn->inEnd,
-						  conn->inBufSize - conn->inEnd);
+	nread = pqReadSome(conn, conn->inBuffer + conn->inEnd,
+					   conn->inBufSize - conn->inEnd);
 	if (nread < 0)
 	{
 		switch (SOCK_ERRNO)
@@ -773,7 +786,7 @@ retry4:
 				goto definitelyFailed;
 
 			default:
-				/* pqsecure_read set the error message for us */
+				/* pqReadSome set the error message for us */
 				return -1;
 		}
 	}
@@ -862,12 +875,12 @@ pqSendSome(PGconn *conn, int len)
 	}
 
 	/* while there's still data to send */
-	while (len > 0)
+	while (len > 0 || conn->zoutLen > 0)
 	{
 		int			sent;
 
 #ifndef WIN32
-		sent = pqsecure_write(conn, ptr, len);
+		sent = pqWriteSome(conn, ptr, len);
 #else
 
 		/*
@@ -875,7 +888,7 @@ pqSendSome(PGconn *conn, int len)
 		 * failure-point appears to be different in different versions of
 		 * Windows, but 64k should always be safe.
 		 */
-		sent = pqsecure_write(conn, ptr, Min(len, 65536));
+		sent = pqWriteSome(conn, ptr, Min(len, 65536));
 #endif
 
 		if (sent < 0)
@@ -897,6 +910,7 @@ pqSendSome(PGconn *conn, int len)
 				default:
 					/* Discard queued data; no chance it'll ever be sent */
 					conn->outCount = 0;
+					conn->zoutLen = 0;
 
 					/* Absorb input data if any, and detect socket closure */
 					if (conn->sock != PGINVALID_SOCKET)
@@ -925,7 +939,7 @@ pqSendSome(PGconn *conn, int len)
 			remaining -= sent;
 		}
 
-		if (len > 0)
+		if (len > 0 || conn->zoutLen > 0)
 		{
 			/*
 			 * We didn't send it all, wait till we can send more.
@@ -983,6 +997,199 @@ pqSendSome(PGconn *conn, int len)
 }
 
 
+/*
+ * pqReadSome: read data, decompressing it if enabled
+ *
+ * Behaves like pqsecure_read().  With compression, conn->zinPending is set
+ * on return if the decompressor might have more output without reading any
+ * more from the socket.
+ */
+static ssize_t
+pqReadSome(PGconn *conn, void *ptr, size_t len)
+{
+	if (conn->decompressor == NULL)
+		return pqsecure_read(conn, ptr, len);
+
+	for (;;)
+	{
+		size_t		srclen = conn->zinEnd - conn->zinStart;
+		size_t		dstlen = len;
+		ssize_t		nread;
+
+		/*
+		 * Try even with no input at hand, as the decompressor might be
+		 * holding back output that didn't fit before.
+		 */
+		if (pg_compress_stream_decompress(conn->decompressor,
+										  conn->zinBuffer + conn->zinStart,
+										  &srclen, ptr, &dstlen) < 0)
+		{
+			libpq_append_conn_error(conn, "could not decompress data from server: %s",
+									pg_compress_stream_error(conn->decompressor));
+			SOCK_ERRNO_SET(0);
+			return -1;
+		}
+		conn->zinStart += srclen;
+		conn->zinPending = (dstlen == len);
+		if (dstlen > 0)
+			return dstlen;
+
+		/* Need more input; left-justify what's left of it first */
+		if (conn->zinStart > 0)
+		{
+			memmove(conn->zinBuffer, conn->zinBuffer + conn->zinStart,
+					conn->zinEnd - conn->zinStart);
+			conn->zinEnd -= conn->zinStart;
+			conn->zinStart = 0;
+		}
+
+		nread = pqsecure_read(conn, conn->zinBuffer + conn->zinEnd,
+							  conn->zinBufSize - conn->zinEnd);
+		if (nread <= 0)
+			return nread;
+		conn->zinEnd += nread;
+	}
+}
+
+/*
+ * pqWriteSome: send data, compressing it first if enabled
+ *
+ * Behaves like pqsecure_write(), except that with compression, data can be
+ * consumed before all of its compressed form has been sent, if the socket
+ * would block.  The rest goes out first thing in the next call, and the
+ * caller must keep calling, with len == 0 if need be, as long as
+ * conn->zoutLen > 0.
+ */
+static ssize_t
+pqWriteSome(PGconn *conn, const void *ptr, size_t len)
+{
+	ssize_t		sent;
+
+	if (conn->compressor == NULL)
+		return pqsecure_write(conn, ptr, len);
+
+	while (conn->zoutLen > 0)
+	{
+		sent = pqsecure_write(conn, conn->zoutPtr, conn->zoutLen);
+		if (sent < 0)
+			return sent;
+		conn->zoutPtr += sent;
+		conn->zoutLen -= sent;
+	}
+	if (len == 0)
+		return 0;
+
+	if (pg_compress_stream_compress(conn->compressor, ptr, &len,
+									&conn->zoutPtr, &conn->zoutLen) < 0)
+	{
+		libpq_append_conn_error(conn, "could not compress data to send to server: %s",
+								pg_compress_stream_error(conn->compressor));
+		SOCK_ERRNO_SET(0);
+		return -1;
+	}
+
+	/*
+	 * The input is consumed now, so report it as sent unless sending fails
+	 * for good.  Anything that can't be sent right away waits for the next
+	 * call.
+	 */
+	while (conn->zoutLen > 0)
+	{
+		sent = pqsecure_write(conn, conn->zoutPtr, conn->zoutLen);
+		if (sent < 0)
+		{
+			int			save_errno = SOCK_ERRNO;
+
+			if (save_errno == EINTR ||
+#ifdef EAGAIN
+				save_errno == EAGAIN ||
+#endif
+#if defined(EWOULDBLOCK) && (!defined(EAGAIN) || (EWOULDBLOCK != EAGAIN))
+				save_errno == EWOULDBLOCK ||
+#endif
+				false)
+				break;
+			return sent;
+		}
+		conn->zoutPtr += sent;
+		conn->zoutLen -= sent;
+	}
+
+	return len;
+}
+
+/*
+ * pqStartCompression: switch to protocol compression, as negotiated
+ *
+ * Called on receipt of the first ReadyForQuery message, after which the
+ * server compresses what it sends and expects the same from us.  Anything
+ * already read beyond that message is compressed, so it's moved over to be
+ * decompressed.
+ *
+ * Returns 0 on success, or -1 with conn->errorMessage set.
+ */
+int
+pqStartCompression(PGconn *conn)
+{
+	conn->compression_pending = false;
+
+	if (conn->compress_send_alg != PG_COMPRESSION_NONE)
+	{
+		conn->compressor = pg_compress_stream_create(conn->compress_send_alg,
+													 conn->compress_send_level,
+													 false);
+		if (conn->compressor == NULL)
+			goto fail;
+	}
+
+	if (conn->compress_recv_alg != PG_COMPRESSION_NONE)
+	{
+		int			leftover = conn->inEnd - conn->inCursor;
+
+		conn->decompressor = pg_compress_stream_create(conn->compress_recv_alg,
+													   0, true);
+		if (conn->decompressor == NULL)
+			goto fail;
+
+		conn->zinBufSize = Max(leftover, 16 * 1024);
+		conn->zinBuffer = malloc(conn->zinBufSize);
+		if (conn->zinBuffer == NULL)
+			goto fail;
+		memcpy(conn->zinBuffer, conn->inBuffer + conn->inCursor, leftover);
+		conn->zinStart = 0;
+		conn->zinEnd = leftover;
+		conn->zinPending = (leftover > 0);
+		conn->inEnd = conn->inCursor;
+	}
+
+	return 0;
+
+fail:
+	libpq_append_conn_error(conn, "could not start protocol compression");
+	pqEndCompression(conn);
+	return -1;
+}
+
+/*
+ * pqEndCompression: release protocol compression state
+ */
+void
+pqEndCompression(PGconn *conn)
+{
+	if (conn->compressor)
+		pg_compress_stream_free(conn->compressor);
+	conn->compressor = NULL;
+	conn->zoutPtr = NULL;
+	conn->zoutLen = 0;
+	if (conn->decompressor)
+		pg_compress_stream_free(conn->decompressor);
+	conn->decompressor = NULL;
+	free(conn->zinBuffer);
+	conn->zinBuffer = NULL;
+	conn->zinBufSize = conn->zinStart = conn->zinEnd = 0;
+	conn->zinPending = false;
+}
+
 /*
  * pqFlush: send any data waiting in the output buffer
  *
@@ -993,7 +1200,7 @@ pqSendSome(PGconn *conn, int len)
 int
 pqFlush(PGconn *conn)
 {
-	if (conn->outCount > 0)
+	if (conn->outCount > 0 || conn->zoutLen > 0)
 	{
 		if (conn->Pfdebug)
 			fflush(conn->Pfdebug);
@@ -1107,6 +1314,10 @@ pqSocketCheck(PGconn *conn, int forRead, int forWrite, pg_usec_time_t end_time)
 			return 1;
 		}
 #endif
+
+		/* Likewise for compressed data we haven't decompressed yet */
+		if (forRead && conn->zinPending)
+			return 1;
 	}
 
 	/* We will retry as long as we get EINTR */
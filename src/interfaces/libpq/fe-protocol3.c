@@ -37,6 +37,7 @@
  */
 #define VALID_LONG_MESSAGE_TYPE(id) \
 	((id) == PqMsg_CopyData || \
+	 (id) == PqMsg_ColumnBatch || \
 	 (id) == PqMsg_DataRow || \
 	 (id) == PqMsg_ErrorResponse || \
 	 (id) == PqMsg_FunctionCallResponse || \
@@ -50,6 +51,7 @@ static void handleSyncLoss(PGconn *conn, char id, int msgLength);
 static int	getRowDescriptions(PGconn *conn, int msgLength);
 static int	getParamDescriptions(PGconn *conn, int msgLength);
 static int	getAnotherTuple(PGconn *conn, int msgLength);
+static int	getColumnBatch(PGconn *conn, int msgLength);
 static int	getParameterStatus(PGconn *conn);
 static int	getBackendKeyData(PGconn *conn, int msgLength);
 static int	getNotify(PGconn *conn);
@@ -227,6 +229,13 @@ pqParseInput3(PGconn *conn)
 				case PqMsg_ReadyForQuery:
 					if (getReadyForQuery(conn))
 						return;
+					/* Protocol compression, if any, starts after the first one */
+					if (conn->compression_pending &&
+						pqStartCompression(conn) < 0)
+					{
+						handleFatalError(conn);
+						return;
+					}
 					if (conn->pipelineStatus != PQ_PIPELINE_OFF)
 					{
 						conn->result = PQmakeEmptyPGresult(conn,
@@ -407,6 +416,31 @@ pqParseInput3(PGconn *conn)
 						conn->inCursor += msgLength;
 					}
 					break;
+				case PqMsg_ColumnBatch:
+					if (conn->result != NULL &&
+						(conn->result->resultStatus == PGRES_TUPLES_OK ||
+						 conn->result->resultStatus == PGRES_TUPLES_CHUNK))
+					{
+						/* Read a batch of rows of a normal query response */
+						if (getColumnBatch(conn, msgLength))
+							return;
+					}
+					else if (conn->error_result ||
+							 (conn->result != NULL &&
+							  conn->result->resultStatus == PGRES_FATAL_ERROR))
+					{
+						/* As above, discard rows till the end of the query */
+						conn->inCursor += msgLength;
+					}
+					else
+					{
+						/* Set up to report error at end of query */
+						libpq_append_conn_error(conn, "server sent data (\"b\" message) without prior row description (\"T\" message)");
+						pqSaveErrorResult(conn);
+						/* Discard the unexpected message */
+						conn->inCursor += msgLength;
+					}
+					break;
 				case PqMsg_CopyInResponse:
 					if (getCopyStart(conn, PGRES_COPY_IN))
 						return;
@@ -886,6 +920,70 @@ advance_and_error:
 }
 
 
+/*
+ * parseInput subroutine to read a 'b' (column batch) message.
+ * We check the header and hand the columns to the batch processor.
+ * Returns: 0 if processed message successfully, EOF to suspend parsing
+ * (the latter case is not actually used currently).
+ */
+static int
+getColumnBatch(PGconn *conn, int msgLength)
+{
+	PGresult   *result = conn->result;
+	int			nfields = result->numAttributes;
+	const char *errmsg;
+	int			ntups;
+	int			batchnfields;
+	int			reserved;
+	int			msgEnd = conn->inStart + 5 + msgLength;
+
+	if (pqGetInt(&ntups, 4, conn) ||
+		pqGetInt(&batchnfields, 2, conn) ||
+		pqGetInt(&reserved, 2, conn))
+	{
+		/* We should not run out of data here, so complain */
+		errmsg = libpq_gettext("insufficient data in \"b\" message");
+		goto advance_and_error;
+	}
+
+	if (batchnfields != nfields || ntups < 0)
+	{
+		errmsg = libpq_gettext("unexpected field count in \"b\" message");
+		goto advance_and_error;
+	}
+
+	/* Process the batch, consuming the rest of the message */
+	errmsg = NULL;
+	if (pqBatchProcessor(conn, ntups, conn->inBuffer + conn->inCursor,
+						 msgEnd - conn->inCursor, &errmsg))
+	{
+		conn->inCursor = msgEnd;
+		return 0;				/* normal, successful exit */
+	}
+
+	/* pqBatchProcessor failed, fall through to report it */
+
+advance_and_error:
+
+	/* See getAnotherTuple */
+	pqClearAsyncResult(conn);
+
+	if (!errmsg)
+		errmsg = libpq_gettext("out of memory for query result");
+
+	appendPQExpBuffer(&conn->errorMessage, "%s\n", errmsg);
+	pqSaveErrorResult(conn);
+
+	/*
+	 * Show the message as fully consumed, else pqParseInput3 will overwrite
+	 * our error with a complaint about that.
+	 */
+	conn->inCursor = msgEnd;
+
+	return 0;
+}
+
+
 /*
  * Attempt to read an Error or Notice response message.
  * This is possible in several places, so we break it out as a subroutine.
@@ -1499,8 +1597,9 @@ pqGetNegotiateProtocolVersion3(PGconn *conn)
 	conn->pversion = their_version;
 
 	/*
-	 * We don't currently request any protocol extensions, so we don't expect
-	 * the server to reply with any either.
+	 * The only protocol extensions we request are compression and column
+	 * batches, both of which we can do without if the server can't provide
+	 * them.
 	 */
 	for (int i = 0; i < num; i++)
 	{
@@ -1513,6 +1612,18 @@ pqGetNegotiateProtocolVersion3(PGconn *conn)
 			libpq_append_conn_error(conn, "received invalid protocol negotiation message: server reported unsupported parameter name without a \"%s\" prefix (\"%s\")", "_pq_.", conn->workBuffer.data);
 			goto failure;
 		}
+		if (strcmp(conn->workBuffer.data, "_pq_.compression") == 0 &&
+			conn->compression_pending)
+		{
+			conn->compression_pending = false;
+			continue;
+		}
+		if (strcmp(conn->workBuffer.data, "_pq_.column_batch_rows") == 0 &&
+			conn->column_batches)
+		{
+			conn->column_batches = false;
+			continue;
+		}
 		libpq_append_conn_error(conn, "received invalid protocol negotiation message: server reported an unsupported parameter that was not requested (\"%s\")", conn->workBuffer.data);
 		goto failure;
 	}
@@ -2464,6 +2575,17 @@ build_startup_packet(const PGconn *conn, char *packet,
 	if (conn->client_encoding_initial && conn->client_encoding_initial[0])
 		ADD_STARTUP_OPTION("client_encoding", conn->client_encoding_initial);
 
+	/* Protocol options */
+	if (conn->compress_request)
+		ADD_STARTUP_OPTION("_pq_.compression", conn->compress_request);
+	if (conn->batch_rows > 0)
+	{
+		char		batch_rows[16];
+
+		snprintf(batch_rows, sizeof(batch_rows), "%d", conn->batch_rows);
+		ADD_STARTUP_OPTION("_pq_.column_batch_rows", batch_rows);
+	}
+
 	/* Add any environment-driven GUC settings needed */
 	for (next_eo = options; next_eo->envName; next_eo++)
 	{
@@ -83,6 +83,38 @@ static int	pgconn_bio_write(BIO *h, const char *buf, int size);
 static BIO_METHOD *pgconn_bio_method(void);
 static int	ssl_set_pgconn_bio(PGconn *conn);
 
+#ifdef USE_KTLS
+
+/*
+ * OpenSSL's socket BIO, which we use for kernel TLS, writes to the socket
+ * without the SIGPIPE protection of pqsecure_raw_write(), so block SIGPIPE
+ * around any OpenSSL call that might write.
+ */
+struct ktls_sigpipe_info
+{
+	bool		blocked;
+	sigset_t	oldsigmask;
+	bool		sigpipe_pending;
+};
+
+#define DECLARE_KTLS_SIGPIPE_INFO(spinfo) struct ktls_sigpipe_info spinfo
+
+#define DISABLE_KTLS_SIGPIPE(conn, spinfo) \
+	((spinfo).blocked = (conn)->ssl_ktls && !(conn)->sigpipe_so && \
+	 pq_block_sigpipe(&(spinfo).oldsigmask, &(spinfo).sigpipe_pending) == 0)
+
+#define RESTORE_KTLS_SIGPIPE(spinfo) \
+	do { \
+		if ((spinfo).blocked) \
+			pq_reset_sigpipe(&(spinfo).oldsigmask, \
+							 (spinfo).sigpipe_pending, true); \
+	} while (0)
+#else
+#define DECLARE_KTLS_SIGPIPE_INFO(spinfo)
+#define DISABLE_KTLS_SIGPIPE(conn, spinfo) ((void) 0)
+#define RESTORE_KTLS_SIGPIPE(spinfo) ((void) 0)
+#endif
+
 static pthread_mutex_t ssl_config_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static PQsslKeyPassHook_OpenSSL_type PQsslKeyPassHook = NULL;
@@ -123,6 +155,8 @@ pgtls_read(PGconn *conn, void *ptr, size_t len)
 	int			err;
 	unsigned long ecode;
 
+	DECLARE_KTLS_SIGPIPE_INFO(spinfo);
+
 rloop:
 
 	/*
@@ -134,9 +168,11 @@ rloop:
 	 * to call ERR_get_error() themselves (after their own I/O operations),
 	 * pro-actively clear the per-thread error queue now.
 	 */
+	DISABLE_KTLS_SIGPIPE(conn, spinfo);
 	SOCK_ERRNO_SET(0);
 	ERR_clear_error();
 	n = SSL_read(conn->ssl, ptr, len);
+	RESTORE_KTLS_SIGPIPE(spinfo);
 	err = SSL_get_error(conn->ssl, n);
 
 	/*
@@ -245,9 +281,13 @@ pgtls_write(PGconn *conn, const void *ptr, size_t len)
 	int			err;
 	unsigned long ecode;
 
+	DECLARE_KTLS_SIGPIPE_INFO(spinfo);
+
+	DISABLE_KTLS_SIGPIPE(conn, spinfo);
 	SOCK_ERRNO_SET(0);
 	ERR_clear_error();
 	n = SSL_write(conn->ssl, ptr, len);
+	RESTORE_KTLS_SIGPIPE(spinfo);
 	err = SSL_get_error(conn->ssl, n);
 	ecode = (err != SSL_ERROR_NONE || n < 0) ? ERR_get_error() : 0;
 	switch (err)
@@ -1339,9 +1379,13 @@ open_client_SSL(PGconn *conn)
 {
 	int			r;
 
+	DECLARE_KTLS_SIGPIPE_INFO(spinfo);
+
+	DISABLE_KTLS_SIGPIPE(conn, spinfo);
 	SOCK_ERRNO_SET(0);
 	ERR_clear_error();
 	r = SSL_connect(conn->ssl);
+	RESTORE_KTLS_SIGPIPE(spinfo);
 	if (r <= 0)
 	{
 		int			save_errno = SOCK_ERRNO;
@@ -1511,11 +1555,16 @@ pgtls_close(PGconn *conn)
 			 * thread callbacks, so set a flag here and check at the end.
 			 */
 
+			DECLARE_KTLS_SIGPIPE_INFO(spinfo);
+
+			DISABLE_KTLS_SIGPIPE(conn, spinfo);
 			SSL_shutdown(conn->ssl);
+			RESTORE_KTLS_SIGPIPE(spinfo);
 			SSL_free(conn->ssl);
 			conn->ssl = NULL;
 			conn->ssl_in_use = false;
 			conn->ssl_handshake_started = false;
+			conn->ssl_ktls = false;
 		}
 
 		if (conn->peer)
@@ -1880,6 +1929,20 @@ ssl_set_pgconn_bio(PGconn *conn)
 	BIO		   *bio;
 	BIO_METHOD *bio_method;
 
+#ifdef USE_KTLS
+
+	/*
+	 * Kernel TLS needs OpenSSL's own socket BIO, which is what passes the
+	 * session keys to the kernel.
+	 */
+	if (conn->sslktls && conn->sslktls[0] == '1')
+	{
+		SSL_set_options(conn->ssl, SSL_OP_ENABLE_KTLS);
+		conn->ssl_ktls = true;
+		return SSL_set_fd(conn->ssl, conn->sock);
+	}
+#endif
+
 	bio_method = pgconn_bio_method();
 	if (bio_method == NULL)
 		return 0;
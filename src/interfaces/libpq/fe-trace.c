@@ -307,6 +307,17 @@ pqTraceOutput_DataRow(FILE *f, const char *message, int *cursor)
 	}
 }
 
+static void
+pqTraceOutput_ColumnBatch(FILE *f, const char *message, int *cursor,
+						  int length)
+{
+	fprintf(f, "ColumnBatch\t");
+	pqTraceOutputInt32(f, message, cursor, false);
+	pqTraceOutputInt16(f, message, cursor);
+	pqTraceOutputInt16(f, message, cursor);
+	pqTraceOutputNchar(f, length - *cursor + 1, message, cursor, false);
+}
+
 static void
 pqTraceOutput_Describe(FILE *f, const char *message, int *cursor)
 {
@@ -691,6 +702,10 @@ pqTraceOutputMessage(PGconn *conn, const char *message, bool toServer)
 			pqTraceOutput_CopyData(conn->Pfdebug, message, &logCursor,
 								   length, regress);
 			break;
+		case PqMsg_ColumnBatch:
+			pqTraceOutput_ColumnBatch(conn->Pfdebug, message, &logCursor,
+									  length);
+			break;
 		case PqMsg_Describe:
 			/* Describe(F) and DataRow(B) use the same identifier. */
 			Assert(PqMsg_Describe == PqMsg_DataRow);
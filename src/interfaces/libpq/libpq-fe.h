@@ -63,6 +63,10 @@ extern "C"
 /* Indicates presence of the PQAUTHDATA_PROMPT_OAUTH_DEVICE authdata hook */
 #define LIBPQ_HAS_PROMPT_OAUTH_DEVICE 1
 
+/* Features added in PostgreSQL v19: */
+/* Indicates presence of PQcolumnBatchRows, PQnbatches and friends */
+#define LIBPQ_HAS_COLUMN_BATCHES 1
+
 /*
  * Option flags for PQcopyResult
  */
@@ -410,6 +414,7 @@ extern const char *PQparameterStatus(const PGconn *conn,
 									 const char *paramName);
 extern int	PQprotocolVersion(const PGconn *conn);
 extern int	PQfullProtocolVersion(const PGconn *conn);
+extern int	PQcolumnBatchRows(const PGconn *conn);
 extern int	PQserverVersion(const PGconn *conn);
 extern char *PQerrorMessage(const PGconn *conn);
 extern int	PQsocket(const PGconn *conn);
@@ -604,6 +609,14 @@ extern char *PQcmdTuples(PGresult *res);
 extern char *PQgetvalue(const PGresult *res, int tup_num, int field_num);
 extern int	PQgetlength(const PGresult *res, int tup_num, int field_num);
 extern int	PQgetisnull(const PGresult *res, int tup_num, int field_num);
+extern int	PQnbatches(const PGresult *res);
+extern int	PQbatchNtuples(const PGresult *res, int batch_num);
+extern const unsigned char *PQbatchValidity(const PGresult *res,
+											int batch_num, int field_num);
+extern const int *PQbatchOffsets(const PGresult *res,
+								 int batch_num, int field_num);
+extern const char *PQbatchData(const PGresult *res,
+							   int batch_num, int field_num);
 extern int	PQnparams(const PGresult *res);
 extern Oid	PQparamtype(const PGresult *res, int param_num);
 
@@ -75,6 +75,7 @@ typedef struct
 #endif
 #endif							/* USE_OPENSSL */
 
+#include "common/compress_stream.h"
 #include "common/pg_prng.h"
 
 /*
@@ -135,6 +136,24 @@ typedef struct pgresAttValue
 	char	   *value;			/* actual value, plus terminating zero byte */
 } PGresAttValue;
 
+/*
+ * A ColumnBatch message stored in a PGresult.  The pointers point into a
+ * copy of the message, whose value offsets have been converted to host byte
+ * order in place.
+ */
+typedef struct pgresBatchColumn
+{
+	const unsigned char *validity;	/* bit set for each non-null value */
+	const int  *offsets;		/* ntups + 1 value boundaries in data */
+	const char *data;			/* the values, back to back */
+} PGresBatchColumn;
+
+typedef struct pgresColumnBatch
+{
+	int			ntups;			/* number of rows in the batch */
+	PGresBatchColumn *columns;	/* one per attribute */
+} PGresColumnBatch;
+
 /* Typedef for message-field list entries */
 typedef struct pgMessageField
 {
@@ -169,6 +188,9 @@ struct pg_result
 	PGresAttValue **tuples;		/* each PGresult tuple is an array of
 								 * PGresAttValue's */
 	int			tupArrSize;		/* allocated size of tuples array */
+	PGresColumnBatch *batches;	/* rows received in column batches */
+	int			nbatches;
+	int			batchArrSize;	/* allocated size of batches array */
 	int			numParameters;
 	PGresParamDesc *paramDescs;
 	ExecStatusType resultStatus;
@@ -199,8 +221,8 @@ struct pg_result
 
 	/*
 	 * Space management information.  Note that attDescs and error stuff, if
-	 * not null, point into allocated blocks.  But tuples points to a
-	 * separately malloc'd block, so that we can realloc it.
+	 * not null, point into allocated blocks.  But tuples and batches point
+	 * to separately malloc'd blocks, so that we can realloc them.
 	 */
 	PGresult_data *curBlock;	/* most recently allocated block */
 	int			curOffset;		/* start offset of free space in block */
@@ -414,6 +436,7 @@ struct pg_conn
 	char	   *sslcrl;			/* certificate revocation list filename */
 	char	   *sslcrldir;		/* certificate revocation list directory name */
 	char	   *sslsni;			/* use SSL SNI extension (0 or 1) */
+	char	   *sslktls;		/* try kernel TLS offload (0 or 1) */
 	char	   *requirepeer;	/* required peer credentials for local sockets */
 	char	   *gssencmode;		/* GSS mode (require,prefer,disable) */
 	char	   *krbsrvname;		/* Kerberos service name */
@@ -427,6 +450,8 @@ struct pg_conn
 	char	   *target_session_attrs;	/* desired session properties */
 	char	   *require_auth;	/* name of the expected auth method */
 	char	   *load_balance_hosts; /* load balance over hosts */
+	char	   *compression;	/* protocol compression to request */
+	char	   *column_batch_rows;	/* rows per column batch to request */
 	char	   *scram_client_key;	/* base64-encoded SCRAM client key */
 	char	   *scram_server_key;	/* base64-encoded SCRAM server key */
 	char	   *sslkeylogfile;	/* where should the client write ssl keylogs */
@@ -547,6 +572,12 @@ struct pg_conn
 	uint8	   *scram_server_key_binary;	/* binary SCRAM server key */
 	ProtocolVersion min_pversion;	/* protocol version to request */
 	ProtocolVersion max_pversion;	/* protocol version to request */
+	pg_compress_algorithm compress_send_alg;	/* how we compress */
+	int			compress_send_level;
+	pg_compress_algorithm compress_recv_alg;	/* how the server compresses */
+	char	   *compress_request;	/* _pq_.compression to send, or NULL */
+	int			batch_rows;		/* parsed column_batch_rows, or 0 */
+	bool		column_batches; /* did the server accept batch_rows? */
 
 	/* Miscellaneous stuff */
 	int			be_pid;			/* PID of backend --- needed for cancels */
@@ -589,6 +620,23 @@ struct pg_conn
 								 * msg has no length word */
 	int			outMsgEnd;		/* offset to msg end (so far) */
 
+	/*
+	 * Protocol compression state.  Compression starts after the first
+	 * ReadyForQuery message, while compression_pending is set.  Compressed
+	 * output that couldn't be sent yet is at zoutPtr, and compressed input
+	 * waiting to be decompressed into inBuffer is in zinBuffer.
+	 */
+	bool		compression_pending;	/* was compression requested? */
+	pg_compress_stream *compressor; /* for data sent, or NULL */
+	pg_compress_stream *decompressor;	/* for data received, or NULL */
+	const char *zoutPtr;		/* compressed data waiting to be sent */
+	size_t		zoutLen;
+	char	   *zinBuffer;		/* compressed data received */
+	int			zinBufSize;		/* allocated size of zinBuffer */
+	int			zinStart;		/* offset to first undecompressed byte */
+	int			zinEnd;			/* offset to first position after data */
+	bool		zinPending;		/* may the decompressor hold back output? */
+
 	/* Row processor interface workspace */
 	PGdataValue *rowBuf;		/* array for passing values to rowProcessor */
 	int			rowBufLen;		/* number of entries allocated in rowBuf */
@@ -621,6 +669,7 @@ struct pg_conn
 	bool		ssl_handshake_started;
 	bool		ssl_cert_requested; /* Did the server ask us for a cert? */
 	bool		ssl_cert_sent;	/* Did we send one in reply? */
+	bool		ssl_ktls;		/* using OpenSSL's socket BIO for kernel TLS? */
 	bool		last_read_was_eof;
 
 #ifdef USE_SSL
@@ -758,6 +807,8 @@ extern void pqSaveMessageField(PGresult *res, char code,
 extern int	pqSaveParameterStatus(PGconn *conn, const char *name,
 								  const char *value);
 extern int	pqRowProcessor(PGconn *conn, const char **errmsgp);
+extern int	pqBatchProcessor(PGconn *conn, int ntups, const char *body,
+							 int len, const char **errmsgp);
 extern void pqCommandQueueAdvance(PGconn *conn, bool isReadyForQuery,
 								  bool gotSync);
 extern int	PQsendQueryContinue(PGconn *conn, const char *query);
@@ -808,6 +859,8 @@ extern int	pqPutMsgStart(char msg_type, PGconn *conn);
 extern int	pqPutMsgEnd(PGconn *conn);
 extern int	pqReadData(PGconn *conn);
 extern int	pqFlush(PGconn *conn);
+extern int	pqStartCompression(PGconn *conn);
+extern void pqEndCompression(PGconn *conn);
 extern int	pqWait(int forRead, int forWrite, PGconn *conn);
 extern int	pqWaitTimed(int forRead, int forWrite, PGconn *conn,
 						pg_usec_time_t end_time);
@@ -0,0 +1,97 @@
+# Copyright (c) 2025, PostgreSQL Global Development Group
+
+# Tests for protocol compression, requested with the "compression"
+# connection option.
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Utils;
+use PostgreSQL::Test::Cluster;
+use Test::More;
+
+my @methods;
+push @methods, 'gzip' if check_pg_config("#define HAVE_LIBZ 1");
+push @methods, 'lz4' if check_pg_config("#define USE_LZ4 1");
+push @methods, 'zstd' if check_pg_config("#define USE_ZSTD 1");
+
+if (!@methods)
+{
+	plan skip_all => 'no compression method supported by this build';
+}
+
+my $node = PostgreSQL::Test::Cluster->new('node');
+$node->init;
+$node->append_conf('postgresql.conf', "log_connections = on\n");
+$node->start;
+
+$node->safe_psql('postgres', 'CREATE TABLE t (a int, b text)');
+
+my $connstr = $node->connstr('postgres');
+
+# Enough data in both directions to span many compressed chunks.
+my $big = 'x' x 1_000_000;
+my $copy_data = join('', map { "$_\trow $_\n" } 1 .. 50000);
+
+foreach my $method (@methods)
+{
+	$node->connect_ok(
+		"$connstr compression=$method",
+		"$method in both directions",
+		sql => "SELECT length(string_agg(md5(i::text), '')) "
+		  . "FROM generate_series(1, 100000) i; "
+		  . "SELECT length('$big');",
+		expected_stdout => qr/^3200000\n1000000$/,
+		log_like => [
+			qr/connection authorized: .* compression \(send=$method, receive=$method\)/
+		]);
+
+	$node->connect_ok(
+		"$connstr compression=$method:level=1",
+		"$method with COPY",
+		sql => "TRUNCATE t;\n"
+		  . "COPY t FROM STDIN;\n"
+		  . $copy_data
+		  . "\\.\n"
+		  . "SELECT count(*), sum(length(b)) FROM t;",
+		expected_stdout => qr/^50000\|438894$/);
+}
+
+my $method = $methods[0];
+
+$node->connect_ok(
+	"$connstr compression=server-$method",
+	"$method from the server only",
+	sql => "SELECT 1",
+	log_like =>
+	  [qr/connection authorized: .* compression \(send=$method, receive=none\)/]
+);
+
+$node->connect_ok(
+	"$connstr compression='client-$method server-none'",
+	"$method from the client only",
+	sql => "SELECT 1",
+	log_like =>
+	  [qr/connection authorized: .* compression \(send=none, receive=$method\)/]
+);
+
+$node->connect_ok(
+	"$connstr compression=none",
+	"no compression",
+	sql => "SELECT 1",
+	log_unlike => [qr/compression \(/]);
+
+$node->connect_fails(
+	"$connstr compression=nosuchmethod",
+	"unknown method",
+	expected_stderr => qr/invalid compression value: "nosuchmethod"/);
+
+$node->connect_fails(
+	"$connstr compression=$method:fast",
+	"invalid level",
+	expected_stderr => qr/invalid compression level: "fast"/);
+
+$node->connect_fails(
+	"$connstr compression=$method:level=1000",
+	"level rejected by the server",
+	expected_stderr => qr/invalid value for parameter "_pq_.compression"/);
+
+done_testing();
@@ -116,6 +116,18 @@ pg_numa_get_max_node(void)
 	return numa_max_node();
 }
 
+/*
+ * Have the not yet allocated pages of the given range come from the node of
+ * the CPU that first touches them, whatever the process's memory policy is.
+ * A preferred policy with an empty node mask means just that, and unlike a
+ * binding it falls back to other nodes if the local one is full.
+ */
+int
+pg_numa_bind_local(void *ptr, size_t size)
+{
+	return mbind(ptr, size, MPOL_PREFERRED, NULL, 0, 0);
+}
+
 #else
 
 /* Empty wrappers */
@@ -138,4 +150,10 @@ pg_numa_get_max_node(void)
 	return 0;
 }
 
+int
+pg_numa_bind_local(void *ptr, size_t size)
+{
+	return 0;
+}
+
 #endif
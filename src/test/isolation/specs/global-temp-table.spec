@@ -0,0 +1,55 @@
+# Global temporary tables
+#
+# The definition of a global temporary table is shared, but every session
+# sees only the rows it inserted itself.  TRUNCATE, VACUUM and indexes only
+# deal with the session's own contents, and a session that still has
+# contents when another session drops the table removes its files when it
+# next commits.
+
+setup
+{
+	CREATE GLOBAL TEMPORARY TABLE gtt (a int PRIMARY KEY, b text);
+	CREATE TABLE gtt_files (path text);
+}
+
+teardown
+{
+	DROP TABLE IF EXISTS gtt;
+	DROP TABLE gtt_files;
+}
+
+session s1
+step s1_insert		{ INSERT INTO gtt VALUES (1, 's1'); }
+step s1_select		{ SELECT a, b FROM gtt ORDER BY a; }
+step s1_begin		{ BEGIN; }
+step s1_truncate	{ TRUNCATE gtt; }
+step s1_rollback	{ ROLLBACK; }
+step s1_index		{ CREATE INDEX gtt_b_idx ON gtt (b); }
+step s1_vacuum		{ VACUUM gtt; }
+step s1_drop		{ DROP TABLE gtt; }
+
+session s2
+step s2_insert		{ INSERT INTO gtt VALUES (1, 's2'), (2, 's2'); }
+step s2_select		{ SELECT a, b FROM gtt ORDER BY a; }
+step s2_count_b		{ SET enable_seqscan = off; SELECT count(*) FROM gtt WHERE b = 's2'; }
+step s2_vacuum		{ VACUUM gtt; }
+step s2_path		{ INSERT INTO gtt_files SELECT pg_relation_filepath('gtt'); }
+step s2_files		{ SELECT count(*) FROM gtt_files WHERE (pg_stat_file(path, true)).size IS NOT NULL; }
+
+# each session sees only its own rows, even with the same key
+permutation s1_insert s2_select s2_insert s1_select s2_select
+
+# TRUNCATE empties only the session's own contents, and is undone by
+# ROLLBACK
+permutation s1_insert s2_insert s1_truncate s1_select s2_select
+permutation s1_insert s2_insert s1_begin s1_truncate s1_select s1_rollback s1_select s2_select
+
+# an index created by another session covers the rows inserted before
+permutation s2_insert s1_index s2_count_b s1_select
+
+# VACUUM in a session without contents doesn't touch those of others
+permutation s2_insert s1_vacuum s2_vacuum s2_select
+
+# the files of a session that still has contents go away when it commits
+# after the table is dropped
+permutation s2_insert s2_path s2_files s1_drop s2_files s2_files
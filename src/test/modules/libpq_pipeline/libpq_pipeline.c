@@ -1425,6 +1425,145 @@ test_protocol_version(PGconn *conn)
 	PQconninfoFree(opts);
 }
 
+/*
+ * Check a text column of a column batch holding rows first..first+ntups-1
+ * of the test query in test_column_batches.
+ */
+static void
+check_batch_text_column(PGresult *res, int batch, int first, int ntups)
+{
+	const unsigned char *validity = PQbatchValidity(res, batch, 1);
+	const int  *offsets = PQbatchOffsets(res, batch, 1);
+	const char *data = PQbatchData(res, batch, 1);
+
+	if (PQbatchNtuples(res, batch) != ntups)
+		pg_fatal("expected %d rows in batch %d, got %d",
+				 ntups, batch, PQbatchNtuples(res, batch));
+
+	for (int j = 0; j < ntups; j++)
+	{
+		int			i = first + j;
+		bool		isnull = (validity[j / 8] & (1 << (j % 8))) == 0;
+
+		if (isnull != (i % 3 == 0))
+			pg_fatal("unexpected null flag for row %d", i);
+		if (offsets[j + 1] - offsets[j] != (isnull ? 0 : i))
+			pg_fatal("unexpected length %d for row %d",
+					 offsets[j + 1] - offsets[j], i);
+		for (int k = offsets[j]; k < offsets[j + 1]; k++)
+			if (data[k] != 'x')
+				pg_fatal("unexpected data for row %d", i);
+	}
+}
+
+/* Verify results received in column batches */
+static void
+test_column_batches(PGconn *conn)
+{
+	const char *query = "SELECT i, CASE WHEN i % 3 <> 0 THEN repeat('x', i) END "
+		"FROM generate_series(1, 7) i";
+	const char **keywords;
+	const char **vals;
+	int			nopts;
+	PQconninfoOption *opts = PQconninfo(conn);
+	PGresult   *res;
+	const int  *offsets;
+	const char *data;
+	int			i;
+
+	fprintf(stderr, "column batches... ");
+
+	/* Copy the existing connection's options, adding column_batch_rows */
+	nopts = 0;
+	for (PQconninfoOption *opt = opts; opt->keyword != NULL; ++opt)
+		nopts++;
+	nopts++;					/* column_batch_rows */
+	nopts++;					/* NULL terminator */
+
+	keywords = pg_malloc0(sizeof(char *) * nopts);
+	vals = pg_malloc0(sizeof(char *) * nopts);
+
+	i = 0;
+	for (PQconninfoOption *opt = opts; opt->keyword != NULL; ++opt)
+	{
+		if (opt->val)
+		{
+			keywords[i] = opt->keyword;
+			vals[i] = opt->val;
+			i++;
+		}
+	}
+	keywords[i] = "column_batch_rows";
+	vals[i] = "3";
+	i++;
+	keywords[i] = vals[i] = NULL;
+
+	conn = PQconnectdbParams(keywords, vals, false);
+	if (PQstatus(conn) != CONNECTION_OK)
+		pg_fatal("Connection to database failed: %s",
+				 PQerrorMessage(conn));
+	if (PQcolumnBatchRows(conn) != 3)
+		pg_fatal("expected 3 rows per batch, got %d",
+				 PQcolumnBatchRows(conn));
+
+	/* Text format, seven rows in batches of 3, 3 and 1 */
+	res = PQexec(conn, query);
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		pg_fatal("query failed: %s", PQerrorMessage(conn));
+	if (PQntuples(res) != 0 || PQnbatches(res) != 3)
+		pg_fatal("expected 0 rows and 3 batches, got %d and %d",
+				 PQntuples(res), PQnbatches(res));
+	check_batch_text_column(res, 0, 1, 3);
+	check_batch_text_column(res, 1, 4, 3);
+	check_batch_text_column(res, 2, 7, 1);
+	offsets = PQbatchOffsets(res, 1, 0);
+	data = PQbatchData(res, 1, 0);
+	if (offsets[3] != 3 || strncmp(data, "456", 3) != 0)
+		pg_fatal("unexpected text data in batch 1");
+	PQclear(res);
+
+	/* Binary format */
+	res = PQexecParams(conn, "SELECT i FROM generate_series(1, 2) i",
+					   0, NULL, NULL, NULL, NULL, 1);
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		pg_fatal("query failed: %s", PQerrorMessage(conn));
+	if (PQnbatches(res) != 1 || PQbatchNtuples(res, 0) != 2)
+		pg_fatal("expected one batch of 2 rows");
+	offsets = PQbatchOffsets(res, 0, 0);
+	data = PQbatchData(res, 0, 0);
+	if (offsets[1] != 4 || offsets[2] != 8 ||
+		memcmp(data, "\0\0\0\1\0\0\0\2", 8) != 0)
+		pg_fatal("unexpected binary data");
+	PQclear(res);
+
+	/* In chunked mode, each batch is returned as a result of its own */
+	if (PQsendQuery(conn, query) != 1)
+		pg_fatal("failed to send query: %s", PQerrorMessage(conn));
+	if (PQsetChunkedRowsMode(conn, 100) != 1)
+		pg_fatal("failed to set chunked rows mode");
+	for (i = 0; i < 3; i++)
+	{
+		res = PQgetResult(conn);
+		if (PQresultStatus(res) != PGRES_TUPLES_CHUNK)
+			pg_fatal("expected PGRES_TUPLES_CHUNK, got %s",
+					 PQresStatus(PQresultStatus(res)));
+		if (PQnbatches(res) != 1)
+			pg_fatal("expected 1 batch, got %d", PQnbatches(res));
+		check_batch_text_column(res, 0, 1 + 3 * i, i < 2 ? 3 : 1);
+		PQclear(res);
+	}
+	consume_result_status(conn, PGRES_TUPLES_OK);
+	consume_null_result(conn);
+
+	PQfinish(conn);
+
+	pfree(keywords);
+	pfree(vals);
+	PQconninfoFree(opts);
+
+	fprintf(stderr, "ok\n");
+}
+
 /* Notice processor: print notices, and count how many we got */
 static void
 notice_processor(void *arg, const char *message)
@@ -2099,6 +2238,7 @@ static void
 print_test_list(void)
 {
 	printf("cancel\n");
+	printf("column_batches\n");
 	printf("disallowed_in_pipeline\n");
 	printf("multi_pipelines\n");
 	printf("nosync\n");
@@ -2205,6 +2345,8 @@ main(int argc, char **argv)
 
 	if (strcmp(testname, "cancel") == 0)
 		test_cancel(conn);
+	else if (strcmp(testname, "column_batches") == 0)
+		test_column_batches(conn);
 	else if (strcmp(testname, "disallowed_in_pipeline") == 0)
 		test_disallowed_in_pipeline(conn);
 	else if (strcmp(testname, "multi_pipelines") == 0)
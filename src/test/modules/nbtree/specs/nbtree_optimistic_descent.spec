@@ -0,0 +1,44 @@
+# Test that a B-tree search that copies an internal page without locking it
+# notices when the page is modified during the copy, and falls back to
+# locking the page.
+#
+# s1 copies the root page, and waits before checking whether the page was
+# modified meanwhile.  If s2 splits a leaf page in the meantime, which adds
+# a downlink to the root, the copy must be rejected.  Either way, the search
+# must find its row.
+
+setup
+{
+	CREATE EXTENSION injection_points;
+	CREATE TABLE nbtree_descent (i int4) WITH (autovacuum_enabled = off);
+	INSERT INTO nbtree_descent SELECT generate_series(1, 2000);
+	CREATE INDEX nbtree_descent_i_idx ON nbtree_descent (i);
+}
+teardown
+{
+	DROP TABLE nbtree_descent;
+	DROP EXTENSION injection_points;
+}
+
+# Search for a row; the first search loads the caches, so that the searches
+# in the steps have no catalog lookups to do.
+session s1
+setup
+{
+	SELECT injection_points_set_local();
+	SET enable_seqscan = off;
+	SELECT i FROM nbtree_descent WHERE i = 2000;
+}
+step s1_wait	{ SELECT injection_points_attach('copy-buffer-optimistic-before-recheck', 'wait'); }
+step s1_notice	{ SELECT injection_points_attach('nbtree-optimistic-copy-failed', 'notice'); }
+step s1_search	{ SELECT i FROM nbtree_descent WHERE i = 2000; }
+
+session s2
+step s2_split	{ INSERT INTO nbtree_descent SELECT generate_series(2001, 3000); }
+step s2_wakeup	{ SELECT injection_points_wakeup('copy-buffer-optimistic-before-recheck'); }
+
+# The root page is split while s1 is copying it
+permutation s1_notice s1_wait s1_search s2_split s2_wakeup
+
+# Nothing happens while s1 is copying the root page
+permutation s1_notice s1_wait s1_search s2_wakeup
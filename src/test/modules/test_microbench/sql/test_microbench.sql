@@ -0,0 +1,27 @@
+CREATE EXTENSION test_microbench;
+
+-- The timings vary from run to run, so show only the results, which don't.
+SELECT result FROM bench_sort('int4', 10000);
+SELECT result FROM bench_sort('int8', 10000, 2);
+SELECT result FROM bench_sort('float8', 10000);
+SELECT result FROM bench_sort('text', 10000);
+SELECT result, elapsed_ms >= 0 AS timed FROM bench_expr(10000, 2);
+SELECT result FROM bench_hash(10000, 2);
+SELECT result FROM bench_deform(10, 10000, 2);
+SELECT result FROM bench_bitmapset(2000, 100, 2);
+SELECT result FROM bench_bitmapset(1, 3);
+
+-- Large blocks placed for huge pages must give the same results
+SELECT result AS hash_result FROM bench_hash(200000) \gset
+SELECT result AS sort_result FROM bench_sort('int8', 200000) \gset
+SET memory_block_large_threshold = '1MB';
+SELECT result = :hash_result AS same_result FROM bench_hash(200000, 2);
+SELECT result = :sort_result AS same_result FROM bench_sort('int8', 200000);
+RESET memory_block_large_threshold;
+
+-- Errors
+SELECT result FROM bench_sort('point', 100);
+SELECT result FROM bench_sort('bool', 100);
+SELECT result FROM bench_expr(0);
+SELECT result FROM bench_deform(0, 100);
+SELECT result FROM bench_bitmapset(0, 100);
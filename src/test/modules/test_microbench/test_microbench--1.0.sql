@@ -0,0 +1,52 @@
+/* src/test/modules/test_microbench/test_microbench--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_microbench" to load this file. \quit
+
+CREATE FUNCTION bench_sort(
+datatype regtype,
+ntuples int4,
+loops int4 DEFAULT 1,
+OUT result int8,
+OUT elapsed_ms float8,
+OUT ns_per_tuple float8)
+RETURNS record STRICT PARALLEL UNSAFE
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION bench_expr(
+ntuples int4,
+loops int4 DEFAULT 1,
+OUT result int8,
+OUT elapsed_ms float8,
+OUT ns_per_tuple float8)
+RETURNS record STRICT PARALLEL UNSAFE
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION bench_hash(
+ntuples int4,
+loops int4 DEFAULT 1,
+OUT result int8,
+OUT elapsed_ms float8,
+OUT ns_per_tuple float8)
+RETURNS record STRICT PARALLEL UNSAFE
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION bench_deform(
+natts int4,
+ntuples int4,
+loops int4 DEFAULT 1,
+OUT result int8,
+OUT elapsed_ms float8,
+OUT ns_per_tuple float8)
+RETURNS record STRICT PARALLEL UNSAFE
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION bench_bitmapset(
+nmembers int4,
+nsets int4,
+loops int4 DEFAULT 1,
+OUT result int8,
+OUT elapsed_ms float8,
+OUT ns_per_tuple float8)
+RETURNS record STRICT PARALLEL UNSAFE
+AS 'MODULE_PATHNAME' LANGUAGE C;
@@ -0,0 +1,641 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_microbench.c
+ *		Micro-benchmarks of executor and sort code.
+ *
+ * Each function runs one hot path of the executor over synthetic data that
+ * is generated before the clock starts, and reports how long that took, so
+ * that a change to the code can be measured without the noise of a whole
+ * query:
+ *
+ *	bench_sort		tuplesort of a single datum column, using the comparator
+ *					of the given type
+ *	bench_expr		ExecQual() of an arithmetic and comparison qual
+ *	bench_hash		build and probe of a TupleHashTable
+ *	bench_deform	slot_getallattrs() of heap tuples
+ *	bench_bitmapset	union, intersection, subset test and iteration of
+ *					large Bitmapsets, as the planner does with the relids
+ *					of queries on many partitions
+ *
+ * The data depends only on the arguments, so besides the timings each
+ * function returns a checksum of what it computed, which the regression
+ * test checks.  Run with larger arguments and several loops to benchmark,
+ * for example:
+ *
+ *	SELECT * FROM bench_sort('int8', 1000000, 10);
+ *
+ * bench_hash with tens of millions of tuples probes a table much larger than
+ * the TLB covers, like a large hash join does; comparing its timings with
+ * and without memory_block_large_threshold shows what huge pages and local
+ * NUMA placement gain.
+ *
+ * Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_microbench/test_microbench.c
+ *
+ * -------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "access/tupdesc.h"
+#include "catalog/namespace.h"
+#include "catalog/pg_collation.h"
+#include "catalog/pg_operator.h"
+#include "catalog/pg_type.h"
+#include "executor/executor.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "nodes/bitmapset.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "portability/instr_time.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/sortsupport.h"
+#include "utils/tuplesort.h"
+#include "utils/typcache.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(bench_sort);
+PG_FUNCTION_INFO_V1(bench_expr);
+PG_FUNCTION_INFO_V1(bench_hash);
+PG_FUNCTION_INFO_V1(bench_deform);
+PG_FUNCTION_INFO_V1(bench_bitmapset);
+
+/*
+ * The i'th value of the synthetic data: a 24-bit number, scattered by
+ * Fibonacci hashing so that the data is in no particular order but the
+ * same on every platform.
+ */
+static inline uint32
+bench_value(int64 i)
+{
+	return (uint32) (((uint64) i + 1) * UINT64CONST(0x9E3779B97F4A7C15) >> 40);
+}
+
+static void
+check_arguments(int ntuples, int loops)
+{
+	if (ntuples <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of tuples must be greater than zero")));
+	if (loops <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of loops must be greater than zero")));
+}
+
+/*
+ * Build the result row: the checksum, the total time of all loops, and the
+ * average time per tuple processed.
+ */
+static Datum
+bench_result(FunctionCallInfo fcinfo, int64 result, instr_time elapsed,
+			 int64 ntuples, int loops)
+{
+	TupleDesc	tupdesc;
+	Datum		values[3];
+	bool		nulls[3] = {0};
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	values[0] = Int64GetDatum(result);
+	values[1] = Float8GetDatum(INSTR_TIME_GET_MILLISEC(elapsed));
+	values[2] = Float8GetDatum((double) INSTR_TIME_GET_NANOSEC(elapsed) /
+							   ((double) ntuples * loops));
+
+	return HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls));
+}
+
+/*
+ * Make the synthetic values of a type that bench_sort supports.
+ */
+static Datum *
+make_sort_values(Oid typid, int ntuples)
+{
+	Datum	   *values = palloc_array(Datum, ntuples);
+
+	for (int i = 0; i < ntuples; i++)
+	{
+		uint32		v = bench_value(i);
+
+		switch (typid)
+		{
+			case INT4OID:
+				values[i] = Int32GetDatum((int32) v);
+				break;
+			case INT8OID:
+				values[i] = Int64GetDatum((int64) v << 16);
+				break;
+			case FLOAT8OID:
+				values[i] = Float8GetDatum(v / 16.0);
+				break;
+			case TEXTOID:
+				values[i] = CStringGetTextDatum(psprintf("value %u", v));
+				break;
+			default:
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("type %s is not supported",
+								format_type_be(typid))));
+		}
+	}
+
+	return values;
+}
+
+/*
+ * bench_sort(datatype, ntuples, loops)
+ *
+ * Sort ntuples values of the type with its default "<" operator.  The result
+ * is the number of distinct values, counted by an untimed pass over the
+ * sorted output that also checks its order.
+ */
+Datum
+bench_sort(PG_FUNCTION_ARGS)
+{
+	Oid			typid = PG_GETARG_OID(0);
+	int			ntuples = PG_GETARG_INT32(1);
+	int			loops = PG_GETARG_INT32(2);
+	TypeCacheEntry *typentry;
+	Oid			collation;
+	Datum	   *values;
+	SortSupportData ssup;
+	Tuplesortstate *state;
+	Datum		val;
+	Datum		prev = (Datum) 0;
+	bool		isnull;
+	int64		ndistinct = 0;
+	instr_time	start;
+	instr_time	end;
+	instr_time	elapsed;
+
+	check_arguments(ntuples, loops);
+
+	typentry = lookup_type_cache(typid, TYPECACHE_LT_OPR);
+	if (!OidIsValid(typentry->lt_opr))
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_FUNCTION),
+				 errmsg("could not identify an ordering operator for type %s",
+						format_type_be(typid))));
+	collation = OidIsValid(get_typcollation(typid)) ?
+		DEFAULT_COLLATION_OID : InvalidOid;
+
+	values = make_sort_values(typid, ntuples);
+
+	INSTR_TIME_SET_ZERO(elapsed);
+	for (int loop = 0; loop < loops; loop++)
+	{
+		INSTR_TIME_SET_CURRENT(start);
+
+		state = tuplesort_begin_datum(typid, typentry->lt_opr, collation,
+									  false, work_mem, NULL, TUPLESORT_NONE);
+		for (int i = 0; i < ntuples; i++)
+			tuplesort_putdatum(state, values[i], false);
+		tuplesort_performsort(state);
+		while (tuplesort_getdatum(state, true, false, &val, &isnull, NULL))
+			;
+		tuplesort_end(state);
+
+		INSTR_TIME_SET_CURRENT(end);
+		INSTR_TIME_ACCUM_DIFF(elapsed, end, start);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	/* sort once more to check the output */
+	memset(&ssup, 0, sizeof(ssup));
+	ssup.ssup_cxt = CurrentMemoryContext;
+	ssup.ssup_collation = collation;
+	PrepareSortSupportFromOrderingOp(typentry->lt_opr, &ssup);
+
+	state = tuplesort_begin_datum(typid, typentry->lt_opr, collation,
+								  false, work_mem, NULL, TUPLESORT_NONE);
+	for (int i = 0; i < ntuples; i++)
+		tuplesort_putdatum(state, values[i], false);
+	tuplesort_performsort(state);
+	while (tuplesort_getdatum(state, true, true, &val, &isnull, NULL))
+	{
+		int			cmp = 1;
+
+		if (ndistinct > 0)
+			cmp = ApplySortComparator(val, false, prev, false, &ssup);
+		if (cmp < 0)
+			elog(ERROR, "tuplesort returned values out of order");
+		if (cmp > 0)
+			ndistinct++;
+		prev = val;
+	}
+	tuplesort_end(state);
+
+	return bench_result(fcinfo, ndistinct, elapsed, ntuples, loops);
+}
+
+/*
+ * Make "left <name> right" for an int4 operator.
+ */
+static Expr *
+make_int4_op(const char *name, Expr *left, Expr *right)
+{
+	Oid			opno;
+	Expr	   *result;
+
+	opno = OpernameGetOprid(list_make1(makeString(pstrdup(name))),
+							INT4OID, INT4OID);
+	if (!OidIsValid(opno))
+		elog(ERROR, "could not find operator %s for type integer", name);
+
+	result = make_opclause(opno, get_op_rettype(opno), false, left, right,
+						   InvalidOid, InvalidOid);
+	fix_opfuncids((Node *) result);
+
+	return result;
+}
+
+/*
+ * bench_expr(ntuples, loops)
+ *
+ * Evaluate "(a + b) * 2 > c AND a <> d" over ntuples rows of four int4
+ * columns in a virtual slot, as a scan's qual would be.  The result is the
+ * number of rows that pass.
+ */
+Datum
+bench_expr(PG_FUNCTION_ARGS)
+{
+	int			ntuples = PG_GETARG_INT32(0);
+	int			loops = PG_GETARG_INT32(1);
+	TupleDesc	tupdesc;
+	TupleTableSlot *slot;
+	ExprContext *econtext;
+	Expr	   *var[4];
+	Expr	   *two;
+	List	   *quals;
+	ExprState  *qual;
+	int32	   *data;
+	int64		npassed = 0;
+	instr_time	start;
+	instr_time	end;
+	instr_time	elapsed;
+
+	check_arguments(ntuples, loops);
+
+	tupdesc = CreateTemplateTupleDesc(4);
+	for (int j = 0; j < 4; j++)
+	{
+		TupleDescInitEntry(tupdesc, j + 1, NULL, INT4OID, -1, 0);
+		var[j] = (Expr *) makeVar(1, j + 1, INT4OID, -1, InvalidOid, 0);
+	}
+	two = (Expr *) makeConst(INT4OID, -1, InvalidOid, sizeof(int32),
+							 Int32GetDatum(2), false, true);
+
+	quals = list_make2(make_int4_op(">",
+									make_int4_op("*",
+												 make_int4_op("+", var[0], var[1]),
+												 two),
+									var[2]),
+					   make_int4_op("<>", var[0], var[3]));
+
+	slot = MakeSingleTupleTableSlot(tupdesc, &TTSOpsVirtual);
+	econtext = CreateStandaloneExprContext();
+	econtext->ecxt_scantuple = slot;
+	qual = ExecInitQual(quals, NULL);
+
+	data = palloc_array(int32, (Size) ntuples * 4);
+	for (int64 i = 0; i < (int64) ntuples * 4; i++)
+		data[i] = bench_value(i) % 1000;
+
+	INSTR_TIME_SET_ZERO(elapsed);
+	for (int loop = 0; loop < loops; loop++)
+	{
+		int64		n = 0;
+
+		INSTR_TIME_SET_CURRENT(start);
+
+		for (int i = 0; i < ntuples; i++)
+		{
+			ExecClearTuple(slot);
+			for (int j = 0; j < 4; j++)
+			{
+				slot->tts_values[j] = Int32GetDatum(data[i * 4 + j]);
+				slot->tts_isnull[j] = false;
+			}
+			ExecStoreVirtualTuple(slot);
+
+			if (ExecQual(qual, econtext))
+				n++;
+			ResetExprContext(econtext);
+		}
+
+		INSTR_TIME_SET_CURRENT(end);
+		INSTR_TIME_ACCUM_DIFF(elapsed, end, start);
+
+		npassed = n;
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	FreeExprContext(econtext, true);
+	ExecDropSingleTupleTableSlot(slot);
+
+	return bench_result(fcinfo, npassed, elapsed, ntuples, loops);
+}
+
+/*
+ * bench_hash(ntuples, loops)
+ *
+ * Insert ntuples int4 keys into a TupleHashTable, then probe it with as many
+ * different keys from the same range.  Both are timed.  The result is the
+ * number of probes that found a match.
+ */
+Datum
+bench_hash(PG_FUNCTION_ARGS)
+{
+	int			ntuples = PG_GETARG_INT32(0);
+	int			loops = PG_GETARG_INT32(1);
+	TupleDesc	tupdesc;
+	TupleTableSlot *slot;
+	MemoryContext metacxt;
+	MemoryContext tuplescxt;
+	MemoryContext tempcxt;
+	TupleHashTable hashtable;
+	AttrNumber	keyColIdx[1] = {1};
+	Oid			eqfuncoids[1];
+	Oid			collations[1] = {InvalidOid};
+	FmgrInfo	hashfunctions[1];
+	Oid			lefthashfn;
+	Oid			righthashfn;
+	int32	   *build;
+	int32	   *probe;
+	int64		nfound = 0;
+	instr_time	start;
+	instr_time	end;
+	instr_time	elapsed;
+
+	check_arguments(ntuples, loops);
+
+	tupdesc = CreateTemplateTupleDesc(1);
+	TupleDescInitEntry(tupdesc, 1, NULL, INT4OID, -1, 0);
+	slot = MakeSingleTupleTableSlot(tupdesc, &TTSOpsVirtual);
+
+	eqfuncoids[0] = get_opcode(Int4EqualOperator);
+	if (!get_op_hash_functions(Int4EqualOperator, &lefthashfn, &righthashfn))
+		elog(ERROR, "could not find hash function for operator %u",
+			 Int4EqualOperator);
+	fmgr_info(lefthashfn, &hashfunctions[0]);
+
+	metacxt = AllocSetContextCreate(CurrentMemoryContext,
+									"bench_hash metadata",
+									ALLOCSET_DEFAULT_SIZES);
+	tuplescxt = AllocSetContextCreate(CurrentMemoryContext,
+									  "bench_hash tuples",
+									  ALLOCSET_DEFAULT_SIZES);
+	tempcxt = AllocSetContextCreate(CurrentMemoryContext,
+									"bench_hash temporary",
+									ALLOCSET_DEFAULT_SIZES);
+
+	hashtable = BuildTupleHashTable(NULL, tupdesc, &TTSOpsVirtual,
+									1, keyColIdx, eqfuncoids, hashfunctions,
+									collations, ntuples, 0,
+									metacxt, tuplescxt, tempcxt, false);
+
+	build = palloc_array(int32, ntuples);
+	probe = palloc_array(int32, ntuples);
+	for (int i = 0; i < ntuples; i++)
+	{
+		build[i] = bench_value(i) % ntuples;
+		probe[i] = bench_value((int64) ntuples + i) % ntuples;
+	}
+
+	INSTR_TIME_SET_ZERO(elapsed);
+	for (int loop = 0; loop < loops; loop++)
+	{
+		int64		n = 0;
+
+		ResetTupleHashTable(hashtable);
+
+		INSTR_TIME_SET_CURRENT(start);
+
+		for (int i = 0; i < ntuples; i++)
+		{
+			bool		isnew;
+
+			ExecClearTuple(slot);
+			slot->tts_values[0] = Int32GetDatum(build[i]);
+			slot->tts_isnull[0] = false;
+			ExecStoreVirtualTuple(slot);
+
+			(void) LookupTupleHashEntry(hashtable, slot, &isnew, NULL);
+		}
+
+		for (int i = 0; i < ntuples; i++)
+		{
+			ExecClearTuple(slot);
+			slot->tts_values[0] = Int32GetDatum(probe[i]);
+			slot->tts_isnull[0] = false;
+			ExecStoreVirtualTuple(slot);
+
+			if (LookupTupleHashEntry(hashtable, slot, NULL, NULL) != NULL)
+				n++;
+		}
+
+		INSTR_TIME_SET_CURRENT(end);
+		INSTR_TIME_ACCUM_DIFF(elapsed, end, start);
+
+		nfound = n;
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	MemoryContextDelete(tempcxt);
+	MemoryContextDelete(tuplescxt);
+	MemoryContextDelete(metacxt);
+
+	/* each tuple is inserted once and probed once */
+	return bench_result(fcinfo, nfound, elapsed, (int64) ntuples * 2, loops);
+}
+
+/*
+ * bench_deform(natts, ntuples, loops)
+ *
+ * Store ntuples heap tuples, with natts int4, text and int8 columns in turn
+ * of which every tenth is null, in a slot and deform all of their attributes.
+ * The result is the number of non-null attributes.
+ */
+Datum
+bench_deform(PG_FUNCTION_ARGS)
+{
+	int			natts = PG_GETARG_INT32(0);
+	int			ntuples = PG_GETARG_INT32(1);
+	int			loops = PG_GETARG_INT32(2);
+	TupleDesc	tupdesc;
+	TupleTableSlot *slot;
+	HeapTuple  *tuples;
+	Datum	   *values;
+	bool	   *nulls;
+	int64		nnotnull = 0;
+	instr_time	start;
+	instr_time	end;
+	instr_time	elapsed;
+
+	check_arguments(ntuples, loops);
+	if (natts <= 0 || natts > MaxHeapAttributeNumber)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of attributes must be between 1 and %d",
+						MaxHeapAttributeNumber)));
+
+	tupdesc = CreateTemplateTupleDesc(natts);
+	for (int j = 0; j < natts; j++)
+	{
+		static const Oid types[3] = {INT4OID, TEXTOID, INT8OID};
+
+		TupleDescInitEntry(tupdesc, j + 1, NULL, types[j % 3], -1, 0);
+	}
+
+	tuples = palloc_array(HeapTuple, ntuples);
+	values = palloc_array(Datum, natts);
+	nulls = palloc_array(bool, natts);
+	for (int i = 0; i < ntuples; i++)
+	{
+		for (int j = 0; j < natts; j++)
+		{
+			uint32		v = bench_value((int64) i * natts + j);
+
+			nulls[j] = ((i + j) % 10 == 0);
+			if (j % 3 == 0)
+				values[j] = Int32GetDatum((int32) v);
+			else if (j % 3 == 1)
+				values[j] = CStringGetTextDatum(psprintf("value %u", v));
+			else
+				values[j] = Int64GetDatum((int64) v << 24);
+		}
+		tuples[i] = heap_form_tuple(tupdesc, values, nulls);
+	}
+
+	slot = MakeSingleTupleTableSlot(tupdesc, &TTSOpsHeapTuple);
+
+	INSTR_TIME_SET_ZERO(elapsed);
+	for (int loop = 0; loop < loops; loop++)
+	{
+		INSTR_TIME_SET_CURRENT(start);
+
+		for (int i = 0; i < ntuples; i++)
+		{
+			ExecStoreHeapTuple(tuples[i], slot, false);
+			slot_getallattrs(slot);
+			ExecClearTuple(slot);
+		}
+
+		INSTR_TIME_SET_CURRENT(end);
+		INSTR_TIME_ACCUM_DIFF(elapsed, end, start);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	/* count the non-null attributes in an untimed pass */
+	for (int i = 0; i < ntuples; i++)
+	{
+		ExecStoreHeapTuple(tuples[i], slot, false);
+		slot_getallattrs(slot);
+		for (int j = 0; j < natts; j++)
+		{
+			if (!slot->tts_isnull[j])
+				nnotnull++;
+		}
+		ExecClearTuple(slot);
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+
+	return bench_result(fcinfo, nnotnull, elapsed, ntuples, loops);
+}
+
+/*
+ * bench_bitmapset(nmembers, nsets, loops)
+ *
+ * Make nsets sets, each holding about a quarter of the integers below
+ * nmembers, and for each set and the next one compute their union and
+ * intersection, test that the intersection is a subset of the first, and
+ * iterate over the members of the union.  The result is the total number of
+ * members of the unions and intersections.
+ */
+Datum
+bench_bitmapset(PG_FUNCTION_ARGS)
+{
+	int			nmembers = PG_GETARG_INT32(0);
+	int			nsets = PG_GETARG_INT32(1);
+	int			loops = PG_GETARG_INT32(2);
+	Bitmapset **sets;
+	int64		nfound = 0;
+	instr_time	start;
+	instr_time	end;
+	instr_time	elapsed;
+
+	check_arguments(nsets, loops);
+	if (nmembers <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of members must be greater than zero")));
+
+	sets = palloc_array(Bitmapset *, nsets);
+	for (int j = 0; j < nsets; j++)
+	{
+		sets[j] = NULL;
+		for (int k = 0; k < nmembers; k++)
+		{
+			if (bench_value((int64) j * nmembers + k) % 4 == 0)
+				sets[j] = bms_add_member(sets[j], k);
+		}
+	}
+
+	INSTR_TIME_SET_ZERO(elapsed);
+	for (int loop = 0; loop < loops; loop++)
+	{
+		INSTR_TIME_SET_CURRENT(start);
+
+		for (int j = 0; j < nsets; j++)
+		{
+			Bitmapset  *a = sets[j];
+			Bitmapset  *b = sets[(j + 1) % nsets];
+			Bitmapset  *u = bms_union(a, b);
+			Bitmapset  *x = bms_intersect(a, b);
+			int			m = -1;
+
+			if (!bms_is_subset(x, a))
+				elog(ERROR, "intersection is not a subset");
+			while ((m = bms_next_member(u, m)) >= 0)
+				;
+			bms_free(u);
+			bms_free(x);
+		}
+
+		INSTR_TIME_SET_CURRENT(end);
+		INSTR_TIME_ACCUM_DIFF(elapsed, end, start);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	/* count the members in an untimed pass */
+	for (int j = 0; j < nsets; j++)
+	{
+		Bitmapset  *a = sets[j];
+		Bitmapset  *b = sets[(j + 1) % nsets];
+		Bitmapset  *u = bms_union(a, b);
+		Bitmapset  *x = bms_intersect(a, b);
+		int			m = -1;
+
+		while ((m = bms_next_member(u, m)) >= 0)
+			nfound++;
+		nfound += bms_num_members(x);
+		bms_free(u);
+		bms_free(x);
+	}
+
+	return bench_result(fcinfo, nfound, elapsed, nsets, loops);
+}
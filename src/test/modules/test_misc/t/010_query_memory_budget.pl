@@ -0,0 +1,119 @@
+# Copyright (c) 2025, PostgreSQL Global Development Group
+
+# Check that sorts, hash joins and hash aggregates spill to disk when
+# query_memory_budget is exhausted, although work_mem would let them run
+# in memory, and that a session returns its reservations when a query
+# holding them fails.
+
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init();
+$node->append_conf(
+	'postgresql.conf', qq(
+work_mem = 32MB
+hash_mem_multiplier = 1
+max_parallel_workers_per_gather = 0
+jit = off
+));
+$node->start;
+
+$node->safe_psql(
+	'postgres', qq(
+CREATE TABLE budget_t (a int, b int);
+INSERT INTO budget_t SELECT g, g % 1000 FROM generate_series(1, 50000) g;
+ANALYZE budget_t;
+));
+
+my $settings = qq(
+SET enable_mergejoin = off;
+SET enable_nestloop = off;
+SET enable_sort = off;
+);
+
+sub explain_analyze
+{
+	my ($query, $extra) = @_;
+	$extra //= '';
+
+	return $node->safe_psql('postgres',
+		"$settings $extra EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, SUMMARY OFF) $query"
+	);
+}
+
+my $sort_query = 'SELECT * FROM budget_t ORDER BY a DESC';
+my $hashjoin_query =
+  'SELECT count(*) FROM budget_t t1 JOIN budget_t t2 USING (a)';
+my $hashagg_query = 'SELECT a, count(*) FROM budget_t GROUP BY a';
+
+# Sets query_memory_budget and waits for new sessions to see it
+sub set_budget
+{
+	my ($budget) = @_;
+
+	$node->safe_psql('postgres',
+		"ALTER SYSTEM SET query_memory_budget = '$budget'");
+	$node->reload;
+	$node->poll_query_until('postgres',
+		"SELECT current_setting('query_memory_budget') = '$budget'")
+	  or die "timed out waiting for query_memory_budget = $budget";
+}
+
+# Without a budget, everything fits in work_mem
+my $out = explain_analyze($sort_query, 'SET enable_sort = on;');
+like($out, qr/Sort Method: quicksort/, 'sort in memory without budget');
+$out = explain_analyze($hashjoin_query);
+like($out, qr/Batches: 1 /, 'hash join in one batch without budget');
+$out = explain_analyze($hashagg_query);
+like($out, qr/Batches: 1 /, 'hash aggregate in one batch without budget');
+unlike($out, qr/Disk Usage/, 'hash aggregate not spilled without budget');
+
+# With a small budget, they all spill
+set_budget('256kB');
+
+$out = explain_analyze($sort_query, 'SET enable_sort = on;');
+like($out, qr/Sort Method: external merge/, 'sort spills with budget');
+$out = explain_analyze($hashjoin_query);
+ok($out =~ /Batches: (\d+)/ && $1 > 1, 'hash join adds batches with budget')
+  or diag $out;
+$out = explain_analyze($hashagg_query);
+like($out, qr/Disk Usage/, 'hash aggregate spills with budget');
+
+# With a budget the sort fits in, the sort runs in memory, also after
+# another session failed while holding most of the budget.
+set_budget('8MB');
+
+$out = explain_analyze($sort_query, 'SET enable_sort = on;');
+like($out, qr/Sort Method: quicksort/, 'sort in memory within budget');
+
+my $session = $node->background_psql('postgres', on_error_stop => 0);
+$session->query_safe($settings);
+my ($ret, $err) = $session->query(
+	"SELECT a, count(*) FROM budget_t GROUP BY a HAVING 1 / (count(*) - 1) > 0"
+);
+ok($err, 'aggregate holding budget failed');
+
+# The failed session is still connected, but its reservations are gone
+$out = explain_analyze($sort_query, 'SET enable_sort = on;');
+like($out, qr/Sort Method: quicksort/,
+	'budget returned by failed query at transaction end');
+
+# Likewise for a failure inside a transaction block, once it's rolled back
+$session->query_safe('BEGIN');
+$session->query(
+	"SELECT a, count(*) FROM budget_t GROUP BY a HAVING 1 / (count(*) - 1) > 0"
+);
+$session->query_safe('ROLLBACK');
+$out = explain_analyze($sort_query, 'SET enable_sort = on;');
+like($out, qr/Sort Method: quicksort/,
+	'budget returned after rollback of failed transaction block');
+
+$session->quit;
+
+$node->stop;
+
+done_testing();
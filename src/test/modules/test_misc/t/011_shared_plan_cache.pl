@@ -0,0 +1,107 @@
+# Copyright (c) 2025, PostgreSQL Global Development Group
+
+# Check that generic plans stored in the shared plan cache are reused by
+# other sessions, that catalog changes remove them, and that sessions whose
+# search_path or user differ don't share plans.
+#
+# Whether a session had to plan a statement is seen from the
+# log_planner_stats output in the server log.
+
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init();
+$node->append_conf(
+	'postgresql.conf', qq(
+shared_plan_cache_entries = 100
+plan_cache_mode = force_generic_plan
+));
+$node->start;
+
+$node->safe_psql(
+	'postgres', qq(
+CREATE TABLE spc_t (a int PRIMARY KEY, b int);
+INSERT INTO spc_t SELECT g, g * 10 FROM generate_series(1, 1000) g;
+ANALYZE spc_t;
+CREATE SCHEMA spc_schema;
+CREATE TABLE spc_schema.spc_t (a int PRIMARY KEY, b int);
+INSERT INTO spc_schema.spc_t VALUES (1, -1);
+CREATE ROLE spc_user;
+GRANT SELECT ON spc_t TO spc_user;
+));
+
+my $query = 'SELECT b FROM spc_t WHERE a = $1';
+
+# Prepares and executes the query in a new session, after running $setup.
+# Returns the result and whether the session had to plan the query.
+sub execute_prepared
+{
+	my ($setup) = @_;
+	$setup //= '';
+
+	my $offset = -s $node->logfile;
+	my $result = $node->safe_psql(
+		'postgres', qq(
+SET log_planner_stats = on;
+$setup
+PREPARE p(int) AS $query;
+EXECUTE p(1);
+));
+	my $log = slurp_file($node->logfile, $offset);
+
+	return ($result, scalar($log =~ /PLANNER STATISTICS/));
+}
+
+my ($result, $planned) = execute_prepared();
+is($result, '10', 'first session gets the right result');
+ok($planned, 'first session plans the query');
+
+($result, $planned) = execute_prepared();
+is($result, '10', 'second session gets the right result');
+ok(!$planned, 'second session reuses the shared plan');
+
+# Changing the table's statistics removes the shared plan
+$node->safe_psql(
+	'postgres', qq(
+INSERT INTO spc_t SELECT g, g * 10 FROM generate_series(1001, 2000) g;
+ANALYZE spc_t;
+));
+($result, $planned) = execute_prepared();
+ok($planned, 'query planned again after ANALYZE');
+($result, $planned) = execute_prepared();
+ok(!$planned, 'plan built after ANALYZE is shared');
+
+# So does DDL on the table
+$node->safe_psql('postgres', 'ALTER TABLE spc_t ADD COLUMN c int');
+($result, $planned) = execute_prepared();
+is($result, '10', 'right result after DDL');
+ok($planned, 'query planned again after DDL');
+($result, $planned) = execute_prepared();
+ok(!$planned, 'plan built after DDL is shared');
+
+# A different search_path gets a plan of its own, although the query text
+# is the same
+($result, $planned) =
+  execute_prepared('SET search_path = spc_schema, public;');
+is($result, '-1', 'query uses the table in search_path');
+ok($planned, 'plan not shared across search_path settings');
+
+($result, $planned) = execute_prepared();
+is($result, '10', 'default search_path still uses its own plan');
+ok(!$planned, 'plan for the default search_path is still shared');
+
+# Likewise for a different user
+($result, $planned) = execute_prepared('SET ROLE spc_user;');
+is($result, '10', 'right result for another user');
+ok($planned, 'plan not shared across users');
+
+($result, $planned) = execute_prepared('SET ROLE spc_user;');
+ok(!$planned, 'plan shared by sessions of the same user');
+
+$node->stop;
+
+done_testing();
@@ -0,0 +1,15 @@
+CREATE EXTENSION test_swisshash;
+
+-- Random operations on a small and on a large key space, with and without
+-- SIMD instructions.  These error out on any difference from simplehash.h.
+SELECT simd,
+       test_swisshash_random(1, 100000, 100, 40, simd) >= 0 AS small,
+       test_swisshash_random(2, 200000, 100000, 30, simd) >= 0 AS large,
+       test_swisshash_random(3, 200000, 5000, 60, simd) >= 0 AS delete_heavy
+FROM (VALUES (true), (false)) AS v(simd);
+
+-- A sliding window of keys fills the table with tombstones, which have to
+-- be removed by rebuilding the table at the same size.  The table is created
+-- with 4096 buckets, and 1700 elements are less than half its grow threshold.
+SELECT simd, test_swisshash_sliding(100000, 1700, simd) > 0 AS rebuilt
+FROM (VALUES (true), (false)) AS v(simd);
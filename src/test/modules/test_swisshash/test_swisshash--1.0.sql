@@ -0,0 +1,14 @@
+/* src/test/modules/test_swisshash/test_swisshash--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_swisshash" to load this file. \quit
+
+CREATE FUNCTION test_swisshash_random(seed int8, nops int4, keyspace int4,
+                                      delete_pct int4, simd bool)
+RETURNS int8 STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
+
+CREATE FUNCTION test_swisshash_sliding(nops int4, window_size int4,
+                                       simd bool)
+RETURNS int8 STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
@@ -0,0 +1,79 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_swisshash.c
+ *		Test module for lib/swisshash.h.
+ *
+ * The checks themselves are in test_swisshash_check.c, which is compiled
+ * once here, using SIMD instructions if the platform has them, and once in
+ * test_swisshash_nosimd.c, without.
+ *
+ * Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_swisshash/test_swisshash.c
+ *
+ * -------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "fmgr.h"
+#include "test_swisshash.h"
+
+#define CHECK_NAME(name) CppConcat(swisshash_simd_, name)
+#include "test_swisshash_check.c"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(test_swisshash_random);
+PG_FUNCTION_INFO_V1(test_swisshash_sliding);
+
+/*
+ * Random insertions, deletions and lookups, see test_swisshash_check.c.
+ * Returns the number of times the table was rebuilt at the same size.
+ */
+Datum
+test_swisshash_random(PG_FUNCTION_ARGS)
+{
+	int64		seed = PG_GETARG_INT64(0);
+	int32		nops = PG_GETARG_INT32(1);
+	int32		keyspace = PG_GETARG_INT32(2);
+	int32		delete_pct = PG_GETARG_INT32(3);
+	bool		simd = PG_GETARG_BOOL(4);
+	uint64		rebuilds;
+
+	if (keyspace <= 0)
+		elog(ERROR, "keyspace must be positive");
+	if (delete_pct < 0 || delete_pct > 100)
+		elog(ERROR, "delete_pct must be between 0 and 100");
+
+	if (simd)
+		rebuilds = swisshash_simd_random(seed, nops, keyspace, delete_pct);
+	else
+		rebuilds = swisshash_nosimd_random(seed, nops, keyspace, delete_pct);
+
+	PG_RETURN_INT64(rebuilds);
+}
+
+/*
+ * Insertions of consecutive keys, each deleted again after 'window' more,
+ * see test_swisshash_check.c.  Returns the number of times the table was
+ * rebuilt at the same size.
+ */
+Datum
+test_swisshash_sliding(PG_FUNCTION_ARGS)
+{
+	int32		nops = PG_GETARG_INT32(0);
+	int32		window = PG_GETARG_INT32(1);
+	bool		simd = PG_GETARG_BOOL(2);
+	uint64		rebuilds;
+
+	if (window <= 0)
+		elog(ERROR, "window must be positive");
+
+	if (simd)
+		rebuilds = swisshash_simd_sliding(nops, window);
+	else
+		rebuilds = swisshash_nosimd_sliding(nops, window);
+
+	PG_RETURN_INT64(rebuilds);
+}
@@ -0,0 +1,24 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_swisshash.h
+ *		Entry points of the checks in test_swisshash_check.c.
+ *
+ * Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_swisshash/test_swisshash.h
+ *
+ * -------------------------------------------------------------------------
+ */
+#ifndef TEST_SWISSHASH_H
+#define TEST_SWISSHASH_H
+
+extern uint64 swisshash_simd_random(uint64 seed, int nops, uint32 keyspace,
+									int delete_pct);
+extern uint64 swisshash_simd_sliding(int nops, uint32 window);
+
+extern uint64 swisshash_nosimd_random(uint64 seed, int nops, uint32 keyspace,
+									  int delete_pct);
+extern uint64 swisshash_nosimd_sliding(int nops, uint32 window);
+
+#endif							/* TEST_SWISSHASH_H */
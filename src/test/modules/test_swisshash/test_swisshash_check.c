@@ -0,0 +1,324 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_swisshash_check.c
+ *		Randomized checks of lib/swisshash.h against lib/simplehash.h.
+ *
+ * This file is #included by test_swisshash.c and test_swisshash_nosimd.c,
+ * with CHECK_NAME() defined to give the entry points distinct names.  The
+ * latter also defines SWISSHASH_NO_SIMD, so that the portable version of
+ * the group probes gets tested even where SIMD instructions are available.
+ *
+ * Every operation is done on a swisshash table and on a simplehash table,
+ * and their results must agree.  Besides that, we check that deletions
+ * never move other elements, which nodeMemoize.c relies on, and count the
+ * insertions that had to rebuild the table at the same size to get rid of
+ * tombstones.
+ *
+ * Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_swisshash/test_swisshash_check.c
+ *
+ * -------------------------------------------------------------------------
+ */
+
+#include "common/hashfn.h"
+#include "common/pg_prng.h"
+#include "utils/memutils.h"
+
+typedef struct TestEntry
+{
+	uint32		key;
+	uint32		value;
+	char		status;
+} TestEntry;
+
+#define SH_PREFIX swh
+#define SH_ELEMENT_TYPE TestEntry
+#define SH_KEY_TYPE uint32
+#define SH_KEY key
+#define SH_HASH_KEY(tb, key) murmurhash32(key)
+#define SH_EQUAL(tb, a, b) ((a) == (b))
+#define SH_SCOPE static inline
+#define SH_DECLARE
+#define SH_DEFINE
+#include "lib/swisshash.h"
+
+#define SH_PREFIX ref
+#define SH_ELEMENT_TYPE TestEntry
+#define SH_KEY_TYPE uint32
+#define SH_KEY key
+#define SH_HASH_KEY(tb, key) murmurhash32(key)
+#define SH_EQUAL(tb, a, b) ((a) == (b))
+#define SH_SCOPE static inline
+#define SH_DECLARE
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
+/* how often to compare the whole tables */
+#define CHECK_VERIFY_INTERVAL 1000
+
+typedef struct CheckState
+{
+	swh_hash   *swh;
+	ref_hash   *ref;
+	pg_prng_state prng;
+
+	/* number of insertions that rebuilt the table at the same size */
+	uint64		rebuilds;
+
+	/* an element that must stay in place while others are deleted */
+	bool		tracking;
+	uint32		tracked_key;
+	TestEntry  *tracked;
+} CheckState;
+
+static void
+CHECK_NAME(check_tracked) (CheckState *state)
+{
+	TestEntry  *entry;
+
+	if (!state->tracking)
+		return;
+
+	entry = swh_lookup(state->swh, state->tracked_key);
+	if (entry != state->tracked)
+		elog(ERROR, "element with key %u moved from %p to %p",
+			 state->tracked_key, state->tracked, entry);
+	if (entry->status != swh_SH_IN_USE || entry->key != state->tracked_key)
+		elog(ERROR, "element with key %u was overwritten",
+			 state->tracked_key);
+}
+
+static void
+CHECK_NAME(insert) (CheckState *state, uint32 key)
+{
+	uint64		oldsize = state->swh->size;
+	uint32		olddeleted = state->swh->deleted;
+	uint32		value = pg_prng_uint32(&state->prng);
+	TestEntry  *entry;
+	TestEntry  *refentry;
+	bool		found;
+	bool		reffound;
+
+	entry = swh_insert(state->swh, key, &found);
+	refentry = ref_insert(state->ref, key, &reffound);
+
+	if (found != reffound)
+		elog(ERROR, "insertion of key %u found %d, expected %d",
+			 key, found, reffound);
+	if (entry->key != key || entry->status != swh_SH_IN_USE)
+		elog(ERROR, "insertion of key %u returned a wrong element", key);
+	if (found && entry->value != refentry->value)
+		elog(ERROR, "insertion of key %u found value %u, expected %u",
+			 key, entry->value, refentry->value);
+
+	entry->value = value;
+	refentry->value = value;
+
+	/*
+	 * Reusing a tombstone removes just that one, so if more are gone without
+	 * the table having grown, it was rebuilt.
+	 */
+	if (state->swh->size == oldsize && state->swh->deleted + 1 < olddeleted)
+		state->rebuilds++;
+
+	/* Insertions may move elements, so look up the tracked one again */
+	if (state->tracking)
+		state->tracked = swh_lookup(state->swh, state->tracked_key);
+	else
+	{
+		state->tracking = true;
+		state->tracked_key = key;
+		state->tracked = entry;
+	}
+	CHECK_NAME(check_tracked) (state);
+}
+
+static void
+CHECK_NAME(delete) (CheckState *state, uint32 key)
+{
+	bool		found;
+	bool		reffound;
+
+	found = swh_delete(state->swh, key);
+	reffound = ref_delete(state->ref, key);
+
+	if (found != reffound)
+		elog(ERROR, "deletion of key %u found %d, expected %d",
+			 key, found, reffound);
+
+	if (state->tracking && key == state->tracked_key)
+		state->tracking = false;
+	CHECK_NAME(check_tracked) (state);
+}
+
+static void
+CHECK_NAME(lookup) (CheckState *state, uint32 key)
+{
+	TestEntry  *entry = swh_lookup(state->swh, key);
+	TestEntry  *refentry = ref_lookup(state->ref, key);
+
+	if ((entry != NULL) != (refentry != NULL))
+		elog(ERROR, "lookup of key %u found %d, expected %d",
+			 key, entry != NULL, refentry != NULL);
+	if (entry != NULL &&
+		(entry->key != key || entry->status != swh_SH_IN_USE ||
+		 entry->value != refentry->value))
+		elog(ERROR, "lookup of key %u returned a wrong element", key);
+}
+
+/*
+ * Check that iteration returns every element once, with the right value, and
+ * that lookups find every element.
+ */
+static void
+CHECK_NAME(verify) (CheckState *state)
+{
+	swh_iterator iter;
+	ref_iterator refiter;
+	TestEntry  *entry;
+	uint32		count = 0;
+
+	if (state->swh->members != state->ref->members)
+		elog(ERROR, "table has %u members, expected %u",
+			 state->swh->members, state->ref->members);
+
+	swh_start_iterate(state->swh, &iter);
+	while ((entry = swh_iterate(state->swh, &iter)) != NULL)
+	{
+		TestEntry  *refentry = ref_lookup(state->ref, entry->key);
+
+		if (refentry == NULL)
+			elog(ERROR, "iteration returned key %u, which isn't in the table",
+				 entry->key);
+		if (entry->status != swh_SH_IN_USE || entry->value != refentry->value)
+			elog(ERROR, "iteration returned a wrong element for key %u",
+				 entry->key);
+		count++;
+	}
+	if (count != state->ref->members)
+		elog(ERROR, "iteration returned %u elements, expected %u",
+			 count, state->ref->members);
+
+	ref_start_iterate(state->ref, &refiter);
+	while ((entry = ref_iterate(state->ref, &refiter)) != NULL)
+		CHECK_NAME(lookup) (state, entry->key);
+}
+
+/*
+ * Delete the elements with odd keys while iterating, then check that all of
+ * them were visited and the others are still there.
+ */
+static void
+CHECK_NAME(delete_while_iterating) (CheckState *state)
+{
+	swh_iterator iter;
+	ref_iterator refiter;
+	TestEntry  *entry;
+
+	swh_start_iterate_at(state->swh, &iter, pg_prng_uint32(&state->prng));
+	while ((entry = swh_iterate(state->swh, &iter)) != NULL)
+	{
+		uint32		key = entry->key;
+
+		if (key % 2 == 1)
+			CHECK_NAME(delete) (state, key);
+	}
+
+	ref_start_iterate(state->ref, &refiter);
+	while ((entry = ref_iterate(state->ref, &refiter)) != NULL)
+	{
+		if (entry->key % 2 == 1)
+			elog(ERROR, "key %u was not visited by iteration", entry->key);
+	}
+
+	CHECK_NAME(verify) (state);
+}
+
+static void
+CHECK_NAME(init) (CheckState *state, uint32 nelements, uint64 seed)
+{
+	state->swh = swh_create(CurrentMemoryContext, nelements, NULL);
+	state->ref = ref_create(CurrentMemoryContext, nelements, NULL);
+	pg_prng_seed(&state->prng, seed);
+	state->rebuilds = 0;
+	state->tracking = false;
+}
+
+static void
+CHECK_NAME(finish) (CheckState *state)
+{
+	CHECK_NAME(delete_while_iterating) (state);
+
+	swh_destroy(state->swh);
+	ref_destroy(state->ref);
+}
+
+/*
+ * Run 'nops' random insertions, deletions and lookups of keys below
+ * 'keyspace', starting from a tiny table.  'delete_pct' percent of the
+ * operations are deletions, and as many are lookups as insertions.
+ *
+ * Returns the number of same-size rebuilds.
+ */
+uint64
+CHECK_NAME(random) (uint64 seed, int nops, uint32 keyspace, int delete_pct)
+{
+	CheckState	state;
+
+	CHECK_NAME(init) (&state, 1, seed);
+
+	for (int i = 0; i < nops; i++)
+	{
+		uint32		key = pg_prng_uint64_range(&state.prng, 0, keyspace - 1);
+		int			op = pg_prng_uint64_range(&state.prng, 0, 99);
+
+		if (op < delete_pct)
+			CHECK_NAME(delete) (&state, key);
+		else if (op < delete_pct + (100 - delete_pct) / 2)
+			CHECK_NAME(insert) (&state, key);
+		else
+			CHECK_NAME(lookup) (&state, key);
+
+		if (i % CHECK_VERIFY_INTERVAL == 0)
+			CHECK_NAME(verify) (&state);
+	}
+
+	CHECK_NAME(finish) (&state);
+
+	return state.rebuilds;
+}
+
+/*
+ * Insert 'nops' consecutive keys, deleting each key again once 'window' newer
+ * ones are in the table.  The table is created for twice that many elements.
+ * If 'window' is also below half of its grow threshold, which depends on how
+ * its size got rounded up, the table never needs to grow; the tombstones of
+ * the deleted keys pile up instead, until it gets rebuilt at the same size.
+ *
+ * Returns the number of same-size rebuilds.
+ */
+uint64
+CHECK_NAME(sliding) (int nops, uint32 window)
+{
+	CheckState	state;
+
+	CHECK_NAME(init) (&state, window * 2, 0);
+
+	for (int i = 0; i < nops; i++)
+	{
+		CHECK_NAME(insert) (&state, i);
+		if (i >= window)
+			CHECK_NAME(delete) (&state, i - window);
+
+		CHECK_NAME(lookup) (&state, pg_prng_uint64_range(&state.prng, 0, i));
+
+		if (i % CHECK_VERIFY_INTERVAL == 0)
+			CHECK_NAME(verify) (&state);
+	}
+
+	CHECK_NAME(finish) (&state);
+
+	return state.rebuilds;
+}
@@ -0,0 +1,19 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_swisshash_nosimd.c
+ *		Checks of swisshash.h without SIMD instructions.
+ *
+ * Copyright (c) 2025, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_swisshash/test_swisshash_nosimd.c
+ *
+ * -------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "test_swisshash.h"
+
+#define SWISSHASH_NO_SIMD
+#define CHECK_NAME(name) CppConcat(swisshash_nosimd_, name)
+#include "test_swisshash_check.c"
@@ -0,0 +1,73 @@
+
+# Copyright (c) 2025, PostgreSQL Global Development Group
+
+# Test connection proxies, which share a pool of backends among the clients
+# connected to proxy_port.
+
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+if ($windows_os)
+{
+	plan skip_all => 'connection proxies are not supported on Windows';
+}
+
+my $proxy_port = PostgreSQL::Test::Cluster::get_free_port();
+
+# A single backend per pool makes sharing easy to observe
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq{
+listen_addresses = '127.0.0.1'
+proxy_port = $proxy_port
+connection_proxies = 1
+session_pool_size = 1
+});
+$node->start;
+
+my $connstr = "host=127.0.0.1 port=$proxy_port dbname=postgres";
+
+my $s1 = $node->background_psql('postgres', connstr => $connstr);
+my $s2 = $node->background_psql('postgres', connstr => $connstr);
+
+my $pid1 = $s1->query_safe('SELECT pg_backend_pid()');
+my $pid2 = $s2->query_safe('SELECT pg_backend_pid()');
+is($pid2, $pid1, 'sessions share the backend of the pool');
+
+# Each session sees its own prepared statement, despite the same name
+$s1->query_safe("SELECT 'one' \\parse s1");
+$s2->query_safe("SELECT 'two' \\parse s1");
+is($s1->query_safe("\\bind_named s1 \\g"),
+	'one', 'prepared statement of first session');
+is($s2->query_safe("\\bind_named s1 \\g"),
+	'two', 'prepared statement of second session');
+
+# A temporary table pins the first session to the backend, which leaves the
+# pool.  The next connection refills it.
+$s1->query_safe('CREATE TEMP TABLE pinned (a int)');
+
+my $s3 = $node->background_psql('postgres', connstr => $connstr);
+my $pid3 = $s3->query_safe('SELECT pg_backend_pid()');
+isnt($pid3, $pid1, 'new connection is served by a new backend');
+is($s2->query_safe('SELECT pg_backend_pid()'),
+	$pid3, 'unpinned session moves to the new backend');
+is($s2->query_safe("\\bind_named s1 \\g"),
+	'two', 'prepared statement is recreated in the new backend');
+is($s1->query_safe('SELECT pg_backend_pid(), count(*) FROM pinned'),
+	"$pid1|0", 'pinned session keeps its backend');
+
+$s1->quit;
+$s2->quit;
+$s3->quit;
+
+# Connections over the regular port are not affected
+isnt($node->safe_psql('postgres', 'SELECT pg_backend_pid()'),
+	$pid1, 'regular connection has its own backend');
+
+$node->stop;
+
+done_testing();
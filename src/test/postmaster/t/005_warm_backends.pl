@@ -0,0 +1,67 @@
+
+# Copyright (c) 2025, PostgreSQL Global Development Group
+
+# Test warm backends, which are forked ahead of time and handed new
+# connections by the postmaster.
+
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+if ($windows_os)
+{
+	plan skip_all => 'warm backends are not supported on Windows';
+}
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq{
+warm_backends = 2
+work_mem = '4MB'
+});
+$node->start;
+
+# Each of these connections should find a warm backend waiting
+for my $i (1 .. 3)
+{
+	is($node->safe_psql('postgres', 'SELECT 1'),
+		'1', "connection $i succeeds");
+}
+
+ok( $node->poll_query_until(
+		'postgres',
+		"SELECT warm_backend_hits >= 3 FROM pg_stat_database WHERE datname = 'postgres'"
+	),
+	'connections were handed to warm backends');
+
+# Warm backends forked before a reload must not serve connections with the
+# old configuration.
+$node->append_conf('postgresql.conf', "work_mem = '8MB'");
+$node->reload;
+ok( $node->poll_query_until('postgres', 'SHOW work_mem', '8MB'),
+	'new connections see the reloaded configuration');
+is($node->safe_psql('postgres', 'SHOW work_mem'),
+	'8MB', 'reloaded configuration is used consistently');
+
+# With warm_backends disabled, connections are forked as usual
+$node->append_conf('postgresql.conf', 'warm_backends = 0');
+$node->reload;
+$node->poll_query_until('postgres', 'SHOW warm_backends', '0');
+my $hits = $node->safe_psql('postgres',
+	"SELECT warm_backend_hits FROM pg_stat_database WHERE datname = 'postgres'"
+);
+$node->safe_psql('postgres', 'SELECT 1') for 1 .. 2;
+$node->safe_psql('postgres', 'SELECT pg_stat_force_next_flush()');
+is( $node->safe_psql(
+		'postgres',
+		"SELECT warm_backend_hits FROM pg_stat_database WHERE datname = 'postgres'"
+	),
+	$hits,
+	'no warm backends are used when disabled');
+
+$node->stop;
+
+done_testing();
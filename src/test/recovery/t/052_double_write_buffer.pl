@@ -0,0 +1,54 @@
+# Copyright (c) 2025, PostgreSQL Global Development Group
+#
+# Check that crash recovery repairs a torn data page from the double-write
+# buffer when full_page_writes is off.
+
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('main');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq(
+full_page_writes = off
+double_write_buffer = on
+autovacuum = off
+));
+$node->start;
+
+$node->safe_psql('postgres',
+	'CREATE TABLE dw_test AS SELECT g AS i, repeat(\'x\', 100) AS t FROM generate_series(1, 1000) g'
+);
+
+# Write out the pages, through the double-write buffer
+$node->safe_psql('postgres', 'CHECKPOINT');
+
+my $relpath = $node->safe_psql('postgres',
+	q{SELECT pg_relation_filepath('dw_test')});
+$node->stop('immediate');
+
+# Simulate a torn write of the first page: keep its first half and zero the
+# rest.
+my $file = $node->data_dir . '/' . $relpath;
+open my $fh, '+<', $file or die "could not open $file: $!";
+binmode $fh;
+sysseek($fh, 4096, 0) or die "could not seek in $file: $!";
+syswrite($fh, "\0" x 4096) == 4096 or die "could not write $file: $!";
+close $fh;
+
+my $log_offset = -s $node->logfile;
+$node->start;
+ok( $node->log_contains(
+		qr/restored \d+ pages? from the double-write buffer/, $log_offset),
+	'torn page restored from double-write buffer');
+
+is( $node->safe_psql('postgres', 'SELECT count(*), sum(i) FROM dw_test'),
+	'1000|500500',
+	'table contents intact after recovery');
+
+$node->stop;
+
+done_testing();
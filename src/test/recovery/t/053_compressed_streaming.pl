@@ -0,0 +1,64 @@
+# Copyright (c) 2025, PostgreSQL Global Development Group
+#
+# Check that a standby can stream WAL compressed with each of the supported
+# methods, and switch between them on reload.
+
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my @methods;
+push @methods, 'lz4' if check_pg_config("#define USE_LZ4 1");
+push @methods, 'zstd:level=1' if check_pg_config("#define USE_ZSTD 1");
+
+plan skip_all => 'neither lz4 nor zstd is supported by this build'
+  unless @methods;
+
+my $primary = PostgreSQL::Test::Cluster->new('primary');
+$primary->init(allows_streaming => 1);
+$primary->start;
+
+my $backup_name = 'my_backup';
+$primary->backup($backup_name);
+
+my $standby = PostgreSQL::Test::Cluster->new('standby');
+$standby->init_from_backup($primary, $backup_name, has_streaming => 1);
+$standby->start;
+
+$primary->safe_psql('postgres', 'CREATE TABLE t (i int, t text)');
+
+my $rows = 0;
+foreach my $method (@methods)
+{
+	$standby->append_conf('postgresql.conf',
+		"wal_receiver_compression = '$method'");
+	$standby->reload;
+
+	# The walreceiver restarts to pick up the new setting
+	$primary->poll_query_until('postgres',
+		"SELECT count(*) = 1 FROM pg_stat_replication WHERE state = 'streaming'"
+	) or die "timed out waiting for standby to stream";
+
+	$primary->safe_psql('postgres',
+		"INSERT INTO t SELECT g, repeat('x', 500) FROM generate_series(1, 10000) g"
+	);
+	$rows += 10000;
+	$primary->wait_for_replay_catchup($standby);
+
+	is($standby->safe_psql('postgres', 'SELECT count(*) FROM t'),
+		$rows, "WAL streamed with compression $method");
+}
+
+# An invalid setting is rejected, and streaming goes on with the old one
+$standby->append_conf('postgresql.conf', "wal_receiver_compression = 'gzip'");
+$standby->reload;
+$primary->safe_psql('postgres',
+	"INSERT INTO t SELECT g, 'y' FROM generate_series(1, 100) g");
+$rows += 100;
+$primary->wait_for_replay_catchup($standby);
+is($standby->safe_psql('postgres', 'SELECT count(*) FROM t'),
+	$rows, 'streaming continues after invalid compression setting');
+
+done_testing();
@@ -29,6 +29,25 @@ SELECT any_value(v) FROM (VALUES (NULL)) AS v (v);
 SELECT any_value(v) FROM (VALUES (NULL), (1), (2)) AS v (v);
 SELECT any_value(v) FROM (VALUES (array['hello', 'world'])) AS v (v);
 
+SELECT approx_count_distinct(v) FROM (VALUES (1), (2), (2), (NULL)) AS v (v);
+SELECT approx_count_distinct(v) FROM (VALUES (NULL::int)) AS v (v);
+SELECT approx_count_distinct(v) FROM (VALUES (1)) AS v (v) WHERE false;
+SELECT abs(approx_count_distinct(g % 10000) - 10000) < 500 AS ok,
+       abs(approx_count_distinct(g::text, 14) - 20000) < 500 AS ok14
+  FROM generate_series(1, 20000) g;
+SELECT approx_count_distinct(v, 3) FROM (VALUES (1)) AS v (v);
+SELECT approx_count_distinct(v, g) FROM (VALUES (1, 4), (2, 5)) AS v (v, g);
+
+SELECT approx_percentile(v, 0.5) FROM (VALUES (1), (2), (3), (4), (5), (NULL)) AS v (v);
+SELECT approx_percentile(v, 0) AS min, approx_percentile(v, 1) AS max
+  FROM (VALUES (3), (1), (2)) AS v (v);
+SELECT approx_percentile(v, 0.5) FROM (VALUES (NULL::float8)) AS v (v);
+SELECT abs(approx_percentile(g, 0.5) - 50000) < 50 AS p50,
+       abs(approx_percentile(g, 0.99) - 99000) < 50 AS p99
+  FROM generate_series(1, 100000) g;
+SELECT approx_percentile(v, 1.5) FROM (VALUES (1)) AS v (v);
+SELECT approx_percentile(v, f) FROM (VALUES (1, 0.5), (2, 0.9)) AS v (v, f);
+
 -- In 7.1, avg(float4) is computed using float8 arithmetic.
 -- Round the result to 3 digits to avoid platform-specific results.
 
@@ -715,6 +734,22 @@ explain (costs off)
 select sum(two order by two) from tenk1;
 reset enable_presorted_aggregate;
 
+-- DISTINCT aggregates whose result doesn't depend on the order of their
+-- input eliminate duplicates with a hash table rather than by sorting
+select count(distinct a), sum(distinct a), regr_count(distinct a, b)
+  from (values (1, 1), (2, 2), (1, 1), (null, 2), (2, 3)) v(a, b);
+select two, four, count(distinct ten), regr_count(distinct four, ten)
+  from tenk1 group by rollup (two, four) order by two, four;
+
+-- once the hash table outgrows hash_mem, the remaining input is sorted
+set work_mem = '64kB';
+set hash_mem_multiplier = 1;
+select count(distinct unique1), count(distinct unique1 % 1000),
+       sum(distinct unique2 % 5000)
+  from tenk1;
+reset work_mem;
+reset hash_mem_multiplier;
+
 --
 -- Test cases with FILTER clause
 --
@@ -1524,6 +1559,17 @@ SELECT balk(hundred) FROM tenk1;
 
 ROLLBACK;
 
+-- approx_percentile() supports parallel aggregation, too
+BEGIN;
+ALTER TABLE tenk1 set (parallel_workers = 4);
+SET LOCAL parallel_setup_cost=0;
+SET LOCAL max_parallel_workers_per_gather=4;
+
+EXPLAIN (COSTS OFF) SELECT approx_percentile(hundred, 0.9) FROM tenk1;
+SELECT approx_percentile(hundred, 0.9) BETWEEN 89 AND 90 AS ok FROM tenk1;
+
+ROLLBACK;
+
 -- test multiple usage of an aggregate whose finalfn returns a R/W datum
 BEGIN;
 
@@ -1725,6 +1771,23 @@ create table agg_hash_4 as
 select (g/2)::numeric as c1, array_agg(g::numeric) as c2, count(*) as c3
   from agg_data_2k group by g/2;
 
+-- Partial aggregation, which flushes its hash table rather than spilling
+-- when aggregation doesn't reduce the input much
+
+set parallel_setup_cost = 0;
+set parallel_tuple_cost = 0;
+set min_parallel_table_scan_size = 0;
+set max_parallel_workers_per_gather = 2;
+
+create table agg_hash_5 as
+select g%10000 as c1, sum(g::numeric) as c2, count(*) as c3
+  from agg_data_20k group by g%10000;
+
+reset parallel_setup_cost;
+reset parallel_tuple_cost;
+reset min_parallel_table_scan_size;
+reset max_parallel_workers_per_gather;
+
 set enable_sort = true;
 set work_mem to default;
 
@@ -1746,6 +1809,10 @@ set work_mem to default;
   union all
 (select * from agg_group_4 except select * from agg_hash_4);
 
+(select * from agg_hash_5 except select * from agg_group_1)
+  union all
+(select * from agg_group_1 except select * from agg_hash_5);
+
 drop table agg_group_1;
 drop table agg_group_2;
 drop table agg_group_3;
@@ -1754,3 +1821,4 @@ drop table agg_hash_1;
 drop table agg_hash_2;
 drop table agg_hash_3;
 drop table agg_hash_4;
+drop table agg_hash_5;
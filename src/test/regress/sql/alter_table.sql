@@ -1730,6 +1730,31 @@ $$);
 DROP FUNCTION check_ddl_rewrite(regclass, text);
 DROP TABLE rewrite_test;
 
+-- a rewrite can be shared with parallel workers
+CREATE TABLE rewrite_parallel (a int, b text) WITH (parallel_workers = 2);
+INSERT INTO rewrite_parallel SELECT i, i::text FROM generate_series(1, 10000) i;
+SET max_parallel_maintenance_workers = 2;
+ALTER TABLE rewrite_parallel ALTER COLUMN a TYPE bigint,
+  ADD COLUMN c int DEFAULT 42 CHECK (c > 0);
+SELECT count(*), sum(a), count(DISTINCT b), min(c), max(c) FROM rewrite_parallel;
+-- constraint violations are reported whichever process finds them
+\set VERBOSITY terse
+ALTER TABLE rewrite_parallel ALTER COLUMN b TYPE int USING b::int,
+  ADD CHECK (b < 9000);
+-- constraints can be verified in parallel without a rewrite
+ALTER TABLE rewrite_parallel
+  ADD CONSTRAINT rewrite_parallel_a_check CHECK (a <= 10000) NOT VALID;
+ALTER TABLE rewrite_parallel VALIDATE CONSTRAINT rewrite_parallel_a_check;
+ALTER TABLE rewrite_parallel
+  ADD CONSTRAINT rewrite_parallel_a_check2 CHECK (a < 10000);
+CREATE TABLE rewrite_parallel_pk (a bigint PRIMARY KEY);
+INSERT INTO rewrite_parallel_pk SELECT generate_series(1, 9999);
+ALTER TABLE rewrite_parallel
+  ADD CONSTRAINT rewrite_parallel_a_fkey FOREIGN KEY (a) REFERENCES rewrite_parallel_pk;
+\set VERBOSITY default
+RESET max_parallel_maintenance_workers;
+DROP TABLE rewrite_parallel, rewrite_parallel_pk;
+
 --
 -- lock levels
 --
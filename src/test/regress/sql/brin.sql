@@ -534,3 +534,14 @@ CREATE INDEX brin_insert_optimization_idx ON brin_insert_optimization USING brin
 UPDATE brin_insert_optimization SET a = a;
 REINDEX INDEX CONCURRENTLY brin_insert_optimization_idx;
 DROP TABLE brin_insert_optimization;
+
+-- test MIN/MAX narrowed by BRIN summaries, including stale summaries
+CREATE TABLE brin_minmax_agg (a int) WITH (autovacuum_enabled = off);
+INSERT INTO brin_minmax_agg SELECT g FROM generate_series(1, 10000) g;
+CREATE INDEX brin_minmax_agg_idx ON brin_minmax_agg USING brin (a)
+  WITH (pages_per_range = 2);
+SELECT min(a), max(a) FROM brin_minmax_agg;
+-- the summaries still cover the deleted rows, so the fallback is needed
+DELETE FROM brin_minmax_agg WHERE a <= 1000 OR a > 9000;
+SELECT min(a), max(a) FROM brin_minmax_agg;
+DROP TABLE brin_minmax_agg;
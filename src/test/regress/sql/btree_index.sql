@@ -438,3 +438,39 @@ CREATE TABLE btree_part (id int4) PARTITION BY RANGE (id);
 CREATE INDEX btree_part_idx ON btree_part(id);
 ALTER INDEX btree_part_idx ALTER COLUMN id SET (n_distinct=100);
 DROP TABLE btree_part;
+
+--
+-- Test index scans that read ahead to prefetch heap blocks
+--
+set index_prefetch_distance to 8;
+set enable_seqscan to false;
+set enable_bitmapscan to false;
+set enable_indexonlyscan to false;
+explain (costs off)
+select count(*), sum(ten), sum(hundred) from tenk1 where unique1 < 1000;
+select count(*), sum(ten), sum(hundred) from tenk1 where unique1 < 1000;
+explain (costs off)
+select unique1, ten from tenk1 where unique1 > 9994 order by unique1 desc;
+select unique1, ten from tenk1 where unique1 > 9994 order by unique1 desc;
+select unique1 from tenk1 where unique1 >= 5000 order by unique1 limit 3;
+-- rescans must forget entries read ahead for the previous outer row
+select count(*), sum(t.unique1) from generate_series(0, 9) g, tenk1 t
+  where t.unique1 between g * 100 and g * 100 + 9;
+-- index-only scans check the visibility map as they read ahead
+create table btree_ios_prefetch (a int, b int) with (autovacuum_enabled = off);
+insert into btree_ios_prefetch select g, g % 10 from generate_series(1, 2000) g;
+create index btree_ios_prefetch_idx on btree_ios_prefetch (a, b);
+vacuum analyze btree_ios_prefetch;
+update btree_ios_prefetch set b = b + 1 where a % 100 = 0;
+delete from btree_ios_prefetch where a = 700;
+set enable_indexonlyscan to true;
+explain (costs off)
+select count(*), sum(b) from btree_ios_prefetch where a < 1500;
+select count(*), sum(b) from btree_ios_prefetch where a < 1500;
+select count(*), sum(t.b) from generate_series(0, 9) g, btree_ios_prefetch t
+  where t.a between g * 100 and g * 100 + 9;
+drop table btree_ios_prefetch;
+reset index_prefetch_distance;
+reset enable_seqscan;
+reset enable_bitmapscan;
+reset enable_indexonlyscan;
@@ -269,6 +269,20 @@ select * from
         tenthous, lag(tenthous) over () as ltenthous from clstr_4) ss
 where row(hundred, thousand, tenthous) <= row(lhundred, lthousand, ltenthous);
 
+-- Test parallel CLUSTER, after deleting some rows
+alter table clstr_4 set (parallel_workers = 2);
+delete from clstr_4 where tenthous % 10 = 0;
+set max_parallel_maintenance_workers = 2;
+cluster clstr_4 using cluster_sort;
+alter table clstr_4 reset (parallel_workers);
+select count(*) from clstr_4;
+select * from
+(select hundred, lag(hundred) over () as lhundred,
+        thousand, lag(thousand) over () as lthousand,
+        tenthous, lag(tenthous) over () as ltenthous from clstr_4) ss
+where row(hundred, thousand, tenthous) <= row(lhundred, lthousand, ltenthous);
+reset max_parallel_maintenance_workers;
+
 reset enable_indexscan;
 reset maintenance_work_mem;
 
@@ -419,3 +419,30 @@ CREATE TABLE pp_510 PARTITION OF pp_2 FOR VALUES FROM (5) TO (10);
 INSERT INTO pp SELECT g, 10 + g FROM generate_series(1,6) g;
 COPY pp TO stdout(header);
 DROP TABLE PP;
+
+-- COPY FROM inserts into non-unique btree indexes in sorted batches, and
+-- into unique ones a row at a time.
+CREATE TABLE copy_batch (a int, b text);
+CREATE INDEX copy_batch_a ON copy_batch (a DESC NULLS LAST);
+CREATE INDEX copy_batch_b ON copy_batch (lower(b)) WHERE a > 2;
+CREATE UNIQUE INDEX copy_batch_ab ON copy_batch (a, b);
+COPY copy_batch FROM stdin;
+5	E
+1	a
+\N	x
+3	C
+4	d
+2	b
+3	c
+\.
+COPY copy_batch FROM stdin;
+6	f
+3	c
+\.
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT a FROM copy_batch ORDER BY a DESC NULLS LAST;
+SELECT count(*) FROM copy_batch WHERE a > 2 AND lower(b) = 'c';
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE copy_batch;
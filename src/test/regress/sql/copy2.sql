@@ -710,3 +710,38 @@ truncate copy_default;
 
 -- DEFAULT cannot be used in COPY TO
 copy (select 1 as test) TO stdout with (default '\D');
+
+-- PARALLEL option
+create table copy_parallel (a int primary key, b text, c int default 7);
+copy copy_parallel (a, b) from stdin with (parallel 2);
+1	one
+2	two
+3	three
+\.
+
+copy copy_parallel from stdin with (format csv, header, parallel 2);
+a,b,c
+4,"multi
+line",40
+5,five,50
+\.
+
+select a, replace(b, E'\n', ' ') as b, c from copy_parallel order by a;
+
+-- a table with insert triggers is loaded serially
+create function copy_parallel_trig() returns trigger language plpgsql as
+$$ begin new.c := new.c + 1; return new; end $$;
+create trigger copy_parallel_trig before insert on copy_parallel
+  for each row execute function copy_parallel_trig();
+copy copy_parallel from stdin with (parallel 2);
+6	six	60
+\.
+
+select a, b, c from copy_parallel where a = 6;
+
+-- PARALLEL must be in range, and cannot be used in COPY TO
+copy copy_parallel from stdin with (parallel -1);
+copy (select 1) to stdout with (parallel 2);
+
+drop table copy_parallel;
+drop function copy_parallel_trig();
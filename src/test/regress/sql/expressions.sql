@@ -209,3 +209,51 @@ select * from inttest where a not in (1::myint,2::myint,3::myint,4::myint,5::myi
 select * from inttest where a not in (0::myint,2::myint,3::myint,4::myint,5::myint, null);
 
 rollback;
+
+--
+-- Batched evaluation of simple quals in sequential scans
+--
+CREATE TEMP TABLE batchq AS
+  SELECT i AS a, i::int8 * 1000000000 AS b, (i / 4.0)::float8 AS c,
+         date '2000-01-01' + i AS d, i % 3 AS e
+  FROM generate_series(1, 1000) i;
+INSERT INTO batchq VALUES (0, 0, 'NaN', NULL, 0), (NULL, NULL, NULL, NULL, NULL);
+SET seqscan_batch_size = 16;
+EXPLAIN (COSTS OFF) SELECT count(*) FROM batchq WHERE a > 100 AND 500 >= a;
+SELECT count(*) FROM batchq WHERE a > 100 AND 500 >= a;
+SELECT count(*) FROM batchq WHERE b < 5000000000 AND a <> 3;
+SELECT count(*) FROM batchq WHERE c >= 249.5;
+SELECT count(*) FROM batchq WHERE d < '2000-01-11';
+-- mix of batched and row-by-row clauses
+SELECT count(*) FROM batchq WHERE a <= 30 AND e = 0 AND a % 5 = 0;
+-- rescans, with a clause that can't be batched because of the outer reference
+SELECT x, (SELECT count(*) FROM batchq WHERE a < x AND e = 1)
+FROM (VALUES (3), (10)) v(x);
+-- clauses on later columns first; rows are deformed in column order
+SELECT a, c, e FROM batchq WHERE d < '2000-01-08' AND e <> 1 AND a > 3 ORDER BY a;
+-- system columns must survive being fetched ahead
+SELECT a, tableoid = 'batchq'::regclass FROM batchq WHERE a < 3 ORDER BY a;
+-- WHERE CURRENT OF must find the row the cursor returned, not one read ahead
+BEGIN;
+DECLARE batchc CURSOR FOR SELECT a FROM batchq WHERE a > 5 AND a < 9;
+FETCH batchc;
+UPDATE batchq SET e = -1 WHERE CURRENT OF batchc;
+FETCH batchc;
+DELETE FROM batchq WHERE CURRENT OF batchc;
+SELECT a, e FROM batchq WHERE a BETWEEN 5 AND 9 ORDER BY a;
+ROLLBACK;
+RESET seqscan_batch_size;
+DROP TABLE batchq;
+
+--
+-- Fast paths for simple quals
+--
+CREATE TEMP TABLE fastq (a int4, b int8, t text);
+INSERT INTO fastq VALUES (1, 10, 'one'), (2, 20, 'two'), (NULL, NULL, NULL), (2, 30, 'two');
+SELECT * FROM fastq WHERE a = 2 ORDER BY b;
+SELECT * FROM fastq WHERE b = 20::int8;
+SELECT * FROM fastq WHERE 'one' = t;
+SELECT * FROM fastq WHERE a IS NOT NULL AND t <> 'one' ORDER BY b;
+SELECT count(*) FROM fastq WHERE b IS NOT NULL AND a = 1;
+SELECT count(*) FROM fastq WHERE a IS NOT NULL AND b IS NOT NULL;
+DROP TABLE fastq;
@@ -2434,3 +2434,17 @@ WITH cte AS (
 
 DROP SCHEMA fkpart13 CASCADE;
 RESET search_path;
+
+-- FK checks against a plain table probe its unique index directly; make sure
+-- that works with key columns out of index order and with cross-type keys
+CREATE TABLE fkidx_pk (a int, b text, PRIMARY KEY (b, a));
+CREATE TABLE fkidx_fk (x int8, y varchar,
+  FOREIGN KEY (x, y) REFERENCES fkidx_pk (a, b));
+INSERT INTO fkidx_pk VALUES (1, 'one'), (2, 'two');
+INSERT INTO fkidx_fk VALUES (1, 'one'), (2, 'two'), (NULL, 'three');
+INSERT INTO fkidx_fk VALUES (2, 'one');
+UPDATE fkidx_fk SET x = 3 WHERE x = 1;
+DELETE FROM fkidx_pk WHERE a = 2;
+INSERT INTO fkidx_fk VALUES (2, 'two');
+SELECT * FROM fkidx_fk ORDER BY x;
+DROP TABLE fkidx_fk, fkidx_pk;
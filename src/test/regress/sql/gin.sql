@@ -19,6 +19,14 @@ vacuum gin_test_tbl; -- flush the fastupdate buffers
 
 select gin_clean_pending_list('gin_test_idx'); -- nothing to flush
 
+-- With autocleanup, cleanup of an overflowing pending list is left to
+-- autovacuum, if it's running
+alter index gin_test_idx set (autocleanup = on, gin_pending_list_limit = 64);
+insert into gin_test_tbl select array[4, g] from generate_series(1, 1000) g;
+select count(*) from gin_test_tbl where i @> array[4];
+alter index gin_test_idx reset (autocleanup, gin_pending_list_limit);
+delete from gin_test_tbl where i @> array[4];
+
 -- Test vacuuming
 delete from gin_test_tbl where i @> array[2];
 vacuum gin_test_tbl;
@@ -37,6 +37,16 @@ vacuum analyze gist_point_tbl;
 alter index gist_pointidx SET (fillfactor = 40);
 reindex index gist_pointidx;
 
+-- rebuild it again using a parallel sorted build
+begin;
+set local min_parallel_table_scan_size = 0;
+set local max_parallel_maintenance_workers = 2;
+reindex index gist_pointidx;
+commit;
+set enable_seqscan = off;
+select count(*) from gist_point_tbl where p <@ box(point(0,0), point(100000, 100000));
+reset enable_seqscan;
+
 --
 -- Test Index-only plans on GiST indexes
 --
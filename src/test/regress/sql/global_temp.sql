@@ -0,0 +1,117 @@
+--
+-- GLOBAL TEMP
+-- Test global temporary tables and their indexes
+--
+
+CREATE GLOBAL TEMPORARY TABLE gtt (a int PRIMARY KEY, b text);
+
+SELECT relname, relpersistence FROM pg_class
+  WHERE relname IN ('gtt', 'gtt_pkey') ORDER BY relname;
+
+-- the session's contents are private, and start out empty
+SELECT * FROM gtt;
+
+INSERT INTO gtt VALUES (1, 'one'), (2, 'two');
+
+SELECT * FROM gtt ORDER BY a;
+
+INSERT INTO gtt VALUES (1, 'uno');
+
+-- an index created after rows were inserted covers them
+CREATE INDEX gtt_b_idx ON gtt (b);
+
+SET enable_seqscan = off;
+
+SELECT a FROM gtt WHERE b = 'two';
+
+-- TRUNCATE is transactional
+BEGIN;
+TRUNCATE gtt;
+SELECT count(*) FROM gtt;
+INSERT INTO gtt VALUES (3, 'three');
+SELECT a FROM gtt WHERE b = 'three';
+ROLLBACK;
+
+SELECT a FROM gtt ORDER BY a;
+SELECT a FROM gtt WHERE b = 'three';
+
+BEGIN;
+SAVEPOINT s1;
+TRUNCATE gtt;
+ROLLBACK TO SAVEPOINT s1;
+SELECT count(*) FROM gtt;
+SAVEPOINT s2;
+TRUNCATE gtt;
+RELEASE SAVEPOINT s2;
+SELECT count(*) FROM gtt;
+ROLLBACK;
+
+SELECT count(*) FROM gtt;
+
+TRUNCATE gtt;
+
+SELECT count(*) FROM gtt;
+
+INSERT INTO gtt VALUES (1, 'one'), (2, 'two');
+
+REINDEX TABLE gtt;
+
+SELECT a FROM gtt WHERE b = 'one';
+
+RESET enable_seqscan;
+
+-- VACUUM processes the session's contents; VACUUM FULL can't
+VACUUM gtt;
+
+VACUUM ANALYZE gtt;
+
+VACUUM FULL gtt;
+
+SELECT a FROM gtt ORDER BY a;
+
+-- commands that rewrite the table are not supported
+CLUSTER gtt USING gtt_pkey;
+
+ALTER TABLE gtt SET TABLESPACE pg_default;
+
+-- only ON COMMIT PRESERVE ROWS is supported
+CREATE GLOBAL TEMPORARY TABLE gtt_delete (a int) ON COMMIT DELETE ROWS;
+
+CREATE GLOBAL TEMPORARY TABLE gtt_drop (a int) ON COMMIT DROP;
+
+CREATE GLOBAL TEMPORARY TABLE gtt_preserve (a int) ON COMMIT PRESERVE ROWS;
+
+BEGIN;
+INSERT INTO gtt_preserve VALUES (1);
+COMMIT;
+
+SELECT * FROM gtt_preserve;
+
+-- a new session sees only its own contents, and creates its files for the
+-- table when it first uses it
+\c -
+
+SELECT pg_stat_file(pg_relation_filepath('gtt'), true) IS NULL AS no_file;
+
+SELECT count(*) FROM gtt;
+
+SELECT pg_stat_file(pg_relation_filepath('gtt'), true) IS NULL AS no_file;
+
+INSERT INTO gtt VALUES (1, 'eins');
+
+SET enable_seqscan = off;
+
+SELECT a FROM gtt WHERE b = 'eins';
+
+RESET enable_seqscan;
+
+SELECT * FROM gtt_preserve;
+
+-- dropping the table removes the session's files
+SELECT pg_relation_filepath('gtt') AS gtt_path \gset
+
+DROP TABLE gtt;
+
+SELECT pg_stat_file(:'gtt_path', true) IS NULL AS removed;
+
+DROP TABLE gtt_preserve;
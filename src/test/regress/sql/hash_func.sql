@@ -262,3 +262,26 @@ SELECT hashfloat4('NaN'::float4) = hashfloat4(-'NaN'::float4) AS t;
 SELECT hashfloat8('0'::float8) = hashfloat8('-0'::float8) AS t;
 SELECT hashfloat8('NaN'::float8) = hashfloat8(-'NaN'::float8) AS t;
 SELECT hashfloat4('NaN'::float4) = hashfloat8('NaN'::float8) AS t;
+
+--
+-- Hash functions for in-memory hash tables, used with fast_hash_functions
+--
+SELECT hashtextfast('') = hashtextfast(''::text COLLATE "C") AS t;
+SELECT hashtextfast(repeat('x', 100)) = hashtextfast(repeat('x', 99) || 'x') AS t;
+SELECT hashbyteafast('\x0102'::bytea) != hashbyteafast('\x0201'::bytea) AS t;
+
+SET fast_hash_functions = on;
+SET enable_sort = off;
+SET enable_mergejoin = off;
+SET enable_nestloop = off;
+SELECT count(*) FROM
+  (SELECT v::text, count(*) FROM generate_series(1, 1000) v GROUP BY 1) s;
+SELECT count(*) FROM
+  (SELECT DISTINCT convert_to(v::text, 'UTF8') FROM generate_series(1, 1000) v) s;
+SELECT count(*) FROM
+  (SELECT v::text AS t FROM generate_series(1, 1000) v) a JOIN
+  (SELECT v::text AS t FROM generate_series(1, 1000, 2) v) b USING (t);
+RESET fast_hash_functions;
+RESET enable_sort;
+RESET enable_mergejoin;
+RESET enable_nestloop;
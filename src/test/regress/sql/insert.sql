@@ -674,3 +674,16 @@ alter table returningwrtest2 drop c;
 alter table returningwrtest attach partition returningwrtest2 for values in (2);
 insert into returningwrtest values (2, 'foo') returning returningwrtest;
 drop table returningwrtest;
+
+-- check routing of ordered input moving from one range partition to the next
+create table rangeroute (a int) partition by range (a);
+create table rangeroute1 partition of rangeroute for values from (0) to (20);
+create table rangeroute2 partition of rangeroute for values from (20) to (40);
+create table rangeroute3 partition of rangeroute for values from (60) to (80);
+create table rangeroute4 partition of rangeroute for values from (80) to (100);
+create table rangeroute_def partition of rangeroute default;
+insert into rangeroute select generate_series(0, 119);
+insert into rangeroute select generate_series(0, 19) union all select 5;
+select tableoid::regclass, count(*), min(a), max(a) from rangeroute
+  group by 1 order by 1;
+drop table rangeroute;
@@ -384,6 +384,17 @@ select count(*) from tenk1 x where
   x.unique1 in (select a.f1 from int4_tbl a,float8_tbl b where a.f1=b.f1) and
   x.unique1 = 0 and
   x.unique1 in (select aa.f1 from int4_tbl aa,float8_tbl bb where aa.f1=bb.f1);
+-- and with linearized join search (the second query checks outer join order)
+set linearized_join_search = on;
+select count(*) from tenk1 x where
+  x.unique1 in (select a.f1 from int4_tbl a,float8_tbl b where a.f1=b.f1) and
+  x.unique1 = 0 and
+  x.unique1 in (select aa.f1 from int4_tbl aa,float8_tbl bb where aa.f1=bb.f1);
+select count(*), count(c.unique1) from tenk1 a
+  left join (tenk1 b join tenk1 c on b.hundred = c.unique1)
+    on a.unique1 = b.unique2
+  join tenk1 d on d.unique1 = a.ten
+  where a.unique1 < 10;
 rollback;
 
 --
@@ -3681,6 +3692,11 @@ select * from j1
 inner join j2 on j1.id1 = j2.id1 and j1.id2 = j2.id2
 where j1.id1 % 1000 = 1 and j2.id1 % 1000 = 1 and j2.id1 >= any (array[1,5]);
 
+-- Exercise merge joins that restart the inner index scan at the outer key
+select count(*), sum(t2.unique1) from tenk1 t1
+join tenk1 t2 on t2.unique1 = t1.unique2 * 7
+where t1.unique2 < 1000;
+
 reset enable_nestloop;
 reset enable_hashjoin;
 reset enable_sort;
@@ -3780,3 +3796,50 @@ SELECT COUNT(*) FROM onek t1 LEFT JOIN tenk1 t2
     ON (t2.thousand = t1.tenthous OR t2.thousand = t1.thousand);
 SELECT COUNT(*) FROM onek t1 LEFT JOIN tenk1 t2
     ON (t2.thousand = t1.tenthous OR t2.thousand = t1.thousand);
+
+--
+-- Test adaptive nested loops switching to hashing at run time
+--
+create function adaptive_outer(n int) returns setof int language plpgsql
+rows 10 as $$ begin return query select generate_series(1, n); end $$;
+create function adaptive_join_strategy(query text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, summary off, timing off, buffers off) %s',
+            query)
+    loop
+        if ln like '%Join Strategy%' then
+            return next trim(ln);
+        end if;
+    end loop;
+end;
+$$;
+create table adaptive_inner (a int, b int);
+insert into adaptive_inner select i, i from generate_series(1, 100) i;
+insert into adaptive_inner values (50, -1), (null, 0);
+analyze adaptive_inner;
+set enable_hashjoin = off;
+set enable_mergejoin = off;
+select adaptive_join_strategy('select * from adaptive_outer(5000) as o(x)
+  left join adaptive_inner t on t.a = o.x');
+select count(*), count(t.b), sum(t.b) from adaptive_outer(5000) as o(x)
+  left join adaptive_inner t on t.a = o.x;
+select count(*), sum(t.b) from adaptive_outer(5000) as o(x)
+  join adaptive_inner t on t.a = o.x;
+select count(*) from adaptive_outer(5000) as o(x)
+  where not exists (select 1 from adaptive_inner t where t.a = o.x);
+set enable_adaptive_join = off;
+select adaptive_join_strategy('select * from adaptive_outer(5000) as o(x)
+  left join adaptive_inner t on t.a = o.x');
+select count(*), count(t.b), sum(t.b) from adaptive_outer(5000) as o(x)
+  left join adaptive_inner t on t.a = o.x;
+reset enable_adaptive_join;
+reset enable_hashjoin;
+reset enable_mergejoin;
+drop table adaptive_inner;
+drop function adaptive_join_strategy(text);
+drop function adaptive_outer(int);
@@ -157,6 +157,15 @@ $$
 $$);
 rollback to settings;
 
+-- the same, with compressed batch files
+savepoint settings;
+set local max_parallel_workers_per_gather = 0;
+set local work_mem = '128kB';
+set local hash_mem_multiplier = 1.0;
+set local temp_file_compression = pglz;
+select count(*), sum(r.id) from simple r join simple s using (id);
+rollback to settings;
+
 -- parallel with parallel-oblivious hash join
 savepoint settings;
 set local max_parallel_workers_per_gather = 2;
@@ -623,3 +632,95 @@ lateral (select t1.fivethous, i4.f1 from tenk1 t1 join int4_tbl i4
          on t1.fivethous = i4.f1+i8.q2 order by 1,2) ss;
 
 rollback;
+
+-- Verify that hash joins can push a Bloom filter of the inner keys down into
+-- the outer seqscan, and that doing so doesn't change the results.
+begin;
+set local hashjoin_bloom_filter = on;
+set local enable_mergejoin = off;
+set local enable_nestloop = off;
+set local max_parallel_workers_per_gather = 0;
+
+create temp table hjbloom_fact (id int, dim int, tag text);
+insert into hjbloom_fact
+  select g, g % 1000, 'tag ' || (g % 3) from generate_series(1, 10000) g;
+insert into hjbloom_fact values (0, null, null);
+create temp table hjbloom_dim (dim int, tag text);
+insert into hjbloom_dim
+  select g * 100, 'tag ' || (g % 3) from generate_series(0, 9) g;
+analyze hjbloom_fact, hjbloom_dim;
+
+-- Report how many outer rows the runtime filter discarded.
+create function hjbloom_removed(query text) returns bigint
+language plpgsql as
+$$
+declare
+  ln text;
+begin
+  for ln in
+    execute 'explain (analyze, costs off, timing off, summary off) ' || query
+  loop
+    if ln ~ 'Rows Removed by Runtime Filter' then
+      return substring(ln from '(\d+)$')::bigint;
+    end if;
+  end loop;
+  return 0;
+end;
+$$;
+
+explain (costs off)
+select count(*) from hjbloom_fact f join hjbloom_dim d using (dim);
+select count(*) from hjbloom_fact f join hjbloom_dim d using (dim);
+select hjbloom_removed('select * from hjbloom_fact f join hjbloom_dim d using (dim)') > 9000 as filtered;
+
+-- multiple keys, of different types
+select count(*), sum(f.id) from hjbloom_fact f join hjbloom_dim d using (dim, tag);
+select hjbloom_removed('select * from hjbloom_fact f join hjbloom_dim d using (dim, tag)') > 9000 as filtered;
+
+-- semijoin
+select count(*) from hjbloom_fact f
+  where exists (select 1 from hjbloom_dim d where d.dim = f.dim);
+
+-- not used for joins that emit unmatched outer rows
+select count(*) from hjbloom_fact f left join hjbloom_dim d using (dim);
+select hjbloom_removed('select * from hjbloom_fact f left join hjbloom_dim d using (dim)') as removed;
+
+rollback;
+
+-- Verify that fetching outer tuples ahead to prefetch their buckets doesn't
+-- change the results, including for multi-batch joins and rescans.
+begin;
+set local hashjoin_batch_size = 7;
+set local enable_mergejoin = off;
+set local enable_nestloop = off;
+set local max_parallel_workers_per_gather = 0;
+
+select count(*), sum(t1.unique1)
+  from tenk1 t1 join tenk1 t2 on t1.unique1 = t2.hundred;
+select count(*), count(t2.unique1)
+  from tenk1 t1 left join tenk1 t2 on t1.unique1 = t2.hundred;
+
+set local work_mem = '64kB';
+select count(*), sum(t1.unique1)
+  from tenk1 t1 join tenk1 t2 on t1.unique1 = t2.hundred;
+select count(*), count(t2.unique1)
+  from tenk1 t1 left join tenk1 t2 on t1.unique1 = t2.hundred;
+reset work_mem;
+
+-- a hash table large enough to be stored in bucket order
+set local hashjoin_radix_partition = on;
+set local work_mem = '64MB';
+create temp table hjradix as
+  select g as a, g % 1000 as b from generate_series(1, 300000) g;
+analyze hjradix;
+select count(*), sum(t.a) from hjradix t join hjradix u on t.a = u.b;
+select count(*) from hjradix t
+  where exists (select 1 from hjradix u where u.b = t.a);
+reset work_mem;
+
+select i8.q2, ss.* from
+int8_tbl i8,
+lateral (select t1.fivethous, i4.f1 from tenk1 t1 join int4_tbl i4
+         on t1.fivethous = i4.f1+i8.q2 order by 1,2) ss;
+
+rollback;
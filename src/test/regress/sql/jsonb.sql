@@ -1506,6 +1506,25 @@ select length(id), test_json[id] from test_jsonb_subscript;
 table test_jsonb_subscript;
 \x
 
+-- -> and ->> fetch only the parts of large values stored out of line
+create temp table test_jsonb_toast (id int, j jsonb);
+alter table test_jsonb_toast alter column j set storage external;
+insert into test_jsonb_toast
+  select 1, jsonb_object_agg('k' || i, md5(i::text)) ||
+            '{"nested": {"a": 1.5, "b": [1, 2]}, "n": null}'
+  from generate_series(1, 2000) i;
+insert into test_jsonb_toast
+  select 2, jsonb_agg(md5(i::text)) from generate_series(1, 2000) i;
+alter table test_jsonb_toast alter column j set storage extended;
+insert into test_jsonb_toast
+  select 3, jsonb_object_agg('k' || i, md5(i::text)) ||
+            '{"nested": {"a": 1.5, "b": [1, 2]}, "n": null}'
+  from generate_series(1, 2000) i;
+select id, j -> 'k1' as k1, j ->> 'k1999' as k1999, j -> 'nested' as nested,
+       j -> 'nested' ->> 'a' as a, j ->> 'n' as n, j -> 'k2001' as k2001
+  from test_jsonb_toast order by id;
+drop table test_jsonb_toast;
+
 -- jsonb to tsvector
 select to_tsvector('{"a": "aaa bbb ddd ccc", "b": ["eee fff ggg"], "c": {"d": "hhh iii"}}'::jsonb);
 
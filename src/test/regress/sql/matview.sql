@@ -318,3 +318,26 @@ EXPLAIN (ANALYZE, COSTS OFF, SUMMARY OFF, TIMING OFF, BUFFERS OFF)
   CREATE MATERIALIZED VIEW IF NOT EXISTS matview_ine_tab AS
     SELECT 1 / 0 WITH NO DATA; -- ok
 DROP MATERIALIZED VIEW matview_ine_tab;
+
+-- incremental maintenance
+CREATE TABLE mvi_base (g int, v int);
+INSERT INTO mvi_base VALUES (1, 10), (1, 20), (2, 5), (NULL, 7);
+CREATE INCREMENTAL MATERIALIZED VIEW mvi_incr AS
+  SELECT g, count(*) AS n, sum(v) AS s FROM mvi_base GROUP BY g;
+CREATE UNIQUE INDEX mvi_incr_g ON mvi_incr (g);
+SELECT * FROM mvi_incr ORDER BY g;
+INSERT INTO mvi_base VALUES (2, 1), (3, 3);
+SELECT * FROM mvi_incr ORDER BY g;
+UPDATE mvi_base SET g = 3 WHERE g = 1 AND v = 10;
+SELECT * FROM mvi_incr ORDER BY g;
+DELETE FROM mvi_base WHERE g IS NULL OR v = 20;
+SELECT * FROM mvi_incr ORDER BY g;
+TRUNCATE mvi_base;
+SELECT * FROM mvi_incr ORDER BY g;
+-- unsupported queries
+CREATE INCREMENTAL MATERIALIZED VIEW mvi_bad AS
+  SELECT sum(v) FROM mvi_base; -- error
+CREATE INCREMENTAL MATERIALIZED VIEW mvi_bad AS
+  SELECT v + 1 AS w, count(*) FROM mvi_base GROUP BY v + 1; -- error
+DROP MATERIALIZED VIEW mvi_incr;
+DROP TABLE mvi_base;
@@ -241,6 +241,13 @@ SELECT COUNT(*),AVG(t2.unique1) FROM tenk1 t1,
 LATERAL (SELECT t2.unique1 FROM tenk1 t2 WHERE t1.twenty = t2.unique1) t2
 WHERE t1.unique1 < 1000;
 
+-- Ensure the results are the same with a cache shared by the workers.
+SET memoize_shared_cache TO on;
+SELECT COUNT(*),AVG(t2.unique1) FROM tenk1 t1,
+LATERAL (SELECT t2.unique1 FROM tenk1 t2 WHERE t1.twenty = t2.unique1) t2
+WHERE t1.unique1 < 1000;
+RESET memoize_shared_cache;
+
 RESET max_parallel_workers_per_gather;
 RESET parallel_tuple_cost;
 RESET parallel_setup_cost;
@@ -271,3 +278,16 @@ SELECT * FROM tab_anti t1 WHERE t1.a IN
   (SELECT t1.b FROM tab_anti t3 WHERE t2.a > 1 OFFSET 0));
 
 DROP TABLE tab_anti;
+
+-- Test caching the results of a correlated subplan
+SET enable_subplan_cache TO on;
+SET enable_bitmapscan TO off;
+SELECT explain_memoize('
+SELECT COUNT(*), SUM((SELECT t2.unique2 FROM tenk1 t2 WHERE t2.unique1 = t1.twenty))
+FROM tenk1 t1 WHERE t1.unique1 < 1000;', false);
+
+-- And check we get the expected results.
+SELECT COUNT(*), SUM((SELECT t2.unique2 FROM tenk1 t2 WHERE t2.unique1 = t1.twenty))
+FROM tenk1 t1 WHERE t1.unique1 < 1000;
+RESET enable_bitmapscan;
+RESET enable_subplan_cache;
@@ -1495,6 +1495,16 @@ select trim_scale(1e100);
 SELECT SUM(9999::numeric) FROM generate_series(1, 100000);
 SELECT SUM((-9999)::numeric) FROM generate_series(1, 100000);
 
+-- inputs with the same scale are summed as scaled integers; check mixing
+-- them with inputs of other scales or too large ones
+SELECT SUM(x), AVG(x) FROM (VALUES (1.25), (2.5), (-0.75), (10)) v(x);
+SELECT SUM(x) FROM (VALUES (1e20), (1.5), (1e20)) v(x);
+SELECT SUM(CASE WHEN g = 1 THEN 0.5 ELSE 9999 END)
+  FROM generate_series(1, 100000) g;
+SELECT i, SUM(x) OVER w, AVG(x) OVER w
+  FROM (VALUES (1, 1.10), (2, 2.20), (3, 3.30), (4, 4.40)) v(i, x)
+  WINDOW w AS (ORDER BY i ROWS BETWEEN 1 PRECEDING AND CURRENT ROW);
+
 --
 -- Tests for VARIANCE()
 --
@@ -1447,3 +1447,36 @@ select min(a) over (partition by a order by a) from part_abc where a >= stable_o
 
 drop view part_abc_view;
 drop table part_abc;
+
+-- Generic plans should only lock partitions that survive initial pruning
+create table lockprune (a int) partition by list (a);
+create table lockprune_1 partition of lockprune for values in (1);
+create table lockprune_2 partition of lockprune for values in (2);
+create table lockprune_3 partition of lockprune for values in (3);
+set plan_cache_mode = force_generic_plan;
+prepare lockprune_q (int) as select * from lockprune where a = $1;
+execute lockprune_q (1);
+begin;
+execute lockprune_q (2);
+select relation::regclass, mode from pg_locks
+  where locktype = 'relation' and pid = pg_backend_pid()
+    and relation::regclass::text like 'lockprune%'
+  order by relation::regclass::text;
+commit;
+deallocate lockprune_q;
+reset plan_cache_mode;
+drop table lockprune;
+
+-- Append starting reads for upcoming partitions early
+create table prefetch_append (a int, b text) partition by range (a);
+create table prefetch_append_1 partition of prefetch_append for values from (0) to (1000);
+create table prefetch_append_2 partition of prefetch_append for values from (1000) to (2000);
+create table prefetch_append_3 partition of prefetch_append for values from (2000) to (3000);
+insert into prefetch_append select g, repeat('x', 100) from generate_series(0, 2999) g;
+set append_prefetch_subplans = 2;
+select count(*), sum(a) from prefetch_append;
+-- rescans, with run-time pruning
+select x, (select count(*) from prefetch_append where a >= x)
+  from (values (500), (2500)) v(x);
+reset append_prefetch_subplans;
+drop table prefetch_append;
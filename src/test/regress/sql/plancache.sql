@@ -223,3 +223,20 @@ select name, generic_plans, custom_plans from pg_prepared_statements
   where  name = 'test_mode_pp';
 
 drop table test_mode;
+
+-- simple query cache
+set simple_query_cache_size = 2;
+create temp table sqc (a int);
+insert into sqc values (1);
+select * from sqc;
+select * from sqc;
+alter table sqc add column b int default 2;
+select * from sqc;
+select 1 as x;
+select 2 as x;
+select * from sqc;
+select * into temp sqc2 from sqc;
+select * from sqc2;
+drop table sqc;
+select * from sqc;
+reset simple_query_cache_size;
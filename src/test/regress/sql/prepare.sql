@@ -82,3 +82,26 @@ SELECT name, statement, parameter_types, result_types FROM pg_prepared_statement
 DEALLOCATE ALL;
 SELECT name, statement, parameter_types FROM pg_prepared_statements
     ORDER BY name;
+
+-- reuse of executor state across executions of a generic plan
+CREATE TEMP TABLE reuse_tbl (id int PRIMARY KEY, val text);
+INSERT INTO reuse_tbl SELECT g, 'v' || g FROM generate_series(1, 100) g;
+SET plan_cache_mode = force_generic_plan;
+SET executor_state_reuse = on;
+PREPARE reuse1(int) AS SELECT val FROM reuse_tbl WHERE id = $1;
+EXECUTE reuse1(1);
+EXECUTE reuse1(42);
+EXECUTE reuse1(1000);
+PREPARE reuse2(int) AS SELECT id FROM reuse_tbl WHERE val = 'v' || $1 LIMIT 1;
+EXECUTE reuse2(7);
+EXECUTE reuse2(8);
+
+-- changing the table invalidates the plan, and the state with it
+ALTER TABLE reuse_tbl ADD COLUMN extra int DEFAULT 0;
+EXECUTE reuse1(42);
+EXECUTE reuse2(9);
+DEALLOCATE reuse1;
+DEALLOCATE reuse2;
+RESET executor_state_reuse;
+RESET plan_cache_mode;
+DROP TABLE reuse_tbl;
@@ -152,6 +152,12 @@ select regexp_match('fooba', '(?:..)*');
 select regexp_match('xyz', repeat('.', 260));
 select regexp_match('foo', '(?:.|){99}');
 
+-- Patterns with a string every match must contain
+select 'xxabcxx' ~ 'abc' as t, 'xxabxcx' ~ 'abc' as f;
+select 'abd' ~ 'ab(c|d)' as t, 'abe' ~ 'ab(c|d)' as f;
+select 'xyz' ~ '(abc)?' as t, 'ABC' ~* 'abc' as t;
+select 'x1a' ~ '(?<=x)1' as t, substring('xxabcde' from 'abc(.)') as d;
+
 -- Error conditions
 select 'xyz' ~ 'x(\w)(?=\1)';  -- no backrefs in LACONs
 select 'xyz' ~ 'x(\w)(?=(\1))';
@@ -83,6 +83,21 @@ INSERT INTO reloptions_test VALUES (1, NULL), (NULL, NULL);
 VACUUM (FREEZE, DISABLE_PAGE_SKIPPING) reloptions_test;
 SELECT pg_relation_size('reloptions_test') = 0;
 
+-- Test page_compression option
+DROP TABLE reloptions_test;
+
+CREATE TABLE reloptions_test(i INT, t text) WITH (page_compression=true);
+SELECT reloptions FROM pg_class WHERE oid = 'reloptions_test'::regclass;
+INSERT INTO reloptions_test SELECT g, repeat('x', 50) FROM generate_series(1, 1000) g;
+CREATE INDEX reloptions_test_idx ON reloptions_test (i)
+	WITH (page_compression=true);
+-- Rewritten pages are written out directly, so these read them back
+VACUUM FULL reloptions_test;
+SELECT count(*), sum(i), min(t) = max(t) FROM reloptions_test;
+SET enable_seqscan TO off;
+SELECT i, length(t) FROM reloptions_test WHERE i = 500;
+RESET enable_seqscan;
+
 -- Test toast.* options
 DROP TABLE reloptions_test;
 
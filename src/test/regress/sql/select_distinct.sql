@@ -274,3 +274,35 @@ SELECT DISTINCT y, x FROM distinct_tbl ORDER BY y;
 RESET enable_hashagg;
 
 DROP TABLE distinct_tbl;
+
+--
+-- Test loose index scans
+--
+CREATE TABLE loose_tbl (a int, b int);
+INSERT INTO loose_tbl SELECT i % 10, i FROM generate_series(1, 10000) i;
+INSERT INTO loose_tbl VALUES (NULL, 2), (NULL, 1), (3, NULL);
+CREATE INDEX loose_tbl_a_b_idx ON loose_tbl (a, b);
+VACUUM ANALYZE loose_tbl;
+
+SET enable_looseindexscan = on;
+
+EXPLAIN (COSTS OFF)
+SELECT DISTINCT a FROM loose_tbl ORDER BY a;
+SELECT DISTINCT a FROM loose_tbl ORDER BY a;
+
+EXPLAIN (COSTS OFF)
+SELECT DISTINCT a FROM loose_tbl WHERE a > 5;
+SELECT DISTINCT a FROM loose_tbl WHERE a > 5;
+
+-- The first row of each group is the one with the smallest b
+EXPLAIN (COSTS OFF)
+SELECT DISTINCT ON (a) a, b FROM loose_tbl ORDER BY a, b;
+SELECT DISTINCT ON (a) a, b FROM loose_tbl ORDER BY a, b;
+
+EXPLAIN (COSTS OFF)
+SELECT a, min(b) FROM loose_tbl GROUP BY a ORDER BY a;
+SELECT a, min(b) FROM loose_tbl GROUP BY a ORDER BY a;
+
+RESET enable_looseindexscan;
+
+DROP TABLE loose_tbl;
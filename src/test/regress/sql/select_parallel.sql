@@ -99,6 +99,21 @@ select length(stringu1) from tenk1 group by length(stringu1);
 explain (costs off)
 	select stringu1, count(*) from tenk1 group by stringu1 order by stringu1;
 
+-- test that duplicates are removed below the Gather for set operations
+explain (costs off)
+	select ten from tenk1 union select four from tenk1;
+select count(*) from (select ten from tenk1 union select four from tenk1) ss;
+explain (costs off)
+	select ten from tenk1 except select four from tenk1;
+select count(*) from (select ten from tenk1 except select four from tenk1) ss;
+
+-- test parallel scan of a materialized CTE
+explain (costs off)
+	with x as materialized (select ten from tenk1)
+	select count(*), sum(ten) from x;
+with x as materialized (select ten from tenk1)
+select count(*), sum(ten) from x;
+
 -- test that parallel plan for aggregates is not selected when
 -- target list contains parallel restricted clause.
 explain (costs off)
@@ -226,6 +241,8 @@ create table bmscantest (a int, t text);
 insert into bmscantest select r, 'fooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooooo' FROM generate_series(1,100000) r;
 create index i_bmtest ON bmscantest(a);
 select count(*) from bmscantest where a>1;
+-- BitmapOr of index scans shared by all participants
+select count(*) from bmscantest where a < 100 or a > 99900;
 
 -- test accumulation of stats for parallel nodes
 reset enable_seqscan;
@@ -296,6 +313,13 @@ explain (costs off)
 
 select count(*) from tenk1 group by twenty;
 
+-- test partial aggregation below grouping sets
+explain (costs off)
+   select four, ten, count(*) from tenk1 group by rollup (four, ten);
+
+select four, count(*), sum(unique1), grouping(four)
+  from tenk1 group by rollup (four) order by 1;
+
 --test expressions in targetlist are pushed down for gather merge
 create function sp_simple_func(var1 integer) returns integer
 as $$
@@ -344,6 +368,27 @@ reset enable_material;
 
 reset enable_hashagg;
 
+-- test parallel-aware sort below gather merge
+set enable_parallel_sort = on;
+explain (costs off)
+  select string4, unique1 from tenk1 order by string4, unique1;
+select count(*) as n,
+       count(*) filter (where (string4, unique1) < (ps, pu)) as out_of_order
+  from (select string4, unique1,
+               lag(string4) over () as ps, lag(unique1) over () as pu
+        from (select string4, unique1 from tenk1
+              order by string4, unique1) ss) s;
+-- the leader merges the runs even if it doesn't otherwise participate
+set parallel_leader_participation = off;
+select count(*) as n,
+       count(*) filter (where (string4, unique1) < (ps, pu)) as out_of_order
+  from (select string4, unique1,
+               lag(string4) over () as ps, lag(unique1) over () as pu
+        from (select string4, unique1 from tenk1
+              order by string4, unique1) ss) s;
+reset parallel_leader_participation;
+reset enable_parallel_sort;
+
 -- check parallelized int8 aggregate (bug #14897)
 explain (costs off)
 select avg(unique1::int8) from tenk1;
@@ -441,6 +486,16 @@ explain (costs off, verbose)
   select count(*) from tenk1 a where (unique1, two) in
     (select unique1, row_number() over() from tenk1 b);
 
+-- Window functions partitioned by a shared PARTITION BY key can be split
+-- between the workers by hashing that key.
+set enable_parallel_window = on;
+select count(*), sum(c), sum(rn) from
+  (select count(*) over (partition by four) c,
+          row_number() over (partition by four, ten order by unique1) rn
+   from tenk1) s;
+select four, ten, row_number() over (partition by four order by ten, unique1) rn
+  from tenk1 order by four, rn limit 3;
+reset enable_parallel_window;
 
 -- LIMIT/OFFSET within sub-selects can't be pushed to workers.
 explain (costs off)
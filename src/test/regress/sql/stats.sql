@@ -893,6 +893,24 @@ SELECT pg_stat_get_tuples_hot_updated('brin_hot'::regclass::oid);
 DROP TABLE brin_hot;
 DROP FUNCTION wait_for_hot_stats();
 
+-- test that an expression index doesn't block HOT updates as long as its
+-- value doesn't change
+CREATE TABLE expr_hot (id int PRIMARY KEY, doc jsonb)
+  WITH (autovacuum_enabled = off, fillfactor = 50);
+INSERT INTO expr_hot VALUES (1, '{"status": "new", "n": 0}');
+CREATE INDEX expr_hot_status ON expr_hot ((doc->>'status'));
+BEGIN;
+UPDATE expr_hot SET doc = jsonb_set(doc, '{n}', '1') WHERE id = 1;
+UPDATE expr_hot SET doc = jsonb_set(doc, '{status}', '"done"') WHERE id = 1;
+SELECT pg_stat_get_xact_tuples_updated('expr_hot'::regclass) AS updated,
+       pg_stat_get_xact_tuples_hot_updated('expr_hot'::regclass) AS hot_updated;
+COMMIT;
+SET enable_seqscan = off;
+SELECT id, doc->>'n' AS n FROM expr_hot WHERE doc->>'status' = 'done';
+SELECT count(*) FROM expr_hot WHERE doc->>'status' = 'new';
+RESET enable_seqscan;
+DROP TABLE expr_hot;
+
 -- Test handling of index predicates - updating attributes in precicates
 -- should not block HOT when summarizing indexes are involved. We update
 -- a row that was not indexed due to the index predicate, and becomes
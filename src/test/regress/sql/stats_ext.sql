@@ -1864,5 +1864,26 @@ ANALYZE sb_2;
 
 SELECT * FROM check_estimated_rows('SELECT * FROM sb_2 WHERE numeric_lt(y, 1.0)');
 
+
+-- Join estimates using multi-column statistics of both relations
+CREATE TABLE join_stats_1 (a int, b int);
+CREATE TABLE join_stats_2 (a int, b int);
+INSERT INTO join_stats_1 SELECT i % 100, i % 100 FROM generate_series(1, 1000) s(i);
+INSERT INTO join_stats_2 SELECT i % 100 + 50, i % 100 + 50 FROM generate_series(1, 1000) s(i);
+ANALYZE join_stats_1, join_stats_2;
+SELECT * FROM check_estimated_rows('SELECT * FROM join_stats_1 t1 JOIN join_stats_2 t2 ON t1.a = t2.a AND t1.b = t2.b');
+CREATE STATISTICS join_stats_1_nd (ndistinct) ON a, b FROM join_stats_1;
+CREATE STATISTICS join_stats_2_nd (ndistinct) ON a, b FROM join_stats_2;
+ANALYZE join_stats_1, join_stats_2;
+SELECT * FROM check_estimated_rows('SELECT * FROM join_stats_1 t1 JOIN join_stats_2 t2 ON t1.a = t2.a AND t1.b = t2.b');
+-- MCV lists find the combinations present on both sides
+CREATE STATISTICS join_stats_1_mcv (mcv) ON a, b FROM join_stats_1;
+CREATE STATISTICS join_stats_2_mcv (mcv) ON a, b FROM join_stats_2;
+ANALYZE join_stats_1, join_stats_2;
+SELECT * FROM check_estimated_rows('SELECT * FROM join_stats_1 t1 JOIN join_stats_2 t2 ON t1.a = t2.a AND t1.b = t2.b');
+SELECT * FROM check_estimated_rows('SELECT * FROM join_stats_1 t1 LEFT JOIN join_stats_2 t2 ON t1.a = t2.a AND t1.b = t2.b');
+
+DROP TABLE join_stats_1, join_stats_2;
+
 -- Tidy up
 DROP TABLE sb_1, sb_2 CASCADE;
@@ -42,6 +42,10 @@ from contexts c1, contexts c2
 where c2.name = 'CacheMemoryContext'
 and c1.path[c2.level] = c2.path[c2.level];
 
+-- Our own backend's memory must be accounted for in pg_stat_backend_memory
+select backend_type, allocated_bytes > 0 as ok
+  from pg_stat_backend_memory where pid = pg_backend_pid();
+
 -- At introduction, pg_config had 23 entries; it may grow
 select count(*) > 20 as ok from pg_config;
 
@@ -305,3 +305,28 @@ EXPLAIN (COSTS OFF) :qry;
 :qry;
 
 COMMIT;
+
+-- radix sort of large inputs on a fixed-width or abbreviated leading key
+CREATE TEMP TABLE radix_sort_data AS
+    SELECT CASE WHEN i % 97 = 0 THEN NULL ELSE (i * 7919) % 1000 - 500 END::int8 AS a,
+        (i * 31) % 17 AS b,
+        'k' || (i * 7) % 3001 AS t
+    FROM generate_series(1, 5000) i;
+
+SELECT md5(string_agg(coalesce(a::text, 'n'), ',' ORDER BY a)) FROM radix_sort_data;
+SELECT md5(string_agg(coalesce(a::text, 'n'), ',' ORDER BY a DESC NULLS LAST)) FROM radix_sort_data;
+SELECT md5(string_agg(coalesce(a::text, 'n'), ',' ORDER BY a::int4 DESC)) FROM radix_sort_data;
+SELECT md5(string_agg(coalesce(a::text, 'n'), ',' ORDER BY a::int4 NULLS FIRST)) FROM radix_sort_data;
+SELECT md5(string_agg(coalesce(a::text, 'n') || ':' || b, ',' ORDER BY a, b DESC)) FROM radix_sort_data;
+SELECT md5(string_agg(t, ',' ORDER BY t COLLATE "C")) FROM radix_sort_data;
+
+DROP TABLE radix_sort_data;
+
+-- external sort merging many runs
+BEGIN;
+SET LOCAL work_mem = '64kB';
+SELECT count(*) AS n, count(*) FILTER (WHERE a < prev) AS out_of_order
+FROM (SELECT a, lag(a) OVER (ORDER BY a) AS prev
+      FROM (SELECT (i * 7919) % 20011 AS a
+            FROM generate_series(1, 20011) i) s) t;
+COMMIT;
@@ -670,3 +670,20 @@ update hash_parted set b = b + 8 where b = 1;
 drop table hash_parted;
 drop operator class custom_opclass using hash;
 drop function dummy_hashint4(a int4, seed int8);
+
+-- UPDATE batches insertions into non-unique indexes; check that all entries
+-- get there, across several batches
+create table upd_batch (a int primary key, b int, c text);
+create index upd_batch_b on upd_batch (b);
+create index upd_batch_c on upd_batch (lower(c)) where b % 2 = 0;
+insert into upd_batch select g, g, 'Row' || g from generate_series(1, 2500) g;
+update upd_batch set b = b + 1, c = c || '!';
+-- unique indexes are still checked row by row
+update upd_batch set a = a + 1 where a in (1, 2);
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+select count(*) from upd_batch where b between 2 and 2501;
+select a, b from upd_batch where b % 2 = 0 and lower(c) = 'row2001!';
+reset enable_seqscan;
+reset enable_bitmapscan;
+drop table upd_batch;
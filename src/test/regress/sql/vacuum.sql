@@ -237,6 +237,31 @@ SELECT relname, relhasindex FROM pg_class
   WHERE relname LIKE 'vacparted_i%' AND relkind IN ('p','r')
   ORDER BY relname;
 DROP TABLE vacparted_i;
+-- INCREMENTAL merges the statistics of the partitions into the parent's, and
+-- skips partitions not modified since they were last analyzed
+CREATE TABLE vacparted_incr (a int, b int, c text) PARTITION BY RANGE (a);
+CREATE TABLE vacparted_incr1 PARTITION OF vacparted_incr FOR VALUES FROM (0) TO (1000)
+  WITH (autovacuum_enabled = off);
+CREATE TABLE vacparted_incr2 PARTITION OF vacparted_incr FOR VALUES FROM (1000) TO (2000)
+  WITH (autovacuum_enabled = off);
+INSERT INTO vacparted_incr
+  SELECT i, i % 10, CASE WHEN i % 4 = 0 THEN NULL ELSE 'x' END
+  FROM generate_series(0, 1999) i;
+SELECT pg_stat_force_next_flush();
+ANALYZE (INCREMENTAL) vacparted_incr;
+SELECT attname, null_frac, n_distinct, most_common_vals FROM pg_stats
+  WHERE tablename = 'vacparted_incr' AND inherited ORDER BY attname;
+CREATE TABLE vacparted_incr3 PARTITION OF vacparted_incr FOR VALUES FROM (2000) TO (3000)
+  WITH (autovacuum_enabled = off);
+INSERT INTO vacparted_incr SELECT i, i % 20, NULL FROM generate_series(2000, 2999) i;
+SELECT pg_stat_force_next_flush();
+ANALYZE (INCREMENTAL) vacparted_incr;
+SELECT relname, analyze_count FROM pg_stat_user_tables
+  WHERE relname LIKE 'vacparted_incr%' ORDER BY relname;
+SELECT attname, null_frac, n_distinct, most_common_vals FROM pg_stats
+  WHERE tablename = 'vacparted_incr' AND inherited ORDER BY attname;
+VACUUM (INCREMENTAL) vacparted_incr;
+DROP TABLE vacparted_incr;
 
 -- multiple tables specified
 VACUUM vaccluster, vactst;
@@ -525,3 +550,20 @@ SELECT id, pg_column_toast_chunk_id(f1) IS NULL AS f1_chunk_null,
 SELECT pg_column_toast_chunk_id(f1) = :'id_2_chunk' AS same_chunk
   FROM vac_rewrite_toast WHERE id = 2;
 DROP TABLE vac_rewrite_toast;
+
+-- pg_stat_autovacuum_queue
+CREATE TABLE vac_queue_off (a int) WITH (autovacuum_enabled = off);
+INSERT INTO vac_queue_off SELECT generate_series(1, 1000);
+DELETE FROM vac_queue_off;
+SELECT count(*) FROM pg_stat_autovacuum_queue
+  WHERE relid = 'vac_queue_off'::regclass;
+-- Tables come in processing order: wraparound first, then by score.
+SELECT count(*) AS misordered
+  FROM (SELECT wraparound, score,
+               lag(wraparound) OVER w AS prev_wraparound,
+               lag(score) OVER w AS prev_score
+          FROM pg_stat_get_autovacuum_queue() WITH ORDINALITY AS q
+        WINDOW w AS (ORDER BY ordinality)) s
+  WHERE (prev_wraparound = wraparound AND prev_score < score) OR
+        (NOT prev_wraparound AND wraparound);
+DROP TABLE vac_queue_off;
@@ -39,6 +39,23 @@ VACUUM (PARALLEL 4, INDEX_CLEANUP ON) parallel_vacuum_table;
 -- assertion failure with bug #17245 (in the absence of bugfix):
 INSERT INTO parallel_vacuum_table SELECT i FROM generate_series(1, 10000) i;
 
+-- Parallel heap scan, with dead items overflowing a tiny memory budget
+-- so that the scan is performed in several rounds:
+SET min_parallel_table_scan_size TO 0;
+SET maintenance_work_mem TO '64kB';
+CREATE TABLE parallel_vacuum_heap (a int, b text) WITH (autovacuum_enabled = off);
+INSERT INTO parallel_vacuum_heap SELECT i, repeat('x', 100) FROM generate_series(1, 20000) i;
+CREATE INDEX parallel_vacuum_heap_a ON parallel_vacuum_heap (a);
+DELETE FROM parallel_vacuum_heap WHERE a % 3 <> 0;
+VACUUM (PARALLEL 2) parallel_vacuum_heap;
+SELECT count(*), sum(a) FROM parallel_vacuum_heap;
+SET enable_seqscan TO off;
+SELECT count(*) FROM parallel_vacuum_heap WHERE a < 100;
+RESET enable_seqscan;
+RESET maintenance_work_mem;
+RESET min_parallel_table_scan_size;
+DROP TABLE parallel_vacuum_heap;
+
 RESET max_parallel_maintenance_workers;
 RESET min_parallel_index_scan_size;
 
@@ -1918,6 +1918,32 @@ SELECT i, b, bool_and(b) OVER w, bool_or(b) OVER w
   FROM (VALUES (1,true), (2,true), (3,false), (4,false), (5,true)) v(i,b)
   WINDOW w AS (ORDER BY i ROWS BETWEEN CURRENT ROW AND 1 FOLLOWING);
 
+-- Test moving aggregates without inverse transition functions, which use
+-- their combine function to avoid restarting for every row.  Compare with
+-- the results computed by plain aggregates over the same rows.
+WITH vs AS (
+	SELECT i, CASE WHEN i % 7 = 0 THEN NULL ELSE (i * 37) % 101 END AS v
+	FROM generate_series(1, 200) AS i
+)
+SELECT count(*) AS total,
+	count(*) FILTER (WHERE mx IS DISTINCT FROM
+		(SELECT max(v) FROM vs
+		 WHERE vs.i % 3 = w.i % 3 AND vs.i BETWEEN w.i - 6 AND w.i)) AS max_diff,
+	count(*) FILTER (WHERE mn IS DISTINCT FROM
+		(SELECT min(v) FILTER (WHERE v % 2 = 0) FROM vs
+		 WHERE vs.i BETWEEN w.i - 3 AND w.i + 2)) AS min_diff,
+	count(*) FILTER (WHERE tx IS DISTINCT FROM
+		(SELECT max(v::text) FROM vs
+		 WHERE vs.i BETWEEN w.i - 10 AND w.i - 2)) AS text_diff
+FROM (SELECT i,
+		max(v) OVER (PARTITION BY i % 3 ORDER BY i
+					 ROWS BETWEEN 2 PRECEDING AND CURRENT ROW) AS mx,
+		min(v) FILTER (WHERE v % 2 = 0) OVER (ORDER BY i
+					 ROWS BETWEEN 3 PRECEDING AND 2 FOLLOWING) AS mn,
+		max(v::text) OVER (ORDER BY i
+					 ROWS BETWEEN 10 PRECEDING AND 2 PRECEDING) AS tx
+	  FROM vs) w;
+
 --
 -- Test WindowAgg costing takes into account the number of rows that need to
 -- be fetched before the first row can be output.
@@ -35,6 +35,18 @@ refresh materialized view parallel_mat_view;
 refresh materialized view concurrently parallel_mat_view;
 drop materialized view parallel_mat_view;
 
+-- With a Gather at the top, the workers insert the rows themselves
+explain (costs off) create table parallel_write as
+    select unique1, stringu1 from tenk1 where ten = 7;
+create table parallel_write as
+    select unique1, stringu1 from tenk1 where ten = 7;
+select count(*), sum(unique1) from parallel_write;
+drop table parallel_write;
+
+-- ... and for COPY (query) TO, format them
+copy (select unique1, stringu1 from tenk1 where stringu1 = 'AAAAAA')
+    to stdout with (format csv, force_quote (stringu1));
+
 prepare prep_stmt as select length(stringu1) from tenk1 group by length(stringu1);
 explain (costs off) create table parallel_write as execute prep_stmt;
 create table parallel_write as execute prep_stmt;
@@ -248,6 +248,17 @@ SKIP:
 		expected_stderr => qr/could not open/);
 }
 
+# Kernel TLS falls back to encryption within OpenSSL wherever the library
+# or the kernel can't offload it, so connections must work either way.
+$node->append_conf('sslconfig.conf', "ssl_ktls = on");
+$node->reload;
+$node->connect_ok(
+	"$common_connstr sslrootcert=ssl/root+server_ca.crt sslmode=require sslktls=1",
+	"connect with kernel TLS",
+	sql => "SELECT length(string_agg(md5(i::text), '')) "
+	  . "FROM generate_series(1, 100000) i",
+	expected_stdout => qr/^3200000$/);
+
 # The server should not accept non-SSL connections.
 $node->connect_fails(
 	"$common_connstr sslmode=disable",
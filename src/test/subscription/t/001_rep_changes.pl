@@ -530,6 +530,31 @@ is($result, qq(0), 'check non-replicated table is empty on subscriber');
 $node_publisher->append_conf('postgresql.conf', "log_min_messages = warning");
 $node_publisher->reload;
 
+# Changes to tables that are not published are discarded as soon as they are
+# decoded, so a large transaction making them is neither spilled to disk nor
+# streamed.
+$node_publisher->append_conf('postgresql.conf',
+	"logical_decoding_work_mem = 64kB");
+$node_publisher->reload;
+$node_publisher->safe_psql('postgres', "INSERT INTO tab_notrep VALUES (12)");
+$node_publisher->wait_for_catchup('tap_sub');
+$node_publisher->safe_psql('postgres',
+	"SELECT pg_stat_reset_replication_slot('tap_sub')");
+
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO tab_notrep SELECT generate_series(1, 20000)");
+$node_publisher->wait_for_catchup('tap_sub');
+
+$result = $node_publisher->safe_psql('postgres',
+	"SELECT spill_txns + stream_txns FROM pg_stat_replication_slots WHERE slot_name = 'tap_sub'"
+);
+is($result, qq(0),
+	'changes to a non-replicated table are discarded while decoding');
+
+$node_publisher->append_conf('postgresql.conf',
+	"logical_decoding_work_mem = 64MB");
+$node_publisher->reload;
+
 # note that data are different on provider and subscriber
 $result = $node_subscriber->safe_psql('postgres',
 	"SELECT count(*), min(a), max(a) FROM tab_ins");
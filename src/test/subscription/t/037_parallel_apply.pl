@@ -0,0 +1,114 @@
+
+# Copyright (c) 2025, PostgreSQL Global Development Group
+
+# Test applying non-streamed transactions with parallel apply workers
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node_publisher = PostgreSQL::Test::Cluster->new('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->start;
+
+my $node_subscriber = PostgreSQL::Test::Cluster->new('subscriber');
+$node_subscriber->init;
+$node_subscriber->append_conf(
+	'postgresql.conf', qq(
+max_logical_replication_workers = 10
+max_parallel_apply_workers_per_subscription = 4
+parallel_apply_non_streamed = on
+));
+$node_subscriber->start;
+
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+
+# The subscriber has a unique index the publisher doesn't have, so that
+# changes can depend on each other through it, too.
+$node_publisher->safe_psql('postgres',
+	"CREATE TABLE tab1 (a int PRIMARY KEY, b int, c text)");
+$node_subscriber->safe_psql(
+	'postgres', qq(
+CREATE TABLE tab1 (a int PRIMARY KEY, b int, c text);
+CREATE UNIQUE INDEX tab1_b_idx ON tab1 (b);
+));
+
+$node_publisher->safe_psql('postgres',
+	"CREATE TABLE tab2 (a int PRIMARY KEY, b int)");
+$node_subscriber->safe_psql('postgres',
+	"CREATE TABLE tab2 (a int PRIMARY KEY, b int)");
+
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR TABLE tab1, tab2");
+$node_subscriber->safe_psql('postgres',
+	"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr' PUBLICATION tap_pub"
+);
+
+$node_subscriber->wait_for_subscription_sync($node_publisher, 'tap_sub');
+
+# Many small transactions, each depending on the one before it through the
+# primary key, the unique index on the subscriber, or both.
+my $sql = '';
+for my $i (1 .. 100)
+{
+	$sql .= "INSERT INTO tab1 VALUES ($i, $i, 'row $i');\n";
+	$sql .= "INSERT INTO tab2 VALUES ($i, $i);\n";
+}
+for my $i (1 .. 100)
+{
+	# Move the value of b around, freeing it for another row each time.
+	my $j = $i % 100 + 1;
+	$sql .= "UPDATE tab1 SET b = -b WHERE a = $i;\n";
+	$sql .= "UPDATE tab1 SET c = c || ' updated' WHERE a = $j;\n";
+	$sql .= "UPDATE tab2 SET b = b + 1 WHERE a = $j;\n";
+}
+for my $i (1 .. 50)
+{
+	$sql .= "DELETE FROM tab1 WHERE a = $i;\n";
+	$sql .= "INSERT INTO tab1 VALUES ($i + 1000, $i, 'reused $i');\n";
+}
+$sql .= "TRUNCATE tab2;\n";
+for my $i (1 .. 20)
+{
+	$sql .= "INSERT INTO tab2 VALUES ($i, $i);\n";
+}
+$node_publisher->safe_psql('postgres', $sql);
+
+$node_publisher->wait_for_catchup('tap_sub');
+
+my $query = "SELECT a, b, c FROM tab1 ORDER BY a";
+is( $node_subscriber->safe_psql('postgres', $query),
+	$node_publisher->safe_psql('postgres', $query),
+	'tab1 is the same on publisher and subscriber');
+
+$query = "SELECT a, b FROM tab2 ORDER BY a";
+is( $node_subscriber->safe_psql('postgres', $query),
+	$node_publisher->safe_psql('postgres', $query),
+	'tab2 is the same on publisher and subscriber');
+
+# The workers are kept around for the next transactions.
+ok( $node_subscriber->poll_query_until(
+		'postgres',
+		"SELECT count(*) > 0 FROM pg_stat_subscription WHERE worker_type = 'parallel apply'"
+	),
+	'parallel apply workers were used');
+
+# Turning the feature off again makes the leader apply everything itself.
+$node_subscriber->append_conf('postgresql.conf',
+	'parallel_apply_non_streamed = off');
+$node_subscriber->reload;
+
+$node_publisher->safe_psql('postgres',
+	"UPDATE tab1 SET b = b + 1000; DELETE FROM tab2 WHERE a > 10;");
+$node_publisher->wait_for_catchup('tap_sub');
+
+$query = "SELECT a, b, c FROM tab1 ORDER BY a";
+is( $node_subscriber->safe_psql('postgres', $query),
+	$node_publisher->safe_psql('postgres', $query),
+	'tab1 is the same after disabling parallel apply');
+
+$node_subscriber->stop('fast');
+$node_publisher->stop('fast');
+
+done_testing();
@@ -0,0 +1,86 @@
+
+# Copyright (c) 2025, PostgreSQL Global Development Group
+
+# Test copying a table with parallel tablesync workers
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node_publisher = PostgreSQL::Test::Cluster->new('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->start;
+
+# A min_parallel_table_scan_size of 0 lets even a small table be split into
+# many chunks.
+my $node_subscriber = PostgreSQL::Test::Cluster->new('subscriber');
+$node_subscriber->init;
+$node_subscriber->append_conf(
+	'postgresql.conf', qq(
+max_sync_workers_per_table = 3
+max_prepared_transactions = 10
+min_parallel_table_scan_size = 0
+log_min_messages = debug1
+));
+$node_subscriber->start;
+
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+
+$node_publisher->safe_psql(
+	'postgres', qq(
+CREATE TABLE tab1 (a int PRIMARY KEY, b text);
+INSERT INTO tab1 SELECT i, repeat('x', i % 100) FROM generate_series(1, 20000) i;
+CREATE TABLE tab2 (a int, b int);
+INSERT INTO tab2 SELECT i, i % 10 FROM generate_series(1, 20000) i;
+));
+$node_subscriber->safe_psql(
+	'postgres', qq(
+CREATE TABLE tab1 (a int PRIMARY KEY, b text);
+CREATE TABLE tab2 (a int, b int);
+));
+
+# tab2 has a row filter, which must be applied to every chunk.
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR TABLE tab1, tab2 WHERE (b < 5)");
+
+my $log_offset = -s $node_subscriber->logfile;
+
+$node_subscriber->safe_psql('postgres',
+	"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr' PUBLICATION tap_pub"
+);
+$node_subscriber->wait_for_subscription_sync($node_publisher, 'tap_sub');
+
+ok( $node_subscriber->log_contains(
+		qr/copying table "public.tab1" in \d+ chunks of \d+ blocks with [1-9]\d* helper processes/,
+		$log_offset),
+	'table copied by parallel tablesync workers');
+
+is( $node_subscriber->safe_psql(
+		'postgres', "SELECT count(*), sum(a), sum(length(b)) FROM tab1"),
+	$node_publisher->safe_psql(
+		'postgres', "SELECT count(*), sum(a), sum(length(b)) FROM tab1"),
+	'all rows of tab1 copied exactly once');
+
+is( $node_subscriber->safe_psql('postgres',
+		"SELECT count(*), sum(a) FROM tab2"),
+	$node_publisher->safe_psql('postgres',
+		"SELECT count(*), sum(a) FROM tab2 WHERE b < 5"),
+	'row filter applied to all chunks of tab2');
+
+is($node_subscriber->safe_psql('postgres', "SELECT count(*) FROM pg_prepared_xacts"),
+	'0', 'no prepared transactions left behind');
+
+# Changes made after the copy are replicated on top of it.
+$node_publisher->safe_psql('postgres',
+	"UPDATE tab1 SET b = 'updated' WHERE a % 1000 = 0");
+$node_publisher->wait_for_catchup('tap_sub');
+
+is( $node_subscriber->safe_psql(
+		'postgres', "SELECT count(*) FROM tab1 WHERE b = 'updated'"),
+	'20', 'changes replicated after parallel copy');
+
+$node_subscriber->stop('fast');
+$node_publisher->stop('fast');
+
+done_testing();
@@ -0,0 +1,158 @@
+
+# Copyright (c) 2021-2025, PostgreSQL Global Development Group
+
+# Tests that consecutive inserts are sent and applied as MULTI INSERT messages
+use strict;
+use warnings FATAL => 'all';
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+# Create publisher node
+my $node_publisher = PostgreSQL::Test::Cluster->new('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->append_conf('postgresql.conf', 'autovacuum = off');
+$node_publisher->start;
+
+# Create subscriber node
+my $node_subscriber = PostgreSQL::Test::Cluster->new('subscriber');
+$node_subscriber->init;
+$node_subscriber->start;
+
+# A plain table, one with a BEFORE ROW trigger on the subscriber, and a
+# partitioned table
+my $ddl = qq(
+	CREATE TABLE tab_plain (a int primary key, b text);
+	CREATE TABLE tab_trig (a int primary key, b text);
+	CREATE TABLE tab_part (a int primary key, b text) PARTITION BY RANGE (a);
+	CREATE TABLE tab_part_1 PARTITION OF tab_part FOR VALUES FROM (0) TO (500);
+	CREATE TABLE tab_part_2 PARTITION OF tab_part FOR VALUES FROM (500) TO (MAXVALUE);
+);
+$node_publisher->safe_psql('postgres', $ddl);
+$node_subscriber->safe_psql('postgres', $ddl);
+$node_subscriber->safe_psql(
+	'postgres', qq(
+	CREATE FUNCTION trig_upper() RETURNS trigger LANGUAGE plpgsql AS
+	\$\$ BEGIN NEW.b := upper(NEW.b); RETURN NEW; END \$\$;
+	CREATE TRIGGER tab_trig_upper BEFORE INSERT ON tab_trig
+		FOR EACH ROW EXECUTE FUNCTION trig_upper();
+	ALTER TABLE tab_trig ENABLE ALWAYS TRIGGER tab_trig_upper;
+));
+
+# Setup logical replication
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR TABLE tab_plain, tab_trig, tab_part");
+
+$node_subscriber->safe_psql('postgres',
+	"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr' PUBLICATION tap_pub"
+);
+
+$node_subscriber->wait_for_subscription_sync($node_publisher, 'tap_sub');
+
+# Insert more rows than fit in one message, interleaved with an update
+$node_publisher->safe_psql(
+	'postgres', qq(
+	BEGIN;
+	INSERT INTO tab_plain SELECT g, 'row ' || g FROM generate_series(1, 2500) g;
+	UPDATE tab_plain SET b = 'updated' WHERE a = 2500;
+	INSERT INTO tab_plain VALUES (2501, 'last');
+	INSERT INTO tab_trig SELECT g, 'row ' || g FROM generate_series(1, 100) g;
+	INSERT INTO tab_part SELECT g, 'row ' || g FROM generate_series(1, 1000) g;
+	COMMIT;
+));
+
+$node_publisher->wait_for_catchup('tap_sub');
+
+my $result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), min(a), max(a), count(DISTINCT b) FROM tab_plain");
+is($result, qq(2501|1|2501|2501), 'multi-row inserts applied to plain table');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT b FROM tab_plain WHERE a IN (2500, 2501) ORDER BY a");
+is( $result, qq(updated
+last), 'update between multi-row inserts applied in order');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), count(*) FILTER (WHERE b = upper(b)) FROM tab_trig");
+is($result, qq(100|100),
+	'multi-row inserts applied to table with BEFORE ROW trigger');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*) FROM tab_part_1 UNION ALL SELECT count(*) FROM tab_part_2"
+);
+is( $result, qq(499
+501), 'multi-row inserts routed to partitions');
+
+# A conflict within a multi-row insert is detected
+$node_subscriber->safe_psql('postgres',
+	"INSERT INTO tab_plain VALUES (3005, 'conflict')");
+
+my $log_offset = -s $node_subscriber->logfile;
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO tab_plain SELECT g, 'row ' || g FROM generate_series(3001, 3010) g"
+);
+$node_subscriber->wait_for_log(
+	qr/conflict detected on relation "public.tab_plain": conflict=insert_exists/,
+	$log_offset);
+
+$node_subscriber->safe_psql('postgres',
+	"DELETE FROM tab_plain WHERE a = 3005");
+$node_publisher->wait_for_catchup('tap_sub');
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*) FROM tab_plain WHERE a > 3000");
+is($result, qq(10), 'multi-row insert applied after resolving conflict');
+
+# Check the messages the publisher sends
+$node_subscriber->safe_psql('postgres', "ALTER SUBSCRIPTION tap_sub DISABLE");
+
+$node_publisher->poll_query_until(
+	'postgres',
+	"SELECT COUNT(*) FROM pg_catalog.pg_replication_slots WHERE slot_name = 'tap_sub' AND active='f'",
+	1);
+
+$node_publisher->safe_psql(
+	'postgres', qq(
+	BEGIN;
+	INSERT INTO tab_plain SELECT g, 'row ' || g FROM generate_series(4001, 4003) g;
+	INSERT INTO tab_trig VALUES (4001, 'single');
+	COMMIT;
+));
+
+# 66 105 73 67 == B i I C == BEGIN MULTI-INSERT INSERT COMMIT
+$result = $node_publisher->safe_psql(
+	'postgres', qq(
+		SELECT get_byte(data, 0)
+		FROM pg_logical_slot_peek_binary_changes('tap_sub', NULL, NULL,
+			'proto_version', '5',
+			'publication_names', 'tap_pub')
+		WHERE get_byte(data, 0) <> 82
+));
+is( $result, qq(66
+105
+73
+67),
+	'consecutive inserts sent as a multi-row insert with proto_version 5');
+
+# 66 73 73 73 73 67 == B I I I I C
+$result = $node_publisher->safe_psql(
+	'postgres', qq(
+		SELECT get_byte(data, 0)
+		FROM pg_logical_slot_peek_binary_changes('tap_sub', NULL, NULL,
+			'proto_version', '4',
+			'publication_names', 'tap_pub')
+		WHERE get_byte(data, 0) <> 82
+));
+is( $result, qq(66
+73
+73
+73
+73
+67),
+	'inserts sent one by one with proto_version 4');
+
+$node_subscriber->stop('fast');
+$node_publisher->stop('fast');
+
+done_testing();